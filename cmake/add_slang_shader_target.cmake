@@ -1,10 +1,34 @@
 include_guard()
 
+# Adds the command compiling the sources to a single SPIR-V binary. slangc writes the depfile of the imported modules,
+# so editing an imported module rebuilds the binary.
+function(_add_slang_compile_command OUT_BINARY SHADERS_DIR SOURCES SLANGC_ARGS)
+    get_filename_component(OUT_BINARY_FILE_NAME ${OUT_BINARY} NAME)
+    set(DEPFILE "${CMAKE_CURRENT_BINARY_DIR}/slang_deps/${OUT_BINARY_FILE_NAME}.d")
+
+    add_custom_command (
+          OUTPUT  "${OUT_BINARY}"
+          COMMAND ${CMAKE_COMMAND} -E make_directory "${CMAKE_CURRENT_BINARY_DIR}/slang_deps"
+          COMMAND ${SLANGC_EXECUTABLE} ${SOURCES} -target spirv -profile spirv_1_4 -emit-spirv-directly -fvk-use-entrypoint-name ${SLANGC_ARGS} -depfile ${DEPFILE} -o ${OUT_BINARY}
+          WORKING_DIRECTORY ${SHADERS_DIR}
+          DEPENDS ${SHADERS_DIR} ${SOURCES}
+          DEPFILE "${DEPFILE}"
+          COMMENT "Compiling Slang Shader ${OUT_BINARY_FILE_NAME}"
+          VERBATIM
+    )
+endfunction()
+
 # Use relative paths for sources
+#
+# Options:
+#   PER_ENTRY_POINT  Emits a binary per entry point, named `<OUT_BINARY_NAME>.<entry point>.spv`, instead of a single
+#                    `<OUT_BINARY_NAME>.spv` with all of the entry points. Editing a shader then only rebuilds the
+#                    binaries of its entry points and the pipelines may load only the stages they use.
+#   DEFINES          Preprocessor definitions passed to slangc, e.g. `DEFINES USE_SHADOWS=1 MAX_LIGHTS=8`.
 function(add_slang_shader_target TARGET)
-    set(multiValueArgs SOURCES ENTRY_POINTS)
+    set(multiValueArgs SOURCES ENTRY_POINTS DEFINES)
     set(singleValueArgs SHADERS_DIR OUT_BINARY_NAME)
-    cmake_parse_arguments(ARGS "SHADER" "${singleValueArgs}" "${multiValueArgs}" ${ARGN})
+    cmake_parse_arguments(ARGS "SHADER;PER_ENTRY_POINT" "${singleValueArgs}" "${multiValueArgs}" ${ARGN})
 
     if (NOT ARGS_ENTRY_POINTS)
         message(FATAL_ERROR "No shader entry points provided for shader with name ${TARGET}")
@@ -20,7 +44,7 @@ function(add_slang_shader_target TARGET)
     foreach(SOURCE ${ARGS_SOURCES})
         list(APPEND SOURCES "${CMAKE_CURRENT_SOURCE_DIR}/${SOURCE}")
     endforeach()
-    
+
     set (SHADERS_DIR "")
     if (NOT ARGS_SHADERS_DIR)
         set (SHADERS_DIR ${CMAKE_CURRENT_LIST_DIR}/shaders)
@@ -33,12 +57,10 @@ function(add_slang_shader_target TARGET)
     else()
         set(OUT_BINARY_NAME "${ARGS_OUT_BINARY_NAME}")
     endif()
-    set(OUT_BINARY "${SHADERS_DIR}/${OUT_BINARY_NAME}.spv")
 
-    set(ENTRY_POINTS_SLANGC_ARGS "")
-    foreach(ENTRY_POINT ${ARGS_ENTRY_POINTS})
-        list(APPEND ENTRY_POINTS_SLANGC_ARGS "-entry")
-        list(APPEND ENTRY_POINTS_SLANGC_ARGS "${ENTRY_POINT}")
+    set(DEFINES_SLANGC_ARGS "")
+    foreach(DEFINE ${ARGS_DEFINES})
+        list(APPEND DEFINES_SLANGC_ARGS "-D${DEFINE}")
     endforeach()
 
     add_custom_command (
@@ -46,17 +68,27 @@ function(add_slang_shader_target TARGET)
           COMMAND ${CMAKE_COMMAND} -E make_directory ${SHADERS_DIR}
     )
 
-    add_custom_command (
-          OUTPUT  "${OUT_BINARY}"
-          COMMAND ${SLANGC_EXECUTABLE} ${SOURCES} -target spirv -profile spirv_1_4 -emit-spirv-directly -fvk-use-entrypoint-name ${ENTRY_POINTS_SLANGC_ARGS} -o ${OUT_BINARY_NAME}.spv
-          WORKING_DIRECTORY ${SHADERS_DIR}
-          DEPENDS ${SHADERS_DIR} ${SOURCES}
-          COMMENT "Compiling Slang Shaders"
-          VERBATIM
-    )
+    set(OUT_BINARIES "")
+    if (ARGS_PER_ENTRY_POINT)
+        foreach(ENTRY_POINT ${ARGS_ENTRY_POINTS})
+            set(OUT_BINARY "${SHADERS_DIR}/${OUT_BINARY_NAME}.${ENTRY_POINT}.spv")
+            _add_slang_compile_command("${OUT_BINARY}" "${SHADERS_DIR}" "${SOURCES}" "${DEFINES_SLANGC_ARGS};-entry;${ENTRY_POINT}")
+            list(APPEND OUT_BINARIES "${OUT_BINARY}")
+        endforeach()
+    else()
+        set(ENTRY_POINTS_SLANGC_ARGS "")
+        foreach(ENTRY_POINT ${ARGS_ENTRY_POINTS})
+            list(APPEND ENTRY_POINTS_SLANGC_ARGS "-entry")
+            list(APPEND ENTRY_POINTS_SLANGC_ARGS "${ENTRY_POINT}")
+        endforeach()
+
+        set(OUT_BINARY "${SHADERS_DIR}/${OUT_BINARY_NAME}.spv")
+        _add_slang_compile_command("${OUT_BINARY}" "${SHADERS_DIR}" "${SOURCES}" "${DEFINES_SLANGC_ARGS};${ENTRY_POINTS_SLANGC_ARGS}")
+        list(APPEND OUT_BINARIES "${OUT_BINARY}")
+    endif()
+
+    add_custom_target(${TARGET} DEPENDS ${OUT_BINARIES})
 
-    add_custom_target(${TARGET} DEPENDS "${OUT_BINARY}")
-    
-    message(STATUS "Shader target ${TARGET} and entry points ${ARGS_ENTRY_POINTS} added. Shader output: ${OUT_BINARY}")
+    message(STATUS "Shader target ${TARGET} and entry points ${ARGS_ENTRY_POINTS} added. Shader output: ${OUT_BINARIES}")
 
 endfunction()
@@ -33,8 +33,9 @@ function(configure_library)
 
         # Dependencies
         set(DEPS_PUBLIC ${ARGS_DEPS_PUBLIC})
-        if(${TRACY_ENABLE})
+        if(ENABLE_TRACY)
             list(APPEND DEPS_PUBLIC TracyClient)
+            list(APPEND ARGS_COMPILE_DEFINITIONS ERAY_ENABLE_PROFILING)
         endif()
         message(STATUS "Requested libraries: ${DEPS_PUBLIC}")
         target_link_libraries(${PROJECT_NAME} INTERFACE ${DEPS_PUBLIC})
@@ -78,8 +79,9 @@ function(configure_library)
 
         # Dependencies
         set(DEPS_PUBLIC ${ARGS_DEPS_PUBLIC})
-        if(${TRACY_ENABLE})
+        if(ENABLE_TRACY)
             list(APPEND DEPS_PUBLIC TracyClient)
+            list(APPEND ARGS_COMPILE_DEFINITIONS ERAY_ENABLE_PROFILING)
         endif()
         message(STATUS "Dependencies: ${DEPS_PUBLIC}")
         if (ARGS_INCLUDE_DIRS)
@@ -133,5 +135,35 @@ function(configure_library)
         endif()
     endif()
 
+    # Benchmarks configuration
+    if(BUILD_BENCHMARKS)
+        message(STATUS "Configuring ${PROJECT_NAME}_bench executable")
+        file(GLOB_RECURSE BENCH_SOURCES
+            "${CMAKE_CURRENT_SOURCE_DIR}/benches/*.cpp"
+        )
+        if(NOT BENCH_SOURCES)
+            message(STATUS "No benchmark sources found, benchmark executable configuration stopped")
+        else()
+            add_executable(
+                "${PROJECT_NAME}_bench"
+                ${BENCH_SOURCES}
+            )
+
+            # The harness of liberay-util provides the main, see liberay-util/bench_harness
+            if(TARGET liberay-bench-harness)
+                set(BENCH_MAIN liberay-bench-harness)
+            else()
+                message(STATUS "liberay-bench-harness not found, falling back to benchmark::benchmark_main")
+                set(BENCH_MAIN benchmark::benchmark_main)
+            endif()
+            target_link_libraries(
+                "${PROJECT_NAME}_bench"
+                ${BENCH_MAIN}
+                ${PROJECT_NAME}
+            )
+            target_compile_options("${PROJECT_NAME}_bench" PRIVATE ${PROJ_CXX_FLAGS})
+        endif()
+    endif()
+
     list(POP_BACK CMAKE_MESSAGE_INDENT)
 endfunction()
@@ -143,6 +143,9 @@ function(fetch_tracy)
   if(NOT TARGET TracyClient)
     loader_begin("Tracy")
 
+    # The data is collected only while the profiler is connected, so that the instrumented builds can be shipped
+    set(TRACY_ON_DEMAND ON CACHE BOOL "" FORCE)
+
     FetchContent_Declare(
       Tracy
       GIT_REPOSITORY "https://github.com/wolfpld/tracy"
@@ -175,6 +178,28 @@ function(fetch_googletest)
   endif()
 endfunction()
 
+# =============================================================================
+# Google Benchmark
+# =============================================================================
+function(fetch_google_benchmark)
+  if(NOT TARGET benchmark)
+    loader_begin("Google Benchmark")
+
+    set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+
+    FetchContent_Declare(
+      benchmark
+      GIT_REPOSITORY "https://github.com/google/benchmark.git"
+      GIT_TAG "v1.9.1"
+    )
+    FetchContent_MakeAvailable(benchmark)
+
+    loader_end()
+  endif()
+endfunction()
+
 # =============================================================================
 # assimp 
 # =============================================================================
@@ -235,3 +260,25 @@ function(fetch_assimp)
   endif()
 endfunction()
 
+
+# =============================================================================
+# meshoptimizer
+# =============================================================================
+function(fetch_meshoptimizer)
+  if(NOT TARGET meshoptimizer)
+    loader_begin("meshoptimizer")
+
+    set(MESHOPT_BUILD_DEMO OFF CACHE BOOL "" FORCE)
+    set(MESHOPT_BUILD_GLTFPACK OFF CACHE BOOL "" FORCE)
+    set(MESHOPT_BUILD_SHARED_LIBS OFF CACHE BOOL "" FORCE)
+
+    FetchContent_Declare(
+      meshoptimizer
+      GIT_REPOSITORY "https://github.com/zeux/meshoptimizer.git"
+      GIT_TAG "v0.22"
+      UPDATE_DISCONNECTED 1)
+    FetchContent_MakeAvailable(meshoptimizer)
+
+    loader_end()
+  endif()
+endfunction()
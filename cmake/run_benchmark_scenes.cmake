@@ -0,0 +1,48 @@
+# Runs the example scenes in the headless benchmark mode and writes a report per scene, see `vkren::FrameBenchmark`.
+# Compare the reports of two runs with `bench_compare`.
+#
+# Usage:
+#   cmake -DEXAMPLES_BIN_DIR=<build>/examples_bin -DOUT_DIR=<dir> [-DFRAMES=600] -P run_benchmark_scenes.cmake
+
+if(NOT EXAMPLES_BIN_DIR OR NOT OUT_DIR)
+    message(FATAL_ERROR "EXAMPLES_BIN_DIR and OUT_DIR must be set")
+endif()
+if(NOT FRAMES)
+    set(FRAMES 600)
+endif()
+
+file(MAKE_DIRECTORY "${OUT_DIR}")
+
+# run_scene(<report name> <example> [<env var>=<value>...])
+function(run_scene NAME EXAMPLE)
+    set(EXECUTABLE "${EXAMPLES_BIN_DIR}/${EXAMPLE}/${EXAMPLE}${CMAKE_EXECUTABLE_SUFFIX}")
+    if(NOT EXISTS "${EXECUTABLE}")
+        message(FATAL_ERROR "Example ${EXECUTABLE} does not exist, configure with BUILD_EXAMPLES=ON")
+    endif()
+
+    message(STATUS "Benchmarking ${NAME}")
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E env
+            ERAY_HEADLESS=1
+            ERAY_BENCHMARK_FRAMES=${FRAMES}
+            "ERAY_BENCHMARK_REPORT=${OUT_DIR}/${NAME}.json"
+            ${ARGN}
+            "${EXECUTABLE}"
+        WORKING_DIRECTORY "${EXAMPLES_BIN_DIR}/${EXAMPLE}"
+        RESULT_VARIABLE RESULT
+        OUTPUT_QUIET
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Benchmark ${NAME} failed: ${RESULT}")
+    endif()
+endfunction()
+
+run_scene(vkren_triangle vkren_triangle)
+foreach(VIEWPORTS 1 4 16)
+    run_scene(multiviewport_${VIEWPORTS} multiviewport ERAY_VIEWPORT_COUNT=${VIEWPORTS})
+endforeach()
+foreach(PARTICLES 8192 262144 4194304)
+    run_scene(compute_shader_${PARTICLES} compute_shader ERAY_PARTICLE_COUNT=${PARTICLES})
+endforeach()
+
+message(STATUS "Benchmark reports written to ${OUT_DIR}")
@@ -1,18 +1,41 @@
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_vulkan.h>
 
+#include <charconv>
 #include <compute_shader/particle.hpp>
+#include <cstdlib>
 #include <liberay/os/system.hpp>
+#include <liberay/os/window/headless/headless_window_creator.hpp>
+#include <liberay/util/logger.hpp>
 #include <liberay/vkren/app.hpp>
 #include <liberay/vkren/buffer/ubo.hpp>
 #include <liberay/vkren/glfw/vk_glfw_window_creator.hpp>
 #include <liberay/vkren/pipeline.hpp>
 #include <liberay/vkren/render_graph.hpp>
 #include <liberay/vkren/shader.hpp>
+#include <string_view>
 
 namespace vkren = eray::vkren;
 namespace util  = eray::util;
 
+namespace {
+
+// ERAY_PARTICLE_COUNT scales the scene for the benchmarks, the count is rounded up to whole workgroups
+size_t requested_particle_count() {
+  auto count = ParticleSystem::kDefaultParticleCount;
+  if (const auto* value = std::getenv("ERAY_PARTICLE_COUNT")) {  // NOLINT(concurrency-mt-unsafe)
+    const auto str = std::string_view(value);
+    if (auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), count); ec != std::errc{} || count == 0) {
+      util::Logger::warn(R"(Ignoring ERAY_PARTICLE_COUNT="{}", expected a positive number)", str);
+      count = ParticleSystem::kDefaultParticleCount;
+    }
+  }
+  return (count + ParticleSystem::kWorkgroupSize - 1) / ParticleSystem::kWorkgroupSize *
+         ParticleSystem::kWorkgroupSize;
+}
+
+}  // namespace
+
 class ComputeShaderApplication : public vkren::VulkanApplication {
  private:
   vkren::ShaderStorageHandle ssbo_handle_;
@@ -24,8 +47,10 @@ class ComputeShaderApplication : public vkren::VulkanApplication {
   vk::raii::Pipeline graphics_pipeline_              = nullptr;
   vk::raii::Pipeline compute_pipeline_               = nullptr;
 
+  size_t particle_count_ = 0;
+
   vk::DescriptorSetLayout compute_ds_layout_;
-  vk::DescriptorSet compute_ds_;
+  vkren::DescriptorSetBinder compute_bindings_;
 
   struct Viewport {
     VkDescriptorSet imgui_txt_ds_;
@@ -46,8 +71,9 @@ class ComputeShaderApplication : public vkren::VulkanApplication {
     window().set_window_size(kWinWidth, kWinHeight);
 
     // Buffers setup
-    auto particle_system =
-        ParticleSystem::create_on_circle(static_cast<float>(kViewportWidth) / static_cast<float>(kViewportHeight));
+    particle_count_      = requested_particle_count();
+    auto particle_system = ParticleSystem::create_on_circle(
+        particle_count_, static_cast<float>(kViewportWidth) / static_cast<float>(kViewportHeight));
     auto region =
         util::MemoryRegion{particle_system.particles.data(), particle_system.particles.size() * sizeof(Particle)};
     ssbo_handle_ =
@@ -56,21 +82,18 @@ class ComputeShaderApplication : public vkren::VulkanApplication {
     ubo_gpu_            = vkren::MappedUniformBuffer<UniformBufferObject>::create(device()).or_panic();
     ubo_cpu_.delta_time = 0.F;
 
-    // Descriptor set
+    // Push descriptors, the dispatch is tiny, so there is no descriptor set to allocate and update
     {
-      auto result = vkren::DescriptorSetBuilder::create(device())
-                        .with_binding(vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eCompute)
-                        .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
-                        .build()
-                        .or_panic();
-      compute_ds_layout_ = result.layout;
-      compute_ds_        = result.descriptor_set;
-
-      auto binder = vkren::DescriptorSetBinder::create(device());
-      binder.bind_buffer(0, ubo_gpu_.desc_buffer_info(), vk::DescriptorType::eUniformBuffer);
-      binder.bind_buffer(1, render_graph().shader_storage_buffer(ssbo_handle_).buffer.desc_buffer_info(),
-                         vk::DescriptorType::eStorageBuffer);
-      binder.apply(compute_ds_);
+      compute_ds_layout_ = vkren::DescriptorSetBuilder::create(device())
+                               .with_binding(vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eCompute)
+                               .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                               .build_push_descriptor_layout()
+                               .or_panic();
+
+      compute_bindings_ = vkren::DescriptorSetBinder::create(device());
+      compute_bindings_.bind_buffer(0, ubo_gpu_.desc_buffer_info(), vk::DescriptorType::eUniformBuffer);
+      compute_bindings_.bind_buffer(1, render_graph().shader_storage_buffer(ssbo_handle_).buffer.desc_buffer_info(),
+                                    vk::DescriptorType::eStorageBuffer);
     }
 
     // Pipelines setup
@@ -140,9 +163,8 @@ class ComputeShaderApplication : public vkren::VulkanApplication {
           .with_shader_storage(ssbo_handle_)
           .on_emit([this](vkren::Device&, vk::CommandBuffer& cmd_buff) {
             cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, compute_pipeline_);
-            cmd_buff.bindDescriptorSets(vk::PipelineBindPoint::eCompute, compute_pipeline_layout_, 0, {compute_ds_},
-                                        {});
-            cmd_buff.dispatch(ParticleSystem::kParticleCount / 256, 1, 1);
+            compute_bindings_.push(cmd_buff, vk::PipelineBindPoint::eCompute, compute_pipeline_layout_);
+            cmd_buff.dispatch(static_cast<uint32_t>(particle_count_ / ParticleSystem::kWorkgroupSize), 1, 1);
           })
           .build()
           .or_panic();
@@ -160,7 +182,7 @@ class ComputeShaderApplication : public vkren::VulkanApplication {
               .on_emit([this](vkren::Device&, vk::CommandBuffer& cmd) {
                 cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, graphics_pipeline_);
                 cmd.bindVertexBuffers(0, {render_graph().shader_storage_buffer(ssbo_handle_).buffer.vk_buffer()}, {0});
-                cmd.draw(ParticleSystem::kParticleCount, 1, 0, 0);
+                cmd.draw(static_cast<uint32_t>(particle_count_), 1, 0, 0);
               })
 
               // Wait for particles until they are ready
@@ -208,13 +230,16 @@ int main() {
 
   Logger::instance().init();
   Logger::instance().add_scribe(std::make_unique<eray::util::TerminalLoggerScribe>());
+  // ERAY_HEADLESS=1 renders offscreen, e.g. to benchmark with ERAY_BENCHMARK_FRAMES on a machine without a display
   auto window_creator =
-      eray::os::VulkanGLFWWindowCreator::create().or_panic("Could not create a Vulkan GLFW window creator");
+      std::getenv("ERAY_HEADLESS")  // NOLINT(concurrency-mt-unsafe)
+          ? eray::os::HeadlessWindowCreator::create().or_panic("Could not create a headless window creator")
+          : eray::os::VulkanGLFWWindowCreator::create().or_panic("Could not create a Vulkan GLFW window creator");
   System::init(std::move(window_creator)).or_panic("Could not initialize Operating System API");
 
   // == Application ====================================================================================================
   auto app = eray::vkren::VulkanApplication::create<ComputeShaderApplication>(eray::vkren::VulkanApplicationCreateInfo{
-      .vsync = false,
+      .present_mode = eray::vkren::PresentMode::Immediate,
   });
   app.run();
 
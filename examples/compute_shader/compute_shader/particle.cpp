@@ -4,14 +4,14 @@
 #include <numbers>
 #include <random>
 
-ParticleSystem ParticleSystem::create_on_circle(float aspect_ratio) {
+ParticleSystem ParticleSystem::create_on_circle(size_t particle_count, float aspect_ratio) {
   using Vec2 = eray::math::Vec2f;
   using Vec4 = eray::math::Vec4f;
 
   auto rnd_engine = std::default_random_engine(static_cast<unsigned>(std::time(nullptr)));
   auto rnd_dist   = std::uniform_real_distribution<float>(0.F, 1.F);
 
-  auto result = std::vector<Particle>(kParticleCount);
+  auto result = std::vector<Particle>(particle_count);
   for (auto& particle : result) {
     const auto radius = rnd_dist(rnd_engine) * 0.25F;
     const auto theta  = rnd_dist(rnd_engine) * 2.F * std::numbers::pi_v<float>;
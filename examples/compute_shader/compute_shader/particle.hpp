@@ -20,9 +20,15 @@ struct Particle {
 };
 
 struct ParticleSystem {
-  static constexpr size_t kParticleCount = 8192;
+  static constexpr size_t kDefaultParticleCount = 8192;
 
-  static ParticleSystem create_on_circle(float aspect_ratio = 1.F);
+  /**
+   * @brief Particles are updated by the workgroups of this size, the particle count is its multiple.
+   *
+   */
+  static constexpr size_t kWorkgroupSize = 256;
+
+  static ParticleSystem create_on_circle(size_t particle_count, float aspect_ratio = 1.F);
 
   static vk::VertexInputBindingDescription binding_desc() {
     return vk::VertexInputBindingDescription{
@@ -1,16 +1,46 @@
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_vulkan.h>
 
+#include <charconv>
+#include <cstdlib>
 #include <liberay/os/system.hpp>
+#include <liberay/os/window/headless/headless_window_creator.hpp>
+#include <liberay/util/logger.hpp>
 #include <liberay/vkren/app.hpp>
 #include <liberay/vkren/buffer/ubo.hpp>
+#include <liberay/vkren/dynamic_resolution.hpp>
 #include <liberay/vkren/glfw/vk_glfw_window_creator.hpp>
 #include <liberay/vkren/pipeline.hpp>
 #include <liberay/vkren/render_graph.hpp>
 #include <liberay/vkren/shader.hpp>
+#include <optional>
+#include <string_view>
+#include <vector>
 
 namespace vkren = eray::vkren;
 
+namespace {
+
+bool dynamic_resolution_requested() {
+  return std::getenv("ERAY_DYNAMIC_RESOLUTION") != nullptr;  // NOLINT(concurrency-mt-unsafe)
+}
+
+// ERAY_VIEWPORT_COUNT scales the scene for the benchmarks
+uint32_t requested_viewport_count() {
+  constexpr auto kDefaultViewportCount = 4U;
+  auto count                           = kDefaultViewportCount;
+  if (const auto* value = std::getenv("ERAY_VIEWPORT_COUNT")) {  // NOLINT(concurrency-mt-unsafe)
+    const auto str = std::string_view(value);
+    if (auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), count); ec != std::errc{} || count == 0) {
+      eray::util::Logger::warn(R"(Ignoring ERAY_VIEWPORT_COUNT="{}", expected a positive number)", str);
+      count = kDefaultViewportCount;
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
 struct Vertex {
   using Vec2 = eray::math::Vec2f;
   using Vec3 = eray::math::Vec3f;
@@ -130,43 +160,61 @@ class MultipleViewportsApplication : public vkren::VulkanApplication {
   vkren::BufferResource ind_buffer_;
 
   vkren::ImageResource txt_image_;
-  vk::raii::ImageView txt_view_  = nullptr;
-  vk::raii::Sampler txt_sampler_ = nullptr;
+  vk::ImageView txt_view_  = nullptr;
+  vk::Sampler txt_sampler_ = nullptr;
 
-  static constexpr auto kViewportsCount = 4U;
-  static constexpr auto kViewportSize   = 500U;
+  static constexpr auto kViewportSize = 500U;
 
   struct ViewportInfo {
-    void* uniform_buffer_mapped_;
-    vkren::BufferResource uniform_buffer_;
+    vkren::FrameVersionedUniformBuffer<UniformBufferObject> uniform_buffer_;
     VkDescriptorSet imgui_txt_ds_;
     vkren::RenderPassAttachmentHandle color_attachment;
+    uint32_t color_attachment_generation;
+    vkren::RenderGraphExtentHandle extent;
     vkren::RenderPassHandle render_pass;
-    vk::DescriptorSet render_pass_ds_;
+    std::vector<vk::DescriptorSet> render_pass_ds_;
     UniformBufferObject ubo;
     std::string name;
-  } viewports_[kViewportsCount];
+  };
+  std::vector<ViewportInfo> viewports_;
 
   vk::DescriptorSetLayout main_dsl_;
   vk::raii::PipelineLayout main_pipeline_layout_ = nullptr;
   vk::raii::Pipeline main_pipeline_              = nullptr;
 
+  /**
+   * @brief Scales the render area of the viewports down when the GPU time exceeds the budget, requires the render
+   * graph profiling.
+   *
+   */
+  std::optional<vkren::DynamicResolutionController> dynamic_resolution_;
+
  public:
   void on_init() override {
     ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-    window().set_window_size(kViewportSize * kViewportsCount / 2U, kViewportSize * kViewportsCount / 2U);
+    window().set_window_size(kViewportSize * 2U, kViewportSize * 2U);
 
-    for (auto i = 0U; i < kViewportsCount; ++i) {
+    // The render passes capture the viewports, so the vector is never resized afterwards
+    viewports_ = std::vector<ViewportInfo>(requested_viewport_count());
+    for (auto i = 0U; i < viewports_.size(); ++i) {
       viewports_[i].name = std::format("Viewport {}", i);
     }
 
     // == Render graph setup ===========================================================================================
     for (auto& viewport : viewports_) {
-      auto msaa_color_attachment = render_graph().create_color_attachment(device(), kViewportSize, kViewportSize, false,
-                                                                          vk::SampleCountFlagBits::e8);
-      auto color_attachment      = render_graph().create_color_attachment(device(), kViewportSize, kViewportSize, true);
-      auto depth_attachment      = render_graph().create_depth_attachment(device(), kViewportSize, kViewportSize, true,
-                                                                          vk::SampleCountFlagBits::e8);
+      // The attachments follow the size of the viewport window, they are reallocated when the window is resized
+      viewport.extent = render_graph().create_extent(kViewportSize, kViewportSize);
+
+      // Nothing reads the MSAA color and the depth after the pass, the graph infers that they are never stored, so they
+      // are lazily allocated or all of the viewports share their memory
+      auto msaa_color_attachment = render_graph().create_transient_color_attachment(
+          device(), kViewportSize, kViewportSize, vk::SampleCountFlagBits::e8);
+      auto color_attachment = render_graph().create_color_attachment(device(), kViewportSize, kViewportSize, true);
+      auto depth_attachment = render_graph().create_transient_depth_attachment(device(), kViewportSize, kViewportSize,
+                                                                               vk::SampleCountFlagBits::e8);
+      for (auto handle : {msaa_color_attachment, color_attachment, depth_attachment}) {
+        render_graph().bind_attachment_extent(handle, vkren::RelativeExtent{.handle = viewport.extent});
+      }
 
       viewport.render_pass = render_graph()
                                  .render_pass_builder(vk::SampleCountFlagBits::e8)
@@ -175,7 +223,7 @@ class MultipleViewportsApplication : public vkren::VulkanApplication {
                                  .on_emit([this, &viewport](vkren::Device&, vk::CommandBuffer& cmd_buff) {
                                    this->record_render_pass(cmd_buff, viewport);
                                  })
-                                 .build(kViewportSize, kViewportSize)
+                                 .build(vkren::RelativeExtent{.handle = viewport.extent})
                                  .or_panic("Could not create render pass");
 
       render_graph().emplace_final_pass_dependency(color_attachment);
@@ -183,6 +231,14 @@ class MultipleViewportsApplication : public vkren::VulkanApplication {
       viewport.color_attachment = color_attachment;
     }
 
+    if (dynamic_resolution_requested() && render_graph().is_profiling_enabled()) {
+      auto info = vkren::DynamicResolutionInfo{};
+      for (const auto& viewport : viewports_) {
+        info.extents.push_back(viewport.extent);
+      }
+      dynamic_resolution_ = vkren::DynamicResolutionController::create(info);
+    }
+
     // == Buffers setup ================================================================================================
     {
       auto vb = VertexBuffer::create();
@@ -198,13 +254,11 @@ class MultipleViewportsApplication : public vkren::VulkanApplication {
       ind_buffer_.write(indices_region).or_panic("Could not fill the index buffer");
 
       for (auto& viewport : viewports_) {
-        vk::DeviceSize size_bytes = sizeof(UniformBufferObject);
-        auto ubo = vkren::BufferResource::create_persistently_mapped_uniform_buffer(device(), size_bytes)
-                       .or_panic("Could not create the uniform buffer");
-        viewport.uniform_buffer_ = std::move(ubo.buffer);
-
-        // Copying to uniform buffer each frame means that staging buffer makes no sense.
-        viewport.uniform_buffer_mapped_ = ubo.mapped_data;
+        // Copying to uniform buffer each frame means that staging buffer makes no sense. A buffer per frame in flight
+        // is updated while the other frames are rendered.
+        viewport.uniform_buffer_ =
+            vkren::FrameVersionedUniformBuffer<UniformBufferObject>::create(device(), frames_in_flight())
+                .or_panic("Could not create the uniform buffer");
       }
     }
 
@@ -215,7 +269,7 @@ class MultipleViewportsApplication : public vkren::VulkanApplication {
       txt_image_ = vkren::ImageResource::create_texture(device(), vkren::ImageDescription::from(img))
                        .or_panic("Could not create a texture image");
       txt_image_.upload(img.memory_region()).or_panic("Could not upload the image");
-      txt_view_ = txt_image_.create_image_view().or_panic("Could not create the image view");
+      txt_view_ = txt_image_.cached_view().or_panic("Could not create the image view");
 
       auto pdev_props   = device().physical_device().getProperties();
       auto sampler_info = vk::SamplerCreateInfo{
@@ -233,30 +287,29 @@ class MultipleViewportsApplication : public vkren::VulkanApplication {
           .minLod           = 0.F,
           .maxLod           = vk::LodClampNone,
       };
-      txt_sampler_ = vkren::Result(device().vk().createSampler(sampler_info)).or_panic("Could not create the sampler");
+      txt_sampler_ = device().sampler(sampler_info).or_panic("Could not create the sampler");
     }
 
     // == Descriptors setup ============================================================================================
     for (auto& viewport : viewports_) {
-      auto result = vkren::DescriptorSetBuilder::create(device())
-                        .with_binding(vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eVertex)
-                        .with_binding(vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
-                        .build()
-                        .or_panic("Could not create descriptor sets");
-
-      viewport.render_pass_ds_ = std::move(result.descriptor_set);
-      main_dsl_                = std::move(result.layout);
-
-      auto binder = vkren::DescriptorSetBinder::create(device());
-      binder.bind_buffer(0, viewport.uniform_buffer_.desc_buffer_info(), vk::DescriptorType::eUniformBuffer);
-      binder.bind_combined_image_sampler(1, txt_view_, txt_sampler_, vk::ImageLayout::eShaderReadOnlyOptimal);
-      binder.apply(viewport.render_pass_ds_);
-      binder.clear();
-
-      viewport.imgui_txt_ds_ = ImGui_ImplVulkan_AddTexture(
-          static_cast<VkSampler>(vk::Sampler{txt_sampler_}),
-          static_cast<VkImageView>(vk::ImageView{render_graph().attachment(viewport.color_attachment).view}),
-          static_cast<VkImageLayout>(vk::ImageLayout::eShaderReadOnlyOptimal));
+      for (auto frame = 0U; frame < frames_in_flight(); ++frame) {
+        auto result = vkren::DescriptorSetBuilder::create(device())
+                          .with_binding(vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eVertex)
+                          .with_binding(vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
+                          .build()
+                          .or_panic("Could not create descriptor sets");
+
+        viewport.render_pass_ds_.push_back(result.descriptor_set);
+        main_dsl_ = std::move(result.layout);
+
+        auto binder = vkren::DescriptorSetBinder::create(device());
+        binder.bind_buffer(0, viewport.uniform_buffer_.desc_buffer_info(frame), vk::DescriptorType::eUniformBuffer);
+        binder.bind_combined_image_sampler(1, txt_view_, txt_sampler_, vk::ImageLayout::eShaderReadOnlyOptimal);
+        binder.apply(viewport.render_pass_ds_.back());
+        binder.clear();
+      }
+
+      add_imgui_texture(viewport);
     }
 
     // == Shaders + Graphics Pipeline ==================================================================================
@@ -284,11 +337,23 @@ class MultipleViewportsApplication : public vkren::VulkanApplication {
     }
   }
 
+  void add_imgui_texture(ViewportInfo& viewport) {
+    const auto& color_attachment         = render_graph().attachment(viewport.color_attachment);
+    viewport.color_attachment_generation = color_attachment.generation;
+    viewport.imgui_txt_ds_ =
+        ImGui_ImplVulkan_AddTexture(static_cast<VkSampler>(vk::Sampler{txt_sampler_}),
+                                    static_cast<VkImageView>(vk::ImageView{color_attachment.view}),
+                                    static_cast<VkImageLayout>(vk::ImageLayout::eShaderReadOnlyOptimal));
+  }
+
   void on_process(float /*delta*/) override {
-    mark_frame_data_dirty();
-    auto window_size = window().window_size();
+    if (dynamic_resolution_) {
+      dynamic_resolution_->update(render_graph());
+    }
+
+    for (auto i = 0U; i < viewports_.size(); ++i) {
+      auto extent = render_graph().extent(viewports_[i].extent);
 
-    for (auto i = 0U; i < kViewportsCount; ++i) {
       auto t = std::chrono::duration<float>(time()).count();
       auto s = std::sin(t * 0.7F);
       s      = (s * s - 0.5F) * 90.F;
@@ -299,23 +364,40 @@ class MultipleViewportsApplication : public vkren::VulkanApplication {
       viewports_[i].ubo.model = eray::math::rotation_axis(eray::math::radians(s), axis);
       viewports_[i].ubo.view  = eray::math::translation(eray::math::Vec3f(0.F, 0.F, -4.F));
       viewports_[i].ubo.proj  = eray::math::perspective_vk_rh(
-          eray::math::radians(80.0F), static_cast<float>(window_size.width) / static_cast<float>(window_size.height),
-          0.01F, 10.F);
+          eray::math::radians(80.0F), static_cast<float>(extent.width) / static_cast<float>(extent.height), 0.01F,
+          10.F);
+      viewports_[i].uniform_buffer_.mark_dirty();
     }
   }
 
-  void on_frame_prepare_sync(Duration /*delta*/) override {
+  void on_frame_prepare(uint32_t current_frame, Duration /*delta*/) override {
     for (auto& viewport : viewports_) {
-      memcpy(viewport.uniform_buffer_mapped_, &viewport.ubo, sizeof(viewport.ubo));
+      viewport.uniform_buffer_.sync(current_frame, viewport.ubo);
     }
   }
 
   void on_imgui() override {
     ImGui::DockSpaceOverViewport();
-    for (auto i = 0U; i < kViewportsCount; ++i) {
+    for (auto i = 0U; i < viewports_.size(); ++i) {
       ImGui::PushID(static_cast<int>(i));
       ImGui::Begin(viewports_[i].name.c_str());
-      ImGui::Image(viewports_[i].imgui_txt_ds_, ImVec2(kViewportSize, kViewportSize));
+      auto& viewport = viewports_[i];
+      auto size      = ImGui::GetContentRegionAvail();
+      auto width     = static_cast<uint32_t>(std::max(size.x, 1.F));
+      auto height    = static_cast<uint32_t>(std::max(size.y, 1.F));
+      if (render_graph().extent(viewport.extent) != vk::Extent2D{.width = width, .height = height}) {
+        // The attachments are reallocated lazily, compile the graph now so that the texture is valid in this frame
+        render_graph().resize_extent(viewport.extent, width, height);
+        render_graph().compile().or_panic("Could not compile the render graph");
+      }
+      if (render_graph().attachment(viewport.color_attachment).generation != viewport.color_attachment_generation) {
+        ImGui_ImplVulkan_RemoveTexture(viewport.imgui_txt_ds_);
+        add_imgui_texture(viewport);
+      }
+      // Only the scaled render area holds the image, the sampler upscales it to the window
+      const auto uv_scale = render_graph().render_uv_scale(vkren::RelativeExtent{.handle = viewport.extent});
+      ImGui::Image(viewport.imgui_txt_ds_, ImVec2(static_cast<float>(width), static_cast<float>(height)),
+                   ImVec2(0.F, 0.F), ImVec2(uv_scale[0], uv_scale[1]));
       ImGui::End();
       ImGui::PopID();
     }
@@ -325,8 +407,8 @@ class MultipleViewportsApplication : public vkren::VulkanApplication {
     cmd_buff.bindPipeline(vk::PipelineBindPoint::eGraphics, main_pipeline_);
     cmd_buff.bindVertexBuffers(0, vert_buffer_.vk_buffer(), {0});
     cmd_buff.bindIndexBuffer(ind_buffer_.vk_buffer(), 0, vk::IndexType::eUint16);
-    cmd_buff.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, main_pipeline_layout_, 0, viewport.render_pass_ds_,
-                                nullptr);
+    cmd_buff.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, main_pipeline_layout_, 0,
+                                viewport.render_pass_ds_[current_frame_in_flight()], nullptr);
     cmd_buff.drawIndexed(12, 1, 0, 0, 0);
   }
 
@@ -344,12 +426,18 @@ int main() {
 
   Logger::instance().init();
   Logger::instance().add_scribe(std::make_unique<eray::util::TerminalLoggerScribe>());
+  // ERAY_HEADLESS=1 renders offscreen, e.g. to benchmark with ERAY_BENCHMARK_FRAMES on a machine without a display
   auto window_creator =
-      eray::os::VulkanGLFWWindowCreator::create().or_panic("Could not create a Vulkan GLFW window creator");
+      std::getenv("ERAY_HEADLESS")  // NOLINT(concurrency-mt-unsafe)
+          ? eray::os::HeadlessWindowCreator::create().or_panic("Could not create a headless window creator")
+          : eray::os::VulkanGLFWWindowCreator::create().or_panic("Could not create a Vulkan GLFW window creator");
   System::init(std::move(window_creator)).or_panic("Could not initialize Operating System API");
 
   // == Application ====================================================================================================
-  auto app = eray::vkren::VulkanApplication::create<MultipleViewportsApplication>();
+  // ERAY_DYNAMIC_RESOLUTION=1 profiles the render graph and scales the viewports to keep the GPU time within budget
+  auto app = eray::vkren::VulkanApplication::create<MultipleViewportsApplication>({
+      .enable_render_graph_profiling = dynamic_resolution_requested(),
+  });
   app.run();
 
   // == Cleanup ========================================================================================================
@@ -1,8 +1,10 @@
 #include <imgui/imgui.h>
 
+#include <cstdlib>
 #include <liberay/math/mat.hpp>
 #include <liberay/os/rendering_api.hpp>
 #include <liberay/os/system.hpp>
+#include <liberay/os/window/headless/headless_window_creator.hpp>
 #include <liberay/os/window/input_codes.hpp>
 #include <liberay/util/logger.hpp>
 #include <liberay/util/memory_region.hpp>
@@ -132,17 +134,20 @@ int main() {
   Logger::instance().init();
   Logger::instance().add_scribe(std::make_unique<eray::util::TerminalLoggerScribe>());
 
+  // ERAY_HEADLESS=1 renders offscreen, e.g. to benchmark with ERAY_BENCHMARK_FRAMES on a machine without a display
   auto window_creator =
-      eray::os::VulkanGLFWWindowCreator::create().or_panic("Could not create a Vulkan GLFW window creator");
+      std::getenv("ERAY_HEADLESS")  // NOLINT(concurrency-mt-unsafe)
+          ? eray::os::HeadlessWindowCreator::create().or_panic("Could not create a headless window creator")
+          : eray::os::VulkanGLFWWindowCreator::create().or_panic("Could not create a Vulkan GLFW window creator");
   System::init(std::move(window_creator)).or_panic("Could not initialize Operating System API");
 
   // == Application ====================================================================================================
   {
     auto app =
         eray::vkren::VulkanApplication::create<VkRenTriangleApplication>(eray::vkren::VulkanApplicationCreateInfo{
-            .app_name    = "VkRenTriangle",
-            .enable_msaa = true,
-            .vsync       = false,
+            .app_name     = "VkRenTriangle",
+            .enable_msaa  = true,
+            .present_mode = eray::vkren::PresentMode::Immediate,
         });
     app.run();
   }  // Destroy app
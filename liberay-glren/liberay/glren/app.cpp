@@ -4,22 +4,30 @@
 #include <imgui/imgui_impl_opengl3.h>
 
 #include <liberay/glren/app.hpp>
+#include <liberay/glren/shader_program.hpp>
+#include <liberay/glren/state_cache.hpp>
 #include <liberay/glren/vertex_array.hpp>
 #include <liberay/os/system.hpp>
 #include <liberay/os/window/events/event.hpp>
 #include <liberay/os/window_api.hpp>
+#include <liberay/res/asset_cache.hpp>
 #include <liberay/util/logger.hpp>
 #include <liberay/util/panic.hpp>
 
 namespace eray::glren {
 
-Application::Application() {
+Application::Application(uint32_t frames_in_flight) : frames_in_flight_(frames_in_flight) {
   window_ = eray::os::System::instance().create_window().or_panic("Could not create a window");
+  if (auto cache = res::AssetCache::open(os::System::executable_dir() / "asset_cache")) {
+    driver::gl::ShaderProgram::set_binary_cache(std::move(*cache));
+  }
   window_->set_event_callback<os::WindowClosedEvent>(class_method_as_event_callback(this, &Application::on_closed));
 }
 
 void Application::run() {
-  swap_chain_ = GLFWSwapChain::create(*window_);
+  swap_chain_   = GLFWSwapChain::create(*window_);
+  gpu_profiler_ = driver::gl::GpuProfiler::create();
+  frame_sync_   = driver::gl::FrameSync::create(frames_in_flight_);
 
   // == ImGui Integration ==============================================================================================
   const char* glsl_version = "#version 130";
@@ -66,10 +74,20 @@ void Application::run() {
       ImGui_ImplOpenGL3_NewFrame();
       ImGui_ImplGlfw_NewFrame();
       ImGui::NewFrame();
+      frame_sync_.begin_frame();
+      gpu_profiler_.begin_frame();
       render_gui(delta);
-      render(delta);
+      {
+        auto scope = gpu_profiler_.scope("Scene");
+        render(delta);
+      }
       ImGui::Render();
-      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      {
+        auto scope = gpu_profiler_.scope("ImGui");
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      }
+      driver::gl::StateCache::current().invalidate();
+      frame_sync_.end_frame();
     }
 
     window_->poll_events();
@@ -97,6 +115,9 @@ void Application::run() {
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
+  gpu_profiler_ = driver::gl::GpuProfiler(nullptr);
+  frame_sync_   = driver::gl::FrameSync(nullptr);
+  driver::gl::VertexFormatCache::current().clear();
 }
 
 void Application::render_gui(Duration /* delta */) {}
@@ -109,6 +130,39 @@ void Application::render(Duration /* delta */) {
 
 void Application::update(Duration /* delta */) {}
 
+void Application::show_gpu_profiler(bool* open) {
+  if (!ImGui::Begin("GPU Profiler", open)) {
+    ImGui::End();
+    return;
+  }
+
+  if (!gpu_profiler_.is_enabled()) {
+    ImGui::TextUnformatted("Profiling is disabled");
+    ImGui::End();
+    return;
+  }
+
+  const auto results = gpu_profiler_.profiling_results();
+  ImGui::Text("Dropped frames: %llu", static_cast<unsigned long long>(gpu_profiler_.dropped_frame_count()));  // NOLINT
+
+  if (ImGui::BeginTable("passes", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Pass");
+    ImGui::TableSetupColumn("GPU [ms]");
+    ImGui::TableHeadersRow();
+
+    for (const auto& result : results) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(gpu_profiler_.pass_name(result.pass_index).c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", result.gpu_time_ms);
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
 bool Application::on_closed(const os::WindowClosedEvent&) {
   running_ = false;
   return true;
@@ -1,5 +1,7 @@
 #pragma once
+#include <liberay/glren/frame_sync.hpp>
 #include <liberay/glren/glfw/gl_glfw_swap_chain.hpp>
+#include <liberay/glren/gpu_profiler.hpp>
 #include <liberay/glren/vertex_array.hpp>
 #include <liberay/os/window/events/event.hpp>
 #include <liberay/os/window/window.hpp>
@@ -12,7 +14,14 @@ using namespace std::chrono_literals;
 
 class Application {
  public:
-  Application();
+  static constexpr uint32_t kDefaultFramesInFlight = 2;
+
+  /**
+   * @brief Creates the window.
+   *
+   * @param frames_in_flight Number of the frames the CPU records ahead of the GPU, see `driver::gl::FrameSync`.
+   */
+  explicit Application(uint32_t frames_in_flight = kDefaultFramesInFlight);
 
   virtual ~Application() = default;
 
@@ -45,6 +54,13 @@ class Application {
    */
   virtual void update(Duration delta);
 
+  /**
+   * @brief Shows the GPU times of the passes measured with the `gpu_profiler_` scopes. The scene rendering and the GUI
+   * are measured by default, the framebuffer passes of the `render()` might be wrapped in their own scopes.
+   *
+   */
+  void show_gpu_profiler(bool* open = nullptr);
+
  private:
   bool on_closed(const os::WindowClosedEvent& closed_event);
 
@@ -57,7 +73,16 @@ class Application {
   bool running_   = true;
   bool minimized_ = false;
 
-  GLFWSwapChain swap_chain_ = GLFWSwapChain(nullptr);
+  GLFWSwapChain swap_chain_             = GLFWSwapChain(nullptr);
+  driver::gl::GpuProfiler gpu_profiler_ = driver::gl::GpuProfiler(nullptr);
+
+  /**
+   * @brief The frame has begun before `render()` is invoked, the per frame resources are indexed with its
+   * `frame_index()`.
+   *
+   */
+  driver::gl::FrameSync frame_sync_ = driver::gl::FrameSync(nullptr);
+  uint32_t frames_in_flight_;
 
   std::shared_ptr<os::Window> window_;
 };
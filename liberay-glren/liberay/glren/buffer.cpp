@@ -1,9 +1,13 @@
 #include <glad/gl.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <liberay/glren/buffer.hpp>
 #include <liberay/glren/gl_error.hpp>
+#include <liberay/util/panic.hpp>
 #include <liberay/util/zstring_view.hpp>
+#include <utility>
 
 namespace eray::driver::gl {
 
@@ -33,10 +37,106 @@ void ElementBuffer::buffer_data(std::span<uint32_t> indices, DataUsage usage) {
                                  reinterpret_cast<const void*>(indices.data()), kDataUsageGLMapper[usage]));
 }
 
-void ElementBuffer::sub_buffer_data(GLuint offset_count, std::span<uint32_t> indices) {
+void ElementBuffer::sub_buffer_data(GLuint offset_count, std::span<const uint32_t> indices) {
   ERAY_GL_CALL(glNamedBufferSubData(id_.get(), static_cast<GLintptr>(offset_count * sizeof(uint32_t)),
                                     static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)),
                                     reinterpret_cast<const void*>(indices.data())));
 }
 
+void ElementBuffer::allocate(size_t count) {
+  count_ = count;
+  ERAY_GL_CALL(glNamedBufferStorage(id_.get(), static_cast<GLsizeiptr>(count * sizeof(uint32_t)), nullptr,
+                                    GL_DYNAMIC_STORAGE_BIT));
+}
+
+namespace {
+
+constexpr auto kFenceWaitTimeoutNs = GLuint64{1'000'000};
+
+}  // namespace
+
+// -- StreamingBuffer -------------------------------------------------------------------------------------------------
+
+StreamingBuffer StreamingBuffer::create(size_t region_bytes_size, uint32_t region_count) {
+  region_bytes_size = (region_bytes_size + kRegionAlignment - 1) / kRegionAlignment * kRegionAlignment;
+  region_count      = std::max(region_count, 1U);
+
+  GLuint id = 0;
+  ERAY_GL_CALL(glCreateBuffers(1, &id));
+
+  const auto bytes_size = static_cast<GLsizeiptr>(region_bytes_size * region_count);
+  const auto flags      = static_cast<GLbitfield>(GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+  ERAY_GL_CALL(glNamedBufferStorage(id, bytes_size, nullptr, flags));
+  auto* mapped = static_cast<std::byte*>(ERAY_GL_CALL_RET(glMapNamedBufferRange(id, 0, bytes_size, flags)));
+  if (mapped == nullptr) {
+    util::panic("Could not map the streaming buffer");
+  }
+
+  return StreamingBuffer(id, mapped, region_bytes_size, region_count);
+}
+
+StreamingBuffer::StreamingBuffer(StreamingBuffer&& other) noexcept
+    : Buffer(std::move(other)),
+      mapped_(std::exchange(other.mapped_, nullptr)),
+      region_bytes_size_(other.region_bytes_size_),
+      current_region_(other.current_region_),
+      fences_(std::exchange(other.fences_, {})) {}
+
+StreamingBuffer& StreamingBuffer::operator=(StreamingBuffer&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  release();
+  Buffer::operator=(std::move(other));
+  mapped_            = std::exchange(other.mapped_, nullptr);
+  region_bytes_size_ = other.region_bytes_size_;
+  current_region_    = other.current_region_;
+  fences_            = std::exchange(other.fences_, {});
+
+  return *this;
+}
+
+StreamingBuffer::~StreamingBuffer() { release(); }
+
+void StreamingBuffer::release() {
+  for (auto& fence : fences_) {
+    if (fence != nullptr) {
+      ERAY_GL_CALL(glDeleteSync(fence));
+      fence = nullptr;
+    }
+  }
+  if (mapped_ != nullptr) {
+    ERAY_GL_CALL(glUnmapNamedBuffer(id_.get()));
+    mapped_ = nullptr;
+  }
+}
+
+std::span<std::byte> StreamingBuffer::next_region() {
+  current_region_ = (current_region_ + 1) % region_count();
+
+  if (auto& fence = fences_[current_region_]; fence != nullptr) {
+    // The region was fenced frames ago and is usually free, only a busy one flushes the commands and blocks
+    auto status = glClientWaitSync(fence, 0, 0);
+    while (status == GL_TIMEOUT_EXPIRED) {
+      status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceWaitTimeoutNs);
+    }
+    if (status == GL_WAIT_FAILED) {
+      util::panic("Waiting for the streaming buffer region failed");
+    }
+    ERAY_GL_CALL(glDeleteSync(fence));
+    fence = nullptr;
+  }
+
+  return {mapped_ + region_offset(), region_bytes_size_};
+}
+
+void StreamingBuffer::fence_region() {
+  auto& fence = fences_[current_region_];
+  if (fence != nullptr) {
+    ERAY_GL_CALL(glDeleteSync(fence));
+  }
+  fence = ERAY_GL_CALL_RET(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
 }  // namespace eray::driver::gl
@@ -5,10 +5,12 @@
 #include <liberay/glren/gl_error.hpp>
 #include <liberay/glren/gl_handle.hpp>
 #include <liberay/util/enum_mapper.hpp>
+#include <liberay/util/flat_hash_map.hpp>
 #include <liberay/util/ruleof.hpp>
 #include <liberay/util/zstring_view.hpp>
+#include <cstddef>
+#include <cstring>
 #include <span>
-#include <unordered_map>
 #include <vector>
 
 namespace eray::driver::gl {
@@ -38,6 +40,17 @@ constexpr auto kDataUsageGLMapper = util::EnumMapper<DataUsage, GLenum>({
     {DataUsage::DynamicCopy, GL_DYNAMIC_COPY},
 });
 
+enum class IndexedBufferTarget : uint8_t {
+  Uniform       = 0,
+  ShaderStorage = 1,
+  _Count        = 2  // NOLINT
+};
+
+constexpr auto kIndexedBufferTargetGLMapper = util::EnumMapper<IndexedBufferTarget, GLenum>({
+    {IndexedBufferTarget::Uniform, GL_UNIFORM_BUFFER},
+    {IndexedBufferTarget::ShaderStorage, GL_SHADER_STORAGE_BUFFER},
+});
+
 class VertexArray;
 
 class Buffer {
@@ -48,6 +61,23 @@ class Buffer {
   GLuint raw_gl_id() const { return id_.get(); }
   const BufferHandle& handle() const { return id_; }
 
+  /**
+   * @brief Binds the whole buffer to the binding point of the uniform or shader storage blocks.
+   *
+   */
+  void bind_base(IndexedBufferTarget target, GLuint binding) const {
+    ERAY_GL_CALL(glBindBufferBase(kIndexedBufferTargetGLMapper[target], binding, id_.get()));
+  }
+
+  /**
+   * @brief Binds a range of the buffer to the binding point of the uniform or shader storage blocks, e.g. a region of
+   * a `StreamingBuffer` with the per frame data.
+   *
+   */
+  void bind_range(IndexedBufferTarget target, GLuint binding, GLintptr bytes_offset, GLsizeiptr bytes_size) const {
+    ERAY_GL_CALL(glBindBufferRange(kIndexedBufferTargetGLMapper[target], binding, id_.get(), bytes_offset, bytes_size));
+  }
+
  protected:
   explicit Buffer(GLuint id);
 
@@ -132,7 +162,7 @@ class VertexBuffer : public Buffer {
     auto end() const { return attribs_.end(); }
 
    private:
-    std::unordered_map<util::zstring_view, size_t> indices_;
+    util::FlatHashMap<util::zstring_view, size_t> indices_;
     std::vector<Attribute> attribs_;
     size_t current_bytes_offset_;
   };
@@ -145,6 +175,11 @@ class VertexBuffer : public Buffer {
    */
   static VertexBuffer create(Layout&& layout);
 
+  /**
+   * @brief Calls glNamedBufferData, which re-specifies the storage. Geometry updated every frame should be written into
+   * a `StreamingBuffer` instead.
+   *
+   */
   template <CPrimitiveType PrimitiveType>
   void buffer_data(std::span<PrimitiveType> vertices, DataUsage usage) {
     ERAY_GL_CALL(glNamedBufferData(id_.get(), static_cast<GLsizeiptr>(vertices.size() * sizeof(PrimitiveType)),
@@ -176,6 +211,15 @@ class VertexBuffer : public Buffer {
         static_cast<GLsizeiptr>(attrib.count * attrib.bytes_type_size), reinterpret_cast<const void*>(attr_value)));
   }
 
+  /**
+   * @brief Allocates immutable storage for the vertices, filled later with `sub_buffer_data`.
+   *
+   */
+  void allocate(size_t vertex_count) {
+    ERAY_GL_CALL(glNamedBufferStorage(id_.get(), static_cast<GLsizeiptr>(vertex_count * layout_.bytes_size()), nullptr,
+                                      GL_DYNAMIC_STORAGE_BIT));
+  }
+
   const Layout& layout() const { return layout_; }
 
  private:
@@ -199,7 +243,13 @@ class ElementBuffer : public Buffer {
    * @param indices is measured in floats not bytes.
    * @param vertices
    */
-  void sub_buffer_data(GLuint offset_count, std::span<uint32_t> indices);
+  void sub_buffer_data(GLuint offset_count, std::span<const uint32_t> indices);
+
+  /**
+   * @brief Allocates immutable storage for the indices, filled later with `sub_buffer_data`.
+   *
+   */
+  void allocate(size_t count);
 
   size_t count() const { return count_; }
 
@@ -208,4 +258,86 @@ class ElementBuffer : public Buffer {
   size_t count_{};
 };
 
+/**
+ * @brief Buffer with immutable storage that stays persistently and coherently mapped. The storage is split into
+ * regions used in turns, e.g. one per frame in flight, so that the CPU writes in place into a region the GPU is no
+ * longer reading, without the driver copies and the implicit synchronization of `glNamedBufferSubData`.
+ *
+ * Every frame: `next_region()` waits for the fence of the region and returns its memory, the data written there is
+ * drawn from the `region_offset()` of the buffer (e.g. `glVertexArrayVertexBuffer` offset or a base vertex) and
+ * `fence_region()` is called after the last command that reads the region. With the frames synchronized by a
+ * `FrameSync`, `frame_region()` selects the region of the frame in flight instead and no fences are needed.
+ *
+ */
+class StreamingBuffer : public Buffer {
+ public:
+  static constexpr uint32_t kDefaultRegionCount = 3;
+
+  /**
+   * @brief Rounds the regions up so that each of them can be bound as a uniform or storage buffer range.
+   *
+   */
+  static constexpr size_t kRegionAlignment = 256;
+
+  StreamingBuffer() = delete;
+  ERAY_DELETE_COPY(StreamingBuffer)
+
+  StreamingBuffer(StreamingBuffer&& other) noexcept;
+  StreamingBuffer& operator=(StreamingBuffer&& other) noexcept;
+  ~StreamingBuffer();
+
+  static StreamingBuffer create(size_t region_bytes_size, uint32_t region_count = kDefaultRegionCount);
+
+  /**
+   * @brief Advances to the next region, waits until the GPU has finished reading it and returns its memory.
+   *
+   */
+  std::span<std::byte> next_region();
+
+  /**
+   * @brief Switches to the region of the frame in flight without waiting, the `FrameSync::begin_frame()` has already
+   * waited for the GPU to finish the frame that used it. The buffer must have a region per frame in flight, the
+   * regions used this way are not fenced.
+   *
+   */
+  std::span<std::byte> frame_region(uint32_t frame_index) {
+    current_region_ = frame_index % region_count();
+    return {mapped_ + region_offset(), region_bytes_size_};
+  }
+
+  /**
+   * @brief Copies the data into the current region.
+   *
+   * @param bytes_offset is relative to the beginning of the region.
+   * @return GLintptr offset of the data from the beginning of the buffer.
+   */
+  template <typename T>
+  GLintptr write(std::span<const T> data, size_t bytes_offset = 0) {
+    std::memcpy(mapped_ + region_offset() + bytes_offset, data.data(), data.size_bytes());
+    return static_cast<GLintptr>(region_offset() + bytes_offset);
+  }
+
+  /**
+   * @brief Guards the current region, must be called after the last command that reads it has been issued.
+   *
+   */
+  void fence_region();
+
+  GLintptr region_offset() const { return static_cast<GLintptr>(current_region_ * region_bytes_size_); }
+  size_t region_bytes_size() const { return region_bytes_size_; }
+  uint32_t region_count() const { return static_cast<uint32_t>(fences_.size()); }
+
+ private:
+  StreamingBuffer(GLuint id, std::byte* mapped, size_t region_bytes_size, uint32_t region_count)
+      : Buffer(id), mapped_(mapped), region_bytes_size_(region_bytes_size), fences_(region_count, nullptr) {}
+
+  void release();
+
+ private:
+  std::byte* mapped_ = nullptr;
+  size_t region_bytes_size_{};
+  uint32_t current_region_{};
+  std::vector<GLsync> fences_;
+};
+
 }  // namespace eray::driver::gl
@@ -0,0 +1,80 @@
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <liberay/glren/frame_sync.hpp>
+#include <liberay/glren/gl_error.hpp>
+#include <liberay/util/panic.hpp>
+
+namespace eray::driver::gl {
+
+namespace {
+
+constexpr auto kFenceWaitTimeoutNs = GLuint64{1'000'000};
+
+}  // namespace
+
+FrameSync FrameSync::create(uint32_t frames_in_flight) {
+  return FrameSync(std::clamp(frames_in_flight, 1U, kMaxFramesInFlight));
+}
+
+FrameSync& FrameSync::operator=(FrameSync&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  release();
+  fences_      = std::exchange(other.fences_, {});
+  frame_index_ = other.frame_index_;
+  frame_       = other.frame_;
+
+  return *this;
+}
+
+FrameSync::~FrameSync() { release(); }
+
+void FrameSync::release() {
+  for (auto& fence : fences_) {
+    if (fence != nullptr) {
+      ERAY_GL_CALL(glDeleteSync(fence));
+      fence = nullptr;
+    }
+  }
+}
+
+uint32_t FrameSync::begin_frame() {
+  if (fences_.empty()) {
+    return 0;
+  }
+
+  frame_index_ = static_cast<uint32_t>(frame_ % fences_.size());
+  ++frame_;
+
+  if (auto& fence = fences_[frame_index_]; fence != nullptr) {
+    // The first wait flushes the commands of the last frame, so that the fence is guaranteed to signal
+    auto status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (status == GL_TIMEOUT_EXPIRED) {
+      status = glClientWaitSync(fence, 0, kFenceWaitTimeoutNs);
+    }
+    if (status == GL_WAIT_FAILED) {
+      util::panic("Waiting for the frame in flight failed");
+    }
+    ERAY_GL_CALL(glDeleteSync(fence));
+    fence = nullptr;
+  }
+
+  return frame_index_;
+}
+
+void FrameSync::end_frame() {
+  if (fences_.empty()) {
+    return;
+  }
+
+  auto& fence = fences_[frame_index_];
+  if (fence != nullptr) {
+    ERAY_GL_CALL(glDeleteSync(fence));
+  }
+  fence = ERAY_GL_CALL_RET(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+}  // namespace eray::driver::gl
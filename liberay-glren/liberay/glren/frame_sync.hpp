@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/util/ruleof.hpp>
+#include <utility>
+#include <vector>
+
+namespace eray::driver::gl {
+
+/**
+ * @brief Fences of the frames in flight. The CPU records at most `frames_in_flight()` frames ahead of the GPU: every
+ * frame is fenced after its last command and `begin_frame()` waits for the fence of the frame whose slot is reused.
+ * The per frame resources indexed with `frame_index()` (see `FrameSlots`) are then no longer read by the GPU and are
+ * written without any driver side synchronization, e.g. the regions of the persistently mapped buffers.
+ *
+ */
+class FrameSync {
+ public:
+  static constexpr uint32_t kMaxFramesInFlight = 3;
+
+  FrameSync() = delete;
+  explicit FrameSync(std::nullptr_t) {}
+  ERAY_DELETE_COPY(FrameSync)
+
+  FrameSync(FrameSync&& other) noexcept
+      : fences_(std::exchange(other.fences_, {})), frame_index_(other.frame_index_), frame_(other.frame_) {}
+  FrameSync& operator=(FrameSync&& other) noexcept;
+  ~FrameSync();
+
+  /**
+   * @brief Creates the fences.
+   *
+   * @param frames_in_flight Clamped to [1, `kMaxFramesInFlight`].
+   * @return FrameSync
+   */
+  static FrameSync create(uint32_t frames_in_flight);
+
+  /**
+   * @brief Advances to the next frame slot and waits until the GPU has finished the frame that used it before. Must be
+   * called before the first command of the frame.
+   *
+   * @return uint32_t Index of the frame in flight.
+   */
+  uint32_t begin_frame();
+
+  /**
+   * @brief Fences the frame, must be called after its last command, e.g. before the buffers are swapped.
+   *
+   */
+  void end_frame();
+
+  uint32_t frame_index() const { return frame_index_; }
+  uint32_t frames_in_flight() const { return static_cast<uint32_t>(fences_.size()); }
+
+  /**
+   * @brief Number of the frames begun so far.
+   *
+   */
+  uint64_t frame() const { return frame_; }
+
+ private:
+  explicit FrameSync(uint32_t frames_in_flight) : fences_(frames_in_flight, nullptr) {}
+
+  void release();
+
+ private:
+  std::vector<GLsync> fences_;
+  uint32_t frame_index_{};
+  uint64_t frame_{};
+};
+
+/**
+ * @brief A copy of a resource per frame in flight, e.g. a uniform buffer written every frame. The copy of the current
+ * frame is not read by the GPU once `FrameSync::begin_frame()` has returned.
+ *
+ */
+template <typename TResource>
+class FrameSlots {
+ public:
+  FrameSlots() = delete;
+
+  /**
+   * @brief Creates the copies with `factory(frame_index) -> TResource`.
+   *
+   */
+  template <typename TFactory>
+  static FrameSlots create(const FrameSync& frame_sync, TFactory&& factory) {
+    auto slots = std::vector<TResource>();
+    slots.reserve(frame_sync.frames_in_flight());
+    for (auto i = 0U; i < frame_sync.frames_in_flight(); ++i) {
+      slots.push_back(factory(i));
+    }
+    return FrameSlots(std::move(slots));
+  }
+
+  TResource& current(const FrameSync& frame_sync) { return slots_[frame_sync.frame_index()]; }
+  const TResource& current(const FrameSync& frame_sync) const { return slots_[frame_sync.frame_index()]; }
+
+  TResource& operator[](uint32_t frame_index) { return slots_[frame_index]; }
+  const TResource& operator[](uint32_t frame_index) const { return slots_[frame_index]; }
+
+  uint32_t size() const { return static_cast<uint32_t>(slots_.size()); }
+
+ private:
+  explicit FrameSlots(std::vector<TResource>&& slots) : slots_(std::move(slots)) {}
+
+ private:
+  std::vector<TResource> slots_;
+};
+
+}  // namespace eray::driver::gl
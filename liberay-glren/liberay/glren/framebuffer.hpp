@@ -2,8 +2,10 @@
 
 #include <glad/gl.h>
 
+#include <array>
 #include <cstddef>
 #include <liberay/util/ruleof.hpp>
+#include <optional>
 #include <unordered_set>
 
 namespace eray::driver::gl {
@@ -51,17 +53,52 @@ class ViewportFramebuffer : public Framebuffer {
   void begin_pick_render_only() const;
   void end_pick_render() const;
 
+  /**
+   * @brief Reads the mouse pick id under the cursor. Stalls the CPU until all of the rendering of the frame is
+   * finished, prefer `request_mouse_pick()`.
+   *
+   */
   int sample_mouse_pick(size_t x, size_t y) const;
   std::unordered_set<int> sample_mouse_pick_box(size_t x, size_t y, size_t width, size_t height) const;
 
+  /**
+   * @brief Copies the mouse pick id under the cursor to a pixel pack buffer and fences the copy. The copy is executed
+   * by the GPU along with the rendering, the id is returned by `poll_mouse_pick()` usually one or two frames later.
+   * The framebuffer must be bound.
+   *
+   * @return false when the position is outside of the framebuffer or all of the readbacks are still in flight.
+   */
+  bool request_mouse_pick(size_t x, size_t y);
+
+  /**
+   * @brief Never blocks. Consumes all of the finished readbacks and returns the id read by the most recent of them.
+   *
+   * @return std::optional<int> Nothing when no readback has finished since the last poll.
+   */
+  std::optional<int> poll_mouse_pick();
+
+  bool has_pending_mouse_picks() const { return pick_readbacks_pending_ > 0; }
+
   void clear() override;
   void resize(size_t width, size_t height) override;
 
   GLuint color_texture() const { return color_attachment_texture_; }
 
+  static constexpr size_t kPickReadbackCount = 3;
+
+ private:
+  struct PickReadback {
+    GLuint buffer;
+    GLsync fence;
+  };
+
  private:
   GLuint color_attachment_texture_, mouse_pick_attachment_texture_;
   GLuint depth_renderbuffer_;
+
+  std::array<PickReadback, kPickReadbackCount> pick_readbacks_{};
+  size_t pick_readbacks_head_{};
+  size_t pick_readbacks_pending_{};
 };
 
 class ImageFramebuffer : public Framebuffer {
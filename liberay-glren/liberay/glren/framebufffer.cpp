@@ -2,7 +2,9 @@
 
 #include <liberay/glren/framebuffer.hpp>
 #include <liberay/glren/gl_error.hpp>
+#include <liberay/glren/state_cache.hpp>
 #include <liberay/util/logger.hpp>
+#include <utility>
 
 namespace eray::driver::gl {
 
@@ -18,7 +20,10 @@ Framebuffer::Framebuffer(size_t width, size_t height) : width_(width), height_(h
   ERAY_GL_CALL(glCreateFramebuffers(1, &framebuffer_id_));
 }
 
-Framebuffer::~Framebuffer() { ERAY_GL_CALL(glDeleteFramebuffers(1, &framebuffer_id_)); }
+Framebuffer::~Framebuffer() {
+  StateCache::current().forget_framebuffer(framebuffer_id_);
+  ERAY_GL_CALL(glDeleteFramebuffers(1, &framebuffer_id_));
+}
 
 Framebuffer::Framebuffer(Framebuffer&& other) noexcept
     : width_(other.width_), height_(other.height_), framebuffer_id_(other.framebuffer_id_) {
@@ -28,13 +33,13 @@ Framebuffer::Framebuffer(Framebuffer&& other) noexcept
 }
 
 void Framebuffer::bind() const {
-  ERAY_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_id_));
+  StateCache::current().bind_framebuffer(framebuffer_id_);
   ERAY_GL_CALL(glViewport(0, 0, static_cast<GLsizei>(width_), static_cast<GLsizei>(height_)));
 }
 
-void Framebuffer::unbind() const { ERAY_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0)); }  // NOLINT
+void Framebuffer::unbind() const { StateCache::current().bind_framebuffer(0); }  // NOLINT
 
-void Framebuffer::start_init() const { ERAY_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_id_)); }
+void Framebuffer::start_init() const { StateCache::current().bind_framebuffer(framebuffer_id_); }
 
 void Framebuffer::end_init() const {  // NOLINT
   // Verify framebuffer creation
@@ -43,8 +48,9 @@ void Framebuffer::end_init() const {  // NOLINT
     std::terminate();
   }
 
-  // Bind default framebuffer
-  ERAY_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  // Bind default framebuffer, the attachments have been set up with the texture bound to the active unit
+  StateCache::current().bind_framebuffer(0);
+  StateCache::current().invalidate_texture_units();
 }
 
 ViewportFramebuffer::ViewportFramebuffer(size_t width, size_t height)
@@ -78,6 +84,12 @@ ViewportFramebuffer::ViewportFramebuffer(size_t width, size_t height)
       glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, mouse_pick_attachment_texture_, 0));
 
   end_init();
+
+  // Setup mouse pick readbacks, each holds a single id
+  for (auto& readback : pick_readbacks_) {
+    ERAY_GL_CALL(glCreateBuffers(1, &readback.buffer));
+    ERAY_GL_CALL(glNamedBufferStorage(readback.buffer, sizeof(int), nullptr, GL_CLIENT_STORAGE_BIT));
+  }
 }
 
 ViewportFramebuffer::~ViewportFramebuffer() {
@@ -85,6 +97,15 @@ ViewportFramebuffer::~ViewportFramebuffer() {
     return;
   }
 
+  for (auto& readback : pick_readbacks_) {
+    if (readback.fence != nullptr) {
+      ERAY_GL_CALL(glDeleteSync(readback.fence));
+    }
+    ERAY_GL_CALL(glDeleteBuffers(1, &readback.buffer));
+  }
+
+  StateCache::current().forget_texture(color_attachment_texture_);
+  StateCache::current().forget_texture(mouse_pick_attachment_texture_);
   ERAY_GL_CALL(glDeleteRenderbuffers(1, &depth_renderbuffer_));
   ERAY_GL_CALL(glDeleteTextures(1, &color_attachment_texture_));
   ERAY_GL_CALL(glDeleteTextures(1, &mouse_pick_attachment_texture_));
@@ -94,7 +115,10 @@ ViewportFramebuffer::ViewportFramebuffer(ViewportFramebuffer&& other) noexcept
     : Framebuffer(std::move(other)),
       color_attachment_texture_(other.color_attachment_texture_),
       mouse_pick_attachment_texture_(other.mouse_pick_attachment_texture_),
-      depth_renderbuffer_(other.depth_renderbuffer_) {
+      depth_renderbuffer_(other.depth_renderbuffer_),
+      pick_readbacks_(std::exchange(other.pick_readbacks_, {})),
+      pick_readbacks_head_(std::exchange(other.pick_readbacks_head_, 0)),
+      pick_readbacks_pending_(std::exchange(other.pick_readbacks_pending_, 0)) {
   other.color_attachment_texture_      = 0;
   other.mouse_pick_attachment_texture_ = 0;
   other.depth_renderbuffer_            = 0;
@@ -138,6 +162,7 @@ void ViewportFramebuffer::resize(size_t width, size_t height) {
   // Resize mouse pick attachment
   ERAY_GL_CALL(glBindTexture(GL_TEXTURE_2D, mouse_pick_attachment_texture_));
   prepare_texture(GL_RED_INTEGER, GL_R32I, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+  StateCache::current().invalidate_texture_units();
 }
 
 int ViewportFramebuffer::sample_mouse_pick(const size_t x, const size_t y) const {  // NOLINT
@@ -148,6 +173,51 @@ int ViewportFramebuffer::sample_mouse_pick(const size_t x, const size_t y) const
   return pixel;
 }
 
+bool ViewportFramebuffer::request_mouse_pick(const size_t x, const size_t y) {
+  if (x >= width_ || y == 0 || y > height_) {
+    return false;
+  }
+  if (pick_readbacks_pending_ == kPickReadbackCount) {
+    util::Logger::warn("All of the mouse pick readbacks are in flight, the request is dropped");
+    return false;
+  }
+
+  auto& readback = pick_readbacks_[pick_readbacks_head_];
+  ERAY_GL_CALL(glReadBuffer(GL_COLOR_ATTACHMENT1));
+  ERAY_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+  ERAY_GL_CALL(
+      glReadPixels(static_cast<GLint>(x), static_cast<GLint>(height_ - y), 1, 1, GL_RED_INTEGER, GL_INT, nullptr));
+  ERAY_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  readback.fence = ERAY_GL_CALL_RET(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+  pick_readbacks_head_ = (pick_readbacks_head_ + 1) % kPickReadbackCount;
+  ++pick_readbacks_pending_;
+  return true;
+}
+
+std::optional<int> ViewportFramebuffer::poll_mouse_pick() {
+  auto result = std::optional<int>();
+  while (pick_readbacks_pending_ > 0) {
+    // The readbacks are fenced in order, the oldest one finishes first
+    auto& readback =
+        pick_readbacks_[(pick_readbacks_head_ + kPickReadbackCount - pick_readbacks_pending_) % kPickReadbackCount];
+    const auto status = ERAY_GL_CALL_RET(glClientWaitSync(readback.fence, 0, 0));
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      break;
+    }
+
+    ERAY_GL_CALL(glDeleteSync(readback.fence));
+    readback.fence = nullptr;
+    --pick_readbacks_pending_;
+
+    int pixel = -1;
+    ERAY_GL_CALL(glGetNamedBufferSubData(readback.buffer, 0, sizeof(int), &pixel));
+    result = pixel;
+  }
+
+  return result;
+}
+
 std::unordered_set<int> ViewportFramebuffer::sample_mouse_pick_box(const size_t x, const size_t y, const size_t width,
                                                                    const size_t height) const {  // NOLINT
   auto glwidth  = width;
@@ -198,6 +268,7 @@ ImageFramebuffer::~ImageFramebuffer() {
   if (color_attachment_texture_ == 0) {
     return;
   }
+  StateCache::current().forget_texture(color_attachment_texture_);
   ERAY_GL_CALL(glDeleteTextures(1, &color_attachment_texture_));
 }
 
@@ -215,6 +286,7 @@ void ImageFramebuffer::resize(size_t width, size_t height) {
   // Resize color attachment
   ERAY_GL_CALL(glBindTexture(GL_TEXTURE_2D, color_attachment_texture_));
   prepare_texture(GL_RGBA, GL_RGBA8, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+  StateCache::current().invalidate_texture_units();
 }
 
 }  // namespace eray::driver::gl
@@ -0,0 +1,142 @@
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <liberay/glren/gl_error.hpp>
+#include <liberay/glren/gpu_profiler.hpp>
+#include <liberay/util/logger.hpp>
+#include <utility>
+
+namespace eray::driver::gl {
+
+// -- GpuProfileScope -------------------------------------------------------------------------------------------------
+
+GpuProfileScope::GpuProfileScope(GpuProfileScope&& other) noexcept
+    : profiler_(std::exchange(other.profiler_, nullptr)), zone_(other.zone_) {}
+
+GpuProfileScope::~GpuProfileScope() {
+  if (profiler_ != nullptr) {
+    profiler_->end_zone(zone_);
+  }
+}
+
+// -- GpuProfiler -----------------------------------------------------------------------------------------------------
+
+GpuProfiler GpuProfiler::create(uint32_t frame_latency) {
+  GLint counter_bits = 0;
+  ERAY_GL_CALL(glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counter_bits));
+  if (counter_bits == 0) {
+    util::Logger::warn("OpenGL timestamp queries are not supported, the GPU profiling is disabled");
+    return GpuProfiler(std::vector<Frame>());
+  }
+
+  return GpuProfiler(std::vector<Frame>(std::max(frame_latency, 1U)));
+}
+
+GpuProfiler::GpuProfiler(GpuProfiler&& other) noexcept
+    : frames_(std::exchange(other.frames_, {})),
+      current_frame_(other.current_frame_),
+      pass_names_(std::move(other.pass_names_)),
+      pass_indices_(std::move(other.pass_indices_)),
+      profiling_results_(std::move(other.profiling_results_)),
+      dropped_frame_count_(other.dropped_frame_count_) {}
+
+GpuProfiler& GpuProfiler::operator=(GpuProfiler&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  release();
+  frames_              = std::exchange(other.frames_, {});
+  current_frame_       = other.current_frame_;
+  pass_names_          = std::move(other.pass_names_);
+  pass_indices_        = std::move(other.pass_indices_);
+  profiling_results_   = std::move(other.profiling_results_);
+  dropped_frame_count_ = other.dropped_frame_count_;
+
+  return *this;
+}
+
+GpuProfiler::~GpuProfiler() { release(); }
+
+void GpuProfiler::release() {
+  for (auto& frame : frames_) {
+    if (!frame.queries.empty()) {
+      ERAY_GL_CALL(glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data()));
+    }
+  }
+  frames_.clear();
+}
+
+void GpuProfiler::begin_frame() {
+  if (!is_enabled()) {
+    return;
+  }
+
+  current_frame_ = (current_frame_ + 1) % static_cast<uint32_t>(frames_.size());
+  auto& frame    = frames_[current_frame_];
+  if (frame.zone_count > 0) {
+    // The queries are ended in order, the last one is available once all of them are
+    GLint available = GL_FALSE;
+    ERAY_GL_CALL(glGetQueryObjectiv(frame.queries[2 * frame.zone_count - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+    if (available == GL_TRUE) {
+      read_results(frame);
+    } else {
+      ++dropped_frame_count_;
+    }
+  }
+
+  frame.pass_indices.clear();
+  frame.zone_count = 0;
+}
+
+GpuProfileScope GpuProfiler::scope(std::string_view pass_name) {
+  if (!is_enabled()) {
+    return GpuProfileScope(nullptr, 0);
+  }
+
+  auto pass_index = static_cast<uint32_t>(pass_names_.size());
+  if (auto it = pass_indices_.find(pass_name); it != pass_indices_.end()) {
+    pass_index = it->second;
+  } else {
+    pass_names_.emplace_back(pass_name);
+    pass_indices_.try_emplace(std::string(pass_name), pass_index);
+  }
+
+  auto& frame     = frames_[current_frame_];
+  const auto zone = frame.zone_count++;
+  if (frame.queries.size() < 2 * frame.zone_count) {
+    const auto old_size = frame.queries.size();
+    frame.queries.resize(2 * frame.zone_count);
+    ERAY_GL_CALL(glGenQueries(2, frame.queries.data() + old_size));
+  }
+  frame.pass_indices.push_back(pass_index);
+  ERAY_GL_CALL(glQueryCounter(frame.queries[2 * zone], GL_TIMESTAMP));
+
+  return GpuProfileScope(this, zone);
+}
+
+void GpuProfiler::end_zone(uint32_t zone) {
+  ERAY_GL_CALL(glQueryCounter(frames_[current_frame_].queries[2 * zone + 1], GL_TIMESTAMP));
+}
+
+void GpuProfiler::read_results(const Frame& frame) {
+  profiling_results_.clear();
+  for (auto zone = 0U; zone < frame.zone_count; ++zone) {
+    GLuint64 begin = 0;
+    GLuint64 end   = 0;
+    ERAY_GL_CALL(glGetQueryObjectui64v(frame.queries[2 * zone], GL_QUERY_RESULT, &begin));
+    ERAY_GL_CALL(glGetQueryObjectui64v(frame.queries[2 * zone + 1], GL_QUERY_RESULT, &end));
+    const auto gpu_time_ms = static_cast<double>(end - begin) / 1'000'000.0;
+
+    // The scopes of the same pass are summed up
+    const auto pass_index = frame.pass_indices[zone];
+    auto it               = std::ranges::find(profiling_results_, pass_index, &PassProfilingResult::pass_index);
+    if (it != profiling_results_.end()) {
+      it->gpu_time_ms += gpu_time_ms;
+    } else {
+      profiling_results_.push_back(PassProfilingResult{.pass_index = pass_index, .gpu_time_ms = gpu_time_ms});
+    }
+  }
+}
+
+}  // namespace eray::driver::gl
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <liberay/util/flat_hash_map.hpp>
+#include <liberay/util/ruleof.hpp>
+#include <liberay/util/string_hash.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace eray::driver::gl {
+
+/**
+ * @brief GPU cost of a single pass measured with timestamp queries.
+ *
+ */
+struct PassProfilingResult {
+  uint32_t pass_index = 0;
+  double gpu_time_ms  = 0.0;
+};
+
+class GpuProfiler;
+
+/**
+ * @brief Measures the GPU time of the commands issued in its lifetime, see `GpuProfiler::scope()`.
+ *
+ */
+class GpuProfileScope {
+ public:
+  GpuProfileScope() = delete;
+  ERAY_DELETE_COPY(GpuProfileScope)
+
+  GpuProfileScope(GpuProfileScope&& other) noexcept;
+  GpuProfileScope& operator=(GpuProfileScope&& other) = delete;
+  ~GpuProfileScope();
+
+ private:
+  friend class GpuProfiler;
+
+  GpuProfileScope(GpuProfiler* profiler, uint32_t zone) : profiler_(profiler), zone_(zone) {}
+
+ private:
+  GpuProfiler* profiler_;
+  uint32_t zone_;
+};
+
+/**
+ * @brief Measures the GPU time of the passes with `GL_TIMESTAMP` queries. Each of the `frame_latency` frames uses its
+ * own queries, their results are read when the queries are reused, i.e. `frame_latency` frames later, so the CPU never
+ * waits for the GPU. The results that are still unavailable then are dropped. The timestamps, unlike the
+ * `GL_TIME_ELAPSED` queries, allow the passes to nest.
+ *
+ * The results have the same form as the results of the vkren render graph profiling, so both of the backends can be
+ * reported by the same code.
+ *
+ */
+class GpuProfiler {
+ public:
+  static constexpr uint32_t kDefaultFrameLatency = 3;
+
+  GpuProfiler() = delete;
+  explicit GpuProfiler(std::nullptr_t) {}
+  ERAY_DELETE_COPY(GpuProfiler)
+
+  GpuProfiler(GpuProfiler&& other) noexcept;
+  GpuProfiler& operator=(GpuProfiler&& other) noexcept;
+  ~GpuProfiler();
+
+  /**
+   * @brief Creates the profiler. Without the timestamp support the profiler is disabled and the scopes measure nothing.
+   *
+   * @param frame_latency Number of frames after which the results are read.
+   * @return GpuProfiler
+   */
+  static GpuProfiler create(uint32_t frame_latency = kDefaultFrameLatency);
+
+  /**
+   * @brief Reads back the results of the frame whose queries are reused and starts a new frame. Must be called once per
+   * frame before the first scope.
+   *
+   */
+  void begin_frame();
+
+  /**
+   * @brief Measures the commands issued until the returned scope is destroyed. The scopes of the same name are
+   * reported as a single pass.
+   *
+   */
+  [[nodiscard]] GpuProfileScope scope(std::string_view pass_name);
+
+  bool is_enabled() const { return !frames_.empty(); }
+
+  /**
+   * @brief Results of the most recent frame whose queries have been read back, in the order the scopes were opened.
+   *
+   */
+  std::span<const PassProfilingResult> profiling_results() const { return profiling_results_; }
+
+  const std::string& pass_name(uint32_t pass_index) const { return pass_names_[pass_index]; }
+
+  /**
+   * @brief Number of frames whose results were not available in time.
+   *
+   */
+  uint64_t dropped_frame_count() const { return dropped_frame_count_; }
+
+ private:
+  friend class GpuProfileScope;
+
+  /**
+   * @brief Two timestamps per zone.
+   *
+   */
+  struct Frame {
+    std::vector<GLuint> queries;
+    std::vector<uint32_t> pass_indices;
+    uint32_t zone_count{};
+  };
+
+  explicit GpuProfiler(std::vector<Frame>&& frames) : frames_(std::move(frames)) {}
+
+  void end_zone(uint32_t zone);
+  void read_results(const Frame& frame);
+  void release();
+
+ private:
+  std::vector<Frame> frames_;
+  uint32_t current_frame_{};
+
+  std::vector<std::string> pass_names_;
+  util::FlatHashMap<std::string, uint32_t, util::StringHash, std::equal_to<>> pass_indices_;
+
+  std::vector<PassProfilingResult> profiling_results_;
+  uint64_t dropped_frame_count_{};
+};
+
+}  // namespace eray::driver::gl
@@ -0,0 +1,108 @@
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <liberay/glren/buffer.hpp>
+#include <liberay/glren/gl_error.hpp>
+#include <liberay/glren/indirect_draw.hpp>
+#include <liberay/glren/vertex_array.hpp>
+#include <liberay/util/logger.hpp>
+
+namespace eray::driver::gl {
+
+// -- MeshArena -------------------------------------------------------------------------------------------------------
+
+MeshArena MeshArena::create(VertexBuffer::Layout&& layout, size_t vertex_capacity, size_t index_capacity) {
+  auto vbo = VertexBuffer::create(std::move(layout));
+  vbo.allocate(vertex_capacity);
+  auto ebo = ElementBuffer::create();
+  ebo.allocate(index_capacity);
+
+  return MeshArena(VertexArray::create(std::move(vbo), std::move(ebo)), vertex_capacity, index_capacity);
+}
+
+std::optional<MeshRange> MeshArena::add_mesh(const void* vertices, size_t vertex_count,
+                                             std::span<const uint32_t> indices) {
+  if (vertex_count_ + vertex_count > vertex_capacity_ || index_count_ + indices.size() > index_capacity_) {
+    util::Logger::warn("Mesh arena is full, the mesh with {} vertices and {} indices is not added", vertex_count,
+                       indices.size());
+    return std::nullopt;
+  }
+
+  const auto range = MeshRange{
+      .index_count = static_cast<uint32_t>(indices.size()),
+      .first_index = static_cast<uint32_t>(index_count_),
+      .base_vertex = static_cast<int32_t>(vertex_count_),
+  };
+  vao_.vbo().sub_buffer_data(static_cast<GLuint>(vertex_count_), vertices, vertex_count);
+  vao_.ebo().sub_buffer_data(static_cast<GLuint>(index_count_), indices);
+  vertex_count_ += vertex_count;
+  index_count_  += indices.size();
+
+  return range;
+}
+
+// -- IndirectDrawBuffer ----------------------------------------------------------------------------------------------
+
+IndirectDrawBuffer IndirectDrawBuffer::create() {
+  GLuint id = 0;
+  ERAY_GL_CALL(glCreateBuffers(1, &id));
+  return IndirectDrawBuffer(id);
+}
+
+uint32_t IndirectDrawBuffer::add_draw(const MeshRange& mesh, uint32_t instance_count) {
+  commands_.push_back(DrawElementsIndirectCommand{
+      .count          = mesh.index_count,
+      .instance_count = instance_count,
+      .first_index    = mesh.first_index,
+      .base_vertex    = mesh.base_vertex,
+      .base_instance  = instance_count_,
+  });
+  instance_count_ += instance_count;
+  return static_cast<uint32_t>(commands_.size() - 1);
+}
+
+void IndirectDrawBuffer::clear() {
+  commands_.clear();
+  instance_count_ = 0;
+}
+
+void IndirectDrawBuffer::upload() {
+  const auto bytes_size = static_cast<GLsizeiptr>(commands_.size() * sizeof(DrawElementsIndirectCommand));
+  if (commands_.size() > capacity_) {
+    capacity_ = std::max(commands_.size(), capacity_ * 2);
+    ERAY_GL_CALL(glNamedBufferData(id_.get(),
+                                   static_cast<GLsizeiptr>(capacity_ * sizeof(DrawElementsIndirectCommand)), nullptr,
+                                   GL_DYNAMIC_DRAW));
+  }
+  if (bytes_size > 0) {
+    ERAY_GL_CALL(glNamedBufferSubData(id_.get(), 0, bytes_size, commands_.data()));
+  }
+}
+
+void IndirectDrawBuffer::draw(const MeshArena& arena, GLenum mode) const {
+  if (commands_.empty()) {
+    return;
+  }
+
+  arena.vertex_array().bind();
+  ERAY_GL_CALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id_.get()));
+  ERAY_GL_CALL(glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands_.size()),
+                                           sizeof(DrawElementsIndirectCommand)));
+}
+
+void IndirectDrawBuffer::draw_count(const MeshArena& arena, const Buffer& parameter_buffer,
+                                    GLintptr count_bytes_offset, GLsizei max_draw_count, GLenum mode) const {
+  arena.vertex_array().bind();
+  ERAY_GL_CALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id_.get()));
+  if (!supports_draw_count()) {
+    ERAY_GL_CALL(glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, nullptr, max_draw_count,
+                                             sizeof(DrawElementsIndirectCommand)));
+    return;
+  }
+
+  ERAY_GL_CALL(glBindBuffer(GL_PARAMETER_BUFFER, parameter_buffer.raw_gl_id()));
+  ERAY_GL_CALL(glMultiDrawElementsIndirectCount(mode, GL_UNSIGNED_INT, nullptr, count_bytes_offset, max_draw_count,
+                                                sizeof(DrawElementsIndirectCommand)));
+}
+
+}  // namespace eray::driver::gl
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <liberay/glren/buffer.hpp>
+#include <liberay/glren/gl_error.hpp>
+#include <liberay/glren/vertex_array.hpp>
+#include <liberay/util/ruleof.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace eray::driver::gl {
+
+/**
+ * @brief Layout of the commands read by `glMultiDrawElementsIndirect`.
+ *
+ */
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(GLuint));
+
+/**
+ * @brief Place of a mesh in the `MeshArena`.
+ *
+ */
+struct MeshRange {
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t base_vertex;
+};
+
+/**
+ * @brief Vertices and indices of many meshes in a single vertex array, so that all of them are drawn by one multi draw
+ * call. The meshes are appended, the indices of every mesh are relative to its first vertex.
+ *
+ */
+class MeshArena {
+ public:
+  MeshArena() = delete;
+  ERAY_DELETE_COPY(MeshArena)
+  ERAY_DEFAULT_MOVE(MeshArena)
+
+  static MeshArena create(VertexBuffer::Layout&& layout, size_t vertex_capacity, size_t index_capacity);
+
+  /**
+   * @brief Copies the mesh into the arena.
+   *
+   * @param vertices `vertex_count` vertices with the layout of the arena.
+   * @return std::optional<MeshRange> Nothing when the arena is full.
+   */
+  std::optional<MeshRange> add_mesh(const void* vertices, size_t vertex_count, std::span<const uint32_t> indices);
+
+  const VertexArray& vertex_array() const { return vao_; }
+
+  size_t vertex_count() const { return vertex_count_; }
+  size_t index_count() const { return index_count_; }
+
+ private:
+  MeshArena(VertexArray&& vao, size_t vertex_capacity, size_t index_capacity)
+      : vao_(std::move(vao)), vertex_capacity_(vertex_capacity), index_capacity_(index_capacity) {}
+
+ private:
+  VertexArray vao_;
+  size_t vertex_capacity_;
+  size_t index_capacity_;
+  size_t vertex_count_{};
+  size_t index_count_{};
+};
+
+/**
+ * @brief Draw commands of the meshes of a `MeshArena`, all of them issued by a single `glMultiDrawElementsIndirect`.
+ *
+ * The draw id returned by `add_draw` is the `gl_DrawID` of the draw in the shaders, which index the per draw data in
+ * a shader storage buffer with it, e.g. the model matrix and the material. The instances of all the draws are
+ * numbered consecutively, `gl_BaseInstance + gl_InstanceID` indexes the per instance data.
+ *
+ */
+class IndirectDrawBuffer : public Buffer {
+ public:
+  IndirectDrawBuffer() = delete;
+  ERAY_DELETE_COPY(IndirectDrawBuffer)
+  ERAY_DEFAULT_MOVE(IndirectDrawBuffer)
+
+  static IndirectDrawBuffer create();
+
+  /**
+   * @brief Appends a draw command.
+   *
+   * @return uint32_t The draw id.
+   */
+  uint32_t add_draw(const MeshRange& mesh, uint32_t instance_count = 1);
+
+  void clear();
+
+  /**
+   * @brief Uploads the commands, must be called after they have changed and before drawing them. The storage grows
+   * only when there are more commands than ever before.
+   *
+   */
+  void upload();
+
+  /**
+   * @brief Draws all the commands with a single `glMultiDrawElementsIndirect`.
+   *
+   */
+  void draw(const MeshArena& arena, GLenum mode = GL_TRIANGLES) const;
+
+  /**
+   * @brief Draws the first commands with `glMultiDrawElementsIndirectCount`, their count is read by the GPU from the
+   * parameter buffer, e.g. written by a culling compute shader. Without OpenGL 4.6 all the `max_draw_count` commands
+   * are drawn, so the culling must also zero the instance count of the culled commands.
+   *
+   */
+  void draw_count(const MeshArena& arena, const Buffer& parameter_buffer, GLintptr count_bytes_offset,
+                  GLsizei max_draw_count, GLenum mode = GL_TRIANGLES) const;
+
+  static bool supports_draw_count() { return GLAD_GL_VERSION_4_6 != 0; }
+
+  std::span<const DrawElementsIndirectCommand> commands() const { return commands_; }
+  size_t draw_count() const { return commands_.size(); }
+  uint32_t instance_count() const { return instance_count_; }
+
+ private:
+  explicit IndirectDrawBuffer(GLuint id) : Buffer(id) {}
+
+ private:
+  std::vector<DrawElementsIndirectCommand> commands_;
+  uint32_t instance_count_{};
+  size_t capacity_{};
+};
+
+}  // namespace eray::driver::gl
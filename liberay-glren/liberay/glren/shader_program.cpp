@@ -1,30 +1,91 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <expected>
 #include <liberay/glren/gl_error.hpp>
 #include <liberay/glren/glsl_shader.hpp>
 #include <liberay/glren/shader_program.hpp>
+#include <liberay/glren/state_cache.hpp>
+#include <liberay/res/asset_cache.hpp>
 #include <liberay/util/logger.hpp>
 #include <liberay/util/try.hpp>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace eray::driver::gl {
 
+namespace {
+
+/**
+ * @brief Bumped whenever the cached program binaries change their layout.
+ *
+ */
+constexpr auto kProgramBinaryVersion = uint32_t{1};
+
+struct ProgramBinaryMetadata {
+  GLenum format;
+};
+
+std::optional<res::AssetCache>& program_binary_cache() {
+  static std::optional<res::AssetCache> cache;
+  return cache;
+}
+
+/**
+ * @brief The binaries are valid only for the driver that produced them. Zero when the driver supports no binary
+ * formats.
+ *
+ */
+uint64_t driver_params_hash() {
+  static const uint64_t kHash = [] {
+    GLint format_count = 0;
+    ERAY_GL_CALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count));
+    if (format_count <= 0) {
+      util::Logger::warn("The OpenGL driver supports no program binary formats, the programs are not cached");
+      return uint64_t{0};
+    }
+
+    auto driver = std::to_string(kProgramBinaryVersion);
+    for (const auto name : std::array<GLenum, 3>{GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      const auto* str = reinterpret_cast<const char*>(ERAY_GL_CALL_RET(glGetString(name)));
+      driver += '\n';
+      driver += str != nullptr ? str : "";
+    }
+    return std::max(res::content_hash(std::as_bytes(std::span(driver))), uint64_t{1});
+  }();
+  return kHash;
+}
+
+}  // namespace
+
+void ShaderProgram::set_binary_cache(std::optional<res::AssetCache> cache) {
+  program_binary_cache() = std::move(cache);
+}
+
 ShaderProgram::ShaderProgram(util::zstring_view name) : shader_name_(name), program_id_(glCreateProgram()) {
   if (program_id_ == 0) {
     throw std::runtime_error(std::format("Unable to create shader {}", name));
   }
 }
 
-ShaderProgram::~ShaderProgram() { ERAY_GL_CALL(glDeleteProgram(program_id_)); }
+ShaderProgram::~ShaderProgram() {
+  StateCache::current().forget_program(program_id_);
+  ERAY_GL_CALL(glDeleteProgram(program_id_));
+}
 
-void ShaderProgram::bind() const { ERAY_GL_CALL(glUseProgram(program_id_)); }
+void ShaderProgram::bind() const { StateCache::current().use_program(program_id_); }
 
-void ShaderProgram::unbind() const { ERAY_GL_CALL(glUseProgram(0)); }  // NOLINT
+void ShaderProgram::unbind() const { StateCache::current().use_program(0); }  // NOLINT
 
 std::expected<void, ShaderProgram::ProgramCreationError> ShaderProgram::recompile() {
   using clock = std::chrono::high_resolution_clock;
   auto start  = clock::now();
 
+  StateCache::current().forget_program(program_id_);
   ERAY_GL_CALL(glDeleteProgram(program_id_));
   program_id_ = ERAY_GL_CALL_RET(glCreateProgram());
 
@@ -34,11 +95,6 @@ std::expected<void, ShaderProgram::ProgramCreationError> ShaderProgram::recompil
   auto duration = duration_cast<std::chrono::milliseconds>(stop - start);
   util::Logger::debug("Shader {} recompilation took {}", shader_name_, duration);
 
-  // Reconnect UBO bindings
-  for (auto& pair : uniform_block_bindings_) {
-    ERAY_GL_CALL(glUniformBlockBinding(program_id_, pair.first, pair.second));
-  }
-
   return {};
 }
 
@@ -73,6 +129,9 @@ std::optional<std::string> ShaderProgram::program_status(GLuint program, GLenum
 }
 
 std::expected<void, ShaderProgram::ProgramCreationError> ShaderProgram::link_program() {
+  if (program_binary_cache()) {
+    ERAY_GL_CALL(glProgramParameteri(program_id_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+  }
   ERAY_GL_CALL(glLinkProgram(program_id_));
 
   auto link_status = program_status(program_id_, GL_LINK_STATUS);
@@ -89,9 +148,29 @@ std::expected<void, ShaderProgram::ProgramCreationError> ShaderProgram::link_pro
     return std::unexpected(ProgramCreationError::LinkingFailed);
   }
 
+  resolve_after_link();
+
   return {};
 }
 
+void ShaderProgram::resolve_after_link() const {
+  uniform_locations_.clear();
+  for (auto& handle : uniform_handles_) {
+    handle.location = ERAY_GL_CALL_RET(glGetUniformLocation(program_id_, handle.name.c_str()));
+    if (handle.location == -1) {
+      util::Logger::err(R"(Unable to find uniform "{}" in shader "{}")", handle.name, shader_name_);
+    }
+  }
+
+  // Reconnect the block bindings
+  for (const auto& [name, binding] : uniform_block_bindings_) {
+    bind_uniform_block(name, binding);
+  }
+  for (const auto& [name, binding] : storage_block_bindings_) {
+    bind_storage_block(name, binding);
+  }
+}
+
 GLint ShaderProgram::uniform_location(util::zstring_view name) const {
   auto it = uniform_locations_.find(name);
   if (it != uniform_locations_.end()) {
@@ -110,6 +189,104 @@ GLint ShaderProgram::uniform_location(util::zstring_view name) const {
   return location;
 }
 
+std::optional<res::AssetKey> ShaderProgram::binary_key(std::span<const GLSLShader* const> shaders) {
+  if (!program_binary_cache()) {
+    return std::nullopt;
+  }
+  const auto params_hash = driver_params_hash();
+  if (params_hash == 0) {
+    return std::nullopt;
+  }
+
+  auto content_hash = uint64_t{0};
+  for (const auto* shader : shaders) {
+    if (shader == nullptr) {
+      continue;
+    }
+    content_hash = res::content_hash(std::as_bytes(std::span(shader->glsl())),
+                                     content_hash ^ static_cast<uint64_t>(shader->type()));
+  }
+
+  return res::AssetKey{.content_hash = content_hash, .params_hash = params_hash};
+}
+
+bool ShaderProgram::load_binary(const res::AssetKey& key) {
+  auto asset = program_binary_cache()->find(key, res::AssetKind::Shader);
+  if (!asset) {
+    return false;
+  }
+
+  const auto metadata = asset->metadata<ProgramBinaryMetadata>();
+  ERAY_GL_CALL(glProgramBinary(program_id_, metadata.format, asset->payload().data(),
+                               static_cast<GLsizei>(asset->payload().size())));
+
+  // The driver rejects the binaries of another driver version, the program is compiled then
+  if (program_status(program_id_, GL_LINK_STATUS).has_value()) {
+    util::Logger::info(R"(Cached binary of shader "{}" has been rejected by the driver)", shader_name_);
+    return false;
+  }
+
+  resolve_after_link();
+  util::Logger::debug(R"(Loaded cached binary of shader "{}")", shader_name_);
+  return true;
+}
+
+void ShaderProgram::store_binary(const res::AssetKey& key) const {
+  GLint length = 0;
+  ERAY_GL_CALL(glGetProgramiv(program_id_, GL_PROGRAM_BINARY_LENGTH, &length));
+  if (length <= 0) {
+    return;
+  }
+
+  auto binary   = std::vector<std::byte>(static_cast<size_t>(length));
+  auto metadata = ProgramBinaryMetadata{};
+  ERAY_GL_CALL(glGetProgramBinary(program_id_, length, &length, &metadata.format, binary.data()));
+  binary.resize(static_cast<size_t>(length));
+
+  if (auto result = program_binary_cache()->store(key, res::AssetKind::Shader,
+                                                  std::as_bytes(std::span(&metadata, 1)), binary);
+      !result) {
+    util::Logger::warn(R"(Could not cache the binary of shader "{}": {})", shader_name_, result.error().msg);
+  }
+}
+
+uint32_t ShaderProgram::register_uniform(util::zstring_view name) const {
+  auto it = std::ranges::find(uniform_handles_, std::string_view(name), &UniformHandle::name);
+  if (it != uniform_handles_.end()) {
+    return static_cast<uint32_t>(it - uniform_handles_.begin());
+  }
+
+  uniform_handles_.push_back(UniformHandle{.name = std::string(name), .location = uniform_location(name)});
+  return static_cast<uint32_t>(uniform_handles_.size() - 1);
+}
+
+void ShaderProgram::bind_uniform_block(util::zstring_view name, GLuint binding) const {
+  const GLuint index = ERAY_GL_CALL_RET(glGetUniformBlockIndex(program_id_, name.c_str()));
+  if (index == GL_INVALID_INDEX) {
+    util::Logger::err(R"(Unable to find uniform block "{}" in shader "{}")", name, shader_name_);
+    return;
+  }
+
+  uniform_block_bindings_[std::string(name)] = binding;
+  ERAY_GL_CALL(glUniformBlockBinding(program_id_, index, binding));
+  util::Logger::debug(R"(Bound uniform block "{}" (index: {}) in shader "{}" to binding: {})", name, index,
+                      shader_name_, binding);
+}
+
+void ShaderProgram::bind_storage_block(util::zstring_view name, GLuint binding) const {
+  const GLuint index =
+      ERAY_GL_CALL_RET(glGetProgramResourceIndex(program_id_, GL_SHADER_STORAGE_BLOCK, name.c_str()));
+  if (index == GL_INVALID_INDEX) {
+    util::Logger::err(R"(Unable to find shader storage block "{}" in shader "{}")", name, shader_name_);
+    return;
+  }
+
+  storage_block_bindings_[std::string(name)] = binding;
+  ERAY_GL_CALL(glShaderStorageBlockBinding(program_id_, index, binding));
+  util::Logger::debug(R"(Bound shader storage block "{}" (index: {}) in shader "{}" to binding: {})", name, index,
+                      shader_name_, binding);
+}
+
 // TODO(migoox): return GLName wrapper instead of the raw id
 std::expected<GLuint, ShaderProgram::ProgramCreationError> ShaderProgram::create_shader(const GLSLShader& resource,
                                                                                         GLenum type) {
@@ -133,45 +310,6 @@ std::expected<GLuint, ShaderProgram::ProgramCreationError> ShaderProgram::create
   return shader;
 }
 
-// void ShaderProgram::bind_uniform_buffer(util::zstring_view name, const UniformBuffer& ubo) const {
-//   const GLuint index = ERAY_GL_CALL( glGetUniformBlockIndex(program_id_, name.data()) );
-//   if (index == GL_INVALID_INDEX) {
-//     log_throw(ShaderProgramValidationException(
-//         shader_name_, std::format(R"(Unable to find uniform block "{}" in shader "{}")", name, shader_name_)));
-//   }
-
-//   GLint size = 0;
-//   ERAY_GL_CALL( glGetActiveUniformBlockiv(program_id_, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size) );
-
-//   // According to std140 standard the padding at the end of an array MAY be added
-//   // https://registry.khronos.org/OpenGL/specs/gl/glspec45.core.pdf#page=159
-//   if (size != static_cast<GLint>(ubo.buffer_size()) &&
-//       size != static_cast<GLint>(ubo.buffer_size_without_end_padding())) {
-//     log_throw(ShaderProgramValidationException(
-//         shader_name_, std::format(R"(Unexpected uniform block size: {}. Expected: {} or {})", size,
-//         ubo.buffer_size(),
-//                                   ubo.buffer_size_without_end_padding())));
-//   }
-
-//   uniform_block_bindings_[index] = static_cast<GLuint>(ubo.binding());
-//   ERAY_GL_CALL( glUniformBlockBinding(program_id_, index, uniform_block_bindings_[index]) );
-//   util::Logger::debug(R"(Bound uniform block "{}" (index: {}, size: {} bytes) in shader "{}" to binding: {})", name,
-//                       index, size, shader_name_, ubo.binding());
-// }
-
-// void ShaderProgram::bind_uniform_buffer(util::zstring_view name, size_t binding) const {
-//   const GLuint index = ERAY_GL_CALL( glGetUniformBlockIndex(program_id_, name.data()) );
-//   if (index == GL_INVALID_INDEX) {
-//     log_throw(ShaderProgramValidationException(
-//         shader_name_, std::format(R"(Unable to find uniform block "{}" in shader "{}")", name, shader_name_)));
-//   }
-
-//   uniform_block_bindings_[index] = static_cast<GLuint>(binding);
-//   ERAY_GL_CALL( glUniformBlockBinding(program_id_, index, uniform_block_bindings_[index]) );
-//   util::Logger::debug(R"(Bound uniform block "{}" (index: {}) in shader "{}" to binding: {})", name, index,
-//                       shader_name_, binding);
-// }
-
 RenderingShaderProgram::RenderingShaderProgram(util::zstring_view name, GLSLShader&& vert_shader,
                                                GLSLShader&& frag_shader, std::optional<GLSLShader>&& tesc_shader,
                                                std::optional<GLSLShader>&& tese_shader,
@@ -239,6 +377,18 @@ RenderingShaderProgram::create(util::zstring_view name, GLSLShader vert_shader,
 }
 
 std::expected<void, RenderingShaderProgram::ProgramCreationError> RenderingShaderProgram::create_program() {
+  const auto shaders = std::array<const GLSLShader*, 5>{
+      &vertex_shader_,
+      &fragment_shader_,
+      tesc_shader_ ? &*tesc_shader_ : nullptr,
+      tese_shader_ ? &*tese_shader_ : nullptr,
+      geom_shader_ ? &*geom_shader_ : nullptr,
+  };
+  const auto key = binary_key(shaders);
+  if (key && load_binary(*key)) {
+    return {};
+  }
+
   TRY_UNWRAP_DEFINE(vertex_shader, create_shader(vertex_shader_, GL_VERTEX_SHADER));
   TRY_UNWRAP_DEFINE(fragment_shader, create_shader(fragment_shader_, GL_FRAGMENT_SHADER));
   ERAY_GL_CALL(glAttachShader(program_id_, vertex_shader));
@@ -279,6 +429,10 @@ std::expected<void, RenderingShaderProgram::ProgramCreationError> RenderingShade
     ERAY_GL_CALL(glDeleteShader(*geom_shader));
   }
 
+  if (key) {
+    store_binary(*key);
+  }
+
   return {};
 }
 
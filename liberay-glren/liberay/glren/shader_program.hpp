@@ -2,15 +2,47 @@
 
 #include <glad/gl.h>
 
+#include <cstdint>
+#include <liberay/glren/gl_error.hpp>
 #include <liberay/glren/glsl_shader.hpp>
 #include <liberay/math/mat.hpp>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/util/flat_hash_map.hpp>
 #include <liberay/util/string_hash.hpp>
 #include <liberay/util/zstring_view.hpp>
+#include <optional>
+#include <span>
 #include <string>
-#include <unordered_map>
+#include <type_traits>
+#include <vector>
 
 namespace eray::driver::gl {
 
+template <typename T>
+concept CUniformType =
+    std::is_same_v<T, bool> || std::is_same_v<T, int> || std::is_same_v<T, uint32_t> || std::is_same_v<T, float> ||
+    std::is_same_v<T, math::Vec2f> || std::is_same_v<T, math::Vec3f> || std::is_same_v<T, math::Vec4f> ||
+    std::is_same_v<T, math::Mat3f> || std::is_same_v<T, math::Mat4f>;
+
+class ShaderProgram;
+
+/**
+ * @brief Typed handle of a uniform, resolved once by `ShaderProgram::uniform`. The handle stays valid after the
+ * program is recompiled, the program resolves the locations again after every link.
+ *
+ */
+template <CUniformType T>
+class Uniform {
+ public:
+  Uniform() = delete;
+
+ private:
+  friend ShaderProgram;
+  explicit Uniform(uint32_t index) : index_(index) {}
+
+  uint32_t index_;
+};
+
 class ShaderProgram {
  public:
   explicit ShaderProgram(util::zstring_view name);
@@ -27,34 +59,49 @@ class ShaderProgram {
   void bind() const;
   void unbind() const;
 
+  /**
+   * @brief Enables the cache of the linked program binaries, stored in the asset cache as `res::AssetKind::Shader`.
+   * The binaries are keyed by the preprocessed sources and the driver, so an edited shader or an updated driver
+   * compiles the program again. `std::nullopt` disables the cache.
+   *
+   */
+  static void set_binary_cache(std::optional<res::AssetCache> cache);
+
   std::expected<void, ProgramCreationError> recompile();
 
-  template <typename T>
+  template <CUniformType T>
   void set_uniform(util::zstring_view name, const T& value) const {
-    GLint location = uniform_location(name);
-    if constexpr (std::is_same_v<T, bool>) {
-      ERAY_GL_CALL(glProgramUniform1i(program_id_, location, value ? 1 : 0));
-    } else if constexpr (std::is_same_v<T, int>) {
-      ERAY_GL_CALL(glProgramUniform1i(program_id_, location, value));
-    } else if constexpr (std::is_same_v<T, uint32_t>) {
-      ERAY_GL_CALL(glProgramUniform1ui(program_id_, location, value));
-    } else if constexpr (std::is_same_v<T, float>) {
-      ERAY_GL_CALL(glProgramUniform1f(program_id_, location, value));
-    } else if constexpr (std::is_same_v<T, math::Vec2f>) {
-      ERAY_GL_CALL(glProgramUniform2f(program_id_, location, value.x, value.y));
-    } else if constexpr (std::is_same_v<T, math::Vec3f>) {
-      ERAY_GL_CALL(glProgramUniform3f(program_id_, location, value.x, value.y, value.z));
-    } else if constexpr (std::is_same_v<T, math::Vec4f>) {
-      ERAY_GL_CALL(glProgramUniform4f(program_id_, location, value.x, value.y, value.z, value.w));
-    } else if constexpr (std::is_same_v<T, math::Mat3f>) {
-      ERAY_GL_CALL(glProgramUniformMatrix3fv(program_id_, location, 1, GL_FALSE, value.raw_ptr()));
-    } else if constexpr (std::is_same_v<T, math::Mat4f>) {
-      ERAY_GL_CALL(glProgramUniformMatrix4fv(program_id_, location, 1, GL_FALSE, value.raw_ptr()));
-    } else {
-      static_assert(false, "Unsupported uniform type");
-    }
+    set_uniform_at(uniform_location(name), value);
+  }
+
+  /**
+   * @brief Resolves the uniform once, so that setting it does not look up its name.
+   *
+   */
+  template <CUniformType T>
+  Uniform<T> uniform(util::zstring_view name) const {
+    return Uniform<T>(register_uniform(name));
+  }
+
+  template <CUniformType T>
+  void set_uniform(Uniform<T> uniform, const T& value) const {
+    set_uniform_at(uniform_handles_[uniform.index_].location, value);
   }
 
+  /**
+   * @brief Assigns the uniform block to the binding point, the data is then bound with `Buffer::bind_range` once for
+   * every program that uses the binding. The assignment is kept when the program is recompiled.
+   *
+   */
+  void bind_uniform_block(util::zstring_view name, GLuint binding) const;
+
+  /**
+   * @brief Assigns the shader storage block to the binding point. The assignment is kept when the program is
+   * recompiled.
+   *
+   */
+  void bind_storage_block(util::zstring_view name, GLuint binding) const;
+
  protected:
   static std::optional<std::string> shader_status(GLuint shader, GLenum type);
   static std::optional<std::string> program_status(GLuint program, GLenum type);
@@ -63,6 +110,20 @@ class ShaderProgram {
   std::expected<GLuint, ProgramCreationError> create_shader(const GLSLShader& resource, GLenum type);
   std::expected<void, ProgramCreationError> link_program();
 
+  /**
+   * @brief Key of the program binary built from the shaders, `std::nullopt` when the binaries are not cached.
+   *
+   */
+  static std::optional<res::AssetKey> binary_key(std::span<const GLSLShader* const> shaders);
+
+  /**
+   * @brief Loads the cached binary instead of compiling the shaders. Fails when the binary is missing or rejected by
+   * the driver, the program must then be compiled.
+   *
+   */
+  bool load_binary(const res::AssetKey& key);
+  void store_binary(const res::AssetKey& key) const;
+
   static constexpr util::zstring_view shader_type_name(GLenum shaderType) {
     switch (shaderType) {
       case GL_VERTEX_SHADER:
@@ -76,20 +137,54 @@ class ShaderProgram {
     }
   }
 
-  // TODO(migoox): implement shader uniform buffer binding
-  //   void bind_uniform_buffer(util::zstring_view name, const UniformBuffer& ubo) const;
-  //   void bind_uniform_buffer(util::zstring_view name, size_t binding) const;
-
  private:
+  template <CUniformType T>
+  void set_uniform_at(GLint location, const T& value) const {
+    if constexpr (std::is_same_v<T, bool>) {
+      ERAY_GL_CALL(glProgramUniform1i(program_id_, location, value ? 1 : 0));
+    } else if constexpr (std::is_same_v<T, int>) {
+      ERAY_GL_CALL(glProgramUniform1i(program_id_, location, value));
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+      ERAY_GL_CALL(glProgramUniform1ui(program_id_, location, value));
+    } else if constexpr (std::is_same_v<T, float>) {
+      ERAY_GL_CALL(glProgramUniform1f(program_id_, location, value));
+    } else if constexpr (std::is_same_v<T, math::Vec2f>) {
+      ERAY_GL_CALL(glProgramUniform2f(program_id_, location, value.x, value.y));
+    } else if constexpr (std::is_same_v<T, math::Vec3f>) {
+      ERAY_GL_CALL(glProgramUniform3f(program_id_, location, value.x, value.y, value.z));
+    } else if constexpr (std::is_same_v<T, math::Vec4f>) {
+      ERAY_GL_CALL(glProgramUniform4f(program_id_, location, value.x, value.y, value.z, value.w));
+    } else if constexpr (std::is_same_v<T, math::Mat3f>) {
+      ERAY_GL_CALL(glProgramUniformMatrix3fv(program_id_, location, 1, GL_FALSE, value.raw_ptr()));
+    } else if constexpr (std::is_same_v<T, math::Mat4f>) {
+      ERAY_GL_CALL(glProgramUniformMatrix4fv(program_id_, location, 1, GL_FALSE, value.raw_ptr()));
+    }
+  }
+
   GLint uniform_location(util::zstring_view name) const;
+  uint32_t register_uniform(util::zstring_view name) const;
+
+  /**
+   * @brief Resolves the uniform handles and the block bindings again, the linking may change them.
+   *
+   */
+  void resolve_after_link() const;
 
  protected:
   std::string shader_name_;
   GLuint program_id_;
 
  private:
-  mutable std::unordered_map<std::string, GLint, util::StringHash, std::equal_to<>> uniform_locations_;
-  mutable std::unordered_map<GLuint, GLuint> uniform_block_bindings_;
+  mutable util::FlatHashMap<std::string, GLint, util::StringHash, std::equal_to<>> uniform_locations_;
+
+  struct UniformHandle {
+    std::string name;
+    GLint location;
+  };
+  mutable std::vector<UniformHandle> uniform_handles_;
+
+  mutable util::FlatHashMap<std::string, GLuint, util::StringHash, std::equal_to<>> uniform_block_bindings_;
+  mutable util::FlatHashMap<std::string, GLuint, util::StringHash, std::equal_to<>> storage_block_bindings_;
 };
 
 class RenderingShaderProgram : public ShaderProgram {
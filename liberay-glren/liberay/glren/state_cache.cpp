@@ -0,0 +1,167 @@
+#include <glad/gl.h>
+
+#include <liberay/glren/gl_error.hpp>
+#include <liberay/glren/state_cache.hpp>
+#include <liberay/util/logger.hpp>
+
+namespace eray::driver::gl {
+
+namespace {
+
+GLint query_integer(GLenum pname) {
+  GLint value = 0;
+  ERAY_GL_CALL(glGetIntegerv(pname, &value));
+  return value;
+}
+
+bool query_enabled(GLenum cap) { return ERAY_GL_CALL_RET(glIsEnabled(cap)) == GL_TRUE; }
+
+}  // namespace
+
+template <typename T, typename Query>
+bool StateCache::update(std::optional<T>& cached, T value, Query&& query, util::zstring_view name) {
+  if (cached == value) {
+    if (!validation_enabled_) {
+      ++stats_.skipped;
+      return false;
+    }
+
+    if (const auto actual = query(); actual == value) {
+      ++stats_.skipped;
+      return false;
+    }
+    util::Logger::err("OpenGL state cache is stale: {} has been changed without the cache", name);
+  }
+
+  cached = value;
+  ++stats_.issued;
+  return true;
+}
+
+void StateCache::use_program(GLuint program) {
+  if (update(program_, program, [] { return static_cast<GLuint>(query_integer(GL_CURRENT_PROGRAM)); }, "program")) {
+    ERAY_GL_CALL(glUseProgram(program));
+  }
+}
+
+void StateCache::bind_vertex_array(GLuint vertex_array) {
+  if (update(vertex_array_, vertex_array,
+             [] { return static_cast<GLuint>(query_integer(GL_VERTEX_ARRAY_BINDING)); }, "vertex array")) {
+    ERAY_GL_CALL(glBindVertexArray(vertex_array));
+  }
+}
+
+void StateCache::bind_framebuffer(GLuint framebuffer) {
+  // The draw and the read framebuffers are bound together
+  if (update(framebuffer_, framebuffer,
+             [] {
+               const auto draw = static_cast<GLuint>(query_integer(GL_DRAW_FRAMEBUFFER_BINDING));
+               const auto read = static_cast<GLuint>(query_integer(GL_READ_FRAMEBUFFER_BINDING));
+               return draw == read ? draw : ~draw;
+             },
+             "framebuffer")) {
+    ERAY_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+  }
+}
+
+void StateCache::bind_texture_unit(GLuint unit, GLuint texture) {
+  if (unit >= kTrackedTextureUnits) {
+    ++stats_.issued;
+    ERAY_GL_CALL(glBindTextureUnit(unit, texture));
+    return;
+  }
+
+  // The texture bound to a unit is queried per target, the units are not validated
+  auto& cached = texture_units_[unit];
+  if (cached == texture) {
+    ++stats_.skipped;
+    return;
+  }
+  cached = texture;
+  ++stats_.issued;
+  ERAY_GL_CALL(glBindTextureUnit(unit, texture));
+}
+
+void StateCache::set_blend(bool enabled) {
+  if (update(blend_, enabled, [] { return query_enabled(GL_BLEND); }, "blend")) {
+    if (enabled) {
+      ERAY_GL_CALL(glEnable(GL_BLEND));
+    } else {
+      ERAY_GL_CALL(glDisable(GL_BLEND));
+    }
+  }
+}
+
+void StateCache::set_blend_func(GLenum src_factor, GLenum dst_factor) {
+  const auto query = [] {
+    return std::array{static_cast<GLenum>(query_integer(GL_BLEND_SRC_RGB)),
+                      static_cast<GLenum>(query_integer(GL_BLEND_DST_RGB))};
+  };
+  if (update(blend_func_, std::array{src_factor, dst_factor}, query, "blend func")) {
+    ERAY_GL_CALL(glBlendFunc(src_factor, dst_factor));
+  }
+}
+
+void StateCache::set_depth_test(bool enabled) {
+  if (update(depth_test_, enabled, [] { return query_enabled(GL_DEPTH_TEST); }, "depth test")) {
+    if (enabled) {
+      ERAY_GL_CALL(glEnable(GL_DEPTH_TEST));
+    } else {
+      ERAY_GL_CALL(glDisable(GL_DEPTH_TEST));
+    }
+  }
+}
+
+void StateCache::set_depth_write(bool enabled) {
+  if (update(depth_write_, enabled, [] { return query_integer(GL_DEPTH_WRITEMASK) == GL_TRUE; }, "depth write")) {
+    ERAY_GL_CALL(glDepthMask(enabled ? GL_TRUE : GL_FALSE));
+  }
+}
+
+void StateCache::set_depth_func(GLenum func) {
+  if (update(depth_func_, func, [] { return static_cast<GLenum>(query_integer(GL_DEPTH_FUNC)); }, "depth func")) {
+    ERAY_GL_CALL(glDepthFunc(func));
+  }
+}
+
+void StateCache::forget_program(GLuint program) {
+  if (program_ == program) {
+    program_.reset();
+  }
+}
+
+void StateCache::forget_vertex_array(GLuint vertex_array) {
+  if (vertex_array_ == vertex_array) {
+    vertex_array_.reset();
+  }
+}
+
+void StateCache::forget_framebuffer(GLuint framebuffer) {
+  if (framebuffer_ == framebuffer) {
+    framebuffer_.reset();
+  }
+}
+
+void StateCache::forget_texture(GLuint texture) {
+  for (auto& unit : texture_units_) {
+    if (unit == texture) {
+      unit.reset();
+    }
+  }
+}
+
+void StateCache::invalidate() {
+  program_.reset();
+  vertex_array_.reset();
+  framebuffer_.reset();
+  invalidate_texture_units();
+  blend_.reset();
+  blend_func_.reset();
+  depth_test_.reset();
+  depth_write_.reset();
+  depth_func_.reset();
+}
+
+void StateCache::invalidate_texture_units() { texture_units_.fill(std::nullopt); }
+
+}  // namespace eray::driver::gl
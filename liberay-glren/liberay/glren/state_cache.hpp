@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <array>
+#include <cstdint>
+#include <liberay/util/ruleof.hpp>
+#include <liberay/util/zstring_view.hpp>
+#include <optional>
+
+namespace eray::driver::gl {
+
+/**
+ * @brief Tracks the bound program, vertex array, framebuffer, textures and the blend and depth state of the OpenGL
+ * context, so that the binds of the state that is already set are not issued.
+ *
+ * The cache is per thread, i.e. per the context current on the thread. The state changed directly with OpenGL, e.g.
+ * by a library, makes the cache stale, `invalidate()` must be called afterwards. The deleted objects must be forgotten,
+ * their names might be reused. The validation mode compares the cache with the state queried from OpenGL before every
+ * skipped call and reports the calls that change the state behind the cache.
+ *
+ */
+class StateCache {
+ public:
+  ERAY_DELETE_COPY_AND_MOVE(StateCache)
+
+  static constexpr size_t kTrackedTextureUnits = 32;
+
+  struct Stats {
+    uint64_t issued;
+    uint64_t skipped;
+  };
+
+  static StateCache& current() {
+    thread_local StateCache cache;
+    return cache;
+  }
+
+  void use_program(GLuint program);
+  void bind_vertex_array(GLuint vertex_array);
+  void bind_framebuffer(GLuint framebuffer);
+
+  /**
+   * @brief Binds the texture with `glBindTextureUnit`, the units above `kTrackedTextureUnits` are not tracked.
+   *
+   */
+  void bind_texture_unit(GLuint unit, GLuint texture);
+
+  void set_blend(bool enabled);
+  void set_blend_func(GLenum src_factor, GLenum dst_factor);
+  void set_depth_test(bool enabled);
+  void set_depth_write(bool enabled);
+  void set_depth_func(GLenum func);
+
+  void forget_program(GLuint program);
+  void forget_vertex_array(GLuint vertex_array);
+  void forget_framebuffer(GLuint framebuffer);
+  void forget_texture(GLuint texture);
+
+  /**
+   * @brief Forgets the whole state, the next calls are issued.
+   *
+   */
+  void invalidate();
+  void invalidate_texture_units();
+
+  void set_validation_enabled(bool enabled) { validation_enabled_ = enabled; }
+  bool validation_enabled() const { return validation_enabled_; }
+
+  const Stats& stats() const { return stats_; }
+  void reset_stats() { stats_ = {}; }
+
+ private:
+  StateCache() = default;
+
+  /**
+   * @brief Returns true when the call must be issued and caches the value.
+   *
+   */
+  template <typename T, typename Query>
+  bool update(std::optional<T>& cached, T value, Query&& query, util::zstring_view name);
+
+ private:
+  std::optional<GLuint> program_;
+  std::optional<GLuint> vertex_array_;
+  std::optional<GLuint> framebuffer_;
+  std::array<std::optional<GLuint>, kTrackedTextureUnits> texture_units_{};
+
+  std::optional<bool> blend_;
+  std::optional<std::array<GLenum, 2>> blend_func_;
+  std::optional<bool> depth_test_;
+  std::optional<bool> depth_write_;
+  std::optional<GLenum> depth_func_;
+
+  Stats stats_{};
+  bool validation_enabled_ = false;
+};
+
+}  // namespace eray::driver::gl
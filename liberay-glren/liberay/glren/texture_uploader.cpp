@@ -0,0 +1,160 @@
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <iterator>
+#include <liberay/glren/gl_error.hpp>
+#include <liberay/glren/texture_uploader.hpp>
+#include <liberay/util/logger.hpp>
+#include <span>
+
+namespace eray::driver::gl {
+
+namespace {
+
+// Keeps the rows of the float formats aligned to their type, the region offsets are already aligned further
+constexpr auto kUploadAlignment = size_t{16};
+
+struct PixelTransferFormat {
+  GLenum internal_format;
+  GLenum format;
+  GLenum type;
+};
+
+PixelTransferFormat pixel_transfer_format(res::PixelFormat format, res::ColorSpace color_space) {
+  switch (format) {
+    case res::PixelFormat::R8:
+      return {.internal_format = GL_R8, .format = GL_RED, .type = GL_UNSIGNED_BYTE};
+    case res::PixelFormat::RG8:
+      return {.internal_format = GL_RG8, .format = GL_RG, .type = GL_UNSIGNED_BYTE};
+    case res::PixelFormat::RGBA8:
+      return {
+          .internal_format = color_space == res::ColorSpace::Srgb ? GLenum{GL_SRGB8_ALPHA8} : GLenum{GL_RGBA8},
+          .format          = GL_RGBA,
+          .type            = GL_UNSIGNED_BYTE,
+      };
+    case res::PixelFormat::R16:
+      return {.internal_format = GL_R16, .format = GL_RED, .type = GL_UNSIGNED_SHORT};
+    case res::PixelFormat::RGBA16F:
+      return {.internal_format = GL_RGBA16F, .format = GL_RGBA, .type = GL_HALF_FLOAT};
+    case res::PixelFormat::RGBA32F:
+      return {.internal_format = GL_RGBA32F, .format = GL_RGBA, .type = GL_FLOAT};
+  }
+  return {.internal_format = GL_RGBA8, .format = GL_RGBA, .type = GL_UNSIGNED_BYTE};
+}
+
+}  // namespace
+
+TextureUploader TextureUploader::create(size_t region_bytes_size) {
+  return TextureUploader(StreamingBuffer::create(region_bytes_size));
+}
+
+TextureHandle TextureUploader::create_texture(const res::Image& image, res::ColorSpace color_space,
+                                              bool generate_mipmaps) {
+  const auto transfer = pixel_transfer_format(image.format(), color_space);
+  const auto levels   = generate_mipmaps ? image.calculate_mip_levels() : 1U;
+
+  GLuint id = 0;
+  ERAY_GL_CALL(glCreateTextures(GL_TEXTURE_2D, 1, &id));
+  ERAY_GL_CALL(glTextureStorage2D(id, static_cast<GLsizei>(levels), transfer.internal_format,
+                                  static_cast<GLsizei>(image.width()), static_cast<GLsizei>(image.height())));
+  queue(id, image, 0, levels > 1);
+
+  return TextureHandle(id);
+}
+
+void TextureUploader::queue(GLuint texture, res::Image image, GLint level, bool generate_mipmaps) {
+  const auto lock = std::lock_guard(queue_->mutex);
+  queue_->uploads.push_back(Upload{
+      .texture          = texture,
+      .image            = std::move(image),
+      .level            = level,
+      .generate_mipmaps = generate_mipmaps,
+      .next_row         = 0,
+  });
+}
+
+bool TextureUploader::has_pending_uploads() const {
+  if (!uploads_.empty()) {
+    return true;
+  }
+
+  const auto lock = std::lock_guard(queue_->mutex);
+  return !queue_->uploads.empty();
+}
+
+void TextureUploader::update() {
+  {
+    const auto lock = std::lock_guard(queue_->mutex);
+    std::ranges::move(queue_->uploads, std::back_inserter(uploads_));
+    queue_->uploads.clear();
+  }
+  if (uploads_.empty()) {
+    return;
+  }
+
+  const auto region = ring_.next_region();
+  auto used_bytes   = size_t{0};
+
+  // The rows are tightly packed, e.g. the odd widths of the R8 images are not padded to 4 bytes
+  auto unpack_alignment = GLint{4};
+  ERAY_GL_CALL(glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_alignment));
+  ERAY_GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+  ERAY_GL_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring_.raw_gl_id()));
+
+  while (!uploads_.empty()) {
+    auto& upload         = uploads_.front();
+    const auto transfer  = pixel_transfer_format(upload.image.format(), res::ColorSpace::Linear);
+    const auto row_bytes = static_cast<size_t>(upload.image.width()) * upload.image.bytes_per_pixel();
+
+    used_bytes                = (used_bytes + kUploadAlignment - 1) / kUploadAlignment * kUploadAlignment;
+    const auto free_bytes     = used_bytes < region.size() ? region.size() - used_bytes : 0;
+    const auto remaining_rows = upload.image.height() - upload.next_row;
+    const auto rows           = static_cast<uint32_t>(std::min<size_t>(remaining_rows, free_bytes / row_bytes));
+    if (rows == 0) {
+      if (used_bytes > 0) {
+        break;
+      }
+
+      // A single row does not fit into the region, the ring would never make progress
+      util::Logger::warn("Row of {} bytes exceeds the texture upload region of {} bytes, uploading from client memory",
+                         row_bytes, region.size());
+      ERAY_GL_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+      upload_from_client_memory(upload);
+      ERAY_GL_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring_.raw_gl_id()));
+    } else {
+      const auto* src   = static_cast<const std::byte*>(upload.image.memory_region().data());
+      const auto offset = ring_.write(std::span(src + upload.next_row * row_bytes, rows * row_bytes), used_bytes);
+      used_bytes += rows * row_bytes;
+
+      ERAY_GL_CALL(glTextureSubImage2D(upload.texture, upload.level, 0, static_cast<GLint>(upload.next_row),
+                                       static_cast<GLsizei>(upload.image.width()), static_cast<GLsizei>(rows),
+                                       transfer.format, transfer.type, reinterpret_cast<const void*>(offset)));
+      upload.next_row += rows;
+      if (upload.next_row < upload.image.height()) {
+        break;
+      }
+    }
+
+    if (upload.generate_mipmaps) {
+      ERAY_GL_CALL(glGenerateTextureMipmap(upload.texture));
+    }
+    uploads_.pop_front();
+  }
+
+  ERAY_GL_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+  ERAY_GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment));
+  ring_.fence_region();
+}
+
+void TextureUploader::upload_from_client_memory(const Upload& upload) {
+  const auto transfer  = pixel_transfer_format(upload.image.format(), res::ColorSpace::Linear);
+  const auto row_bytes = static_cast<size_t>(upload.image.width()) * upload.image.bytes_per_pixel();
+  const auto* src      = static_cast<const std::byte*>(upload.image.memory_region().data());
+
+  ERAY_GL_CALL(glTextureSubImage2D(upload.texture, upload.level, 0, static_cast<GLint>(upload.next_row),
+                                   static_cast<GLsizei>(upload.image.width()),
+                                   static_cast<GLsizei>(upload.image.height() - upload.next_row), transfer.format,
+                                   transfer.type, src + upload.next_row * row_bytes));
+}
+
+}  // namespace eray::driver::gl
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <deque>
+#include <liberay/glren/buffer.hpp>
+#include <liberay/glren/gl_handle.hpp>
+#include <liberay/res/image.hpp>
+#include <liberay/util/ruleof.hpp>
+#include <memory>
+#include <mutex>
+
+namespace eray::driver::gl {
+
+/**
+ * @brief Uploads images to textures through a persistently mapped pixel unpack buffer, so that the render thread never
+ * waits for the driver to copy the pixels out of the client memory.
+ *
+ * The uploads are queued and executed by `update()` once per frame: the rows of the queued images are copied into the
+ * next region of a `StreamingBuffer` and `glTextureSubImage2D` sources them from there. A region bounds the bytes
+ * uploaded per frame, the images that do not fit are continued in the next frames.
+ *
+ * The images might be queued from any thread, e.g. straight from the callbacks of `res::Image::load_many_async()`,
+ * which decodes the files on the job system workers.
+ *
+ */
+class TextureUploader {
+ public:
+  static constexpr size_t kDefaultRegionBytesSize = 8 * 1024 * 1024;
+
+  TextureUploader() = delete;
+  ERAY_DELETE_COPY(TextureUploader)
+  ERAY_DEFAULT_MOVE(TextureUploader)
+
+  /**
+   * @brief Creates the uploader.
+   *
+   * @param region_bytes_size Bytes uploaded per frame at most.
+   * @return TextureUploader
+   */
+  static TextureUploader create(size_t region_bytes_size = kDefaultRegionBytesSize);
+
+  /**
+   * @brief Creates an immutable texture with the size and the format of the image and queues the upload of its pixels.
+   * The contents are undefined until the upload has been executed by `update()`. Render thread only.
+   *
+   * @param color_space Used by the RGBA8 images only.
+   * @param generate_mipmaps Allocates the full mip chain and generates it once the base level is uploaded.
+   * @return TextureHandle
+   */
+  TextureHandle create_texture(const res::Image& image, res::ColorSpace color_space = res::ColorSpace::Linear,
+                               bool generate_mipmaps = true);
+
+  /**
+   * @brief Queues the upload of the image into the level of the texture. Thread-safe. The decoded pixels are shared,
+   * not copied.
+   *
+   * @param texture Must have a storage matching the image and outlive the upload.
+   * @param image
+   * @param level
+   * @param generate_mipmaps Generates the levels below `level` once it is uploaded.
+   */
+  void queue(GLuint texture, res::Image image, GLint level = 0, bool generate_mipmaps = false);
+
+  /**
+   * @brief Executes the queued uploads that fit into the next region of the ring. Must be called once per frame on the
+   * render thread.
+   *
+   */
+  void update();
+
+  /**
+   * @brief Render thread only.
+   *
+   */
+  bool has_pending_uploads() const;
+
+ private:
+  struct Upload {
+    GLuint texture;
+    res::Image image;
+    GLint level;
+    bool generate_mipmaps;
+    uint32_t next_row;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Upload> uploads;
+  };
+
+  explicit TextureUploader(StreamingBuffer&& ring) : ring_(std::move(ring)), queue_(std::make_unique<Queue>()) {}
+
+  /**
+   * @brief Uploads the remaining rows of the image straight from the client memory.
+   *
+   */
+  static void upload_from_client_memory(const Upload& upload);
+
+ private:
+  StreamingBuffer ring_;
+  std::unique_ptr<Queue> queue_;
+
+  /**
+   * @brief Uploads taken from the queue, in progress. Render thread only.
+   *
+   */
+  std::deque<Upload> uploads_;
+};
+
+}  // namespace eray::driver::gl
@@ -3,7 +3,9 @@
 #include <liberay/glren/buffer.hpp>
 #include <liberay/glren/gl_error.hpp>
 #include <liberay/glren/gl_handle.hpp>
+#include <liberay/glren/state_cache.hpp>
 #include <liberay/glren/vertex_array.hpp>
+#include <liberay/util/hash_combine.hpp>
 #include <liberay/util/zstring_view.hpp>
 
 namespace eray::driver::gl {
@@ -55,7 +57,10 @@ VertexArray& VertexArray::operator=(VertexArray&& other) noexcept {
   return *this;
 }
 
-VertexArray::~VertexArray() { ERAY_GL_CALL(glDeleteVertexArrays(1, &m_.id)); }
+VertexArray::~VertexArray() {
+  StateCache::current().forget_vertex_array(m_.id);
+  ERAY_GL_CALL(glDeleteVertexArrays(1, &m_.id));
+}
 
 // -- SimpleVertexArray ------------------------------------------------------------------------------------------------
 
@@ -134,6 +139,10 @@ void VertexArrays::set_binding_divisor(util::zstring_view name, GLuint divisor)
   ERAY_GL_CALL(glVertexArrayBindingDivisor(m_.id, m_.vbos_binding_ind.at(name), divisor));
 }
 
+void VertexArrays::set_binding_divisor(GLuint binding_index, GLuint divisor) {  // NOLINT
+  ERAY_GL_CALL(glVertexArrayBindingDivisor(m_.id, binding_index, divisor));
+}
+
 VertexArrays::VertexArrays(VertexArrays&& other) noexcept : m_(std::move(other.m_)) { other.m_.id = 0; }
 
 VertexArrays& VertexArrays::operator=(VertexArrays&& other) noexcept {
@@ -143,6 +152,138 @@ VertexArrays& VertexArrays::operator=(VertexArrays&& other) noexcept {
   return *this;
 }
 
-VertexArrays::~VertexArrays() { ERAY_GL_CALL(glDeleteVertexArrays(1, &m_.id)); }
+VertexArrays::~VertexArrays() {
+  StateCache::current().forget_vertex_array(m_.id);
+  ERAY_GL_CALL(glDeleteVertexArrays(1, &m_.id));
+}
+
+// -- VertexFormatCache -----------------------------------------------------------------------------------------------
+
+VertexFormatKey VertexFormatKey::from_layout(const VertexBuffer::Layout& layout) {
+  auto key = VertexFormatKey{
+      .attributes = {},
+      .stride     = static_cast<GLsizei>(layout.bytes_size()),
+  };
+  for (const auto& attrib : layout) {
+    key.attributes.push_back(Attribute{
+        .location     = static_cast<GLuint>(attrib.location),
+        .count        = static_cast<GLint>(attrib.count),
+        .type         = attrib.type,
+        .normalize    = attrib.normalize,
+        .bytes_offset = static_cast<GLuint>(attrib.bytes_offset),
+    });
+  }
+
+  return key;
+}
+
+size_t VertexFormatKeyHash::operator()(const VertexFormatKey& key) const {
+  auto seed = std::hash<GLsizei>{}(key.stride);
+  for (const auto& attrib : key.attributes) {
+    util::hash_combine(seed, attrib.location);
+    util::hash_combine(seed, attrib.count);
+    util::hash_combine(seed, attrib.type);
+    util::hash_combine(seed, attrib.normalize);
+    util::hash_combine(seed, attrib.bytes_offset);
+  }
+
+  return seed;
+}
+
+uint32_t VertexFormatCache::vertex_array(const VertexBuffer::Layout& layout) {
+  auto key = VertexFormatKey::from_layout(layout);
+  if (auto it = indices_.find(key); it != indices_.end()) {
+    return it->second;
+  }
+
+  GLuint id = 0;
+  ERAY_GL_CALL(glCreateVertexArrays(1, &id));
+  for (const auto& attrib : key.attributes) {
+    ERAY_GL_CALL(glEnableVertexArrayAttrib(id, attrib.location));
+    ERAY_GL_CALL(glVertexArrayAttribFormat(id,                                     //
+                                           attrib.location,                        //
+                                           attrib.count,                           //
+                                           attrib.type,                            //
+                                           attrib.normalize ? GL_TRUE : GL_FALSE,  //
+                                           attrib.bytes_offset));                  //
+    ERAY_GL_CALL(glVertexArrayAttribBinding(id, attrib.location, 0));
+  }
+
+  const auto index = static_cast<uint32_t>(vertex_arrays_.size());
+  vertex_arrays_.push_back(Entry{.id = id, .stride = key.stride, .vbo = 0, .ebo = 0});
+  indices_.try_emplace(std::move(key), index);
+
+  return index;
+}
+
+void VertexFormatCache::bind(uint32_t vertex_array, GLuint vbo, GLuint ebo) {
+  auto& entry = vertex_arrays_[vertex_array];
+  if (entry.vbo != vbo) {
+    ERAY_GL_CALL(glVertexArrayVertexBuffer(entry.id, 0, vbo, 0, entry.stride));
+    entry.vbo = vbo;
+  }
+  if (entry.ebo != ebo) {
+    ERAY_GL_CALL(glVertexArrayElementBuffer(entry.id, ebo));
+    entry.ebo = ebo;
+  }
+  StateCache::current().bind_vertex_array(entry.id);
+}
+
+void VertexFormatCache::forget_buffer(GLuint buffer) {
+  for (auto& entry : vertex_arrays_) {
+    if (entry.vbo == buffer) {
+      ERAY_GL_CALL(glVertexArrayVertexBuffer(entry.id, 0, 0, 0, entry.stride));
+      entry.vbo = 0;
+    }
+    if (entry.ebo == buffer) {
+      ERAY_GL_CALL(glVertexArrayElementBuffer(entry.id, 0));
+      entry.ebo = 0;
+    }
+  }
+}
+
+void VertexFormatCache::clear() {
+  for (const auto& entry : vertex_arrays_) {
+    StateCache::current().forget_vertex_array(entry.id);
+    ERAY_GL_CALL(glDeleteVertexArrays(1, &entry.id));
+  }
+  vertex_arrays_.clear();
+  indices_.clear();
+}
+
+// -- SharedVertexArray -----------------------------------------------------------------------------------------------
+
+SharedVertexArray SharedVertexArray::create(VertexBuffer&& vert_buff, ElementBuffer&& ebo_buff) {
+  const auto vertex_array = VertexFormatCache::current().vertex_array(vert_buff.layout());
+  return SharedVertexArray({
+      .vbo          = std::move(vert_buff),
+      .ebo          = std::move(ebo_buff),
+      .vertex_array = vertex_array,
+  });
+}
+
+SharedVertexArray& SharedVertexArray::operator=(SharedVertexArray&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  release();
+  m_ = std::move(other.m_);
+
+  return *this;
+}
+
+SharedVertexArray::~SharedVertexArray() { release(); }
+
+void SharedVertexArray::release() {
+  // The buffers are deleted with the members, their names must not stay attached to the shared vertex array
+  auto& cache = VertexFormatCache::current();
+  if (m_.vbo.raw_gl_id() != 0) {
+    cache.forget_buffer(m_.vbo.raw_gl_id());
+  }
+  if (m_.ebo.raw_gl_id() != 0) {
+    cache.forget_buffer(m_.ebo.raw_gl_id());
+  }
+}
 
 }  // namespace eray::driver::gl
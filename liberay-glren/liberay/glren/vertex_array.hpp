@@ -3,9 +3,12 @@
 
 #include <liberay/glren/buffer.hpp>
 #include <liberay/glren/gl_handle.hpp>
+#include <liberay/glren/state_cache.hpp>
+#include <liberay/util/flat_hash_map.hpp>
 #include <liberay/util/ruleof.hpp>
 #include <liberay/util/zstring_view.hpp>
 #include <unordered_map>
+#include <vector>
 
 namespace eray::driver::gl {
 
@@ -24,9 +27,9 @@ class VertexArray {
    * class uses DSA (Direct State Access).
    *
    */
-  void bind() const { ERAY_GL_CALL(glBindVertexArray(m_.id)); }
+  void bind() const { StateCache::current().bind_vertex_array(m_.id); }
 
-  static void unbind() { ERAY_GL_CALL(glBindVertexArray(0)); }
+  static void unbind() { StateCache::current().bind_vertex_array(0); }
 
   void set_binding_divisor(GLuint divisor);
 
@@ -64,9 +67,9 @@ class SimpleVertexArray {
    * class uses DSA (Direct State Access).
    *
    */
-  void bind() const { ERAY_GL_CALL(glBindVertexArray(m_.id.get())); }
+  void bind() const { StateCache::current().bind_vertex_array(m_.id.get()); }
 
-  static void unbind() { ERAY_GL_CALL(glBindVertexArray(0)); }
+  static void unbind() { StateCache::current().bind_vertex_array(0); }
 
   void set_binding_divisor(GLuint divisor);
 
@@ -102,12 +105,21 @@ class VertexArrays {
    * class uses DSA (Direct State Access).
    *
    */
-  void bind() const { ERAY_GL_CALL(glBindVertexArray(m_.id)); }
+  void bind() const { StateCache::current().bind_vertex_array(m_.id); }
 
-  static void unbind() { ERAY_GL_CALL(glBindVertexArray(0)); }
+  static void unbind() { StateCache::current().bind_vertex_array(0); }
 
   void set_binding_divisor(util::zstring_view name, GLuint divisor);
 
+  /**
+   * @brief Same as the by name overload, without the name lookup. The binding index is obtained once with
+   * `binding_index()`.
+   *
+   */
+  void set_binding_divisor(GLuint binding_index, GLuint divisor);
+
+  GLuint binding_index(util::zstring_view name) const { return m_.vbos_binding_ind.at(name); }
+
   const VertexBuffer& vbo(util::zstring_view name) const { return m_.vbos.at(name); }
   VertexBuffer& vbo(util::zstring_view name) { return m_.vbos.at(name); }
 
@@ -127,4 +139,137 @@ class VertexArrays {
   Members m_;
 };
 
+/**
+ * @brief Vertex format of a vertex array with a single vertex buffer binding.
+ *
+ */
+struct VertexFormatKey {
+  struct Attribute {
+    GLuint location;
+    GLint count;
+    GLenum type;
+    bool normalize;
+    GLuint bytes_offset;
+
+    bool operator==(const Attribute&) const = default;
+  };
+
+  std::vector<Attribute> attributes;
+  GLsizei stride;
+
+  static VertexFormatKey from_layout(const VertexBuffer::Layout& layout);
+
+  bool operator==(const VertexFormatKey&) const = default;
+};
+
+struct VertexFormatKeyHash {
+  size_t operator()(const VertexFormatKey& key) const;
+};
+
+/**
+ * @brief Vertex arrays shared by the meshes whose vertex buffers have the same layout. The vertex format is specified
+ * once per layout, switching between the meshes of the same layout only reattaches the vertex and element buffers
+ * with `glVertexArrayVertexBuffer` and `glVertexArrayElementBuffer` instead of binding another vertex array. The
+ * attachments that are already in place are skipped.
+ *
+ * The cache is per thread, i.e. per the context current on the thread, like the `StateCache`. The vertex arrays must
+ * be deleted with `clear()` before the context is destroyed.
+ *
+ */
+class VertexFormatCache {
+ public:
+  ERAY_DELETE_COPY_AND_MOVE(VertexFormatCache)
+
+  static VertexFormatCache& current() {
+    thread_local VertexFormatCache cache;
+    return cache;
+  }
+
+  /**
+   * @brief Returns the index of the vertex array of the layout, the vertex array is created on the first use.
+   *
+   */
+  uint32_t vertex_array(const VertexBuffer::Layout& layout);
+
+  /**
+   * @brief Binds the vertex array and attaches the buffers to it.
+   *
+   * @param vertex_array Index returned by `vertex_array()`.
+   * @param vbo Attached to the binding 0.
+   * @param ebo Might be 0.
+   */
+  void bind(uint32_t vertex_array, GLuint vbo, GLuint ebo);
+
+  /**
+   * @brief Detaches the buffer from all of the vertex arrays, must be called before the buffer is deleted, as its name
+   * might be reused.
+   *
+   */
+  void forget_buffer(GLuint buffer);
+
+  size_t size() const { return vertex_arrays_.size(); }
+
+  /**
+   * @brief Deletes all of the vertex arrays, the indices returned before are invalidated.
+   *
+   */
+  void clear();
+
+ private:
+  VertexFormatCache() = default;
+
+  struct Entry {
+    GLuint id;
+    GLsizei stride;
+    GLuint vbo;
+    GLuint ebo;
+  };
+
+ private:
+  util::FlatHashMap<VertexFormatKey, uint32_t, VertexFormatKeyHash> indices_;
+  std::vector<Entry> vertex_arrays_;
+};
+
+/**
+ * @brief Vertex and element buffers drawn with the vertex array shared by all of the meshes of the same layout, see
+ * `VertexFormatCache`. Cheaper to switch between than `VertexArray` when many small meshes are drawn.
+ *
+ */
+class SharedVertexArray {
+ public:
+  SharedVertexArray() = delete;
+  ERAY_DELETE_COPY(SharedVertexArray)
+
+  SharedVertexArray(SharedVertexArray&& other) noexcept = default;
+  SharedVertexArray& operator=(SharedVertexArray&& other) noexcept;
+  ~SharedVertexArray();
+
+  static SharedVertexArray create(VertexBuffer&& vert_buff, ElementBuffer&& ebo_buff);
+
+  /**
+   * @brief Binds the shared vertex array with the buffers of this mesh attached.
+   *
+   */
+  void bind() const { VertexFormatCache::current().bind(m_.vertex_array, m_.vbo.raw_gl_id(), m_.ebo.raw_gl_id()); }
+
+  const VertexBuffer& vbo() const { return m_.vbo; }
+  VertexBuffer& vbo() { return m_.vbo; }
+
+  const ElementBuffer& ebo() const { return m_.ebo; }
+  ElementBuffer& ebo() { return m_.ebo; }
+
+ private:
+  struct Members {
+    VertexBuffer vbo;
+    ElementBuffer ebo;
+    uint32_t vertex_array;
+  };
+  explicit SharedVertexArray(Members&& m) : m_(std::move(m)) {}
+
+  void release();
+
+ private:
+  Members m_;
+};
+
 }  // namespace eray::driver::gl
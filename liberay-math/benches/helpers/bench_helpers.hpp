@@ -0,0 +1,54 @@
+#pragma once
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/quat.hpp>
+#include <liberay/math/simd.hpp>
+#include <liberay/math/vec.hpp>
+#include <random>
+#include <vector>
+
+namespace eray::math::bench {
+
+// Number of the elements the single operation benchmarks cycle through, small enough to stay in the L1 cache
+constexpr std::size_t kElementCount = 256;
+
+// Labels the results with the backend, `liberay-math_bench` uses the SIMD backend and `liberay-math_bench-scalar` the
+// generic code, so the rows of the two executables can be compared side by side.
+inline void label_backend(benchmark::State& state) { state.SetLabel(simd::kEnabled ? "simd" : "scalar"); }
+
+inline std::mt19937& rng() {
+  static auto engine = std::mt19937(42);
+  return engine;
+}
+
+inline float random_float(float min = -1.F, float max = 1.F) {
+  return std::uniform_real_distribution<float>(min, max)(rng());
+}
+
+inline Vec3f random_vec3() { return Vec3f(random_float(), random_float(), random_float()); }
+
+inline Vec4f random_vec4() { return Vec4f(random_float(), random_float(), random_float(), random_float()); }
+
+inline Quatf random_unit_quat() {
+  return Quatf(random_float(), random_float(), random_float(), random_float() + 2.F).normalized();
+}
+
+// Translation, rotation and non-uniform scale, i.e. an invertible affine matrix
+inline Mat4f random_affine_mat() {
+  return translation(random_vec3()) * rot_mat_from_quat(random_unit_quat()) *
+         scale(Vec3f(random_float(0.5F, 2.F), random_float(0.5F, 2.F), random_float(0.5F, 2.F)));
+}
+
+template <typename T, typename TGenerator>
+std::vector<T> random_vector(std::size_t count, TGenerator&& generator) {
+  auto result = std::vector<T>();
+  result.reserve(count);
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    result.push_back(generator());
+  }
+  return result;
+}
+
+}  // namespace eray::math::bench
@@ -0,0 +1,184 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/bench_helpers.hpp>
+#include <liberay/math/batch.hpp>
+
+using namespace eray::math;        // NOLINT
+using namespace eray::math::bench;  // NOLINT
+
+// Every batch kernel is measured next to the loop of the single element operations it replaces
+
+namespace {
+
+void batch_args(benchmark::internal::Benchmark* bench) { bench->RangeMultiplier(8)->Range(64, 1 << 15); }
+
+void finish(benchmark::State& state) {
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  label_backend(state);
+}
+
+}  // namespace
+
+static void BM_TransformPointsLoop(benchmark::State& state) {
+  const auto mat    = random_affine_mat();
+  const auto points = random_vector<Vec3f>(static_cast<std::size_t>(state.range(0)), random_vec3);
+  auto out          = std::vector<Vec3f>(points.size());
+  for (auto _ : state) {
+    for (auto i = std::size_t{0}; i < points.size(); ++i) {
+      out[i] = Vec3f(mat * Vec4f(points[i], 1.F));
+    }
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_TransformPointsLoop)->Apply(batch_args);
+
+static void BM_TransformPoints(benchmark::State& state) {
+  const auto mat    = random_affine_mat();
+  const auto points = random_vector<Vec3f>(static_cast<std::size_t>(state.range(0)), random_vec3);
+  auto out          = std::vector<Vec3f>(points.size());
+  for (auto _ : state) {
+    transform_points(mat, points, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_TransformPoints)->Apply(batch_args);
+
+static void BM_TransformVectorsLoop(benchmark::State& state) {
+  const auto mat  = random_affine_mat();
+  const auto vecs = random_vector<Vec4f>(static_cast<std::size_t>(state.range(0)), random_vec4);
+  auto out        = std::vector<Vec4f>(vecs.size());
+  for (auto _ : state) {
+    for (auto i = std::size_t{0}; i < vecs.size(); ++i) {
+      out[i] = mat * vecs[i];
+    }
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_TransformVectorsLoop)->Apply(batch_args);
+
+static void BM_TransformVectors(benchmark::State& state) {
+  const auto mat  = random_affine_mat();
+  const auto vecs = random_vector<Vec4f>(static_cast<std::size_t>(state.range(0)), random_vec4);
+  auto out        = std::vector<Vec4f>(vecs.size());
+  for (auto _ : state) {
+    transform_vectors(mat, vecs, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_TransformVectors)->Apply(batch_args);
+
+static void BM_MultiplyManyLoop(benchmark::State& state) {
+  const auto parent = random_affine_mat();
+  const auto locals = random_vector<Mat4f>(static_cast<std::size_t>(state.range(0)), random_affine_mat);
+  auto out          = std::vector<Mat4f>(locals.size());
+  for (auto _ : state) {
+    for (auto i = std::size_t{0}; i < locals.size(); ++i) {
+      out[i] = parent * locals[i];
+    }
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_MultiplyManyLoop)->Apply(batch_args);
+
+static void BM_MultiplyMany(benchmark::State& state) {
+  const auto parent = random_affine_mat();
+  const auto locals = random_vector<Mat4f>(static_cast<std::size_t>(state.range(0)), random_affine_mat);
+  auto out          = std::vector<Mat4f>(locals.size());
+  for (auto _ : state) {
+    multiply_many(parent, locals, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_MultiplyMany)->Apply(batch_args);
+
+static void BM_SlerpLoop(benchmark::State& state) {
+  const auto start = random_vector<Quatf>(static_cast<std::size_t>(state.range(0)), random_unit_quat);
+  const auto end   = random_vector<Quatf>(start.size(), random_unit_quat);
+  auto out         = std::vector<Quatf>(start.size());
+  for (auto _ : state) {
+    for (auto i = std::size_t{0}; i < start.size(); ++i) {
+      out[i] = slerp_quat(start[i], end[i], 0.3F);
+    }
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_SlerpLoop)->Apply(batch_args);
+
+static void BM_SlerpMany(benchmark::State& state) {
+  const auto start = random_vector<Quatf>(static_cast<std::size_t>(state.range(0)), random_unit_quat);
+  const auto end   = random_vector<Quatf>(start.size(), random_unit_quat);
+  auto out         = std::vector<Quatf>(start.size());
+  for (auto _ : state) {
+    slerp_many(start, end, 0.3F, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_SlerpMany)->Apply(batch_args);
+
+static void BM_NlerpMany(benchmark::State& state) {
+  const auto start = random_vector<Quatf>(static_cast<std::size_t>(state.range(0)), random_unit_quat);
+  const auto end   = random_vector<Quatf>(start.size(), random_unit_quat);
+  auto out         = std::vector<Quatf>(start.size());
+  for (auto _ : state) {
+    nlerp_many(start, end, 0.3F, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_NlerpMany)->Apply(batch_args);
+
+static void BM_MultiplyQuatsMany(benchmark::State& state) {
+  const auto lhs = random_vector<Quatf>(static_cast<std::size_t>(state.range(0)), random_unit_quat);
+  const auto rhs = random_vector<Quatf>(lhs.size(), random_unit_quat);
+  auto out       = std::vector<Quatf>(lhs.size());
+  for (auto _ : state) {
+    multiply_many(lhs, rhs, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_MultiplyQuatsMany)->Apply(batch_args);
+
+static void BM_RotMatsFromQuatsLoop(benchmark::State& state) {
+  const auto quats = random_vector<Quatf>(static_cast<std::size_t>(state.range(0)), random_unit_quat);
+  auto out         = std::vector<Mat4f>(quats.size());
+  for (auto _ : state) {
+    for (auto i = std::size_t{0}; i < quats.size(); ++i) {
+      out[i] = rot_mat_from_quat(quats[i]);
+    }
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_RotMatsFromQuatsLoop)->Apply(batch_args);
+
+static void BM_RotMatsFromQuats(benchmark::State& state) {
+  const auto quats = random_vector<Quatf>(static_cast<std::size_t>(state.range(0)), random_unit_quat);
+  auto out         = std::vector<Mat4f>(quats.size());
+  for (auto _ : state) {
+    rot_mats_from_quats(quats, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  finish(state);
+}
+BENCHMARK(BM_RotMatsFromQuats)->Apply(batch_args);
@@ -0,0 +1,120 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/bench_helpers.hpp>
+#include <cmath>
+#include <liberay/math/fast_math.hpp>
+
+using namespace eray::math;        // NOLINT
+using namespace eray::math::bench;  // NOLINT
+
+// Every approximation is measured next to the standard function it replaces
+
+static void BM_StdSin(benchmark::State& state) {
+  const auto values = random_vector<float>(kElementCount, [] { return random_float(-10.F, 10.F); });
+  auto i            = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::sin(values[i]));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_StdSin);
+
+static void BM_FastSin(benchmark::State& state) {
+  const auto values = random_vector<float>(kElementCount, [] { return random_float(-10.F, 10.F); });
+  auto i            = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fast_sin(values[i]));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_FastSin);
+
+static void BM_FastSinMany(benchmark::State& state) {
+  const auto values = random_vector<float>(kElementCount, [] { return random_float(-10.F, 10.F); });
+  auto out          = std::vector<float>(values.size());
+  for (auto _ : state) {
+    fast_sin_many(values, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kElementCount));
+  label_backend(state);
+}
+BENCHMARK(BM_FastSinMany);
+
+static void BM_StdAtan2(benchmark::State& state) {
+  const auto vecs = random_vector<Vec3f>(kElementCount, random_vec3);
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::atan2(vecs[i].y(), vecs[i].x()));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_StdAtan2);
+
+static void BM_FastAtan2(benchmark::State& state) {
+  const auto vecs = random_vector<Vec3f>(kElementCount, random_vec3);
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fast_atan2(vecs[i].y(), vecs[i].x()));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_FastAtan2);
+
+static void BM_Vec3Normalize(benchmark::State& state) {
+  const auto vecs = random_vector<Vec3f>(kElementCount, random_vec3);
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(vecs[i].normalized());
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Vec3Normalize);
+
+static void BM_Vec3FastNormalize(benchmark::State& state) {
+  const auto vecs = random_vector<Vec3f>(kElementCount, random_vec3);
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fast_normalize(vecs[i]));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Vec3FastNormalize);
+
+static void BM_Vec3FastNormalizeMany(benchmark::State& state) {
+  const auto vecs = random_vector<Vec3f>(kElementCount, random_vec3);
+  auto out        = std::vector<Vec3f>(vecs.size());
+  for (auto _ : state) {
+    fast_normalize_many<3>(vecs, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kElementCount));
+  label_backend(state);
+}
+BENCHMARK(BM_Vec3FastNormalizeMany);
+
+static void BM_QuatFastSlerp(benchmark::State& state) {
+  const auto quats = random_vector<Quatf>(kElementCount, random_unit_quat);
+  auto i           = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fast_slerp_quat(quats[i], quats[(i + 1) % kElementCount], 0.3F));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_QuatFastSlerp);
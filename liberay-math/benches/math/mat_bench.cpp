@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/bench_helpers.hpp>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/vec.hpp>
+
+using namespace eray::math;        // NOLINT
+using namespace eray::math::bench;  // NOLINT
+
+// Every iteration takes the next operands of the precomputed arrays, so the results cannot be folded away
+
+static void BM_Mat4MultMat4(benchmark::State& state) {
+  const auto lhs = random_vector<Mat4f>(kElementCount, random_affine_mat);
+  const auto rhs = random_vector<Mat4f>(kElementCount, random_affine_mat);
+  auto i         = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lhs[i] * rhs[i]);
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Mat4MultMat4);
+
+static void BM_Mat4MultVec4(benchmark::State& state) {
+  const auto mats = random_vector<Mat4f>(kElementCount, random_affine_mat);
+  const auto vecs = random_vector<Vec4f>(kElementCount, random_vec4);
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mats[i] * vecs[i]);
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Mat4MultVec4);
+
+static void BM_Vec4MultMat4(benchmark::State& state) {
+  const auto mats = random_vector<Mat4f>(kElementCount, random_affine_mat);
+  const auto vecs = random_vector<Vec4f>(kElementCount, random_vec4);
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(vecs[i] * mats[i]);
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Vec4MultMat4);
+
+static void BM_Vec4DotAndNormalize(benchmark::State& state) {
+  const auto vecs = random_vector<Vec4f>(kElementCount, random_vec4);
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dot(vecs[i], vecs[(i + 1) % kElementCount]));
+    benchmark::DoNotOptimize(vecs[i].normalized());
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Vec4DotAndNormalize);
+
+static void BM_Mat4Inverse(benchmark::State& state) {
+  const auto mats = random_vector<Mat4f>(kElementCount, random_affine_mat);
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(inverse(mats[i]));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Mat4Inverse);
+
+static void BM_Mat4InverseAffine(benchmark::State& state) {
+  const auto mats = random_vector<Mat4f>(kElementCount, random_affine_mat);
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(inverse_affine(mats[i]));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Mat4InverseAffine);
+
+static void BM_Mat4InverseRigid(benchmark::State& state) {
+  const auto mats = random_vector<Mat4f>(
+      kElementCount, [] { return translation(random_vec3()) * rot_mat_from_quat(random_unit_quat()); });
+  auto i = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(inverse_rigid(mats[i]));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Mat4InverseRigid);
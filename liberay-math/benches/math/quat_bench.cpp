@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/bench_helpers.hpp>
+#include <liberay/math/quat.hpp>
+
+using namespace eray::math;        // NOLINT
+using namespace eray::math::bench;  // NOLINT
+
+static void BM_QuatMult(benchmark::State& state) {
+  const auto quats = random_vector<Quatf>(kElementCount, random_unit_quat);
+  auto i           = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(quats[i] * quats[(i + 1) % kElementCount]);
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_QuatMult);
+
+static void BM_QuatNormalize(benchmark::State& state) {
+  const auto quats = random_vector<Quatf>(kElementCount, [] { return random_unit_quat() * 3.F; });
+  auto i           = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(quats[i].normalized());
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_QuatNormalize);
+
+static void BM_QuatRotateVec3(benchmark::State& state) {
+  const auto quats = random_vector<Quatf>(kElementCount, random_unit_quat);
+  const auto vecs  = random_vector<Vec3f>(kElementCount, random_vec3);
+  auto i           = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(quats[i] * vecs[i]);
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_QuatRotateVec3);
+
+static void BM_QuatLerp(benchmark::State& state) {
+  const auto quats = random_vector<Quatf>(kElementCount, random_unit_quat);
+  auto i           = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lerp_quat(quats[i], quats[(i + 1) % kElementCount], 0.3F));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_QuatLerp);
+
+static void BM_QuatSlerp(benchmark::State& state) {
+  const auto quats = random_vector<Quatf>(kElementCount, random_unit_quat);
+  auto i           = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(slerp_quat(quats[i], quats[(i + 1) % kElementCount], 0.3F));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_QuatSlerp);
+
+static void BM_QuatToMat4(benchmark::State& state) {
+  const auto quats = random_vector<Quatf>(kElementCount, random_unit_quat);
+  auto i           = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(rot_mat_from_quat(quats[i]));
+    i = (i + 1) % kElementCount;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_QuatToMat4);
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/bench_helpers.hpp>
+#include <liberay/math/transform3.hpp>
+#include <vector>
+
+using namespace eray::math;        // NOLINT
+using namespace eray::math::bench;  // NOLINT
+
+namespace {
+
+// Chain of `depth` transforms, every one the parent of the next one. The vector is never reallocated, the transforms
+// keep references to each other.
+std::vector<Transform3f> make_chain(std::size_t depth) {
+  auto chain = std::vector<Transform3f>();
+  chain.reserve(depth);
+  for (auto i = std::size_t{0}; i < depth; ++i) {
+    chain.emplace_back(random_vec3(), random_unit_quat(), Vec3f::filled(random_float(0.5F, 2.F)));
+    if (i > 0) {
+      chain[i].set_parent(chain[i - 1]);
+    }
+  }
+  return chain;
+}
+
+}  // namespace
+
+// Moves the root and reads the leaf world matrix, i.e. the whole chain is recomposed
+static void BM_Transform3ChainUpdate(benchmark::State& state) {
+  auto chain = make_chain(static_cast<std::size_t>(state.range(0)));
+  auto delta = 1e-3F;
+  for (auto _ : state) {
+    chain.front().move(Vec3f(delta, 0.F, 0.F));
+    benchmark::DoNotOptimize(chain.back().local_to_world_matrix());
+    delta = -delta;
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  label_backend(state);
+}
+BENCHMARK(BM_Transform3ChainUpdate)->Arg(1)->Arg(8)->Arg(32);
+
+// Same as above, but with the inverse world matrix
+static void BM_Transform3ChainInverseUpdate(benchmark::State& state) {
+  auto chain = make_chain(static_cast<std::size_t>(state.range(0)));
+  auto delta = 1e-3F;
+  for (auto _ : state) {
+    chain.front().rotate(delta, Vec3f(0.F, 1.F, 0.F));
+    benchmark::DoNotOptimize(chain.back().world_to_local_matrix());
+    delta = -delta;
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  label_backend(state);
+}
+BENCHMARK(BM_Transform3ChainInverseUpdate)->Arg(1)->Arg(8)->Arg(32);
+
+// Moves the root of a wide hierarchy and reads a single child, the other children are only invalidated
+static void BM_Transform3WideEdit(benchmark::State& state) {
+  auto root     = Transform3f();
+  auto children = std::vector<Transform3f>();
+  children.reserve(static_cast<std::size_t>(state.range(0)));
+  for (auto i = 0; i < state.range(0); ++i) {
+    children.emplace_back(random_vec3());
+    children.back().local_set_parent(root);
+  }
+
+  auto delta = 1e-3F;
+  for (auto _ : state) {
+    root.move(Vec3f(delta, 0.F, 0.F));
+    benchmark::DoNotOptimize(children.front().local_to_world_matrix());
+    delta = -delta;
+  }
+  state.SetItemsProcessed(state.iterations());
+  label_backend(state);
+}
+BENCHMARK(BM_Transform3WideEdit)->Arg(16)->Arg(1024);
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/bounds.hpp>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/quat.hpp>
+#include <liberay/math/simd.hpp>
+#include <liberay/math/vec.hpp>
+#include <span>
+#include <vector>
+
+// Transforms of whole arrays, e.g. of point clouds, bounding box corners or line strip vertices. The loops keep the
+// matrix in the registers and, with the `simd` backend, the 3D vectors are processed 4 at a time. The elements past the
+// last full group of 4 are transformed one by one, the quaternion kernels pad them to a group instead. The output may
+// alias the input (in place transform), other overlaps are not allowed.
+
+namespace eray::math {
+
+namespace internal {
+
+static_assert(sizeof(Vec3f) == 3 * sizeof(float), "The batches read the 3D vectors as packed floats");
+
+inline void transform_vec3_many(const Mat4f& mat, std::span<const Vec3f> vecs, std::span<Vec3f> out, float w) {
+  assert(out.size() >= vecs.size() && "Output must fit all of the vectors");
+
+  auto i = std::size_t{0};
+  if constexpr (simd::kEnabled) {
+    for (; i + 4 <= vecs.size(); i += 4) {
+      simd::mat4_transform_vec3x4(mat.raw_ptr(), vecs[i].data, w, out[i].data);
+    }
+  }
+
+  for (; i < vecs.size(); ++i) {
+    out[i] = Vec3f(mat * Vec4f(vecs[i], w));
+  }
+}
+
+inline float* floats_of(Quatf& quat) { return &quat.w; }
+inline float* floats_of(Mat4f& mat) { return mat.raw_ptr(); }
+
+/**
+ * @brief Runs `kernel(inputs, out)` on the groups of 4 quaternions, where `inputs` are the pointers to the group of
+ * every input span. The tail shorter than a group goes through buffers padded with identities, so the whole batch
+ * takes the same path.
+ *
+ */
+template <std::size_t kInputs, typename TOut, typename TKernel>
+void for_each_quat_group(const std::array<std::span<const Quatf>, kInputs>& inputs, std::span<TOut> out,
+                         TKernel&& kernel) {
+  const auto count = inputs[0].size();
+  for (const auto& input : inputs) {
+    assert(input.size() == count && "Inputs must have the same length");
+  }
+  assert(out.size() >= count && "Output must fit all of the results");
+
+  auto group = std::array<const float*, kInputs>();
+  auto i     = std::size_t{0};
+  for (; i + 4 <= count; i += 4) {
+    for (auto k = 0U; k < kInputs; ++k) {
+      group[k] = &inputs[k][i].w;
+    }
+    kernel(group, floats_of(out[i]));
+  }
+  if (i == count) {
+    return;
+  }
+
+  std::array<std::array<Quatf, 4>, kInputs> padded;
+  for (auto k = 0U; k < kInputs; ++k) {
+    padded[k].fill(Quatf());
+    std::ranges::copy(inputs[k].subspan(i), padded[k].begin());
+    group[k] = &padded[k][0].w;
+  }
+  std::array<TOut, 4> results;
+  kernel(group, floats_of(results[0]));
+  std::copy_n(results.begin(), count - i, out.begin() + static_cast<std::ptrdiff_t>(i));
+}
+
+}  // namespace internal
+
+/**
+ * @brief Transforms the points by an affine matrix: `out[i] = (mat * vec4(points[i], 1)).xyz`. No perspective divide
+ * is performed.
+ *
+ * @param mat
+ * @param points
+ * @param out Must be at least as long as `points`.
+ */
+inline void transform_points(const Mat4f& mat, std::span<const Vec3f> points, std::span<Vec3f> out) {
+  internal::transform_vec3_many(mat, points, out, 1.F);
+}
+
+/**
+ * @brief Transforms the directions by an affine matrix, the translation is ignored:
+ * `out[i] = (mat * vec4(directions[i], 0)).xyz`.
+ *
+ * @param mat
+ * @param directions
+ * @param out Must be at least as long as `directions`.
+ */
+inline void transform_directions(const Mat4f& mat, std::span<const Vec3f> directions, std::span<Vec3f> out) {
+  internal::transform_vec3_many(mat, directions, out, 0.F);
+}
+
+/**
+ * @brief Transforms the homogeneous vectors: `out[i] = mat * vecs[i]`.
+ *
+ * @param mat
+ * @param vecs
+ * @param out Must be at least as long as `vecs`.
+ */
+inline void transform_vectors(const Mat4f& mat, std::span<const Vec4f> vecs, std::span<Vec4f> out) {
+  assert(out.size() >= vecs.size() && "Output must fit all of the vectors");
+
+  if constexpr (simd::kEnabled) {
+    if (!vecs.empty()) {
+      simd::mat4_mult_vec_many(mat.raw_ptr(), vecs.front().data, vecs.size(), out.front().data);
+    }
+    return;
+  }
+
+  for (auto i = std::size_t{0}; i < vecs.size(); ++i) {
+    out[i] = mat * vecs[i];
+  }
+}
+
+/**
+ * @brief Multiplies one matrix by all of the others: `out[i] = lhs * rhs[i]`, e.g. a parent transform by the local
+ * transforms of its children.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out Must be at least as long as `rhs`.
+ */
+inline void multiply_many(const Mat4f& lhs, std::span<const Mat4f> rhs, std::span<Mat4f> out) {
+  assert(out.size() >= rhs.size() && "Output must fit all of the products");
+
+  if constexpr (simd::kEnabled) {
+    if (!rhs.empty()) {
+      simd::mat4_mult_many(lhs.raw_ptr(), rhs.front().raw_ptr(), rhs.size(), out.front().raw_ptr());
+    }
+    return;
+  }
+
+  for (auto i = std::size_t{0}; i < rhs.size(); ++i) {
+    out[i] = lhs * rhs[i];
+  }
+}
+
+/**
+ * @brief Multiplies the matrices pairwise: `out[i] = lhs[i] * rhs[i]`.
+ *
+ * @param lhs
+ * @param rhs Must be as long as `lhs`.
+ * @param out Must be at least as long as `lhs`.
+ */
+inline void multiply_many(std::span<const Mat4f> lhs, std::span<const Mat4f> rhs, std::span<Mat4f> out) {
+  assert(lhs.size() == rhs.size() && "Operands must have the same length");
+  assert(out.size() >= lhs.size() && "Output must fit all of the products");
+
+  for (auto i = std::size_t{0}; i < lhs.size(); ++i) {
+    out[i] = lhs[i] * rhs[i];
+  }
+}
+
+/**
+ * @brief Multiplies the quaternions pairwise: `out[i] = lhs[i] * rhs[i]`.
+ *
+ * @param lhs
+ * @param rhs Must be as long as `lhs`.
+ * @param out Must be at least as long as `lhs`.
+ */
+inline void multiply_many(std::span<const Quatf> lhs, std::span<const Quatf> rhs, std::span<Quatf> out) {
+  if constexpr (simd::kEnabled) {
+    internal::for_each_quat_group<2>({lhs, rhs}, out, [](const auto& in, float* result) {
+      simd::quat_mult_x4(in[0], in[1], result);
+    });
+    return;
+  }
+
+  assert(lhs.size() == rhs.size() && "Operands must have the same length");
+  for (auto i = std::size_t{0}; i < lhs.size(); ++i) {
+    out[i] = lhs[i] * rhs[i];
+  }
+}
+
+/**
+ * @brief Normalizes the quaternions, e.g. after accumulating rotations. The SIMD path uses a refined reciprocal square
+ * root, precise to about 1e-6.
+ *
+ * @param quats
+ * @param out Must be at least as long as `quats`.
+ */
+inline void normalize_many(std::span<const Quatf> quats, std::span<Quatf> out) {
+  if constexpr (simd::kEnabled) {
+    internal::for_each_quat_group<1>({quats}, out, [](const auto& in, float* result) {
+      simd::quat_normalize_x4(in[0], result);
+    });
+    return;
+  }
+
+  for (auto i = std::size_t{0}; i < quats.size(); ++i) {
+    out[i] = quats[i].normalized();
+  }
+}
+
+/**
+ * @brief Normalized linear interpolation along the shorter arc, see `lerp_quat()`. Cheaper than `slerp_many()` and
+ * close to it for the small angles between the consecutive animation keys.
+ *
+ * @param start
+ * @param end Must be as long as `start`.
+ * @param t Interpolation parameter shared by all of the pairs.
+ * @param out Must be at least as long as `start`.
+ */
+inline void nlerp_many(std::span<const Quatf> start, std::span<const Quatf> end, float t, std::span<Quatf> out) {
+  if constexpr (simd::kEnabled) {
+    internal::for_each_quat_group<2>({start, end}, out, [t](const auto& in, float* result) {
+      simd::quat_nlerp_x4(in[0], in[1], t, result);
+    });
+    return;
+  }
+
+  assert(start.size() == end.size() && "Operands must have the same length");
+  for (auto i = std::size_t{0}; i < start.size(); ++i) {
+    out[i] = lerp_quat(start[i], end[i], t);
+  }
+}
+
+/**
+ * @brief Spherical linear interpolation along the shorter arc, see `slerp_quat()`. The SIMD path evaluates `acos` and
+ * `sin` with polynomials, the result is precise to about 1e-6.
+ *
+ * @param start
+ * @param end Must be as long as `start`.
+ * @param t Interpolation parameter shared by all of the pairs.
+ * @param out Must be at least as long as `start`.
+ */
+inline void slerp_many(std::span<const Quatf> start, std::span<const Quatf> end, float t, std::span<Quatf> out) {
+  if constexpr (simd::kEnabled) {
+    internal::for_each_quat_group<2>({start, end}, out, [t](const auto& in, float* result) {
+      simd::quat_slerp_x4(in[0], in[1], t, result);
+    });
+    return;
+  }
+
+  assert(start.size() == end.size() && "Operands must have the same length");
+  for (auto i = std::size_t{0}; i < start.size(); ++i) {
+    out[i] = slerp_quat(start[i], end[i], t);
+  }
+}
+
+/**
+ * @brief Rotation matrices of the unit quaternions, see `rot_mat_from_quat()`.
+ *
+ * @param unit_quats
+ * @param out Must be at least as long as `unit_quats`.
+ */
+inline void rot_mats_from_quats(std::span<const Quatf> unit_quats, std::span<Mat4f> out) {
+  if constexpr (simd::kEnabled) {
+    internal::for_each_quat_group<1>({unit_quats}, out, [](const auto& in, float* result) {
+      simd::quat_to_mat4_x4(in[0], result);
+    });
+    return;
+  }
+
+  for (auto i = std::size_t{0}; i < unit_quats.size(); ++i) {
+    out[i] = rot_mat_from_quat(unit_quats[i]);
+  }
+}
+
+/**
+ * @brief Bounds of the boxes transformed by the affine matrix, see `Aabb3f::transformed()`.
+ *
+ * @param mat
+ * @param boxes
+ * @param out Must be at least as long as `boxes`.
+ */
+inline void transform_aabbs(const Mat4f& mat, std::span<const Aabb3f> boxes, std::span<Aabb3f> out) {
+  assert(out.size() >= boxes.size() && "Output must fit all of the boxes");
+
+  for (auto i = std::size_t{0}; i < boxes.size(); ++i) {
+    out[i] = boxes[i].transformed(mat);
+  }
+}
+
+/**
+ * @brief Appends the indices of the boxes that are not outside of the frustum, 8 boxes are tested at a time.
+ *
+ * @param frustum
+ * @param boxes Must not be empty.
+ * @param indices
+ */
+inline void cull_aabbs(const Frustum& frustum, std::span<const Aabb3f> boxes, std::vector<uint32_t>& indices) {
+  auto i = std::size_t{0};
+  for (; i + 8 <= boxes.size(); i += 8) {
+    for (auto mask = frustum.intersects_x8(boxes.subspan(i).first<8>()); mask != 0; mask &= mask - 1) {
+      indices.push_back(static_cast<uint32_t>(i) + static_cast<uint32_t>(std::countr_zero(mask)));
+    }
+  }
+
+  for (; i < boxes.size(); ++i) {
+    if (frustum.intersects(boxes[i])) {
+      indices.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+}  // namespace eray::math
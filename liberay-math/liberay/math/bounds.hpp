@@ -0,0 +1,388 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/simd.hpp>
+#include <liberay/math/vec.hpp>
+#include <limits>
+#include <optional>
+#include <span>
+
+// Bounding volumes and the intersection tests used by the culling, the bounding volume hierarchies and the picking.
+// The batch tests (`Frustum::intersects_x8()`, `Ray3f::intersect_x4()`) use the `simd` backend when it is enabled.
+
+namespace eray::math {
+
+/**
+ * @brief Axis aligned bounding box. The default box is empty, i.e. merging it with any box yields the other box.
+ *
+ */
+struct Aabb3f {
+  Vec3f min = Vec3f::filled(std::numeric_limits<float>::max());
+  Vec3f max = Vec3f::filled(std::numeric_limits<float>::lowest());
+
+  [[nodiscard]] static Aabb3f from_center_extent(const Vec3f& center, const Vec3f& extent) {
+    return Aabb3f{.min = center - extent, .max = center + extent};
+  }
+
+  /**
+   * @brief Smallest box containing all of the points, empty for no points.
+   *
+   */
+  [[nodiscard]] static Aabb3f from_points(std::span<const Vec3f> points) {
+    auto box = Aabb3f();
+    for (const auto& point : points) {
+      box.min = math::min(box.min, point);
+      box.max = math::max(box.max, point);
+    }
+    return box;
+  }
+
+  bool empty() const { return min.x() > max.x() || min.y() > max.y() || min.z() > max.z(); }
+
+  Vec3f center() const { return (min + max) * 0.5F; }
+
+  /**
+   * @brief Half of the size of the box.
+   *
+   */
+  Vec3f extent() const { return (max - min) * 0.5F; }
+
+  /**
+   * @brief Surface area of the box, the cost metric of the bounding volume hierarchies.
+   *
+   */
+  float surface_area() const {
+    const auto size = max - min;
+    return 2.F * (size.x() * size.y() + size.y() * size.z() + size.z() * size.x());
+  }
+
+  bool contains(const Vec3f& point) const {
+    return min.x() <= point.x() && min.y() <= point.y() && min.z() <= point.z() && max.x() >= point.x() &&
+           max.y() >= point.y() && max.z() >= point.z();
+  }
+
+  bool contains(const Aabb3f& other) const {
+    return min.x() <= other.min.x() && min.y() <= other.min.y() && min.z() <= other.min.z() &&
+           max.x() >= other.max.x() && max.y() >= other.max.y() && max.z() >= other.max.z();
+  }
+
+  bool intersects(const Aabb3f& other) const {
+    return min.x() <= other.max.x() && min.y() <= other.max.y() && min.z() <= other.max.z() &&
+           max.x() >= other.min.x() && max.y() >= other.min.y() && max.z() >= other.min.z();
+  }
+
+  [[nodiscard]] Aabb3f merged(const Aabb3f& other) const {
+    return Aabb3f{.min = math::min(min, other.min), .max = math::max(max, other.max)};
+  }
+
+  [[nodiscard]] Aabb3f expanded(float margin) const {
+    return Aabb3f{.min = min - Vec3f::filled(margin), .max = max + Vec3f::filled(margin)};
+  }
+
+  /**
+   * @brief Returns the box that bounds this box transformed by the affine `mat`. The extent is transformed by the
+   * absolute values of the linear part, so the 8 corners are never computed.
+   *
+   * @param mat
+   * @return Aabb3f
+   */
+  [[nodiscard]] Aabb3f transformed(const Mat4f& mat) const {
+    if constexpr (simd::kEnabled) {
+      auto result = Aabb3f();
+      simd::aabb_transform(mat.raw_ptr(), min.data, result.min.data);
+      return result;
+    }
+
+    const auto c = center();
+    const auto e = extent();
+
+    auto new_center = Vec3f(mat[3][0], mat[3][1], mat[3][2]);
+    auto new_extent = Vec3f::filled(0.F);
+    for (auto col = 0U; col < 3; ++col) {
+      for (auto row = 0U; row < 3; ++row) {
+        new_center[row] += mat[col][row] * c[col];
+        new_extent[row] += std::abs(mat[col][row]) * e[col];
+      }
+    }
+    return from_center_extent(new_center, new_extent);
+  }
+};
+
+static_assert(sizeof(Aabb3f) == 6 * sizeof(float), "The SIMD kernels read the boxes as packed floats");
+
+struct Sphere3f {
+  Vec3f center = Vec3f::filled(0.F);
+  float radius = 0.F;
+
+  bool contains(const Vec3f& point) const { return distance_sq(center, point) <= radius * radius; }
+
+  bool intersects(const Sphere3f& other) const {
+    const auto radii = radius + other.radius;
+    return distance_sq(center, other.center) <= radii * radii;
+  }
+
+  bool intersects(const Aabb3f& box) const {
+    const auto closest = math::clamp(center, box.min, box.max);
+    return distance_sq(center, closest) <= radius * radius;
+  }
+
+  Aabb3f bounds() const { return Aabb3f::from_center_extent(center, Vec3f::filled(radius)); }
+
+  /**
+   * @brief Returns the sphere that bounds this sphere transformed by the affine `mat`, the radius is scaled by the
+   * largest axis scale.
+   *
+   * @param mat
+   * @return Sphere3f
+   */
+  [[nodiscard]] Sphere3f transformed(const Mat4f& mat) const {
+    auto max_scale_sq = 0.F;
+    for (auto col = 0U; col < 3; ++col) {
+      max_scale_sq = std::max(max_scale_sq, mat[col][0] * mat[col][0] + mat[col][1] * mat[col][1] +
+                                                mat[col][2] * mat[col][2]);
+    }
+    return Sphere3f{.center = Vec3f(mat * Vec4f(center, 1.F)), .radius = radius * std::sqrt(max_scale_sq)};
+  }
+};
+
+/**
+ * @brief Half-line `origin + t * direction` for `t >= 0`. The direction does not have to be normalized, the distances
+ * returned by the intersection tests are then expressed in its lengths.
+ *
+ */
+struct Ray3f {
+  Vec3f origin    = Vec3f::filled(0.F);
+  Vec3f direction = Vec3f(0.F, 0.F, -1.F);
+
+  Vec3f at(float t) const { return origin + direction * t; }
+
+  /**
+   * @brief Component-wise reciprocal of the direction, the zero components become infinities.
+   *
+   */
+  Vec3f inv_direction() const { return Vec3f(1.F / direction.x(), 1.F / direction.y(), 1.F / direction.z()); }
+
+  /**
+   * @brief Slab test, returns the distance at which the ray enters the box (0 if it starts inside of it).
+   *
+   * @param box
+   * @param t_max Hits further than `t_max` are ignored.
+   * @return std::optional<float>
+   */
+  std::optional<float> intersect(const Aabb3f& box, float t_max = std::numeric_limits<float>::infinity()) const {
+    const auto inv = inv_direction();
+    auto t_enter   = 0.F;
+    auto t_exit    = t_max;
+    for (auto k = 0U; k < 3; ++k) {
+      const auto t0 = (box.min[k] - origin[k]) * inv[k];
+      const auto t1 = (box.max[k] - origin[k]) * inv[k];
+      t_enter       = std::max(t_enter, std::min(t0, t1));
+      t_exit        = std::min(t_exit, std::max(t0, t1));
+    }
+
+    if (t_enter > t_exit) {
+      return std::nullopt;
+    }
+    return t_enter;
+  }
+
+  /**
+   * @brief Returns the distance at which the ray enters the sphere (0 if it starts inside of it).
+   *
+   * @param sphere
+   * @param t_max Hits further than `t_max` are ignored.
+   * @return std::optional<float>
+   */
+  std::optional<float> intersect(const Sphere3f& sphere, float t_max = std::numeric_limits<float>::infinity()) const {
+    const auto to_origin = origin - sphere.center;
+    const auto a         = dot(direction, direction);
+    const auto b         = dot(to_origin, direction);
+    const auto c         = dot(to_origin, to_origin) - sphere.radius * sphere.radius;
+    const auto delta     = b * b - a * c;
+    if (delta < 0.F) {
+      return std::nullopt;
+    }
+
+    const auto sqrt_delta = std::sqrt(delta);
+    if ((-b + sqrt_delta) / a < 0.F) {
+      return std::nullopt;
+    }
+    const auto t = std::max((-b - sqrt_delta) / a, 0.F);
+    if (t > t_max) {
+      return std::nullopt;
+    }
+    return t;
+  }
+
+  /**
+   * @brief Slab test against 4 boxes at once, e.g. the children of a 4-wide BVH node.
+   *
+   * @param boxes
+   * @param t_near Entry distances of the boxes that are hit, see `intersect()`.
+   * @param t_max Hits further than `t_max` are ignored.
+   * @return uint32_t Bit i is set if `boxes[i]` is hit.
+   */
+  uint32_t intersect_x4(std::span<const Aabb3f, 4> boxes, std::span<float, 4> t_near,
+                        float t_max = std::numeric_limits<float>::infinity()) const {
+    if constexpr (simd::kEnabled) {
+      const auto inv = inv_direction();
+      return simd::ray_aabb_x4(origin.data, inv.data, t_max, boxes[0].min.data, t_near.data());
+    }
+
+    auto mask = 0U;
+    for (auto i = 0U; i < 4; ++i) {
+      if (const auto t = intersect(boxes[i], t_max)) {
+        t_near[i] = *t;
+        mask |= 1U << i;
+      }
+    }
+    return mask;
+  }
+};
+
+enum class FrustumTest : uint8_t {
+  Outside,
+  Intersecting,
+  Inside,
+};
+
+/**
+ * @brief View frustum as 6 planes `n * p + d >= 0` facing inwards. The planes are kept as a structure of arrays padded
+ * to `kLanes`, so a box is tested against all of them with fixed trip count loops the compiler turns into vector
+ * instructions. The padding planes accept every box.
+ *
+ */
+class Frustum {
+ public:
+  static constexpr size_t kPlanes = 6;
+  static constexpr size_t kLanes  = 8;
+
+  /**
+   * @brief Extracts the planes from a Vulkan view projection matrix (depth range 0 to 1), e.g. built with
+   * `perspective_vk_rh()` or `orthographic_vk_rh()`. The planes are expressed in the space the matrix transforms from,
+   * e.g. the world space for `proj * view`.
+   *
+   * @param view_proj
+   * @return Frustum
+   */
+  [[nodiscard]] static Frustum from_view_projection(const Mat4f& view_proj) {
+    const auto row = [&](size_t k) {
+      return Vec4f(view_proj[0][k], view_proj[1][k], view_proj[2][k], view_proj[3][k]);
+    };
+    const auto r0 = row(0);
+    const auto r1 = row(1);
+    const auto r2 = row(2);
+    const auto r3 = row(3);
+
+    // Gribb-Hartmann extraction, the clip space depth is within [0, w]
+    const auto planes = std::array<Vec4f, kPlanes>{
+        r3 + r0,  // left
+        r3 - r0,  // right
+        r3 + r1,  // bottom
+        r3 - r1,  // top
+        r2,       // near
+        r3 - r2,  // far
+    };
+
+    auto frustum = Frustum();
+    for (auto i = 0U; i < kLanes; ++i) {
+      if (i >= kPlanes) {
+        frustum.d_[i] = std::numeric_limits<float>::max();
+        continue;
+      }
+
+      const auto& plane = planes[i];
+      const auto length = std::sqrt(plane.x() * plane.x() + plane.y() * plane.y() + plane.z() * plane.z());
+      const auto inv    = length > 0.F ? 1.F / length : 0.F;
+      frustum.nx_[i]    = plane.x() * inv;
+      frustum.ny_[i]    = plane.y() * inv;
+      frustum.nz_[i]    = plane.z() * inv;
+      frustum.d_[i]     = plane.w() * inv;
+    }
+    return frustum;
+  }
+
+  /**
+   * @brief Tests the box against every plane at once.
+   *
+   * @param box Must not be empty.
+   * @return FrustumTest `Inside` if the box lies fully inside of the frustum.
+   */
+  FrustumTest classify(const Aabb3f& box) const {
+    const auto c = box.center();
+    const auto e = box.extent();
+
+    // Signed distance of the center and the projected radius of the box, per plane
+    auto distance = std::array<float, kLanes>{};
+    auto radius   = std::array<float, kLanes>{};
+    for (auto i = 0U; i < kLanes; ++i) {
+      distance[i] = nx_[i] * c.x() + ny_[i] * c.y() + nz_[i] * c.z() + d_[i];
+      radius[i]   = std::abs(nx_[i]) * e.x() + std::abs(ny_[i]) * e.y() + std::abs(nz_[i]) * e.z();
+    }
+
+    auto outside      = 0U;
+    auto intersecting = 0U;
+    for (auto i = 0U; i < kLanes; ++i) {
+      outside |= static_cast<uint32_t>(distance[i] + radius[i] < 0.F);
+      intersecting |= static_cast<uint32_t>(distance[i] - radius[i] < 0.F);
+    }
+
+    if (outside != 0) {
+      return FrustumTest::Outside;
+    }
+    return intersecting != 0 ? FrustumTest::Intersecting : FrustumTest::Inside;
+  }
+
+  bool intersects(const Aabb3f& box) const { return classify(box) != FrustumTest::Outside; }
+
+  bool intersects(const Sphere3f& sphere) const {
+    auto outside = 0U;
+    for (auto i = 0U; i < kLanes; ++i) {
+      const auto& c       = sphere.center;
+      const auto distance = nx_[i] * c.x() + ny_[i] * c.y() + nz_[i] * c.z() + d_[i];
+      outside |= static_cast<uint32_t>(distance < -sphere.radius);
+    }
+    return outside == 0;
+  }
+
+  /**
+   * @brief Tests 8 boxes at once.
+   *
+   * @param boxes Must not be empty.
+   * @return uint32_t Bit i is set if `boxes[i]` is not outside of the frustum.
+   */
+  uint32_t intersects_x8(std::span<const Aabb3f, 8> boxes) const {
+    if constexpr (simd::kEnabled) {
+      const float* planes[4] = {nx_.data(), ny_.data(), nz_.data(), d_.data()};
+      return simd::frustum_aabb_x4(planes, kPlanes, boxes[0].min.data) |
+             (simd::frustum_aabb_x4(planes, kPlanes, boxes[4].min.data) << 4);
+    }
+
+    auto mask = 0U;
+    for (auto i = 0U; i < 8; ++i) {
+      mask |= static_cast<uint32_t>(intersects(boxes[i])) << i;
+    }
+    return mask;
+  }
+
+  /**
+   * @brief Normalized plane `(n, d)`, e.g. for the GPU culling.
+   *
+   * @param index Less than `kPlanes`.
+   * @return Vec4f
+   */
+  Vec4f plane(size_t index) const { return Vec4f(nx_[index], ny_[index], nz_[index], d_[index]); }
+
+ private:
+  std::array<float, kLanes> nx_{};
+  std::array<float, kLanes> ny_{};
+  std::array<float, kLanes> nz_{};
+  std::array<float, kLanes> d_{};
+};
+
+}  // namespace eray::math
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/quat.hpp>
+#include <liberay/math/simd.hpp>
+#include <liberay/math/vec.hpp>
+#include <numbers>
+#include <span>
+
+// Approximations of the common functions, opt-in where a few ULPs can be traded for speed (camera controls,
+// particles, procedural animation). The error bounds below are measured over the whole stated domain. The `_many`
+// variants process 4 values at a time with the `simd` backend and match the scalar functions within the same bounds.
+
+namespace eray::math {
+
+namespace internal {
+
+/**
+ * @brief `sin(x)` for x in [-pi/2, pi/2], Taylor polynomial of the 11th degree.
+ *
+ */
+constexpr float sin_half_pi(float x) {
+  const auto x2 = x * x;
+  auto poly     = -1.F / 39916800.F;
+  poly          = poly * x2 + 1.F / 362880.F;
+  poly          = poly * x2 - 1.F / 5040.F;
+  poly          = poly * x2 + 1.F / 120.F;
+  poly          = poly * x2 - 1.F / 6.F;
+  poly          = poly * x2 + 1.F;
+  return x * poly;
+}
+
+constexpr float round_half_away(float x) {
+  return static_cast<float>(static_cast<int64_t>(x >= 0.F ? x + 0.5F : x - 0.5F));
+}
+
+/**
+ * @brief `x` minus the nearest multiple of 2 pi, in [-pi, pi]. 2 pi is split in an exact high part and a low part
+ * (Cody-Waite), so the multiples of the high part are exact.
+ *
+ */
+constexpr float reduce_two_pi(float x) {
+  constexpr auto kTwoPiHigh = 6.28125F;
+  constexpr auto kTwoPiLow  = 1.9353071795864769e-3F;
+
+  const auto turns = round_half_away(x * (0.5F / std::numbers::pi_v<float>));
+  return (x - turns * kTwoPiHigh) - turns * kTwoPiLow;
+}
+
+}  // namespace internal
+
+/**
+ * @brief `1 / sqrt(x)` from the exponent bit trick refined with two Newton steps, the relative error is below 5e-6.
+ *
+ * @param x Positive.
+ * @return float
+ */
+[[nodiscard]] constexpr float fast_rsqrt(float x) {
+  auto y = std::bit_cast<float>(0x5F375A86U - (std::bit_cast<uint32_t>(x) >> 1));
+  y      = y * (1.5F - 0.5F * x * y * y);
+  return y * (1.5F - 0.5F * x * y * y);
+}
+
+/**
+ * @brief `vec.normalized()` with `fast_rsqrt()`, the relative error is below 5e-6.
+ *
+ * @param vec Must not be zero.
+ */
+template <std::size_t N>
+[[nodiscard]] Vec<N, float> fast_normalize(const Vec<N, float>& vec) {
+  return vec * fast_rsqrt(dot(vec, vec));
+}
+
+/**
+ * @brief `length(vec)` as `x * rsqrt(x)`, the relative error is below 5e-6.
+ *
+ */
+template <std::size_t N>
+[[nodiscard]] float fast_length(const Vec<N, float>& vec) {
+  const auto length_sq = dot(vec, vec);
+  return length_sq > 0.F ? length_sq * fast_rsqrt(length_sq) : 0.F;
+}
+
+/**
+ * @brief `sin(x)` reduced to [-pi/2, pi/2] and evaluated with a polynomial. The absolute error is below 4e-7 for |x|
+ * up to 100, beyond that it grows with the rounding of the range reduction.
+ *
+ */
+[[nodiscard]] constexpr float fast_sin(float x) {
+  constexpr auto kPi = std::numbers::pi_v<float>;
+
+  auto r = internal::reduce_two_pi(x);
+  if (r > kPi / 2.F) {
+    r = kPi - r;
+  } else if (r < -kPi / 2.F) {
+    r = -kPi - r;
+  }
+  return internal::sin_half_pi(r);
+}
+
+/**
+ * @brief `cos(x)` as `sin(pi/2 - |x|)` after the range reduction of `fast_sin()`, with the same error bounds.
+ *
+ */
+[[nodiscard]] constexpr float fast_cos(float x) {
+  const auto r = internal::reduce_two_pi(x);
+  return internal::sin_half_pi(std::numbers::pi_v<float> / 2.F - (r < 0.F ? -r : r));
+}
+
+/**
+ * @brief `atan2(y, x)` from a minimax polynomial of `atan` on [0, 1] and the octant symmetries, the absolute error is
+ * below 1.2e-5. Returns 0 for `(0, 0)`.
+ *
+ */
+[[nodiscard]] constexpr float fast_atan2(float y, float x) {
+  constexpr auto kPi = std::numbers::pi_v<float>;
+
+  const auto abs_x = x < 0.F ? -x : x;
+  const auto abs_y = y < 0.F ? -y : y;
+  const auto low   = abs_x < abs_y ? abs_x : abs_y;
+  const auto high  = abs_x < abs_y ? abs_y : abs_x;
+  const auto a     = high > 0.F ? low / high : 0.F;
+
+  const auto s = a * a;
+  auto poly    = 0.0208351F;
+  poly         = poly * s - 0.0851330F;
+  poly         = poly * s + 0.1801410F;
+  poly         = poly * s - 0.3302995F;
+  poly         = poly * s + 0.9998660F;
+  auto r       = poly * a;
+
+  if (abs_x < abs_y) {
+    r = kPi / 2.F - r;
+  }
+  if (x < 0.F) {
+    r = kPi - r;
+  }
+  return (std::bit_cast<uint32_t>(y) >> 31) != 0 ? -r : r;
+}
+
+/**
+ * @brief `acos(x)` for x in [-1, 1], Abramowitz and Stegun 4.4.46 (the polynomial of the SIMD `slerp_many()`), the
+ * absolute error is below 5e-7.
+ *
+ */
+[[nodiscard]] inline float fast_acos(float x) {
+  const auto abs_x = std::min(std::abs(x), 1.F);
+  auto poly        = -0.0012624911F;
+  poly             = poly * abs_x + 0.0066700901F;
+  poly             = poly * abs_x - 0.0170881256F;
+  poly             = poly * abs_x + 0.0308918810F;
+  poly             = poly * abs_x - 0.0501743046F;
+  poly             = poly * abs_x + 0.0889789874F;
+  poly             = poly * abs_x - 0.2145988016F;
+  poly             = poly * abs_x + 1.5707963050F;
+  const auto r     = std::sqrt(1.F - abs_x) * poly;
+  return x < 0.F ? std::numbers::pi_v<float> - r : r;
+}
+
+/**
+ * @brief `Quatf::rotation_axis()` with `fast_sin()` and `fast_cos()`.
+ *
+ * @param rad_angle
+ * @param unit_axis
+ * @return Quatf
+ */
+[[nodiscard]] inline Quatf fast_quat_rotation_axis(float rad_angle, const Vec3f& unit_axis) {
+  const auto s = fast_sin(rad_angle * 0.5F);
+  return Quatf(fast_cos(rad_angle * 0.5F), unit_axis.x() * s, unit_axis.y() * s, unit_axis.z() * s);
+}
+
+/**
+ * @brief `slerp_quat()` with `fast_acos()` and `fast_sin()`, the result is within 1e-6 of the exact one.
+ *
+ */
+[[nodiscard]] inline Quatf fast_slerp_quat(const Quatf& start, const Quatf& end, float t) {
+  auto cos_angle = dot(start, end);
+  auto end_quat  = end;
+  if (cos_angle < 0.F) {
+    end_quat  = -end;
+    cos_angle = -cos_angle;
+  }
+
+  const auto angle = fast_acos(cos_angle);
+  const auto s     = internal::sin_half_pi(angle);
+  if (s < 1.e-5F) {
+    return lerp_quat(start, end_quat, t);
+  }
+
+  const auto inv_s = 1.F / s;
+  return (start * (internal::sin_half_pi((1.F - t) * angle) * inv_s) +
+          end_quat * (internal::sin_half_pi(t * angle) * inv_s))
+      .normalized();
+}
+
+namespace internal {
+
+template <typename TScalar, typename TSimd>
+void fast_many(std::span<const float> in, std::span<float> out, TScalar&& scalar, TSimd&& simd_kernel) {
+  // `simd_kernel` is a generic lambda, so the kernels declared only without SIMD are never referenced
+  assert(out.size() >= in.size() && "Output must fit all of the values");
+
+  auto i = std::size_t{0};
+  if constexpr (simd::kEnabled) {
+    for (; i + 4 <= in.size(); i += 4) {
+      simd_kernel(&in[i], &out[i]);
+    }
+  }
+  for (; i < in.size(); ++i) {
+    out[i] = scalar(in[i]);
+  }
+}
+
+}  // namespace internal
+
+/**
+ * @brief `fast_normalize()` of every vector, the reciprocal square roots are computed 4 at a time.
+ *
+ * @param vecs Must not contain zero vectors.
+ * @param out Must be at least as long as `vecs`.
+ */
+template <std::size_t N>
+void fast_normalize_many(std::span<const Vec<N, float>> vecs, std::span<Vec<N, float>> out) {
+  assert(out.size() >= vecs.size() && "Output must fit all of the vectors");
+
+  auto i = std::size_t{0};
+  if constexpr (simd::kEnabled) {
+    float lengths_sq[4];
+    float inv_lengths[4];
+    for (; i + 4 <= vecs.size(); i += 4) {
+      for (auto k = 0U; k < 4; ++k) {
+        lengths_sq[k] = dot(vecs[i + k], vecs[i + k]);
+      }
+      simd::rsqrt_x4(lengths_sq, inv_lengths);
+      for (auto k = 0U; k < 4; ++k) {
+        out[i + k] = vecs[i + k] * inv_lengths[k];
+      }
+    }
+  }
+  for (; i < vecs.size(); ++i) {
+    out[i] = fast_normalize(vecs[i]);
+  }
+}
+
+inline void fast_sin_many(std::span<const float> in, std::span<float> out) {
+  internal::fast_many(in, out, fast_sin, [](const auto* src, float* dst) { simd::fast_sin_x4(src, dst); });
+}
+
+inline void fast_cos_many(std::span<const float> in, std::span<float> out) {
+  internal::fast_many(in, out, fast_cos, [](const auto* src, float* dst) { simd::fast_cos_x4(src, dst); });
+}
+
+inline void fast_acos_many(std::span<const float> in, std::span<float> out) {
+  internal::fast_many(in, out, fast_acos, [](const auto* src, float* dst) { simd::fast_acos_x4(src, dst); });
+}
+
+/**
+ * @brief `out[i] = fast_atan2(y[i], x[i])`.
+ *
+ * @param y
+ * @param x Must be as long as `y`.
+ * @param out Must be at least as long as `y`.
+ */
+inline void fast_atan2_many(std::span<const float> y, std::span<const float> x, std::span<float> out) {
+  assert(x.size() == y.size() && "Operands must have the same length");
+  assert(out.size() >= y.size() && "Output must fit all of the values");
+
+  auto i = std::size_t{0};
+  if constexpr (simd::kEnabled) {
+    for (; i + 4 <= y.size(); i += 4) {
+      simd::fast_atan2_x4(&y[i], &x[i], &out[i]);
+    }
+  }
+  for (; i < y.size(); ++i) {
+    out[i] = fast_atan2(y[i], x[i]);
+  }
+}
+
+}  // namespace eray::math
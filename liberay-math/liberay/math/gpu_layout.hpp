@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/types.hpp>
+#include <liberay/math/vec.hpp>
+#include <type_traits>
+
+// Math types with the std140/std430 layout of their shader counterparts. A struct built of them and of the 4-byte
+// scalars has the layout the shader expects without any hand-written padding, so the struct (and arrays of it) can be
+// copied into a mapped buffer directly, e.g. with `MappedUniformBuffer<T>`:
+//
+// struct Ubo {
+//   gpu::Mat4f view_projection;
+//   gpu::Vec3f camera_pos;  // vec3, padded to 16 bytes
+//   gpu::Mat3f normal;      // mat3, 3 columns padded to vec4
+//   float time;
+// };
+// ERAY_GPU_ASSERT_OFFSET(Ubo, normal, 80);
+// static_assert(gpu::CStd140Block<Ubo>);
+//
+// std430 lets a scalar share the last 4 bytes of a vec3, the padded `gpu::Vec3f` does not. Declare such pairs as
+// `math::Vec3f` followed by the scalar, starting at a multiple of 16 bytes (see `vkren::GpuLight`).
+
+namespace eray::math::gpu {
+
+namespace internal {
+
+template <std::size_t N, CPrimitive T>
+consteval std::size_t vec_alignment() {
+  return (N == 2 ? 2 : 4) * sizeof(T);
+}
+
+}  // namespace internal
+
+/**
+ * @brief Vector aligned to its std140/std430 base alignment: twice the component for 2 components and four times the
+ * component for 3 and 4. The 3-component vector is padded to the size of 4 components, which is also the array stride
+ * of vec3.
+ *
+ */
+template <std::size_t N, CPrimitive T>
+  requires(N >= 2 && N <= 4)
+struct alignas(internal::vec_alignment<N, T>()) Vec {
+  math::Vec<N, T> value;
+
+  constexpr Vec() = default;
+  constexpr Vec(const math::Vec<N, T>& vec) : value(vec) {}  // NOLINT(google-explicit-constructor)
+
+  constexpr operator math::Vec<N, T>() const { return value; }  // NOLINT(google-explicit-constructor)
+};
+
+using Vec2f = Vec<2, float>;
+using Vec3f = Vec<3, float>;
+using Vec4f = Vec<4, float>;
+
+using Vec2i = Vec<2, int>;
+using Vec3i = Vec<3, int>;
+using Vec4i = Vec<4, int>;
+
+using Vec2u = Vec<2, uint32_t>;
+using Vec3u = Vec<3, uint32_t>;
+using Vec4u = Vec<4, uint32_t>;
+
+/**
+ * @brief Column-major matrix of `N` columns with `M` rows, every column padded to 4 components, i.e. the std140 and
+ * std430 layout of `matNxM`. The 2-row matrices are not supported, their std140 and std430 layouts differ.
+ *
+ */
+template <std::size_t M, std::size_t N, CFloatingPoint T>
+  requires(M >= 3 && M <= 4 && N >= 2 && N <= 4)
+struct alignas(4 * sizeof(T)) Mat {
+  math::Vec<4, T> columns[N];
+
+  constexpr Mat() = default;
+
+  constexpr Mat(const math::Mat<M, N, T>& mat) {  // NOLINT(google-explicit-constructor)
+    for (std::size_t j = 0; j < N; ++j) {
+      for (std::size_t i = 0; i < M; ++i) {
+        columns[j][i] = mat[j][i];
+      }
+    }
+  }
+
+  constexpr operator math::Mat<M, N, T>() const {  // NOLINT(google-explicit-constructor)
+    auto mat = math::Mat<M, N, T>();
+    for (std::size_t j = 0; j < N; ++j) {
+      for (std::size_t i = 0; i < M; ++i) {
+        mat[j][i] = columns[j][i];
+      }
+    }
+    return mat;
+  }
+};
+
+using Mat3f   = Mat<3, 3, float>;
+using Mat3x4f = Mat<4, 3, float>;
+using Mat4f   = Mat<4, 4, float>;
+
+/**
+ * @brief Element of a std140 array of scalars or 2-component vectors, whose array stride is rounded up to 16 bytes.
+ * The std430 arrays use the types directly.
+ *
+ */
+template <typename T>
+struct alignas(16) Std140ArrayElement {
+  T value;
+};
+
+/**
+ * @brief Struct that can be copied into a std430 buffer as is. The C++ struct alignment and array stride follow the
+ * std430 rules once the members do, the member offsets are checked with `ERAY_GPU_ASSERT_OFFSET`.
+ *
+ */
+template <typename T>
+concept CStd430Block = std::is_trivially_copyable_v<T> && std::is_standard_layout_v<T>;
+
+/**
+ * @brief Struct that can be copied into a std140 buffer as is, the std140 structs are additionally aligned to 16 bytes.
+ *
+ */
+template <typename T>
+concept CStd140Block = CStd430Block<T> && alignof(T) % 16 == 0;
+
+}  // namespace eray::math::gpu
+
+/**
+ * @brief Asserts that a member of a GPU struct is at the byte offset of the shader.
+ *
+ */
+#define ERAY_GPU_ASSERT_OFFSET(type, member, offset) \
+  static_assert(offsetof(type, member) == (offset), #type "::" #member " is not at the offset of the shader")
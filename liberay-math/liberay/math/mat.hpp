@@ -2,10 +2,12 @@
 
 #include <cmath>
 #include <liberay/math/mat_fwd.hpp>
+#include <liberay/math/simd.hpp>
 #include <liberay/math/types.hpp>
 #include <liberay/math/vec.hpp>
 #include <numbers>
 #include <optional>
+#include <type_traits>
 #include <utility>
 
 namespace eray::math {
@@ -241,10 +243,22 @@ struct Mat {
     ((lhs[Is] -= rhs[Is]), ...);
   }
 
+  /**
+   * @brief True for the 4x4 float matrices, which use the `simd` backend outside of constant evaluation.
+   *
+   */
+  static constexpr bool kSimd = M == 4 && N == 4 && std::is_same_v<T, float> && simd::kEnabled;
+
   template <std::size_t K>
   static constexpr Mat<M, K, T> mult(const Mat& lhs, const Mat<N, K, T>& rhs) {
-    // TODO(migoox): optimize this, especially for 4x4 matrices (maybe some sort of SIMD operation?)
     auto result = Mat<M, K, T>();
+    if constexpr (kSimd && K == 4) {
+      if (!std::is_constant_evaluated()) {
+        simd::mat4_mult(lhs.raw_ptr(), rhs.raw_ptr(), result.raw_ptr());
+        return result;
+      }
+    }
+
     for (std::size_t i = 0; i < M; ++i) {
       for (std::size_t j = 0; j < K; ++j) {
         for (std::size_t k = 0; k < N; ++k) {
@@ -256,8 +270,14 @@ struct Mat {
   }
 
   static constexpr Vec<M, T> mult_vec_lhs(const Vec<M, T>& lhs, const Mat& rhs) {
-    // TODO(migoox): optimize this (maybe some sort of SIMD operation?)
     auto result = Vec<M, T>();
+    if constexpr (kSimd) {
+      if (!std::is_constant_evaluated()) {
+        simd::vec_mult_mat4(lhs.data, rhs.raw_ptr(), result.data);
+        return result;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i) {
       for (size_t j = 0; j < M; ++j) {
         result[i] += lhs[j] * rhs[i][j];
@@ -268,8 +288,14 @@ struct Mat {
   }
 
   static constexpr Vec<M, T> mult_vec_rhs(const Mat& lhs, const Vec<M, T>& rhs) {
-    // TODO(migoox): optimize this (maybe some sort of SIMD operation?)
     auto result = Vec<M, T>();
+    if constexpr (kSimd) {
+      if (!std::is_constant_evaluated()) {
+        simd::mat4_mult_vec(lhs.raw_ptr(), rhs.data, result.data);
+        return result;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i) {
       for (size_t j = 0; j < M; ++j) {
         result[i] += rhs[j] * lhs[j][i];
@@ -288,6 +314,8 @@ struct Mat {
   Vec<M, T> data_[N];
 };
 
+static_assert(sizeof(Mat<4, 4, float>) == 16 * sizeof(float));
+
 /**
  * @brief Equivalent of `mat.transposed()`.
  *
@@ -767,6 +795,71 @@ constexpr std::optional<Mat<4, 4, T>> inverse(const Mat<4, 4, T>& m) {
   return inverse * (static_cast<T>(1) / det);
 }
 
+/**
+ * @brief Inverse of an affine matrix, i.e. with the last row equal to (0, 0, 0, 1): the inverse of the 3x3 linear part
+ * and the translation `-(A^-1 * t)`. A fraction of the cost of `inverse()`, the linear part must be invertible.
+ *
+ * @tparam T
+ * @param m
+ * @return Mat<4, 4, T>
+ */
+template <CFloatingPoint T>
+constexpr Mat<4, 4, T> inverse_affine(const Mat<4, 4, T>& m) {
+  auto inverse = Mat<4, 4, T>::identity();
+  if constexpr (std::is_same_v<T, float> && simd::kEnabled) {
+    if (!std::is_constant_evaluated()) {
+      simd::mat4_inverse_affine(m.raw_ptr(), inverse.raw_ptr());
+      return inverse;
+    }
+  }
+
+  // The rows of the inverse of the linear part are the cross products of its columns divided by the determinant
+  const auto c0 = Vec<3, T>(m[0][0], m[0][1], m[0][2]);
+  const auto c1 = Vec<3, T>(m[1][0], m[1][1], m[1][2]);
+  const auto c2 = Vec<3, T>(m[2][0], m[2][1], m[2][2]);
+  const auto t  = Vec<3, T>(m[3][0], m[3][1], m[3][2]);
+
+  const Vec<3, T> rows[3] = {cross(c1, c2), cross(c2, c0), cross(c0, c1)};
+  const auto inv_det      = static_cast<T>(1) / dot(c0, rows[0]);
+  for (std::size_t i = 0; i < 3; ++i) {
+    inverse[0][i] = rows[i][0] * inv_det;
+    inverse[1][i] = rows[i][1] * inv_det;
+    inverse[2][i] = rows[i][2] * inv_det;
+    inverse[3][i] = -dot(rows[i], t) * inv_det;
+  }
+
+  return inverse;
+}
+
+/**
+ * @brief Inverse of a rigid matrix, i.e. a rotation followed by a translation (e.g. a camera view matrix): the
+ * transposed rotation and the translation `-(R^T * t)`. The rotation must be orthonormal, use `inverse_affine()`
+ * otherwise.
+ *
+ * @tparam T
+ * @param m
+ * @return Mat<4, 4, T>
+ */
+template <CFloatingPoint T>
+constexpr Mat<4, 4, T> inverse_rigid(const Mat<4, 4, T>& m) {
+  auto inverse = Mat<4, 4, T>::identity();
+  if constexpr (std::is_same_v<T, float> && simd::kEnabled) {
+    if (!std::is_constant_evaluated()) {
+      simd::mat4_inverse_rigid(m.raw_ptr(), inverse.raw_ptr());
+      return inverse;
+    }
+  }
+
+  for (std::size_t i = 0; i < 3; ++i) {
+    inverse[0][i] = m[i][0];
+    inverse[1][i] = m[i][1];
+    inverse[2][i] = m[i][2];
+    inverse[3][i] = -(m[i][0] * m[3][0] + m[i][1] * m[3][1] + m[i][2] * m[3][2]);
+  }
+
+  return inverse;
+}
+
 namespace internal {
 
 template <typename T>
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/simd.hpp>
+#include <liberay/math/vec.hpp>
+#include <span>
+
+// Compact vertex attribute types: half floats and normalized integers with the bit layouts of the matching Vulkan
+// formats (see `vkren::kVertexFormatOf`). They are storage types only, unpack them to the math types for arithmetic.
+
+namespace eray::math {
+
+namespace internal {
+
+constexpr int32_t round_to_int(float value) {
+  return static_cast<int32_t>(value >= 0.F ? value + 0.5F : value - 0.5F);
+}
+
+constexpr uint32_t to_unorm(float value, uint32_t max) {
+  return static_cast<uint32_t>(round_to_int(std::clamp(value, 0.F, 1.F) * static_cast<float>(max)));
+}
+
+constexpr int32_t to_snorm(float value, int32_t max) {
+  return round_to_int(std::clamp(value, -1.F, 1.F) * static_cast<float>(max));
+}
+
+constexpr float from_snorm(int32_t value, int32_t max) {
+  return std::max(static_cast<float>(value) / static_cast<float>(max), -1.F);
+}
+
+}  // namespace internal
+
+/**
+ * @brief IEEE 754 half precision float (binary16), `vk::Format::eR16Sfloat`.
+ *
+ */
+struct Half {
+  uint16_t bits = 0;
+
+  /**
+   * @brief Rounds to the nearest even half, the values out of range become infinities and NaNs become a quiet NaN.
+   *
+   */
+  [[nodiscard]] static constexpr Half from_float(float value) {
+    constexpr auto kF32Infinity   = uint32_t{255} << 23;
+    constexpr auto kF16Max        = uint32_t{127 + 16} << 23;
+    constexpr auto kDenormMagic   = uint32_t{((127 - 15) + (23 - 10) + 1)} << 23;
+    constexpr auto kMinNormalized = uint32_t{113} << 23;
+
+    auto f          = std::bit_cast<uint32_t>(value);
+    const auto sign = f & 0x80000000U;
+    f ^= sign;
+
+    auto result = uint32_t{0};
+    if (f >= kF16Max) {
+      result = f > kF32Infinity ? 0x7E00U : 0x7C00U;
+    } else if (f < kMinNormalized) {
+      // Adding the magic aligns the 10 mantissa bits at the bottom, the float addition rounds to the nearest even
+      result = std::bit_cast<uint32_t>(std::bit_cast<float>(f) + std::bit_cast<float>(kDenormMagic)) - kDenormMagic;
+    } else {
+      const auto mantissa_odd = (f >> 13) & 1U;
+      f += static_cast<uint32_t>(15 - 127) << 23;
+      f += 0xFFFU + mantissa_odd;
+      result = f >> 13;
+    }
+
+    return Half{.bits = static_cast<uint16_t>(result | (sign >> 16))};
+  }
+
+  [[nodiscard]] constexpr float to_float() const {
+    constexpr auto kShiftedExponent = uint32_t{0x7C00} << 13;
+    constexpr auto kMagic           = uint32_t{113} << 23;
+
+    auto result         = (static_cast<uint32_t>(bits) & 0x7FFFU) << 13;
+    const auto exponent = result & kShiftedExponent;
+    result += static_cast<uint32_t>(127 - 15) << 23;
+    if (exponent == kShiftedExponent) {
+      // Infinity or NaN
+      result += static_cast<uint32_t>(128 - 16) << 23;
+    } else if (exponent == 0) {
+      // Zero or denormalized, renormalized by the float subtraction
+      result += uint32_t{1} << 23;
+      result = std::bit_cast<uint32_t>(std::bit_cast<float>(result) - std::bit_cast<float>(kMagic));
+    }
+
+    return std::bit_cast<float>(result | ((static_cast<uint32_t>(bits) & 0x8000U) << 16));
+  }
+};
+
+/**
+ * @brief `vk::Format::eR16G16Sfloat`.
+ *
+ */
+struct Half2 {
+  Half x;
+  Half y;
+
+  [[nodiscard]] static constexpr Half2 from_vec(const Vec2f& vec) {
+    return Half2{.x = Half::from_float(vec.x()), .y = Half::from_float(vec.y())};
+  }
+
+  [[nodiscard]] constexpr Vec2f to_vec() const { return Vec2f(x.to_float(), y.to_float()); }
+};
+
+/**
+ * @brief `vk::Format::eR16G16B16A16Sfloat`.
+ *
+ */
+struct Half4 {
+  Half x;
+  Half y;
+  Half z;
+  Half w;
+
+  [[nodiscard]] static constexpr Half4 from_vec(const Vec4f& vec) {
+    return Half4{
+        .x = Half::from_float(vec.x()),
+        .y = Half::from_float(vec.y()),
+        .z = Half::from_float(vec.z()),
+        .w = Half::from_float(vec.w()),
+    };
+  }
+
+  [[nodiscard]] constexpr Vec4f to_vec() const { return Vec4f(x.to_float(), y.to_float(), z.to_float(), w.to_float()); }
+};
+
+/**
+ * @brief Two signed normalized 16-bit integers, `vk::Format::eR16G16Snorm`. Holds the octahedral normals, see
+ * `oct_encode()`.
+ *
+ */
+struct Snorm16x2 {
+  int16_t x = 0;
+  int16_t y = 0;
+
+  static constexpr int32_t kMax = 32767;
+
+  [[nodiscard]] static constexpr Snorm16x2 from_vec(const Vec2f& vec) {
+    return Snorm16x2{
+        .x = static_cast<int16_t>(internal::to_snorm(vec.x(), kMax)),
+        .y = static_cast<int16_t>(internal::to_snorm(vec.y(), kMax)),
+    };
+  }
+
+  [[nodiscard]] constexpr Vec2f to_vec() const {
+    return Vec2f(internal::from_snorm(x, kMax), internal::from_snorm(y, kMax));
+  }
+};
+
+/**
+ * @brief Four unsigned normalized 8-bit integers, `vk::Format::eR8G8B8A8Unorm`, e.g. a color.
+ *
+ */
+struct Unorm8x4 {
+  uint8_t x = 0;
+  uint8_t y = 0;
+  uint8_t z = 0;
+  uint8_t w = 0;
+
+  [[nodiscard]] static constexpr Unorm8x4 from_vec(const Vec4f& vec) {
+    return Unorm8x4{
+        .x = static_cast<uint8_t>(internal::to_unorm(vec.x(), 255)),
+        .y = static_cast<uint8_t>(internal::to_unorm(vec.y(), 255)),
+        .z = static_cast<uint8_t>(internal::to_unorm(vec.z(), 255)),
+        .w = static_cast<uint8_t>(internal::to_unorm(vec.w(), 255)),
+    };
+  }
+
+  [[nodiscard]] constexpr Vec4f to_vec() const {
+    return Vec4f(static_cast<float>(x) / 255.F, static_cast<float>(y) / 255.F, static_cast<float>(z) / 255.F,
+                 static_cast<float>(w) / 255.F);
+  }
+};
+
+/**
+ * @brief Four unsigned normalized 16-bit integers, `vk::Format::eR16G16B16A16Unorm`. Holds the positions quantized
+ * relative to the bounding box of a mesh.
+ *
+ */
+struct Unorm16x4 {
+  uint16_t x = 0;
+  uint16_t y = 0;
+  uint16_t z = 0;
+  uint16_t w = 0;
+
+  static constexpr uint32_t kMax = 65535;
+
+  [[nodiscard]] static constexpr Unorm16x4 from_vec(const Vec4f& vec) {
+    return Unorm16x4{
+        .x = static_cast<uint16_t>(internal::to_unorm(vec.x(), kMax)),
+        .y = static_cast<uint16_t>(internal::to_unorm(vec.y(), kMax)),
+        .z = static_cast<uint16_t>(internal::to_unorm(vec.z(), kMax)),
+        .w = static_cast<uint16_t>(internal::to_unorm(vec.w(), kMax)),
+    };
+  }
+
+  [[nodiscard]] constexpr Vec4f to_vec() const {
+    constexpr auto kScale = 1.F / static_cast<float>(kMax);
+    return Vec4f(static_cast<float>(x) * kScale, static_cast<float>(y) * kScale, static_cast<float>(z) * kScale,
+                 static_cast<float>(w) * kScale);
+  }
+};
+
+/**
+ * @brief Three unsigned normalized 10-bit integers and a 2-bit one, `vk::Format::eA2B10G10R10UnormPack32`: x in the
+ * lowest bits and w in the highest ones.
+ *
+ */
+struct Unorm10x3_2 {
+  uint32_t bits = 0;
+
+  [[nodiscard]] static constexpr Unorm10x3_2 from_vec(const Vec4f& vec) {
+    return Unorm10x3_2{
+        .bits = internal::to_unorm(vec.x(), 1023) | (internal::to_unorm(vec.y(), 1023) << 10) |
+                (internal::to_unorm(vec.z(), 1023) << 20) | (internal::to_unorm(vec.w(), 3) << 30),
+    };
+  }
+
+  [[nodiscard]] constexpr Vec4f to_vec() const {
+    return Vec4f(static_cast<float>(bits & 0x3FFU) / 1023.F, static_cast<float>((bits >> 10) & 0x3FFU) / 1023.F,
+                 static_cast<float>((bits >> 20) & 0x3FFU) / 1023.F, static_cast<float>(bits >> 30) / 3.F);
+  }
+};
+
+/**
+ * @brief Signed variant of the `Unorm10x3_2`, `vk::Format::eA2B10G10R10SnormPack32`, e.g. a tangent with the
+ * bitangent sign in w.
+ *
+ */
+struct Snorm10x3_2 {
+  uint32_t bits = 0;
+
+  [[nodiscard]] static constexpr Snorm10x3_2 from_vec(const Vec4f& vec) {
+    const auto field = [](float value, int32_t max, uint32_t mask, uint32_t shift) {
+      return (static_cast<uint32_t>(internal::to_snorm(value, max)) & mask) << shift;
+    };
+    return Snorm10x3_2{
+        .bits = field(vec.x(), 511, 0x3FFU, 0) | field(vec.y(), 511, 0x3FFU, 10) | field(vec.z(), 511, 0x3FFU, 20) |
+                field(vec.w(), 1, 0x3U, 30),
+    };
+  }
+
+  [[nodiscard]] constexpr Vec4f to_vec() const {
+    // The arithmetic shift of the field moved to the top bits extends its sign
+    const auto field = [this](uint32_t width, uint32_t shift) {
+      return static_cast<int32_t>(bits << (32 - width - shift)) >> (32 - width);
+    };
+    return Vec4f(internal::from_snorm(field(10, 0), 511), internal::from_snorm(field(10, 10), 511),
+                 internal::from_snorm(field(10, 20), 511), internal::from_snorm(field(2, 30), 1));
+  }
+};
+
+static_assert(sizeof(Half) == 2 && sizeof(Half2) == 4 && sizeof(Half4) == 8);
+static_assert(sizeof(Snorm16x2) == 4 && sizeof(Unorm8x4) == 4 && sizeof(Unorm16x4) == 8);
+static_assert(sizeof(Unorm10x3_2) == 4 && sizeof(Snorm10x3_2) == 4);
+
+/**
+ * @brief Octahedral encoding of a unit vector: the vector is projected on the octahedron |x| + |y| + |z| = 1, whose
+ * lower half is folded over the upper one. 32 bits keep the direction with an error below 0.005 degrees.
+ *
+ * @param unit_normal
+ * @return Snorm16x2
+ */
+[[nodiscard]] inline Snorm16x2 oct_encode(const Vec3f& unit_normal) {
+  const auto sign     = [](float value) { return value >= 0.F ? 1.F : -1.F; };
+  const auto inv_norm = 1.F / (std::abs(unit_normal.x()) + std::abs(unit_normal.y()) + std::abs(unit_normal.z()));
+  auto x              = unit_normal.x() * inv_norm;
+  auto y              = unit_normal.y() * inv_norm;
+  if (unit_normal.z() < 0.F) {
+    const auto folded_x = (1.F - std::abs(y)) * sign(x);
+    y                   = (1.F - std::abs(x)) * sign(y);
+    x                   = folded_x;
+  }
+
+  return Snorm16x2::from_vec(Vec2f(x, y));
+}
+
+/**
+ * @brief Inverse of `oct_encode()`, returns a unit vector.
+ *
+ * @param encoded
+ * @return Vec3f
+ */
+[[nodiscard]] inline Vec3f oct_decode(const Snorm16x2& encoded) {
+  const auto vec = encoded.to_vec();
+  auto x         = vec.x();
+  auto y         = vec.y();
+  const auto z   = 1.F - std::abs(x) - std::abs(y);
+  const auto t   = std::max(-z, 0.F);
+  x += x >= 0.F ? -t : t;
+  y += y >= 0.F ? -t : t;
+
+  return Vec3f(x, y, z).normalized();
+}
+
+/**
+ * @brief Converts the floats to halves, 4 at a time when `simd::kHalfEnabled`.
+ *
+ * @param values
+ * @param out Must be at least as long as `values`.
+ */
+inline void to_halves(std::span<const float> values, std::span<Half> out) {
+  assert(out.size() >= values.size() && "Output must fit all of the values");
+
+  auto i = std::size_t{0};
+  if constexpr (simd::kHalfEnabled) {
+    for (; i + 4 <= values.size(); i += 4) {
+      simd::halves_from_floats4(&values[i], &out[i].bits);
+    }
+  }
+  for (; i < values.size(); ++i) {
+    out[i] = Half::from_float(values[i]);
+  }
+}
+
+/**
+ * @brief Converts the halves to floats, 4 at a time when `simd::kHalfEnabled`.
+ *
+ * @param halves
+ * @param out Must be at least as long as `halves`.
+ */
+inline void to_floats(std::span<const Half> halves, std::span<float> out) {
+  assert(out.size() >= halves.size() && "Output must fit all of the values");
+
+  auto i = std::size_t{0};
+  if constexpr (simd::kHalfEnabled) {
+    for (; i + 4 <= halves.size(); i += 4) {
+      simd::floats_from_halves4(&halves[i].bits, &out[i]);
+    }
+  }
+  for (; i < halves.size(); ++i) {
+    out[i] = halves[i].to_float();
+  }
+}
+
+/**
+ * @brief `oct_encode()` of every normal.
+ *
+ * @param unit_normals
+ * @param out Must be at least as long as `unit_normals`.
+ */
+inline void oct_encode_many(std::span<const Vec3f> unit_normals, std::span<Snorm16x2> out) {
+  assert(out.size() >= unit_normals.size() && "Output must fit all of the normals");
+  std::ranges::transform(unit_normals, out.begin(), oct_encode);
+}
+
+/**
+ * @brief `Unorm8x4::from_vec()` of every color.
+ *
+ * @param colors
+ * @param out Must be at least as long as `colors`.
+ */
+inline void to_unorm8x4_many(std::span<const Vec4f> colors, std::span<Unorm8x4> out) {
+  assert(out.size() >= colors.size() && "Output must fit all of the colors");
+  std::ranges::transform(colors, out.begin(), Unorm8x4::from_vec);
+}
+
+}  // namespace eray::math
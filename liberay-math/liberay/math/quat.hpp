@@ -4,7 +4,9 @@
 #include <liberay/math/mat.hpp>
 #include <liberay/math/mat_fwd.hpp>
 #include <liberay/math/quat_fwd.hpp>
+#include <liberay/math/simd.hpp>
 #include <liberay/math/types.hpp>
+#include <type_traits>
 
 namespace eray::math {
 
@@ -250,6 +252,14 @@ struct Quat {
   }
 
   [[nodiscard]] constexpr friend Quat operator*(Quat lhs, const Quat& rhs) {
+    if constexpr (kSimd) {
+      if (!std::is_constant_evaluated()) {
+        auto result = Quat();
+        simd::quat_mult(&lhs.w, &rhs.w, &result.w);
+        return result;
+      }
+    }
+
     return Quat{
         lhs.w * rhs.w - lhs.x * rhs.x - lhs.y * rhs.y - lhs.z * rhs.z,  // w
         lhs.w * rhs.x + lhs.x * rhs.w + lhs.y * rhs.z - lhs.z * rhs.y,  // x
@@ -342,7 +352,17 @@ struct Quat {
    */
   [[nodiscard]] constexpr Quat inversed() const { return conjugated() / norm_sq(); }
 
-  [[nodiscard]] constexpr Quat normalized() const { return *this / norm(); }
+  [[nodiscard]] constexpr Quat normalized() const {
+    if constexpr (kSimd) {
+      if (!std::is_constant_evaluated()) {
+        auto result = Quat();
+        simd::normalize4(&w, &result.w);
+        return result;
+      }
+    }
+
+    return *this / norm();
+  }
 
   /**
    * @brief Returns an affine 3D rotation matrix created from unit quaternion.
@@ -392,8 +412,18 @@ struct Quat {
                         Vec<3, T>{static_cast<T>(2) * (xz + wy), static_cast<T>(2) * (yz - wx),
                                   static_cast<T>(1) - static_cast<T>(2) * (xx + yy)}};
   }
+
+ private:
+  /**
+   * @brief True for the float quaternions, which use the `simd` backend outside of constant evaluation.
+   *
+   */
+  static constexpr bool kSimd = std::is_same_v<T, float> && simd::kEnabled;
 };
 
+// The SIMD backend reads the components as 4 contiguous floats starting at `w`
+static_assert(sizeof(Quat<float>) == 4 * sizeof(float) && std::is_standard_layout_v<Quat<float>>);
+
 /**
  * @brief Returns a real part of the quaternion.
  *
@@ -473,6 +503,11 @@ template <CFloatingPoint T>
 
 template <CFloatingPoint T>
 [[nodiscard]] constexpr T dot(const Quat<T>& quat1, const Quat<T>& quat2) {
+  if constexpr (std::is_same_v<T, float> && simd::kEnabled) {
+    if (!std::is_constant_evaluated()) {
+      return simd::dot4(&quat1.w, &quat2.w);
+    }
+  }
   return quat1.w * quat2.w + quat1.x * quat2.x + quat1.y * quat2.y + quat1.z * quat2.z;
 }
 
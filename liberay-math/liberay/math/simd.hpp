@@ -0,0 +1,895 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// The backend is selected at compile time from the target instruction set, define `ERAY_MATH_DISABLE_SIMD` to force
+// the generic code. SSE needs SSE4.1 (`-msse4.1`, implied by `-mavx2`), FMA is used when enabled (`-mfma`). NEON is
+// used on AArch64 only.
+#if !defined(ERAY_MATH_DISABLE_SIMD)
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define ERAY_MATH_SIMD_SSE 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define ERAY_MATH_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace eray::math::simd {
+
+/**
+ * @brief True if the 4-component float operations below use SIMD instructions. The math types call them for
+ * `Vec<4, float>`, `Mat<4, 4, float>` and `Quat<float>` outside of constant evaluation only, the generic `constexpr`
+ * code is used otherwise.
+ *
+ * All of the functions work on unaligned, contiguous floats: 4 for a vector or a quaternion (w, x, y, z) and 16 for
+ * a matrix (4 column vectors). The types keep their layout, the SIMD registers never leak into them.
+ *
+ */
+#if defined(ERAY_MATH_SIMD_SSE) || defined(ERAY_MATH_SIMD_NEON)
+inline constexpr bool kEnabled = true;
+#else
+inline constexpr bool kEnabled = false;
+#endif
+
+/**
+ * @brief True if the half float conversions below use SIMD instructions, they need F16C on x86 (`-mf16c`, implied by
+ * `-march` of the CPUs with AVX2) and are always available with NEON.
+ *
+ */
+#if (defined(ERAY_MATH_SIMD_SSE) && defined(__F16C__)) || defined(ERAY_MATH_SIMD_NEON)
+inline constexpr bool kHalfEnabled = true;
+#else
+inline constexpr bool kHalfEnabled = false;
+#endif
+
+#if defined(ERAY_MATH_SIMD_SSE)
+
+namespace internal {
+
+inline __m128 madd(__m128 a, __m128 b, __m128 c) {
+#if defined(__FMA__)
+  return _mm_fmadd_ps(a, b, c);
+#else
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+/**
+ * @brief `mat * vec` of a matrix already in the registers.
+ *
+ */
+inline __m128 mult_vec(const __m128 columns[4], __m128 vec) {
+  auto result = _mm_mul_ps(columns[0], _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(0, 0, 0, 0)));
+  result      = madd(columns[1], _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(1, 1, 1, 1)), result);
+  result      = madd(columns[2], _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(2, 2, 2, 2)), result);
+  return madd(columns[3], _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(3, 3, 3, 3)), result);
+}
+
+}  // namespace internal
+
+inline void mat4_mult(const float* lhs, const float* rhs, float* out) {
+  const __m128 columns[4] = {_mm_loadu_ps(lhs), _mm_loadu_ps(lhs + 4), _mm_loadu_ps(lhs + 8), _mm_loadu_ps(lhs + 12)};
+  for (auto j = 0; j < 4; ++j) {
+    _mm_storeu_ps(out + 4 * j, internal::mult_vec(columns, _mm_loadu_ps(rhs + 4 * j)));
+  }
+}
+
+inline void mat4_mult_vec(const float* mat, const float* vec, float* out) {
+  const __m128 columns[4] = {_mm_loadu_ps(mat), _mm_loadu_ps(mat + 4), _mm_loadu_ps(mat + 8), _mm_loadu_ps(mat + 12)};
+  _mm_storeu_ps(out, internal::mult_vec(columns, _mm_loadu_ps(vec)));
+}
+
+inline void vec_mult_mat4(const float* vec, const float* mat, float* out) {
+  // Every component is the dot product of the vector with a column
+  const auto v = _mm_loadu_ps(vec);
+  auto result  = _mm_dp_ps(v, _mm_loadu_ps(mat), 0xF1);
+  result       = _mm_or_ps(result, _mm_dp_ps(v, _mm_loadu_ps(mat + 4), 0xF2));
+  result       = _mm_or_ps(result, _mm_dp_ps(v, _mm_loadu_ps(mat + 8), 0xF4));
+  result       = _mm_or_ps(result, _mm_dp_ps(v, _mm_loadu_ps(mat + 12), 0xF8));
+  _mm_storeu_ps(out, result);
+}
+
+inline float dot4(const float* lhs, const float* rhs) {
+  return _mm_cvtss_f32(_mm_dp_ps(_mm_loadu_ps(lhs), _mm_loadu_ps(rhs), 0xF1));
+}
+
+inline void normalize4(const float* vec, float* out) {
+  const auto v = _mm_loadu_ps(vec);
+  _mm_storeu_ps(out, _mm_div_ps(v, _mm_sqrt_ps(_mm_dp_ps(v, v, 0xFF))));
+}
+
+/**
+ * @brief Hamilton product of two quaternions stored as (w, x, y, z).
+ *
+ */
+inline void quat_mult(const float* lhs, const float* rhs, float* out) {
+  const auto l = _mm_loadu_ps(lhs);
+  const auto r = _mm_loadu_ps(rhs);
+
+  // out = lw * (rw, rx, ry, rz) + lx * (-rx, rw, -rz, ry) + ly * (-ry, rz, rw, -rx) + lz * (-rz, -ry, rx, rw)
+  const auto a = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(-1.F, 1.F, -1.F, 1.F));
+  const auto b = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)), _mm_setr_ps(-1.F, 1.F, 1.F, -1.F));
+  const auto c = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 1, 2, 3)), _mm_setr_ps(-1.F, -1.F, 1.F, 1.F));
+  auto result  = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r);
+  result       = internal::madd(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), a, result);
+  result       = internal::madd(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), b, result);
+  result       = internal::madd(_mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3)), c, result);
+  _mm_storeu_ps(out, result);
+}
+
+inline void mat4_mult_many(const float* lhs, const float* rhs, std::size_t count, float* out) {
+  const __m128 columns[4] = {_mm_loadu_ps(lhs), _mm_loadu_ps(lhs + 4), _mm_loadu_ps(lhs + 8), _mm_loadu_ps(lhs + 12)};
+  for (auto i = std::size_t{0}; i < 4 * count; ++i) {
+    _mm_storeu_ps(out + 4 * i, internal::mult_vec(columns, _mm_loadu_ps(rhs + 4 * i)));
+  }
+}
+
+inline void mat4_mult_vec_many(const float* mat, const float* vecs, std::size_t count, float* out) {
+  const __m128 columns[4] = {_mm_loadu_ps(mat), _mm_loadu_ps(mat + 4), _mm_loadu_ps(mat + 8), _mm_loadu_ps(mat + 12)};
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    _mm_storeu_ps(out + 4 * i, internal::mult_vec(columns, _mm_loadu_ps(vecs + 4 * i)));
+  }
+}
+
+/**
+ * @brief Transforms 4 packed 3D vectors (12 floats) by a 4x4 matrix, `w` is their homogeneous coordinate. The
+ * vectors are transposed to the x, y and z registers, so every instruction works on all 4 of them.
+ *
+ */
+inline void mat4_transform_vec3x4(const float* mat, const float* vecs, float w, float* out) {
+  // a = (x0, y0, z0, x1), b = (y1, z1, x2, y2), c = (z2, x3, y3, z3)
+  const auto a = _mm_loadu_ps(vecs);
+  const auto b = _mm_loadu_ps(vecs + 4);
+  const auto c = _mm_loadu_ps(vecs + 8);
+  const auto x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+  const auto y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                                _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+  const auto z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                                _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+  __m128 rows[3];
+  for (auto i = 0; i < 3; ++i) {
+    rows[i] = _mm_set1_ps(mat[12 + i] * w);
+    rows[i] = internal::madd(_mm_set1_ps(mat[i]), x, rows[i]);
+    rows[i] = internal::madd(_mm_set1_ps(mat[4 + i]), y, rows[i]);
+    rows[i] = internal::madd(_mm_set1_ps(mat[8 + i]), z, rows[i]);
+  }
+
+  const auto& [rx, ry, rz] = rows;
+  _mm_storeu_ps(out, _mm_shuffle_ps(_mm_shuffle_ps(rx, ry, _MM_SHUFFLE(0, 0, 0, 0)),
+                                    _mm_shuffle_ps(rz, rx, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+  _mm_storeu_ps(out + 4, _mm_shuffle_ps(_mm_shuffle_ps(ry, rz, _MM_SHUFFLE(1, 1, 1, 1)),
+                                        _mm_shuffle_ps(rx, ry, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+  _mm_storeu_ps(out + 8, _mm_shuffle_ps(_mm_shuffle_ps(rz, rx, _MM_SHUFFLE(3, 3, 2, 2)),
+                                        _mm_shuffle_ps(ry, rz, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+namespace internal {
+
+inline __m128 cross3(__m128 lhs, __m128 rhs) {
+  const auto lhs_yzx = _mm_shuffle_ps(lhs, lhs, _MM_SHUFFLE(3, 0, 2, 1));
+  const auto rhs_yzx = _mm_shuffle_ps(rhs, rhs, _MM_SHUFFLE(3, 0, 2, 1));
+  const auto result  = _mm_sub_ps(_mm_mul_ps(lhs, rhs_yzx), _mm_mul_ps(lhs_yzx, rhs));
+  return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+/**
+ * @brief Writes the inverse of an affine matrix whose linear part inverse has the `rows`: their transpose and the
+ * translation `-(rows * t)`.
+ *
+ */
+inline void store_affine_inverse(__m128 rows[3], __m128 translation, float* out) {
+  auto last = _mm_setr_ps(0.F, 0.F, 0.F, 1.F);
+  _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], last);
+  auto t = _mm_mul_ps(rows[0], _mm_shuffle_ps(translation, translation, _MM_SHUFFLE(0, 0, 0, 0)));
+  t      = madd(rows[1], _mm_shuffle_ps(translation, translation, _MM_SHUFFLE(1, 1, 1, 1)), t);
+  t      = madd(rows[2], _mm_shuffle_ps(translation, translation, _MM_SHUFFLE(2, 2, 2, 2)), t);
+  _mm_storeu_ps(out, rows[0]);
+  _mm_storeu_ps(out + 4, rows[1]);
+  _mm_storeu_ps(out + 8, rows[2]);
+  _mm_storeu_ps(out + 12, _mm_sub_ps(_mm_setr_ps(0.F, 0.F, 0.F, 1.F), t));
+}
+
+}  // namespace internal
+
+inline void mat4_inverse_rigid(const float* mat, float* out) {
+  __m128 rows[3] = {_mm_loadu_ps(mat), _mm_loadu_ps(mat + 4), _mm_loadu_ps(mat + 8)};
+  internal::store_affine_inverse(rows, _mm_loadu_ps(mat + 12), out);
+}
+
+inline void mat4_inverse_affine(const float* mat, float* out) {
+  // The rows of the inverse of the linear part are the cross products of its columns divided by the determinant
+  const auto c0      = _mm_loadu_ps(mat);
+  const auto c1      = _mm_loadu_ps(mat + 4);
+  const auto c2      = _mm_loadu_ps(mat + 8);
+  const auto r0      = internal::cross3(c1, c2);
+  const auto inv_det = _mm_div_ps(_mm_set1_ps(1.F), _mm_dp_ps(c0, r0, 0x7F));
+  __m128 rows[3]     = {_mm_mul_ps(r0, inv_det), _mm_mul_ps(internal::cross3(c2, c0), inv_det),
+                        _mm_mul_ps(internal::cross3(c0, c1), inv_det)};
+  internal::store_affine_inverse(rows, _mm_loadu_ps(mat + 12), out);
+}
+
+#if defined(__F16C__)
+
+/**
+ * @brief Converts 4 floats to half floats (the raw bits), rounding to the nearest even.
+ *
+ */
+inline void halves_from_floats4(const float* in, uint16_t* out) {
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_cvtps_ph(_mm_loadu_ps(in), _MM_FROUND_TO_NEAREST_INT));
+}
+
+inline void floats_from_halves4(const uint16_t* in, float* out) {
+  _mm_storeu_ps(out, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in))));
+}
+
+#endif
+
+namespace internal {
+
+// Primitives of the structure of arrays kernels below, every lane holds a component of another element
+
+using Float4 = __m128;
+using Mask4  = __m128;
+
+inline Float4 load(const float* src) { return _mm_loadu_ps(src); }
+inline void store(float* dst, Float4 v) { _mm_storeu_ps(dst, v); }
+inline Float4 splat(float v) { return _mm_set1_ps(v); }
+inline Float4 add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+inline Float4 div(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+inline Float4 min(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+inline Float4 sqrt(Float4 v) { return _mm_sqrt_ps(v); }
+inline Float4 abs(Float4 v) { return _mm_andnot_ps(_mm_set1_ps(-0.F), v); }
+inline Float4 max(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+inline Float4 round(Float4 v) { return _mm_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline Mask4 less_than(Float4 a, Float4 b) { return _mm_cmplt_ps(a, b); }
+inline Mask4 less_equal(Float4 a, Float4 b) { return _mm_cmple_ps(a, b); }
+inline Mask4 mask_or(Mask4 a, Mask4 b) { return _mm_or_ps(a, b); }
+inline Mask4 mask_false() { return _mm_setzero_ps(); }
+inline Float4 select(Mask4 mask, Float4 a, Float4 b) { return _mm_blendv_ps(b, a, mask); }
+
+/**
+ * @brief Bit i of the result is set if the lane i of the mask is set.
+ *
+ */
+inline uint32_t mask_bits(Mask4 mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+
+/**
+ * @brief Negates the lanes of `v` where `sign` is negative.
+ *
+ */
+inline Float4 mult_sign(Float4 v, Float4 sign) { return _mm_xor_ps(v, _mm_and_ps(sign, _mm_set1_ps(-0.F))); }
+
+/**
+ * @brief Reciprocal square root estimate refined with a Newton step, about 22 bits of precision.
+ *
+ */
+inline Float4 rsqrt(Float4 v) {
+  const auto y = _mm_rsqrt_ps(v);
+  return mul(y, sub(splat(1.5F), mul(mul(splat(0.5F), v), mul(y, y))));
+}
+
+inline void transpose(Float4 (&v)[4]) { _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]); }
+
+}  // namespace internal
+
+#elif defined(ERAY_MATH_SIMD_NEON)
+
+namespace internal {
+
+inline float32x4_t mult_vec(const float32x4_t columns[4], float32x4_t vec) {
+  auto result = vmulq_laneq_f32(columns[0], vec, 0);
+  result      = vfmaq_laneq_f32(result, columns[1], vec, 1);
+  result      = vfmaq_laneq_f32(result, columns[2], vec, 2);
+  return vfmaq_laneq_f32(result, columns[3], vec, 3);
+}
+
+}  // namespace internal
+
+inline void mat4_mult(const float* lhs, const float* rhs, float* out) {
+  const float32x4_t columns[4] = {vld1q_f32(lhs), vld1q_f32(lhs + 4), vld1q_f32(lhs + 8), vld1q_f32(lhs + 12)};
+  for (auto j = 0; j < 4; ++j) {
+    vst1q_f32(out + 4 * j, internal::mult_vec(columns, vld1q_f32(rhs + 4 * j)));
+  }
+}
+
+inline void mat4_mult_vec(const float* mat, const float* vec, float* out) {
+  const float32x4_t columns[4] = {vld1q_f32(mat), vld1q_f32(mat + 4), vld1q_f32(mat + 8), vld1q_f32(mat + 12)};
+  vst1q_f32(out, internal::mult_vec(columns, vld1q_f32(vec)));
+}
+
+inline void vec_mult_mat4(const float* vec, const float* mat, float* out) {
+  // Every component is the dot product of the vector with a column, the pairwise adds reduce all four at once
+  const auto v  = vld1q_f32(vec);
+  const auto p0 = vmulq_f32(v, vld1q_f32(mat));
+  const auto p1 = vmulq_f32(v, vld1q_f32(mat + 4));
+  const auto p2 = vmulq_f32(v, vld1q_f32(mat + 8));
+  const auto p3 = vmulq_f32(v, vld1q_f32(mat + 12));
+  vst1q_f32(out, vpaddq_f32(vpaddq_f32(p0, p1), vpaddq_f32(p2, p3)));
+}
+
+inline float dot4(const float* lhs, const float* rhs) { return vaddvq_f32(vmulq_f32(vld1q_f32(lhs), vld1q_f32(rhs))); }
+
+inline void normalize4(const float* vec, float* out) {
+  const auto v = vld1q_f32(vec);
+  vst1q_f32(out, vdivq_f32(v, vdupq_n_f32(std::sqrt(vaddvq_f32(vmulq_f32(v, v))))));
+}
+
+/**
+ * @brief Hamilton product of two quaternions stored as (w, x, y, z).
+ *
+ */
+inline void quat_mult(const float* lhs, const float* rhs, float* out) {
+  const auto l = vld1q_f32(lhs);
+  const auto r = vld1q_f32(rhs);
+
+  // out = lw * (rw, rx, ry, rz) + lx * (-rx, rw, -rz, ry) + ly * (-ry, rz, rw, -rx) + lz * (-rz, -ry, rx, rw)
+  static constexpr float kSignsA[4] = {-1.F, 1.F, -1.F, 1.F};
+  static constexpr float kSignsB[4] = {-1.F, 1.F, 1.F, -1.F};
+  static constexpr float kSignsC[4] = {-1.F, -1.F, 1.F, 1.F};
+  const auto swapped                = vextq_f32(r, r, 2);
+  const auto a                      = vmulq_f32(vrev64q_f32(r), vld1q_f32(kSignsA));
+  const auto b                      = vmulq_f32(swapped, vld1q_f32(kSignsB));
+  const auto c                      = vmulq_f32(vrev64q_f32(swapped), vld1q_f32(kSignsC));
+  auto result                       = vmulq_laneq_f32(r, l, 0);
+  result                            = vfmaq_laneq_f32(result, a, l, 1);
+  result                            = vfmaq_laneq_f32(result, b, l, 2);
+  result                            = vfmaq_laneq_f32(result, c, l, 3);
+  vst1q_f32(out, result);
+}
+
+inline void mat4_mult_many(const float* lhs, const float* rhs, std::size_t count, float* out) {
+  const float32x4_t columns[4] = {vld1q_f32(lhs), vld1q_f32(lhs + 4), vld1q_f32(lhs + 8), vld1q_f32(lhs + 12)};
+  for (auto i = std::size_t{0}; i < 4 * count; ++i) {
+    vst1q_f32(out + 4 * i, internal::mult_vec(columns, vld1q_f32(rhs + 4 * i)));
+  }
+}
+
+inline void mat4_mult_vec_many(const float* mat, const float* vecs, std::size_t count, float* out) {
+  const float32x4_t columns[4] = {vld1q_f32(mat), vld1q_f32(mat + 4), vld1q_f32(mat + 8), vld1q_f32(mat + 12)};
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    vst1q_f32(out + 4 * i, internal::mult_vec(columns, vld1q_f32(vecs + 4 * i)));
+  }
+}
+
+/**
+ * @brief Transforms 4 packed 3D vectors (12 floats) by a 4x4 matrix, `w` is their homogeneous coordinate. The
+ * structure loads transpose the vectors to the x, y and z registers, so every instruction works on all 4 of them.
+ *
+ */
+inline void mat4_transform_vec3x4(const float* mat, const float* vecs, float w, float* out) {
+  const auto xyz = vld3q_f32(vecs);
+  auto result    = float32x4x3_t{};
+  for (auto i = 0; i < 3; ++i) {
+    result.val[i] = vdupq_n_f32(mat[12 + i] * w);
+    result.val[i] = vfmaq_n_f32(result.val[i], xyz.val[0], mat[i]);
+    result.val[i] = vfmaq_n_f32(result.val[i], xyz.val[1], mat[4 + i]);
+    result.val[i] = vfmaq_n_f32(result.val[i], xyz.val[2], mat[8 + i]);
+  }
+  vst3q_f32(out, result);
+}
+
+namespace internal {
+
+inline float32x4_t cross3(float32x4_t lhs, float32x4_t rhs) {
+  // Byte indices of the (y, z, x, w) lanes
+  static constexpr uint8_t kYzx[16] = {4, 5, 6, 7, 8, 9, 10, 11, 0, 1, 2, 3, 12, 13, 14, 15};
+  const auto yzx     = vld1q_u8(kYzx);
+  const auto lhs_yzx = vreinterpretq_f32_u8(vqtbl1q_u8(vreinterpretq_u8_f32(lhs), yzx));
+  const auto rhs_yzx = vreinterpretq_f32_u8(vqtbl1q_u8(vreinterpretq_u8_f32(rhs), yzx));
+  const auto result  = vfmsq_f32(vmulq_f32(lhs, rhs_yzx), lhs_yzx, rhs);
+  return vreinterpretq_f32_u8(vqtbl1q_u8(vreinterpretq_u8_f32(result), yzx));
+}
+
+/**
+ * @brief Writes the inverse of an affine matrix whose linear part inverse has the `rows`: their transpose and the
+ * translation `-(rows * t)`.
+ *
+ */
+inline void store_affine_inverse(const float32x4_t rows[3], float32x4_t translation, float* out) {
+  static constexpr float kLast[4] = {0.F, 0.F, 0.F, 1.F};
+  const auto last                 = vld1q_f32(kLast);
+  const auto r01                  = vtrnq_f32(rows[0], rows[1]);
+  const auto r23                  = vtrnq_f32(rows[2], last);
+  const auto c0                   = vcombine_f32(vget_low_f32(r01.val[0]), vget_low_f32(r23.val[0]));
+  const auto c1                   = vcombine_f32(vget_low_f32(r01.val[1]), vget_low_f32(r23.val[1]));
+  const auto c2                   = vcombine_f32(vget_high_f32(r01.val[0]), vget_high_f32(r23.val[0]));
+  auto t                          = vmulq_laneq_f32(c0, translation, 0);
+  t                               = vfmaq_laneq_f32(t, c1, translation, 1);
+  t                               = vfmaq_laneq_f32(t, c2, translation, 2);
+  vst1q_f32(out, c0);
+  vst1q_f32(out + 4, c1);
+  vst1q_f32(out + 8, c2);
+  vst1q_f32(out + 12, vsubq_f32(last, t));
+}
+
+}  // namespace internal
+
+inline void mat4_inverse_rigid(const float* mat, float* out) {
+  const float32x4_t rows[3] = {vld1q_f32(mat), vld1q_f32(mat + 4), vld1q_f32(mat + 8)};
+  internal::store_affine_inverse(rows, vld1q_f32(mat + 12), out);
+}
+
+inline void mat4_inverse_affine(const float* mat, float* out) {
+  // The rows of the inverse of the linear part are the cross products of its columns divided by the determinant
+  static constexpr float kXyz[4] = {1.F, 1.F, 1.F, 0.F};
+  const auto c0                  = vld1q_f32(mat);
+  const auto c1                  = vld1q_f32(mat + 4);
+  const auto c2                  = vld1q_f32(mat + 8);
+  const auto r0                  = internal::cross3(c1, c2);
+  const auto inv_det             = 1.F / vaddvq_f32(vmulq_f32(vmulq_f32(c0, r0), vld1q_f32(kXyz)));
+  const float32x4_t rows[3]      = {vmulq_n_f32(r0, inv_det), vmulq_n_f32(internal::cross3(c2, c0), inv_det),
+                                    vmulq_n_f32(internal::cross3(c0, c1), inv_det)};
+  internal::store_affine_inverse(rows, vld1q_f32(mat + 12), out);
+}
+
+/**
+ * @brief Converts 4 floats to half floats (the raw bits), rounding to the nearest even.
+ *
+ */
+inline void halves_from_floats4(const float* in, uint16_t* out) {
+  vst1_u16(out, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in))));
+}
+
+inline void floats_from_halves4(const uint16_t* in, float* out) {
+  vst1q_f32(out, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(in))));
+}
+
+namespace internal {
+
+// Primitives of the structure of arrays kernels below, every lane holds a component of another element
+
+using Float4 = float32x4_t;
+using Mask4  = uint32x4_t;
+
+inline Float4 load(const float* src) { return vld1q_f32(src); }
+inline void store(float* dst, Float4 v) { vst1q_f32(dst, v); }
+inline Float4 splat(float v) { return vdupq_n_f32(v); }
+inline Float4 add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+inline Float4 sub(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+inline Float4 mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+inline Float4 div(Float4 a, Float4 b) { return vdivq_f32(a, b); }
+inline Float4 min(Float4 a, Float4 b) { return vminq_f32(a, b); }
+inline Float4 sqrt(Float4 v) { return vsqrtq_f32(v); }
+inline Float4 abs(Float4 v) { return vabsq_f32(v); }
+inline Float4 madd(Float4 a, Float4 b, Float4 c) { return vfmaq_f32(c, a, b); }
+inline Float4 max(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+inline Float4 round(Float4 v) { return vrndnq_f32(v); }
+inline Mask4 less_than(Float4 a, Float4 b) { return vcltq_f32(a, b); }
+inline Mask4 less_equal(Float4 a, Float4 b) { return vcleq_f32(a, b); }
+inline Mask4 mask_or(Mask4 a, Mask4 b) { return vorrq_u32(a, b); }
+inline Mask4 mask_false() { return vdupq_n_u32(0); }
+inline Float4 select(Mask4 mask, Float4 a, Float4 b) { return vbslq_f32(mask, a, b); }
+
+/**
+ * @brief Bit i of the result is set if the lane i of the mask is set.
+ *
+ */
+inline uint32_t mask_bits(Mask4 mask) {
+  constexpr uint32_t kBits[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(mask, vld1q_u32(kBits)));
+}
+
+/**
+ * @brief Negates the lanes of `v` where `sign` is negative.
+ *
+ */
+inline Float4 mult_sign(Float4 v, Float4 sign) {
+  const auto sign_bits = vandq_u32(vreinterpretq_u32_f32(sign), vdupq_n_u32(0x80000000U));
+  return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(v), sign_bits));
+}
+
+/**
+ * @brief Reciprocal square root estimate refined with two Newton steps (the estimate has only 8 bits), about 22 bits
+ * of precision.
+ *
+ */
+inline Float4 rsqrt(Float4 v) {
+  auto y = vrsqrteq_f32(v);
+  y      = vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(v, y), y));
+  return vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(v, y), y));
+}
+
+inline void transpose(Float4 (&v)[4]) {
+  const auto v01 = vtrnq_f32(v[0], v[1]);
+  const auto v23 = vtrnq_f32(v[2], v[3]);
+  v[0]           = vcombine_f32(vget_low_f32(v01.val[0]), vget_low_f32(v23.val[0]));
+  v[1]           = vcombine_f32(vget_low_f32(v01.val[1]), vget_low_f32(v23.val[1]));
+  v[2]           = vcombine_f32(vget_high_f32(v01.val[0]), vget_high_f32(v23.val[0]));
+  v[3]           = vcombine_f32(vget_high_f32(v01.val[1]), vget_high_f32(v23.val[1]));
+}
+
+}  // namespace internal
+
+#else
+
+// Declared only, the math types refer to them in the discarded `if constexpr (kEnabled)` branches
+void mat4_mult(const float* lhs, const float* rhs, float* out);
+void mat4_mult_vec(const float* mat, const float* vec, float* out);
+void vec_mult_mat4(const float* vec, const float* mat, float* out);
+float dot4(const float* lhs, const float* rhs);
+void normalize4(const float* vec, float* out);
+void quat_mult(const float* lhs, const float* rhs, float* out);
+void mat4_mult_many(const float* lhs, const float* rhs, std::size_t count, float* out);
+void mat4_mult_vec_many(const float* mat, const float* vecs, std::size_t count, float* out);
+void mat4_transform_vec3x4(const float* mat, const float* vecs, float w, float* out);
+void mat4_inverse_rigid(const float* mat, float* out);
+void mat4_inverse_affine(const float* mat, float* out);
+void quat_mult_x4(const float* lhs, const float* rhs, float* out);
+void quat_normalize_x4(const float* quats, float* out);
+void quat_nlerp_x4(const float* start, const float* end, float t, float* out);
+void quat_slerp_x4(const float* start, const float* end, float t, float* out);
+void quat_to_mat4_x4(const float* unit_quats, float* out);
+void aabb_transform(const float* mat, const float* box, float* out);
+uint32_t frustum_aabb_x4(const float* const planes[4], std::size_t plane_count, const float* boxes);
+uint32_t ray_aabb_x4(const float* origin, const float* inv_direction, float t_max, const float* boxes, float* t_near);
+void rsqrt_x4(const float* in, float* out);
+void fast_sin_x4(const float* in, float* out);
+void fast_cos_x4(const float* in, float* out);
+void fast_atan2_x4(const float* y, const float* x, float* out);
+void fast_acos_x4(const float* in, float* out);
+
+#endif
+
+#if !(defined(ERAY_MATH_SIMD_SSE) && defined(__F16C__)) && !defined(ERAY_MATH_SIMD_NEON)
+
+// Declared only, see `kHalfEnabled`
+void halves_from_floats4(const float* in, uint16_t* out);
+void floats_from_halves4(const uint16_t* in, float* out);
+
+#endif
+
+#if defined(ERAY_MATH_SIMD_SSE) || defined(ERAY_MATH_SIMD_NEON)
+
+// == Quaternion kernels ==============================================================================================
+//
+// The kernels work on 4 quaternions (16 floats) at a time, transposed to the w, x, y and z registers. All of the
+// inputs are loaded before the output is stored, so the output may alias an input.
+
+namespace internal {
+
+struct Quat4 {
+  Float4 w, x, y, z;
+};
+
+inline Quat4 load_quat4(const float* src) {
+  Float4 v[4] = {load(src), load(src + 4), load(src + 8), load(src + 12)};
+  transpose(v);
+  return Quat4{.w = v[0], .x = v[1], .y = v[2], .z = v[3]};
+}
+
+inline void store_quat4(float* dst, const Quat4& q) {
+  Float4 v[4] = {q.w, q.x, q.y, q.z};
+  transpose(v);
+  for (auto i = 0; i < 4; ++i) {
+    store(dst + 4 * i, v[i]);
+  }
+}
+
+inline Float4 dot(const Quat4& a, const Quat4& b) {
+  return madd(a.z, b.z, madd(a.y, b.y, madd(a.x, b.x, mul(a.w, b.w))));
+}
+
+inline Quat4 scaled(const Quat4& q, Float4 s) { return Quat4{mul(q.w, s), mul(q.x, s), mul(q.y, s), mul(q.z, s)}; }
+
+inline Quat4 normalized(const Quat4& q) { return scaled(q, rsqrt(dot(q, q))); }
+
+/**
+ * @brief `wa * a + wb * b`.
+ *
+ */
+inline Quat4 blend(const Quat4& a, Float4 wa, const Quat4& b, Float4 wb) {
+  return Quat4{madd(b.w, wb, mul(a.w, wa)), madd(b.x, wb, mul(a.x, wa)), madd(b.y, wb, mul(a.y, wa)),
+               madd(b.z, wb, mul(a.z, wa))};
+}
+
+/**
+ * @brief Flips `end` to the hemisphere of `start`, so the interpolation takes the shorter arc. Returns the cosine of
+ * the angle between them, which is not negative.
+ *
+ */
+inline Float4 to_shorter_arc(const Quat4& start, Quat4& end) {
+  const auto cos = dot(start, end);
+  end            = Quat4{mult_sign(end.w, cos), mult_sign(end.x, cos), mult_sign(end.y, cos), mult_sign(end.z, cos)};
+  return abs(cos);
+}
+
+/**
+ * @brief `acos(x)` for x in [0, 1], Abramowitz and Stegun 4.4.46, the absolute error is below 2e-8.
+ *
+ */
+inline Float4 acos_unit(Float4 x) {
+  auto poly = splat(-0.0012624911F);
+  poly      = madd(poly, x, splat(0.0066700901F));
+  poly      = madd(poly, x, splat(-0.0170881256F));
+  poly      = madd(poly, x, splat(0.0308918810F));
+  poly      = madd(poly, x, splat(-0.0501743046F));
+  poly      = madd(poly, x, splat(0.0889789874F));
+  poly      = madd(poly, x, splat(-0.2145988016F));
+  poly      = madd(poly, x, splat(1.5707963050F));
+  return mul(sqrt(sub(splat(1.F), x)), poly);
+}
+
+/**
+ * @brief `sin(x)` for x in [0, pi/2], Taylor polynomial of the 11th degree, the absolute error is below 1e-7.
+ *
+ */
+inline Float4 sin_half_pi(Float4 x) {
+  const auto x2 = mul(x, x);
+  auto poly     = splat(-1.F / 39916800.F);
+  poly          = madd(poly, x2, splat(1.F / 362880.F));
+  poly          = madd(poly, x2, splat(-1.F / 5040.F));
+  poly          = madd(poly, x2, splat(1.F / 120.F));
+  poly          = madd(poly, x2, splat(-1.F / 6.F));
+  poly          = madd(poly, x2, splat(1.F));
+  return mul(x, poly);
+}
+
+}  // namespace internal
+
+inline void quat_mult_x4(const float* lhs, const float* rhs, float* out) {
+  using namespace internal;  // NOLINT
+  const auto l = load_quat4(lhs);
+  const auto r = load_quat4(rhs);
+  store_quat4(out, Quat4{
+                       .w = sub(sub(sub(mul(l.w, r.w), mul(l.x, r.x)), mul(l.y, r.y)), mul(l.z, r.z)),
+                       .x = sub(add(add(mul(l.w, r.x), mul(l.x, r.w)), mul(l.y, r.z)), mul(l.z, r.y)),
+                       .y = add(add(sub(mul(l.w, r.y), mul(l.x, r.z)), mul(l.y, r.w)), mul(l.z, r.x)),
+                       .z = add(sub(add(mul(l.w, r.z), mul(l.x, r.y)), mul(l.y, r.x)), mul(l.z, r.w)),
+                   });
+}
+
+inline void quat_normalize_x4(const float* quats, float* out) {
+  internal::store_quat4(out, internal::normalized(internal::load_quat4(quats)));
+}
+
+inline void quat_nlerp_x4(const float* start, const float* end, float t, float* out) {
+  using namespace internal;  // NOLINT
+  const auto a = load_quat4(start);
+  auto b       = load_quat4(end);
+  to_shorter_arc(a, b);
+  store_quat4(out, normalized(blend(a, splat(1.F - t), b, splat(t))));
+}
+
+inline void quat_slerp_x4(const float* start, const float* end, float t, float* out) {
+  using namespace internal;  // NOLINT
+  const auto a     = load_quat4(start);
+  auto b           = load_quat4(end);
+  const auto angle = acos_unit(min(to_shorter_arc(a, b), splat(1.F)));
+  const auto sin_a = sin_half_pi(angle);
+
+  // Nearly parallel quaternions fall back to nlerp, the final normalization also absorbs the approximation error
+  const auto nlerp = less_than(sin_a, splat(1e-5F));
+  const auto wa    = select(nlerp, splat(1.F - t), div(sin_half_pi(mul(splat(1.F - t), angle)), sin_a));
+  const auto wb    = select(nlerp, splat(t), div(sin_half_pi(mul(splat(t), angle)), sin_a));
+  store_quat4(out, normalized(blend(a, wa, b, wb)));
+}
+
+/**
+ * @brief Rotation matrices of 4 unit quaternions, `out` holds 64 floats.
+ *
+ */
+inline void quat_to_mat4_x4(const float* unit_quats, float* out) {
+  using namespace internal;  // NOLINT
+  const auto q   = load_quat4(unit_quats);
+  const auto two = splat(2.F);
+  const auto one = splat(1.F);
+  const auto xx  = mul(q.x, q.x);
+  const auto yy  = mul(q.y, q.y);
+  const auto zz  = mul(q.z, q.z);
+  const auto xy  = mul(q.x, q.y);
+  const auto xz  = mul(q.x, q.z);
+  const auto yz  = mul(q.y, q.z);
+  const auto wx  = mul(q.w, q.x);
+  const auto wy  = mul(q.w, q.y);
+  const auto wz  = mul(q.w, q.z);
+
+  // Every row holds an entry of the 4 matrices, a transpose turns the 4 rows of a column into the columns of the 4
+  // matrices
+  Float4 columns[3][4] = {
+      {sub(one, mul(two, add(yy, zz))), mul(two, add(xy, wz)), mul(two, sub(xz, wy)), splat(0.F)},
+      {mul(two, sub(xy, wz)), sub(one, mul(two, add(xx, zz))), mul(two, add(yz, wx)), splat(0.F)},
+      {mul(two, add(xz, wy)), mul(two, sub(yz, wx)), sub(one, mul(two, add(xx, yy))), splat(0.F)},
+  };
+  for (auto c = 0; c < 3; ++c) {
+    transpose(columns[c]);
+    for (auto m = 0; m < 4; ++m) {
+      store(out + 16 * m + 4 * c, columns[c][m]);
+    }
+  }
+  for (auto m = 0; m < 4; ++m) {
+    store(out + 16 * m + 12, splat(0.F));
+    out[16 * m + 15] = 1.F;
+  }
+}
+
+// == Bounding volume kernels =========================================================================================
+//
+// A box is 6 floats: the min and the max corner. The kernels test 4 boxes (24 floats) at a time, transposed to the
+// registers of the min and max coordinates.
+
+namespace internal {
+
+struct Aabb4 {
+  Float4 min[3];
+  Float4 max[3];
+};
+
+inline Aabb4 load_aabb4(const float* boxes) {
+  // Rows (min x, min y, min z, max x) and (min z, max x, max y, max z) of the boxes
+  Float4 low[4]  = {load(boxes), load(boxes + 6), load(boxes + 12), load(boxes + 18)};
+  Float4 high[4] = {load(boxes + 2), load(boxes + 8), load(boxes + 14), load(boxes + 20)};
+  transpose(low);
+  transpose(high);
+  return Aabb4{.min = {low[0], low[1], low[2]}, .max = {high[1], high[2], high[3]}};
+}
+
+}  // namespace internal
+
+/**
+ * @brief Bounds of the box transformed by the affine matrix, the extent is transformed by the absolute values of the
+ * linear part.
+ *
+ */
+inline void aabb_transform(const float* mat, const float* box, float* out) {
+  using namespace internal;  // NOLINT
+  const float center[3] = {(box[0] + box[3]) * 0.5F, (box[1] + box[4]) * 0.5F, (box[2] + box[5]) * 0.5F};
+  const float extent[3] = {(box[3] - box[0]) * 0.5F, (box[4] - box[1]) * 0.5F, (box[5] - box[2]) * 0.5F};
+
+  auto new_center = load(mat + 12);
+  auto new_extent = splat(0.F);
+  for (auto j = 0; j < 3; ++j) {
+    const auto column = load(mat + 4 * j);
+    new_center        = madd(column, splat(center[j]), new_center);
+    new_extent        = madd(abs(column), splat(extent[j]), new_extent);
+  }
+
+  float corners[2][4];
+  store(corners[0], sub(new_center, new_extent));
+  store(corners[1], add(new_center, new_extent));
+  for (auto i = 0; i < 3; ++i) {
+    out[i]     = corners[0][i];
+    out[3 + i] = corners[1][i];
+  }
+}
+
+/**
+ * @brief Tests 4 boxes against the planes `n * p + d >= 0`, given as the arrays of nx, ny, nz and d. Bit i of the
+ * result is set if box i is not outside of any plane.
+ *
+ */
+inline uint32_t frustum_aabb_x4(const float* const planes[4], std::size_t plane_count, const float* boxes) {
+  using namespace internal;  // NOLINT
+  const auto box = load_aabb4(boxes);
+  Float4 center[3];
+  Float4 extent[3];
+  for (auto k = 0; k < 3; ++k) {
+    center[k] = mul(add(box.min[k], box.max[k]), splat(0.5F));
+    extent[k] = mul(sub(box.max[k], box.min[k]), splat(0.5F));
+  }
+
+  auto outside = mask_false();
+  for (auto i = std::size_t{0}; i < plane_count; ++i) {
+    auto distance = splat(planes[3][i]);
+    auto radius   = splat(0.F);
+    for (auto k = 0; k < 3; ++k) {
+      distance = madd(splat(planes[k][i]), center[k], distance);
+      radius   = madd(splat(std::abs(planes[k][i])), extent[k], radius);
+    }
+    outside = mask_or(outside, less_than(add(distance, radius), splat(0.F)));
+  }
+  return ~mask_bits(outside) & 0xFU;
+}
+
+/**
+ * @brief Slab test of a ray against 4 boxes. Bit i of the result is set if the ray enters box i within [0, t_max],
+ * `t_near[i]` is then the entry distance (0 for a ray starting inside of the box). A ray parallel to a slab
+ * and starting exactly on its boundary plane gives an unspecified result.
+ *
+ */
+inline uint32_t ray_aabb_x4(const float* origin, const float* inv_direction, float t_max, const float* boxes,
+                            float* t_near) {
+  using namespace internal;  // NOLINT
+  const auto box = load_aabb4(boxes);
+  auto t_enter   = splat(0.F);
+  auto t_exit    = splat(t_max);
+  for (auto k = 0; k < 3; ++k) {
+    const auto o   = splat(origin[k]);
+    const auto inv = splat(inv_direction[k]);
+    const auto t0  = mul(sub(box.min[k], o), inv);
+    const auto t1  = mul(sub(box.max[k], o), inv);
+    t_enter        = max(min(t0, t1), t_enter);
+    t_exit         = min(max(t0, t1), t_exit);
+  }
+  store(t_near, t_enter);
+  return mask_bits(less_equal(t_enter, t_exit));
+}
+
+// == Approximate math kernels ========================================================================================
+//
+// SIMD variants of the functions of `fast_math.hpp`, with the same polynomials and error bounds.
+
+namespace internal {
+
+/**
+ * @brief `x` minus the nearest multiple of 2 pi (Cody-Waite), in [-pi, pi].
+ *
+ */
+inline Float4 reduce_two_pi(Float4 x) {
+  constexpr auto kTwoPiHigh = 6.28125F;
+  constexpr auto kTwoPiLow  = 1.9353071795864769e-3F;
+
+  const auto turns = round(mul(x, splat(0.5F / 3.14159265358979F)));
+  return sub(sub(x, mul(turns, splat(kTwoPiHigh))), mul(turns, splat(kTwoPiLow)));
+}
+
+inline Float4 fast_sin(Float4 x) {
+  constexpr auto kPi = 3.14159265358979F;
+
+  // Folds to [-pi/2, pi/2] with sin(x) = sin(+-pi - x)
+  auto r          = reduce_two_pi(x);
+  const auto fold = less_than(splat(kPi / 2.F), abs(r));
+  r               = select(fold, sub(mult_sign(splat(kPi), r), r), r);
+  return sin_half_pi(r);
+}
+
+inline Float4 fast_cos(Float4 x) { return sin_half_pi(sub(splat(3.14159265358979F / 2.F), abs(reduce_two_pi(x)))); }
+
+inline Float4 fast_atan2(Float4 y, Float4 x) {
+  constexpr auto kPi = 3.14159265358979F;
+
+  const auto abs_x = abs(x);
+  const auto abs_y = abs(y);
+  const auto low   = min(abs_x, abs_y);
+  const auto high  = max(abs_x, abs_y);
+  const auto a     = select(less_than(splat(0.F), high), div(low, high), splat(0.F));
+
+  // atan(a) for a in [0, 1], Abramowitz and Stegun 4.4.49
+  const auto s = mul(a, a);
+  auto poly    = splat(0.0208351F);
+  poly         = madd(poly, s, splat(-0.0851330F));
+  poly         = madd(poly, s, splat(0.1801410F));
+  poly         = madd(poly, s, splat(-0.3302995F));
+  poly         = madd(poly, s, splat(0.9998660F));
+  auto r       = mul(poly, a);
+
+  r = select(less_than(abs_x, abs_y), sub(splat(kPi / 2.F), r), r);
+  r = select(less_than(x, splat(0.F)), sub(splat(kPi), r), r);
+  return mult_sign(r, y);
+}
+
+}  // namespace internal
+
+/**
+ * @brief `1 / sqrt(x)` of 4 floats, see `internal::rsqrt()`.
+ *
+ */
+inline void rsqrt_x4(const float* in, float* out) { internal::store(out, internal::rsqrt(internal::load(in))); }
+
+inline void fast_sin_x4(const float* in, float* out) {
+  internal::store(out, internal::fast_sin(internal::load(in)));
+}
+
+inline void fast_cos_x4(const float* in, float* out) {
+  internal::store(out, internal::fast_cos(internal::load(in)));
+}
+
+inline void fast_atan2_x4(const float* y, const float* x, float* out) {
+  internal::store(out, internal::fast_atan2(internal::load(y), internal::load(x)));
+}
+
+inline void fast_acos_x4(const float* in, float* out) {
+  using namespace internal;  // NOLINT
+  const auto x = load(in);
+  const auto r = acos_unit(min(abs(x), splat(1.F)));
+  store(out, select(less_than(x, splat(0.F)), sub(splat(3.14159265358979F), r), r));
+}
+
+#endif
+
+}  // namespace eray::math::simd
@@ -1,4 +1,7 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <liberay/math/quat.hpp>
 #include <liberay/math/transform3_fwd.hpp>
 #include <optional>
@@ -6,6 +9,14 @@
 
 namespace eray::math {
 
+/**
+ * @brief Position, rotation and scale relative to an optional parent transform. The world matrices are cached and
+ * validated with version counters: every local change stamps the transform with a new, globally increasing version
+ * and the world version of a transform is the greatest version along its path to the root. A cached matrix stays valid
+ * while the world version matches the one it was computed for, so a change is O(1) and the matrices are recomputed
+ * lazily, only along the queried paths.
+ *
+ */
 template <CFloatingPoint T>
 struct Transform3 final {
  public:
@@ -13,11 +24,12 @@ struct Transform3 final {
                       const Quat<T> rot   = Quat<T>{static_cast<T>(1), static_cast<T>(0), static_cast<T>(0),
                                                     static_cast<T>(0)},
                       const Vec3<T> scale = Vec3<T>{static_cast<T>(1), static_cast<T>(1), static_cast<T>(1)})
-      : pos_(pos), rot_(rot), scale_(scale), dirty_(true), inv_dirty_(true) {}
+      : pos_(pos), rot_(rot), scale_(scale), local_version_(next_version()) {}
 
   ~Transform3() {
     for (const auto child : children_) {
       child.get().parent_.reset();
+      child.get().mark_dirty();
     }
 
     if (parent_.has_value()) {
@@ -34,9 +46,10 @@ struct Transform3 final {
         pos_(std::move(other.pos_)),
         rot_(std::move(other.rot_)),
         scale_(std::move(other.scale_)),
-        dirty_(other.dirty_),
+        local_version_(other.local_version_),
+        model_version_(other.model_version_),
         model_mat_(std::move(other.model_mat_)),
-        inv_dirty_(other.inv_dirty_),
+        inv_model_version_(other.inv_model_version_),
         inv_model_mat_(std::move(other.inv_model_mat_)) {
     for (auto& child : children_) {
       child.get().parent_ = *this;
@@ -62,17 +75,19 @@ struct Transform3 final {
       }
       for (const auto& child : children_) {
         child.get().parent_.reset();
+        child.get().mark_dirty();
       }
 
-      parent_        = std::move(other.parent_);
-      children_      = std::move(other.children_);
-      pos_           = std::move(other.pos_);
-      rot_           = std::move(other.rot_);
-      scale_         = std::move(other.scale_);
-      dirty_         = other.dirty_;
-      model_mat_     = std::move(other.model_mat_);
-      inv_dirty_     = other.inv_dirty_;
-      inv_model_mat_ = std::move(other.inv_model_mat_);
+      parent_            = std::move(other.parent_);
+      children_          = std::move(other.children_);
+      pos_               = std::move(other.pos_);
+      rot_               = std::move(other.rot_);
+      scale_             = std::move(other.scale_);
+      local_version_     = other.local_version_;
+      model_version_     = other.model_version_;
+      model_mat_         = std::move(other.model_mat_);
+      inv_model_version_ = other.inv_model_version_;
+      inv_model_mat_     = std::move(other.inv_model_mat_);
 
       for (auto& child : children_) {
         child.get().parent_ = *this;
@@ -270,15 +285,21 @@ struct Transform3 final {
     return Mat3<T>{normalize(orientation[0]), normalize(orientation[1]), normalize(orientation[2])};
   }
 
-  void mark_dirty() const {
-    if (dirty_ && inv_dirty_) {
-      return;
-    }
+  /**
+   * @brief Invalidates the cached matrices of this transform and of its descendants in O(1), by stamping the transform
+   * with a new version. Call it after changing the local transform through a mutable reference, e.g. `local_pos()`.
+   *
+   */
+  void mark_dirty() const { local_version_ = next_version(); }
 
-    dirty_ = inv_dirty_ = true;
-    for (const auto child : children_) {
-      child.get().mark_dirty();
-    }
+  /**
+   * @brief Version of the world transform, changes whenever this transform or any of its ancestors changes. Lets the
+   * external caches derived from the world transform (e.g. bounds) detect changes without comparing the matrices.
+   *
+   * @return uint64_t
+   */
+  uint64_t world_version() const {
+    return parent_ ? std::max(local_version_, parent_->get().world_version()) : local_version_;
   }
 
   Mat4<T> local_to_parent_matrix() const {
@@ -293,30 +314,12 @@ struct Transform3 final {
   }
 
   const Mat4<T>& local_to_world_matrix() const {
-    if (!dirty_) {
-      return model_mat_;
-    }
-
-    model_mat_ = local_to_parent_matrix();
-    if (parent_) {
-      model_mat_ = parent_->get().local_to_world_matrix() * model_mat_;
-    }
-
-    dirty_ = false;
+    update_model_mat();
     return model_mat_;
   }
 
   const Mat4<T>& world_to_local_matrix() const {
-    if (!inv_dirty_) {
-      return inv_model_mat_;
-    }
-
-    inv_model_mat_ = parent_to_local_matrix();
-    if (parent_) {
-      inv_model_mat_ *= parent_->get().world_to_local_matrix();
-    }
-
-    inv_dirty_ = false;
+    update_inv_model_mat();
     return inv_model_mat_;
   }
 
@@ -370,6 +373,36 @@ struct Transform3 final {
   }
 
  private:
+  static uint64_t next_version() {
+    static auto counter = std::atomic<uint64_t>(0);
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  /**
+   * @brief Brings the cached world matrix up to date, the ancestors first. Returns the world version.
+   *
+   */
+  uint64_t update_model_mat() const {
+    const auto parent_version = parent_ ? parent_->get().update_model_mat() : uint64_t{0};
+    const auto version        = std::max(local_version_, parent_version);
+    if (model_version_ != version) {
+      model_mat_ = parent_ ? parent_->get().model_mat_ * local_to_parent_matrix() : local_to_parent_matrix();
+      model_version_ = version;
+    }
+    return version;
+  }
+
+  uint64_t update_inv_model_mat() const {
+    const auto parent_version = parent_ ? parent_->get().update_inv_model_mat() : uint64_t{0};
+    const auto version        = std::max(local_version_, parent_version);
+    if (inv_model_version_ != version) {
+      inv_model_mat_ =
+          parent_ ? parent_to_local_matrix() * parent_->get().inv_model_mat_ : parent_to_local_matrix();
+      inv_model_version_ = version;
+    }
+    return version;
+  }
+
   void remove_parent() {
     std::erase_if(parent_->get().children_, [this](auto ref) { return std::addressof(ref.get()) == this; });
     parent_.reset();
@@ -383,10 +416,12 @@ struct Transform3 final {
   Quat<T> rot_;
   Vec3<T> scale_;
 
-  mutable bool dirty_            = false;
-  mutable Mat4<T> model_mat_     = Mat4<T>::identity();
-  mutable bool inv_dirty_        = false;
-  mutable Mat4<T> inv_model_mat_ = Mat4<T>::identity();
+  // Versions start at 1, so the caches stamped with 0 are never valid
+  mutable uint64_t local_version_     = 0;
+  mutable uint64_t model_version_     = 0;
+  mutable Mat4<T> model_mat_          = Mat4<T>::identity();
+  mutable uint64_t inv_model_version_ = 0;
+  mutable Mat4<T> inv_model_mat_      = Mat4<T>::identity();
 
 };  // class Transform
 
@@ -1,6 +1,7 @@
 #pragma once
 #include <cmath>
 #include <format>
+#include <liberay/math/simd.hpp>
 #include <liberay/math/types.hpp>
 #include <liberay/math/vec_fwd.hpp>
 #include <numbers>
@@ -342,7 +343,14 @@ struct Vec {
 
   auto length_sq() const { return length_sq(std::make_index_sequence<N>{}, data); }
 
-  Vec normalized() const { return *this / this->length(); }
+  Vec normalized() const {
+    if constexpr (N == 4 && std::is_same_v<T, float> && simd::kEnabled) {
+      auto result = Vec();
+      simd::normalize4(data, result.data);
+      return result;
+    }
+    return *this / this->length();
+  }
 
   Vec abs() const {
     auto v = Vec(*this);
@@ -554,6 +562,11 @@ constexpr bool all_components_less_than(std::index_sequence<Is...>, T* data, con
  */
 template <std::size_t N, CPrimitive T>
 constexpr T dot(const Vec<N, T>& lhs, const Vec<N, T>& rhs) {
+  if constexpr (N == 4 && std::is_same_v<T, float> && simd::kEnabled) {
+    if (!std::is_constant_evaluated()) {
+      return simd::dot4(lhs.data, rhs.data);
+    }
+  }
   return internal::dot_base(std::make_index_sequence<N>(), lhs.data, rhs.data);
 }
 
@@ -836,6 +849,7 @@ template <CFloatingPoint T, std::size_t N>
 }
 
 static_assert(std::is_trivially_copyable_v<Vec<3, float>>);
+static_assert(sizeof(Vec<4, float>) == 4 * sizeof(float));
 
 }  // namespace eray::math
 
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <liberay/math/batch.hpp>
+#include <cmath>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/quat.hpp>
+#include <liberay/math/vec.hpp>
+#include <tests/helpers/math_helpers.hpp>
+#include <vector>
+
+using namespace eray::math;  // NOLINT
+
+namespace {
+
+constexpr auto kEpsilon = 1e-4F;
+
+const auto kMat = Mat4f{Vec4f{1.F, 2.F, 3.F, 0.F}, Vec4f{-5.F, 6.F, 7.F, 0.F}, Vec4f{9.F, -10.F, 11.F, 0.F},
+                        Vec4f{13.F, 14.F, -15.F, 1.F}};
+
+std::vector<Vec3f> test_points(std::size_t count) {
+  auto points = std::vector<Vec3f>();
+  for (auto i = 0U; i < count; ++i) {
+    const auto t = static_cast<float>(i);
+    points.emplace_back(t, -0.5F * t, 2.F - t);
+  }
+  return points;
+}
+
+}  // namespace
+
+TEST(BatchTest, TransformsPointsAndDirectionsWithTails) {
+  // Covers the empty batch, the tails shorter than a group and the full groups
+  for (auto count = 0U; count < 11; ++count) {
+    const auto points = test_points(count);
+    auto transformed  = std::vector<Vec3f>(count);
+    auto directions   = std::vector<Vec3f>(count);
+    transform_points(kMat, points, transformed);
+    transform_directions(kMat, points, directions);
+
+    for (auto i = 0U; i < count; ++i) {
+      EXPECT_VEC_NEAR(Vec3f(kMat * Vec4f(points[i], 1.F)), transformed[i], kEpsilon);
+      EXPECT_VEC_NEAR(Vec3f(kMat * Vec4f(points[i], 0.F)), directions[i], kEpsilon);
+    }
+  }
+}
+
+TEST(BatchTest, TransformsPointsInPlace) {
+  const auto points = test_points(9);
+  auto transformed  = points;
+  transform_points(kMat, transformed, transformed);
+
+  for (auto i = 0U; i < points.size(); ++i) {
+    EXPECT_VEC_NEAR(Vec3f(kMat * Vec4f(points[i], 1.F)), transformed[i], kEpsilon);
+  }
+}
+
+TEST(BatchTest, TransformsHomogeneousVectors) {
+  auto vecs = std::vector<Vec4f>();
+  for (const auto& point : test_points(5)) {
+    vecs.emplace_back(point, 0.5F);
+  }
+  auto transformed = std::vector<Vec4f>(vecs.size());
+  transform_vectors(kMat, vecs, transformed);
+
+  for (auto i = 0U; i < vecs.size(); ++i) {
+    EXPECT_VEC_NEAR(kMat * vecs[i], transformed[i], kEpsilon);
+  }
+}
+
+TEST(BatchTest, MultipliesMatrices) {
+  auto rhs = std::vector<Mat4f>();
+  for (const auto& point : test_points(3)) {
+    rhs.push_back(translation(point));
+  }
+  auto lhs = std::vector<Mat4f>{kMat, Mat4f::identity(), scale(Vec3f::filled(2.F))};
+
+  auto products = std::vector<Mat4f>(rhs.size());
+  multiply_many(kMat, rhs, products);
+  for (auto i = 0U; i < rhs.size(); ++i) {
+    EXPECT_MAT_NEAR(kMat * rhs[i], products[i], kEpsilon);
+  }
+
+  multiply_many(lhs, rhs, products);
+  for (auto i = 0U; i < rhs.size(); ++i) {
+    EXPECT_MAT_NEAR(lhs[i] * rhs[i], products[i], kEpsilon);
+  }
+}
+
+namespace {
+
+std::vector<Quatf> test_quats(std::size_t count, float phase) {
+  auto quats = std::vector<Quatf>();
+  for (auto i = 0U; i < count; ++i) {
+    const auto t = static_cast<float>(i) + phase;
+    quats.push_back(Quatf(std::cos(t), std::sin(2.F * t), 0.5F * std::cos(3.F * t), std::sin(t) - 0.3F).normalized());
+  }
+  return quats;
+}
+
+void expect_quat_near(const Quatf& expected, const Quatf& actual, float epsilon) {
+  EXPECT_NEAR(expected.w, actual.w, epsilon);
+  EXPECT_NEAR(expected.x, actual.x, epsilon);
+  EXPECT_NEAR(expected.y, actual.y, epsilon);
+  EXPECT_NEAR(expected.z, actual.z, epsilon);
+}
+
+}  // namespace
+
+TEST(BatchTest, MultipliesAndNormalizesQuaternions) {
+  for (auto count = 0U; count < 10; ++count) {
+    const auto lhs = test_quats(count, 0.F);
+    const auto rhs = test_quats(count, 1.F);
+    auto products  = std::vector<Quatf>(count);
+    multiply_many(lhs, rhs, products);
+
+    auto scaled = std::vector<Quatf>();
+    for (const auto& quat : lhs) {
+      scaled.push_back(quat * 3.F);
+    }
+    normalize_many(scaled, scaled);
+
+    for (auto i = 0U; i < count; ++i) {
+      expect_quat_near(lhs[i] * rhs[i], products[i], kEpsilon);
+      expect_quat_near(lhs[i], scaled[i], kEpsilon);
+    }
+  }
+}
+
+TEST(BatchTest, InterpolatesQuaternions) {
+  const auto start = test_quats(7, 0.F);
+  auto end         = test_quats(7, 0.7F);
+  end[2]           = -start[2] * Quatf(std::cos(0.01F), std::sin(0.01F), 0.F, 0.F);  // Opposite hemisphere
+  end[5]           = start[5];                                                         // Parallel
+
+  for (const auto t : {0.F, 0.25F, 0.6F, 1.F}) {
+    auto nlerped = std::vector<Quatf>(start.size());
+    auto slerped = std::vector<Quatf>(start.size());
+    nlerp_many(start, end, t, nlerped);
+    slerp_many(start, end, t, slerped);
+
+    for (auto i = 0U; i < start.size(); ++i) {
+      expect_quat_near(lerp_quat(start[i], end[i], t), nlerped[i], kEpsilon);
+      expect_quat_near(slerp_quat(start[i], end[i], t), slerped[i], kEpsilon);
+    }
+  }
+}
+
+TEST(BatchTest, ConvertsQuaternionsToMatrices) {
+  const auto quats = test_quats(6, 0.3F);
+  auto mats        = std::vector<Mat4f>(quats.size());
+  rot_mats_from_quats(quats, mats);
+
+  for (auto i = 0U; i < quats.size(); ++i) {
+    EXPECT_MAT_NEAR(rot_mat_from_quat(quats[i]), mats[i], kEpsilon);
+  }
+}
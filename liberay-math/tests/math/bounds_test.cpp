@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <liberay/math/batch.hpp>
+#include <liberay/math/bounds.hpp>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/vec.hpp>
+#include <numbers>
+#include <tests/helpers/math_helpers.hpp>
+#include <vector>
+
+using namespace eray::math;  // NOLINT
+
+namespace {
+
+constexpr auto kEpsilon = 1e-5F;
+
+Aabb3f unit_box_at(float x, float y, float z) {
+  return Aabb3f::from_center_extent(Vec3f(x, y, z), Vec3f::filled(1.F));
+}
+
+Frustum camera_frustum() {
+  // Camera at the origin looking down -z, 90 degrees vertical field of view
+  const auto proj = perspective_vk_rh(std::numbers::pi_v<float> / 2.F, 1.F, 0.1F, 100.F);
+  return Frustum::from_view_projection(proj);
+}
+
+}  // namespace
+
+TEST(BoundsTest, AabbTransformMatchesTransformedCorners) {
+  const auto mat = translation(Vec3f(1.F, -2.F, 3.F)) * rotation_axis(0.7F, normalize(Vec3f(1.F, 2.F, -0.5F))) *
+                   scale(Vec3f(2.F, 0.5F, 1.5F));
+  const auto box = Aabb3f{.min = Vec3f(-1.F, 0.F, 2.F), .max = Vec3f(0.5F, 3.F, 2.5F)};
+
+  auto expected = Aabb3f();
+  for (auto corner = 0U; corner < 8; ++corner) {
+    const auto point = Vec3f((corner & 1U) != 0 ? box.max.x() : box.min.x(),
+                             (corner & 2U) != 0 ? box.max.y() : box.min.y(),
+                             (corner & 4U) != 0 ? box.max.z() : box.min.z());
+    const auto transformed = Vec3f(mat * Vec4f(point, 1.F));
+    expected               = expected.merged(Aabb3f{.min = transformed, .max = transformed});
+  }
+
+  const auto actual = box.transformed(mat);
+  EXPECT_VEC_NEAR(actual.min, expected.min, kEpsilon);
+  EXPECT_VEC_NEAR(actual.max, expected.max, kEpsilon);
+
+  auto batch = std::vector<Aabb3f>(1);
+  transform_aabbs(mat, std::span(&box, 1), batch);
+  EXPECT_VEC_NEAR(batch[0].min, expected.min, kEpsilon);
+}
+
+TEST(BoundsTest, FrustumClassifiesBoxes) {
+  const auto frustum = camera_frustum();
+  EXPECT_EQ(frustum.classify(unit_box_at(0.F, 0.F, -10.F)), FrustumTest::Inside);
+  EXPECT_EQ(frustum.classify(unit_box_at(0.F, 0.F, 10.F)), FrustumTest::Outside);
+  EXPECT_EQ(frustum.classify(unit_box_at(0.F, 0.F, -200.F)), FrustumTest::Outside);
+  EXPECT_EQ(frustum.classify(unit_box_at(30.F, 0.F, -10.F)), FrustumTest::Outside);
+  EXPECT_EQ(frustum.classify(unit_box_at(10.F, 0.F, -10.F)), FrustumTest::Intersecting);
+
+  const auto ortho = Frustum::from_view_projection(orthographic_vk_rh(-5.F, 5.F, -5.F, 5.F, 0.F, 10.F));
+  EXPECT_EQ(ortho.classify(unit_box_at(0.F, 0.F, -5.F)), FrustumTest::Inside);
+  EXPECT_EQ(ortho.classify(unit_box_at(7.F, 0.F, -5.F)), FrustumTest::Outside);
+  EXPECT_TRUE(frustum.intersects(Sphere3f{.center = Vec3f(0.F, 0.F, -10.F), .radius = 1.F}));
+  EXPECT_FALSE(frustum.intersects(Sphere3f{.center = Vec3f(0.F, 0.F, 5.F), .radius = 1.F}));
+}
+
+TEST(BoundsTest, FrustumBatchMatchesScalarTest) {
+  const auto frustum = camera_frustum();
+  auto boxes         = std::vector<Aabb3f>();
+  for (auto i = 0; i < 19; ++i) {
+    const auto fi = static_cast<float>(i);
+    boxes.push_back(unit_box_at(std::sin(fi) * 2.F * fi, std::cos(fi) * fi, -fi * 1.5F + 5.F));
+  }
+
+  auto expected_mask = 0U;
+  for (auto i = 0U; i < 8; ++i) {
+    expected_mask |= static_cast<uint32_t>(frustum.intersects(boxes[i])) << i;
+  }
+  EXPECT_EQ(frustum.intersects_x8(std::span(boxes).first<8>()), expected_mask);
+
+  auto expected = std::vector<uint32_t>();
+  for (auto i = 0U; i < boxes.size(); ++i) {
+    if (frustum.intersects(boxes[i])) {
+      expected.push_back(i);
+    }
+  }
+  auto actual = std::vector<uint32_t>();
+  cull_aabbs(frustum, boxes, actual);
+  EXPECT_EQ(actual, expected);
+  EXPECT_FALSE(expected.empty());
+  EXPECT_LT(expected.size(), boxes.size());
+}
+
+TEST(BoundsTest, RayHitsBoxes) {
+  const auto ray = Ray3f{.origin = Vec3f(0.F, 0.F, 5.F), .direction = Vec3f(0.F, 0.F, -1.F)};
+  const auto hit = ray.intersect(unit_box_at(0.F, 0.F, 0.F));
+  ASSERT_TRUE(hit.has_value());
+  EXPECT_NEAR(*hit, 4.F, kEpsilon);
+  EXPECT_FALSE(ray.intersect(unit_box_at(0.F, 0.F, 0.F), 3.F).has_value());
+  EXPECT_FALSE(ray.intersect(unit_box_at(3.F, 0.F, 0.F)).has_value());
+  EXPECT_FALSE(ray.intersect(unit_box_at(0.F, 0.F, 10.F)).has_value());
+  EXPECT_NEAR(ray.intersect(unit_box_at(0.F, 0.F, 5.F)).value_or(-1.F), 0.F, kEpsilon);
+
+  const auto sphere_hit = ray.intersect(Sphere3f{.center = Vec3f(0.F, 0.F, -1.F), .radius = 2.F});
+  ASSERT_TRUE(sphere_hit.has_value());
+  EXPECT_NEAR(*sphere_hit, 4.F, kEpsilon);
+  EXPECT_FALSE(ray.intersect(Sphere3f{.center = Vec3f(0.F, 0.F, 10.F), .radius = 2.F}).has_value());
+}
+
+TEST(BoundsTest, RayBatchMatchesScalarTest) {
+  const auto ray   = Ray3f{.origin = Vec3f(-4.F, 0.5F, 0.F), .direction = normalize(Vec3f(1.F, 0.1F, -0.2F))};
+  const auto boxes = std::array<Aabb3f, 4>{unit_box_at(0.F, 0.F, 0.F), unit_box_at(3.F, 1.F, -1.F),
+                                           unit_box_at(0.F, 5.F, 0.F), unit_box_at(-10.F, 0.F, 0.F)};
+
+  auto t_near     = std::array<float, 4>{};
+  const auto mask = ray.intersect_x4(boxes, t_near);
+  for (auto i = 0U; i < 4; ++i) {
+    const auto expected = ray.intersect(boxes[i]);
+    ASSERT_EQ((mask >> i & 1U) != 0, expected.has_value()) << "box: " << i;
+    if (expected) {
+      EXPECT_NEAR(t_near[i], *expected, kEpsilon) << "box: " << i;
+    }
+  }
+  EXPECT_EQ(mask, 0b0011U);
+  EXPECT_EQ(ray.intersect_x4(boxes, t_near, 4.F), 0b0001U);
+}
+
+TEST(BoundsTest, SphereTests) {
+  const auto sphere = Sphere3f{.center = Vec3f(1.F, 0.F, 0.F), .radius = 1.F};
+  EXPECT_TRUE(sphere.contains(Vec3f(1.5F, 0.F, 0.F)));
+  EXPECT_TRUE(sphere.intersects(unit_box_at(2.5F, 0.F, 0.F)));
+  EXPECT_FALSE(sphere.intersects(unit_box_at(3.5F, 0.F, 0.F)));
+  EXPECT_TRUE(sphere.intersects(Sphere3f{.center = Vec3f(2.5F, 0.F, 0.F), .radius = 0.5F}));
+
+  const auto transformed = sphere.transformed(translation(Vec3f(0.F, 1.F, 0.F)) * scale(Vec3f(1.F, 3.F, 2.F)));
+  EXPECT_VEC_NEAR(transformed.center, Vec3f(1.F, 1.F, 0.F), kEpsilon);
+  EXPECT_NEAR(transformed.radius, 3.F, kEpsilon);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <liberay/math/fast_math.hpp>
+#include <liberay/math/quat.hpp>
+#include <liberay/math/vec.hpp>
+#include <numbers>
+#include <tests/helpers/math_helpers.hpp>
+#include <vector>
+
+using namespace eray::math;  // NOLINT
+
+// The sweeps check the error bounds stated in fast_math.hpp against the double precision functions
+
+namespace {
+
+constexpr auto kPi = std::numbers::pi_v<float>;
+
+std::vector<float> sweep(float first, float last, int count) {
+  auto values = std::vector<float>();
+  for (auto i = 0; i < count; ++i) {
+    values.push_back(first + (last - first) * static_cast<float>(i) / static_cast<float>(count - 1));
+  }
+  return values;
+}
+
+}  // namespace
+
+static_assert(fast_sin(0.F) == 0.F);
+static_assert(fast_atan2(0.F, 0.F) == 0.F);
+
+TEST(FastMathTest, RsqrtAndNormalizeAreWithinBounds) {
+  for (const auto x : sweep(1e-6F, 1e6F, 10007)) {
+    EXPECT_NEAR(fast_rsqrt(x) * std::sqrt(static_cast<double>(x)), 1.0, 5e-6) << "x: " << x;
+  }
+
+  const auto vec = Vec3f(3.F, -4.F, 12.F);
+  EXPECT_VEC_NEAR(fast_normalize(vec), vec / 13.F, 5e-6F);
+  EXPECT_NEAR(fast_length(vec), 13.F, 13.F * 5e-6F);
+  EXPECT_EQ(fast_length(Vec3f::filled(0.F)), 0.F);
+}
+
+TEST(FastMathTest, SinAndCosAreWithinBounds) {
+  for (const auto x : sweep(-100.F, 100.F, 100003)) {
+    const auto reference = static_cast<double>(x);
+    ASSERT_NEAR(fast_sin(x), std::sin(reference), 4e-7) << "x: " << x;
+    ASSERT_NEAR(fast_cos(x), std::cos(reference), 4e-7) << "x: " << x;
+  }
+}
+
+TEST(FastMathTest, Atan2AndAcosAreWithinBounds) {
+  for (const auto angle : sweep(-kPi, kPi, 100003)) {
+    const auto y = std::sin(angle) * 3.F;
+    const auto x = std::cos(angle) * 3.F;
+    ASSERT_NEAR(fast_atan2(y, x), std::atan2(static_cast<double>(y), static_cast<double>(x)), 1.2e-5)
+        << "angle: " << angle;
+  }
+  EXPECT_EQ(fast_atan2(0.F, 0.F), 0.F);
+
+  for (const auto x : sweep(-1.F, 1.F, 100003)) {
+    ASSERT_NEAR(fast_acos(x), std::acos(static_cast<double>(x)), 5e-7) << "x: " << x;
+  }
+}
+
+TEST(FastMathTest, BatchMatchesScalarFunctions) {
+  // 13 values cover three groups of 4 and the tail
+  const auto values = sweep(-7.F, 7.F, 13);
+  auto unit         = sweep(-1.F, 1.F, 13);
+  auto out          = std::vector<float>(values.size());
+
+  fast_sin_many(values, out);
+  for (auto i = 0U; i < values.size(); ++i) {
+    EXPECT_NEAR(out[i], fast_sin(values[i]), 1e-6F);
+  }
+  fast_cos_many(values, out);
+  for (auto i = 0U; i < values.size(); ++i) {
+    EXPECT_NEAR(out[i], fast_cos(values[i]), 1e-6F);
+  }
+  fast_acos_many(unit, out);
+  for (auto i = 0U; i < unit.size(); ++i) {
+    EXPECT_NEAR(out[i], fast_acos(unit[i]), 1e-6F);
+  }
+  fast_atan2_many(values, unit, out);
+  for (auto i = 0U; i < values.size(); ++i) {
+    EXPECT_NEAR(out[i], fast_atan2(values[i], unit[i]), 1e-6F);
+  }
+
+  auto vecs = std::vector<Vec3f>();
+  for (const auto v : values) {
+    vecs.emplace_back(v, 1.F, -2.F * v);
+  }
+  auto normalized = std::vector<Vec3f>(vecs.size());
+  fast_normalize_many<3>(vecs, normalized);
+  for (auto i = 0U; i < vecs.size(); ++i) {
+    EXPECT_VEC_NEAR(normalized[i], normalize(vecs[i]), 1e-5F);
+  }
+}
+
+TEST(FastMathTest, QuaternionHelpersMatchExactOnes) {
+  const auto axis     = normalize(Vec3f(1.F, -2.F, 0.5F));
+  const auto expected = Quatf::rotation_axis(2.F, axis);
+  const auto actual   = fast_quat_rotation_axis(2.F, axis);
+  EXPECT_NEAR(dot(expected, actual), 1.F, 1e-6F);
+
+  const auto start = Quatf::rotation_axis(0.3F, axis);
+  const auto end   = Quatf::rotation_axis(-2.5F, Vec3f(0.F, 1.F, 0.F));
+  for (const auto t : sweep(0.F, 1.F, 11)) {
+    const auto exact = slerp_quat(start, end, t);
+    const auto fast  = fast_slerp_quat(start, end, t);
+    EXPECT_NEAR(exact.w, fast.w, 1e-6F);
+    EXPECT_NEAR(exact.x, fast.x, 1e-6F);
+    EXPECT_NEAR(exact.y, fast.y, 1e-6F);
+    EXPECT_NEAR(exact.z, fast.z, 1e-6F);
+  }
+}
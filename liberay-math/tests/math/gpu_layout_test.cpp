@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <liberay/math/gpu_layout.hpp>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/vec.hpp>
+#include <tests/helpers/math_helpers.hpp>
+#include <vector>
+
+using namespace eray::math;  // NOLINT
+
+namespace {
+
+// std140 offsets of a uniform block with the same members:
+// mat4 view_projection; vec3 camera_pos; mat3 normal; vec2 viewport; float time;
+struct TestUbo {
+  gpu::Mat4f view_projection;
+  gpu::Vec3f camera_pos;
+  gpu::Mat3f normal;
+  gpu::Vec2f viewport;
+  float time;
+};
+ERAY_GPU_ASSERT_OFFSET(TestUbo, camera_pos, 64);
+ERAY_GPU_ASSERT_OFFSET(TestUbo, normal, 80);
+ERAY_GPU_ASSERT_OFFSET(TestUbo, viewport, 128);
+ERAY_GPU_ASSERT_OFFSET(TestUbo, time, 136);
+static_assert(sizeof(TestUbo) == 144);
+static_assert(gpu::CStd140Block<TestUbo>);
+
+// std430 array element: vec3 position; uint id; float weights[2]
+struct TestParticle {
+  gpu::Vec3f position;
+  uint32_t id;
+  float weights[2];
+};
+ERAY_GPU_ASSERT_OFFSET(TestParticle, id, 16);
+static_assert(sizeof(TestParticle) == 32);
+static_assert(gpu::CStd430Block<TestParticle>);
+
+}  // namespace
+
+TEST(GpuLayoutTest, TypesHaveShaderSizesAndAlignments) {
+  EXPECT_EQ(sizeof(gpu::Vec2f), 8);
+  EXPECT_EQ(alignof(gpu::Vec2f), 8);
+  EXPECT_EQ(sizeof(gpu::Vec3f), 16);
+  EXPECT_EQ(alignof(gpu::Vec3f), 16);
+  EXPECT_EQ(sizeof(gpu::Vec4u), 16);
+  EXPECT_EQ(alignof(gpu::Vec4u), 16);
+
+  EXPECT_EQ(sizeof(gpu::Mat3f), 48);
+  EXPECT_EQ(sizeof(gpu::Mat3x4f), 48);
+  EXPECT_EQ(sizeof(gpu::Mat4f), 64);
+  EXPECT_EQ(alignof(gpu::Mat4f), 16);
+
+  EXPECT_EQ(sizeof(gpu::Std140ArrayElement<float>), 16);
+  EXPECT_EQ(sizeof(gpu::Std140ArrayElement<gpu::Vec2f>), 16);
+}
+
+TEST(GpuLayoutTest, ConvertsFromAndToMathTypes) {
+  const auto mat3 = Mat3f{Vec3f(1.F, 2.F, 3.F), Vec3f(4.F, 5.F, 6.F), Vec3f(7.F, 8.F, 9.F)};
+  const auto gpu  = gpu::Mat3f(mat3);
+  EXPECT_VEC_NEAR(Vec4f(4.F, 5.F, 6.F, 0.F), gpu.columns[1], 0.F);
+  EXPECT_MAT_NEAR(mat3, static_cast<Mat3f>(gpu), 0.F);
+
+  const auto vec = gpu::Vec3f(Vec3f(1.F, 2.F, 3.F));
+  EXPECT_VEC_NEAR(Vec3f(1.F, 2.F, 3.F), static_cast<Vec3f>(vec), 0.F);
+}
+
+TEST(GpuLayoutTest, ArraysAreCopiedAsIs) {
+  auto particles = std::vector<TestParticle>(3);
+  for (auto i = 0U; i < particles.size(); ++i) {
+    particles[i] = TestParticle{.position = Vec3f::filled(static_cast<float>(i)), .id = i, .weights = {0.5F, 1.F}};
+  }
+
+  // The bytes a shader reads with the std430 array stride of 32
+  auto buffer = std::vector<std::byte>(particles.size() * 32);
+  std::memcpy(buffer.data(), particles.data(), buffer.size());
+  for (auto i = 0U; i < particles.size(); ++i) {
+    auto id = uint32_t{0};
+    auto y  = 0.F;
+    std::memcpy(&id, buffer.data() + i * 32 + 16, sizeof(id));
+    std::memcpy(&y, buffer.data() + i * 32 + 4, sizeof(y));
+    EXPECT_EQ(id, i);
+    EXPECT_FLOAT_EQ(y, static_cast<float>(i));
+  }
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <liberay/math/mat.hpp>
+#include <liberay/math/vec.hpp>
+#include <numbers>
+#include <tests/helpers/math_helpers.hpp>
+
+using namespace eray::math;  // NOLINT
+
+namespace {
+
+constexpr auto kEpsilon = 1e-5F;
+constexpr auto kPi      = std::numbers::pi_v<float>;
+
+Mat4f test_rotation() { return rotation_y(kPi / 3.F) * rotation_x(-kPi / 5.F) * rotation_z(kPi / 7.F); }
+
+}  // namespace
+
+TEST(MatInverseTest, AffineInverseMatchesGeneralInverse) {
+  const auto m = translation(Vec3f(1.F, -2.F, 3.F)) * test_rotation() * scale(Vec3f(2.F, 0.5F, 3.F));
+  auto shear   = m;
+  shear[1][0] += 0.7F;
+
+  for (const auto& affine : {m, shear}) {
+    const auto expected = inverse(affine);
+    ASSERT_TRUE(expected.has_value());
+    EXPECT_MAT_NEAR(*expected, inverse_affine(affine), kEpsilon);
+    EXPECT_MAT_NEAR(Mat4f::identity(), affine * inverse_affine(affine), kEpsilon);
+  }
+}
+
+TEST(MatInverseTest, RigidInverseMatchesGeneralInverse) {
+  const auto m        = translation(Vec3f(-4.F, 0.5F, 2.F)) * test_rotation();
+  const auto expected = inverse(m);
+  ASSERT_TRUE(expected.has_value());
+  EXPECT_MAT_NEAR(*expected, inverse_rigid(m), kEpsilon);
+  EXPECT_MAT_NEAR(*expected, inverse_affine(m), kEpsilon);
+}
+
+TEST(MatInverseTest, ConstantEvaluatedInversesMatch) {
+  constexpr auto kAffine = Mat4f{Vec4f{2.F, 0.F, 0.F, 0.F}, Vec4f{1.F, 4.F, 0.F, 0.F}, Vec4f{0.F, 0.F, 0.5F, 0.F},
+                                 Vec4f{3.F, -1.F, 2.F, 1.F}};
+  constexpr auto kRigid  = Mat4f{Vec4f{0.F, 1.F, 0.F, 0.F}, Vec4f{-1.F, 0.F, 0.F, 0.F}, Vec4f{0.F, 0.F, 1.F, 0.F},
+                                 Vec4f{3.F, -1.F, 2.F, 1.F}};
+
+  constexpr auto kAffineInverse = inverse_affine(kAffine);
+  constexpr auto kRigidInverse  = inverse_rigid(kRigid);
+
+  auto affine = kAffine;
+  auto rigid  = kRigid;
+  EXPECT_MAT_NEAR(kAffineInverse, inverse_affine(affine), kEpsilon);
+  EXPECT_MAT_NEAR(kRigidInverse, inverse_rigid(rigid), kEpsilon);
+}
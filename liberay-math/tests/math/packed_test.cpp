@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <liberay/math/packed.hpp>
+#include <liberay/math/vec.hpp>
+#include <numbers>
+#include <tests/helpers/math_helpers.hpp>
+#include <vector>
+
+using namespace eray::math;  // NOLINT
+
+static_assert(Half::from_float(1.F).bits == 0x3C00);
+static_assert(Half::from_float(-2.F).bits == 0xC000);
+static_assert(Half{.bits = 0x3555}.to_float() == 0.333251953125F);
+
+TEST(PackedTest, HalfConvertsSpecialValues) {
+  EXPECT_EQ(Half::from_float(0.F).bits, 0x0000);
+  EXPECT_EQ(Half::from_float(-0.F).bits, 0x8000);
+  EXPECT_EQ(Half::from_float(65504.F).bits, 0x7BFF);
+  EXPECT_EQ(Half::from_float(1e6F).bits, 0x7C00);
+  EXPECT_EQ(Half::from_float(-std::numeric_limits<float>::infinity()).bits, 0xFC00);
+  EXPECT_TRUE(std::isnan(Half::from_float(std::numeric_limits<float>::quiet_NaN()).to_float()));
+
+  // The smallest denormal and the value halfway below it
+  EXPECT_EQ(Half::from_float(5.9604645e-8F).bits, 0x0001);
+  EXPECT_EQ(Half::from_float(2.9802322e-8F).bits, 0x0000);
+  EXPECT_FLOAT_EQ(Half{.bits = 0x0001}.to_float(), 5.9604645e-8F);
+  EXPECT_FLOAT_EQ(Half{.bits = 0x03FF}.to_float(), 6.0975552e-5F);
+}
+
+TEST(PackedTest, HalfRoundsToNearestEven) {
+  // 2049 and 2051 are halfway between the halves around them (spacing of 2)
+  EXPECT_EQ(Half::from_float(2049.F).to_float(), 2048.F);
+  EXPECT_EQ(Half::from_float(2051.F).to_float(), 2052.F);
+  EXPECT_EQ(Half::from_float(2050.9F).to_float(), 2050.F);
+}
+
+TEST(PackedTest, HalfRoundTripsEveryFiniteHalf) {
+  for (auto bits = uint32_t{0}; bits <= 0xFFFF; ++bits) {
+    const auto half = Half{.bits = static_cast<uint16_t>(bits)};
+    if ((bits & 0x7C00) == 0x7C00) {
+      continue;
+    }
+    ASSERT_EQ(Half::from_float(half.to_float()).bits, half.bits) << "bits: " << bits;
+  }
+}
+
+TEST(PackedTest, BatchHalfConversionMatchesScalarCode) {
+  // 11 values cover two groups of 4 and the tail
+  auto values = std::vector<float>{0.F, -1.F, 0.1F, 3.14159F, 65504.F, 1e6F, 2049.F, 2051.F, -6e-8F, 1e-5F, -0.5F};
+  auto halves = std::vector<Half>(values.size());
+  to_halves(values, halves);
+  for (auto i = 0U; i < values.size(); ++i) {
+    EXPECT_EQ(halves[i].bits, Half::from_float(values[i]).bits) << "index: " << i;
+  }
+
+  auto floats = std::vector<float>(halves.size());
+  to_floats(halves, floats);
+  for (auto i = 0U; i < halves.size(); ++i) {
+    EXPECT_EQ(floats[i], halves[i].to_float()) << "index: " << i;
+  }
+}
+
+TEST(PackedTest, OctahedralNormalsRoundTrip) {
+  auto normals = std::vector<Vec3f>{Vec3f(0.F, 0.F, 1.F), Vec3f(0.F, 0.F, -1.F), Vec3f(1.F, 0.F, 0.F),
+                                    Vec3f(0.F, -1.F, 0.F)};
+  for (auto i = 0; i < 64; ++i) {
+    const auto theta = static_cast<float>(i) * 0.37F;
+    const auto z     = std::cos(static_cast<float>(i) * 0.11F);
+    const auto r     = std::sqrt(1.F - z * z);
+    normals.emplace_back(r * std::cos(theta), r * std::sin(theta), z);
+  }
+
+  auto encoded = std::vector<Snorm16x2>(normals.size());
+  oct_encode_many(normals, encoded);
+  for (auto i = 0U; i < normals.size(); ++i) {
+    const auto decoded = oct_decode(encoded[i]);
+    EXPECT_NEAR(dot(decoded, decoded), 1.F, 1e-5F);
+    // The chord of 0.005 degrees
+    EXPECT_LT(distance(decoded, normals[i]), 0.005F * std::numbers::pi_v<float> / 180.F) << "index: " << i;
+  }
+}
+
+TEST(PackedTest, NormalizedIntegersRoundTrip) {
+  constexpr auto kColor = Vec4f(0.F, 0.25F, 1.F, 0.5F);
+  auto colors           = std::vector<Vec4f>{kColor, Vec4f(2.F, -1.F, 0.5F, 1.F)};
+  auto packed           = std::vector<Unorm8x4>(colors.size());
+  to_unorm8x4_many(colors, packed);
+  EXPECT_EQ(packed[0].y, 64);
+  EXPECT_EQ(packed[1].x, 255);
+  EXPECT_EQ(packed[1].y, 0);
+  EXPECT_VEC_NEAR(packed[0].to_vec(), kColor, 0.5F / 255.F);
+
+  const auto unorm = Unorm10x3_2::from_vec(kColor);
+  EXPECT_EQ(unorm.bits & 0x3FFU, 0U);
+  EXPECT_EQ(unorm.bits >> 20 & 0x3FFU, 1023U);
+  EXPECT_EQ(unorm.bits >> 30, 2U);
+  EXPECT_VEC_NEAR(unorm.to_vec(), Vec4f(0.F, 0.25F, 1.F, 2.F / 3.F), 0.5F / 1023.F);
+
+  constexpr auto kTangent = Vec4f(-0.6F, 0.8F, -1.F, -1.F);
+  const auto snorm        = Snorm10x3_2::from_vec(kTangent);
+  EXPECT_VEC_NEAR(snorm.to_vec(), kTangent, 0.5F / 511.F);
+  EXPECT_VEC_NEAR(Snorm16x2::from_vec(Vec2f(-1.F, 0.3F)).to_vec(), Vec2f(-1.F, 0.3F), 0.5F / 32767.F);
+
+  const auto unorm16 = Unorm16x4::from_vec(Vec4f(0.F, 0.5F, 1.F, 2.F));
+  EXPECT_EQ(unorm16.x, 0);
+  EXPECT_EQ(unorm16.y, 32768);
+  EXPECT_EQ(unorm16.w, 65535);
+  EXPECT_VEC_NEAR(unorm16.to_vec(), Vec4f(0.F, 0.5F, 1.F, 1.F), 0.5F / 65535.F);
+}
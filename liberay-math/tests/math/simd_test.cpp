@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <liberay/math/mat.hpp>
+#include <liberay/math/quat.hpp>
+#include <liberay/math/vec.hpp>
+#include <tests/helpers/math_helpers.hpp>
+
+using namespace eray::math;  // NOLINT
+
+// The SIMD backend is compared against the scalar reference below and the constant evaluated generic code.
+
+namespace {
+
+constexpr auto kEpsilon = 1e-5F;
+
+constexpr auto kLhs = Mat4f{Vec4f{1.F, 2.F, 3.F, 4.F}, Vec4f{-5.F, 6.F, 7.F, 8.F}, Vec4f{9.F, -10.F, 11.F, 12.F},
+                            Vec4f{13.F, 14.F, -15.F, 16.F}};
+constexpr auto kRhs = Mat4f{Vec4f{0.5F, -1.F, 2.F, 0.F}, Vec4f{3.F, 0.25F, -2.F, 1.F}, Vec4f{-1.F, 4.F, 1.5F, 2.F},
+                            Vec4f{0.F, 1.F, -3.F, 0.75F}};
+constexpr auto kVec = Vec4f{1.5F, -2.F, 0.5F, 3.F};
+
+float reference_dot(const Vec4f& lhs, const Vec4f& rhs) {
+  return lhs[0] * rhs[0] + lhs[1] * rhs[1] + lhs[2] * rhs[2] + lhs[3] * rhs[3];
+}
+
+Vec4f reference_row(const Mat4f& mat, std::size_t i) { return Vec4f{mat[0][i], mat[1][i], mat[2][i], mat[3][i]}; }
+
+}  // namespace
+
+TEST(SimdTest, MatrixProductMatchesScalarCode) {
+  auto expected = Mat4f::zeros();
+  for (auto j = 0U; j < 4; ++j) {
+    for (auto i = 0U; i < 4; ++i) {
+      expected[j][i] = reference_dot(reference_row(kLhs, i), kRhs[j]);
+    }
+  }
+  EXPECT_MAT_NEAR(expected, kLhs * kRhs, kEpsilon);
+}
+
+TEST(SimdTest, MatrixVectorProductsMatchScalarCode) {
+  auto expected_rhs = Vec4f::zeros();
+  auto expected_lhs = Vec4f::zeros();
+  for (auto i = 0U; i < 4; ++i) {
+    expected_rhs[i] = reference_dot(reference_row(kLhs, i), kVec);
+    expected_lhs[i] = reference_dot(kVec, kLhs[i]);
+  }
+  EXPECT_VEC_NEAR(expected_rhs, kLhs * kVec, kEpsilon);
+  EXPECT_VEC_NEAR(expected_lhs, kVec * kLhs, kEpsilon);
+}
+
+TEST(SimdTest, DotAndNormalizeMatchGenericCode) {
+  constexpr auto kExpectedDot = dot(kVec, Vec4f{2.F, 1.F, -4.F, 0.5F});
+  auto vec                    = kVec;
+  EXPECT_NEAR(kExpectedDot, dot(vec, Vec4f{2.F, 1.F, -4.F, 0.5F}), kEpsilon);
+
+  auto normalized = vec.normalized();
+  EXPECT_NEAR(dot(normalized, normalized), 1.F, kEpsilon);
+  EXPECT_VEC_NEAR(kVec / 3.90512483795F, normalized, kEpsilon);
+}
+
+TEST(SimdTest, QuaternionProductMatchesGenericCode) {
+  constexpr auto kQ1       = Quatf(0.5F, -1.F, 2.F, 0.25F);
+  constexpr auto kQ2       = Quatf(-1.5F, 0.75F, 1.F, -2.F);
+  constexpr auto kExpected = kQ1 * kQ2;
+  auto q1                  = kQ1;
+  auto q2                  = kQ2;
+
+  const auto actual = q1 * q2;
+  EXPECT_NEAR(kExpected.w, actual.w, kEpsilon);
+  EXPECT_NEAR(kExpected.x, actual.x, kEpsilon);
+  EXPECT_NEAR(kExpected.y, actual.y, kEpsilon);
+  EXPECT_NEAR(kExpected.z, actual.z, kEpsilon);
+
+  constexpr auto kExpectedDot = dot(kQ1, kQ2);
+  EXPECT_NEAR(kExpectedDot, dot(q1, q2), kEpsilon);
+
+  const auto normalized = q1.normalized();
+  EXPECT_NEAR(dot(normalized, normalized), 1.F, kEpsilon);
+}
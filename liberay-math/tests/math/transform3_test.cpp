@@ -3,6 +3,7 @@
 #include <liberay/math/transform3.hpp>
 #include <liberay/math/vec.hpp>
 #include <numbers>
+#include <vector>
 #include <tests/helpers/math_helpers.hpp>
 
 constexpr float kPi = std::numbers::pi_v<float>;
@@ -173,3 +174,64 @@ TEST_F(TransformTest, ScaleIsTransformedProperly) {
   // then
   EXPECT_VEC_NEAR(expected, transform_.scale(), 1e-5F);
 }
+
+/**
+ * Cache invalidation
+ */
+
+TEST_F(TransformTest, WorldVersionChangesWithAncestorsOnly) {
+  // given
+  Transform3f sibling;
+  sibling.set_parent(parent_transform_);
+  Transform3f child;
+  child.local_set_parent(transform_);
+  const auto version         = child.world_version();
+  const auto sibling_version = sibling.world_version();
+
+  // when
+  transform_.move(Vec3f(1.F, 0.F, 0.F));
+
+  // then
+  EXPECT_NE(version, child.world_version());
+  EXPECT_EQ(sibling_version, sibling.world_version());
+  EXPECT_EQ(child.world_version(), child.world_version());
+}
+
+TEST_F(TransformTest, DeepChainMatricesFollowAncestorChanges) {
+  // given
+  constexpr auto kDepth = 16U;
+  auto chain            = std::vector<Transform3f>();
+  chain.reserve(kDepth);
+  for (auto i = 0U; i < kDepth; ++i) {
+    chain.emplace_back(Vec3f(1.F, 0.F, 0.F));
+    if (i > 0) {
+      chain[i].local_set_parent(chain[i - 1]);
+    }
+  }
+  EXPECT_VEC_NEAR(chain.back().pos(), Vec3f(16.F, 0.F, 0.F), 1e-5F);
+
+  // when
+  chain.front().set_local_scale(Vec3f::filled(2.F));
+  chain[kDepth / 2].local_pos() = Vec3f(0.F, 1.F, 0.F);
+  chain[kDepth / 2].mark_dirty();
+
+  // then
+  const auto expected = Vec3f(1.F + 2.F * 14.F, 2.F, 0.F);
+  EXPECT_VEC_NEAR(chain.back().pos(), expected, 1e-4F);
+  EXPECT_VEC_NEAR(Vec3f(chain.back().world_to_local_matrix() * Vec4f(expected, 1.F)), Vec3f(0.F, 0.F, 0.F), 1e-4F);
+}
+
+TEST_F(TransformTest, ChildIsInvalidatedWhenParentIsDestroyed) {
+  // given
+  Transform3f child(Vec3f(1.F, 0.F, 0.F));
+  {
+    Transform3f parent(Vec3f(0.F, 5.F, 0.F));
+    child.local_set_parent(parent);
+    EXPECT_VEC_NEAR(child.pos(), Vec3f(1.F, 5.F, 0.F), 1e-5F);
+    EXPECT_VEC_NEAR(Vec3f(child.local_to_world_matrix()[3]), Vec3f(1.F, 5.F, 0.F), 1e-5F);
+  }
+
+  // then
+  EXPECT_FALSE(child.has_parent());
+  EXPECT_VEC_NEAR(Vec3f(child.local_to_world_matrix()[3]), Vec3f(1.F, 0.F, 0.F), 1e-5F);
+}
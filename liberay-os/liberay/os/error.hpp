@@ -13,13 +13,17 @@ class ErrorCode {
   struct WindowBackendFailure {};
   struct RenderingAPIInitializationFailure {};
   struct RenderingAPINotSupported {};
+  struct ThreadConfigurationFailure {};
+  struct FileError {};
 
   using Enum = std::variant<              //
       WindowBackendNotSupported,          //
       WindowBackendCreationFailure,       //
       WindowBackendFailure,               //
       RenderingAPIInitializationFailure,  //
-      RenderingAPINotSupported            //
+      RenderingAPINotSupported,           //
+      ThreadConfigurationFailure,         //
+      FileError                           //
       >;
 };
 
@@ -4,100 +4,174 @@
 
 #include <expected>
 #include <liberay/os/file_dialog.hpp>
+#include <liberay/util/logger.hpp>
 #include <liberay/util/path_utf8.hpp>
 #include <nfd/nfd.hpp>
+#include <utility>
 
 namespace eray::os {
 
 FileDialog::~FileDialog() {
+  if (!worker_.joinable()) {
+    return;
+  }
+
+  {
+    const auto lock = std::lock_guard(state_->mutex);
+    state_->stop    = true;
+  }
+  state_->request_cv.notify_one();
+
   if (is_active()) {
     // https://stackoverflow.com/a/58222149
-    // The nfd is a blocking api so there is no way to tell it to stop working.
-    // An alternative would be to freeze ui and wait for the dialog exit by calling .join() instead.
-    this->dialog_thread_.detach();
+    // The nfd is a blocking api so there is no way to tell it to stop working. The worker owns the shared state and
+    // exits once the dialog is closed.
+    worker_.detach();
+  } else {
+    worker_.join();
   }
 }
 
 std::expected<void, FileDialog::FileDialogError> FileDialog::update() {
-  if (!dialog_task_.has_value()) {
+  if (!state_->has_completion.load(std::memory_order_acquire)) {
     return {};
   }
 
-  if (dialog_task_->wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) {
-    return {};
+  auto completion = Completion{};
+  {
+    const auto lock = std::lock_guard(state_->mutex);
+    completion      = *std::exchange(state_->completion, std::nullopt);
+    state_->has_completion.store(false, std::memory_order_relaxed);
   }
+  auto on_finish = std::exchange(on_finish_, nullptr);
+  state_->active.store(false, std::memory_order_release);
 
-  auto result = dialog_task_->get();
-  if (result.has_value()) {
-    if (on_finish_.has_value()) {
-      auto path = util::utf8str_to_path(*result);
-
-      if (std::filesystem::exists(path.parent_path())) {
-        (*on_finish_)(std::move(path));
-      } else {
-        util::Logger::err("Incorrect path {} obtained from file dialog", path.string());
-        return std::unexpected(DirectoryDoesNotExist);
-      }
-    } else {
-      util::Logger::warn(R"(Obtained path target, but no handler is set)");
-    }
-  } else {
+  if (!completion.path) {
     util::Logger::info("File dialog cancelled");
+    return {};
+  }
+  if (!on_finish) {
+    util::Logger::warn(R"(Obtained path target, but no handler is set)");
+    return {};
   }
 
-  dialog_task_ = std::nullopt;
-  dialog_thread_.join();
+  auto path = util::utf8str_to_path(*completion.path);
+  if (!std::filesystem::exists(path.parent_path())) {
+    util::Logger::err("Incorrect path {} obtained from file dialog", path.string());
+    return std::unexpected(DirectoryDoesNotExist);
+  }
+  on_finish(path);
 
   return {};
 }
 
+void FileDialog::set_completion_callback(std::function<void()> callback) {
+  const auto lock     = std::lock_guard(state_->mutex);
+  state_->on_complete = std::move(callback);
+}
+
 std::expected<void, FileDialog::FileDialogError> FileDialog::start_file_dialog(
-    FileDialog::DialogType type, std::optional<std::span<const FilterItem>> filters,
-    std::optional<std::string> default_name) {
-  if (dialog_task_.has_value()) {
+    FileDialog::DialogType type, const std::function<void(const std::filesystem::path&)>& on_finish,
+    std::optional<std::span<const FilterItem>> filters, std::optional<std::string> default_name) {
+  if (is_active()) {
     util::Logger::warn("Detected an attempt to open second file dialog");
     return std::unexpected(FileDialogAlreadyOpen);
   }
 
-  std::promise<std::optional<std::string>> curr_promise;
-  dialog_task_   = curr_promise.get_future();
-  dialog_thread_ = std::thread(
-      [type](std::promise<std::optional<std::string>> promise,
-             std::optional<std::span<const FilterItem>> _dialog_filters, std::optional<std::string> _default_name) {
-        auto res = NFD_Init();
-        if (res == NFD_ERROR) {
-          util::Logger::err("Failed to open the file dialog");
-        }
-
-        nfdu8char_t* out_path = nullptr;
-        nfdresult_t result    = NFD_ERROR;
-
-        if (type == DialogType::OpenFile) {
-          result = NFD_OpenDialogU8(
-              &out_path,
-              _dialog_filters ? reinterpret_cast<const nfdu8filteritem_t*>(_dialog_filters->data()) : nullptr,
-              _dialog_filters ? static_cast<nfdfiltersize_t>(_dialog_filters->size()) : 0, nullptr);
-        } else if (type == DialogType::SaveFile) {
-          result = NFD_SaveDialogU8(
-              &out_path,
-              _dialog_filters ? reinterpret_cast<const nfdu8filteritem_t*>(_dialog_filters->data()) : nullptr,
-              _dialog_filters ? static_cast<nfdfiltersize_t>(_dialog_filters->size()) : 0, nullptr,
-              _default_name ? _default_name->data() : nullptr);
-        } else {
-          result = NFD_PickFolderU8(&out_path, nullptr);
-        }
-
-        if (result == NFD_OKAY) {
-          promise.set_value(std::string(out_path));
-          NFD_FreePathU8(out_path);
-        } else {
-          promise.set_value(std::nullopt);
-        }
-
-        NFD_Quit();
-      },
-      std::move(curr_promise), std::move(filters), std::move(default_name));
+  // The filters of the caller might not outlive the dialog
+  auto request = Request{
+      .type         = type,
+      .filter_names = {},
+      .filter_specs = {},
+      .default_name = std::move(default_name),
+  };
+  if (filters) {
+    for (const auto& filter : *filters) {
+      request.filter_names.emplace_back(filter.name);
+      request.filter_specs.emplace_back(filter.spec);
+    }
+  }
+
+  on_finish_ = on_finish;
+  state_->active.store(true, std::memory_order_release);
+  {
+    const auto lock = std::lock_guard(state_->mutex);
+    state_->request = std::move(request);
+  }
+  if (!worker_.joinable()) {
+    worker_ = std::thread([state = state_] { worker_loop(state); });
+  }
+  state_->request_cv.notify_one();
+
   return {};
 }
 
+void FileDialog::worker_loop(const std::shared_ptr<State>& state) {
+  // The nfd must be initialized and used on the same thread
+  if (NFD_Init() == NFD_ERROR) {
+    util::Logger::err("Failed to initialize the file dialogs: {}", NFD_GetError());
+  }
+
+  auto lock = std::unique_lock(state->mutex);
+  while (true) {
+    state->request_cv.wait(lock, [&state] { return state->stop || state->request.has_value(); });
+    if (state->stop) {
+      break;
+    }
+
+    const auto request = *std::exchange(state->request, std::nullopt);
+    lock.unlock();
+    auto path = show_dialog(request);
+    lock.lock();
+
+    state->completion = Completion{.path = std::move(path)};
+    state->has_completion.store(true, std::memory_order_release);
+    if (state->on_complete) {
+      state->on_complete();
+    }
+  }
+  lock.unlock();
+
+  NFD_Quit();
+}
+
+std::optional<std::string> FileDialog::show_dialog(const Request& request) {
+  auto filters = std::vector<nfdu8filteritem_t>();
+  filters.reserve(request.filter_names.size());
+  for (auto i = 0U; i < request.filter_names.size(); ++i) {
+    filters.push_back(nfdu8filteritem_t{
+        .name = request.filter_names[i].c_str(),
+        .spec = request.filter_specs[i].c_str(),
+    });
+  }
+  const auto* filter_list = filters.empty() ? nullptr : filters.data();
+  const auto filter_count = static_cast<nfdfiltersize_t>(filters.size());
+
+  nfdu8char_t* out_path = nullptr;
+  nfdresult_t result    = NFD_ERROR;
+  switch (request.type) {
+    case DialogType::OpenFile:
+      result = NFD_OpenDialogU8(&out_path, filter_list, filter_count, nullptr);
+      break;
+    case DialogType::SaveFile:
+      result = NFD_SaveDialogU8(&out_path, filter_list, filter_count, nullptr,
+                                request.default_name ? request.default_name->c_str() : nullptr);
+      break;
+    case DialogType::PickFolder:
+      result = NFD_PickFolderU8(&out_path, nullptr);
+      break;
+  }
+
+  if (result == NFD_ERROR) {
+    util::Logger::err("File dialog failed: {}", NFD_GetError());
+  }
+  if (result != NFD_OKAY) {
+    return std::nullopt;
+  }
+
+  auto path = std::string(out_path);
+  NFD_FreePathU8(out_path);
+  return path;
+}
+
 }  // namespace eray::os
@@ -2,21 +2,30 @@
 
 #pragma once
 
-#include <sys/types.h>
-
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <expected>
 #include <filesystem>
-#include <future>
+#include <functional>
 #include <liberay/util/ruleof.hpp>
 #include <liberay/util/zstring_view.hpp>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <span>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace eray::os {
 
+/**
+ * @brief Native file dialogs shown by a worker thread, so that the frames keep running while a dialog is open. The
+ * results are queued by the worker and the handlers are invoked by `update()` on the thread that drains the queue,
+ * usually the frame loop.
+ *
+ */
 class FileDialog {
  public:
   ERAY_DELETE_COPY_AND_MOVE(FileDialog)
@@ -42,44 +51,96 @@ class FileDialog {
     return instance;
   }
 
-  bool is_active() const { return dialog_task_.has_value(); }
+  /**
+   * @brief True from opening a dialog until its handler is invoked by `update()`.
+   *
+   */
+  bool is_active() const { return state_->active.load(std::memory_order_acquire); }
 
+  /**
+   * @note The filters are copied, they do not have to outlive the call.
+   *
+   */
   std::expected<void, FileDialogError> open_file(
       const std::function<void(const std::filesystem::path&)>& on_open_function,
       std::optional<std::span<const FilterItem>> filters = std::nullopt) {
-    on_finish_ = on_open_function;
-    return start_file_dialog(DialogType::OpenFile, std::move(filters));
+    return start_file_dialog(DialogType::OpenFile, on_open_function, filters);
   }
 
   std::expected<void, FileDialogError> save_file(
       const std::function<void(const std::filesystem::path&)>& on_save_function,
       std::optional<std::span<const FilterItem>> filters = std::nullopt,
       std::optional<std::string> default_name            = std::nullopt) {
-    on_finish_ = on_save_function;
-    return start_file_dialog(DialogType::SaveFile, std::move(filters), std::move(default_name));
+    return start_file_dialog(DialogType::SaveFile, on_save_function, filters, std::move(default_name));
   }
 
   std::expected<void, FileDialogError> pick_folder(
       const std::function<void(const std::filesystem::path&)>& on_pick_function) {
-    on_finish_ = on_pick_function;
-    return start_file_dialog(DialogType::PickFolder);
+    return start_file_dialog(DialogType::PickFolder, on_pick_function);
   }
 
+  /**
+   * @brief Invokes the handler of a finished dialog. Costs a single atomic load unless a dialog has finished.
+   *
+   */
   std::expected<void, FileDialogError> update();
 
+  /**
+   * @brief Invoked on the worker thread when a dialog finishes, e.g. to wake an idle frame loop that drains the
+   * results.
+   *
+   */
+  void set_completion_callback(std::function<void()> callback);
+
  private:
   enum class DialogType : uint8_t { OpenFile = 0, SaveFile, PickFolder };
 
+  struct Request {
+    DialogType type;
+    std::vector<std::string> filter_names;
+    std::vector<std::string> filter_specs;
+    std::optional<std::string> default_name;
+  };
+
+  struct Completion {
+    std::optional<std::string> path;
+  };
+
+  /**
+   * @brief Shared with the worker thread, which is detached when the dialog is still open at the destruction.
+   *
+   */
+  struct State {
+    std::mutex mutex;
+    std::condition_variable request_cv;
+    std::optional<Request> request;
+    std::optional<Completion> completion;
+    std::function<void()> on_complete;
+    bool stop = false;
+
+    std::atomic<bool> has_completion = false;
+    std::atomic<bool> active         = false;
+  };
+
   FileDialog() = default;
 
   std::expected<void, FileDialogError> start_file_dialog(
-      DialogType dialog_type, std::optional<std::span<const FilterItem>> filters = std::nullopt,
-      std::optional<std::string> default_name = std::nullopt);
+      DialogType dialog_type, const std::function<void(const std::filesystem::path&)>& on_finish,
+      std::optional<std::span<const FilterItem>> filters = std::nullopt,
+      std::optional<std::string> default_name            = std::nullopt);
+
+  static void worker_loop(const std::shared_ptr<State>& state);
+  static std::optional<std::string> show_dialog(const Request& request);
 
  private:
-  std::optional<std::future<std::optional<std::string>>> dialog_task_;
-  std::thread dialog_thread_;
-  std::optional<std::function<void(const std::filesystem::path&)>> on_finish_;
+  std::shared_ptr<State> state_ = std::make_shared<State>();
+  std::thread worker_;
+
+  /**
+   * @brief Handler of the open dialog, used only by the thread that opens the dialogs and drains the results.
+   *
+   */
+  std::function<void(const std::filesystem::path&)> on_finish_;
 };
 
 }  // namespace eray::os
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <chrono>
 #include <liberay/os/input.hpp>
 #include <liberay/os/window/events/event.hpp>
 #include <liberay/os/window/mouse_cursor_codes.hpp>
@@ -5,89 +7,77 @@
 
 namespace eray::os {
 
-std::unique_ptr<InputManager> InputManager::create(std::shared_ptr<Window> window) {
-  auto* input_manager = new InputManager(std::move(window));  // NOLINT
-
-  input_manager->window_->set_event_callback<KeyPressedEvent>(
-      [input_manager](const KeyPressedEvent& key_pressed_event) {
-        auto key_code = static_cast<uint8_t>(key_pressed_event.key_code());
-
-        input_manager->is_key_pressed_[key_code] = true;
-        input_manager->keys_just_pressed_.insert(key_code);
-        ++input_manager->pressed_count_;
-
-        return false;
-      });
-
-  input_manager->window_->set_event_callback<KeyReleasedEvent>(
-      [input_manager](const KeyReleasedEvent& key_pressed_event) {
-        auto key_code = static_cast<uint8_t>(key_pressed_event.key_code());
-
-        input_manager->is_key_pressed_[key_code] = false;
-        input_manager->keys_just_released_.insert(key_code);
-        input_manager->pressed_count_ = std::max(0, input_manager->pressed_count_ - 1);
-
-        return false;
-      });
-
-  input_manager->window_->set_event_callback<MouseButtonPressedEvent>(
-      [input_manager](const MouseButtonPressedEvent& mouse_btn_pressed_event) {
-        auto key_code = static_cast<uint8_t>(mouse_btn_pressed_event.mouse_btn_code());
-
-        input_manager->is_mouse_btn_pressed_[key_code] = true;
-        input_manager->mouse_btns_just_pressed_.insert(key_code);
-        ++input_manager->pressed_count_;
-
-        return false;
-      });
+namespace {
 
-  input_manager->window_->set_event_callback<MouseButtonReleasedEvent>(
-      [input_manager](const MouseButtonReleasedEvent& mouse_btn_pressed_event) {
-        auto key_code = static_cast<uint8_t>(mouse_btn_pressed_event.mouse_btn_code());
-
-        input_manager->is_mouse_btn_pressed_[key_code] = false;
-        input_manager->mouse_btns_just_released_.insert(key_code);
-        input_manager->pressed_count_ = std::max(0, input_manager->pressed_count_ - 1);
-
-        return false;
-      });
-
-  input_manager->window_->set_event_callback<MouseScrolledEvent>(
-      [input_manager](const MouseScrolledEvent& mouse_scrolled_event) {
-        input_manager->mouse_scroll_x_ = mouse_scrolled_event.x_offset();
-        input_manager->mouse_scroll_y_ = mouse_scrolled_event.y_offset();
-        input_manager->just_scrolled_  = true;
+uint64_t now_ns() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
 
-        return false;
-      });
+}  // namespace
 
-  input_manager->window_->set_event_callback<MouseEntered>([input_manager](const auto&) {
-    input_manager->is_mouse_on_window_ = true;
+std::shared_ptr<InputEventRing> InputEventRing::create(const std::shared_ptr<Window>& window) {
+  auto ring = std::shared_ptr<InputEventRing>(new InputEventRing());  // NOLINT
 
+  const auto push = [ring](InputEventType type, uint8_t code, double x = 0.0, double y = 0.0) {
+    ring->push(InputEvent{.type = type, .code = code, .x = x, .y = y, .timestamp_ns = now_ns()});
     return false;
-  });
-
-  input_manager->window_->set_event_callback<MouseLeft>([input_manager](const auto&) {
-    input_manager->is_mouse_on_window_ = false;
+  };
 
+  window->set_event_callback<KeyPressedEvent>([push](const KeyPressedEvent& event) {
+    return push(InputEventType::KeyPressed, static_cast<uint8_t>(event.key_code()));
+  });
+  window->set_event_callback<KeyReleasedEvent>([push](const KeyReleasedEvent& event) {
+    return push(InputEventType::KeyReleased, static_cast<uint8_t>(event.key_code()));
+  });
+  window->set_event_callback<MouseButtonPressedEvent>([push](const MouseButtonPressedEvent& event) {
+    return push(InputEventType::MouseBtnPressed, static_cast<uint8_t>(event.mouse_btn_code()));
+  });
+  window->set_event_callback<MouseButtonReleasedEvent>([push](const MouseButtonReleasedEvent& event) {
+    return push(InputEventType::MouseBtnReleased, static_cast<uint8_t>(event.mouse_btn_code()));
+  });
+  window->set_event_callback<MouseScrolledEvent>([push](const MouseScrolledEvent& event) {
+    return push(InputEventType::MouseScrolled, 0, event.x_offset(), event.y_offset());
+  });
+  window->set_event_callback<MouseMovedEvent>([ring](const MouseMovedEvent& event) {
+    ring->push(InputEvent{
+        .type         = InputEventType::MouseMoved,
+        .code         = 0,
+        .x            = event.x(),
+        .y            = event.y(),
+        .timestamp_ns = event.timestamp_ns(),
+    });
     return false;
   });
+  window->set_event_callback<MouseEntered>([push](const auto&) { return push(InputEventType::MouseEntered, 0); });
+  window->set_event_callback<MouseLeft>([push](const auto&) { return push(InputEventType::MouseLeft, 0); });
+
+  return ring;
+}
 
-  auto result = std::unique_ptr<InputManager>(input_manager);
+std::unique_ptr<InputManager> InputManager::create(std::shared_ptr<Window> window,
+                                                   std::shared_ptr<InputEventRing> events) {
+  auto result = std::unique_ptr<InputManager>(new InputManager(std::move(window), std::move(events)));  // NOLINT
   result->is_key_pressed_.fill(false);
   result->is_mouse_btn_pressed_.fill(false);
 
   return result;
 }
 
+std::unique_ptr<InputManager> InputManager::create(std::shared_ptr<Window> window) {
+  auto events = InputEventRing::create(window);
+  return create(std::move(window), std::move(events));
+}
+
 bool InputManager::is_key_just_pressed(KeyCode key_code) const {
   auto code = static_cast<uint8_t>(key_code);
-  return keys_just_pressed_.contains(code);
+  return keys_just_pressed_.test(code);
 }
 
 bool InputManager::is_key_just_released(KeyCode key_code) const {
   auto code = static_cast<uint8_t>(key_code);
-  return keys_just_released_.contains(code);
+  return keys_just_released_.test(code);
 }
 
 bool InputManager::is_key_pressed(KeyCode key_code) const {
@@ -99,12 +89,12 @@ bool InputManager::is_anything_pressed() const { return pressed_count_ != 0; }
 
 bool InputManager::is_mouse_btn_just_pressed(MouseBtnCode mouse_btn_code) const {
   auto code = static_cast<uint8_t>(mouse_btn_code);
-  return mouse_btns_just_pressed_.contains(code);
+  return mouse_btns_just_pressed_.test(code);
 }
 
 bool InputManager::is_mouse_btn_just_released(MouseBtnCode mouse_btn_code) const {
   auto code = static_cast<uint8_t>(mouse_btn_code);
-  return mouse_btns_just_released_.contains(code);
+  return mouse_btns_just_released_.test(code);
 }
 
 bool InputManager::is_mouse_btn_pressed(MouseBtnCode mouse_btn_code) const {
@@ -112,7 +102,15 @@ bool InputManager::is_mouse_btn_pressed(MouseBtnCode mouse_btn_code) const {
   return is_mouse_btn_pressed_[code];
 }
 
-InputManager::InputManager(std::shared_ptr<Window> window) : window_(std::move(window)) {}
+InputManager::InputManager(std::shared_ptr<Window> window, std::shared_ptr<InputEventRing> ring)
+    : ring_(std::move(ring)), cursor_(ring_->head()), window_(std::move(window)) {
+  // The position is updated by the motion events from now on
+  const auto mouse_pos = window_->mouse_pos();
+  mouse_pos_x_         = mouse_pos.x;
+  mouse_pos_y_         = mouse_pos.y;
+  last_mouse_pos_x_    = mouse_pos.x;
+  last_mouse_pos_y_    = mouse_pos.y;
+}
 
 void InputManager::set_mouse_cursor_mode(CursorMode cursor_mode) {
   if (!window_->is_destroyed()) {
@@ -120,6 +118,10 @@ void InputManager::set_mouse_cursor_mode(CursorMode cursor_mode) {
   }
 }
 
+bool InputManager::set_raw_mouse_motion(bool enabled) {
+  return !window_->is_destroyed() && window_->set_raw_mouse_motion(enabled);
+}
+
 CursorMode InputManager::cursor_mode() const {
   if (!window_->is_destroyed()) {
     return window_->mouse_cursor_mode();
@@ -127,11 +129,106 @@ CursorMode InputManager::cursor_mode() const {
   return CursorMode::Normal;
 }
 
+std::unique_ptr<InputManager> InputManager::create_snapshot() const {
+  // The snapshot is not prepared by the application, so it does not read the events
+  auto snapshot = std::unique_ptr<InputManager>(new InputManager(window_, ring_));  // NOLINT
+  snapshot->copy_state_from(*this);
+  return snapshot;
+}
+
+void InputManager::copy_state_from(const InputManager& other) {
+  is_key_pressed_           = other.is_key_pressed_;
+  keys_just_pressed_        = other.keys_just_pressed_;
+  keys_just_released_       = other.keys_just_released_;
+  is_mouse_btn_pressed_     = other.is_mouse_btn_pressed_;
+  mouse_btns_just_pressed_  = other.mouse_btns_just_pressed_;
+  mouse_btns_just_released_ = other.mouse_btns_just_released_;
+  just_scrolled_            = other.just_scrolled_;
+  events_                   = other.events_;
+  dropped_events_           = other.dropped_events_;
+  last_mouse_pos_x_         = other.last_mouse_pos_x_;
+  last_mouse_pos_y_         = other.last_mouse_pos_y_;
+  mouse_pos_x_              = other.mouse_pos_x_;
+  mouse_pos_y_              = other.mouse_pos_y_;
+  mouse_scroll_x_           = other.mouse_scroll_x_;
+  mouse_scroll_y_           = other.mouse_scroll_y_;
+  mouse_motion_x_           = other.mouse_motion_x_;
+  mouse_motion_y_           = other.mouse_motion_y_;
+  motion_pos_x_             = other.motion_pos_x_;
+  motion_pos_y_             = other.motion_pos_y_;
+  has_motion_origin_        = other.has_motion_origin_;
+  pressed_count_            = other.pressed_count_;
+  is_mouse_on_window_       = other.is_mouse_on_window_;
+  is_input_captured_        = other.is_input_captured_;
+}
+
+void InputManager::read_events() {
+  if (const auto tail = ring_->tail(); cursor_ < tail) {
+    dropped_events_ += tail - cursor_;
+    cursor_          = tail;
+  }
+  for (const auto head = ring_->head(); cursor_ < head; ++cursor_) {
+    const auto event = ring_->read(cursor_);
+    if (!event) {
+      ++dropped_events_;
+      continue;
+    }
+    apply(*event);
+    events_.push_back(*event);
+  }
+}
+
+void InputManager::apply(const InputEvent& event) {
+  switch (event.type) {
+    case InputEventType::KeyPressed:
+      is_key_pressed_[event.code] = true;
+      keys_just_pressed_.set(event.code);
+      ++pressed_count_;
+      break;
+    case InputEventType::KeyReleased:
+      is_key_pressed_[event.code] = false;
+      keys_just_released_.set(event.code);
+      pressed_count_ = std::max(0, pressed_count_ - 1);
+      break;
+    case InputEventType::MouseBtnPressed:
+      is_mouse_btn_pressed_[event.code] = true;
+      mouse_btns_just_pressed_.set(event.code);
+      ++pressed_count_;
+      break;
+    case InputEventType::MouseBtnReleased:
+      is_mouse_btn_pressed_[event.code] = false;
+      mouse_btns_just_released_.set(event.code);
+      pressed_count_ = std::max(0, pressed_count_ - 1);
+      break;
+    case InputEventType::MouseScrolled:
+      mouse_scroll_x_ += event.x;
+      mouse_scroll_y_ += event.y;
+      just_scrolled_   = true;
+      break;
+    case InputEventType::MouseMoved:
+      if (has_motion_origin_) {
+        mouse_motion_x_ += event.x - motion_pos_x_;
+        mouse_motion_y_ += event.y - motion_pos_y_;
+      }
+      motion_pos_x_      = event.x;
+      motion_pos_y_      = event.y;
+      has_motion_origin_ = true;
+      break;
+    case InputEventType::MouseEntered:
+      is_mouse_on_window_ = true;
+      break;
+    case InputEventType::MouseLeft:
+      is_mouse_on_window_ = false;
+      break;
+  }
+}
+
 void InputManager::process() {
-  keys_just_pressed_.clear();
-  keys_just_released_.clear();
-  mouse_btns_just_pressed_.clear();
-  mouse_btns_just_released_.clear();
+  keys_just_pressed_.reset();
+  keys_just_released_.reset();
+  mouse_btns_just_pressed_.reset();
+  mouse_btns_just_released_.reset();
+  events_.clear();
 
   just_scrolled_ = false;
 
@@ -140,6 +237,8 @@ void InputManager::process() {
 
   mouse_scroll_x_ = 0.;
   mouse_scroll_y_ = 0.;
+  mouse_motion_x_ = 0.;
+  mouse_motion_y_ = 0.;
 }
 
 }  // namespace eray::os
@@ -1,16 +1,167 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <bitset>
 #include <concepts>
+#include <cstdint>
+#include <cstring>
 #include <liberay/os/window/input_codes.hpp>
 #include <liberay/os/window/mouse_cursor_codes.hpp>
 #include <liberay/os/window/window.hpp>
 #include <memory>
-#include <unordered_set>
+#include <optional>
+#include <type_traits>
+#include <vector>
 
 namespace eray::os {
 
+enum class InputEventType : uint8_t {
+  KeyPressed,
+  KeyReleased,
+  MouseBtnPressed,
+  MouseBtnReleased,
+  MouseScrolled,
+  MouseMoved,
+  MouseEntered,
+  MouseLeft,
+};
+
+/**
+ * @brief Window input event with the time it was dispatched at.
+ *
+ */
+struct InputEvent {
+  InputEventType type;
+
+  /**
+   * @brief `KeyCode` or `MouseBtnCode` of the button events.
+   *
+   */
+  uint8_t code;
+
+  /**
+   * @brief Offsets of the scroll events, cursor position of the motion events.
+   *
+   */
+  double x;
+  double y;
+
+  /**
+   * @brief `std::chrono::steady_clock` time the window received the event at.
+   *
+   */
+  uint64_t timestamp_ns;
+};
+
+/**
+ * @brief Fixed capacity ring of the input events of a window. The window events are recorded once and every
+ * `InputManager` reads them with its own cursor, so the physics and the frame managers see the same events in the
+ * order they arrived.
+ *
+ * The ring is lock-free, the events are written by the window event callbacks on one thread and may be read on any
+ * threads at the same time, e.g. when the window events are pumped by a dedicated thread. The writer never waits for
+ * the readers, a reader that falls more than `kCapacity` events behind loses the overwritten events.
+ *
+ */
+class InputEventRing {
+ public:
+  static constexpr size_t kCapacity = 1024;
+
+  /**
+   * @brief Creates the ring and subscribes it to the input events of the `window`.
+   *
+   */
+  static std::shared_ptr<InputEventRing> create(const std::shared_ptr<Window>& window);
+
+  InputEventRing(const InputEventRing&)            = delete;
+  InputEventRing& operator=(const InputEventRing&) = delete;
+
+  /**
+   * @brief Must be called by a single thread.
+   *
+   */
+  void push(const InputEvent& event) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    // A reader copying the overwritten slot sees the started write and discards the copy
+    started_.store(head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto words = std::array<uint64_t, kSlotWords>{};
+    std::memcpy(words.data(), &event, sizeof(InputEvent));
+    auto& slot = slots_[head % kCapacity];
+    for (auto i = 0U; i < kSlotWords; ++i) {
+      slot[i].store(words[i], std::memory_order_relaxed);
+    }
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief Position of the next event, the cursors of the readers advance towards it.
+   *
+   */
+  uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Oldest event still held, a reader whose cursor is older has lost the events in between.
+   *
+   */
+  uint64_t tail() const {
+    const auto head = this->head();
+    return head > kCapacity ? head - kCapacity : 0;
+  }
+
+  /**
+   * @brief Copies the event at the `position`, which must be older than the `head()`.
+   *
+   * @return std::nullopt The event has been overwritten in the meantime.
+   */
+  std::optional<InputEvent> read(uint64_t position) const {
+    auto words       = std::array<uint64_t, kSlotWords>{};
+    const auto& slot = slots_[position % kCapacity];
+    for (auto i = 0U; i < kSlotWords; ++i) {
+      words[i] = slot[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (started_.load(std::memory_order_relaxed) > position + kCapacity) {
+      return std::nullopt;
+    }
+
+    auto event = InputEvent{};
+    std::memcpy(&event, words.data(), sizeof(InputEvent));
+    return event;
+  }
+
+ private:
+  InputEventRing() = default;
+
+  // The slots are copied word by word with relaxed atomics, so that a concurrent overwrite is not a data race
+  static constexpr size_t kSlotWords = (sizeof(InputEvent) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  static_assert(std::is_trivially_copyable_v<InputEvent>);
+
+  std::array<std::array<std::atomic<uint64_t>, kSlotWords>, kCapacity> slots_{};
+  std::atomic<uint64_t> head_ = 0;
+
+  /**
+   * @brief Number of the started writes, ahead of the `head_` while an event is written.
+   *
+   */
+  std::atomic<uint64_t> started_ = 0;
+};
+
 class InputManager {
  public:
+  /**
+   * @brief Creates a manager that reads the `events`, e.g. shared between the physics and the frame managers of the
+   * window.
+   *
+   */
+  static std::unique_ptr<InputManager> create(std::shared_ptr<Window> window, std::shared_ptr<InputEventRing> events);
+
+  /**
+   * @brief Creates a manager with its own event ring.
+   *
+   */
   static std::unique_ptr<InputManager> create(std::shared_ptr<Window> window);
 
   InputManager()                             = delete;
@@ -53,6 +204,26 @@ class InputManager {
 
   bool just_scrolled() const { return just_scrolled_; }
 
+  /**
+   * @brief Events read by the last `prepare()` since the previous `process()`, in the order they arrived. Unlike the
+   * edge queries the events keep the order and the timing of the input within the tick, e.g. of a click that was both
+   * pressed and released.
+   *
+   */
+  const std::vector<InputEvent>& events() const { return events_; }
+
+  /**
+   * @brief Number of the events that were overwritten in the ring before this manager read them.
+   *
+   */
+  uint64_t dropped_events() const { return dropped_events_; }
+
+  /**
+   * @brief Ring the manager reads the events from, e.g. to feed it with the events of an `InputReplay`.
+   *
+   */
+  InputEventRing& event_ring() const { return *ring_; }
+
   /**
    * @brief Returns true when the button is down.
    */
@@ -112,6 +283,10 @@ class InputManager {
     return static_cast<float>(mouse_pos_y_ - last_mouse_pos_y_);
   }
 
+  /**
+   * @brief Sum of the scroll offsets since the previous `process()`.
+   *
+   */
   template <typename T = float>
     requires std::floating_point<T>
   T delta_mouse_scroll_x() const {
@@ -130,40 +305,94 @@ class InputManager {
     return static_cast<float>(mouse_scroll_y_);
   }
 
+  /**
+   * @brief Sum of the mouse motion of every motion event since the previous `process()`. Unlike the delta of the
+   * positions sampled by `prepare()` it is not quantized to the tick rate and it is unaccelerated when the raw mouse
+   * motion is enabled, see `set_raw_mouse_motion()`.
+   *
+   */
+  template <typename T = float>
+    requires std::floating_point<T>
+  T mouse_motion_x() const {
+    return static_cast<T>(mouse_motion_x_);
+  }
+
+  template <typename T = float>
+    requires std::floating_point<T>
+  T mouse_motion_y() const {
+    return static_cast<T>(mouse_motion_y_);
+  }
+
   bool is_mouse_on_window() const { return is_mouse_on_window_; }
 
   void set_mouse_cursor_mode(CursorMode cursor_mode);
   CursorMode cursor_mode() const;
 
+  /**
+   * @brief Enables the raw mouse motion of the window, it applies while the cursor is disabled.
+   *
+   * @return false The raw mouse motion is not supported.
+   */
+  bool set_raw_mouse_motion(bool enabled);
+
   bool is_input_captured() const { return is_input_captured_; }
 
+  /**
+   * @brief Creates a copy of the current input state that is not updated by the window events. The state of the copy
+   * can be refreshed with `copy_state_from()`, e.g. to read the input on a different thread.
+   *
+   * @return std::unique_ptr<InputManager>
+   */
+  std::unique_ptr<InputManager> create_snapshot() const;
+
+  /**
+   * @brief Copies the input state of the `other` manager, the window stays the same.
+   *
+   * @param other
+   */
+  void copy_state_from(const InputManager& other);
+
   /**
    * @brief Called automatically bo the application.
    */
   void process();
 
   /**
-   * @brief Called automatically bo the application.
+   * @brief Called automatically bo the application. Reads the new events of the ring, the mouse position is the one of
+   * the last motion event. It does not query the window, so it may be called on any thread.
    */
   void prepare(bool input_captured) {
-    mouse_pos_x_ = window_->mouse_pos().x;
-    mouse_pos_y_ = window_->mouse_pos().y;
-
     is_input_captured_ = input_captured;
+    read_events();
+
+    if (has_motion_origin_) {
+      mouse_pos_x_ = motion_pos_x_;
+      mouse_pos_y_ = motion_pos_y_;
+    }
   }
 
  private:
-  explicit InputManager(std::shared_ptr<Window> window);
+  using CodeBitset = std::bitset<256>;
+
+  InputManager(std::shared_ptr<Window> window, std::shared_ptr<InputEventRing> ring);
+
+  void read_events();
+  void apply(const InputEvent& event);
 
  private:
   std::array<bool, static_cast<uint8_t>(KeyCode::_Count)> is_key_pressed_{};
-  std::unordered_set<uint8_t> keys_just_pressed_;
-  std::unordered_set<uint8_t> keys_just_released_;
+  CodeBitset keys_just_pressed_;
+  CodeBitset keys_just_released_;
 
   std::array<bool, static_cast<uint8_t>(MouseBtnCode::_Count)> is_mouse_btn_pressed_{};
-  std::unordered_set<uint8_t> mouse_btns_just_pressed_;
-  std::unordered_set<uint8_t> mouse_btns_just_released_;
-  bool just_scrolled_;
+  CodeBitset mouse_btns_just_pressed_;
+  CodeBitset mouse_btns_just_released_;
+  bool just_scrolled_ = false;
+
+  std::shared_ptr<InputEventRing> ring_;
+  uint64_t cursor_ = 0;
+  std::vector<InputEvent> events_;
+  uint64_t dropped_events_ = 0;
 
   double last_mouse_pos_x_ = 0.;
   double last_mouse_pos_y_ = 0.;
@@ -174,6 +403,17 @@ class InputManager {
   double mouse_scroll_x_ = 0.;
   double mouse_scroll_y_ = 0.;
 
+  double mouse_motion_x_ = 0.;
+  double mouse_motion_y_ = 0.;
+
+  /**
+   * @brief Position of the last motion event, the origin of the next motion.
+   *
+   */
+  double motion_pos_x_    = 0.;
+  double motion_pos_y_    = 0.;
+  bool has_motion_origin_ = false;
+
   int pressed_count_ = 0;
 
   bool is_mouse_on_window_ = true;
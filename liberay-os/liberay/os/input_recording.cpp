@@ -0,0 +1,232 @@
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <liberay/os/input_recording.hpp>
+#include <liberay/os/window/input_codes.hpp>
+#include <liberay/util/logger.hpp>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace eray::os {
+
+namespace {
+
+// The file is a header followed by the frames, every frame record is followed by its event records. The values are
+// stored in the native byte order
+constexpr auto kMagic   = std::array<char, 8>{'E', 'R', 'A', 'Y', 'I', 'N', 'P', '\0'};
+constexpr auto kVersion = uint32_t{1};
+
+struct FileHeader {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t tick_time_ns;
+};
+
+struct FrameRecord {
+  uint64_t delta_ns;
+  uint64_t lag_ns;
+  uint32_t tick_count;
+  uint32_t framebuffer_width;
+  uint32_t framebuffer_height;
+  uint32_t event_count;
+};
+
+/**
+ * @brief The events are stored without the padding of `InputEvent`: the type, the code, the x, the y and the timestamp.
+ *
+ */
+constexpr auto kEventRecordSize = 2 + 3 * sizeof(uint64_t);
+
+uint64_t now_ns() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+template <typename T>
+void append(std::vector<std::byte>& bytes, const T& value) {
+  const auto offset = bytes.size();
+  bytes.resize(offset + sizeof(T));
+  std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+/**
+ * @brief Reads a `T` at the `offset` and advances it, or returns `std::nullopt` when the bytes end before the value.
+ *
+ */
+template <typename T>
+std::optional<T> read(std::span<const std::byte> bytes, size_t& offset) {
+  if (bytes.size() - offset < sizeof(T)) {
+    return std::nullopt;
+  }
+  auto value = T{};
+  std::memcpy(&value, bytes.data() + offset, sizeof(T));
+  offset += sizeof(T);
+  return value;
+}
+
+bool is_valid(const InputEvent& event) {
+  switch (event.type) {
+    case InputEventType::KeyPressed:
+    case InputEventType::KeyReleased:
+      return event.code < static_cast<uint8_t>(KeyCode::_Count);
+    case InputEventType::MouseBtnPressed:
+    case InputEventType::MouseBtnReleased:
+      return event.code < static_cast<uint8_t>(MouseBtnCode::_Count);
+    case InputEventType::MouseScrolled:
+    case InputEventType::MouseMoved:
+    case InputEventType::MouseEntered:
+    case InputEventType::MouseLeft:
+      return true;
+  }
+  return false;
+}
+
+Error recording_error(const std::filesystem::path& path, std::string_view what) {
+  return Error{
+      .msg  = std::format(R"({} "{}")", what, path.string()),
+      .code = ErrorCode::FileError{},
+  };
+}
+
+}  // namespace
+
+Result<std::unique_ptr<InputRecorder>, Error> InputRecorder::create(const std::filesystem::path& path,
+                                                                    std::chrono::nanoseconds tick_time) {
+  auto recorder       = std::unique_ptr<InputRecorder>(new InputRecorder());  // NOLINT
+  recorder->path_     = path;
+  recorder->file_     = std::ofstream(path, std::ios::binary | std::ios::trunc);
+  recorder->start_ns_ = now_ns();
+
+  const auto header = FileHeader{
+      .magic        = kMagic,
+      .version      = kVersion,
+      .reserved     = 0,
+      .tick_time_ns = static_cast<uint64_t>(tick_time.count()),
+  };
+  recorder->file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (!recorder->file_) {
+    util::Logger::err(R"(Could not create the input recording "{}")", path.string());
+    return std::unexpected(recording_error(path, "Could not create the input recording"));
+  }
+
+  return recorder;
+}
+
+void InputRecorder::record_frame(const InputRecordingFrame& frame, std::span<const InputEvent> events) {
+  buffer_.clear();
+  append(buffer_, FrameRecord{
+                      .delta_ns           = frame.delta_ns,
+                      .lag_ns             = frame.lag_ns,
+                      .tick_count         = frame.tick_count,
+                      .framebuffer_width  = frame.framebuffer_width,
+                      .framebuffer_height = frame.framebuffer_height,
+                      .event_count        = static_cast<uint32_t>(events.size()),
+                  });
+  for (const auto& event : events) {
+    append(buffer_, event.type);
+    append(buffer_, event.code);
+    append(buffer_, event.x);
+    append(buffer_, event.y);
+    // Wraps around for the events received before the recorder was created, the replay wraps it back
+    append(buffer_, event.timestamp_ns - start_ns_);
+  }
+
+  file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+  ++frame_count_;
+}
+
+Result<void, Error> InputRecorder::flush() {
+  file_.flush();
+  if (!file_) {
+    util::Logger::err(R"(Could not write the input recording "{}")", path_.string());
+    return std::unexpected(recording_error(path_, "Could not write the input recording"));
+  }
+  return {};
+}
+
+Result<InputReplay, Error> InputReplay::load(const std::filesystem::path& path) {
+  auto file = std::ifstream(path, std::ios::ate | std::ios::binary);
+  if (!file) {
+    util::Logger::err(R"(Could not open the input recording "{}")", path.string());
+    return std::unexpected(recording_error(path, "Could not open the input recording"));
+  }
+  auto bytes = std::vector<std::byte>(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  if (!file) {
+    util::Logger::err(R"(Could not read the input recording "{}")", path.string());
+    return std::unexpected(recording_error(path, "Could not read the input recording"));
+  }
+
+  auto offset       = size_t{0};
+  const auto header = read<FileHeader>(bytes, offset);
+  if (!header || header->magic != kMagic || header->version != kVersion) {
+    util::Logger::err(R"(The file "{}" is not an input recording of a supported version)", path.string());
+    return std::unexpected(recording_error(path, "Invalid input recording"));
+  }
+
+  auto replay          = InputReplay(nullptr);
+  replay.tick_time_ns_ = header->tick_time_ns;
+  while (offset < bytes.size()) {
+    const auto record = read<FrameRecord>(bytes, offset);
+    if (!record || (bytes.size() - offset) / kEventRecordSize < record->event_count) {
+      // The recording application has not exited cleanly, the frames read so far are still valid
+      util::Logger::warn(R"(The input recording "{}" is truncated after {} frames)", path.string(),
+                         replay.frames_.size());
+      break;
+    }
+
+    replay.frames_.push_back(Frame{
+        .timing =
+            InputRecordingFrame{
+                .delta_ns           = record->delta_ns,
+                .lag_ns             = record->lag_ns,
+                .tick_count         = record->tick_count,
+                .framebuffer_width  = record->framebuffer_width,
+                .framebuffer_height = record->framebuffer_height,
+            },
+        .first_event = static_cast<uint32_t>(replay.events_.size()),
+        .event_count = record->event_count,
+    });
+    for (auto i = 0U; i < record->event_count; ++i) {
+      auto event         = InputEvent{};
+      event.type         = *read<InputEventType>(bytes, offset);
+      event.code         = *read<uint8_t>(bytes, offset);
+      event.x            = *read<double>(bytes, offset);
+      event.y            = *read<double>(bytes, offset);
+      event.timestamp_ns = *read<uint64_t>(bytes, offset);
+      if (!is_valid(event)) {
+        util::Logger::err(R"(The input recording "{}" contains an invalid event)", path.string());
+        return std::unexpected(recording_error(path, "Invalid input recording"));
+      }
+      replay.events_.push_back(event);
+    }
+  }
+
+  util::Logger::info(R"(Loaded the input recording "{}" of {} frames and {} events)", path.string(),
+                     replay.frames_.size(), replay.events_.size());
+  return replay;
+}
+
+const InputRecordingFrame& InputReplay::replay_frame(InputEventRing& ring) {
+  if (next_frame_ == 0) {
+    start_ns_ = now_ns();
+  }
+
+  const auto& frame = frames_[next_frame_++];
+  for (auto i = frame.first_event; i < frame.first_event + frame.event_count; ++i) {
+    auto event          = events_[i];
+    event.timestamp_ns += start_ns_;
+    ring.push(event);
+  }
+  return frame.timing;
+}
+
+}  // namespace eray::os
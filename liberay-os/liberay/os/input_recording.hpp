@@ -0,0 +1,145 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <liberay/os/error.hpp>
+#include <liberay/os/input.hpp>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace eray::os {
+
+/**
+ * @brief Timing of a recorded frame. The application replays the frame with the same simulated time step and the same
+ * number of the physics ticks, regardless of how long the replayed frame really took.
+ *
+ */
+struct InputRecordingFrame {
+  /**
+   * @brief Time step the frame advanced the application by.
+   *
+   */
+  uint64_t delta_ns;
+
+  /**
+   * @brief Time accumulated towards the next physics tick after the ticks of the frame, so that the interpolation
+   * between the ticks is replayed as well.
+   *
+   */
+  uint64_t lag_ns;
+  uint32_t tick_count;
+
+  /**
+   * @brief Framebuffer size at the frame, the replay resizes the window when it changes.
+   *
+   */
+  uint32_t framebuffer_width;
+  uint32_t framebuffer_height;
+};
+
+/**
+ * @brief Writes the input events read by an `InputManager` frame by frame into a compact binary file, so that the
+ * session can be replayed with `InputReplay`, e.g. to compare the frame times of two builds on the exact same camera
+ * path. The file is written as the frames are recorded.
+ *
+ * The event timestamps are stored relative to the creation of the recorder.
+ *
+ */
+class InputRecorder {
+ public:
+  InputRecorder(const InputRecorder&)            = delete;
+  InputRecorder& operator=(const InputRecorder&) = delete;
+
+  /**
+   * @brief Creates the file, an existing one is overwritten.
+   *
+   * @param path
+   * @param tick_time Fixed time step of the physics ticks.
+   * @return Result<std::unique_ptr<InputRecorder>, Error>
+   */
+  static Result<std::unique_ptr<InputRecorder>, Error> create(const std::filesystem::path& path,
+                                                              std::chrono::nanoseconds tick_time);
+
+  /**
+   * @brief Appends a frame with its `events`, usually `InputManager::events()` of the frame input manager right after
+   * its `prepare()`.
+   *
+   */
+  void record_frame(const InputRecordingFrame& frame, std::span<const InputEvent> events);
+
+  /**
+   * @brief Flushes the recorded frames to the file.
+   *
+   */
+  Result<void, Error> flush();
+
+  uint64_t frame_count() const { return frame_count_; }
+
+ private:
+  InputRecorder() = default;
+
+  std::filesystem::path path_;
+  std::ofstream file_;
+  std::vector<std::byte> buffer_;
+  uint64_t start_ns_    = 0;
+  uint64_t frame_count_ = 0;
+};
+
+/**
+ * @brief Feeds a recording of `InputRecorder` back into an `InputEventRing`, one frame at a time. Combined with the
+ * headless window the replayed run is deterministic: every frame sees the same events, the same time step and the same
+ * physics ticks as the recorded one.
+ *
+ * The replayed events carry the timestamps shifted to the start of the replay. The live input of the window is not
+ * blocked, it is mixed with the replayed events.
+ *
+ */
+class InputReplay {
+ public:
+  InputReplay() = delete;
+  explicit InputReplay(std::nullptr_t) {}
+
+  /**
+   * @brief Reads the whole recording.
+   *
+   */
+  static Result<InputReplay, Error> load(const std::filesystem::path& path);
+
+  std::chrono::nanoseconds tick_time() const { return std::chrono::nanoseconds(tick_time_ns_); }
+
+  size_t frame_count() const { return frames_.size(); }
+  size_t current_frame() const { return next_frame_; }
+  bool is_finished() const { return next_frame_ >= frames_.size(); }
+
+  /**
+   * @brief Pushes the events of the next frame into the `ring` and returns the timing of the frame.
+   *
+   * @warning The replay must not be finished. The ring must not be written by another thread at the same time, see
+   * `InputEventRing::push()`.
+   */
+  const InputRecordingFrame& replay_frame(InputEventRing& ring);
+
+ private:
+  struct Frame {
+    InputRecordingFrame timing;
+    uint32_t first_event;
+    uint32_t event_count;
+  };
+
+  uint64_t tick_time_ns_ = 0;
+  std::vector<Frame> frames_;
+
+  /**
+   * @brief Timestamps relative to the start of the recording.
+   *
+   */
+  std::vector<InputEvent> events_;
+
+  size_t next_frame_ = 0;
+  uint64_t start_ns_ = 0;
+};
+
+}  // namespace eray::os
@@ -11,6 +11,8 @@
 #include <liberay/util/zstring_view.hpp>
 #include <memory>
 #include <ranges>
+#include <utility>
+#include <vector>
 
 #ifdef IS_WINDOWS
 #include <windows.h>
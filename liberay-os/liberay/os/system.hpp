@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <deque>
 #include <liberay/os/file_dialog.hpp>
 #include <liberay/os/operating_system.hpp>
@@ -13,9 +14,103 @@
 #include <liberay/util/ruleof.hpp>
 #include <liberay/util/zstring_view.hpp>
 #include <memory>
+#include <optional>
+#include <span>
+#include <vector>
 
 namespace eray::os {
 
+enum class CoreClass : uint8_t {
+  Performance = 0,
+  Efficiency  = 1,
+};
+
+struct LogicalCore {
+  /**
+   * @brief Index of the core used by the OS, e.g. by `System::set_current_thread_affinity()`.
+   *
+   */
+  uint32_t id;
+
+  /**
+   * @brief Index of the physical core, shared by the hyper-threads of the core.
+   *
+   */
+  uint32_t physical_core;
+  uint32_t numa_node;
+
+  /**
+   * @brief Always `Performance` on the CPUs whose cores are all the same.
+   *
+   */
+  CoreClass core_class;
+};
+
+struct CpuCache {
+  uint32_t level;
+
+  /**
+   * @brief Size of a single cache of the level, e.g. of the L2 cache of one core.
+   *
+   */
+  uint64_t size_bytes;
+  uint32_t line_size_bytes;
+
+  /**
+   * @brief Number of the logical cores sharing a single cache of the level.
+   *
+   */
+  uint32_t shared_by;
+};
+
+struct CpuTopology {
+  /**
+   * @brief Number of the hardware threads, i.e. the physical cores multiplied by the SMT ways.
+   *
+   */
+  uint32_t logical_cores;
+  uint32_t physical_cores;
+
+  /**
+   * @brief Physical cores of the classes, on a hybrid CPU (e.g. Intel P-cores and E-cores, ARM big.LITTLE) the
+   * efficiency cores are slower and their threads see more latency jitter.
+   *
+   */
+  uint32_t performance_cores;
+  uint32_t efficiency_cores;
+
+  uint32_t numa_nodes;
+
+  /**
+   * @brief Empty when the OS does not report the cores, e.g. on MacOS.
+   *
+   */
+  std::vector<LogicalCore> cores;
+
+  /**
+   * @brief Data and unified caches of a performance core ordered by the level, empty when they cannot be queried.
+   *
+   */
+  std::vector<CpuCache> caches;
+
+  bool is_hybrid() const { return efficiency_cores > 0; }
+
+  /**
+   * @brief Ids of the logical cores of the class, e.g. to pin a latency sensitive thread to the performance cores.
+   *
+   */
+  std::vector<uint32_t> logical_core_ids(CoreClass core_class) const;
+
+  std::optional<CpuCache> cache(uint32_t level) const;
+};
+
+enum class ThreadPriority : uint8_t {
+  Low          = 0,
+  Normal       = 1,
+  High         = 2,
+  TimeCritical = 3,
+};
+
 /**
  * @brief Singleton class that provides an abstraction over common operating system calls. Basing on the requested
  * graphics rendering API this class is capable of creating a window.
@@ -147,6 +242,47 @@ class System {
    */
   static std::filesystem::path utf8str_to_path(util::zstring_view str_path);
 
+  /**
+   * @brief Returns the cores, the caches and the NUMA nodes of the CPU, queried once. When the topology cannot be
+   * queried, every logical core is assumed to be a physical performance core.
+   *
+   * @return const CpuTopology&
+   */
+  static const CpuTopology& cpu_topology();
+
+  /**
+   * @brief Number of the worker threads that saturate the CPU together with the main thread, i.e. one fewer than the
+   * physical cores. The hyper-threads are skipped, the jobs are compute bound and gain little from sharing a core.
+   *
+   * @return uint32_t At least 1.
+   */
+  static uint32_t recommended_worker_count();
+
+  /**
+   * @brief Names the calling thread for the debuggers and the system profilers. Linux truncates the name to 15
+   * characters.
+   *
+   */
+  static Result<void, Error> set_current_thread_name(util::zstring_view name);
+
+  /**
+   * @brief Restricts the calling thread to the logical cores (see `LogicalCore::id`), e.g. to keep the render thread
+   * off the efficiency cores. On Windows the cores must belong to one processor group, the cores outside of the group
+   * of the first one are ignored.
+   *
+   * @warning Not supported on MacOS, where the scheduler picks the cores by the priority, see
+   * `set_current_thread_priority()`.
+   */
+  static Result<void, Error> set_current_thread_affinity(std::span<const uint32_t> logical_core_ids);
+
+  /**
+   * @brief Changes the scheduling priority of the calling thread. On Linux it is the nice value of the thread, raising
+   * it above `Normal` requires the `CAP_SYS_NICE` capability or a raised `RLIMIT_NICE`. On MacOS it is the QoS class,
+   * which also steers the thread to the performance cores.
+   *
+   */
+  static Result<void, Error> set_current_thread_priority(ThreadPriority priority);
+
   /**
    * @brief Creates a window and returns an unique pointer to the instance.
    * The window is valid until the `terminate` function is not called.
@@ -0,0 +1,505 @@
+#include <algorithm>
+#include <array>
+#include <expected>
+#include <format>
+#include <liberay/os/error.hpp>
+#include <liberay/os/system.hpp>
+#include <liberay/util/platform.hpp>
+#include <liberay/util/zstring_view.hpp>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef IS_WINDOWS
+#include <windows.h>
+
+#include <map>
+#elif defined(IS_MACOS)
+#include <pthread.h>
+#include <sys/qos.h>
+#include <sys/sysctl.h>
+#elif defined(IS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string_view>
+#endif
+
+namespace eray::os {
+
+std::vector<uint32_t> CpuTopology::logical_core_ids(CoreClass core_class) const {
+  auto result = std::vector<uint32_t>();
+  for (const auto& core : cores) {
+    if (core.core_class == core_class) {
+      result.push_back(core.id);
+    }
+  }
+  return result;
+}
+
+std::optional<CpuCache> CpuTopology::cache(uint32_t level) const {
+  if (const auto it = std::ranges::find(caches, level, &CpuCache::level); it != caches.end()) {
+    return *it;
+  }
+  return std::nullopt;
+}
+
+namespace {
+
+Error thread_configuration_error(std::string_view what, int error_code) {
+  return Error{
+      .msg  = std::format("{}: {}", what, std::system_category().message(error_code)),
+      .code = ErrorCode::ThreadConfigurationFailure{},
+  };
+}
+
+/**
+ * @brief Counts the physical cores of the classes and sorts the cores by their ids.
+ *
+ */
+void finalize_topology(CpuTopology& topology) {
+  std::ranges::sort(topology.cores, {}, &LogicalCore::id);
+  std::ranges::sort(topology.caches, {}, &CpuCache::level);
+
+  auto physical_cores = std::vector<std::optional<CoreClass>>();
+  auto numa_nodes     = 0U;
+  for (const auto& core : topology.cores) {
+    if (core.physical_core >= physical_cores.size()) {
+      physical_cores.resize(core.physical_core + 1);
+    }
+    physical_cores[core.physical_core] = core.core_class;
+    numa_nodes                         = std::max(numa_nodes, core.numa_node + 1);
+  }
+
+  topology.logical_cores     = static_cast<uint32_t>(topology.cores.size());
+  topology.performance_cores = static_cast<uint32_t>(std::ranges::count(physical_cores, CoreClass::Performance));
+  topology.efficiency_cores  = static_cast<uint32_t>(std::ranges::count(physical_cores, CoreClass::Efficiency));
+  topology.physical_cores    = topology.performance_cores + topology.efficiency_cores;
+  topology.numa_nodes        = std::max(numa_nodes, 1U);
+}
+
+#ifdef IS_WINDOWS
+
+void append_group_mask(std::vector<uint32_t>& ids, const GROUP_AFFINITY& mask) {
+  for (auto bit = 0U; bit < sizeof(KAFFINITY) * 8; ++bit) {
+    if ((mask.Mask >> bit) & 1U) {
+      ids.push_back(static_cast<uint32_t>(mask.Group) * sizeof(KAFFINITY) * 8 + bit);
+    }
+  }
+}
+
+/**
+ * @brief A logical core id is the processor group multiplied by 64 plus the index within the group.
+ *
+ */
+std::optional<CpuTopology> query_topology() {
+  auto size = DWORD{0};
+  GetLogicalProcessorInformationEx(RelationAll, nullptr, &size);
+  auto buffer = std::vector<std::byte>(size);
+  if (buffer.empty() || !GetLogicalProcessorInformationEx(
+                            RelationAll, reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data()),
+                            &size)) {
+    return std::nullopt;
+  }
+
+  struct Core {
+    std::vector<uint32_t> ids;
+    BYTE efficiency_class;
+  };
+  struct Cache {
+    CpuCache cache;
+    std::vector<uint32_t> ids;
+  };
+  auto cores      = std::vector<Core>();
+  auto caches     = std::vector<Cache>();
+  auto numa_nodes = std::map<uint32_t, uint32_t>();
+  for (auto offset = DWORD{0}; offset < size;) {
+    const auto& info = *reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+    offset          += info.Size;
+
+    if (info.Relationship == RelationProcessorCore) {
+      auto& core            = cores.emplace_back();
+      core.efficiency_class = info.Processor.EfficiencyClass;
+      for (auto i = 0U; i < info.Processor.GroupCount; ++i) {
+        append_group_mask(core.ids, info.Processor.GroupMask[i]);
+      }
+    } else if (info.Relationship == RelationNumaNode) {
+      auto ids = std::vector<uint32_t>();
+      append_group_mask(ids, info.NumaNode.GroupMask);
+      for (const auto id : ids) {
+        numa_nodes[id] = info.NumaNode.NodeNumber;
+      }
+    } else if (info.Relationship == RelationCache &&
+               (info.Cache.Type == CacheData || info.Cache.Type == CacheUnified)) {
+      auto& cache = caches.emplace_back();
+      append_group_mask(cache.ids, info.Cache.GroupMask);
+      cache.cache = CpuCache{
+          .level           = info.Cache.Level,
+          .size_bytes      = info.Cache.CacheSize,
+          .line_size_bytes = info.Cache.LineSize,
+          .shared_by       = static_cast<uint32_t>(cache.ids.size()),
+      };
+    }
+  }
+  if (cores.empty()) {
+    return std::nullopt;
+  }
+
+  // A higher efficiency class means a faster core, the classes are all 0 on the CPUs whose cores are all the same
+  const auto performance_class = std::ranges::max(cores, {}, &Core::efficiency_class).efficiency_class;
+  auto topology                = CpuTopology{};
+  for (auto i = 0U; i < cores.size(); ++i) {
+    for (const auto id : cores[i].ids) {
+      topology.cores.push_back(LogicalCore{
+          .id            = id,
+          .physical_core = i,
+          .numa_node     = numa_nodes.contains(id) ? numa_nodes[id] : 0,
+          .core_class    = cores[i].efficiency_class == performance_class ? CoreClass::Performance
+                                                                          : CoreClass::Efficiency,
+      });
+    }
+  }
+
+  const auto first_performance_core =
+      std::ranges::find(topology.cores, CoreClass::Performance, &LogicalCore::core_class)->id;
+  for (const auto& cache : caches) {
+    if (std::ranges::find(cache.ids, first_performance_core) != cache.ids.end()) {
+      topology.caches.push_back(cache.cache);
+    }
+  }
+
+  finalize_topology(topology);
+  return topology;
+}
+
+#elif defined(IS_MACOS)
+
+std::optional<uint64_t> sysctl_value(const char* name) {
+  auto value = uint64_t{0};
+  auto size  = sizeof(value);
+  if (sysctlbyname(name, &value, &size, nullptr, 0) != 0) {
+    return std::nullopt;
+  }
+  // Some of the values are 32-bit, the value is little endian
+  return size == sizeof(uint32_t) ? static_cast<uint32_t>(value) : value;
+}
+
+/**
+ * @brief MacOS does not report the logical cores, only their numbers. The performance level 0 is the fastest one.
+ *
+ */
+std::optional<CpuTopology> query_topology() {
+  const auto logical_cores = sysctl_value("hw.logicalcpu");
+  if (!logical_cores) {
+    return std::nullopt;
+  }
+
+  auto topology          = CpuTopology{};
+  topology.logical_cores = static_cast<uint32_t>(*logical_cores);
+  topology.numa_nodes    = 1;
+  if (const auto levels = sysctl_value("hw.nperflevels"); levels && *levels > 1) {
+    topology.performance_cores = static_cast<uint32_t>(sysctl_value("hw.perflevel0.physicalcpu").value_or(0));
+    topology.efficiency_cores  = static_cast<uint32_t>(sysctl_value("hw.perflevel1.physicalcpu").value_or(0));
+  } else {
+    topology.performance_cores = static_cast<uint32_t>(sysctl_value("hw.physicalcpu").value_or(*logical_cores));
+  }
+  topology.physical_cores = topology.performance_cores + topology.efficiency_cores;
+
+  const auto line_size = static_cast<uint32_t>(sysctl_value("hw.cachelinesize").value_or(0));
+  const auto l1 = sysctl_value("hw.perflevel0.l1dcachesize").or_else([] { return sysctl_value("hw.l1dcachesize"); });
+  const auto l2 = sysctl_value("hw.perflevel0.l2cachesize").or_else([] { return sysctl_value("hw.l2cachesize"); });
+  if (l1) {
+    topology.caches.push_back(CpuCache{.level = 1, .size_bytes = *l1, .line_size_bytes = line_size, .shared_by = 1});
+  }
+  if (l2) {
+    topology.caches.push_back(CpuCache{
+        .level           = 2,
+        .size_bytes      = *l2,
+        .line_size_bytes = line_size,
+        .shared_by       = static_cast<uint32_t>(sysctl_value("hw.perflevel0.cpusperl2").value_or(1)),
+    });
+  }
+  return topology;
+}
+
+#elif defined(IS_LINUX)
+
+std::string read_line(const std::filesystem::path& path) {
+  auto line = std::string();
+  std::getline(std::ifstream(path), line);
+  return line;
+}
+
+std::optional<uint32_t> parse_uint(std::string_view str) {
+  auto value        = uint32_t{0};
+  const auto result = std::from_chars(str.data(), str.data() + str.size(), value);
+  if (result.ec != std::errc{} || result.ptr == str.data()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<uint32_t> parse_cpu_index(std::string_view name, std::string_view prefix) {
+  if (!name.starts_with(prefix) || name.size() == prefix.size() ||
+      !std::ranges::all_of(name.substr(prefix.size()), [](char c) { return c >= '0' && c <= '9'; })) {
+    return std::nullopt;
+  }
+  return parse_uint(name.substr(prefix.size()));
+}
+
+/**
+ * @brief Parses the sysfs cpu lists, e.g. "0-3,8,10-11".
+ *
+ */
+std::set<uint32_t> parse_cpu_list(std::string_view list) {
+  auto result = std::set<uint32_t>();
+  for (const auto range : std::views::split(list, ',')) {
+    const auto str   = std::string_view(range.begin(), range.end());
+    const auto dash  = str.find('-');
+    const auto first = parse_uint(str.substr(0, dash));
+    const auto last  = dash == std::string_view::npos ? first : parse_uint(str.substr(dash + 1));
+    if (!first || !last) {
+      continue;
+    }
+    for (auto cpu = *first; cpu <= *last; ++cpu) {
+      result.insert(cpu);
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Parses the sysfs cache sizes, e.g. "48K".
+ *
+ */
+uint64_t parse_cache_size(std::string_view str) {
+  const auto value = parse_uint(str).value_or(0);
+  if (str.ends_with('K')) {
+    return uint64_t{value} << 10;
+  }
+  if (str.ends_with('M')) {
+    return uint64_t{value} << 20;
+  }
+  return value;
+}
+
+/**
+ * @brief Reads the topology from sysfs. The offline cores have no topology directory and are skipped. Intel hybrid CPUs
+ * list their efficiency cores in the `cpu_atom` PMU, on ARM the efficiency cores have a lower `cpu_capacity`.
+ *
+ */
+std::optional<CpuTopology> query_topology() {
+  const auto cpu_dir = std::filesystem::path("/sys/devices/system/cpu");
+
+  struct Cpu {
+    uint32_t id;
+    uint32_t package;
+    uint32_t core;
+    uint32_t numa_node;
+    uint32_t capacity;
+  };
+  auto cpus = std::vector<Cpu>();
+  auto ec   = std::error_code{};
+  for (const auto& entry : std::filesystem::directory_iterator(cpu_dir, ec)) {
+    const auto id      = parse_cpu_index(entry.path().filename().string(), "cpu");
+    const auto package = parse_uint(read_line(entry.path() / "topology" / "physical_package_id"));
+    const auto core    = parse_uint(read_line(entry.path() / "topology" / "core_id"));
+    if (!id || !package || !core) {
+      continue;
+    }
+
+    auto numa_node = 0U;
+    for (const auto& node : std::filesystem::directory_iterator(entry.path(), ec)) {
+      if (const auto index = parse_cpu_index(node.path().filename().string(), "node")) {
+        numa_node = *index;
+        break;
+      }
+    }
+    cpus.push_back(Cpu{
+        .id        = *id,
+        .package   = *package,
+        .core      = *core,
+        .numa_node = numa_node,
+        .capacity  = parse_uint(read_line(entry.path() / "cpu_capacity")).value_or(0),
+    });
+  }
+  if (cpus.empty()) {
+    return std::nullopt;
+  }
+  std::ranges::sort(cpus, {}, &Cpu::id);
+
+  const auto atom_cpus    = parse_cpu_list(read_line("/sys/devices/cpu_atom/cpus"));
+  const auto max_capacity = std::ranges::max(cpus, {}, &Cpu::capacity).capacity;
+  const auto is_efficient = [&](const Cpu& cpu) {
+    return atom_cpus.empty() ? cpu.capacity < max_capacity : atom_cpus.contains(cpu.id);
+  };
+
+  // The hyper-threads of a core share the core id within the package
+  auto topology       = CpuTopology{};
+  auto physical_cores = std::map<std::pair<uint32_t, uint32_t>, uint32_t>();
+  for (const auto& cpu : cpus) {
+    const auto physical_core =
+        physical_cores.try_emplace({cpu.package, cpu.core}, static_cast<uint32_t>(physical_cores.size())).first->second;
+    topology.cores.push_back(LogicalCore{
+        .id            = cpu.id,
+        .physical_core = physical_core,
+        .numa_node     = cpu.numa_node,
+        .core_class    = is_efficient(cpu) ? CoreClass::Efficiency : CoreClass::Performance,
+    });
+  }
+
+  const auto first_performance_core =
+      std::ranges::find(topology.cores, CoreClass::Performance, &LogicalCore::core_class)->id;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(cpu_dir / std::format("cpu{}", first_performance_core) / "cache", ec)) {
+    if (!parse_cpu_index(entry.path().filename().string(), "index")) {
+      continue;
+    }
+    const auto type = read_line(entry.path() / "type");
+    if (type != "Data" && type != "Unified") {
+      continue;
+    }
+    topology.caches.push_back(CpuCache{
+        .level           = parse_uint(read_line(entry.path() / "level")).value_or(0),
+        .size_bytes      = parse_cache_size(read_line(entry.path() / "size")),
+        .line_size_bytes = parse_uint(read_line(entry.path() / "coherency_line_size")).value_or(0),
+        .shared_by       = static_cast<uint32_t>(parse_cpu_list(read_line(entry.path() / "shared_cpu_list")).size()),
+    });
+  }
+
+  finalize_topology(topology);
+  return topology;
+}
+
+#else
+
+std::optional<CpuTopology> query_topology() { return std::nullopt; }
+
+#endif
+
+}  // namespace
+
+const CpuTopology& System::cpu_topology() {
+  static const auto kTopology = []() {
+    const auto logical = std::max(std::thread::hardware_concurrency(), 1U);
+    auto topology      = query_topology().value_or(CpuTopology{});
+    if (topology.physical_cores == 0) {
+      topology.logical_cores     = logical;
+      topology.physical_cores    = logical;
+      topology.performance_cores = logical;
+      topology.efficiency_cores  = 0;
+      topology.numa_nodes        = 1;
+      topology.cores.clear();
+    }
+    return topology;
+  }();
+  return kTopology;
+}
+
+uint32_t System::recommended_worker_count() { return std::max(cpu_topology().physical_cores, 2U) - 1; }
+
+Result<void, Error> System::set_current_thread_name(util::zstring_view name) {
+#ifdef IS_WINDOWS
+  auto wide_name = std::wstring(name.size(), L'\0');
+  wide_name.resize(static_cast<size_t>(MultiByteToWideChar(CP_UTF8, 0, name.data(), static_cast<int>(name.size()),
+                                                           wide_name.data(), static_cast<int>(wide_name.size()))));
+  if (const auto result = SetThreadDescription(GetCurrentThread(), wide_name.c_str()); FAILED(result)) {
+    return std::unexpected(thread_configuration_error("Could not set the thread name", static_cast<int>(result)));
+  }
+#elif defined(IS_MACOS)
+  if (const auto result = pthread_setname_np(name.c_str()); result != 0) {
+    return std::unexpected(thread_configuration_error("Could not set the thread name", result));
+  }
+#elif defined(IS_LINUX)
+  // The name is limited to 16 bytes including the null terminator
+  const auto truncated = std::string(std::string_view(name).substr(0, 15));
+  if (const auto result = pthread_setname_np(pthread_self(), truncated.c_str()); result != 0) {
+    return std::unexpected(thread_configuration_error("Could not set the thread name", result));
+  }
+#else
+  static_cast<void>(name);
+#endif
+  return {};
+}
+
+Result<void, Error> System::set_current_thread_affinity(std::span<const uint32_t> logical_core_ids) {
+  if (logical_core_ids.empty()) {
+    return std::unexpected(Error{
+        .msg  = "Could not set the thread affinity: no cores given",
+        .code = ErrorCode::ThreadConfigurationFailure{},
+    });
+  }
+
+#ifdef IS_WINDOWS
+  constexpr auto kGroupSize = static_cast<uint32_t>(sizeof(KAFFINITY) * 8);
+  auto affinity             = GROUP_AFFINITY{};
+  affinity.Group            = static_cast<WORD>(logical_core_ids.front() / kGroupSize);
+  for (const auto id : logical_core_ids) {
+    if (id / kGroupSize == affinity.Group) {
+      affinity.Mask |= KAFFINITY{1} << (id % kGroupSize);
+    }
+  }
+  if (!SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr)) {
+    return std::unexpected(
+        thread_configuration_error("Could not set the thread affinity", static_cast<int>(GetLastError())));
+  }
+  return {};
+#elif defined(IS_LINUX)
+  auto cpu_set = cpu_set_t{};
+  CPU_ZERO(&cpu_set);
+  for (const auto id : logical_core_ids) {
+    CPU_SET(id, &cpu_set);
+  }
+  if (const auto result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set); result != 0) {
+    return std::unexpected(thread_configuration_error("Could not set the thread affinity", result));
+  }
+  return {};
+#else
+  return std::unexpected(Error{
+      .msg  = "Could not set the thread affinity: not supported by the operating system",
+      .code = ErrorCode::ThreadConfigurationFailure{},
+  });
+#endif
+}
+
+Result<void, Error> System::set_current_thread_priority(ThreadPriority priority) {
+#ifdef IS_WINDOWS
+  constexpr auto kPriorities = std::array{THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_HIGHEST,
+                                          THREAD_PRIORITY_TIME_CRITICAL};
+  if (!SetThreadPriority(GetCurrentThread(), kPriorities[static_cast<size_t>(priority)])) {
+    return std::unexpected(
+        thread_configuration_error("Could not set the thread priority", static_cast<int>(GetLastError())));
+  }
+#elif defined(IS_MACOS)
+  constexpr auto kQosClasses =
+      std::array{QOS_CLASS_UTILITY, QOS_CLASS_DEFAULT, QOS_CLASS_USER_INITIATED, QOS_CLASS_USER_INTERACTIVE};
+  if (const auto result = pthread_set_qos_class_self_np(kQosClasses[static_cast<size_t>(priority)], 0); result != 0) {
+    return std::unexpected(thread_configuration_error("Could not set the thread priority", result));
+  }
+#elif defined(IS_LINUX)
+  // The nice value of a thread applies to the thread only, despite `PRIO_PROCESS`
+  constexpr auto kNiceValues = std::array{10, 0, -5, -10};
+  const auto thread_id       = static_cast<id_t>(syscall(SYS_gettid));
+  if (setpriority(PRIO_PROCESS, thread_id, kNiceValues[static_cast<size_t>(priority)]) != 0) {
+    return std::unexpected(thread_configuration_error("Could not set the thread priority", errno));
+  }
+#else
+  static_cast<void>(priority);
+#endif
+  return {};
+}
+
+}  // namespace eray::os
@@ -1,10 +1,14 @@
 #pragma once
+#include <array>
 #include <concepts>
-#include <functional>
+#include <cstdint>
 #include <liberay/os/window/input_codes.hpp>
 #include <liberay/util/enum_mapper.hpp>
+#include <liberay/util/inline_function.hpp>
+#include <tuple>
+#include <type_traits>
 #include <utility>
-#include <variant>
+#include <vector>
 
 namespace eray::os {
 
@@ -22,7 +26,8 @@ enum class WindowEventType : uint8_t {
   MouseEntered        = 10,
   MouseLeft           = 11,
   FramebufferResized  = 12,
-  _Count              = 13,  // NOLINT
+  MouseMoved          = 13,
+  _Count              = 14,  // NOLINT
 };
 
 constexpr std::size_t kWindowEventCount = static_cast<std::size_t>(WindowEventType::_Count);
@@ -41,6 +46,7 @@ constexpr auto kWindowEventTypeName = util::StringEnumMapper<WindowEventType>({
     {WindowEventType::MouseEntered, "MouseEnteredEvent"},
     {WindowEventType::MouseLeft, "MouseLeftEvent"},
     {WindowEventType::FramebufferResized, "FramebufferResized"},
+    {WindowEventType::MouseMoved, "MouseMovedEvent"},
 });
 
 template <typename T>
@@ -159,6 +165,29 @@ class MouseScrolledEvent : public WindowEventBase<WindowEventType::MouseScrolled
   double y_offset_{};
 };
 
+/**
+ * @brief Cursor position reported by every motion event of the OS, unaccelerated if the raw mouse motion is enabled
+ * (see `Window::set_raw_mouse_motion()`).
+ *
+ */
+class MouseMovedEvent : public WindowEventBase<WindowEventType::MouseMoved> {
+ public:
+  explicit MouseMovedEvent(double x, double y, uint64_t timestamp_ns) : x_(x), y_(y), timestamp_ns_(timestamp_ns) {}
+  double x() const { return x_; }
+  double y() const { return y_; }
+
+  /**
+   * @brief `std::chrono::steady_clock` time the event was received at, the event is dispatched later.
+   *
+   */
+  uint64_t timestamp_ns() const { return timestamp_ns_; }
+
+ private:
+  double x_{};
+  double y_{};
+  uint64_t timestamp_ns_{};
+};
+
 class MouseEntered : public WindowEventBase<WindowEventType::MouseEntered> {
  public:
   MouseEntered() = default;
@@ -174,8 +203,19 @@ class FramebufferResizedEvent : public WindowEventBase<WindowEventType::Framebuf
   FramebufferResizedEvent() = default;
 };
 
+/**
+ * @brief Inline buffer size of the event callbacks, fits a lambda capturing a few pointers or a shared pointer.
+ *
+ */
+constexpr std::size_t kEventCallbackCapacity = 6 * sizeof(void*);
+
+/**
+ * @brief Event callbacks never allocate, the callables are stored inline. Callables that do not fit into
+ * `kEventCallbackCapacity` bytes are rejected at compile time.
+ *
+ */
 template <CWindowEvent TEvent>
-using EventCallback = std::function<bool(const TEvent&)>;
+using EventCallback = util::InlineFunction<bool(const TEvent&), kEventCallbackCapacity>;
 
 /**
  * @brief Allows for converting a class method to an event callback. It creates a lambda wrapper with reference to an
@@ -205,14 +245,23 @@ struct EventCallbackHandle {
  * @brief This class allows for subscribing/dispatching window events that are specified in the pack.
  * The dispatcher instance is owned by `Window` class.
  *
+ * The events are queued per type and the queued order is kept as a byte per event, so processing the queue resolves the
+ * event types at compile time, there is no variant visitation. The queues keep their capacity, once warmed up
+ * enqueuing and processing the events does not allocate.
+ *
  * @tparam TEvents
  */
 template <CWindowEvent... TEvents>
 class WindowEventDispatcherBase {
+  static_assert(sizeof...(TEvents) <= 256, "The queued order stores the event type indices as bytes");
+
  public:
   template <CWindowEvent TEvent>
   using CallbacksFor = std::vector<EventCallback<TEvent>>;
 
+  template <CWindowEvent TEvent>
+  using QueueFor = std::vector<TEvent>;
+
   /**
    * @brief Subscribe to event notifications dispatched by window event dispatcher. It's
    * possible to set multiple event callbacks to one event. The last added callback will be invoked the last.
@@ -235,21 +284,17 @@ class WindowEventDispatcherBase {
   void remove_event_callback(EventCallbackHandle<TEvent> callback_handle) {
     auto& vec = std::get<CallbacksFor<TEvent>>(subscribers_);
     if (callback_handle.index < vec.size()) {
-      vec[callback_handle.index] = {};
+      vec[callback_handle.index] = nullptr;
     }
   }
 
   /**
-   * @brief Dispatches all the deferred (enqueued) events and clears the queue. It's blocking operation that is
-   * typically invoked at the begining of the game loop.
+   * @brief Dispatches all the deferred (enqueued) events in the order they were enqueued and clears the queue. It's
+   * blocking operation that is typically invoked at the begining of the game loop. Events enqueued by the callbacks
+   * are dispatched in the same call.
    *
    */
-  void process_queued_events() {
-    for (auto& event : events_queue_) {
-      std::visit(WindowEventVisitor{*this}, event);
-    }
-    events_queue_.clear();
-  }
+  void process_queued_events() { process_queued_events(std::index_sequence_for<TEvents...>{}); }
 
   /**
    * @brief Deferrs event dispatching to the moment when `process_queued_events` is called (non-blocking).
@@ -258,7 +303,9 @@ class WindowEventDispatcherBase {
    */
   template <CWindowEvent TEvent>
   void enqueue_event(const TEvent& event) {
-    events_queue_.push_back(event);
+    ++received_events_;
+    std::get<QueueFor<TEvent>>(queues_).push_back(event);
+    queued_order_.push_back(event_index<TEvent>());
   }
 
   /**
@@ -269,6 +316,19 @@ class WindowEventDispatcherBase {
    */
   template <CWindowEvent TEvent>
   void dispatch_event(const TEvent& event) {
+    ++received_events_;
+    notify_subscribers(event);
+  }
+
+  /**
+   * @brief Number of the enqueued and dispatched events, the dispatches of the enqueued events are not counted again.
+   *
+   */
+  uint64_t received_events() const { return received_events_; }
+
+ private:
+  template <CWindowEvent TEvent>
+  void notify_subscribers(const TEvent& event) {
     auto& callbacks = std::get<CallbacksFor<TEvent>>(subscribers_);
     for (auto& subscriber : callbacks) {
       if (subscriber) {  // TODO(migoox): Improve callback removal system.
@@ -277,19 +337,42 @@ class WindowEventDispatcherBase {
     }
   }
 
- private:
-  struct WindowEventVisitor {
-    WindowEventDispatcherBase<TEvents...>& dispatcher;  // NOLINT
+  template <CWindowEvent TEvent>
+  static consteval uint8_t event_index() {
+    auto index = uint8_t{0};
+    static_cast<void>(((std::is_same_v<TEvent, TEvents> || (++index, false)) || ...));
+    return index;
+  }
 
-    template <typename TEvent>
-    void operator()(const TEvent& event) const {
-      dispatcher.dispatch_event(event);
+  template <std::size_t... TIndices>
+  void process_queued_events(std::index_sequence<TIndices...> /*indices*/) {
+    auto cursors = std::array<std::size_t, sizeof...(TEvents)>{};
+    for (auto i = 0U; i < queued_order_.size(); ++i) {
+      const auto index = queued_order_[i];
+      static_cast<void>(((index == TIndices && (dispatch_next_queued<TIndices>(cursors[TIndices]), true)) || ...));
     }
-  };
+    (std::get<TIndices>(queues_).clear(), ...);
+    queued_order_.clear();
+  }
+
+  template <std::size_t TIndex>
+  void dispatch_next_queued(std::size_t& cursor) {
+    // Copied, a callback may enqueue another event and grow the queue
+    const auto event = std::get<TIndex>(queues_)[cursor++];
+    notify_subscribers(event);
+  }
 
  private:
-  std::tuple<std::vector<EventCallback<TEvents>>...> subscribers_{};
-  std::vector<std::variant<TEvents...>> events_queue_{};
+  std::tuple<CallbacksFor<TEvents>...> subscribers_{};
+  std::tuple<QueueFor<TEvents>...> queues_{};
+
+  /**
+   * @brief Index of the event type in the pack for each queued event, the events of one type are in their queue.
+   *
+   */
+  std::vector<uint8_t> queued_order_;
+
+  uint64_t received_events_ = 0;
 };
 
 /**
@@ -299,6 +382,7 @@ class WindowEventDispatcherBase {
 using WindowEventDispatcher =
     WindowEventDispatcherBase<KeyPressedEvent, KeyReleasedEvent, MouseButtonPressedEvent, MouseButtonReleasedEvent,
                               WindowClosedEvent, WindowResizedEvent, WindowFocusedEvent, WindowLostFocusEvent,
-                              WindowMovedEvent, MouseScrolledEvent, MouseEntered, MouseLeft, FramebufferResizedEvent>;
+                              WindowMovedEvent, MouseScrolledEvent, MouseEntered, MouseLeft, FramebufferResizedEvent,
+                              MouseMovedEvent>;
 
 }  // namespace eray::os
@@ -1,5 +1,8 @@
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <liberay/os/rendering_api.hpp>
 #include <liberay/os/window/events/event.hpp>
 #include <liberay/os/window/glfw/glfw_mappings.hpp>
@@ -7,6 +10,7 @@
 #include <liberay/os/window/mouse_cursor_codes.hpp>
 #include <liberay/os/window_api.hpp>
 #include <liberay/util/logger.hpp>
+#include <thread>
 
 namespace eray::os {
 
@@ -16,13 +20,33 @@ namespace {
 
 inline GLFWwindow* glfw_win_ptr(void* glfw_window_ptr) { return reinterpret_cast<GLFWwindow*>(glfw_window_ptr); }
 
+uint64_t pack_size(int width, int height) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(width)) << 32U) | static_cast<uint32_t>(height);
+}
+
 }  // namespace
 
 }  // namespace glfw
 
 GLFWWindow::GLFWWindow(void* glfw_window_ptr, const WindowProperties& props, WindowAPI window_api)
-    : Window(props), glfw_window_ptr_(glfw_window_ptr), window_api_(window_api) {
+    : Window(props),
+      glfw_window_ptr_(glfw_window_ptr),
+      window_api_(window_api),
+      main_thread_id_(std::this_thread::get_id()) {
   //   glfwSwapInterval(props.vsync ? 1 : 0); opengl specific
+  int width  = 0;
+  int height = 0;
+  glfwGetFramebufferSize(glfw::glfw_win_ptr(glfw_window_ptr_), &width, &height);
+  framebuffer_size_.store(glfw::pack_size(width, height), std::memory_order_relaxed);
+
+  auto* monitor = glfwGetWindowMonitor(glfw::glfw_win_ptr(glfw_window_ptr_));
+  if (monitor == nullptr) {
+    monitor = glfwGetPrimaryMonitor();
+  }
+  if (const auto* video_mode = monitor ? glfwGetVideoMode(monitor) : nullptr) {
+    refresh_rate_ = static_cast<uint32_t>(std::max(video_mode->refreshRate, 0));
+  }
+
   init_dispatcher();
 }
 
@@ -41,11 +65,11 @@ void GLFWWindow::init_dispatcher() {
     dispatcher->dispatch_event(WindowResizedEvent(width, height));
   });
 
-  glfwSetFramebufferSizeCallback(
-      glfw::glfw_win_ptr(glfw_window_ptr_), [](GLFWwindow* window, int /*width*/, int /*height*/) {
-        auto* dispatcher = &reinterpret_cast<GLFWWindow*>(glfwGetWindowUserPointer(window))->event_dispatcher_;
-        dispatcher->dispatch_event(FramebufferResizedEvent());
-      });
+  glfwSetFramebufferSizeCallback(glfw::glfw_win_ptr(glfw_window_ptr_), [](GLFWwindow* window, int width, int height) {
+    auto* glfw_window = reinterpret_cast<GLFWWindow*>(glfwGetWindowUserPointer(window));
+    glfw_window->framebuffer_size_.store(glfw::pack_size(width, height), std::memory_order_release);
+    glfw_window->event_dispatcher_.dispatch_event(FramebufferResizedEvent());
+  });
 
   glfwSetWindowFocusCallback(glfw::glfw_win_ptr(glfw_window_ptr_), [](GLFWwindow* window, int focused) {
     auto* dispatcher = &reinterpret_cast<GLFWWindow*>(glfwGetWindowUserPointer(window))->event_dispatcher_;
@@ -102,6 +126,13 @@ void GLFWWindow::init_dispatcher() {
     dispatcher->enqueue_event(MouseScrolledEvent(xoffset, yoffset));
   });
 
+  glfwSetCursorPosCallback(glfw::glfw_win_ptr(glfw_window_ptr_), [](GLFWwindow* window, double x, double y) {
+    auto* dispatcher  = &reinterpret_cast<GLFWWindow*>(glfwGetWindowUserPointer(window))->event_dispatcher_;
+    const auto now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+    dispatcher->enqueue_event(MouseMovedEvent(x, y, static_cast<uint64_t>(now_ns.count())));
+  });
+
   glfwSetCursorEnterCallback(glfw::glfw_win_ptr(glfw_window_ptr_), [](GLFWwindow* window, int entered) {
     auto* dispatcher = &reinterpret_cast<GLFWWindow*>(glfwGetWindowUserPointer(window))->event_dispatcher_;
     if (entered) {
@@ -152,9 +183,31 @@ CursorMode GLFWWindow::mouse_cursor_mode() const {
   return *mouse_cursor_from_glfw(glfwGetInputMode(glfw::glfw_win_ptr(glfw_window_ptr_), GLFW_CURSOR));
 }
 
+bool GLFWWindow::set_raw_mouse_motion(bool enabled) {
+  if (glfwRawMouseMotionSupported() == GLFW_FALSE) {
+    return false;
+  }
+  glfwSetInputMode(glfw::glfw_win_ptr(glfw_window_ptr_), GLFW_RAW_MOUSE_MOTION, enabled ? GLFW_TRUE : GLFW_FALSE);
+  return true;
+}
+
+bool GLFWWindow::is_raw_mouse_motion() const {
+  return glfwGetInputMode(glfw::glfw_win_ptr(glfw_window_ptr_), GLFW_RAW_MOUSE_MOTION) == GLFW_TRUE;
+}
+
 bool GLFWWindow::should_close() const { return glfwWindowShouldClose(glfw::glfw_win_ptr(glfw_window_ptr_)) != 0; }
 
 Window::Dimensions GLFWWindow::framebuffer_size() const {
+  if (std::this_thread::get_id() != main_thread_id_) {
+    // GLFW allows querying the window on the main thread only, which keeps the cached size up to date
+    auto size = framebuffer_size_.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(size >> 32U) == 0 || static_cast<uint32_t>(size) == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      size = framebuffer_size_.load(std::memory_order_acquire);
+    }
+    return Window::Dimensions{.width = static_cast<uint32_t>(size >> 32U), .height = static_cast<uint32_t>(size)};
+  }
+
   int width  = 0;
   int height = 0;
   glfwGetFramebufferSize(glfw::glfw_win_ptr(glfw_window_ptr_), &width, &height);
@@ -166,8 +219,19 @@ Window::Dimensions GLFWWindow::framebuffer_size() const {
   return Window::Dimensions{.width = static_cast<uint32_t>(width), .height = static_cast<uint32_t>(height)};
 }
 
+bool GLFWWindow::is_minimized() const {
+  const auto size = framebuffer_size_.load(std::memory_order_acquire);
+  return static_cast<uint32_t>(size >> 32U) == 0 || static_cast<uint32_t>(size) == 0;
+}
+
 void GLFWWindow::poll_events() { glfwPollEvents(); }
 
+void GLFWWindow::wait_events(std::chrono::nanoseconds timeout) {
+  glfwWaitEventsTimeout(std::chrono::duration<double>(timeout).count());
+}
+
+void GLFWWindow::wake() { glfwPostEmptyEvent(); }
+
 void GLFWWindow::destroy() {
   if (glfw_window_ptr_) {
     util::Logger::info("Destroying GLFW window...");
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <liberay/os/window/window.hpp>
 #include <liberay/os/window/window_props.hpp>
 #include <liberay/os/window_api.hpp>
 #include <liberay/util/ruleof.hpp>
+#include <thread>
 
 namespace eray::os {
 
@@ -18,12 +21,16 @@ class GLFWWindow final : public Window {
   ~GLFWWindow() final;
 
   void poll_events() final;
+  void wait_events(std::chrono::nanoseconds timeout) final;
+  void wake() final;
 
   void set_title(util::zstring_view title) final;
   void set_window_size(int width, int height) final;
   void set_fullscreen(bool fullscreen) final;
 
   Dimensions framebuffer_size() const final;
+  bool is_minimized() const final;
+  uint32_t refresh_rate() const final { return refresh_rate_; }
   MousePosition mouse_pos() const final;
 
   WindowAPI window_api() const final { return window_api_; }
@@ -34,6 +41,9 @@ class GLFWWindow final : public Window {
   void set_mouse_cursor_mode(CursorMode cursor_mode) final;
   CursorMode mouse_cursor_mode() const final;
 
+  bool set_raw_mouse_motion(bool enabled) final;
+  bool is_raw_mouse_motion() const final;
+
   bool should_close() const final;
 
   void* win_ptr() const final { return glfw_window_ptr_; }
@@ -47,6 +57,21 @@ class GLFWWindow final : public Window {
  private:
   void* glfw_window_ptr_;
   WindowAPI window_api_;
+
+  /**
+   * @brief Thread that created the window, the only one that may call GLFW.
+   *
+   */
+  std::thread::id main_thread_id_;
+
+  /**
+   * @brief Updated by the framebuffer size callback, the width in the high half. Read by `framebuffer_size()` called
+   * on the other threads.
+   *
+   */
+  std::atomic<uint64_t> framebuffer_size_ = 0;
+
+  uint32_t refresh_rate_ = 0;
 };
 
 }  // namespace eray::os
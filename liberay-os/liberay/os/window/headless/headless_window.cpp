@@ -0,0 +1,33 @@
+#include <liberay/os/window/events/event.hpp>
+#include <liberay/os/window/headless/headless_window.hpp>
+
+namespace eray::os {
+
+void HeadlessWindow::set_window_size(int width, int height) {
+  event_dispatcher_.dispatch_event(WindowResizedEvent(width, height));
+  event_dispatcher_.dispatch_event(FramebufferResizedEvent());
+}
+
+void HeadlessWindow::wait_events(std::chrono::nanoseconds timeout) {
+  auto lock = std::unique_lock(wake_mutex_);
+  wake_cv_.wait_for(lock, timeout, [this]() { return wake_requested_; });
+  wake_requested_ = false;
+}
+
+void HeadlessWindow::wake() {
+  {
+    const auto lock = std::lock_guard(wake_mutex_);
+    wake_requested_ = true;
+  }
+  wake_cv_.notify_one();
+}
+
+void HeadlessWindow::request_close() {
+  if (close_requested_) {
+    return;
+  }
+  close_requested_ = true;
+  event_dispatcher_.enqueue_event(WindowClosedEvent());
+}
+
+}  // namespace eray::os
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <liberay/os/window/window.hpp>
+#include <liberay/os/window/window_props.hpp>
+#include <liberay/os/window_api.hpp>
+#include <mutex>
+
+namespace eray::os {
+
+/**
+ * @brief Window without a display. The framebuffer is not shown anywhere, the renderers draw into offscreen images of
+ * its size. There is no user input, the window closes only when `request_close()` is called. Used to run the
+ * applications on machines without a display, e.g. in benchmarks.
+ *
+ */
+class HeadlessWindow final : public Window {
+ public:
+  HeadlessWindow() = delete;
+  explicit HeadlessWindow(const WindowProperties& props) : Window(props) {}
+  HeadlessWindow(const HeadlessWindow&)                = delete;
+  HeadlessWindow(HeadlessWindow&&) noexcept            = delete;
+  HeadlessWindow& operator=(const HeadlessWindow&)     = delete;
+  HeadlessWindow& operator=(HeadlessWindow&&) noexcept = delete;
+  ~HeadlessWindow() final                              = default;
+
+  void poll_events() final {}
+
+  /**
+   * @brief There are no events, it waits for the `timeout` or for `wake()`.
+   *
+   */
+  void wait_events(std::chrono::nanoseconds timeout) final;
+  void wake() final;
+
+  void set_title(util::zstring_view title) final { props_.title = std::string(title); }
+
+  /**
+   * @brief Resizes the framebuffer right away, the resize events are dispatched like for a regular window.
+   *
+   */
+  void set_window_size(int width, int height) final;
+  void set_fullscreen(bool /*fullscreen*/) final {}
+
+  Dimensions framebuffer_size() const final { return window_size(); }
+  bool is_minimized() const final { return false; }
+  uint32_t refresh_rate() const final { return 0; }
+  MousePosition mouse_pos() const final { return MousePosition{.x = 0.0, .y = 0.0}; }
+
+  WindowAPI window_api() const final { return WindowAPI::Headless; }
+
+  bool is_btn_pressed(KeyCode /*code*/) final { return false; }
+  bool is_mouse_btn_pressed(MouseBtnCode /*code*/) final { return false; }
+
+  void set_mouse_cursor_mode(CursorMode cursor_mode) final { cursor_mode_ = cursor_mode; }
+  CursorMode mouse_cursor_mode() const final { return cursor_mode_; }
+
+  bool should_close() const final { return close_requested_; }
+
+  /**
+   * @brief Makes `should_close()` return true, the headless equivalent of closing the window by the user.
+   *
+   */
+  void request_close();
+
+  void* win_ptr() const final { return nullptr; }
+
+  void destroy() final { destroyed_ = true; }
+  bool is_destroyed() const final { return destroyed_; }
+
+ private:
+  CursorMode cursor_mode_ = CursorMode::Normal;
+  bool close_requested_   = false;
+  bool destroyed_         = false;
+
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+  bool wake_requested_ = false;
+};
+
+}  // namespace eray::os
@@ -0,0 +1,24 @@
+#include <liberay/os/error.hpp>
+#include <liberay/os/window/headless/headless_window.hpp>
+#include <liberay/os/window/headless/headless_window_creator.hpp>
+#include <memory>
+
+namespace eray::os {
+
+Result<std::unique_ptr<IWindowCreator>, Error> HeadlessWindowCreator::create(RenderingAPI rendering_api) {
+  if (rendering_api != RenderingAPI::Vulkan) {
+    return std::unexpected(Error{
+        .msg  = "Headless windows support only the Vulkan rendering API",
+        .code = ErrorCode::RenderingAPINotSupported{},
+    });
+  }
+
+  util::Logger::info("Using the headless window backend");
+  return std::make_unique<HeadlessWindowCreator>(rendering_api);
+}
+
+Result<std::unique_ptr<Window>, Error> HeadlessWindowCreator::create_window(const WindowProperties& props) {
+  return std::unique_ptr<Window>(new HeadlessWindow(props));
+}
+
+}  // namespace eray::os
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <liberay/os/error.hpp>
+#include <liberay/os/rendering_api.hpp>
+#include <liberay/os/window/window_creator.hpp>
+#include <liberay/os/window_api.hpp>
+#include <liberay/util/ruleof.hpp>
+
+namespace eray::os {
+
+/**
+ * @brief Creates the `HeadlessWindow`s. Does not require any window backend, the renderers detect the headless
+ * windows by `WindowAPI::Headless` and render offscreen.
+ *
+ */
+class HeadlessWindowCreator : public IWindowCreator {
+ public:
+  HeadlessWindowCreator() = delete;
+  explicit HeadlessWindowCreator(RenderingAPI rendering_api) : rendering_api_(rendering_api) {}
+  ERAY_DELETE_COPY_AND_MOVE(HeadlessWindowCreator)
+
+  ~HeadlessWindowCreator() override = default;
+
+  [[nodiscard]] static Result<std::unique_ptr<IWindowCreator>, Error> create(
+      RenderingAPI rendering_api = RenderingAPI::Vulkan);
+  [[nodiscard]] Result<std::unique_ptr<Window>, Error> create_window(const WindowProperties& props) override;
+  [[nodiscard]] RenderingAPI rendering_api() override { return rendering_api_; }
+  [[nodiscard]] WindowAPI window_api() override { return WindowAPI::Headless; }
+
+  void terminate() final {}
+
+ private:
+  RenderingAPI rendering_api_;
+};
+
+}  // namespace eray::os
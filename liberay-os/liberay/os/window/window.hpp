@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <liberay/os/rendering_api.hpp>
 #include <liberay/os/window/events/event.hpp>
 #include <liberay/os/window/input_codes.hpp>
@@ -56,10 +58,27 @@ class Window {
    * `window_size()` function. On high DPI displays (like Apple's Retina display), screen coordinates returned by
    * `window_size()` does not correspond to pixels of the framebuffer.
    *
+   * Blocks while the window is minimized. Unlike the other methods it may be called on any thread, the other threads
+   * get the size reported by the last processed event.
+   *
    * @return Dimensions
    */
   virtual Dimensions framebuffer_size() const = 0;
 
+  /**
+   * @brief True while the framebuffer has a zero size, e.g. the window is minimized. Unlike `framebuffer_size()` it
+   * never blocks and may be called on any thread.
+   *
+   */
+  virtual bool is_minimized() const = 0;
+
+  /**
+   * @brief Refresh rate of the monitor in Hz, 0 when unknown. Determined when the window is created, from the monitor
+   * of a fullscreen window or the primary monitor. May be called on any thread.
+   *
+   */
+  virtual uint32_t refresh_rate() const = 0;
+
   virtual MousePosition mouse_pos() const = 0;
   virtual WindowAPI window_api() const    = 0;
 
@@ -71,6 +90,26 @@ class Window {
    */
   virtual void poll_events() = 0;
 
+  /**
+   * @brief Blocks until an event arrives, `wake()` is called or the `timeout` passes, then processes the events like
+   * `poll_events()`.
+   *
+   */
+  virtual void wait_events(std::chrono::nanoseconds timeout) = 0;
+
+  /**
+   * @brief Makes the pending `wait_events()` return. Unlike the other methods it may be called on any thread.
+   *
+   */
+  virtual void wake() = 0;
+
+  /**
+   * @brief Number of the events received by the window so far, e.g. to tell whether `wait_events()` has returned
+   * because of an event.
+   *
+   */
+  uint64_t received_events() const { return event_dispatcher_.received_events(); }
+
   virtual bool should_close() const                    = 0;
   virtual bool is_btn_pressed(KeyCode code)            = 0;
   virtual bool is_mouse_btn_pressed(MouseBtnCode code) = 0;
@@ -102,6 +141,15 @@ class Window {
   virtual void set_mouse_cursor_mode(CursorMode cursor_mode) = 0;
   virtual CursorMode mouse_cursor_mode() const               = 0;
 
+  /**
+   * @brief Requests the unscaled and unaccelerated mouse motion, which applies while the cursor is disabled, e.g. for
+   * the camera controls. The motion is reported by `MouseMovedEvent`.
+   *
+   * @return false The backend or the platform does not support the raw mouse motion.
+   */
+  virtual bool set_raw_mouse_motion(bool /*enabled*/) { return false; }
+  virtual bool is_raw_mouse_motion() const { return false; }
+
   /**
    * @brief Returns the native window handle for the active backend.
    *
@@ -6,14 +6,16 @@
 namespace eray::os {
 
 enum class WindowAPI : uint8_t {
-  GLFW   = 0,
-  WinAPI = 1,
-  _Count = 2,  // NOLINT
+  GLFW     = 0,
+  WinAPI   = 1,
+  Headless = 2,
+  _Count   = 3,  // NOLINT
 };
 
 constexpr auto kWindowingAPIName = util::StringEnumMapper<WindowAPI>({
     {WindowAPI::GLFW, "GLFW"},
     {WindowAPI::WinAPI, "WinAPI"},
+    {WindowAPI::Headless, "Headless"},
 });
 
 }  // namespace eray::os
@@ -0,0 +1,269 @@
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/res/error.hpp>
+#include <liberay/res/image.hpp>
+#include <liberay/res/mapped_file.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/try.hpp>
+#include <thread>
+
+namespace eray::res {
+
+namespace {
+
+constexpr auto kMagic   = std::array<char, 8>{'E', 'R', 'A', 'Y', 'A', 'S', 'T', '\0'};
+constexpr auto kVersion = uint32_t{1};
+
+/**
+ * @brief Bumped whenever the image processing changes its output, so the stale images miss the cache.
+ *
+ */
+constexpr auto kImageProcessingVersion = uint32_t{2};
+
+struct AssetFileHeader {
+  std::array<char, 8> magic;
+  uint32_t version;
+  AssetKind kind;
+  uint64_t content_hash;
+  uint64_t params_hash;
+  uint64_t payload_size;
+  uint32_t metadata_size;
+  uint32_t reserved;
+  std::array<std::byte, CachedAsset::kMaxMetadataSize> metadata;
+  std::array<std::byte, 16> padding;
+};
+
+// The payload follows the header, the offsets are mirrored in `CachedAsset`
+static_assert(sizeof(AssetFileHeader) == 128);
+static_assert(offsetof(AssetFileHeader, metadata) == 48);
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+template <typename T>
+T read_unaligned(const std::byte* ptr) {
+  auto result = T{};
+  std::memcpy(&result, ptr, sizeof(T));
+  return result;
+}
+
+uint64_t round(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  acc  = std::rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+uint64_t merge_round(uint64_t acc, uint64_t val) {
+  acc ^= round(0, val);
+  return acc * kPrime1 + kPrime4;
+}
+
+uint64_t image_params_hash(ColorSpace color_space) {
+  const auto params = std::array<uint32_t, 2>{kImageProcessingVersion, static_cast<uint32_t>(color_space)};
+  return content_hash(std::as_bytes(std::span(params)));
+}
+
+}  // namespace
+
+uint64_t content_hash(std::span<const std::byte> bytes, uint64_t seed) {
+  const auto* ptr = bytes.data();
+  const auto* end = ptr + bytes.size();
+
+  auto hash = uint64_t{0};
+  if (bytes.size() >= 32) {
+    auto v1 = seed + kPrime1 + kPrime2;
+    auto v2 = seed + kPrime2;
+    auto v3 = seed;
+    auto v4 = seed - kPrime1;
+    for (; ptr + 32 <= end; ptr += 32) {
+      v1 = round(v1, read_unaligned<uint64_t>(ptr));
+      v2 = round(v2, read_unaligned<uint64_t>(ptr + 8));
+      v3 = round(v3, read_unaligned<uint64_t>(ptr + 16));
+      v4 = round(v4, read_unaligned<uint64_t>(ptr + 24));
+    }
+    hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+    hash = merge_round(hash, v1);
+    hash = merge_round(hash, v2);
+    hash = merge_round(hash, v3);
+    hash = merge_round(hash, v4);
+  } else {
+    hash = seed + kPrime5;
+  }
+
+  hash += static_cast<uint64_t>(bytes.size());
+  for (; ptr + 8 <= end; ptr += 8) {
+    hash ^= round(0, read_unaligned<uint64_t>(ptr));
+    hash  = std::rotl(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (ptr + 4 <= end) {
+    hash ^= static_cast<uint64_t>(read_unaligned<uint32_t>(ptr)) * kPrime1;
+    hash  = std::rotl(hash, 23) * kPrime2 + kPrime3;
+    ptr  += 4;
+  }
+  for (; ptr < end; ++ptr) {
+    hash ^= static_cast<uint64_t>(*ptr) * kPrime5;
+    hash  = std::rotl(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+util::Result<AssetKey, FileError> AssetKey::from_file(const std::filesystem::path& path, uint64_t params_hash) {
+  TRY_UNWRAP_DEFINE(file, MappedFile::open(path));
+  return AssetKey::from_bytes(file.bytes(), params_hash);
+}
+
+util::Result<AssetCache, FileError> AssetCache::open(const std::filesystem::path& directory) {
+  auto ec = std::error_code{};
+  std::filesystem::create_directories(directory, ec);
+  if (ec || !std::filesystem::is_directory(directory)) {
+    util::Logger::err(R"(Could not create the asset cache directory "{}": {})", directory.string(), ec.message());
+    return std::unexpected(FileError{
+        .path = directory,
+        .msg  = "Could not create the asset cache directory",
+        .code = FileErrorCode::PermissionDenied,
+    });
+  }
+
+  return AssetCache(directory);
+}
+
+std::filesystem::path AssetCache::asset_path(const AssetKey& key, AssetKind kind) const {
+  return directory_ /
+         std::format("{:016x}{:016x}.{}.asset", key.content_hash, key.params_hash, static_cast<uint32_t>(kind));
+}
+
+std::optional<CachedAsset> AssetCache::find(const AssetKey& key, AssetKind kind) const {
+  const auto path = asset_path(key, kind);
+  if (!std::filesystem::is_regular_file(path)) {
+    return std::nullopt;
+  }
+
+  auto file = MappedFile::open(path);
+  if (!file) {
+    return std::nullopt;
+  }
+
+  auto header = AssetFileHeader{};
+  if (file->size_bytes() < sizeof(header)) {
+    util::Logger::warn(R"(Ignoring the truncated cached asset "{}")", path.string());
+    return std::nullopt;
+  }
+  std::memcpy(&header, file->bytes().data(), sizeof(header));
+
+  if (header.magic != kMagic || header.version != kVersion || header.kind != kind ||
+      header.content_hash != key.content_hash || header.params_hash != key.params_hash ||
+      header.payload_size != file->size_bytes() - sizeof(header)) {
+    util::Logger::warn(R"(Ignoring the invalid cached asset "{}")", path.string());
+    return std::nullopt;
+  }
+
+  return CachedAsset(std::move(*file), kind, static_cast<size_t>(header.payload_size));
+}
+
+util::Result<void, FileError> AssetCache::store(const AssetKey& key, AssetKind kind,
+                                                std::span<const std::byte> metadata,
+                                                std::span<const std::byte> payload) const {
+  if (metadata.size() > CachedAsset::kMaxMetadataSize) {
+    return std::unexpected(FileError{
+        .path = asset_path(key, kind),
+        .msg  = std::format("Asset metadata must not exceed {} bytes", CachedAsset::kMaxMetadataSize),
+        .code = FileErrorCode::FileTooLarge,
+    });
+  }
+
+  auto header          = AssetFileHeader{};
+  header.magic         = kMagic;
+  header.version       = kVersion;
+  header.kind          = kind;
+  header.content_hash  = key.content_hash;
+  header.params_hash   = key.params_hash;
+  header.payload_size  = payload.size();
+  header.metadata_size = static_cast<uint32_t>(metadata.size());
+  std::memcpy(header.metadata.data(), metadata.data(), metadata.size());
+
+  // The asset is written to a temporary file first, so the readers never map a partially written asset. The name is
+  // unique per thread, so the concurrent writers of the same asset do not interleave.
+  const auto path = asset_path(key, kind);
+  auto tmp_path   = path;
+  tmp_path += std::format(".{:x}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    auto file = std::ofstream(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+    if (!file) {
+      util::Logger::err(R"(Could not write the cached asset "{}")", tmp_path.string());
+      return std::unexpected(FileError{
+          .path = tmp_path,
+          .msg  = "Could not write the cached asset",
+          .code = FileErrorCode::ReadFailure,
+      });
+    }
+  }
+
+  auto ec = std::error_code{};
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    util::Logger::err(R"(Could not replace the cached asset "{}": {})", path.string(), ec.message());
+    std::filesystem::remove(tmp_path, ec);
+    return std::unexpected(FileError{
+        .path = path,
+        .msg  = "Could not replace the cached asset",
+        .code = FileErrorCode::PermissionDenied,
+    });
+  }
+
+  return {};
+}
+
+util::Result<void, FileError> AssetCache::store_image(const AssetKey& key, const MipMappedImage& image,
+                                                      ColorSpace color_space) const {
+  const auto metadata = ImageAssetMetadata{
+      .lod0_width  = image.lod0_width,
+      .lod0_height = image.lod0_height,
+      .mip_levels  = image.mip_levels,
+      .color_space = color_space,
+      .format      = image.format,
+  };
+  return store(key, AssetKind::Image, std::as_bytes(std::span(&metadata, 1)),
+               std::as_bytes(std::span(image.data)));
+}
+
+util::Result<CachedAsset, FileError> AssetCache::load_mipmapped_image(const std::filesystem::path& path,
+                                                                      ColorSpace color_space) const {
+  TRY_UNWRAP_DEFINE(key, AssetKey::from_file(path, image_params_hash(color_space)));
+  if (auto cached = find(key, AssetKind::Image)) {
+    return std::move(*cached);
+  }
+
+  TRY_UNWRAP_DEFINE(image, Image::load_from_path(path));
+  TRY(store_image(key, image.generate_mipmaps_buffer(color_space), color_space));
+  util::Logger::info(R"(Cached the mipmapped image "{}")", path.string());
+
+  if (auto cached = find(key, AssetKind::Image)) {
+    return std::move(*cached);
+  }
+  return std::unexpected(FileError{
+      .path = asset_path(key, AssetKind::Image),
+      .msg  = "Could not read back the cached asset",
+      .code = FileErrorCode::ReadFailure,
+  });
+}
+
+}  // namespace eray::res
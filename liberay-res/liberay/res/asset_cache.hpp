@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <liberay/res/error.hpp>
+#include <liberay/res/image.hpp>
+#include <liberay/res/mapped_file.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/result.hpp>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+namespace eray::res {
+
+/**
+ * @brief 64-bit hash of the bytes (XXH64), fast enough to hash the source files on every run.
+ *
+ */
+uint64_t content_hash(std::span<const std::byte> bytes, uint64_t seed = 0);
+
+/**
+ * @brief Identifies a processed asset: the hash of the source content and the hash of the processing parameters
+ * (e.g. the color space and the version of the processing code). A change of either one misses the cache.
+ *
+ */
+struct AssetKey {
+  uint64_t content_hash;
+  uint64_t params_hash;
+
+  static AssetKey from_bytes(std::span<const std::byte> content, uint64_t params_hash = 0) {
+    return AssetKey{.content_hash = res::content_hash(content), .params_hash = params_hash};
+  }
+
+  /**
+   * @brief Hashes the mapped file, so the key costs a single read of the source.
+   *
+   */
+  static util::Result<AssetKey, FileError> from_file(const std::filesystem::path& path, uint64_t params_hash = 0);
+
+  bool operator==(const AssetKey&) const = default;
+};
+
+enum class AssetKind : uint32_t {
+  Blob   = 0,
+  Image  = 1,
+  Shader = 2,
+  Mesh   = 3,
+};
+
+/**
+ * @brief Metadata of the `AssetKind::Image` assets. The payload is the packed mip chain of `format` pixels, LOD0
+ * first, as returned by `Image::generate_mipmaps_buffer()`.
+ *
+ */
+struct ImageAssetMetadata {
+  uint32_t lod0_width;
+  uint32_t lod0_height;
+  uint32_t mip_levels;
+  ColorSpace color_space;
+  PixelFormat format;
+};
+
+/**
+ * @brief Asset read from the cache. The payload is read straight from the mapped file and is 64-byte aligned, so it
+ * may be copied to a staging buffer as it is.
+ *
+ */
+class CachedAsset {
+ public:
+  static constexpr size_t kMaxMetadataSize = 64;
+
+  AssetKind kind() const { return kind_; }
+
+  std::span<const std::byte> payload() const { return file_.bytes().subspan(kPayloadOffset, payload_size_); }
+  util::MemoryRegion memory_region() const { return util::MemoryRegion(payload().data(), payload_size_); }
+
+  /**
+   * @brief Metadata stored with the asset, e.g. `ImageAssetMetadata`.
+   *
+   */
+  template <typename T>
+    requires(std::is_trivially_copyable_v<T> && sizeof(T) <= kMaxMetadataSize)
+  T metadata() const {
+    auto result = T{};
+    std::memcpy(&result, file_.bytes().data() + kMetadataOffset, sizeof(T));
+    return result;
+  }
+
+ private:
+  friend class AssetCache;
+
+  static constexpr size_t kMetadataOffset = 48;
+  static constexpr size_t kPayloadOffset  = 128;
+
+  CachedAsset(MappedFile&& file, AssetKind kind, size_t payload_size)
+      : file_(std::move(file)), kind_(kind), payload_size_(payload_size) {}
+
+  MappedFile file_;
+  AssetKind kind_;
+  size_t payload_size_;
+};
+
+/**
+ * @brief On-disk cache of processed assets (mipmapped images, compiled shaders, optimized meshes), one flat file per
+ * asset named after its key. The files are memory mapped on load, so a warm start only reads the pages it uses.
+ *
+ * The files are written to a temporary path and renamed, so the concurrent or interrupted writes never leave a partial
+ * asset behind. The cache is meant to stay on one machine, the files are stored in the native byte order.
+ *
+ */
+class AssetCache {
+ public:
+  /**
+   * @brief Opens the cache, the directory is created if it does not exist.
+   *
+   */
+  static util::Result<AssetCache, FileError> open(const std::filesystem::path& directory);
+
+  /**
+   * @brief Returns `std::nullopt` on a miss, or if the cached file is invalid (e.g. written by an older version).
+   *
+   */
+  std::optional<CachedAsset> find(const AssetKey& key, AssetKind kind) const;
+
+  /**
+   * @brief Stores the asset, replaces the cached one with the same key and kind.
+   *
+   * @param key
+   * @param kind
+   * @param metadata At most `CachedAsset::kMaxMetadataSize` bytes.
+   * @param payload
+   * @return util::Result<void, FileError>
+   */
+  util::Result<void, FileError> store(const AssetKey& key, AssetKind kind, std::span<const std::byte> metadata,
+                                      std::span<const std::byte> payload) const;
+
+  util::Result<void, FileError> store_image(const AssetKey& key, const MipMappedImage& image,
+                                            ColorSpace color_space) const;
+
+  /**
+   * @brief Returns the cached mip chain of the image file. On a miss the file is decoded, its mipmaps are generated
+   * and the result is stored first.
+   *
+   * @param path Source image.
+   * @param color_space
+   * @return util::Result<CachedAsset, FileError> Asset with `ImageAssetMetadata`.
+   */
+  util::Result<CachedAsset, FileError> load_mipmapped_image(const std::filesystem::path& path,
+                                                            ColorSpace color_space = ColorSpace::Srgb) const;
+
+  std::filesystem::path asset_path(const AssetKey& key, AssetKind kind) const;
+
+  const std::filesystem::path& directory() const { return directory_; }
+
+ private:
+  explicit AssetCache(std::filesystem::path directory) : directory_(std::move(directory)) {}
+
+  std::filesystem::path directory_;
+};
+
+}  // namespace eray::res
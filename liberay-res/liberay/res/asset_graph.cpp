@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <deque>
+#include <expected>
+#include <liberay/res/asset_graph.hpp>
+#include <liberay/res/mapped_file.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/try.hpp>
+#include <system_error>
+
+namespace eray::res {
+
+namespace {
+
+std::string_view trim_front(std::string_view str) {
+  const auto first = str.find_first_not_of(" \t");
+  return first == std::string_view::npos ? std::string_view() : str.substr(first);
+}
+
+}  // namespace
+
+std::vector<std::string_view> find_includes(std::string_view source) {
+  constexpr auto kInclude = std::string_view("include");
+
+  auto includes = std::vector<std::string_view>();
+  while (!source.empty()) {
+    const auto line_end = source.find('\n');
+    auto line           = trim_front(source.substr(0, line_end));
+    source              = line_end == std::string_view::npos ? std::string_view() : source.substr(line_end + 1);
+
+    // `# include` is a valid directive as well
+    if (!line.starts_with('#')) {
+      continue;
+    }
+    line = trim_front(line.substr(1));
+    if (!line.starts_with(kInclude)) {
+      continue;
+    }
+    line = trim_front(line.substr(kInclude.size()));
+    if (line.empty() || (line.front() != '"' && line.front() != '<')) {
+      continue;
+    }
+
+    const auto close = line.find(line.front() == '"' ? '"' : '>', 1);
+    if (close != std::string_view::npos && close > 1) {
+      includes.push_back(line.substr(1, close - 1));
+    }
+  }
+
+  return includes;
+}
+
+AssetGraph AssetGraph::create(std::vector<std::filesystem::path> include_dirs) {
+  return AssetGraph(std::move(include_dirs));
+}
+
+std::filesystem::path AssetGraph::normalize(const std::filesystem::path& path) {
+  auto ec     = std::error_code{};
+  auto result = std::filesystem::weakly_canonical(path, ec);
+  return ec ? path.lexically_normal() : result;
+}
+
+util::Result<AssetNodeId, FileError> AssetGraph::add(const std::filesystem::path& path) {
+  auto normalized = normalize(path);
+  if (auto it = ids_.find(normalized); it != ids_.end()) {
+    return it->second;
+  }
+
+  auto ec         = std::error_code{};
+  auto write_time = std::filesystem::last_write_time(normalized, ec);
+  if (ec) {
+    util::Logger::err(R"(Could not track the asset file "{}": {})", normalized.string(), ec.message());
+    return std::unexpected(FileError{
+        .path = normalized,
+        .msg  = "Could not track the asset file",
+        .code = FileErrorCode::FileNotFound,
+    });
+  }
+  TRY_UNWRAP_DEFINE(file, MappedFile::open(normalized));
+
+  const auto id = AssetNodeId{static_cast<uint32_t>(nodes_.size())};
+  nodes_.push_back(Node{
+      .path         = normalized,
+      .write_time   = write_time,
+      .content_hash = res::content_hash(file.bytes()),
+      .dependencies = {},
+      .dependents   = {},
+      .is_shader    = false,
+  });
+  ids_.emplace(std::move(normalized), id);
+
+  return id;
+}
+
+util::Result<AssetNodeId, FileError> AssetGraph::add_shader(const std::filesystem::path& path) {
+  TRY_UNWRAP_DEFINE(id, add(path));
+  if (!nodes_[id._value].is_shader) {
+    // Marked before the scan, so the include cycles end here
+    nodes_[id._value].is_shader = true;
+    TRY(scan_includes(id));
+  }
+  return id;
+}
+
+std::optional<AssetNodeId> AssetGraph::find(const std::filesystem::path& path) const {
+  if (auto it = ids_.find(normalize(path)); it != ids_.end()) {
+    return it->second;
+  }
+  return std::nullopt;
+}
+
+util::Result<void, FileError> AssetGraph::set_dependencies(AssetNodeId node,
+                                                           std::span<const AssetNodeId> dependencies) {
+  for (const auto dependency : dependencies) {
+    if (dependency == node || depends_on(dependency, node)) {
+      util::Logger::err(R"(Asset "{}" cannot depend on "{}", it would be a dependency cycle)",
+                        nodes_[node._value].path.string(), nodes_[dependency._value].path.string());
+      return std::unexpected(FileError{
+          .path = nodes_[node._value].path,
+          .msg  = "Asset dependency cycle",
+          .code = FileErrorCode::DependencyCycle,
+      });
+    }
+  }
+
+  for (const auto old : nodes_[node._value].dependencies) {
+    std::erase(nodes_[old._value].dependents, node);
+  }
+
+  auto& result = nodes_[node._value].dependencies;
+  result.clear();
+  for (const auto dependency : dependencies) {
+    if (std::ranges::find(result, dependency) == result.end()) {
+      result.push_back(dependency);
+      nodes_[dependency._value].dependents.push_back(node);
+    }
+  }
+
+  return {};
+}
+
+util::Result<void, FileError> AssetGraph::scan_includes(AssetNodeId node) {
+  // The node vector grows while the includes are added, so the node is always indexed
+  const auto path = nodes_[node._value].path;
+  TRY_UNWRAP_DEFINE(file, MappedFile::open(path));
+
+  auto dependencies = std::vector<AssetNodeId>();
+  for (const auto include : find_includes(file.as_string_view())) {
+    auto resolved = path.parent_path() / include;
+    for (const auto& dir : include_dirs_) {
+      if (std::filesystem::is_regular_file(resolved)) {
+        break;
+      }
+      resolved = dir / include;
+    }
+    if (!std::filesystem::is_regular_file(resolved)) {
+      util::Logger::warn(R"(Could not find the include "{}" of the shader "{}")", include, path.string());
+      continue;
+    }
+
+    TRY_UNWRAP_DEFINE(dependency, add_shader(resolved));
+    if (dependency == node || depends_on(dependency, node)) {
+      // Guarded mutual includes, the cycle is not a dependency
+      continue;
+    }
+    dependencies.push_back(dependency);
+  }
+
+  return set_dependencies(node, dependencies);
+}
+
+bool AssetGraph::depends_on(AssetNodeId node, AssetNodeId dependency) const {
+  auto visited = std::vector<bool>(nodes_.size(), false);
+  auto stack   = std::vector<AssetNodeId>{node};
+  while (!stack.empty()) {
+    const auto current = stack.back();
+    stack.pop_back();
+    for (const auto next : nodes_[current._value].dependencies) {
+      if (next == dependency) {
+        return true;
+      }
+      if (!visited[next._value]) {
+        visited[next._value] = true;
+        stack.push_back(next);
+      }
+    }
+  }
+  return false;
+}
+
+std::vector<AssetNodeId> AssetGraph::poll() {
+  auto changed = std::vector<AssetNodeId>();
+  for (auto i = 0U; i < nodes_.size(); ++i) {
+    auto& node      = nodes_[i];
+    auto ec         = std::error_code{};
+    auto write_time = std::filesystem::last_write_time(node.path, ec);
+    if (ec || write_time == node.write_time) {
+      continue;
+    }
+
+    auto file = MappedFile::open(node.path);
+    if (!file) {
+      continue;
+    }
+
+    node.write_time = write_time;
+    const auto hash = res::content_hash(file->bytes());
+    if (hash != node.content_hash) {
+      node.content_hash = hash;
+      changed.push_back(AssetNodeId{i});
+    }
+  }
+
+  for (const auto id : changed) {
+    if (nodes_[id._value].is_shader) {
+      if (auto result = scan_includes(id); !result) {
+        util::Logger::warn(R"(Could not rescan the includes of the shader "{}": {})",
+                           nodes_[id._value].path.string(), result.error().msg);
+      }
+    }
+  }
+
+  // == Dependents =====================================================================================================
+  auto affected = std::vector<bool>(nodes_.size(), false);
+  auto stack    = changed;
+  for (const auto id : changed) {
+    affected[id._value] = true;
+  }
+  while (!stack.empty()) {
+    const auto current = stack.back();
+    stack.pop_back();
+    for (const auto dependent : nodes_[current._value].dependents) {
+      if (!affected[dependent._value]) {
+        affected[dependent._value] = true;
+        stack.push_back(dependent);
+      }
+    }
+  }
+
+  // == Topological order ==============================================================================================
+  auto pending_dependencies = std::vector<uint32_t>(nodes_.size(), 0);
+  auto ready                = std::deque<AssetNodeId>();
+  for (auto i = 0U; i < nodes_.size(); ++i) {
+    if (!affected[i]) {
+      continue;
+    }
+    pending_dependencies[i] = static_cast<uint32_t>(std::ranges::count_if(
+        nodes_[i].dependencies, [&](AssetNodeId dependency) { return affected[dependency._value]; }));
+    if (pending_dependencies[i] == 0) {
+      ready.push_back(AssetNodeId{i});
+    }
+  }
+
+  auto result = std::vector<AssetNodeId>();
+  while (!ready.empty()) {
+    const auto current = ready.front();
+    ready.pop_front();
+    result.push_back(current);
+    for (const auto dependent : nodes_[current._value].dependents) {
+      if (--pending_dependencies[dependent._value] == 0) {
+        ready.push_back(dependent);
+      }
+    }
+  }
+
+  return result;
+}
+
+AssetKey AssetGraph::key(AssetNodeId node, uint64_t params_hash) const {
+  auto memo = std::unordered_map<uint32_t, uint64_t>();
+  return AssetKey{.content_hash = combined_hash(node, memo), .params_hash = params_hash};
+}
+
+uint64_t AssetGraph::combined_hash(AssetNodeId node, std::unordered_map<uint32_t, uint64_t>& memo) const {
+  if (auto it = memo.find(node._value); it != memo.end()) {
+    return it->second;
+  }
+
+  const auto& dependencies = nodes_[node._value].dependencies;
+  if (dependencies.empty()) {
+    return nodes_[node._value].content_hash;
+  }
+
+  auto hashes = std::vector<uint64_t>{nodes_[node._value].content_hash};
+  for (const auto dependency : dependencies) {
+    hashes.push_back(combined_hash(dependency, memo));
+  }
+  const auto hash = res::content_hash(std::as_bytes(std::span(hashes)));
+  memo.emplace(node._value, hash);
+  return hash;
+}
+
+}  // namespace eray::res
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/res/error.hpp>
+#include <liberay/util/result.hpp>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace eray::res {
+
+struct AssetNodeId {
+  uint32_t _value;
+
+  bool operator==(const AssetNodeId&) const = default;
+};
+
+/**
+ * @brief Returns the paths of the `#include "..."` and `#include <...>` directives of a shader source, in order.
+ *
+ */
+std::vector<std::string_view> find_includes(std::string_view source);
+
+/**
+ * @brief Dependency graph of the source files of the assets, e.g. a shader depends on its includes, a material on its
+ * textures and a mesh on its materials. Every node is a file with its modification time and content hash.
+ *
+ * `poll()` rehashes only the files whose modification time changed and returns the nodes whose content changed
+ * together with everything that depends on them, so only the affected derived assets are processed and uploaded
+ * again. A touched file with the same content (e.g. a checkout) is not a change.
+ *
+ * The dependencies of the shaders added with `add_shader()` are their includes, which are rescanned whenever the
+ * shader or one of its includes changes. The rest of the dependencies is set by the importers with
+ * `set_dependencies()`.
+ *
+ */
+class AssetGraph {
+ public:
+  /**
+   * @brief Creates an empty graph.
+   *
+   * @param include_dirs Searched for the includes that are not relative to the including file.
+   * @return AssetGraph
+   */
+  static AssetGraph create(std::vector<std::filesystem::path> include_dirs = {});
+
+  /**
+   * @brief Adds the file, or returns its node if it has already been added. The file is hashed right away.
+   *
+   */
+  util::Result<AssetNodeId, FileError> add(const std::filesystem::path& path);
+
+  /**
+   * @brief Adds the shader source and its includes, recursively. An include that is not found is only logged, the
+   * shader compiler reports it.
+   *
+   */
+  util::Result<AssetNodeId, FileError> add_shader(const std::filesystem::path& path);
+
+  /**
+   * @brief Replaces the dependencies of the node, e.g. after the material was imported again. Fails if the graph
+   * would contain a cycle.
+   *
+   */
+  util::Result<void, FileError> set_dependencies(AssetNodeId node, std::span<const AssetNodeId> dependencies);
+
+  /**
+   * @brief Checks the modification times of the files.
+   *
+   * @return std::vector<AssetNodeId> The changed nodes and their transitive dependents, every node after its
+   * dependencies, so the derived assets can be processed in order. The files that cannot be read (e.g. still being
+   * written) are retried on the next poll.
+   */
+  std::vector<AssetNodeId> poll();
+
+  /**
+   * @brief Cache key of the asset derived from the node, a hash of the content of the file and of all of its
+   * transitive dependencies. A change of any of them misses the `AssetCache`, while an untouched asset hits it across
+   * the runs.
+   *
+   */
+  AssetKey key(AssetNodeId node, uint64_t params_hash = 0) const;
+
+  std::optional<AssetNodeId> find(const std::filesystem::path& path) const;
+
+  const std::filesystem::path& path(AssetNodeId node) const { return nodes_[node._value].path; }
+  uint64_t content_hash(AssetNodeId node) const { return nodes_[node._value].content_hash; }
+  std::span<const AssetNodeId> dependencies(AssetNodeId node) const { return nodes_[node._value].dependencies; }
+  std::span<const AssetNodeId> dependents(AssetNodeId node) const { return nodes_[node._value].dependents; }
+
+  size_t node_count() const { return nodes_.size(); }
+
+ private:
+  struct Node {
+    std::filesystem::path path;
+    std::filesystem::file_time_type write_time;
+    uint64_t content_hash;
+    std::vector<AssetNodeId> dependencies;
+    std::vector<AssetNodeId> dependents;
+
+    /**
+     * @brief The dependencies are the includes of the file, see `add_shader()`.
+     *
+     */
+    bool is_shader;
+  };
+
+  explicit AssetGraph(std::vector<std::filesystem::path> include_dirs) : include_dirs_(std::move(include_dirs)) {}
+
+  static std::filesystem::path normalize(const std::filesystem::path& path);
+
+  util::Result<void, FileError> scan_includes(AssetNodeId node);
+  bool depends_on(AssetNodeId node, AssetNodeId dependency) const;
+  uint64_t combined_hash(AssetNodeId node, std::unordered_map<uint32_t, uint64_t>& memo) const;
+
+  std::vector<std::filesystem::path> include_dirs_;
+  std::vector<Node> nodes_;
+  std::unordered_map<std::filesystem::path, AssetNodeId> ids_;
+};
+
+}  // namespace eray::res
@@ -11,6 +11,7 @@ enum class FileErrorCode : uint8_t {
   PermissionDenied     = 4,
   IncorrectFormat      = 5,
   InvalidFileExtension = 6,
+  DependencyCycle      = 7,
 };
 
 struct FileError {
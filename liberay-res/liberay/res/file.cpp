@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <expected>
-#include <fstream>
 #include <liberay/res/error.hpp>
 #include <liberay/res/file.hpp>
+#include <liberay/res/mapped_file.hpp>
+#include <liberay/util/job_system.hpp>
 #include <span>
 
 namespace eray::res {
@@ -44,27 +46,19 @@ util::Result<void, FileError> validate_file(const std::filesystem::path& path, s
 
 util::Result<std::string, FileError> load_as_string_utf8(const std::filesystem::path& path,
                                                          std::span<const char*> extensions) {
-  if (auto res = validate_file(path, extensions); !res) {
-    return std::unexpected(res.error());
-  }
-
-  auto file = std::ifstream(path, std::ios::binary);
+  // The mapped file is only used as the source of the single copy
+  auto file = MappedFile::open(path, extensions);
   if (!file) {
-    return std::unexpected(FileError{
-        .path = path,
-        .msg  = "Could not open the file stream",
-        .code = FileErrorCode::ReadFailure,
-    });
+    return std::unexpected(file.error());
   }
 
-  file.seekg(0, std::ios::end);
-  auto size = file.tellg();
-  file.seekg(0);
-
-  auto str_buff = std::string(static_cast<size_t>(size), '\0');
-  file.read(str_buff.data(), size);
+  return std::string(file->as_string_view());
+}
 
-  return str_buff;
+util::Task<util::Result<std::string, FileError>> load_as_string_utf8_async(util::JobSystem& jobs,
+                                                                           std::filesystem::path path) {
+  co_await jobs.schedule();
+  co_return load_as_string_utf8(path);
 }
 
 }  // namespace eray::res
@@ -2,8 +2,13 @@
 #include <filesystem>
 #include <liberay/res/error.hpp>
 #include <liberay/util/result.hpp>
+#include <liberay/util/task.hpp>
 #include <span>
 
+namespace eray::util {
+class JobSystem;
+}  // namespace eray::util
+
 namespace eray::res {
 
 /**
@@ -19,4 +24,15 @@ util::Result<void, FileError> validate_file(const std::filesystem::path& path, s
 util::Result<std::string, FileError> load_as_string_utf8(const std::filesystem::path& path,
                                                          std::span<const char*> extensions = {});
 
+/**
+ * @brief Reads the file on a worker of the `jobs`, the awaiting coroutine is resumed on the worker once the file is
+ * read.
+ *
+ * @param jobs
+ * @param path
+ * @return util::Task<util::Result<std::string, FileError>>
+ */
+util::Task<util::Result<std::string, FileError>> load_as_string_utf8_async(util::JobSystem& jobs,
+                                                                           std::filesystem::path path);
+
 }  // namespace eray::res
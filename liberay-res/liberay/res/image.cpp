@@ -4,84 +4,349 @@
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include <stb_image/stb_image_resize2.h>
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
 #include <expected>
 #include <filesystem>
+#include <liberay/math/packed.hpp>
 #include <liberay/res/error.hpp>
 #include <liberay/res/file.hpp>
 #include <liberay/res/image.hpp>
+#include <liberay/util/job_system.hpp>
 #include <liberay/util/logger.hpp>
 #include <liberay/util/path_utf8.hpp>
+#include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace eray::res {
 
+namespace {
+
+// Levels with at least this many pixels are split across the jobs, in chunks of `kRowsPerJob` rows
+constexpr auto kParallelLevelPixels = size_t{256} * 256;
+constexpr auto kRowsPerJob          = 32U;
+
+// The linear values are 16-bit, the sums of 4 of them are mapped back to sRGB with a 14-bit table
+constexpr auto kLinearToSrgbSize = size_t{1} << 14;
+
+struct SrgbTables {
+  std::array<uint16_t, 256> to_linear;
+  std::array<uint8_t, kLinearToSrgbSize + 1> to_srgb;
+};
+
+const SrgbTables& srgb_tables() {
+  static const auto kTables = [] {
+    auto tables = SrgbTables{};
+    for (auto i = 0U; i < tables.to_linear.size(); ++i) {
+      const auto c        = static_cast<double>(i) / 255.0;
+      const auto linear   = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+      tables.to_linear[i] = static_cast<uint16_t>(std::lround(linear * 65535.0));
+    }
+    for (auto i = 0U; i < tables.to_srgb.size(); ++i) {
+      const auto linear = std::min((static_cast<double>(i) + 0.5) / static_cast<double>(kLinearToSrgbSize), 1.0);
+      const auto c      = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+      tables.to_srgb[i] = static_cast<uint8_t>(std::lround(c * 255.0));
+    }
+    return tables;
+  }();
+  return kTables;
+}
+
+/**
+ * @brief Rounded average of the 4 pixels, each channel separately. Two channels are summed at a time in the 16-bit
+ * lanes of a 32-bit integer, so the loops over the pixels vectorize well.
+ *
+ */
+inline ColorU32 average_linear(ColorU32 a, ColorU32 b, ColorU32 c, ColorU32 d) {
+  constexpr auto kMask     = 0x00FF00FFU;
+  constexpr auto kRounding = 0x00020002U;
+
+  const auto even = (a & kMask) + (b & kMask) + (c & kMask) + (d & kMask) + kRounding;
+  const auto odd  = ((a >> 8) & kMask) + ((b >> 8) & kMask) + ((c >> 8) & kMask) + ((d >> 8) & kMask) + kRounding;
+  return ((even >> 2) & kMask) | (((odd >> 2) & kMask) << 8);
+}
+
+inline ColorU32 average_srgb(ColorU32 a, ColorU32 b, ColorU32 c, ColorU32 d, const SrgbTables& tables) {
+  auto result = average_linear(a, b, c, d) & 0xFF000000U;
+  for (auto shift = 0U; shift < 24; shift += 8) {
+    const auto sum = static_cast<uint32_t>(tables.to_linear[(a >> shift) & 0xFF]) +
+                     tables.to_linear[(b >> shift) & 0xFF] + tables.to_linear[(c >> shift) & 0xFF] +
+                     tables.to_linear[(d >> shift) & 0xFF];
+    result |= static_cast<ColorU32>(tables.to_srgb[(sum + 8) >> 4]) << shift;
+  }
+  return result;
+}
+
+/**
+ * @brief Writes the rows [row_begin, row_end) of the next mip level of a power-of-two image with a 2x2 box filter. A
+ * side that is already 1 pixel long is not filtered.
+ *
+ */
+template <ColorSpace TColorSpace>
+void downsample_rows(const ColorU32* src, uint32_t src_width, uint32_t src_height, ColorU32* dst, uint32_t row_begin,
+                     uint32_t row_end) {
+  const auto step_x    = src_width > 1 ? 1U : 0U;
+  const auto step_y    = src_height > 1 ? 1U : 0U;
+  const auto dst_width = std::max(src_width / 2, 1U);
+
+  [[maybe_unused]] const auto& tables = srgb_tables();
+  for (auto y = row_begin; y < row_end; ++y) {
+    const auto* row0 = src + static_cast<size_t>(y << step_y) * src_width;
+    const auto* row1 = row0 + static_cast<size_t>(step_y) * src_width;
+    auto* out        = dst + static_cast<size_t>(y) * dst_width;
+    for (auto x = 0U; x < dst_width; ++x) {
+      const auto x0 = x << step_x;
+      const auto x1 = x0 + step_x;
+      if constexpr (TColorSpace == ColorSpace::Srgb) {
+        out[x] = average_srgb(row0[x0], row0[x1], row1[x0], row1[x1], tables);
+      } else {
+        out[x] = average_linear(row0[x0], row0[x1], row1[x0], row1[x1]);
+      }
+    }
+  }
+}
+
+void downsample_level(const ColorU32* src, uint32_t src_width, uint32_t src_height, ColorU32* dst,
+                      ColorSpace color_space, util::JobSystem* jobs) {
+  const auto dst_width  = std::max(src_width / 2, 1U);
+  const auto dst_height = std::max(src_height / 2, 1U);
+
+  auto rows = [&](uint32_t row_begin, uint32_t row_end) {
+    if (color_space == ColorSpace::Srgb) {
+      downsample_rows<ColorSpace::Srgb>(src, src_width, src_height, dst, row_begin, row_end);
+    } else {
+      downsample_rows<ColorSpace::Linear>(src, src_width, src_height, dst, row_begin, row_end);
+    }
+  };
+
+  if (jobs == nullptr || static_cast<size_t>(dst_width) * dst_height < kParallelLevelPixels) {
+    rows(0, dst_height);
+    return;
+  }
+
+  const auto chunks = (dst_height + kRowsPerJob - 1) / kRowsPerJob;
+  jobs->parallel_for(
+      0, chunks,
+      [&](size_t chunk) {
+        const auto row_begin = static_cast<uint32_t>(chunk) * kRowsPerJob;
+        rows(row_begin, std::min(row_begin + kRowsPerJob, dst_height));
+      },
+      1);
+}
+
+bool is_power_of_two(uint32_t value) { return value != 0 && (value & (value - 1)) == 0; }
+
+stbir_pixel_layout stbir_layout(PixelFormat format) {
+  switch (channel_count(format)) {
+    case 1:
+      return STBIR_1CHANNEL;
+    case 2:
+      return STBIR_2CHANNEL;
+    default:
+      return STBIR_RGBA;
+  }
+}
+
+stbir_datatype stbir_type(PixelFormat format, ColorSpace color_space) {
+  switch (format) {
+    case PixelFormat::R16:
+      return STBIR_TYPE_UINT16;
+    case PixelFormat::RGBA16F:
+      return STBIR_TYPE_HALF_FLOAT;
+    case PixelFormat::RGBA32F:
+      return STBIR_TYPE_FLOAT;
+    default:
+      return color_space == ColorSpace::Srgb ? STBIR_TYPE_UINT8_SRGB : STBIR_TYPE_UINT8;
+  }
+}
+
+util::Result<Image, FileError> read_failure(const std::filesystem::path& path) {
+  util::Logger::err("Could not load the image. The file is invalid.");
+  return std::unexpected(FileError{
+      .path = path,
+      .msg  = "stbi_load result is NULL",
+      .code = FileErrorCode::ReadFailure,
+  });
+}
+
+/**
+ * @brief The image adopts the buffer decoded by stb_image, so the pixels are never copied.
+ *
+ */
+std::shared_ptr<const std::byte[]> adopt_decoded(void* buff) {
+  return std::shared_ptr<const std::byte[]>(static_cast<const std::byte*>(buff), [](const std::byte* ptr) {
+    stbi_image_free(const_cast<void*>(static_cast<const void*>(ptr)));
+  });
+}
+
+}  // namespace
+
 Image::Image(uint32_t width, uint32_t height, ColorU32 color) : width_(width), height_(height) {
-  data_ = std::vector<uint32_t>(width_ * height_, color);
+  data_ = std::vector<std::byte>(static_cast<size_t>(width_) * height_ * sizeof(ColorU32));
+  std::ranges::fill(std::span(reinterpret_cast<ColorU32*>(data_.data()), static_cast<size_t>(width_) * height_),
+                    color);
+}
+
+Image::Image(uint32_t width, uint32_t height, PixelFormat format, std::vector<std::byte>&& data)
+    : width_(width), height_(height), format_(format), data_(std::move(data)) {
+  assert(data_.size() == size_bytes() && "Image data must hold exactly all of the pixels");
 }
 
-Image::Image(uint32_t width, uint32_t height, uint8_t bpp, std::vector<ColorU32>&& data)
-    : width_(width), height_(height), bpp_(bpp), data_(std::move(data)) {}
+Image::Image(uint32_t width, uint32_t height, PixelFormat format, std::shared_ptr<const std::byte[]>&& decoded)
+    : width_(width), height_(height), format_(format), decoded_(std::move(decoded)) {}
 
 Image Image::create(uint32_t width, uint32_t height, ColorU32 color) { return Image(width, height, color); }
 
-Image Image::create(uint32_t width, uint32_t height, uint8_t bpp, std::vector<ColorU32>&& data) {
-  return Image(width, height, bpp, std::move(data));
+Image Image::create(uint32_t width, uint32_t height, std::vector<ColorU32>&& data) {
+  auto bytes = std::vector<std::byte>(data.size() * sizeof(ColorU32));
+  std::memcpy(bytes.data(), data.data(), bytes.size());
+  return Image(width, height, PixelFormat::RGBA8, std::move(bytes));
+}
+
+Image Image::create(uint32_t width, uint32_t height, PixelFormat format, std::vector<std::byte>&& data) {
+  return Image(width, height, format, std::move(data));
 }
 
-util::Result<Image, FileError> Image::load_from_path(const std::filesystem::path& path) {
+util::Result<Image, FileError> Image::load_from_path(const std::filesystem::path& path,
+                                                     const ImageLoadOptions& options) {
   auto validation_result = validate_file(path);
   if (!validation_result) {
     return std::unexpected(validation_result.error());
   }
 
-  stbi_set_flip_vertically_on_load(1);
-  int width  = 0;
-  int height = 0;
-  int bpp    = 0;
+  assert(is_float_format(options.hdr_format) && "HDR images must be loaded as a float format");
+
+  // The global flag would race with the loads on the other threads
+  stbi_set_flip_vertically_on_load_thread(1);
+  const auto path_str = util::path_to_utf8str(path);
+  int width           = 0;
+  int height          = 0;
+  int channels        = 0;
+  if (stbi_info(path_str.c_str(), &width, &height, &channels) == 0) {
+    return read_failure(path);
+  }
+
+  // == HDR ============================================================================================================
+  if (stbi_is_hdr(path_str.c_str()) != 0) {
+    auto* buff = stbi_loadf(path_str.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!buff) {
+      return read_failure(path);
+    }
+    auto decoded = adopt_decoded(buff);
+    if (options.hdr_format == PixelFormat::RGBA32F) {
+      return Image(static_cast<uint32_t>(width), static_cast<uint32_t>(height), PixelFormat::RGBA32F,
+                   std::move(decoded));
+    }
+
+    const auto count = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+    auto halves      = std::vector<std::byte>(count * sizeof(math::Half));
+    math::to_halves(std::span(buff, count), std::span(reinterpret_cast<math::Half*>(halves.data()), count));
+    return Image(static_cast<uint32_t>(width), static_cast<uint32_t>(height), PixelFormat::RGBA16F,
+                 std::move(halves));
+  }
+
+  // == 16-bit grayscale, e.g. height maps =============================================================================
+  if (options.native_channels && channels == 1 && stbi_is_16_bit(path_str.c_str()) != 0) {
+    auto* buff = stbi_load_16(path_str.c_str(), &width, &height, &channels, STBI_grey);
+    if (!buff) {
+      return read_failure(path);
+    }
+    return Image(static_cast<uint32_t>(width), static_cast<uint32_t>(height), PixelFormat::R16, adopt_decoded(buff));
+  }
 
-  auto* buff = reinterpret_cast<uint32_t*>(
-      stbi_load(util::path_to_utf8str(path).c_str(), &width, &height, &bpp, STBI_rgb_alpha));
+  // == 8-bit ==========================================================================================================
+  auto format = PixelFormat::RGBA8;
+  if (options.native_channels && channels == 1) {
+    format = PixelFormat::R8;
+  } else if (options.native_channels && channels == 2) {
+    format = PixelFormat::RG8;
+  }
 
+  auto* buff = stbi_load(path_str.c_str(), &width, &height, &channels, static_cast<int>(channel_count(format)));
   if (!buff) {
-    util::Logger::err("Could not load the image. The file is invalid.");
-    return std::unexpected(FileError{
-        .path = path,
-        .msg  = "stbi_load result is NULL",
-        .code = FileErrorCode::ReadFailure,
-    });
+    return read_failure(path);
   }
+  return Image(static_cast<uint32_t>(width), static_cast<uint32_t>(height), format, adopt_decoded(buff));
+}
+
+std::vector<util::Result<Image, FileError>> Image::load_many(util::JobSystem& jobs,
+                                                             std::span<const std::filesystem::path> paths,
+                                                             const ImageLoadOptions& options) {
+  auto loaded = std::vector<std::optional<util::Result<Image, FileError>>>(paths.size());
+  jobs.parallel_for(0, paths.size(), [&](size_t i) { loaded[i].emplace(load_from_path(paths[i], options)); }, 1);
 
-  auto data = std::vector<ColorU32>();
-  data.insert(data.end(), &buff[0], &buff[width * height]);
-  stbi_image_free(reinterpret_cast<void*>(buff));
-  return Image(static_cast<uint32_t>(width), static_cast<uint32_t>(height), static_cast<uint8_t>(bpp), std::move(data));
+  auto result = std::vector<util::Result<Image, FileError>>();
+  result.reserve(paths.size());
+  for (auto& image : loaded) {
+    result.push_back(std::move(*image));
+  }
+  return result;
 }
 
-void Image::clear(uint32_t color) {
-  for (auto& pixel : data_) {
-    pixel = color;
+void Image::load_many_async(util::JobSystem& jobs, std::span<const std::filesystem::path> paths,
+                            LoadCallback&& on_loaded, util::JobCounter& counter, const ImageLoadOptions& options) {
+  auto callback = std::make_shared<LoadCallback>(std::move(on_loaded));
+  for (auto i = size_t{0}; i < paths.size(); ++i) {
+    jobs.run([callback, i, path = paths[i], options]() { (*callback)(i, load_from_path(path, options)); }, counter);
   }
 }
 
+util::Task<util::Result<Image, FileError>> Image::load_async(util::JobSystem& jobs, std::filesystem::path path,
+                                                             ImageLoadOptions options) {
+  co_await jobs.schedule();
+  co_return load_from_path(path, options);
+}
+
+const std::byte* Image::rgba8_bytes() const {
+  assert(format_ == PixelFormat::RGBA8 && "ColorU32 pixels are available for the RGBA8 images only");
+  return bytes();
+}
+
+ColorU32* Image::writable_pixels() {
+  assert(format_ == PixelFormat::RGBA8 && "ColorU32 pixels are available for the RGBA8 images only");
+  if (decoded_) {
+    data_.assign(decoded_.get(), decoded_.get() + size_bytes());
+    decoded_.reset();
+  }
+  return reinterpret_cast<ColorU32*>(data_.data());
+}
+
+void Image::clear(uint32_t color) {
+  decoded_.reset();
+  data_.resize(size_bytes());
+  std::ranges::fill(std::span(writable_pixels(), static_cast<size_t>(width_) * height_), color);
+}
+
 void Image::set_pixel_safe(uint32_t x, uint32_t y, uint32_t color) {
   if (!is_in_bounds(x, y)) {
     return;
   }
 
-  data_[x + y * width_] = color;
+  writable_pixels()[x + y * width_] = color;
 }
 
-void Image::set_pixel(uint32_t x, uint32_t y, uint32_t color) { data_[x + y * width_] = color; }
+void Image::set_pixel(uint32_t x, uint32_t y, uint32_t color) { writable_pixels()[x + y * width_] = color; }
 
 void Image::resize(uint32_t new_width, uint32_t new_height, uint32_t color) {
-  data_.resize(new_width * new_height, color);
+  writable_pixels();
+  const auto old_count = static_cast<size_t>(width_) * height_;
+  const auto new_count = static_cast<size_t>(new_width) * new_height;
+  data_.resize(new_count * sizeof(ColorU32));
+  if (new_count > old_count) {
+    std::ranges::fill(std::span(writable_pixels() + old_count, new_count - old_count), color);
+  }
   width_  = new_width;
   height_ = new_height;
 }
 
 bool Image::is_in_bounds(uint32_t x, uint32_t y) const { return x < width_ && y < height_; }
 
-uint32_t Image::pixel(uint32_t x, uint32_t y) const { return data_[x + y * width_]; }
+uint32_t Image::pixel(uint32_t x, uint32_t y) const { return raw()[x + y * width_]; }
 
 uint32_t Image::calculate_mip_levels() const { return calculate_mip_levels(width_, height_); }
 
@@ -96,51 +361,82 @@ uint32_t Image::calculate_mip_levels(uint32_t width, uint32_t height, std::uint3
   return levels;
 }
 
-MipMappedImage Image::generate_mipmaps_buffer() const {
+size_t Image::mip_chain_size() const {
+  auto mip_width  = width_;
+  auto mip_height = height_;
+  auto size       = size_t{0};
+  for (auto i = 0U; i < calculate_mip_levels(); ++i) {
+    size      += static_cast<size_t>(mip_width) * mip_height;
+    mip_width  = std::max(mip_width / 2, 1U);
+    mip_height = std::max(mip_height / 2, 1U);
+  }
+  return size;
+}
+
+MipMappedImage Image::generate_mipmaps_buffer(ColorSpace color_space) const {
+  auto result = std::vector<std::byte>(mip_chain_size_bytes());
+  generate_mipmaps_into(result, color_space);
+
+  return MipMappedImage{
+      .data        = std::move(result),
+      .lod0_width  = width_,
+      .lod0_height = height_,
+      .mip_levels  = calculate_mip_levels(),
+      .format      = format_,
+  };
+}
+
+MipMappedImage Image::generate_mipmaps_buffer(util::JobSystem& jobs, ColorSpace color_space) const {
+  auto result = std::vector<std::byte>(mip_chain_size_bytes());
+  generate_mipmaps_into(result, color_space, &jobs);
+
+  return MipMappedImage{
+      .data        = std::move(result),
+      .lod0_width  = width_,
+      .lod0_height = height_,
+      .mip_levels  = calculate_mip_levels(),
+      .format      = format_,
+  };
+}
+
+void Image::generate_mipmaps_into(std::span<std::byte> out, ColorSpace color_space, util::JobSystem* jobs) const {
   if (height_ == 0 || width_ == 0) {
     util::panic("Cannot generate mipmaps, width and height must contain non-zero values.");
   }
+  assert(out.size() == mip_chain_size_bytes() && "Output must fit exactly all of the mip levels");
 
   const auto mip_levels = calculate_mip_levels();
+  const auto bpp        = static_cast<size_t>(bytes_per_pixel());
+  std::memcpy(out.data(), bytes(), size_bytes());
 
-  auto mip_width  = static_cast<int>(width_);
-  auto mip_height = static_cast<int>(height_);
-  auto buff_size  = 0;
-  for (auto i = 0U; i < mip_levels; ++i) {
-    buff_size += mip_width * mip_height;
-    mip_width  = std::max(mip_width / 2, 1);
-    mip_height = std::max(mip_height / 2, 1);
-  }
-
-  auto result = std::vector<ColorU32>();
-  result.resize(static_cast<size_t>(buff_size));
-  std::ranges::copy(data_.begin(), data_.end(), result.begin());
+  // The 2x2 box filter of the RGBA8 images is hand-written, the other formats go through stb_image_resize
+  const auto is_pot     = is_power_of_two(width_) && is_power_of_two(height_);
+  const auto fast_path  = is_pot && format_ == PixelFormat::RGBA8;
+  const auto filter     = is_pot ? STBIR_FILTER_BOX : STBIR_FILTER_TRIANGLE;
+  const auto data_type  = stbir_type(format_, color_space);
+  auto* const out_rgba8 = reinterpret_cast<ColorU32*>(out.data());
 
-  mip_width  = static_cast<int>(width_);
-  mip_height = static_cast<int>(height_);
-  auto prev  = 0;
-  auto next  = static_cast<int>(width_ * height_);
+  auto mip_width  = width_;
+  auto mip_height = height_;
+  auto prev       = size_t{0};
+  auto next       = static_cast<size_t>(width_) * height_;
   for (auto i = 1U; i < mip_levels; ++i) {
-    auto new_mip_width  = std::max(mip_width / 2, 1);
-    auto new_mip_height = std::max(mip_height / 2, 1);
+    auto new_mip_width  = std::max(mip_width / 2, 1U);
+    auto new_mip_height = std::max(mip_height / 2, 1U);
 
-    stbir_resize(result.data() + prev, mip_width, mip_height, 0, result.data() + next, new_mip_width, new_mip_height, 0,
-                 stbir_pixel_layout::STBIR_RGBA, stbir_datatype::STBIR_TYPE_UINT8, stbir_edge::STBIR_EDGE_CLAMP,
-                 stbir_filter::STBIR_FILTER_TRIANGLE);
+    if (fast_path) {
+      downsample_level(out_rgba8 + prev, mip_width, mip_height, out_rgba8 + next, color_space, jobs);
+    } else {
+      stbir_resize(out.data() + prev * bpp, static_cast<int>(mip_width), static_cast<int>(mip_height), 0,
+                   out.data() + next * bpp, static_cast<int>(new_mip_width), static_cast<int>(new_mip_height), 0,
+                   stbir_layout(format_), data_type, stbir_edge::STBIR_EDGE_CLAMP, filter);
+    }
 
     prev       = next;
-    next       = next + new_mip_width * new_mip_height;
+    next       = next + static_cast<size_t>(new_mip_width) * new_mip_height;
     mip_width  = new_mip_width;
     mip_height = new_mip_height;
   }
-
-  return MipMappedImage{
-      .data        = std::move(result),
-      .lod0_width  = width_,
-      .lod0_height = height_,
-      .mip_levels  = mip_levels,
-      .bpp         = bpp_,
-  };
 }
 
 }  // namespace eray::res
@@ -2,14 +2,23 @@
 
 #include <cmath>
 #include <cstdint>
+#include <cstddef>
 #include <filesystem>
+#include <functional>
 #include <liberay/res/error.hpp>
 #include <liberay/util/memory_region.hpp>
 #include <liberay/util/result.hpp>
 #include <liberay/util/ruleof.hpp>
+#include <liberay/util/task.hpp>
+#include <memory>
 #include <span>
 #include <vector>
 
+namespace eray::util {
+class JobSystem;
+class JobCounter;
+}  // namespace eray::util
+
 namespace eray::res {
 
 using ColorU32         = uint32_t;
@@ -57,8 +66,85 @@ class Color {
 struct MipMappedImage;
 
 /**
- * @brief Represents an image with alpha channel (4 bytes per pixel). The pixel format is R8 G8 B8 A8. The data is
- * stored in RAM.
+ * @brief Color space of the RGB channels, the alpha channel is always linear. Only the 8-bit formats may be sRGB, the
+ * other ones are always linear.
+ *
+ */
+enum class ColorSpace : uint8_t {
+  Linear = 0,
+  Srgb   = 1,
+};
+
+/**
+ * @brief Pixel format of an `Image`. The channels are stored in the R G B A order, the 16-bit and 32-bit channels in
+ * the native byte order.
+ *
+ */
+enum class PixelFormat : uint8_t {
+  R8      = 0,
+  RG8     = 1,
+  RGBA8   = 2,
+  R16     = 3,
+  RGBA16F = 4,
+  RGBA32F = 5,
+};
+
+constexpr uint32_t channel_count(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::R8:
+    case PixelFormat::R16:
+      return 1;
+    case PixelFormat::RG8:
+      return 2;
+    case PixelFormat::RGBA8:
+    case PixelFormat::RGBA16F:
+    case PixelFormat::RGBA32F:
+      return 4;
+  }
+  return 0;
+}
+
+constexpr uint32_t bytes_per_pixel(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::R8:
+      return 1;
+    case PixelFormat::RG8:
+    case PixelFormat::R16:
+      return 2;
+    case PixelFormat::RGBA8:
+      return 4;
+    case PixelFormat::RGBA16F:
+      return 8;
+    case PixelFormat::RGBA32F:
+      return 16;
+  }
+  return 0;
+}
+
+constexpr bool is_float_format(PixelFormat format) {
+  return format == PixelFormat::RGBA16F || format == PixelFormat::RGBA32F;
+}
+
+struct ImageLoadOptions {
+  /**
+   * @brief Keeps the channels of the file: the grayscale images are loaded as `R8` (`R16` if the file is 16-bit), the
+   * grayscale images with alpha as `RG8`. Otherwise, and for the RGB images, the pixels are expanded to `RGBA8`.
+   *
+   */
+  bool native_channels = true;
+
+  /**
+   * @brief Format of the HDR files (Radiance `.hdr`), `RGBA16F` or `RGBA32F`. The pixels are linear.
+   *
+   */
+  PixelFormat hdr_format = PixelFormat::RGBA16F;
+};
+
+/**
+ * @brief Represents an image in RAM, R8, RG8, RGBA8 (the default), R16, RGBA16F or RGBA32F. The `ColorU32` accessors
+ * (e.g. `pixel()`, `set_pixel()`) are available for the RGBA8 images only.
+ *
+ * The loaded images keep the buffer decoded by stb_image, the copies share it until one of them is modified.
  *
  */
 class Image {
@@ -66,10 +152,67 @@ class Image {
   ERAY_DEFAULT_MOVE_AND_COPY_CTOR(Image)
   ERAY_DEFAULT_MOVE_AND_COPY_ASSIGN(Image)
 
+  using LoadCallback = std::move_only_function<void(size_t index, util::Result<Image, FileError>&& image)>;
+
   static Image create(uint32_t width, uint32_t height, ColorU32 color = Color::kBlack);
-  static Image create(uint32_t width, uint32_t height, uint8_t bpp, std::vector<ColorU32>&& data);
+  static Image create(uint32_t width, uint32_t height, std::vector<ColorU32>&& data);
+
+  /**
+   * @brief Creates an image of any format.
+   *
+   * @param width
+   * @param height
+   * @param format
+   * @param data Exactly `width * height * bytes_per_pixel(format)` bytes.
+   * @return Image
+   */
+  static Image create(uint32_t width, uint32_t height, PixelFormat format, std::vector<std::byte>&& data);
+
+  /**
+   * @brief Decodes the file into an image. Thread-safe.
+   *
+   */
+  static util::Result<Image, FileError> load_from_path(const std::filesystem::path& path,
+                                                       const ImageLoadOptions& options = {});
+
+  /**
+   * @brief Decodes the files in parallel, one job per file, and waits for all of them. The calling thread decodes
+   * the files in the meantime.
+   *
+   * @param jobs
+   * @param paths
+   * @param options
+   * @return std::vector<util::Result<Image, FileError>> Result for every path, in the order of `paths`.
+   */
+  static std::vector<util::Result<Image, FileError>> load_many(util::JobSystem& jobs,
+                                                               std::span<const std::filesystem::path> paths,
+                                                               const ImageLoadOptions& options = {});
 
-  static util::Result<Image, FileError> load_from_path(const std::filesystem::path& path);
+  /**
+   * @brief Queues one decoding job per file and returns immediately. Wait for the `counter` with
+   * `JobSystem::wait()` before the callback is destroyed.
+   *
+   * @param jobs
+   * @param paths Copied, may be destroyed after the call.
+   * @param on_loaded Invoked as `on_loaded(i, image)` for `paths[i]` on the worker that decoded it, so concurrently.
+   * @param counter Counts the pending files.
+   * @param options
+   */
+  static void load_many_async(util::JobSystem& jobs, std::span<const std::filesystem::path> paths,
+                              LoadCallback&& on_loaded, util::JobCounter& counter,
+                              const ImageLoadOptions& options = {});
+
+  /**
+   * @brief Decodes the file on a worker of the `jobs` without blocking the awaiting coroutine's thread. The awaiting
+   * coroutine is resumed on the worker.
+   *
+   * @param jobs
+   * @param path
+   * @param options
+   * @return util::Task<util::Result<Image, FileError>>
+   */
+  static util::Task<util::Result<Image, FileError>> load_async(util::JobSystem& jobs, std::filesystem::path path,
+                                                               ImageLoadOptions options = {});
 
   bool is_in_bounds(uint32_t x, uint32_t y) const;
   void set_pixel(uint32_t x, uint32_t y, ColorU32 color);
@@ -80,17 +223,25 @@ class Image {
 
   uint32_t width() const { return width_; }
   uint32_t height() const { return height_; }
-  size_t size_bytes() const { return width_ * height_ * sizeof(uint32_t); }
+  PixelFormat format() const { return format_; }
+  uint32_t bytes_per_pixel() const { return res::bytes_per_pixel(format_); }
+  size_t size_bytes() const { return static_cast<size_t>(width_) * height_ * bytes_per_pixel(); }
 
-  const ColorU32* raw() const { return data_.data(); }
-  const ColorComponentU8* raw_bytes() const { return reinterpret_cast<const ColorComponentU8*>(data_.data()); }
+  /**
+   * @brief Pixels of an RGBA8 image.
+   *
+   */
+  const ColorU32* raw() const { return reinterpret_cast<const ColorU32*>(rgba8_bytes()); }
+  const ColorComponentU8* raw_bytes() const { return reinterpret_cast<const ColorComponentU8*>(bytes()); }
 
-  std::span<const ColorU32> data() const { return data_; }
-  std::span<const ColorComponentU8> data_bytes() const {
-    return std::span{reinterpret_cast<const ColorComponentU8*>(data_.data()), size_bytes()};
-  }
+  /**
+   * @brief Pixels of an RGBA8 image.
+   *
+   */
+  std::span<const ColorU32> data() const { return std::span{raw(), static_cast<size_t>(width_) * height_}; }
+  std::span<const ColorComponentU8> data_bytes() const { return std::span{raw_bytes(), size_bytes()}; }
 
-  util::MemoryRegion memory_region() const { return util::MemoryRegion(data_.data(), size_bytes()); }
+  util::MemoryRegion memory_region() const { return util::MemoryRegion(bytes(), size_bytes()); }
 
   /**
    * @brief Calculates the number of mip levels basing on height and width of the image.
@@ -103,31 +254,67 @@ class Image {
   /**
    * @brief CPU-sided mipmaps generation. Returns a buffer of packed images with LOD ranging 0 to mip levels - 1.
    *
+   * Power-of-two images are downsampled with a 2x2 box filter, averaged in linear space if `color_space` is sRGB. The
+   * other images are resized with a triangle filter. The `color_space` is ignored for the formats that are not 8-bit.
+   *
    */
-  MipMappedImage generate_mipmaps_buffer() const;
+  MipMappedImage generate_mipmaps_buffer(ColorSpace color_space = ColorSpace::Linear) const;
+
+  /**
+   * @brief `generate_mipmaps_buffer()` with the large levels split across the jobs.
+   *
+   */
+  MipMappedImage generate_mipmaps_buffer(util::JobSystem& jobs, ColorSpace color_space = ColorSpace::Linear) const;
+
+  /**
+   * @brief Writes the packed mip chain (see `generate_mipmaps_buffer()`) to `out`, e.g. straight to a mapped staging
+   * buffer.
+   *
+   * @param out Exactly `mip_chain_size_bytes()` bytes.
+   * @param color_space
+   * @param jobs Splits the large RGBA8 levels across the jobs if provided.
+   */
+  void generate_mipmaps_into(std::span<std::byte> out, ColorSpace color_space = ColorSpace::Linear,
+                             util::JobSystem* jobs = nullptr) const;
+
+  /**
+   * @brief Number of the pixels of all of the mip levels.
+   *
+   */
+  size_t mip_chain_size() const;
+  size_t mip_chain_size_bytes() const { return mip_chain_size() * bytes_per_pixel(); }
 
  private:
   Image();
   Image(uint32_t width, uint32_t height, ColorU32 color = Color::kBlack);
-  Image(uint32_t width, uint32_t height, uint8_t bpp, std::vector<ColorU32>&& data);
+  Image(uint32_t width, uint32_t height, PixelFormat format, std::vector<std::byte>&& data);
+  Image(uint32_t width, uint32_t height, PixelFormat format, std::shared_ptr<const std::byte[]>&& decoded);
+
+  const std::byte* bytes() const { return decoded_ ? decoded_.get() : data_.data(); }
+  const std::byte* rgba8_bytes() const;
+
+  /**
+   * @brief Copies the shared decoded pixels to `data_` before the first write. Asserts the RGBA8 format, the writes
+   * take `ColorU32`.
+   *
+   */
+  ColorU32* writable_pixels();
 
   uint32_t width_;
   uint32_t height_;
-  uint8_t bpp_ = 4;
-
-  std::vector<ColorU32> data_;
+  PixelFormat format_ = PixelFormat::RGBA8;
+  std::vector<std::byte> data_;
+  std::shared_ptr<const std::byte[]> decoded_;
 };
 
 struct MipMappedImage {
-  std::vector<ColorU32> data;
+  std::vector<std::byte> data;
   uint32_t lod0_width;
   uint32_t lod0_height;
   uint32_t mip_levels;
-  uint8_t bpp = 4;
+  PixelFormat format = PixelFormat::RGBA8;
 
-  size_t size() const { return data.size(); }
-  size_t size_bytes() const { return data.size() * sizeof(uint32_t); }
-  const ColorU32* raw() const { return data.data(); }
+  size_t size_bytes() const { return data.size(); }
   const ColorComponentU8* raw_bytes() const { return reinterpret_cast<const ColorComponentU8*>(data.data()); }
   util::MemoryRegion memory_region() const { return util::MemoryRegion{data.data(), size_bytes()}; }
 };
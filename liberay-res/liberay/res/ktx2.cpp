@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <expected>
+#include <liberay/res/error.hpp>
+#include <liberay/res/ktx2.hpp>
+#include <liberay/res/mapped_file.hpp>
+#include <liberay/util/logger.hpp>
+
+namespace eray::res {
+
+namespace {
+
+constexpr auto kIdentifier = std::array<uint8_t, 12>{0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// Identifier, 9 header fields, the index of the data format descriptor, key/value data and supercompression data
+constexpr auto kLevelIndexOffset = size_t{80};
+constexpr auto kLevelIndexStride = size_t{24};
+
+/**
+ * @brief Reads a little endian integer, the bounds are checked by the caller.
+ *
+ */
+template <typename T>
+T read(std::span<const std::byte> bytes, size_t offset) {
+  auto result = T{};
+  for (auto i = 0U; i < sizeof(T); ++i) {
+    result |= static_cast<T>(std::to_integer<uint8_t>(bytes[offset + i])) << (8 * i);
+  }
+  return result;
+}
+
+std::unexpected<FileError> invalid_file(const std::filesystem::path& path, const char* msg) {
+  util::Logger::err(R"(Could not load the KTX2 texture "{}": {})", path.string(), msg);
+  return std::unexpected(FileError{
+      .path = path,
+      .msg  = msg,
+      .code = FileErrorCode::IncorrectFormat,
+  });
+}
+
+}  // namespace
+
+util::Result<Ktx2Texture, FileError> Ktx2Texture::load_from_path(const std::filesystem::path& path) {
+  auto file = MappedFile::open(path);
+  if (!file) {
+    return std::unexpected(file.error());
+  }
+
+  const auto bytes = file->bytes();
+  if (bytes.size() < kLevelIndexOffset || std::memcmp(bytes.data(), kIdentifier.data(), kIdentifier.size()) != 0) {
+    return invalid_file(path, "Not a KTX2 file");
+  }
+
+  const auto vk_format               = read<uint32_t>(bytes, 12);
+  const auto width                   = read<uint32_t>(bytes, 20);
+  const auto height                  = read<uint32_t>(bytes, 24);
+  const auto depth                   = read<uint32_t>(bytes, 28);
+  const auto layer_count             = read<uint32_t>(bytes, 32);
+  const auto face_count              = read<uint32_t>(bytes, 36);
+  const auto level_count             = read<uint32_t>(bytes, 40);
+  const auto supercompression_scheme = read<uint32_t>(bytes, 44);
+
+  if (vk_format == 0) {
+    return invalid_file(path, "Basis Universal textures must be transcoded, which is not supported");
+  }
+  if (supercompression_scheme != 0) {
+    return invalid_file(path, "Supercompressed textures are not supported");
+  }
+  if (width == 0 || (face_count != 1 && face_count != 6)) {
+    return invalid_file(path, "Invalid texture dimensions");
+  }
+
+  // Level count 0 asks for the mipmaps to be generated at load time, only LOD0 is stored then
+  const auto stored_levels = std::max(level_count, 1U);
+  if (bytes.size() < kLevelIndexOffset + stored_levels * kLevelIndexStride) {
+    return invalid_file(path, "Truncated level index");
+  }
+
+  auto texture         = Ktx2Texture(std::move(*file));
+  texture.vk_format_   = vk_format;
+  texture.width_       = width;
+  texture.height_      = std::max(height, 1U);
+  texture.depth_       = std::max(depth, 1U);
+  texture.layer_count_ = std::max(layer_count, 1U);
+  texture.face_count_  = face_count;
+  texture.levels_.reserve(stored_levels);
+
+  const auto file_bytes = texture.file_.bytes();
+  auto begin            = file_bytes.size();
+  auto end              = size_t{0};
+  for (auto level = 0U; level < stored_levels; ++level) {
+    const auto entry  = kLevelIndexOffset + level * kLevelIndexStride;
+    const auto offset = read<uint64_t>(file_bytes, entry);
+    const auto size   = read<uint64_t>(file_bytes, entry + 8);
+    if (size == 0 || offset > file_bytes.size() || size > file_bytes.size() - offset) {
+      return invalid_file(path, "Mip level is out of the file bounds");
+    }
+
+    texture.levels_.push_back(Level{.offset = offset, .size_bytes = size});
+    begin = std::min(begin, static_cast<size_t>(offset));
+    end   = std::max(end, static_cast<size_t>(offset + size));
+  }
+
+  texture.levels_begin_ = begin;
+  texture.levels_end_   = end;
+  texture.level_offsets_.reserve(stored_levels);
+  for (const auto& level : texture.levels_) {
+    texture.level_offsets_.push_back(level.offset - begin);
+  }
+
+  return texture;
+}
+
+}  // namespace eray::res
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <liberay/res/error.hpp>
+#include <liberay/res/mapped_file.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/result.hpp>
+#include <span>
+#include <vector>
+
+namespace eray::res {
+
+/**
+ * @brief Texture stored in a KTX2 container, usually block compressed (BCn, ETC2, ASTC) with a precomputed mip chain.
+ * The file is mapped into memory and the levels are read in place, ready to be uploaded verbatim.
+ *
+ * The format is a `VkFormat` value. Basis Universal payloads (BasisLZ, UASTC) and the supercompressed files (Zstd,
+ * zlib) are rejected, they need a transcoder. Ship one file per block compression family instead, and pick the one
+ * supported by the device.
+ *
+ */
+class Ktx2Texture {
+ public:
+  struct Level {
+    uint64_t offset;
+    uint64_t size_bytes;
+  };
+
+  static util::Result<Ktx2Texture, FileError> load_from_path(const std::filesystem::path& path);
+
+  /**
+   * @brief `VkFormat` of the texel data, never `VK_FORMAT_UNDEFINED`.
+   *
+   */
+  uint32_t vk_format() const { return vk_format_; }
+
+  uint32_t width() const { return width_; }
+  uint32_t height() const { return height_; }
+  uint32_t depth() const { return depth_; }
+
+  /**
+   * @brief Number of the array layers, 1 if the texture is not an array.
+   *
+   */
+  uint32_t layer_count() const { return layer_count_; }
+
+  /**
+   * @brief 6 for cube maps, 1 otherwise. The faces of a level are stored as consecutive layers.
+   *
+   */
+  uint32_t face_count() const { return face_count_; }
+
+  uint32_t mip_levels() const { return static_cast<uint32_t>(levels_.size()); }
+
+  /**
+   * @brief Texel data of all of the layers and faces of the mip level `level`.
+   *
+   */
+  std::span<const std::byte> level_data(uint32_t level) const {
+    return file_.bytes().subspan(levels_[level].offset, levels_[level].size_bytes);
+  }
+
+  /**
+   * @brief Contiguous part of the file that holds every mip level. KTX2 stores the smallest level first, see
+   * `level_offsets()`.
+   *
+   */
+  util::MemoryRegion levels_region() const {
+    return util::MemoryRegion(file_.bytes().data() + levels_begin_, levels_end_ - levels_begin_);
+  }
+
+  /**
+   * @brief Offset of every mip level (LOD0 first) relative to `levels_region()`.
+   *
+   */
+  std::span<const uint64_t> level_offsets() const { return level_offsets_; }
+
+ private:
+  explicit Ktx2Texture(MappedFile&& file) : file_(std::move(file)) {}
+
+  MappedFile file_;
+  uint32_t vk_format_   = 0;
+  uint32_t width_       = 0;
+  uint32_t height_      = 0;
+  uint32_t depth_       = 1;
+  uint32_t layer_count_ = 1;
+  uint32_t face_count_  = 1;
+  std::vector<Level> levels_;
+  std::vector<uint64_t> level_offsets_;
+  uint64_t levels_begin_ = 0;
+  uint64_t levels_end_   = 0;
+};
+
+}  // namespace eray::res
@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <expected>
+#include <liberay/res/error.hpp>
+#include <liberay/res/file.hpp>
+#include <liberay/res/mapped_file.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/platform.hpp>
+#include <limits>
+#include <utility>
+
+#ifdef IS_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace eray::res {
+
+namespace {
+
+std::unexpected<FileError> map_failure(const std::filesystem::path& path, const char* msg) {
+  util::Logger::err(R"(Could not map the file "{}": {})", path.string(), msg);
+  return std::unexpected(FileError{
+      .path = path,
+      .msg  = msg,
+      .code = FileErrorCode::ReadFailure,
+  });
+}
+
+}  // namespace
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    unmap();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() { unmap(); }
+
+util::Result<MappedFile, FileError> MappedFile::open(const std::filesystem::path& path,
+                                                     std::span<const char*> extensions) {
+  if (auto result = validate_file(path, extensions); !result) {
+    return std::unexpected(result.error());
+  }
+
+  // The view keeps the mapping alive, so the handles are closed right after mapping
+#ifdef IS_WINDOWS
+  auto* file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return map_failure(path, "CreateFileW failed");
+  }
+
+  auto size = LARGE_INTEGER{};
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return map_failure(path, "GetFileSizeEx failed");
+  }
+  if (size.QuadPart == 0) {
+    CloseHandle(file);
+    return MappedFile(nullptr, 0);
+  }
+  if (static_cast<uint64_t>(size.QuadPart) > std::numeric_limits<size_t>::max()) {
+    CloseHandle(file);
+    return std::unexpected(FileError{
+        .path = path,
+        .msg  = "File does not fit in the address space",
+        .code = FileErrorCode::FileTooLarge,
+    });
+  }
+
+  auto* mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return map_failure(path, "CreateFileMappingW failed");
+  }
+
+  auto* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (view == nullptr) {
+    return map_failure(path, "MapViewOfFile failed");
+  }
+
+  return MappedFile(static_cast<const std::byte*>(view), static_cast<size_t>(size.QuadPart));
+#else
+  const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return map_failure(path, "open failed");
+  }
+
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    return map_failure(path, "fstat failed");
+  }
+  if (info.st_size == 0) {
+    ::close(fd);
+    return MappedFile(nullptr, 0);
+  }
+  if (static_cast<uint64_t>(info.st_size) > std::numeric_limits<size_t>::max()) {
+    ::close(fd);
+    return std::unexpected(FileError{
+        .path = path,
+        .msg  = "File does not fit in the address space",
+        .code = FileErrorCode::FileTooLarge,
+    });
+  }
+
+  const auto size = static_cast<size_t>(info.st_size);
+  auto* view      = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    return map_failure(path, "mmap failed");
+  }
+
+  return MappedFile(static_cast<const std::byte*>(view), size);
+#endif
+}
+
+void MappedFile::unmap() {
+  if (data_ == nullptr) {
+    return;
+  }
+
+#ifdef IS_WINDOWS
+  UnmapViewOfFile(data_);
+#else
+  ::munmap(const_cast<std::byte*>(data_), size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace eray::res
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <liberay/res/error.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/result.hpp>
+#include <liberay/util/ruleof.hpp>
+#include <span>
+#include <string_view>
+
+namespace eray::res {
+
+/**
+ * @brief Read-only view of a whole file mapped into memory (`mmap` or `MapViewOfFile`). The pages are served from
+ * the page cache on the first access, the contents are never copied to the heap. The view is page aligned.
+ *
+ * @warning The file must not be truncated while it is mapped, on POSIX systems reading the lost pages raises SIGBUS.
+ *
+ */
+class MappedFile {
+ public:
+  ERAY_DELETE_COPY(MappedFile)
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  /**
+   * @brief Maps the whole file. An empty file results in an empty view.
+   *
+   * @param path
+   * @param extensions Checked by `validate_file()`.
+   * @return util::Result<MappedFile, FileError>
+   */
+  static util::Result<MappedFile, FileError> open(const std::filesystem::path& path,
+                                                  std::span<const char*> extensions = {});
+
+  std::span<const std::byte> bytes() const { return std::span{data_, size_}; }
+  std::string_view as_string_view() const { return std::string_view(reinterpret_cast<const char*>(data_), size_); }
+  size_t size_bytes() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  util::MemoryRegion memory_region() const { return util::MemoryRegion(data_, size_); }
+
+ private:
+  MappedFile(const std::byte* data, size_t size) : data_(data), size_(size) {}
+
+  void unmap();
+
+  const std::byte* data_ = nullptr;
+  size_t size_           = 0;
+};
+
+}  // namespace eray::res
@@ -0,0 +1,335 @@
+#include <meshoptimizer.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/res/error.hpp>
+#include <liberay/res/file.hpp>
+#include <liberay/res/mesh.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/try.hpp>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace eray::res {
+
+namespace {
+
+/**
+ * @brief Bumped whenever the mesh processing changes its output, so the stale meshes miss the cache.
+ *
+ */
+constexpr auto kMeshProcessingVersion = uint32_t{1};
+
+constexpr size_t kSectionAlignment = 16;
+
+size_t align_up(size_t value) { return (value + kSectionAlignment - 1) & ~(kSectionAlignment - 1); }
+
+uint64_t mesh_params_hash(const MeshImportOptions& options) {
+  const auto params = std::array<uint32_t, 9>{
+      kMeshProcessingVersion,
+      options.lod_count,
+      std::bit_cast<uint32_t>(options.lod_index_ratio),
+      std::bit_cast<uint32_t>(options.lod_max_error),
+      std::bit_cast<uint32_t>(options.overdraw_threshold),
+      options.build_meshlets ? 1U : 0U,
+      options.meshlet_max_vertices,
+      options.meshlet_max_triangles,
+      std::bit_cast<uint32_t>(options.meshlet_cone_weight),
+  };
+  return content_hash(std::as_bytes(std::span(params)));
+}
+
+static_assert(offsetof(MeshVertex, position) == 0);
+
+const float* positions(const std::vector<MeshVertex>& vertices) {
+  return reinterpret_cast<const float*>(vertices.data());
+}
+
+/**
+ * @brief Appends the meshlets of the level, the offsets are made relative to the whole mesh.
+ *
+ */
+void build_meshlets(MeshData& mesh, MeshLod& lod, const MeshImportOptions& options) {
+  const auto indices = std::span(mesh.indices).subspan(lod.first_index, lod.index_count);
+
+  const auto max_meshlets =
+      meshopt_buildMeshletsBound(indices.size(), options.meshlet_max_vertices, options.meshlet_max_triangles);
+  auto meshlets          = std::vector<meshopt_Meshlet>(max_meshlets);
+  auto meshlet_vertices  = std::vector<uint32_t>(max_meshlets * options.meshlet_max_vertices);
+  auto meshlet_triangles = std::vector<uint8_t>(max_meshlets * options.meshlet_max_triangles * 3);
+  meshlets.resize(meshopt_buildMeshlets(meshlets.data(), meshlet_vertices.data(), meshlet_triangles.data(),
+                                        indices.data(), indices.size(), positions(mesh.vertices),
+                                        mesh.vertices.size(), sizeof(MeshVertex), options.meshlet_max_vertices,
+                                        options.meshlet_max_triangles, options.meshlet_cone_weight));
+
+  lod.first_meshlet = static_cast<uint32_t>(mesh.meshlets.size());
+  lod.meshlet_count = static_cast<uint32_t>(meshlets.size());
+
+  const auto vertex_base   = static_cast<uint32_t>(mesh.meshlet_vertices.size());
+  const auto triangle_base = static_cast<uint32_t>(mesh.meshlet_triangles.size());
+  for (const auto& meshlet : meshlets) {
+    meshopt_optimizeMeshlet(&meshlet_vertices[meshlet.vertex_offset], &meshlet_triangles[meshlet.triangle_offset],
+                            meshlet.triangle_count, meshlet.vertex_count);
+    const auto bounds = meshopt_computeMeshletBounds(
+        &meshlet_vertices[meshlet.vertex_offset], &meshlet_triangles[meshlet.triangle_offset], meshlet.triangle_count,
+        positions(mesh.vertices), mesh.vertices.size(), sizeof(MeshVertex));
+
+    mesh.meshlets.push_back(Meshlet{
+        .vertex_offset   = vertex_base + meshlet.vertex_offset,
+        .triangle_offset = triangle_base + meshlet.triangle_offset,
+        .vertex_count    = meshlet.vertex_count,
+        .triangle_count  = meshlet.triangle_count,
+        .center          = {bounds.center[0], bounds.center[1], bounds.center[2]},
+        .radius          = bounds.radius,
+        .cone_apex       = {bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]},
+        .cone_axis       = {bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]},
+        .cone_cutoff     = bounds.cone_cutoff,
+        .padding         = 0,
+    });
+  }
+
+  // The triangles of every meshlet are padded to 4 bytes
+  if (!meshlets.empty()) {
+    const auto& last = meshlets.back();
+    meshlet_vertices.resize(last.vertex_offset + last.vertex_count);
+    meshlet_triangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3U));
+  }
+  mesh.meshlet_vertices.insert(mesh.meshlet_vertices.end(), meshlet_vertices.begin(), meshlet_vertices.end());
+  mesh.meshlet_triangles.insert(mesh.meshlet_triangles.end(), meshlet_triangles.begin(), meshlet_triangles.end());
+}
+
+}  // namespace
+
+util::Result<MeshData, FileError> MeshData::import_from_path(const std::filesystem::path& path,
+                                                             const MeshImportOptions& options) {
+  TRY(validate_file(path));
+
+  // The hierarchy is flattened, the meshes are merged in the world space. The vertices are welded by meshoptimizer.
+  auto importer     = Assimp::Importer();
+  const auto* scene = importer.ReadFile(path.string(), aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+                                                           aiProcess_PreTransformVertices | aiProcess_SortByPType);
+  if (scene == nullptr || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) != 0 || scene->mNumMeshes == 0) {
+    util::Logger::err(R"(Could not import the mesh "{}": {})", path.string(), importer.GetErrorString());
+    return std::unexpected(FileError{
+        .path = path,
+        .msg  = std::string(importer.GetErrorString()),
+        .code = FileErrorCode::IncorrectFormat,
+    });
+  }
+
+  auto vertices = std::vector<MeshVertex>();
+  auto indices  = std::vector<uint32_t>();
+  for (auto i = 0U; i < scene->mNumMeshes; ++i) {
+    const auto* mesh = scene->mMeshes[i];
+    if ((mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0) {
+      continue;
+    }
+
+    const auto base = static_cast<uint32_t>(vertices.size());
+    for (auto v = 0U; v < mesh->mNumVertices; ++v) {
+      const auto& p = mesh->mVertices[v];
+      const auto n  = mesh->HasNormals() ? mesh->mNormals[v] : aiVector3D(0.F, 0.F, 1.F);
+      const auto uv = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][v] : aiVector3D(0.F, 0.F, 0.F);
+      vertices.push_back(MeshVertex{
+          .position = math::Vec3f(p.x, p.y, p.z),
+          .normal   = math::oct_encode(math::normalize(math::Vec3f(n.x, n.y, n.z))),
+          .uv       = math::Half2::from_vec(math::Vec2f(uv.x, uv.y)),
+      });
+    }
+    for (auto f = 0U; f < mesh->mNumFaces; ++f) {
+      const auto& face = mesh->mFaces[f];
+      if (face.mNumIndices == 3) {
+        indices.insert(indices.end(), {base + face.mIndices[0], base + face.mIndices[1], base + face.mIndices[2]});
+      }
+    }
+  }
+
+  if (indices.empty()) {
+    util::Logger::err(R"(Could not import the mesh "{}": the file has no triangles)", path.string());
+    return std::unexpected(FileError{
+        .path = path,
+        .msg  = "Mesh file has no triangles",
+        .code = FileErrorCode::IncorrectFormat,
+    });
+  }
+
+  return create(vertices, indices, options);
+}
+
+MeshData MeshData::create(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices,
+                          const MeshImportOptions& options) {
+  auto result = MeshData{};
+
+  // == Weld the duplicated vertices ===================================================================================
+  auto remap              = std::vector<uint32_t>(vertices.size());
+  const auto vertex_count = meshopt_generateVertexRemap(remap.data(), indices.data(), indices.size(), vertices.data(),
+                                                        vertices.size(), sizeof(MeshVertex));
+  auto welded             = std::vector<MeshVertex>(vertex_count);
+  auto lod0               = std::vector<uint32_t>(indices.size());
+  meshopt_remapVertexBuffer(welded.data(), vertices.data(), vertices.size(), sizeof(MeshVertex), remap.data());
+  meshopt_remapIndexBuffer(lod0.data(), indices.data(), indices.size(), remap.data());
+
+  // == Optimize the LOD0 for the vertex cache and the overdraw ========================================================
+  meshopt_optimizeVertexCache(lod0.data(), lod0.data(), lod0.size(), vertex_count);
+  if (options.overdraw_threshold > 1.F) {
+    meshopt_optimizeOverdraw(lod0.data(), lod0.data(), lod0.size(), positions(welded), vertex_count,
+                             sizeof(MeshVertex), options.overdraw_threshold);
+  }
+  result.indices = lod0;
+  result.lods.push_back(MeshLod{
+      .first_index   = 0,
+      .index_count   = static_cast<uint32_t>(lod0.size()),
+      .first_meshlet = 0,
+      .meshlet_count = 0,
+      .error         = 0.F,
+  });
+
+  // == Simplify the LOD chain, every level from the previous one ======================================================
+  const auto scale = meshopt_simplifyScale(positions(welded), vertex_count, sizeof(MeshVertex));
+  auto previous    = std::move(lod0);
+  auto lod         = std::vector<uint32_t>(previous.size());
+  auto error       = 0.F;
+  while (result.lods.size() < options.lod_count) {
+    const auto target = static_cast<size_t>(static_cast<float>(previous.size() / 3) * options.lod_index_ratio) * 3;
+    auto lod_error    = 0.F;
+    lod.resize(meshopt_simplify(lod.data(), previous.data(), previous.size(), positions(welded), vertex_count,
+                                sizeof(MeshVertex), target, options.lod_max_error, 0, &lod_error));
+
+    // The errors are measured against the previous level, so they add up
+    if (lod.empty() || static_cast<float>(lod.size()) > static_cast<float>(previous.size()) * 0.9F) {
+      break;
+    }
+    meshopt_optimizeVertexCache(lod.data(), lod.data(), lod.size(), vertex_count);
+    error += lod_error * scale;
+
+    result.lods.push_back(MeshLod{
+        .first_index   = static_cast<uint32_t>(result.indices.size()),
+        .index_count   = static_cast<uint32_t>(lod.size()),
+        .first_meshlet = 0,
+        .meshlet_count = 0,
+        .error         = error,
+    });
+    result.indices.insert(result.indices.end(), lod.begin(), lod.end());
+    std::swap(previous, lod);
+    lod.resize(previous.size());
+  }
+
+  // == Order the vertices by the first use, the LOD0 first ============================================================
+  result.vertices.resize(vertex_count);
+  result.vertices.resize(meshopt_optimizeVertexFetch(result.vertices.data(), result.indices.data(),
+                                                     result.indices.size(), welded.data(), vertex_count,
+                                                     sizeof(MeshVertex)));
+
+  if (options.build_meshlets) {
+    for (auto& level : result.lods) {
+      build_meshlets(result, level, options);
+    }
+  }
+
+  result.bounds_min = math::Vec3f::filled(std::numeric_limits<float>::max());
+  result.bounds_max = math::Vec3f::filled(std::numeric_limits<float>::lowest());
+  for (const auto& vertex : result.vertices) {
+    result.bounds_min = math::min(result.bounds_min, vertex.position);
+    result.bounds_max = math::max(result.bounds_max, vertex.position);
+  }
+
+  return result;
+}
+
+MeshAssetMetadata MeshData::metadata() const {
+  return MeshAssetMetadata{
+      .vertex_stride          = sizeof(MeshVertex),
+      .vertex_count           = static_cast<uint32_t>(vertices.size()),
+      .index_count            = static_cast<uint32_t>(indices.size()),
+      .lod_count              = static_cast<uint32_t>(lods.size()),
+      .meshlet_count          = static_cast<uint32_t>(meshlets.size()),
+      .meshlet_vertex_count   = static_cast<uint32_t>(meshlet_vertices.size()),
+      .meshlet_triangle_bytes = static_cast<uint32_t>(meshlet_triangles.size()),
+      .reserved               = 0,
+      .bounds_min             = {bounds_min.x(), bounds_min.y(), bounds_min.z()},
+      .bounds_max             = {bounds_max.x(), bounds_max.y(), bounds_max.z()},
+  };
+}
+
+std::vector<std::byte> MeshData::to_bytes() const {
+  const auto offsets = MeshAsset::layout(metadata());
+
+  auto bytes       = std::vector<std::byte>(offsets.end);
+  auto write_range = [&bytes](size_t offset, const auto& range) {
+    std::memcpy(bytes.data() + offset, range.data(), range.size() * sizeof(*range.data()));
+  };
+  write_range(offsets.vertices, vertices);
+  write_range(offsets.indices, indices);
+  write_range(offsets.lods, lods);
+  write_range(offsets.meshlets, meshlets);
+  write_range(offsets.meshlet_vertices, meshlet_vertices);
+  write_range(offsets.meshlet_triangles, meshlet_triangles);
+
+  return bytes;
+}
+
+MeshAsset::Offsets MeshAsset::layout(const MeshAssetMetadata& metadata) {
+  auto offsets              = Offsets{};
+  offsets.vertices          = 0;
+  offsets.indices           = align_up(offsets.vertices + size_t{metadata.vertex_count} * sizeof(MeshVertex));
+  offsets.lods              = align_up(offsets.indices + size_t{metadata.index_count} * sizeof(uint32_t));
+  offsets.meshlets          = align_up(offsets.lods + size_t{metadata.lod_count} * sizeof(MeshLod));
+  offsets.meshlet_vertices  = align_up(offsets.meshlets + size_t{metadata.meshlet_count} * sizeof(Meshlet));
+  offsets.meshlet_triangles = align_up(offsets.meshlet_vertices + size_t{metadata.meshlet_vertex_count} * 4);
+  offsets.end               = offsets.meshlet_triangles + metadata.meshlet_triangle_bytes;
+  return offsets;
+}
+
+util::Result<MeshAsset, FileError> MeshAsset::from_cached(CachedAsset&& asset) {
+  const auto metadata = asset.metadata<MeshAssetMetadata>();
+  if (asset.kind() != AssetKind::Mesh || metadata.vertex_stride != sizeof(MeshVertex) ||
+      asset.payload().size() != layout(metadata).end) {
+    util::Logger::err("Could not load a cached mesh. The asset layout does not match the mesh format");
+    return std::unexpected(FileError{
+        .path = {},
+        .msg  = "Cached asset is not a mesh",
+        .code = FileErrorCode::IncorrectFormat,
+    });
+  }
+
+  return MeshAsset(std::move(asset), metadata);
+}
+
+util::Result<void, FileError> MeshAsset::store(const AssetCache& cache, const AssetKey& key, const MeshData& mesh) {
+  const auto metadata = mesh.metadata();
+  return cache.store(key, AssetKind::Mesh, std::as_bytes(std::span(&metadata, 1)), mesh.to_bytes());
+}
+
+util::Result<MeshAsset, FileError> MeshAsset::load(const AssetCache& cache, const std::filesystem::path& path,
+                                                   const MeshImportOptions& options) {
+  TRY_UNWRAP_DEFINE(key, AssetKey::from_file(path, mesh_params_hash(options)));
+  if (auto cached = cache.find(key, AssetKind::Mesh)) {
+    return from_cached(std::move(*cached));
+  }
+
+  TRY_UNWRAP_DEFINE(mesh, MeshData::import_from_path(path, options));
+  TRY(store(cache, key, mesh));
+  util::Logger::info(R"(Cached the optimized mesh "{}" ({} vertices, {} LODs, {} meshlets))", path.string(),
+                     mesh.vertices.size(), mesh.lods.size(), mesh.meshlets.size());
+
+  if (auto cached = cache.find(key, AssetKind::Mesh)) {
+    return from_cached(std::move(*cached));
+  }
+  return std::unexpected(FileError{
+      .path = cache.asset_path(key, AssetKind::Mesh),
+      .msg  = "Could not read back the cached asset",
+      .code = FileErrorCode::ReadFailure,
+  });
+}
+
+}  // namespace eray::res
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <liberay/math/packed.hpp>
+#include <liberay/math/vec.hpp>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/res/error.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/result.hpp>
+#include <span>
+#include <vector>
+
+namespace eray::res {
+
+/**
+ * @brief Vertex of the imported meshes, 20 bytes. The normal is octahedral encoded (see `math::oct_encode()`), e.g.
+ * `vertex_attribute<math::Snorm16x2>(1, offsetof(res::MeshVertex, normal))` in vkren.
+ *
+ */
+struct MeshVertex {
+  math::Vec3f position;
+  math::Snorm16x2 normal;
+  math::Half2 uv;
+};
+
+static_assert(sizeof(MeshVertex) == 20);
+
+/**
+ * @brief Level of detail of a mesh. All of the levels share the vertices, the indices of a level are a range of the
+ * index buffer.
+ *
+ */
+struct MeshLod {
+  uint32_t first_index;
+  uint32_t index_count;
+  uint32_t first_meshlet;
+  uint32_t meshlet_count;
+
+  /**
+   * @brief Object space deviation from the LOD0 surface, 0 for the LOD0.
+   *
+   */
+  float error;
+};
+
+/**
+ * @brief Cluster of at most `MeshImportOptions::meshlet_max_triangles` triangles. The triangles index the
+ * `meshlet_vertices()` of the meshlet, which index the vertices of the mesh.
+ *
+ */
+struct Meshlet {
+  uint32_t vertex_offset;
+  uint32_t triangle_offset;
+  uint32_t vertex_count;
+  uint32_t triangle_count;
+
+  /**
+   * @brief Bounding sphere.
+   *
+   */
+  std::array<float, 3> center;
+  float radius;
+
+  /**
+   * @brief Normal cone, the meshlet is back facing when `dot(normalize(cone_apex - eye), cone_axis) >= cone_cutoff`.
+   *
+   */
+  std::array<float, 3> cone_apex;
+  std::array<float, 3> cone_axis;
+  float cone_cutoff;
+  uint32_t padding;
+};
+
+static_assert(sizeof(Meshlet) == 64);
+
+struct MeshImportOptions {
+  /**
+   * @brief Number of the levels of detail including the LOD0, 1 disables the simplification. The chain ends earlier
+   * once the simplification cannot reduce the mesh anymore.
+   *
+   */
+  uint32_t lod_count = 4;
+
+  /**
+   * @brief Target index count of a level relative to the previous one.
+   *
+   */
+  float lod_index_ratio = 0.5F;
+
+  /**
+   * @brief Maximum deviation of a level, relative to the mesh extents.
+   *
+   */
+  float lod_max_error = 0.02F;
+
+  /**
+   * @brief How much worse the vertex cache efficiency may get for the sake of the overdraw, 1 disables the overdraw
+   * optimization.
+   *
+   */
+  float overdraw_threshold = 1.05F;
+
+  bool build_meshlets = true;
+
+  /**
+   * @brief The defaults fit the NVIDIA and AMD mesh shader recommendations. At most 255 vertices and 512 triangles, the
+   * triangles must be divisible by 4.
+   *
+   */
+  uint32_t meshlet_max_vertices  = 64;
+  uint32_t meshlet_max_triangles = 124;
+
+  /**
+   * @brief Between 0 and 1, trades the spatial compactness of the meshlets for the tighter normal cones.
+   *
+   */
+  float meshlet_cone_weight = 0.25F;
+};
+
+/**
+ * @brief Metadata of the `AssetKind::Mesh` assets, see `MeshAsset`.
+ *
+ */
+struct MeshAssetMetadata {
+  uint32_t vertex_stride;
+  uint32_t vertex_count;
+  uint32_t index_count;
+  uint32_t lod_count;
+  uint32_t meshlet_count;
+  uint32_t meshlet_vertex_count;
+  uint32_t meshlet_triangle_bytes;
+  uint32_t reserved;
+  std::array<float, 3> bounds_min;
+  std::array<float, 3> bounds_max;
+};
+
+/**
+ * @brief Optimized mesh in RAM, the output of the import.
+ *
+ * The import merges every triangle mesh of the file in the world space, then runs meshoptimizer: deduplicates the
+ * vertices, reorders the triangles for the post-transform vertex cache and the overdraw, simplifies the LOD chain,
+ * reorders the vertices in the order of the first use by the indices and builds the meshlets of every level.
+ *
+ */
+struct MeshData {
+  std::vector<MeshVertex> vertices;
+
+  /**
+   * @brief Indices of all of the levels, LOD0 first.
+   *
+   */
+  std::vector<uint32_t> indices;
+  std::vector<MeshLod> lods;
+
+  std::vector<Meshlet> meshlets;
+  std::vector<uint32_t> meshlet_vertices;
+  std::vector<uint8_t> meshlet_triangles;
+
+  math::Vec3f bounds_min;
+  math::Vec3f bounds_max;
+
+  /**
+   * @brief Imports the file with assimp (glTF and OBJ are enabled) and optimizes it. Thread-safe.
+   *
+   */
+  static util::Result<MeshData, FileError> import_from_path(const std::filesystem::path& path,
+                                                            const MeshImportOptions& options = {});
+
+  /**
+   * @brief Optimizes the indexed triangle list, e.g. a procedural mesh. The duplicated vertices are welded.
+   *
+   * @param vertices
+   * @param indices Triangle list, a multiple of 3.
+   * @param options
+   * @return MeshData
+   */
+  static MeshData create(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices,
+                         const MeshImportOptions& options = {});
+
+  MeshAssetMetadata metadata() const;
+
+  /**
+   * @brief Payload of the `AssetKind::Mesh` asset, see `MeshAsset`.
+   *
+   */
+  std::vector<std::byte> to_bytes() const;
+};
+
+/**
+ * @brief Mesh read from the asset cache. The payload holds the vertices and the indices back to back, followed by the
+ * levels of detail and the meshlets (each section 16-byte aligned):
+ *
+ *   MeshVertex[vertex_count] | uint32_t[index_count] | MeshLod[lod_count] | Meshlet[meshlet_count] |
+ *   uint32_t[meshlet_vertex_count] | uint8_t[meshlet_triangle_bytes]
+ *
+ * The vertices and the indices are the `GeometryArena` layout, so a mesh is loaded with a single mapping of the file
+ * and uploaded as it is: `arena.allocate(vertex_count(), index_count())` then
+ * `arena.upload(uploader, handle, vertices_region(), indices_region())`. The LOD `i` is drawn with the `first_index`
+ * of `lods()[i]` added to the first index of the allocation.
+ *
+ */
+class MeshAsset {
+ public:
+  /**
+   * @brief Returns the cached mesh of the file. On a miss the file is imported and optimized, and the result is stored
+   * first.
+   *
+   * @param cache
+   * @param path Source mesh.
+   * @param options Part of the key, a change of the options imports the file again.
+   * @return util::Result<MeshAsset, FileError>
+   */
+  static util::Result<MeshAsset, FileError> load(const AssetCache& cache, const std::filesystem::path& path,
+                                                 const MeshImportOptions& options = {});
+
+  /**
+   * @brief Validates the layout of the `AssetKind::Mesh` asset.
+   *
+   */
+  static util::Result<MeshAsset, FileError> from_cached(CachedAsset&& asset);
+
+  static util::Result<void, FileError> store(const AssetCache& cache, const AssetKey& key, const MeshData& mesh);
+
+  uint32_t vertex_count() const { return metadata_.vertex_count; }
+  uint32_t index_count() const { return metadata_.index_count; }
+  const MeshAssetMetadata& metadata() const { return metadata_; }
+
+  math::Vec3f bounds_min() const {
+    return math::Vec3f(metadata_.bounds_min[0], metadata_.bounds_min[1], metadata_.bounds_min[2]);
+  }
+  math::Vec3f bounds_max() const {
+    return math::Vec3f(metadata_.bounds_max[0], metadata_.bounds_max[1], metadata_.bounds_max[2]);
+  }
+
+  util::MemoryRegion vertices_region() const { return region(offsets_.vertices, vertex_count() * sizeof(MeshVertex)); }
+  util::MemoryRegion indices_region() const { return region(offsets_.indices, index_count() * sizeof(uint32_t)); }
+
+  std::span<const MeshLod> lods() const { return section<MeshLod>(offsets_.lods, metadata_.lod_count); }
+  std::span<const Meshlet> meshlets() const { return section<Meshlet>(offsets_.meshlets, metadata_.meshlet_count); }
+  std::span<const uint32_t> meshlet_vertices() const {
+    return section<uint32_t>(offsets_.meshlet_vertices, metadata_.meshlet_vertex_count);
+  }
+  std::span<const uint8_t> meshlet_triangles() const {
+    return section<uint8_t>(offsets_.meshlet_triangles, metadata_.meshlet_triangle_bytes);
+  }
+
+ private:
+  struct Offsets {
+    size_t vertices;
+    size_t indices;
+    size_t lods;
+    size_t meshlets;
+    size_t meshlet_vertices;
+    size_t meshlet_triangles;
+    size_t end;
+  };
+
+  friend struct MeshData;
+
+  static Offsets layout(const MeshAssetMetadata& metadata);
+
+  MeshAsset(CachedAsset&& asset, const MeshAssetMetadata& metadata)
+      : asset_(std::move(asset)), metadata_(metadata), offsets_(layout(metadata)) {}
+
+  util::MemoryRegion region(size_t offset, size_t size_bytes) const {
+    return util::MemoryRegion(asset_.payload().data() + offset, size_bytes);
+  }
+
+  /**
+   * @brief The payload is 64-byte aligned and the sections are 16-byte aligned, so they are read in place.
+   *
+   */
+  template <typename T>
+  std::span<const T> section(size_t offset, size_t count) const {
+    return std::span(reinterpret_cast<const T*>(asset_.payload().data() + offset), count);
+  }
+
+  CachedAsset asset_;
+  MeshAssetMetadata metadata_;
+  Offsets offsets_;
+};
+
+}  // namespace eray::res
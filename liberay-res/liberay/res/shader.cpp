@@ -1,11 +1,46 @@
+#include <cstring>
 #include <expected>
+#include <fstream>
 #include <liberay/res/error.hpp>
 #include <liberay/res/file.hpp>
 #include <liberay/res/shader.hpp>
 
 namespace eray::res {
 
+namespace {
+
+util::Result<void, FileError> validate_spirv_size(const std::filesystem::path& path, size_t bytes) {
+  if (bytes % 4 != 0) {
+    eray::util::Logger::err("SPIR-V file size {} is not a multiple of 4", bytes);
+    return std::unexpected(FileError{
+        .path = path,
+        .msg  = "Invalid SPIR-V file size",
+        .code = FileErrorCode::IncorrectFormat,
+    });
+  }
+  return {};
+}
+
+}  // namespace
+
 util::Result<SPIRVShaderBinary, FileError> SPIRVShaderBinary::load_from_path(const std::filesystem::path& path) {
+  auto file = MappedFile::open(path);
+  if (!file) {
+    return std::unexpected(file.error());
+  }
+
+  if (auto result = validate_spirv_size(path, file->size_bytes()); !result) {
+    return std::unexpected(result.error());
+  }
+
+  eray::util::Logger::info("Mapped {} bytes from {}", file->size_bytes(), path.string());
+
+  return SPIRVShaderBinary(Members{
+      .storage = std::move(*file),
+  });
+}
+
+util::Result<SPIRVShaderBinary, FileError> SPIRVShaderBinary::read_from_path(const std::filesystem::path& path) {
   if (auto result = validate_file(path); !result) {
     return std::unexpected(result.error());
   }
@@ -21,13 +56,8 @@ util::Result<SPIRVShaderBinary, FileError> SPIRVShaderBinary::load_from_path(con
   }
 
   auto bytes = static_cast<size_t>(file.tellg());
-  if (bytes % 4 != 0) {
-    eray::util::Logger::err("SPIR-V file size {} is not a multiple of 4", bytes);
-    return std::unexpected(FileError{
-        .path = path,
-        .msg  = "Invalid SPIR-V file size",
-        .code = FileErrorCode::IncorrectFormat,
-    });
+  if (auto result = validate_spirv_size(path, bytes); !result) {
+    return std::unexpected(result.error());
   }
 
   auto buffer = std::vector<char>(bytes);
@@ -41,7 +71,20 @@ util::Result<SPIRVShaderBinary, FileError> SPIRVShaderBinary::load_from_path(con
   eray::util::Logger::info("Read {} bytes from {}", bytes, path.string());
 
   return SPIRVShaderBinary(Members{
-      .data_bytes = buffer,
+      .storage = std::move(buffer),
+  });
+}
+
+util::Result<SPIRVShaderBinary, FileError> SPIRVShaderBinary::from_bytes(std::span<const std::byte> bytes) {
+  if (auto result = validate_spirv_size({}, bytes.size()); !result) {
+    return std::unexpected(result.error());
+  }
+
+  auto buffer = std::vector<char>(bytes.size());
+  std::memcpy(buffer.data(), bytes.data(), bytes.size());
+
+  return SPIRVShaderBinary(Members{
+      .storage = std::move(buffer),
   });
 }
 
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <liberay/res/error.hpp>
+#include <liberay/res/mapped_file.hpp>
 #include <liberay/util/result.hpp>
 #include <span>
+#include <variant>
+#include <vector>
 
 namespace eray::res {
 
@@ -14,18 +18,42 @@ namespace eray::res {
 struct SPIRVShaderBinary {
   SPIRVShaderBinary() = delete;
 
+  /**
+   * @brief Maps the file into memory, the code is read straight from the page cache.
+   *
+   */
   static util::Result<SPIRVShaderBinary, FileError> load_from_path(const std::filesystem::path& path);
 
-  size_t size_bytes() const { return m_.data_bytes.size(); }
-  std::span<const char> data_bytes() const { return m_.data_bytes; }
+  /**
+   * @brief Copies the file to the heap. Use it for the files that might be rewritten while the binary is alive (hot
+   * reloading), a mapped file must not be truncated.
+   *
+   */
+  static util::Result<SPIRVShaderBinary, FileError> read_from_path(const std::filesystem::path& path);
+
+  /**
+   * @brief Copies the code to the heap, e.g. the payload of a cached asset.
+   *
+   */
+  static util::Result<SPIRVShaderBinary, FileError> from_bytes(std::span<const std::byte> bytes);
+
+  size_t size_bytes() const { return data_bytes().size(); }
+  std::span<const char> data_bytes() const {
+    if (const auto* mapped = std::get_if<MappedFile>(&m_.storage)) {
+      const auto view = mapped->as_string_view();
+      return std::span{view.data(), view.size()};
+    }
+    return std::get<std::vector<char>>(m_.storage);
+  }
   std::span<const uint32_t> data() const {
-    // std::vector default allocator asserts that std::byte array is aligned (the worst case alignment is satisfied)
-    return std::span{reinterpret_cast<const uint32_t*>(m_.data_bytes.data()), m_.data_bytes.size() / sizeof(uint32_t)};
+    // Both the mapped view (page aligned) and the std::vector allocation (the worst case alignment) are aligned
+    const auto bytes = data_bytes();
+    return std::span{reinterpret_cast<const uint32_t*>(bytes.data()), bytes.size() / sizeof(uint32_t)};
   }
 
  private:
   struct Members {
-    std::vector<char> data_bytes;
+    std::variant<MappedFile, std::vector<char>> storage;
   } m_;
   explicit SPIRVShaderBinary(Members&& m) : m_(std::move(m)) {}
 };
@@ -0,0 +1,479 @@
+#include <algorithm>
+#include <expected>
+#include <format>
+#include <iterator>
+#include <liberay/res/shader_reflection.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace eray::res {
+
+namespace {
+
+// The subset of the SPIR-V specification needed to find the descriptor bindings and the push constants
+namespace spv {
+
+constexpr uint32_t kMagicNumber    = 0x07230203;
+constexpr uint32_t kHeaderWords    = 5;
+constexpr uint32_t kVersion14      = 0x00010400;
+constexpr uint32_t kOpCodeMask     = 0xFFFF;
+constexpr uint32_t kWordCountShift = 16;
+
+enum Op : uint16_t {
+  OpName                         = 5,
+  OpEntryPoint                   = 15,
+  OpTypeBool                     = 20,
+  OpTypeInt                      = 21,
+  OpTypeFloat                    = 22,
+  OpTypeVector                   = 23,
+  OpTypeMatrix                   = 24,
+  OpTypeImage                    = 25,
+  OpTypeSampler                  = 26,
+  OpTypeSampledImage             = 27,
+  OpTypeArray                    = 28,
+  OpTypeRuntimeArray             = 29,
+  OpTypeStruct                   = 30,
+  OpTypePointer                  = 32,
+  OpConstant                     = 43,
+  OpVariable                     = 59,
+  OpDecorate                     = 71,
+  OpMemberDecorate               = 72,
+  OpTypeAccelerationStructureKHR = 5341,
+};
+
+enum Decoration : uint32_t {
+  Block         = 2,
+  BufferBlock   = 3,
+  ArrayStride   = 6,
+  Binding       = 33,
+  DescriptorSet = 34,
+  Offset        = 35,
+};
+
+enum StorageClass : uint32_t {
+  UniformConstant = 0,
+  Uniform         = 2,
+  PushConstant    = 9,
+  StorageBuffer   = 12,
+};
+
+enum Dim : uint32_t {
+  DimBuffer      = 5,
+  DimSubpassData = 6,
+};
+
+std::optional<ShaderStage> execution_model_stage(uint32_t execution_model) {
+  switch (execution_model) {
+    case 0:
+      return ShaderStage::Vertex;
+    case 1:
+      return ShaderStage::TessellationControl;
+    case 2:
+      return ShaderStage::TessellationEvaluation;
+    case 3:
+      return ShaderStage::Geometry;
+    case 4:
+      return ShaderStage::Fragment;
+    case 5:
+      return ShaderStage::Compute;
+    case 5364:
+      return ShaderStage::Task;
+    case 5365:
+      return ShaderStage::Mesh;
+    default:
+      return std::nullopt;
+  }
+}
+
+}  // namespace spv
+
+struct TypeInfo {
+  uint16_t op = 0;
+
+  /**
+   * @brief Operands of the type instruction, without the result id.
+   *
+   */
+  std::span<const uint32_t> operands;
+};
+
+struct IdDecorations {
+  std::optional<uint32_t> set;
+  std::optional<uint32_t> binding;
+  std::optional<uint32_t> array_stride;
+  bool block        = false;
+  bool buffer_block = false;
+};
+
+struct Variable {
+  uint32_t id;
+  uint32_t pointer_type;
+  uint32_t storage_class;
+};
+
+std::string read_string(std::span<const uint32_t> words) {
+  auto result = std::string();
+  for (auto word : words) {
+    for (auto i = 0U; i < 4; ++i) {
+      const auto c = static_cast<char>((word >> (i * 8)) & 0xFF);
+      if (c == '\0') {
+        return result;
+      }
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+
+size_t string_word_count(std::span<const uint32_t> words) {
+  for (auto i = 0U; i < words.size(); ++i) {
+    if ((words[i] >> 24) == 0) {
+      return i + 1;
+    }
+  }
+  return words.size();
+}
+
+class Module {
+ public:
+  explicit Module(std::span<const uint32_t> words) : words_(words) {}
+
+  util::Result<ShaderReflection, SPIRVReflectionError> reflect();
+
+ private:
+  util::Result<void, SPIRVReflectionError> parse();
+  uint32_t size_of(uint32_t type_id) const;
+  std::optional<ShaderResourceBinding> binding_of(const Variable& variable) const;
+
+  std::span<const uint32_t> words_;
+  uint32_t version_ = 0;
+
+  std::unordered_map<uint32_t, TypeInfo> types_;
+  std::unordered_map<uint32_t, uint32_t> constants_;
+  std::unordered_map<uint32_t, IdDecorations> decorations_;
+  std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> member_offsets_;
+  std::unordered_map<uint32_t, std::string> names_;
+  std::unordered_map<uint32_t, ShaderStageFlags> variable_stages_;
+  std::vector<ShaderEntryPoint> entry_points_;
+  std::vector<Variable> variables_;
+};
+
+util::Result<void, SPIRVReflectionError> Module::parse() {
+  if (words_.size() < spv::kHeaderWords || words_[0] != spv::kMagicNumber) {
+    return std::unexpected(SPIRVReflectionError{.msg = "Not a SPIR-V module"});
+  }
+  version_ = words_[1];
+
+  auto offset = static_cast<size_t>(spv::kHeaderWords);
+  while (offset < words_.size()) {
+    const auto word_count = words_[offset] >> spv::kWordCountShift;
+    const auto op         = static_cast<uint16_t>(words_[offset] & spv::kOpCodeMask);
+    if (word_count == 0 || offset + word_count > words_.size()) {
+      return std::unexpected(SPIRVReflectionError{.msg = "Malformed SPIR-V instruction"});
+    }
+    const auto operands = words_.subspan(offset + 1, word_count - 1);
+    offset += word_count;
+
+    switch (op) {
+      case spv::OpName:
+        names_[operands[0]] = read_string(operands.subspan(1));
+        break;
+      case spv::OpEntryPoint: {
+        auto stage = spv::execution_model_stage(operands[0]);
+        if (!stage) {
+          break;
+        }
+        const auto name_words = operands.subspan(2);
+        entry_points_.push_back(ShaderEntryPoint{.name = read_string(name_words), .stage = *stage});
+        for (auto id : name_words.subspan(string_word_count(name_words))) {
+          variable_stages_[id] |= *stage;
+        }
+        break;
+      }
+      case spv::OpTypeBool:
+      case spv::OpTypeInt:
+      case spv::OpTypeFloat:
+      case spv::OpTypeVector:
+      case spv::OpTypeMatrix:
+      case spv::OpTypeImage:
+      case spv::OpTypeSampler:
+      case spv::OpTypeSampledImage:
+      case spv::OpTypeArray:
+      case spv::OpTypeRuntimeArray:
+      case spv::OpTypeStruct:
+      case spv::OpTypePointer:
+      case spv::OpTypeAccelerationStructureKHR:
+        types_[operands[0]] = TypeInfo{.op = op, .operands = operands.subspan(1)};
+        break;
+      case spv::OpConstant:
+        // Only the 32-bit constants are used as the array lengths
+        constants_[operands[1]] = operands[2];
+        break;
+      case spv::OpVariable:
+        variables_.push_back(Variable{.id = operands[1], .pointer_type = operands[0], .storage_class = operands[2]});
+        break;
+      case spv::OpDecorate: {
+        auto& decorations = decorations_[operands[0]];
+        switch (operands[1]) {
+          case spv::DescriptorSet:
+            decorations.set = operands[2];
+            break;
+          case spv::Binding:
+            decorations.binding = operands[2];
+            break;
+          case spv::ArrayStride:
+            decorations.array_stride = operands[2];
+            break;
+          case spv::Block:
+            decorations.block = true;
+            break;
+          case spv::BufferBlock:
+            decorations.buffer_block = true;
+            break;
+          default:
+            break;
+        }
+        break;
+      }
+      case spv::OpMemberDecorate:
+        if (operands[2] == spv::Offset) {
+          member_offsets_[operands[0]][operands[1]] = operands[3];
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  return {};
+}
+
+uint32_t Module::size_of(uint32_t type_id) const {
+  auto it = types_.find(type_id);
+  if (it == types_.end()) {
+    return 0;
+  }
+
+  const auto& type = it->second;
+  switch (type.op) {
+    case spv::OpTypeBool:
+      return 4;
+    case spv::OpTypeInt:
+    case spv::OpTypeFloat:
+      return type.operands[0] / 8;
+    case spv::OpTypeVector:
+      return size_of(type.operands[0]) * type.operands[1];
+    case spv::OpTypeMatrix:
+      return size_of(type.operands[0]) * type.operands[1];
+    case spv::OpTypeArray: {
+      const auto length = constants_.contains(type.operands[1]) ? constants_.at(type.operands[1]) : 0;
+      auto decorations  = decorations_.find(type_id);
+      auto stride       = decorations != decorations_.end() && decorations->second.array_stride
+                              ? *decorations->second.array_stride
+                              : size_of(type.operands[0]);
+      return stride * length;
+    }
+    case spv::OpTypeStruct: {
+      auto size    = 0U;
+      auto offsets = member_offsets_.find(type_id);
+      for (auto i = 0U; i < type.operands.size(); ++i) {
+        auto member_offset = 0U;
+        if (offsets != member_offsets_.end() && offsets->second.contains(i)) {
+          member_offset = offsets->second.at(i);
+        }
+        size = std::max(size, member_offset + size_of(type.operands[i]));
+      }
+      return size;
+    }
+    default:
+      return 0;
+  }
+}
+
+std::optional<ShaderResourceBinding> Module::binding_of(const Variable& variable) const {
+  auto decorations = decorations_.find(variable.id);
+  if (decorations == decorations_.end() || !decorations->second.set || !decorations->second.binding) {
+    return std::nullopt;
+  }
+
+  auto pointer = types_.find(variable.pointer_type);
+  if (pointer == types_.end() || pointer->second.op != spv::OpTypePointer) {
+    return std::nullopt;
+  }
+
+  // Peel the arrays of the resources
+  auto count   = 1U;
+  auto type_id = pointer->second.operands[1];
+  auto type    = types_.find(type_id);
+  while (type != types_.end() && (type->second.op == spv::OpTypeArray || type->second.op == spv::OpTypeRuntimeArray)) {
+    if (type->second.op == spv::OpTypeRuntimeArray) {
+      count = 0;
+    } else if (auto length = constants_.find(type->second.operands[1]); length != constants_.end()) {
+      count *= length->second;
+    }
+    type_id = type->second.operands[0];
+    type    = types_.find(type_id);
+  }
+  if (type == types_.end()) {
+    return std::nullopt;
+  }
+
+  auto resource_type = std::optional<ShaderResourceType>();
+  switch (type->second.op) {
+    case spv::OpTypeSampler:
+      resource_type = ShaderResourceType::Sampler;
+      break;
+    case spv::OpTypeSampledImage:
+      resource_type = ShaderResourceType::CombinedImageSampler;
+      break;
+    case spv::OpTypeImage: {
+      // Operands: sampled type, dim, depth, arrayed, multisampled, sampled, format
+      const auto dim     = type->second.operands[1];
+      const auto sampled = type->second.operands[5];
+      if (dim == spv::DimBuffer) {
+        resource_type = sampled == 1 ? ShaderResourceType::UniformTexelBuffer : ShaderResourceType::StorageTexelBuffer;
+      } else if (dim == spv::DimSubpassData) {
+        resource_type = ShaderResourceType::InputAttachment;
+      } else {
+        resource_type = sampled == 1 ? ShaderResourceType::SampledImage : ShaderResourceType::StorageImage;
+      }
+      break;
+    }
+    case spv::OpTypeAccelerationStructureKHR:
+      resource_type = ShaderResourceType::AccelerationStructure;
+      break;
+    case spv::OpTypeStruct: {
+      if (variable.storage_class == spv::StorageBuffer) {
+        resource_type = ShaderResourceType::StorageBuffer;
+        break;
+      }
+      auto struct_decorations = decorations_.find(type_id);
+      if (struct_decorations != decorations_.end() && struct_decorations->second.buffer_block) {
+        resource_type = ShaderResourceType::StorageBuffer;
+      } else {
+        resource_type = ShaderResourceType::UniformBuffer;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  if (!resource_type) {
+    return std::nullopt;
+  }
+
+  auto name = std::string();
+  if (auto it = names_.find(variable.id); it != names_.end()) {
+    name = it->second;
+  }
+
+  return ShaderResourceBinding{
+      .set     = *decorations->second.set,
+      .binding = *decorations->second.binding,
+      .type    = *resource_type,
+      .count   = count,
+      .stages  = {},
+      .name    = std::move(name),
+  };
+}
+
+util::Result<ShaderReflection, SPIRVReflectionError> Module::reflect() {
+  if (auto result = parse(); !result) {
+    return std::unexpected(result.error());
+  }
+
+  auto reflection         = ShaderReflection{};
+  reflection.entry_points = entry_points_;
+
+  const auto all_stages = reflection.stages();
+  auto stages_of        = [&](uint32_t variable_id) {
+    // Before SPIR-V 1.4 the interfaces list only the inputs and outputs
+    if (version_ < spv::kVersion14) {
+      return all_stages;
+    }
+    auto it = variable_stages_.find(variable_id);
+    return it == variable_stages_.end() ? ShaderStageFlags{} : it->second;
+  };
+
+  for (const auto& variable : variables_) {
+    if (variable.storage_class == spv::PushConstant) {
+      auto pointer = types_.find(variable.pointer_type);
+      if (pointer != types_.end() && stages_of(variable.id) != ShaderStageFlags{}) {
+        reflection.push_constant_size_bytes =
+            std::max(reflection.push_constant_size_bytes, size_of(pointer->second.operands[1]));
+        reflection.push_constant_stages |= stages_of(variable.id);
+      }
+      continue;
+    }
+
+    if (variable.storage_class != spv::UniformConstant && variable.storage_class != spv::Uniform &&
+        variable.storage_class != spv::StorageBuffer) {
+      continue;
+    }
+
+    if (auto binding = binding_of(variable)) {
+      binding->stages = stages_of(variable.id);
+      if (binding->stages == ShaderStageFlags{}) {
+        // Declared, but not used by any of the entry points
+        continue;
+      }
+      reflection.bindings.push_back(std::move(*binding));
+    }
+  }
+
+  std::ranges::sort(reflection.bindings, [](const auto& a, const auto& b) {
+    return a.set == b.set ? a.binding < b.binding : a.set < b.set;
+  });
+
+  return reflection;
+}
+
+}  // namespace
+
+ShaderStageFlags ShaderReflection::stages() const {
+  auto result = ShaderStageFlags{};
+  for (const auto& entry_point : entry_points) {
+    result |= entry_point.stage;
+  }
+  return result;
+}
+
+util::Result<ShaderReflection, SPIRVReflectionError> ShaderReflection::reflect(
+    std::span<const uint32_t> spirv_bytecode) {
+  return Module(spirv_bytecode).reflect();
+}
+
+util::Result<ShaderReflection, SPIRVReflectionError> ShaderReflection::merge(
+    std::span<const ShaderReflection> reflections) {
+  auto result = ShaderReflection{};
+  for (const auto& reflection : reflections) {
+    std::ranges::copy(reflection.entry_points, std::back_inserter(result.entry_points));
+    result.push_constant_size_bytes = std::max(result.push_constant_size_bytes, reflection.push_constant_size_bytes);
+    result.push_constant_stages |= reflection.push_constant_stages;
+
+    for (const auto& binding : reflection.bindings) {
+      auto it = std::ranges::find_if(result.bindings, [&binding](const auto& b) {
+        return b.set == binding.set && b.binding == binding.binding;
+      });
+      if (it == result.bindings.end()) {
+        result.bindings.push_back(binding);
+        continue;
+      }
+      if (it->type != binding.type || it->count != binding.count) {
+        return std::unexpected(SPIRVReflectionError{
+            .msg = std::format("Conflicting resources at set {} binding {}", binding.set, binding.binding),
+        });
+      }
+      it->stages |= binding.stages;
+    }
+  }
+
+  std::ranges::sort(result.bindings, [](const auto& a, const auto& b) {
+    return a.set == b.set ? a.binding < b.binding : a.set < b.set;
+  });
+
+  return result;
+}
+
+}  // namespace eray::res
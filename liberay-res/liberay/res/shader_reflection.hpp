@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/res/shader.hpp>
+#include <liberay/util/flags.hpp>
+#include <liberay/util/result.hpp>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace eray::res {
+
+/**
+ * @brief Shader stages. The bits match the VkShaderStageFlagBits, so the flags can be casted directly.
+ *
+ */
+enum class ShaderStage : uint32_t {
+  None                   = 0,
+  Vertex                 = 0x01,
+  TessellationControl    = 0x02,
+  TessellationEvaluation = 0x04,
+  Geometry               = 0x08,
+  Fragment               = 0x10,
+  Compute                = 0x20,
+  Task                   = 0x40,
+  Mesh                   = 0x80,
+};
+
+using ShaderStageFlags = util::Flags<ShaderStage>;
+
+/**
+ * @brief Kinds of the shader resources bound with the descriptors. The values match the VkDescriptorType.
+ *
+ */
+enum class ShaderResourceType : uint32_t {
+  Sampler               = 0,
+  CombinedImageSampler  = 1,
+  SampledImage          = 2,
+  StorageImage          = 3,
+  UniformTexelBuffer    = 4,
+  StorageTexelBuffer    = 5,
+  UniformBuffer         = 6,
+  StorageBuffer         = 7,
+  InputAttachment       = 10,
+  AccelerationStructure = 1000150000,
+};
+
+struct ShaderResourceBinding {
+  uint32_t set;
+  uint32_t binding;
+  ShaderResourceType type;
+
+  /**
+   * @brief Number of the array elements, 1 for non-arrays and 0 for the runtime sized arrays.
+   *
+   */
+  uint32_t count;
+  ShaderStageFlags stages;
+  std::string name;
+};
+
+struct ShaderEntryPoint {
+  std::string name;
+  ShaderStage stage;
+};
+
+struct SPIRVReflectionError {
+  std::string msg;
+};
+
+/**
+ * @brief Descriptor bindings, push constants and entry points of a SPIR-V module.
+ *
+ * When the module is SPIR-V 1.4 or newer, the entry point interfaces list every global variable used by the entry
+ * point, so the stages of a binding are the stages that actually use it. For the older modules every binding is
+ * assumed to be used by all of the entry points.
+ *
+ */
+struct ShaderReflection {
+  std::vector<ShaderEntryPoint> entry_points;
+
+  /**
+   * @brief Sorted by the set and binding numbers.
+   *
+   */
+  std::vector<ShaderResourceBinding> bindings;
+
+  /**
+   * @brief Size of the push constant block, 0 if there is none.
+   *
+   */
+  uint32_t push_constant_size_bytes = 0;
+  ShaderStageFlags push_constant_stages;
+
+  ShaderStageFlags stages() const;
+
+  /**
+   * @brief Number of the descriptor sets, i.e. the highest set number plus one.
+   *
+   */
+  uint32_t set_count() const { return bindings.empty() ? 0 : bindings.back().set + 1; }
+
+  /**
+   * @brief Parses the module.
+   *
+   * @param spirv_bytecode
+   * @return util::Result<ShaderReflection, SPIRVReflectionError>
+   */
+  static util::Result<ShaderReflection, SPIRVReflectionError> reflect(std::span<const uint32_t> spirv_bytecode);
+  static util::Result<ShaderReflection, SPIRVReflectionError> reflect(const SPIRVShaderBinary& spirv) {
+    return reflect(spirv.data());
+  }
+
+  /**
+   * @brief Merges the reflections of the modules linked into a single pipeline, e.g. a vertex and a fragment shader
+   * module. The stages of the bindings shared by the modules are combined.
+   *
+   * @param reflections
+   * @return util::Result<ShaderReflection, SPIRVReflectionError> Fails when the modules declare different resources at
+   * the same binding.
+   */
+  static util::Result<ShaderReflection, SPIRVReflectionError> merge(std::span<const ShaderReflection> reflections);
+};
+
+}  // namespace eray::res
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/res/error.hpp>
+#include <liberay/res/shader.hpp>
+#include <liberay/res/slang_compiler.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/try.hpp>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef ERAY_SLANGC_EXECUTABLE
+#define ERAY_SLANGC_EXECUTABLE "slangc"
+#endif
+
+namespace eray::res {
+
+namespace {
+
+/**
+ * @brief Bumped whenever the compiler arguments change, so the stale binaries miss the cache.
+ *
+ */
+constexpr auto kSlangCompilerVersion = uint32_t{1};
+
+struct SlangShaderMetadata {
+  uint64_t spirv_size;
+  uint64_t dependencies_hash;
+};
+
+std::string quote(const std::string& arg) {
+#ifdef _WIN32
+  return std::format("\"{}\"", arg);
+#else
+  auto result = std::string("'");
+  for (const auto c : arg) {
+    if (c == '\'') {
+      result += R"('\'')";
+    } else {
+      result += c;
+    }
+  }
+  result += '\'';
+  return result;
+#endif
+}
+
+std::string read_text(const std::filesystem::path& path) {
+  auto file = std::ifstream(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Hash of the contents of the files, `std::nullopt` if one of them can not be read anymore.
+ *
+ */
+std::optional<uint64_t> dependencies_hash(const std::vector<std::filesystem::path>& dependencies) {
+  auto hash = uint64_t{0};
+  for (const auto& dependency : dependencies) {
+    auto key = AssetKey::from_file(dependency);
+    if (!key) {
+      return std::nullopt;
+    }
+    hash = content_hash(std::as_bytes(std::span(&key->content_hash, 1)), hash);
+  }
+  return hash;
+}
+
+/**
+ * @brief Paths of the compiler outputs, removed when the compilation ends.
+ *
+ */
+struct ScratchFiles {
+  std::filesystem::path spirv;
+  std::filesystem::path depfile;
+  std::filesystem::path log;
+
+  ScratchFiles(const ScratchFiles&)            = delete;
+  ScratchFiles& operator=(const ScratchFiles&) = delete;
+
+  explicit ScratchFiles(const std::filesystem::path& directory) {
+    // Unique per compilation, so the concurrent compilations of the same shader do not overwrite the outputs
+    static auto counter = std::atomic<uint64_t>{0};
+
+    const auto name = std::format("slang_{:x}_{}", std::hash<std::thread::id>{}(std::this_thread::get_id()),
+                                  counter.fetch_add(1, std::memory_order_relaxed));
+    spirv           = directory / (name + ".spv");
+    depfile         = directory / (name + ".d");
+    log             = directory / (name + ".log");
+  }
+
+  ~ScratchFiles() {
+    auto ec = std::error_code{};
+    std::filesystem::remove(spirv, ec);
+    std::filesystem::remove(depfile, ec);
+    std::filesystem::remove(log, ec);
+  }
+};
+
+}  // namespace
+
+std::vector<std::filesystem::path> parse_depfile(std::string_view depfile) {
+  auto result    = std::vector<std::filesystem::path>();
+  auto token     = std::string();
+  auto in_target = true;
+
+  const auto flush = [&]() {
+    if (!token.empty() && std::ranges::find(result, std::filesystem::path(token)) == result.end()) {
+      result.emplace_back(token);
+    }
+    token.clear();
+  };
+
+  for (auto i = size_t{0}; i < depfile.size(); ++i) {
+    const auto c = depfile[i];
+    if (c == '\\' && i + 1 < depfile.size()) {
+      const auto next = depfile[i + 1];
+      if (next == '\n' || (next == '\r' && i + 2 < depfile.size() && depfile[i + 2] == '\n')) {
+        // Line continuation
+        i += next == '\r' ? 2 : 1;
+        if (!in_target) {
+          flush();
+        }
+        continue;
+      }
+      if (next == ' ' || next == '#' || next == '\\') {
+        token += next;
+        ++i;
+        continue;
+      }
+    }
+    if (c == '$' && i + 1 < depfile.size() && depfile[i + 1] == '$') {
+      token += '$';
+      ++i;
+      continue;
+    }
+
+    if (in_target) {
+      // The target ends with the first colon followed by a whitespace, the drive letters are a part of the path
+      if (c == ':' && (i + 1 == depfile.size() || std::isspace(static_cast<unsigned char>(depfile[i + 1])) != 0)) {
+        token.clear();
+        in_target = false;
+      } else if (c != '\n' && c != '\r') {
+        token += c;
+      }
+      continue;
+    }
+
+    if (c == '\n') {
+      flush();
+      in_target = true;
+    } else if (c == ' ' || c == '\t' || c == '\r') {
+      flush();
+    } else {
+      token += c;
+    }
+  }
+  if (!in_target) {
+    flush();
+  }
+
+  return result;
+}
+
+std::filesystem::path SlangCompiler::default_executable() { return ERAY_SLANGC_EXECUTABLE; }
+
+SlangCompiler SlangCompiler::create(std::optional<AssetCache> cache, std::filesystem::path executable) {
+  return SlangCompiler(std::move(cache), std::move(executable));
+}
+
+util::Result<SPIRVShaderBinary, FileError> SlangCompiler::compile(const std::filesystem::path& source,
+                                                                  const SlangCompileOptions& options) const {
+  if (options.entry_points.empty()) {
+    return std::unexpected(FileError{
+        .path = source,
+        .msg  = "No shader entry points provided",
+        .code = FileErrorCode::IncorrectFormat,
+    });
+  }
+
+  TRY_UNWRAP_DEFINE(key, AssetKey::from_file(source, options_hash(source, options)));
+  if (auto cached = find_cached(key)) {
+    util::Logger::debug(R"(Loaded cached SPIR-V of shader "{}")", source.string());
+    return std::move(*cached);
+  }
+
+  const auto scratch_dir = cache_ ? cache_->directory() : std::filesystem::temp_directory_path();
+  const auto files       = ScratchFiles(scratch_dir);
+
+  auto command = std::format("{} {} -target spirv -profile spirv_1_4 -emit-spirv-directly -fvk-use-entrypoint-name",
+                             quote(executable_.string()), quote(source.string()));
+  for (const auto& entry_point : options.entry_points) {
+    command += std::format(" -entry {}", quote(entry_point));
+  }
+  for (const auto& define : options.defines) {
+    command += std::format(" {}", quote(define.value.empty() ? std::format("-D{}", define.name)
+                                                             : std::format("-D{}={}", define.name, define.value)));
+  }
+  for (const auto& include_dir : options.include_dirs) {
+    command += std::format(" -I {}", quote(include_dir.string()));
+  }
+  command += std::format(" -depfile {} -o {} > {} 2>&1", quote(files.depfile.string()), quote(files.spirv.string()),
+                         quote(files.log.string()));
+#ifdef _WIN32
+  // cmd.exe strips the outer quotes of the command
+  command = std::format("\"{}\"", command);
+#endif
+
+  util::Logger::info(R"(Compiling shader "{}")", source.string());
+  const auto status = std::system(command.c_str());  // NOLINT(cert-env33-c)
+  if (status != 0 || !std::filesystem::is_regular_file(files.spirv)) {
+    auto output = read_text(files.log);
+    while (!output.empty() && std::isspace(static_cast<unsigned char>(output.back())) != 0) {
+      output.pop_back();
+    }
+    util::Logger::err(R"(Could not compile shader "{}" (status {}): {})", source.string(), status, output);
+    return std::unexpected(FileError{
+        .path = source,
+        .msg  = output.empty() ? std::format("slangc exited with status {}", status) : std::move(output),
+        .code = FileErrorCode::IncorrectFormat,
+    });
+  }
+
+  TRY_UNWRAP_DEFINE(binary, SPIRVShaderBinary::read_from_path(files.spirv));
+  if (cache_) {
+    auto dependencies = parse_depfile(read_text(files.depfile));
+    if (std::ranges::find(dependencies, source) == dependencies.end()) {
+      dependencies.push_back(source);
+    }
+    store_cached(key, binary, dependencies);
+  }
+
+  return binary;
+}
+
+uint64_t SlangCompiler::options_hash(const std::filesystem::path& source, const SlangCompileOptions& options) const {
+  // The fields are separated with the null characters, so the moved separators do not collide
+  auto params = std::format("{}", kSlangCompilerVersion);
+  params.push_back('\0');
+  params += executable_.string();
+  params.push_back('\0');
+  params += std::filesystem::absolute(source).string();
+  for (const auto& entry_point : options.entry_points) {
+    params.push_back('\0');
+    params += entry_point;
+  }
+  params.push_back('\0');
+  for (const auto& define : options.defines) {
+    params.push_back('\0');
+    params += std::format("{}={}", define.name, define.value);
+  }
+  params.push_back('\0');
+  for (const auto& include_dir : options.include_dirs) {
+    params.push_back('\0');
+    params += std::filesystem::absolute(include_dir).string();
+  }
+  return content_hash(std::as_bytes(std::span(params)));
+}
+
+std::optional<SPIRVShaderBinary> SlangCompiler::find_cached(const AssetKey& key) const {
+  if (!cache_) {
+    return std::nullopt;
+  }
+  auto asset = cache_->find(key, AssetKind::Shader);
+  if (!asset) {
+    return std::nullopt;
+  }
+
+  // The payload is the SPIR-V followed by the paths of the dependencies, a path per line
+  const auto metadata = asset->metadata<SlangShaderMetadata>();
+  const auto payload  = asset->payload();
+  if (metadata.spirv_size > payload.size()) {
+    return std::nullopt;
+  }
+
+  const auto paths = std::string_view(reinterpret_cast<const char*>(payload.data() + metadata.spirv_size),
+                                      payload.size() - metadata.spirv_size);
+  auto dependencies = std::vector<std::filesystem::path>();
+  auto line         = std::string();
+  auto stream       = std::istringstream(std::string(paths));
+  while (std::getline(stream, line)) {
+    if (!line.empty()) {
+      dependencies.emplace_back(line);
+    }
+  }
+  if (dependencies_hash(dependencies) != metadata.dependencies_hash) {
+    return std::nullopt;
+  }
+
+  auto binary = SPIRVShaderBinary::from_bytes(payload.first(metadata.spirv_size));
+  if (!binary) {
+    return std::nullopt;
+  }
+  return std::move(*binary);
+}
+
+void SlangCompiler::store_cached(const AssetKey& key, const SPIRVShaderBinary& binary,
+                                 const std::vector<std::filesystem::path>& dependencies) const {
+  const auto hash = dependencies_hash(dependencies);
+  if (!hash) {
+    util::Logger::warn("Could not hash the dependencies of a compiled shader, the binary is not cached");
+    return;
+  }
+
+  auto payload = std::vector<std::byte>(binary.size_bytes());
+  std::memcpy(payload.data(), binary.data_bytes().data(), binary.size_bytes());
+  for (const auto& dependency : dependencies) {
+    const auto path = std::filesystem::absolute(dependency).string() + '\n';
+    const auto view = std::as_bytes(std::span(path));
+    payload.insert(payload.end(), view.begin(), view.end());
+  }
+
+  const auto metadata = SlangShaderMetadata{
+      .spirv_size        = binary.size_bytes(),
+      .dependencies_hash = *hash,
+  };
+  if (auto result = cache_->store(key, AssetKind::Shader, std::as_bytes(std::span(&metadata, 1)), payload); !result) {
+    util::Logger::warn("Could not cache the compiled shader: {}", result.error().msg);
+  }
+}
+
+}  // namespace eray::res
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/res/error.hpp>
+#include <liberay/res/shader.hpp>
+#include <liberay/util/result.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace eray::res {
+
+struct SlangDefine {
+  std::string name;
+  std::string value;
+};
+
+struct SlangCompileOptions {
+  /**
+   * @brief Entry points of the binary, all of them in a single module. Compile a shader per entry point to load only
+   * the stages a pipeline uses.
+   *
+   */
+  std::vector<std::string> entry_points;
+  std::vector<SlangDefine> defines;
+  std::vector<std::filesystem::path> include_dirs;
+};
+
+/**
+ * @brief Returns the prerequisites of the rules of a Makefile depfile (e.g. written by `slangc -depfile`), in order and
+ * without the duplicates. Handles the line continuations and the escaped spaces.
+ *
+ */
+std::vector<std::filesystem::path> parse_depfile(std::string_view depfile);
+
+/**
+ * @brief Compiles the slang shaders to SPIR-V at runtime with the `slangc` executable, with the same arguments as the
+ * `add_slang_shader_target()` CMake function. Meant for the tools and the shader permutations that are not known at
+ * build time.
+ *
+ * With an asset cache, the binaries are stored as `AssetKind::Shader` keyed by the hash of the source and the hash of
+ * the compile options. The imported modules reported by the compiler are stored with the binary and hashed again on a
+ * cache lookup, so editing an imported module compiles the shader again.
+ *
+ */
+class SlangCompiler {
+ public:
+  /**
+   * @brief Path of `slangc` found by CMake, or `slangc` to search the `PATH`.
+   *
+   */
+  static std::filesystem::path default_executable();
+
+  static SlangCompiler create(std::optional<AssetCache> cache  = std::nullopt,
+                              std::filesystem::path executable = default_executable());
+
+  /**
+   * @brief Returns the cached binary, or compiles the shader. The compiler output is logged and returned as the error
+   * message on a failure.
+   *
+   * @param source
+   * @param options
+   * @return util::Result<SPIRVShaderBinary, FileError>
+   */
+  util::Result<SPIRVShaderBinary, FileError> compile(const std::filesystem::path& source,
+                                                     const SlangCompileOptions& options) const;
+
+  const std::filesystem::path& executable() const { return executable_; }
+  const std::optional<AssetCache>& cache() const { return cache_; }
+
+ private:
+  SlangCompiler(std::optional<AssetCache> cache, std::filesystem::path executable)
+      : cache_(std::move(cache)), executable_(std::move(executable)) {}
+
+  uint64_t options_hash(const std::filesystem::path& source, const SlangCompileOptions& options) const;
+
+  std::optional<SPIRVShaderBinary> find_cached(const AssetKey& key) const;
+
+  void store_cached(const AssetKey& key, const SPIRVShaderBinary& binary,
+                    const std::vector<std::filesystem::path>& dependencies) const;
+
+  std::optional<AssetCache> cache_;
+  std::filesystem::path executable_;
+};
+
+}  // namespace eray::res
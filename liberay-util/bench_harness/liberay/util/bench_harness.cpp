@@ -0,0 +1,195 @@
+#include <benchmark/benchmark.h>
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <liberay/util/bench_harness.hpp>
+#include <liberay/util/platform.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#ifdef IS_WINDOWS
+#include <windows.h>
+#elif defined(IS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#endif
+
+namespace eray::util::bench {
+
+namespace {
+
+constexpr std::string_view kPinCpuFlag        = "--eray_pin_cpu=";
+constexpr std::string_view kJsonFlag          = "--eray_json";
+constexpr std::string_view kSkipCpuChecksFlag = "--eray_skip_cpu_checks";
+constexpr std::string_view kHelpFlag          = "--help";
+constexpr std::string_view kHarnessUsage      = R"(liberay benchmark harness flags:
+  --eray_pin_cpu=<id>      Pins the benchmark thread to the logical core.
+  --eray_json[=<path>]     Writes the JSON report, `<executable name>.json` by default.
+  --eray_skip_cpu_checks   Skips the CPU frequency scaling checks.
+)";
+
+#ifdef IS_LINUX
+std::optional<std::string> read_first_line(const std::filesystem::path& path) {
+  auto file = std::ifstream(path);
+  auto line = std::string();
+  if (!file || !std::getline(file, line)) {
+    return std::nullopt;
+  }
+  return line;
+}
+#endif
+
+}  // namespace
+
+HarnessOptions parse_harness_options(int& argc, char** argv) {
+  auto options = HarnessOptions{};
+  auto kept    = 1;
+  for (auto i = 1; i < argc; ++i) {
+    const auto arg = std::string_view(argv[i]);
+    if (arg.starts_with(kPinCpuFlag)) {
+      const auto value = arg.substr(kPinCpuFlag.size());
+      auto core_id     = uint32_t{0};
+      if (auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), core_id);
+          ec == std::errc{} && ptr == value.data() + value.size()) {
+        options.pin_cpu = core_id;
+      } else {
+        std::fprintf(stderr, "***WARNING*** Invalid core id `%s`, the benchmarks are not pinned\n", argv[i]);
+      }
+    } else if (arg == kJsonFlag) {
+      options.json_path = std::filesystem::path(argv[0]).stem().string() + ".json";
+    } else if (arg.starts_with(kJsonFlag) && arg[kJsonFlag.size()] == '=') {
+      options.json_path = std::string(arg.substr(kJsonFlag.size() + 1));
+    } else if (arg == kSkipCpuChecksFlag) {
+      options.skip_cpu_checks = true;
+    } else {
+      if (arg == kHelpFlag) {
+        std::fputs(kHarnessUsage.data(), stdout);
+      }
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+
+  return options;
+}
+
+std::vector<std::string> cpu_frequency_warnings() {
+  auto warnings = std::vector<std::string>();
+
+#ifdef IS_LINUX
+  const auto cpu_dir = std::filesystem::path("/sys/devices/system/cpu");
+  auto error         = std::error_code{};
+  auto governors     = std::map<std::string, uint32_t>();
+  for (const auto& entry : std::filesystem::directory_iterator(cpu_dir, error)) {
+    const auto name = entry.path().filename().string();
+    if (!name.starts_with("cpu") || name.size() == 3 ||
+        !std::ranges::all_of(name.substr(3), [](char c) { return c >= '0' && c <= '9'; })) {
+      continue;
+    }
+    if (auto governor = read_first_line(entry.path() / "cpufreq" / "scaling_governor")) {
+      ++governors[*governor];
+    }
+  }
+  for (const auto& [governor, core_count] : governors) {
+    if (governor != "performance") {
+      warnings.push_back(std::format(
+          "CPU scaling governor is `{}` on {} logical cores, set it to `performance` for stable results, e.g. with "
+          "`sudo cpupower frequency-set -g performance`",
+          governor, core_count));
+    }
+  }
+
+  // The Intel P-state driver reports the disabled turbo, the other drivers report the enabled boost
+  const auto no_turbo = read_first_line(cpu_dir / "intel_pstate" / "no_turbo");
+  const auto boost    = read_first_line(cpu_dir / "cpufreq" / "boost");
+  if ((no_turbo && *no_turbo == "0") || (boost && *boost == "1")) {
+    warnings.emplace_back("CPU turbo boost is enabled, the clock depends on the temperature and the load of the other "
+                          "cores, disable it for stable results");
+  }
+#endif
+
+  return warnings;
+}
+
+bool pin_current_thread(uint32_t logical_core_id) {
+#ifdef IS_WINDOWS
+  constexpr auto kGroupSize = static_cast<uint32_t>(sizeof(KAFFINITY) * 8);
+  auto affinity             = GROUP_AFFINITY{};
+  affinity.Group            = static_cast<WORD>(logical_core_id / kGroupSize);
+  affinity.Mask             = KAFFINITY{1} << (logical_core_id % kGroupSize);
+  return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(IS_LINUX)
+  if (logical_core_id >= CPU_SETSIZE) {
+    return false;
+  }
+  auto cpu_set = cpu_set_t{};
+  CPU_ZERO(&cpu_set);
+  CPU_SET(logical_core_id, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+  static_cast<void>(logical_core_id);
+  return false;
+#endif
+}
+
+int run(int argc, char** argv) {
+  const auto options = parse_harness_options(argc, argv);
+
+  if (!options.skip_cpu_checks) {
+    for (const auto& warning : cpu_frequency_warnings()) {
+      std::fprintf(stderr, "***WARNING*** %s\n", warning.c_str());
+    }
+  }
+
+  if (options.pin_cpu) {
+    if (pin_current_thread(*options.pin_cpu)) {
+      benchmark::AddCustomContext("eray_pinned_cpu", std::to_string(*options.pin_cpu));
+    } else {
+      std::fprintf(stderr, "***WARNING*** Could not pin the benchmarks to the logical core %u\n", *options.pin_cpu);
+    }
+  }
+
+  // The JSON report is written by Google Benchmark next to the console output
+  auto args = std::vector<std::string>(argv, argv + argc);
+  if (options.json_path) {
+    args.push_back(std::format("--benchmark_out={}", *options.json_path));
+    args.emplace_back("--benchmark_out_format=json");
+  }
+  auto arg_ptrs = std::vector<char*>();
+  arg_ptrs.reserve(args.size() + 1);
+  for (auto& arg : args) {
+    arg_ptrs.push_back(arg.data());
+  }
+  arg_ptrs.push_back(nullptr);
+  auto arg_count = static_cast<int>(args.size());
+
+#ifdef IS_DEBUG
+  benchmark::AddCustomContext("eray_build_type", "debug");
+#else
+  benchmark::AddCustomContext("eray_build_type", "release");
+#endif
+
+  benchmark::Initialize(&arg_count, arg_ptrs.data());
+  if (benchmark::ReportUnrecognizedArguments(arg_count, arg_ptrs.data())) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  if (options.json_path) {
+    std::fprintf(stderr, "JSON report written to `%s`\n", options.json_path->c_str());
+  }
+  return 0;
+}
+
+}  // namespace eray::util::bench
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace eray::util::bench {
+
+/**
+ * @brief Options of the shared `main()` of the `<library>_bench` executables, parsed from the `--eray_*` flags. The
+ * rest of the flags is passed to Google Benchmark.
+ *
+ *   --eray_pin_cpu=<id>      Pins the benchmark thread to the logical core.
+ *   --eray_json[=<path>]     Writes the JSON report, `<executable name>.json` by default.
+ *   --eray_skip_cpu_checks   Skips the CPU frequency scaling checks.
+ *
+ */
+struct HarnessOptions {
+  std::optional<uint32_t> pin_cpu;
+  std::optional<std::string> json_path;
+  bool skip_cpu_checks = false;
+};
+
+/**
+ * @brief Parses the `--eray_*` flags and removes them from the `argv`.
+ *
+ */
+HarnessOptions parse_harness_options(int& argc, char** argv);
+
+/**
+ * @brief Describes the CPU settings that make the results unstable: a scaling governor other than `performance` and
+ * the enabled turbo boost. Linux only, always empty on the other platforms.
+ *
+ */
+std::vector<std::string> cpu_frequency_warnings();
+
+/**
+ * @brief Pins the calling thread to the logical core. The threads spawned afterwards inherit the affinity on Linux,
+ * so the multithreaded benchmarks should not be run pinned.
+ *
+ * @return bool False if the core is invalid or the pinning is not supported by the operating system.
+ */
+bool pin_current_thread(uint32_t logical_core_id);
+
+/**
+ * @brief Applies the harness options, runs the registered benchmarks and returns the exit code of the process.
+ *
+ */
+int run(int argc, char** argv);
+
+}  // namespace eray::util::bench
@@ -0,0 +1,3 @@
+#include <liberay/util/bench_harness.hpp>
+
+int main(int argc, char** argv) { return eray::util::bench::run(argc, argv); }
@@ -0,0 +1,43 @@
+#pragma once
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace eray::util::bench {
+
+// Container sizes of the benchmarks, from the L1 cache resident ones up to the ones that spill out of L2
+inline void size_args(benchmark::internal::Benchmark* bench) { bench->RangeMultiplier(8)->Range(64, 1 << 18); }
+
+inline std::mt19937_64& rng() {
+  static auto engine = std::mt19937_64(42);
+  return engine;
+}
+
+// Unique keys in a random order, so the lookups do not walk the memory linearly
+inline std::vector<uint64_t> random_keys(std::size_t count) {
+  auto keys = std::vector<uint64_t>(count);
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    keys[i] = (i * 0x9E3779B97F4A7C15ULL) ^ 0xDEADBEEFULL;
+  }
+  std::ranges::shuffle(keys, rng());
+  return keys;
+}
+
+inline std::vector<std::string> random_strings(std::size_t count, std::size_t length) {
+  auto dist    = std::uniform_int_distribution<int>('a', 'z');
+  auto strings = std::vector<std::string>(count);
+  for (auto& str : strings) {
+    str.resize(length);
+    for (auto& c : str) {
+      c = static_cast<char>(dist(rng()));
+    }
+  }
+  return strings;
+}
+
+}  // namespace eray::util::bench
@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/bench_helpers.hpp>
+#include <cstdint>
+#include <liberay/util/flat_hash_map.hpp>
+#include <string>
+#include <unordered_map>
+
+using namespace eray::util;         // NOLINT
+using namespace eray::util::bench;  // NOLINT
+
+// Every `FlatHashMap` benchmark is measured next to the same operations on the `std::unordered_map` it replaces
+
+namespace {
+
+template <typename TMap>
+void insert(benchmark::State& state) {
+  const auto keys = random_keys(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    auto map = TMap();
+    for (const auto key : keys) {
+      map.insert({key, key});
+    }
+    benchmark::DoNotOptimize(map);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename TMap>
+void find_hit(benchmark::State& state) {
+  const auto keys = random_keys(static_cast<std::size_t>(state.range(0)));
+  auto map        = TMap();
+  for (const auto key : keys) {
+    map.insert({key, key});
+  }
+  auto i = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[i]));
+    i = (i + 1) % keys.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename TMap>
+void find_miss(benchmark::State& state) {
+  const auto keys = random_keys(static_cast<std::size_t>(state.range(0)) * 2);
+  auto map        = TMap();
+  for (auto i = std::size_t{0}; i < keys.size() / 2; ++i) {
+    map.insert({keys[i], keys[i]});
+  }
+  auto i = keys.size() / 2;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[i]));
+    i = i + 1 == keys.size() ? keys.size() / 2 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename TMap>
+void erase_insert(benchmark::State& state) {
+  const auto keys = random_keys(static_cast<std::size_t>(state.range(0)));
+  auto map        = TMap();
+  for (const auto key : keys) {
+    map.insert({key, key});
+  }
+  auto i = std::size_t{0};
+  for (auto _ : state) {
+    map.erase(keys[i]);
+    map.insert({keys[i], keys[i]});
+    i = (i + 1) % keys.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename TMap>
+void iterate(benchmark::State& state) {
+  const auto keys = random_keys(static_cast<std::size_t>(state.range(0)));
+  auto map        = TMap();
+  for (const auto key : keys) {
+    map.insert({key, key});
+  }
+  for (auto _ : state) {
+    auto sum = uint64_t{0};
+    for (const auto& [key, value] : map) {
+      sum += value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename TMap>
+void find_string(benchmark::State& state) {
+  const auto keys = random_strings(static_cast<std::size_t>(state.range(0)), 24);
+  auto map        = TMap();
+  for (auto i = std::size_t{0}; i < keys.size(); ++i) {
+    map.insert({keys[i], i});
+  }
+  auto i = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[i]));
+    i = (i + 1) % keys.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+using FlatMap    = FlatHashMap<uint64_t, uint64_t>;
+using StdMap     = std::unordered_map<uint64_t, uint64_t>;
+using FlatStrMap = FlatHashMap<std::string, std::size_t>;
+using StdStrMap  = std::unordered_map<std::string, std::size_t>;
+
+}  // namespace
+
+static void BM_FlatHashMapInsert(benchmark::State& state) { insert<FlatMap>(state); }
+BENCHMARK(BM_FlatHashMapInsert)->Apply(size_args);
+static void BM_UnorderedMapInsert(benchmark::State& state) { insert<StdMap>(state); }
+BENCHMARK(BM_UnorderedMapInsert)->Apply(size_args);
+
+static void BM_FlatHashMapFindHit(benchmark::State& state) { find_hit<FlatMap>(state); }
+BENCHMARK(BM_FlatHashMapFindHit)->Apply(size_args);
+static void BM_UnorderedMapFindHit(benchmark::State& state) { find_hit<StdMap>(state); }
+BENCHMARK(BM_UnorderedMapFindHit)->Apply(size_args);
+
+static void BM_FlatHashMapFindMiss(benchmark::State& state) { find_miss<FlatMap>(state); }
+BENCHMARK(BM_FlatHashMapFindMiss)->Apply(size_args);
+static void BM_UnorderedMapFindMiss(benchmark::State& state) { find_miss<StdMap>(state); }
+BENCHMARK(BM_UnorderedMapFindMiss)->Apply(size_args);
+
+static void BM_FlatHashMapEraseInsert(benchmark::State& state) { erase_insert<FlatMap>(state); }
+BENCHMARK(BM_FlatHashMapEraseInsert)->Apply(size_args);
+static void BM_UnorderedMapEraseInsert(benchmark::State& state) { erase_insert<StdMap>(state); }
+BENCHMARK(BM_UnorderedMapEraseInsert)->Apply(size_args);
+
+static void BM_FlatHashMapIterate(benchmark::State& state) { iterate<FlatMap>(state); }
+BENCHMARK(BM_FlatHashMapIterate)->Apply(size_args);
+static void BM_UnorderedMapIterate(benchmark::State& state) { iterate<StdMap>(state); }
+BENCHMARK(BM_UnorderedMapIterate)->Apply(size_args);
+
+static void BM_FlatHashMapFindString(benchmark::State& state) { find_string<FlatStrMap>(state); }
+BENCHMARK(BM_FlatHashMapFindString)->Apply(size_args);
+static void BM_UnorderedMapFindString(benchmark::State& state) { find_string<StdStrMap>(state); }
+BENCHMARK(BM_UnorderedMapFindString)->Apply(size_args);
@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <format>
+#include <iterator>
+#include <liberay/util/logger.hpp>
+#include <memory>
+#include <source_location>
+#include <string>
+#include <string_view>
+
+using namespace eray::util;  // NOLINT
+
+// The messages are formatted to memory, so the benchmarks measure the cost paid by the logging thread without the
+// terminal or the file I/O
+
+namespace {
+
+class NullLoggerScribe : public LoggerScribe {
+ public:
+  NullLoggerScribe() : LoggerScribe(LogLevel::Info) {}
+
+  void vlog(std::string_view usr_fmt, std::format_args usr_args,
+            const std::chrono::time_point<std::chrono::system_clock>& /*time_point*/, std::string_view /*file_path*/,
+            const std::source_location& /*location*/, LogLevel /*level*/, bool /*is_debug_msg*/) override {
+    buffer_.clear();
+    std::vformat_to(std::back_inserter(buffer_), usr_fmt, usr_args);
+    benchmark::DoNotOptimize(buffer_.data());
+  }
+
+ private:
+  std::string buffer_;
+};
+
+Logger& bench_logger() {
+  static auto& logger = []() -> Logger& {
+    Logger::instance().add_scribe(std::make_unique<NullLoggerScribe>());
+    return Logger::instance();
+  }();
+  return logger;
+}
+
+}  // namespace
+
+static void BM_LoggerFilteredOut(benchmark::State& state) {
+  auto& logger = bench_logger();
+  logger.set_level(LogLevel::Err);
+  auto i = 0;
+  for (auto _ : state) {
+    Logger::info("Frame {} took {:.3f} ms", i++, 16.6);
+  }
+  logger.set_level(LogLevel::Info);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerFilteredOut);
+
+static void BM_LoggerSync(benchmark::State& state) {
+  bench_logger();
+  auto i = 0;
+  for (auto _ : state) {
+    Logger::info("Frame {} took {:.3f} ms", i++, 16.6);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerSync);
+
+static void BM_LoggerSyncString(benchmark::State& state) {
+  bench_logger();
+  const auto name = std::string("liberay-util/benches/util/logger_bench.cpp");
+  for (auto _ : state) {
+    Logger::info("Loaded the asset `{}`", name);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerSyncString);
+
+// The logging thread only copies the arguments to its ring, the formatting is left to the background thread
+static void BM_LoggerAsync(benchmark::State& state) {
+  auto& logger = bench_logger();
+  if (state.thread_index() == 0) {
+    logger.start_async();
+  }
+  auto i = 0;
+  for (auto _ : state) {
+    Logger::info("Frame {} took {:.3f} ms", i++, 16.6);
+  }
+  if (state.thread_index() == 0) {
+    logger.stop_async();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerAsync)->ThreadRange(1, 4)->UseRealTime();
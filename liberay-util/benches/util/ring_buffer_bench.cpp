@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <liberay/util/ring_buffer.hpp>
+#include <memory>
+#include <span>
+
+using namespace eray::util;  // NOLINT
+
+namespace {
+
+constexpr std::size_t kCapacity  = 1024;
+constexpr std::size_t kBatchSize = 64;
+
+}  // namespace
+
+static void BM_SpscRingBufferPushPop(benchmark::State& state) {
+  auto ring  = SpscRingBuffer<uint64_t>(kCapacity);
+  auto value = uint64_t{0};
+  for (auto _ : state) {
+    ring.try_push(value++);
+    benchmark::DoNotOptimize(ring.try_pop());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SpscRingBufferPushPop);
+
+static void BM_SpscRingBufferBatch(benchmark::State& state) {
+  auto ring = SpscRingBuffer<uint64_t>(kCapacity);
+  auto in   = std::array<uint64_t, kBatchSize>{};
+  auto out  = std::array<uint64_t, kBatchSize>{};
+  for (auto _ : state) {
+    ring.try_push_batch(std::span<const uint64_t>(in));
+    benchmark::DoNotOptimize(ring.try_pop_batch(out));
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kBatchSize));
+}
+BENCHMARK(BM_SpscRingBufferBatch);
+
+static void BM_MpmcRingBufferPushPop(benchmark::State& state) {
+  auto ring  = MpmcRingBuffer<uint64_t>(kCapacity);
+  auto value = uint64_t{0};
+  for (auto _ : state) {
+    ring.try_push(value++);
+    benchmark::DoNotOptimize(ring.try_pop());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MpmcRingBufferPushPop);
+
+// Every thread pushes and then pops a single element, so the threads contend on both of the shared indices and the
+// ring never runs full or empty
+static void BM_MpmcRingBufferContended(benchmark::State& state) {
+  static auto ring = std::unique_ptr<MpmcRingBuffer<uint64_t>>();
+  if (state.thread_index() == 0) {
+    ring = std::make_unique<MpmcRingBuffer<uint64_t>>(kCapacity);
+  }
+  auto value = uint64_t{0};
+  for (auto _ : state) {
+    while (!ring->try_push(value)) {
+    }
+    auto popped = ring->try_pop();
+    while (!popped) {
+      popped = ring->try_pop();
+    }
+    benchmark::DoNotOptimize(popped);
+    ++value;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MpmcRingBufferContended)->ThreadRange(1, 8)->UseRealTime();
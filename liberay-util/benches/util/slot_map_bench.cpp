@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <benches/helpers/bench_helpers.hpp>
+#include <cstdint>
+#include <liberay/util/slot_map.hpp>
+#include <utility>
+#include <vector>
+
+using namespace eray::util;         // NOLINT
+using namespace eray::util::bench;  // NOLINT
+
+namespace {
+
+// Size of a typical small component, e.g. a transform
+struct Payload {
+  std::array<float, 16> values{};
+};
+
+using Map = SlotMap<Payload>;
+using Key = Map::key_type;
+
+std::vector<Key> fill(Map& map, std::size_t count) {
+  auto keys = std::vector<Key>();
+  keys.reserve(count);
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    keys.push_back(map.emplace());
+  }
+  return keys;
+}
+
+// Visits the keys in a random order, so the slot array is not walked linearly
+std::vector<Key> shuffled(std::vector<Key> keys) {
+  std::ranges::shuffle(keys, rng());
+  return keys;
+}
+
+}  // namespace
+
+static void BM_SlotMapInsert(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    auto map = Map();
+    for (auto i = std::size_t{0}; i < count; ++i) {
+      benchmark::DoNotOptimize(map.emplace());
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SlotMapInsert)->Apply(size_args);
+
+static void BM_SlotMapLookup(benchmark::State& state) {
+  auto map        = Map();
+  const auto keys = shuffled(fill(map, static_cast<std::size_t>(state.range(0))));
+  auto i          = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map[keys[i]].values[0]);
+    i = (i + 1) % keys.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SlotMapLookup)->Apply(size_args);
+
+static void BM_SlotMapContainsStale(benchmark::State& state) {
+  auto map  = Map();
+  auto keys = fill(map, static_cast<std::size_t>(state.range(0)));
+  for (const auto key : keys) {
+    map.erase(key);
+  }
+  fill(map, keys.size());
+  keys   = shuffled(std::move(keys));
+  auto i = std::size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.contains(keys[i]));
+    i = (i + 1) % keys.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SlotMapContainsStale)->Apply(size_args);
+
+// Erasing moves the last element into the hole, the churn measures the free list and the dense vector swaps together
+static void BM_SlotMapEraseInsert(benchmark::State& state) {
+  auto map  = Map();
+  auto keys = shuffled(fill(map, static_cast<std::size_t>(state.range(0))));
+  auto i    = std::size_t{0};
+  for (auto _ : state) {
+    map.erase(keys[i]);
+    keys[i] = map.emplace();
+    i       = (i + 1) % keys.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SlotMapEraseInsert)->Apply(size_args);
+
+static void BM_SlotMapIterate(benchmark::State& state) {
+  auto map = Map();
+  fill(map, static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    auto sum = 0.F;
+    for (const auto& payload : map) {
+      sum += payload.values[0];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SlotMapIterate)->Apply(size_args);
@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <liberay/util/inplace_vector.hpp>
+#include <liberay/util/small_vector.hpp>
+#include <vector>
+
+using namespace eray::util;  // NOLINT
+
+// The short lived vectors built in the hot loops, e.g. the barriers of a pass or the attachments of a pipeline. The
+// SmallVector stores 16 elements inline, the 32 element runs show the cost of spilling to the heap. The InplaceVector
+// holds all of the runs.
+
+namespace {
+
+constexpr std::size_t kInlineCapacity = 16;
+constexpr std::size_t kMaxElements    = 32;
+
+void element_args(benchmark::internal::Benchmark* bench) { bench->Arg(4)->Arg(8)->Arg(16)->Arg(32); }
+
+template <typename TVector>
+void build(benchmark::State& state) {
+  const auto count = static_cast<uint32_t>(state.range(0));
+  for (auto _ : state) {
+    auto vec = TVector();
+    for (auto i = uint32_t{0}; i < count; ++i) {
+      vec.push_back(i);
+    }
+    benchmark::DoNotOptimize(vec.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename TVector>
+void copy(benchmark::State& state) {
+  auto src = TVector();
+  for (auto i = uint32_t{0}; i < static_cast<uint32_t>(state.range(0)); ++i) {
+    src.push_back(i);
+  }
+  for (auto _ : state) {
+    auto dst = src;
+    benchmark::DoNotOptimize(dst.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+static void BM_SmallVectorBuild(benchmark::State& state) { build<SmallVector<uint32_t, kInlineCapacity>>(state); }
+BENCHMARK(BM_SmallVectorBuild)->Apply(element_args);
+static void BM_InplaceVectorBuild(benchmark::State& state) { build<InplaceVector<uint32_t, kMaxElements>>(state); }
+BENCHMARK(BM_InplaceVectorBuild)->Apply(element_args);
+static void BM_StdVectorBuild(benchmark::State& state) { build<std::vector<uint32_t>>(state); }
+BENCHMARK(BM_StdVectorBuild)->Apply(element_args);
+
+static void BM_SmallVectorCopy(benchmark::State& state) { copy<SmallVector<uint32_t, kInlineCapacity>>(state); }
+BENCHMARK(BM_SmallVectorCopy)->Apply(element_args);
+static void BM_InplaceVectorCopy(benchmark::State& state) { copy<InplaceVector<uint32_t, kMaxElements>>(state); }
+BENCHMARK(BM_InplaceVectorCopy)->Apply(element_args);
+static void BM_StdVectorCopy(benchmark::State& state) { copy<std::vector<uint32_t>>(state); }
+BENCHMARK(BM_StdVectorCopy)->Apply(element_args);
@@ -0,0 +1,167 @@
+#include <atomic>
+#include <cstdlib>
+#include <liberay/util/alloc_tracker.hpp>
+#include <liberay/util/panic.hpp>
+#include <liberay/util/platform.hpp>
+#include <new>
+
+#ifdef IS_WINDOWS
+#include <malloc.h>
+#endif
+
+namespace eray::util {
+
+namespace {
+
+/**
+ * @brief Trivial, so that the thread local needs no initialization guard and can be used from `operator new` at any
+ * time, including the thread startup and teardown.
+ *
+ */
+struct ThreadAllocationCounters {
+  uint64_t count;
+  uint64_t bytes;
+};
+
+constinit thread_local ThreadAllocationCounters tls_allocations{};  // NOLINT
+constinit std::atomic<uint64_t> global_allocation_count{0};         // NOLINT
+constinit std::atomic<uint64_t> global_allocation_bytes{0};         // NOLINT
+
+}  // namespace
+
+AllocationStats AllocationTracker::thread_stats() {
+  return AllocationStats{.count = tls_allocations.count, .bytes = tls_allocations.bytes};
+}
+
+AllocationStats AllocationTracker::global_stats() {
+  return AllocationStats{
+      .count = global_allocation_count.load(std::memory_order_relaxed),
+      .bytes = global_allocation_bytes.load(std::memory_order_relaxed),
+  };
+}
+
+NoAllocationScope::~NoAllocationScope() {
+  if constexpr (AllocationTracker::kEnabled) {
+    if (const auto stats = scope_.stats(); stats.count > 0) {
+      panic({"Unexpected {} heap allocations ({} bytes) in a no allocation scope", location_}, stats.count,
+            stats.bytes);
+    }
+  }
+}
+
+}  // namespace eray::util
+
+#ifdef ERAY_TRACK_ALLOCATIONS
+
+// == Global operator new and delete replacements ======================================================================
+
+namespace {
+
+void record_allocation(std::size_t size) {
+  using namespace eray::util;  // NOLINT
+
+  ++tls_allocations.count;
+  tls_allocations.bytes += size;
+  global_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  global_allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void* try_allocate(std::size_t size, std::size_t alignment) {
+  if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    return std::malloc(size);  // NOLINT
+  }
+#ifdef IS_WINDOWS
+  return _aligned_malloc(size, alignment);
+#else
+  // The size of `aligned_alloc` must be a multiple of the alignment
+  return std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));  // NOLINT
+#endif
+}
+
+void deallocate(void* ptr, std::size_t alignment) noexcept {
+#ifdef IS_WINDOWS
+  if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    _aligned_free(ptr);
+    return;
+  }
+#else
+  static_cast<void>(alignment);
+#endif
+  std::free(ptr);  // NOLINT
+}
+
+/**
+ * @brief Follows the standard `operator new`: calls the new handler until the allocation succeeds and throws
+ * `std::bad_alloc` when there is no handler.
+ *
+ */
+void* allocate(std::size_t size, std::size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+  record_allocation(size);
+  size = size == 0 ? 1 : size;
+  while (true) {
+    if (auto* ptr = try_allocate(size, alignment)) {
+      return ptr;
+    }
+    auto* handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void* allocate_nothrow(std::size_t size, std::size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) noexcept {
+  try {
+    return allocate(size, alignment);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+}  // namespace
+
+// NOLINTBEGIN
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate_nothrow(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate_nothrow(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocate_nothrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocate_nothrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept { deallocate(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete(void* ptr, std::size_t) noexcept { deallocate(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete[](void* ptr, std::size_t) noexcept { deallocate(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete(void* ptr, std::align_val_t alignment) noexcept {
+  deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept {
+  deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+  deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+  deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+// NOLINTEND
+
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <source_location>
+
+namespace eray::util {
+
+struct AllocationStats {
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+
+  AllocationStats operator-(const AllocationStats& other) const {
+    return AllocationStats{.count = count - other.count, .bytes = bytes - other.bytes};
+  }
+};
+
+/**
+ * @brief Counts the heap allocations. Compiled with the `ERAY_TRACK_ALLOCATIONS` CMake option, liberay-util replaces
+ * the global `operator new` and `operator delete` with versions that bump the counters of the calling thread and the
+ * global counters before forwarding to `malloc`. Otherwise the operators are not replaced and the counters stay zero.
+ *
+ * Meant for proving that the steady-state frames do not allocate, see `ERAY_EXPECT_NO_ALLOC()`.
+ *
+ */
+class AllocationTracker {
+ public:
+#ifdef ERAY_TRACK_ALLOCATIONS
+  static constexpr bool kEnabled = true;
+#else
+  static constexpr bool kEnabled = false;
+#endif
+
+  /**
+   * @brief Allocations made by the calling thread since it started.
+   *
+   */
+  static AllocationStats thread_stats();
+
+  /**
+   * @brief Allocations made by all of the threads since the program started.
+   *
+   */
+  static AllocationStats global_stats();
+};
+
+/**
+ * @brief Counts the allocations the calling thread makes during the lifetime of the scope.
+ *
+ */
+class AllocationScope {
+ public:
+  AllocationScope() : start_(AllocationTracker::thread_stats()) {}
+
+  AllocationStats stats() const { return AllocationTracker::thread_stats() - start_; }
+
+ private:
+  AllocationStats start_;
+};
+
+/**
+ * @brief Panics if the calling thread allocates during the lifetime of the scope. Does nothing unless built with
+ * `ERAY_TRACK_ALLOCATIONS`.
+ *
+ */
+class NoAllocationScope {
+ public:
+  explicit NoAllocationScope(const std::source_location& location = std::source_location::current())
+      : location_(location) {}
+
+  NoAllocationScope(const NoAllocationScope&)            = delete;
+  NoAllocationScope& operator=(const NoAllocationScope&) = delete;
+
+  ~NoAllocationScope();
+
+ private:
+  AllocationScope scope_;
+  std::source_location location_;
+};
+
+}  // namespace eray::util
+
+#define ERAY_ALLOC_CONCAT_IMPL(a, b) a##b
+#define ERAY_ALLOC_CONCAT(a, b) ERAY_ALLOC_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Asserts that the rest of the enclosing scope makes no heap allocations on the calling thread, e.g. in the
+ * tests of the per-frame code paths. Check `AllocationTracker::kEnabled` to skip such tests in the builds without
+ * the tracking.
+ *
+ */
+#define ERAY_EXPECT_NO_ALLOC() \
+  const ::eray::util::NoAllocationScope ERAY_ALLOC_CONCAT(eray_no_alloc_scope_, __LINE__)
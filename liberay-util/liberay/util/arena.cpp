@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cassert>
+#include <liberay/util/arena.hpp>
+#include <utility>
+
+namespace eray::util {
+
+namespace {
+
+constexpr size_t kChunkAlignment = alignof(std::max_align_t);
+
+}  // namespace
+
+LinearArena::LinearArena(size_t capacity, std::pmr::memory_resource* upstream) : upstream_(upstream) {
+  add_chunk(std::max(capacity, kChunkAlignment));
+}
+
+LinearArena::LinearArena(LinearArena&& other) noexcept
+    : upstream_(other.upstream_),
+      chunks_(std::move(other.chunks_)),
+      offset_(std::exchange(other.offset_, 0)),
+      used_bytes_(std::exchange(other.used_bytes_, 0)) {
+  other.chunks_.clear();
+}
+
+LinearArena& LinearArena::operator=(LinearArena&& other) noexcept {
+  if (this != &other) {
+    release_chunks();
+    upstream_   = other.upstream_;
+    chunks_     = std::move(other.chunks_);
+    offset_     = std::exchange(other.offset_, 0);
+    used_bytes_ = std::exchange(other.used_bytes_, 0);
+    other.chunks_.clear();
+  }
+  return *this;
+}
+
+LinearArena::~LinearArena() { release_chunks(); }
+
+size_t LinearArena::capacity() const {
+  auto result = size_t{0};
+  for (const auto& chunk : chunks_) {
+    result += chunk.size_bytes;
+  }
+  return result;
+}
+
+void LinearArena::reset() {
+  if (chunks_.size() > 1) {
+    const auto total = capacity();
+    release_chunks();
+    add_chunk(total);
+  }
+  offset_     = 0;
+  used_bytes_ = 0;
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment) {
+  assert(!chunks_.empty() && "Arena has been moved from");
+
+  auto& chunk        = chunks_.back();
+  const auto address = reinterpret_cast<uintptr_t>(chunk.data) + offset_;
+  const auto padding = ((address + alignment - 1) & ~(alignment - 1)) - address;
+  if (offset_ + padding + bytes <= chunk.size_bytes) {
+    auto* result  = chunk.data + offset_ + padding;
+    offset_      += padding + bytes;
+    used_bytes_  += padding + bytes;
+    return result;
+  }
+
+  // The chunks are aligned to `std::max_align_t`, the over-aligned allocations need the room for the padding
+  add_chunk(std::max(chunk.size_bytes * 2, bytes + std::max(alignment, kChunkAlignment)));
+  return do_allocate(bytes, alignment);
+}
+
+void LinearArena::add_chunk(size_t size_bytes) {
+  chunks_.push_back(Chunk{
+      .data       = static_cast<std::byte*>(upstream_->allocate(size_bytes, kChunkAlignment)),
+      .size_bytes = size_bytes,
+  });
+  offset_ = 0;
+}
+
+void LinearArena::release_chunks() {
+  for (const auto& chunk : chunks_) {
+    upstream_->deallocate(chunk.data, chunk.size_bytes, kChunkAlignment);
+  }
+  chunks_.clear();
+}
+
+FrameArena FrameArena::create(uint32_t frames_in_flight, size_t capacity_per_frame) {
+  auto result = FrameArena(nullptr);
+  result.arenas_.reserve(frames_in_flight);
+  for (auto i = 0U; i < frames_in_flight; ++i) {
+    result.arenas_.emplace_back(capacity_per_frame);
+  }
+  return result;
+}
+
+void FrameArena::begin_frame(uint32_t frame_index) {
+  assert(frame_index < arenas_.size() && "Frame index out of range");
+  current_frame_ = frame_index;
+  arenas_[frame_index].reset();
+}
+
+}  // namespace eray::util
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace eray::util {
+
+/**
+ * @brief Bump allocator, the memory is released all at once by `reset()`. Deallocation is a no-op. When a chunk runs
+ * out a new one is allocated from the upstream resource, `reset()` then replaces the chunks with a single chunk of
+ * their combined size, so once the arena has seen its peak usage it never allocates again.
+ *
+ * The arena is a `std::pmr::memory_resource`, so the standard containers allocate from it with
+ * `std::pmr::vector<T>(&arena)`. The containers must not outlive the next `reset()`.
+ *
+ * @warning Not thread-safe.
+ *
+ */
+class LinearArena final : public std::pmr::memory_resource {
+ public:
+  static constexpr size_t kDefaultCapacity = 64 * 1024;
+
+  explicit LinearArena(size_t capacity = kDefaultCapacity,
+                       std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+  LinearArena(const LinearArena&)            = delete;
+  LinearArena& operator=(const LinearArena&) = delete;
+  LinearArena(LinearArena&& other) noexcept;
+  LinearArena& operator=(LinearArena&& other) noexcept;
+
+  ~LinearArena() override;
+
+  /**
+   * @brief Uninitialized storage of `count` trivially destructible objects.
+   *
+   */
+  template <typename T>
+    requires(std::is_trivially_destructible_v<T>)
+  std::span<T> allocate_span(size_t count) {
+    return std::span(static_cast<T*>(allocate(count * sizeof(T), alignof(T))), count);
+  }
+
+  /**
+   * @brief Releases all of the allocations.
+   *
+   */
+  void reset();
+
+  /**
+   * @brief Bytes allocated since the last reset, including the alignment padding.
+   *
+   */
+  size_t used_bytes() const { return used_bytes_; }
+  size_t capacity() const;
+
+ private:
+  struct Chunk {
+    std::byte* data;
+    size_t size_bytes;
+  };
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* /*p*/, size_t /*bytes*/, size_t /*alignment*/) override {}
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+  void add_chunk(size_t size_bytes);
+  void release_chunks();
+
+  std::pmr::memory_resource* upstream_;
+  std::vector<Chunk> chunks_;
+  size_t offset_     = 0;
+  size_t used_bytes_ = 0;
+};
+
+/**
+ * @brief One `LinearArena` per frame in flight. The arena of a frame is reset when the frame begins, so the per-frame
+ * containers (e.g. `std::pmr::vector` of barriers or descriptor writes) live until the frame slot is reused and the
+ * steady state frame does not touch the global heap.
+ *
+ */
+class FrameArena {
+ public:
+  FrameArena() = delete;
+  explicit FrameArena(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the arenas.
+   *
+   * @param frames_in_flight
+   * @param capacity_per_frame Initial capacity, the arenas grow to the peak usage of the frames.
+   * @return FrameArena
+   */
+  [[nodiscard]] static FrameArena create(uint32_t frames_in_flight,
+                                         size_t capacity_per_frame = LinearArena::kDefaultCapacity);
+
+  /**
+   * @brief Resets the arena of the frame, call once the previous use of the frame in flight has finished.
+   *
+   */
+  void begin_frame(uint32_t frame_index);
+
+  LinearArena& arena() { return arenas_[current_frame_]; }
+  std::pmr::memory_resource* resource() { return &arenas_[current_frame_]; }
+
+ private:
+  std::vector<LinearArena> arenas_;
+  uint32_t current_frame_ = 0;
+};
+
+}  // namespace eray::util
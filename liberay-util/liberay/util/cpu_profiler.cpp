@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <liberay/util/cpu_profiler.hpp>
+#include <liberay/util/ring_buffer.hpp>
+#include <mutex>
+#include <utility>
+
+namespace eray::util {
+
+struct CpuProfiler::Ring {
+  SpscRingBuffer<Event> events{kRingCapacity};
+  std::atomic<uint64_t> dropped{0};
+
+  /**
+   * @brief The thread has exited, the ring is released once it is drained.
+   *
+   */
+  std::atomic<bool> abandoned{false};
+
+  /**
+   * @brief Guarded by the registry mutex.
+   *
+   */
+  std::string name;
+  uint32_t id = 0;
+};
+
+struct CpuProfiler::Registry {
+  std::mutex mutex;
+
+  /**
+   * @brief Rings of the threads that started recording after the last `end_frame()`.
+   *
+   */
+  std::vector<std::shared_ptr<Ring>> new_rings;
+
+  uint32_t next_thread_id    = 0;
+  uint64_t released_dropped = 0;
+};
+
+namespace {
+
+struct ThreadProfileRing {
+  std::shared_ptr<CpuProfiler::Ring> ring;
+  uint32_t depth = 0;
+
+  ThreadProfileRing() = default;
+  ThreadProfileRing(const ThreadProfileRing&)            = delete;
+  ThreadProfileRing& operator=(const ThreadProfileRing&) = delete;
+  ~ThreadProfileRing() {
+    if (ring) {
+      ring->abandoned.store(true, std::memory_order_release);
+    }
+  }
+};
+
+thread_local ThreadProfileRing tls_profile_ring;  // NOLINT
+
+}  // namespace
+
+CpuProfiler::CpuProfiler() : registry_(std::make_unique<Registry>()) {}
+
+CpuProfiler::~CpuProfiler() = default;
+
+CpuProfiler& CpuProfiler::instance() {
+  static auto profiler = CpuProfiler();
+  return profiler;
+}
+
+uint64_t CpuProfiler::now_ns() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+CpuProfiler::Ring& CpuProfiler::thread_ring() {
+  if (!tls_profile_ring.ring) {
+    auto ring       = std::make_shared<Ring>();
+    auto& registry  = *instance().registry_;
+    const auto lock = std::lock_guard(registry.mutex);
+    ring->id        = registry.next_thread_id++;
+    registry.new_rings.push_back(ring);
+    tls_profile_ring.ring = std::move(ring);
+  }
+  return *tls_profile_ring.ring;
+}
+
+void CpuProfiler::set_thread_name(std::string_view name) {
+  auto& ring      = thread_ring();
+  const auto lock = std::lock_guard(instance().registry_->mutex);
+  ring.name       = name;
+}
+
+void CpuProfiler::record(const Event& event) {
+  auto& ring = thread_ring();
+  if (!ring.events.try_push(event)) {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void CpuProfiler::end_frame() {
+  const auto allocations   = AllocationTracker::global_stats();
+  frame_allocations_       = allocations - frame_start_allocations_;
+  frame_start_allocations_ = allocations;
+
+  {
+    const auto lock = std::lock_guard(registry_->mutex);
+    for (auto& ring : registry_->new_rings) {
+      threads_.push_back(Thread{
+          .name  = {},
+          .nodes = {Node{}},
+          .id    = ring->id,
+      });
+      thread_rings_.push_back(ThreadRing{
+          .ring     = std::move(ring),
+          .deferred = {},
+      });
+    }
+    registry_->new_rings.clear();
+
+    for (auto i = 0U; i < threads_.size(); ++i) {
+      const auto& ring = *thread_rings_[i].ring;
+      threads_[i].name = ring.name.empty() ? std::format("Thread {}", ring.id) : ring.name;
+    }
+  }
+
+  // == Release the rings of the exited threads, shown for a frame after the last events ===============================
+  for (auto i = threads_.size(); i-- > 0;) {
+    auto& ring = *thread_rings_[i].ring;
+    if (ring.abandoned.load(std::memory_order_acquire) && thread_rings_[i].deferred.empty() && ring.events.empty()) {
+      {
+        const auto lock = std::lock_guard(registry_->mutex);
+        registry_->released_dropped += ring.dropped.load(std::memory_order_relaxed);
+      }
+      threads_.erase(threads_.begin() + i);
+      thread_rings_.erase(thread_rings_.begin() + i);
+    }
+  }
+
+  for (auto i = 0U; i < threads_.size(); ++i) {
+    auto& deferred = thread_rings_[i].deferred;
+    events_.assign(deferred.begin(), deferred.end());
+    events_.resize(deferred.size() + kRingCapacity);
+    const auto count = thread_rings_[i].ring->events.try_pop_batch(std::span(events_).subspan(deferred.size()));
+    events_.resize(deferred.size() + count);
+
+    // The deferred events were captured when they were drained
+    if (capturing_ && count > 0) {
+      for (const auto& event : std::span(events_).subspan(deferred.size())) {
+        captured_events_.push_back(CapturedEvent{
+            .name      = event.name,
+            .start_ns  = event.start_ns,
+            .end_ns    = event.end_ns,
+            .thread_id = threads_[i].id,
+        });
+      }
+      if (std::ranges::none_of(captured_thread_names_, [&](const auto& t) { return t.first == threads_[i].id; })) {
+        captured_thread_names_.emplace_back(threads_[i].id, threads_[i].name);
+      }
+    }
+    deferred.clear();
+
+    merge_events(threads_[i], events_, thread_rings_[i].deferred);
+  }
+
+  ++frame_index_;
+}
+
+void CpuProfiler::merge_events(Thread& thread, std::span<Event> events, std::vector<Event>& deferred) {
+  // The events are recorded when the scopes end, the parents are sorted before their children
+  std::ranges::sort(events, [](const Event& a, const Event& b) {
+    return a.start_ns != b.start_ns ? a.start_ns < b.start_ns : a.depth < b.depth;
+  });
+
+  frame_ms_.assign(thread.nodes.size(), 0.0F);
+  frame_calls_.assign(thread.nodes.size(), 0);
+  open_scopes_.clear();
+  for (auto i = 0U; i < events.size(); ++i) {
+    const auto& event = events[i];
+
+    while (!open_scopes_.empty()) {
+      const auto& open = events[open_scopes_.back().first];
+      if (open.depth < event.depth && event.end_ns <= open.end_ns) {
+        break;
+      }
+      open_scopes_.pop_back();
+    }
+
+    // A scope without its parent is held back by a frame, the parent has not ended yet. If the parent does not show up
+    // (the profiler was enabled inside of it), the scope is attached to the nearest enclosing scope instead
+    const auto is_orphan =
+        event.depth > 0 && (open_scopes_.empty() || events[open_scopes_.back().first].depth + 1 != event.depth);
+    if ((is_orphan && !event.deferred) || (!open_scopes_.empty() && open_scopes_.back().second == kNoNode)) {
+      deferred.push_back(event);
+      deferred.back().deferred = true;
+      open_scopes_.emplace_back(i, kNoNode);
+      continue;
+    }
+
+    const auto parent = open_scopes_.empty() ? 0 : open_scopes_.back().second;
+    const auto node   = find_or_add_child(thread, parent, event.name);
+    if (frame_ms_.size() < thread.nodes.size()) {
+      frame_ms_.resize(thread.nodes.size(), 0.0F);
+      frame_calls_.resize(thread.nodes.size(), 0);
+    }
+    frame_ms_[node] += static_cast<float>(static_cast<double>(event.end_ns - event.start_ns) / 1e6);
+    frame_calls_[node] += 1;
+    open_scopes_.emplace_back(i, node);
+  }
+
+  const auto history_index = frame_index_ % kHistoryFrames;
+  for (auto node = 1U; node < thread.nodes.size(); ++node) {
+    thread.nodes[node].last_calls = frame_calls_[node];
+    thread.nodes[node].history_ms[history_index] =
+        frame_calls_[node] > 0 ? frame_ms_[node] : std::numeric_limits<float>::quiet_NaN();
+  }
+}
+
+uint32_t CpuProfiler::find_or_add_child(Thread& thread, uint32_t parent, const char* name) {
+  for (const auto child : thread.nodes[parent].children) {
+    if (thread.nodes[child].name == name) {
+      return child;
+    }
+  }
+
+  const auto index = static_cast<uint32_t>(thread.nodes.size());
+  auto node        = Node{
+             .name       = name,
+             .parent     = parent,
+             .depth      = thread.nodes[parent].depth + 1,
+             .children   = {},
+             .last_calls = 0,
+             .history_ms = {},
+  };
+  node.history_ms.fill(std::numeric_limits<float>::quiet_NaN());
+  thread.nodes.push_back(std::move(node));
+  thread.nodes[parent].children.push_back(index);
+  return index;
+}
+
+CpuProfiler::Stats CpuProfiler::stats(const Node& node) const {
+  auto result = Stats{};
+  if (frame_index_ == 0) {
+    return result;
+  }
+
+  const auto last = node.history_ms[(frame_index_ - 1) % kHistoryFrames];
+  result.last_ms  = std::isnan(last) ? 0.0F : last;
+  result.calls    = node.last_calls;
+  result.min_ms   = std::numeric_limits<float>::max();
+
+  auto frames = 0U;
+  auto sum    = 0.0F;
+  for (const auto ms : node.history_ms) {
+    if (std::isnan(ms)) {
+      continue;
+    }
+    result.min_ms  = std::min(result.min_ms, ms);
+    result.max_ms  = std::max(result.max_ms, ms);
+    sum           += ms;
+    ++frames;
+  }
+  if (frames == 0) {
+    result.min_ms = 0.0F;
+    return result;
+  }
+  result.avg_ms = sum / static_cast<float>(frames);
+
+  return result;
+}
+
+uint64_t CpuProfiler::dropped_events() const {
+  auto result = uint64_t{0};
+  {
+    const auto lock = std::lock_guard(registry_->mutex);
+    result          = registry_->released_dropped;
+  }
+  for (const auto& thread_ring : thread_rings_) {
+    result += thread_ring.ring->dropped.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+void CpuProfiler::begin_capture() {
+  capturing_ = true;
+  captured_events_.clear();
+  captured_thread_names_.clear();
+}
+
+std::string_view CpuProfiler::captured_thread_name(uint32_t thread_id) const {
+  const auto it = std::ranges::find(captured_thread_names_, thread_id, [](const auto& t) { return t.first; });
+  return it == captured_thread_names_.end() ? std::string_view() : std::string_view(it->second);
+}
+
+void CpuProfileScope::begin(const char* name) {
+  name_     = name;
+  depth_    = tls_profile_ring.depth++;
+  start_ns_ = CpuProfiler::now_ns();
+}
+
+void CpuProfileScope::end() {
+  const auto end_ns = CpuProfiler::now_ns();
+  --tls_profile_ring.depth;
+  CpuProfiler::record(CpuProfiler::Event{
+      .name     = name_,
+      .start_ns = start_ns_,
+      .end_ns   = end_ns,
+      .depth    = depth_,
+      .deferred = false,
+  });
+}
+
+}  // namespace eray::util
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/util/alloc_tracker.hpp>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace eray::util {
+
+/**
+ * @brief In-engine hierarchical CPU profiler. The `CpuProfileScope`s (usually the `ERAY_PROFILE_SCOPE` macros, see
+ * `profiler.hpp`) record their begin and end times into a ring of the calling thread, `end_frame()` drains the rings
+ * and merges the events into a tree of the scopes of every thread, with the times of the last `kHistoryFrames`
+ * frames. Unlike Tracy, the results are available in the application, e.g. in an ImGui window.
+ *
+ * The profiler is disabled by default, a disabled scope costs a relaxed atomic load. The events that do not fit into
+ * the ring of a thread before the next `end_frame()` are dropped and counted.
+ *
+ * @warning The scope names are stored as pointers, they must be string literals (or outlive the profiler).
+ * `end_frame()` and the results must be accessed from a single thread.
+ *
+ */
+class CpuProfiler {
+ public:
+  static constexpr size_t kRingCapacity  = 8192;
+  static constexpr size_t kHistoryFrames = 120;
+  static constexpr uint32_t kNoNode      = UINT32_MAX;
+
+  /**
+   * @brief Scope in the tree of a thread, the scopes with the same name and parent are merged.
+   *
+   */
+  struct Node {
+    std::string_view name;
+    uint32_t parent = kNoNode;
+    uint32_t depth  = 0;
+    std::vector<uint32_t> children;
+
+    /**
+     * @brief Number of times the scope was entered in the last frame.
+     *
+     */
+    uint32_t last_calls = 0;
+
+    /**
+     * @brief Total time of the scope in the recent frames, NaN in the frames in which it did not run. Indexed by the
+     * frame index modulo `kHistoryFrames`.
+     *
+     */
+    std::array<float, kHistoryFrames> history_ms{};
+  };
+
+  /**
+   * @brief The first node is the root of the thread, it has no name and no time.
+   *
+   */
+  struct Thread {
+    std::string name;
+    std::vector<Node> nodes;
+
+    /**
+     * @brief Identifies the thread in the `CapturedEvent`s.
+     *
+     */
+    uint32_t id = 0;
+  };
+
+  /**
+   * @brief Scope recorded while capturing, see `begin_capture()`. The times are in the `now_ns()` timebase.
+   *
+   */
+  struct CapturedEvent {
+    std::string_view name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t thread_id;
+  };
+
+  /**
+   * @brief Statistics of a scope over the frames of the history in which it ran.
+   *
+   */
+  struct Stats {
+    float last_ms  = 0.0F;
+    float min_ms   = 0.0F;
+    float avg_ms   = 0.0F;
+    float max_ms   = 0.0F;
+    uint32_t calls = 0;
+  };
+
+  CpuProfiler(const CpuProfiler&)            = delete;
+  CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+  ~CpuProfiler();
+
+  static CpuProfiler& instance();
+
+  static bool is_enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+  /**
+   * @brief Names the calling thread in the results. The threads that are not named are numbered.
+   *
+   */
+  static void set_thread_name(std::string_view name);
+
+  /**
+   * @brief Timebase of the events, `std::chrono::steady_clock` in nanoseconds.
+   *
+   */
+  static uint64_t now_ns();
+
+  /**
+   * @brief Drains the events recorded since the previous call and appends a frame to the history.
+   *
+   */
+  void end_frame();
+
+  std::span<const Thread> threads() const { return threads_; }
+
+  Stats stats(const Node& node) const;
+
+  /**
+   * @brief Number of the events dropped because a ring was full.
+   *
+   */
+  uint64_t dropped_events() const;
+
+  uint64_t frame_index() const { return frame_index_; }
+
+  /**
+   * @brief Keeps the individual scopes drained by the following `end_frame()` calls until `end_capture()`, e.g. to
+   * export them as a trace. Clears the previous capture. The profiler must be enabled for the scopes to be recorded.
+   *
+   */
+  void begin_capture();
+  void end_capture() { capturing_ = false; }
+  bool is_capturing() const { return capturing_; }
+
+  std::span<const CapturedEvent> captured_events() const { return captured_events_; }
+
+  /**
+   * @brief Name of the thread of the captured events, the thread might have already exited.
+   *
+   */
+  std::string_view captured_thread_name(uint32_t thread_id) const;
+
+  /**
+   * @brief Heap allocations of all of the threads between the last two `end_frame()` calls. Zero unless built with
+   * `ERAY_TRACK_ALLOCATIONS`, counted even when the profiler is disabled.
+   *
+   */
+  AllocationStats frame_allocations() const { return frame_allocations_; }
+
+  /**
+   * @brief Defined in the translation unit.
+   *
+   */
+  struct Ring;
+
+ private:
+  friend class CpuProfileScope;
+
+  struct Event {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t depth;
+
+    /**
+     * @brief The event was already held back by a frame, see `ThreadRing::deferred`.
+     *
+     */
+    bool deferred;
+  };
+  struct Registry;
+
+  struct ThreadRing {
+    std::shared_ptr<Ring> ring;
+
+    /**
+     * @brief Events whose parent scope had not ended at the last `end_frame()`, e.g. the scopes of a frame that
+     * encloses `ERAY_PROFILE_FRAME()`. They are merged with the next frame, together with the parent.
+     *
+     */
+    std::vector<Event> deferred;
+  };
+
+  CpuProfiler();
+
+  /**
+   * @brief Ring of the calling thread, registered on the first use.
+   *
+   */
+  static Ring& thread_ring();
+  static void record(const Event& event);
+
+  void merge_events(Thread& thread, std::span<Event> events, std::vector<Event>& deferred);
+  static uint32_t find_or_add_child(Thread& thread, uint32_t parent, const char* name);
+
+  inline static std::atomic<bool> enabled_{false};
+
+  std::unique_ptr<Registry> registry_;
+  std::vector<Thread> threads_;
+  std::vector<ThreadRing> thread_rings_;
+  std::vector<Event> events_;
+  std::vector<float> frame_ms_;
+  std::vector<uint32_t> frame_calls_;
+  std::vector<std::pair<uint32_t, uint32_t>> open_scopes_;
+  uint64_t frame_index_ = 0;
+  AllocationStats frame_start_allocations_;
+  AllocationStats frame_allocations_;
+
+  bool capturing_ = false;
+  std::vector<CapturedEvent> captured_events_;
+  std::vector<std::pair<uint32_t, std::string>> captured_thread_names_;
+};
+
+/**
+ * @brief Records the time between its construction and destruction as a scope of the `CpuProfiler`. Nested scopes of
+ * a thread form the tree.
+ *
+ */
+class CpuProfileScope {
+ public:
+  explicit CpuProfileScope(const char* name) {
+    if (CpuProfiler::is_enabled()) {
+      begin(name);
+    }
+  }
+
+  ~CpuProfileScope() {
+    if (name_ != nullptr) {
+      end();
+    }
+  }
+
+  CpuProfileScope(const CpuProfileScope&)            = delete;
+  CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+  CpuProfileScope(CpuProfileScope&&)                 = delete;
+  CpuProfileScope& operator=(CpuProfileScope&&)      = delete;
+
+ private:
+  void begin(const char* name);
+  void end();
+
+  const char* name_  = nullptr;
+  uint64_t start_ns_ = 0;
+  uint32_t depth_    = 0;
+};
+
+}  // namespace eray::util
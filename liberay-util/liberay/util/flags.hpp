@@ -41,6 +41,8 @@ class Flags {
   }
 
   constexpr bool has_flag(BitType flag) const noexcept { return (mask_ & static_cast<MaskType>(flag)) != 0; }
+  constexpr bool operator==(Flags<BitType> const& rhs) const noexcept = default;
+  constexpr MaskType mask() const noexcept { return mask_; }
 
  private:
   MaskType mask_;
@@ -0,0 +1,653 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace eray::util {
+
+namespace internal {
+
+/**
+ * @brief Control byte of a slot. The full slots store the low 7 bits of the hash, so most of the mismatches are
+ * rejected without touching the slots.
+ *
+ */
+inline constexpr uint8_t kCtrlEmpty   = 0x80;
+inline constexpr uint8_t kCtrlDeleted = 0xFE;
+
+inline constexpr std::size_t kFlatGroupWidth = 8;
+
+/**
+ * @brief Group of 8 control bytes matched at once with the bit tricks on a 64-bit word (SWAR), so the table does not
+ * depend on a particular SIMD instruction set. Every match is a mask with the high bit of the matching bytes set.
+ *
+ */
+struct FlatGroup {
+  static constexpr uint64_t kLsbs = 0x0101010101010101ULL;
+  static constexpr uint64_t kMsbs = 0x8080808080808080ULL;
+
+  explicit FlatGroup(const uint8_t* ctrl) {
+    std::memcpy(&bits, ctrl, sizeof(bits));
+    if constexpr (std::endian::native == std::endian::big) {
+      bits = std::byteswap(bits);
+    }
+  }
+
+  /**
+   * @brief May report a false positive right after a real match, the keys are compared anyway.
+   *
+   */
+  uint64_t match(uint8_t h2) const {
+    const auto x = bits ^ (kLsbs * h2);
+    return (x - kLsbs) & ~x & kMsbs;
+  }
+
+  uint64_t match_empty() const { return bits & (~bits << 6) & kMsbs; }
+  uint64_t match_empty_or_deleted() const { return bits & kMsbs; }
+
+  static std::size_t lowest(uint64_t mask) { return static_cast<std::size_t>(std::countr_zero(mask)) / 8; }
+
+  uint64_t bits;
+};
+
+template <bool TTransparent>
+struct FlatKeyArg {
+  template <typename TArg, typename TKey>
+  using type = TArg;
+};
+
+template <>
+struct FlatKeyArg<false> {
+  template <typename TArg, typename TKey>
+  using type = TKey;
+};
+
+template <typename TKey, typename TValue>
+struct FlatMapPolicy {
+  using key_type  = TKey;
+  using slot_type = std::pair<TKey, TValue>;
+
+  static constexpr bool kMutable = true;
+
+  static const TKey& key(const slot_type& slot) { return slot.first; }
+};
+
+template <typename TKey>
+struct FlatSetPolicy {
+  using key_type  = TKey;
+  using slot_type = TKey;
+
+  static constexpr bool kMutable = false;
+
+  static const TKey& key(const slot_type& slot) { return slot; }
+};
+
+/**
+ * @brief Open addressing hash table with the SwissTable layout: an array of control bytes next to an array of slots.
+ * A lookup hashes the key once, then scans the control bytes a group at a time and compares only the keys whose 7-bit
+ * hash matches. The elements are stored inline, so they move when the table grows.
+ *
+ */
+template <typename TPolicy, typename THash, typename TEq>
+class FlatHashTable {
+ public:
+  using key_type        = typename TPolicy::key_type;
+  using value_type      = typename TPolicy::slot_type;
+  using size_type       = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher          = THash;
+  using key_equal       = TEq;
+  using reference       = value_type&;
+  using const_reference = const value_type&;
+
+  template <bool TConst>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = typename TPolicy::slot_type;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = std::conditional_t<TConst || !TPolicy::kMutable, const value_type*, value_type*>;
+    using reference         = std::conditional_t<TConst || !TPolicy::kMutable, const value_type&, value_type&>;
+
+    Iterator() = default;
+    operator Iterator<true>() const  // NOLINT
+      requires(!TConst)
+    {
+      return Iterator<true>(ctrl_, slot_, end_);
+    }
+
+    reference operator*() const { return *slot_; }
+    pointer operator->() const { return slot_; }
+
+    Iterator& operator++() {
+      ++ctrl_;
+      ++slot_;
+      skip_free();
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const Iterator& other) const { return slot_ == other.slot_; }
+
+   private:
+    friend class FlatHashTable;
+    template <bool>
+    friend class Iterator;
+
+    Iterator(const uint8_t* ctrl, pointer slot, const uint8_t* end) : ctrl_(ctrl), slot_(slot), end_(end) {}
+
+    void skip_free() {
+      while (ctrl_ != end_ && (*ctrl_ & kCtrlEmpty) != 0) {
+        ++ctrl_;
+        ++slot_;
+      }
+    }
+
+    const uint8_t* ctrl_ = nullptr;
+    pointer slot_        = nullptr;
+    const uint8_t* end_  = nullptr;
+  };
+
+  using iterator       = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  FlatHashTable() = default;
+
+  FlatHashTable(const FlatHashTable& other)
+    requires(std::is_copy_constructible_v<value_type>)
+      : hash_(other.hash_), eq_(other.eq_) {
+    reserve(other.size_);
+    for (const auto& value : other) {
+      insert_unique(hash_of(TPolicy::key(value)), value);
+    }
+  }
+
+  FlatHashTable(FlatHashTable&& other) noexcept
+      : ctrl_(std::exchange(other.ctrl_, nullptr)),
+        slots_(std::exchange(other.slots_, nullptr)),
+        capacity_(std::exchange(other.capacity_, 0)),
+        size_(std::exchange(other.size_, 0)),
+        growth_left_(std::exchange(other.growth_left_, 0)),
+        hash_(std::move(other.hash_)),
+        eq_(std::move(other.eq_)) {}
+
+  FlatHashTable& operator=(const FlatHashTable& other)
+    requires(std::is_copy_constructible_v<value_type>)
+  {
+    if (this != &other) {
+      auto tmp = FlatHashTable(other);
+      *this    = std::move(tmp);
+    }
+    return *this;
+  }
+
+  FlatHashTable& operator=(FlatHashTable&& other) noexcept {
+    if (this != &other) {
+      destroy();
+      ctrl_        = std::exchange(other.ctrl_, nullptr);
+      slots_       = std::exchange(other.slots_, nullptr);
+      capacity_    = std::exchange(other.capacity_, 0);
+      size_        = std::exchange(other.size_, 0);
+      growth_left_ = std::exchange(other.growth_left_, 0);
+      hash_        = std::move(other.hash_);
+      eq_          = std::move(other.eq_);
+    }
+    return *this;
+  }
+
+  ~FlatHashTable() { destroy(); }
+
+  iterator begin() { return make_iterator<false>(0); }
+  iterator end() { return make_iterator<false>(capacity_); }
+  const_iterator begin() const { return make_iterator<true>(0); }
+  const_iterator end() const { return make_iterator<true>(capacity_); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_type capacity() const { return capacity_; }
+
+  /**
+   * @brief Destroys the elements, keeps the memory.
+   *
+   */
+  void clear() {
+    if (capacity_ == 0) {
+      return;
+    }
+    for (auto i = size_type{0}; i < capacity_; ++i) {
+      if (is_full(ctrl_[i])) {
+        std::destroy_at(slots_ + i);
+      }
+    }
+    std::memset(ctrl_, kCtrlEmpty, capacity_ + kFlatGroupWidth);
+    size_        = 0;
+    growth_left_ = max_load(capacity_);
+  }
+
+  /**
+   * @brief Makes room for `count` elements without a rehash.
+   *
+   */
+  void reserve(size_type count) {
+    if (count > max_load(capacity_)) {
+      rehash(capacity_for(count));
+    }
+  }
+
+ protected:
+  /**
+   * @brief With a transparent hash and equality the lookups accept any key type they accept. The iterators are
+   * excluded, so that `erase(it)` does not match the lookup overloads.
+   *
+   */
+  template <typename TKey>
+  static constexpr bool kHeterogeneous = requires {
+    typename THash::is_transparent;
+    typename TEq::is_transparent;
+  } && !std::is_convertible_v<const TKey&, const_iterator>;
+
+ public:
+  iterator find(const key_type& key) { return make_iterator<false>(find_index(key, hash_of(key))); }
+  const_iterator find(const key_type& key) const { return make_iterator<true>(find_index(key, hash_of(key))); }
+  bool contains(const key_type& key) const { return find_index(key, hash_of(key)) != capacity_; }
+  size_type count(const key_type& key) const { return contains(key) ? 1 : 0; }
+  size_type erase(const key_type& key) { return erase_key(key); }
+
+  template <typename TKey>
+    requires(kHeterogeneous<TKey>)
+  iterator find(const TKey& key) {
+    return make_iterator<false>(find_index(key, hash_of(key)));
+  }
+
+  template <typename TKey>
+    requires(kHeterogeneous<TKey>)
+  const_iterator find(const TKey& key) const {
+    return make_iterator<true>(find_index(key, hash_of(key)));
+  }
+
+  template <typename TKey>
+    requires(kHeterogeneous<TKey>)
+  bool contains(const TKey& key) const {
+    return find_index(key, hash_of(key)) != capacity_;
+  }
+
+  template <typename TKey>
+    requires(kHeterogeneous<TKey>)
+  size_type count(const TKey& key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  template <typename TKey>
+    requires(kHeterogeneous<TKey>)
+  size_type erase(const TKey& key) {
+    return erase_key(key);
+  }
+
+  /**
+   * @brief Erasing does not move the other elements, so the table can be erased from while it is iterated.
+   *
+   */
+  iterator erase(const_iterator pos) {
+    const auto index = static_cast<size_type>(pos.ctrl_ - ctrl_);
+    erase_index(index);
+    auto next = make_iterator<false>(index);
+    next.skip_free();
+    return next;
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return emplace_unique(TPolicy::key(value),
+                          [&](value_type* slot) { ::new (static_cast<void*>(slot)) value_type(value); });
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return emplace_unique(TPolicy::key(value),
+                          [&](value_type* slot) { ::new (static_cast<void*>(slot)) value_type(std::move(value)); });
+  }
+
+  template <std::input_iterator TIt>
+  void insert(TIt first, TIt last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  void insert(std::initializer_list<value_type> init) { insert(init.begin(), init.end()); }
+
+  /**
+   * @brief The element is constructed before the lookup, `try_emplace()` of the map avoids it.
+   *
+   */
+  template <typename... TArgs>
+  std::pair<iterator, bool> emplace(TArgs&&... args) {
+    return insert(value_type(std::forward<TArgs>(args)...));
+  }
+
+  friend bool operator==(const FlatHashTable& lhs, const FlatHashTable& rhs) {
+    if (lhs.size_ != rhs.size_) {
+      return false;
+    }
+    for (const auto& value : lhs) {
+      auto it = rhs.find(TPolicy::key(value));
+      if (it == rhs.end() || !(*it == value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ protected:
+  /**
+   * @brief Finds the key or constructs a new element in its slot with `construct(value_type*)`.
+   *
+   */
+  template <typename TKey, typename TConstruct>
+  std::pair<iterator, bool> emplace_unique(const TKey& key, TConstruct&& construct) {
+    const auto hash = hash_of(key);
+    if (const auto index = find_index(key, hash); index != capacity_) {
+      return {make_iterator<false>(index), false};
+    }
+    const auto index = prepare_insert(hash);
+    construct(slots_ + index);
+    set_ctrl(index, h2(hash));
+    ++size_;
+    return {make_iterator<false>(index), true};
+  }
+
+  template <typename TKey>
+  size_type erase_key(const TKey& key) {
+    const auto index = find_index(key, hash_of(key));
+    if (index == capacity_) {
+      return 0;
+    }
+    erase_index(index);
+    return 1;
+  }
+
+  template <typename TKey>
+  size_type find_index(const TKey& key, size_t hash) const {
+    if (capacity_ == 0) {
+      return 0;
+    }
+
+    const auto mask = capacity_ - 1;
+    auto pos        = h1(hash) & mask;
+    auto step       = size_type{0};
+    while (true) {
+      const auto group = FlatGroup(ctrl_ + pos);
+      for (auto match = group.match(h2(hash)); match != 0; match &= match - 1) {
+        const auto index = (pos + FlatGroup::lowest(match)) & mask;
+        if (eq_(TPolicy::key(slots_[index]), key)) {
+          return index;
+        }
+      }
+      if (group.match_empty() != 0) {
+        return capacity_;
+      }
+      // Triangular probing visits every group of a power of two table
+      step += kFlatGroupWidth;
+      pos   = (pos + step) & mask;
+    }
+  }
+
+  template <typename TKey>
+  size_t hash_of(const TKey& key) const {
+    // The standard hashes of the integers and pointers are the identity, so the bits are mixed before they are split
+    // into the probe start and the 7-bit control hash
+    auto hash  = static_cast<uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ULL;
+    hash      ^= hash >> 32;
+    return static_cast<size_t>(hash);
+  }
+
+  template <bool TConst>
+  Iterator<TConst> make_iterator(size_type index) const {
+    if (capacity_ == 0) {
+      return Iterator<TConst>(nullptr, nullptr, nullptr);
+    }
+    auto it = Iterator<TConst>(ctrl_ + index, slots_ + index, ctrl_ + capacity_);
+    if (index == 0) {
+      it.skip_free();
+    }
+    return it;
+  }
+
+ private:
+  static bool is_full(uint8_t ctrl) { return (ctrl & kCtrlEmpty) == 0; }
+  static size_t h1(size_t hash) { return hash >> 7; }
+  static uint8_t h2(size_t hash) { return static_cast<uint8_t>(hash & 0x7F); }
+
+  /**
+   * @brief The load factor is kept at 7/8, so the probing always ends at an empty slot.
+   *
+   */
+  static size_type max_load(size_type capacity) { return capacity - capacity / 8; }
+
+  static size_type capacity_for(size_type count) {
+    auto capacity = std::max(kFlatGroupWidth, std::bit_ceil(count));
+    while (max_load(capacity) < count) {
+      capacity *= 2;
+    }
+    return capacity;
+  }
+
+  /**
+   * @brief The first group of control bytes is mirrored after the last slot, so a group can be loaded at any slot.
+   *
+   */
+  void set_ctrl(size_type index, uint8_t value) {
+    ctrl_[index]                                                           = value;
+    ctrl_[((index - kFlatGroupWidth) & (capacity_ - 1)) + kFlatGroupWidth] = value;
+  }
+
+  size_type find_free_index(size_t hash) const {
+    const auto mask = capacity_ - 1;
+    auto pos        = h1(hash) & mask;
+    auto step       = size_type{0};
+    while (true) {
+      const auto group = FlatGroup(ctrl_ + pos);
+      if (const auto match = group.match_empty_or_deleted(); match != 0) {
+        return (pos + FlatGroup::lowest(match)) & mask;
+      }
+      step += kFlatGroupWidth;
+      pos   = (pos + step) & mask;
+    }
+  }
+
+  size_type prepare_insert(size_t hash) {
+    if (growth_left_ == 0) {
+      // A table full of tombstones is only cleaned up, it grows once it is really full
+      rehash(size_ < max_load(capacity_) / 2 ? capacity_ : capacity_for(size_ + 1));
+    }
+    const auto index = find_free_index(hash);
+    if (ctrl_[index] == kCtrlEmpty) {
+      --growth_left_;
+    }
+    return index;
+  }
+
+  void insert_unique(size_t hash, const value_type& value) {
+    const auto index = prepare_insert(hash);
+    ::new (static_cast<void*>(slots_ + index)) value_type(value);
+    set_ctrl(index, h2(hash));
+    ++size_;
+  }
+
+  void erase_index(size_type index) {
+    std::destroy_at(slots_ + index);
+    --size_;
+
+    // The slot may be on the probe path of another key, unless its group has never been full
+    const auto mask        = capacity_ - 1;
+    const auto before      = FlatGroup(ctrl_ + ((index - kFlatGroupWidth) & mask)).match_empty();
+    const auto after       = FlatGroup(ctrl_ + index).match_empty();
+    const auto empty_after = after == 0 ? kFlatGroupWidth : FlatGroup::lowest(after);
+    const auto empty_before = before == 0 ? kFlatGroupWidth : static_cast<size_type>(std::countl_zero(before)) / 8;
+    if (empty_before + empty_after < kFlatGroupWidth) {
+      set_ctrl(index, kCtrlEmpty);
+      ++growth_left_;
+    } else {
+      set_ctrl(index, kCtrlDeleted);
+    }
+  }
+
+  void rehash(size_type new_capacity) {
+    auto* old_ctrl     = ctrl_;
+    auto* old_slots    = slots_;
+    const auto old_cap = capacity_;
+
+    ctrl_        = std::allocator<uint8_t>().allocate(new_capacity + kFlatGroupWidth);
+    slots_       = std::allocator<value_type>().allocate(new_capacity);
+    capacity_    = new_capacity;
+    growth_left_ = max_load(new_capacity) - size_;
+    std::memset(ctrl_, kCtrlEmpty, new_capacity + kFlatGroupWidth);
+
+    for (auto i = size_type{0}; i < old_cap; ++i) {
+      if (is_full(old_ctrl[i])) {
+        const auto hash  = hash_of(TPolicy::key(old_slots[i]));
+        const auto index = find_free_index(hash);
+        ::new (static_cast<void*>(slots_ + index)) value_type(std::move(old_slots[i]));
+        std::destroy_at(old_slots + i);
+        set_ctrl(index, h2(hash));
+      }
+    }
+
+    if (old_cap != 0) {
+      std::allocator<uint8_t>().deallocate(old_ctrl, old_cap + kFlatGroupWidth);
+      std::allocator<value_type>().deallocate(old_slots, old_cap);
+    }
+  }
+
+  void destroy() {
+    if (capacity_ == 0) {
+      return;
+    }
+    clear();
+    std::allocator<uint8_t>().deallocate(ctrl_, capacity_ + kFlatGroupWidth);
+    std::allocator<value_type>().deallocate(slots_, capacity_);
+    ctrl_        = nullptr;
+    slots_       = nullptr;
+    capacity_    = 0;
+    growth_left_ = 0;
+  }
+
+  uint8_t* ctrl_         = nullptr;
+  value_type* slots_     = nullptr;
+  size_type capacity_    = 0;
+  size_type size_        = 0;
+  size_type growth_left_ = 0;
+  [[no_unique_address]] THash hash_;
+  [[no_unique_address]] TEq eq_;
+};
+
+}  // namespace internal
+
+/**
+ * @brief Flat open addressing hash map (SwissTable layout), the replacement of `std::unordered_map` for the lookups on
+ * the hot paths. The entries live in a single array, so the lookups and the iteration do not chase the node pointers.
+ *
+ * With a transparent hash and equality (e.g. `util::StringHash` and `std::equal_to<>`) the map is looked up with any
+ * comparable key, e.g. a `std::string` keyed map with `std::string_view`, without constructing the key.
+ *
+ * @warning Unlike `std::unordered_map`, the `value_type` is `std::pair<TKey, TValue>` and its key must not be
+ * modified. Growing the map invalidates the iterators and the references to the elements, erasing does not.
+ *
+ */
+template <typename TKey, typename TValue, typename THash = std::hash<TKey>, typename TEq = std::equal_to<TKey>>
+class FlatHashMap : public internal::FlatHashTable<internal::FlatMapPolicy<TKey, TValue>, THash, TEq> {
+  using Base = internal::FlatHashTable<internal::FlatMapPolicy<TKey, TValue>, THash, TEq>;
+
+ public:
+  using mapped_type = TValue;
+  using typename Base::const_iterator;
+  using typename Base::iterator;
+  using typename Base::value_type;
+
+  FlatHashMap() = default;
+  FlatHashMap(std::initializer_list<value_type> init) { Base::insert(init); }
+
+  template <typename TArg = TKey, typename... TArgs>
+  std::pair<iterator, bool> try_emplace(TArg&& key, TArgs&&... args) {
+    return Base::emplace_unique(key, [&](value_type* slot) {
+      ::new (static_cast<void*>(slot))
+          value_type(std::piecewise_construct, std::forward_as_tuple(std::forward<TArg>(key)),
+                     std::forward_as_tuple(std::forward<TArgs>(args)...));
+    });
+  }
+
+  template <typename TArg = TKey, typename TMapped>
+  std::pair<iterator, bool> insert_or_assign(TArg&& key, TMapped&& value) {
+    auto result = try_emplace(std::forward<TArg>(key), std::forward<TMapped>(value));
+    if (!result.second) {
+      result.first->second = std::forward<TMapped>(value);
+    }
+    return result;
+  }
+
+  template <typename TArg = TKey>
+  TValue& operator[](TArg&& key) {
+    return try_emplace(std::forward<TArg>(key)).first->second;
+  }
+
+  TValue& at(const TKey& key) { return at_impl(*this, key); }
+  const TValue& at(const TKey& key) const { return at_impl(*this, key); }
+
+  template <typename TArg>
+    requires(Base::template kHeterogeneous<TArg>)
+  TValue& at(const TArg& key) {
+    return at_impl(*this, key);
+  }
+
+  template <typename TArg>
+    requires(Base::template kHeterogeneous<TArg>)
+  const TValue& at(const TArg& key) const {
+    return at_impl(*this, key);
+  }
+
+ private:
+  template <typename TSelf, typename TArg>
+  static auto& at_impl(TSelf& self, const TArg& key) {
+    auto it = self.find(key);
+    if (it == self.end()) {
+      throw std::out_of_range("FlatHashMap::at: key not found");
+    }
+    return it->second;
+  }
+};
+
+/**
+ * @brief Flat open addressing hash set, see `FlatHashMap`. The elements are immutable through the iterators.
+ *
+ */
+template <typename TKey, typename THash = std::hash<TKey>, typename TEq = std::equal_to<TKey>>
+class FlatHashSet : public internal::FlatHashTable<internal::FlatSetPolicy<TKey>, THash, TEq> {
+  using Base = internal::FlatHashTable<internal::FlatSetPolicy<TKey>, THash, TEq>;
+
+ public:
+  using typename Base::value_type;
+
+  FlatHashSet() = default;
+  FlatHashSet(std::initializer_list<value_type> init) { Base::insert(init); }
+};
+
+}  // namespace eray::util
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace eray::util {
+
+/**
+ * @brief Caps the frame rate by waiting for the start of every frame. The OS sleep wakes up late by up to a scheduler
+ * quantum, so the limiter sleeps until a margin before the deadline and spins for the rest of it. The margin follows
+ * the oversleep measured on the machine.
+ *
+ * The deadlines advance by the frame interval, so a frame that started a little late is followed by a shorter wait. A
+ * frame later than the whole interval restarts the deadlines instead of being followed by a burst of frames.
+ *
+ */
+class FrameLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr auto kMinSpinMargin = std::chrono::microseconds(100);
+  static constexpr auto kMaxSpinMargin = std::chrono::milliseconds(4);
+
+  /**
+   * @brief Frames per second, 0 disables the limiter.
+   *
+   */
+  void set_frame_rate(float frame_rate) {
+    frame_rate_ = std::max(frame_rate, 0.0F);
+    interval_   = frame_rate_ > 0.0F ? std::chrono::duration_cast<Clock::duration>(
+                                         std::chrono::duration<double>(1.0 / static_cast<double>(frame_rate_)))
+                                   : Clock::duration::zero();
+  }
+  float frame_rate() const { return frame_rate_; }
+  bool is_enabled() const { return interval_ > Clock::duration::zero(); }
+
+  /**
+   * @brief Estimated oversleep of the OS, the last part of the wait that is spun.
+   *
+   */
+  Clock::duration spin_margin() const { return spin_margin_; }
+
+  /**
+   * @brief Waits until the start of the next frame. The `sleep_until` callable sleeps the coarse part of the wait, e.g.
+   * so that the caller keeps polling the input.
+   *
+   */
+  template <typename SleepUntil>
+  void wait(SleepUntil&& sleep_until) {
+    if (!is_enabled()) {
+      return;
+    }
+
+    auto now   = Clock::now();
+    deadline_ += interval_;
+    if (deadline_ + interval_ < now) {
+      deadline_ = now;
+      return;
+    }
+
+    if (const auto wake_up = deadline_ - spin_margin_; wake_up > now) {
+      sleep_until(wake_up);
+      now = Clock::now();
+
+      // Grows right away to the observed oversleep and shrinks slowly, the sleep that overshoots the deadline costs a
+      // late frame
+      const auto oversleep = now - wake_up;
+      spin_margin_         = std::clamp<Clock::duration>(std::max<Clock::duration>(oversleep, spin_margin_ * 15 / 16),
+                                                         kMinSpinMargin, kMaxSpinMargin);
+    }
+
+    while (now < deadline_) {
+      std::this_thread::yield();
+      now = Clock::now();
+    }
+  }
+
+  void wait() {
+    wait([](Clock::time_point time) { std::this_thread::sleep_until(time); });
+  }
+
+ private:
+  float frame_rate_ = 0.0F;
+  Clock::duration interval_{};
+  Clock::time_point deadline_{};
+  Clock::duration spin_margin_ = std::chrono::milliseconds(1);
+};
+
+}  // namespace eray::util
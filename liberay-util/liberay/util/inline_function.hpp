@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace eray::util {
+
+template <typename TSignature, std::size_t TCapacity = 4 * sizeof(void*)>
+class InlineFunction;
+
+/**
+ * @brief Owning, copyable type-erased callable, similar to `std::function`, that always stores the callable in its
+ * inline buffer. It never allocates, callables that do not fit into `TCapacity` bytes are rejected at compile time.
+ * Moved from functions are empty.
+ *
+ * @tparam TReturn
+ * @tparam TArgs
+ * @tparam TCapacity Size of the inline buffer in bytes.
+ */
+template <typename TReturn, typename... TArgs, std::size_t TCapacity>
+class InlineFunction<TReturn(TArgs...), TCapacity> {
+ public:
+  InlineFunction() = default;
+  InlineFunction(std::nullptr_t) {}  // NOLINT
+
+  template <typename TFunc>
+    requires(!std::is_same_v<std::remove_cvref_t<TFunc>, InlineFunction> &&
+             std::is_invocable_r_v<TReturn, std::remove_cvref_t<TFunc>&, TArgs...>)
+  InlineFunction(TFunc&& func)  // NOLINT
+  {
+    using Callable = std::remove_cvref_t<TFunc>;
+    static_assert(sizeof(Callable) <= TCapacity, "Callable does not fit into the inline buffer");
+    static_assert(alignof(Callable) <= alignof(std::max_align_t), "Callable is over-aligned");
+    static_assert(std::is_nothrow_move_constructible_v<Callable>, "Callable must be nothrow move constructible");
+    static_assert(std::is_copy_constructible_v<Callable>, "Callable must be copy constructible");
+
+    ::new (static_cast<void*>(buffer_)) Callable(std::forward<TFunc>(func));
+    invoke_ = &invoke_impl<Callable>;
+    ops_    = &kOps<Callable>;
+  }
+
+  InlineFunction(const InlineFunction& other) : invoke_(other.invoke_), ops_(other.ops_) {
+    if (ops_) {
+      ops_->copy(buffer_, other.buffer_);
+    }
+  }
+
+  InlineFunction(InlineFunction&& other) noexcept : invoke_(other.invoke_), ops_(other.ops_) {
+    if (ops_) {
+      ops_->move(buffer_, other.buffer_);
+      other.reset();
+    }
+  }
+
+  InlineFunction& operator=(const InlineFunction& other) {
+    if (this != &other) {
+      auto tmp = InlineFunction(other);
+      *this    = std::move(tmp);
+    }
+    return *this;
+  }
+
+  InlineFunction& operator=(InlineFunction&& other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other.ops_) {
+        other.ops_->move(buffer_, other.buffer_);
+        invoke_ = other.invoke_;
+        ops_    = other.ops_;
+        other.reset();
+      }
+    }
+    return *this;
+  }
+
+  InlineFunction& operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  ~InlineFunction() { reset(); }
+
+  /**
+   * @brief Invokes the stored callable. Calling an empty function is undefined behavior.
+   *
+   */
+  TReturn operator()(TArgs... args) const {
+    return invoke_(const_cast<std::byte*>(buffer_), std::forward<TArgs>(args)...);  // NOLINT
+  }
+
+  explicit operator bool() const noexcept { return invoke_ != nullptr; }
+
+  void reset() noexcept {
+    if (ops_) {
+      ops_->destroy(buffer_);
+    }
+    invoke_ = nullptr;
+    ops_    = nullptr;
+  }
+
+ private:
+  struct Ops {
+    void (*copy)(std::byte* dst, const std::byte* src);
+    void (*move)(std::byte* dst, std::byte* src) noexcept;
+    void (*destroy)(std::byte* buffer) noexcept;
+  };
+
+  template <typename TCallable>
+  static TReturn invoke_impl(std::byte* buffer, TArgs... args) {
+    return std::invoke(*std::launder(reinterpret_cast<TCallable*>(buffer)), std::forward<TArgs>(args)...);
+  }
+
+  template <typename TCallable>
+  static constexpr Ops kOps = Ops{
+      .copy = [](std::byte* dst, const std::byte* src) {
+        ::new (static_cast<void*>(dst)) TCallable(*std::launder(reinterpret_cast<const TCallable*>(src)));
+      },
+      .move = [](std::byte* dst, std::byte* src) noexcept {
+        ::new (static_cast<void*>(dst)) TCallable(std::move(*std::launder(reinterpret_cast<TCallable*>(src))));
+      },
+      .destroy =
+          [](std::byte* buffer) noexcept { std::destroy_at(std::launder(reinterpret_cast<TCallable*>(buffer))); },
+  };
+
+  // The invoker is stored directly, so that calling the function costs a single indirect call.
+  TReturn (*invoke_)(std::byte*, TArgs...) = nullptr;
+  const Ops* ops_                          = nullptr;
+  alignas(std::max_align_t) std::byte buffer_[TCapacity]{};  // NOLINT
+};
+
+}  // namespace eray::util
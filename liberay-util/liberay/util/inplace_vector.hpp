@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+namespace eray::util {
+
+/**
+ * @brief Vector with a fixed capacity, the elements are stored inline and it never allocates. Similar to the C++26
+ * `std::inplace_vector`, but exceeding the capacity is a precondition violation (asserted) instead of an exception,
+ * `try_push_back()` reports it instead.
+ *
+ * Meant for the arrays with a hard upper bound, e.g. the color attachments of a render pass.
+ *
+ * @tparam T
+ * @tparam N Capacity.
+ */
+template <typename T, std::size_t N>
+class InplaceVector {
+  static_assert(N > 0, "InplaceVector capacity must be positive");
+
+ public:
+  using value_type      = T;
+  using size_type       = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = T&;
+  using const_reference = const T&;
+  using pointer         = T*;
+  using const_pointer   = const T*;
+  using iterator        = T*;
+  using const_iterator  = const T*;
+
+  InplaceVector() = default;
+
+  InplaceVector(std::initializer_list<T> init) {
+    assert(init.size() <= N && "InplaceVector capacity exceeded");
+    std::uninitialized_copy(init.begin(), init.end(), data());
+    size_ = init.size();
+  }
+
+  template <std::input_iterator TIt>
+  InplaceVector(TIt first, TIt last) {
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  InplaceVector(const InplaceVector& other)
+    requires(std::is_copy_constructible_v<T>)
+  {
+    std::uninitialized_copy(other.begin(), other.end(), data());
+    size_ = other.size_;
+  }
+
+  InplaceVector(InplaceVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    std::uninitialized_move(other.begin(), other.end(), data());
+    size_ = other.size_;
+    other.clear();
+  }
+
+  InplaceVector& operator=(const InplaceVector& other)
+    requires(std::is_copy_constructible_v<T>)
+  {
+    if (this != &other) {
+      clear();
+      std::uninitialized_copy(other.begin(), other.end(), data());
+      size_ = other.size_;
+    }
+    return *this;
+  }
+
+  InplaceVector& operator=(InplaceVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      clear();
+      std::uninitialized_move(other.begin(), other.end(), data());
+      size_ = other.size_;
+      other.clear();
+    }
+    return *this;
+  }
+
+  ~InplaceVector() { clear(); }
+
+  template <typename... TArgs>
+  T& emplace_back(TArgs&&... args) {
+    assert(size_ < N && "InplaceVector capacity exceeded");
+    auto* result = ::new (static_cast<void*>(data() + size_)) T(std::forward<TArgs>(args)...);
+    ++size_;
+    return *result;
+  }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  /**
+   * @brief Appends the element if there is room for it.
+   *
+   * @return T* The new element or `nullptr` when the vector is full.
+   */
+  template <typename... TArgs>
+  T* try_emplace_back(TArgs&&... args) {
+    if (size_ == N) {
+      return nullptr;
+    }
+    return &emplace_back(std::forward<TArgs>(args)...);
+  }
+
+  T* try_push_back(const T& value) { return try_emplace_back(value); }
+  T* try_push_back(T&& value) { return try_emplace_back(std::move(value)); }
+
+  void pop_back() {
+    assert(size_ > 0 && "InplaceVector is empty");
+    std::destroy_at(data() + --size_);
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    auto* dst = begin() + (first - begin());
+    auto* src = begin() + (last - begin());
+    if (first != last) {
+      auto* new_end = std::move(src, end(), dst);
+      std::destroy(new_end, end());
+      size_ = static_cast<size_type>(new_end - begin());
+    }
+    return dst;
+  }
+
+  void resize(size_type count) {
+    assert(count <= N && "InplaceVector capacity exceeded");
+    if (count < size_) {
+      std::destroy(begin() + count, end());
+    } else {
+      std::uninitialized_value_construct(end(), begin() + count);
+    }
+    size_ = count;
+  }
+
+  void clear() noexcept {
+    std::destroy(begin(), end());
+    size_ = 0;
+  }
+
+  T* data() noexcept { return reinterpret_cast<T*>(storage_); }
+  const T* data() const noexcept { return reinterpret_cast<const T*>(storage_); }
+
+  size_type size() const noexcept { return size_; }
+  static constexpr size_type capacity() noexcept { return N; }
+  static constexpr size_type max_size() noexcept { return N; }
+  bool empty() const noexcept { return size_ == 0; }
+  bool full() const noexcept { return size_ == N; }
+
+  T& operator[](size_type i) {
+    assert(i < size_ && "InplaceVector index out of range");
+    return data()[i];
+  }
+  const T& operator[](size_type i) const {
+    assert(i < size_ && "InplaceVector index out of range");
+    return data()[i];
+  }
+
+  T& front() { return (*this)[0]; }
+  const T& front() const { return (*this)[0]; }
+  T& back() { return (*this)[size_ - 1]; }
+  const T& back() const { return (*this)[size_ - 1]; }
+
+  iterator begin() noexcept { return data(); }
+  const_iterator begin() const noexcept { return data(); }
+  iterator end() noexcept { return data() + size_; }
+  const_iterator end() const noexcept { return data() + size_; }
+
+  friend bool operator==(const InplaceVector& lhs, const InplaceVector& rhs) {
+    return std::ranges::equal(lhs, rhs);
+  }
+
+ private:
+  alignas(T) std::byte storage_[N * sizeof(T)];  // NOLINT
+  size_type size_ = 0;
+};
+
+}  // namespace eray::util
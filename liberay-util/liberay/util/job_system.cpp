@@ -0,0 +1,158 @@
+#include <liberay/util/job_system.hpp>
+#include <liberay/util/profiler.hpp>
+#include <optional>
+#include <utility>
+
+namespace eray::util {
+
+namespace {
+
+/**
+ * @brief Set on the worker threads, the jobs spawned by a worker go to its own queue.
+ *
+ */
+thread_local const JobSystem* current_system = nullptr;
+thread_local uint32_t current_worker         = 0;
+
+}  // namespace
+
+JobSystem::JobSystem(uint32_t worker_count) : worker_count_(worker_count) {
+  queues_.reserve(worker_count);
+  for (auto i = 0U; i < worker_count; ++i) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+
+  workers_.reserve(worker_count);
+  for (auto i = 0U; i < worker_count; ++i) {
+    workers_.emplace_back([this, i](const std::stop_token& stop_token) { worker_loop(stop_token, i); });
+  }
+}
+
+JobSystem::~JobSystem() {
+  for (auto& worker : workers_) {
+    worker.request_stop();
+  }
+  wake_.notify_all();
+  workers_.clear();
+}
+
+std::unique_ptr<JobSystem> JobSystem::create(uint32_t worker_count) {
+  if (worker_count == 0) {
+    worker_count = std::max(std::thread::hardware_concurrency(), 2U) - 1;
+  }
+  return std::unique_ptr<JobSystem>(new JobSystem(worker_count));
+}
+
+bool JobSystem::is_worker_thread() { return current_system != nullptr; }
+
+uint32_t JobSystem::thread_index() const { return current_system == this ? current_worker : worker_count_; }
+
+void JobSystem::run(Job&& job, JobCounter& counter) {
+  counter.pending_.fetch_add(1, std::memory_order_relaxed);
+  push(Task{.job = std::move(job), .counter = &counter});
+}
+
+void JobSystem::run(Job&& job) { push(Task{.job = std::move(job), .counter = nullptr}); }
+
+void JobSystem::push(Task&& task) {
+  {
+    // Incremented under the lock, so that a worker cannot miss the wake up between checking and starting to sleep.
+    // Incremented before the push, so that a steal never observes a job that is not counted yet.
+    auto lock = std::scoped_lock(sleep_mutex_);
+    queued_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  const auto index = current_system == this
+                         ? current_worker
+                         : next_queue_.fetch_add(1, std::memory_order_relaxed) % worker_count();
+  {
+    auto& queue = *queues_[index];
+    auto lock   = std::scoped_lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  wake_.notify_one();
+}
+
+bool JobSystem::try_run_one() {
+  const auto is_worker = current_system == this;
+  const auto own       = is_worker ? current_worker : 0U;
+
+  auto task = std::optional<Task>();
+  if (is_worker) {
+    auto& queue = *queues_[own];
+    auto lock   = std::scoped_lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+  }
+
+  // The front holds the oldest, usually the largest, jobs
+  for (auto i = 1U; !task && i <= worker_count(); ++i) {
+    auto& queue = *queues_[(own + i) % worker_count()];
+    auto lock   = std::scoped_lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+  }
+
+  if (!task) {
+    return false;
+  }
+
+  queued_.fetch_sub(1, std::memory_order_relaxed);
+  {
+    ERAY_PROFILE_SCOPE("Job");
+    task->job();
+  }
+  if (task->counter) {
+    auto& counter      = *task->counter;
+    const auto pending = counter.pending_.fetch_sub(1, std::memory_order_acq_rel);
+    if (pending == (JobCounter::kAwaitedBit | 1U)) {
+      // The awaiting coroutine is suspended until it is resumed here, so the counter is still alive
+      const auto continuation = std::exchange(counter.continuation_, nullptr);
+      counter.pending_.store(0, std::memory_order_release);
+      continuation.resume();
+    }
+  }
+  return true;
+}
+
+bool JobCounter::Awaiter::await_suspend(std::coroutine_handle<> continuation) {
+  counter_->continuation_ = continuation;
+  const auto pending      = counter_->pending_.fetch_or(kAwaitedBit, std::memory_order_acq_rel);
+  if ((pending & kCountMask) == 0) {
+    // The last job finished in the meantime, it has not seen the awaiter
+    counter_->continuation_ = nullptr;
+    counter_->pending_.fetch_and(kCountMask, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void JobSystem::wait(const JobCounter& counter) {
+  while (!counter.is_done()) {
+    if (!try_run_one()) {
+      // The remaining jobs are being executed by the other threads
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::worker_loop(const std::stop_token& stop_token, uint32_t index) {
+  current_system = this;
+  current_worker = index;
+  ERAY_PROFILE_THREAD_NAME("Job worker");
+
+  while (!stop_token.stop_requested()) {
+    if (try_run_one()) {
+      continue;
+    }
+
+    auto lock = std::unique_lock(sleep_mutex_);
+    wake_.wait(lock, stop_token, [this]() { return queued_.load(std::memory_order_acquire) > 0; });
+  }
+}
+
+}  // namespace eray::util
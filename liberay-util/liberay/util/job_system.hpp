@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace eray::util {
+
+/**
+ * @brief Counts the jobs that have not finished yet. A parent job waits for its children with
+ * `JobSystem::wait(counter)`, a coroutine with `co_await counter.completion()`.
+ *
+ * @warning The counter must outlive the jobs it counts.
+ *
+ */
+class JobCounter {
+ public:
+  JobCounter() = default;
+
+  JobCounter(const JobCounter&)            = delete;
+  JobCounter& operator=(const JobCounter&) = delete;
+
+  bool is_done() const { return (pending_.load(std::memory_order_acquire) & kCountMask) == 0; }
+  uint32_t pending() const { return pending_.load(std::memory_order_relaxed) & kCountMask; }
+
+  /**
+   * @brief Suspends the awaiting coroutine until the counted jobs are done, without blocking the thread. The coroutine
+   * is resumed by the thread that finishes the last job.
+   *
+   */
+  class Awaiter {
+   public:
+    explicit Awaiter(JobCounter& counter) : counter_(&counter) {}
+
+    bool await_ready() const { return counter_->is_done(); }
+    bool await_suspend(std::coroutine_handle<> continuation);
+    void await_resume() const {}
+
+   private:
+    JobCounter* counter_;
+  };
+
+  /**
+   * @brief Awaitable completion of the counted jobs.
+   *
+   * @warning Only a single coroutine may await the counter at a time and no jobs may be added to the counter by the
+   * other threads while it is awaited.
+   *
+   */
+  Awaiter completion() { return Awaiter(*this); }
+
+ private:
+  friend class JobSystem;
+
+  /**
+   * @brief Set in `pending_` while a coroutine awaits the counter. It is set and the count is decremented by atomic
+   * read-modify-write operations of the same variable, so the last job either sees the awaiter or the awaiter sees
+   * the count drop to zero, and the counter is not accessed by the last job unless a coroutine is suspended on it.
+   *
+   */
+  static constexpr uint32_t kAwaitedBit = 1U << 31;
+  static constexpr uint32_t kCountMask  = kAwaitedBit - 1;
+
+  std::atomic<uint32_t> pending_ = 0;
+  std::coroutine_handle<> continuation_;
+};
+
+/**
+ * @brief Work-stealing thread pool. Every worker owns a deque, the jobs spawned by a worker are pushed to and popped
+ * from the back of its deque (the most recent job is hot in the cache), the idle workers steal from the front of the
+ * other deques. The jobs submitted by the other threads are distributed between the workers.
+ *
+ * Waiting on a counter never blocks the thread, the waiting thread runs the queued jobs in the meantime, so the jobs
+ * may fork and join recursively without starving the pool.
+ *
+ * @warning Jobs must not throw.
+ *
+ */
+class JobSystem {
+ public:
+  using Job = std::move_only_function<void()>;
+
+  JobSystem(const JobSystem&)            = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+  JobSystem(JobSystem&&)                 = delete;
+  JobSystem& operator=(JobSystem&&)      = delete;
+
+  ~JobSystem();
+
+  /**
+   * @brief Starts the workers.
+   *
+   * @param worker_count Number of the worker threads, 0 picks one fewer than the hardware threads. Prefer
+   * `os::System::recommended_worker_count()`, which skips the hyper-threads.
+   * @return std::unique_ptr<JobSystem>
+   */
+  [[nodiscard]] static std::unique_ptr<JobSystem> create(uint32_t worker_count = 0);
+
+  /**
+   * @brief Queues the job. The `counter` is incremented now and decremented when the job finishes.
+   *
+   * @param job
+   * @param counter
+   */
+  void run(Job&& job, JobCounter& counter);
+
+  /**
+   * @brief Queues the job without tracking its completion.
+   *
+   * @param job
+   */
+  void run(Job&& job);
+
+  /**
+   * @brief Resumes the awaiting coroutine as a job, e.g. `co_await jobs.schedule()` moves the rest of a coroutine to
+   * the workers.
+   *
+   */
+  class ScheduleAwaiter {
+   public:
+    explicit ScheduleAwaiter(JobSystem& jobs) : jobs_(&jobs) {}
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> continuation) {
+      jobs_->run([continuation]() { continuation.resume(); });
+    }
+    void await_resume() const {}
+
+   private:
+    JobSystem* jobs_;
+  };
+
+  ScheduleAwaiter schedule() { return ScheduleAwaiter(*this); }
+
+  /**
+   * @brief Runs the queued jobs until all of the jobs counted by the `counter` are done.
+   *
+   * @param counter
+   */
+  void wait(const JobCounter& counter);
+
+  /**
+   * @brief Calls `func(i)` for every i in [begin, end) and waits for all of the calls. The range is split into chunks
+   * of `grain` indices, each chunk is a single job.
+   *
+   * @param begin
+   * @param end
+   * @param func Invoked concurrently.
+   * @param grain Number of the indices per job, 0 splits the range into a few chunks per worker.
+   */
+  template <typename TFunc>
+    requires std::is_invocable_v<TFunc&, size_t>
+  void parallel_for(size_t begin, size_t end, TFunc&& func, size_t grain = 0) {
+    if (begin >= end) {
+      return;
+    }
+
+    const auto count = end - begin;
+    if (grain == 0) {
+      grain = std::max<size_t>(count / (static_cast<size_t>(worker_count()) * kChunksPerWorker), 1);
+    }
+
+    // The last chunk is executed by the calling thread
+    auto counter = JobCounter{};
+    auto chunk   = begin;
+    for (; end - chunk > grain; chunk += grain) {
+      run(
+          [&func, chunk, grain]() {
+            for (auto i = chunk; i < chunk + grain; ++i) {
+              func(i);
+            }
+          },
+          counter);
+    }
+    for (auto i = chunk; i < end; ++i) {
+      func(i);
+    }
+    wait(counter);
+  }
+
+  uint32_t worker_count() const { return worker_count_; }
+
+  /**
+   * @brief Index of the calling thread in `[0, worker_count()]`, the workers of this system get their own index and
+   * every other thread gets `worker_count()`. Lets the jobs write to per-thread buffers without locking, as long as
+   * only a single thread outside of the pool submits the work.
+   *
+   */
+  uint32_t thread_index() const;
+
+  /**
+   * @brief True if the calling thread is one of the workers of any job system.
+   *
+   */
+  static bool is_worker_thread();
+
+ private:
+  static constexpr size_t kChunksPerWorker = 4;
+
+  struct Task {
+    Job job;
+    JobCounter* counter;
+  };
+
+  struct alignas(64) WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  explicit JobSystem(uint32_t worker_count);
+
+  void push(Task&& task);
+
+  /**
+   * @brief Pops a job of the calling worker or steals a job of another worker and runs it.
+   *
+   * @return true A job has been executed.
+   */
+  bool try_run_one();
+
+  void worker_loop(const std::stop_token& stop_token, uint32_t index);
+
+  uint32_t worker_count_ = 0;
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::jthread> workers_;
+
+  /**
+   * @brief Queue that receives the next job submitted from outside of the pool.
+   *
+   */
+  std::atomic<uint32_t> next_queue_ = 0;
+
+  /**
+   * @brief Number of the queued jobs, the idle workers sleep while it is 0.
+   *
+   */
+  std::atomic<uint32_t> queued_ = 0;
+  std::mutex sleep_mutex_;
+  std::condition_variable_any wake_;
+};
+
+}  // namespace eray::util
@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <filesystem>
 #include <iostream>
@@ -14,6 +17,7 @@
 #include <source_location>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <tuple>
 #include <utility>
 
@@ -136,6 +140,8 @@ void TerminalLoggerScribe::vlog(std::string_view usr_fmt, std::format_args usr_a
 #endif
 }
 
+void TerminalLoggerScribe::flush() { std_stream_->flush(); }
+
 RotatedFileLoggerScribe::RotatedFileLoggerScribe(std::filesystem::path base_path, size_t max_backups,
                                                  LogLevel max_level)
     : LoggerScribe(max_level), file_stream_(std::nullopt), base_path_(std::move(base_path)), max_backups_(max_backups) {
@@ -234,12 +240,353 @@ void RotatedFileLoggerScribe::vlog(std::string_view usr_fmt, std::format_args us
 #endif
 }
 
+void RotatedFileLoggerScribe::flush() {
+  if (file_stream_.has_value() && file_stream_->is_open()) {
+    file_stream_->flush();
+  }
+}
+
+namespace {
+
+/**
+ * @brief Single producer, single consumer ring of the log records of a thread. The counters grow monotonically, the
+ * position in the ring is the counter modulo the capacity.
+ *
+ */
+struct LogRing {
+  explicit LogRing(size_t capacity) : data(std::make_unique<std::byte[]>(capacity)), capacity(capacity) {}
+
+  std::unique_ptr<std::byte[]> data;
+  size_t capacity;
+
+  alignas(64) std::atomic<uint64_t> head{0};
+  alignas(64) std::atomic<uint64_t> tail{0};
+
+  /**
+   * @brief End of the record being written, published to `head` by `Logger::end_record()`.
+   *
+   */
+  uint64_t reserved_head = 0;
+
+  /**
+   * @brief The thread has exited, the ring is released once it is drained.
+   *
+   */
+  std::atomic<bool> abandoned{false};
+};
+
+struct ThreadLogRing {
+  std::shared_ptr<LogRing> ring;
+  uint64_t generation = 0;
+
+  ThreadLogRing() = default;
+  ThreadLogRing(const ThreadLogRing&)            = delete;
+  ThreadLogRing& operator=(const ThreadLogRing&) = delete;
+  ~ThreadLogRing() {
+    if (ring) {
+      ring->abandoned.store(true, std::memory_order_release);
+    }
+  }
+};
+
+thread_local ThreadLogRing tls_log_ring;  // NOLINT
+
+std::atomic<uint64_t> async_generations{0};  // NOLINT
+
+constexpr uint64_t align_record(uint64_t size) { return (size + 7) & ~uint64_t{7}; }
+
+}  // namespace
+
+struct Logger::AsyncBackend {
+  AsyncOptions options;
+  uint64_t generation;
+
+  std::mutex rings_mutex;
+  std::vector<std::shared_ptr<LogRing>> rings;
+
+  std::atomic<uint64_t> enqueued{0};
+
+  std::mutex state_mutex;
+  std::condition_variable wake_cv;
+  std::condition_variable flushed_cv;
+  uint64_t dispatched  = 0;
+  bool wake_requested  = false;
+  bool flush_requested = false;
+  bool stop            = false;
+
+  std::thread consumer;
+  std::thread::id consumer_id;
+
+  LogRing& thread_ring() {
+    if (tls_log_ring.generation != generation) {
+      auto ring = std::make_shared<LogRing>(options.ring_size_bytes);
+      {
+        const std::lock_guard lock(rings_mutex);
+        rings.push_back(ring);
+      }
+      if (tls_log_ring.ring) {
+        tls_log_ring.ring->abandoned.store(true, std::memory_order_release);
+      }
+      tls_log_ring.ring       = std::move(ring);
+      tls_log_ring.generation = generation;
+    }
+    return *tls_log_ring.ring;
+  }
+
+  void wake(bool flush) {
+    {
+      const std::lock_guard lock(state_mutex);
+      wake_requested   = true;
+      flush_requested |= flush;
+    }
+    wake_cv.notify_one();
+  }
+};
+
 Logger::Logger() : file_name_start_pos_(0) {}
 
+Logger::~Logger() { stop_async(); }
+
 void Logger::add_scribe(std::unique_ptr<LoggerScribe> scribe) {
   const std::lock_guard lock(mutex_);
 
   scribes_.push_back(std::move(scribe));
+  update_enabled_level();
+}
+
+void Logger::set_level(LogLevel level) {
+  const std::lock_guard lock(mutex_);
+
+  level_.store(static_cast<int>(level), std::memory_order_relaxed);
+  update_enabled_level();
+}
+
+void Logger::update_enabled_level() {
+  auto scribes_level = -1;
+  for (const auto& scribe : scribes_) {
+    scribes_level = std::max(scribes_level, static_cast<int>(scribe->max_level()));
+  }
+  enabled_level_.store(std::min(level_.load(std::memory_order_relaxed), scribes_level), std::memory_order_relaxed);
+}
+
+void Logger::dispatch(std::string_view fmt, std::format_args args, std::chrono::system_clock::time_point time,
+                      const std::source_location& location, LogLevel level, bool debug) {
+  const auto file_path = std::string_view(location.file_name() + file_name_start_pos_);
+  for (const auto& scribe : scribes_) {
+    scribe->vlog(fmt, args, time, file_path, location, level, debug);
+  }
+}
+
+void Logger::start_async(const AsyncOptions& options) {
+  if (async_backend_) {
+    return;
+  }
+
+  async_backend_                          = std::make_unique<AsyncBackend>();
+  async_backend_->options                 = options;
+  async_backend_->options.ring_size_bytes = std::bit_ceil(std::max(options.ring_size_bytes, size_t{1024}));
+  async_backend_->generation              = ++async_generations;
+  async_backend_->consumer                = std::thread([this]() { run_async_consumer(); });
+  async_backend_->consumer_id = async_backend_->consumer.get_id();
+
+  async_enabled_.store(true, std::memory_order_release);
+}
+
+void Logger::run_async_consumer() {
+  auto& backend = *async_backend_;
+  auto lock     = std::unique_lock(backend.state_mutex);
+  while (true) {
+    backend.wake_cv.wait_for(lock, backend.options.flush_interval,
+                             [&]() { return backend.wake_requested || backend.stop; });
+    backend.wake_requested = false;
+    const auto stopping    = backend.stop;
+    const auto flush       = std::exchange(backend.flush_requested, false);
+    lock.unlock();
+
+    const auto drained = drain(flush || stopping);
+
+    lock.lock();
+    backend.dispatched = std::max(backend.dispatched, drained);
+    backend.flushed_cv.notify_all();
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+void Logger::stop_async() {
+  if (!async_backend_) {
+    return;
+  }
+
+  // No thread starts a record from now on, the ones in progress are finished first
+  async_enabled_.store(false);
+  while (async_writers_.load() != 0) {
+    std::this_thread::yield();
+  }
+
+  {
+    const std::lock_guard lock(async_backend_->state_mutex);
+    async_backend_->stop = true;
+  }
+  async_backend_->wake_cv.notify_one();
+  async_backend_->consumer.join();
+  async_backend_.reset();
+}
+
+std::byte* Logger::begin_record(LogLevel level, bool debug, const std::source_location& location,
+                                std::string_view fmt, std::chrono::system_clock::time_point time, size_t payload_size,
+                                internal::LogRecordDecoder decode) {
+  if (!async_enabled_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  async_writers_.fetch_add(1);
+  if (!async_enabled_.load()) {
+    async_writers_.fetch_sub(1, std::memory_order_release);
+    return nullptr;
+  }
+
+  auto& backend     = *async_backend_;
+  const auto size   = align_record(sizeof(internal::LogRecordHeader) + payload_size);
+  const auto is_own = std::this_thread::get_id() == backend.consumer_id;
+  if (is_own || size > backend.options.ring_size_bytes / 2) {
+    // The background thread cannot wait for itself, the oversized messages would never fit
+    async_writers_.fetch_sub(1, std::memory_order_release);
+    if (!is_own) {
+      flush();
+    }
+    return nullptr;
+  }
+
+  auto& ring       = backend.thread_ring();
+  const auto head  = ring.head.load(std::memory_order_relaxed);
+  const auto pos   = head & (ring.capacity - 1);
+  const auto space = ring.capacity - pos;
+  const auto skip  = size > space ? space : 0;
+  while (head + skip + size - ring.tail.load(std::memory_order_acquire) > ring.capacity) {
+    backend.wake(false);
+    std::this_thread::yield();
+  }
+
+  if (skip != 0) {
+    const auto padding = internal::LogRecordPrefix{.size_bytes = static_cast<uint32_t>(skip), .is_padding = 1};
+    std::memcpy(ring.data.get() + pos, &padding, sizeof(padding));
+  }
+
+  const auto header = internal::LogRecordHeader{
+      .prefix   = internal::LogRecordPrefix{.size_bytes = static_cast<uint32_t>(size), .is_padding = 0},
+      .level    = level,
+      .is_debug = debug,
+      .fmt_size = static_cast<uint32_t>(fmt.size()),
+      .fmt      = fmt.data(),
+      .location = location,
+      .time     = time,
+      .decode   = decode,
+  };
+  auto* record = ring.data.get() + ((head + skip) & (ring.capacity - 1));
+  std::memcpy(record, &header, sizeof(header));
+  ring.reserved_head = head + skip + size;
+
+  return record + sizeof(header);
+}
+
+void Logger::end_record(LogLevel level) {
+  auto& backend = *async_backend_;
+  auto& ring    = *tls_log_ring.ring;
+  ring.head.store(ring.reserved_head, std::memory_order_release);
+  backend.enqueued.fetch_add(1, std::memory_order_release);
+
+  const auto is_half_full = ring.reserved_head - ring.tail.load(std::memory_order_relaxed) > ring.capacity / 2;
+  async_writers_.fetch_sub(1, std::memory_order_release);
+
+  if (level == LogLevel::Err) {
+    flush();
+  } else if (is_half_full) {
+    backend.wake(false);
+  }
+}
+
+uint64_t Logger::drain(bool flush_scribes) {
+  auto& backend       = *async_backend_;
+  const auto enqueued = backend.enqueued.load(std::memory_order_acquire);
+
+  auto rings = std::vector<std::shared_ptr<LogRing>>();
+  {
+    const std::lock_guard lock(backend.rings_mutex);
+    std::erase_if(backend.rings, [](const std::shared_ptr<LogRing>& ring) {
+      return ring->abandoned.load(std::memory_order_acquire) &&
+             ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed);
+    });
+    rings = backend.rings;
+  }
+
+  struct Record {
+    internal::LogRecordHeader header;
+    const std::byte* payload;
+  };
+
+  auto records = std::vector<Record>();
+  auto heads   = std::vector<uint64_t>();
+  heads.reserve(rings.size());
+  for (const auto& ring : rings) {
+    const auto head = ring->head.load(std::memory_order_acquire);
+    for (auto tail = ring->tail.load(std::memory_order_relaxed); tail < head;) {
+      const auto* data = ring->data.get() + (tail & (ring->capacity - 1));
+      auto prefix      = internal::LogRecordPrefix{};
+      std::memcpy(&prefix, data, sizeof(prefix));
+      if (prefix.is_padding == 0) {
+        auto& record = records.emplace_back(Record{.header = {}, .payload = data + sizeof(internal::LogRecordHeader)});
+        std::memcpy(&record.header, data, sizeof(internal::LogRecordHeader));
+      }
+      tail += prefix.size_bytes;
+    }
+    heads.push_back(head);
+  }
+
+  // The rings are ordered on their own, the messages of the threads are interleaved by their timestamps
+  std::ranges::stable_sort(records, {}, [](const Record& record) { return record.header.time; });
+
+  {
+    const std::lock_guard lock(mutex_);
+    for (const auto& record : records) {
+      record.header.decode(*this, record.header, record.payload);
+    }
+    const auto has_errors =
+        std::ranges::any_of(records, [](const Record& record) { return record.header.level == LogLevel::Err; });
+    if (flush_scribes || has_errors) {
+      for (const auto& scribe : scribes_) {
+        scribe->flush();
+      }
+    }
+  }
+
+  for (auto i = 0U; i < rings.size(); ++i) {
+    rings[i]->tail.store(heads[i], std::memory_order_release);
+  }
+
+  return enqueued;
+}
+
+void Logger::flush() {
+  async_writers_.fetch_add(1);
+  if (!async_enabled_.load()) {
+    async_writers_.fetch_sub(1, std::memory_order_release);
+    const std::lock_guard lock(mutex_);
+    for (const auto& scribe : scribes_) {
+      scribe->flush();
+    }
+    return;
+  }
+
+  auto& backend = *async_backend_;
+  if (std::this_thread::get_id() != backend.consumer_id) {
+    const auto target = backend.enqueued.load(std::memory_order_acquire);
+    backend.wake(true);
+
+    auto lock = std::unique_lock(backend.state_mutex);
+    backend.flushed_cv.wait_for(lock, backend.options.flush_timeout, [&]() { return backend.dispatched >= target; });
+  }
+  async_writers_.fetch_sub(1, std::memory_order_release);
 }
 
 void Logger::init(std::optional<std::filesystem::path> abs_build_path) {
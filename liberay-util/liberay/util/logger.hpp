@@ -1,15 +1,22 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <format>
 #include <fstream>
+#include <liberay/util/platform.hpp>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <source_location>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace eray::util {
@@ -29,6 +36,20 @@ static constexpr uint32_t kMaxLogPrefixSize
 
 inline std::string_view log_prefix(LogLevel level) { return kLogPrefixes[static_cast<uint32_t>(level)]; }
 
+#ifndef ERAY_LOG_MIN_LEVEL
+#define ERAY_LOG_MIN_LEVEL 3
+#endif
+
+/**
+ * @brief Least severe level compiled in, set with `ERAY_LOG_MIN_LEVEL` (0 errors, 1 warnings, 2 successes, 3 infos).
+ * The calls of the less severe levels compile to nothing. The errors are always compiled in.
+ *
+ */
+static constexpr auto kMinLogLevel =
+    static_cast<LogLevel>(ERAY_LOG_MIN_LEVEL < 0 ? 0 : (ERAY_LOG_MIN_LEVEL > 3 ? 3 : ERAY_LOG_MIN_LEVEL));
+
+constexpr bool is_log_level_compiled(LogLevel level) { return level <= kMinLogLevel; }
+
 class LoggerScribe {
  public:
   explicit LoggerScribe(LogLevel max_level);
@@ -41,6 +62,14 @@ class LoggerScribe {
                     const std::chrono::time_point<std::chrono::system_clock>& time_point, std::string_view file_path,
                     const std::source_location& location, LogLevel level, bool is_debug_msg) = 0;
 
+  /**
+   * @brief Writes the buffered messages out, called by `Logger::flush()`.
+   *
+   */
+  virtual void flush() {}
+
+  LogLevel max_level() const { return max_level_; }
+
  protected:
   const LogLevel max_level_;
 };
@@ -58,6 +87,8 @@ class TerminalLoggerScribe : public LoggerScribe {
             const std::chrono::time_point<std::chrono::system_clock>& time_point, std::string_view file_path,
             const std::source_location& location, LogLevel level, bool is_debug_msg) override;
 
+  void flush() override;
+
  private:
   std::ostream* std_stream_;
 };
@@ -76,21 +107,142 @@ class RotatedFileLoggerScribe : public LoggerScribe {
             const std::chrono::time_point<std::chrono::system_clock>& time_point, std::string_view file_path,
             const std::source_location& location, LogLevel level, bool is_debug_msg) override;
 
+  void flush() override;
+
  private:
   std::optional<std::ofstream> file_stream_;
   std::filesystem::path base_path_;
   size_t max_backups_;
 };
 
+class Logger;
+
+namespace internal {
+
 /**
- * @brief Singleton thread-safe class that forwards messages to the provided
- * `LoggerScribe`s.
+ * @brief Arguments that are copied to the ring of the async mode, the rest of the arguments is formatted in the
+ * calling thread.
+ *
+ */
+template <typename T>
+concept LogStringArg = std::is_convertible_v<const T&, std::string_view>;
+
+template <typename T>
+concept LogValueArg = !LogStringArg<T> && (std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+                                           std::is_same_v<T, const void*> || std::is_same_v<T, void*>);
+
+template <typename T>
+concept DeferredLogArg = LogStringArg<T> || LogValueArg<T>;
+
+template <typename T>
+using DecodedLogArg = std::conditional_t<LogStringArg<T>, std::string_view, T>;
+
+struct LogRecordPrefix {
+  uint32_t size_bytes;
+
+  /**
+   * @brief The rest of the ring up to its end is skipped, the record did not fit before the wrap.
+   *
+   */
+  uint32_t is_padding;
+};
+
+struct LogRecordHeader;
+using LogRecordDecoder = void (*)(Logger& logger, const LogRecordHeader& header, const std::byte* payload);
+
+/**
+ * @brief Record of the async mode, followed by the encoded arguments.
+ *
+ */
+struct LogRecordHeader {
+  LogRecordPrefix prefix;
+  LogLevel level;
+  bool is_debug;
+  uint32_t fmt_size;
+  const char* fmt;
+  std::source_location location;
+  std::chrono::system_clock::time_point time;
+  LogRecordDecoder decode;
+};
+
+template <DeferredLogArg T>
+size_t encoded_log_arg_size(const T& arg) {
+  if constexpr (LogStringArg<T>) {
+    return sizeof(uint32_t) + std::string_view(arg).size();
+  } else {
+    return sizeof(T);
+  }
+}
+
+template <DeferredLogArg T>
+std::byte* encode_log_arg(std::byte* out, const T& arg) {
+  if constexpr (LogStringArg<T>) {
+    const auto str  = std::string_view(arg);
+    const auto size = static_cast<uint32_t>(str.size());
+    std::memcpy(out, &size, sizeof(size));
+    std::memcpy(out + sizeof(size), str.data(), str.size());
+    return out + sizeof(size) + str.size();
+  } else {
+    std::memcpy(out, &arg, sizeof(T));
+    return out + sizeof(T);
+  }
+}
+
+template <DeferredLogArg T>
+DecodedLogArg<T> decode_log_arg(const std::byte*& in) {
+  if constexpr (LogStringArg<T>) {
+    auto size = uint32_t{0};
+    std::memcpy(&size, in, sizeof(size));
+    const auto str = std::string_view(reinterpret_cast<const char*>(in + sizeof(size)), size);
+    in += sizeof(size) + size;
+    return str;
+  } else {
+    auto value = T{};
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+  }
+}
+
+}  // namespace internal
+
+/**
+ * @brief Singleton thread-safe class that forwards messages to the provided `LoggerScribe`s.
+ *
+ * By default the messages are formatted and written by the calling thread under a mutex. In the async mode (see
+ * `start_async()`) a call only copies the format string pointer, the level, the location and the arguments to a
+ * lock-free ring of the calling thread, and a background thread formats the messages in the order of their
+ * timestamps and writes them to the scribes. Errors (including `panic()`) flush the queue before returning.
+ *
+ * @warning In the async mode the format strings must be string literals, only their pointer is stored. The arguments
+ * other than the numbers, enums and strings are formatted in the calling thread.
  *
  */
 class Logger {
  public:
   Logger();
-  ~Logger() = default;
+  ~Logger();
+
+  struct AsyncOptions {
+    /**
+     * @brief Capacity of the ring of every logging thread, rounded up to a power of two. A thread whose ring is full
+     * waits for the background thread. The messages larger than half of the ring are written synchronously.
+     *
+     */
+    size_t ring_size_bytes = 64 * 1024;
+
+    /**
+     * @brief Longest time a message waits in the ring.
+     *
+     */
+    std::chrono::milliseconds flush_interval{10};
+
+    /**
+     * @brief Longest time `flush()` (and an error message) waits for the background thread.
+     *
+     */
+    std::chrono::milliseconds flush_timeout{200};
+  };
 
   struct FormatWithLocation {
     const char* value;
@@ -103,28 +255,38 @@ class Logger {
 
   template <typename... Args>
   static void err(FormatWithLocation fmt_loc, const Args&... args) {
-    instance().log(LogLevel::Err, false, fmt_loc.loc, fmt_loc.value, args...);
+    if constexpr (is_log_level_compiled(LogLevel::Err)) {
+      instance().log(LogLevel::Err, false, fmt_loc.loc, fmt_loc.value, args...);
+    }
   }
 
   template <typename... Args>
   static void warn(FormatWithLocation fmt_loc, const Args&... args) {
-    instance().log(LogLevel::Warn, false, fmt_loc.loc, fmt_loc.value, args...);
+    if constexpr (is_log_level_compiled(LogLevel::Warn)) {
+      instance().log(LogLevel::Warn, false, fmt_loc.loc, fmt_loc.value, args...);
+    }
   }
 
   template <typename... Args>
   static void info(FormatWithLocation fmt_loc, const Args&... args) {
-    instance().log(LogLevel::Info, false, fmt_loc.loc, fmt_loc.value, args...);
+    if constexpr (is_log_level_compiled(LogLevel::Info)) {
+      instance().log(LogLevel::Info, false, fmt_loc.loc, fmt_loc.value, args...);
+    }
   }
 
   template <typename... Args>
   static void succ(FormatWithLocation fmt_loc, const Args&... args) {
-    instance().log(LogLevel::Success, false, fmt_loc.loc, fmt_loc.value, args...);
+    if constexpr (is_log_level_compiled(LogLevel::Success)) {
+      instance().log(LogLevel::Success, false, fmt_loc.loc, fmt_loc.value, args...);
+    }
   }
 
   template <typename... Args>
   static void debug(FormatWithLocation fmt_loc, const Args&... args) {
 #ifdef IS_DEBUG
-    instance().log(LogLevel::Info, true, fmt_loc.loc, fmt_loc.value, args...);
+    if constexpr (is_log_level_compiled(LogLevel::Info)) {
+      instance().log(LogLevel::Info, true, fmt_loc.loc, fmt_loc.value, args...);
+    }
 #else
     // Silence the unused parameters warnings when in release
     (void)fmt_loc;
@@ -135,14 +297,63 @@ class Logger {
   template <typename... Args>
   void log(const LogLevel level, const bool debug, const std::source_location& location, const std::string_view fmt,
            const Args&... args) {
-    const std::lock_guard lock(mutex_);
-    const auto file_path = std::string_view(location.file_name() + file_name_start_pos_);
-    const auto now       = std::chrono::system_clock::now();
-    for (const auto& scribe : scribes_) {
-      scribe->vlog(fmt, std::make_format_args(args...), now, file_path, location, level, debug);
+    if (!is_enabled(level, debug)) {
+      return;
+    }
+
+    const auto now = std::chrono::system_clock::now();
+    if constexpr ((internal::DeferredLogArg<Args> && ...)) {
+      const auto payload_size = (size_t{0} + ... + internal::encoded_log_arg_size(args));
+      if (auto* payload = begin_record(level, debug, location, fmt, now, payload_size, &decode_record<Args...>)) {
+        ((payload = internal::encode_log_arg(payload, args)), ...);
+        end_record(level);
+        return;
+      }
+    } else if (is_async()) {
+      // The arguments might not outlive the call, so the message is formatted right away
+      const auto msg = std::vformat(fmt, std::make_format_args(args...));
+      log(level, debug, location, "{}", msg);
+      return;
     }
+
+    const std::lock_guard lock(mutex_);
+    dispatch(fmt, std::make_format_args(args...), now, location, level, debug);
   }
 
+  /**
+   * @brief Messages less severe than the level are dropped before anything is formatted or queued, as well as the
+   * messages that none of the scribes would write.
+   *
+   */
+  void set_level(LogLevel level);
+
+  bool is_enabled(LogLevel level, bool debug = false) const {
+    // The debug messages ignore the levels of the scribes
+    return static_cast<int>(level) <= (debug ? level_ : enabled_level_).load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Starts the background thread of the async mode.
+   *
+   */
+  void start_async(const AsyncOptions& options);
+  void start_async() { start_async(AsyncOptions{}); }
+
+  /**
+   * @brief Writes out the queued messages and returns to the synchronous mode.
+   *
+   */
+  void stop_async();
+
+  bool is_async() const { return async_enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Waits until the messages logged so far are written (at most `AsyncOptions::flush_timeout`) and flushes the
+   * scribes.
+   *
+   */
+  void flush();
+
   void init(std::optional<std::filesystem::path> abs_build_path = std::nullopt);
   void add_scribe(std::unique_ptr<LoggerScribe> scribe);
 
@@ -152,9 +363,103 @@ class Logger {
   }
 
  private:
+  struct AsyncBackend;
+
+  template <typename... Args>
+  static void decode_record(Logger& logger, const internal::LogRecordHeader& header,
+                            [[maybe_unused]] const std::byte* payload) {
+    // The braced initialization decodes the arguments in order
+    auto values = std::tuple<internal::DecodedLogArg<Args>...>{internal::decode_log_arg<Args>(payload)...};
+    std::apply(
+        [&](auto&... decoded) {
+          logger.dispatch(std::string_view(header.fmt, header.fmt_size), std::make_format_args(decoded...),
+                          header.time, header.location, header.level, header.is_debug);
+        },
+        values);
+  }
+
+  /**
+   * @brief Reserves a record in the ring of the calling thread, returns the pointer to its payload or `nullptr` if the
+   * message has to be written synchronously.
+   *
+   */
+  std::byte* begin_record(LogLevel level, bool debug, const std::source_location& location, std::string_view fmt,
+                          std::chrono::system_clock::time_point time, size_t payload_size,
+                          internal::LogRecordDecoder decode);
+  void end_record(LogLevel level);
+
+  void update_enabled_level();
+
+  void dispatch(std::string_view fmt, std::format_args args, std::chrono::system_clock::time_point time,
+                const std::source_location& location, LogLevel level, bool debug);
+
+  void run_async_consumer();
+
+  /**
+   * @brief Writes the published records of all of the rings, returns the number of the records enqueued before.
+   *
+   */
+  uint64_t drain(bool flush_scribes);
+
   std::vector<std::unique_ptr<LoggerScribe>> scribes_;
-  std::mutex mutex_;
+
+  /**
+   * @brief Recursive, so the scribes may log while they write.
+   *
+   */
+  std::recursive_mutex mutex_;
   size_t file_name_start_pos_;
+
+  std::atomic<int> level_{static_cast<int>(LogLevel::Info)};
+
+  /**
+   * @brief The `level_` limited by the most verbose scribe, -1 without the scribes.
+   *
+   */
+  std::atomic<int> enabled_level_{-1};
+
+  std::atomic<bool> async_enabled_{false};
+
+  /**
+   * @brief Threads inside `begin_record()` and `end_record()`, the backend is destroyed once there are none.
+   *
+   */
+  std::atomic<uint32_t> async_writers_{0};
+  std::unique_ptr<AsyncBackend> async_backend_;
 };
 
 }  // namespace eray::util
+
+/**
+ * @brief Same as the `Logger` functions, but the arguments are not even evaluated when the level is compiled out or
+ * disabled at runtime, e.g. `ERAY_LOG_INFO("Visible {}", count_visible())` in a hot loop.
+ *
+ */
+#define ERAY_LOG_IMPL(level, function, ...)                     \
+  do {                                                          \
+    if constexpr (::eray::util::is_log_level_compiled(level)) { \
+      if (::eray::util::Logger::instance().is_enabled(level)) { \
+        ::eray::util::Logger::function(__VA_ARGS__);            \
+      }                                                         \
+    }                                                           \
+  } while (false)
+
+#define ERAY_LOG_ERR(...) ERAY_LOG_IMPL(::eray::util::LogLevel::Err, err, __VA_ARGS__)
+#define ERAY_LOG_WARN(...) ERAY_LOG_IMPL(::eray::util::LogLevel::Warn, warn, __VA_ARGS__)
+#define ERAY_LOG_SUCC(...) ERAY_LOG_IMPL(::eray::util::LogLevel::Success, succ, __VA_ARGS__)
+#define ERAY_LOG_INFO(...) ERAY_LOG_IMPL(::eray::util::LogLevel::Info, info, __VA_ARGS__)
+
+#ifdef IS_DEBUG
+#define ERAY_LOG_DEBUG(...)                                                                  \
+  do {                                                                                       \
+    if constexpr (::eray::util::is_log_level_compiled(::eray::util::LogLevel::Info)) {       \
+      if (::eray::util::Logger::instance().is_enabled(::eray::util::LogLevel::Info, true)) { \
+        ::eray::util::Logger::debug(__VA_ARGS__);                                            \
+      }                                                                                      \
+    }                                                                                        \
+  } while (false)
+#else
+#define ERAY_LOG_DEBUG(...) \
+  do {                      \
+  } while (false)
+#endif
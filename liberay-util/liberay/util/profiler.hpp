@@ -0,0 +1,61 @@
+#pragma once
+
+/**
+ * @file profiler.hpp
+ * @brief CPU profiling macros. The scopes are always recorded by the in-engine `util::CpuProfiler` while it is enabled
+ * (a disabled scope costs an atomic load). Compiled with the `ENABLE_TRACY` CMake option the macros additionally emit
+ * Tracy zones. The Tracy client is built on demand, it collects the data only while the profiler is connected.
+ *
+ */
+
+#include <liberay/util/cpu_profiler.hpp>
+
+#define ERAY_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ERAY_PROFILE_CONCAT(a, b) ERAY_PROFILE_CONCAT_IMPL(a, b)
+#define ERAY_CPU_PROFILE_SCOPE(name) \
+  const ::eray::util::CpuProfileScope ERAY_PROFILE_CONCAT(eray_cpu_profile_scope_, __LINE__)(name)
+
+#ifdef ERAY_ENABLE_PROFILING
+
+#include <tracy/Tracy.hpp>
+
+/**
+ * @brief Profiles the enclosing scope. The name must be a string literal.
+ *
+ */
+#define ERAY_PROFILE_SCOPE(name) \
+  ZoneScopedN(name);             \
+  ERAY_CPU_PROFILE_SCOPE(name)
+
+/**
+ * @brief Profiles the enclosing scope, named after the enclosing function.
+ *
+ */
+#define ERAY_PROFILE_FUNCTION() \
+  ZoneScoped;                   \
+  ERAY_CPU_PROFILE_SCOPE(__func__)
+
+/**
+ * @brief Marks the end of a frame.
+ *
+ */
+#define ERAY_PROFILE_FRAME() \
+  FrameMark;                 \
+  ::eray::util::CpuProfiler::instance().end_frame()
+
+/**
+ * @brief Names the calling thread in the profiler. The name must be a string literal.
+ *
+ */
+#define ERAY_PROFILE_THREAD_NAME(name) \
+  tracy::SetThreadName(name);          \
+  ::eray::util::CpuProfiler::set_thread_name(name)
+
+#else
+
+#define ERAY_PROFILE_SCOPE(name) ERAY_CPU_PROFILE_SCOPE(name)
+#define ERAY_PROFILE_FUNCTION() ERAY_CPU_PROFILE_SCOPE(__func__)
+#define ERAY_PROFILE_FRAME() ::eray::util::CpuProfiler::instance().end_frame()
+#define ERAY_PROFILE_THREAD_NAME(name) ::eray::util::CpuProfiler::set_thread_name(name)
+
+#endif
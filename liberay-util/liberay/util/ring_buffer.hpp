@@ -0,0 +1,312 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace eray::util {
+
+/**
+ * @brief Alignment of the indices shared between the threads, so that the producer and the consumer do not write to
+ * the same cache line.
+ *
+ */
+inline constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @brief Bounded wait-free single producer, single consumer queue. The capacity is rounded up to a power of two.
+ *
+ * Each side keeps a cached copy of the index of the other side and reloads it only when the ring looks full (empty),
+ * so in the steady state a push or a pop touches only the cache lines of its own side and of the element.
+ *
+ * @warning The `try_push*()` functions must be called from a single thread, and so must the `try_pop*()` functions.
+ *
+ * @tparam T
+ */
+template <typename T>
+class SpscRingBuffer {
+  static_assert(std::is_nothrow_move_constructible_v<T>, "SpscRingBuffer requires a nothrow move constructible type");
+
+ public:
+  explicit SpscRingBuffer(size_t capacity)
+      : slots_(std::make_unique<Slot[]>(std::bit_ceil(std::max<size_t>(capacity, 1)))),  // NOLINT
+        mask_(std::bit_ceil(std::max<size_t>(capacity, 1)) - 1) {}
+
+  SpscRingBuffer(const SpscRingBuffer&)            = delete;
+  SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+  ~SpscRingBuffer() {
+    const auto head = head_.load(std::memory_order_relaxed);
+    for (auto index = tail_.load(std::memory_order_relaxed); index != head; ++index) {
+      std::destroy_at(slot(index));
+    }
+  }
+
+  template <typename... TArgs>
+  bool try_emplace(TArgs&&... args) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (free_slots(head, 1) == 0) {
+      return false;
+    }
+    ::new (static_cast<void*>(slot(head))) T(std::forward<TArgs>(args)...);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_push(const T& value) { return try_emplace(value); }
+  bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+  /**
+   * @brief Pushes as many of the values as fit and publishes them at once.
+   *
+   * @return size_t Number of the pushed values, a prefix of `values`.
+   */
+  size_t try_push_batch(std::span<const T> values) {
+    const auto head  = head_.load(std::memory_order_relaxed);
+    const auto count = std::min(values.size(), free_slots(head, values.size()));
+    for (auto i = size_t{0}; i < count; ++i) {
+      ::new (static_cast<void*>(slot(head + i))) T(values[i]);
+    }
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  std::optional<T> try_pop() {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail == cached_head_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail == cached_head_) {
+        return std::nullopt;
+      }
+    }
+    auto result = std::optional<T>(std::move(*slot(tail)));
+    std::destroy_at(slot(tail));
+    tail_.store(tail + 1, std::memory_order_release);
+    return result;
+  }
+
+  /**
+   * @brief Pops up to `out.size()` values and releases their slots at once.
+   *
+   * @return size_t Number of the popped values, written to the front of `out`.
+   */
+  size_t try_pop_batch(std::span<T> out) {
+    const auto tail  = tail_.load(std::memory_order_relaxed);
+    cached_head_     = head_.load(std::memory_order_acquire);
+    const auto count = std::min(out.size(), static_cast<size_t>(cached_head_ - tail));
+    for (auto i = size_t{0}; i < count; ++i) {
+      out[i] = std::move(*slot(tail + i));
+      std::destroy_at(slot(tail + i));
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  /**
+   * @brief Exact on the consumer thread, a snapshot on the other threads.
+   *
+   */
+  bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Number of the queued values, a snapshot unless called by the producer or the consumer.
+   *
+   */
+  size_t size() const {
+    const auto tail = tail_.load(std::memory_order_acquire);
+    return static_cast<size_t>(head_.load(std::memory_order_acquire) - tail);
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Slot {
+    alignas(T) std::byte storage[sizeof(T)];  // NOLINT
+  };
+
+  T* slot(uint64_t index) { return std::launder(reinterpret_cast<T*>(slots_[index & mask_].storage)); }
+
+  /**
+   * @brief Reloads the tail only if the cached one does not leave room for `wanted` values.
+   *
+   */
+  size_t free_slots(uint64_t head, size_t wanted) {
+    if (capacity() - static_cast<size_t>(head - cached_tail_) < wanted) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    return capacity() - static_cast<size_t>(head - cached_tail_);
+  }
+
+  std::unique_ptr<Slot[]> slots_;  // NOLINT
+  size_t mask_;
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> head_{0};
+  uint64_t cached_tail_ = 0;
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> tail_{0};
+  uint64_t cached_head_ = 0;
+};
+
+/**
+ * @brief Bounded lock-free multi producer, multi consumer queue (Dmitry Vyukov's design). The capacity is rounded up to
+ * a power of two, at least 2.
+ *
+ * Every slot carries a sequence number that tells which lap of the ring it belongs to, so the producers and the
+ * consumers synchronize on the slot instead of on a shared lock. A push or a pop is a single CAS of the shared index
+ * when uncontended, the batch functions claim all of their slots with one CAS.
+ *
+ * @tparam T
+ */
+template <typename T>
+class MpmcRingBuffer {
+  static_assert(std::is_nothrow_move_constructible_v<T>, "MpmcRingBuffer requires a nothrow move constructible type");
+
+ public:
+  explicit MpmcRingBuffer(size_t capacity)
+      : cells_(std::make_unique<Cell[]>(std::bit_ceil(std::max<size_t>(capacity, 2)))),  // NOLINT
+        mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1) {
+    for (auto i = size_t{0}; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcRingBuffer(const MpmcRingBuffer&)            = delete;
+  MpmcRingBuffer& operator=(const MpmcRingBuffer&) = delete;
+
+  ~MpmcRingBuffer() {
+    while (try_pop()) {
+    }
+  }
+
+  template <typename... TArgs>
+  bool try_emplace(TArgs&&... args) {
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    if (claim(enqueue_pos_, pos, 1, 0) == 0) {
+      return false;
+    }
+    auto& cell = cells_[pos & mask_];
+    ::new (static_cast<void*>(cell.storage)) T(std::forward<TArgs>(args)...);
+    cell.sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_push(const T& value) { return try_emplace(value); }
+  bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+  /**
+   * @brief Pushes as many of the values as there are consecutive free slots, claimed with a single CAS.
+   *
+   * @return size_t Number of the pushed values, a prefix of `values`.
+   */
+  size_t try_push_batch(std::span<const T> values) {
+    auto pos         = enqueue_pos_.load(std::memory_order_relaxed);
+    const auto count = claim(enqueue_pos_, pos, values.size(), 0);
+    for (auto i = size_t{0}; i < count; ++i) {
+      auto& cell = cells_[(pos + i) & mask_];
+      ::new (static_cast<void*>(cell.storage)) T(values[i]);
+      cell.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return count;
+  }
+
+  std::optional<T> try_pop() {
+    auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+    if (claim(dequeue_pos_, pos, 1, 1) == 0) {
+      return std::nullopt;
+    }
+    auto& cell  = cells_[pos & mask_];
+    auto result = std::optional<T>(std::move(*cell.value()));
+    std::destroy_at(cell.value());
+    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return result;
+  }
+
+  /**
+   * @brief Pops up to `out.size()` consecutive published values, claimed with a single CAS.
+   *
+   * @return size_t Number of the popped values, written to the front of `out`.
+   */
+  size_t try_pop_batch(std::span<T> out) {
+    auto pos         = dequeue_pos_.load(std::memory_order_relaxed);
+    const auto count = claim(dequeue_pos_, pos, out.size(), 1);
+    for (auto i = size_t{0}; i < count; ++i) {
+      auto& cell = cells_[(pos + i) & mask_];
+      out[i]     = std::move(*cell.value());
+      std::destroy_at(cell.value());
+      cell.sequence.store(pos + i + mask_ + 1, std::memory_order_release);
+    }
+    return count;
+  }
+
+  /**
+   * @brief Number of the queued values, a snapshot.
+   *
+   */
+  size_t size_approx() const {
+    const auto dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+    const auto enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+    return enqueue_pos > dequeue_pos ? static_cast<size_t>(enqueue_pos - dequeue_pos) : 0;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell {
+    std::atomic<uint64_t> sequence;
+    alignas(T) std::byte storage[sizeof(T)];  // NOLINT
+
+    T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+  };
+
+  /**
+   * @brief Claims up to `max_count` consecutive cells starting at `pos`. A cell at position `p` is ready for a
+   * producer when its sequence is `p`, and for a consumer when it is `p + 1`, i.e. `offset`.
+   *
+   * @return size_t Number of the claimed cells, `pos` is updated to the first of them.
+   */
+  size_t claim(std::atomic<uint64_t>& shared_pos, uint64_t& pos, size_t max_count, uint64_t offset) {
+    while (max_count > 0) {
+      auto count = size_t{0};
+      auto stale = false;
+      for (; count < max_count; ++count) {
+        const auto sequence = cells_[(pos + count) & mask_].sequence.load(std::memory_order_acquire);
+        const auto diff     = static_cast<int64_t>(sequence - (pos + count + offset));
+        if (diff < 0) {
+          break;  // Full (empty) from this cell on
+        }
+        if (diff > 0) {
+          stale = true;  // Another thread claimed the cell already
+          break;
+        }
+      }
+
+      if (stale && count == 0) {
+        pos = shared_pos.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (count == 0) {
+        return 0;
+      }
+      if (shared_pos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+        return count;
+      }
+    }
+    return 0;
+  }
+
+  std::unique_ptr<Cell[]> cells_;  // NOLINT
+  size_t mask_;
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> enqueue_pos_{0};
+  alignas(kCacheLineSize) std::atomic<uint64_t> dequeue_pos_{0};
+};
+
+}  // namespace eray::util
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace eray::util {
+
+/**
+ * @brief Key of a `SlotMap` element. The index selects the slot, the generation tells whether the slot still holds
+ * the element the key was issued for. The tag only makes the keys of the different maps distinct types.
+ *
+ * @tparam TTag
+ */
+template <typename TTag>
+struct SlotMapKey {
+  using Tag = TTag;
+
+  static constexpr uint32_t kNullIndex = std::numeric_limits<uint32_t>::max();
+
+  uint32_t index      = kNullIndex;
+  uint32_t generation = 0;
+
+  bool is_null() const { return index == kNullIndex; }
+
+  bool operator==(const SlotMapKey&) const = default;
+};
+
+template <typename T>
+concept CSlotMapKey = requires(T key) {
+  { key.index } -> std::convertible_to<uint32_t>;
+  { key.generation } -> std::convertible_to<uint32_t>;
+  T{.index = uint32_t{}, .generation = uint32_t{}};
+};
+
+/**
+ * @brief Associative container that issues its own keys. The elements are stored densely in a vector and the keys
+ * refer to them through a slot array, so the insertion, the erasure and the lookup are O(1) and the lookup is two
+ * array indexing operations instead of a hash or a pointer chase. The slots are reused through an intrusive free list,
+ * their generation counter invalidates the keys of the erased elements.
+ *
+ * The iteration visits the dense vector. Erasing an element moves the last element into its place, so the order is
+ * not preserved, but the keys stay valid.
+ *
+ * @tparam T
+ * @tparam TKey Key type, e.g. a `SlotMapKey` with a tag specific to the map.
+ */
+template <typename T, CSlotMapKey TKey = SlotMapKey<T>>
+class SlotMap {
+ public:
+  using key_type       = TKey;
+  using value_type     = T;
+  using iterator       = typename std::vector<T>::iterator;
+  using const_iterator = typename std::vector<T>::const_iterator;
+
+  SlotMap() = default;
+
+  SlotMap(const SlotMap&)            = default;
+  SlotMap& operator=(const SlotMap&) = default;
+
+  SlotMap(SlotMap&& other) noexcept
+      : values_(std::exchange(other.values_, {})),
+        dense_to_slot_(std::exchange(other.dense_to_slot_, {})),
+        slots_(std::exchange(other.slots_, {})),
+        free_head_(std::exchange(other.free_head_, kNullSlot)) {}
+
+  SlotMap& operator=(SlotMap&& other) noexcept {
+    values_        = std::exchange(other.values_, {});
+    dense_to_slot_ = std::exchange(other.dense_to_slot_, {});
+    slots_         = std::exchange(other.slots_, {});
+    free_head_     = std::exchange(other.free_head_, kNullSlot);
+    return *this;
+  }
+
+  ~SlotMap() = default;
+
+  template <typename... TArgs>
+  TKey emplace(TArgs&&... args) {
+    auto index = free_head_;
+    if (index == kNullSlot) {
+      index = static_cast<uint32_t>(slots_.size());
+      slots_.push_back(Slot{});
+    }
+
+    values_.emplace_back(std::forward<TArgs>(args)...);
+    dense_to_slot_.push_back(index);
+
+    auto& slot              = slots_[index];
+    free_head_              = slot.dense_or_next_free;
+    slot.dense_or_next_free = static_cast<uint32_t>(values_.size() - 1);
+    ++slot.generation;
+
+    return TKey{.index = index, .generation = slot.generation};
+  }
+
+  TKey insert(const T& value) { return emplace(value); }
+  TKey insert(T&& value) { return emplace(std::move(value)); }
+
+  /**
+   * @brief Erases the element and invalidates its key.
+   *
+   * @return false The key is stale or null.
+   */
+  bool erase(TKey key) {
+    if (!contains(key)) {
+      return false;
+    }
+
+    auto& slot       = slots_[key.index];
+    const auto dense = slot.dense_or_next_free;
+    const auto last  = static_cast<uint32_t>(values_.size() - 1);
+    if (dense != last) {
+      values_[dense]                                   = std::move(values_[last]);
+      dense_to_slot_[dense]                            = dense_to_slot_[last];
+      slots_[dense_to_slot_[dense]].dense_or_next_free = dense;
+    }
+    values_.pop_back();
+    dense_to_slot_.pop_back();
+
+    ++slot.generation;
+    slot.dense_or_next_free = free_head_;
+    free_head_              = key.index;
+    return true;
+  }
+
+  /**
+   * @brief True if the element of the key has not been erased. The generation of an occupied slot is odd, the keys
+   * are issued only with odd generations.
+   *
+   */
+  bool contains(TKey key) const {
+    return key.index < slots_.size() && slots_[key.index].generation == key.generation && (key.generation & 1U) != 0;
+  }
+
+  /**
+   * @brief Returns `nullptr` if the key is stale.
+   *
+   */
+  T* get(TKey key) { return contains(key) ? &values_[slots_[key.index].dense_or_next_free] : nullptr; }
+  const T* get(TKey key) const { return contains(key) ? &values_[slots_[key.index].dense_or_next_free] : nullptr; }
+
+  T& operator[](TKey key) {
+    assert(contains(key) && "Invalid slot map key");
+    return values_[slots_[key.index].dense_or_next_free];
+  }
+  const T& operator[](TKey key) const {
+    assert(contains(key) && "Invalid slot map key");
+    return values_[slots_[key.index].dense_or_next_free];
+  }
+
+  /**
+   * @brief Key of the element at the position `dense_index` of the iteration.
+   *
+   */
+  TKey key_at(size_t dense_index) const {
+    const auto index = dense_to_slot_[dense_index];
+    return TKey{.index = index, .generation = slots_[index].generation};
+  }
+
+  /**
+   * @brief Erases all of the elements, the keys issued so far become stale.
+   *
+   */
+  void clear() {
+    for (const auto index : dense_to_slot_) {
+      auto& slot = slots_[index];
+      ++slot.generation;
+      slot.dense_or_next_free = free_head_;
+      free_head_              = index;
+    }
+    values_.clear();
+    dense_to_slot_.clear();
+  }
+
+  void reserve(size_t capacity) {
+    values_.reserve(capacity);
+    dense_to_slot_.reserve(capacity);
+    slots_.reserve(capacity);
+  }
+
+  size_t size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+
+  std::span<T> values() { return values_; }
+  std::span<const T> values() const { return values_; }
+
+  iterator begin() { return values_.begin(); }
+  const_iterator begin() const { return values_.begin(); }
+  iterator end() { return values_.end(); }
+  const_iterator end() const { return values_.end(); }
+
+ private:
+  static constexpr uint32_t kNullSlot = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * @brief An occupied slot stores the position of its element in the dense vector, a free slot stores the next free
+   * slot.
+   *
+   */
+  struct Slot {
+    uint32_t dense_or_next_free = kNullSlot;
+    uint32_t generation         = 0;
+  };
+
+  std::vector<T> values_;
+  std::vector<uint32_t> dense_to_slot_;
+  std::vector<Slot> slots_;
+  uint32_t free_head_ = kNullSlot;
+};
+
+}  // namespace eray::util
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+namespace eray::util {
+
+/**
+ * @brief Vector that stores up to `N` elements inline and moves them to the heap once it grows past them. The small
+ * arrays of the engine structures (e.g. the dependencies of a render pass) then do not need a heap block of their own
+ * and are read without chasing a pointer. Once spilled the vector never moves back to the inline storage, `clear()`
+ * keeps the heap capacity.
+ *
+ * Unlike `std::vector`, moving a vector that has not spilled moves the elements one by one and the iterators of the
+ * source are invalidated.
+ *
+ * @tparam T
+ * @tparam N Inline capacity.
+ */
+template <typename T, std::size_t N>
+class SmallVector {
+  static_assert(N > 0, "SmallVector inline capacity must be positive");
+
+ public:
+  using value_type      = T;
+  using size_type       = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = T&;
+  using const_reference = const T&;
+  using pointer         = T*;
+  using const_pointer   = const T*;
+  using iterator        = T*;
+  using const_iterator  = const T*;
+
+  SmallVector() = default;
+
+  SmallVector(std::initializer_list<T> init) : SmallVector(init.begin(), init.end()) {}
+
+  template <std::input_iterator TIt>
+  SmallVector(TIt first, TIt last) {
+    if constexpr (std::forward_iterator<TIt>) {
+      reserve(static_cast<size_type>(std::distance(first, last)));
+    }
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  SmallVector(const SmallVector& other)
+    requires(std::is_copy_constructible_v<T>)
+      : SmallVector(other.begin(), other.end()) {}
+
+  SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) { take(std::move(other)); }
+
+  SmallVector& operator=(const SmallVector& other)
+    requires(std::is_copy_constructible_v<T>)
+  {
+    if (this != &other) {
+      clear();
+      reserve(other.size_);
+      std::uninitialized_copy(other.begin(), other.end(), data_);
+      size_ = other.size_;
+    }
+    return *this;
+  }
+
+  SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      clear();
+      release_heap();
+      take(std::move(other));
+    }
+    return *this;
+  }
+
+  ~SmallVector() {
+    clear();
+    release_heap();
+  }
+
+  template <typename... TArgs>
+  T& emplace_back(TArgs&&... args) {
+    if (size_ == capacity_) {
+      // The argument may refer to an element, so it is constructed before the elements are moved
+      auto* new_data = allocate(capacity_ * 2);
+      auto* result   = ::new (static_cast<void*>(new_data + size_)) T(std::forward<TArgs>(args)...);
+      relocate(new_data, capacity_ * 2);
+      ++size_;
+      return *result;
+    }
+
+    auto* result = ::new (static_cast<void*>(data_ + size_)) T(std::forward<TArgs>(args)...);
+    ++size_;
+    return *result;
+  }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  void pop_back() {
+    assert(size_ > 0 && "SmallVector is empty");
+    std::destroy_at(data_ + --size_);
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    auto* dst = begin() + (first - begin());
+    auto* src = begin() + (last - begin());
+    if (first != last) {
+      auto* new_end = std::move(src, end(), dst);
+      std::destroy(new_end, end());
+      size_ = static_cast<size_type>(new_end - begin());
+    }
+    return dst;
+  }
+
+  void reserve(size_type new_capacity) {
+    if (new_capacity > capacity_) {
+      relocate(allocate(new_capacity), new_capacity);
+    }
+  }
+
+  void resize(size_type count) {
+    if (count < size_) {
+      std::destroy(begin() + count, end());
+    } else {
+      reserve(count);
+      std::uninitialized_value_construct(end(), begin() + count);
+    }
+    size_ = count;
+  }
+
+  void clear() noexcept {
+    std::destroy(begin(), end());
+    size_ = 0;
+  }
+
+  T* data() noexcept { return data_; }
+  const T* data() const noexcept { return data_; }
+
+  size_type size() const noexcept { return size_; }
+  size_type capacity() const noexcept { return capacity_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  /**
+   * @brief True until the vector grows past its inline capacity.
+   *
+   */
+  bool is_inline() const noexcept { return data_ == inline_data(); }
+
+  T& operator[](size_type i) {
+    assert(i < size_ && "SmallVector index out of range");
+    return data_[i];
+  }
+  const T& operator[](size_type i) const {
+    assert(i < size_ && "SmallVector index out of range");
+    return data_[i];
+  }
+
+  T& front() { return (*this)[0]; }
+  const T& front() const { return (*this)[0]; }
+  T& back() { return (*this)[size_ - 1]; }
+  const T& back() const { return (*this)[size_ - 1]; }
+
+  iterator begin() noexcept { return data_; }
+  const_iterator begin() const noexcept { return data_; }
+  iterator end() noexcept { return data_ + size_; }
+  const_iterator end() const noexcept { return data_ + size_; }
+
+  friend bool operator==(const SmallVector& lhs, const SmallVector& rhs) { return std::ranges::equal(lhs, rhs); }
+
+ private:
+  T* inline_data() noexcept { return reinterpret_cast<T*>(storage_); }
+  const T* inline_data() const noexcept { return reinterpret_cast<const T*>(storage_); }
+
+  static T* allocate(size_type count) { return std::allocator<T>().allocate(count); }
+
+  /**
+   * @brief Moves the elements to the new heap block and frees the old one.
+   *
+   */
+  void relocate(T* new_data, size_type new_capacity) {
+    std::uninitialized_move(begin(), end(), new_data);
+    std::destroy(begin(), end());
+    release_heap();
+    data_     = new_data;
+    capacity_ = new_capacity;
+  }
+
+  void release_heap() noexcept {
+    if (!is_inline()) {
+      std::allocator<T>().deallocate(data_, capacity_);
+      data_     = inline_data();
+      capacity_ = N;
+    }
+  }
+
+  /**
+   * @brief Steals the heap block of the other vector, or moves its inline elements. Expects an empty inline vector.
+   *
+   */
+  void take(SmallVector&& other) {
+    if (other.is_inline()) {
+      std::uninitialized_move(other.begin(), other.end(), data_);
+      size_ = other.size_;
+      other.clear();
+      return;
+    }
+
+    data_     = std::exchange(other.data_, other.inline_data());
+    size_     = std::exchange(other.size_, 0);
+    capacity_ = std::exchange(other.capacity_, N);
+  }
+
+  alignas(T) std::byte storage_[N * sizeof(T)];  // NOLINT
+  T* data_            = inline_data();
+  size_type size_     = 0;
+  size_type capacity_ = N;
+};
+
+}  // namespace eray::util
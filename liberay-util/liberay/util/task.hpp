@@ -0,0 +1,183 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace eray::util {
+
+template <typename T>
+class Task;
+
+namespace detail {
+
+class TaskPromiseBase {
+ public:
+  /**
+   * @brief Resumes the awaiting coroutine by symmetric transfer, so a chain of the tasks completing one after another
+   * does not grow the stack. A detached task destroys its own frame instead.
+   *
+   */
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+
+    template <typename TPromise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<TPromise> handle) noexcept {
+      auto& promise = handle.promise();
+      if (promise.continuation_) {
+        return promise.continuation_;
+      }
+      if (promise.detached_) {
+        handle.destroy();
+      }
+      return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+
+  /**
+   * @brief The engine reports the errors with `util::Result`, an exception escaping a task is a bug.
+   *
+   */
+  void unhandled_exception() const noexcept { std::terminate(); }
+
+ private:
+  template <typename T>
+  friend class util::Task;
+
+  std::coroutine_handle<> continuation_;
+  bool detached_ = false;
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+ public:
+  Task<T> get_return_object() noexcept;
+
+  template <typename TValue>
+    requires std::is_convertible_v<TValue&&, T>
+  void return_value(TValue&& value) {
+    value_.emplace(std::forward<TValue>(value));
+  }
+
+  T take_value() { return std::move(*value_); }
+
+ private:
+  std::optional<T> value_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+ public:
+  Task<void> get_return_object() noexcept;
+
+  void return_void() const noexcept {}
+  void take_value() const noexcept {}
+};
+
+}  // namespace detail
+
+/**
+ * @brief Lazily started coroutine that produces a `T`. The task starts when it is awaited, the awaiting coroutine is
+ * suspended until the task completes and is then resumed by symmetric transfer on the thread that completed it.
+ *
+ * The tasks do not block the threads, a chain of the asynchronous steps (e.g. decoding a file on the workers, then
+ * waiting for its GPU upload, then creating a pipeline) is written as a straight-line coroutine that awaits
+ * `JobSystem::schedule()`, `JobCounter::completion()` or `vkren::TimelineWaitQueue::wait()` between the steps.
+ *
+ * Top-level tasks are started with `detach()`.
+ *
+ * @warning The coroutines must not throw, report the errors with `util::Result` instead.
+ *
+ * @tparam T
+ */
+template <typename T = void>
+class [[nodiscard]] Task {
+ public:
+  using promise_type = detail::TaskPromise<T>;
+
+  Task() = default;
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  Task(const Task&)            = delete;
+  Task& operator=(const Task&) = delete;
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      destroy();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  ~Task() { destroy(); }
+
+  class Awaiter {
+   public:
+    explicit Awaiter(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+      handle_.promise().continuation_ = continuation;
+      return handle_;
+    }
+
+    T await_resume() { return handle_.promise().take_value(); }
+
+   private:
+    std::coroutine_handle<promise_type> handle_;
+  };
+
+  /**
+   * @brief Starts the task and resumes the awaiting coroutine with its result.
+   *
+   */
+  Awaiter operator co_await() && noexcept { return Awaiter(handle_); }
+
+  /**
+   * @brief Starts the task on the calling thread, it runs until its first suspension. The frame is destroyed when the
+   * task completes, the result is discarded.
+   *
+   */
+  void detach() && {
+    auto handle                = std::exchange(handle_, nullptr);
+    handle.promise().detached_ = true;
+    handle.resume();
+  }
+
+  bool is_valid() const { return static_cast<bool>(handle_); }
+  bool is_done() const { return handle_ && handle_.done(); }
+
+ private:
+  void destroy() {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = nullptr;
+    }
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+}  // namespace detail
+
+}  // namespace eray::util
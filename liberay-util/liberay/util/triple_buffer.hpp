@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace eray::util {
+
+/**
+ * @brief Lock-free single producer, single consumer exchange of the latest value. The producer writes into a private
+ * buffer and publishes it, the consumer always reads the most recently published value. Neither of the sides ever
+ * waits for the other, the values published in between two reads are skipped.
+ *
+ * Useful for passing e.g. the simulation state from the physics thread to the render thread.
+ *
+ */
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() = default;
+  explicit TripleBuffer(const T& initial) : buffers_{initial, initial, initial} {}
+
+  TripleBuffer(const TripleBuffer&)            = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  /**
+   * @brief Buffer owned by the producer. Its contents are undefined after `publish()`, it holds one of the older
+   * values.
+   *
+   */
+  T& write_buffer() { return buffers_[write_]; }
+
+  /**
+   * @brief Publishes the write buffer, called by the producer.
+   *
+   */
+  void publish() {
+    const auto previous = middle_.exchange(static_cast<uint8_t>(write_ | kDirtyBit), std::memory_order_acq_rel);
+    write_              = static_cast<uint8_t>(previous & kIndexMask);
+  }
+
+  /**
+   * @brief Returns the latest published value, called by the consumer. The reference is valid until the next call.
+   *
+   */
+  const T& read() {
+    if (has_update()) {
+      const auto previous = middle_.exchange(read_, std::memory_order_acq_rel);
+      read_               = static_cast<uint8_t>(previous & kIndexMask);
+    }
+    return buffers_[read_];
+  }
+
+  /**
+   * @brief True if a value has been published since the last `read()`.
+   *
+   */
+  bool has_update() const { return (middle_.load(std::memory_order_acquire) & kDirtyBit) != 0; }
+
+ private:
+  static constexpr uint8_t kIndexMask = 0b011;
+  static constexpr uint8_t kDirtyBit  = 0b100;
+
+  std::array<T, 3> buffers_{};
+  uint8_t write_               = 0;
+  std::atomic<uint8_t> middle_ = 1;
+  uint8_t read_                = 2;
+};
+
+}  // namespace eray::util
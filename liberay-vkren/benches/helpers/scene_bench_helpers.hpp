@@ -0,0 +1,55 @@
+#pragma once
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/vkren/scene/entity_pool.hpp>
+#include <liberay/vkren/scene/flat_tree.hpp>
+#include <random>
+#include <vector>
+
+namespace eray::vkren::bench {
+
+// Scene sizes from a small level up to a large open world
+inline void node_count_args(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(1'000, 10'000'000);
+}
+
+inline std::mt19937_64& rng() {
+  static auto engine = std::mt19937_64(42);
+  return engine;
+}
+
+inline size_t random_index(size_t count) { return std::uniform_int_distribution<size_t>(0, count - 1)(rng()); }
+
+/**
+ * @brief Picks `count` distinct random elements of the `values`.
+ *
+ */
+template <typename T>
+std::vector<T> random_subset(std::vector<T> values, size_t count) {
+  std::ranges::shuffle(values, rng());
+  values.resize(std::min(count, values.size()));
+  return values;
+}
+
+/**
+ * @brief Builds a random recursive tree of `count` nodes: the parent of every node is the root (1 in 8) or a uniformly
+ * chosen earlier node, so the tree has O(log n) levels and a mix of the leaves and the wide nodes like a typical scene.
+ *
+ * @tparam TTree `FlatTree` or `TransformTree`.
+ * @return std::vector<NodeId> The created nodes in the creation order.
+ */
+template <typename TTree>
+std::vector<NodeId> build_random_tree(TTree& tree, size_t count) {
+  auto nodes = std::vector<NodeId>();
+  nodes.reserve(count);
+  for (auto i = size_t{0}; i < count; ++i) {
+    const auto orphan = nodes.empty() || random_index(8) == 0;
+    nodes.push_back(tree.create_node(orphan ? FlatTree::kRootNodeId : nodes[random_index(nodes.size())]));
+  }
+  return nodes;
+}
+
+}  // namespace eray::vkren::bench
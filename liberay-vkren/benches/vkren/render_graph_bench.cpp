@@ -0,0 +1,245 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <expected>
+#include <liberay/util/try.hpp>
+#include <liberay/util/variant_match.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/render_graph.hpp>
+#include <memory>
+#include <span>
+#include <variant>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+using namespace eray::vkren;  // NOLINT
+namespace util = eray::util;
+
+// The CPU cost of `RenderGraph::compile()` and `RenderGraph::emit()` on synthetic graphs. The graphs are recorded into
+// a command buffer of a headless device that is never submitted, so that only the graph compilation, the barrier
+// batches and the driver recording cost are measured. The passes record no commands of their own.
+
+namespace {
+
+constexpr uint32_t kAttachmentSize     = 64;
+constexpr vk::DeviceSize kStorageBytes = 4096;
+
+enum class GraphShape : uint8_t {
+  /**
+   * @brief Every pass consumes the output of the previous pass.
+   *
+   */
+  Chain,
+
+  /**
+   * @brief Repeated diamonds: a pass feeds two independent passes that are joined by the fourth pass, which feeds the
+   * next diamond.
+   *
+   */
+  Diamond,
+
+  /**
+   * @brief The first pass feeds every other pass, whose outputs are all consumed by the final pass.
+   *
+   */
+  FanOut,
+};
+
+struct BenchDevice {
+  vk::raii::Context context;
+  std::unique_ptr<Device> device;
+  vk::raii::CommandPool command_pool = nullptr;
+  vk::raii::CommandBuffer cmd_buff   = nullptr;
+};
+
+/**
+ * @brief Headless device without the validation layers, created on the first use and shared by all of the benchmarks.
+ * Null when no Vulkan device is available.
+ *
+ */
+BenchDevice* bench_device() {
+  static auto instance = []() -> std::unique_ptr<BenchDevice> {
+    auto result            = std::make_unique<BenchDevice>();
+    auto profile           = Device::CreateInfo::DesktopProfile{};
+    auto info              = profile.get_headless();
+    info.validation_layers = {};
+
+    auto device = Device::create(result->context, info);
+    if (!device) {
+      return nullptr;
+    }
+    result->device = std::move(*device);
+
+    auto pool = (*result->device)->createCommandPool(vk::CommandPoolCreateInfo{
+        .flags            = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = result->device->graphics_queue_family(),
+    });
+    if (!pool) {
+      return nullptr;
+    }
+    result->command_pool = std::move(*pool);
+
+    auto cmd_buffs = (*result->device)
+                         ->allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+                             .commandPool        = *result->command_pool,
+                             .level              = vk::CommandBufferLevel::ePrimary,
+                             .commandBufferCount = 1,
+                         });
+    if (!cmd_buffs) {
+      return nullptr;
+    }
+    result->cmd_buff = std::move(cmd_buffs->front());
+
+    return result;
+  }();
+  return instance.get();
+}
+
+using PassOutput = std::variant<RenderPassAttachmentHandle, ShaderStorageHandle>;
+
+/**
+ * @brief Adds a pass that consumes the `inputs`. Every third pass is a compute pass that writes a storage buffer, the
+ * rest are render passes that write a color attachment, so the graph mixes the image and the buffer barriers.
+ *
+ */
+Result<PassOutput, Error> add_pass(Device& device, RenderGraph& graph, uint32_t index,
+                                   std::span<const PassOutput> inputs) {
+  if (index % 3 == 2) {
+    auto builder = graph.compute_pass_builder();
+    for (const auto& input : inputs) {
+      std::visit(util::match{
+                     [&](RenderPassAttachmentHandle handle) {
+                       builder.with_image_dependency(handle, vk::PipelineStageFlagBits2::eComputeShader);
+                     },
+                     [&](ShaderStorageHandle handle) { builder.with_buffer_dependency(handle); },
+                 },
+                 input);
+    }
+    const auto storage = graph.create_shader_storage_buffer(device, kStorageBytes);
+    TRY(builder.with_shader_storage(storage).build());
+    return storage;
+  }
+
+  auto builder = graph.render_pass_builder();
+  for (const auto& input : inputs) {
+    std::visit(util::match{
+                   [&](RenderPassAttachmentHandle handle) { builder.with_image_dependency(handle); },
+                   [&](ShaderStorageHandle handle) {
+                     builder.with_buffer_dependency(handle, vk::PipelineStageFlagBits2::eFragmentShader);
+                   },
+               },
+               input);
+  }
+  const auto attachment = graph.create_color_attachment(device, kAttachmentSize, kAttachmentSize, true);
+  TRY(builder.with_color_attachment(attachment).build(kAttachmentSize, kAttachmentSize));
+  return attachment;
+}
+
+void add_final_dependency(RenderGraph& graph, const PassOutput& output) {
+  std::visit(util::match{
+                 [&](RenderPassAttachmentHandle handle) { graph.emplace_final_pass_dependency(handle); },
+                 [&](ShaderStorageHandle handle) { graph.emplace_final_pass_storage_buffer_dependency(handle); },
+             },
+             output);
+}
+
+Result<RenderGraph, Error> build_graph(Device& device, GraphShape shape, uint32_t pass_count) {
+  auto graph   = RenderGraph::create();
+  auto outputs = std::vector<PassOutput>();
+  outputs.reserve(pass_count);
+
+  for (auto i = 0U; i < pass_count; ++i) {
+    auto inputs = std::vector<PassOutput>();
+    if (i > 0) {
+      switch (shape) {
+        case GraphShape::Chain:
+          inputs.push_back(outputs[i - 1]);
+          break;
+        case GraphShape::Diamond:
+          // The top of a diamond is preceded by the bottom of the previous one, the sides by the top
+          if (i % 4 == 3) {
+            inputs = {outputs[i - 2], outputs[i - 1]};
+          } else {
+            inputs.push_back(outputs[i % 4 == 0 ? i - 1 : i - (i % 4)]);
+          }
+          break;
+        case GraphShape::FanOut:
+          inputs.push_back(outputs[0]);
+          break;
+      }
+    }
+    TRY_UNWRAP_DEFINE(output, add_pass(device, graph, i, inputs));
+    outputs.push_back(output);
+  }
+
+  if (shape == GraphShape::FanOut) {
+    for (auto i = 1U; i < pass_count; ++i) {
+      add_final_dependency(graph, outputs[i]);
+    }
+  } else {
+    add_final_dependency(graph, outputs.back());
+  }
+
+  return graph;
+}
+
+void pass_count_args(benchmark::internal::Benchmark* bench) {
+  bench->Arg(10)->Arg(50)->Arg(100)->Arg(250)->Arg(500)->ArgName("passes")->Unit(benchmark::kMicrosecond);
+}
+
+}  // namespace
+
+// A frame of the steady state: the graph is compiled once, every iteration records it again
+static void BM_RenderGraphEmit(benchmark::State& state, GraphShape shape) {
+  auto* bench = bench_device();
+  if (bench == nullptr) {
+    state.SkipWithError("Could not create a headless Vulkan device");
+    return;
+  }
+
+  auto graph = build_graph(*bench->device, shape, static_cast<uint32_t>(state.range(0)));
+  if (!graph || !graph->compile()) {
+    state.SkipWithError("Could not build the render graph");
+    return;
+  }
+
+  auto cmd_buff = *bench->cmd_buff;
+  for (auto _ : state) {
+    cmd_buff.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    graph->emit(*bench->device, cmd_buff);
+    cmd_buff.end();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_RenderGraphEmit, chain, GraphShape::Chain)->Apply(pass_count_args);
+BENCHMARK_CAPTURE(BM_RenderGraphEmit, diamond, GraphShape::Diamond)->Apply(pass_count_args);
+BENCHMARK_CAPTURE(BM_RenderGraphEmit, fan_out, GraphShape::FanOut)->Apply(pass_count_args);
+
+// A full compilation, as after a pass is added, with the compilation cache disabled
+static void BM_RenderGraphCompile(benchmark::State& state, GraphShape shape) {
+  auto* bench = bench_device();
+  if (bench == nullptr) {
+    state.SkipWithError("Could not create a headless Vulkan device");
+    return;
+  }
+
+  auto graph = build_graph(*bench->device, shape, static_cast<uint32_t>(state.range(0)));
+  if (!graph) {
+    state.SkipWithError("Could not build the render graph");
+    return;
+  }
+  graph->set_compilation_cache_capacity(0);
+
+  for (auto _ : state) {
+    if (!graph->compile()) {
+      state.SkipWithError("Could not compile the render graph");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_RenderGraphCompile, chain, GraphShape::Chain)->Apply(pass_count_args);
+BENCHMARK_CAPTURE(BM_RenderGraphCompile, diamond, GraphShape::Diamond)->Apply(pass_count_args);
+BENCHMARK_CAPTURE(BM_RenderGraphCompile, fan_out, GraphShape::FanOut)->Apply(pass_count_args);
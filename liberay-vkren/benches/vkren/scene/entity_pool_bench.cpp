@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/scene_bench_helpers.hpp>
+#include <cstddef>
+#include <liberay/vkren/scene/entity_pool.hpp>
+#include <utility>
+#include <vector>
+
+using namespace eray::vkren;         // NOLINT
+using namespace eray::vkren::bench;  // NOLINT
+
+// Every iteration creates a pool, fills it and removes all of its entities in a random order, the following creates
+// reuse the shuffled free list
+
+static void BM_EntityPoolCreateRemove(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto pool        = EntityPool<NodeId>::create(count);
+  auto ids         = std::vector<NodeId>(count);
+  auto order       = std::vector<size_t>(count);
+  for (auto i = size_t{0}; i < count; ++i) {
+    order[i] = i;
+  }
+  order = random_subset(std::move(order), count);
+
+  for (auto _ : state) {
+    for (auto& id : ids) {
+      id = pool.create();
+    }
+    for (const auto i : order) {
+      pool.remove(ids[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_EntityPoolCreateRemove)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
+
+static void BM_EntityPoolCreateRemoveMany(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto pool        = EntityPool<NodeId>::create(count);
+  auto ids         = std::vector<NodeId>(count);
+
+  for (auto _ : state) {
+    pool.create_many(ids);
+    pool.remove_many(ids);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_EntityPoolCreateRemoveMany)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
+
+static void BM_EntityPoolExists(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto pool        = EntityPool<NodeId>::create(count);
+  auto ids         = std::vector<NodeId>(count);
+  pool.create_many(ids);
+  ids = random_subset(std::move(ids), count);
+
+  auto i = size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pool.exists(ids[i]));
+    i = i + 1 == count ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EntityPoolExists)->Apply(node_count_args);
+
+static void BM_EntityPoolForEach(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto pool        = EntityPool<NodeId>::create(count);
+  auto ids         = std::vector<NodeId>(count);
+  pool.create_many(ids);
+
+  // Every other entity is removed, so that the live bitmask is sparse
+  for (auto i = size_t{0}; i < count; i += 2) {
+    pool.remove(ids[i]);
+  }
+  for (auto _ : state) {
+    auto visited = size_t{0};
+    pool.for_each([&](NodeId id) {
+      benchmark::DoNotOptimize(id);
+      ++visited;
+    });
+    benchmark::DoNotOptimize(visited);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(pool.count()));
+}
+BENCHMARK(BM_EntityPoolForEach)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/scene_bench_helpers.hpp>
+#include <cstddef>
+#include <liberay/vkren/scene/flat_tree.hpp>
+#include <vector>
+
+using namespace eray::vkren;         // NOLINT
+using namespace eray::vkren::bench;  // NOLINT
+
+namespace {
+
+// Number of the leaves that are recreated in turns by the churn, the rest of the tree stays intact
+constexpr size_t kChurnNodeCount = 64;
+
+// Number of the precomputed random operands, cycled through by the edits
+constexpr size_t kOperandCount = 4096;
+
+// Node counts, with the DFS preorder cache built before the edits (1) or left dirty (0). A renderer requests the
+// preorder every frame, so the edits keep it up to date.
+void edit_args(benchmark::internal::Benchmark* bench) {
+  bench->ArgsProduct({{1'000, 10'000, 100'000, 1'000'000, 10'000'000}, {0, 1}})->ArgNames({"nodes", "dfs_cached"});
+}
+
+std::vector<NodeId> random_picks(const std::vector<NodeId>& nodes, size_t count) {
+  auto picks = std::vector<NodeId>(count);
+  for (auto& pick : picks) {
+    pick = nodes[random_index(nodes.size())];
+  }
+  return picks;
+}
+
+}  // namespace
+
+static void BM_FlatTreeBuild(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    auto tree = FlatTree::create(count + 1);
+    benchmark::DoNotOptimize(build_random_tree(tree, count));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FlatTreeBuild)->Apply(node_count_args)->Unit(benchmark::kMillisecond);
+
+// Every iteration deletes the oldest churned leaf and creates a new one under a random node
+static void BM_FlatTreeCreateDeleteChurn(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto tree        = FlatTree::create(count + kChurnNodeCount + 1);
+  const auto nodes = build_random_tree(tree, count);
+  if (state.range(1) != 0) {
+    benchmark::DoNotOptimize(tree.nodes_dfs_preorder());
+  }
+
+  const auto parents = random_picks(nodes, kOperandCount);
+  auto churned       = std::vector<NodeId>(kChurnNodeCount, FlatTree::kNullNodeId);
+  auto i             = size_t{0};
+  for (auto _ : state) {
+    auto& leaf = churned[i % kChurnNodeCount];
+    if (leaf != FlatTree::kNullNodeId) {
+      tree.delete_node(leaf);
+    }
+    leaf = tree.create_node(parents[i % kOperandCount]);
+    ++i;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FlatTreeCreateDeleteChurn)->Apply(edit_args);
+
+// Moves random subtrees under random nodes, the root adopts the subtree when the new parent is its descendant
+static void BM_FlatTreeReparent(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto tree        = FlatTree::create(count + 1);
+  const auto nodes = build_random_tree(tree, count);
+  if (state.range(1) != 0) {
+    benchmark::DoNotOptimize(tree.nodes_dfs_preorder());
+  }
+
+  const auto children = random_picks(nodes, kOperandCount);
+  const auto parents  = random_picks(nodes, kOperandCount);
+  auto i              = size_t{0};
+  for (auto _ : state) {
+    const auto child = children[i % kOperandCount];
+    auto parent      = parents[i % kOperandCount];
+    if (parent == child || tree.is_descendant(parent, child)) {
+      parent = FlatTree::kRootNodeId;
+    }
+    tree.change_parent(child, parent);
+    ++i;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FlatTreeReparent)->Apply(edit_args);
+
+// The rebuilds start from a copy of the tree with the dirty caches, the copy is not measured
+static void BM_FlatTreeDfsCacheRebuild(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto source      = FlatTree::create(count + 1);
+  build_random_tree(source, count);
+
+  auto tree = source;
+  for (auto _ : state) {
+    state.PauseTiming();
+    tree = source;
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(tree.nodes_dfs_preorder().data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FlatTreeDfsCacheRebuild)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
+
+static void BM_FlatTreeBfsCacheRebuild(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto source      = FlatTree::create(count + 1);
+  build_random_tree(source, count);
+
+  auto tree = source;
+  for (auto _ : state) {
+    state.PauseTiming();
+    tree = source;
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(tree.nodes_bfs_order().data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FlatTreeBfsCacheRebuild)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
+
+// The allocation free traversal through the node links, the alternative to the cached preorder
+static void BM_FlatTreeDfsWalk(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto tree        = FlatTree::create(count + 1);
+  build_random_tree(tree, count);
+
+  for (auto _ : state) {
+    auto visited = size_t{0};
+    for (const auto node : FlatTreeDFSRange(&tree, FlatTree::kRootNodeId)) {
+      benchmark::DoNotOptimize(node);
+      ++visited;
+    }
+    benchmark::DoNotOptimize(visited);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FlatTreeDfsWalk)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/scene_bench_helpers.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/scene/sparse_set.hpp>
+#include <utility>
+#include <vector>
+
+using namespace eray::vkren;         // NOLINT
+using namespace eray::vkren::bench;  // NOLINT
+namespace math = eray::math;
+
+namespace {
+
+// A component of a position and an index, keyed by the node index
+using ComponentSet = SparseSet<uint32_t, math::Vec3f, uint32_t>;
+
+// Every other key of the range is used, in a random order, so that the sparse pages are half full
+std::vector<uint32_t> random_keys(size_t count) {
+  auto keys = std::vector<uint32_t>(count);
+  for (auto i = size_t{0}; i < count; ++i) {
+    keys[i] = static_cast<uint32_t>(i * 2);
+  }
+  return random_subset(std::move(keys), count);
+}
+
+ComponentSet filled_set(const std::vector<uint32_t>& keys) {
+  auto set = ComponentSet::create(static_cast<uint32_t>(keys.size() * 2));
+  for (const auto key : keys) {
+    set.insert(key, math::Vec3f::filled(static_cast<float>(key)), uint32_t{key});
+  }
+  return set;
+}
+
+}  // namespace
+
+static void BM_SparseSetInsert(benchmark::State& state) {
+  const auto keys = random_keys(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(filled_set(keys).size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SparseSetInsert)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
+
+// The removals swap the last element into the hole, in a random order they touch random dense entries
+static void BM_SparseSetRemove(benchmark::State& state) {
+  const auto keys         = random_keys(static_cast<size_t>(state.range(0)));
+  const auto removal_keys = random_subset(keys, keys.size());
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto set = filled_set(keys);
+    state.ResumeTiming();
+    for (const auto key : removal_keys) {
+      set.remove(key);
+    }
+    benchmark::DoNotOptimize(set.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SparseSetRemove)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
+
+static void BM_SparseSetLookup(benchmark::State& state) {
+  const auto keys    = random_keys(static_cast<size_t>(state.range(0)));
+  const auto set     = filled_set(keys);
+  const auto lookups = random_subset(keys, keys.size());
+  auto i             = size_t{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set.at<math::Vec3f>(lookups[i]));
+    i = i + 1 == lookups.size() ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SparseSetLookup)->Apply(node_count_args);
+
+static void BM_SparseSetIterate(benchmark::State& state) {
+  const auto set = filled_set(random_keys(static_cast<size_t>(state.range(0))));
+  for (auto _ : state) {
+    auto sum = math::Vec3f::filled(0.F);
+    for (const auto& position : set.values<math::Vec3f>()) {
+      sum += position;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SparseSetIterate)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
+
+static void BM_SparseSetIterateKeyValuePairs(benchmark::State& state) {
+  const auto set = filled_set(random_keys(static_cast<size_t>(state.range(0))));
+  for (auto _ : state) {
+    auto sum = uint64_t{0};
+    for (const auto& [key, index] : set.key_value_pairs<uint32_t>()) {
+      sum += key ^ index;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SparseSetIterateKeyValuePairs)->Apply(node_count_args)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <benches/helpers/scene_bench_helpers.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/vec.hpp>
+#include <liberay/util/job_system.hpp>
+#include <liberay/vkren/scene/transform_tree.hpp>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace eray::vkren;         // NOLINT
+using namespace eray::vkren::bench;  // NOLINT
+namespace math = eray::math;
+
+namespace {
+
+// Node counts and the percentage of the nodes whose local transform changes between the updates. The dirty nodes are
+// random, so a dirty node also updates all of its descendants, like a moved object carries its children.
+void update_args(benchmark::internal::Benchmark* bench) {
+  bench->ArgsProduct({{1'000, 10'000, 100'000, 1'000'000, 10'000'000}, {1, 10, 100}})
+      ->ArgNames({"nodes", "dirty_pct"})
+      ->Unit(benchmark::kMicrosecond);
+}
+
+struct UpdateFixture {
+  // The inverse world matrices are not needed by the update, dropping them keeps the largest scenes in memory
+  TransformTree tree = TransformTree(nullptr);
+  std::vector<NodeId> dirty_nodes;
+
+  explicit UpdateFixture(const benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    tree             = TransformTree::create(count + 1, InverseWorldMatrices::None);
+    auto nodes       = build_random_tree(tree, count);
+    tree.update();
+    dirty_nodes = random_subset(std::move(nodes), count * static_cast<size_t>(state.range(1)) / 100);
+  }
+
+  void mark_dirty(float offset) {
+    for (const auto node : dirty_nodes) {
+      tree.set_local_position(node, math::Vec3f(offset, 0.F, 0.F));
+    }
+  }
+};
+
+}  // namespace
+
+static void BM_TransformTreeUpdate(benchmark::State& state) {
+  auto fixture = UpdateFixture(state);
+  auto offset  = 0.F;
+  for (auto _ : state) {
+    state.PauseTiming();
+    fixture.mark_dirty(offset += 1.F);
+    state.ResumeTiming();
+    fixture.tree.update();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(fixture.dirty_nodes.size()));
+}
+BENCHMARK(BM_TransformTreeUpdate)->Apply(update_args);
+
+static void BM_TransformTreeParallelUpdate(benchmark::State& state) {
+  auto fixture = UpdateFixture(state);
+  auto jobs    = eray::util::JobSystem::create();
+  auto offset  = 0.F;
+  for (auto _ : state) {
+    state.PauseTiming();
+    fixture.mark_dirty(offset += 1.F);
+    state.ResumeTiming();
+    fixture.tree.update(*jobs);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(fixture.dirty_nodes.size()));
+}
+BENCHMARK(BM_TransformTreeParallelUpdate)->Apply(update_args)->UseRealTime();
+
+// Marking is paid by the gameplay code for every changed transform, separately from the update
+static void BM_TransformTreeMarkDirty(benchmark::State& state) {
+  auto fixture = UpdateFixture(state);
+  auto offset  = 0.F;
+  for (auto _ : state) {
+    fixture.mark_dirty(offset += 1.F);
+    state.PauseTiming();
+    fixture.tree.update();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(fixture.dirty_nodes.size()));
+}
+BENCHMARK(BM_TransformTreeMarkDirty)->Apply(update_args);
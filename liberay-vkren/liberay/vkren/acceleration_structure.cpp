@@ -0,0 +1,653 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <cassert>
+#include <expected>
+#include <iterator>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/acceleration_structure.hpp>
+#include <liberay/vkren/error.hpp>
+#include <ranges>
+#include <utility>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+constexpr auto kBlasBuildFlags =
+    vk::BuildAccelerationStructureFlagsKHR{vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace |
+                                           vk::BuildAccelerationStructureFlagBitsKHR::eAllowCompaction};
+constexpr auto kTlasBuildFlags =
+    vk::BuildAccelerationStructureFlagsKHR{vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace |
+                                           vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate};
+
+vk::DeviceAddress align_up(vk::DeviceAddress address, vk::DeviceSize alignment) {
+  return (address + alignment - 1) / alignment * alignment;
+}
+
+vk::DeviceOrHostAddressConstKHR const_address(vk::DeviceAddress address) {
+  auto result          = vk::DeviceOrHostAddressConstKHR{};
+  result.deviceAddress = address;
+  return result;
+}
+
+/**
+ * @brief The instances are read from the instance buffer, so the TLAS geometry does not depend on their count.
+ *
+ */
+vk::AccelerationStructureGeometryKHR instances_geometry(vk::DeviceAddress instance_buffer_address) {
+  auto geometry               = vk::AccelerationStructureGeometryKHR{.geometryType = vk::GeometryTypeKHR::eInstances};
+  geometry.geometry.instances = vk::AccelerationStructureGeometryInstancesDataKHR{
+      .arrayOfPointers = vk::False,
+      .data            = const_address(instance_buffer_address),
+  };
+  return geometry;
+}
+
+void build_barrier(vk::CommandBuffer cmd_buff, vk::PipelineStageFlags2 src_stage_mask) {
+  auto barrier = vk::MemoryBarrier2{
+      .srcStageMask  = src_stage_mask,
+      .srcAccessMask = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+      .dstAccessMask =
+          vk::AccessFlagBits2::eAccelerationStructureReadKHR | vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &barrier,
+  });
+}
+
+}  // namespace
+
+Result<AccelerationStructureBuilder, Error> AccelerationStructureBuilder::create(Device& device,
+                                                                                 const GeometryArena& arena,
+                                                                                 FrameDeletionQueue& deletion_queue,
+                                                                                 uint32_t max_instances,
+                                                                                 vk::DeviceSize scratch_size) {
+  if (!device.has_ray_query()) {
+    util::Logger::err("Could not create the acceleration structure builder. The ray queries are not enabled");
+    return std::unexpected(Error{
+        .msg  = "Acceleration structures are not supported",
+        .code = ErrorCode::ExtensionNotSupported{.extension = vk::KHRAccelerationStructureExtensionName},
+    });
+  }
+  assert(max_instances > 0 && scratch_size > 0 && "Builder must not be empty");
+
+  auto builder              = AccelerationStructureBuilder(nullptr);
+  builder.p_device_         = &device;
+  builder.p_arena_          = &arena;
+  builder.p_deletion_queue_ = &deletion_queue;
+  builder.max_instances_    = max_instances;
+
+  const auto as_properties =
+      device.physical_device()
+          .getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceAccelerationStructurePropertiesKHR>()
+          .get<vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+  builder.scratch_alignment_ = as_properties.minAccelerationStructureScratchOffsetAlignment;
+
+  // The buffer is padded, so that the whole pool fits past the aligned base address
+  auto scratch_buffer =
+      BufferResource::create_gpu_local_buffer(device, scratch_size + builder.scratch_alignment_,
+                                              vk::BufferUsageFlagBits::eStorageBuffer |
+                                                  vk::BufferUsageFlagBits::eShaderDeviceAddress);
+  if (!scratch_buffer) {
+    return std::unexpected(scratch_buffer.error());
+  }
+  builder.scratch_buffer_ = std::move(*scratch_buffer);
+  builder.scratch_address_ =
+      align_up(device->getBufferAddress(vk::BufferDeviceAddressInfo{.buffer = builder.scratch_buffer_.vk_buffer()}),
+               builder.scratch_alignment_);
+
+  auto block_info = VmaVirtualBlockCreateInfo{};
+  block_info.size = scratch_size;
+
+  VmaVirtualBlock block = VK_NULL_HANDLE;
+  if (auto result = vmaCreateVirtualBlock(&block_info, &block); result != VK_SUCCESS) {
+    return std::unexpected(Error{
+        .msg     = "Could not create a virtual block",
+        .code    = ErrorCode::MemoryAllocationFailure{},
+        .vk_code = vk::Result(result),
+    });
+  }
+  builder.scratch_block_.reset(block);
+
+  auto instance_buffer = BufferResource::create_gpu_local_buffer(
+      device, static_cast<vk::DeviceSize>(max_instances) * sizeof(vk::AccelerationStructureInstanceKHR),
+      vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
+          vk::BufferUsageFlagBits::eShaderDeviceAddress);
+  if (!instance_buffer) {
+    return std::unexpected(instance_buffer.error());
+  }
+  builder.instance_buffer_ = std::move(*instance_buffer);
+  builder.instance_records_.reserve(max_instances);
+
+  const auto query_pool_info = vk::QueryPoolCreateInfo{
+      .queryType  = vk::QueryType::eAccelerationStructureCompactedSizeKHR,
+      .queryCount = kMaxPendingCompactions,
+  };
+  if (auto result = device->createQueryPool(query_pool_info)) {
+    builder.query_pool_ = std::move(*result);
+  } else {
+    util::Logger::err("Could not create the compaction query pool. {}", vk::to_string(result.error()));
+    return std::unexpected(Error{
+        .msg     = "Compaction query pool creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = result.error(),
+    });
+  }
+  builder.query_pool_.reset(0, kMaxPendingCompactions);
+  for (auto query = kMaxPendingCompactions; query > 0; --query) {
+    builder.free_queries_.push_back(query - 1);
+  }
+
+  // The TLAS is allocated for the full capacity once, so that a change of the instance count needs no reallocation
+  const auto geometry   = instances_geometry(0);
+  const auto build_info = vk::AccelerationStructureBuildGeometryInfoKHR{
+      .type          = vk::AccelerationStructureTypeKHR::eTopLevel,
+      .flags         = kTlasBuildFlags,
+      .geometryCount = 1,
+      .pGeometries   = &geometry,
+  };
+  const auto sizes =
+      device->getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice, build_info,
+                                                    max_instances);
+  if (sizes.buildScratchSize > scratch_size) {
+    util::Logger::err("The TLAS of {} instances needs {} bytes of scratch, the pool has {}", max_instances,
+                      sizes.buildScratchSize, scratch_size);
+    return std::unexpected(Error{
+        .msg  = "Scratch pool is too small",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  auto tlas = builder.create_acceleration_structure(vk::AccelerationStructureTypeKHR::eTopLevel,
+                                                    sizes.accelerationStructureSize);
+  if (!tlas) {
+    return std::unexpected(tlas.error());
+  }
+  builder.tlas_.structure           = std::move(*tlas);
+  builder.tlas_.build_scratch_size  = sizes.buildScratchSize;
+  builder.tlas_.update_scratch_size = sizes.updateScratchSize;
+
+  return builder;
+}
+
+Result<BlasHandle, Error> AccelerationStructureBuilder::add_blas(GeometryHandle geometry, bool opaque) {
+  auto blas     = Blas{};
+  blas.geometry = geometry;
+  blas.opaque   = opaque;
+
+  const auto triangles  = blas_geometry(blas);
+  const auto primitives = p_arena_->range(geometry).index_count / 3;
+
+  const auto build_info = vk::AccelerationStructureBuildGeometryInfoKHR{
+      .type          = vk::AccelerationStructureTypeKHR::eBottomLevel,
+      .flags         = kBlasBuildFlags,
+      .geometryCount = 1,
+      .pGeometries   = &triangles,
+  };
+  const auto sizes = (*p_device_)->getAccelerationStructureBuildSizesKHR(
+      vk::AccelerationStructureBuildTypeKHR::eDevice, build_info, primitives);
+
+  // Shares the pool with the TLAS scratch, which is allocated first
+  const auto scratch_capacity =
+      scratch_buffer_.size_bytes - scratch_alignment_ - align_up(tlas_.build_scratch_size, scratch_alignment_);
+  if (sizes.buildScratchSize > scratch_capacity) {
+    util::Logger::err("The BLAS of {} triangles needs {} bytes of scratch, the pool has {}", primitives,
+                      sizes.buildScratchSize, scratch_capacity);
+    return std::unexpected(Error{
+        .msg  = "Scratch pool is too small",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  auto structure =
+      create_acceleration_structure(vk::AccelerationStructureTypeKHR::eBottomLevel, sizes.accelerationStructureSize);
+  if (!structure) {
+    return std::unexpected(structure.error());
+  }
+  blas.current            = std::move(*structure);
+  blas.build_scratch_size = sizes.buildScratchSize;
+
+  const auto handle = blases_.insert(std::move(blas));
+  pending_builds_.push_back(handle);
+  return handle;
+}
+
+void AccelerationStructureBuilder::remove_blas(BlasHandle handle) {
+  if (!blases_.contains(handle)) {
+    return;
+  }
+
+  auto& blas = blases_[handle];
+  release(blas.current);
+  if (blas.compacted) {
+    release(*blas.compacted);
+  }
+  if (blas.query) {
+    retired_queries_.push_back(*blas.query);
+  }
+  std::erase(pending_builds_, handle);
+  std::erase(pending_compactions_, handle);
+  std::erase(pending_copies_, handle);
+  blases_.erase(handle);
+}
+
+void AccelerationStructureBuilder::set_instances(std::span<const AccelerationStructureInstance> instances) {
+  assert(instances.size() <= max_instances_ && "Instance capacity exceeded");
+
+  instances_.assign(instances.begin(), instances.end());
+  node_instances_.clear();
+  for (auto i = 0U; i < instances_.size(); ++i) {
+    node_instances_.emplace_back(instances_[i].node_index, i);
+  }
+  std::ranges::sort(node_instances_);
+  instances_changed_ = true;
+}
+
+Result<void, Error> AccelerationStructureBuilder::sync(const TransformTree& tree, StagingRingBuffer& staging) {
+  ERAY_PROFILE_FUNCTION();
+
+  std::erase_if(retired_queries_, [this](uint32_t query) { return read_query(query).has_value(); });
+
+  // The compacted BLAS replaces the original one in the TLAS, so the instances are rebuilt with its address
+  for (auto it = pending_compactions_.begin(); it != pending_compactions_.end();) {
+    const auto handle = *it;
+    auto& blas        = blases_[handle];
+    auto size         = read_query(*blas.query);
+    if (!size) {
+      ++it;
+      continue;
+    }
+    blas.query = std::nullopt;
+    it         = pending_compactions_.erase(it);
+
+    auto compacted = create_acceleration_structure(vk::AccelerationStructureTypeKHR::eBottomLevel, *size);
+    if (!compacted) {
+      // The original BLAS stays in use
+      continue;
+    }
+    blas.compacted = std::move(*compacted);
+    pending_copies_.push_back(handle);
+    instances_changed_ = true;
+  }
+
+  const auto update = tree.update_count();
+  changed_indices_.clear();
+  if (instances_changed_ || !synced_update_ || !tree.world_matrices_changed_since(*synced_update_, changed_indices_)) {
+    const auto& matrices = tree.local_to_world_matrices();
+    instance_records_.clear();
+    for (const auto& instance : instances_) {
+      instance_records_.push_back(instance_record(instance, matrices[instance.node_index]));
+    }
+    if (auto result = stage_instances(staging, 0, static_cast<uint32_t>(instance_records_.size())); !result) {
+      return std::unexpected(result.error());
+    }
+
+    instances_changed_    = false;
+    tlas_rebuild_pending_ = true;
+    synced_update_        = update;
+    return {};
+  }
+
+  changed_instances_.clear();
+  for (auto node_index : changed_indices_) {
+    auto [begin, end] = std::ranges::equal_range(node_instances_, node_index, {},
+                                                 [](const auto& node_instance) { return node_instance.first; });
+    for (const auto& [node, instance] : std::ranges::subrange(begin, end)) {
+      changed_instances_.push_back(instance);
+    }
+  }
+
+  // Adjacent instances are copied with a single region
+  const auto& matrices = tree.local_to_world_matrices();
+  std::ranges::sort(changed_instances_);
+  for (auto begin = changed_instances_.begin(); begin != changed_instances_.end();) {
+    auto end = std::next(begin);
+    while (end != changed_instances_.end() && *end == *std::prev(end) + 1) {
+      ++end;
+    }
+    for (auto it = begin; it != end; ++it) {
+      instance_records_[*it] = instance_record(instances_[*it], matrices[instances_[*it].node_index]);
+    }
+    if (auto result = stage_instances(staging, *begin, static_cast<uint32_t>(end - begin)); !result) {
+      return std::unexpected(result.error());
+    }
+    begin = end;
+  }
+
+  if (!changed_instances_.empty()) {
+    tlas_refit_pending_ = true;
+  }
+  synced_update_ = update;
+  return {};
+}
+
+void AccelerationStructureBuilder::record_write_barrier(vk::CommandBuffer cmd_buff) {
+  if (!has_staged_writes_) {
+    return;
+  }
+  has_staged_writes_ = false;
+
+  // Write after read hazards need an execution dependency only
+  auto barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+      .srcAccessMask = vk::AccessFlagBits2::eNone,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eCopy,
+      .dstAccessMask = vk::AccessFlagBits2::eNone,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &barrier,
+  });
+}
+
+void AccelerationStructureBuilder::record_build(vk::CommandBuffer cmd_buff) {
+  ERAY_PROFILE_FUNCTION();
+
+  // The previous builds are written and the previous ray queries are done before any structure is rewritten
+  build_barrier(cmd_buff, vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR |
+                              vk::PipelineStageFlagBits2::eComputeShader |
+                              vk::PipelineStageFlagBits2::eFragmentShader);
+  vmaClearVirtualBlock(scratch_block_.get());
+
+  // The TLAS scratch is allocated first, so that the BLAS builds never starve it. The pool fits it, see `create()`.
+  const auto tlas_pending = (tlas_rebuild_pending_ || tlas_refit_pending_) && !instances_.empty();
+  const auto refit        = !tlas_rebuild_pending_ && tlas_.built && refit_count_ < kMaxRefitsPerRebuild;
+  auto tlas_scratch       = vk::DeviceAddress{0};
+  if (tlas_pending) {
+    tlas_scratch = allocate_scratch(refit ? tlas_.update_scratch_size : tlas_.build_scratch_size).value_or(0);
+  }
+
+  record_blas_builds(cmd_buff);
+  record_compactions(cmd_buff);
+  build_barrier(cmd_buff, vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR);
+  if (tlas_pending) {
+    record_tlas_build(cmd_buff, refit, tlas_scratch);
+  } else if (instances_.empty()) {
+    tlas_.built = false;
+  }
+  tlas_rebuild_pending_ = false;
+  tlas_refit_pending_   = false;
+
+  auto barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+      .srcAccessMask = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eFragmentShader,
+      .dstAccessMask = vk::AccessFlagBits2::eAccelerationStructureReadKHR,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &barrier,
+  });
+}
+
+Result<ComputePassHandle, Error> AccelerationStructureBuilder::add_build_pass(RenderGraph& render_graph,
+                                                                             std::string name) {
+  return render_graph.compute_pass_builder()
+      .with_name(std::move(name))
+      .on_emit([this](Device& /*device*/, vk::CommandBuffer& cmd_buff) { record_build(cmd_buff); })
+      .build();
+}
+
+bool AccelerationStructureBuilder::is_built(BlasHandle handle) const {
+  return blases_.contains(handle) && blases_[handle].built;
+}
+
+Result<AccelerationStructureBuilder::AccelerationStructure, Error>
+AccelerationStructureBuilder::create_acceleration_structure(vk::AccelerationStructureTypeKHR type,
+                                                            vk::DeviceSize size) {
+  auto buffer = BufferResource::create_gpu_local_buffer(
+      *p_device_, size,
+      vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress);
+  if (!buffer) {
+    return std::unexpected(buffer.error());
+  }
+
+  auto structure   = AccelerationStructure{};
+  structure.buffer = std::move(*buffer);
+
+  const auto create_info = vk::AccelerationStructureCreateInfoKHR{
+      .buffer = structure.buffer.vk_buffer(),
+      .size   = size,
+      .type   = type,
+  };
+  if (auto result = (*p_device_)->createAccelerationStructureKHR(create_info)) {
+    structure.acceleration_structure = std::move(*result);
+  } else {
+    util::Logger::err("Could not create an acceleration structure. {}", vk::to_string(result.error()));
+    return std::unexpected(Error{
+        .msg     = "Acceleration structure creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = result.error(),
+    });
+  }
+
+  structure.address = (*p_device_)->getAccelerationStructureAddressKHR(vk::AccelerationStructureDeviceAddressInfoKHR{
+      .accelerationStructure = *structure.acceleration_structure,
+  });
+  return structure;
+}
+
+void AccelerationStructureBuilder::release(AccelerationStructure& structure) {
+  p_deletion_queue_->push(structure.acceleration_structure.release());
+  p_deletion_queue_->push(std::move(structure.buffer._buffer));
+  structure.address = 0;
+}
+
+std::optional<vk::DeviceAddress> AccelerationStructureBuilder::allocate_scratch(vk::DeviceSize size) {
+  auto alloc_info      = VmaVirtualAllocationCreateInfo{};
+  alloc_info.size      = size;
+  alloc_info.alignment = scratch_alignment_;
+
+  // Cleared by the next build, so the allocation is not kept
+  auto allocation = VmaVirtualAllocation{VK_NULL_HANDLE};
+  auto offset     = VkDeviceSize{0};
+  if (vmaVirtualAllocate(scratch_block_.get(), &alloc_info, &allocation, &offset) != VK_SUCCESS) {
+    return std::nullopt;
+  }
+
+  return scratch_address_ + offset;
+}
+
+std::optional<vk::DeviceSize> AccelerationStructureBuilder::read_query(uint32_t query) {
+  auto [result, sizes] = query_pool_.getResults<vk::DeviceSize>(query, 1, sizeof(vk::DeviceSize),
+                                                                sizeof(vk::DeviceSize), vk::QueryResultFlagBits::e64);
+  if (result != vk::Result::eSuccess) {
+    return std::nullopt;
+  }
+
+  // The write has completed, so the host reset does not race with the GPU
+  query_pool_.reset(query, 1);
+  free_queries_.push_back(query);
+  return sizes.front();
+}
+
+vk::AccelerationStructureGeometryKHR AccelerationStructureBuilder::blas_geometry(const Blas& blas) const {
+  const auto& range  = p_arena_->range(blas.geometry);
+  const auto& device = *p_device_;
+
+  const auto vertices =
+      device->getBufferAddress(vk::BufferDeviceAddressInfo{.buffer = p_arena_->vertex_buffer().vk_buffer()});
+  const auto indices =
+      device->getBufferAddress(vk::BufferDeviceAddressInfo{.buffer = p_arena_->index_buffer().vk_buffer()});
+
+  auto geometry = vk::AccelerationStructureGeometryKHR{
+      .geometryType = vk::GeometryTypeKHR::eTriangles,
+      .flags        = blas.opaque ? vk::GeometryFlagBitsKHR::eOpaque : vk::GeometryFlagsKHR{},
+  };
+  geometry.geometry.triangles = vk::AccelerationStructureGeometryTrianglesDataKHR{
+      .vertexFormat = vk::Format::eR32G32B32Sfloat,
+      .vertexData   = const_address(vertices + p_arena_->vertex_offset_bytes(blas.geometry)),
+      .vertexStride = p_arena_->vertex_stride(),
+      .maxVertex    = range.vertex_count > 0 ? range.vertex_count - 1 : 0,
+      .indexType    = vk::IndexType::eUint32,
+      .indexData    = const_address(indices + p_arena_->index_offset_bytes(blas.geometry)),
+  };
+  return geometry;
+}
+
+vk::AccelerationStructureInstanceKHR AccelerationStructureBuilder::instance_record(
+    const AccelerationStructureInstance& instance, const math::Mat4f& world) const {
+  auto record = vk::AccelerationStructureInstanceKHR{};
+
+  // Row major 3x4, the matrix is column major
+  for (auto row = 0U; row < 3; ++row) {
+    for (auto col = 0U; col < 4; ++col) {
+      record.transform.matrix[row][col] = world[col][row];
+    }
+  }
+  record.instanceCustomIndex                    = instance.custom_index & 0xFFFFFFU;
+  record.mask                                   = instance.mask;
+  record.instanceShaderBindingTableRecordOffset = 0;
+  record.flags = static_cast<VkGeometryInstanceFlagsKHR>(vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable);
+
+  // A zero reference deactivates the instance until its BLAS is built, the build restages the instances
+  const auto& blas = blases_[instance.blas];
+  if (blas.built) {
+    record.accelerationStructureReference = blas.compacted ? blas.compacted->address : blas.current.address;
+  }
+  return record;
+}
+
+Result<void, Error> AccelerationStructureBuilder::stage_instances(StagingRingBuffer& staging, uint32_t first,
+                                                                 uint32_t count) {
+  if (count == 0) {
+    return {};
+  }
+
+  const auto record_size = sizeof(vk::AccelerationStructureInstanceKHR);
+  if (auto result = staging.upload(util::MemoryRegion{&instance_records_[first], count * record_size},
+                                   instance_buffer_, first * record_size);
+      !result) {
+    return std::unexpected(result.error());
+  }
+
+  has_staged_writes_ = true;
+  return {};
+}
+
+void AccelerationStructureBuilder::record_blas_builds(vk::CommandBuffer cmd_buff) {
+  if (pending_builds_.empty()) {
+    return;
+  }
+
+  auto geometries = std::vector<vk::AccelerationStructureGeometryKHR>();
+  auto infos      = std::vector<vk::AccelerationStructureBuildGeometryInfoKHR>();
+  auto ranges     = std::vector<vk::AccelerationStructureBuildRangeInfoKHR>();
+  auto batch      = std::vector<BlasHandle>();
+  geometries.reserve(pending_builds_.size());
+  for (auto handle : pending_builds_) {
+    if (free_queries_.empty()) {
+      break;
+    }
+    auto& blas   = blases_[handle];
+    auto scratch = allocate_scratch(blas.build_scratch_size);
+    if (!scratch) {
+      break;
+    }
+
+    auto scratch_data          = vk::DeviceOrHostAddressKHR{};
+    scratch_data.deviceAddress = *scratch;
+    geometries.push_back(blas_geometry(blas));
+    infos.push_back(vk::AccelerationStructureBuildGeometryInfoKHR{
+        .type                     = vk::AccelerationStructureTypeKHR::eBottomLevel,
+        .flags                    = kBlasBuildFlags,
+        .mode                     = vk::BuildAccelerationStructureModeKHR::eBuild,
+        .dstAccelerationStructure = *blas.current.acceleration_structure,
+        .geometryCount            = 1,
+        .pGeometries              = &geometries.back(),
+        .scratchData              = scratch_data,
+    });
+    ranges.push_back(vk::AccelerationStructureBuildRangeInfoKHR{
+        .primitiveCount = p_arena_->range(blas.geometry).index_count / 3,
+    });
+    batch.push_back(handle);
+
+    blas.query = free_queries_.back();
+    free_queries_.pop_back();
+  }
+  if (batch.empty()) {
+    return;
+  }
+
+  auto range_ptrs = std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*>();
+  for (const auto& range : ranges) {
+    range_ptrs.push_back(&range);
+  }
+  cmd_buff.buildAccelerationStructuresKHR(infos, range_ptrs);
+
+  // The compacted sizes are known once the builds have completed
+  build_barrier(cmd_buff, vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR);
+  for (auto handle : batch) {
+    auto& blas = blases_[handle];
+    cmd_buff.writeAccelerationStructuresPropertiesKHR(*blas.current.acceleration_structure,
+                                                      vk::QueryType::eAccelerationStructureCompactedSizeKHR,
+                                                      *query_pool_, *blas.query);
+    blas.built = true;
+    pending_compactions_.push_back(handle);
+  }
+  pending_builds_.erase(pending_builds_.begin(), pending_builds_.begin() + static_cast<ptrdiff_t>(batch.size()));
+
+  // The instances of the new BLASes are deactivated until the next sync
+  if (!instances_.empty()) {
+    instances_changed_ = true;
+  }
+}
+
+void AccelerationStructureBuilder::record_compactions(vk::CommandBuffer cmd_buff) {
+  // The instances refer to the compacted BLASes only once they have been restaged
+  if (pending_copies_.empty() || (!tlas_rebuild_pending_ && !instances_.empty())) {
+    return;
+  }
+
+  for (auto handle : pending_copies_) {
+    auto& blas = blases_[handle];
+    cmd_buff.copyAccelerationStructureKHR(vk::CopyAccelerationStructureInfoKHR{
+        .src  = *blas.current.acceleration_structure,
+        .dst  = *blas.compacted->acceleration_structure,
+        .mode = vk::CopyAccelerationStructureModeKHR::eCompact,
+    });
+    release(blas.current);
+    blas.current = std::move(*blas.compacted);
+    blas.compacted.reset();
+  }
+  pending_copies_.clear();
+}
+
+void AccelerationStructureBuilder::record_tlas_build(vk::CommandBuffer cmd_buff, bool refit,
+                                                     vk::DeviceAddress scratch) {
+  const auto geometry = instances_geometry(
+      (*p_device_)->getBufferAddress(vk::BufferDeviceAddressInfo{.buffer = instance_buffer_.vk_buffer()}));
+
+  auto scratch_data          = vk::DeviceOrHostAddressKHR{};
+  scratch_data.deviceAddress = scratch;
+
+  const auto mode       = refit ? vk::BuildAccelerationStructureModeKHR::eUpdate
+                                : vk::BuildAccelerationStructureModeKHR::eBuild;
+  const auto build_info = vk::AccelerationStructureBuildGeometryInfoKHR{
+      .type                     = vk::AccelerationStructureTypeKHR::eTopLevel,
+      .flags                    = kTlasBuildFlags,
+      .mode                     = mode,
+      .srcAccelerationStructure = refit ? *tlas_.structure.acceleration_structure : vk::AccelerationStructureKHR{},
+      .dstAccelerationStructure = *tlas_.structure.acceleration_structure,
+      .geometryCount            = 1,
+      .pGeometries              = &geometry,
+      .scratchData              = scratch_data,
+  };
+  const auto range = vk::AccelerationStructureBuildRangeInfoKHR{
+      .primitiveCount = static_cast<uint32_t>(instances_.size()),
+  };
+  const auto* range_ptr = &range;
+  cmd_buff.buildAccelerationStructuresKHR(build_info, range_ptr);
+
+  refit_count_ = refit ? refit_count_ + 1 : 0;
+  tlas_.built  = true;
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <vma/vk_mem_alloc.h>
+
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/util/slot_map.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/buffer/geometry_arena.hpp>
+#include <liberay/vkren/buffer/staging_ring_buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/deletion_queue.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/render_graph.hpp>
+#include <liberay/vkren/scene/transform_tree.hpp>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+struct BlasTag {};
+
+/**
+ * @brief Stable handle of a bottom level acceleration structure, stays valid across the compaction.
+ *
+ */
+using BlasHandle = util::SlotMapKey<BlasTag>;
+
+/**
+ * @brief Instance of a BLAS in the top level acceleration structure, placed by the world matrix of a node.
+ *
+ */
+struct AccelerationStructureInstance {
+  /**
+   * @brief Index of the node in the `TransformTree`, i.e. `FlatTree::index_of()`.
+   *
+   */
+  uint32_t node_index;
+  BlasHandle blas;
+
+  /**
+   * @brief `InstanceID()` of the ray query hits, e.g. the entity to pick. Only the low 24 bits are kept.
+   *
+   */
+  uint32_t custom_index = 0;
+
+  /**
+   * @brief Visibility mask, a ray query skips the instance when the mask and the cull mask of the ray do not intersect.
+   *
+   */
+  uint8_t mask = 0xFF;
+};
+
+/**
+ * @brief Bottom (BLAS) and top (TLAS) level acceleration structures of the meshes of a `GeometryArena`, for the ray
+ * queries in the shaders, e.g. the GPU picking, the ray traced shadows and the ambient occlusion. Requires
+ * `Device::has_ray_query()`.
+ *
+ * Every BLAS is a single mesh of the arena, with the `float3` position at the beginning of its vertices. The requested
+ * BLASes are built in batches: every `record_build()` builds as many of them as fit the scratch pool at once. Each
+ * built BLAS writes its compacted size to a query, once the query is available `sync()` allocates the compacted BLAS
+ * and the next `record_build()` copies it, the original is released through the `FrameDeletionQueue`.
+ *
+ * The TLAS is rebuilt whenever its instances change (including a BLAS moved by the compaction). Otherwise `sync()`
+ * stages only the instances whose node world matrix changed (see `TransformTree::world_matrices_changed_since()`) and
+ * the TLAS is refit in place, every `kMaxRefitsPerRebuild`-th update rebuilds it to restore its quality. The instances
+ * of the BLASes that have not been built yet are inactive until the sync that follows their build.
+ *
+ * The scratch buffers of all of the builds are suballocated from a single device local buffer with a VMA virtual
+ * block, the suballocations are released by the next `record_build()`.
+ *
+ * `record_build()` is meant to be emitted by a render graph compute pass, see `add_build_pass()`, after the
+ * `StagingRingBuffer::record_pending_copies()` that uploads the instances. The TLAS is ready for the ray queries of the
+ * compute and the fragment shaders that follow it.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class AccelerationStructureBuilder {
+ public:
+  AccelerationStructureBuilder() = delete;
+  explicit AccelerationStructureBuilder(std::nullptr_t) {}
+
+  static constexpr vk::DeviceSize kDefaultScratchSize = 32ULL * 1024ULL * 1024ULL;
+
+  /**
+   * @brief Maximum number of the BLASes whose compacted size has not been read back yet.
+   *
+   */
+  static constexpr uint32_t kMaxPendingCompactions = 256;
+
+  /**
+   * @brief Number of the consecutive TLAS refits before it is rebuilt.
+   *
+   */
+  static constexpr uint32_t kMaxRefitsPerRebuild = 64;
+
+  /**
+   * @brief Creates the scratch pool, the instance buffer and the compaction queries.
+   *
+   * @param device Must support the ray queries.
+   * @param arena Must outlive the builder. Created after the device, so that its buffers have the device addresses.
+   * @param deletion_queue Releases the replaced acceleration structures, must outlive the builder.
+   * @param max_instances Capacity of the TLAS.
+   * @param scratch_size Size of the scratch pool, the largest single build must fit it.
+   * @return Result<AccelerationStructureBuilder, Error> Fails with `ExtensionNotSupported` when the ray queries are not
+   * enabled.
+   */
+  [[nodiscard]] static Result<AccelerationStructureBuilder, Error> create(
+      Device& device, const GeometryArena& arena, FrameDeletionQueue& deletion_queue, uint32_t max_instances,
+      vk::DeviceSize scratch_size = kDefaultScratchSize);
+
+  /**
+   * @brief Allocates the BLAS of the mesh and queues its build. The mesh must be uploaded before the build is
+   * recorded.
+   *
+   * @param geometry
+   * @param opaque Skips the any hit candidates of the ray queries.
+   * @return Result<BlasHandle, Error> Fails with `MemoryAllocationFailure` when the build does not fit the scratch
+   * pool.
+   */
+  Result<BlasHandle, Error> add_blas(GeometryHandle geometry, bool opaque = true);
+
+  /**
+   * @brief Releases the BLAS once the GPU is done with it. No instance may refer to it after the next
+   * `set_instances()`.
+   *
+   */
+  void remove_blas(BlasHandle handle);
+
+  /**
+   * @brief Replaces the instances of the TLAS, the next `sync()` stages all of them and the TLAS is rebuilt.
+   *
+   * @param instances At most `max_instances()`, the BLASes must not be removed.
+   */
+  void set_instances(std::span<const AccelerationStructureInstance> instances);
+
+  /**
+   * @brief Starts the compaction of the BLASes whose compacted size is known and stages the changed instances, the
+   * copies are recorded by the next `StagingRingBuffer::record_pending_copies()`, which must be preceded by
+   * `record_write_barrier()` and followed by `record_build()`.
+   *
+   * @param tree Must be updated already.
+   * @param staging
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when the ring has not enough free space, the
+   * instances are staged again by the next sync then.
+   */
+  Result<void, Error> sync(const TransformTree& tree, StagingRingBuffer& staging);
+
+  /**
+   * @brief Records the batch of the BLAS builds, the compaction copies and the TLAS build or refit. Must be recorded
+   * outside of rendering.
+   *
+   * @param cmd_buff
+   */
+  void record_build(vk::CommandBuffer cmd_buff);
+
+  /**
+   * @brief Makes the instance copies staged by `sync()` wait for the previously recorded TLAS builds. Does nothing if
+   * nothing has been staged since the last call. Must be recorded outside of rendering.
+   *
+   * @param cmd_buff
+   */
+  void record_write_barrier(vk::CommandBuffer cmd_buff);
+
+  /**
+   * @brief Adds the compute pass that records `record_build()`.
+   *
+   * @warning The builder must not be moved while the render graph uses the pass.
+   *
+   * @param render_graph
+   * @param name
+   * @return Result<ComputePassHandle, Error>
+   */
+  Result<ComputePassHandle, Error> add_build_pass(RenderGraph& render_graph,
+                                                  std::string name = "Acceleration Structure Build");
+
+  /**
+   * @brief The TLAS, null until the first instances are built.
+   *
+   */
+  vk::AccelerationStructureKHR tlas() const {
+    return tlas_.built ? *tlas_.structure.acceleration_structure : vk::AccelerationStructureKHR{};
+  }
+
+  /**
+   * @brief True if the BLAS has been built and might be instanced.
+   *
+   */
+  bool is_built(BlasHandle handle) const;
+
+  uint32_t max_instances() const { return max_instances_; }
+  uint32_t instance_count() const { return static_cast<uint32_t>(instances_.size()); }
+  size_t pending_build_count() const { return pending_builds_.size(); }
+  size_t pending_compaction_count() const { return pending_compactions_.size(); }
+
+ private:
+  /**
+   * @brief The acceleration structure is declared after its buffer, so it is destroyed first.
+   *
+   */
+  struct AccelerationStructure {
+    BufferResource buffer{};
+    vk::raii::AccelerationStructureKHR acceleration_structure = nullptr;
+    vk::DeviceAddress address                                  = 0;
+  };
+
+  struct Blas {
+    AccelerationStructure current;
+
+    /**
+     * @brief Allocated by `sync()` once the compacted size is known, the copy is recorded by the next build.
+     *
+     */
+    std::optional<AccelerationStructure> compacted;
+    GeometryHandle geometry;
+    vk::DeviceSize build_scratch_size = 0;
+    std::optional<uint32_t> query;
+    bool opaque = true;
+    bool built  = false;
+  };
+
+  struct Tlas {
+    AccelerationStructure structure;
+    vk::DeviceSize build_scratch_size  = 0;
+    vk::DeviceSize update_scratch_size = 0;
+    bool built                         = false;
+  };
+
+  /**
+   * @brief VMA requires the virtual block to be empty before it is destroyed.
+   *
+   */
+  struct VirtualBlockDeleter {
+    void operator()(VmaVirtualBlock block) const noexcept {
+      vmaClearVirtualBlock(block);
+      vmaDestroyVirtualBlock(block);
+    }
+  };
+
+  Result<AccelerationStructure, Error> create_acceleration_structure(vk::AccelerationStructureTypeKHR type,
+                                                                     vk::DeviceSize size);
+  void release(AccelerationStructure& structure);
+
+  /**
+   * @brief Suballocates the scratch pool, fails when it is full.
+   *
+   */
+  std::optional<vk::DeviceAddress> allocate_scratch(vk::DeviceSize size);
+
+  vk::AccelerationStructureGeometryKHR blas_geometry(const Blas& blas) const;
+  vk::AccelerationStructureInstanceKHR instance_record(const AccelerationStructureInstance& instance,
+                                                       const math::Mat4f& world) const;
+
+  /**
+   * @brief Resets the query from the host and frees it if its result is available.
+   *
+   */
+  std::optional<vk::DeviceSize> read_query(uint32_t query);
+
+  Result<void, Error> stage_instances(StagingRingBuffer& staging, uint32_t first, uint32_t count);
+
+  void record_blas_builds(vk::CommandBuffer cmd_buff);
+  void record_compactions(vk::CommandBuffer cmd_buff);
+  void record_tlas_build(vk::CommandBuffer cmd_buff, bool refit, vk::DeviceAddress scratch);
+
+  observer_ptr<Device> p_device_                    = nullptr;
+  observer_ptr<const GeometryArena> p_arena_        = nullptr;
+  observer_ptr<FrameDeletionQueue> p_deletion_queue_ = nullptr;
+
+  util::SlotMap<Blas, BlasHandle> blases_;
+  std::vector<BlasHandle> pending_builds_;
+  std::vector<BlasHandle> pending_compactions_;
+  std::vector<BlasHandle> pending_copies_;
+  std::vector<uint32_t> free_queries_;
+
+  /**
+   * @brief Queries of the removed BLASes, freed once their pending results are available.
+   *
+   */
+  std::vector<uint32_t> retired_queries_;
+  vk::raii::QueryPool query_pool_ = nullptr;
+
+  BufferResource scratch_buffer_{};
+  std::unique_ptr<VmaVirtualBlock_T, VirtualBlockDeleter> scratch_block_;
+  vk::DeviceAddress scratch_address_ = 0;
+  vk::DeviceSize scratch_alignment_  = 0;
+
+  std::vector<AccelerationStructureInstance> instances_;
+  std::vector<vk::AccelerationStructureInstanceKHR> instance_records_;
+  BufferResource instance_buffer_{};
+
+  /**
+   * @brief Pairs of the node index and the index of its instance, sorted by the node index.
+   *
+   */
+  std::vector<std::pair<uint32_t, uint32_t>> node_instances_;
+  std::vector<uint32_t> changed_indices_;
+  std::vector<uint32_t> changed_instances_;
+
+  Tlas tlas_{};
+  std::optional<uint64_t> synced_update_;
+  uint32_t max_instances_    = 0;
+  uint32_t refit_count_      = 0;
+  bool instances_changed_    = false;
+  bool tlas_rebuild_pending_ = false;
+  bool tlas_refit_pending_   = false;
+  bool has_staged_writes_    = false;
+};
+
+}  // namespace eray::vkren
@@ -3,14 +3,28 @@
 #include <imgui/imgui_impl_vulkan.h>
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdlib>
 #include <exception>
+#include <format>
+#include <iterator>
+#include <mutex>
 #include <liberay/os/system.hpp>
 #include <liberay/os/window_api.hpp>
+#include <liberay/util/hash_combine.hpp>
 #include <liberay/util/logger.hpp>
 #include <liberay/util/panic.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/util/zstring_view.hpp>
 #include <liberay/vkren/app.hpp>
 #include <liberay/vkren/device.hpp>
 #include <liberay/vkren/swap_chain.hpp>
+#include <ranges>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_structs.hpp>
@@ -18,55 +32,758 @@
 
 namespace eray::vkren {
 
+namespace {
+
+/**
+ * @brief Set on the physics thread, so that `VulkanApplication::input()` returns the input of the current tick.
+ *
+ */
+thread_local bool is_physics_thread = false;
+
+/**
+ * @brief Names the calling engine thread and, on a hybrid CPU, keeps it off the efficiency cores, which would stretch
+ * the frames and the physics ticks. Failures are not fatal, the thread keeps its defaults.
+ *
+ */
+void configure_engine_thread(util::zstring_view name) {
+  if (auto result = os::System::set_current_thread_name(name); !result) {
+    util::Logger::warn("Could not name the {} thread. {}", name, result.error().msg);
+  }
+
+  if (const auto& topology = os::System::cpu_topology(); topology.is_hybrid()) {
+    const auto cores = topology.logical_core_ids(os::CoreClass::Performance);
+    if (auto result = os::System::set_current_thread_affinity(cores); !result) {
+      util::Logger::warn("Could not pin the {} thread to the performance cores. {}", name, result.error().msg);
+    }
+  }
+}
+
+/**
+ * @brief Draws a row of the CPU profiler table and, if the node is expanded, the rows of its children.
+ *
+ */
+void show_cpu_profile_node(const util::CpuProfiler& profiler, const util::CpuProfiler::Thread& thread, uint32_t index) {
+  const auto& node   = thread.nodes[index];
+  const auto stats   = profiler.stats(node);
+  const auto is_leaf = node.children.empty();
+
+  ImGui::TableNextRow();
+  ImGui::TableNextColumn();
+  auto flags = ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen;
+  if (is_leaf) {
+    flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+  }
+  ImGui::PushID(static_cast<int>(index));
+  const auto is_open =
+      ImGui::TreeNodeEx("##scope", flags, "%.*s", static_cast<int>(node.name.size()), node.name.data());
+  ImGui::PopID();
+  ImGui::TableNextColumn();
+  ImGui::Text("%u", stats.calls);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.3f", stats.last_ms);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.3f", stats.min_ms);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.3f", stats.avg_ms);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.3f", stats.max_ms);
+
+  if (is_open && !is_leaf) {
+    for (const auto child : node.children) {
+      show_cpu_profile_node(profiler, thread, child);
+    }
+    ImGui::TreePop();
+  }
+}
+
+}  // namespace
+
 void VulkanApplication::run() {
+  ERAY_PROFILE_THREAD_NAME("Main");
+  const auto worker_count =
+      create_info_.worker_count == 0 ? os::System::recommended_worker_count() : create_info_.worker_count;
+  context_.job_system = util::JobSystem::create(worker_count);
+
+  // The pipeline cache file is read while the window is created, the device creation needs the window surface
+  auto pipeline_cache_read = util::JobCounter{};
+  context_.job_system->run(
+      [this] { pipeline_cache_data_ = Device::read_pipeline_cache(create_info_.pipeline_cache_path); },
+      pipeline_cache_read);
+
   context_.window = eray::os::System::instance().create_window().or_panic("Could not create a window");
   context_.window->set_title(create_info_.app_name);
   on_window_setup(*context_.window);
-  context_.physics_input_manager = os::InputManager::create(context_.window);
-  context_.frame_input_manager   = os::InputManager::create(context_.window);
+  auto input_events              = os::InputEventRing::create(context_.window);
+  context_.physics_input_manager = os::InputManager::create(context_.window, input_events);
+  context_.frame_input_manager   = os::InputManager::create(context_.window, std::move(input_events));
   current_input_manager_         = context_.frame_input_manager.get();
+  read_benchmark_env();
+  util::CpuProfiler::set_enabled(create_info_.enable_cpu_profiling);
+  performance_hud_visible_ = create_info_.show_performance_hud;
 
+  context_.job_system->wait(pipeline_cache_read);
   init_vk();
+  pipeline_cache_data_.reset();
+  context_.device->wait_statistics().set_stall_threshold(create_info_.stall_warning_threshold);
   init_imgui();
+  // The dialogs finish on their own thread, an idle on-demand loop must wake up to invoke the handlers
+  os::System::file_dialog().set_completion_callback([this] { request_frame(); });
   on_init();
-  main_loop();
+  start_asset_loading();
+  init_input_recording();
+  start_physics_thread();
+  if (create_info_.threaded_rendering && !context_.device->is_headless()) {
+    run_event_loop();
+  } else {
+    main_loop();
+  }
+  stop_physics_thread();
   destroy();
 }
 
+os::InputManager& VulkanApplication::input() const {
+  if (physics_thread_ && is_physics_thread) {
+    return *physics_thread_->tick_input;
+  }
+  return *current_input_manager_;
+}
+
+float VulkanApplication::physics_interpolation_alpha() const {
+  auto elapsed = lag_;
+  if (physics_thread_) {
+    const auto last_tick_time =
+        Clock::time_point(Clock::duration(physics_thread_->last_tick_time.load(std::memory_order_acquire)));
+    elapsed = std::chrono::duration_cast<Duration>(Clock::now() - last_tick_time);
+  }
+
+  return std::clamp(std::chrono::duration<float>(elapsed) / std::chrono::duration<float>(tick_time_), 0.0F, 1.0F);
+}
+
+void VulkanApplication::start_physics_thread() {
+  if (!create_info_.threaded_physics) {
+    return;
+  }
+
+  physics_thread_             = std::make_unique<PhysicsThread>();
+  physics_thread_->tick_input = context_.physics_input_manager->create_snapshot();
+  physics_thread_->time.store(time_.count());
+  physics_thread_->last_tick_time.store(Clock::now().time_since_epoch().count());
+  physics_thread_->thread = std::jthread([this](const std::stop_token& stop_token) { physics_loop(stop_token); });
+}
+
+void VulkanApplication::stop_physics_thread() {
+  if (!physics_thread_) {
+    return;
+  }
+
+  physics_thread_->thread.request_stop();
+  physics_thread_->thread.join();
+  time_ = Duration(physics_thread_->time.load());
+  physics_thread_.reset();
+}
+
+void VulkanApplication::physics_loop(const std::stop_token& stop_token) {
+  is_physics_thread = true;
+  ERAY_PROFILE_THREAD_NAME("Physics");
+  configure_engine_thread("Physics");
+
+  auto& physics      = *physics_thread_;
+  auto previous_time = Clock::now();
+  auto lag           = Duration{0};
+  while (!stop_token.stop_requested()) {
+    auto current_time = Clock::now();
+    lag += std::chrono::duration_cast<Duration>(current_time - previous_time);
+    previous_time = current_time;
+
+    auto tick_time_flt = std::chrono::duration<float>(tick_time_).count();
+    while (lag >= tick_time_ && !stop_token.stop_requested()) {
+      ERAY_PROFILE_SCOPE("Physics tick");
+      {
+        // The input events are dispatched on the main thread, the tick reads a copy
+        auto lock = std::lock_guard(physics.input_mutex);
+        physics.tick_input->copy_state_from(*context_.physics_input_manager);
+        context_.physics_input_manager->process();
+      }
+
+      on_process_physics(tick_time_flt);
+      on_process_physics_generic(tick_time_);
+
+      lag -= tick_time_;
+      physics.time.fetch_add(tick_time_.count(), std::memory_order_relaxed);
+      physics.ticks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The published state corresponds to the nominal time of the last tick, not to the time it was computed at
+    physics.last_tick_time.store((current_time - lag).time_since_epoch().count(), std::memory_order_release);
+    std::this_thread::sleep_until(current_time + (tick_time_ - lag));
+  }
+}
+
+void VulkanApplication::read_benchmark_env() {
+  auto& benchmark = create_info_.benchmark;
+  if (const auto* frames = std::getenv("ERAY_BENCHMARK_FRAMES")) {  // NOLINT(concurrency-mt-unsafe)
+    const auto frames_str = std::string_view(frames);
+    auto frame_count      = uint32_t{0};
+    if (auto [ptr, ec] = std::from_chars(frames_str.data(), frames_str.data() + frames_str.size(), frame_count);
+        ec == std::errc{}) {
+      benchmark.frame_count = frame_count;
+    } else {
+      util::Logger::warn(R"(Ignoring ERAY_BENCHMARK_FRAMES="{}", expected a number of frames)", frames_str);
+    }
+  }
+  if (const auto* report_path = std::getenv("ERAY_BENCHMARK_REPORT")) {  // NOLINT(concurrency-mt-unsafe)
+    benchmark.report_path = report_path;
+  }
+  if (const auto* recording_path = std::getenv("ERAY_RECORD_INPUT")) {  // NOLINT(concurrency-mt-unsafe)
+    create_info_.input_recording_path = recording_path;
+  }
+  if (const auto* replay_path = std::getenv("ERAY_REPLAY_INPUT")) {  // NOLINT(concurrency-mt-unsafe)
+    create_info_.input_replay_path = replay_path;
+  }
+
+  if (!create_info_.input_replay_path.empty()) {
+    // The ticks and the frames must follow the recorded alignment
+    create_info_.threaded_physics    = false;
+    create_info_.threaded_rendering  = false;
+    create_info_.on_demand_rendering = false;
+  }
+
+  if (benchmark.frame_count > 0) {
+    // The frames are not limited by the display
+    create_info_.present_mode                  = PresentMode::Immediate;
+    create_info_.frame_rate_cap                = 0.0F;
+    create_info_.variable_refresh_rate         = false;
+    create_info_.low_latency                   = false;
+    create_info_.enable_render_graph_profiling = true;
+    util::Logger::info("Benchmarking {} frames after {} warmup frames", benchmark.frame_count,
+                       benchmark.warmup_frame_count);
+  }
+}
+
 std::unique_ptr<Device> VulkanApplication::create_device() {
   auto desktop_profile                  = Device::CreateInfo::DesktopProfile{};
   auto device_info                      = desktop_profile.get(*context_.window);
   device_info.app_info.pApplicationName = create_info_.app_name.c_str();
+  device_info.pipeline_cache_path       = create_info_.pipeline_cache_path;
+  device_info.pipeline_cache_data       = std::move(pipeline_cache_data_);
+  device_info.prefer_descriptor_buffer  = create_info_.prefer_descriptor_buffer;
   return Device::create(context_.vk_context, device_info).or_panic("Could not create a logical device wrapper");
 }
 
 void VulkanApplication::init_vk() {
-  context_.device = create_device();
+  frames_in_flight_ = std::clamp(create_info_.frames_in_flight, 1U, kMaxFramesInFlight);
+
+  context_.device       = create_device();
+  context_.staging_ring = StagingRingBuffer::create(*context_.device, create_info_.staging_ring_size_bytes,
+                                                    frames_in_flight_)
+                              .or_panic("Could not create the staging ring");
+  context_.uniform_ring = UniformRingBuffer::create(*context_.device, create_info_.uniform_ring_frame_size_bytes,
+                                                    frames_in_flight_)
+                              .or_panic("Could not create the uniform ring");
+  context_.bindless_heap = BindlessHeap::create(*context_.device, create_info_.bindless_heap, frames_in_flight_)
+                               .or_panic("Could not create the bindless heap");
+  context_.frame_descriptor_allocator = FrameDescriptorAllocator::create(*context_.device, frames_in_flight_);
+  context_.frame_arena = util::FrameArena::create(frames_in_flight_, create_info_.frame_arena_size_bytes);
+  if (context_.device->has_descriptor_buffer()) {
+    context_.descriptor_buffer =
+        DescriptorBuffer::create(*context_.device, create_info_.descriptor_buffer_frame_size_bytes, frames_in_flight_)
+            .or_panic("Could not create the descriptor buffer");
+  }
+  context_.uploader = TransferUploader::create(*context_.device).or_panic("Could not create the transfer uploader");
+  context_.frame_timeline = FrameTimeline::create(*context_.device).or_panic("Could not create the frame timeline");
+  context_.timeline_waits = TimelineWaitQueue::create(*context_.device);
+  context_.frame_deletion_queue =
+      FrameDeletionQueue::create(*context_.device->vk(), context_.device->vma_alloc_manager(), frames_in_flight_);
+  context_.descriptor_set_cache = DescriptorSetCache::create(context_.device->dsl_allocator(), frames_in_flight_);
+  context_.frame_deletion_queue.set_descriptor_set_cache(&context_.descriptor_set_cache);
+  context_.render_graph.enable_async_compute(*context_.device);
+  if (create_info_.enable_render_graph_profiling) {
+    if (!context_.render_graph.enable_profiling(*context_.device, frames_in_flight_,
+                                                create_info_.profile_pipeline_statistics)) {
+      util::Logger::warn("Render graph profiling is disabled");
+    }
+  }
   create_swap_chain();
+  context_.swap_chain->set_frame_deletion_queue(&context_.frame_deletion_queue);
   create_command_pool();
   create_command_buffers();
+  context_.gpu_profiler =
+      GpuProfiler::create(*context_.device, command_pool_).or_panic("Could not create the GPU profiler");
+  context_.render_graph.set_gpu_profiler(&context_.gpu_profiler);
+  if (create_info_.enable_shader_cost_profiling) {
+    if (auto profiler = ShaderCostProfiler::create(*context_.device, create_info_.shader_cost_query_capacity,
+                                                   frames_in_flight_)) {
+      context_.shader_cost_profiler = std::move(*profiler);
+      context_.render_graph.set_shader_cost_profiler(&*context_.shader_cost_profiler);
+    } else {
+      util::Logger::warn("Shader cost profiling is disabled");
+    }
+  }
   create_sync_objs();
+  if (create_info_.benchmark.frame_count > 0) {
+    benchmark_ = FrameBenchmark::create(*context_.device, create_info_.benchmark, frames_in_flight_)
+                     .or_panic("Could not create the frame benchmark");
+  }
+  update_frame_limiter();
+}
+
+void VulkanApplication::show_render_graph_profiler(bool* open) {
+  if (!ImGui::Begin("Render Graph Profiler", open)) {
+    ImGui::End();
+    return;
+  }
+
+  auto& render_graph = context_.render_graph;
+  if (!render_graph.is_profiling_enabled()) {
+    ImGui::TextUnformatted("Profiling is disabled");
+    ImGui::End();
+    return;
+  }
+
+  const auto results = render_graph.profiling_results();
+  auto total_ms      = 0.0;
+  for (const auto& result : results) {
+    total_ms += result.gpu_time_ms;
+  }
+  ImGui::Text("GPU time: %.3f ms", total_ms);
+
+  if (ImGui::BeginTable("passes", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Pass");
+    ImGui::TableSetupColumn("GPU [ms]");
+    ImGui::TableSetupColumn("Vertices");
+    ImGui::TableSetupColumn("Fragments");
+    ImGui::TableSetupColumn("Compute");
+    ImGui::TableHeadersRow();
+
+    for (const auto& result : results) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(render_graph.pass_name(result.pass_index).c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", result.gpu_time_ms);
+      if (result.statistics) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(result.statistics->vertex_shader_invocations));  // NOLINT
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(result.statistics->fragment_shader_invocations));  // NOLINT
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(result.statistics->compute_shader_invocations));  // NOLINT
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+void VulkanApplication::show_shader_cost_report(bool* open) {
+  if (!ImGui::Begin("Shader Cost Report", open)) {
+    ImGui::End();
+    return;
+  }
+
+  if (!context_.shader_cost_profiler) {
+    ImGui::TextUnformatted("Shader cost profiling is disabled");
+    ImGui::End();
+    return;
+  }
+
+  auto& profiler = *context_.shader_cost_profiler;
+  ImGui::Text("Frames: %u", profiler.frame_count());
+  ImGui::SameLine();
+  if (ImGui::Button("Reset")) {
+    profiler.reset();
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Save JSON")) {
+    if (auto result = profiler.write_json("shader_cost.json"); !result) {
+      util::Logger::err("Could not write the shader cost report: {}", result.error().msg);
+    }
+  }
+
+  constexpr auto kColumns = std::array{
+      &ShaderCostCounters::vertex_invocations,   &ShaderCostCounters::clipping_primitives,
+      &ShaderCostCounters::fragment_invocations, &ShaderCostCounters::compute_invocations,
+  };
+  constexpr auto kFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Sortable |
+                          ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit;
+  if (ImGui::BeginTable("entries", 7, kFlags)) {
+    ImGui::TableSetupColumn("Pass", ImGuiTableColumnFlags_NoSort);
+    ImGui::TableSetupColumn("Material", ImGuiTableColumnFlags_NoSort);
+    ImGui::TableSetupColumn("Vertices");
+    ImGui::TableSetupColumn("Primitives");
+    ImGui::TableSetupColumn("Fragments",
+                            ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableSetupColumn("Compute");
+    ImGui::TableSetupColumn("Frag/prim");
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableHeadersRow();
+
+    // The report is sorted by the total cost, a column of the counters resorts it
+    auto entries = profiler.report();
+    if (const auto* specs = ImGui::TableGetSortSpecs(); specs != nullptr && specs->SpecsCount > 0) {
+      const auto& spec      = specs->Specs[0];
+      const auto descending = spec.SortDirection == ImGuiSortDirection_Descending;
+      const auto key        = [&spec, &kColumns](const ShaderCostEntry& entry) {
+        if (spec.ColumnIndex == 6) {
+          return entry.fragments_per_primitive();
+        }
+        return static_cast<double>(entry.total.*kColumns[spec.ColumnIndex - 2]);
+      };
+      std::ranges::stable_sort(entries, [&](const ShaderCostEntry& lhs, const ShaderCostEntry& rhs) {
+        return descending ? key(lhs) > key(rhs) : key(lhs) < key(rhs);
+      });
+    }
+
+    for (const auto& entry : entries) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(entry.pass.c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(entry.material.empty() ? "-" : entry.material.c_str());
+      for (const auto counter : kColumns) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.0f", entry.per_frame(counter));
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", entry.fragments_per_primitive());
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+void VulkanApplication::show_memory_statistics(bool* open) {
+  if (!ImGui::Begin("Memory Statistics", open)) {
+    ImGui::End();
+    return;
+  }
+
+  static constexpr auto kMiB = 1024.0 * 1024.0;
+  const auto& alloc_manager  = context_.device->vma_alloc_manager();
+  if (!context_.device->has_memory_budget()) {
+    ImGui::TextUnformatted("VK_EXT_memory_budget is not supported, the budgets are estimated");
+  }
+  if (alloc_manager.is_near_budget()) {
+    ImGui::TextColored(ImVec4(1.0F, 0.4F, 0.4F, 1.0F), "Device-local memory is close to the budget");
+  }
+
+  if (ImGui::BeginTable("heaps", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Heap");
+    ImGui::TableSetupColumn("Usage [MiB]");
+    ImGui::TableSetupColumn("Budget [MiB]");
+    ImGui::TableSetupColumn("Blocks [MiB]");
+    ImGui::TableSetupColumn("Allocations [MiB]");
+    ImGui::TableHeadersRow();
+
+    const auto heaps = alloc_manager.heap_budgets();
+    for (const auto& [index, heap] : std::views::enumerate(heaps)) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%d%s", static_cast<int>(index), heap.device_local ? " (device local)" : "");
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", static_cast<double>(heap.usage) / kMiB);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", static_cast<double>(heap.budget) / kMiB);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", static_cast<double>(heap.block_bytes) / kMiB);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", static_cast<double>(heap.allocation_bytes) / kMiB);
+    }
+    ImGui::EndTable();
+  }
+
+  if (ImGui::BeginTable("categories", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Category");
+    ImGui::TableSetupColumn("Size [MiB]");
+    ImGui::TableSetupColumn("Allocations");
+    ImGui::TableHeadersRow();
+
+    for (const auto [category, name] : kMemoryCategoryName) {
+      const auto& stats = alloc_manager.category_statistics(category);
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", static_cast<double>(stats.allocation_bytes) / kMiB);
+      ImGui::TableNextColumn();
+      ImGui::Text("%u", stats.allocation_count);
+    }
+    ImGui::EndTable();
+  }
+
+  if (ImGui::Button("Dump live allocations")) {
+    alloc_manager.dump_live_allocations();
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Set checkpoint")) {
+    allocation_checkpoint_ = alloc_manager.checkpoint();
+  }
+  if (allocation_checkpoint_) {
+    ImGui::SameLine();
+    if (ImGui::Button("Dump since checkpoint")) {
+      alloc_manager.dump_allocations_since(*allocation_checkpoint_);
+    }
+  }
+
+  ImGui::End();
+}
+
+void VulkanApplication::show_cpu_profiler(bool* open) {
+  if (!ImGui::Begin("CPU Profiler", open)) {
+    ImGui::End();
+    return;
+  }
+
+  const auto& profiler = util::CpuProfiler::instance();
+  if constexpr (util::AllocationTracker::kEnabled) {
+    const auto allocations = profiler.frame_allocations();
+    ImGui::Text("Heap allocations per frame: %llu (%.1f KiB)", static_cast<unsigned long long>(allocations.count),
+                static_cast<double>(allocations.bytes) / 1024.0);  // NOLINT
+  }
+
+  if (!util::CpuProfiler::is_enabled()) {
+    ImGui::TextUnformatted("Profiling is disabled");
+    ImGui::End();
+    return;
+  }
+
+  ImGui::Text("Min, avg and max over the last %zu frames", util::CpuProfiler::kHistoryFrames);
+  if (const auto dropped = profiler.dropped_events(); dropped > 0) {
+    ImGui::TextColored(ImVec4(1.0F, 0.4F, 0.4F, 1.0F), "Dropped events: %llu",
+                       static_cast<unsigned long long>(dropped));  // NOLINT
+  }
+
+  static constexpr auto kTableFlags =
+      ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+  if (ImGui::BeginTable("scopes", 6, kTableFlags)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_NoHide);
+    ImGui::TableSetupColumn("Calls");
+    ImGui::TableSetupColumn("Last [ms]");
+    ImGui::TableSetupColumn("Min [ms]");
+    ImGui::TableSetupColumn("Avg [ms]");
+    ImGui::TableSetupColumn("Max [ms]");
+    ImGui::TableHeadersRow();
+
+    for (const auto& [index, thread] : std::views::enumerate(profiler.threads())) {
+      ImGui::PushID(static_cast<int>(index));
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      if (ImGui::TreeNodeEx("##thread", ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen, "%s",
+                            thread.name.c_str())) {
+        for (const auto child : thread.nodes.front().children) {
+          show_cpu_profile_node(profiler, thread, child);
+        }
+        ImGui::TreePop();
+      }
+      ImGui::PopID();
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+void VulkanApplication::show_performance_hud(bool* open) {
+  static constexpr auto kMiB        = 1024.0 * 1024.0;
+  static constexpr auto kHudPadding = 10.0F;
+  static constexpr auto kHudFlags =
+      ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+      ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+
+  const auto* viewport = ImGui::GetMainViewport();
+  ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + kHudPadding, viewport->WorkPos.y + kHudPadding),
+                          ImGuiCond_Always);
+  ImGui::SetNextWindowViewport(viewport->ID);
+  ImGui::SetNextWindowBgAlpha(0.6F);
+  if (!ImGui::Begin("Performance HUD", open, kHudFlags)) {
+    ImGui::End();
+    return;
+  }
+
+  // == CPU frame times ================================================================================================
+  auto max_ms = 0.0F;
+  auto sum_ms = 0.0F;
+  for (const auto frame_ms : frame_times_ms_) {
+    max_ms = std::max(max_ms, frame_ms);
+    sum_ms += frame_ms;
+  }
+  const auto sample_count = std::min(frame_time_index_, kFrameTimeHistory);
+  const auto avg_ms       = sample_count == 0 ? 0.0F : sum_ms / static_cast<float>(sample_count);
+  ImGui::Text("%u FPS, %u TPS", static_cast<unsigned>(fps_), static_cast<unsigned>(tps_));
+  const auto overlay = std::format("avg {:.2f} ms, max {:.2f} ms", avg_ms, max_ms);
+  ImGui::PlotLines("##frame_times", frame_times_ms_.data(), static_cast<int>(frame_times_ms_.size()),
+                   static_cast<int>(frame_time_index_ % kFrameTimeHistory), overlay.c_str(), 0.0F, max_ms * 1.25F,
+                   ImVec2(0.0F, 60.0F));
+
+  // == GPU passes =====================================================================================================
+  auto& render_graph = context_.render_graph;
+  if (render_graph.is_profiling_enabled()) {
+    const auto results = render_graph.profiling_results();
+    auto total_ms      = 0.0;
+    for (const auto& result : results) {
+      total_ms += result.gpu_time_ms;
+    }
+    ImGui::SeparatorText("GPU");
+    ImGui::Text("Total: %.3f ms", total_ms);
+    for (const auto& result : results) {
+      ImGui::Text("%-24s %.3f ms", render_graph.pass_name(result.pass_index).c_str(), result.gpu_time_ms);
+    }
+  }
+
+  // == Frame statistics ===============================================================================================
+  const auto& counters = context_.device->statistics().last_frame();
+  ImGui::SeparatorText("Frame");
+  ImGui::Text("Draws: %llu, dispatches: %llu", static_cast<unsigned long long>(counters.draw_count),  // NOLINT
+              static_cast<unsigned long long>(counters.dispatch_count));                            // NOLINT
+  ImGui::Text("Barriers: %llu", static_cast<unsigned long long>(counters.barrier_count));  // NOLINT
+  ImGui::Text("Descriptor allocations: %llu",
+              static_cast<unsigned long long>(counters.descriptor_allocation_count));  // NOLINT
+  ImGui::Text("Staging uploads: %.1f KiB", static_cast<double>(counters.staging_bytes) / 1024.0);
+
+  // == CPU waits ======================================================================================================
+  const auto& waits = context_.device->wait_statistics();
+  ImGui::SeparatorText("CPU waits");
+  ImGui::Text("Pacing: %.2f ms", waits.last_frame_ms(WaitKind::Pacing));
+  ImGui::Text("Stalls: %.2f ms", waits.last_frame_ms(WaitKind::Stall));
+  for (const auto& site : waits.sites()) {
+    if (site.kind == WaitKind::Stall && site.last_frame_count > 0) {
+      ImGui::TextColored(ImVec4(1.0F, 0.4F, 0.4F, 1.0F), "%-24s %.3f ms (%u)", std::string(site.label).c_str(),
+                         site.last_frame_ms, site.last_frame_count);
+    }
+  }
+
+  // == Memory and pipelines ===========================================================================================
+  auto usage  = vk::DeviceSize{0};
+  auto budget = vk::DeviceSize{0};
+  for (const auto& heap : context_.device->vma_alloc_manager().heap_budgets()) {
+    if (heap.device_local) {
+      usage += heap.usage;
+      budget += heap.budget;
+    }
+  }
+  ImGui::SeparatorText("Memory");
+  const auto vram_label = std::format("{:.0f} / {:.0f} MiB", static_cast<double>(usage) / kMiB,
+                                      static_cast<double>(budget) / kMiB);
+  ImGui::ProgressBar(budget == 0 ? 0.0F : static_cast<float>(usage) / static_cast<float>(budget), ImVec2(-1.0F, 0.0F),
+                     vram_label.c_str());
+  ImGui::Text("Pipeline cache hits: %.0f%% of %llu", counters.pipeline_cache_hit_rate() * 100.0F,
+              static_cast<unsigned long long>(counters.pipeline_count));  // NOLINT
+
+  ImGui::End();
+}
+
+void VulkanApplication::capture_trace(uint32_t frame_count, std::filesystem::path path) {
+  if (trace_capture_ || frame_count == 0) {
+    return;
+  }
+
+  if (!context_.render_graph.is_profiling_enabled()) {
+    trace_capture_enabled_profiling_ = static_cast<bool>(
+        context_.render_graph.enable_profiling(*context_.device, frames_in_flight_, false));
+    if (!trace_capture_enabled_profiling_) {
+      util::Logger::warn("Render graph profiling is disabled, the trace contains the CPU timeline only");
+    }
+  }
+  trace_capture_ = TraceCapture::start(*context_.device, frame_count, std::move(path));
+}
+
+void VulkanApplication::finish_trace_capture() {
+  if (auto result = trace_capture_->finish(); !result) {
+    util::Logger::err("Could not write the trace: {}", result.error().msg);
+  }
+  trace_capture_.reset();
+
+  if (trace_capture_enabled_profiling_) {
+    context_.render_graph.disable_profiling();
+    trace_capture_enabled_profiling_ = false;
+  }
+}
+
+Result<void, Error> VulkanApplication::start_frame_capture(FrameCapture::CreateInfo info,
+                                                           FrameCapture::Encoder encoder) {
+  stop_frame_capture();
+
+  const auto& swap_chain = *context_.swap_chain;
+  if (!(swap_chain.image_usage() & vk::ImageUsageFlagBits::eTransferSrc) ||
+      !FrameCapture::supports(swap_chain.image_format(), info.pixel_format)) {
+    util::Logger::err("Could not start the frame capture. The swap chain images of the {} format cannot be captured",
+                      vk::to_string(swap_chain.image_format()));
+    return std::unexpected(Error{
+        .msg  = "Swap chain images cannot be captured",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
+  info.buffer_count = std::max(info.buffer_count, frames_in_flight_ + 1);
+  auto capture      = FrameCapture::create(*context_.device, context_.frame_deletion_queue, info, std::move(encoder));
+  if (!capture) {
+    return std::unexpected(capture.error());
+  }
+  frame_capture_ = std::move(*capture);
+
+  return {};
+}
+
+void VulkanApplication::stop_frame_capture() {
+  if (!frame_capture_) {
+    return;
+  }
+
+  if (auto result = frame_capture_->finish(context_.frame_timeline); !result) {
+    util::Logger::err("Could not finish the frame capture: {}", result.error().msg);
+  }
+  util::Logger::info("Captured {} frames, {} frames dropped", frame_capture_->captured_frame_count(),
+                     frame_capture_->dropped_frame_count());
+  frame_capture_.reset();
 }
 
 void VulkanApplication::main_loop() {
   auto& imgui_io     = ImGui::GetIO();
   auto previous_time = Clock::now();
   while (!context_.window->should_close()) {
+    if (create_info_.on_demand_rendering && !benchmark_ && wait_for_frame_request()) {
+      previous_time = Clock::now();
+    }
+    pace_frame();
+    ERAY_PROFILE_SCOPE("Frame");
+
     auto current_time = Clock::now();
-    auto delta        = current_time - previous_time;
+    auto frame_time   = current_time - previous_time;
     previous_time     = current_time;
-    lag_ += std::chrono::duration_cast<Duration>(delta);
-    second_ += std::chrono::duration_cast<Duration>(delta);
+    second_ += std::chrono::duration_cast<Duration>(frame_time);
 
     // == Process Window events ========================================================================================
-    context_.window->poll_events();
-    context_.window->process_queued_events();
+    {
+      ERAY_PROFILE_SCOPE("Window events");
+      sample_input();
+    }
+
+    // The replayed frames advance the application by the recorded time steps, not by the time they really took
+    const auto* replayed_frame = replay_input_frame();
+    if (input_replay_ && !replayed_frame) {
+      util::Logger::info("Input replay finished after {} frames", input_replay_->frame_count());
+      break;
+    }
+    const auto delta = replayed_frame ? Clock::duration(Duration(replayed_frame->delta_ns)) : frame_time;
+    if (!physics_thread_) {
+      lag_ += std::chrono::duration_cast<Duration>(delta);
+    }
 
     // == Fixed time step update =======================================================================================
     auto tick_time_flt = std::chrono::duration<float>(tick_time_).count();
 
+    auto frame_ticks = uint32_t{0};
+    if (physics_thread_) {
+      frame_ticks = physics_thread_->ticks.exchange(0, std::memory_order_relaxed);
+      ticks_      = static_cast<uint16_t>(ticks_ + frame_ticks);
+    }
+
     current_input_manager_ = context_.physics_input_manager.get();
-    while (lag_ >= tick_time_) {
+    while (!physics_thread_ && (replayed_frame ? frame_ticks < replayed_frame->tick_count : lag_ >= tick_time_)) {
+      ERAY_PROFILE_SCOPE("Physics tick");
       context_.physics_input_manager->prepare(imgui_io.WantCaptureMouse || imgui_io.WantCaptureKeyboard);
       on_process_physics(tick_time_flt);
       on_process_physics_generic(tick_time_);
@@ -75,6 +792,10 @@ void VulkanApplication::main_loop() {
       lag_ -= tick_time_;
       time_ += tick_time_;
       ++ticks_;
+      ++frame_ticks;
+    }
+    if (replayed_frame) {
+      lag_ = Duration(replayed_frame->lag_ns);
     }
     current_input_manager_ = context_.frame_input_manager.get();
 
@@ -87,24 +808,36 @@ void VulkanApplication::main_loop() {
     auto delta_flt = std::chrono::duration<float>(delta).count();
 
     context_.frame_input_manager->prepare(imgui_io.WantCaptureMouse || imgui_io.WantCaptureKeyboard);
+    if (input_recorder_) {
+      record_input_frame(delta, frame_ticks);
+    }
 
-    ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-
-    ImGui::NewFrame();
-    on_imgui(delta_flt);
-    on_imgui();
-    ImGui::Render();
+    poll_asset_loading();
+    const auto imgui_frame_built = build_imgui_frame(delta);
 
-    on_process(delta_flt);
-    on_process_generic(current_frame_, delta);
+    {
+      ERAY_PROFILE_SCOPE("Process");
+      on_process(delta_flt);
+      on_process_generic(current_frame_, delta);
+    }
 
     render_frame(delta);
     frames_++;
+    frame_times_ms_[frame_time_index_++ % kFrameTimeHistory] =
+        std::chrono::duration<float, std::milli>(frame_time).count();
+    context_.device->statistics().end_frame();
+    context_.device->wait_statistics().end_frame();
+    if (benchmark_) {
+      benchmark_->end_frame(std::chrono::duration_cast<Duration>(frame_time), context_.render_graph);
+    }
+    if (trace_capture_) {
+      trace_capture_->end_frame(context_.render_graph);
+    }
 
     context_.frame_input_manager->process();
 
-    if (imgui_io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+    if ((imgui_io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) && !context_.device->is_headless() &&
+        !render_thread_ && imgui_frame_built) {
       ImGui::UpdatePlatformWindows();
       ImGui::RenderPlatformWindowsDefault();
     }
@@ -119,61 +852,606 @@ void VulkanApplication::main_loop() {
       ticks_  = 0;
       second_ = 0ns;
     }
+
+    ERAY_PROFILE_FRAME();
+
+    if (trace_capture_ && trace_capture_->is_finished()) {
+      finish_trace_capture();
+    }
+    if (benchmark_ && benchmark_->is_finished()) {
+      break;
+    }
   }
 
   // Since draw frame operations are async, when the main loop ends the drawing operations may still be going on.
   // This call is allows for the async operations to finish before cleaning the resources.
-  context_.device->vk().waitIdle();
+  {
+    const auto wait = WaitScope(context_.device->wait_statistics(), "Main loop end", WaitKind::Pacing);
+    context_.device->vk().waitIdle();
+  }
+
+  if (trace_capture_) {
+    finish_trace_capture();
+  }
+  stop_frame_capture();
+  if (benchmark_) {
+    if (auto result = benchmark_->write_report(); !result) {
+      util::Logger::err("Could not write the benchmark report: {}", result.error().msg);
+    }
+  }
+  if (input_recorder_) {
+    if (auto result = input_recorder_->flush(); result) {
+      util::Logger::succ(R"(Input recording of {} frames written to "{}")", input_recorder_->frame_count(),
+                         create_info_.input_recording_path.string());
+    }
+  }
+}
+
+void VulkanApplication::init_input_recording() {
+  if (!create_info_.input_replay_path.empty()) {
+    input_replay_ =
+        os::InputReplay::load(create_info_.input_replay_path).or_panic("Could not load the input recording");
+    if (input_replay_->tick_time() != tick_time_) {
+      util::Logger::warn("The input recording was made with a different tick time, the recorded one is used");
+      tick_time_ = input_replay_->tick_time();
+    }
+  }
+
+  if (!create_info_.input_recording_path.empty()) {
+    input_recorder_ = os::InputRecorder::create(create_info_.input_recording_path, tick_time_)
+                          .or_panic("Could not create the input recording");
+  }
+}
+
+const os::InputRecordingFrame* VulkanApplication::replay_input_frame() {
+  if (!input_replay_ || input_replay_->is_finished()) {
+    return nullptr;
+  }
+
+  const auto& frame = input_replay_->replay_frame(context_.frame_input_manager->event_ring());
+  if (const auto framebuffer_size = context_.window->framebuffer_size();
+      framebuffer_size.width != frame.framebuffer_width || framebuffer_size.height != frame.framebuffer_height) {
+    context_.window->set_window_size(static_cast<int>(frame.framebuffer_width),
+                                     static_cast<int>(frame.framebuffer_height));
+  }
+  return &frame;
+}
+
+void VulkanApplication::record_input_frame(Clock::duration delta, uint32_t tick_count) {
+  auto lag = lag_;
+  if (physics_thread_) {
+    // The ticks do not follow the frames, the time since the last tick is the closest alignment
+    const auto last_tick_time =
+        Clock::time_point(Clock::duration(physics_thread_->last_tick_time.load(std::memory_order_acquire)));
+    lag = std::clamp(std::chrono::duration_cast<Duration>(Clock::now() - last_tick_time), Duration{0}, tick_time_);
+  }
+
+  const auto framebuffer_size = context_.window->framebuffer_size();
+  input_recorder_->record_frame(
+      os::InputRecordingFrame{
+          .delta_ns           = static_cast<uint64_t>(std::chrono::duration_cast<Duration>(delta).count()),
+          .lag_ns             = static_cast<uint64_t>(lag.count()),
+          .tick_count         = tick_count,
+          .framebuffer_width  = framebuffer_size.width,
+          .framebuffer_height = framebuffer_size.height,
+      },
+      context_.frame_input_manager->events());
+}
+
+static size_t hash_imgui_draw_data(const ImDrawData& draw_data) {
+  auto seed  = size_t{0};
+  auto bytes = [&seed](const auto& vector) {
+    util::hash_combine(seed, std::string_view(reinterpret_cast<const char*>(vector.Data),
+                                              static_cast<size_t>(vector.size_in_bytes())));
+  };
+  util::hash_combine(seed, draw_data.DisplaySize.x);
+  util::hash_combine(seed, draw_data.DisplaySize.y);
+  for (const auto* list : draw_data.CmdLists) {
+    bytes(list->VtxBuffer);
+    bytes(list->IdxBuffer);
+    for (const auto& cmd : list->CmdBuffer) {
+      util::hash_combine(seed, cmd.ClipRect.x);
+      util::hash_combine(seed, cmd.ClipRect.y);
+      util::hash_combine(seed, cmd.ClipRect.z);
+      util::hash_combine(seed, cmd.ClipRect.w);
+      util::hash_combine(seed, cmd.GetTexID());
+      util::hash_combine(seed, cmd.VtxOffset);
+      util::hash_combine(seed, cmd.IdxOffset);
+      util::hash_combine(seed, cmd.ElemCount);
+      util::hash_combine(seed, cmd.UserCallback != nullptr);
+    }
+  }
+  return seed;
+}
+
+bool VulkanApplication::can_reuse_imgui_frame(Clock::duration delta) {
+  if (create_info_.ui_refresh_rate_hz == 0 || !imgui_frame_static_ || ImGui::GetDrawData() == nullptr) {
+    return false;
+  }
+
+  // The input and the resizes change the UI right away, the rest (e.g. the statistics text) waits for the period
+  const auto extent = context_.swap_chain->extent();
+  if (!context_.frame_input_manager->events().empty() || extent.width != imgui_extent_.width ||
+      extent.height != imgui_extent_.height) {
+    return false;
+  }
+  const auto period = std::chrono::duration_cast<Clock::duration>(1s) / create_info_.ui_refresh_rate_hz;
+  return imgui_skipped_time_ + delta < period;
+}
+
+bool VulkanApplication::build_imgui_frame(Clock::duration delta) {
+  ERAY_PROFILE_SCOPE("ImGui");
+  auto& imgui_io = ImGui::GetIO();
+
+  auto platform_lock = std::unique_lock<std::mutex>();
+  if (render_thread_) {
+    // The main thread holds the lock while the OS blocks it, e.g. in the modal loop of a moved window. The previous
+    // frame is drawn again instead of waiting, there is none at the start
+    if (render_thread_->has_imgui_frame) {
+      platform_lock = std::unique_lock(render_thread_->platform_mutex, std::try_to_lock);
+    } else {
+      platform_lock = std::unique_lock(render_thread_->platform_mutex);
+    }
+    if (!platform_lock.owns_lock() || !render_thread_->imgui_platform_frame) {
+      return false;
+    }
+  }
+
+  // The platform frame of the threaded rendering stays started until the frame is rebuilt
+  if (can_reuse_imgui_frame(delta)) {
+    imgui_skipped_time_ += delta;
+    return false;
+  }
+  delta         = std::exchange(imgui_skipped_time_, Clock::duration{}) + delta;
+  imgui_extent_ = context_.swap_chain->extent();
+
+  if (render_thread_) {
+    render_thread_->imgui_platform_frame = false;
+    render_thread_->has_imgui_frame      = true;
+  }
+
+  ImGui_ImplVulkan_NewFrame();
+  if (context_.device->is_headless()) {
+    // There is no platform backend, the display is the offscreen framebuffer
+    const auto framebuffer_size = context_.window->framebuffer_size();
+    imgui_io.DisplaySize =
+        ImVec2(static_cast<float>(framebuffer_size.width), static_cast<float>(framebuffer_size.height));
+    imgui_io.DeltaTime = std::max(std::chrono::duration<float>(delta).count(), 1e-6F);
+  } else if (!render_thread_) {
+    // With the threaded rendering the platform frame is started on the main thread, see `pump_events()`
+    ImGui_ImplGlfw_NewFrame();
+  }
+
+  ImGui::NewFrame();
+  on_imgui(std::chrono::duration<float>(delta).count());
+  on_imgui();
+  if (create_info_.performance_hud_key != ImGuiKey_None &&
+      ImGui::IsKeyPressed(create_info_.performance_hud_key, false)) {
+    performance_hud_visible_ = !performance_hud_visible_;
+  }
+  if (performance_hud_visible_) {
+    show_performance_hud(&performance_hud_visible_);
+  }
+  if (asset_loading_ && create_info_.show_loading_overlay) {
+    show_loading_overlay();
+  }
+  if (create_info_.trace_capture_key != ImGuiKey_None && ImGui::IsKeyPressed(create_info_.trace_capture_key, false)) {
+    capture_trace(create_info_.trace_capture_frame_count, create_info_.trace_capture_path);
+  }
+  ImGui::Render();
+
+  if (create_info_.ui_refresh_rate_hz != 0) {
+    ERAY_PROFILE_SCOPE("ImGui draw data hash");
+    const auto hash       = hash_imgui_draw_data(*ImGui::GetDrawData());
+    imgui_frame_static_   = hash == imgui_draw_data_hash_;
+    imgui_draw_data_hash_ = hash;
+  }
+  return true;
+}
+
+void VulkanApplication::start_asset_loading() {
+  asset_loading_ = std::make_unique<AssetLoading>();
+  context_.job_system->run(
+      [this] {
+        ERAY_PROFILE_SCOPE("Asset loading");
+        on_load_assets();
+        // Wakes the idle on-demand loop, which hands the assets over
+        request_frame();
+      },
+      asset_loading_->counter);
+}
+
+void VulkanApplication::poll_asset_loading() {
+  if (!asset_loading_ || !asset_loading_->counter.is_done()) {
+    return;
+  }
+
+  asset_loading_.reset();
+  on_assets_loaded();
+  mark_frame_data_dirty();
+}
+
+void VulkanApplication::set_loading_progress(float progress) {
+  if (asset_loading_) {
+    asset_loading_->progress.store(std::min(progress, 1.0F), std::memory_order_relaxed);
+    request_frame();
+  }
+}
+
+void VulkanApplication::show_loading_overlay() const {
+  static constexpr auto kLoadingBarWidth = 240.0F;
+  static constexpr auto kLoadingFlags =
+      ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+      ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoInputs;
+
+  const auto* viewport = ImGui::GetMainViewport();
+  ImGui::SetNextWindowPos(viewport->GetCenter(), ImGuiCond_Always, ImVec2(0.5F, 0.5F));
+  ImGui::SetNextWindowViewport(viewport->ID);
+  if (ImGui::Begin("##Loading", nullptr, kLoadingFlags)) {
+    ImGui::TextUnformatted("Loading...");
+    // The indeterminate bar animates with a negative fraction
+    auto progress = asset_loading_->progress.load(std::memory_order_relaxed);
+    if (progress < 0.0F) {
+      progress = -static_cast<float>(ImGui::GetTime());
+    }
+    ImGui::ProgressBar(progress, ImVec2(kLoadingBarWidth, 0.0F));
+  }
+  ImGui::End();
+}
+
+void VulkanApplication::run_event_loop() {
+  render_thread_ = std::make_unique<RenderThread>();
+  if (auto& imgui_io = ImGui::GetIO(); imgui_io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+    util::Logger::warn("ImGui multi-viewports are disabled, the render thread cannot create the platform windows");
+    imgui_io.ConfigFlags &= ~ImGuiConfigFlags_ViewportsEnable;
+  }
+
+  // Starts the first ImGui platform frame, so that the render thread has an ImGui frame to draw from the start
+  pump_events();
+  render_thread_->thread = std::jthread([this] {
+    ERAY_PROFILE_THREAD_NAME("Render");
+    configure_engine_thread("Render");
+    main_loop();
+    render_thread_->finished.store(true, std::memory_order_release);
+  });
+
+  const auto rate =
+      create_info_.input_sampling_rate_hz == 0 ? kDefaultEventPumpRateHz : create_info_.input_sampling_rate_hz;
+  const auto period = std::chrono::duration_cast<Clock::duration>(1s) / rate;
+  auto next_pump    = Clock::now();
+  while (!render_thread_->finished.load(std::memory_order_acquire)) {
+    pump_events();
+    next_pump = std::max(next_pump + period, Clock::now());
+    std::this_thread::sleep_until(next_pump);
+  }
+
+  render_thread_->thread.join();
+  render_thread_.reset();
+}
+
+void VulkanApplication::sample_input() {
+  if (!render_thread_) {
+    pump_events();
+  }
+}
+
+void VulkanApplication::pump_events() {
+  // Held while the OS blocks the main thread in the poll, the ImGui callbacks run inside of it
+  auto platform_lock = std::unique_lock<std::mutex>();
+  if (render_thread_) {
+    platform_lock = std::unique_lock(render_thread_->platform_mutex);
+  }
+
+  if (render_thread_) {
+    for (auto& window : render_thread_->closed_windows) {
+      window->destroy();
+    }
+    render_thread_->closed_windows.clear();
+  }
+
+  auto received_events = context_.window->received_events();
+  for (const auto& target : context_.window_targets) {
+    received_events += target->window().received_events();
+  }
+  context_.window->poll_events();
+  context_.window->process_queued_events();
+  auto processed_events = context_.window->received_events();
+  for (const auto& target : context_.window_targets) {
+    target->window().process_queued_events();
+    processed_events += target->window().received_events();
+  }
+  if (create_info_.on_demand_rendering && processed_events != received_events) {
+    request_frame();
+  }
+
+  const auto& imgui_io = ImGui::GetIO();
+  if (physics_thread_) {
+    // The physics tick copies the prepared state, the event ring itself may be read by any thread
+    const auto input_lock = std::lock_guard(physics_thread_->input_mutex);
+    context_.physics_input_manager->prepare(imgui_io.WantCaptureMouse || imgui_io.WantCaptureKeyboard);
+  }
+
+  if (render_thread_ && !render_thread_->imgui_platform_frame) {
+    // Queries the window, which GLFW allows on the main thread only
+    ImGui_ImplGlfw_NewFrame();
+    render_thread_->imgui_platform_frame = true;
+  }
+}
+
+observer_ptr<WindowTarget> VulkanApplication::add_window(const os::WindowProperties& props,
+                                                        PresentMode present_mode) {
+  if (context_.device->is_headless()) {
+    util::Logger::warn(R"(The headless device cannot present, the window "{}" is not created)", props.title);
+    return nullptr;
+  }
+
+  auto window = os::System::instance().create_window(props).or_panic("Could not create a window");
+  auto target = WindowTarget::create(*context_.device, std::move(window),
+                                     get_msaa_sample_count(context_.device->physical_device()), present_mode,
+                                     frames_in_flight_)
+                    .or_panic("Could not create a window target");
+  target->swap_chain().set_frame_deletion_queue(&context_.frame_deletion_queue);
+  return context_.window_targets.emplace_back(std::move(target)).get();
+}
+
+void VulkanApplication::request_frame() {
+  {
+    const auto lock            = std::lock_guard(frame_requests_->mutex);
+    frame_requests_->requested = true;
+  }
+  frame_requests_->requested_cv.notify_one();
+  if (create_info_.on_demand_rendering && context_.window) {
+    context_.window->wake();
+  }
+}
+
+bool VulkanApplication::take_frame_request() {
+  const auto lock = std::lock_guard(frame_requests_->mutex);
+  return std::exchange(frame_requests_->requested, false);
+}
+
+bool VulkanApplication::wait_for_frame_request() {
+  if (take_frame_request()) {
+    trailing_frames_ = kOnDemandTrailingFrames;
+    return false;
+  }
+  // The coroutines awaiting the GPU are resumed by the frames, see `render_frame()`
+  if (trailing_frames_ > 0 || context_.timeline_waits->pending() > 0) {
+    trailing_frames_ = trailing_frames_ > 0 ? trailing_frames_ - 1 : 0;
+    return false;
+  }
+
+  while (!context_.window->should_close()) {
+    if (render_thread_) {
+      // The main thread requests a frame when it receives a window event, see `pump_events()`
+      auto lock = std::unique_lock(frame_requests_->mutex);
+      frame_requests_->requested_cv.wait_for(lock, create_info_.on_demand_idle_timeout,
+                                             [this]() { return frame_requests_->requested; });
+    } else {
+      // The events are dispatched by the next `sample_input()`
+      const auto received_events = context_.window->received_events();
+      context_.window->wait_events(create_info_.on_demand_idle_timeout);
+      if (context_.window->received_events() != received_events) {
+        request_frame();
+      }
+    }
+
+    if (take_frame_request() || context_.timeline_waits->pending() > 0) {
+      break;
+    }
+  }
+
+  trailing_frames_ = kOnDemandTrailingFrames;
+  return true;
+}
+
+void VulkanApplication::sleep_sampling_input(Clock::time_point deadline) {
+  if (create_info_.input_sampling_rate_hz == 0 || render_thread_) {
+    std::this_thread::sleep_until(deadline);
+    return;
+  }
+
+  const auto period = std::chrono::duration_cast<Clock::duration>(1s) / create_info_.input_sampling_rate_hz;
+  for (auto now = Clock::now(); now < deadline; now = Clock::now()) {
+    sample_input();
+    std::this_thread::sleep_until(std::min(now + period, deadline));
+  }
+}
+
+void VulkanApplication::set_present_mode(PresentMode present_mode) {
+  create_info_.present_mode = present_mode;
+  context_.swap_chain->set_present_mode(present_mode);
+}
+
+void VulkanApplication::set_frame_rate_cap(float frame_rate) {
+  create_info_.frame_rate_cap = frame_rate;
+  update_frame_limiter();
+}
+
+void VulkanApplication::update_frame_limiter() {
+  auto frame_rate = create_info_.frame_rate_cap;
+  if (frame_rate <= 0.0F && create_info_.variable_refresh_rate &&
+      context_.window->refresh_rate() > kVariableRefreshRateMargin) {
+    frame_rate = static_cast<float>(context_.window->refresh_rate() - kVariableRefreshRateMargin);
+  }
+  if (frame_rate != frame_limiter_.frame_rate()) {
+    frame_limiter_.set_frame_rate(frame_rate);
+    util::Logger::info("Frame rate cap: {}", frame_rate > 0.0F ? std::format("{:.1f} FPS", frame_rate) : "none");
+  }
+}
+
+void VulkanApplication::pace_frame() {
+  if (frame_limiter_.is_enabled()) {
+    ERAY_PROFILE_SCOPE("Frame rate cap");
+    frame_limiter_.wait([this](Clock::time_point deadline) { sleep_sampling_input(deadline); });
+  }
+
+  if (!create_info_.low_latency || !context_.device->has_present_wait() || !context_.swap_chain->vsync_enabled()) {
+    return;
+  }
+  ERAY_PROFILE_FUNCTION();
+
+  // The timeout keeps the application responsive when the window is minimized and nothing is displayed
+  static constexpr auto kPresentWaitTimeout = std::chrono::nanoseconds(100ms).count();
+  static constexpr auto kDelayStep          = 250us;
+
+  if (present_id_ > 0 &&
+      (**context_.swap_chain).waitForPresent(present_id_, kPresentWaitTimeout) == vk::Result::eSuccess) {
+    const auto now = Clock::now();
+    if (present_time_ != Clock::time_point{}) {
+      // Smoothed, the presentation times jitter a little
+      const auto interval = std::chrono::duration_cast<Duration>(now - present_time_);
+      refresh_interval_   = refresh_interval_ == 0ns ? interval : (refresh_interval_ * 7 + interval) / 8;
+    }
+    present_time_  = now;
+    input_latency_ = std::chrono::duration_cast<Duration>(now - input_sample_time_);
+
+    // A frame that took longer than the refresh interval has missed the vertical blank it was delayed for
+    if (input_latency_ > refresh_interval_ + kDelayStep) {
+      frame_delay_ /= 2;
+    } else {
+      frame_delay_ = std::min(frame_delay_ + kDelayStep, refresh_interval_ / 2 + refresh_interval_ / 4);
+    }
+
+    if (frame_delay_ > 0ns) {
+      sleep_sampling_input(Clock::now() + frame_delay_);
+    }
+  }
+
+  input_sample_time_ = Clock::now();
 }
 
 void VulkanApplication::render_frame(Duration delta) {
-  // If rendering for the current frame has not finished yet, CPU waits for the GPU
-  while (vk::Result::eTimeout ==
-         context_.device->vk().waitForFences(*record_fences_[current_frame_], vk::True, UINT64_MAX)) {
-    ;
+  ERAY_PROFILE_FUNCTION();
+
+  // If the previous use of the frame in flight has not finished yet, CPU waits for the GPU
+  {
+    ERAY_PROFILE_SCOPE("Wait for frame");
+    const auto frame    = context_.frame_timeline.current_frame();
+    const auto wait_for = frame > frames_in_flight_ ? frame - frames_in_flight_ : 0;
+    if (create_info_.input_sampling_rate_hz > 0 && !render_thread_) {
+      const auto period = std::chrono::duration_cast<Clock::duration>(1s) / create_info_.input_sampling_rate_hz;
+      while (!context_.frame_timeline.is_complete(wait_for)) {
+        sample_input();
+        std::this_thread::sleep_for(period);
+      }
+    }
+    context_.frame_timeline.wait(wait_for).or_panic("Could not wait for the frame in flight");
+  }
+  {
+    ERAY_PROFILE_SCOPE("Resume timeline waits");
+    context_.timeline_waits->poll();
+  }
+  if (frame_capture_) {
+    frame_capture_->poll(context_.frame_timeline);
+  }
+  if (benchmark_) {
+    benchmark_->begin_frame(current_frame_);
+  }
+  context_.staging_ring.begin_frame(current_frame_);
+  context_.uniform_ring.begin_frame(current_frame_);
+  context_.bindless_heap.begin_frame(current_frame_);
+  context_.frame_descriptor_allocator.begin_frame(current_frame_);
+  context_.frame_arena.begin_frame(current_frame_);
+  context_.descriptor_set_cache.begin_frame(current_frame_);
+  if (context_.device->has_descriptor_buffer()) {
+    context_.descriptor_buffer.begin_frame(current_frame_);
+  }
+  context_.frame_deletion_queue.begin_frame(current_frame_);
+  if (auto& alloc_manager = context_.device->vma_alloc_manager();
+      alloc_manager.has_pending_defragmentation_pass() && defragmentation_frame_ == current_frame_) {
+    alloc_manager.end_defragmentation_pass().or_panic("Could not end the defragmentation pass");
   }
-  context_.device->vk().resetFences(*record_fences_[current_frame_]);
   graphics_command_buffers_[current_frame_].reset();
+  if (context_.device->has_async_compute_queue()) {
+    ownership_release_command_buffers_[current_frame_].reset();
+    async_compute_command_buffers_[current_frame_].reset();
+    after_async_compute_command_buffers_[current_frame_].reset();
+  }
 
-  // Get the image from the swap chain. When the image is ready ready the present semaphore will be signaled.
+  // Get the image from the swap chain. When the image is ready ready the present semaphore will be signaled. After
+  // the swap chain is recreated the acquire is retried, so that the retired resources pushed to the frame deletion
+  // queue are destroyed only after this frame is finished.
   uint32_t image_index{};
-  if (auto acquire_opt = context_.swap_chain->acquire_next_image(
-          UINT64_MAX, *acquire_image_semaphores_[current_semaphore_], nullptr)) {
-    if (acquire_opt->status != SwapChain::AcquireResult::Status::Success) {
+  auto acquired = false;
+  for (auto attempt = 0; attempt < 2 && !acquired; ++attempt) {
+    if (auto acquire_opt = context_.swap_chain->acquire_next_image(
+            UINT64_MAX, *acquire_image_semaphores_[current_semaphore_], nullptr)) {
+      acquired    = acquire_opt->status == SwapChain::AcquireResult::Status::Success;
+      image_index = acquire_opt->image_index;
+    } else {
+      eray::util::panic("Failed to acquire next image!");
       return;
     }
-    image_index = acquire_opt->image_index;
-  } else {
-    eray::util::panic("Failed to acquire next image!");
+  }
+  if (!acquired) {
+    // Nothing is submitted in this frame, the retired resources must not outlive the frames in flight
+    {
+      const auto wait = WaitScope(context_.device->wait_statistics(), "Swap chain retirement", WaitKind::Stall);
+      context_.device->vk().waitIdle();
+    }
+    context_.frame_deletion_queue.begin_frame(current_frame_);
     return;
   }
+  acquire_window_targets();
   record_graphics_command_buffer(current_frame_, image_index);
   on_frame_prepare(current_frame_, delta);
 
-  auto wait_dst_stage_mask = vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput);
-  auto submit_info         = vk::SubmitInfo{
-              .waitSemaphoreCount   = 1,
-              .pWaitSemaphores      = &*acquire_image_semaphores_[current_semaphore_],
-              .pWaitDstStageMask    = &wait_dst_stage_mask,
-              .commandBufferCount   = 1,
-              .pCommandBuffers      = &*graphics_command_buffers_[current_frame_],
-              .signalSemaphoreCount = 1,
-              .pSignalSemaphores    = &*render_finished_semaphores_[image_index],
-  };
-
   if (frame_data_dirty_) {
-    auto prev_frame = (kMaxFramesInFlight + current_frame_ - 1) % kMaxFramesInFlight;
-    while (vk::Result::eTimeout ==
-           context_.device->vk().waitForFences(*record_fences_[prev_frame], vk::True, UINT64_MAX)) {
-      ;
-    }
+    context_.frame_timeline.wait(context_.frame_timeline.submitted_frame(), UINT64_MAX, WaitKind::Stall)
+        .or_panic("Could not wait for the previous frame");
     on_frame_prepare_sync(delta);
     frame_data_dirty_ = false;
   }
-  context_.device->graphics_compute_queue().submit(submit_info, *record_fences_[current_frame_]);
+
+  if (context_.device->has_async_compute_queue()) {
+    submit_with_async_compute(image_index);
+  } else {
+    auto waits = std::vector<vk::SemaphoreSubmitInfo>{
+        vk::SemaphoreSubmitInfo{
+            .semaphore = *acquire_image_semaphores_[current_semaphore_],
+            .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+        },
+    };
+    if (upload_wait_) {
+      waits.push_back(*upload_wait_);
+    }
+    auto cmd_buff = vk::CommandBufferSubmitInfo{.commandBuffer = *graphics_command_buffers_[current_frame_]};
+    auto signals  = std::vector<vk::SemaphoreSubmitInfo>{
+        vk::SemaphoreSubmitInfo{
+            .semaphore = *render_finished_semaphores_[image_index],
+            .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+        },
+        context_.frame_timeline.graphics_signal_info(),
+    };
+    for (const auto& target : context_.window_targets) {
+      if (target->is_acquired()) {
+        waits.push_back(target->wait_info());
+        signals.push_back(target->signal_info());
+      }
+    }
+    ERAY_PROFILE_SCOPE("Queue submit");
+    context_.device->graphics_compute_queue().submit2(vk::SubmitInfo2{
+        .waitSemaphoreInfoCount   = static_cast<uint32_t>(waits.size()),
+        .pWaitSemaphoreInfos      = waits.data(),
+        .commandBufferInfoCount   = 1,
+        .pCommandBufferInfos      = &cmd_buff,
+        .signalSemaphoreInfoCount = static_cast<uint32_t>(signals.size()),
+        .pSignalSemaphoreInfos    = signals.data(),
+    });
+  }
+  context_.frame_timeline.advance();
+
+  // The presentation of the frame is awaited by `pace_frame()` in the low latency mode
+  ++present_id_;
+  const auto present_id = vk::PresentIdKHR{
+      .swapchainCount = 1,
+      .pPresentIds    = &present_id_,
+  };
 
   // The image will not be presented until the render finished semaphore is signaled by the submit call.
   const auto present_info = vk::PresentInfoKHR{
+      .pNext              = context_.device->has_present_wait() ? &present_id : nullptr,
       .waitSemaphoreCount = 1,
       .pWaitSemaphores    = &*render_finished_semaphores_[image_index],
       .swapchainCount     = 1,
@@ -185,14 +1463,175 @@ void VulkanApplication::render_frame(Duration delta) {
   if (!context_.swap_chain->present_image(present_info)) {
     eray::util::Logger::err("Failed to present an image!");
   }
+  present_window_targets();
 
   current_semaphore_ = (current_semaphore_ + 1) % acquire_image_semaphores_.size();
-  current_frame_     = (current_frame_ + 1) % kMaxFramesInFlight;
+  current_frame_     = (current_frame_ + 1) % frames_in_flight_;
+}
+
+void VulkanApplication::submit_with_async_compute(uint32_t image_index) {
+  ERAY_PROFILE_FUNCTION();
+
+  // The render graph releases the async compute resources in a separate submission, so that the async compute can
+  // start before the graphics passes finish. The release submission also waits for the previous frames, as the
+  // signal operation covers all of the commands submitted earlier to the graphics queue.
+  auto timeline_value = context_.frame_timeline.current_frame();
+
+  auto release_cmd_buff =
+      vk::CommandBufferSubmitInfo{.commandBuffer = *ownership_release_command_buffers_[current_frame_]};
+  auto graphics_cmd_buff = vk::CommandBufferSubmitInfo{.commandBuffer = *graphics_command_buffers_[current_frame_]};
+  auto release_signal    = vk::SemaphoreSubmitInfo{
+         .semaphore = *ownership_release_semaphore_,
+         .value     = timeline_value,
+         .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+  };
+  auto graphics_submits = std::array{
+      vk::SubmitInfo2{
+          .waitSemaphoreInfoCount   = upload_wait_ ? 1U : 0U,
+          .pWaitSemaphoreInfos      = upload_wait_ ? &*upload_wait_ : nullptr,
+          .commandBufferInfoCount   = 1,
+          .pCommandBufferInfos      = &release_cmd_buff,
+          .signalSemaphoreInfoCount = 1,
+          .pSignalSemaphoreInfos    = &release_signal,
+      },
+      vk::SubmitInfo2{
+          .commandBufferInfoCount = 1,
+          .pCommandBufferInfos    = &graphics_cmd_buff,
+      },
+  };
+  context_.device->graphics_compute_queue().submit2(graphics_submits);
+
+  auto async_compute_cmd_buff =
+      vk::CommandBufferSubmitInfo{.commandBuffer = *async_compute_command_buffers_[current_frame_]};
+  auto async_compute_wait = vk::SemaphoreSubmitInfo{
+      .semaphore = *ownership_release_semaphore_,
+      .value     = timeline_value,
+      .stageMask = vk::PipelineStageFlagBits2::eComputeShader,
+  };
+  auto async_compute_signal = context_.frame_timeline.compute_signal_info();
+  context_.device->compute_queue().submit2(vk::SubmitInfo2{
+      .waitSemaphoreInfoCount   = 1,
+      .pWaitSemaphoreInfos      = &async_compute_wait,
+      .commandBufferInfoCount   = 1,
+      .pCommandBufferInfos      = &async_compute_cmd_buff,
+      .signalSemaphoreInfoCount = 1,
+      .pSignalSemaphoreInfos    = &async_compute_signal,
+  });
+
+  auto final_cmd_buff =
+      vk::CommandBufferSubmitInfo{.commandBuffer = *after_async_compute_command_buffers_[current_frame_]};
+  auto final_waits = std::vector<vk::SemaphoreSubmitInfo>{
+      vk::SemaphoreSubmitInfo{
+          .semaphore = *acquire_image_semaphores_[current_semaphore_],
+          .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+      },
+      context_.frame_timeline.compute_wait_info(context_.render_graph.async_compute_wait_stage_mask()),
+  };
+  auto final_signals = std::vector<vk::SemaphoreSubmitInfo>{
+      vk::SemaphoreSubmitInfo{
+          .semaphore = *render_finished_semaphores_[image_index],
+          .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+      },
+      context_.frame_timeline.graphics_signal_info(),
+  };
+  for (const auto& target : context_.window_targets) {
+    if (target->is_acquired()) {
+      final_waits.push_back(target->wait_info());
+      final_signals.push_back(target->signal_info());
+    }
+  }
+  context_.device->graphics_compute_queue().submit2(vk::SubmitInfo2{
+      .waitSemaphoreInfoCount   = static_cast<uint32_t>(final_waits.size()),
+      .pWaitSemaphoreInfos      = final_waits.data(),
+      .commandBufferInfoCount   = 1,
+      .pCommandBufferInfos      = &final_cmd_buff,
+      .signalSemaphoreInfoCount = static_cast<uint32_t>(final_signals.size()),
+      .pSignalSemaphoreInfos    = final_signals.data(),
+  });
+}
+
+void VulkanApplication::acquire_window_targets() {
+  const auto is_closed = [](const std::unique_ptr<WindowTarget>& target) { return target->window().should_close(); };
+  if (std::ranges::any_of(context_.window_targets, is_closed)) {
+    // Rare enough to wait for the device, the surface must outlive the retired swap chains of the deletion queue
+    {
+      const auto wait = WaitScope(context_.device->wait_statistics(), "Window target closing", WaitKind::Stall);
+      context_.device->vk().waitIdle();
+    }
+    context_.frame_deletion_queue.flush_all();
+
+    // The main thread processes the events of the windows, see `pump_events()`
+    auto platform_lock = std::unique_lock<std::mutex>();
+    if (render_thread_) {
+      platform_lock = std::unique_lock(render_thread_->platform_mutex);
+    }
+    std::erase_if(context_.window_targets, [this, &is_closed](const std::unique_ptr<WindowTarget>& target) {
+      if (!is_closed(target)) {
+        return false;
+      }
+      auto window = target->window_ptr();
+      target->destroy();
+      if (render_thread_) {
+        render_thread_->closed_windows.push_back(std::move(window));
+      } else {
+        window->destroy();
+      }
+      return true;
+    });
+  }
+
+  for (auto& target : context_.window_targets) {
+    if (auto result = target->acquire(); !result) {
+      util::Logger::err("Could not acquire an image of the window \"{}\"", target->window().title());
+    }
+  }
+}
+
+void VulkanApplication::record_window_targets(const vk::raii::CommandBuffer& cmd_buff, uint32_t frame_index) {
+  for (auto& target : context_.window_targets) {
+    if (!target->is_acquired()) {
+      continue;
+    }
+    ERAY_PROFILE_GPU_SCOPE(&context_.gpu_profiler, *cmd_buff, "Window");
+    target->begin_rendering(cmd_buff, get_clear_color_value(), get_clear_depth_stencil_value());
+    on_record_window(*target, cmd_buff, frame_index);
+    target->end_rendering(cmd_buff);
+  }
+}
+
+void VulkanApplication::present_window_targets() {
+  // Every window is presented separately, so that an out of date swap chain or a slow presentation engine of one
+  // window does not affect the others
+  for (auto& target : context_.window_targets) {
+    if (target->is_acquired() && !target->present()) {
+      util::Logger::err("Could not present the window \"{}\"", target->window().title());
+    }
+  }
 }
 
 void VulkanApplication::destroy() {
+  os::System::file_dialog().set_completion_callback(nullptr);
+  if (asset_loading_) {
+    // The window was closed before the assets were loaded
+    context_.job_system->wait(asset_loading_->counter);
+    asset_loading_.reset();
+  }
   on_destroy();
+  benchmark_.reset();
+  context_.job_system.reset();
+  context_.render_graph.set_gpu_profiler(nullptr);
+  context_.gpu_profiler = GpuProfiler(nullptr);
+  context_.render_graph.set_shader_cost_profiler(nullptr);
+  if (context_.shader_cost_profiler) {
+    context_.shader_cost_profiler->destroy();
+    context_.shader_cost_profiler.reset();
+  }
+  context_.frame_deletion_queue.flush_all();
   deletion_queue_.flush();
+  for (auto& target : context_.window_targets) {
+    target->destroy();
+  }
+  context_.window_targets.clear();
   context_.swap_chain->destroy();
 
   eray::util::Logger::succ("Successfully destroyed the vulkan application");
@@ -204,7 +1643,8 @@ vk::SampleCountFlagBits VulkanApplication::get_msaa_sample_count(const vk::raii:
 
 void VulkanApplication::create_swap_chain() {
   context_.swap_chain = SwapChain::create(*context_.device, context_.window,
-                                          get_msaa_sample_count(context_.device->physical_device()), create_info_.vsync)
+                                          get_msaa_sample_count(context_.device->physical_device()),
+                                          create_info_.present_mode, frames_in_flight_)
                             .or_panic("Could not create a swap chain");
 }
 
@@ -225,6 +1665,12 @@ void VulkanApplication::create_command_pool() {
 
   command_pool_ =
       Result(context_.device->vk().createCommandPool(command_pool_info)).or_panic("Could not create a command pool");
+
+  if (context_.device->has_async_compute_queue()) {
+    command_pool_info.queueFamilyIndex = context_.device->compute_queue_family();
+    async_compute_command_pool_        = Result(context_.device->vk().createCommandPool(command_pool_info))
+                                      .or_panic("Could not create an async compute command pool");
+  }
 }
 
 void VulkanApplication::create_command_buffers() {
@@ -238,12 +1684,29 @@ void VulkanApplication::create_command_buffers() {
       // - VK_COMMAND_BUFFER_LEVEL_SECONDARY: Cannot be submitted directly, but can be called from primary command
       //   buffers.
       .level              = vk::CommandBufferLevel::ePrimary,  //
-      .commandBufferCount = kMaxFramesInFlight,                //
+      .commandBufferCount = frames_in_flight_,                 //
   };
 
   auto result =
       Result(context_.device->vk().allocateCommandBuffers(alloc_info)).or_panic("Could not allocate a command buffer");
-  std::ranges::move(result | std::views::take(kMaxFramesInFlight), graphics_command_buffers_.begin());
+  graphics_command_buffers_ = std::move(result);
+
+  if (context_.device->has_async_compute_queue()) {
+    alloc_info.commandBufferCount = 2 * frames_in_flight_;
+    result = Result(context_.device->vk().allocateCommandBuffers(alloc_info))
+                 .or_panic("Could not allocate a command buffer");
+    ownership_release_command_buffers_.clear();
+    after_async_compute_command_buffers_.clear();
+    std::ranges::move(result | std::views::take(frames_in_flight_),
+                      std::back_inserter(ownership_release_command_buffers_));
+    std::ranges::move(result | std::views::drop(frames_in_flight_),
+                      std::back_inserter(after_async_compute_command_buffers_));
+
+    alloc_info.commandPool         = async_compute_command_pool_;
+    alloc_info.commandBufferCount  = frames_in_flight_;
+    async_compute_command_buffers_ = Result(context_.device->vk().allocateCommandBuffers(alloc_info))
+                                         .or_panic("Could not allocate a command buffer");
+  }
 }
 
 void VulkanApplication::create_sync_objs() {
@@ -266,33 +1729,96 @@ void VulkanApplication::create_sync_objs() {
     }
   }
 
-  for (size_t i = 0; i < kMaxFramesInFlight; ++i) {
-    if (auto result =
-            context_.device->vk().createFence(vk::FenceCreateInfo{.flags = vk::FenceCreateFlagBits::eSignaled})) {
-      record_fences_[i] = std::move(*result);
-    } else {
-      eray::util::panic("Could not create a fence");
-    }
+  if (context_.device->has_async_compute_queue()) {
+    auto timeline_info = vk::SemaphoreTypeCreateInfo{
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue  = 0,
+    };
+    auto semaphore_info          = vk::SemaphoreCreateInfo{.pNext = &timeline_info};
+    ownership_release_semaphore_ = Result(context_.device->vk().createSemaphore(semaphore_info))
+                                       .or_panic("Could not create a timeline semaphore");
+  }
+}
+
+void VulkanApplication::record_defragmentation_pass(vk::CommandBuffer cmd_buff, uint32_t frame_index) {
+  auto& alloc_manager = context_.device->vma_alloc_manager();
+  if (!alloc_manager.is_defragmenting() || alloc_manager.has_pending_defragmentation_pass()) {
+    return;
+  }
+
+  auto relocations = alloc_manager.record_defragmentation_pass(cmd_buff).or_panic("Defragmentation pass failed");
+  defragmentation_frame_ = frame_index;
+  if (!relocations.empty()) {
+    on_buffers_relocated(relocations, frame_index);
+  }
+}
+
+void VulkanApplication::begin_query_frame(vk::CommandBuffer cmd_buff, uint32_t frame_index) {
+  context_.device->query_pools().begin_frame(cmd_buff, frame_index);
+  if (context_.shader_cost_profiler) {
+    context_.shader_cost_profiler->begin_frame(frame_index);
   }
 }
 
 void VulkanApplication::record_graphics_command_buffer(size_t frame_index, uint32_t image_index) {
+  ERAY_PROFILE_FUNCTION();
   auto clear_color_value         = get_clear_color_value();
   auto clear_depth_stencil_value = get_clear_depth_stencil_value();
 
+  // Batches submitted while the frame is recorded are waited for by the next frame
+  upload_wait_ = context_.uploader.graphics_wait_info();
+
   graphics_command_buffers_[frame_index].begin({});
-  {
+  context_.gpu_profiler.collect(graphics_command_buffers_[frame_index]);
+  if (context_.device->has_async_compute_queue()) {
+    ownership_release_command_buffers_[frame_index].begin({});
+    if (benchmark_) {
+      benchmark_->write_frame_begin(ownership_release_command_buffers_[frame_index],
+                                    static_cast<uint32_t>(frame_index));
+    }
+    async_compute_command_buffers_[frame_index].begin({});
+    after_async_compute_command_buffers_[frame_index].begin({});
+    begin_query_frame(ownership_release_command_buffers_[frame_index], static_cast<uint32_t>(frame_index));
+
+    // The ownership release is submitted first, the uploads are visible to both of the queues
+    context_.staging_ring.record_pending_copies(ownership_release_command_buffers_[frame_index],
+                                                static_cast<uint32_t>(frame_index));
+    context_.uploader.record_acquire_barriers(ownership_release_command_buffers_[frame_index])
+        .or_panic("Could not acquire the uploaded resources");
+    record_defragmentation_pass(ownership_release_command_buffers_[frame_index], static_cast<uint32_t>(frame_index));
+
+    auto cmd_buffs = AsyncComputeCommandBuffers{
+        .ownership_release            = ownership_release_command_buffers_[frame_index],
+        .async_compute                = async_compute_command_buffers_[frame_index],
+        .graphics                     = graphics_command_buffers_[frame_index],
+        .graphics_after_async_compute = after_async_compute_command_buffers_[frame_index],
+    };
+    context_.render_graph.emit(*context_.device, cmd_buffs);
+
+    ownership_release_command_buffers_[frame_index].end();
+    async_compute_command_buffers_[frame_index].end();
+    graphics_command_buffers_[frame_index].end();
+  } else {
     auto cmd_buff = vk::CommandBuffer{graphics_command_buffers_[frame_index]};
+    if (benchmark_) {
+      benchmark_->write_frame_begin(cmd_buff, static_cast<uint32_t>(frame_index));
+    }
+    begin_query_frame(cmd_buff, static_cast<uint32_t>(frame_index));
+    context_.staging_ring.record_pending_copies(cmd_buff, static_cast<uint32_t>(frame_index));
+    context_.uploader.record_acquire_barriers(cmd_buff).or_panic("Could not acquire the uploaded resources");
+    record_defragmentation_pass(cmd_buff, static_cast<uint32_t>(frame_index));
     context_.render_graph.emit(*context_.device, cmd_buff);
   }
-  context_.swap_chain->begin_rendering(graphics_command_buffers_[frame_index], image_index, clear_color_value,
-                                       clear_depth_stencil_value);
+
+  // The swap chain image is rendered after the render graph, in the last graphics submission
+  auto& cmd_buff = context_.device->has_async_compute_queue() ? after_async_compute_command_buffers_[frame_index]
+                                                               : graphics_command_buffers_[frame_index];
+  context_.swap_chain->begin_rendering(cmd_buff, image_index, clear_color_value, clear_depth_stencil_value);
 
   // Scissor rectangle defines in which region pixels will actually be stored. The rasterizer will discard any
   // pixels outside the scissored rectangle. We want to draw to entire framebuffer.
-  graphics_command_buffers_[frame_index].setScissor(
-      0, vk::Rect2D{.offset = vk::Offset2D{.x = 0, .y = 0}, .extent = context_.swap_chain->extent()});
-  graphics_command_buffers_[frame_index].setViewport(
+  cmd_buff.setScissor(0, vk::Rect2D{.offset = vk::Offset2D{.x = 0, .y = 0}, .extent = context_.swap_chain->extent()});
+  cmd_buff.setViewport(
       0, vk::Viewport{
              .x      = 0.0F,
              .y      = 0.0F,
@@ -302,15 +1828,36 @@ void VulkanApplication::record_graphics_command_buffer(size_t frame_index, uint3
              .minDepth = 0.0F,
              .maxDepth = 1.0F  //
          });
-  on_record_graphics(graphics_command_buffers_[frame_index], static_cast<uint32_t>(frame_index));
-
   {
-    vk::CommandBuffer cmd_buff = graphics_command_buffers_[frame_index];
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), static_cast<VkCommandBuffer>(cmd_buff));
+    ERAY_PROFILE_GPU_SCOPE(&context_.gpu_profiler, *cmd_buff, "Swap chain");
+    on_record_graphics(cmd_buff, static_cast<uint32_t>(frame_index));
+
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), static_cast<VkCommandBuffer>(vk::CommandBuffer{cmd_buff}));
+  }
+
+  context_.swap_chain->end_rendering(cmd_buff, image_index);
+  if (frame_capture_) {
+    // The image is captured in the layout it is left in for the presentation
+    auto& swap_chain  = *context_.swap_chain;
+    const auto layout =
+        swap_chain.is_headless() ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+    if (auto result = frame_capture_->record_capture(*cmd_buff, swap_chain.images()[image_index],
+                                                     swap_chain.image_format(), swap_chain.extent(), layout,
+                                                     context_.frame_timeline.current_frame());
+        !result) {
+      util::Logger::err("Could not capture the frame: {}", result.error().msg);
+    }
+  }
+  record_window_targets(cmd_buff, static_cast<uint32_t>(frame_index));
+  if (benchmark_) {
+    benchmark_->write_frame_end(cmd_buff, static_cast<uint32_t>(frame_index));
   }
+  cmd_buff.end();
 
-  context_.swap_chain->end_rendering(graphics_command_buffers_[frame_index], image_index);
-  graphics_command_buffers_[frame_index].end();
+  context_.uniform_ring.flush();
+  if (context_.device->has_descriptor_buffer()) {
+    context_.descriptor_buffer.flush();
+  }
 }
 
 static void check_vk_result(VkResult err) {
@@ -354,10 +1901,11 @@ void VulkanApplication::init_imgui() {
   ImGui::CreateContext();
 
   // this initializes imgui for SDL
-  if (context_.window->window_api() != os::WindowAPI::GLFW) {
+  if (context_.window->window_api() == os::WindowAPI::GLFW) {
+    ImGui_ImplGlfw_InitForVulkan(reinterpret_cast<GLFWwindow*>(context_.window->win_ptr()), true);
+  } else if (context_.window->window_api() != os::WindowAPI::Headless) {
     util::panic("Could not initialize imgui context: only GLFW is supported");
   }
-  ImGui_ImplGlfw_InitForVulkan(reinterpret_cast<GLFWwindow*>(context_.window->win_ptr()), true);
 
   // this initializes imgui for Vulkan
   vk::Instance instance                    = context_.device->instance();
@@ -380,7 +1928,7 @@ void VulkanApplication::init_imgui() {
   init_info.MinImageCount               = context_.swap_chain->min_image_count();
   init_info.ImageCount                  = static_cast<uint32_t>(context_.swap_chain->images().size());
   init_info.MSAASamples                 = static_cast<VkSampleCountFlagBits>(context_.swap_chain->msaa_sample_count());
-  init_info.PipelineCache               = VK_NULL_HANDLE;
+  init_info.PipelineCache               = *context_.device->pipeline_cache();
   init_info.Subpass                     = 0;
   init_info.UseDynamicRendering         = true;
   init_info.PipelineRenderingCreateInfo = {
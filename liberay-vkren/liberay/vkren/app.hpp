@@ -2,16 +2,42 @@
 
 #include <imgui/imgui.h>
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <filesystem>
 #include <liberay/os/file_dialog.hpp>
 #include <liberay/os/input.hpp>
+#include <liberay/os/input_recording.hpp>
 #include <liberay/os/system.hpp>
 #include <liberay/os/window/window.hpp>
+#include <liberay/util/arena.hpp>
+#include <liberay/util/frame_limiter.hpp>
+#include <liberay/util/job_system.hpp>
+#include <liberay/vkren/benchmark.hpp>
+#include <liberay/vkren/bindless_heap.hpp>
+#include <liberay/vkren/buffer/staging_ring_buffer.hpp>
+#include <liberay/vkren/buffer/uniform_ring_buffer.hpp>
 #include <liberay/vkren/deletion_queue.hpp>
 #include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/descriptor_buffer.hpp>
 #include <liberay/vkren/device.hpp>
+#include <liberay/vkren/frame_capture.hpp>
+#include <liberay/vkren/frame_timeline.hpp>
+#include <liberay/vkren/gpu_profiler.hpp>
 #include <liberay/vkren/render_graph.hpp>
+#include <liberay/vkren/shader_cost_profiler.hpp>
 #include <liberay/vkren/swap_chain.hpp>
+#include <liberay/vkren/timeline_wait_queue.hpp>
+#include <liberay/vkren/trace_capture.hpp>
+#include <liberay/vkren/transfer_uploader.hpp>
+#include <liberay/vkren/window_target.hpp>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_raii.hpp>
@@ -52,6 +78,73 @@ struct VulkanApplicationContext {
    */
   RenderGraph render_graph;
 
+  /**
+   * @brief Staging memory for the per-frame uploads. The queued copies are recorded at the beginning of the next
+   * recorded frame, before the render graph.
+   */
+  StagingRingBuffer staging_ring = StagingRingBuffer(nullptr);
+
+  /**
+   * @brief Per-frame uniform data bound with dynamic offsets. The partition of the frame is flushed when the frame is
+   * recorded.
+   */
+  UniformRingBuffer uniform_ring = UniformRingBuffer(nullptr);
+
+  /**
+   * @brief Global descriptor set of textures, storage buffers and samplers addressed by their indices. The released
+   * indices are recycled once the frame that released them has finished.
+   */
+  BindlessHeap bindless_heap = BindlessHeap(nullptr);
+
+  /**
+   * @brief Descriptor sets that are rebuilt every frame. The pools of a frame are reset at once when the frame begins.
+   */
+  FrameDescriptorAllocator frame_descriptor_allocator = FrameDescriptorAllocator(nullptr);
+
+  /**
+   * @brief CPU memory of the containers that live for a single frame, e.g.
+   * `std::pmr::vector<vk::ImageMemoryBarrier2>(frame_arena.resource())` or
+   * `DescriptorSetBinder::create(device, frame_arena.resource())`. Reset when the frame begins, used by the render
+   * thread only.
+   */
+  util::FrameArena frame_arena = util::FrameArena(nullptr);
+
+  /**
+   * @brief Long-lived descriptor sets reused by their contents. The sets that reference a resource pushed to the
+   * `frame_deletion_queue` are evicted.
+   */
+  DescriptorSetCache descriptor_set_cache = DescriptorSetCache(nullptr);
+
+  /**
+   * @brief Per-frame descriptors written with VK_EXT_descriptor_buffer. Created only when the device uses the
+   * `DescriptorBackend::DescriptorBuffer`, see `VulkanApplicationCreateInfo::prefer_descriptor_buffer`.
+   */
+  DescriptorBuffer descriptor_buffer = DescriptorBuffer(nullptr);
+
+  /**
+   * @brief Non-blocking uploads on the transfer queue. The frames wait for the batches submitted before they are
+   * recorded and acquire the uploaded resources automatically.
+   */
+  TransferUploader uploader = TransferUploader(nullptr);
+
+  /**
+   * @brief Resources released while the application is running. They are destroyed once the frames in flight that
+   * might use them have finished.
+   */
+  FrameDeletionQueue frame_deletion_queue = FrameDeletionQueue(nullptr);
+
+  /**
+   * @brief Numbers the submitted frames. A frame is finished on the GPU once its number is reached by the graphics
+   * timeline, so the work of a frame can be waited for or queried without the fences.
+   */
+  FrameTimeline frame_timeline = FrameTimeline(nullptr);
+
+  /**
+   * @brief Coroutines waiting for the uploads and the frames, polled at the start of every frame, e.g.
+   * `co_await context.timeline_waits->wait(context.uploader, token)`.
+   */
+  std::unique_ptr<TimelineWaitQueue> timeline_waits = nullptr;
+
   /**
    * @brief Main input manager of the application.
    */
@@ -61,6 +154,29 @@ struct VulkanApplicationContext {
    * @brief Main input manager of the application.
    */
   std::unique_ptr<os::InputManager> frame_input_manager = nullptr;
+
+  /**
+   * @brief Work-stealing thread pool shared by the parallel parts of the engine and the application.
+   */
+  std::unique_ptr<util::JobSystem> job_system = nullptr;
+
+  /**
+   * @brief Tracy GPU zones of the graphics queue, empty unless built with the `ENABLE_TRACY` CMake option. The render
+   * graph passes are profiled automatically.
+   */
+  GpuProfiler gpu_profiler = GpuProfiler(nullptr);
+
+  /**
+   * @brief Present when the `enable_shader_cost_profiling` create info flag is set, the render graph passes are
+   * profiled automatically. Pass it to `RenderQueue::record()` to split the passes by the materials.
+   */
+  std::optional<ShaderCostProfiler> shader_cost_profiler;
+
+  /**
+   * @brief Additional windows presented by the device, see `VulkanApplication::add_window()`. The closed windows are
+   * removed by the frame loop.
+   */
+  std::vector<std::unique_ptr<WindowTarget>> window_targets;
 };
 
 struct VulkanApplicationCreateInfo {
@@ -73,10 +189,231 @@ struct VulkanApplicationCreateInfo {
   bool enable_msaa = true;
 
   /**
-   * @brief Enables VSync.
+   * @brief Presentation mode policy, may be changed at runtime with `VulkanApplication::set_present_mode()`.
+   *
+   */
+  PresentMode present_mode = PresentMode::Fifo;
+
+  /**
+   * @brief Frames per second the frames are capped at by a sleep-plus-spin limiter, 0 disables the cap. May be changed
+   * at runtime with `VulkanApplication::set_frame_rate_cap()`. Usually combined with the `PresentMode::Mailbox`.
+   *
+   */
+  float frame_rate_cap = 0.0F;
+
+  /**
+   * @brief The display has a variable refresh rate (FreeSync, G-SYNC). Without an explicit `frame_rate_cap` the frames
+   * are capped a few frames below the refresh rate of the monitor, so that they stay within the variable refresh range
+   * and the FIFO presentation queue never fills up.
+   *
+   */
+  bool variable_refresh_rate = false;
+
+  /**
+   * @brief Number of the frames the CPU records ahead of the GPU, clamped to [1,
+   * `VulkanApplication::kMaxFramesInFlight`]. Three frames give a steadier frame rate in the CPU bound scenes, a single
+   * frame gives the lowest latency.
+   *
+   */
+  uint32_t frames_in_flight = 2;
+
+  /**
+   * @brief Delays the start of every frame, i.e. the input sampling, so that the frame is finished just before the
+   * vertical blank. Requires VK_KHR_present_wait (see `Device::has_present_wait()`) and VSync, ignored otherwise.
+   *
+   */
+  bool low_latency = false;
+
+  /**
+   * @brief Polls the window events at this rate while the frame waits for the GPU or for the low latency delay, so the
+   * physics ticks and the `os::InputManager` motion events see the input at a finer granularity than the frame rate.
+   * 0 polls once per frame. GLFW allows polling on the main thread only, so the waits of the main thread are used
+   * instead of a dedicated input thread. With `threaded_rendering` it is the rate the main thread polls at, 0 picks
+   * `kDefaultEventPumpRateHz`.
+   *
+   */
+  uint32_t input_sampling_rate_hz = 0;
+
+  /**
+   * @brief Runs the frames on a dedicated render thread while the main thread only pumps the window events into the
+   * `os::InputEventRing`, so that moving or resizing the window (a modal loop on Windows) or an OS dialog does not
+   * stall the frames and a long frame does not delay the input. The ImGui frame is not rebuilt while the OS blocks the
+   * main thread, the previous one is drawn instead. Ignored by the headless window.
+   *
+   * @warning GLFW allows calling the window on the main thread only, the callbacks should not change the window
+   * (e.g. `os::InputManager::set_mouse_cursor_mode()`) in this mode. The ImGui multi-viewports are disabled.
+   *
+   */
+  bool threaded_rendering = false;
+
+  /**
+   * @brief Renders only when something changes, i.e. on the window events, `request_frame()` and
+   * `mark_frame_data_dirty()`. Otherwise the main loop blocks in `os::Window::wait_events()`, which frees the GPU and
+   * saves power, e.g. for the editors left open. A few frames follow every change, so that the ImGui animations finish.
+   * The time and the physics ticks stand still while idle, an animation should call `request_frame()` every frame.
+   * Ignored by the benchmarks.
+   *
+   */
+  bool on_demand_rendering = false;
+
+  /**
+   * @brief Longest idle wait of the on demand rendering, after which the loop checks the coroutines awaiting the GPU
+   * (see `VulkanApplicationContext::timeline_waits`) without rendering a frame.
+   *
+   */
+  std::chrono::milliseconds on_demand_idle_timeout = 250ms;
+
+  /**
+   * @brief Rate the ImGui frame is rebuilt at while it does not change, 0 rebuilds it every frame. The frames in
+   * between draw the previous draw data again, so a static UI (e.g. a docked editor layout) does not cost the
+   * `on_imgui()` and the ImGui layout every frame. The frame is rebuilt right away on the input, on a resize and while
+   * the draw data differs from the previous one (an ImGui animation), see `is_imgui_frame_static()`.
+   *
+   */
+  uint32_t ui_refresh_rate_hz = 0;
+
+  /**
+   * @brief Runs the fixed time step physics ticks on a dedicated thread, so that a slow tick does not drop frames and a
+   * slow frame does not delay the ticks. The physics state should be passed to the render side with e.g.
+   * `util::TripleBuffer` and interpolated with `physics_interpolation_alpha()`.
+   *
+   */
+  bool threaded_physics = false;
+
+  /**
+   * @brief Number of the job system workers, 0 picks `os::System::recommended_worker_count()`.
+   *
+   */
+  uint32_t worker_count = 0;
+
+  /**
+   * @brief Writes GPU timestamps around every render graph pass, see `show_render_graph_profiler()`.
+   *
+   */
+  bool enable_render_graph_profiling = false;
+
+  /**
+   * @brief Additionally collects the pipeline statistics of passes recorded on the graphics queue. Requires
+   * `enable_render_graph_profiling`.
+   *
+   */
+  bool profile_pipeline_statistics = false;
+
+  /**
+   * @brief Collects the pipeline statistics of every graphics queue pass and material, see `ShaderCostProfiler` and
+   * `show_shader_cost_report()`. Replaces the `profile_pipeline_statistics`.
+   *
+   */
+  bool enable_shader_cost_profiling   = false;
+  uint32_t shader_cost_query_capacity = 1024;
+
+  /**
+   * @brief Records the `ERAY_PROFILE_*` scopes with the in-engine `util::CpuProfiler`, see `show_cpu_profiler()`.
+   *
+   */
+  bool enable_cpu_profiling = false;
+
+  /**
+   * @brief A CPU stall on the GPU longer than the threshold is logged as a warning, see `WaitStatistics`.
+   *
+   */
+  std::chrono::microseconds stall_warning_threshold{2000};
+
+  /**
+   * @brief Shows the performance HUD from the start, see `show_performance_hud()`.
+   *
+   */
+  bool show_performance_hud = false;
+
+  /**
+   * @brief Draws a progress overlay while the `on_load_assets()` runs, see `set_loading_progress()`.
+   *
+   */
+  bool show_loading_overlay = true;
+
+  /**
+   * @brief Key that toggles the performance HUD at runtime, `ImGuiKey_None` disables the toggle.
+   *
+   */
+  ImGuiKey performance_hud_key = ImGuiKey_None;
+
+  /**
+   * @brief Key that captures a trace of the next `trace_capture_frame_count` frames to the `trace_capture_path`, see
+   * `VulkanApplication::capture_trace()`. `ImGuiKey_None` disables the key.
+   *
+   */
+  ImGuiKey trace_capture_key                = ImGuiKey_None;
+  uint32_t trace_capture_frame_count        = 120;
+  std::filesystem::path trace_capture_path = "trace.json";
+
+  /**
+   * @brief Size of the staging ring shared by the frames in flight, see `VulkanApplicationContext::staging_ring`.
+   *
+   */
+  vk::DeviceSize staging_ring_size_bytes = 16 * 1024 * 1024;
+
+  /**
+   * @brief Size of the partition of a single frame in flight, see `VulkanApplicationContext::uniform_ring`.
+   *
+   */
+  vk::DeviceSize uniform_ring_frame_size_bytes = 1024 * 1024;
+
+  /**
+   * @brief See `Device::CreateInfo::pipeline_cache_path`. Relative paths are resolved against the working directory.
+   *
+   */
+  std::filesystem::path pipeline_cache_path = "pipeline_cache.bin";
+
+  /**
+   * @brief See `Device::CreateInfo::prefer_descriptor_buffer`.
+   *
+   */
+  bool prefer_descriptor_buffer = false;
+
+  /**
+   * @brief Size of the partition of a single frame in flight, see `VulkanApplicationContext::descriptor_buffer`.
+   *
+   */
+  vk::DeviceSize descriptor_buffer_frame_size_bytes = 1024 * 1024;
+
+  /**
+   * @brief Initial size of the arena of a single frame in flight, see `VulkanApplicationContext::frame_arena`. The
+   * arenas grow to the peak usage of the frames.
    *
    */
-  bool vsync = true;
+  size_t frame_arena_size_bytes = 256 * 1024;
+
+  /**
+   * @brief Capacities of the `VulkanApplicationContext::bindless_heap`.
+   *
+   */
+  BindlessHeap::CreateInfo bindless_heap;
+
+  /**
+   * @brief Renders the given number of frames as fast as possible, writes a report of the frame times and exits. The
+   * VSync and the low latency mode are disabled and the render graph profiling is enabled for the benchmark. Combined
+   * with `os::HeadlessWindowCreator` no window is shown. The `ERAY_BENCHMARK_FRAMES` and `ERAY_BENCHMARK_REPORT`
+   * environment variables override the frame count and the report path.
+   *
+   */
+  BenchmarkInfo benchmark;
+
+  /**
+   * @brief Records the input events, the frame time steps, the physics ticks and the framebuffer sizes of the run into
+   * the file, see `os::InputRecorder`. Empty disables the recording. The `ERAY_RECORD_INPUT` environment variable
+   * overrides it.
+   *
+   */
+  std::filesystem::path input_recording_path;
+
+  /**
+   * @brief Replays a recording of `input_recording_path`, the application exits once it ends. The frames advance the
+   * time by the recorded steps and run the recorded physics ticks, so that combined with the `benchmark` and
+   * `os::HeadlessWindowCreator` two builds render the exact same frames. The threaded physics, the threaded rendering
+   * and the on demand rendering are disabled. The `ERAY_REPLAY_INPUT` environment variable overrides it.
+   *
+   */
+  std::filesystem::path input_replay_path;
 };
 
 class VulkanApplication {
@@ -103,8 +440,9 @@ class VulkanApplication {
   void run();
 
   // Multiple frames are created in flight at once. Rendering of one frame does not interfere with the recording of
-  // the other. We choose the number 2, because we don't want the CPU to go to far ahead of the GPU.
-  static constexpr int kMaxFramesInFlight = 2;
+  // the other. By default 2 frames are used, because we don't want the CPU to go to far ahead of the GPU, see
+  // `VulkanApplicationCreateInfo::frames_in_flight`.
+  static constexpr uint32_t kMaxFramesInFlight = 3;
 
  protected:
   /**
@@ -144,12 +482,27 @@ class VulkanApplication {
   virtual void on_init() {}
 
   /**
-   * @brief Called on each physics update (synchronously) with fixed time step. To change time step use `set_tick_time`.
+   * @brief Called on a job system worker after `on_init()`, while the main loop already renders the frames with
+   * `is_loading()` set. Loads the assets the first frame does not need, e.g. reads the shader binaries and queues the
+   * pipelines to the `PipelineCompiler`, so the window shows up before they are ready. The state read by the frame
+   * callbacks must not be modified here, the loaded assets are handed over in `on_assets_loaded()`.
+   */
+  virtual void on_load_assets() {}
+
+  /**
+   * @brief Called on the frame thread before the first frame after `on_load_assets()` returns.
+   */
+  virtual void on_assets_loaded() {}
+
+  /**
+   * @brief Called on each physics update with fixed time step. To change time step use `set_tick_time`. Invoked on the
+   * physics thread when `VulkanApplicationCreateInfo::threaded_physics` is set, synchronously otherwise.
    */
   virtual void on_process_physics_generic(Duration /*delta*/) {}
 
   /**
-   * @brief Called on each physics update (synchronously) with fixed time step. To change time step use `set_tick_time`.
+   * @brief Called on each physics update with fixed time step. To change time step use `set_tick_time`. Invoked on the
+   * physics thread when `VulkanApplicationCreateInfo::threaded_physics` is set, synchronously otherwise.
    */
   virtual void on_process_physics(float /*delta*/) {}
 
@@ -179,7 +532,7 @@ class VulkanApplication {
    *
    * @warning Avoid doing heavy operations in this method as it stalls both CPU and GPU. This
    * method should be responsible only for uploading the data. If you need to perform some data calculations use
-   * `on_update()` instead.
+   * `on_update()` instead. Prefer a `FrameVersioned` resource updated in `on_frame_prepare()`, which does not stall.
    */
   virtual void on_frame_prepare_sync(Duration /*delta*/) {}
 
@@ -199,6 +552,22 @@ class VulkanApplication {
   virtual void on_record_graphics(vk::CommandBuffer /*graphics_command_buffer*/, uint32_t /*current_frame_in_flight*/) {
   }
 
+  /**
+   * @brief Invoked when an additional window (see `add_window()`) is rendered, after the main window in the same
+   * command buffer. The images of the render graph read here must be registered as the final pass dependencies, see
+   * `RenderGraph::emplace_final_pass_dependency()`. Windows that have no image ready skip the frame.
+   */
+  virtual void on_record_window(WindowTarget& /*target*/, vk::CommandBuffer /*graphics_command_buffer*/,
+                                uint32_t /*current_frame_in_flight*/) {}
+
+  /**
+   * @brief Invoked when the defragmentation (see `VmaAllocationManager::begin_defragmentation()`) moves buffers in the
+   * currently recorded frame. The handles of the buffers are already patched, the descriptor sets referring to the old
+   * buffers must be rewritten. Only the descriptor sets of the current frame in flight can be updated safely.
+   */
+  virtual void on_buffers_relocated(std::span<const BufferRelocation> /*relocations*/,
+                                    uint32_t /*current_frame_in_flight*/) {}
+
   /**
    * @brief Called after the main loop exits, before destruction.
    */
@@ -208,7 +577,61 @@ class VulkanApplication {
    * @brief Marks the frame data dirty. If the frame data dirty is marked as dirty the `on_frame_prepare_sync` will be
    * invoked for the current frame.
    */
-  void mark_frame_data_dirty() { frame_data_dirty_ = true; }
+  void mark_frame_data_dirty() {
+    frame_data_dirty_ = true;
+    request_frame();
+  }
+
+  /**
+   * @brief Requests a frame in the on demand rendering mode (see `VulkanApplicationCreateInfo::on_demand_rendering`)
+   * and wakes the idle loop. May be called on any thread, e.g. by a job that has finished loading an asset.
+   *
+   */
+  void request_frame();
+
+  /**
+   * @brief True until `on_assets_loaded()` is called. The draws of the assets that are still loading should be skipped.
+   * Must be called on the frame thread.
+   *
+   */
+  bool is_loading() const { return asset_loading_ != nullptr; }
+
+  /**
+   * @brief Progress in [0, 1] shown by the loading overlay, negative values show an indeterminate state. May be called
+   * by `on_load_assets()`.
+   *
+   */
+  void set_loading_progress(float progress);
+
+  /**
+   * @brief Opens an additional window rendered by the same device, the window is drawn in `on_record_window()`. A
+   * closed window is destroyed by the application. Returns nullptr on the headless device.
+   *
+   * @warning Must be called on the main thread before the main loop starts, i.e. in `on_init()`.
+   */
+  observer_ptr<WindowTarget> add_window(const os::WindowProperties& props,
+                                        PresentMode present_mode = PresentMode::Fifo);
+
+  /**
+   * @brief Switches the present mode of the main window. The swap chain is recreated by the next frame, nothing else.
+   *
+   */
+  void set_present_mode(PresentMode present_mode);
+  PresentMode present_mode() const { return create_info_.present_mode; }
+
+  /**
+   * @brief Frames per second the frames are capped at, 0 disables the cap, see
+   * `VulkanApplicationCreateInfo::frame_rate_cap`.
+   *
+   */
+  void set_frame_rate_cap(float frame_rate);
+
+  /**
+   * @brief The cap applied to the frames, i.e. the `frame_rate_cap` or the one derived from the refresh rate of the
+   * variable refresh rate display. 0 when the frames are not capped.
+   *
+   */
+  float frame_rate_cap() const { return frame_limiter_.frame_rate(); }
 
   /**
    * @brief Returns current frames per seconds.
@@ -220,15 +643,115 @@ class VulkanApplication {
    */
   std::uint16_t tps() const { return tps_; }
 
+  /**
+   * @brief Estimated time between the input sampling and the presentation of the frame. Measured only in the low
+   * latency mode, see `VulkanApplicationCreateInfo::low_latency`.
+   */
+  Duration input_latency() const { return input_latency_; }
+
+  /**
+   * @brief Number of the frames in flight, the per-frame resources should be created for each of them.
+   */
+  uint32_t frames_in_flight() const { return frames_in_flight_; }
+
+  /**
+   * @brief Frame in flight that is currently recorded, e.g. to select the per-frame resources in the pass callbacks.
+   */
+  uint32_t current_frame_in_flight() const { return current_frame_; }
+
+  /**
+   * @brief Draws an ImGui window with the GPU times of the render graph passes measured a few frames ago. Requires
+   * the `enable_render_graph_profiling` create info flag.
+   */
+  void show_render_graph_profiler(bool* open = nullptr);
+
+  /**
+   * @brief Draws an ImGui window with the budgets of the memory heaps and the device memory attributed to each of the
+   * `MemoryCategory` values. The live allocations and the allocations created since a checkpoint can be dumped to the
+   * log, see `VmaAllocationManager::dump_live_allocations()`.
+   */
+  void show_memory_statistics(bool* open = nullptr);
+
+  /**
+   * @brief Draws an ImGui window with the tree of the CPU profiling scopes of every thread and their times over the
+   * recent frames. Requires the `enable_cpu_profiling` create info flag.
+   */
+  void show_cpu_profiler(bool* open = nullptr);
+
+  /**
+   * @brief Draws an ImGui window with the per frame pipeline statistics of the passes and materials, the most
+   * expensive first, and a button that writes them as JSON. Requires the `enable_shader_cost_profiling` create info
+   * flag.
+   */
+  void show_shader_cost_report(bool* open = nullptr);
+
+  /**
+   * @brief Draws a compact overlay with the CPU frame time graph, the GPU times of the render graph passes, the draws,
+   * dispatches, barriers, descriptor allocations and staging bytes of the last frame (see `FrameStatistics`), the
+   * device-local memory against its budget and the pipeline cache hit rate. Drawn by the application after `on_imgui()`
+   * while it is visible, it costs nothing but the frame statistics counters while hidden.
+   */
+  void show_performance_hud(bool* open = nullptr);
+
+  void set_performance_hud_visible(bool visible) { performance_hud_visible_ = visible; }
+  bool is_performance_hud_visible() const { return performance_hud_visible_; }
+
+  /**
+   * @brief Returns true when the last rebuilt ImGui frame drew the same as the one before it, the frames are then
+   * rebuilt at the `VulkanApplicationCreateInfo::ui_refresh_rate_hz`.
+   *
+   */
+  bool is_imgui_frame_static() const { return imgui_frame_static_; }
+
+  /**
+   * @brief Captures the CPU profiling scopes, the GPU times of the render graph passes, the queue submissions and the
+   * frame waits of the next frames and writes them as a Chrome trace JSON for the Perfetto UI, see `TraceCapture`. The
+   * render graph profiling is enabled for the duration of the capture. Ignored while a capture is in progress.
+   */
+  void capture_trace(uint32_t frame_count, std::filesystem::path path);
+  bool is_capturing_trace() const { return trace_capture_.has_value(); }
+
+  /**
+   * @brief Starts capturing the swap chain images of the next frames, e.g. to record a video of the session, see
+   * `FrameCapture`. The images are copied at the end of every frame and handed to the `encoder` on the encoder thread a
+   * few frames later, the rendering is never blocked. The capture in progress is stopped first. Must be called on the
+   * thread that records the frames, e.g. from `on_frame_prepare()`.
+   *
+   * @param info The number of the buffers is raised to the number of the frames in flight plus one.
+   * @param encoder
+   * @return Result<void, Error> Fails with `PhysicalDeviceNotSufficient` when the swap chain images cannot be copied or
+   * their format is not supported by the `info.pixel_format`.
+   */
+  Result<void, Error> start_frame_capture(FrameCapture::CreateInfo info, FrameCapture::Encoder encoder);
+
+  /**
+   * @brief Waits until the frames in flight are captured and the encoder has processed all of them.
+   *
+   */
+  void stop_frame_capture();
+  bool is_capturing_frames() const { return frame_capture_.has_value(); }
+
   /**
    * @brief Returns time in seconds from start of the app.
    *
    * @warning Casting this value to float directly might produce numerical instability the older the application is.
    */
-  Duration time() const { return time_; }
+  Duration time() const {
+    return physics_thread_ ? Duration(physics_thread_->time.load(std::memory_order_relaxed)) : time_;
+  }
+
+  /**
+   * @brief With the threaded physics, the tick time must be set before the main loop starts.
+   */
   void set_tick_time(Duration tick_time) { tick_time_ = tick_time; }
   float tick_time() { return std::chrono::duration<float>(tick_time_).count(); }
 
+  /**
+   * @brief Fraction of the tick time elapsed since the last physics tick, in range [0, 1]. The rendered state should be
+   * interpolated between the last two physics states with this factor.
+   */
+  float physics_interpolation_alpha() const;
+
   VulkanApplicationContext& ctx() { return context_; }
   const VulkanApplicationContext& ctx() const { return context_; }
 
@@ -241,13 +764,32 @@ class VulkanApplication {
 
   Device& device() const { return *context_.device; }
   SwapChain& swap_chain() const { return *context_.swap_chain; }
-  os::InputManager& input() const { return *current_input_manager_; }
+  /**
+   * @brief Returns the physics input on the physics thread and in the physics callbacks, the frame input otherwise.
+   */
+  os::InputManager& input() const;
+
+  util::JobSystem& jobs() const { return *context_.job_system; }
 
   RenderGraph& render_graph() { return context_.render_graph; }
   const RenderGraph& render_graph() const { return context_.render_graph; }
 
   static constexpr Duration kDefaultTickTime = 16666us;  // 60 TPS = 16.6(6) ms/t
 
+  static constexpr uint32_t kDefaultEventPumpRateHz = 1000;
+
+  /**
+   * @brief Frames rendered after every change in the on demand rendering mode, so that the ImGui animations finish.
+   *
+   */
+  static constexpr uint32_t kOnDemandTrailingFrames = 3;
+
+  /**
+   * @brief Frames per second the variable refresh rate cap stays below the refresh rate of the monitor.
+   *
+   */
+  static constexpr uint32_t kVariableRefreshRateMargin = 3;
+
  private:
   void init_vk();
   void init_imgui();
@@ -255,6 +797,93 @@ class VulkanApplication {
   void main_loop();
   void render_frame(Duration delta);
 
+  /**
+   * @brief Waits for the frame rate cap. In the low latency mode also waits until the previous frame is displayed and
+   * then for the estimated slack of the frame. The slack grows while the frames are presented at the first vertical
+   * blank and shrinks when a frame misses it.
+   *
+   */
+  void pace_frame();
+
+  /**
+   * @brief Applies the frame rate cap of the create info, or the variable refresh rate cap.
+   *
+   */
+  void update_frame_limiter();
+
+  /**
+   * @brief Polls the window events, unless they are pumped by the main thread, see `run_event_loop()`.
+   *
+   */
+  void sample_input();
+
+  /**
+   * @brief Polls the window events. With the threaded physics also prepares the physics input manager, so that the
+   * next tick sees the new events. With the threaded rendering also starts the next ImGui platform frame.
+   *
+   */
+  void pump_events();
+
+  /**
+   * @brief In the on demand rendering mode blocks until a frame is requested, unless the frame follows a change.
+   *
+   * @return true The loop has been idle, the time spent waiting should not advance the application time.
+   */
+  bool wait_for_frame_request();
+  bool take_frame_request();
+
+  /**
+   * @brief Runs the `main_loop()` on the render thread and pumps the window events on the calling (main) thread until
+   * it finishes, see `VulkanApplicationCreateInfo::threaded_rendering`.
+   *
+   */
+  void run_event_loop();
+
+  /**
+   * @brief Starts, builds and renders the ImGui frame. With the threaded rendering the frame is built only when the
+   * main thread has started the platform frame and does not hold the ImGui context. A static frame is rebuilt at the
+   * `ui_refresh_rate_hz` only. Returns false when the previous frame is drawn again.
+   *
+   */
+  bool build_imgui_frame(Clock::duration delta);
+
+  /**
+   * @brief Returns true when the static ImGui frame does not need to be rebuilt yet.
+   *
+   */
+  bool can_reuse_imgui_frame(Clock::duration delta);
+
+  /**
+   * @brief Runs the `on_load_assets()` on a worker.
+   *
+   */
+  void start_asset_loading();
+
+  /**
+   * @brief Calls the `on_assets_loaded()` once the loading job is done.
+   *
+   */
+  void poll_asset_loading();
+
+  void show_loading_overlay() const;
+
+  /**
+   * @brief Sleeps until the `deadline`, sampling the input at the `input_sampling_rate_hz` in the meantime.
+   *
+   */
+  void sleep_sampling_input(Clock::time_point deadline);
+
+  void start_physics_thread();
+  void stop_physics_thread();
+  void physics_loop(const std::stop_token& stop_token);
+
+  /**
+   * @brief Reads back the queries of the `Device::query_pools()` and the shader cost profiler and resets the pools.
+   * Recorded into the first command buffer of the frame.
+   *
+   */
+  void begin_query_frame(vk::CommandBuffer cmd_buff, uint32_t frame_index);
+
   /**
    * @brief Writes the commands we what to execute into a command buffer
    *
@@ -262,8 +891,59 @@ class VulkanApplication {
    */
   void record_graphics_command_buffer(size_t frame_index, uint32_t image_index);
 
+  /**
+   * @brief Records the next defragmentation pass, if the defragmentation is in progress. Must be recorded after the
+   * uploads of the frame, so that the uploaded data is moved along with the buffers.
+   *
+   */
+  void record_defragmentation_pass(vk::CommandBuffer cmd_buff, uint32_t frame_index);
+
+  /**
+   * @brief Submits the render graph split between the graphics and the async compute queue, see
+   * `AsyncComputeCommandBuffers`.
+   *
+   * @param image_index
+   */
+  void submit_with_async_compute(uint32_t image_index);
+
+  /**
+   * @brief Acquires the images of the additional windows and destroys the windows that have been closed.
+   *
+   */
+  void acquire_window_targets();
+  void record_window_targets(const vk::raii::CommandBuffer& cmd_buff, uint32_t frame_index);
+  void present_window_targets();
+
   void destroy();
 
+  /**
+   * @brief Applies the benchmark and the input recording environment variables, see
+   * `VulkanApplicationCreateInfo::benchmark` and `VulkanApplicationCreateInfo::input_replay_path`.
+   *
+   */
+  void read_benchmark_env();
+
+  /**
+   * @brief Writes the trace and disables the render graph profiling if it was enabled by `capture_trace()`.
+   *
+   */
+  void finish_trace_capture();
+
+  /**
+   * @brief Opens the input recording or the replay. The replay overrides the tick time with the recorded one.
+   *
+   */
+  void init_input_recording();
+
+  /**
+   * @brief Feeds the events of the next replayed frame into the event ring and resizes the window to the recorded
+   * framebuffer size.
+   *
+   * @return nullptr There is no replay or it has ended.
+   */
+  const os::InputRecordingFrame* replay_input_frame();
+  void record_input_frame(Clock::duration delta, uint32_t tick_count);
+
   void create_swap_chain();
   void create_command_pool();
   void create_command_buffers();
@@ -281,6 +961,125 @@ class VulkanApplication {
   uint16_t frames_    = 0U;
   uint16_t ticks_     = 0U;
 
+  /**
+   * @brief CPU frame times of the performance HUD graph, `frame_time_index_` is the next one to be written.
+   *
+   */
+  static constexpr size_t kFrameTimeHistory = 240;
+  std::array<float, kFrameTimeHistory> frame_times_ms_{};
+  size_t frame_time_index_      = 0;
+  bool performance_hud_visible_ = false;
+
+  /**
+   * @brief Reuse of the static ImGui frames, see `VulkanApplicationCreateInfo::ui_refresh_rate_hz`. The skipped time is
+   * passed to the next rebuilt frame.
+   *
+   */
+  size_t imgui_draw_data_hash_ = 0;
+  bool imgui_frame_static_     = false;
+  Clock::duration imgui_skipped_time_{};
+  vk::Extent2D imgui_extent_{};
+
+  /**
+   * @brief State shared with the physics thread when `VulkanApplicationCreateInfo::threaded_physics` is set.
+   *
+   */
+  struct PhysicsThread {
+    /**
+     * @brief Guards the `physics_input_manager`, which is modified by the window events on the main thread.
+     *
+     */
+    std::mutex input_mutex;
+
+    /**
+     * @brief Copy of the physics input taken at the beginning of every tick. Read only by the physics thread.
+     *
+     */
+    std::unique_ptr<os::InputManager> tick_input;
+
+    std::atomic<Duration::rep> time        = 0;
+    std::atomic<Clock::rep> last_tick_time = 0;
+    std::atomic<uint16_t> ticks            = 0;
+
+    std::jthread thread;
+  };
+  std::unique_ptr<PhysicsThread> physics_thread_;
+
+  /**
+   * @brief State shared with the main thread when `VulkanApplicationCreateInfo::threaded_rendering` is set.
+   *
+   */
+  struct RenderThread {
+    /**
+     * @brief Guards the window event processing and the ImGui context, which is written by the ImGui GLFW callbacks on
+     * the main thread.
+     *
+     */
+    std::mutex platform_mutex;
+
+    /**
+     * @brief The main thread has started the ImGui platform frame, so the render thread may build the next ImGui frame.
+     * Guarded by the `platform_mutex`.
+     *
+     */
+    bool imgui_platform_frame = false;
+
+    /**
+     * @brief An ImGui frame has been rendered, so there is a previous frame to draw. Read only by the render thread.
+     *
+     */
+    bool has_imgui_frame = false;
+
+    /**
+     * @brief Windows of the closed window targets, GLFW allows destroying them on the main thread only. Guarded by the
+     * `platform_mutex`.
+     *
+     */
+    std::vector<std::shared_ptr<os::Window>> closed_windows;
+
+    std::atomic<bool> finished = false;
+    std::jthread thread;
+  };
+  std::unique_ptr<RenderThread> render_thread_;
+
+  // == Startup ========================================================================================================
+  /**
+   * @brief Read by a worker while the window is created, consumed by the `create_device()`.
+   *
+   */
+  std::optional<std::vector<char>> pipeline_cache_data_;
+
+  struct AssetLoading {
+    util::JobCounter counter;
+    std::atomic<float> progress = -1.F;
+  };
+
+  /**
+   * @brief Exists while the `on_load_assets()` runs and until the `on_assets_loaded()` is called.
+   *
+   */
+  std::unique_ptr<AssetLoading> asset_loading_;
+
+  // == On demand rendering ============================================================================================
+  struct FrameRequests {
+    std::mutex mutex;
+    std::condition_variable requested_cv;
+    bool requested = true;
+  };
+  std::unique_ptr<FrameRequests> frame_requests_ = std::make_unique<FrameRequests>();
+  uint32_t trailing_frames_                      = 0;
+
+  // == Frame rate cap =================================================================================================
+  util::FrameLimiter frame_limiter_;
+
+  // == Low latency mode ===============================================================================================
+  uint64_t present_id_       = 0;
+  Duration refresh_interval_ = 0ns;
+  Duration frame_delay_      = 0ns;
+  Duration input_latency_    = 0ns;
+  Clock::time_point input_sample_time_;
+  Clock::time_point present_time_;
+
   /**
    * @brief Command pools manage the memory that is used to store the buffers and command buffers are allocated from
    * them.
@@ -290,15 +1089,34 @@ class VulkanApplication {
 
   uint32_t current_semaphore_ = 0;
   uint32_t current_frame_     = 0;
+  uint32_t frames_in_flight_  = 0;
 
   /**
    * @brief Drawing operations are recorded in command buffer objects.
    *
    */
-  std::array<vk::raii::CommandBuffer, kMaxFramesInFlight> graphics_command_buffers_ = {nullptr, nullptr};
+  std::vector<vk::raii::CommandBuffer> graphics_command_buffers_;
 
   /**
-   * @brief Semaphores are used to assert on GPU that a process e.g. rendering is finished.
+   * @brief Used only when the device exposes a dedicated compute queue family. The render graph splits the graphics
+   * work into the passes recorded before and after the async compute results are awaited.
+   *
+   */
+  vk::raii::CommandPool async_compute_command_pool_ = nullptr;
+
+  std::vector<vk::raii::CommandBuffer> ownership_release_command_buffers_;
+  std::vector<vk::raii::CommandBuffer> async_compute_command_buffers_;
+  std::vector<vk::raii::CommandBuffer> after_async_compute_command_buffers_;
+
+  /**
+   * @brief Timeline semaphore signaled with the frame number by the ownership release submission. The async compute
+   * submission signals the compute timeline of the `FrameTimeline`.
+   *
+   */
+  vk::raii::Semaphore ownership_release_semaphore_ = nullptr;
+
+  /**
+   * @brief Binary semaphores of the presentation engine, which does not accept the timeline semaphores.
    *
    */
   std::vector<vk::raii::Semaphore> acquire_image_semaphores_;
@@ -307,16 +1125,50 @@ class VulkanApplication {
   std::vector<vk::PipelineStageFlags> submit_stage_masks_;
 
   /**
-   * @brief Fences are used to block GPU until the frame is presented.
+   * @brief Wait for the upload batches acquired by the currently recorded frame.
+   *
+   */
+  std::optional<vk::SemaphoreSubmitInfo> upload_wait_;
+
+  /**
+   * @brief Frame in flight that recorded the pending defragmentation pass.
    *
    */
-  std::array<vk::raii::Fence, kMaxFramesInFlight> record_fences_ = {nullptr, nullptr};
+  uint32_t defragmentation_frame_ = 0;
 
   vk::DescriptorSetLayout dsl_;
   vk::raii::DescriptorPool imgui_descriptor_pool_ = nullptr;
 
   VulkanApplicationCreateInfo create_info_;
 
+  /**
+   * @brief Present only when the `VulkanApplicationCreateInfo::benchmark` is enabled.
+   *
+   */
+  std::optional<FrameBenchmark> benchmark_;
+
+  /**
+   * @brief Present while a trace is captured, see `capture_trace()`.
+   *
+   */
+  std::optional<TraceCapture> trace_capture_;
+  bool trace_capture_enabled_profiling_ = false;
+
+  /**
+   * @brief Present while the frames are captured, see `start_frame_capture()`.
+   *
+   */
+  std::optional<FrameCapture> frame_capture_;
+
+  std::unique_ptr<os::InputRecorder> input_recorder_;
+  std::optional<os::InputReplay> input_replay_;
+
+  /**
+   * @brief Set in the memory statistics window, to find the allocations that have not been released since.
+   *
+   */
+  std::optional<AllocationCheckpoint> allocation_checkpoint_;
+
   DeletionQueue deletion_queue_;
 
   os::InputManager* current_input_manager_ = nullptr;
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/benchmark.hpp>
+#include <numeric>
+#include <ranges>
+#include <string_view>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+double to_ms(FrameBenchmark::Duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); }
+
+std::string escape_json(std::string_view str) {
+  auto result = std::string();
+  result.reserve(str.size());
+  for (const auto c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+std::string statistics_json(const BenchmarkStatistics& stats) {
+  return std::format(
+      R"({{"samples": {}, "mean": {:.4f}, "min": {:.4f}, "p50": {:.4f}, "p95": {:.4f}, "p99": {:.4f}, "max": {:.4f}}})",
+      stats.sample_count, stats.mean_ms, stats.min_ms, stats.p50_ms, stats.p95_ms, stats.p99_ms, stats.max_ms);
+}
+
+std::string samples_json(const std::vector<double>& samples_ms) {
+  auto result = std::string("[");
+  for (const auto& [i, sample] : std::views::enumerate(samples_ms)) {
+    result += std::format("{}{:.4f}", i == 0 ? "" : ", ", sample);
+  }
+  result += ']';
+  return result;
+}
+
+}  // namespace
+
+BenchmarkStatistics BenchmarkStatistics::compute(std::vector<double> samples_ms) {
+  if (samples_ms.empty()) {
+    return {};
+  }
+  std::ranges::sort(samples_ms);
+
+  // Nearest-rank percentiles
+  const auto percentile = [&samples_ms](double p) {
+    const auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(samples_ms.size())));
+    return samples_ms[std::clamp<size_t>(rank, 1, samples_ms.size()) - 1];
+  };
+
+  const auto sum = std::accumulate(samples_ms.begin(), samples_ms.end(), 0.0);
+  return BenchmarkStatistics{
+      .sample_count = samples_ms.size(),
+      .mean_ms      = sum / static_cast<double>(samples_ms.size()),
+      .min_ms       = samples_ms.front(),
+      .p50_ms       = percentile(50.0),
+      .p95_ms       = percentile(95.0),
+      .p99_ms       = percentile(99.0),
+      .max_ms       = samples_ms.back(),
+  };
+}
+
+Result<FrameBenchmark, Error> FrameBenchmark::create(const Device& device, const BenchmarkInfo& info,
+                                                     uint32_t frames_in_flight) {
+  auto benchmark         = FrameBenchmark(nullptr);
+  benchmark.info_        = info;
+  const auto props       = device.physical_device().getProperties();
+  benchmark.device_name_ = std::string(std::string_view(props.deviceName));
+  benchmark.cpu_frame_times_ms_.reserve(info.frame_count);
+  benchmark.gpu_frame_times_ms_.reserve(info.frame_count);
+
+  const auto queue_families = device.physical_device().getQueueFamilyProperties();
+  const auto valid_bits     = queue_families[device.graphics_queue_family()].timestampValidBits;
+  if (valid_bits == 0) {
+    util::Logger::warn("Graphics queue does not support timestamps, the GPU frame times are not measured");
+    return benchmark;
+  }
+
+  benchmark.timestamp_period_ns_ = props.limits.timestampPeriod;
+  benchmark.timestamp_mask_      = valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << valid_bits) - 1;
+  benchmark.frame_queries_.resize(frames_in_flight);
+  for (auto& queries : benchmark.frame_queries_) {
+    const auto query_pool_info = vk::QueryPoolCreateInfo{
+        .queryType  = vk::QueryType::eTimestamp,
+        .queryCount = 2,
+    };
+    if (auto result = device->createQueryPool(query_pool_info)) {
+      queries.timestamps = std::move(*result);
+    } else {
+      util::Logger::err("Could not create the benchmark timestamp query pool. {}", vk::to_string(result.error()));
+      return std::unexpected(Error{
+          .msg     = "Benchmark query pool creation failure",
+          .code    = ErrorCode::VulkanObjectCreationFailure{},
+          .vk_code = result.error(),
+      });
+    }
+  }
+
+  return benchmark;
+}
+
+void FrameBenchmark::begin_frame(uint32_t frame_index) {
+  if (frame_queries_.empty()) {
+    return;
+  }
+
+  auto& queries = frame_queries_[frame_index];
+  if (!queries.frame || !is_measured(*queries.frame)) {
+    return;
+  }
+
+  // The frame has finished already, the results are available without waiting
+  auto [result, timestamps] = queries.timestamps.getResults<uint64_t>(0, 2, 2 * sizeof(uint64_t), sizeof(uint64_t),
+                                                                        vk::QueryResultFlagBits::e64);
+  if (result == vk::Result::eSuccess) {
+    // The subtraction wraps around with the counter
+    const auto ticks = (timestamps[1] - timestamps[0]) & timestamp_mask_;
+    gpu_frame_times_ms_.push_back(static_cast<double>(ticks) * timestamp_period_ns_ / 1e6);
+  }
+  queries.frame = std::nullopt;
+}
+
+void FrameBenchmark::write_frame_begin(vk::CommandBuffer cmd_buff, uint32_t frame_index) {
+  if (frame_queries_.empty()) {
+    return;
+  }
+
+  auto& queries = frame_queries_[frame_index];
+  cmd_buff.resetQueryPool(*queries.timestamps, 0, 2);
+  cmd_buff.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *queries.timestamps, 0);
+  queries.frame = frame_;
+}
+
+void FrameBenchmark::write_frame_end(vk::CommandBuffer cmd_buff, uint32_t frame_index) {
+  if (frame_queries_.empty()) {
+    return;
+  }
+
+  cmd_buff.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, *frame_queries_[frame_index].timestamps, 1);
+}
+
+void FrameBenchmark::end_frame(Duration cpu_time, const RenderGraph& render_graph) {
+  if (!is_measured(frame_++)) {
+    return;
+  }
+
+  cpu_frame_times_ms_.push_back(to_ms(cpu_time));
+  for (const auto& result : render_graph.profiling_results()) {
+    auto name = render_graph.pass_name(result.pass_index);
+    auto it   = std::ranges::find(pass_samples_, name, &PassSamples::name);
+    if (it == pass_samples_.end()) {
+      pass_samples_.push_back(PassSamples{.name = std::move(name), .gpu_times_ms = {}});
+      it = std::prev(pass_samples_.end());
+    }
+    it->gpu_times_ms.push_back(result.gpu_time_ms);
+  }
+}
+
+Result<void, Error> FrameBenchmark::write_report() const {
+  auto file = std::ofstream(info_.report_path, std::ios::trunc);
+  if (!file) {
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not open the benchmark report "{}")", info_.report_path.string()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  file << "{\n";
+  file << std::format("  \"device\": \"{}\",\n", escape_json(device_name_));
+  file << std::format("  \"frames\": {},\n", cpu_frame_times_ms_.size());
+  file << std::format("  \"warmup_frames\": {},\n", info_.warmup_frame_count);
+  file << std::format("  \"cpu_frame_ms\": {},\n", statistics_json(BenchmarkStatistics::compute(cpu_frame_times_ms_)));
+  if (frame_queries_.empty()) {
+    file << "  \"gpu_frame_ms\": null,\n";
+  } else {
+    file << std::format("  \"gpu_frame_ms\": {},\n",
+                        statistics_json(BenchmarkStatistics::compute(gpu_frame_times_ms_)));
+  }
+  file << std::format("  \"cpu_frame_times_ms\": {},\n", samples_json(cpu_frame_times_ms_));
+  file << std::format("  \"gpu_frame_times_ms\": {},\n", samples_json(gpu_frame_times_ms_));
+  file << "  \"passes\": [";
+  for (const auto& [i, pass] : std::views::enumerate(pass_samples_)) {
+    file << std::format("{}\n    {{\"name\": \"{}\", \"gpu_ms\": {}}}", i == 0 ? "" : ",", escape_json(pass.name),
+                        statistics_json(BenchmarkStatistics::compute(pass.gpu_times_ms)));
+  }
+  file << (pass_samples_.empty() ? "]\n" : "\n  ]\n");
+  file << "}\n";
+
+  if (!file) {
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not write the benchmark report "{}")", info_.report_path.string()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  util::Logger::succ(R"(Benchmark report of {} frames written to "{}")", cpu_frame_times_ms_.size(),
+                     info_.report_path.string());
+  return {};
+}
+
+}  // namespace eray::vkren
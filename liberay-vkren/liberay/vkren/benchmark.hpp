@@ -0,0 +1,164 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/render_graph.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+struct BenchmarkInfo {
+  /**
+   * @brief Number of the measured frames, the application exits after them. 0 disables the benchmark.
+   *
+   */
+  uint32_t frame_count = 0;
+
+  /**
+   * @brief Number of the frames rendered before the measurements start, so that the pipelines are compiled and the
+   * resources are uploaded.
+   *
+   */
+  uint32_t warmup_frame_count = 60;
+
+  /**
+   * @brief JSON file the report is written to. Relative paths are resolved against the working directory.
+   *
+   */
+  std::filesystem::path report_path = "benchmark.json";
+};
+
+/**
+ * @brief Percentiles of the samples in milliseconds.
+ *
+ */
+struct BenchmarkStatistics {
+  size_t sample_count = 0;
+  double mean_ms      = 0.0;
+  double min_ms       = 0.0;
+  double p50_ms       = 0.0;
+  double p95_ms       = 0.0;
+  double p99_ms       = 0.0;
+  double max_ms       = 0.0;
+
+  static BenchmarkStatistics compute(std::vector<double> samples_ms);
+};
+
+/**
+ * @brief Collects the CPU frame times, the GPU frame times and the GPU times of the render graph passes and writes
+ * them as a JSON report. The GPU frame time is measured with the timestamps written at the beginning of the first and
+ * at the end of the last command buffer of the frame. The pass times are taken from the render graph profiling.
+ *
+ * The report lists the frame times of every measured frame as well, so that two runs replaying the same input (see
+ * `os::InputReplay`) can be compared frame by frame.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class FrameBenchmark {
+ public:
+  using Duration = std::chrono::nanoseconds;
+
+  FrameBenchmark() = delete;
+  explicit FrameBenchmark(std::nullptr_t) {}
+
+  FrameBenchmark(const FrameBenchmark&)                = delete;
+  FrameBenchmark& operator=(const FrameBenchmark&)     = delete;
+  FrameBenchmark(FrameBenchmark&&) noexcept            = default;
+  FrameBenchmark& operator=(FrameBenchmark&&) noexcept = default;
+
+  /**
+   * @brief Creates the timestamp queries of every frame in flight. When the graphics queue does not support the
+   * timestamps, only the CPU frame times and the pass times are reported.
+   *
+   * @param device
+   * @param info
+   * @param frames_in_flight
+   * @return Result<FrameBenchmark, Error>
+   */
+  [[nodiscard]] static Result<FrameBenchmark, Error> create(const Device& device, const BenchmarkInfo& info,
+                                                            uint32_t frames_in_flight);
+
+  /**
+   * @brief Reads back the GPU frame time of the previous use of the frame in flight. Must be called after that frame
+   * is waited for.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Resets the queries of the frame and writes the first timestamp. Must be recorded into the first command
+   * buffer of the frame submitted to the graphics queue.
+   *
+   */
+  void write_frame_begin(vk::CommandBuffer cmd_buff, uint32_t frame_index);
+
+  /**
+   * @brief Writes the second timestamp. Must be recorded into the last command buffer of the frame submitted to the
+   * graphics queue.
+   *
+   */
+  void write_frame_end(vk::CommandBuffer cmd_buff, uint32_t frame_index);
+
+  /**
+   * @brief Records the CPU time of the frame and the latest pass times of the render graph.
+   *
+   * @param cpu_time Time between the beginnings of two consecutive frames.
+   * @param render_graph
+   */
+  void end_frame(Duration cpu_time, const RenderGraph& render_graph);
+
+  /**
+   * @brief True once all of the `BenchmarkInfo::frame_count` frames have been measured.
+   *
+   */
+  bool is_finished() const { return cpu_frame_times_ms_.size() >= info_.frame_count; }
+
+  /**
+   * @brief Writes the report to the `BenchmarkInfo::report_path`.
+   *
+   * @return Result<void, Error>
+   */
+  Result<void, Error> write_report() const;
+
+ private:
+  struct FrameQueries {
+    vk::raii::QueryPool timestamps = nullptr;
+
+    /**
+     * @brief Index of the benchmark frame the queries were written by.
+     *
+     */
+    std::optional<uint32_t> frame;
+  };
+
+  struct PassSamples {
+    std::string name;
+    std::vector<double> gpu_times_ms;
+  };
+
+  bool is_measured(uint32_t frame) const { return frame >= info_.warmup_frame_count; }
+
+  BenchmarkInfo info_;
+  std::string device_name_;
+
+  std::vector<FrameQueries> frame_queries_;
+  double timestamp_period_ns_ = 0.0;
+  uint64_t timestamp_mask_    = 0;
+
+  uint32_t frame_ = 0;
+  std::vector<double> cpu_frame_times_ms_;
+  std::vector<double> gpu_frame_times_ms_;
+  std::vector<PassSamples> pass_samples_;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cassert>
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/bindless_heap.hpp>
+#include <liberay/vkren/error.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+constexpr auto kArrayCount = static_cast<size_t>(BindlessArray::_Count);
+
+constexpr auto kDescriptorTypes = std::array<vk::DescriptorType, kArrayCount>{
+    vk::DescriptorType::eSampledImage,
+    vk::DescriptorType::eStorageBuffer,
+    vk::DescriptorType::eSampler,
+};
+
+}  // namespace
+
+Result<BindlessHeap, Error> BindlessHeap::create(Device& device, const CreateInfo& info, uint32_t frames_in_flight) {
+  assert(frames_in_flight > 0 && "There must be at least one frame in flight");
+
+  // == Capacities =====================================================================================================
+  auto props = device.physical_device()
+                   .getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>()
+                   .get<vk::PhysicalDeviceVulkan12Properties>();
+
+  auto capacities = std::array<uint32_t, kArrayCount>{
+      std::min(info.max_sampled_images, props.maxDescriptorSetUpdateAfterBindSampledImages),
+      std::min(info.max_storage_buffers, props.maxDescriptorSetUpdateAfterBindStorageBuffers),
+      std::min(info.max_samplers, props.maxDescriptorSetUpdateAfterBindSamplers),
+  };
+  if (capacities[0] < info.max_sampled_images || capacities[1] < info.max_storage_buffers ||
+      capacities[2] < info.max_samplers) {
+    util::Logger::warn("Bindless heap capacities clamped to the device limits: {} sampled images, {} storage buffers, "
+                       "{} samplers",
+                       capacities[0], capacities[1], capacities[2]);
+  }
+
+  // == Layout =========================================================================================================
+  auto bindings      = std::array<vk::DescriptorSetLayoutBinding, kArrayCount>{};
+  auto binding_flags = std::array<vk::DescriptorBindingFlags, kArrayCount>{};
+  for (auto i = 0U; i < kArrayCount; ++i) {
+    bindings[i] = vk::DescriptorSetLayoutBinding{
+        .binding         = i,
+        .descriptorType  = kDescriptorTypes[i],
+        .descriptorCount = capacities[i],
+        .stageFlags      = info.stage_flags,
+    };
+    // The unused array elements are never accessed, the elements might be updated while the set is bound by the
+    // frames in flight
+    binding_flags[i] = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind;
+  }
+
+  auto binding_flags_info = vk::DescriptorSetLayoutBindingFlagsCreateInfo{
+      .bindingCount  = static_cast<uint32_t>(binding_flags.size()),
+      .pBindingFlags = binding_flags.data(),
+  };
+  auto layout_info = vk::DescriptorSetLayoutCreateInfo{
+      .pNext        = &binding_flags_info,
+      .flags        = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+      .bindingCount = static_cast<uint32_t>(bindings.size()),
+      .pBindings    = bindings.data(),
+  };
+
+  auto layout_opt = device->createDescriptorSetLayout(layout_info);
+  if (!layout_opt) {
+    return std::unexpected(Error{
+        .msg     = "Bindless Descriptor Set Layout creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = layout_opt.error(),
+    });
+  }
+
+  // == Pool and Set ===================================================================================================
+  auto pool_sizes = std::array<vk::DescriptorPoolSize, kArrayCount>{};
+  for (auto i = 0U; i < kArrayCount; ++i) {
+    pool_sizes[i] = vk::DescriptorPoolSize{
+        .type            = kDescriptorTypes[i],
+        .descriptorCount = capacities[i],
+    };
+  }
+
+  auto pool_info = vk::DescriptorPoolCreateInfo{
+      .flags         = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+      .maxSets       = 1,
+      .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+      .pPoolSizes    = pool_sizes.data(),
+  };
+
+  auto pool_opt = device->createDescriptorPool(pool_info);
+  if (!pool_opt) {
+    return std::unexpected(Error{
+        .msg     = "Bindless Descriptor Pool creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = pool_opt.error(),
+    });
+  }
+
+  auto vk_layout  = vk::DescriptorSetLayout{*layout_opt};
+  auto alloc_info = vk::DescriptorSetAllocateInfo{
+      .descriptorPool     = *pool_opt,
+      .descriptorSetCount = 1,
+      .pSetLayouts        = &vk_layout,
+  };
+
+  // The set is freed with the pool, which has no VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+  auto descriptor_set = vk::DescriptorSet{};
+  if (auto result = vk::Device{**device}.allocateDescriptorSets(&alloc_info, &descriptor_set);
+      result != vk::Result::eSuccess) {
+    return std::unexpected(Error{
+        .msg     = "Bindless Descriptor Set allocation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = result,
+    });
+  }
+
+  auto arrays = std::array<Array, kArrayCount>{};
+  for (auto i = 0U; i < kArrayCount; ++i) {
+    arrays[i].capacity = capacities[i];
+    arrays[i].retired_indices.resize(frames_in_flight);
+  }
+
+  return BindlessHeap(device, std::move(*layout_opt), std::move(*pool_opt), descriptor_set, std::move(arrays));
+}
+
+Result<BindlessIndex, Error> BindlessHeap::register_sampled_image(vk::ImageView image_view, vk::ImageLayout layout) {
+  auto index = acquire(BindlessArray::SampledImage);
+  if (index) {
+    update_sampled_image(*index, image_view, layout);
+  }
+  return index;
+}
+
+Result<BindlessIndex, Error> BindlessHeap::register_storage_buffer(vk::DescriptorBufferInfo buffer_info) {
+  auto index = acquire(BindlessArray::StorageBuffer);
+  if (index) {
+    update_storage_buffer(*index, buffer_info);
+  }
+  return index;
+}
+
+Result<BindlessIndex, Error> BindlessHeap::register_sampler(vk::Sampler sampler) {
+  auto index = acquire(BindlessArray::Sampler);
+  if (index) {
+    auto image_info = vk::DescriptorImageInfo{.sampler = sampler};
+    write(BindlessArray::Sampler, *index, &image_info, nullptr);
+  }
+  return index;
+}
+
+void BindlessHeap::update_sampled_image(BindlessIndex index, vk::ImageView image_view, vk::ImageLayout layout) {
+  auto image_info = vk::DescriptorImageInfo{
+      .imageView   = image_view,
+      .imageLayout = layout,
+  };
+  write(BindlessArray::SampledImage, index, &image_info, nullptr);
+}
+
+void BindlessHeap::update_storage_buffer(BindlessIndex index, vk::DescriptorBufferInfo buffer_info) {
+  write(BindlessArray::StorageBuffer, index, nullptr, &buffer_info);
+}
+
+void BindlessHeap::release(BindlessArray array, BindlessIndex index) {
+  if (!index.is_valid()) {
+    return;
+  }
+
+  auto& arr = arrays_[static_cast<size_t>(array)];
+  assert(index.value < arr.high_water_mark && "Index has not been registered");
+  arr.retired_indices[current_frame_].push_back(index.value);
+}
+
+void BindlessHeap::begin_frame(uint32_t frame_index) {
+  current_frame_ = frame_index;
+  for (auto& arr : arrays_) {
+    auto& retired = arr.retired_indices[frame_index];
+    arr.free_indices.insert(arr.free_indices.end(), retired.begin(), retired.end());
+    retired.clear();
+  }
+}
+
+void BindlessHeap::bind(vk::CommandBuffer cmd_buff, vk::PipelineBindPoint bind_point,
+                        vk::PipelineLayout pipeline_layout, uint32_t set) const {
+  cmd_buff.bindDescriptorSets(bind_point, pipeline_layout, set, descriptor_set_, nullptr);
+}
+
+uint32_t BindlessHeap::used_count(BindlessArray array) const {
+  const auto& arr    = arrays_[static_cast<size_t>(array)];
+  auto retired_count = size_t{0};
+  for (const auto& retired : arr.retired_indices) {
+    retired_count += retired.size();
+  }
+  return arr.high_water_mark - static_cast<uint32_t>(arr.free_indices.size() + retired_count);
+}
+
+Result<BindlessIndex, Error> BindlessHeap::acquire(BindlessArray array) {
+  auto& arr = arrays_[static_cast<size_t>(array)];
+  if (!arr.free_indices.empty()) {
+    auto index = arr.free_indices.back();
+    arr.free_indices.pop_back();
+    return BindlessIndex{.value = index};
+  }
+
+  if (arr.high_water_mark >= arr.capacity) {
+    util::Logger::warn("Bindless heap array {} is full ({} descriptors)", static_cast<uint32_t>(array), arr.capacity);
+    return std::unexpected(Error{
+        .msg  = "Bindless heap array is full",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  return BindlessIndex{.value = arr.high_water_mark++};
+}
+
+void BindlessHeap::write(BindlessArray array, BindlessIndex index, const vk::DescriptorImageInfo* image_info,
+                         const vk::DescriptorBufferInfo* buffer_info) const {
+  assert(index.is_valid() && index.value < capacity(array) && "Bindless index out of bounds");
+
+  auto descriptor_write = vk::WriteDescriptorSet{
+      .dstSet          = descriptor_set_,
+      .dstBinding      = static_cast<uint32_t>(array),
+      .dstArrayElement = index.value,
+      .descriptorCount = 1,
+      .descriptorType  = kDescriptorTypes[static_cast<size_t>(array)],
+      .pImageInfo      = image_info,
+      .pBufferInfo     = buffer_info,
+  };
+  (*p_device_)->updateDescriptorSets(descriptor_write, nullptr);
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Arrays of the bindless heap. The value is the binding number of the array in the heap descriptor set.
+ *
+ */
+enum class BindlessArray : uint8_t {
+  SampledImage  = 0,
+  StorageBuffer = 1,
+  Sampler       = 2,
+  _Count        = 3,
+};
+
+/**
+ * @brief Stable 32-bit index of a resource in a bindless heap array. Shaders receive it, e.g. via push constants.
+ *
+ */
+struct BindlessIndex {
+  static constexpr uint32_t kInvalid = UINT32_MAX;
+
+  uint32_t value = kInvalid;
+
+  bool is_valid() const { return value != kInvalid; }
+  bool operator==(const BindlessIndex&) const = default;
+};
+
+/**
+ * @brief Single global descriptor set with large UPDATE_AFTER_BIND | PARTIALLY_BOUND arrays of sampled images (binding
+ * 0), storage buffers (binding 1) and samplers (binding 2). The resources are registered once and addressed by their
+ * indices, so a draw only updates the push constants instead of binding a descriptor set per material.
+ *
+ * The descriptor indexing features are required by the VP_KHR_roadmap_2022 profile the device is created with.
+ *
+ * Indices are recycled with a delay, a `release()`d index is reused only once the frame that released it has finished,
+ * see `begin_frame()`.
+ *
+ * @warning Lifetime is bound by the device lifetime. The registered resources must outlive their registration.
+ *
+ */
+class BindlessHeap {
+ public:
+  BindlessHeap() = delete;
+  explicit BindlessHeap(std::nullptr_t) {}
+
+  struct CreateInfo {
+    uint32_t max_sampled_images  = 16 * 1024;
+    uint32_t max_storage_buffers = 4 * 1024;
+    uint32_t max_samplers        = 64;
+
+    /**
+     * @brief Stages that read the heap.
+     *
+     */
+    vk::ShaderStageFlags stage_flags = vk::ShaderStageFlagBits::eAllGraphics | vk::ShaderStageFlagBits::eCompute;
+  };
+
+  /**
+   * @brief Creates the layout, the pool and the descriptor set of the heap. The capacities are clamped to the
+   * update-after-bind limits of the device.
+   *
+   * @param device
+   * @param info
+   * @param frames_in_flight
+   * @return Result<BindlessHeap, Error>
+   */
+  [[nodiscard]] static Result<BindlessHeap, Error> create(Device& device, const CreateInfo& info,
+                                                          uint32_t frames_in_flight);
+
+  /**
+   * @brief Writes the image view to a free slot of the sampled image array.
+   *
+   * @param image_view
+   * @param layout Layout of the image whenever a shader might read it.
+   * @return Result<BindlessIndex, Error> Fails with `MemoryAllocationFailure` when the array is full.
+   */
+  Result<BindlessIndex, Error> register_sampled_image(vk::ImageView image_view,
+                                                      vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+  Result<BindlessIndex, Error> register_storage_buffer(vk::DescriptorBufferInfo buffer_info);
+  Result<BindlessIndex, Error> register_sampler(vk::Sampler sampler);
+
+  /**
+   * @brief Rewrites the descriptor of a registered resource, e.g. after the image has been recreated. Frames in flight
+   * might still read the previous descriptor, which is allowed by UPDATE_AFTER_BIND as long as the previous resource is
+   * kept alive until they finish.
+   *
+   */
+  void update_sampled_image(BindlessIndex index, vk::ImageView image_view,
+                            vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+  void update_storage_buffer(BindlessIndex index, vk::DescriptorBufferInfo buffer_info);
+
+  /**
+   * @brief Returns the index to the array once the current frame has finished.
+   *
+   * @param array
+   * @param index
+   */
+  void release(BindlessArray array, BindlessIndex index);
+
+  /**
+   * @brief Recycles the indices released by the previous submission of the frame. Call after the fence of the frame
+   * has been waited for.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Binds the heap descriptor set.
+   *
+   * @param cmd_buff
+   * @param bind_point
+   * @param pipeline_layout Must include `layout()` at the `set` index.
+   * @param set
+   */
+  void bind(vk::CommandBuffer cmd_buff, vk::PipelineBindPoint bind_point, vk::PipelineLayout pipeline_layout,
+            uint32_t set = 0) const;
+
+  vk::DescriptorSetLayout layout() const { return *layout_; }
+  vk::DescriptorSet descriptor_set() const { return descriptor_set_; }
+  uint32_t capacity(BindlessArray array) const { return arrays_[static_cast<size_t>(array)].capacity; }
+  uint32_t used_count(BindlessArray array) const;
+
+ private:
+  struct Array {
+    uint32_t capacity = 0;
+
+    /**
+     * @brief Indices below it have been handed out at least once.
+     *
+     */
+    uint32_t high_water_mark = 0;
+    std::vector<uint32_t> free_indices;
+
+    /**
+     * @brief Indices released during each frame in flight.
+     *
+     */
+    std::vector<std::vector<uint32_t>> retired_indices;
+  };
+
+  BindlessHeap(Device& device, vk::raii::DescriptorSetLayout&& layout, vk::raii::DescriptorPool&& pool,
+               vk::DescriptorSet descriptor_set, std::array<Array, static_cast<size_t>(BindlessArray::_Count)>&& arrays)
+      : p_device_(&device),
+        layout_(std::move(layout)),
+        pool_(std::move(pool)),
+        descriptor_set_(descriptor_set),
+        arrays_(std::move(arrays)) {}
+
+  Result<BindlessIndex, Error> acquire(BindlessArray array);
+  void write(BindlessArray array, BindlessIndex index, const vk::DescriptorImageInfo* image_info,
+             const vk::DescriptorBufferInfo* buffer_info) const;
+
+  observer_ptr<Device> p_device_         = nullptr;
+  vk::raii::DescriptorSetLayout layout_  = nullptr;
+  vk::raii::DescriptorPool pool_         = nullptr;
+  vk::DescriptorSet descriptor_set_      = nullptr;
+  std::array<Array, static_cast<size_t>(BindlessArray::_Count)> arrays_;
+  uint32_t current_frame_ = 0;
+};
+
+}  // namespace eray::vkren
@@ -11,6 +11,7 @@
 #include <liberay/vkren/vma_allocation_manager.hpp>
 #include <liberay/vkren/vma_raii_object.hpp>
 #include <optional>
+#include <source_location>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_raii.hpp>
@@ -82,6 +83,7 @@ Result<ExclusiveBufferResource, Error> ExclusiveBufferResource::create_staging(c
     return std::unexpected(staging_buff_opt.error());
   }
   staging_buff_opt->fill_data(src_region, 0);
+  device.statistics().count_staging_bytes(src_region.size_bytes());
   return std::move(*staging_buff_opt);
 }
 
@@ -130,7 +132,8 @@ void ExclusiveBufferResource::copy_from(const vk::raii::Buffer& src_buff, vk::Bu
 }
 
 Result<BufferResource, Error> BufferResource::create_staging_buffer(Device& device,
-                                                                    const util::MemoryRegion& src_region) {
+                                                                    const util::MemoryRegion& src_region,
+                                                                    const std::source_location& location) {
   auto buf_create_info = vk::BufferCreateInfo{
       .sType = vk::StructureType::eBufferCreateInfo,
       .size  = src_region.size_bytes(),
@@ -141,13 +144,14 @@ Result<BufferResource, Error> BufferResource::create_staging_buffer(Device& devi
   alloc_create_info.usage                   = VMA_MEMORY_USAGE_AUTO;
   alloc_create_info.flags                   = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
 
-  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info);
+  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, location);
   if (!buff_opt) {
-    std::unexpected(buff_opt.error());
+    return std::unexpected(buff_opt.error());
   }
 
   vmaCopyMemoryToAllocation(device.vma_alloc_manager().allocator(), src_region.data(), buff_opt->allocation, 0,
                             src_region.size_bytes());
+  device.statistics().count_staging_bytes(src_region.size_bytes());
 
   return BufferResource{
       ._buffer             = VmaRaiiBuffer(device.vma_alloc_manager(), buff_opt->allocation, buff_opt->vk_buffer),
@@ -161,7 +165,7 @@ Result<BufferResource, Error> BufferResource::create_staging_buffer(Device& devi
 }
 
 Result<PersistentlyMappedBufferResource, Error> BufferResource::persistently_mapped_staging_buffer(
-    Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags usage) {
+    Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags usage, const std::source_location& location) {
   auto buf_create_info = vk::BufferCreateInfo{
       .sType = vk::StructureType::eBufferCreateInfo,
       .size  = size_bytes,
@@ -173,9 +177,9 @@ Result<PersistentlyMappedBufferResource, Error> BufferResource::persistently_map
   alloc_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
   VmaAllocationInfo alloc_info;
-  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, alloc_info);
+  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, alloc_info, location);
   if (!buff_opt) {
-    std::unexpected(buff_opt.error());
+    return std::unexpected(buff_opt.error());
   }
 
   if (!alloc_info.pMappedData) {
@@ -201,12 +205,13 @@ Result<PersistentlyMappedBufferResource, Error> BufferResource::persistently_map
 }
 
 Result<PersistentlyMappedBufferResource, Error> BufferResource::create_readback_storage_buffer(
-    Device& device, vk::DeviceSize size_bytes) {
-  return create_readback_buffer(device, size_bytes, vk::BufferUsageFlagBits::eStorageBuffer);
+    Device& device, vk::DeviceSize size_bytes, const std::source_location& location) {
+  return create_readback_buffer(device, size_bytes, vk::BufferUsageFlagBits::eStorageBuffer, location);
 }
 
 Result<PersistentlyMappedBufferResource, Error> BufferResource::create_readback_buffer(
-    Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags additional_usage_flags) {
+    Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags additional_usage_flags,
+    const std::source_location& location) {
   auto buf_create_info = vk::BufferCreateInfo{
       .sType = vk::StructureType::eBufferCreateInfo,
       .size  = size_bytes,
@@ -218,9 +223,9 @@ Result<PersistentlyMappedBufferResource, Error> BufferResource::create_readback_
   alloc_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
   VmaAllocationInfo alloc_info;
-  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, alloc_info);
+  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, alloc_info, location);
   if (!buff_opt) {
-    std::unexpected(buff_opt.error());
+    return std::unexpected(buff_opt.error());
   }
 
   if (!alloc_info.pMappedData) {
@@ -246,7 +251,8 @@ Result<PersistentlyMappedBufferResource, Error> BufferResource::create_readback_
 }
 
 Result<BufferResource, Error> BufferResource::create_gpu_local_buffer(Device& device, vk::DeviceSize size_bytes,
-                                                                      vk::BufferUsageFlags usage) {
+                                                                      vk::BufferUsageFlags usage,
+                                                                      const std::source_location& location) {
   auto buf_create_info = vk::BufferCreateInfo{
       .sType       = vk::StructureType::eBufferCreateInfo,
       .size        = size_bytes,
@@ -257,9 +263,9 @@ Result<BufferResource, Error> BufferResource::create_gpu_local_buffer(Device& de
   VmaAllocationCreateInfo alloc_create_info = {};
   alloc_create_info.usage                   = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
-  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info);
+  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, location);
   if (!buff_opt) {
-    std::unexpected(buff_opt.error());
+    return std::unexpected(buff_opt.error());
   }
 
   return BufferResource{
@@ -299,6 +305,7 @@ Result<void, Error> BufferResource::write_via_staging_buffer(BufferResource& sta
 
   vmaCopyMemoryToAllocation(_p_device->vma_alloc_manager().allocator(), src_region.data(),
                             staging_buffer._buffer._allocation, 0, src_region.size_bytes());
+  _p_device->statistics().count_staging_bytes(src_region.size_bytes());
 
   auto cmd_cpy_buff = _p_device->begin_single_time_commands();
   cmd_cpy_buff.copyBuffer(staging_buffer._buffer._vk_handle, _buffer._vk_handle,
@@ -308,31 +315,55 @@ Result<void, Error> BufferResource::write_via_staging_buffer(BufferResource& sta
   return {};
 }
 
-Result<BufferResource, Error> BufferResource::create_uniform_buffer(Device& device, vk::DeviceSize size_bytes) {
+Result<BufferResource, Error> BufferResource::create_uniform_buffer(Device& device, vk::DeviceSize size_bytes,
+                                                                    const std::source_location& location) {
+  return create_dynamic_buffer(device, size_bytes, vk::BufferUsageFlagBits::eUniformBuffer, location);
+}
+
+Result<BufferResource, Error> BufferResource::create_dynamic_buffer(Device& device, vk::DeviceSize size_bytes,
+                                                                    vk::BufferUsageFlags usage,
+                                                                    const std::source_location& location) {
   vk::BufferCreateInfo buf_create_info = {
       .sType       = vk::StructureType::eBufferCreateInfo,
       .size        = size_bytes,
-      .usage       = vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      .usage       = usage | vk::BufferUsageFlagBits::eTransferDst,
       .sharingMode = vk::SharingMode::eExclusive,
   };
 
+  // == Host Visible Device Local ======================================================================================
+  // The CPU writes the data directly to the memory read by the GPU, there is no staging copy and no submit.
+  if (device.fits_host_visible_device_local(size_bytes)) {
+    VmaAllocationCreateInfo alloc_create_info = {};
+    alloc_create_info.usage                   = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    alloc_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    alloc_create_info.requiredFlags  = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    alloc_create_info.preferredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    VmaAllocationInfo alloc_info;
+    if (auto buff_opt =
+            device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, alloc_info, location)) {
+      return BufferResource{
+          ._buffer             = VmaRaiiBuffer(device.vma_alloc_manager(), buff_opt->allocation, buff_opt->vk_buffer),
+          ._p_device           = &device,
+          .size_bytes          = size_bytes,
+          .usage               = buf_create_info.usage,
+          .transfer_src        = false,
+          .persistently_mapped = alloc_info.pMappedData != nullptr,
+          .mappable            = true,
+      };
+    }
+    util::Logger::warn("Could not allocate {} bytes of host visible device local memory, falling back to device local",
+                       size_bytes);
+  }
+
+  // == Device Local ===================================================================================================
+  // The heap is small, exhausted or there is none at all. The buffer is filled with transfers, see `write()`.
   VmaAllocationCreateInfo alloc_create_info = {};
-  alloc_create_info.usage                   = VMA_MEMORY_USAGE_AUTO;
-  alloc_create_info.flags                   = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
-                            VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT |
-                            VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  alloc_create_info.usage                   = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
-  VmaAllocationInfo alloc_info;
-  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, alloc_info);
+  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, location);
   if (!buff_opt) {
-    std::unexpected(buff_opt.error());
-  }
-
-  VkMemoryPropertyFlags mem_prop_flags = 0;
-  vmaGetAllocationMemoryProperties(device.vma_alloc_manager().allocator(), buff_opt->allocation, &mem_prop_flags);
-  bool mappable_flag = false;
-  if (mem_prop_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
-    mappable_flag = true;
+    return std::unexpected(buff_opt.error());
   }
 
   return BufferResource{
@@ -341,13 +372,13 @@ Result<BufferResource, Error> BufferResource::create_uniform_buffer(Device& devi
       .size_bytes          = size_bytes,
       .usage               = buf_create_info.usage,
       .transfer_src        = false,
-      .persistently_mapped = alloc_info.pMappedData != nullptr,
-      .mappable            = mappable_flag,
+      .persistently_mapped = false,
+      .mappable            = false,
   };
 }
 
 [[nodiscard]] Result<PersistentlyMappedBufferResource, Error> BufferResource::create_persistently_mapped_uniform_buffer(
-    Device& device, vk::DeviceSize size_bytes) {
+    Device& device, vk::DeviceSize size_bytes, const std::source_location& location) {
   // TODO(migoox): Read about HOST_COHERENT & HOST_CACHED (might improve the performance)
   vk::BufferCreateInfo buf_create_info = {
       .sType       = vk::StructureType::eBufferCreateInfo,
@@ -361,9 +392,9 @@ Result<BufferResource, Error> BufferResource::create_uniform_buffer(Device& devi
   alloc_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
   VmaAllocationInfo alloc_info;
-  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, alloc_info);
+  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, alloc_info, location);
   if (!buff_opt) {
-    std::unexpected(buff_opt.error());
+    return std::unexpected(buff_opt.error());
   }
 
   if (!alloc_info.pMappedData) {
@@ -466,4 +497,11 @@ std::optional<void*> BufferResource::mapping() const {
   return info.pMappedData;
 }
 
+void BufferResource::set_debug_name(util::zstring_view name) const {
+  _p_device->set_object_name(vk_buffer(), name);
+  if (_buffer.owns_allocation()) {
+    _p_device->vma_alloc_manager().set_allocation_name(_buffer._allocation, name);
+  }
+}
+
 }  // namespace eray::vkren
@@ -3,9 +3,11 @@
 #include <vma/vk_mem_alloc.h>
 
 #include <liberay/util/memory_region.hpp>
+#include <liberay/util/zstring_view.hpp>
 #include <liberay/vkren/common.hpp>
 #include <liberay/vkren/device.hpp>
 #include <liberay/vkren/vma_raii_object.hpp>
+#include <source_location>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
@@ -121,11 +123,13 @@ struct BufferResource {
    * @param size_bytes
    * @return Result<Buffer, Error>
    */
-  [[nodiscard]] static Result<BufferResource, Error> create_staging_buffer(Device& device,
-                                                                           const util::MemoryRegion& src_region);
+  [[nodiscard]] static Result<BufferResource, Error> create_staging_buffer(
+      Device& device, const util::MemoryRegion& src_region,
+      const std::source_location& location = std::source_location::current());
 
   [[nodiscard]] static Result<PersistentlyMappedBufferResource, Error> persistently_mapped_staging_buffer(
-      Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eTransferSrc);
+      Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eTransferSrc,
+      const std::source_location& location = std::source_location::current());
 
   /**
    * @brief Creates a gpu local buffer, e.g. for vertex or index buffer.
@@ -135,14 +139,19 @@ struct BufferResource {
    * @param usage
    * @return Result<Buffer, Error>
    */
-  [[nodiscard]] static Result<BufferResource, Error> create_gpu_local_buffer(Device& device, vk::DeviceSize size_bytes,
-                                                                             vk::BufferUsageFlags usage);
-
-  [[nodiscard]] static Result<BufferResource, Error> create_index_buffer(Device& device, vk::DeviceSize size_bytes) {
-    return create_gpu_local_buffer(device, size_bytes, vk::BufferUsageFlagBits::eIndexBuffer);
+  [[nodiscard]] static Result<BufferResource, Error> create_gpu_local_buffer(
+      Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags usage,
+      const std::source_location& location = std::source_location::current());
+
+  [[nodiscard]] static Result<BufferResource, Error> create_index_buffer(
+      Device& device, vk::DeviceSize size_bytes,
+      const std::source_location& location = std::source_location::current()) {
+    return create_gpu_local_buffer(device, size_bytes, vk::BufferUsageFlagBits::eIndexBuffer, location);
   }
-  [[nodiscard]] static Result<BufferResource, Error> create_vertex_buffer(Device& device, vk::DeviceSize size_bytes) {
-    return create_gpu_local_buffer(device, size_bytes, vk::BufferUsageFlagBits::eVertexBuffer);
+  [[nodiscard]] static Result<BufferResource, Error> create_vertex_buffer(
+      Device& device, vk::DeviceSize size_bytes,
+      const std::source_location& location = std::source_location::current()) {
+    return create_gpu_local_buffer(device, size_bytes, vk::BufferUsageFlagBits::eVertexBuffer, location);
   }
 
   /**
@@ -154,10 +163,12 @@ struct BufferResource {
    * @return Result<Buffer, Error>
    */
   [[nodiscard]] static Result<PersistentlyMappedBufferResource, Error> create_readback_buffer(
-      Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags usage_flags);
+      Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags usage_flags,
+      const std::source_location& location = std::source_location::current());
 
   [[nodiscard]] static Result<PersistentlyMappedBufferResource, Error> create_readback_storage_buffer(
-      Device& device, vk::DeviceSize size_bytes);
+      Device& device, vk::DeviceSize size_bytes,
+      const std::source_location& location = std::source_location::current());
 
   /**
    * @brief For resources that you frequently write on CPU via mapped pointer and frequently read on GPU e.g. uniform
@@ -167,18 +178,45 @@ struct BufferResource {
    * @param size_bytes
    * @return Result<Buffer, Error>
    */
-  [[nodiscard]] static Result<BufferResource, Error> create_uniform_buffer(Device& device, vk::DeviceSize size_bytes);
-  [[nodiscard]] static Result<BufferResource, Error> create_storage_buffer(Device& device, vk::DeviceSize size_bytes) {
-    return create_gpu_local_buffer(device, size_bytes, vk::BufferUsageFlagBits::eStorageBuffer);
+  [[nodiscard]] static Result<BufferResource, Error> create_uniform_buffer(
+      Device& device, vk::DeviceSize size_bytes,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Same as `create_uniform_buffer()`, but with arbitrary usage, e.g. for vertex data rewritten every frame.
+   * The buffer is placed in the DEVICE_LOCAL | HOST_VISIBLE memory (resizable BAR) while it fits the budget of
+   * `Device::host_visible_device_local_heap()`. Otherwise it is DEVICE_LOCAL and not mappable (check `mappable`) and
+   * must be filled with a transfer.
+   *
+   * @param device
+   * @param size_bytes
+   * @param usage VK_BUFFER_USAGE_TRANSFER_DST_BIT is always added.
+   * @return Result<BufferResource, Error>
+   */
+  [[nodiscard]] static Result<BufferResource, Error> create_dynamic_buffer(
+      Device& device, vk::DeviceSize size_bytes, vk::BufferUsageFlags usage,
+      const std::source_location& location = std::source_location::current());
+  [[nodiscard]] static Result<BufferResource, Error> create_dynamic_vertex_buffer(
+      Device& device, vk::DeviceSize size_bytes,
+      const std::source_location& location = std::source_location::current()) {
+    return create_dynamic_buffer(device, size_bytes, vk::BufferUsageFlagBits::eVertexBuffer, location);
+  }
+  [[nodiscard]] static Result<BufferResource, Error> create_storage_buffer(
+      Device& device, vk::DeviceSize size_bytes,
+      const std::source_location& location = std::source_location::current()) {
+    return create_gpu_local_buffer(device, size_bytes, vk::BufferUsageFlagBits::eStorageBuffer, location);
   }
 
   [[nodiscard]] static Result<PersistentlyMappedBufferResource, Error> create_persistently_mapped_uniform_buffer(
-      Device& device, vk::DeviceSize size_bytes);
+      Device& device, vk::DeviceSize size_bytes,
+      const std::source_location& location = std::source_location::current());
 
   /**
    * @brief Creates a temporary staging buffer and uses it to fill the buffer.
    * This function blocks the CPU until the write is ready.
    *
+   * @note Uploads performed every frame should go through the `StagingRingBuffer` instead.
+   *
    * @param offset Represents the destination (GPU memory) offset. Zero by default.
    * @param src_region
    * @return Result<void, Error>
@@ -249,6 +287,12 @@ struct BufferResource {
 
   vk::Buffer vk_buffer() const { return _buffer._vk_handle; }
 
+  /**
+   * @brief Names the buffer and its VMA allocation for the GPU captures and the VMA statistics dumps.
+   *
+   */
+  void set_debug_name(util::zstring_view name) const;
+
   vk::DescriptorBufferInfo desc_buffer_info(size_t offset = 0) const {
     return vk::DescriptorBufferInfo{
         .buffer = vk_buffer(),
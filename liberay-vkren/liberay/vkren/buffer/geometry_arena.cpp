@@ -0,0 +1,328 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <cassert>
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/panic.hpp>
+#include <liberay/vkren/buffer/geometry_arena.hpp>
+#include <liberay/vkren/error.hpp>
+#include <numeric>
+#include <utility>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+Result<VmaVirtualBlock, Error> create_virtual_block(uint32_t size) {
+  auto create_info = VmaVirtualBlockCreateInfo{};
+  create_info.size = size;
+
+  VmaVirtualBlock block = VK_NULL_HANDLE;
+  if (auto result = vmaCreateVirtualBlock(&create_info, &block); result != VK_SUCCESS) {
+    return std::unexpected(Error{
+        .msg     = "Could not create a virtual block",
+        .code    = ErrorCode::MemoryAllocationFailure{},
+        .vk_code = vk::Result(result),
+    });
+  }
+
+  return block;
+}
+
+/**
+ * @brief Empty ranges do not allocate, VMA does not accept zero sized allocations.
+ *
+ */
+bool virtual_allocate(VmaVirtualBlock block, uint32_t size, VmaVirtualAllocation& allocation, uint32_t& offset) {
+  allocation = VK_NULL_HANDLE;
+  offset     = 0;
+  if (size == 0) {
+    return true;
+  }
+
+  auto alloc_info = VmaVirtualAllocationCreateInfo{};
+  alloc_info.size = size;
+
+  auto vma_offset = VkDeviceSize{0};
+  if (vmaVirtualAllocate(block, &alloc_info, &allocation, &vma_offset) != VK_SUCCESS) {
+    return false;
+  }
+  offset = static_cast<uint32_t>(vma_offset);
+
+  return true;
+}
+
+void virtual_free(VmaVirtualBlock block, VmaVirtualAllocation allocation) {
+  if (allocation != VK_NULL_HANDLE) {
+    vmaVirtualFree(block, allocation);
+  }
+}
+
+}  // namespace
+
+Result<GeometryArena, Error> GeometryArena::create(Device& device, uint32_t vertex_stride, uint32_t max_vertices,
+                                                   uint32_t max_indices) {
+  assert(vertex_stride > 0 && max_vertices > 0 && max_indices > 0 && "Arena must not be empty");
+
+  // Transfer source is required by the compaction. The mesh shaders of the `MeshletCuller` fetch the vertices from a
+  // storage buffer. The `AccelerationStructureBuilder` reads the triangles through the device addresses.
+  auto geometry_usage = vk::BufferUsageFlags{};
+  if (device.has_ray_query()) {
+    geometry_usage = vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
+                     vk::BufferUsageFlagBits::eShaderDeviceAddress;
+  }
+  auto vertex_buffer = BufferResource::create_gpu_local_buffer(
+      device, static_cast<vk::DeviceSize>(max_vertices) * vertex_stride,
+      vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
+          vk::BufferUsageFlagBits::eTransferSrc | geometry_usage);
+  if (!vertex_buffer) {
+    return std::unexpected(vertex_buffer.error());
+  }
+
+  auto index_buffer = BufferResource::create_gpu_local_buffer(
+      device, static_cast<vk::DeviceSize>(max_indices) * sizeof(uint32_t),
+      vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferSrc | geometry_usage);
+  if (!index_buffer) {
+    return std::unexpected(index_buffer.error());
+  }
+
+  auto vertex_block = create_virtual_block(max_vertices);
+  if (!vertex_block) {
+    return std::unexpected(vertex_block.error());
+  }
+
+  auto index_block = create_virtual_block(max_indices);
+  if (!index_block) {
+    vmaDestroyVirtualBlock(*vertex_block);
+    return std::unexpected(index_block.error());
+  }
+
+  return GeometryArena(std::move(*vertex_buffer), std::move(*index_buffer), *vertex_block, *index_block,
+                       vertex_stride);
+}
+
+GeometryArena::GeometryArena(GeometryArena&& other) noexcept
+    : vertex_buffer_(std::move(other.vertex_buffer_)),
+      index_buffer_(std::move(other.index_buffer_)),
+      vertex_block_(std::exchange(other.vertex_block_, VK_NULL_HANDLE)),
+      index_block_(std::exchange(other.index_block_, VK_NULL_HANDLE)),
+      vertex_stride_(other.vertex_stride_),
+      used_vertices_(other.used_vertices_),
+      used_indices_(other.used_indices_),
+      slots_(std::move(other.slots_)) {}
+
+GeometryArena& GeometryArena::operator=(GeometryArena&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  destroy_blocks();
+
+  vertex_buffer_ = std::move(other.vertex_buffer_);
+  index_buffer_  = std::move(other.index_buffer_);
+  vertex_block_  = std::exchange(other.vertex_block_, VK_NULL_HANDLE);
+  index_block_   = std::exchange(other.index_block_, VK_NULL_HANDLE);
+  vertex_stride_ = other.vertex_stride_;
+  used_vertices_ = other.used_vertices_;
+  used_indices_  = other.used_indices_;
+  slots_         = std::move(other.slots_);
+
+  return *this;
+}
+
+GeometryArena::~GeometryArena() { destroy_blocks(); }
+
+void GeometryArena::destroy_blocks() noexcept {
+  // VMA requires the virtual blocks to be empty before they are destroyed.
+  if (vertex_block_ != VK_NULL_HANDLE) {
+    vmaClearVirtualBlock(vertex_block_);
+    vmaDestroyVirtualBlock(vertex_block_);
+    vertex_block_ = VK_NULL_HANDLE;
+  }
+  if (index_block_ != VK_NULL_HANDLE) {
+    vmaClearVirtualBlock(index_block_);
+    vmaDestroyVirtualBlock(index_block_);
+    index_block_ = VK_NULL_HANDLE;
+  }
+}
+
+Result<GeometryHandle, Error> GeometryArena::allocate(uint32_t vertex_count, uint32_t index_count) {
+  auto slot = Slot{
+      .range =
+          GeometryRange{
+              .vertex_offset = 0,
+              .vertex_count  = vertex_count,
+              .first_index   = 0,
+              .index_count   = index_count,
+          },
+      .vertex_allocation = VK_NULL_HANDLE,
+      .index_allocation  = VK_NULL_HANDLE,
+  };
+
+  if (!virtual_allocate(vertex_block_, vertex_count, slot.vertex_allocation, slot.range.vertex_offset)) {
+    util::Logger::warn("Geometry arena has no free range of {} vertices, {} vertices in use", vertex_count,
+                       used_vertices_);
+    return std::unexpected(Error{
+        .msg  = "Geometry arena vertex buffer is full",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  if (!virtual_allocate(index_block_, index_count, slot.index_allocation, slot.range.first_index)) {
+    virtual_free(vertex_block_, slot.vertex_allocation);
+    util::Logger::warn("Geometry arena has no free range of {} indices, {} indices in use", index_count,
+                       used_indices_);
+    return std::unexpected(Error{
+        .msg  = "Geometry arena index buffer is full",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  used_vertices_ += vertex_count;
+  used_indices_ += index_count;
+
+  return slots_.insert(slot);
+}
+
+void GeometryArena::free(GeometryHandle handle) {
+  assert(slots_.contains(handle) && "Invalid geometry handle");
+
+  const auto& slot = slots_[handle];
+  virtual_free(vertex_block_, slot.vertex_allocation);
+  virtual_free(index_block_, slot.index_allocation);
+  used_vertices_ -= slot.range.vertex_count;
+  used_indices_ -= slot.range.index_count;
+  slots_.erase(handle);
+}
+
+Result<void, Error> GeometryArena::upload(TransferUploader& uploader, GeometryHandle handle,
+                                          const util::MemoryRegion& vertices,
+                                          const util::MemoryRegion& indices) const {
+  const auto& mesh_range = range(handle);
+  assert(vertices.size_bytes() == static_cast<size_t>(mesh_range.vertex_count) * vertex_stride_ &&
+         "Vertex data size does not match the allocation");
+  assert(indices.size_bytes() == static_cast<size_t>(mesh_range.index_count) * sizeof(uint32_t) &&
+         "Index data size does not match the allocation");
+
+  if (vertices.size_bytes() > 0) {
+    if (auto result = uploader.upload(vertices, vertex_buffer_, vertex_offset_bytes(handle)); !result) {
+      return std::unexpected(result.error());
+    }
+  }
+  if (indices.size_bytes() > 0) {
+    if (auto result = uploader.upload(indices, index_buffer_, index_offset_bytes(handle)); !result) {
+      return std::unexpected(result.error());
+    }
+  }
+
+  return {};
+}
+
+Result<void, Error> GeometryArena::compact() {
+  auto& device = *vertex_buffer_._p_device;
+
+  auto compacted = GeometryArena::create(device, vertex_stride_,
+                                         static_cast<uint32_t>(vertex_buffer_.size_bytes / vertex_stride_),
+                                         static_cast<uint32_t>(index_buffer_.size_bytes / sizeof(uint32_t)));
+  if (!compacted) {
+    return std::unexpected(compacted.error());
+  }
+
+  // The meshes are moved in the order of their current offsets, so that the relative order (and locality) of the
+  // data is preserved.
+  const auto slots = slots_.values();
+  auto order       = std::vector<uint32_t>(slots.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::sort(order, [slots](uint32_t a, uint32_t b) {
+    return slots[a].range.vertex_offset < slots[b].range.vertex_offset;
+  });
+
+  auto new_slots      = slots_;
+  auto vertex_regions = std::vector<vk::BufferCopy>();
+  for (auto index : order) {
+    auto& slot = new_slots.values()[index];
+
+    auto old_offset = slot.range.vertex_offset;
+    if (!virtual_allocate(compacted->vertex_block_, slot.range.vertex_count, slot.vertex_allocation,
+                          slot.range.vertex_offset)) {
+      util::panic("Compacted geometry arena could not fit the live vertices");
+    }
+    if (slot.range.vertex_count > 0) {
+      vertex_regions.push_back(vk::BufferCopy{
+          .srcOffset = static_cast<vk::DeviceSize>(old_offset) * vertex_stride_,
+          .dstOffset = static_cast<vk::DeviceSize>(slot.range.vertex_offset) * vertex_stride_,
+          .size      = static_cast<vk::DeviceSize>(slot.range.vertex_count) * vertex_stride_,
+      });
+    }
+  }
+
+  std::ranges::sort(order, [slots](uint32_t a, uint32_t b) {
+    return slots[a].range.first_index < slots[b].range.first_index;
+  });
+
+  auto index_regions = std::vector<vk::BufferCopy>();
+  for (auto index : order) {
+    auto& slot = new_slots.values()[index];
+
+    auto old_first_index = slot.range.first_index;
+    if (!virtual_allocate(compacted->index_block_, slot.range.index_count, slot.index_allocation,
+                          slot.range.first_index)) {
+      util::panic("Compacted geometry arena could not fit the live indices");
+    }
+    if (slot.range.index_count > 0) {
+      index_regions.push_back(vk::BufferCopy{
+          .srcOffset = static_cast<vk::DeviceSize>(old_first_index) * sizeof(uint32_t),
+          .dstOffset = static_cast<vk::DeviceSize>(slot.range.first_index) * sizeof(uint32_t),
+          .size      = static_cast<vk::DeviceSize>(slot.range.index_count) * sizeof(uint32_t),
+      });
+    }
+  }
+
+  // The immediate submit waits for the graphics queue to become idle, so the frames in flight are done with the old
+  // buffers once it returns.
+  device.immediate_command_submit([&](vk::CommandBuffer cmd_buff) {
+    if (!vertex_regions.empty()) {
+      cmd_buff.copyBuffer(vertex_buffer_.vk_buffer(), compacted->vertex_buffer_.vk_buffer(),
+                          vertex_regions);
+    }
+    if (!index_regions.empty()) {
+      cmd_buff.copyBuffer(index_buffer_.vk_buffer(), compacted->index_buffer_.vk_buffer(),
+                          index_regions);
+    }
+  });
+
+  compacted->used_vertices_ = used_vertices_;
+  compacted->used_indices_  = used_indices_;
+  compacted->slots_         = std::move(new_slots);
+  *this                     = std::move(*compacted);
+
+  return {};
+}
+
+void GeometryArena::bind(vk::CommandBuffer cmd_buff) const {
+  cmd_buff.bindVertexBuffers(0, vertex_buffer_.vk_buffer(), {0});
+  cmd_buff.bindIndexBuffer(index_buffer_.vk_buffer(), 0, vk::IndexType::eUint32);
+}
+
+void GeometryArena::draw(vk::CommandBuffer cmd_buff, GeometryHandle handle, uint32_t instance_count,
+                         uint32_t first_instance) const {
+  const auto& mesh_range = range(handle);
+  cmd_buff.drawIndexed(mesh_range.index_count, instance_count, mesh_range.first_index,
+                       static_cast<int32_t>(mesh_range.vertex_offset), first_instance);
+}
+
+GPUMeshSurface GeometryArena::surface(GeometryHandle handle) const {
+  const auto& mesh_range = range(handle);
+  return GPUMeshSurface{
+      .vertex_buffer = vertex_buffer_.vk_buffer(),
+      .index_buffer  = index_buffer_.vk_buffer(),
+      .first_index   = mesh_range.first_index,
+      .index_count   = mesh_range.index_count,
+      .vertex_offset = static_cast<int32_t>(mesh_range.vertex_offset),
+  };
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <vma/vk_mem_alloc.h>
+
+#include <cstdint>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/slot_map.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/scene/mesh.hpp>
+#include <liberay/vkren/transfer_uploader.hpp>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+struct GeometryTag {};
+
+/**
+ * @brief Stable handle of a geometry arena allocation. Stays valid across the compaction, a freed handle is detected
+ * by the generation check.
+ *
+ */
+using GeometryHandle = util::SlotMapKey<GeometryTag>;
+
+/**
+ * @brief Location of mesh data in the arena buffers. The `vertex_offset` and `first_index` are expressed in vertices
+ * and indices respectively, so they can be passed directly to `drawIndexed`.
+ *
+ */
+struct GeometryRange {
+  uint32_t vertex_offset;
+  uint32_t vertex_count;
+  uint32_t first_index;
+  uint32_t index_count;
+};
+
+/**
+ * @brief One large device-local vertex buffer and one index buffer (`uint32_t` indices) suballocated between many
+ * meshes with VMA virtual blocks. All of the meshes share a single vertex layout, so a whole scene is drawn with one
+ * `bind()` and a `drawIndexed` (or an indirect draw) per mesh.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class GeometryArena {
+ public:
+  GeometryArena() = delete;
+  explicit GeometryArena(std::nullptr_t) {}
+
+  GeometryArena(GeometryArena&& other) noexcept;
+  GeometryArena& operator=(GeometryArena&& other) noexcept;
+  GeometryArena(const GeometryArena&)            = delete;
+  GeometryArena& operator=(const GeometryArena&) = delete;
+
+  ~GeometryArena();
+
+  /**
+   * @brief Creates the arena buffers.
+   *
+   * @param device
+   * @param vertex_stride Size of a single vertex in bytes.
+   * @param max_vertices Capacity of the vertex buffer.
+   * @param max_indices Capacity of the index buffer.
+   * @return Result<GeometryArena, Error>
+   */
+  [[nodiscard]] static Result<GeometryArena, Error> create(Device& device, uint32_t vertex_stride,
+                                                           uint32_t max_vertices, uint32_t max_indices);
+
+  /**
+   * @brief Reserves space for a mesh. The contents are undefined until the mesh is uploaded.
+   *
+   * @param vertex_count
+   * @param index_count
+   * @return Result<GeometryHandle, Error> Fails with `MemoryAllocationFailure` when there is no free range large
+   * enough, the caller might `compact()` the arena and try again.
+   */
+  Result<GeometryHandle, Error> allocate(uint32_t vertex_count, uint32_t index_count);
+
+  /**
+   * @brief Returns the ranges of the mesh to the arena. The GPU must not use the mesh anymore.
+   *
+   * @param handle
+   */
+  void free(GeometryHandle handle);
+
+  /**
+   * @brief Queues the upload of the mesh data on the transfer queue.
+   *
+   * @param uploader
+   * @param handle
+   * @param vertices Must hold `vertex_count * vertex_stride` bytes.
+   * @param indices Must hold `index_count` indices.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> upload(TransferUploader& uploader, GeometryHandle handle, const util::MemoryRegion& vertices,
+                             const util::MemoryRegion& indices) const;
+
+  /**
+   * @brief Moves all of the live meshes to the beginning of the new arena buffers, so that the freed ranges join into
+   * a single free range. The ranges of the meshes change, the handles stay valid.
+   *
+   * @warning Blocks the CPU until the graphics queue is idle. Temporarily needs twice as much memory.
+   *
+   * @return Result<void, Error>
+   */
+  Result<void, Error> compact();
+
+  /**
+   * @brief Binds the vertex buffer at binding 0 and the index buffer.
+   *
+   * @param cmd_buff
+   */
+  void bind(vk::CommandBuffer cmd_buff) const;
+
+  /**
+   * @brief Records the draw of the mesh. Expects the arena to be bound.
+   *
+   * @param cmd_buff
+   * @param handle
+   * @param instance_count
+   * @param first_instance
+   */
+  void draw(vk::CommandBuffer cmd_buff, GeometryHandle handle, uint32_t instance_count = 1,
+            uint32_t first_instance = 0) const;
+
+  const GeometryRange& range(GeometryHandle handle) const { return slots_[handle].range; }
+  GPUMeshSurface surface(GeometryHandle handle) const;
+
+  const BufferResource& vertex_buffer() const { return vertex_buffer_; }
+  const BufferResource& index_buffer() const { return index_buffer_; }
+  uint32_t vertex_stride() const { return vertex_stride_; }
+  vk::DeviceSize vertex_offset_bytes(GeometryHandle handle) const {
+    return static_cast<vk::DeviceSize>(range(handle).vertex_offset) * vertex_stride_;
+  }
+  vk::DeviceSize index_offset_bytes(GeometryHandle handle) const {
+    return static_cast<vk::DeviceSize>(range(handle).first_index) * sizeof(uint32_t);
+  }
+
+  uint32_t used_vertices() const { return used_vertices_; }
+  uint32_t used_indices() const { return used_indices_; }
+
+ private:
+  struct Slot {
+    GeometryRange range;
+    VmaVirtualAllocation vertex_allocation;
+    VmaVirtualAllocation index_allocation;
+  };
+
+  GeometryArena(BufferResource&& vertex_buffer, BufferResource&& index_buffer, VmaVirtualBlock vertex_block,
+                VmaVirtualBlock index_block, uint32_t vertex_stride)
+      : vertex_buffer_(std::move(vertex_buffer)),
+        index_buffer_(std::move(index_buffer)),
+        vertex_block_(vertex_block),
+        index_block_(index_block),
+        vertex_stride_(vertex_stride) {}
+
+  void destroy_blocks() noexcept;
+
+  BufferResource vertex_buffer_{};
+  BufferResource index_buffer_{};
+
+  /**
+   * @brief The virtual blocks are sized in vertices and indices rather than bytes, so their offsets are the draw
+   * offsets.
+   *
+   */
+  VmaVirtualBlock vertex_block_ = VK_NULL_HANDLE;
+  VmaVirtualBlock index_block_  = VK_NULL_HANDLE;
+
+  uint32_t vertex_stride_ = 0;
+  uint32_t used_vertices_ = 0;
+  uint32_t used_indices_  = 0;
+
+  util::SlotMap<Slot, GeometryHandle> slots_;
+};
+
+}  // namespace eray::vkren
@@ -1,26 +1,149 @@
 #pragma once
+#include <vma/vk_mem_alloc.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/vec.hpp>
 #include <liberay/vkren/buffer.hpp>
 #include <liberay/vkren/device.hpp>
+#include <type_traits>
+#include <vector>
+#include <vulkan/vulkan.hpp>
 
 namespace eray::vkren {
 
+/**
+ * @brief How the `LineStripRingBuffer` draws the strip.
+ *
+ */
+enum class LineStripRenderMode : uint8_t {
+  /**
+   * @brief The vertex buffer is drawn as a line strip, wider lines than 1 pixel require the `wideLines` feature and
+   * they are neither anti-aliased nor consistent across the vendors.
+   *
+   */
+  LineStrip,
+
+  /**
+   * @brief The points are read from a storage buffer by `liberay-vkren/shaders/wide_polyline.slang` (the entry points
+   * `mainVert` and `mainFrag`), which expands every segment to a screen-space quad of any width, mitered with the
+   * neighbouring segments and anti-aliased. The whole strip is a single instanced draw, see
+   * `LineStripRingBuffer::render_wide()`. The vertices must have the layout of the `WidePolylineVertex`.
+   *
+   */
+  ExpandedQuads,
+};
+
+/**
+ * @brief Vertex of the `LineStripRenderMode::ExpandedQuads` mode, std430 layout of the `Point` in
+ * `wide_polyline.slang`.
+ *
+ */
+struct WidePolylineVertex {
+  math::Vec3f position;
+
+  /**
+   * @brief Multiplies the `WidePolylineParams::width` at the vertex, the width is interpolated along the segment.
+   *
+   */
+  float width       = 1.F;
+  math::Vec4f color = math::Vec4f(1.F, 1.F, 1.F, 1.F);
+};
+static_assert(sizeof(WidePolylineVertex) == 32);
+
+/**
+ * @brief View of the `LineStripRingBuffer::render_wide()`.
+ *
+ */
+struct WidePolylineParams {
+  math::Mat4f view_projection = math::Mat4f::identity();
+
+  /**
+   * @brief Size of the viewport in pixels.
+   *
+   */
+  math::Vec2f viewport_size = math::Vec2f(1.F, 1.F);
+
+  /**
+   * @brief Width of the line in pixels.
+   *
+   */
+  float width = 1.F;
+
+  /**
+   * @brief Width of the anti-aliased edge in pixels, the pipeline should blend the alpha.
+   *
+   */
+  float feather = 1.F;
+};
+
+/**
+ * @brief Push constants of `wide_polyline.slang`, the pipeline layout of the mode must have a range of this size for
+ * the vertex and fragment stages.
+ *
+ */
+struct WidePolylinePushConstants {
+  math::Mat4f view_projection;
+  math::Vec2f viewport_size;
+  float width;
+  float feather;
+  std::uint32_t first_point;
+  std::uint32_t point_count;
+  std::uint32_t ring_size;
+  std::uint32_t _padding;
+};
+
+/**
+ * @brief Range of vertices `[begin, end)` modified since the last update of the frame.
+ *
+ */
+struct LineStripDirtyRange {
+  std::uint32_t begin;
+  std::uint32_t end;
+};
+
 struct LineStripRingBufferFrameData {
   eray::vkren::BufferResource vertex_buffer;
+
+  /**
+   * @brief Not created when the vertex buffer is HOST_VISIBLE, then the vertices are written directly.
+   *
+   */
   eray::vkren::BufferResource staging_buffer;
-  void* staging_buffer_mapping = nullptr;
-  bool dirty                   = true;
+
+  /**
+   * @brief Mapping of the buffer written by the CPU, i.e. the vertex buffer or the staging buffer.
+   *
+   */
+  void* mapping = nullptr;
+  std::vector<LineStripDirtyRange> dirty_ranges;
+  std::uint32_t dirty_count = 0;
+  bool direct_write         = false;
+
+  bool dirty() const { return !dirty_ranges.empty(); }
 };
 
 /**
  * @brief Persistently mapped line strip buffer compatible with frame in flights. The vertices are kept in the
  * DEVICE_LOCAL buffer. If max count is exceeded the line strip wraps around (ring buffer).
  *
+ * The slot 0 repeats the last vertex of the ring, so that the line strip mode draws the wrapped strip with two draws.
+ * In the `LineStripRenderMode::ExpandedQuads` mode the shader walks the slots 1 to `max_size - 1` from the oldest
+ * vertex instead, fetching the neighbours of a segment across the wrap.
+ *
+ * Only the vertices pushed since the previous update of a frame are uploaded. When the vertex buffer lives in
+ * DEVICE_LOCAL | HOST_VISIBLE memory they are written in place, otherwise the copies from the staging buffer are
+ * recorded into the frame command buffer.
+ *
  */
 template <typename TVertex>
 struct LineStripRingBuffer {
   std::vector<LineStripRingBufferFrameData> frame_data;
   std::uint32_t max_size = 0;
   std::vector<TVertex> points;
+  LineStripRenderMode render_mode = LineStripRenderMode::LineStrip;
 
   std::uint32_t _pivot = 0;
   bool _rounded        = false;
@@ -31,36 +154,51 @@ struct LineStripRingBuffer {
    * @param device
    * @param max_size_
    * @param max_frames_in_flight If frames in flight are disabled or 'on_frame_prepare_sync` is used, use 1.
+   * @param render_mode
    * @return LineStripRingBuffer
    */
   static LineStripRingBuffer create(eray::vkren::Device& device, std::uint32_t max_size_,
-                                    std::uint32_t max_frames_in_flight) {
+                                    std::uint32_t max_frames_in_flight,
+                                    LineStripRenderMode render_mode = LineStripRenderMode::LineStrip) {
+    if constexpr (!std::is_same_v<TVertex, WidePolylineVertex>) {
+      assert(render_mode == LineStripRenderMode::LineStrip && "Expanded quads require the wide polyline vertices");
+    }
+
     vk::DeviceSize size_bytes = max_size_ * sizeof(TVertex);
+    auto usage                = vk::BufferUsageFlags(vk::BufferUsageFlagBits::eVertexBuffer);
+    if (render_mode == LineStripRenderMode::ExpandedQuads) {
+      usage |= vk::BufferUsageFlagBits::eStorageBuffer;
+    }
 
     auto new_frame_data = std::vector<LineStripRingBufferFrameData>();
     new_frame_data.resize(max_frames_in_flight);
 
     for (auto i = 0U; i < max_frames_in_flight; ++i) {
-      auto mapping = eray::vkren::BufferResource::persistently_mapped_staging_buffer(device, size_bytes)
-                         .or_panic("Could not create a staging buffer for line strip");
-      auto vb = eray::vkren::BufferResource::create_vertex_buffer(device, size_bytes)
+      auto vb = eray::vkren::BufferResource::create_dynamic_buffer(device, size_bytes, usage)
                     .or_panic("Could not create a vertex buffer for line strip");
 
-      new_frame_data[i].staging_buffer         = std::move(mapping.buffer);
-      new_frame_data[i].staging_buffer_mapping = std::move(mapping.mapped_data);
-      new_frame_data[i].vertex_buffer          = std::move(vb);
-      new_frame_data[i].dirty                  = false;
+      if (auto vb_mapping = vb.mapping(); vb.mappable && vb_mapping) {
+        new_frame_data[i].mapping      = *vb_mapping;
+        new_frame_data[i].direct_write = true;
+      } else {
+        auto mapping = eray::vkren::BufferResource::persistently_mapped_staging_buffer(device, size_bytes)
+                           .or_panic("Could not create a staging buffer for line strip");
+        new_frame_data[i].staging_buffer = std::move(mapping.buffer);
+        new_frame_data[i].mapping        = mapping.mapped_data;
+      }
+      new_frame_data[i].vertex_buffer = std::move(vb);
     }
 
     auto new_points = std::vector<TVertex>();
     new_points.resize(max_size_);
 
     return LineStripRingBuffer{
-        .frame_data = std::move(new_frame_data),
-        .max_size   = max_size_,
-        .points     = std::move(new_points),
-        ._pivot     = 1,
-        ._rounded   = false,
+        .frame_data  = std::move(new_frame_data),
+        .max_size    = max_size_,
+        .points      = std::move(new_points),
+        .render_mode = render_mode,
+        ._pivot      = 1,
+        ._rounded    = false,
     };
   }
 
@@ -73,46 +211,160 @@ struct LineStripRingBuffer {
 
   void push_vertex(const TVertex& point) {
     points[_pivot] = point;
+    mark_dirty(_pivot);
     ++_pivot;
     if (_pivot >= max_size) {
       points[0] = point;
-      _pivot    = 1;
-      _rounded  = true;
-    }
-
-    for (auto& fd : frame_data) {
-      fd.dirty = true;
+      mark_dirty(0);
+      _pivot   = 1;
+      _rounded = true;
     }
   }
 
   void emplace_vertex(TVertex&& point) {
     points[_pivot] = std::move(point);
+    mark_dirty(_pivot);
     ++_pivot;
     if (_pivot >= max_size) {
-      points[0] = std::move(point);
-      _pivot    = 1;
-      _rounded  = true;
+      points[0] = points[max_size - 1];
+      mark_dirty(0);
+      _pivot   = 1;
+      _rounded = true;
     }
+  }
 
-    for (auto& fd : frame_data) {
-      fd.dirty = true;
+  /**
+   * @brief Uploads the vertices modified since the previous update of the frame. Must be recorded outside of a render
+   * pass, before the `render()` of the frame.
+   *
+   * @param cmd Graphics command buffer of the frame. Used only when the vertex buffer is not HOST_VISIBLE.
+   * @param image_index
+   */
+  void update(vk::CommandBuffer cmd, std::uint32_t image_index) {
+    auto& fd = frame_data[image_index];
+    if (!fd.dirty()) {
+      return;
     }
-  }
 
-  void update(std::uint32_t image_index) {
-    if (frame_data[image_index].dirty) {
-      memcpy(frame_data[image_index].staging_buffer_mapping, points.data(), size_bytes());
-      auto region = eray::util::MemoryRegion{points.data(), size_bytes()};
-      frame_data[image_index].vertex_buffer._p_device->immediate_command_submit([&](vk::CommandBuffer cmd) {
-        cmd.copyBuffer(frame_data[image_index].staging_buffer.vk_buffer(),
-                       frame_data[image_index].vertex_buffer.vk_buffer(), vk::BufferCopy(0, 0, size_bytes()));
+    for (const auto& range : fd.dirty_ranges) {
+      auto offset = static_cast<vk::DeviceSize>(range.begin) * sizeof(TVertex);
+      auto size   = static_cast<vk::DeviceSize>(range.end - range.begin) * sizeof(TVertex);
+      std::memcpy(static_cast<std::byte*>(fd.mapping) + offset, points.data() + range.begin, size);
+    }
+
+    if (fd.direct_write) {
+      // Host writes are made visible to the device by the queue submission, only the non coherent memory needs a flush
+      auto allocator = fd.vertex_buffer._p_device->vma_alloc_manager().allocator();
+      for (const auto& range : fd.dirty_ranges) {
+        vmaFlushAllocation(allocator, fd.vertex_buffer._buffer._allocation,
+                           static_cast<vk::DeviceSize>(range.begin) * sizeof(TVertex),
+                           static_cast<vk::DeviceSize>(range.end - range.begin) * sizeof(TVertex));
+      }
+    } else {
+      auto regions = std::vector<vk::BufferCopy>();
+      regions.reserve(fd.dirty_ranges.size());
+      for (const auto& range : fd.dirty_ranges) {
+        auto offset = static_cast<vk::DeviceSize>(range.begin) * sizeof(TVertex);
+        regions.push_back(vk::BufferCopy{
+            .srcOffset = offset,
+            .dstOffset = offset,
+            .size      = static_cast<vk::DeviceSize>(range.end - range.begin) * sizeof(TVertex),
+        });
+      }
+      cmd.copyBuffer(fd.staging_buffer.vk_buffer(), fd.vertex_buffer.vk_buffer(), regions);
+
+      auto barrier = vk::BufferMemoryBarrier2{
+          .srcStageMask        = vk::PipelineStageFlagBits2::eCopy,
+          .srcAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+          .dstStageMask        = vk::PipelineStageFlagBits2::eVertexAttributeInput |
+                          vk::PipelineStageFlagBits2::eVertexShader,
+          .dstAccessMask       = vk::AccessFlagBits2::eVertexAttributeRead | vk::AccessFlagBits2::eShaderStorageRead,
+          .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+          .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+          .buffer              = fd.vertex_buffer.vk_buffer(),
+          .offset              = 0,
+          .size                = vk::WholeSize,
+      };
+      cmd.pipelineBarrier2(vk::DependencyInfo{
+          .bufferMemoryBarrierCount = 1,
+          .pBufferMemoryBarriers    = &barrier,
       });
-      frame_data[image_index].dirty = false;
     }
+
+    fd.dirty_ranges.clear();
+    fd.dirty_count = 0;
   }
 
   vk::DeviceSize size_bytes() const { return max_size * sizeof(TVertex); }
 
+  /**
+   * @brief Extends the last dirty range of every frame when the vertex is contiguous with it, otherwise starts a new
+   * one. Frames that fell behind by the whole buffer upload it at once.
+   *
+   */
+  void mark_dirty(std::uint32_t index) {
+    for (auto& fd : frame_data) {
+      if (fd.dirty_count >= max_size) {
+        continue;
+      }
+
+      if (++fd.dirty_count >= max_size) {
+        fd.dirty_ranges.assign(1, LineStripDirtyRange{.begin = 0, .end = max_size});
+      } else if (!fd.dirty_ranges.empty() && fd.dirty_ranges.back().end == index) {
+        ++fd.dirty_ranges.back().end;
+      } else {
+        fd.dirty_ranges.push_back(LineStripDirtyRange{.begin = index, .end = index + 1});
+      }
+    }
+  }
+
+  /**
+   * @brief Number of the vertices of the strip, at most `max_size - 1`.
+   *
+   */
+  std::uint32_t point_count() const { return _rounded ? max_size - 1 : _pivot - 1; }
+
+  /**
+   * @brief Storage buffer of the frame read by `wide_polyline.slang` at the binding 0, e.g. for a push descriptor.
+   *
+   */
+  vk::DescriptorBufferInfo storage_buffer_info(std::uint32_t image_index) const {
+    return frame_data[image_index].vertex_buffer.desc_buffer_info();
+  }
+
+  /**
+   * @brief Draws the strip in the `LineStripRenderMode::ExpandedQuads` mode, an instance of 6 vertices per segment.
+   * The pipeline of `wide_polyline.slang` and the `storage_buffer_info()` of the frame must be bound already.
+   *
+   * @param graphics_command_buffer
+   * @param layout Layout of the pipeline, with the `WidePolylinePushConstants` range.
+   * @param params
+   */
+  void render_wide(vk::CommandBuffer graphics_command_buffer, vk::PipelineLayout layout,
+                   const WidePolylineParams& params) const {
+    assert(render_mode == LineStripRenderMode::ExpandedQuads && "The buffer was not created for the expanded quads");
+
+    const auto count = point_count();
+    if (count < 2) {
+      return;
+    }
+
+    // The oldest vertex is at the pivot once the strip wrapped around
+    const auto push_constants = WidePolylinePushConstants{
+        .view_projection = params.view_projection,
+        .viewport_size   = params.viewport_size,
+        .width           = params.width,
+        .feather         = params.feather,
+        .first_point     = _rounded ? _pivot - 1 : 0,
+        .point_count     = count,
+        .ring_size       = max_size - 1,
+        ._padding        = 0,
+    };
+    graphics_command_buffer.pushConstants<WidePolylinePushConstants>(
+        layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, push_constants);
+    graphics_command_buffer.draw(6, count - 1, 0, 0);
+  }
+
   void render(vk::CommandBuffer graphics_command_buffer, std::uint32_t image_index) const {
     graphics_command_buffer.bindVertexBuffers(0, frame_data[image_index].vertex_buffer.vk_buffer(), {0});
     if (_rounded) {
@@ -0,0 +1,154 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/buffer/readback_ring_buffer.hpp>
+#include <liberay/vkren/error.hpp>
+#include <utility>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+Error slot_unavailable_error() {
+  return Error{
+      .msg  = "No readback slot is available",
+      .code = ErrorCode::MemoryAllocationFailure{},
+  };
+}
+
+}  // namespace
+
+Result<ReadbackRingBuffer, Error> ReadbackRingBuffer::create(Device& device, vk::DeviceSize slot_size_bytes,
+                                                             uint32_t slot_count) {
+  auto slots = std::vector<Slot>();
+  slots.reserve(slot_count);
+  for (auto i = 0U; i < slot_count; ++i) {
+    auto buffer = BufferResource::create_readback_buffer(device, slot_size_bytes, {});
+    if (!buffer) {
+      return std::unexpected(buffer.error());
+    }
+    slots.push_back(Slot{
+        .buffer     = std::move(*buffer),
+        .frame      = 0,
+        .size_bytes = 0,
+        .on_ready   = nullptr,
+    });
+  }
+
+  return ReadbackRingBuffer(std::move(slots), slot_size_bytes);
+}
+
+Result<void, Error> ReadbackRingBuffer::record_image_copy(vk::CommandBuffer cmd_buff, vk::Image image,
+                                                          const vk::ImageSubresourceLayers& subresource,
+                                                          vk::Offset3D offset, vk::Extent3D extent,
+                                                          vk::DeviceSize texel_size_bytes, uint64_t frame,
+                                                          Callback on_ready) {
+  ERAY_PROFILE_FUNCTION();
+  const auto size_bytes = texel_size_bytes * extent.width * extent.height * extent.depth *
+                          static_cast<vk::DeviceSize>(subresource.layerCount);
+  auto* slot = acquire_slot(size_bytes);
+  if (!slot) {
+    return std::unexpected(slot_unavailable_error());
+  }
+
+  cmd_buff.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, slot->buffer.buffer.vk_buffer(),
+                             vk::BufferImageCopy{
+                                 .bufferOffset      = 0,
+                                 .bufferRowLength   = 0,
+                                 .bufferImageHeight = 0,
+                                 .imageSubresource  = subresource,
+                                 .imageOffset       = offset,
+                                 .imageExtent       = extent,
+                             });
+  record_host_barrier(cmd_buff);
+
+  slot->frame      = frame;
+  slot->size_bytes = size_bytes;
+  slot->on_ready   = std::move(on_ready);
+  ++pending_count_;
+
+  return {};
+}
+
+Result<void, Error> ReadbackRingBuffer::record_buffer_copy(vk::CommandBuffer cmd_buff, vk::Buffer src_buffer,
+                                                           vk::DeviceSize src_offset, vk::DeviceSize size_bytes,
+                                                           uint64_t frame, Callback on_ready) {
+  ERAY_PROFILE_FUNCTION();
+  auto* slot = acquire_slot(size_bytes);
+  if (!slot) {
+    return std::unexpected(slot_unavailable_error());
+  }
+
+  cmd_buff.copyBuffer(src_buffer, slot->buffer.buffer.vk_buffer(),
+                      vk::BufferCopy{
+                          .srcOffset = src_offset,
+                          .dstOffset = 0,
+                          .size      = size_bytes,
+                      });
+  record_host_barrier(cmd_buff);
+
+  slot->frame      = frame;
+  slot->size_bytes = size_bytes;
+  slot->on_ready   = std::move(on_ready);
+  ++pending_count_;
+
+  return {};
+}
+
+void ReadbackRingBuffer::poll(const FrameTimeline& timeline) {
+  if (pending_count_ == 0) {
+    return;
+  }
+
+  ERAY_PROFILE_FUNCTION();
+  for (auto& slot : slots_) {
+    if (!slot.on_ready || !timeline.is_complete(slot.frame)) {
+      continue;
+    }
+
+    // The memory might not be host coherent
+    const auto& buffer = slot.buffer.buffer;
+    vmaInvalidateAllocation(buffer._p_device->vma_alloc_manager().allocator(), buffer._buffer._allocation, 0,
+                            slot.size_bytes);
+
+    // The slot is freed first, so that the callback is able to request another readback
+    auto on_ready = std::exchange(slot.on_ready, nullptr);
+    --pending_count_;
+    on_ready(util::MemoryRegion(slot.buffer.mapped_data, slot.size_bytes));
+  }
+}
+
+ReadbackRingBuffer::Slot* ReadbackRingBuffer::acquire_slot(vk::DeviceSize size_bytes) {
+  if (size_bytes > slot_size_bytes_) {
+    util::Logger::warn("Readback of {} bytes exceeds the slot size of {} bytes", size_bytes, slot_size_bytes_);
+    return nullptr;
+  }
+
+  for (auto& slot : slots_) {
+    if (!slot.on_ready) {
+      return &slot;
+    }
+  }
+
+  util::Logger::warn("All of the {} readback slots are in flight", slots_.size());
+  return nullptr;
+}
+
+void ReadbackRingBuffer::record_host_barrier(vk::CommandBuffer cmd_buff) {
+  auto barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eCopy,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eHost,
+      .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &barrier,
+  });
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/frame_timeline.hpp>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Persistently mapped readback slots for copying small amounts of GPU data back to the CPU without stalling,
+ * e.g. the mouse pick id under the cursor or GPU counters. A copy is recorded into the command buffer of a frame and
+ * tagged with the frame number, its callback is invoked by `poll()` once the `FrameTimeline` reports the frame as
+ * complete, usually one or two frames later.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class ReadbackRingBuffer {
+ public:
+  using Callback = std::function<void(const util::MemoryRegion&)>;
+
+  ReadbackRingBuffer() = delete;
+  explicit ReadbackRingBuffer(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the readback slots.
+   *
+   * @param device
+   * @param slot_size_bytes Maximal size of a single readback.
+   * @param slot_count Maximal number of readbacks in flight.
+   * @return Result<ReadbackRingBuffer, Error>
+   */
+  [[nodiscard]] static Result<ReadbackRingBuffer, Error> create(Device& device, vk::DeviceSize slot_size_bytes,
+                                                                uint32_t slot_count);
+
+  /**
+   * @brief Records a copy of the image region to a free slot followed by a barrier that makes it visible to the host.
+   * Must be recorded outside of rendering.
+   *
+   * @param cmd_buff
+   * @param image Must be in the `eTransferSrcOptimal` layout and have VK_IMAGE_USAGE_TRANSFER_SRC_BIT set.
+   * @param subresource
+   * @param offset
+   * @param extent
+   * @param texel_size_bytes
+   * @param frame Frame that submits the `cmd_buff`, i.e. `FrameTimeline::current_frame()`.
+   * @param on_ready Receives the tightly packed texels.
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when all of the slots are in flight or the region
+   * does not fit into a slot.
+   */
+  Result<void, Error> record_image_copy(vk::CommandBuffer cmd_buff, vk::Image image,
+                                        const vk::ImageSubresourceLayers& subresource, vk::Offset3D offset,
+                                        vk::Extent3D extent, vk::DeviceSize texel_size_bytes, uint64_t frame,
+                                        Callback on_ready);
+
+  /**
+   * @brief Records a copy of the buffer range to a free slot followed by a barrier that makes it visible to the host.
+   *
+   * @param cmd_buff
+   * @param src_buffer Must have VK_BUFFER_USAGE_TRANSFER_SRC_BIT set.
+   * @param src_offset
+   * @param size_bytes
+   * @param frame Frame that submits the `cmd_buff`, i.e. `FrameTimeline::current_frame()`.
+   * @param on_ready
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when all of the slots are in flight or the range
+   * does not fit into a slot.
+   */
+  Result<void, Error> record_buffer_copy(vk::CommandBuffer cmd_buff, vk::Buffer src_buffer, vk::DeviceSize src_offset,
+                                         vk::DeviceSize size_bytes, uint64_t frame, Callback on_ready);
+
+  /**
+   * @brief Never blocks. Invokes the callbacks of the readbacks whose frames are complete and frees their slots.
+   *
+   * @param timeline
+   */
+  void poll(const FrameTimeline& timeline);
+
+  uint32_t pending_count() const { return pending_count_; }
+  uint32_t slot_count() const { return static_cast<uint32_t>(slots_.size()); }
+  vk::DeviceSize slot_size_bytes() const { return slot_size_bytes_; }
+
+ private:
+  struct Slot {
+    PersistentlyMappedBufferResource buffer;
+    uint64_t frame;
+    vk::DeviceSize size_bytes;
+    Callback on_ready;
+  };
+
+  ReadbackRingBuffer(std::vector<Slot>&& slots, vk::DeviceSize slot_size_bytes)
+      : slots_(std::move(slots)), slot_size_bytes_(slot_size_bytes) {}
+
+  /**
+   * @brief Returns a free slot able to hold `size_bytes`, nullptr otherwise.
+   *
+   */
+  Slot* acquire_slot(vk::DeviceSize size_bytes);
+
+  static void record_host_barrier(vk::CommandBuffer cmd_buff);
+
+  /**
+   * @brief Slots with a callback are in flight.
+   *
+   */
+  std::vector<Slot> slots_;
+  vk::DeviceSize slot_size_bytes_ = 0;
+  uint32_t pending_count_         = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,129 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <expected>
+#include <functional>
+#include <iterator>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/buffer/staging_ring_buffer.hpp>
+#include <liberay/vkren/error.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+// Keeps the staged data aligned for any vertex, index or uniform type, copies themselves have no alignment requirement
+constexpr auto kStagingAlignment = vk::DeviceSize{16};
+
+}  // namespace
+
+Result<StagingRingBuffer, Error> StagingRingBuffer::create(Device& device, vk::DeviceSize size_bytes,
+                                                           uint32_t frames_in_flight) {
+  auto staging = BufferResource::persistently_mapped_staging_buffer(device, size_bytes);
+  if (!staging) {
+    return std::unexpected(staging.error());
+  }
+  staging->buffer.set_debug_name("Staging ring");
+
+  return StagingRingBuffer(std::move(*staging), frames_in_flight);
+}
+
+Result<void, Error> StagingRingBuffer::upload(const util::MemoryRegion& src_region, const BufferResource& dst_buffer,
+                                              vk::DeviceSize dst_offset) {
+  ERAY_PROFILE_FUNCTION();
+  assert(dst_offset + src_region.size_bytes() <= dst_buffer.size_bytes && "Region size exceeds the buffer size");
+
+  const auto ring_size = size_bytes();
+  const auto size      = static_cast<vk::DeviceSize>(src_region.size_bytes());
+  auto offset          = (head_ + kStagingAlignment - 1) / kStagingAlignment * kStagingAlignment;
+  if (offset + size > ring_size) {
+    // The allocation must be contiguous, the end of the ring is skipped
+    offset = 0;
+  }
+  const auto consumed = offset >= head_ ? offset + size - head_ : ring_size - head_ + size;
+
+  if (size > ring_size || used_bytes_ + consumed > ring_size) {
+    util::Logger::warn("Staging ring is full, requested {} bytes with {} of {} bytes in use", size, used_bytes_,
+                       ring_size);
+    return std::unexpected(Error{
+        .msg  = "Staging ring is full",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  std::memcpy(static_cast<std::byte*>(staging_.mapped_data) + offset, src_region.data(), size);
+  staging_.buffer._p_device->statistics().count_staging_bytes(size);
+  head_ = offset + size;
+  used_bytes_ += consumed;
+  pending_bytes_ += consumed;
+
+  pending_copies_.push_back(PendingCopy{
+      .dst_buffer = dst_buffer.vk_buffer(),
+      .region =
+          vk::BufferCopy{
+              .srcOffset = offset,
+              .dstOffset = dst_offset,
+              .size      = size,
+          },
+  });
+
+  return {};
+}
+
+void StagingRingBuffer::record_pending_copies(vk::CommandBuffer cmd_buff, uint32_t frame_index) {
+  ERAY_PROFILE_FUNCTION();
+  frame_used_bytes_[frame_index] += pending_bytes_;
+  pending_bytes_ = 0;
+
+  if (pending_copies_.empty()) {
+    return;
+  }
+
+  // The memory might not be host coherent
+  vmaFlushAllocation(staging_.buffer._p_device->vma_alloc_manager().allocator(), staging_.buffer._buffer._allocation, 0,
+                     VK_WHOLE_SIZE);
+
+  std::ranges::stable_sort(pending_copies_, std::less{},
+                           [](const PendingCopy& copy) { return static_cast<VkBuffer>(copy.dst_buffer); });
+
+  auto regions = std::vector<vk::BufferCopy>();
+  for (auto begin = pending_copies_.begin(); begin != pending_copies_.end();) {
+    auto end = std::find_if(begin, pending_copies_.end(),
+                            [dst = begin->dst_buffer](const PendingCopy& copy) { return copy.dst_buffer != dst; });
+
+    regions.clear();
+    std::ranges::transform(begin, end, std::back_inserter(regions), &PendingCopy::region);
+    cmd_buff.copyBuffer(staging_.buffer.vk_buffer(), begin->dst_buffer, regions);
+    begin = end;
+  }
+  pending_copies_.clear();
+
+  // The destination buffers might be used by any kind of command, e.g. as vertex, index, uniform or storage buffers
+  auto barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eCopy,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eAllCommands,
+      .dstAccessMask = vk::AccessFlagBits2::eMemoryRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &barrier,
+  });
+}
+
+void StagingRingBuffer::begin_frame(uint32_t frame_index) {
+  // Frames finish in the submission order, so the reclaimed bytes are always the oldest ones
+  used_bytes_ -= frame_used_bytes_[frame_index];
+  frame_used_bytes_[frame_index] = 0;
+
+  if (used_bytes_ == 0) {
+    head_ = 0;
+  }
+}
+
+}  // namespace eray::vkren
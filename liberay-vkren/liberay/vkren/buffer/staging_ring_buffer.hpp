@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Persistently mapped staging buffer shared by all of the frames in flight. Uploads are bump allocated, copied
+ * with a single `memcpy` and recorded into the command buffer of the frame that submits them, so there are no
+ * temporary buffers and no CPU/GPU round trips.
+ *
+ * The memory is reused in the ring order: the bytes staged for a frame are reclaimed by `begin_frame()` once the fence
+ * of that frame has signaled. Uploads that do not fit into the free space fail, the caller might fall back to
+ * `BufferResource::write_via_staging_buffer()`.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class StagingRingBuffer {
+ public:
+  StagingRingBuffer() = delete;
+  explicit StagingRingBuffer(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the staging ring.
+   *
+   * @param device
+   * @param size_bytes Size of the ring shared by all of the frames in flight.
+   * @param frames_in_flight
+   * @return Result<StagingRingBuffer, Error>
+   */
+  [[nodiscard]] static Result<StagingRingBuffer, Error> create(Device& device, vk::DeviceSize size_bytes,
+                                                               uint32_t frames_in_flight);
+
+  /**
+   * @brief Copies the `src_region` to the ring and queues a copy to the `dst_buffer`. The copy is executed by the
+   * command buffer passed to the next `record_pending_copies()`.
+   *
+   * @param src_region
+   * @param dst_buffer Must have VK_BUFFER_USAGE_TRANSFER_DST_BIT set and outlive the frame that records the copy.
+   * @param dst_offset
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when the ring has not enough free space.
+   */
+  Result<void, Error> upload(const util::MemoryRegion& src_region, const BufferResource& dst_buffer,
+                             vk::DeviceSize dst_offset = 0);
+
+  /**
+   * @brief Records all of the queued copies (one `copyBuffer` per destination buffer) followed by a single barrier
+   * that makes the transfer writes visible to all of the later commands. Must be recorded outside of rendering.
+   *
+   * @param cmd_buff
+   * @param frame_index Frame in flight that submits the `cmd_buff`.
+   */
+  void record_pending_copies(vk::CommandBuffer cmd_buff, uint32_t frame_index);
+
+  /**
+   * @brief Reclaims the memory staged by the previous submission of the frame. Call after the fence of the frame has
+   * been waited for, before the frame is recorded.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  bool has_pending_copies() const { return !pending_copies_.empty(); }
+  vk::DeviceSize size_bytes() const { return staging_.buffer.size_bytes; }
+  vk::DeviceSize used_bytes() const { return used_bytes_; }
+
+ private:
+  struct PendingCopy {
+    vk::Buffer dst_buffer;
+    vk::BufferCopy region;
+  };
+
+  StagingRingBuffer(PersistentlyMappedBufferResource&& staging, uint32_t frames_in_flight)
+      : staging_(std::move(staging)), frame_used_bytes_(frames_in_flight, 0) {}
+
+  PersistentlyMappedBufferResource staging_ = {};
+
+  /**
+   * @brief Offset of the next allocation. The bytes in use always directly precede it (modulo the ring size).
+   *
+   */
+  vk::DeviceSize head_ = 0;
+
+  /**
+   * @brief Bytes in use, including the padding and the unused end of the ring skipped on wrap around.
+   *
+   */
+  vk::DeviceSize used_bytes_    = 0;
+  vk::DeviceSize pending_bytes_ = 0;
+
+  std::vector<vk::DeviceSize> frame_used_bytes_;
+  std::vector<PendingCopy> pending_copies_;
+};
+
+}  // namespace eray::vkren
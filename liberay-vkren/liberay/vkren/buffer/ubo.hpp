@@ -1,15 +1,21 @@
 #pragma once
+#include <cstdint>
+#include <cstring>
 #include <expected>
 #include <liberay/math/mat.hpp>
 #include <liberay/math/vec.hpp>
 #include <liberay/util/memory_region.hpp>
 #include <liberay/vkren/buffer.hpp>
 #include <liberay/vkren/device.hpp>
+#include <liberay/vkren/frame_versioned.hpp>
 
 namespace eray::vkren {
 
 /**
  * @brief Represents a persistently mapped buffer resource used as uniform buffer.
+ *
+ * @note Data rewritten every frame, e.g. per-draw uniforms, should be pushed to the `UniformRingBuffer` instead, it
+ * does not need an instance per frame in flight nor a descriptor set per object.
  */
 template <typename TUniformBuffer>
 struct MappedUniformBuffer {
@@ -69,4 +75,43 @@ struct MappedUniformBuffer {
   void mark_dirty() { _dirty = true; }
 };
 
+/**
+ * @brief Persistently mapped uniform buffer per frame in flight. The buffer of a frame is rewritten only if the data
+ * has changed since the frame was last recorded, so it can be updated without `on_frame_prepare_sync`.
+ *
+ */
+template <typename TUniformBuffer>
+struct FrameVersionedUniformBuffer {
+  using Buffers = FrameVersioned<MappedUniformBuffer<TUniformBuffer>>;
+
+  Buffers buffers = Buffers(nullptr);
+
+  static eray::vkren::Result<FrameVersionedUniformBuffer<TUniformBuffer>, eray::vkren::Error> create(
+      eray::vkren::Device& device, uint32_t frames_in_flight) {
+    auto result = Buffers::create(frames_in_flight,
+                                  [&device](uint32_t) { return MappedUniformBuffer<TUniformBuffer>::create(device); });
+    if (!result) {
+      return std::unexpected(result.error());
+    }
+
+    auto vubo    = FrameVersionedUniformBuffer<TUniformBuffer>();
+    vubo.buffers = std::move(*result);
+    return vubo;
+  }
+
+  /**
+   * @brief Writes the `data` to the buffer of the frame if it is stale. Must be called after the previous use of the
+   * frame in flight has finished, e.g. in `on_frame_prepare`.
+   */
+  void sync(uint32_t frame_index, const TUniformBuffer& data) {
+    buffers.update(frame_index, [&data](MappedUniformBuffer<TUniformBuffer>& buffer) {
+      memcpy(buffer.ubo_map, &data, sizeof(TUniformBuffer));
+    });
+  }
+
+  auto desc_buffer_info(uint32_t frame_index) const { return buffers[frame_index].desc_buffer_info(); }
+
+  void mark_dirty() { buffers.mark_dirty(); }
+};
+
 }  // namespace eray::vkren
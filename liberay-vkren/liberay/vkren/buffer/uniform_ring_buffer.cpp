@@ -0,0 +1,83 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <cassert>
+#include <cstring>
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/buffer/uniform_ring_buffer.hpp>
+#include <liberay/vkren/error.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+Result<UniformRingBuffer, Error> UniformRingBuffer::create(Device& device, vk::DeviceSize frame_size_bytes,
+                                                           uint32_t frames_in_flight) {
+  assert(frames_in_flight > 0 && "There must be at least one frame in flight");
+
+  // Partitions are aligned as well, so every dynamic offset is a multiple of the alignment
+  const auto alignment = device.physical_device().getProperties().limits.minUniformBufferOffsetAlignment;
+  frame_size_bytes     = align_up(frame_size_bytes, alignment);
+
+  auto ring = BufferResource::create_persistently_mapped_uniform_buffer(device, frame_size_bytes * frames_in_flight);
+  if (!ring) {
+    return std::unexpected(ring.error());
+  }
+
+  return UniformRingBuffer(std::move(*ring), frame_size_bytes, alignment);
+}
+
+Result<UniformAllocation, Error> UniformRingBuffer::allocate(vk::DeviceSize size_bytes) {
+  const auto offset    = align_up(head_, alignment_);
+  const auto frame_end = frame_begin() + frame_size_bytes_;
+  if (offset + size_bytes > frame_end) {
+    util::Logger::warn("Uniform ring partition is full, requested {} bytes with {} of {} bytes in use", size_bytes,
+                       used_bytes(), frame_size_bytes_);
+    return std::unexpected(Error{
+        .msg  = "Uniform ring partition is full",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  head_ = offset + size_bytes;
+  return UniformAllocation{
+      .data           = static_cast<std::byte*>(ring_.mapped_data) + offset,
+      .dynamic_offset = static_cast<uint32_t>(offset),
+  };
+}
+
+Result<uint32_t, Error> UniformRingBuffer::push(const util::MemoryRegion& src_region) {
+  auto allocation = allocate(src_region.size_bytes());
+  if (!allocation) {
+    return std::unexpected(allocation.error());
+  }
+
+  std::memcpy(allocation->data, src_region.data(), src_region.size_bytes());
+  return allocation->dynamic_offset;
+}
+
+void UniformRingBuffer::flush() const {
+  if (used_bytes() == 0) {
+    return;
+  }
+
+  // The memory might not be host coherent
+  vmaFlushAllocation(ring_.buffer._p_device->vma_alloc_manager().allocator(), ring_.buffer._buffer._allocation,
+                     frame_begin(), used_bytes());
+}
+
+void UniformRingBuffer::begin_frame(uint32_t frame_index) {
+  assert(static_cast<vk::DeviceSize>(frame_index + 1) * frame_size_bytes_ <= ring_.buffer.size_bytes &&
+         "Frame index out of bounds");
+
+  current_frame_ = frame_index;
+  head_          = frame_begin();
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Slice of the uniform ring written by the CPU. The `dynamic_offset` is passed to `bindDescriptorSets`.
+ *
+ */
+struct UniformAllocation {
+  void* data;
+  uint32_t dynamic_offset;
+};
+
+/**
+ * @brief Persistently mapped uniform buffer split into a partition per frame in flight. The uniform data of a frame is
+ * bump allocated from its partition with `minUniformBufferOffsetAlignment` and bound as a
+ * VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor, so a single descriptor set per layout serves every draw of
+ * every frame and nothing is rewritten while the application runs.
+ *
+ * The partition of a frame is reset by `begin_frame()` once the fence of the frame has signaled, the uniform data must
+ * be written again every frame it is used.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class UniformRingBuffer {
+ public:
+  UniformRingBuffer() = delete;
+  explicit UniformRingBuffer(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the uniform ring.
+   *
+   * @param device
+   * @param frame_size_bytes Size of the partition of a single frame in flight.
+   * @param frames_in_flight
+   * @return Result<UniformRingBuffer, Error>
+   */
+  [[nodiscard]] static Result<UniformRingBuffer, Error> create(Device& device, vk::DeviceSize frame_size_bytes,
+                                                               uint32_t frames_in_flight);
+
+  /**
+   * @brief Reserves an aligned slice in the partition of the current frame. The contents are undefined.
+   *
+   * @param size_bytes
+   * @return Result<UniformAllocation, Error> Fails with `MemoryAllocationFailure` when the partition is full.
+   */
+  Result<UniformAllocation, Error> allocate(vk::DeviceSize size_bytes);
+
+  /**
+   * @brief Copies the `src_region` to a new slice.
+   *
+   * @param src_region
+   * @return Result<uint32_t, Error> Dynamic offset of the slice.
+   */
+  Result<uint32_t, Error> push(const util::MemoryRegion& src_region);
+
+  template <typename TUniformBuffer>
+  Result<uint32_t, Error> push(const TUniformBuffer& data) {
+    return push(util::MemoryRegion{&data, sizeof(TUniformBuffer)});
+  }
+
+  /**
+   * @brief Makes the writes of the current frame visible to the device. Call before the frame is submitted.
+   *
+   */
+  void flush() const;
+
+  /**
+   * @brief Switches to the partition of the `frame_index`. Call after the fence of the frame has been waited for,
+   * before the frame is recorded.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Descriptor of the whole ring, to be written once to a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC binding.
+   *
+   * @param range Size of the uniform block read by the shader. Every slice bound with this descriptor must be at
+   * least that large.
+   * @return vk::DescriptorBufferInfo
+   */
+  vk::DescriptorBufferInfo desc_buffer_info(vk::DeviceSize range) const {
+    return vk::DescriptorBufferInfo{
+        .buffer = ring_.buffer.vk_buffer(),
+        .offset = 0,
+        .range  = range,
+    };
+  }
+
+  vk::DeviceSize alignment() const { return alignment_; }
+  vk::DeviceSize frame_size_bytes() const { return frame_size_bytes_; }
+  vk::DeviceSize used_bytes() const { return head_ - frame_begin(); }
+
+ private:
+  UniformRingBuffer(PersistentlyMappedBufferResource&& ring, vk::DeviceSize frame_size_bytes, vk::DeviceSize alignment)
+      : ring_(std::move(ring)), frame_size_bytes_(frame_size_bytes), alignment_(alignment) {}
+
+  vk::DeviceSize frame_begin() const { return current_frame_ * frame_size_bytes_; }
+
+  PersistentlyMappedBufferResource ring_ = {};
+  vk::DeviceSize frame_size_bytes_       = 0;
+  vk::DeviceSize alignment_              = 1;
+  vk::DeviceSize head_                   = 0;
+  uint32_t current_frame_                = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <expected>
+#include <iterator>
+#include <liberay/math/mat.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/buffer/world_matrix_buffer.hpp>
+#include <liberay/vkren/error.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+Result<WorldMatrixBuffer, Error> WorldMatrixBuffer::create(Device& device, size_t max_nodes_count) {
+  auto buffer = BufferResource::create_storage_buffer(device, max_nodes_count * sizeof(math::Mat4f));
+  if (!buffer) {
+    return std::unexpected(buffer.error());
+  }
+
+  return WorldMatrixBuffer(std::move(*buffer));
+}
+
+Result<void, Error> WorldMatrixBuffer::sync(const TransformTree& tree, StagingRingBuffer& staging) {
+  ERAY_PROFILE_FUNCTION();
+
+  synced_bytes_       = 0;
+  const auto update   = tree.update_count();
+  const auto capacity = static_cast<uint32_t>(buffer_.size_bytes / sizeof(math::Mat4f));
+
+  changed_indices_.clear();
+  if (!synced_update_ || !tree.world_matrices_changed_since(*synced_update_, changed_indices_)) {
+    if (auto result = stage(tree, staging, 0, capacity); !result) {
+      return std::unexpected(result.error());
+    }
+    synced_update_ = update;
+    return {};
+  }
+
+  // Adjacent indices are copied with a single region
+  std::ranges::sort(changed_indices_);
+  for (auto begin = changed_indices_.begin(); begin != changed_indices_.end();) {
+    auto end = std::next(begin);
+    while (end != changed_indices_.end() && *end == *std::prev(end) + 1) {
+      ++end;
+    }
+    if (auto result = stage(tree, staging, *begin, static_cast<uint32_t>(end - begin)); !result) {
+      return std::unexpected(result.error());
+    }
+    begin = end;
+  }
+
+  synced_update_ = update;
+  return {};
+}
+
+void WorldMatrixBuffer::record_write_barrier(vk::CommandBuffer cmd_buff) {
+  if (!has_staged_writes_) {
+    return;
+  }
+  has_staged_writes_ = false;
+
+  // Write after read hazards need an execution dependency only
+  auto barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eAllCommands,
+      .srcAccessMask = vk::AccessFlagBits2::eNone,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eCopy,
+      .dstAccessMask = vk::AccessFlagBits2::eNone,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &barrier,
+  });
+}
+
+Result<void, Error> WorldMatrixBuffer::stage(const TransformTree& tree, StagingRingBuffer& staging, uint32_t first,
+                                             uint32_t count) {
+  const auto& matrices = tree.local_to_world_matrices();
+  const auto size      = static_cast<vk::DeviceSize>(count) * sizeof(math::Mat4f);
+  if (auto result =
+          staging.upload(util::MemoryRegion{&matrices[first], size}, buffer_, first * sizeof(math::Mat4f));
+      !result) {
+    return std::unexpected(result.error());
+  }
+
+  synced_bytes_ += size;
+  has_staged_writes_ = true;
+  return {};
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/buffer/staging_ring_buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/scene/transform_tree.hpp>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Device local storage buffer with the `TransformTree::local_to_world_matrices()`, indexed by
+ * `FlatTree::index_of()`. Only the matrices changed since the last `sync()` (see
+ * `TransformTree::world_matrices_changed_since()`) are staged into the `StagingRingBuffer`, the adjacent ones are
+ * merged into a single copy region. All of the matrices are uploaded by the first sync and whenever the change history
+ * of the tree has been exceeded, so the ring must be able to fit all of them at once.
+ *
+ * There is a single copy of the matrices, the writes of a frame are ordered after the reads of the previous frames by
+ * `record_write_barrier()`.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class WorldMatrixBuffer {
+ public:
+  WorldMatrixBuffer() = delete;
+  explicit WorldMatrixBuffer(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the storage buffer.
+   *
+   * @param device
+   * @param max_nodes_count Must match the `TransformTree::create()` argument.
+   * @return Result<WorldMatrixBuffer, Error>
+   */
+  [[nodiscard]] static Result<WorldMatrixBuffer, Error> create(Device& device, size_t max_nodes_count);
+
+  /**
+   * @brief Stages the world matrices changed since the last successful sync. The copies are recorded by the next
+   * `StagingRingBuffer::record_pending_copies()`, which must be preceded by `record_write_barrier()`.
+   *
+   * @param tree Must be updated already.
+   * @param staging
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when the ring has not enough free space, the
+   * changes are staged again by the next sync then.
+   */
+  Result<void, Error> sync(const TransformTree& tree, StagingRingBuffer& staging);
+
+  /**
+   * @brief Makes the copies staged by `sync()` wait for the reads of the matrices by the previously recorded commands.
+   * Does nothing if nothing has been staged since the last call. Must be recorded outside of rendering.
+   *
+   * @param cmd_buff
+   */
+  void record_write_barrier(vk::CommandBuffer cmd_buff);
+
+  const BufferResource& buffer() const { return buffer_; }
+  vk::DescriptorBufferInfo desc_buffer_info() const { return buffer_.desc_buffer_info(); }
+
+  /**
+   * @brief Number of the bytes staged by the last `sync()`.
+   *
+   */
+  vk::DeviceSize synced_bytes() const { return synced_bytes_; }
+
+ private:
+  explicit WorldMatrixBuffer(BufferResource&& buffer) : buffer_(std::move(buffer)) {}
+
+  Result<void, Error> stage(const TransformTree& tree, StagingRingBuffer& staging, uint32_t first, uint32_t count);
+
+  BufferResource buffer_{};
+
+  /**
+   * @brief `TransformTree::update_count()` at the last successful sync, empty before the first one.
+   *
+   */
+  std::optional<uint64_t> synced_update_;
+  std::vector<uint32_t> changed_indices_;
+  vk::DeviceSize synced_bytes_ = 0;
+  bool has_staged_writes_      = false;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <expected>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/clustered_light_culler.hpp>
+#include <liberay/vkren/error.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+Result<ClusteredLightCuller, Error> ClusteredLightCuller::create(Device& device, vk::ShaderModule cluster_shader,
+                                                                 const LightClusterGrid& grid, uint32_t max_lights,
+                                                                 uint32_t max_light_indices) {
+  auto culler               = ClusteredLightCuller(nullptr);
+  culler.cluster_count_     = grid.cluster_count();
+  culler.max_lights_        = std::max(max_lights, 1U);
+  culler.max_light_indices_ = std::max(max_light_indices, 1U);
+
+  if (auto buffer = BufferResource::create_storage_buffer(device, culler.max_lights_ * sizeof(GpuLight))) {
+    culler.light_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(device, culler.cluster_count_ * sizeof(GpuLightCluster),
+                                                            vk::BufferUsageFlagBits::eStorageBuffer)) {
+    culler.cluster_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(device, culler.max_light_indices_ * sizeof(uint32_t),
+                                                            vk::BufferUsageFlagBits::eStorageBuffer)) {
+    culler.light_index_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer =
+          BufferResource::create_gpu_local_buffer(device, sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer)) {
+    culler.counter_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  auto layout = DescriptorSetBuilder::create(device)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .build_push_descriptor_layout();
+  if (!layout) {
+    return std::unexpected(layout.error());
+  }
+
+  auto push_constant_ranges = std::array{vk::PushConstantRange{
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .offset     = 0,
+      .size       = sizeof(PushConstants),
+  }};
+  auto pipeline = ComputePipelineBuilder::create()
+                      .with_shader(cluster_shader)
+                      .with_descriptor_set_layout(*layout)
+                      .with_push_constant_ranges(push_constant_ranges)
+                      .build(device);
+  if (!pipeline) {
+    return std::unexpected(pipeline.error());
+  }
+  culler.pipeline_ = std::move(*pipeline);
+
+  // The buffers never change, so the push descriptor writes are prepared once
+  culler.binder_ = DescriptorSetBinder::create(device);
+  culler.binder_.bind_buffer(0, culler.light_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  culler.binder_.bind_buffer(1, culler.cluster_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  culler.binder_.bind_buffer(2, culler.light_index_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  culler.binder_.bind_buffer(3, culler.counter_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+
+  culler.push_constants_.dims              = grid.dims();
+  culler.push_constants_.max_light_indices = culler.max_light_indices_;
+
+  return culler;
+}
+
+Result<void, Error> ClusteredLightCuller::upload_lights(StagingRingBuffer& staging, std::span<const GpuLight> lights,
+                                                        uint32_t directional_count) {
+  if (lights.size() > max_lights_) {
+    return std::unexpected(Error{
+        .msg  = "Clustered light culler light capacity exceeded",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+  assert(directional_count <= lights.size());
+
+  if (!lights.empty()) {
+    if (auto result = staging.upload(util::MemoryRegion{lights.data(), lights.size_bytes()}, light_buffer_, 0);
+        !result) {
+      return result;
+    }
+  }
+
+  light_count_       = static_cast<uint32_t>(lights.size());
+  directional_count_ = directional_count;
+  return {};
+}
+
+void ClusteredLightCuller::set_view(const LightClusterGrid& grid, const math::Mat4f& view) {
+  assert(grid.cluster_count() == cluster_count_ && "Cluster grid dims changed");
+
+  push_constants_.view       = view;
+  push_constants_.projection = math::Vec4f(grid.tan_half_fov_x(), grid.tan_half_fov_y(), grid.z_near(), grid.z_far());
+  push_constants_.dims       = grid.dims();
+}
+
+void ClusteredLightCuller::record_cull(vk::CommandBuffer cmd_buff) {
+  ERAY_PROFILE_FUNCTION();
+
+  // The clusters of the previous frame must have been consumed by the shading before they are overwritten, write after
+  // read hazards need an execution dependency only
+  auto war_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eFragmentShader,
+      .srcAccessMask = vk::AccessFlagBits2::eNone,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eClear | vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eNone,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &war_barrier,
+  });
+
+  cmd_buff.fillBuffer(counter_buffer_.vk_buffer(), 0, sizeof(uint32_t), 0);
+  auto clear_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eClear,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &clear_barrier,
+  });
+
+  // Every cluster is written, even with no local lights, so the shading never reads the stale counts
+  push_constants_.first_local_light = directional_count_;
+  push_constants_.local_light_count = light_count_ - directional_count_;
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline_.pipeline);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, pipeline_.layout);
+  cmd_buff.pushConstants<PushConstants>(pipeline_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants_);
+  cmd_buff.dispatch((cluster_count_ + kWorkgroupSize - 1) / kWorkgroupSize, 1, 1);
+  binder_._p_device->statistics().count_dispatches();
+
+  auto shading_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eFragmentShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &shading_barrier,
+  });
+}
+
+}  // namespace eray::vkren
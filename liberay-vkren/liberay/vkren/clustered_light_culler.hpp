@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/buffer/staging_ring_buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <liberay/vkren/scene/light_clusters.hpp>
+#include <span>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Assigns the point and spot lights to the clusters of a `LightClusterGrid` in a compute shader, one thread per
+ * cluster, so the shading iterates only the lights whose range touches the cluster of the fragment. The directional
+ * lights are kept at the front of the light buffer (see `pack_lights()`) and are applied to every fragment.
+ *
+ * The fragment shader reads three storage buffers: the `light_buffer()` with the `GpuLight`s, the `cluster_buffer()`
+ * with a `GpuLightCluster` per cluster and the `light_index_buffer()` the clusters point into. The indices are
+ * relative to the first local light, i.e. `lights[directional_count + light_indices[cluster.offset + i]]`.
+ *
+ * The compute shader is `liberay-vkren/shaders/cluster_lights.slang`, compile it with the `add_slang_shader_target()`
+ * of the binary. `record_cull()` is meant to be emitted by a render graph compute pass preceding the shading.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class ClusteredLightCuller {
+ public:
+  ClusteredLightCuller() = delete;
+  explicit ClusteredLightCuller(std::nullptr_t) {}
+
+  /**
+   * @brief Workgroup size of the cluster shader, must match the `numthreads` of `cluster_lights.slang`.
+   *
+   */
+  static constexpr uint32_t kWorkgroupSize = 64;
+
+  /**
+   * @brief Creates the pipeline and the light, cluster and index buffers.
+   *
+   * @param device
+   * @param cluster_shader Module compiled from `cluster_lights.slang`.
+   * @param grid Only the cluster count is fixed, the projection may change with `set_view()`.
+   * @param max_lights
+   * @param max_light_indices Capacity of the index list shared by all of the clusters, the lights that do not fit are
+   * dropped from the clusters.
+   * @return Result<ClusteredLightCuller, Error>
+   */
+  [[nodiscard]] static Result<ClusteredLightCuller, Error> create(Device& device, vk::ShaderModule cluster_shader,
+                                                                  const LightClusterGrid& grid, uint32_t max_lights,
+                                                                  uint32_t max_light_indices);
+
+  /**
+   * @brief Stages the packed lights, the copies are recorded by the next `StagingRingBuffer::record_pending_copies()`,
+   * which must precede `record_cull()`.
+   *
+   * @param staging
+   * @param lights Result of `pack_lights()`.
+   * @param directional_count
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when the ring has not enough free space.
+   */
+  Result<void, Error> upload_lights(StagingRingBuffer& staging, std::span<const GpuLight> lights,
+                                    uint32_t directional_count);
+
+  /**
+   * @brief Camera used by the next `record_cull()`.
+   *
+   * @param grid Must have the dims the culler was created with.
+   * @param view World to view space matrix.
+   */
+  void set_view(const LightClusterGrid& grid, const math::Mat4f& view);
+
+  /**
+   * @brief Records the cluster assignment. Must be recorded outside of rendering.
+   *
+   * @param cmd_buff
+   */
+  void record_cull(vk::CommandBuffer cmd_buff);
+
+  const BufferResource& light_buffer() const { return light_buffer_; }
+  const BufferResource& cluster_buffer() const { return cluster_buffer_; }
+  const BufferResource& light_index_buffer() const { return light_index_buffer_; }
+  uint32_t light_count() const { return light_count_; }
+  uint32_t directional_count() const { return directional_count_; }
+
+ private:
+  /**
+   * @brief Push constants of `cluster_lights.slang`.
+   *
+   */
+  struct PushConstants {
+    math::Mat4f view;
+
+    /**
+     * @brief `tan_half_fov_x`, `tan_half_fov_y`, `z_near` and `z_far` of the grid.
+     *
+     */
+    math::Vec4f projection;
+    math::Vec3u dims;
+    uint32_t first_local_light;
+    uint32_t local_light_count;
+    uint32_t max_light_indices;
+  };
+
+  Pipeline pipeline_{};
+  DescriptorSetBinder binder_{};
+
+  BufferResource light_buffer_{};
+  BufferResource cluster_buffer_{};
+  BufferResource light_index_buffer_{};
+  BufferResource counter_buffer_{};
+
+  PushConstants push_constants_{};
+  uint32_t cluster_count_     = 0;
+  uint32_t max_lights_        = 0;
+  uint32_t max_light_indices_ = 0;
+  uint32_t light_count_       = 0;
+  uint32_t directional_count_ = 0;
+};
+
+}  // namespace eray::vkren
@@ -7,14 +7,16 @@
 namespace eray::vkren {
 
 Result<void, Error> CommandManager::allocate_command_buffers(const Device& device, uint32_t thread_count,
-                                                             uint32_t buffers_per_thread) {
+                                                             uint32_t buffers_per_thread,
+                                                             vk::CommandBufferLevel level) {
   std::lock_guard<std::mutex> lock(resource_mtx_);
 
   command_buffers_.clear();
+  buffers_per_thread_ = 0;
   for (uint32_t i = 0; i < thread_count; ++i) {
     auto info = vk::CommandBufferAllocateInfo{
         .commandPool        = *command_pools_[i],
-        .level              = vk::CommandBufferLevel::ePrimary,
+        .level              = level,
         .commandBufferCount = buffers_per_thread,
     };
 
@@ -23,6 +25,7 @@ Result<void, Error> CommandManager::allocate_command_buffers(const Device& devic
         command_buffers_.emplace_back(std::move(buffer));
       }
     } else {
+      command_buffers_.clear();
       util::Logger::err("Could not allocate a command buffer");
       return std::unexpected(Error{
           .msg     = "Command Buffer allocation failure",
@@ -31,12 +34,18 @@ Result<void, Error> CommandManager::allocate_command_buffers(const Device& devic
       });
     }
   }
+  buffers_per_thread_ = buffers_per_thread;
+  level_              = level;
+
   return {};
 }
 
 Result<void, Error> CommandManager::create_thread_command_pools(const Device& device, uint32_t queue_family_index,
                                                                 uint32_t thread_count) {
   auto lock = std::lock_guard<std::mutex>(resource_mtx_);
+  // The command buffers must be freed before the pools they were allocated from
+  command_buffers_.clear();
+  buffers_per_thread_ = 0;
   command_pools_.clear();
   for (auto i = 0U; i < thread_count; ++i) {
     auto info = vk::CommandPoolCreateInfo{
@@ -69,4 +78,9 @@ vk::raii::CommandBuffer& CommandManager::command_buffer(uint32_t thread_index) {
   return command_buffers_[thread_index];
 }
 
+vk::raii::CommandBuffer& CommandManager::command_buffer(uint32_t thread_index, uint32_t buffer_index) {
+  auto lock = std::lock_guard<std::mutex>(resource_mtx_);
+  return command_buffers_[(thread_index * buffers_per_thread_) + buffer_index];
+}
+
 }  // namespace eray::vkren
@@ -9,21 +9,45 @@
 
 namespace eray::vkren {
 
+/**
+ * @brief Owns a command pool per recording thread and the command buffers allocated from them. Command buffers of the
+ * thread `i` are allocated from the pool `i`, so that the threads can record them without any synchronization. Pools
+ * must not be shared by frames in flight, use one manager per frame.
+ *
+ */
 class CommandManager {
  public:
   Result<void, Error> create_thread_command_pools(const Device& device, uint32_t queue_family_index,
                                                   uint32_t thread_count);
   vk::raii::CommandPool& command_pool(uint32_t thread_index);
 
+  /**
+   * @brief Frees the previously allocated command buffers and allocates `buffers_per_thread` buffers from each of the
+   * first `thread_count` pools.
+   *
+   * @param device
+   * @param thread_count
+   * @param buffers_per_thread
+   * @param level
+   * @return Result<void, Error>
+   */
   Result<void, Error> allocate_command_buffers(const Device& device, uint32_t thread_count,
-                                               uint32_t buffers_per_thread);
+                                               uint32_t buffers_per_thread,
+                                               vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary);
 
   vk::raii::CommandBuffer& command_buffer(uint32_t thread_index);
+  vk::raii::CommandBuffer& command_buffer(uint32_t thread_index, uint32_t buffer_index);
+
+  uint32_t thread_count() const { return static_cast<uint32_t>(command_pools_.size()); }
+  uint32_t buffers_per_thread() const { return buffers_per_thread_; }
+  vk::CommandBufferLevel level() const { return level_; }
 
  private:
   std::mutex resource_mtx_;
   std::vector<vk::raii::CommandPool> command_pools_;
   std::vector<vk::raii::CommandBuffer> command_buffers_;
+  uint32_t buffers_per_thread_  = 0;
+  vk::CommandBufferLevel level_ = vk::CommandBufferLevel::ePrimary;
 };
 
 }  // namespace eray::vkren
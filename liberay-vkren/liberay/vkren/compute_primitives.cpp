@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <expected>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/compute_primitives.hpp>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+constexpr uint32_t kRadix          = 256;
+constexpr uint32_t kMaxSortPasses  = 8;
+constexpr uint32_t kMaxGroupCountX = 65535;
+
+constexpr uint32_t group_count_of(uint32_t count, uint32_t group_size) { return (count + group_size - 1) / group_size; }
+
+/**
+ * @brief Uints of the sort state, matches the layout of `compute_primitives.slang`.
+ *
+ */
+constexpr vk::DeviceSize sort_state_size(uint32_t partition_count) {
+  return (static_cast<vk::DeviceSize>(kMaxSortPasses) * kRadix) + kMaxSortPasses +
+         (static_cast<vk::DeviceSize>(kMaxSortPasses) * partition_count * kRadix);
+}
+
+}  // namespace
+
+Result<ComputePrimitives, Error> ComputePrimitives::create(Device& device, vk::ShaderModule shader,
+                                                           uint32_t max_count) {
+  assert(max_count > 0 && "Compute primitives must support at least a single element");
+
+  auto primitives       = ComputePrimitives(nullptr);
+  primitives.max_count_ = max_count;
+
+  const auto block_count     = group_count_of(max_count, kScanBlockSize);
+  const auto partition_count = group_count_of(max_count, kSortTileSize);
+
+  const auto buffers = std::array{
+      std::pair{&primitives.block_sums_, static_cast<vk::DeviceSize>(block_count) * sizeof(uint32_t)},
+      std::pair{&primitives.scanned_flags_, static_cast<vk::DeviceSize>(max_count) * sizeof(uint32_t)},
+      std::pair{&primitives.sort_keys_, static_cast<vk::DeviceSize>(max_count) * sizeof(uint64_t)},
+      std::pair{&primitives.sort_values_, static_cast<vk::DeviceSize>(max_count) * sizeof(uint32_t)},
+      std::pair{&primitives.sort_state_, sort_state_size(partition_count) * sizeof(uint32_t)},
+  };
+  for (const auto& [buffer, size_bytes] : buffers) {
+    if (auto result = BufferResource::create_storage_buffer(device, size_bytes)) {
+      *buffer = std::move(*result);
+    } else {
+      return std::unexpected(result.error());
+    }
+  }
+
+  auto layout = DescriptorSetBuilder::create(device)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .build_push_descriptor_layout();
+  if (!layout) {
+    return std::unexpected(layout.error());
+  }
+
+  auto push_constant_ranges = std::array{vk::PushConstantRange{
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .offset     = 0,
+      .size       = sizeof(PushConstants),
+  }};
+
+  // In the order of the `Kernel`s
+  auto entry_points = std::array{
+      std::pair{shader, "scanReduce"},
+      std::pair{shader, "scanBlockSums"},
+      std::pair{shader, "scanApply"},
+      std::pair{shader, "compactScatter"},
+      std::pair{shader, "sortHistogram"},
+      std::pair{shader, "sortScanHistogram"},
+      std::pair{shader, "sortOnesweep"},
+      std::pair{shader, "segmentedReduce"},
+  };
+  auto pipelines = ComputePipelineBuilder::create()
+                       .with_descriptor_set_layout(*layout)
+                       .with_push_constant_ranges(push_constant_ranges)
+                       .with_name("Compute primitives")
+                       .build_for_each_shader(device, entry_points);
+  if (!pipelines) {
+    return std::unexpected(pipelines.error());
+  }
+  primitives.pipelines_ = std::move(*pipelines);
+  primitives.binder_    = DescriptorSetBinder::create(device);
+
+  return primitives;
+}
+
+void ComputePrimitives::record_exclusive_scan(vk::CommandBuffer cmd_buff, const RenderGraph& graph,
+                                              ShaderStorageHandle input, ShaderStorageHandle output, uint32_t count) {
+  ERAY_PROFILE_FUNCTION();
+  record_scan(cmd_buff, graph.shader_storage_buffer(input).buffer.desc_buffer_info(),
+              graph.shader_storage_buffer(output).buffer.desc_buffer_info(), count);
+}
+
+void ComputePrimitives::record_compact(vk::CommandBuffer cmd_buff, const RenderGraph& graph, ShaderStorageHandle input,
+                                       ShaderStorageHandle flags, ShaderStorageHandle output,
+                                       ShaderStorageHandle count_output, uint32_t count) {
+  ERAY_PROFILE_FUNCTION();
+  assert(count > 0 && "Compaction of no elements has no last element to write the count");
+
+  const auto flags_info = graph.shader_storage_buffer(flags).buffer.desc_buffer_info();
+  record_scan(cmd_buff, flags_info, scanned_flags_.desc_buffer_info(), count);
+
+  dispatch(cmd_buff, Kernel::CompactScatter,
+           Bindings{
+               .input      = graph.shader_storage_buffer(input).buffer.desc_buffer_info(),
+               .output     = graph.shader_storage_buffer(output).buffer.desc_buffer_info(),
+               .aux_input  = flags_info,
+               .aux_output = graph.shader_storage_buffer(count_output).buffer.desc_buffer_info(),
+               .scratch    = scanned_flags_.desc_buffer_info(),
+           },
+           PushConstants{.count = count}, group_count_of(count, kWorkgroupSize));
+  compute_barrier(cmd_buff);
+}
+
+void ComputePrimitives::record_sort(vk::CommandBuffer cmd_buff, const RenderGraph& graph, ShaderStorageHandle keys,
+                                    std::optional<ShaderStorageHandle> values, uint32_t count, SortKeyWidth width) {
+  ERAY_PROFILE_FUNCTION();
+  assert(count <= max_count_ && "Sort exceeds the capacity of the compute primitives");
+  if (count == 0) {
+    return;
+  }
+
+  // The state of the previous sort may still be read by its last pass
+  auto clear_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eClear,
+      .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &clear_barrier});
+
+  const auto partition_count = group_count_of(count, kSortTileSize);
+  cmd_buff.fillBuffer(sort_state_.vk_buffer(), 0, sort_state_size(partition_count) * sizeof(uint32_t), 0);
+
+  clear_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eClear,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &clear_barrier});
+
+  const auto key_words  = static_cast<uint32_t>(width);
+  const auto pass_count = key_words * 4;
+  auto push_constants   = PushConstants{
+        .count       = count,
+        .block_count = partition_count,
+        .key_words   = key_words,
+        .has_values  = values ? 1U : 0U,
+  };
+
+  // The passes alternate between the sorted buffers and the scratch ones, the unused value bindings are the scratch
+  const auto keys_info   = graph.shader_storage_buffer(keys).buffer.desc_buffer_info();
+  const auto values_info = values ? graph.shader_storage_buffer(*values).buffer.desc_buffer_info()
+                                  : sort_values_.desc_buffer_info();
+  auto bindings          = Bindings{
+               .input      = keys_info,
+               .output     = sort_keys_.desc_buffer_info(),
+               .aux_input  = values_info,
+               .aux_output = sort_values_.desc_buffer_info(),
+               .scratch    = sort_state_.desc_buffer_info(),
+  };
+
+  dispatch(cmd_buff, Kernel::SortHistogram, bindings, push_constants, partition_count);
+  compute_barrier(cmd_buff);
+  dispatch(cmd_buff, Kernel::SortScanHistogram, bindings, push_constants, pass_count);
+  compute_barrier(cmd_buff);
+
+  for (auto pass = 0U; pass < pass_count; ++pass) {
+    push_constants.pass = pass;
+    dispatch(cmd_buff, Kernel::SortOnesweep, bindings, push_constants, partition_count);
+    compute_barrier(cmd_buff);
+    std::swap(bindings.input, bindings.output);
+    std::swap(bindings.aux_input, bindings.aux_output);
+  }
+}
+
+void ComputePrimitives::record_segmented_reduce(vk::CommandBuffer cmd_buff, const RenderGraph& graph,
+                                                ShaderStorageHandle input, ShaderStorageHandle segment_offsets,
+                                                ShaderStorageHandle output, uint32_t segment_count) {
+  ERAY_PROFILE_FUNCTION();
+  if (segment_count == 0) {
+    return;
+  }
+
+  // A workgroup walks the segments with the stride of the group count
+  const auto group_count = std::min(segment_count, kMaxGroupCountX);
+  dispatch(cmd_buff, Kernel::SegmentedReduce,
+           Bindings{
+               .input      = graph.shader_storage_buffer(input).buffer.desc_buffer_info(),
+               .output     = graph.shader_storage_buffer(output).buffer.desc_buffer_info(),
+               .aux_input  = graph.shader_storage_buffer(segment_offsets).buffer.desc_buffer_info(),
+               .aux_output = block_sums_.desc_buffer_info(),
+               .scratch    = block_sums_.desc_buffer_info(),
+           },
+           PushConstants{.count = segment_count, .block_count = group_count}, group_count);
+  compute_barrier(cmd_buff);
+}
+
+void ComputePrimitives::record_scan(vk::CommandBuffer cmd_buff, vk::DescriptorBufferInfo input,
+                                    vk::DescriptorBufferInfo output, uint32_t count) {
+  assert(count <= max_count_ && "Scan exceeds the capacity of the compute primitives");
+  if (count == 0) {
+    return;
+  }
+
+  const auto block_count    = group_count_of(count, kScanBlockSize);
+  const auto push_constants = PushConstants{.count = count, .block_count = block_count};
+  const auto bindings       = Bindings{
+            .input      = input,
+            .output     = output,
+            .aux_input  = block_sums_.desc_buffer_info(),
+            .aux_output = block_sums_.desc_buffer_info(),
+            .scratch    = block_sums_.desc_buffer_info(),
+  };
+
+  dispatch(cmd_buff, Kernel::ScanReduce, bindings, push_constants, block_count);
+  compute_barrier(cmd_buff);
+  dispatch(cmd_buff, Kernel::ScanBlockSums, bindings, push_constants, 1);
+  compute_barrier(cmd_buff);
+  dispatch(cmd_buff, Kernel::ScanApply, bindings, push_constants, block_count);
+  compute_barrier(cmd_buff);
+}
+
+void ComputePrimitives::dispatch(vk::CommandBuffer cmd_buff, Kernel kernel, const Bindings& bindings,
+                                 const PushConstants& push_constants, uint32_t group_count) {
+  binder_.clear();
+  binder_.bind_buffer(0, bindings.input, vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(1, bindings.output, vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(2, bindings.aux_input, vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(3, bindings.aux_output, vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(4, bindings.scratch, vk::DescriptorType::eStorageBuffer);
+
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, pipelines_.pipeline[static_cast<size_t>(kernel)]);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, pipelines_.layout);
+  cmd_buff.pushConstants<PushConstants>(pipelines_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants);
+  cmd_buff.dispatch(group_count, 1, 1);
+  binder_._p_device->statistics().count_dispatches();
+}
+
+void ComputePrimitives::compute_barrier(vk::CommandBuffer cmd_buff) {
+  auto barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &barrier,
+  });
+}
+
+}  // namespace eray::vkren
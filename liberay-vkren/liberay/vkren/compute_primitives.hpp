@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <liberay/vkren/render_graph.hpp>
+#include <optional>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Width of the keys of `ComputePrimitives::record_sort()`, the 64-bit keys are stored as two uint words with
+ * the low word first.
+ *
+ */
+enum class SortKeyWidth : uint32_t {
+  Bits32 = 1,
+  Bits64 = 2,
+};
+
+/**
+ * @brief Data-parallel building blocks of the GPU-driven passes over the uint shader storage buffers of a
+ * `RenderGraph`: the exclusive scan, the stream compaction, the stable radix sort and the segmented sum. The element
+ * counts are known on the CPU.
+ *
+ * All of the primitives are the entry points of `liberay-vkren/shaders/compute_primitives.slang`, compile it with the
+ * `add_slang_shader_target()` of the binary, with the entry points `scanReduce`, `scanBlockSums`, `scanApply`,
+ * `compactScatter`, `sortHistogram`, `sortScanHistogram`, `sortOnesweep` and `segmentedReduce`.
+ *
+ * The calls are meant to be emitted by a render graph compute pass that depends on the buffers, e.g.:
+ * @code
+ * ComputePassBuilder::create(graph)
+ *     .with_buffer_dependency(keys, vk::AccessFlagBits2::eShaderStorageWrite)
+ *     .with_buffer_dependency(indices, vk::AccessFlagBits2::eShaderStorageWrite)
+ *     .on_emit([&](const RenderGraph& graph, vk::CommandBuffer& cmd) {
+ *       primitives.record_sort(cmd, graph, keys, indices, count);
+ *     })
+ *     .build();
+ * @endcode
+ * The dispatches of a call are ordered with barriers, as well as the following compute shader reads of the results.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class ComputePrimitives {
+ public:
+  ComputePrimitives() = delete;
+  explicit ComputePrimitives(std::nullptr_t) {}
+
+  /**
+   * @brief Workgroup size of all of the entry points, must match the `numthreads` of `compute_primitives.slang`.
+   *
+   */
+  static constexpr uint32_t kWorkgroupSize = 256;
+
+  /**
+   * @brief Elements scanned by a workgroup.
+   *
+   */
+  static constexpr uint32_t kScanBlockSize = kWorkgroupSize * 4;
+
+  /**
+   * @brief Keys sorted by a workgroup in a pass of the radix sort.
+   *
+   */
+  static constexpr uint32_t kSortTileSize = kWorkgroupSize * 8;
+
+  /**
+   * @brief Creates the pipelines and the scratch buffers.
+   *
+   * @param device
+   * @param shader Module compiled from `compute_primitives.slang`.
+   * @param max_count Maximum number of the elements (or the keys) of a call.
+   * @return Result<ComputePrimitives, Error>
+   */
+  [[nodiscard]] static Result<ComputePrimitives, Error> create(Device& device, vk::ShaderModule shader,
+                                                               uint32_t max_count);
+
+  /**
+   * @brief Writes the sum of the preceding input elements to every output element.
+   *
+   * @param cmd_buff
+   * @param graph
+   * @param input
+   * @param output May be the `input`.
+   * @param count At most `max_count()`.
+   */
+  void record_exclusive_scan(vk::CommandBuffer cmd_buff, const RenderGraph& graph, ShaderStorageHandle input,
+                             ShaderStorageHandle output, uint32_t count);
+
+  /**
+   * @brief Copies the input elements with a non-zero flag to the front of the output, in their order.
+   *
+   * @param cmd_buff
+   * @param graph
+   * @param input
+   * @param flags An uint per element, 0 or 1.
+   * @param output Must not be the `input`.
+   * @param count_output Receives the number of the kept elements in its first uint.
+   * @param count At least 1 and at most `max_count()`.
+   */
+  void record_compact(vk::CommandBuffer cmd_buff, const RenderGraph& graph, ShaderStorageHandle input,
+                      ShaderStorageHandle flags, ShaderStorageHandle output, ShaderStorageHandle count_output,
+                      uint32_t count);
+
+  /**
+   * @brief Sorts the keys in place in the ascending order, along with an uint value per key, e.g. the indices of the
+   * elements the keys were computed from. The keys that are equal keep their order.
+   *
+   * @param cmd_buff
+   * @param graph
+   * @param keys
+   * @param values Optional.
+   * @param count At most `max_count()`.
+   * @param width
+   */
+  void record_sort(vk::CommandBuffer cmd_buff, const RenderGraph& graph, ShaderStorageHandle keys,
+                   std::optional<ShaderStorageHandle> values, uint32_t count,
+                   SortKeyWidth width = SortKeyWidth::Bits32);
+
+  /**
+   * @brief Writes the sum of the input elements of every segment to the output. The segment `i` spans the elements
+   * `[offsets[i], offsets[i + 1])`, a workgroup sums a segment, so the segments should not be tiny.
+   *
+   * @param cmd_buff
+   * @param graph
+   * @param input
+   * @param segment_offsets `segment_count + 1` uints.
+   * @param output An uint per segment.
+   * @param segment_count
+   */
+  void record_segmented_reduce(vk::CommandBuffer cmd_buff, const RenderGraph& graph, ShaderStorageHandle input,
+                               ShaderStorageHandle segment_offsets, ShaderStorageHandle output,
+                               uint32_t segment_count);
+
+  uint32_t max_count() const { return max_count_; }
+
+ private:
+  /**
+   * @brief Entry points of `compute_primitives.slang`, in the order of the pipelines.
+   *
+   */
+  enum class Kernel : uint8_t {
+    ScanReduce,
+    ScanBlockSums,
+    ScanApply,
+    CompactScatter,
+    SortHistogram,
+    SortScanHistogram,
+    SortOnesweep,
+    SegmentedReduce,
+  };
+
+  /**
+   * @brief Push constants of `compute_primitives.slang`.
+   *
+   */
+  struct PushConstants {
+    uint32_t count       = 0;
+    uint32_t block_count = 0;
+    uint32_t pass        = 0;
+    uint32_t key_words   = 1;
+    uint32_t has_values  = 0;
+  };
+
+  /**
+   * @brief Buffers of the bindings 0 to 4: the input, the output, the auxiliary input, the auxiliary output and the
+   * scratch buffer. The unused bindings are bound to a scratch buffer.
+   *
+   */
+  struct Bindings {
+    vk::DescriptorBufferInfo input;
+    vk::DescriptorBufferInfo output;
+    vk::DescriptorBufferInfo aux_input;
+    vk::DescriptorBufferInfo aux_output;
+    vk::DescriptorBufferInfo scratch;
+  };
+
+  void dispatch(vk::CommandBuffer cmd_buff, Kernel kernel, const Bindings& bindings,
+                const PushConstants& push_constants, uint32_t group_count);
+
+  void record_scan(vk::CommandBuffer cmd_buff, vk::DescriptorBufferInfo input, vk::DescriptorBufferInfo output,
+                   uint32_t count);
+
+  static void compute_barrier(vk::CommandBuffer cmd_buff);
+
+  Pipelines pipelines_;
+  DescriptorSetBinder binder_{};
+
+  BufferResource block_sums_{};
+
+  /**
+   * @brief Exclusive scan of the compaction flags.
+   *
+   */
+  BufferResource scanned_flags_{};
+
+  /**
+   * @brief Ping-pong buffers of the radix sort passes, the even number of the passes ends in the sorted buffers.
+   *
+   */
+  BufferResource sort_keys_{};
+  BufferResource sort_values_{};
+
+  /**
+   * @brief Digit histograms, partition counters and lookback states of the radix sort, see `compute_primitives.slang`.
+   *
+   */
+  BufferResource sort_state_{};
+
+  uint32_t max_count_ = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,167 @@
+#include <cassert>
+#include <liberay/vkren/deletion_queue.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <numeric>
+#include <utility>
+
+namespace eray::vkren {
+
+FrameDeletionQueue FrameDeletionQueue::create(vk::Device device, VmaAllocationManager& alloc_manager,
+                                              uint32_t frames_in_flight) {
+  assert(frames_in_flight > 0 && "There must be at least one frame in flight");
+  return FrameDeletionQueue(device, alloc_manager, frames_in_flight);
+}
+
+FrameDeletionQueue::FrameDeletionQueue(FrameDeletionQueue&& other) noexcept
+    : device_(other.device_),
+      p_alloc_manager_(std::exchange(other.p_alloc_manager_, nullptr)),
+      p_descriptor_set_cache_(std::exchange(other.p_descriptor_set_cache_, nullptr)),
+      buckets_(std::move(other.buckets_)),
+      current_frame_(other.current_frame_) {}
+
+FrameDeletionQueue& FrameDeletionQueue::operator=(FrameDeletionQueue&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  if (p_alloc_manager_ != nullptr) {
+    flush_all();
+  }
+  device_                 = other.device_;
+  p_alloc_manager_        = std::exchange(other.p_alloc_manager_, nullptr);
+  p_descriptor_set_cache_ = std::exchange(other.p_descriptor_set_cache_, nullptr);
+  buckets_                = std::move(other.buckets_);
+  current_frame_          = other.current_frame_;
+
+  return *this;
+}
+
+FrameDeletionQueue::~FrameDeletionQueue() {
+  if (p_alloc_manager_ != nullptr) {
+    flush_all();
+  }
+}
+
+void FrameDeletionQueue::push(VmaBuffer buffer) {
+  if (p_descriptor_set_cache_ != nullptr) {
+    p_descriptor_set_cache_->evict(buffer.vk_buffer);
+  }
+  current().buffers.push_back(buffer);
+}
+
+void FrameDeletionQueue::push(vk::ImageView image_view) {
+  if (p_descriptor_set_cache_ != nullptr) {
+    p_descriptor_set_cache_->evict(image_view);
+  }
+  current().image_views.push_back(image_view);
+}
+
+void FrameDeletionQueue::push(vk::Sampler sampler) {
+  if (p_descriptor_set_cache_ != nullptr) {
+    p_descriptor_set_cache_->evict(sampler);
+  }
+  current().samplers.push_back(sampler);
+}
+
+void FrameDeletionQueue::push(VmaRaiiBuffer&& buffer) {
+  if (buffer._alloc_manager == nullptr || buffer._vk_handle == VK_NULL_HANDLE) {
+    return;
+  }
+  assert(buffer._alloc_manager == p_alloc_manager_ && "Buffer is managed by a different allocation manager");
+
+  // The handle owned by the raii object is about to be reset, it must not be patched by the defragmentation anymore
+  if (buffer._allocation != nullptr) {
+    buffer._alloc_manager->track_buffer_handle(buffer._allocation, nullptr);
+  }
+  push(VmaBuffer{.vk_buffer = buffer._vk_handle, .allocation = buffer._allocation});
+
+  buffer._alloc_manager = nullptr;
+  buffer._allocation    = nullptr;
+  buffer._vk_handle     = VK_NULL_HANDLE;
+}
+
+void FrameDeletionQueue::push(VmaRaiiImage&& image) {
+  if (image._alloc_manager == nullptr || image._vk_handle == VK_NULL_HANDLE) {
+    return;
+  }
+  assert(image._alloc_manager == p_alloc_manager_ && "Image is managed by a different allocation manager");
+
+  push(VmaImage{.vk_image = image._vk_handle, .allocation = image._allocation});
+
+  image._alloc_manager = nullptr;
+  image._allocation    = nullptr;
+  image._vk_handle     = VK_NULL_HANDLE;
+}
+
+void FrameDeletionQueue::begin_frame(uint32_t frame_index) {
+  assert(frame_index < buckets_.size() && "Frame index out of bounds");
+
+  current_frame_ = frame_index;
+  flush(buckets_[frame_index]);
+}
+
+void FrameDeletionQueue::flush_all() {
+  for (auto& bucket : buckets_) {
+    flush(bucket);
+  }
+}
+
+size_t FrameDeletionQueue::pending_count() const {
+  return std::accumulate(buckets_.begin(), buckets_.end(), size_t{0}, [](size_t count, const Bucket& bucket) {
+    return count + bucket.buffers.size() + bucket.images.size() + bucket.image_views.size() + bucket.samplers.size() +
+           bucket.pipelines.size() + bucket.pipeline_layouts.size() + bucket.descriptor_pools.size() +
+           bucket.acceleration_structures.size() + bucket.deletors.size();
+  });
+}
+
+void FrameDeletionQueue::flush(Bucket& bucket) {
+  // The objects are destroyed in the reverse order of their dependencies. The arrays are cleared, not released, so
+  // in the steady state the queue does not allocate.
+  for (auto pipeline : bucket.pipelines) {
+    device_.destroyPipeline(pipeline);
+  }
+  bucket.pipelines.clear();
+
+  for (auto pipeline_layout : bucket.pipeline_layouts) {
+    device_.destroyPipelineLayout(pipeline_layout);
+  }
+  bucket.pipeline_layouts.clear();
+
+  for (auto descriptor_pool : bucket.descriptor_pools) {
+    device_.destroyDescriptorPool(descriptor_pool);
+  }
+  bucket.descriptor_pools.clear();
+
+  for (auto sampler : bucket.samplers) {
+    device_.destroySampler(sampler);
+  }
+  bucket.samplers.clear();
+
+  for (auto image_view : bucket.image_views) {
+    device_.destroyImageView(image_view);
+  }
+  bucket.image_views.clear();
+
+  // The acceleration structures live in the buffers
+  for (auto acceleration_structure : bucket.acceleration_structures) {
+    device_.destroyAccelerationStructureKHR(acceleration_structure);
+  }
+  bucket.acceleration_structures.clear();
+
+  for (auto image : bucket.images) {
+    p_alloc_manager_->delete_image(image);
+  }
+  bucket.images.clear();
+
+  for (auto buffer : bucket.buffers) {
+    p_alloc_manager_->delete_buffer(buffer);
+  }
+  bucket.buffers.clear();
+
+  for (auto& deletor : std::ranges::reverse_view(bucket.deletors)) {
+    deletor();
+  }
+  bucket.deletors.clear();
+}
+
+}  // namespace eray::vkren
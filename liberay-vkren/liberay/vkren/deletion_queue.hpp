@@ -1,11 +1,21 @@
 #pragma once
 
+#include <cstdint>
 #include <deque>
 #include <functional>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/vma_allocation_manager.hpp>
+#include <liberay/vkren/vma_object.hpp>
+#include <liberay/vkren/vma_raii_object.hpp>
 #include <ranges>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
 
 namespace eray::vkren {
 
+class DescriptorSetCache;
+
 class DeletionQueue {
  public:
   DeletionQueue() = default;
@@ -33,12 +43,117 @@ class DeletionQueue {
 
  private:
   // NOTE: Doing callbacks like this is inneficient at scale, because we are storing whole std::functions for every
-  // object we are deleting, which is not going to be optimal. For the amount of objects we will use in this tutorial,
-  // its going to be fine. but if you need to delete thousands of objects and want them deleted faster, a better
-  // implementation would be to store arrays of vulkan handles of various types such as VkImage, VkBuffer, and so on.
-  // And then delete those from a loop.
+  // object we are deleting. Resources released while the application is running should go through the
+  // `FrameDeletionQueue`, which stores arrays of the handles instead.
 
   std::deque<std::function<void()>> deletors_;
 };
 
+/**
+ * @brief Defers the destruction of the resources until the GPU is done with them. The handles are stored in typed
+ * arrays, one set of arrays (bucket) per frame in flight. The objects pushed while a frame is recorded are destroyed
+ * by `begin_frame()` of the same frame in flight, once its fence has signaled. As the frames are submitted to the same
+ * queue, none of the earlier frames can still use them at that point.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class FrameDeletionQueue {
+ public:
+  FrameDeletionQueue() = delete;
+  explicit FrameDeletionQueue(std::nullptr_t) {}
+
+  FrameDeletionQueue(FrameDeletionQueue&& other) noexcept;
+  FrameDeletionQueue& operator=(FrameDeletionQueue&& other) noexcept;
+  FrameDeletionQueue(const FrameDeletionQueue&)            = delete;
+  FrameDeletionQueue& operator=(const FrameDeletionQueue&) = delete;
+
+  ~FrameDeletionQueue();
+
+  [[nodiscard]] static FrameDeletionQueue create(vk::Device device, VmaAllocationManager& alloc_manager,
+                                                 uint32_t frames_in_flight);
+
+  void push(VmaBuffer buffer);
+  void push(VmaImage image) { current().images.push_back(image); }
+  void push(vk::ImageView image_view);
+  void push(vk::Sampler sampler);
+  void push(vk::Pipeline pipeline) { current().pipelines.push_back(pipeline); }
+  void push(vk::PipelineLayout pipeline_layout) { current().pipeline_layouts.push_back(pipeline_layout); }
+  void push(vk::DescriptorPool descriptor_pool) { current().descriptor_pools.push_back(descriptor_pool); }
+  void push(vk::AccelerationStructureKHR acceleration_structure) {
+    current().acceleration_structures.push_back(acceleration_structure);
+  }
+
+  /**
+   * @brief Takes over the ownership of the buffer, the `buffer` is left empty.
+   *
+   * @param buffer
+   */
+  void push(VmaRaiiBuffer&& buffer);
+
+  /**
+   * @brief Takes over the ownership of the image, the `image` is left empty.
+   *
+   * @param image
+   */
+  void push(VmaRaiiImage&& image);
+
+  /**
+   * @brief Fallback for the objects that have no typed array. Invoked after all of the typed handles of the bucket are
+   * destroyed, the last added deletor is invoked first.
+   *
+   * @param function
+   */
+  void push_deletor(std::function<void()>&& function) { current().deletors.push_back(std::move(function)); }
+
+  /**
+   * @brief The cached descriptor sets that reference the pushed buffers, image views and samplers are evicted from the
+   * `cache` right away. The cache must outlive the queue or be detached with `nullptr`.
+   *
+   * @param cache
+   */
+  void set_descriptor_set_cache(observer_ptr<DescriptorSetCache> cache) { p_descriptor_set_cache_ = cache; }
+
+  /**
+   * @brief Destroys the objects pushed during the previous recording of the frame and starts collecting the objects of
+   * the new recording. Call after the fence of the frame has been waited for.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Destroys all of the pushed objects. The device must be idle.
+   *
+   */
+  void flush_all();
+
+  size_t pending_count() const;
+
+ private:
+  struct Bucket {
+    std::vector<VmaBuffer> buffers;
+    std::vector<VmaImage> images;
+    std::vector<vk::ImageView> image_views;
+    std::vector<vk::Sampler> samplers;
+    std::vector<vk::Pipeline> pipelines;
+    std::vector<vk::PipelineLayout> pipeline_layouts;
+    std::vector<vk::DescriptorPool> descriptor_pools;
+    std::vector<vk::AccelerationStructureKHR> acceleration_structures;
+    std::vector<std::function<void()>> deletors;
+  };
+
+  FrameDeletionQueue(vk::Device device, VmaAllocationManager& alloc_manager, uint32_t frames_in_flight)
+      : device_(device), p_alloc_manager_(&alloc_manager), buckets_(frames_in_flight) {}
+
+  Bucket& current() { return buckets_[current_frame_]; }
+  void flush(Bucket& bucket);
+
+  vk::Device device_;
+  observer_ptr<VmaAllocationManager> p_alloc_manager_       = nullptr;
+  observer_ptr<DescriptorSetCache> p_descriptor_set_cache_ = nullptr;
+  std::vector<Bucket> buckets_;
+  uint32_t current_frame_ = 0;
+};
+
 }  // namespace eray::vkren
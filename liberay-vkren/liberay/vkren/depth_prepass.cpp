@@ -0,0 +1,56 @@
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/depth_prepass.hpp>
+#include <utility>
+#include <vulkan/vulkan_enums.hpp>
+
+namespace eray::vkren {
+
+RenderPassBuilder DepthPrepass::prepass_builder(RenderGraph& render_graph, RenderPassAttachmentHandle depth,
+                                                PassGraphEmitFunc on_emit) {
+  auto builder = RenderPassBuilder::create(render_graph, render_graph.attachment(depth).samples);
+  if (depth.type() == ImageAttachmentType::DepthStencil) {
+    builder.with_depth_stencil_attachment(depth, vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore);
+  } else {
+    builder.with_depth_attachment(depth, vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore);
+  }
+  builder.with_name("Depth pre-pass").on_emit(std::move(on_emit));
+  return builder;
+}
+
+Result<DepthPrepass, Error> DepthPrepass::emplace(RenderGraph& render_graph, RenderPassAttachmentHandle depth,
+                                                  RelativeExtent extent, PassGraphEmitFunc on_emit) {
+  auto prepass = DepthPrepass(nullptr);
+  TRY_UNWRAP_ASSIGN(prepass.render_pass_, prepass_builder(render_graph, depth, std::move(on_emit)).build(extent));
+  prepass.depth_ = depth;
+  return prepass;
+}
+
+Result<DepthPrepass, Error> DepthPrepass::emplace(RenderGraph& render_graph, RenderPassAttachmentHandle depth,
+                                                  vk::Extent2D extent, PassGraphEmitFunc on_emit) {
+  auto prepass = DepthPrepass(nullptr);
+  TRY_UNWRAP_ASSIGN(prepass.render_pass_, prepass_builder(render_graph, depth, std::move(on_emit))
+                                              .build(extent.width, extent.height));
+  prepass.depth_ = depth;
+  return prepass;
+}
+
+Result<ComputePassHandle, Error> DepthPrepass::emplace_hiz_build(RenderGraph& render_graph, HiZPyramid& hiz) const {
+  // The pyramid is built from the complete depth of the frame, the main pass only tests against it
+  return ComputePassBuilder::create(render_graph)
+      .with_image_dependency(depth_, vk::PipelineStageFlagBits2::eComputeShader,
+                             vk::AccessFlagBits2::eShaderSampledRead)
+      .with_name("Hi-Z build")
+      .on_emit([&hiz, depth = depth_](const RenderGraph& graph, vk::CommandBuffer& cmd_buff) {
+        hiz.record_build(cmd_buff, graph.attachment(depth).view);
+      })
+      .build();
+}
+
+RenderPassBuilder& DepthPrepass::with_prepass_depth(RenderPassBuilder& main_pass) const {
+  if (depth_.type() == ImageAttachmentType::DepthStencil) {
+    return main_pass.with_depth_stencil_attachment(depth_, vk::AttachmentLoadOp::eLoad, vk::AttachmentStoreOp::eStore);
+  }
+  return main_pass.with_depth_attachment(depth_, vk::AttachmentLoadOp::eLoad, vk::AttachmentStoreOp::eStore);
+}
+
+}  // namespace eray::vkren
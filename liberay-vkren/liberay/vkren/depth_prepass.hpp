@@ -0,0 +1,87 @@
+#pragma once
+
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/hiz_pyramid.hpp>
+#include <liberay/vkren/render_graph.hpp>
+#include <vulkan/vulkan.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Depth-only render pass drawn before the main pass, so that the expensive fragment shaders of the main pass
+ * run once per pixel. The pre-pass clears and writes the depth attachment, the main pass loads it and tests it for
+ * equality without writing (`GraphicsPipelineBuilder::with_depth_prepass_test()`). The pipelines of the pre-pass are
+ * derived from the ones of the main pass with `GraphicsPipelineBuilder::depth_only_variant()`, ideally reading only the
+ * positions of the geometry arena vertices (`VertexLayout::position_attribute_descriptions()`):
+ * @code
+ * auto prepass = DepthPrepass::emplace(graph, depth, extent, [&](const RenderGraph&, vk::CommandBuffer& cmd) {
+ *   cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, depth_pipeline.pipeline);
+ *   arena.bind(cmd);
+ *   // the draws of the main pass
+ * }).or_panic("Could not create the depth pre-pass");
+ * prepass.emplace_hiz_build(graph, hiz).or_panic("Could not create the Hi-Z build");
+ * // the occlusion culling of the main pass, e.g. `IndirectDrawCuller`
+ * auto main_pass = prepass.with_prepass_depth(RenderPassBuilder::create(graph).with_color_attachment(color))
+ *                      .on_emit(...)
+ *                      .build(extent);
+ * @endcode
+ * The passes are compiled in the order they are emplaced, the Hi-Z build and the culling must be emplaced between the
+ * pre-pass and the main pass.
+ *
+ */
+class DepthPrepass {
+ public:
+  DepthPrepass() = delete;
+  explicit DepthPrepass(std::nullptr_t) {}
+
+  /**
+   * @brief Emplaces the pre-pass rendering to the depth attachment.
+   *
+   * @param render_graph
+   * @param depth Depth or depth stencil attachment shared with the main pass. It must be readable to build the Hi-Z
+   * pyramid, unless it is transient.
+   * @param extent Render area of the main pass.
+   * @param on_emit Records the depth-only draws.
+   * @return Result<DepthPrepass, Error>
+   */
+  [[nodiscard]] static Result<DepthPrepass, Error> emplace(RenderGraph& render_graph, RenderPassAttachmentHandle depth,
+                                                           RelativeExtent extent, PassGraphEmitFunc on_emit);
+  [[nodiscard]] static Result<DepthPrepass, Error> emplace(RenderGraph& render_graph, RenderPassAttachmentHandle depth,
+                                                           vk::Extent2D extent, PassGraphEmitFunc on_emit);
+
+  /**
+   * @brief Emplaces a compute pass building the Hi-Z pyramid from the depth of the pre-pass, so the occlusion culling
+   * of the main pass tests against the depth of the current frame. The pyramid must have been created with the extent
+   * of the depth attachment.
+   *
+   * @param render_graph
+   * @param hiz Must outlive the render graph passes.
+   * @return Result<ComputePassHandle, Error>
+   */
+  Result<ComputePassHandle, Error> emplace_hiz_build(RenderGraph& render_graph, HiZPyramid& hiz) const;
+
+  /**
+   * @brief Attaches the depth of the pre-pass to the main pass, loaded and stored.
+   *
+   * @param main_pass
+   * @return RenderPassBuilder&
+   */
+  RenderPassBuilder& with_prepass_depth(RenderPassBuilder& main_pass) const;
+
+  RenderPassHandle render_pass() const { return render_pass_; }
+  RenderPassAttachmentHandle depth() const { return depth_; }
+
+ private:
+  /**
+   * @brief The pre-pass is multisampled like the depth attachment.
+   *
+   */
+  static RenderPassBuilder prepass_builder(RenderGraph& render_graph, RenderPassAttachmentHandle depth,
+                                           PassGraphEmitFunc on_emit);
+
+  RenderPassHandle render_pass_{};
+  RenderPassAttachmentHandle depth_{};
+};
+
+}  // namespace eray::vkren
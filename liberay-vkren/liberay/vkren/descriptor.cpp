@@ -1,10 +1,14 @@
 #include <vulkan/vulkan_core.h>
 
 #include <algorithm>
+#include <cassert>
 #include <expected>
+#include <liberay/util/hash_combine.hpp>
 #include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/descriptor_buffer.hpp>
 #include <liberay/vkren/device.hpp>
 #include <liberay/vkren/error.hpp>
+#include <tuple>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_raii.hpp>
@@ -180,10 +184,127 @@ Result<std::vector<vk::DescriptorSet>, Error> DescriptorAllocator::allocate_many
 
   allocated_descriptors_.insert(allocated_descriptors_.end(), std::make_move_iterator(ds_opt->begin()),
                                 std::make_move_iterator(ds_opt->end()));
+  p_device_->statistics().count_descriptor_allocations(count);
 
   return result;
 }
 
+TransientDescriptorAllocator TransientDescriptorAllocator::create(
+    Device& device, uint32_t sets_per_pool, std::span<const DescriptorPoolSizeRatio> pool_size_ratios) {
+  return TransientDescriptorAllocator(device, sets_per_pool, pool_size_ratios);
+}
+
+Result<vk::DescriptorPool, Error> TransientDescriptorAllocator::current_pool() {
+  if (!ready_pools_.empty()) {
+    return *ready_pools_.back();
+  }
+
+  auto pool_sizes = std::vector<vk::DescriptorPoolSize>();
+  pool_sizes.reserve(ratios_.size());
+  for (const auto& ratio : ratios_) {
+    pool_sizes.push_back(vk::DescriptorPoolSize{
+        .type            = ratio.type,
+        .descriptorCount = std::max(1U, static_cast<uint32_t>(static_cast<float>(sets_per_pool_) * ratio.ratio)),
+    });
+  }
+
+  // There is no VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, the sets are only freed with the pool reset
+  auto create_info = vk::DescriptorPoolCreateInfo{
+      .maxSets       = sets_per_pool_,
+      .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+      .pPoolSizes    = pool_sizes.data(),
+  };
+
+  auto pool_opt = Result((*p_device_)->createDescriptorPool(create_info));
+  if (!pool_opt) {
+    return std::unexpected(Error{
+        .msg     = "Descriptor Pool creation failed",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = pool_opt.error(),
+    });
+  }
+
+  sets_per_pool_ = std::min<uint32_t>(sets_per_pool_ + sets_per_pool_ / 2, 4092);
+  ready_pools_.push_back(std::move(*pool_opt));
+  return *ready_pools_.back();
+}
+
+Result<vk::DescriptorSet, Error> TransientDescriptorAllocator::allocate(vk::DescriptorSetLayout layout, void* p_next) {
+  auto alloc_info = vk::DescriptorSetAllocateInfo{
+      .pNext              = p_next,
+      .descriptorSetCount = 1,
+      .pSetLayouts        = &layout,
+  };
+
+  // The current pool might run out of memory, then the allocation is retried once with a fresh pool
+  auto result = vk::Result::eSuccess;
+  for (auto attempt = 0; attempt < 2; ++attempt) {
+    auto pool = current_pool();
+    if (!pool) {
+      return std::unexpected(pool.error());
+    }
+
+    alloc_info.descriptorPool = *pool;
+    auto ds                   = vk::DescriptorSet{};
+    result                    = vk::Device{**p_device_}.allocateDescriptorSets(&alloc_info, &ds);
+    if (result == vk::Result::eSuccess) {
+      p_device_->statistics().count_descriptor_allocations();
+      return ds;
+    }
+    if (result != vk::Result::eErrorOutOfPoolMemory && result != vk::Result::eErrorFragmentedPool) {
+      break;
+    }
+
+    // The pool is retired until the reset, the retry takes another ready pool or creates a new one
+    full_pools_.push_back(std::move(ready_pools_.back()));
+    ready_pools_.pop_back();
+  }
+
+  return std::unexpected(Error{
+      .msg     = "Descriptor Sets creation failure",
+      .code    = ErrorCode::VulkanObjectCreationFailure{},
+      .vk_code = result,
+  });
+}
+
+void TransientDescriptorAllocator::reset() {
+  for (auto& pool : ready_pools_) {
+    pool.reset();
+  }
+  for (auto& pool : full_pools_) {
+    pool.reset();
+    ready_pools_.push_back(std::move(pool));
+  }
+  full_pools_.clear();
+}
+
+FrameDescriptorAllocator FrameDescriptorAllocator::create(Device& device, uint32_t frames_in_flight,
+                                                          uint32_t thread_count, uint32_t sets_per_pool,
+                                                          std::span<const DescriptorPoolSizeRatio> pool_size_ratios) {
+  assert(frames_in_flight > 0 && thread_count > 0 && "There must be at least one frame in flight and one thread");
+
+  auto default_ratios = std::vector<DescriptorPoolSizeRatio>();
+  if (pool_size_ratios.empty()) {
+    default_ratios   = DescriptorPoolSizeRatio::create_default();
+    pool_size_ratios = default_ratios;
+  }
+
+  auto allocators = std::vector<TransientDescriptorAllocator>();
+  allocators.reserve(static_cast<size_t>(frames_in_flight) * thread_count);
+  for (auto i = 0U; i < frames_in_flight * thread_count; ++i) {
+    allocators.push_back(TransientDescriptorAllocator::create(device, sets_per_pool, pool_size_ratios));
+  }
+
+  return FrameDescriptorAllocator(std::move(allocators), thread_count);
+}
+
+void FrameDescriptorAllocator::begin_frame(uint32_t frame_index) {
+  current_frame_ = frame_index;
+  for (auto t = 0U; t < thread_count_; ++t) {
+    get(t).reset();
+  }
+}
+
 void DescriptorSetBinder::bind_sampler(uint32_t binding, vk::Sampler sampler) {
   bind_image(binding, VK_NULL_HANDLE, sampler, vk::ImageLayout::eUndefined, vk::DescriptorType::eSampler);
 }
@@ -197,12 +318,13 @@ void DescriptorSetBinder::bind_combined_image_sampler(uint32_t binding, vk::Imag
   bind_image(binding, image, sampler, layout, vk::DescriptorType::eCombinedImageSampler);
 }
 
-void DescriptorSetBinder::bind_storage_image(uint32_t binding, vk::ImageView image, vk::ImageLayout layout) {
-  bind_image(binding, image, VK_NULL_HANDLE, layout, vk::DescriptorType::eStorageImage);
+void DescriptorSetBinder::bind_storage_image(uint32_t binding, vk::ImageView image, vk::ImageLayout layout,
+                                             uint32_t array_element) {
+  bind_image(binding, image, VK_NULL_HANDLE, layout, vk::DescriptorType::eStorageImage, array_element);
 }
 
 void DescriptorSetBinder::bind_image(uint32_t binding, vk::ImageView image, vk::Sampler sampler, vk::ImageLayout layout,
-                                     vk::DescriptorType type) {
+                                     vk::DescriptorType type, uint32_t array_element) {
   auto& info = image_infos.emplace_back(vk::DescriptorImageInfo{
       .sampler     = sampler,
       .imageView   = image,
@@ -213,6 +335,7 @@ void DescriptorSetBinder::bind_image(uint32_t binding, vk::ImageView image, vk::
       .sType           = vk::StructureType::eWriteDescriptorSet,
       .dstSet          = VK_NULL_HANDLE,
       .dstBinding      = binding,
+      .dstArrayElement = array_element,
       .descriptorCount = 1,
       .descriptorType  = type,
       .pImageInfo      = &info,
@@ -259,14 +382,167 @@ void DescriptorSetBinder::apply(vk::DescriptorSet ds) {
   (*_p_device)->updateDescriptorSets(writes, nullptr);
 }
 
-DescriptorSetLayoutInfo DescriptorSetLayoutInfo::create(std::vector<vk::DescriptorSetLayoutBinding>&& bindings) {
-  auto dsl  = DescriptorSetLayoutInfo(std::move(bindings));
+DescriptorSetContents DescriptorSetContents::create(vk::DescriptorSetLayout layout, const DescriptorSetBinder& binder) {
+  auto entries = std::vector<Entry>();
+  entries.reserve(binder.writes.size());
+  for (const auto& write : binder.writes) {
+    auto entry = Entry{
+        .binding       = write.dstBinding,
+        .array_element = write.dstArrayElement,
+        .type          = write.descriptorType,
+        .buffer        = VK_NULL_HANDLE,
+        .offset        = 0,
+        .range         = 0,
+        .image_view    = VK_NULL_HANDLE,
+        .sampler       = VK_NULL_HANDLE,
+        .image_layout  = vk::ImageLayout::eUndefined,
+    };
+    if (write.pBufferInfo != nullptr) {
+      entry.buffer = write.pBufferInfo->buffer;
+      entry.offset = write.pBufferInfo->offset;
+      entry.range  = write.pBufferInfo->range;
+    }
+    if (write.pImageInfo != nullptr) {
+      entry.image_view   = write.pImageInfo->imageView;
+      entry.sampler      = write.pImageInfo->sampler;
+      entry.image_layout = write.pImageInfo->imageLayout;
+    }
+    entries.push_back(entry);
+  }
+
+  // Stable, so when a binding is written twice the later write still wins, as in `vkUpdateDescriptorSets`
+  std::ranges::stable_sort(entries, [](const auto& a, const auto& b) {
+    return std::tie(a.binding, a.array_element) < std::tie(b.binding, b.array_element);
+  });
+
+  auto contents  = DescriptorSetContents(layout, std::move(entries));
+  contents._hash = contents.generate_hash();
+  return contents;
+}
+
+bool DescriptorSetContents::references(vk::Buffer buffer) const {
+  return std::ranges::any_of(entries, [buffer](const auto& entry) { return entry.buffer == buffer; });
+}
+
+bool DescriptorSetContents::references(vk::ImageView image_view) const {
+  return std::ranges::any_of(entries, [image_view](const auto& entry) { return entry.image_view == image_view; });
+}
+
+bool DescriptorSetContents::references(vk::Sampler sampler) const {
+  return std::ranges::any_of(entries, [sampler](const auto& entry) { return entry.sampler == sampler; });
+}
+
+size_t DescriptorSetContents::generate_hash() const {
+  auto result = std::hash<VkDescriptorSetLayout>()(static_cast<VkDescriptorSetLayout>(layout));
+  for (const auto& entry : entries) {
+    util::hash_combine(result, entry.binding);
+    util::hash_combine(result, entry.array_element);
+    util::hash_combine(result, static_cast<uint32_t>(entry.type));
+    util::hash_combine(result, static_cast<VkBuffer>(entry.buffer));
+    util::hash_combine(result, entry.offset);
+    util::hash_combine(result, entry.range);
+    util::hash_combine(result, static_cast<VkImageView>(entry.image_view));
+    util::hash_combine(result, static_cast<VkSampler>(entry.sampler));
+    util::hash_combine(result, static_cast<uint32_t>(entry.image_layout));
+  }
+  return result;
+}
+
+DescriptorSetCache DescriptorSetCache::create(DescriptorAllocator& allocator, uint32_t frames_in_flight) {
+  assert(frames_in_flight > 0 && "There must be at least one frame in flight");
+  return DescriptorSetCache(allocator, frames_in_flight);
+}
+
+Result<vk::DescriptorSet, Error> DescriptorSetCache::get_or_apply(DescriptorSetBinder& binder,
+                                                                  vk::DescriptorSetLayout layout) {
+  auto contents = DescriptorSetContents::create(layout, binder);
+  if (auto it = sets_.find(contents); it != sets_.end()) {
+    ++hit_count_;
+    return it->second;
+  }
+  ++miss_count_;
+
+  auto ds = vk::DescriptorSet{};
+  if (auto& free_sets = free_sets_[layout]; !free_sets.empty()) {
+    ds = free_sets.back();
+    free_sets.pop_back();
+  } else {
+    auto ds_opt = p_allocator_->allocate(layout);
+    if (!ds_opt) {
+      return std::unexpected(ds_opt.error());
+    }
+    ds = *ds_opt;
+  }
+
+  binder.apply(ds);
+  sets_.emplace(std::move(contents), ds);
+  return ds;
+}
+
+template <typename THandle>
+size_t DescriptorSetCache::evict_referencing(THandle handle) {
+  if (!handle) {
+    return 0;
+  }
+
+  auto& retired = retired_sets_[current_frame_];
+  return std::erase_if(sets_, [handle, &retired](const auto& entry) {
+    if (!entry.first.references(handle)) {
+      return false;
+    }
+    retired.push_back(RetiredSet{.layout = entry.first.layout, .descriptor_set = entry.second});
+    return true;
+  });
+}
+
+size_t DescriptorSetCache::evict(vk::Buffer buffer) { return evict_referencing(buffer); }
+
+size_t DescriptorSetCache::evict(vk::ImageView image_view) { return evict_referencing(image_view); }
+
+size_t DescriptorSetCache::evict(vk::Sampler sampler) { return evict_referencing(sampler); }
+
+void DescriptorSetCache::begin_frame(uint32_t frame_index) {
+  assert(frame_index < retired_sets_.size() && "Frame index out of bounds");
+
+  current_frame_ = frame_index;
+  for (const auto& retired : retired_sets_[frame_index]) {
+    free_sets_[retired.layout].push_back(retired.descriptor_set);
+  }
+  retired_sets_[frame_index].clear();
+}
+
+void DescriptorSetCache::clear() {
+  for (const auto& [contents, ds] : sets_) {
+    free_sets_[contents.layout].push_back(ds);
+  }
+  sets_.clear();
+
+  for (auto& retired_sets : retired_sets_) {
+    for (const auto& retired : retired_sets) {
+      free_sets_[retired.layout].push_back(retired.descriptor_set);
+    }
+    retired_sets.clear();
+  }
+}
+
+void DescriptorSetBinder::push(vk::CommandBuffer cmd_buff, vk::PipelineBindPoint bind_point, vk::PipelineLayout layout,
+                               uint32_t set) {
+  for (auto& write : writes) {
+    write.dstSet = VK_NULL_HANDLE;
+  }
+
+  cmd_buff.pushDescriptorSet(bind_point, layout, set, writes);
+}
+
+DescriptorSetLayoutInfo DescriptorSetLayoutInfo::create(std::span<const vk::DescriptorSetLayoutBinding> bindings,
+                                                        vk::DescriptorSetLayoutCreateFlags flags) {
+  auto dsl  = DescriptorSetLayoutInfo(bindings, flags);
   dsl._hash = dsl.generate_hash();
   return dsl;
 }
 
 bool DescriptorSetLayoutInfo::operator==(const DescriptorSetLayoutInfo& other) const {
-  if (other.bindings.size() != bindings.size()) {
+  if (other.bindings.size() != bindings.size() || other.flags != flags) {
     return false;
   }
 
@@ -293,7 +569,7 @@ size_t DescriptorSetLayoutInfo::generate_hash() const {
   using std::hash;
   using std::size_t;
 
-  size_t result = hash<size_t>()(bindings.size());
+  size_t result = hash<size_t>()(bindings.size()) ^ hash<uint32_t>()(static_cast<uint32_t>(flags));
 
   for (const vk::DescriptorSetLayoutBinding& b : bindings) {
     size_t binding_hash = b.binding | (static_cast<uint32_t>(b.descriptorType) << 8) | (b.descriptorCount << 16) |
@@ -305,11 +581,36 @@ size_t DescriptorSetLayoutInfo::generate_hash() const {
   return result;
 }
 
-DescriptorSetBinder DescriptorSetBinder::create(Device& device) {
+PipelineLayoutInfo PipelineLayoutInfo::create(std::vector<vk::DescriptorSetLayout>&& set_layouts,
+                                              std::vector<vk::PushConstantRange>&& push_constant_ranges) {
+  auto info  = PipelineLayoutInfo(std::move(set_layouts), std::move(push_constant_ranges));
+  info._hash = info.generate_hash();
+  return info;
+}
+
+bool PipelineLayoutInfo::operator==(const PipelineLayoutInfo& other) const {
+  return set_layouts == other.set_layouts && push_constant_ranges == other.push_constant_ranges;
+}
+
+size_t PipelineLayoutInfo::generate_hash() const {
+  auto result = std::hash<size_t>()(set_layouts.size());
+  for (const auto& layout : set_layouts) {
+    util::hash_combine(result, static_cast<VkDescriptorSetLayout>(layout));
+  }
+  for (const auto& range : push_constant_ranges) {
+    util::hash_combine(result, static_cast<uint32_t>(range.stageFlags));
+    util::hash_combine(result, range.offset);
+    util::hash_combine(result, range.size);
+  }
+
+  return result;
+}
+
+DescriptorSetBinder DescriptorSetBinder::create(Device& device, std::pmr::memory_resource* resource) {
   return DescriptorSetBinder{
-      .image_infos  = {},
-      .buffer_infos = {},
-      .writes       = {},
+      .image_infos  = std::pmr::deque<vk::DescriptorImageInfo>(resource),
+      .buffer_infos = std::pmr::deque<vk::DescriptorBufferInfo>(resource),
+      .writes       = std::pmr::vector<vk::WriteDescriptorSet>(resource),
       ._p_device    = &device,
   };
 }
@@ -327,7 +628,7 @@ Result<vk::DescriptorSetLayout, Error> DescriptorSetLayoutManager::create_layout
   const auto input_bindings = std::span{create_info.pBindings, create_info.bindingCount};
   const auto is_sorted      = std::ranges::is_sorted(input_bindings, binding_comparer);
 
-  auto layout_info = DescriptorSetLayoutInfo::create(std::ranges::to<std::vector>(input_bindings));
+  auto layout_info = DescriptorSetLayoutInfo::create(input_bindings, create_info.flags);
   if (!is_sorted) {
     std::ranges::sort(layout_info.bindings, binding_comparer);
   }
@@ -355,7 +656,45 @@ Result<vk::DescriptorSetLayout, Error> DescriptorSetLayoutManager::create_layout
       });
 }
 
-void DescriptorSetLayoutManager::destroy() { _layout_cache.clear(); }
+Result<vk::DescriptorSetLayout, Error> DescriptorSetLayoutManager::create_push_descriptor_layout(
+    vk::DescriptorSetLayoutCreateInfo create_info) {
+  create_info.flags |= vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptor;
+  return create_layout(create_info);
+}
+
+Result<vk::PipelineLayout, Error> DescriptorSetLayoutManager::create_pipeline_layout(
+    std::span<const vk::DescriptorSetLayout> set_layouts, std::span<const vk::PushConstantRange> push_constant_ranges) {
+  auto layout_info = PipelineLayoutInfo::create(std::ranges::to<std::vector>(set_layouts),
+                                                std::ranges::to<std::vector>(push_constant_ranges));
+  if (auto it = _pipeline_layout_cache.find(layout_info); it != _pipeline_layout_cache.end()) {
+    return *it->second;
+  }
+
+  auto create_info = vk::PipelineLayoutCreateInfo{
+      .setLayoutCount         = static_cast<uint32_t>(layout_info.set_layouts.size()),
+      .pSetLayouts            = layout_info.set_layouts.data(),
+      .pushConstantRangeCount = static_cast<uint32_t>(layout_info.push_constant_ranges.size()),
+      .pPushConstantRanges    = layout_info.push_constant_ranges.data(),
+  };
+
+  auto layout_opt = (*_p_device)->createPipelineLayout(create_info);
+  if (!layout_opt) {
+    return std::unexpected(Error{
+        .msg     = "Pipeline Layout creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = layout_opt.error(),
+    });
+  }
+
+  auto [it, _] = _pipeline_layout_cache.emplace(std::move(layout_info), std::move(*layout_opt));
+  return *it->second;
+}
+
+void DescriptorSetLayoutManager::destroy() {
+  // Pipeline layouts reference the set layouts
+  _pipeline_layout_cache.clear();
+  _layout_cache.clear();
+}
 
 DescriptorSetBuilder DescriptorSetBuilder::create(DescriptorSetLayoutManager& layout_manager,
                                                   DescriptorAllocator& allocator) {
@@ -363,7 +702,9 @@ DescriptorSetBuilder DescriptorSetBuilder::create(DescriptorSetLayoutManager& la
 }
 
 DescriptorSetBuilder DescriptorSetBuilder::create(Device& device) {
-  return DescriptorSetBuilder(device.dsl_manager(), device.dsl_allocator());
+  auto builder     = DescriptorSetBuilder(device.dsl_manager(), device.dsl_allocator());
+  builder._backend = device.descriptor_backend();
+  return builder;
 }
 
 DescriptorSetBuilder::DescriptorSetBuilder(DescriptorSetLayoutManager& layout_manager, DescriptorAllocator& allocator)
@@ -384,11 +725,20 @@ DescriptorSetBuilder& DescriptorSetBuilder::with_binding(vk::DescriptorType type
   return *this;
 }
 
-Result<DescriptorSetBuilder::DescriptorSet, Error> DescriptorSetBuilder::build() {
-  auto layout = vk::DescriptorSetLayoutCreateInfo{
+vk::DescriptorSetLayoutCreateInfo DescriptorSetBuilder::layout_create_info() const {
+  return vk::DescriptorSetLayoutCreateInfo{
+      .flags        = _backend == DescriptorBackend::DescriptorBuffer
+                          ? vk::DescriptorSetLayoutCreateFlagBits::eDescriptorBufferEXT
+                          : vk::DescriptorSetLayoutCreateFlags{},
       .bindingCount = static_cast<uint32_t>(bindings.size()),
       .pBindings    = bindings.data(),
   };
+}
+
+Result<DescriptorSetBuilder::DescriptorSet, Error> DescriptorSetBuilder::build() {
+  assert(_backend == DescriptorBackend::DescriptorSets && "Use build(DescriptorBuffer&) with the descriptor buffers");
+
+  auto layout = layout_create_info();
   return _dsl_manager->create_layout(layout).and_then([this](auto l) -> std::expected<DescriptorSet, Error> {
     return _allocator->allocate(l).transform([l](auto dsl) {
       return DescriptorSet{
@@ -400,11 +750,9 @@ Result<DescriptorSetBuilder::DescriptorSet, Error> DescriptorSetBuilder::build()
 }
 
 Result<DescriptorSetBuilder::DescriptorSets, Error> DescriptorSetBuilder::build_many(size_t count) {
-  auto layout = vk::DescriptorSetLayoutCreateInfo{
-      .bindingCount = static_cast<uint32_t>(bindings.size()),
-      .pBindings    = bindings.data(),
-  };
+  assert(_backend == DescriptorBackend::DescriptorSets && "Use build(DescriptorBuffer&) with the descriptor buffers");
 
+  auto layout = layout_create_info();
   return _dsl_manager->create_layout(layout).and_then([this, count](auto l) -> std::expected<DescriptorSets, Error> {
     return _allocator->allocate_many(l, count).transform([l](std::vector<vk::DescriptorSet>&& ds_vec) {
       return DescriptorSets{
@@ -415,12 +763,25 @@ Result<DescriptorSetBuilder::DescriptorSets, Error> DescriptorSetBuilder::build_
   });
 }
 
+Result<DescriptorBufferSet, Error> DescriptorSetBuilder::build(DescriptorBuffer& descriptor_buffer) {
+  assert(_backend == DescriptorBackend::DescriptorBuffer && "Descriptor buffers require the descriptor buffer backend");
+
+  auto layout = layout_create_info();
+  return _dsl_manager->create_layout(layout).and_then(
+      [&descriptor_buffer](auto l) { return descriptor_buffer.allocate(l); });
+}
+
 Result<vk::DescriptorSetLayout, Error> DescriptorSetBuilder::build_layout_only() {
+  auto layout = layout_create_info();
+  return _dsl_manager->create_layout(layout);
+}
+
+Result<vk::DescriptorSetLayout, Error> DescriptorSetBuilder::build_push_descriptor_layout() {
   auto layout = vk::DescriptorSetLayoutCreateInfo{
       .bindingCount = static_cast<uint32_t>(bindings.size()),
       .pBindings    = bindings.data(),
   };
-  return _dsl_manager->create_layout(layout);
+  return _dsl_manager->create_push_descriptor_layout(layout);
 }
 
 }  // namespace eray::vkren
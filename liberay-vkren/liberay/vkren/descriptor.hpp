@@ -1,9 +1,15 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <deque>
+#include <liberay/util/flat_hash_map.hpp>
+#include <liberay/util/small_vector.hpp>
 #include <liberay/vkren/common.hpp>
+#include <memory_resource>
+#include <span>
 #include <unordered_map>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
@@ -13,6 +19,19 @@
 namespace eray::vkren {
 
 class Device;
+class DescriptorBuffer;
+struct DescriptorBufferSet;
+
+/**
+ * @brief Selects how the descriptors are provided to the shaders. With `DescriptorSets` the sets are allocated from
+ * the pools and updated with `vkUpdateDescriptorSets`. With `DescriptorBuffer` (VK_EXT_descriptor_buffer) the
+ * descriptors are written straight into a buffer and bound by their offsets, see `DescriptorBuffer`.
+ *
+ */
+enum class DescriptorBackend : uint8_t {
+  DescriptorSets   = 0,
+  DescriptorBuffer = 1,
+};
 
 struct DescriptorPoolSizeRatio {
   vk::DescriptorType type;
@@ -92,13 +111,142 @@ class DescriptorAllocator {
   observer_ptr<Device> p_device_{};
 };
 
+/**
+ * @brief Growable allocator of descriptor sets that live for a single frame. The sets are never freed individually,
+ * `reset()` returns all of them at once with `vkResetDescriptorPool`, so the allocation is O(1) and does not leak.
+ *
+ * @warning Not synchronized, use one instance per recording thread. The sets must not be used after `reset()`.
+ *
+ */
+class TransientDescriptorAllocator {
+ public:
+  TransientDescriptorAllocator() = delete;
+  explicit TransientDescriptorAllocator(std::nullptr_t) {}
+
+  TransientDescriptorAllocator(const TransientDescriptorAllocator&)                = delete;
+  TransientDescriptorAllocator(TransientDescriptorAllocator&&) noexcept            = default;
+  TransientDescriptorAllocator& operator=(const TransientDescriptorAllocator&)     = delete;
+  TransientDescriptorAllocator& operator=(TransientDescriptorAllocator&&) noexcept = default;
+  ~TransientDescriptorAllocator()                                                  = default;
+
+  /**
+   * @brief Creates the allocator, the pools are created on demand.
+   *
+   * @param device
+   * @param sets_per_pool Sets of the first pool, the next pools grow by a half.
+   * @param pool_size_ratios
+   * @return TransientDescriptorAllocator
+   */
+  static TransientDescriptorAllocator create(Device& device, uint32_t sets_per_pool,
+                                             std::span<const DescriptorPoolSizeRatio> pool_size_ratios);
+
+  Result<vk::DescriptorSet, Error> allocate(vk::DescriptorSetLayout layout, void* p_next = nullptr);
+
+  /**
+   * @brief Resets all of the pools. Call only when the GPU does not use any of the allocated sets.
+   *
+   */
+  void reset();
+
+  size_t pool_count() const { return full_pools_.size() + ready_pools_.size(); }
+
+ private:
+  TransientDescriptorAllocator(Device& device, uint32_t sets_per_pool,
+                               std::span<const DescriptorPoolSizeRatio> pool_size_ratios)
+      : ratios_(pool_size_ratios.begin(), pool_size_ratios.end()), sets_per_pool_(sets_per_pool), p_device_(&device) {}
+
+  Result<vk::DescriptorPool, Error> current_pool();
+
+  std::vector<DescriptorPoolSizeRatio> ratios_;
+
+  /**
+   * @brief Pools that ran out of memory since the last reset. The last of the ready pools is the current one.
+   *
+   */
+  std::vector<vk::raii::DescriptorPool> full_pools_;
+  std::vector<vk::raii::DescriptorPool> ready_pools_;
+  uint32_t sets_per_pool_{};
+
+  observer_ptr<Device> p_device_{};
+};
+
+/**
+ * @brief Transient descriptor allocators of every frame in flight and every recording thread. The allocators of a frame
+ * are reset by `begin_frame()` once the fence of the frame has signaled.
+ *
+ */
+class FrameDescriptorAllocator {
+ public:
+  FrameDescriptorAllocator() = delete;
+  explicit FrameDescriptorAllocator(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the allocators.
+   *
+   * @param device
+   * @param frames_in_flight
+   * @param thread_count Number of the threads that allocate the sets in parallel while a frame is recorded.
+   * @param sets_per_pool
+   * @param pool_size_ratios When empty, `DescriptorPoolSizeRatio::create_default()` is used.
+   * @return FrameDescriptorAllocator
+   */
+  static FrameDescriptorAllocator create(Device& device, uint32_t frames_in_flight, uint32_t thread_count = 1,
+                                         uint32_t sets_per_pool                                    = 256,
+                                         std::span<const DescriptorPoolSizeRatio> pool_size_ratios = {});
+
+  /**
+   * @brief Resets the allocators of the frame, all of the sets allocated when the frame was recorded previously are
+   * freed.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Allocator of the current frame, owned by the thread with the `thread_index`.
+   *
+   * @param thread_index
+   * @return TransientDescriptorAllocator&
+   */
+  TransientDescriptorAllocator& get(uint32_t thread_index = 0) {
+    return allocators_[current_frame_ * thread_count_ + thread_index];
+  }
+
+  Result<vk::DescriptorSet, Error> allocate(vk::DescriptorSetLayout layout, uint32_t thread_index = 0) {
+    return get(thread_index).allocate(layout);
+  }
+
+  uint32_t thread_count() const { return thread_count_; }
+
+ private:
+  FrameDescriptorAllocator(std::vector<TransientDescriptorAllocator>&& allocators, uint32_t thread_count)
+      : allocators_(std::move(allocators)), thread_count_(thread_count) {}
+
+  /**
+   * @brief Allocators of the frame `f` and thread `t` are stored at `f * thread_count + t`.
+   *
+   */
+  std::vector<TransientDescriptorAllocator> allocators_;
+  uint32_t thread_count_  = 0;
+  uint32_t current_frame_ = 0;
+};
+
 struct DescriptorSetBinder {
-  std::deque<vk::DescriptorImageInfo> image_infos;
-  std::deque<vk::DescriptorBufferInfo> buffer_infos;
-  std::vector<vk::WriteDescriptorSet> writes;
+  std::pmr::deque<vk::DescriptorImageInfo> image_infos;
+  std::pmr::deque<vk::DescriptorBufferInfo> buffer_infos;
+  std::pmr::vector<vk::WriteDescriptorSet> writes;
   observer_ptr<Device> _p_device;
 
-  static DescriptorSetBinder create(Device& device);
+  /**
+   * @brief Creates the binder, the writes are allocated from the `resource`.
+   *
+   * @param device
+   * @param resource E.g. `VulkanApplicationContext::frame_arena` for the binders that live for a single frame. A binder
+   * assigned to an existing one allocates from the resource of the latter.
+   * @return DescriptorSetBinder
+   */
+  static DescriptorSetBinder create(Device& device,
+                                    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
   /**
    * @brief Calls the `bind_image` function with VK_DESCRIPTOR_TYPE_SAMPLER type.
@@ -133,8 +281,9 @@ struct DescriptorSetBinder {
    * @param binding
    * @param image
    * @param layout
+   * @param array_element Element of an arrayed binding.
    */
-  void bind_storage_image(uint32_t binding, vk::ImageView image, vk::ImageLayout layout);
+  void bind_storage_image(uint32_t binding, vk::ImageView image, vk::ImageLayout layout, uint32_t array_element = 0);
 
   /**
    * @brief Generalized image write. It's abstracted by `write_sampler`, `write_sampled_image`,
@@ -145,9 +294,10 @@ struct DescriptorSetBinder {
    * @param sampler
    * @param layout
    * @param type
+   * @param array_element Element of an arrayed binding.
    */
   void bind_image(uint32_t binding, vk::ImageView image, vk::Sampler sampler, vk::ImageLayout layout,
-                  vk::DescriptorType type);
+                  vk::DescriptorType type, uint32_t array_element = 0);
 
   void bind_buffer(uint32_t binding, vk::Buffer buffer, size_t size, size_t offset, vk::DescriptorType type);
   void bind_buffer(uint32_t binding, vk::DescriptorBufferInfo info, vk::DescriptorType type);
@@ -158,6 +308,161 @@ struct DescriptorSetBinder {
     apply(ds);
     clear();
   }
+
+  /**
+   * @brief Records the writes as push descriptors (`vkCmdPushDescriptorSet`), no descriptor set is allocated or
+   * updated. The set layout must be created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT, see
+   * `DescriptorSetBuilder::build_push_descriptor_layout()`. The writes are recorded into the command buffer, so the
+   * binder might be cleared or reused right after.
+   *
+   * @param cmd_buff
+   * @param bind_point
+   * @param layout Pipeline layout.
+   * @param set Set number of the push descriptor layout in the pipeline layout.
+   */
+  void push(vk::CommandBuffer cmd_buff, vk::PipelineBindPoint bind_point, vk::PipelineLayout layout,
+            uint32_t set = 0);
+};
+
+/**
+ * @brief Layout and the resources written by a `DescriptorSetBinder`. Can be hashed and compared, two sets with equal
+ * contents are interchangeable.
+ *
+ */
+struct DescriptorSetContents {
+  struct Entry {
+    uint32_t binding;
+    uint32_t array_element;
+    vk::DescriptorType type;
+    vk::Buffer buffer;
+    vk::DeviceSize offset;
+    vk::DeviceSize range;
+    vk::ImageView image_view;
+    vk::Sampler sampler;
+    vk::ImageLayout image_layout;
+
+    bool operator==(const Entry&) const = default;
+  };
+
+  vk::DescriptorSetLayout layout;
+
+  /**
+   * @brief Sorted by the binding numbers and the array elements, so the order of the bind calls does not matter.
+   *
+   */
+  std::vector<Entry> entries;
+  size_t _hash{};
+
+  DescriptorSetContents() = delete;
+  static DescriptorSetContents create(vk::DescriptorSetLayout layout, const DescriptorSetBinder& binder);
+
+  bool operator==(const DescriptorSetContents& other) const {
+    return _hash == other._hash && layout == other.layout && entries == other.entries;
+  }
+
+  bool references(vk::Buffer buffer) const;
+  bool references(vk::ImageView image_view) const;
+  bool references(vk::Sampler sampler) const;
+
+  struct Hash {
+    std::size_t operator()(const DescriptorSetContents& contents) const { return contents._hash; }
+  };
+
+ private:
+  size_t generate_hash() const;
+
+  DescriptorSetContents(vk::DescriptorSetLayout layout, std::vector<Entry>&& entries)
+      : layout(layout), entries(std::move(entries)) {}
+};
+
+/**
+ * @brief Reuses the descriptor sets whose contents match. The passes that write the same bindings every frame get the
+ * same set back and `vkUpdateDescriptorSets` is skipped entirely.
+ *
+ * The sets that reference a resource are evicted when the resource is pushed to the `FrameDeletionQueue` the cache is
+ * attached to. An evicted set may still be used by the frames in flight, so it is recycled for another contents of the
+ * same layout only once `begin_frame()` of the evicting frame is called again.
+ *
+ * @warning The sets are owned by the allocator, the cache must not outlive it.
+ *
+ */
+class DescriptorSetCache {
+ public:
+  DescriptorSetCache() = delete;
+  explicit DescriptorSetCache(std::nullptr_t) {}
+
+  static DescriptorSetCache create(DescriptorAllocator& allocator, uint32_t frames_in_flight);
+
+  /**
+   * @brief Returns the set with the contents written by the `binder`. If there is no such set, a set is allocated (or
+   * recycled), the writes are applied and the set is cached. The binder is not cleared.
+   *
+   * @param binder
+   * @param layout Layout of the set, it is a part of the key.
+   * @return Result<vk::DescriptorSet, Error>
+   */
+  Result<vk::DescriptorSet, Error> get_or_apply(DescriptorSetBinder& binder, vk::DescriptorSetLayout layout);
+
+  /**
+   * @brief Evicts all of the sets that reference the resource. The lookup is linear in the number of the cached sets,
+   * it is intended for the resource destruction, not for the hot path.
+   *
+   * @param buffer
+   * @return size_t Number of the evicted sets.
+   */
+  size_t evict(vk::Buffer buffer);
+  size_t evict(vk::ImageView image_view);
+  size_t evict(vk::Sampler sampler);
+
+  /**
+   * @brief Makes the sets evicted during the previous recording of the frame reusable. Call after the fence of the
+   * frame has been waited for.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Drops all of the cached contents. The sets become reusable immediately, the device must be idle.
+   *
+   */
+  void clear();
+
+  size_t size() const { return sets_.size(); }
+  size_t hit_count() const { return hit_count_; }
+  size_t miss_count() const { return miss_count_; }
+
+ private:
+  struct RetiredSet {
+    vk::DescriptorSetLayout layout;
+    vk::DescriptorSet descriptor_set;
+  };
+
+  DescriptorSetCache(DescriptorAllocator& allocator, uint32_t frames_in_flight)
+      : retired_sets_(frames_in_flight), p_allocator_(&allocator) {}
+
+  template <typename THandle>
+  size_t evict_referencing(THandle handle);
+
+  std::unordered_map<DescriptorSetContents, vk::DescriptorSet, DescriptorSetContents::Hash> sets_;
+
+  /**
+   * @brief Sets that can be rewritten, grouped by their layouts.
+   *
+   */
+  std::unordered_map<VkDescriptorSetLayout, std::vector<vk::DescriptorSet>> free_sets_;
+
+  /**
+   * @brief Sets evicted while the frame `f` was recorded are stored at `f`.
+   *
+   */
+  std::vector<std::vector<RetiredSet>> retired_sets_;
+  uint32_t current_frame_ = 0;
+
+  size_t hit_count_  = 0;
+  size_t miss_count_ = 0;
+
+  observer_ptr<DescriptorAllocator> p_allocator_{};
 };
 
 /**
@@ -165,13 +470,20 @@ struct DescriptorSetBinder {
  *
  */
 struct DescriptorSetLayoutInfo {
-  // TODO(migoox): Use static array instead of the vector
-  //   static constexpr size_t kMaxBindings = 16;
-  std::vector<vk::DescriptorSetLayoutBinding> bindings;
+  /**
+   * @brief The bindings are stored inline up to this count, so that the cache lookups do not allocate.
+   *
+   */
+  static constexpr size_t kInlineBindings = 16;
+  using Bindings                          = util::SmallVector<vk::DescriptorSetLayoutBinding, kInlineBindings>;
+
+  Bindings bindings;
+  vk::DescriptorSetLayoutCreateFlags flags;
   size_t _hash{};
 
   DescriptorSetLayoutInfo() = delete;
-  static DescriptorSetLayoutInfo create(std::vector<vk::DescriptorSetLayoutBinding>&& bindings);
+  static DescriptorSetLayoutInfo create(std::span<const vk::DescriptorSetLayoutBinding> bindings,
+                                        vk::DescriptorSetLayoutCreateFlags flags = {});
 
   bool operator==(const DescriptorSetLayoutInfo& other) const;
 
@@ -182,8 +494,37 @@ struct DescriptorSetLayoutInfo {
  private:
   size_t generate_hash() const;
 
-  explicit DescriptorSetLayoutInfo(std::vector<vk::DescriptorSetLayoutBinding>&& bindings)
-      : bindings(std::move(bindings)) {}
+  DescriptorSetLayoutInfo(std::span<const vk::DescriptorSetLayoutBinding> bindings,
+                          vk::DescriptorSetLayoutCreateFlags flags)
+      : bindings(bindings.begin(), bindings.end()), flags(flags) {}
+};
+
+/**
+ * @brief Set layouts and push constant ranges of a pipeline layout that can be hashed and compared. The pipelines
+ * created with the same info are layout compatible.
+ *
+ */
+struct PipelineLayoutInfo {
+  std::vector<vk::DescriptorSetLayout> set_layouts;
+  std::vector<vk::PushConstantRange> push_constant_ranges;
+  size_t _hash{};
+
+  PipelineLayoutInfo() = delete;
+  static PipelineLayoutInfo create(std::vector<vk::DescriptorSetLayout>&& set_layouts,
+                                   std::vector<vk::PushConstantRange>&& push_constant_ranges);
+
+  bool operator==(const PipelineLayoutInfo& other) const;
+
+  struct Hash {
+    std::size_t operator()(const PipelineLayoutInfo& info) const { return info._hash; }
+  };
+
+ private:
+  size_t generate_hash() const;
+
+  PipelineLayoutInfo(std::vector<vk::DescriptorSetLayout>&& set_layouts,
+                     std::vector<vk::PushConstantRange>&& push_constant_ranges)
+      : set_layouts(std::move(set_layouts)), push_constant_ranges(std::move(push_constant_ranges)) {}
 };
 
 /**
@@ -196,14 +537,41 @@ struct DescriptorSetLayoutManager {
   explicit DescriptorSetLayoutManager(std::nullptr_t) {}
 
   using LayoutCacheMap =
-      std::unordered_map<DescriptorSetLayoutInfo, vk::raii::DescriptorSetLayout, DescriptorSetLayoutInfo::Hash>;
+      util::FlatHashMap<DescriptorSetLayoutInfo, vk::raii::DescriptorSetLayout, DescriptorSetLayoutInfo::Hash>;
+
+  using PipelineLayoutCacheMap =
+      util::FlatHashMap<PipelineLayoutInfo, vk::raii::PipelineLayout, PipelineLayoutInfo::Hash>;
 
   LayoutCacheMap _layout_cache;
+  PipelineLayoutCacheMap _pipeline_layout_cache;
   observer_ptr<Device> _p_device{};
 
   static DescriptorSetLayoutManager create(Device& device);
   [[nodiscard]] Result<vk::DescriptorSetLayout, Error> create_layout(
       const vk::DescriptorSetLayoutCreateInfo& create_info);
+
+  /**
+   * @brief Adds VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT to the `create_info` flags. The layout is cached
+   * separately from the layout with the same bindings but without the flag.
+   *
+   * @param create_info
+   * @return Result<vk::DescriptorSetLayout, Error>
+   */
+  [[nodiscard]] Result<vk::DescriptorSetLayout, Error> create_push_descriptor_layout(
+      vk::DescriptorSetLayoutCreateInfo create_info);
+
+  /**
+   * @brief Returns the cached pipeline layout with the same set layouts and push constant ranges or creates a new one.
+   * Since the set layouts are deduplicated as well, the pipelines that declare the same resources share a single
+   * pipeline layout and the bound descriptor sets stay valid when switching between them.
+   *
+   * @param set_layouts
+   * @param push_constant_ranges
+   * @return Result<vk::PipelineLayout, Error>
+   */
+  [[nodiscard]] Result<vk::PipelineLayout, Error> create_pipeline_layout(
+      std::span<const vk::DescriptorSetLayout> set_layouts,
+      std::span<const vk::PushConstantRange> push_constant_ranges = {});
   void destroy();
 
  private:
@@ -214,6 +582,12 @@ struct DescriptorSetBuilder {
   DescriptorSetBuilder() = delete;
   [[nodiscard]] static DescriptorSetBuilder create(DescriptorSetLayoutManager& layout_manager,
                                                    DescriptorAllocator& allocator);
+  /**
+   * @brief Uses the device layout manager and allocator. The backend is the `Device::descriptor_backend()`.
+   *
+   * @param device
+   * @return DescriptorSetBuilder
+   */
   [[nodiscard]] static DescriptorSetBuilder create(Device& device);
 
   /**
@@ -225,8 +599,23 @@ struct DescriptorSetBuilder {
    */
   DescriptorSetBuilder& with_binding(vk::DescriptorType type, vk::ShaderStageFlags stage_flags, uint32_t count = 1);
 
+  /**
+   * @brief With the `DescriptorBackend::DescriptorBuffer` the layout is created with
+   * VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT.
+   *
+   * @return Result<vk::DescriptorSetLayout, Error>
+   */
   Result<vk::DescriptorSetLayout, Error> build_layout_only();
 
+  /**
+   * @brief Creates a layout for the push descriptors, the descriptors are then provided with
+   * `DescriptorSetBinder::push()` and no set is allocated. Useful for the small passes that rebind their resources
+   * every time they are recorded.
+   *
+   * @return Result<vk::DescriptorSetLayout, Error>
+   */
+  Result<vk::DescriptorSetLayout, Error> build_push_descriptor_layout();
+
   struct DescriptorSet {
     vk::DescriptorSet descriptor_set;
     vk::DescriptorSetLayout layout;
@@ -239,14 +628,29 @@ struct DescriptorSetBuilder {
   };
   Result<DescriptorSets, Error> build_many(size_t count);
 
-  std::vector<vk::DescriptorSetLayoutBinding> bindings;
+  /**
+   * @brief Reserves the set in the current frame partition of the `descriptor_buffer`. Requires the
+   * `DescriptorBackend::DescriptorBuffer`, `build()` and `build_many()` require the
+   * `DescriptorBackend::DescriptorSets`.
+   *
+   * @param descriptor_buffer
+   * @return Result<DescriptorBufferSet, Error>
+   */
+  Result<DescriptorBufferSet, Error> build(DescriptorBuffer& descriptor_buffer);
+
+  DescriptorBackend backend() const { return _backend; }
+
+  DescriptorSetLayoutInfo::Bindings bindings;
 
   observer_ptr<DescriptorSetLayoutManager> _dsl_manager;
   observer_ptr<DescriptorAllocator> _allocator;
-  uint32_t _binding_count = 0;
+  uint32_t _binding_count    = 0;
+  DescriptorBackend _backend = DescriptorBackend::DescriptorSets;
 
  private:
   explicit DescriptorSetBuilder(DescriptorSetLayoutManager& layout_manager, DescriptorAllocator& allocator);
+
+  vk::DescriptorSetLayoutCreateInfo layout_create_info() const;
 };
 
 }  // namespace eray::vkren
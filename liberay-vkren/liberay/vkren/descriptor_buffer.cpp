@@ -0,0 +1,214 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <array>
+#include <cassert>
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/descriptor_buffer.hpp>
+#include <liberay/vkren/error.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+Result<DescriptorBuffer, Error> DescriptorBuffer::create(Device& device, vk::DeviceSize frame_size_bytes,
+                                                         uint32_t frames_in_flight) {
+  assert(frames_in_flight > 0 && "There must be at least one frame in flight");
+
+  if (!device.has_descriptor_buffer()) {
+    return std::unexpected(Error{
+        .msg  = "Descriptor buffers are not enabled on the device",
+        .code = ErrorCode::ExtensionNotSupported{.extension = vk::EXTDescriptorBufferExtensionName},
+    });
+  }
+
+  // Partitions are aligned as well, so every set offset is a multiple of the alignment
+  const auto alignment = device.descriptor_buffer_properties().descriptorBufferOffsetAlignment;
+  frame_size_bytes     = align_up(frame_size_bytes, alignment);
+
+  vk::BufferCreateInfo buf_create_info = {
+      .sType       = vk::StructureType::eBufferCreateInfo,
+      .size        = frame_size_bytes * frames_in_flight,
+      .usage       = vk::BufferUsageFlagBits::eResourceDescriptorBufferEXT |
+               vk::BufferUsageFlagBits::eSamplerDescriptorBufferEXT | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+      .sharingMode = vk::SharingMode::eExclusive,
+  };
+
+  VmaAllocationCreateInfo alloc_create_info = {};
+  alloc_create_info.usage                   = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+  alloc_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+  VmaAllocationInfo alloc_info;
+  auto buff_opt = device.vma_alloc_manager().create_buffer(buf_create_info, alloc_create_info, alloc_info);
+  if (!buff_opt) {
+    return std::unexpected(buff_opt.error());
+  }
+
+  auto buffer = BufferResource{
+      ._buffer             = VmaRaiiBuffer(device.vma_alloc_manager(), buff_opt->allocation, buff_opt->vk_buffer),
+      ._p_device           = &device,
+      .size_bytes          = buf_create_info.size,
+      .usage               = buf_create_info.usage,
+      .transfer_src        = false,
+      .persistently_mapped = true,
+      .mappable            = true,
+  };
+  if (!alloc_info.pMappedData) {
+    return std::unexpected(Error{
+        .msg  = "Persistent mapping failed: allocation did not provide pMappedData",
+        .code = ErrorCode::VulkanObjectCreationFailure{},
+    });
+  }
+
+  const auto device_address = device->getBufferAddress(vk::BufferDeviceAddressInfo{.buffer = buffer.vk_buffer()});
+
+  return DescriptorBuffer(std::move(buffer), alloc_info.pMappedData, device_address, frame_size_bytes, alignment);
+}
+
+Result<DescriptorBufferSet, Error> DescriptorBuffer::allocate(vk::DescriptorSetLayout layout) {
+  const auto size_bytes = vk::Device{*buffer_._p_device->vk()}.getDescriptorSetLayoutSizeEXT(layout);
+  const auto offset     = align_up(head_, alignment_);
+  if (offset + size_bytes > frame_begin() + frame_size_bytes_) {
+    util::Logger::warn("Descriptor buffer partition is full, requested {} bytes with {} of {} bytes in use", size_bytes,
+                       used_bytes(), frame_size_bytes_);
+    return std::unexpected(Error{
+        .msg  = "Descriptor buffer partition is full",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  head_ = offset + size_bytes;
+  return DescriptorBufferSet{
+      .layout = layout,
+      .offset = offset,
+      .data   = static_cast<std::byte*>(mapping_) + offset,
+  };
+}
+
+size_t DescriptorBuffer::descriptor_size(vk::DescriptorType type) const {
+  const auto& props = buffer_._p_device->descriptor_buffer_properties();
+  switch (type) {
+    case vk::DescriptorType::eSampler:
+      return props.samplerDescriptorSize;
+    case vk::DescriptorType::eCombinedImageSampler:
+      return props.combinedImageSamplerDescriptorSize;
+    case vk::DescriptorType::eSampledImage:
+      return props.sampledImageDescriptorSize;
+    case vk::DescriptorType::eStorageImage:
+      return props.storageImageDescriptorSize;
+    case vk::DescriptorType::eInputAttachment:
+      return props.inputAttachmentDescriptorSize;
+    case vk::DescriptorType::eUniformBuffer:
+      return props.uniformBufferDescriptorSize;
+    case vk::DescriptorType::eStorageBuffer:
+      return props.storageBufferDescriptorSize;
+    default:
+      return 0;
+  }
+}
+
+void DescriptorBuffer::write(const DescriptorBufferSet& set, const DescriptorSetBinder& binder) const {
+  const auto& device = *buffer_._p_device;
+  auto vk_device     = *device.vk();
+
+  for (const auto& write : binder.writes) {
+    const auto size = descriptor_size(write.descriptorType);
+    if (size == 0) {
+      util::Logger::warn("Descriptor type {} is not supported by the descriptor buffers",
+                         vk::to_string(write.descriptorType));
+      continue;
+    }
+
+    auto address_info = vk::DescriptorAddressInfoEXT{};
+    auto data         = vk::DescriptorDataEXT{};
+    switch (write.descriptorType) {
+      case vk::DescriptorType::eSampler:
+        data.pSampler = &write.pImageInfo->sampler;
+        break;
+      case vk::DescriptorType::eCombinedImageSampler:
+        data.pCombinedImageSampler = write.pImageInfo;
+        break;
+      case vk::DescriptorType::eSampledImage:
+        data.pSampledImage = write.pImageInfo;
+        break;
+      case vk::DescriptorType::eStorageImage:
+        data.pStorageImage = write.pImageInfo;
+        break;
+      case vk::DescriptorType::eInputAttachment:
+        data.pInputAttachmentImage = write.pImageInfo;
+        break;
+      default:
+        assert(write.pBufferInfo->range != vk::WholeSize && "Descriptor buffers require an explicit range");
+        address_info = vk::DescriptorAddressInfoEXT{
+            .address = device->getBufferAddress(vk::BufferDeviceAddressInfo{.buffer = write.pBufferInfo->buffer}) +
+                       write.pBufferInfo->offset,
+            .range  = write.pBufferInfo->range,
+            .format = vk::Format::eUndefined,
+        };
+        if (write.descriptorType == vk::DescriptorType::eUniformBuffer) {
+          data.pUniformBuffer = &address_info;
+        } else {
+          data.pStorageBuffer = &address_info;
+        }
+        break;
+    }
+
+    const auto binding_offset = vk_device.getDescriptorSetLayoutBindingOffsetEXT(set.layout, write.dstBinding);
+    vk_device.getDescriptorEXT(
+        vk::DescriptorGetInfoEXT{
+            .type = write.descriptorType,
+            .data = data,
+        },
+        size, static_cast<std::byte*>(set.data) + binding_offset + (write.dstArrayElement * size));
+  }
+}
+
+void DescriptorBuffer::flush() const {
+  if (used_bytes() == 0) {
+    return;
+  }
+
+  // The memory might not be host coherent
+  vmaFlushAllocation(buffer_._p_device->vma_alloc_manager().allocator(), buffer_._buffer._allocation, frame_begin(),
+                     used_bytes());
+}
+
+void DescriptorBuffer::begin_frame(uint32_t frame_index) {
+  assert(static_cast<vk::DeviceSize>(frame_index + 1) * frame_size_bytes_ <= buffer_.size_bytes &&
+         "Frame index out of bounds");
+
+  current_frame_ = frame_index;
+  head_          = frame_begin();
+}
+
+void DescriptorBuffer::bind(vk::CommandBuffer cmd_buff) const {
+  cmd_buff.bindDescriptorBuffersEXT(vk::DescriptorBufferBindingInfoEXT{
+      .address = device_address_,
+      .usage   = buffer_.usage,
+  });
+}
+
+void DescriptorBuffer::set_offsets(vk::CommandBuffer cmd_buff, vk::PipelineBindPoint bind_point,
+                                   vk::PipelineLayout layout, uint32_t first_set,
+                                   std::span<const DescriptorBufferSet> sets) const {
+  assert(sets.size() <= kMaxBoundSets && "Too many descriptor sets bound at once");
+
+  auto buffer_indices = std::array<uint32_t, kMaxBoundSets>{};
+  auto offsets        = std::array<vk::DeviceSize, kMaxBoundSets>{};
+  for (auto i = 0U; i < sets.size(); ++i) {
+    offsets[i] = sets[i].offset;
+  }
+
+  const auto count = static_cast<uint32_t>(sets.size());
+  cmd_buff.setDescriptorBufferOffsetsEXT(bind_point, layout, first_set,
+                                         vk::ArrayProxy<const uint32_t>(count, buffer_indices.data()),
+                                         vk::ArrayProxy<const vk::DeviceSize>(count, offsets.data()));
+}
+
+}  // namespace eray::vkren
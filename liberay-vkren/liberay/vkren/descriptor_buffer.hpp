@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <span>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Descriptor set stored in a `DescriptorBuffer`. The `offset` is passed to `vkCmdSetDescriptorBufferOffsetsEXT`.
+ *
+ */
+struct DescriptorBufferSet {
+  vk::DescriptorSetLayout layout;
+  vk::DeviceSize offset;
+  void* data;
+};
+
+/**
+ * @brief Backend of the descriptor subsystem built on VK_EXT_descriptor_buffer. The descriptors are written with
+ * `vkGetDescriptorEXT` straight into a persistently mapped buffer split into a partition per frame in flight, so there
+ * are no pools and no set allocations. The sets of a frame are bump allocated from its partition and reset by
+ * `begin_frame()` once the fence of the frame has signaled.
+ *
+ * The layouts must be created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT and the pipelines with
+ * VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT, which the builders do when the device backend is
+ * `DescriptorBackend::DescriptorBuffer`. The buffers bound with the `DescriptorSetBinder` must have
+ * VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT set and an explicit range. The dynamic buffer descriptors are not
+ * supported.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class DescriptorBuffer {
+ public:
+  DescriptorBuffer() = delete;
+  explicit DescriptorBuffer(std::nullptr_t) {}
+
+  /**
+   * @brief Maximum number of the sets bound with a single `set_offsets()` call.
+   *
+   */
+  static constexpr uint32_t kMaxBoundSets = 8;
+
+  /**
+   * @brief Creates the descriptor buffer.
+   *
+   * @param device Must have the descriptor buffer enabled, see `Device::has_descriptor_buffer()`.
+   * @param frame_size_bytes Size of the partition of a single frame in flight.
+   * @param frames_in_flight
+   * @return Result<DescriptorBuffer, Error> Fails with `ExtensionNotSupported` when the device does not use the
+   * descriptor buffers.
+   */
+  [[nodiscard]] static Result<DescriptorBuffer, Error> create(Device& device, vk::DeviceSize frame_size_bytes,
+                                                              uint32_t frames_in_flight);
+
+  /**
+   * @brief Reserves the set in the partition of the current frame. The descriptors are undefined until written.
+   *
+   * @param layout
+   * @return Result<DescriptorBufferSet, Error> Fails with `MemoryAllocationFailure` when the partition is full.
+   */
+  Result<DescriptorBufferSet, Error> allocate(vk::DescriptorSetLayout layout);
+
+  /**
+   * @brief Writes the descriptors recorded by the `binder` into the set. Counterpart of `DescriptorSetBinder::apply()`.
+   *
+   * @param set
+   * @param binder
+   */
+  void write(const DescriptorBufferSet& set, const DescriptorSetBinder& binder) const;
+
+  /**
+   * @brief Makes the writes of the current frame visible to the device. Call before the frame is submitted.
+   *
+   */
+  void flush() const;
+
+  /**
+   * @brief Resets the partition of the frame. Call after the fence of the frame has been waited for.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Binds the descriptor buffer at index 0. Call once per command buffer, before `set_offsets()`.
+   *
+   * @param cmd_buff
+   */
+  void bind(vk::CommandBuffer cmd_buff) const;
+
+  /**
+   * @brief Counterpart of `vkCmdBindDescriptorSets`.
+   *
+   * @param cmd_buff
+   * @param bind_point
+   * @param layout
+   * @param first_set
+   * @param sets
+   */
+  void set_offsets(vk::CommandBuffer cmd_buff, vk::PipelineBindPoint bind_point, vk::PipelineLayout layout,
+                   uint32_t first_set, std::span<const DescriptorBufferSet> sets) const;
+
+  vk::DeviceAddress device_address() const { return device_address_; }
+  vk::DeviceSize frame_size_bytes() const { return frame_size_bytes_; }
+  vk::DeviceSize used_bytes() const { return head_ - frame_begin(); }
+
+ private:
+  DescriptorBuffer(BufferResource&& buffer, void* mapping, vk::DeviceAddress device_address,
+                   vk::DeviceSize frame_size_bytes, vk::DeviceSize alignment)
+      : buffer_(std::move(buffer)),
+        mapping_(mapping),
+        device_address_(device_address),
+        frame_size_bytes_(frame_size_bytes),
+        alignment_(alignment) {}
+
+  vk::DeviceSize frame_begin() const { return static_cast<vk::DeviceSize>(current_frame_) * frame_size_bytes_; }
+  size_t descriptor_size(vk::DescriptorType type) const;
+
+  BufferResource buffer_{};
+  void* mapping_                    = nullptr;
+  vk::DeviceAddress device_address_ = 0;
+  vk::DeviceSize frame_size_bytes_  = 0;
+  vk::DeviceSize alignment_         = 1;
+
+  uint32_t current_frame_ = 0;
+  vk::DeviceSize head_    = 0;
+};
+
+}  // namespace eray::vkren
@@ -7,28 +7,67 @@
 #include <vulkan/vulkan_core.h>
 
 #include <algorithm>
+#include <array>
+#include <cstring>
 #include <expected>
+#include <fstream>
 #include <liberay/os/window/glfw/glfw_window.hpp>
 #include <liberay/os/window_api.hpp>
 #include <liberay/util/logger.hpp>
+#include <liberay/util/platform.hpp>
 #include <liberay/util/try.hpp>
 #include <liberay/vkren/descriptor.hpp>
 #include <liberay/vkren/device.hpp>
 #include <liberay/vkren/error.hpp>
 #include <map>
 #include <ranges>
+#include <span>
+#include <string_view>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_profiles.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include <vulkan/vulkan_structs.hpp>
+
+#ifdef IS_WINDOWS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
 namespace eray::vkren {
 
+namespace {
+
+// The host time domain of `std::chrono::steady_clock`, the timebase of the CPU profiler
+#ifdef IS_WINDOWS
+constexpr auto kHostTimeDomain = vk::TimeDomainEXT::eQueryPerformanceCounter;
+#else
+constexpr auto kHostTimeDomain = vk::TimeDomainEXT::eClockMonotonic;
+#endif
+
+uint64_t host_timestamp_to_ns(uint64_t timestamp) {
+#ifdef IS_WINDOWS
+  auto frequency = LARGE_INTEGER{};
+  QueryPerformanceFrequency(&frequency);
+  const auto ticks_per_second = static_cast<uint64_t>(frequency.QuadPart);
+  return (timestamp / ticks_per_second * 1'000'000'000) +
+         (timestamp % ticks_per_second * 1'000'000'000 / ticks_per_second);
+#else
+  return timestamp;
+#endif
+}
+
+}  // namespace
+
 Device::CreateInfo Device::CreateInfo::DesktopProfile::get(const eray::os::Window& window) noexcept {
   // TODO(migoox): Create better rendererAPI-windowAPI integration abstraction!
+  if (window.window_api() == eray::os::WindowAPI::Headless) {
+    return get_headless();
+  }
   if (window.window_api() != eray::os::WindowAPI::GLFW) {
     eray::util::panic("Renderer supports GLFW only, but {} has been provided",
                       os::kWindowingAPIName[window.window_api()]);
@@ -72,6 +111,17 @@ Device::CreateInfo Device::CreateInfo::DesktopProfile::get(const eray::os::Windo
   return get(surf_creator, required_global_extensions);
 }
 
+Device::CreateInfo Device::CreateInfo::DesktopProfile::get_headless() noexcept {
+  auto info = get(SurfaceCreator{}, {});
+
+  // The swap chain extension requires the surface instance extension
+  std::erase_if(device_extensions_,
+                [](const char* ext) { return std::string_view(ext) == vk::KHRSwapchainExtensionName; });
+  info.device_extensions = device_extensions_;
+
+  return info;
+}
+
 Device::CreateInfo Device::CreateInfo::DesktopProfile::get(
     const SurfaceCreator& surface_creator_func, std::span<const char* const> required_global_extensions) noexcept {
   // == Validation Layers ==============================================================================================
@@ -127,7 +177,10 @@ Result<std::unique_ptr<Device>, Error> Device::create(vk::raii::Context& ctx, co
   VULKAN_HPP_DEFAULT_DISPATCHER.init(vk::Instance{device->instance()});
 
   TRY(device->create_debug_messenger(info));
-  if (auto result = info.surface_creator(device->instance())) {
+  if (!info.surface_creator) {
+    device->headless_ = true;
+    util::Logger::info("No surface creator provided, the device is headless");
+  } else if (auto result = info.surface_creator(device->instance())) {
     device->surface_ = std::move(*result);
   } else {
     util::Logger::err("Failed to create a surface with the injected surface creator.");
@@ -137,13 +190,16 @@ Result<std::unique_ptr<Device>, Error> Device::create(vk::raii::Context& ctx, co
     });
   }
   TRY(device->pick_physical_device(info));
+  device->detect_host_visible_device_local_heap();
   TRY(device->create_logical_device(info));
   TRY(device->create_command_pool());
+  TRY(device->create_pipeline_cache(info));
   device->create_dsl();
 
   VULKAN_HPP_DEFAULT_DISPATCHER.init(vk::Device{device->device_});
 
-  auto res = VmaAllocationManager::create(device->physical_device_, device->device_, device->instance_);
+  auto res = VmaAllocationManager::create(device->physical_device_, device->device_, device->instance_,
+                                          device->memory_budget_enabled_);
   if (!res) {
     return std::unexpected(res.error());
   }
@@ -153,6 +209,37 @@ Result<std::unique_ptr<Device>, Error> Device::create(vk::raii::Context& ctx, co
   return device;
 }
 
+Result<vk::raii::SurfaceKHR, Error> Device::create_surface(const os::Window& window) const {
+  if (headless_ || window.window_api() != eray::os::WindowAPI::GLFW) {
+    util::Logger::err("Could not create a surface of a {} window", os::kWindowingAPIName[window.window_api()]);
+    return std::unexpected(Error{
+        .msg  = "Surface creation failure",
+        .code = ErrorCode::SurfaceCreationFailure{},
+    });
+  }
+
+  VkSurfaceKHR vk_surface{};
+  if (glfwCreateWindowSurface(*instance_, reinterpret_cast<GLFWwindow*>(window.win_ptr()), nullptr, &vk_surface)) {
+    util::Logger::err("Could not create a window surface");
+    return std::unexpected(Error{
+        .msg  = "Surface creation failure",
+        .code = ErrorCode::SurfaceCreationFailure{},
+    });
+  }
+  auto surface = vk::raii::SurfaceKHR(instance_, vk_surface);
+
+  // The queue families are picked for the main surface, the other monitors might be driven by another device
+  if (!physical_device_.getSurfaceSupportKHR(presentation_queue_family_, surface)) {
+    util::Logger::err("The presentation queue cannot present to the window surface");
+    return std::unexpected(Error{
+        .msg  = "The presentation queue does not support the surface",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
+  return surface;
+}
+
 Result<void, Error> Device::create_instance(vk::raii::Context& ctx, const CreateInfo& info) noexcept {
   // == Vulkan Profiles ================================================================================================
   auto supported = vk::False;
@@ -185,6 +272,29 @@ Result<void, Error> Device::create_instance(vk::raii::Context& ctx, const Create
     }
   }
 
+  // VK_EXT_swapchain_maintenance1 requires VK_EXT_surface_maintenance1, which is enabled whenever it is available
+  const auto is_instance_extension_supported = [&extensions_props](std::string_view name) {
+    return std::ranges::any_of(extensions_props,
+                               [name](const auto& prop) { return std::string_view(prop.extensionName) == name; });
+  };
+  if (info.surface_creator && is_instance_extension_supported(vk::KHRGetSurfaceCapabilities2ExtensionName) &&
+      is_instance_extension_supported(vk::EXTSurfaceMaintenance1ExtensionName)) {
+    for (const auto* ext : {vk::KHRGetSurfaceCapabilities2ExtensionName, vk::EXTSurfaceMaintenance1ExtensionName}) {
+      if (std::ranges::none_of(glob_extensions, [ext](const char* e) { return std::string_view(e) == ext; })) {
+        glob_extensions.push_back(ext);
+      }
+    }
+    surface_maintenance1_enabled_ = true;
+  }
+
+  // The names and labels are useful in the captures of the release builds too, where the validation layers are off
+  debug_utils_enabled_ = std::ranges::any_of(
+      glob_extensions, [](const char* e) { return std::string_view(e) == vk::EXTDebugUtilsExtensionName; });
+  if (!debug_utils_enabled_ && info.debug_labels && is_instance_extension_supported(vk::EXTDebugUtilsExtensionName)) {
+    glob_extensions.push_back(vk::EXTDebugUtilsExtensionName);
+    debug_utils_enabled_ = true;
+  }
+
   // == Validation layers ==============================================================================================
 
   // Check if the requested validation layers are supported by the Vulkan implementation.
@@ -359,6 +469,232 @@ Result<void, Error> Device::pick_physical_device(const CreateInfo& info) noexcep
   return {};
 }
 
+namespace {
+
+/**
+ * @brief The driver validates the data as well, but might crash on the data produced by a different driver.
+ *
+ */
+bool is_pipeline_cache_compatible(std::span<const char> data, const vk::PhysicalDeviceProperties& props) {
+  auto header = VkPipelineCacheHeaderVersionOne{};
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  return header.headerSize >= sizeof(header) && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == props.vendorID && header.deviceID == props.deviceID &&
+         std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+}  // namespace
+
+Result<void, Error> Device::create_pipeline_cache(const CreateInfo& info) noexcept {
+  pipeline_cache_path_ = info.pipeline_cache_path;
+
+  // The data read ahead is not copied
+  auto read_data = info.pipeline_cache_data ? std::vector<char>() : read_pipeline_cache(pipeline_cache_path_);
+  auto data      = std::span<const char>(info.pipeline_cache_data ? *info.pipeline_cache_data : read_data);
+  if (!pipeline_cache_path_.empty() && std::filesystem::is_regular_file(pipeline_cache_path_)) {
+    if (!is_pipeline_cache_compatible(data, physical_device_.getProperties())) {
+      util::Logger::warn(R"(Pipeline cache "{}" is invalid or was created for another device, it will be rebuilt)",
+                         pipeline_cache_path_.string());
+      data = {};
+    } else {
+      util::Logger::info(R"(Loaded {} bytes of pipeline cache from "{}")", data.size(), pipeline_cache_path_.string());
+    }
+  }
+
+  auto create_info = vk::PipelineCacheCreateInfo{
+      .initialDataSize = data.size(),
+      .pInitialData    = data.empty() ? nullptr : data.data(),
+  };
+  auto cache_opt = device_.createPipelineCache(create_info);
+  if (!cache_opt) {
+    util::Logger::err("Could not create a pipeline cache. Error code: {}", vk::to_string(cache_opt.error()));
+    return std::unexpected(Error{
+        .msg     = "Pipeline cache creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = cache_opt.error(),
+    });
+  }
+  pipeline_cache_ = std::move(*cache_opt);
+
+  return {};
+}
+
+std::vector<char> Device::read_pipeline_cache(const std::filesystem::path& path) {
+  auto data = std::vector<char>();
+  if (path.empty() || !std::filesystem::is_regular_file(path)) {
+    return data;
+  }
+
+  auto file = std::ifstream(path, std::ios::ate | std::ios::binary);
+  if (file) {
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+  }
+  if (!file) {
+    data.clear();
+  }
+  return data;
+}
+
+Result<void, Error> Device::save_pipeline_cache() const {
+  if (pipeline_cache_path_.empty()) {
+    return {};
+  }
+
+  auto data = pipeline_cache_.getData();
+
+  // The cache is written to a temporary file first, so an interrupted write does not corrupt the previous cache
+  auto tmp_path = pipeline_cache_path_;
+  tmp_path += ".tmp";
+  {
+    auto file = std::ofstream(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+      return std::unexpected(Error{
+          .msg  = std::format(R"(Could not write the pipeline cache to "{}")", tmp_path.string()),
+          .code = ErrorCode::FileError{},
+      });
+    }
+  }
+
+  auto ec = std::error_code{};
+  std::filesystem::rename(tmp_path, pipeline_cache_path_, ec);
+  if (ec) {
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not replace the pipeline cache "{}": {})", pipeline_cache_path_.string(),
+                            ec.message()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  util::Logger::info(R"(Saved {} bytes of pipeline cache to "{}")", data.size(), pipeline_cache_path_.string());
+  return {};
+}
+
+void Device::detect_host_visible_device_local_heap() noexcept {
+  constexpr auto kFlags = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible;
+
+  auto mem_props = physical_device_.getMemoryProperties();
+  for (auto i = 0U; i < mem_props.memoryTypeCount; ++i) {
+    if ((mem_props.memoryTypes[i].propertyFlags & kFlags) != kFlags) {
+      continue;
+    }
+
+    const auto heap_index = mem_props.memoryTypes[i].heapIndex;
+    const auto heap_size  = mem_props.memoryHeaps[heap_index].size;
+    if (host_visible_device_local_heap_ && host_visible_device_local_heap_->size_bytes >= heap_size) {
+      continue;
+    }
+
+    const auto resizable_bar        = heap_size > HostVisibleDeviceLocalHeap::kClassicBarSizeBytes;
+    host_visible_device_local_heap_ = HostVisibleDeviceLocalHeap{
+        .heap_index    = heap_index,
+        .size_bytes    = heap_size,
+        .resizable_bar = resizable_bar,
+        .budget_bytes  = resizable_bar ? heap_size / 2 : heap_size / 4,
+    };
+  }
+
+  if (host_visible_device_local_heap_) {
+    eray::util::Logger::info("Host visible device local heap {} with {} MiB (resizable BAR: {}), dynamic buffer budget "
+                             "{} MiB",
+                             host_visible_device_local_heap_->heap_index,
+                             host_visible_device_local_heap_->size_bytes / (1024 * 1024),
+                             host_visible_device_local_heap_->resizable_bar,
+                             host_visible_device_local_heap_->budget_bytes / (1024 * 1024));
+  } else {
+    eray::util::Logger::info("No host visible device local heap, dynamic buffers are written with transfers");
+  }
+}
+
+void Device::set_object_name(vk::ObjectType type, uint64_t handle, util::zstring_view name) const {
+  if (!debug_utils_enabled_ || handle == 0) {
+    return;
+  }
+  device_.setDebugUtilsObjectNameEXT(vk::DebugUtilsObjectNameInfoEXT{
+      .objectType   = type,
+      .objectHandle = handle,
+      .pObjectName  = name.c_str(),
+  });
+}
+
+void Device::begin_debug_label(vk::CommandBuffer cmd_buff, util::zstring_view name) const {
+  if (debug_utils_enabled_) {
+    cmd_buff.beginDebugUtilsLabelEXT(vk::DebugUtilsLabelEXT{.pLabelName = name.c_str()});
+  }
+}
+
+void Device::end_debug_label(vk::CommandBuffer cmd_buff) const {
+  if (debug_utils_enabled_) {
+    cmd_buff.endDebugUtilsLabelEXT();
+  }
+}
+
+std::optional<TimestampCalibration> Device::calibrate_timestamps() const {
+  if (!calibrated_timestamps_enabled_) {
+    return std::nullopt;
+  }
+
+  const auto infos = std::array{
+      vk::CalibratedTimestampInfoEXT{.timeDomain = vk::TimeDomainEXT::eDevice},
+      vk::CalibratedTimestampInfoEXT{.timeDomain = kHostTimeDomain},
+  };
+  const auto [timestamps, max_deviation_ns] = device_.getCalibratedTimestampsEXT(infos);
+  if (timestamps.size() != infos.size()) {
+    return std::nullopt;
+  }
+
+  return TimestampCalibration{
+      .gpu_ticks           = timestamps[0],
+      .cpu_ns              = host_timestamp_to_ns(timestamps[1]),
+      .max_deviation_ns    = max_deviation_ns,
+      .timestamp_period_ns = physical_device_.getProperties().limits.timestampPeriod,
+  };
+}
+
+void Device::set_host_visible_device_local_budget(vk::DeviceSize budget_bytes) {
+  if (host_visible_device_local_heap_) {
+    host_visible_device_local_heap_->budget_bytes = std::min(budget_bytes, host_visible_device_local_heap_->size_bytes);
+  }
+}
+
+vk::DeviceSize Device::host_visible_device_local_usage() const {
+  constexpr auto kFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+  const VkPhysicalDeviceMemoryProperties* mem_props = nullptr;
+  vmaGetMemoryProperties(vma_alloc_manager_.allocator(), &mem_props);
+
+  auto stats = VmaTotalStatistics{};
+  vmaCalculateStatistics(vma_alloc_manager_.allocator(), &stats);
+
+  auto usage = vk::DeviceSize{0};
+  for (auto i = 0U; i < mem_props->memoryTypeCount; ++i) {
+    if ((mem_props->memoryTypes[i].propertyFlags & kFlags) == kFlags) {
+      usage += stats.memoryType[i].statistics.allocationBytes;
+    }
+  }
+
+  return usage;
+}
+
+bool Device::fits_host_visible_device_local(vk::DeviceSize size_bytes) const {
+  if (!host_visible_device_local_heap_) {
+    return false;
+  }
+
+  if (host_visible_device_local_usage() + size_bytes > host_visible_device_local_heap_->budget_bytes) {
+    return false;
+  }
+
+  const auto heap = vma_alloc_manager_.heap_budgets()[host_visible_device_local_heap_->heap_index];
+  return heap.usage + size_bytes <= heap.budget;
+}
+
 vk::SampleCountFlagBits Device::max_usable_sample_count() const {
   auto props  = physical_device_.getProperties();
   auto counts = props.limits.framebufferColorSampleCounts & props.limits.framebufferDepthSampleCounts;
@@ -392,15 +728,20 @@ Result<void, Error> Device::create_logical_device(const CreateInfo& info) noexce
     auto queue_family_props         = physical_device_.getQueueFamilyProperties();
     auto indexed_queue_family_props = std::views::enumerate(queue_family_props);
 
+    // A headless device never presents, any queue family is good enough
+    auto supports_present = [this](auto index) {
+      return headless_ || physical_device_.getSurfaceSupportKHR(static_cast<uint32_t>(index), surface_);
+    };
+
     // Try to find a queue family that supports both presentation and graphics families.
     // Note: Vulkan requires an implementation which supports graphics operations to have at least one queue family that
     // supports both graphics and compute operations.
     auto queue_family_prop_it =
-        std::ranges::find_if(indexed_queue_family_props, [&pd = physical_device_, &surf = surface_](auto&& pair) {
+        std::ranges::find_if(indexed_queue_family_props, [&supports_present](auto&& pair) {
           auto&& [index, prop] = pair;
           return ((prop.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)) !=
                   static_cast<vk::QueueFlags>(0)) &&
-                 pd.getSurfaceSupportKHR(static_cast<uint32_t>(index), surf);
+                 supports_present(index);
         });
 
     if (queue_family_prop_it == indexed_queue_family_props.end()) {
@@ -423,9 +764,9 @@ Result<void, Error> Device::create_logical_device(const CreateInfo& info) noexce
           static_cast<uint32_t>(std::distance(queue_family_props.begin(), graphics_queue_family_prop_it));
 
       auto surface_queue_family_prop_it =
-          std::ranges::find_if(indexed_queue_family_props, [&pd = physical_device_, &surf = surface_](auto&& pair) {
+          std::ranges::find_if(indexed_queue_family_props, [&supports_present](auto&& pair) {
             auto&& [index, prop] = pair;
-            return pd.getSurfaceSupportKHR(static_cast<uint32_t>(index), surf);
+            return supports_present(index);
           });
 
       if (surface_queue_family_prop_it == indexed_queue_family_props.end()) {
@@ -444,31 +785,352 @@ Result<void, Error> Device::create_logical_device(const CreateInfo& info) noexce
     }
   }
 
-  float queue_priority          = 0.F;
-  auto device_queue_create_info = vk::DeviceQueueCreateInfo{
-      .queueFamilyIndex = graphics_queue_family_,
-      .queueCount       = 1,
-      .pQueuePriorities = &queue_priority,  //
+  // Prefer a dedicated compute queue family, so that the compute work can overlap with the graphics work.
+  {
+    auto queue_family_props      = physical_device_.getQueueFamilyProperties();
+    auto compute_queue_family_it = std::ranges::find_if(queue_family_props, [](const auto& prop) {
+      return (prop.queueFlags & vk::QueueFlagBits::eCompute) && !(prop.queueFlags & vk::QueueFlagBits::eGraphics);
+    });
+    if (compute_queue_family_it != queue_family_props.end()) {
+      compute_queue_family_ =
+          static_cast<uint32_t>(std::distance(queue_family_props.begin(), compute_queue_family_it));
+    }
+  }
+
+  // Prefer a dedicated transfer queue family, so that the uploads do not block the graphics queue.
+  {
+    auto queue_family_props       = physical_device_.getQueueFamilyProperties();
+    transfer_queue_family_        = graphics_queue_family_;
+    auto transfer_queue_family_it = std::ranges::find_if(queue_family_props, [](const auto& prop) {
+      return (prop.queueFlags & vk::QueueFlagBits::eTransfer) &&
+             !(prop.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute));
+    });
+    if (transfer_queue_family_it != queue_family_props.end()) {
+      transfer_queue_family_ =
+          static_cast<uint32_t>(std::distance(queue_family_props.begin(), transfer_queue_family_it));
+    } else if (has_async_compute_queue() && queue_family_props[compute_queue_family_].queueCount > 1) {
+      // Without the copy engines the uploads still overlap the graphics work on a second queue of the compute family
+      transfer_queue_family_ = compute_queue_family_;
+      transfer_queue_index_  = 1;
+    }
+  }
+
+  const auto queue_priorities    = std::array{0.F, 0.F};
+  auto device_queue_create_infos = std::vector<vk::DeviceQueueCreateInfo>{
+      vk::DeviceQueueCreateInfo{
+          .queueFamilyIndex = graphics_queue_family_,
+          .queueCount       = 1,
+          .pQueuePriorities = queue_priorities.data(),  //
+      },
   };
+  if (has_async_compute_queue()) {
+    device_queue_create_infos.push_back(vk::DeviceQueueCreateInfo{
+        .queueFamilyIndex = compute_queue_family_,
+        .queueCount       = transfer_queue_family_ == compute_queue_family_ ? 2U : 1U,
+        .pQueuePriorities = queue_priorities.data(),  //
+    });
+  }
+  if (has_dedicated_transfer_queue() && transfer_queue_family_ != compute_queue_family_) {
+    device_queue_create_infos.push_back(vk::DeviceQueueCreateInfo{
+        .queueFamilyIndex = transfer_queue_family_,
+        .queueCount       = 1,
+        .pQueuePriorities = queue_priorities.data(),  //
+    });
+  }
+
+  // == Optional Extensions ============================================================================================
+
+  auto device_extensions      = std::vector<const char*>(info.device_extensions.begin(), info.device_extensions.end());
+  auto gpl_features           = vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT{};
+  auto db_features            = vk::PhysicalDeviceDescriptorBufferFeaturesEXT{};
+  auto present_id_features    = vk::PhysicalDevicePresentIdFeaturesKHR{};
+  auto present_wait_features  = vk::PhysicalDevicePresentWaitFeaturesKHR{};
+  auto maintenance1_features  = vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT{};
+  auto eds3_features          = vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT{};
+  auto shader_object_features = vk::PhysicalDeviceShaderObjectFeaturesEXT{};
+  auto mesh_shader_features   = vk::PhysicalDeviceMeshShaderFeaturesEXT{};
+  auto as_features            = vk::PhysicalDeviceAccelerationStructureFeaturesKHR{};
+  auto ray_query_features     = vk::PhysicalDeviceRayQueryFeaturesKHR{};
+  auto fsr_features           = vk::PhysicalDeviceFragmentShadingRateFeaturesKHR{};
+  {
+    auto extensions   = physical_device_.enumerateDeviceExtensionProperties();
+    auto is_supported = [&extensions](std::string_view name) {
+      return std::ranges::any_of(extensions, [name](const vk::ExtensionProperties& ext) {
+        return std::string_view(ext.extensionName) == name;
+      });
+    };
+    auto enable = [&device_extensions](const char* name) {
+      if (std::ranges::none_of(device_extensions, [name](const char* ext) { return std::string_view(ext) == name; })) {
+        device_extensions.push_back(name);
+      }
+    };
+
+    memory_budget_enabled_ = is_supported(vk::EXTMemoryBudgetExtensionName);
+    if (memory_budget_enabled_) {
+      enable(vk::EXTMemoryBudgetExtensionName);
+    } else {
+      util::Logger::warn("{} is not supported, the memory budgets are estimated", vk::EXTMemoryBudgetExtensionName);
+    }
+
+    if (is_supported(vk::EXTCalibratedTimestampsExtensionName)) {
+      const auto domains             = physical_device_.getCalibrateableTimeDomainsEXT();
+      calibrated_timestamps_enabled_ = std::ranges::find(domains, vk::TimeDomainEXT::eDevice) != domains.end() &&
+                                       std::ranges::find(domains, kHostTimeDomain) != domains.end();
+    }
+    if (calibrated_timestamps_enabled_) {
+      enable(vk::EXTCalibratedTimestampsExtensionName);
+    }
+
+    if (is_supported(vk::EXTGraphicsPipelineLibraryExtensionName) &&
+        is_supported(vk::KHRPipelineLibraryExtensionName)) {
+      auto chain = physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                 vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+      graphics_pipeline_library_enabled_ =
+          chain.get<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>().graphicsPipelineLibrary == vk::True;
+    }
+    if (graphics_pipeline_library_enabled_) {
+      enable(vk::KHRPipelineLibraryExtensionName);
+      enable(vk::EXTGraphicsPipelineLibraryExtensionName);
+      gpl_features.graphicsPipelineLibrary = vk::True;
+    } else {
+      util::Logger::info("{} is not supported, the pipelines are compiled as a whole",
+                         vk::EXTGraphicsPipelineLibraryExtensionName);
+    }
+
+    if (!headless_ && is_supported(vk::KHRPresentIdExtensionName) && is_supported(vk::KHRPresentWaitExtensionName)) {
+      auto chain = physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR,
+                                                 vk::PhysicalDevicePresentWaitFeaturesKHR>();
+      present_wait_enabled_ = chain.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId == vk::True &&
+                              chain.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait == vk::True;
+    }
+    if (present_wait_enabled_) {
+      enable(vk::KHRPresentIdExtensionName);
+      enable(vk::KHRPresentWaitExtensionName);
+      present_id_features.presentId     = vk::True;
+      present_wait_features.presentWait = vk::True;
+    }
+
+    if (surface_maintenance1_enabled_ && is_supported(vk::EXTSwapchainMaintenance1ExtensionName)) {
+      auto chain = physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                 vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>();
+      swapchain_maintenance1_enabled_ =
+          chain.get<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>().swapchainMaintenance1 == vk::True;
+    }
+    if (swapchain_maintenance1_enabled_) {
+      enable(vk::EXTSwapchainMaintenance1ExtensionName);
+      maintenance1_features.swapchainMaintenance1 = vk::True;
+    } else if (!headless_) {
+      util::Logger::info("{} is not supported, the retired swap chains are destroyed a few frames later",
+                         vk::EXTSwapchainMaintenance1ExtensionName);
+    }
+
+    if (is_supported(vk::EXTExtendedDynamicState3ExtensionName)) {
+      auto chain = physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                 vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT>();
+      const auto& supported = chain.get<vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT>();
+
+      // Only the states that vary between the materials are enabled
+      eds3_features.extendedDynamicState3PolygonMode        = supported.extendedDynamicState3PolygonMode;
+      eds3_features.extendedDynamicState3ColorBlendEnable   = supported.extendedDynamicState3ColorBlendEnable;
+      eds3_features.extendedDynamicState3ColorBlendEquation = supported.extendedDynamicState3ColorBlendEquation;
+      eds3_features.extendedDynamicState3ColorWriteMask     = supported.extendedDynamicState3ColorWriteMask;
+    }
+    extended_dynamic_state3_enabled_ =
+        eds3_features.extendedDynamicState3PolygonMode || eds3_features.extendedDynamicState3ColorBlendEnable ||
+        eds3_features.extendedDynamicState3ColorBlendEquation || eds3_features.extendedDynamicState3ColorWriteMask;
+    if (extended_dynamic_state3_enabled_) {
+      enable(vk::EXTExtendedDynamicState3ExtensionName);
+      extended_dynamic_state3_features_ = eds3_features;
+    } else {
+      util::Logger::info("{} is not supported, the polygon mode and the blending are baked into the pipelines",
+                         vk::EXTExtendedDynamicState3ExtensionName);
+    }
+
+    if (is_supported(vk::EXTShaderObjectExtensionName)) {
+      auto chain =
+          physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceShaderObjectFeaturesEXT>();
+      shader_object_enabled_ = chain.get<vk::PhysicalDeviceShaderObjectFeaturesEXT>().shaderObject == vk::True;
+    }
+    if (shader_object_enabled_) {
+      enable(vk::EXTShaderObjectExtensionName);
+      shader_object_features.shaderObject = vk::True;
+    } else {
+      util::Logger::info("{} is not supported, the graphics programs are compiled into pipelines",
+                         vk::EXTShaderObjectExtensionName);
+    }
+
+    if (is_supported(vk::EXTMeshShaderExtensionName)) {
+      auto chain =
+          physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+      const auto& features = chain.get<vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+      mesh_shader_enabled_ = features.taskShader == vk::True && features.meshShader == vk::True;
+    }
+    if (mesh_shader_enabled_) {
+      enable(vk::EXTMeshShaderExtensionName);
+      mesh_shader_features.taskShader = vk::True;
+      mesh_shader_features.meshShader = vk::True;
+    } else {
+      util::Logger::info("{} is not supported, the meshlets cannot be drawn", vk::EXTMeshShaderExtensionName);
+    }
+
+    // The acceleration structure builds read the geometry through the buffer device addresses, the compaction queries
+    // are reset from the host
+    if (is_supported(vk::KHRAccelerationStructureExtensionName) &&
+        is_supported(vk::KHRDeferredHostOperationsExtensionName) && is_supported(vk::KHRRayQueryExtensionName)) {
+      auto chain = physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features,
+                                                 vk::PhysicalDeviceAccelerationStructureFeaturesKHR,
+                                                 vk::PhysicalDeviceRayQueryFeaturesKHR>();
+      ray_query_enabled_ =
+          chain.get<vk::PhysicalDeviceVulkan12Features>().bufferDeviceAddress == vk::True &&
+          chain.get<vk::PhysicalDeviceVulkan12Features>().hostQueryReset == vk::True &&
+          chain.get<vk::PhysicalDeviceAccelerationStructureFeaturesKHR>().accelerationStructure == vk::True &&
+          chain.get<vk::PhysicalDeviceRayQueryFeaturesKHR>().rayQuery == vk::True;
+    }
+    if (ray_query_enabled_) {
+      enable(vk::KHRAccelerationStructureExtensionName);
+      enable(vk::KHRDeferredHostOperationsExtensionName);
+      enable(vk::KHRRayQueryExtensionName);
+      as_features.accelerationStructure = vk::True;
+      ray_query_features.rayQuery       = vk::True;
+    } else {
+      util::Logger::info("{} is not supported, the acceleration structures cannot be built",
+                         vk::KHRRayQueryExtensionName);
+    }
+
+    // The rate image is combined with the pipeline rate, so both of them are required
+    if (is_supported(vk::KHRFragmentShadingRateExtensionName)) {
+      auto chain = physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                 vk::PhysicalDeviceFragmentShadingRateFeaturesKHR>();
+      const auto& features           = chain.get<vk::PhysicalDeviceFragmentShadingRateFeaturesKHR>();
+      fragment_shading_rate_enabled_ = features.attachmentFragmentShadingRate == vk::True &&
+                                       features.pipelineFragmentShadingRate == vk::True;
+    }
+    if (fragment_shading_rate_enabled_) {
+      enable(vk::KHRFragmentShadingRateExtensionName);
+      fsr_features.pipelineFragmentShadingRate   = vk::True;
+      fsr_features.attachmentFragmentShadingRate = vk::True;
+
+      auto props = physical_device_.getProperties2<vk::PhysicalDeviceProperties2,
+                                                   vk::PhysicalDeviceFragmentShadingRatePropertiesKHR>();
+      fragment_shading_rate_properties_       = props.get<vk::PhysicalDeviceFragmentShadingRatePropertiesKHR>();
+      fragment_shading_rate_properties_.pNext = nullptr;
+    } else {
+      util::Logger::info("{} is not supported, every fragment is shaded at the full rate",
+                         vk::KHRFragmentShadingRateExtensionName);
+    }
+
+    if (info.prefer_descriptor_buffer && is_supported(vk::EXTDescriptorBufferExtensionName)) {
+      auto chain =
+          physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDescriptorBufferFeaturesEXT>();
+      descriptor_buffer_enabled_ =
+          chain.get<vk::PhysicalDeviceDescriptorBufferFeaturesEXT>().descriptorBuffer == vk::True;
+    }
+    if (descriptor_buffer_enabled_) {
+      enable(vk::EXTDescriptorBufferExtensionName);
+      db_features.descriptorBuffer = vk::True;
+
+      auto props = physical_device_.getProperties2<vk::PhysicalDeviceProperties2,
+                                                   vk::PhysicalDeviceDescriptorBufferPropertiesEXT>();
+      descriptor_buffer_properties_       = props.get<vk::PhysicalDeviceDescriptorBufferPropertiesEXT>();
+      descriptor_buffer_properties_.pNext = nullptr;
+    } else if (info.prefer_descriptor_buffer) {
+      util::Logger::info("{} is not supported, the descriptors are bound with the descriptor sets",
+                         vk::EXTDescriptorBufferExtensionName);
+    }
+  }
+
+  // The optional feature structures are chained in front of the Vulkan 1.4 features
+  void* optional_features = nullptr;
+  if (graphics_pipeline_library_enabled_) {
+    gpl_features.pNext = optional_features;
+    optional_features  = &gpl_features;
+  }
+  if (descriptor_buffer_enabled_) {
+    db_features.pNext = optional_features;
+    optional_features = &db_features;
+  }
+  if (extended_dynamic_state3_enabled_) {
+    eds3_features.pNext = optional_features;
+    optional_features   = &eds3_features;
+  }
+  if (shader_object_enabled_) {
+    shader_object_features.pNext = optional_features;
+    optional_features            = &shader_object_features;
+  }
+  if (mesh_shader_enabled_) {
+    mesh_shader_features.pNext = optional_features;
+    optional_features          = &mesh_shader_features;
+  }
+  if (ray_query_enabled_) {
+    as_features.pNext        = optional_features;
+    ray_query_features.pNext = &as_features;
+    optional_features        = &ray_query_features;
+  }
+  if (fragment_shading_rate_enabled_) {
+    fsr_features.pNext = optional_features;
+    optional_features  = &fsr_features;
+  }
+  if (swapchain_maintenance1_enabled_) {
+    maintenance1_features.pNext = optional_features;
+    optional_features           = &maintenance1_features;
+  }
+  if (present_wait_enabled_) {
+    present_id_features.pNext   = optional_features;
+    present_wait_features.pNext = &present_id_features;
+    optional_features           = &present_wait_features;
+  }
 
   // == Logical Device Creation ========================================================================================
 
-  vk::PhysicalDeviceVulkan14Features vk14features{};
+  vk::PhysicalDeviceVulkan14Features vk14features{
+      .pNext = optional_features,
+  };
+  dynamic_rendering_local_read_enabled_ =
+      physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan14Features>()
+          .get<vk::PhysicalDeviceVulkan14Features>()
+          .dynamicRenderingLocalRead == vk::True;
+  if (dynamic_rendering_local_read_enabled_) {
+    vk14features.dynamicRenderingLocalRead = vk::True;
+  } else {
+    util::Logger::info("dynamicRenderingLocalRead is not supported, every render pass is recorded in its own scope");
+  }
+
+  // Like the core features, the Vulkan 1.2 features are enabled as far as they are supported
+  auto vk12features =
+      physical_device_.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>()
+          .get<vk::PhysicalDeviceVulkan12Features>();
+  vk12features.pNext           = &vk14features;
+  draw_indirect_count_enabled_ = vk12features.drawIndirectCount == vk::True;
+  if (!draw_indirect_count_enabled_) {
+    util::Logger::info("drawIndirectCount is not supported, the indirect draws are recorded with a fixed count");
+  }
+
   vk::PhysicalDeviceVulkan11Features vk11features{
-      .pNext = &vk14features,  // chain forward
+      .pNext = &vk12features,  // chain forward
   };
   auto features2                    = physical_device_.getFeatures2();
   features2.pNext                   = &vk11features;
   auto features                     = features2.features;
   features.tessellationShader       = vk::True;
   vk11features.shaderDrawParameters = vk::True;
+  vk11features.multiview            = vk::True;
+  max_multiview_view_count_ =
+      physical_device_.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan11Properties>()
+          .get<vk::PhysicalDeviceVulkan11Properties>()
+          .maxMultiviewViewCount;
+
+  // The sparse features are enabled with the other core features, the binds are submitted to the graphics queue
+  const auto graphics_family_flags =
+      physical_device_.getQueueFamilyProperties()[graphics_queue_family_].queueFlags;
+  sparse_residency_enabled_ = features.sparseBinding == vk::True && features.sparseResidencyImage2D == vk::True &&
+                              (graphics_family_flags & vk::QueueFlagBits::eSparseBinding);
 
   auto device_create_info = vk::DeviceCreateInfo{
       .pNext                   = &vk11features,
-      .queueCreateInfoCount    = 1,
-      .pQueueCreateInfos       = &device_queue_create_info,
-      .enabledExtensionCount   = static_cast<uint32_t>(info.device_extensions.size()),
-      .ppEnabledExtensionNames = info.device_extensions.data(),
+      .queueCreateInfoCount    = static_cast<uint32_t>(device_queue_create_infos.size()),
+      .pQueueCreateInfos       = device_queue_create_infos.data(),
+      .enabledExtensionCount   = static_cast<uint32_t>(device_extensions.size()),
+      .ppEnabledExtensionNames = device_extensions.data(),
       .pEnabledFeatures        = &features,
   };
 
@@ -514,6 +1176,17 @@ Result<void, Error> Device::create_logical_device(const CreateInfo& info) noexce
     });
   }
 
+  if (auto result = device_.getQueue(transfer_queue_family_, transfer_queue_index_)) {
+    transfer_queue_ = std::move(*result);
+  } else {
+    eray::util::Logger::err("Failed to create a transfer queue. {}", vk::to_string(result.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Transfer Queue creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = result.error(),
+    });
+  }
+
   if (auto result = device_.getQueue(graphics_compute_queue_family_, 0)) {
     graphics_compute_queue_ = std::move(*result);
   } else {
@@ -565,13 +1238,60 @@ Result<void, Error> Device::create_command_pool() noexcept {
     });
   }
 
+  // The queues of the other families need their own pools, without them the graphics pool is used
+  const auto create_family_pool = [this](uint32_t queue_family, vk::raii::CommandPool& pool) -> Result<void, Error> {
+    auto result = device_.createCommandPool(vk::CommandPoolCreateInfo{
+        .flags            = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = queue_family,
+    });
+    if (!result) {
+      eray::util::Logger::err("Could not create a command pool. {}", vk::to_string(result.error()));
+      return std::unexpected(Error{
+          .msg     = "Vulkan Command Pool creation failure",
+          .code    = ErrorCode::VulkanObjectCreationFailure{},
+          .vk_code = result.error(),
+      });
+    }
+    pool = std::move(*result);
+    return {};
+  };
+  if (has_async_compute_queue()) {
+    TRY(create_family_pool(compute_queue_family_, compute_cmd_pool_));
+  }
+  if (has_dedicated_transfer_queue() && transfer_queue_family_ != compute_queue_family_) {
+    TRY(create_family_pool(transfer_queue_family_, transfer_cmd_pool_));
+  }
+
   return {};
 }
 
+const vk::raii::CommandPool& Device::single_time_command_pool(QueueType queue_type) const {
+  switch (queue_type) {
+    case QueueType::Graphics:
+      break;
+    case QueueType::Compute:
+      if (has_async_compute_queue()) {
+        return compute_cmd_pool_;
+      }
+      break;
+    case QueueType::Transfer:
+      if (transfer_queue_family_ == compute_queue_family_ && has_async_compute_queue()) {
+        return compute_cmd_pool_;
+      }
+      if (has_dedicated_transfer_queue()) {
+        return transfer_cmd_pool_;
+      }
+      break;
+  }
+  return single_time_cmd_pool_;
+}
+
 void Device::create_dsl() noexcept {
   dsl_manager_   = DescriptorSetLayoutManager::create(*this);
   auto ratios    = DescriptorPoolSizeRatio::create_default();
   dsl_allocator_ = DescriptorAllocator::create_and_init(*this, 100, ratios).or_panic();
+  sampler_cache_ = SamplerCache::create(*this);
+  query_pools_   = QueryPoolManager::create(*this);
 }
 
 std::vector<const char*> Device::global_extensions(const CreateInfo& info) noexcept {
@@ -640,7 +1360,36 @@ vk::raii::CommandBuffer Device::begin_single_time_commands(OptRef<vk::raii::Comm
   return cmd_buff;
 }
 
-void Device::end_single_time_commands(vk::raii::CommandBuffer& cmd_buff) const {
+vk::raii::CommandBuffer Device::begin_single_time_commands(QueueType queue_type) const {
+  auto cmd_buff_info = vk::CommandBufferAllocateInfo{
+      .commandPool        = single_time_command_pool(queue_type),
+      .level              = vk::CommandBufferLevel::ePrimary,
+      .commandBufferCount = 1,
+  };
+  auto cmd_buff = std::move(device_.allocateCommandBuffers(cmd_buff_info)->front());
+  cmd_buff.begin(vk::CommandBufferBeginInfo{
+      .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+  });
+
+  return cmd_buff;
+}
+
+void Device::end_single_time_commands(vk::raii::CommandBuffer& cmd_buff, QueueType queue_type,
+                                      const std::source_location& location) const {
+  cmd_buff.end();
+
+  const auto submit_info = vk::SubmitInfo{
+      .commandBufferCount = 1,
+      .pCommandBuffers    = &*cmd_buff,
+  };
+  const auto& target_queue = queue(queue_type);
+  target_queue.submit(submit_info, nullptr);
+
+  const auto wait = WaitScope(wait_statistics(), "Single time commands", WaitKind::Stall, location);
+  target_queue.waitIdle();
+}
+
+void Device::end_single_time_commands(vk::raii::CommandBuffer& cmd_buff, const std::source_location& location) const {
   cmd_buff.end();
 
   const auto submit_info = vk::SubmitInfo{
@@ -653,6 +1402,8 @@ void Device::end_single_time_commands(vk::raii::CommandBuffer& cmd_buff) const {
       .pSignalSemaphores    = nullptr,  //
   };
   graphics_queue().submit(submit_info, nullptr);
+
+  const auto wait = WaitScope(wait_statistics(), "Single time commands", WaitKind::Stall, location);
   graphics_queue().waitIdle();  // equivalent of having submitted a valid fence to every previously executed queue
                                 // submission command
 }
@@ -703,16 +1454,24 @@ void Device::transition_image_layout(const vk::raii::Image& image, const ImageDe
   end_single_time_commands(cmd_buff);
 }
 
-void Device::destroy() { main_deletion_queue_.flush(); }
+void Device::destroy() {
+  if (*pipeline_cache_ != nullptr) {
+    if (auto result = save_pipeline_cache(); !result) {
+      util::Logger::warn("Could not save the pipeline cache: {}", result.error().msg);
+    }
+  }
+  main_deletion_queue_.flush();
+}
 
 void Device::push_deletor(std::function<void()>&& function) { main_deletion_queue_.push_deletor(std::move(function)); }
 
 Device::~Device() { destroy(); }
 
-void Device::immediate_command_submit(const std::function<void(vk::CommandBuffer)>& function) const {
+void Device::immediate_command_submit(const std::function<void(vk::CommandBuffer)>& function,
+                                      const std::source_location& location) const {
   auto cmd_buf = begin_single_time_commands();
   function(cmd_buf);
-  end_single_time_commands(cmd_buf);
+  end_single_time_commands(cmd_buf, location);
 }
 
 bool Device::is_format_supported(vk::Format format, vk::FormatFeatureFlags features, vk::ImageTiling tiling) const {
@@ -2,6 +2,7 @@
 
 #include <vma/vk_mem_alloc.h>
 
+#include <filesystem>
 #include <functional>
 #include <liberay/os/window/window.hpp>
 #include <liberay/util/logger.hpp>
@@ -11,8 +12,16 @@
 #include <liberay/vkren/deletion_queue.hpp>
 #include <liberay/vkren/descriptor.hpp>
 #include <liberay/vkren/error.hpp>
+#include <liberay/vkren/frame_statistics.hpp>
 #include <liberay/vkren/image_description.hpp>
+#include <liberay/vkren/query_pool_manager.hpp>
+#include <liberay/vkren/sampler_cache.hpp>
 #include <liberay/vkren/vma_allocation_manager.hpp>
+#include <liberay/vkren/wait_statistics.hpp>
+#include <memory>
+#include <optional>
+#include <source_location>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_profiles.hpp>
@@ -21,11 +30,68 @@
 
 namespace eray::vkren {
 
+/**
+ * @brief Memory heap that is both DEVICE_LOCAL and HOST_VISIBLE. On discrete GPUs it is the PCIe BAR, which covers the
+ * whole VRAM when resizable BAR is enabled and 256 MiB otherwise. On integrated GPUs it is the whole memory.
+ *
+ */
+struct HostVisibleDeviceLocalHeap {
+  static constexpr vk::DeviceSize kClassicBarSizeBytes = 256 * 1024 * 1024;
+
+  uint32_t heap_index;
+  vk::DeviceSize size_bytes;
+  bool resizable_bar;
+
+  /**
+   * @brief Bytes the dynamic buffers might allocate in the host visible device local memory types before they fall
+   * back to DEVICE_LOCAL memory filled with transfers.
+   *
+   */
+  vk::DeviceSize budget_bytes;
+};
+
+/**
+ * @brief Pair of the GPU and the CPU timestamps sampled at the same moment, see `Device::calibrate_timestamps()`.
+ *
+ */
+struct TimestampCalibration {
+  uint64_t gpu_ticks;
+
+  /**
+   * @brief In the timebase of `util::CpuProfiler::now_ns()`.
+   *
+   */
+  uint64_t cpu_ns;
+
+  /**
+   * @brief Upper bound of the time between the two samples.
+   *
+   */
+  uint64_t max_deviation_ns;
+
+  float timestamp_period_ns;
+
+  /**
+   * @brief Converts a timestamp query result of any queue to the CPU timebase.
+   *
+   */
+  uint64_t to_cpu_ns(uint64_t ticks) const {
+    const auto delta_ns = static_cast<double>(static_cast<int64_t>(ticks - gpu_ticks)) * timestamp_period_ns;
+    return static_cast<uint64_t>(static_cast<int64_t>(cpu_ns) + static_cast<int64_t>(delta_ns));
+  }
+};
+
 /**
  * @brief Simplifies logical device creation and provides additional functions not available in `vk::raii:Device`.
  * One can access the vk::raii::Device via -> and * operators.
  *
  */
+/**
+ * @brief Selects the queue and the command pool used by the single time commands.
+ *
+ */
+enum class QueueType : uint8_t { Graphics, Compute, Transfer };
+
 class Device {
  public:
   ~Device();
@@ -59,7 +125,8 @@ class Device {
 
     /**
      * @brief Lambda that creates a surface, e.g. when using GLFW the creator lambda would call glfwCreateWindowSurface.
-     * If the surface creation fails the lambda should return the SurfaceCreationError.
+     * If the surface creation fails the lambda should return the SurfaceCreationError. When empty, the device is
+     * headless, see `Device::is_headless()`.
      *
      */
     SurfaceCreator surface_creator;
@@ -72,8 +139,39 @@ class Device {
      */
     vk::DebugUtilsMessageSeverityFlagsEXT severity_flags;
 
+    /**
+     * @brief Enables VK_EXT_debug_utils whenever the instance supports it, also without the validation layers, so that
+     * the objects named with `Device::set_object_name()` and the render graph passes are readable in the RenderDoc,
+     * Nsight or RGP captures.
+     *
+     */
+    bool debug_labels = true;
+
     vk::ApplicationInfo app_info;
 
+    /**
+     * @brief File the pipeline cache is loaded from at the device creation and written back on destruction. The file
+     * is ignored when it was produced by other vendor, device or driver (pipeline cache UUID). When empty, the cache
+     * is not persisted.
+     *
+     */
+    std::filesystem::path pipeline_cache_path;
+
+    /**
+     * @brief Content of the `pipeline_cache_path` read ahead with `Device::read_pipeline_cache()`, e.g. by a worker
+     * while the window is created. When unset, the file is read at the device creation.
+     *
+     */
+    std::optional<std::vector<char>> pipeline_cache_data;
+
+    /**
+     * @brief Enables VK_EXT_descriptor_buffer when the device supports it. The layouts and pipelines created with the
+     * builders then use the `DescriptorBackend::DescriptorBuffer`, the passes must bind their descriptors with a
+     * `DescriptorBuffer` instead of the descriptor sets.
+     *
+     */
+    bool prefer_descriptor_buffer = false;
+
     /**
      * @brief `DesktopTemplate` provides default device configuration for desktop platforms.
      *
@@ -103,6 +201,14 @@ class Device {
        */
       CreateInfo get(const eray::os::Window& window) noexcept;
 
+      /**
+       * @brief Returns `Device::CreateInfo` of a headless device, without a surface and the swap chain extension.
+       * Used for `os::WindowAPI::Headless` windows.
+       *
+       * @return CreateInfo
+       */
+      CreateInfo get_headless() noexcept;
+
      private:
       std::vector<const char*> validation_layers_;
       std::vector<const char*> global_extensions_;
@@ -129,9 +235,26 @@ class Device {
   vk::raii::Device& operator*() noexcept { return device_; }
   const vk::raii::Device& operator*() const noexcept { return device_; }
 
+  /**
+   * @brief True if the device has been created without a surface. The swap chain then renders into offscreen images
+   * and nothing is presented.
+   */
+  bool is_headless() const { return headless_; }
+
   vk::raii::SurfaceKHR& surface() noexcept { return surface_; }
   const vk::raii::SurfaceKHR& surface() const noexcept { return surface_; }
 
+  /**
+   * @brief Creates a surface of an additional window presented by this device, see `WindowTarget`. Fails when the
+   * presentation queue cannot present to the surface.
+   *
+   * @warning Must be called on the main thread. The surface must be destroyed before the window.
+   *
+   * @param window
+   * @return Result<vk::raii::SurfaceKHR, Error>
+   */
+  Result<vk::raii::SurfaceKHR, Error> create_surface(const os::Window& window) const;
+
   VmaAllocationManager& vma_alloc_manager() noexcept { return vma_alloc_manager_; }
   const VmaAllocationManager& vma_alloc_manager() const noexcept { return vma_alloc_manager_; }
 
@@ -160,10 +283,232 @@ class Device {
   vk::raii::Queue& graphics_queue() noexcept { return graphics_queue_; }
   const vk::raii::Queue& graphics_queue() const noexcept { return graphics_queue_; }
 
+  /**
+   * @brief True if the device exposes a compute queue family without graphics support. Otherwise the compute queue is
+   * the graphics queue.
+   */
+  bool has_async_compute_queue() const { return compute_queue_family_ != graphics_queue_family_; }
+
   uint32_t compute_queue_family() const { return compute_queue_family_; }
   vk::raii::Queue& compute_queue() noexcept { return compute_queue_; }
   const vk::raii::Queue& compute_queue() const noexcept { return compute_queue_; }
 
+  /**
+   * @brief True if the device exposes a transfer queue family without graphics and compute support, usually backed by
+   * the copy engines, or a second queue of the async compute family. Otherwise the transfer queue is the graphics
+   * queue.
+   */
+  bool has_dedicated_transfer_queue() const { return transfer_queue_family_ != graphics_queue_family_; }
+
+  uint32_t transfer_queue_family() const { return transfer_queue_family_; }
+  vk::raii::Queue& transfer_queue() noexcept { return transfer_queue_; }
+  const vk::raii::Queue& transfer_queue() const noexcept { return transfer_queue_; }
+
+  uint32_t queue_family(QueueType queue_type) const {
+    switch (queue_type) {
+      case QueueType::Compute:
+        return compute_queue_family_;
+      case QueueType::Transfer:
+        return transfer_queue_family_;
+      default:
+        return graphics_queue_family_;
+    }
+  }
+  const vk::raii::Queue& queue(QueueType queue_type) const noexcept {
+    switch (queue_type) {
+      case QueueType::Compute:
+        return compute_queue_;
+      case QueueType::Transfer:
+        return transfer_queue_;
+      default:
+        return graphics_queue_;
+    }
+  }
+
+  /**
+   * @brief True if VK_EXT_memory_budget is enabled, the heap budgets reported by the allocation manager are then
+   * queried from the driver instead of being estimated.
+   */
+  bool has_memory_budget() const { return memory_budget_enabled_; }
+
+  /**
+   * @brief Samples the GPU timestamp together with the CPU clock, so that the timestamp queries can be placed on the
+   * CPU timeline. Requires VK_EXT_calibrated_timestamps with the device and the monotonic host time domains.
+   *
+   * @return std::optional<TimestampCalibration> Empty if the calibration is not supported.
+   */
+  std::optional<TimestampCalibration> calibrate_timestamps() const;
+
+  /**
+   * @brief True if VK_EXT_debug_utils is enabled, see `CreateInfo::debug_labels`.
+   *
+   */
+  bool has_debug_utils() const { return debug_utils_enabled_; }
+
+  /**
+   * @brief Names the object in the validation messages and the GPU captures. No-op without VK_EXT_debug_utils.
+   *
+   */
+  template <typename THandle>
+  void set_object_name(THandle handle, util::zstring_view name) const {
+    if (debug_utils_enabled_ && handle) {
+      set_object_name(THandle::objectType, reinterpret_cast<uint64_t>(static_cast<typename THandle::CType>(handle)),
+                      name);
+    }
+  }
+  void set_object_name(vk::ObjectType type, uint64_t handle, util::zstring_view name) const;
+
+  /**
+   * @brief Opens a named region of the command buffer that groups its commands in the GPU captures. No-op without
+   * VK_EXT_debug_utils.
+   *
+   */
+  void begin_debug_label(vk::CommandBuffer cmd_buff, util::zstring_view name) const;
+  void end_debug_label(vk::CommandBuffer cmd_buff) const;
+
+  /**
+   * @brief True if VK_EXT_graphics_pipeline_library is enabled, the graphics pipelines might then be compiled in parts
+   * and linked, see `GraphicsPipelineBuilder::build_libraries()`.
+   */
+  bool has_graphics_pipeline_library() const { return graphics_pipeline_library_enabled_; }
+
+  /**
+   * @brief True if VK_KHR_present_id and VK_KHR_present_wait are enabled, the CPU might then wait until a presented
+   * image is displayed.
+   */
+  bool has_present_wait() const { return present_wait_enabled_; }
+
+  /**
+   * @brief True if VK_EXT_swapchain_maintenance1 is enabled, the swap chain then knows when the presentation of an
+   * image has finished and destroys the retired swap chains as soon as possible.
+   */
+  bool has_swapchain_maintenance1() const { return swapchain_maintenance1_enabled_; }
+
+  /**
+   * @brief True if VK_EXT_descriptor_buffer is enabled, see `CreateInfo::prefer_descriptor_buffer`.
+   */
+  bool has_descriptor_buffer() const { return descriptor_buffer_enabled_; }
+
+  /**
+   * @brief True if the `drawIndirectCount` feature is enabled, the number of the indirect draws might then be read from
+   * a buffer, see `IndirectDrawCuller`.
+   */
+  bool has_draw_indirect_count() const { return draw_indirect_count_enabled_; }
+
+  /**
+   * @brief The states of VK_EXT_extended_dynamic_state3 that might be dynamic, all of them are false if the extension
+   * is not supported. Only the polygon mode and the color blend states are enabled. The states of
+   * VK_EXT_extended_dynamic_state and VK_EXT_extended_dynamic_state2 are core in Vulkan 1.3 and always available.
+   */
+  const vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT& extended_dynamic_state3_features() const {
+    return extended_dynamic_state3_features_;
+  }
+
+  /**
+   * @brief True if VK_EXT_shader_object is enabled, the shaders might then be compiled without the pipelines, see
+   * `ShaderObjects` and `GraphicsProgram`.
+   */
+  bool has_shader_object() const { return shader_object_enabled_; }
+
+  /**
+   * @brief True if the task and mesh shaders of VK_EXT_mesh_shader are enabled, see
+   * `GraphicsPipelineBuilder::with_mesh_shaders()` and `MeshletCuller`.
+   */
+  bool has_mesh_shader() const { return mesh_shader_enabled_; }
+
+  /**
+   * @brief True if the acceleration structures (VK_KHR_acceleration_structure) and the ray queries in the shaders
+   * (VK_KHR_ray_query) are enabled, see `AccelerationStructureBuilder`.
+   */
+  bool has_ray_query() const { return ray_query_enabled_; }
+
+  /**
+   * @brief True if the partially resident 2D images are enabled (`sparseBinding` and `sparseResidencyImage2D`) and the
+   * graphics queue supports the sparse binding, see `ImageResource::create_sparse_texture()`.
+   */
+  bool has_sparse_residency() const { return sparse_residency_enabled_; }
+
+  /**
+   * @brief True if the `dynamicRenderingLocalRead` feature of Vulkan 1.4 is enabled, the render graph might then merge
+   * the passes reading the attachments at the same pixel into one rendering scope, see
+   * `RenderGraph::enable_pass_merging()`.
+   */
+  bool has_dynamic_rendering_local_read() const { return dynamic_rendering_local_read_enabled_; }
+
+  /**
+   * @brief True if the attachment and pipeline fragment shading rates of VK_KHR_fragment_shading_rate are enabled, see
+   * `RenderPassBuilder::with_shading_rate_image()` and `ShadingRateGenerator`.
+   */
+  bool has_fragment_shading_rate() const { return fragment_shading_rate_enabled_; }
+
+  /**
+   * @brief Largest number of the views of a multiview render pass (`maxMultiviewViewCount`, at least 6), see
+   * `RenderPassBuilder::with_view_mask()`. The `multiview` feature is required by Vulkan 1.1, so it is always enabled.
+   */
+  uint32_t max_multiview_view_count() const { return max_multiview_view_count_; }
+
+  /**
+   * @brief Backend used by the `DescriptorSetBuilder` and the pipeline builders.
+   */
+  DescriptorBackend descriptor_backend() const {
+    return descriptor_buffer_enabled_ ? DescriptorBackend::DescriptorBuffer : DescriptorBackend::DescriptorSets;
+  }
+
+  /**
+   * @brief Descriptor sizes and alignments of VK_EXT_descriptor_buffer. Valid only if `has_descriptor_buffer()`.
+   */
+  const vk::PhysicalDeviceDescriptorBufferPropertiesEXT& descriptor_buffer_properties() const {
+    return descriptor_buffer_properties_;
+  }
+
+  /**
+   * @brief Shading rate attachment texel sizes and the largest fragment size of VK_KHR_fragment_shading_rate. Valid
+   * only if `has_fragment_shading_rate()`.
+   */
+  const vk::PhysicalDeviceFragmentShadingRatePropertiesKHR& fragment_shading_rate_properties() const {
+    return fragment_shading_rate_properties_;
+  }
+
+  /**
+   * @brief Pipeline cache shared by all of the pipeline builders and ImGui.
+   */
+  const vk::raii::PipelineCache& pipeline_cache() const noexcept { return pipeline_cache_; }
+
+  /**
+   * @brief Writes the pipeline cache to the `CreateInfo::pipeline_cache_path`. Called on destruction, might be called
+   * earlier, e.g. after a batch of pipelines has been compiled.
+   */
+  Result<void, Error> save_pipeline_cache() const;
+
+  /**
+   * @brief Reads the pipeline cache file without validating it, does not need the device. Returns an empty buffer
+   * when the file does not exist or cannot be read.
+   *
+   * @param path
+   * @return std::vector<char>
+   */
+  [[nodiscard]] static std::vector<char> read_pipeline_cache(const std::filesystem::path& path);
+
+  /**
+   * @brief The largest DEVICE_LOCAL | HOST_VISIBLE heap, if any. The budget defaults to a half of the heap with
+   * resizable BAR and a quarter of the classic BAR window, which is shared with the driver.
+   */
+  const std::optional<HostVisibleDeviceLocalHeap>& host_visible_device_local_heap() const {
+    return host_visible_device_local_heap_;
+  }
+  void set_host_visible_device_local_budget(vk::DeviceSize budget_bytes);
+
+  /**
+   * @brief Bytes allocated by VMA in the DEVICE_LOCAL | HOST_VISIBLE memory types.
+   */
+  vk::DeviceSize host_visible_device_local_usage() const;
+
+  /**
+   * @brief True if a dynamic buffer of `size_bytes` fits in the host visible device local budget and the budget of its
+   * heap reported by the allocator.
+   */
+  bool fits_host_visible_device_local(vk::DeviceSize size_bytes) const;
+
   uint32_t presentation_queue_family() const { return presentation_queue_family_; }
   vk::raii::Queue& presentation_queue() noexcept { return presentation_queue_; }
   const vk::raii::Queue& presentation_queue() const noexcept { return presentation_queue_; }
@@ -190,18 +535,39 @@ class Device {
       OptRef<vk::raii::CommandPool> command_pool = std::nullopt) const;
 
   /**
-   * @brief Blocks the CPU until the commands are submitted.
+   * @brief Blocks the CPU until the commands are submitted. The wait is recorded as a stall at the `location`, see
+   * `wait_statistics()`.
    *
    * @param cmd_buff
+   * @param location
    */
-  void end_single_time_commands(vk::raii::CommandBuffer& cmd_buff) const;
+  void end_single_time_commands(vk::raii::CommandBuffer& cmd_buff,
+                                const std::source_location& location = std::source_location::current()) const;
 
   /**
-   * @brief Blocks the CPU until the commands are submitted.
+   * @brief Allocates the command buffer from the pool of the queue family, to be ended with
+   * `end_single_time_commands(cmd_buff, queue_type)`. The uploads recorded for the transfer queue run on the copy
+   * engines, the resources used later on the graphics queue require a queue family ownership transfer, unless they
+   * are created with the concurrent sharing mode.
    *
-   * @param cmd_buff
    */
-  void immediate_command_submit(const std::function<void(vk::CommandBuffer)>& function) const;
+  [[nodiscard]] vk::raii::CommandBuffer begin_single_time_commands(QueueType queue_type) const;
+
+  /**
+   * @brief Submits the commands to the queue of the type and blocks the CPU until they are executed.
+   *
+   */
+  void end_single_time_commands(vk::raii::CommandBuffer& cmd_buff, QueueType queue_type,
+                                const std::source_location& location = std::source_location::current()) const;
+
+  /**
+   * @brief Blocks the CPU until the commands are submitted. The wait is recorded as a stall at the `location`.
+   *
+   * @param function
+   * @param location
+   */
+  void immediate_command_submit(const std::function<void(vk::CommandBuffer)>& function,
+                                const std::source_location& location = std::source_location::current()) const;
 
   /**
    * @brief Non-blocking, defines a pipeline barrier.
@@ -223,6 +589,39 @@ class Device {
   DescriptorAllocator& dsl_allocator() { return dsl_allocator_; }
   const DescriptorAllocator& dsl_allocator() const { return dsl_allocator_; }
 
+  SamplerCache& sampler_cache() { return sampler_cache_; }
+  const SamplerCache& sampler_cache() const { return sampler_cache_; }
+
+  /**
+   * @brief Returns the sampler shared by all of the requests with the same info, see `SamplerCache`. The sampler must
+   * not be destroyed by the caller.
+   *
+   */
+  [[nodiscard]] Result<vk::Sampler, Error> sampler(const vk::SamplerCreateInfo& create_info) {
+    return sampler_cache_.get(create_info);
+  }
+
+  /**
+   * @brief Timestamp, occlusion and pipeline statistics query pools, see `QueryPoolManager`.
+   *
+   */
+  QueryPoolManager& query_pools() { return query_pools_; }
+  const QueryPoolManager& query_pools() const { return query_pools_; }
+
+  /**
+   * @brief Draws, dispatches, barriers, descriptor allocations, staging uploads and pipeline cache hits of the frames,
+   * see `FrameStatistics`. Writable through the const device, so that the const recording paths can count too.
+   *
+   */
+  FrameStatistics& statistics() const { return *statistics_; }
+
+  /**
+   * @brief CPU time blocked on the GPU by the call sites, see `WaitStatistics`. Writable through the const device, as
+   * most of the waits are.
+   *
+   */
+  WaitStatistics& wait_statistics() const { return *wait_statistics_; }
+
  private:
   Device() = default;
 
@@ -231,7 +630,11 @@ class Device {
   Result<void, Error> pick_physical_device(const CreateInfo& info) noexcept;
   Result<void, Error> create_logical_device(const CreateInfo& info) noexcept;
   Result<void, Error> create_command_pool() noexcept;
+  Result<void, Error> create_pipeline_cache(const CreateInfo& info) noexcept;
   void create_dsl() noexcept;
+  void detect_host_visible_device_local_heap() noexcept;
+
+  const vk::raii::CommandPool& single_time_command_pool(QueueType queue_type) const;
 
   std::vector<const char*> global_extensions(const CreateInfo& info) noexcept;
 
@@ -296,6 +699,16 @@ class Device {
    */
   vk::raii::CommandPool single_time_cmd_pool_ = nullptr;
 
+  /**
+   * @brief Pools of the async compute and the transfer queue families, null when the family is the graphics one.
+   *
+   */
+  vk::raii::CommandPool compute_cmd_pool_  = nullptr;
+  vk::raii::CommandPool transfer_cmd_pool_ = nullptr;
+
+  vk::raii::PipelineCache pipeline_cache_ = nullptr;
+  std::filesystem::path pipeline_cache_path_;
+
   /**
    * @brief Vulkan Memory Allocator.
    *
@@ -315,11 +728,48 @@ class Device {
   uint32_t graphics_queue_family_{};
   vk::raii::Queue compute_queue_ = nullptr;
   uint32_t compute_queue_family_{};
+  vk::raii::Queue transfer_queue_ = nullptr;
+  uint32_t transfer_queue_family_{};
+  uint32_t transfer_queue_index_{};
   vk::raii::Queue presentation_queue_ = nullptr;
   uint32_t presentation_queue_family_{};
 
+  bool memory_budget_enabled_                = false;
+  bool debug_utils_enabled_                  = false;
+  bool calibrated_timestamps_enabled_        = false;
+  bool graphics_pipeline_library_enabled_    = false;
+  bool descriptor_buffer_enabled_            = false;
+  bool present_wait_enabled_                 = false;
+  bool surface_maintenance1_enabled_         = false;
+  bool swapchain_maintenance1_enabled_       = false;
+  bool draw_indirect_count_enabled_          = false;
+  bool extended_dynamic_state3_enabled_      = false;
+  bool shader_object_enabled_                = false;
+  bool mesh_shader_enabled_                  = false;
+  bool ray_query_enabled_                    = false;
+  bool sparse_residency_enabled_             = false;
+  bool fragment_shading_rate_enabled_        = false;
+  bool dynamic_rendering_local_read_enabled_ = false;
+  bool headless_                             = false;
+
+  vk::PhysicalDeviceDescriptorBufferPropertiesEXT descriptor_buffer_properties_{};
+  vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT extended_dynamic_state3_features_{};
+  vk::PhysicalDeviceFragmentShadingRatePropertiesKHR fragment_shading_rate_properties_{};
+  uint32_t max_multiview_view_count_ = 0;
+
+  std::optional<HostVisibleDeviceLocalHeap> host_visible_device_local_heap_;
+
   DescriptorSetLayoutManager dsl_manager_ = DescriptorSetLayoutManager(nullptr);
   DescriptorAllocator dsl_allocator_      = DescriptorAllocator(nullptr);
+  SamplerCache sampler_cache_             = SamplerCache(nullptr);
+  QueryPoolManager query_pools_           = QueryPoolManager(nullptr);
+
+  /**
+   * @brief Boxed, the atomics and the mutex would make the device immovable.
+   *
+   */
+  std::unique_ptr<FrameStatistics> statistics_     = std::make_unique<FrameStatistics>();
+  std::unique_ptr<WaitStatistics> wait_statistics_ = std::make_unique<WaitStatistics>();
 };
 
 }  // namespace eray::vkren
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cmath>
+#include <liberay/vkren/dynamic_resolution.hpp>
+
+namespace eray::vkren {
+
+DynamicResolutionController DynamicResolutionController::create(const DynamicResolutionInfo& info) {
+  auto controller   = DynamicResolutionController(nullptr);
+  controller.info_  = info;
+  controller.scale_ = info.max_scale;
+  return controller;
+}
+
+void DynamicResolutionController::update(RenderGraph& render_graph) {
+  update_scale(render_graph.profiling_results());
+  for (const auto extent : info_.extents) {
+    render_graph.set_render_scale(extent, scale_);
+  }
+}
+
+void DynamicResolutionController::update_scale(std::span<const PassProfilingResult> results) {
+  if (results.empty()) {
+    return;
+  }
+
+  auto gpu_time_ms = 0.0;
+  for (const auto& result : results) {
+    gpu_time_ms += result.gpu_time_ms;
+  }
+  gpu_time_ms_ = gpu_time_ms_ == 0.0 ? gpu_time_ms : std::lerp(gpu_time_ms_, gpu_time_ms, info_.smoothing);
+
+  if (settle_frames_left_ > 0) {
+    --settle_frames_left_;
+    return;
+  }
+
+  const auto target = info_.target_gpu_time_ms;
+  if (gpu_time_ms_ <= target && gpu_time_ms_ >= (1.0 - info_.headroom) * target) {
+    return;
+  }
+
+  // The cost is proportional to the pixel count, aim at the middle of the headroom band
+  const auto goal  = (1.0 - 0.5 * info_.headroom) * target;
+  const auto ideal = static_cast<float>(scale_ * std::sqrt(goal / std::max(gpu_time_ms_, 1e-3)));
+  const auto step  = std::clamp(ideal - scale_, -info_.max_scale_step, info_.max_scale_step);
+  const auto scale = std::clamp(scale_ + step, info_.min_scale, info_.max_scale);
+  if (scale == scale_) {
+    return;
+  }
+
+  // The effect of the new scale shows up once the frames in flight are measured
+  scale_              = scale;
+  settle_frames_left_ = info_.settle_frame_count;
+  gpu_time_ms_        = 0.0;
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/vkren/render_graph.hpp>
+#include <span>
+#include <vector>
+
+namespace eray::vkren {
+
+struct DynamicResolutionInfo {
+  /**
+   * @brief Extents whose render scale is controlled. The attachments that follow them should be created at the largest
+   * size the passes are rendered at, the controller only scales the render area down.
+   *
+   */
+  std::vector<RenderGraphExtentHandle> extents;
+
+  /**
+   * @brief GPU time budget of all of the profiled passes in milliseconds.
+   *
+   */
+  double target_gpu_time_ms = 14.0;
+
+  float min_scale = 0.5F;
+  float max_scale = 1.F;
+
+  /**
+   * @brief Largest change of the scale applied at once, prevents the oscillation on the load spikes.
+   *
+   */
+  float max_scale_step = 0.05F;
+
+  /**
+   * @brief Smoothed GPU time within [(1 - headroom) * target, target] keeps the scale unchanged.
+   *
+   */
+  double headroom = 0.1;
+
+  /**
+   * @brief Weight of the newest GPU time in the exponential moving average.
+   *
+   */
+  double smoothing = 0.2;
+
+  /**
+   * @brief Number of the updates skipped after a scale change, the profiling results lag behind by the frames in
+   * flight.
+   *
+   */
+  uint32_t settle_frame_count = 4;
+};
+
+/**
+ * @brief Adjusts the render scale of the render graph extents (see `RenderGraph::set_render_scale()`) so that the GPU
+ * time of the frame stays within the budget. The cost of the passes that follow the extents is assumed to be
+ * proportional to the number of rendered pixels, i.e. to the square of the scale. The GPU time is the sum of the pass
+ * times measured by the render graph profiling, which must be enabled (see `RenderGraph::enable_profiling()`).
+ *
+ */
+class DynamicResolutionController {
+ public:
+  DynamicResolutionController() = delete;
+  explicit DynamicResolutionController(std::nullptr_t) {}
+
+  [[nodiscard]] static DynamicResolutionController create(const DynamicResolutionInfo& info);
+
+  /**
+   * @brief Reads the latest pass times and updates the render scale of the extents. Must be called once per frame,
+   * before the render graph is emitted.
+   *
+   * @param render_graph
+   */
+  void update(RenderGraph& render_graph);
+
+  float scale() const { return scale_; }
+
+  /**
+   * @brief Exponential moving average of the GPU time in milliseconds.
+   *
+   */
+  double gpu_time_ms() const { return gpu_time_ms_; }
+
+  const DynamicResolutionInfo& info() const { return info_; }
+  void set_target_gpu_time_ms(double target_gpu_time_ms) { info_.target_gpu_time_ms = target_gpu_time_ms; }
+
+ private:
+  void update_scale(std::span<const PassProfilingResult> results);
+
+  DynamicResolutionInfo info_;
+  float scale_                 = 1.F;
+  double gpu_time_ms_          = 0.0;
+  uint32_t settle_frames_left_ = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,365 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <expected>
+#include <liberay/util/profiler.hpp>
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/frame_capture.hpp>
+#include <liberay/vkren/image_format_helpers.hpp>
+#include <utility>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+FrameCapture::EncoderThread::EncoderThread(size_t capacity, Encoder&& encoder)
+    : frames(capacity), released_slots(capacity), encoder(std::move(encoder)), thread([this] { run(); }) {}
+
+FrameCapture::EncoderThread::~EncoderThread() {
+  stop.store(true, std::memory_order_release);
+  pushed_count.fetch_add(1, std::memory_order_release);
+  pushed_count.notify_one();
+  thread.join();
+}
+
+void FrameCapture::EncoderThread::run() {
+  ERAY_PROFILE_THREAD_NAME("Frame encoder");
+  while (true) {
+    // Loaded before the queue is drained, so a frame pushed after the last pop ends the wait right away
+    const auto pushed = pushed_count.load(std::memory_order_acquire);
+    while (auto frame = frames.try_pop()) {
+      {
+        ERAY_PROFILE_SCOPE("Encode frame");
+        encoder(*frame);
+      }
+      released_slots.try_push(frame->_slot);
+      encoded_count.fetch_add(1, std::memory_order_release);
+      encoded_count.notify_all();
+    }
+    if (stop.load(std::memory_order_acquire)) {
+      return;
+    }
+    pushed_count.wait(pushed, std::memory_order_acquire);
+  }
+}
+
+Result<FrameCapture, Error> FrameCapture::create(Device& device, FrameDeletionQueue& deletion_queue,
+                                                 const CreateInfo& info, Encoder encoder) {
+  assert(info.buffer_count > 0 && "Expected at least one readback buffer");
+  assert((info.pixel_format != CapturePixelFormat::Yuv420 || info.yuv_shader) &&
+         "The YUV captures require the frame_capture.slang module");
+
+  auto capture              = FrameCapture(nullptr);
+  capture.p_device_         = &device;
+  capture.p_deletion_queue_ = &deletion_queue;
+  capture.pixel_format_     = info.pixel_format;
+
+  if (info.pixel_format == CapturePixelFormat::Yuv420) {
+    auto layout = DescriptorSetBuilder::create(device)
+                      .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                      .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                      .build_push_descriptor_layout();
+    if (!layout) {
+      return std::unexpected(layout.error());
+    }
+
+    auto push_constant_ranges = std::array{vk::PushConstantRange{
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset     = 0,
+        .size       = sizeof(PushConstants),
+    }};
+    auto pipeline = ComputePipelineBuilder::create()
+                        .with_shader(info.yuv_shader)
+                        .with_descriptor_set_layout(*layout)
+                        .with_push_constant_ranges(push_constant_ranges)
+                        .build(device);
+    if (!pipeline) {
+      return std::unexpected(pipeline.error());
+    }
+    capture.yuv_pipeline_ = std::move(*pipeline);
+    capture.binder_       = DescriptorSetBinder::create(device);
+  }
+
+  capture.slots_.resize(info.buffer_count);
+  capture.encoder_thread_ = std::make_unique<EncoderThread>(info.buffer_count, std::move(encoder));
+
+  return capture;
+}
+
+bool FrameCapture::supports(vk::Format format, CapturePixelFormat pixel_format) {
+  if (helper::is_compressed_format(format)) {
+    return false;
+  }
+
+  switch (pixel_format) {
+    case CapturePixelFormat::Source:
+      return helper::bytes_per_pixel(format) > 0;
+    case CapturePixelFormat::Yuv420:
+      return format == vk::Format::eR8G8B8A8Unorm || format == vk::Format::eR8G8B8A8Srgb ||
+             format == vk::Format::eB8G8R8A8Unorm || format == vk::Format::eB8G8R8A8Srgb;
+  }
+  return false;
+}
+
+Result<bool, Error> FrameCapture::record_capture(vk::CommandBuffer cmd_buff, vk::Image image, vk::Format format,
+                                                 vk::Extent2D extent, vk::ImageLayout layout, uint64_t frame) {
+  ERAY_PROFILE_FUNCTION();
+  assert(supports(format, pixel_format_) && "The image format cannot be captured");
+
+  release_encoded_slots();
+  auto slot = std::ranges::find(slots_, SlotState::Free, &Slot::state);
+  if (slot == slots_.end()) {
+    ++dropped_frame_count_;
+    return false;
+  }
+
+  const auto yuv        = pixel_format_ == CapturePixelFormat::Yuv420;
+  const auto texel_size = static_cast<vk::DeviceSize>(helper::bytes_per_pixel(format));
+  const auto image_size = texel_size * extent.width * extent.height;
+
+  auto captured = CapturedFrame{
+      .pixels        = {},
+      .width         = extent.width,
+      .height        = extent.height,
+      .pixel_format  = pixel_format_,
+      .source_format = format,
+      .frame         = frame,
+      ._slot         = static_cast<uint32_t>(slot - slots_.begin()),
+  };
+  auto size_bytes = image_size;
+  if (yuv) {
+    captured.width  = extent.width & ~(kYuvBlockWidth - 1);
+    captured.height = extent.height & ~(kYuvBlockHeight - 1);
+    size_bytes      = static_cast<vk::DeviceSize>(captured.width) * captured.height * 3 / 2;
+  }
+  if (size_bytes == 0) {
+    ++dropped_frame_count_;
+    return false;
+  }
+
+  TRY(reserve_slot(*slot, size_bytes));
+  if (yuv) {
+    TRY(reserve_yuv_input(image_size));
+  }
+  captured.pixels = std::span(static_cast<const std::byte*>(slot->buffer->mapped_data), size_bytes);
+
+  const auto range = vk::ImageSubresourceRange{
+      .aspectMask     = vk::ImageAspectFlagBits::eColor,
+      .baseMipLevel   = 0,
+      .levelCount     = 1,
+      .baseArrayLayer = 0,
+      .layerCount     = 1,
+  };
+  auto to_transfer_src = vk::ImageMemoryBarrier2{
+      .srcStageMask        = vk::PipelineStageFlagBits2::eAllCommands,
+      .srcAccessMask       = vk::AccessFlagBits2::eMemoryWrite,
+      .dstStageMask        = vk::PipelineStageFlagBits2::eCopy,
+      .dstAccessMask       = vk::AccessFlagBits2::eTransferRead,
+      .oldLayout           = layout,
+      .newLayout           = vk::ImageLayout::eTransferSrcOptimal,
+      .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .image               = image,
+      .subresourceRange    = range,
+  };
+
+  // The conversion of the previous capture might still read the YUV input
+  auto yuv_input_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageRead,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eCopy,
+      .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount      = yuv ? 1U : 0U,
+      .pMemoryBarriers         = &yuv_input_barrier,
+      .imageMemoryBarrierCount = 1,
+      .pImageMemoryBarriers    = &to_transfer_src,
+  });
+
+  const auto region = vk::BufferImageCopy{
+      .bufferOffset      = 0,
+      .bufferRowLength   = 0,
+      .bufferImageHeight = 0,
+      .imageSubresource =
+          vk::ImageSubresourceLayers{
+              .aspectMask     = vk::ImageAspectFlagBits::eColor,
+              .mipLevel       = 0,
+              .baseArrayLayer = 0,
+              .layerCount     = 1,
+          },
+      .imageOffset = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+      .imageExtent = vk::Extent3D{.width = extent.width, .height = extent.height, .depth = 1},
+  };
+  cmd_buff.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal,
+                             yuv ? yuv_input_->vk_buffer() : slot->buffer->buffer.vk_buffer(), region);
+
+  auto to_layout          = to_transfer_src;
+  to_layout.srcStageMask  = vk::PipelineStageFlagBits2::eCopy;
+  to_layout.srcAccessMask = vk::AccessFlagBits2::eNone;
+  to_layout.dstStageMask  = vk::PipelineStageFlagBits2::eAllCommands;
+  to_layout.dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite;
+  to_layout.oldLayout     = vk::ImageLayout::eTransferSrcOptimal;
+  to_layout.newLayout     = layout;
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .imageMemoryBarrierCount = 1,
+      .pImageMemoryBarriers    = &to_layout,
+  });
+
+  if (yuv) {
+    record_yuv_conversion(cmd_buff, *slot, captured, format, extent.width);
+  }
+
+  auto host_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = yuv ? vk::PipelineStageFlagBits2::eComputeShader : vk::PipelineStageFlagBits2::eCopy,
+      .srcAccessMask = yuv ? vk::AccessFlagBits2::eShaderStorageWrite : vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eHost,
+      .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &host_barrier,
+  });
+
+  slot->state           = SlotState::InFlight;
+  slot->frame           = captured;
+  last_in_flight_frame_ = std::max(last_in_flight_frame_, frame);
+  ++in_flight_count_;
+
+  return true;
+}
+
+void FrameCapture::record_yuv_conversion(vk::CommandBuffer cmd_buff, const Slot& slot, const CapturedFrame& captured,
+                                         vk::Format format, uint32_t source_width) {
+  auto copy_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eCopy,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &copy_barrier,
+  });
+
+  binder_.clear();
+  binder_.bind_buffer(0, yuv_input_->desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(1, slot.buffer->buffer.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+
+  const auto push_constants = PushConstants{
+      .width        = captured.width,
+      .height       = captured.height,
+      .source_width = source_width,
+      .bgr          = format == vk::Format::eB8G8R8A8Unorm || format == vk::Format::eB8G8R8A8Srgb ? 1U : 0U,
+  };
+  const auto blocks_x = captured.width / kYuvBlockWidth;
+  const auto blocks_y = captured.height / kYuvBlockHeight;
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, yuv_pipeline_.pipeline);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, yuv_pipeline_.layout);
+  cmd_buff.pushConstants<PushConstants>(yuv_pipeline_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants);
+  cmd_buff.dispatch((blocks_x + kWorkgroupSide - 1) / kWorkgroupSide, (blocks_y + kWorkgroupSide - 1) / kWorkgroupSide,
+                    1);
+  p_device_->statistics().count_dispatches();
+}
+
+void FrameCapture::poll(const FrameTimeline& timeline) {
+  release_encoded_slots();
+  if (in_flight_count_ == 0) {
+    return;
+  }
+
+  ERAY_PROFILE_FUNCTION();
+
+  // The encoder gets the frames in the capture order
+  auto ready = std::vector<Slot*>();
+  for (auto& slot : slots_) {
+    if (slot.state == SlotState::InFlight && timeline.is_complete(slot.frame.frame)) {
+      ready.push_back(&slot);
+    }
+  }
+  std::ranges::sort(ready, {}, [](const Slot* slot) { return slot->frame.frame; });
+
+  auto& encoder_thread = *encoder_thread_;
+  for (auto* slot : ready) {
+    // The memory might not be host coherent
+    const auto& buffer = slot->buffer->buffer;
+    vmaInvalidateAllocation(buffer._p_device->vma_alloc_manager().allocator(), buffer._buffer._allocation, 0,
+                            slot->frame.pixels.size());
+
+    // A queue has a place for every slot
+    [[maybe_unused]] const auto pushed = encoder_thread.frames.try_push(slot->frame);
+    assert(pushed && "The encoder queue must hold all of the slots");
+    slot->state = SlotState::Encoding;
+    --in_flight_count_;
+    ++captured_frame_count_;
+  }
+
+  if (!ready.empty()) {
+    encoder_thread.pushed_count.fetch_add(1, std::memory_order_release);
+    encoder_thread.pushed_count.notify_one();
+  }
+}
+
+Result<void, Error> FrameCapture::finish(const FrameTimeline& timeline) {
+  ERAY_PROFILE_FUNCTION();
+  if (in_flight_count_ > 0) {
+    TRY(timeline.wait(last_in_flight_frame_, UINT64_MAX, WaitKind::Stall));
+  }
+  poll(timeline);
+
+  auto& encoder_thread = *encoder_thread_;
+  const auto queued    = captured_frame_count_;
+  for (auto encoded = encoder_thread.encoded_count.load(std::memory_order_acquire); encoded < queued;
+       encoded      = encoder_thread.encoded_count.load(std::memory_order_acquire)) {
+    encoder_thread.encoded_count.wait(encoded, std::memory_order_acquire);
+  }
+  release_encoded_slots();
+
+  return {};
+}
+
+Result<void, Error> FrameCapture::reserve_slot(Slot& slot, vk::DeviceSize size_bytes) {
+  if (slot.buffer && slot.capacity_bytes >= size_bytes) {
+    return {};
+  }
+
+  // The conversion writes the planes as uints
+  const auto usage = pixel_format_ == CapturePixelFormat::Yuv420
+                         ? vk::BufferUsageFlags(vk::BufferUsageFlagBits::eStorageBuffer)
+                         : vk::BufferUsageFlags{};
+  TRY_UNWRAP_DEFINE(buffer, BufferResource::create_readback_buffer(*p_device_, size_bytes, usage));
+  buffer.buffer.set_debug_name("Frame capture readback");
+  slot.buffer         = std::move(buffer);
+  slot.capacity_bytes = size_bytes;
+
+  return {};
+}
+
+Result<void, Error> FrameCapture::reserve_yuv_input(vk::DeviceSize size_bytes) {
+  if (yuv_input_ && yuv_input_->size_bytes >= size_bytes) {
+    return {};
+  }
+
+  TRY_UNWRAP_DEFINE(buffer, BufferResource::create_gpu_local_buffer(*p_device_, size_bytes,
+                                                                    vk::BufferUsageFlagBits::eStorageBuffer));
+  buffer.set_debug_name("Frame capture YUV input");
+
+  // The previous captures might still convert from the old buffer
+  if (yuv_input_) {
+    p_deletion_queue_->push(std::move(yuv_input_->_buffer));
+  }
+  yuv_input_ = std::move(buffer);
+
+  return {};
+}
+
+void FrameCapture::release_encoded_slots() {
+  while (auto slot = encoder_thread_->released_slots.try_pop()) {
+    slots_[*slot].state = SlotState::Free;
+  }
+}
+
+}  // namespace eray::vkren
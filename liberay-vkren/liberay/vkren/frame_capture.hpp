@@ -0,0 +1,300 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <liberay/util/ring_buffer.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/deletion_queue.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/frame_timeline.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+enum class CapturePixelFormat : uint8_t {
+  /**
+   * @brief The texels of the captured image as they are, tightly packed, e.g. BGRA8 for most of the swap chains.
+   *
+   */
+  Source = 0,
+
+  /**
+   * @brief Planar 8-bit YUV 4:2:0 (I420) with the BT.709 limited range coefficients: the Y plane, then the U and the V
+   * planes of half the width and the height. Converted by a compute shader before the readback, so only 1.5 bytes per
+   * pixel cross the bus instead of 4. The captured size is rounded down to a multiple of 8 by 2 pixels.
+   *
+   */
+  Yuv420 = 1,
+};
+
+/**
+ * @brief Pixels of a captured frame handed to the encoder. The `pixels` point into the mapped readback buffer and are
+ * valid until the encoder returns.
+ *
+ */
+struct CapturedFrame {
+  std::span<const std::byte> pixels;
+  uint32_t width;
+  uint32_t height;
+  CapturePixelFormat pixel_format;
+
+  /**
+   * @brief Format of the captured image, the layout of the `CapturePixelFormat::Source` pixels.
+   *
+   */
+  vk::Format source_format;
+
+  /**
+   * @brief `FrameTimeline` frame that recorded the capture.
+   *
+   */
+  uint64_t frame;
+
+  uint32_t _slot;
+};
+
+/**
+ * @brief Records the frames, e.g. of a session, without stalling the rendering. `record_capture()` copies the image
+ * (the swap chain image or any attachment) into one of the ring of persistently mapped readback buffers. `poll()`
+ * checks the `FrameTimeline` and hands the buffers of the completed frames to the encoder thread through a lock-free
+ * queue, usually two or three frames after the capture. The encoder thread calls the `Encoder` with the pixels in
+ * place, the buffer returns to the ring once it is done.
+ *
+ * @code
+ * auto capture = FrameCapture::create(device, deletion_queue, {}, [&](const CapturedFrame& frame) {
+ *   video_encoder.push(frame.pixels, frame.width, frame.height);
+ * }).or_panic("Could not start the capture");
+ * // Every frame, after the swap chain image is rendered
+ * capture.record_capture(cmd_buff, swap_chain.images()[image_index], swap_chain.image_format(), swap_chain.extent(),
+ *                        vk::ImageLayout::ePresentSrcKHR, timeline.current_frame());
+ * // Every frame, after the wait for the frame in flight
+ * capture.poll(timeline);
+ * @endcode
+ *
+ * When the encoder falls behind, all of the buffers end up queued for the encoder and the new frames are dropped, see
+ * `dropped_frame_count()`, the rendering is never blocked.
+ *
+ * @warning Lifetime is bound by the device lifetime. Call `finish()` before the destruction, otherwise the frames in
+ * flight are lost and the GPU might still write to their buffers.
+ *
+ */
+class FrameCapture {
+ public:
+  using Encoder = std::function<void(const CapturedFrame&)>;
+
+  FrameCapture() = delete;
+  explicit FrameCapture(std::nullptr_t) {}
+
+  /**
+   * @brief Workgroup size of the `rgbToYuv420` entry point, must match the `numthreads` of `frame_capture.slang`.
+   *
+   */
+  static constexpr uint32_t kWorkgroupSide = 8;
+
+  /**
+   * @brief Pixels converted by a thread of the `rgbToYuv420` entry point: a row of 8 pixels in 2 rows.
+   *
+   */
+  static constexpr uint32_t kYuvBlockWidth  = 8;
+  static constexpr uint32_t kYuvBlockHeight = 2;
+
+  struct CreateInfo {
+    CapturePixelFormat pixel_format = CapturePixelFormat::Source;
+
+    /**
+     * @brief Number of the readback buffers, shared by the captures in flight and the frames waiting for the encoder.
+     * At least the number of the frames in flight plus one, so that the encoder has a frame to work on.
+     *
+     */
+    uint32_t buffer_count = 4;
+
+    /**
+     * @brief Module compiled from `liberay-vkren/shaders/frame_capture.slang`, required by
+     * `CapturePixelFormat::Yuv420`.
+     *
+     */
+    vk::ShaderModule yuv_shader = nullptr;
+  };
+
+  /**
+   * @brief Creates the YUV conversion pipeline, if requested, and starts the encoder thread. The readback buffers are
+   * allocated by the first captures.
+   *
+   * @param device
+   * @param deletion_queue Releases the conversion input buffer when it grows.
+   * @param info
+   * @param encoder Called on the encoder thread, one frame at a time in the capture order.
+   * @return Result<FrameCapture, Error>
+   */
+  [[nodiscard]] static Result<FrameCapture, Error> create(Device& device, FrameDeletionQueue& deletion_queue,
+                                                          const CreateInfo& info, Encoder encoder);
+
+  /**
+   * @brief True if the images of the format can be captured with the `pixel_format`. The `Yuv420` captures need an
+   * RGBA8 or BGRA8 image, the `Source` ones any uncompressed format.
+   *
+   */
+  static bool supports(vk::Format format, CapturePixelFormat pixel_format);
+
+  /**
+   * @brief Records the copy of the image to a free readback buffer, followed by the YUV conversion if requested, and
+   * a barrier that makes it visible to the host. Must be recorded outside of rendering, the image is transitioned to
+   * the VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL layout and back.
+   *
+   * @param cmd_buff Must be submitted to a queue with the compute support if the capture converts to YUV.
+   * @param image Must have VK_IMAGE_USAGE_TRANSFER_SRC_BIT set, e.g. see `SwapChain::image_usage()`.
+   * @param format Must be supported, see `supports()`.
+   * @param extent
+   * @param layout Layout of the image at this point of the `cmd_buff`, it is left in the same layout.
+   * @param frame Frame that submits the `cmd_buff`, i.e. `FrameTimeline::current_frame()`.
+   * @return Result<bool, Error> False when the frame was dropped, because all of the buffers are in use. Fails when a
+   * readback buffer cannot be allocated.
+   */
+  Result<bool, Error> record_capture(vk::CommandBuffer cmd_buff, vk::Image image, vk::Format format,
+                                     vk::Extent2D extent, vk::ImageLayout layout, uint64_t frame);
+
+  /**
+   * @brief Never blocks. Hands the captures of the completed frames to the encoder and takes back the buffers the
+   * encoder is done with.
+   *
+   * @param timeline
+   */
+  void poll(const FrameTimeline& timeline);
+
+  /**
+   * @brief Waits for the frames with a capture in flight and for the encoder to process all of the queued frames.
+   *
+   * @param timeline
+   * @return Result<void, Error>
+   */
+  Result<void, Error> finish(const FrameTimeline& timeline);
+
+  CapturePixelFormat pixel_format() const { return pixel_format_; }
+  uint32_t buffer_count() const { return static_cast<uint32_t>(slots_.size()); }
+
+  /**
+   * @brief Number of the captures waiting for the GPU.
+   *
+   */
+  uint32_t in_flight_count() const { return in_flight_count_; }
+
+  /**
+   * @brief Number of the frames handed to the encoder.
+   *
+   */
+  uint64_t captured_frame_count() const { return captured_frame_count_; }
+
+  /**
+   * @brief Number of the frames not captured, because all of the buffers were in flight or waiting for the encoder.
+   *
+   */
+  uint64_t dropped_frame_count() const { return dropped_frame_count_; }
+
+ private:
+  enum class SlotState : uint8_t {
+    Free,
+    InFlight,
+    Encoding,
+  };
+
+  struct Slot {
+    std::optional<PersistentlyMappedBufferResource> buffer;
+    vk::DeviceSize capacity_bytes = 0;
+    SlotState state               = SlotState::Free;
+    CapturedFrame frame{};
+  };
+
+  /**
+   * @brief Push constants of `frame_capture.slang`.
+   *
+   */
+  struct PushConstants {
+    uint32_t width;
+    uint32_t height;
+    uint32_t source_width;
+    uint32_t bgr;
+  };
+
+  /**
+   * @brief State shared with the encoder thread. The render thread pushes the frames and pops the released slots,
+   * the encoder thread the other way around, so both of the queues have a single producer and a single consumer.
+   * The destructor stops the thread once the queued frames are encoded.
+   *
+   */
+  struct EncoderThread {
+    EncoderThread(size_t capacity, Encoder&& encoder);
+    ~EncoderThread();
+
+    EncoderThread(const EncoderThread&)            = delete;
+    EncoderThread& operator=(const EncoderThread&) = delete;
+
+    void run();
+
+    util::SpscRingBuffer<CapturedFrame> frames;
+    util::SpscRingBuffer<uint32_t> released_slots;
+
+    /**
+     * @brief Incremented after every push to `frames`, the encoder thread waits on it when the queue is empty.
+     *
+     */
+    std::atomic<uint64_t> pushed_count{0};
+    std::atomic<uint64_t> encoded_count{0};
+    std::atomic<bool> stop{false};
+
+    Encoder encoder;
+    std::thread thread;
+  };
+
+  /**
+   * @brief Grows the slot buffer to hold `size_bytes`. The slot is free, so its buffer is not used by the GPU nor by
+   * the encoder.
+   *
+   */
+  Result<void, Error> reserve_slot(Slot& slot, vk::DeviceSize size_bytes);
+
+  Result<void, Error> reserve_yuv_input(vk::DeviceSize size_bytes);
+
+  void record_yuv_conversion(vk::CommandBuffer cmd_buff, const Slot& slot, const CapturedFrame& captured,
+                             vk::Format format, uint32_t source_width);
+
+  void release_encoded_slots();
+
+  observer_ptr<Device> p_device_                     = nullptr;
+  observer_ptr<FrameDeletionQueue> p_deletion_queue_ = nullptr;
+  CapturePixelFormat pixel_format_                   = CapturePixelFormat::Source;
+
+  Pipeline yuv_pipeline_{};
+  DescriptorSetBinder binder_{};
+
+  /**
+   * @brief The copy of the image converted to YUV, reused by every capture.
+   *
+   */
+  std::optional<BufferResource> yuv_input_;
+
+  std::vector<Slot> slots_;
+  uint32_t in_flight_count_      = 0;
+  uint64_t captured_frame_count_ = 0;
+  uint64_t dropped_frame_count_  = 0;
+  uint64_t last_in_flight_frame_ = 0;
+
+  /**
+   * @brief Declared after the slots, so that the thread is stopped before their buffers are released.
+   *
+   */
+  std::unique_ptr<EncoderThread> encoder_thread_;
+};
+
+}  // namespace eray::vkren
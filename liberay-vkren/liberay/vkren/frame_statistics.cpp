@@ -0,0 +1,30 @@
+#include <liberay/vkren/frame_statistics.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+void FrameStatistics::count_pipeline(const vk::PipelineCreationFeedback& feedback) {
+  if (!(feedback.flags & vk::PipelineCreationFeedbackFlagBits::eValid)) {
+    return;
+  }
+
+  pipeline_count_.fetch_add(1, std::memory_order_relaxed);
+  if (feedback.flags & vk::PipelineCreationFeedbackFlagBits::eApplicationPipelineCacheHit) {
+    pipeline_cache_hit_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void FrameStatistics::end_frame() {
+  last_frame_ = FrameCounters{
+      .draw_count                  = draw_count_.exchange(0, std::memory_order_relaxed),
+      .dispatch_count              = dispatch_count_.exchange(0, std::memory_order_relaxed),
+      .barrier_count               = barrier_count_.exchange(0, std::memory_order_relaxed),
+      .descriptor_allocation_count = descriptor_allocation_count_.exchange(0, std::memory_order_relaxed),
+      .staging_bytes               = staging_bytes_.exchange(0, std::memory_order_relaxed),
+      .pipeline_count              = pipeline_count_.load(std::memory_order_relaxed),
+      .pipeline_cache_hit_count    = pipeline_cache_hit_count_.load(std::memory_order_relaxed),
+  };
+}
+
+}  // namespace eray::vkren
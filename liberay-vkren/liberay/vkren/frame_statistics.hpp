@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Counters of a single frame, see `FrameStatistics::last_frame()`.
+ *
+ */
+struct FrameCounters {
+  uint64_t draw_count                  = 0;
+  uint64_t dispatch_count              = 0;
+  uint64_t barrier_count               = 0;
+  uint64_t descriptor_allocation_count = 0;
+  uint64_t staging_bytes               = 0;
+
+  /**
+   * @brief Pipelines created since the device creation and how many of them were found in the pipeline cache. Not
+   * reset by the frames, the pipelines are rarely created every frame.
+   *
+   */
+  uint64_t pipeline_count           = 0;
+  uint64_t pipeline_cache_hit_count = 0;
+
+  float pipeline_cache_hit_rate() const {
+    return pipeline_count == 0 ? 0.0F
+                               : static_cast<float>(pipeline_cache_hit_count) / static_cast<float>(pipeline_count);
+  }
+};
+
+/**
+ * @brief Per-frame counters of the work recorded by the engine, owned by the `Device`. The counters are relaxed
+ * atomics, so they might be bumped by any recording or loading thread, and are cheap enough to be always on.
+ *
+ * The draws and dispatches are counted by the engine helpers that record them (e.g. `IndirectDrawCuller`), the pass
+ * callbacks that record their own commands should report them with `count_draws()` and `count_dispatches()`.
+ *
+ */
+class FrameStatistics {
+ public:
+  void count_draws(uint64_t count = 1) { draw_count_.fetch_add(count, std::memory_order_relaxed); }
+  void count_dispatches(uint64_t count = 1) { dispatch_count_.fetch_add(count, std::memory_order_relaxed); }
+  void count_barriers(uint64_t count) { barrier_count_.fetch_add(count, std::memory_order_relaxed); }
+  void count_descriptor_allocations(uint64_t count = 1) {
+    descriptor_allocation_count_.fetch_add(count, std::memory_order_relaxed);
+  }
+  void count_staging_bytes(uint64_t size_bytes) { staging_bytes_.fetch_add(size_bytes, std::memory_order_relaxed); }
+
+  /**
+   * @brief Counts the pipeline and the pipeline cache hit reported by the `VK_EXT_pipeline_creation_feedback` (core in
+   * Vulkan 1.3). Feedback without the valid bit is ignored.
+   *
+   */
+  void count_pipeline(const vk::PipelineCreationFeedback& feedback);
+
+  /**
+   * @brief Moves the counters to `last_frame()` and starts counting the next frame. Called by the application once the
+   * frame has been recorded.
+   *
+   */
+  void end_frame();
+
+  /**
+   * @brief Counters of the last finished frame.
+   *
+   */
+  const FrameCounters& last_frame() const { return last_frame_; }
+
+ private:
+  std::atomic<uint64_t> draw_count_{0};
+  std::atomic<uint64_t> dispatch_count_{0};
+  std::atomic<uint64_t> barrier_count_{0};
+  std::atomic<uint64_t> descriptor_allocation_count_{0};
+  std::atomic<uint64_t> staging_bytes_{0};
+  std::atomic<uint64_t> pipeline_count_{0};
+  std::atomic<uint64_t> pipeline_cache_hit_count_{0};
+
+  FrameCounters last_frame_;
+};
+
+}  // namespace eray::vkren
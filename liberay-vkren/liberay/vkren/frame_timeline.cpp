@@ -0,0 +1,95 @@
+#include <liberay/util/logger.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/frame_timeline.hpp>
+#include <vulkan/vulkan_enums.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+Result<vk::raii::Semaphore, Error> create_timeline(Device& device) {
+  auto timeline_info = vk::SemaphoreTypeCreateInfo{
+      .semaphoreType = vk::SemaphoreType::eTimeline,
+      .initialValue  = 0,
+  };
+  auto timeline = device->createSemaphore(vk::SemaphoreCreateInfo{.pNext = &timeline_info});
+  if (!timeline) {
+    util::Logger::err("Could not create a frame timeline semaphore. {}", vk::to_string(timeline.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Semaphore creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = timeline.error(),
+    });
+  }
+
+  return std::move(*timeline);
+}
+
+}  // namespace
+
+Result<FrameTimeline, Error> FrameTimeline::create(Device& device) {
+  auto graphics_timeline = create_timeline(device);
+  if (!graphics_timeline) {
+    return std::unexpected(graphics_timeline.error());
+  }
+
+  auto compute_timeline = vk::raii::Semaphore(nullptr);
+  if (device.has_async_compute_queue()) {
+    if (auto result = create_timeline(device)) {
+      compute_timeline = std::move(*result);
+    } else {
+      return std::unexpected(result.error());
+    }
+  }
+
+  return FrameTimeline(device, std::move(*graphics_timeline), std::move(compute_timeline));
+}
+
+uint64_t FrameTimeline::completed_frame() const { return graphics_timeline_.getCounterValue(); }
+
+Result<void, Error> FrameTimeline::wait(uint64_t frame, uint64_t timeout_ns, WaitKind kind,
+                                        const std::source_location& location) const {
+  ERAY_PROFILE_FUNCTION();
+  const auto wait = WaitScope(p_device_->wait_statistics(), "Frame timeline wait", kind, location);
+  auto wait_info = vk::SemaphoreWaitInfo{
+      .semaphoreCount = 1,
+      .pSemaphores    = &*graphics_timeline_,
+      .pValues        = &frame,
+  };
+  if (auto result = (*p_device_)->waitSemaphores(wait_info, timeout_ns); result != vk::Result::eSuccess) {
+    util::Logger::err("Could not wait for the frame {}. {}", frame, vk::to_string(result));
+    return std::unexpected(Error{
+        .msg     = "Frame wait failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = result,
+    });
+  }
+
+  return {};
+}
+
+vk::SemaphoreSubmitInfo FrameTimeline::graphics_signal_info(vk::PipelineStageFlags2 stage_mask) const {
+  return vk::SemaphoreSubmitInfo{
+      .semaphore = *graphics_timeline_,
+      .value     = current_frame(),
+      .stageMask = stage_mask,
+  };
+}
+
+vk::SemaphoreSubmitInfo FrameTimeline::compute_signal_info(vk::PipelineStageFlags2 stage_mask) const {
+  return vk::SemaphoreSubmitInfo{
+      .semaphore = *compute_timeline_,
+      .value     = current_frame(),
+      .stageMask = stage_mask,
+  };
+}
+
+vk::SemaphoreSubmitInfo FrameTimeline::compute_wait_info(vk::PipelineStageFlags2 stage_mask) const {
+  return vk::SemaphoreSubmitInfo{
+      .semaphore = *compute_timeline_,
+      .value     = current_frame(),
+      .stageMask = stage_mask,
+  };
+}
+
+}  // namespace eray::vkren
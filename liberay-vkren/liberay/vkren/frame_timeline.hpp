@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/wait_statistics.hpp>
+#include <source_location>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Frame counter of the device carried by a timeline semaphore per queue. The frames are numbered from 1, the
+ * last submission of the frame `n` to the graphics queue signals the graphics timeline with `n` and the async compute
+ * submission of the frame signals the compute timeline with `n`. As the signals cover all of the commands submitted
+ * earlier to the queue, a frame is complete once the graphics timeline reaches its number.
+ *
+ * The frame resources, readbacks and deferred destructions can be tagged with `current_frame()` when recorded and
+ * released once `is_complete()` returns true, instead of owning the fences.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class FrameTimeline {
+ public:
+  FrameTimeline() = delete;
+  explicit FrameTimeline(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the graphics timeline and, when the device exposes a dedicated compute queue family, the compute
+   * timeline.
+   *
+   * @param device
+   * @return Result<FrameTimeline, Error>
+   */
+  [[nodiscard]] static Result<FrameTimeline, Error> create(Device& device);
+
+  /**
+   * @brief Number of the currently recorded frame, the value its submissions signal.
+   *
+   */
+  uint64_t current_frame() const { return submitted_frame_ + 1; }
+
+  /**
+   * @brief Number of the last submitted frame, 0 before the first submission.
+   *
+   */
+  uint64_t submitted_frame() const { return submitted_frame_; }
+
+  /**
+   * @brief Number of the last frame whose graphics work has finished on the GPU.
+   *
+   */
+  uint64_t completed_frame() const;
+
+  bool is_complete(uint64_t frame) const { return frame <= submitted_frame_ && completed_frame() >= frame; }
+
+  /**
+   * @brief Blocks the CPU until the graphics work of the frame is finished. Frame 0 is complete from the start.
+   *
+   * @param frame Must have been submitted already.
+   * @param timeout_ns
+   * @param kind Waiting for a frame in flight paces the CPU, waiting for the last submitted frame is a stall.
+   * @param location Call site of the wait in the `Device::wait_statistics()`.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> wait(uint64_t frame, uint64_t timeout_ns = UINT64_MAX, WaitKind kind = WaitKind::Pacing,
+                           const std::source_location& location = std::source_location::current()) const;
+
+  /**
+   * @brief Signal of the current frame, must be added to the last submission of the frame to the graphics queue.
+   *
+   * @param stage_mask
+   * @return vk::SemaphoreSubmitInfo
+   */
+  vk::SemaphoreSubmitInfo graphics_signal_info(
+      vk::PipelineStageFlags2 stage_mask = vk::PipelineStageFlagBits2::eAllCommands) const;
+
+  /**
+   * @brief Semaphore signaled with the number of every submitted frame.
+   *
+   */
+  vk::Semaphore graphics_timeline() const { return *graphics_timeline_; }
+
+  bool has_compute_timeline() const { return static_cast<bool>(*compute_timeline_); }
+
+  /**
+   * @brief Signal of the current frame, must be added to the async compute submission of the frame. Requires the
+   * compute timeline.
+   *
+   * @param stage_mask
+   * @return vk::SemaphoreSubmitInfo
+   */
+  vk::SemaphoreSubmitInfo compute_signal_info(
+      vk::PipelineStageFlags2 stage_mask = vk::PipelineStageFlagBits2::eAllCommands) const;
+
+  /**
+   * @brief Wait for the async compute work of the current frame. Requires the compute timeline.
+   *
+   * @param stage_mask Stages of the graphics submission that consume the async compute results.
+   * @return vk::SemaphoreSubmitInfo
+   */
+  vk::SemaphoreSubmitInfo compute_wait_info(vk::PipelineStageFlags2 stage_mask) const;
+
+  /**
+   * @brief Marks the current frame as submitted, must be called after the submission that contains the
+   * `graphics_signal_info()`.
+   *
+   */
+  void advance() { ++submitted_frame_; }
+
+ private:
+  FrameTimeline(Device& device, vk::raii::Semaphore&& graphics_timeline, vk::raii::Semaphore&& compute_timeline)
+      : p_device_(&device),
+        graphics_timeline_(std::move(graphics_timeline)),
+        compute_timeline_(std::move(compute_timeline)) {}
+
+  observer_ptr<Device> p_device_         = nullptr;
+  vk::raii::Semaphore graphics_timeline_ = nullptr;
+  vk::raii::Semaphore compute_timeline_  = nullptr;
+  uint64_t submitted_frame_              = 0;
+};
+
+}  // namespace eray::vkren
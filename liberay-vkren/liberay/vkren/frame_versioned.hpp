@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <liberay/vkren/error.hpp>
+#include <utility>
+#include <vector>
+
+namespace eray::vkren {
+
+/**
+ * @brief Owns a copy of a GPU resource per frame in flight and tracks which copies are stale. A CPU-side change is
+ * announced with `mark_dirty()`, the copy of a frame is brought up to date by `update()` when the frame is recorded, so
+ * the copies read by the frames in flight are never written and nothing waits for the GPU.
+ *
+ * This is the asynchronous replacement of `VulkanApplication::on_frame_prepare_sync()`: `update()` is meant to be
+ * called in `VulkanApplication::on_frame_prepare()`, after the previous use of the frame in flight has finished.
+ *
+ * @tparam TResource e.g. `MappedUniformBuffer`, see `FrameVersionedUniformBuffer`.
+ */
+template <typename TResource>
+class FrameVersioned {
+ public:
+  FrameVersioned() = delete;
+  explicit FrameVersioned(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the copies with `factory(frame_index) -> Result<TResource, Error>`. All copies start stale.
+   *
+   * @param frames_in_flight
+   * @param factory
+   * @return Result<FrameVersioned, Error>
+   */
+  template <typename TFactory>
+  [[nodiscard]] static Result<FrameVersioned, Error> create(uint32_t frames_in_flight, TFactory&& factory) {
+    auto versioned = FrameVersioned(nullptr);
+    versioned.copies_.reserve(frames_in_flight);
+    for (auto i = 0U; i < frames_in_flight; ++i) {
+      auto result = factory(i);
+      if (!result) {
+        return std::unexpected(result.error());
+      }
+      versioned.copies_.push_back(std::move(*result));
+    }
+    versioned.versions_.assign(frames_in_flight, 0);
+    return versioned;
+  }
+
+  /**
+   * @brief Marks every copy stale, the copies read by the frames in flight are left untouched.
+   *
+   */
+  void mark_dirty() { ++version_; }
+
+  /**
+   * @brief Calls `updater(TResource&)` on the copy of the frame if it is stale. Must be called only when the GPU does
+   * not use the copy, i.e. after the previous use of the frame in flight has finished.
+   *
+   * @param frame_index
+   * @param updater
+   * @return true if the copy has been updated.
+   */
+  template <typename TUpdater>
+  bool update(uint32_t frame_index, TUpdater&& updater) {
+    if (versions_[frame_index] == version_) {
+      return false;
+    }
+    std::forward<TUpdater>(updater)(copies_[frame_index]);
+    versions_[frame_index] = version_;
+    return true;
+  }
+
+  bool is_stale(uint32_t frame_index) const { return versions_[frame_index] != version_; }
+
+  TResource& operator[](uint32_t frame_index) { return copies_[frame_index]; }
+  const TResource& operator[](uint32_t frame_index) const { return copies_[frame_index]; }
+
+  uint32_t frames_in_flight() const { return static_cast<uint32_t>(copies_.size()); }
+
+ private:
+  std::vector<TResource> copies_;
+
+  /**
+   * @brief Version of the data each copy holds, the copy is stale if it differs from the latest `version_`.
+   *
+   */
+  std::vector<uint64_t> versions_;
+  uint64_t version_ = 1;
+};
+
+}  // namespace eray::vkren
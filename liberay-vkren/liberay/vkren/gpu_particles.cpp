@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <expected>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/gpu_particles.hpp>
+#include <utility>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+/**
+ * @brief Uints of the counters, matches the layout of `gpu_particles.slang`.
+ *
+ */
+constexpr uint32_t kCounterCount = 4;
+
+}  // namespace
+
+Result<GpuParticleSystem, Error> GpuParticleSystem::create(Device& device, RenderGraph& render_graph,
+                                                           vk::ShaderModule shader, const GpuParticleSystemInfo& info,
+                                                           observer_ptr<ComputePrimitives> primitives) {
+  assert(info.max_particles > 0 && "Particle system must hold at least a single particle");
+  assert((!info.depth_sort || (primitives && primitives->max_count() >= info.max_particles)) &&
+         "Depth sort requires the compute primitives of the particle capacity");
+
+  auto system               = GpuParticleSystem(nullptr);
+  system.info_              = info;
+  system.info_.max_emitters = std::max(info.max_emitters, 1U);
+  system.p_primitives_      = primitives;
+  system.emitters_.reserve(system.info_.max_emitters);
+
+  const auto max_particles = static_cast<vk::DeviceSize>(info.max_particles);
+  system.particles_        = render_graph.create_shader_storage_buffer(device, max_particles * sizeof(GpuParticle));
+  system.alive_lists_      = render_graph.create_shader_storage_buffer(device, 2 * max_particles * sizeof(uint32_t));
+  system.draw_args_        = render_graph.create_shader_storage_buffer(device, sizeof(vk::DrawIndirectCommand),
+                                                                       vk::BufferUsageFlagBits::eIndirectBuffer);
+  if (info.depth_sort) {
+    system.sort_keys_      = render_graph.create_shader_storage_buffer(device, max_particles * sizeof(uint32_t));
+    system.sorted_indices_ = render_graph.create_shader_storage_buffer(device, max_particles * sizeof(uint32_t));
+  }
+
+  const auto buffers = std::array{
+      std::pair{&system.free_list_, max_particles * sizeof(uint32_t)},
+      std::pair{&system.counters_, static_cast<vk::DeviceSize>(kCounterCount) * sizeof(uint32_t)},
+      std::pair{&system.emitters_buffer_,
+                static_cast<vk::DeviceSize>(system.info_.max_emitters) * sizeof(GpuParticleEmitter)},
+      std::pair{&system.emitter_alive_counts_,
+                static_cast<vk::DeviceSize>(system.info_.max_emitters) * sizeof(uint32_t)},
+  };
+  for (const auto& [buffer, size_bytes] : buffers) {
+    if (auto result = BufferResource::create_storage_buffer(device, size_bytes)) {
+      *buffer = std::move(*result);
+    } else {
+      return std::unexpected(result.error());
+    }
+  }
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(
+          device, sizeof(vk::DispatchIndirectCommand),
+          vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer)) {
+    system.dispatch_args_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  auto layout = DescriptorSetBuilder::create(device)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .build_push_descriptor_layout();
+  if (!layout) {
+    return std::unexpected(layout.error());
+  }
+
+  auto push_constant_ranges = std::array{vk::PushConstantRange{
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .offset     = 0,
+      .size       = sizeof(PushConstants),
+  }};
+
+  // In the order of the `Kernel`s
+  auto entry_points = std::array{
+      std::pair{shader, "particlesInit"},
+      std::pair{shader, "particlesSimulate"},
+      std::pair{shader, "particlesEmit"},
+      std::pair{shader, "particlesFinalize"},
+      std::pair{shader, "particlesSortKeys"},
+  };
+  auto pipelines = ComputePipelineBuilder::create()
+                       .with_descriptor_set_layout(*layout)
+                       .with_push_constant_ranges(push_constant_ranges)
+                       .with_name("GPU particles")
+                       .build_for_each_shader(device, entry_points);
+  if (!pipelines) {
+    return std::unexpected(pipelines.error());
+  }
+  system.pipelines_ = std::move(*pipelines);
+  system.binder_    = DescriptorSetBinder::create(device);
+  system.bind_descriptors(render_graph);
+
+  system.push_constants_ = PushConstants{
+      .gravity_drag          = math::Vec4f(0.F, 0.F, 0.F, 0.F),
+      .sort_eye              = math::Vec4f(0.F, 0.F, 0.F, 0.F),
+      .sort_forward          = math::Vec4f(0.F, 0.F, -1.F, 0.F),
+      .delta_time            = 0.F,
+      .max_particles         = info.max_particles,
+      .emitter_count         = 0,
+      .spawn_count           = 0,
+      .seed                  = 0,
+      .vertices_per_particle = info.vertices_per_particle,
+      .depth_sort            = info.depth_sort ? 1U : 0U,
+      ._padding              = 0,
+  };
+  system.set_simulation(GpuParticleSimulation{});
+
+  return system;
+}
+
+void GpuParticleSystem::bind_descriptors(const RenderGraph& render_graph) {
+  // Without the depth sort the sort bindings are never accessed, the particle buffer stands in for them
+  const auto particles_info = render_graph.shader_storage_buffer(particles_).buffer.desc_buffer_info();
+  const auto sort_keys_info =
+      info_.depth_sort ? render_graph.shader_storage_buffer(sort_keys_).buffer.desc_buffer_info() : particles_info;
+  const auto sorted_indices_info = info_.depth_sort
+                                       ? render_graph.shader_storage_buffer(sorted_indices_).buffer.desc_buffer_info()
+                                       : particles_info;
+
+  binder_.clear();
+  binder_.bind_buffer(0, particles_info, vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(1, render_graph.shader_storage_buffer(alive_lists_).buffer.desc_buffer_info(),
+                      vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(2, free_list_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(3, counters_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(4, emitters_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(5, emitter_alive_counts_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(6, render_graph.shader_storage_buffer(draw_args_).buffer.desc_buffer_info(),
+                      vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(7, dispatch_args_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(8, sort_keys_info, vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(9, sorted_indices_info, vk::DescriptorType::eStorageBuffer);
+}
+
+Result<void, Error> GpuParticleSystem::upload_emitters(StagingRingBuffer& staging,
+                                                       std::span<const GpuParticleEmitter> emitters) {
+  if (emitters.size() > info_.max_emitters) {
+    return std::unexpected(Error{
+        .msg  = "GPU particle system emitter capacity exceeded",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  // The emission finds the emitter of a spawn by a binary search of the first spawns
+  emitters_.assign(emitters.begin(), emitters.end());
+  auto spawn_count = 0U;
+  for (auto& emitter : emitters_) {
+    emitter.first_spawn = spawn_count;
+    spawn_count += emitter.spawn_count;
+  }
+
+  push_constants_.emitter_count = 0;
+  push_constants_.spawn_count   = 0;
+  if (emitters_.empty()) {
+    return {};
+  }
+
+  TRY(staging.upload(util::MemoryRegion{emitters_.data(), emitters_.size() * sizeof(GpuParticleEmitter)},
+                     emitters_buffer_));
+  push_constants_.emitter_count = static_cast<uint32_t>(emitters_.size());
+  push_constants_.spawn_count   = spawn_count;
+  return {};
+}
+
+void GpuParticleSystem::set_simulation(const GpuParticleSimulation& simulation) {
+  push_constants_.gravity_drag =
+      math::Vec4f(simulation.gravity.x(), simulation.gravity.y(), simulation.gravity.z(), simulation.drag);
+  push_constants_.delta_time = simulation.delta_time;
+}
+
+void GpuParticleSystem::set_sort_view(const math::Vec3f& eye, const math::Vec3f& forward) {
+  push_constants_.sort_eye     = math::Vec4f(eye.x(), eye.y(), eye.z(), 0.F);
+  push_constants_.sort_forward = math::Vec4f(forward.x(), forward.y(), forward.z(), 0.F);
+}
+
+Result<ComputePassHandle, Error> GpuParticleSystem::emplace_update_pass(RenderGraph& render_graph) {
+  auto builder = ComputePassBuilder::create(render_graph);
+  builder.with_shader_storage(particles_).with_shader_storage(alive_lists_).with_shader_storage(draw_args_);
+  if (info_.depth_sort) {
+    builder.with_shader_storage(sort_keys_).with_shader_storage(sorted_indices_);
+  }
+
+  return builder.with_name("GPU particles")
+      .on_emit([this](const RenderGraph& graph, vk::CommandBuffer& cmd_buff) { record_update(cmd_buff, graph); })
+      .build();
+}
+
+RenderPassBuilder& GpuParticleSystem::with_particle_draw(RenderPassBuilder& pass) const {
+  pass.with_buffer_dependency(particles_, vk::PipelineStageFlagBits2::eVertexShader)
+      .with_buffer_dependency(draw_list(), vk::PipelineStageFlagBits2::eVertexShader)
+      .with_buffer_dependency(draw_args_, vk::PipelineStageFlagBits2::eDrawIndirect,
+                              vk::AccessFlagBits2::eIndirectCommandRead);
+  return pass;
+}
+
+void GpuParticleSystem::record_update(vk::CommandBuffer cmd_buff, const RenderGraph& render_graph) {
+  ERAY_PROFILE_FUNCTION();
+
+  // The buffers were read by the previous update and draw, the write after read hazards need an execution dependency
+  // only. The dispatch arguments written by the previous finalization are read by the simulation
+  auto war_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexShader |
+                      vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eCopy | vk::PipelineStageFlagBits2::eClear |
+                      vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eShaderStorageRead |
+                       vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &war_barrier,
+  });
+
+  if (!initialized_) {
+    // Every particle is free and none is alive
+    const auto counters = std::array<uint32_t, kCounterCount>{0, 0, 0, info_.max_particles};
+    cmd_buff.updateBuffer<uint32_t>(counters_.vk_buffer(), 0, counters);
+    cmd_buff.updateBuffer<vk::DispatchIndirectCommand>(dispatch_args_.vk_buffer(), 0,
+                                                       vk::DispatchIndirectCommand{.x = 0, .y = 1, .z = 1});
+    cmd_buff.fillBuffer(emitter_alive_counts_.vk_buffer(), 0, vk::WholeSize, 0);
+
+    auto clear_barrier = vk::MemoryBarrier2{
+        .srcStageMask  = vk::PipelineStageFlagBits2::eClear | vk::PipelineStageFlagBits2::eCopy,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eComputeShader,
+        .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eShaderStorageRead |
+                         vk::AccessFlagBits2::eShaderStorageWrite,
+    };
+    cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers    = &clear_barrier,
+    });
+
+    dispatch(cmd_buff, Kernel::Init, info_.max_particles);
+    compute_barrier(cmd_buff);
+    initialized_ = true;
+  }
+
+  push_constants_.seed++;
+
+  // The simulation runs over the alive count of the previous finalization
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, pipelines_.pipeline[static_cast<size_t>(Kernel::Simulate)]);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, pipelines_.layout);
+  cmd_buff.pushConstants<PushConstants>(pipelines_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants_);
+  cmd_buff.dispatchIndirect(dispatch_args_.vk_buffer(), 0);
+  binder_._p_device->statistics().count_dispatches();
+  compute_barrier(cmd_buff);
+
+  if (push_constants_.spawn_count > 0) {
+    dispatch(cmd_buff, Kernel::Emit, push_constants_.spawn_count);
+    compute_barrier(cmd_buff);
+  }
+
+  // Reads the alive count after the emission, so it is a single workgroup
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, pipelines_.pipeline[static_cast<size_t>(Kernel::Finalize)]);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, pipelines_.layout);
+  cmd_buff.pushConstants<PushConstants>(pipelines_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants_);
+  cmd_buff.dispatch(1, 1, 1);
+  binder_._p_device->statistics().count_dispatches();
+  compute_barrier(cmd_buff);
+
+  if (info_.depth_sort) {
+    dispatch(cmd_buff, Kernel::SortKeys, info_.max_particles);
+    compute_barrier(cmd_buff);
+    p_primitives_->record_sort(cmd_buff, render_graph, sort_keys_, sorted_indices_, info_.max_particles);
+  }
+
+  // The emitters were consumed, the next update spawns only what is uploaded for it
+  push_constants_.spawn_count = 0;
+
+  auto draw_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexShader,
+      .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eShaderStorageRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &draw_barrier,
+  });
+}
+
+void GpuParticleSystem::record_draw(vk::CommandBuffer cmd_buff, const RenderGraph& render_graph) const {
+  cmd_buff.drawIndirect(render_graph.shader_storage_buffer(draw_args_).buffer.vk_buffer(), 0, 1,
+                        sizeof(vk::DrawIndirectCommand));
+  binder_._p_device->statistics().count_draws();
+}
+
+void GpuParticleSystem::dispatch(vk::CommandBuffer cmd_buff, Kernel kernel, uint32_t thread_count) {
+  // The dispatches of more than `kMaxGroupCountX` workgroups continue in the rows of the y dimension
+  const auto group_count = (thread_count + kWorkgroupSize - 1) / kWorkgroupSize;
+  const auto row_count   = (group_count + kMaxGroupCountX - 1) / kMaxGroupCountX;
+
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, pipelines_.pipeline[static_cast<size_t>(kernel)]);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, pipelines_.layout);
+  cmd_buff.pushConstants<PushConstants>(pipelines_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants_);
+  cmd_buff.dispatch(std::min(group_count, kMaxGroupCountX), row_count, 1);
+  binder_._p_device->statistics().count_dispatches();
+}
+
+void GpuParticleSystem::compute_barrier(vk::CommandBuffer cmd_buff) {
+  auto barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &barrier,
+  });
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/buffer/staging_ring_buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/compute_primitives.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <liberay/vkren/render_graph.hpp>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Particle of the `GpuParticleSystem`, std430 layout of the `Particle` in `gpu_particles.slang`. Written by the
+ * GPU only, the vertex shaders read it.
+ *
+ */
+struct GpuParticle {
+  /**
+   * @brief Position (xyz) and the seconds since the spawn (w).
+   *
+   */
+  math::Vec4f position_age;
+
+  /**
+   * @brief Velocity (xyz) and the seconds the particle lives for (w).
+   *
+   */
+  math::Vec4f velocity_lifetime;
+
+  /**
+   * @brief RGBA8, red in the lowest byte.
+   *
+   */
+  uint32_t color;
+  uint32_t emitter;
+  float size;
+  uint32_t _padding;
+};
+static_assert(sizeof(GpuParticle) == 48);
+
+/**
+ * @brief Emitter of the `GpuParticleSystem`, std430 layout of the `Emitter` in `gpu_particles.slang`. The index of the
+ * emitter identifies it between the frames, its alive particles are counted against its `budget`.
+ *
+ */
+struct GpuParticleEmitter {
+  /**
+   * @brief Center (xyz) and radius (w) of the sphere the particles spawn in.
+   *
+   */
+  math::Vec4f position = math::Vec4f(0.F, 0.F, 0.F, 0.F);
+
+  /**
+   * @brief Mean initial velocity (xyz) and the largest random speed added to it in a random direction (w).
+   *
+   */
+  math::Vec4f velocity = math::Vec4f(0.F, 0.F, 0.F, 0.F);
+
+  math::Vec4f color = math::Vec4f(1.F, 1.F, 1.F, 1.F);
+
+  /**
+   * @brief The lifetime of each particle is picked uniformly from the range, in seconds.
+   *
+   */
+  float min_lifetime = 1.F;
+  float max_lifetime = 1.F;
+  float size         = 1.F;
+
+  /**
+   * @brief Largest number of the alive particles of the emitter, the spawns over it are dropped.
+   *
+   */
+  uint32_t budget = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * @brief Particles spawned by the next update, e.g. of the `ParticleEmissionClock::advance()`.
+   *
+   */
+  uint32_t spawn_count = 0;
+
+  /**
+   * @brief Written by the `GpuParticleSystem::upload_emitters()`.
+   *
+   */
+  uint32_t first_spawn = 0;
+  std::array<uint32_t, 2> _padding{};
+};
+static_assert(sizeof(GpuParticleEmitter) == 80);
+
+/**
+ * @brief Forces of the next update of the `GpuParticleSystem`.
+ *
+ */
+struct GpuParticleSimulation {
+  math::Vec3f gravity = math::Vec3f(0.F, -9.81F, 0.F);
+
+  /**
+   * @brief The velocity is divided by `1 + drag * delta_time` every update.
+   *
+   */
+  float drag = 0.F;
+
+  /**
+   * @brief Seconds since the previous update.
+   *
+   */
+  float delta_time = 0.F;
+};
+
+struct GpuParticleSystemInfo {
+  /**
+   * @brief Capacity of the particles shared by the emitters, a particle costs 60 bytes of the device memory (68 with
+   * the `depth_sort`, plus the scratch of the `ComputePrimitives`).
+   *
+   */
+  uint32_t max_particles = 1U << 20U;
+  uint32_t max_emitters  = 64;
+
+  /**
+   * @brief Vertices drawn per particle, e.g. 1 for the points or 6 for the camera facing quads.
+   *
+   */
+  uint32_t vertices_per_particle = 1;
+
+  /**
+   * @brief Sorts the alive particles back to front along the `set_sort_view()` every update, for the alpha blending.
+   * The sort runs over the whole capacity, since the CPU does not know the alive count, so it is meant for the smaller
+   * systems. Requires the `ComputePrimitives` at the creation.
+   *
+   */
+  bool depth_sort = false;
+};
+
+/**
+ * @brief Particles emitted, simulated, compacted and drawn entirely on the GPU, so their count is limited by the
+ * device memory rather than by the CPU. The update is a render graph compute pass of a few dispatches:
+ * - the simulation ages and integrates the alive particles, returns the dead ones to the free list (an atomic counter
+ *   stack of the particle indices) and appends the rest to the other half of the alive list,
+ * - the emission pops the free list for the `GpuParticleEmitter::spawn_count` particles of each emitter, within the
+ *   budget of the emitter,
+ * - the finalization writes the `VkDrawIndirectCommand` of the draw and the `VkDispatchIndirectCommand` of the next
+ *   simulation from the alive count,
+ * - with the `GpuParticleSystemInfo::depth_sort` the alive particles are sorted back to front by the radix sort of the
+ *   `ComputePrimitives`.
+ *
+ * The compute shader is `liberay-vkren/shaders/gpu_particles.slang`, compile it with the `add_slang_shader_target()`
+ * of the binary, with the entry points `particlesInit`, `particlesSimulate`, `particlesEmit`, `particlesFinalize` and
+ * `particlesSortKeys`:
+ * @code
+ * auto particles = GpuParticleSystem::create(device, graph, shader, {.max_particles = 16'000'000}).or_panic();
+ * particles.emplace_update_pass(graph).or_panic("Could not create the particle update pass");
+ * particles.with_particle_draw(RenderPassBuilder::create(graph).with_color_attachment(color))
+ *     .on_emit([&](const RenderGraph& graph, vk::CommandBuffer& cmd) {
+ *       cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, particle_pipeline.pipeline);
+ *       // bind the `particle_buffer()` and the `draw_list()`
+ *       particles.record_draw(cmd, graph);
+ *     })
+ *     .build(extent);
+ * @endcode
+ * The vertex shader reads the `GpuParticle` at the index `draw_list()[SV_VulkanInstanceID]`, the instance index
+ * includes the `firstInstance` of the indirect command, which selects the half of the alive list.
+ *
+ * Every frame the emitters are uploaded by `upload_emitters()` and the forces are set by `set_simulation()`.
+ *
+ * @warning Lifetime is bound by the device lifetime. The update pass refers to the system, which must not be moved
+ * after the `emplace_update_pass()`.
+ *
+ */
+class GpuParticleSystem {
+ public:
+  GpuParticleSystem() = delete;
+  explicit GpuParticleSystem(std::nullptr_t) {}
+
+  /**
+   * @brief Workgroup size of the shader, must match the `numthreads` of `gpu_particles.slang`.
+   *
+   */
+  static constexpr uint32_t kWorkgroupSize = 256;
+
+  /**
+   * @brief The larger dispatches continue in the y dimension, must match `gpu_particles.slang`.
+   *
+   */
+  static constexpr uint32_t kMaxGroupCountX = 65535;
+
+  /**
+   * @brief Creates the pipelines, the graph shader storage of the particles and the alive lists and the internal
+   * buffers.
+   *
+   * @param device
+   * @param render_graph
+   * @param shader Module compiled from `gpu_particles.slang`.
+   * @param info
+   * @param primitives Required by the `GpuParticleSystemInfo::depth_sort`, at least `max_particles` elements. Must
+   * outlive the system.
+   * @return Result<GpuParticleSystem, Error>
+   */
+  [[nodiscard]] static Result<GpuParticleSystem, Error> create(Device& device, RenderGraph& render_graph,
+                                                               vk::ShaderModule shader,
+                                                               const GpuParticleSystemInfo& info,
+                                                               observer_ptr<ComputePrimitives> primitives = nullptr);
+
+  /**
+   * @brief Stages the emitters of the next update, the copies are recorded by the next
+   * `StagingRingBuffer::record_pending_copies()`, which must precede the update pass.
+   *
+   * @param staging
+   * @param emitters At most `max_emitters()`, in the same order every frame.
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when the ring has not enough free space.
+   */
+  Result<void, Error> upload_emitters(StagingRingBuffer& staging, std::span<const GpuParticleEmitter> emitters);
+
+  void set_simulation(const GpuParticleSimulation& simulation);
+
+  /**
+   * @brief Camera the `GpuParticleSystemInfo::depth_sort` sorts the particles for.
+   *
+   */
+  void set_sort_view(const math::Vec3f& eye, const math::Vec3f& forward);
+
+  /**
+   * @brief Emplaces the compute pass recording `record_update()`.
+   *
+   * @param render_graph Graph the system was created with.
+   * @return Result<ComputePassHandle, Error>
+   */
+  Result<ComputePassHandle, Error> emplace_update_pass(RenderGraph& render_graph);
+
+  /**
+   * @brief Makes the render pass drawing the particles depend on the update pass.
+   *
+   * @param pass
+   * @return RenderPassBuilder&
+   */
+  RenderPassBuilder& with_particle_draw(RenderPassBuilder& pass) const;
+
+  /**
+   * @brief Records the update dispatches. Must be recorded outside of rendering.
+   *
+   * @param cmd_buff
+   * @param render_graph
+   */
+  void record_update(vk::CommandBuffer cmd_buff, const RenderGraph& render_graph);
+
+  /**
+   * @brief Records the indirect draw of the alive particles written by the last update. The graphics pipeline must be
+   * bound already.
+   *
+   * @param cmd_buff
+   * @param render_graph
+   */
+  void record_draw(vk::CommandBuffer cmd_buff, const RenderGraph& render_graph) const;
+
+  ShaderStorageHandle particle_buffer() const { return particles_; }
+
+  /**
+   * @brief Indices of the particles to draw, the sorted ones with the `GpuParticleSystemInfo::depth_sort`.
+   *
+   */
+  ShaderStorageHandle draw_list() const { return info_.depth_sort ? sorted_indices_ : alive_lists_; }
+
+  uint32_t max_particles() const { return info_.max_particles; }
+  uint32_t max_emitters() const { return info_.max_emitters; }
+
+ private:
+  /**
+   * @brief Entry points of `gpu_particles.slang`, in the order of the pipelines.
+   *
+   */
+  enum class Kernel : uint8_t {
+    Init,
+    Simulate,
+    Emit,
+    Finalize,
+    SortKeys,
+  };
+
+  /**
+   * @brief Push constants of `gpu_particles.slang`.
+   *
+   */
+  struct PushConstants {
+    math::Vec4f gravity_drag;
+    math::Vec4f sort_eye;
+    math::Vec4f sort_forward;
+    float delta_time;
+    uint32_t max_particles;
+    uint32_t emitter_count;
+    uint32_t spawn_count;
+    uint32_t seed;
+    uint32_t vertices_per_particle;
+    uint32_t depth_sort;
+    uint32_t _padding;
+  };
+
+  /**
+   * @brief Prepares the push descriptor writes, the buffers never change.
+   *
+   */
+  void bind_descriptors(const RenderGraph& render_graph);
+
+  void dispatch(vk::CommandBuffer cmd_buff, Kernel kernel, uint32_t thread_count);
+
+  static void compute_barrier(vk::CommandBuffer cmd_buff);
+
+  Pipelines pipelines_;
+  DescriptorSetBinder binder_{};
+  observer_ptr<ComputePrimitives> p_primitives_ = nullptr;
+
+  ShaderStorageHandle particles_{};
+
+  /**
+   * @brief Two halves of `max_particles` indices, the update reads the half of the parity and writes the other one.
+   *
+   */
+  ShaderStorageHandle alive_lists_{};
+  ShaderStorageHandle draw_args_{};
+  ShaderStorageHandle sort_keys_{};
+  ShaderStorageHandle sorted_indices_{};
+
+  BufferResource free_list_{};
+
+  /**
+   * @brief The alive counts of the halves, the parity and the free count, see `gpu_particles.slang`.
+   *
+   */
+  BufferResource counters_{};
+  BufferResource dispatch_args_{};
+  BufferResource emitters_buffer_{};
+  BufferResource emitter_alive_counts_{};
+
+  /**
+   * @brief The emitters of the last `upload_emitters()` with their first spawns.
+   *
+   */
+  std::vector<GpuParticleEmitter> emitters_;
+
+  GpuParticleSystemInfo info_{};
+  PushConstants push_constants_{};
+  bool initialized_ = false;
+};
+
+}  // namespace eray::vkren
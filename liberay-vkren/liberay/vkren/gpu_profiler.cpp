@@ -0,0 +1,77 @@
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/gpu_profiler.hpp>
+#include <utility>
+#include <vulkan/vulkan_structs.hpp>
+#include <vulkan/vulkan_to_string.hpp>
+
+namespace eray::vkren {
+
+#ifdef ERAY_ENABLE_PROFILING
+
+GpuProfiler::GpuProfiler(GpuProfiler&& other) noexcept : ctx_(std::exchange(other.ctx_, nullptr)) {}
+
+GpuProfiler& GpuProfiler::operator=(GpuProfiler&& other) noexcept {
+  if (this != &other) {
+    if (ctx_) {
+      TracyVkDestroy(ctx_);
+    }
+    ctx_ = std::exchange(other.ctx_, nullptr);
+  }
+  return *this;
+}
+
+GpuProfiler::~GpuProfiler() {
+  if (ctx_) {
+    TracyVkDestroy(ctx_);
+  }
+}
+
+Result<GpuProfiler, Error> GpuProfiler::create(const Device& device, vk::CommandPool command_pool) {
+  auto cmd_buffs = device->allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+      .commandPool        = command_pool,
+      .level              = vk::CommandBufferLevel::ePrimary,
+      .commandBufferCount = 1,
+  });
+  if (!cmd_buffs) {
+    util::Logger::err("Could not allocate the GPU profiler command buffer. {}", vk::to_string(cmd_buffs.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Command Buffer allocation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = cmd_buffs.error(),
+    });
+  }
+
+  // The context records, submits and waits for the clock synchronization commands on its own
+  auto profiler = GpuProfiler(nullptr);
+  profiler.ctx_ = TracyVkContext(static_cast<VkPhysicalDevice>(*device.physical_device()),
+                                 static_cast<VkDevice>(*device.vk()), static_cast<VkQueue>(*device.graphics_queue()),
+                                 static_cast<VkCommandBuffer>(*cmd_buffs->front()));
+  TracyVkContextName(profiler.ctx_, "Graphics queue", 14);
+
+  return profiler;
+}
+
+void GpuProfiler::collect(vk::CommandBuffer cmd_buff) {
+  if (ctx_) {
+    TracyVkCollect(ctx_, static_cast<VkCommandBuffer>(cmd_buff));
+  }
+}
+
+#else
+
+GpuProfiler::GpuProfiler(GpuProfiler&&) noexcept {}
+
+GpuProfiler& GpuProfiler::operator=(GpuProfiler&&) noexcept { return *this; }
+
+GpuProfiler::~GpuProfiler() = default;
+
+Result<GpuProfiler, Error> GpuProfiler::create(const Device& /*device*/, vk::CommandPool /*command_pool*/) {
+  return GpuProfiler(nullptr);
+}
+
+void GpuProfiler::collect(vk::CommandBuffer /*cmd_buff*/) {}
+
+#endif
+
+}  // namespace eray::vkren
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+#ifdef ERAY_ENABLE_PROFILING
+#include <string>
+#include <tracy/TracyVulkan.hpp>
+#endif
+
+namespace eray::vkren {
+
+/**
+ * @brief Tracy context of the graphics queue, the GPU zones are recorded with the `ERAY_PROFILE_GPU_SCOPE` macros.
+ * Without the `ENABLE_TRACY` CMake option the profiler is empty and the macros expand to nothing.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class GpuProfiler {
+ public:
+  GpuProfiler() = delete;
+  explicit GpuProfiler(std::nullptr_t) {}
+
+  GpuProfiler(const GpuProfiler&)            = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+  GpuProfiler(GpuProfiler&& other) noexcept;
+  GpuProfiler& operator=(GpuProfiler&& other) noexcept;
+
+  ~GpuProfiler();
+
+  /**
+   * @brief Creates the context and synchronizes the GPU clock with the CPU clock. Blocks until the synchronization
+   * commands are executed on the graphics queue.
+   *
+   * @param device
+   * @param command_pool Pool of the graphics queue family created with the reset command buffer flag, a temporary
+   * command buffer is allocated from it.
+   * @return Result<GpuProfiler, Error>
+   */
+  [[nodiscard]] static Result<GpuProfiler, Error> create(const Device& device, vk::CommandPool command_pool);
+
+  /**
+   * @brief Reads back the zones of the completed frames. Must be recorded once per frame into a command buffer of the
+   * graphics queue, outside of the render pass instances.
+   *
+   * @param cmd_buff
+   */
+  void collect(vk::CommandBuffer cmd_buff);
+
+#ifdef ERAY_ENABLE_PROFILING
+  static tracy::VkCtx* tracy_ctx(const GpuProfiler* profiler) { return profiler ? profiler->ctx_ : nullptr; }
+#endif
+
+ private:
+#ifdef ERAY_ENABLE_PROFILING
+  tracy::VkCtx* ctx_ = nullptr;
+#endif
+};
+
+}  // namespace eray::vkren
+
+#ifdef ERAY_ENABLE_PROFILING
+
+/**
+ * @brief Profiles the GPU commands recorded into the `cmd_buff` in the enclosing scope. The name must be a string
+ * literal, `p_profiler` may be null.
+ *
+ */
+#define ERAY_PROFILE_GPU_SCOPE(p_profiler, cmd_buff, name)                                                   \
+  TracyVkNamedZone(::eray::vkren::GpuProfiler::tracy_ctx(p_profiler), eray_gpu_zone,                         \
+                   static_cast<VkCommandBuffer>(cmd_buff), name,                                             \
+                   ::eray::vkren::GpuProfiler::tracy_ctx(p_profiler) != nullptr)
+
+/**
+ * @brief Same as `ERAY_PROFILE_GPU_SCOPE`, but the name is a runtime string copied by the profiler. The name is not
+ * evaluated when the profiling is disabled.
+ *
+ */
+#define ERAY_PROFILE_GPU_SCOPE_DYNAMIC(p_profiler, cmd_buff, name)                                           \
+  const auto eray_gpu_zone_name = std::string(name);                                                         \
+  TracyVkZoneTransient(::eray::vkren::GpuProfiler::tracy_ctx(p_profiler), eray_gpu_zone,                     \
+                       static_cast<VkCommandBuffer>(cmd_buff), eray_gpu_zone_name.c_str(),                   \
+                       ::eray::vkren::GpuProfiler::tracy_ctx(p_profiler) != nullptr)
+
+#else
+
+#define ERAY_PROFILE_GPU_SCOPE(p_profiler, cmd_buff, name)
+#define ERAY_PROFILE_GPU_SCOPE_DYNAMIC(p_profiler, cmd_buff, name)
+
+#endif
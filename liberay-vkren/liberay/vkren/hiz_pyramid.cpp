@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <expected>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/hiz_pyramid.hpp>
+#include <liberay/vkren/image_description.hpp>
+#include <liberay/vkren/scene/depth_pyramid.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+/**
+ * @brief The workgroups write the levels 0 to 5 and the last one the rest, see `hiz_downsample.slang`.
+ *
+ */
+constexpr uint32_t kWorkgroupLevels = 6;
+
+}  // namespace
+
+Result<HiZPyramid, Error> HiZPyramid::create(Device& device, vk::ShaderModule downsample_shader, uint32_t depth_width,
+                                             uint32_t depth_height) {
+  assert(depth_width > 0 && depth_height > 0 && "Depth attachment must not be empty");
+
+  auto pyramid          = HiZPyramid(nullptr);
+  pyramid.depth_extent_ = math::Vec2u(depth_width, depth_height);
+  pyramid.level_count_  = DepthPyramid::level_count_of(depth_width, depth_height);
+  pyramid.workgroups_   = DepthPyramid::level_extent_of(depth_width, depth_height, kWorkgroupLevels - 1);
+  if (pyramid.level_count_ > kMaxLevels) {
+    return std::unexpected(Error{
+        .msg  = "Hi-Z pyramid depth attachment exceeds 4096 texels per side",
+        .code = ErrorCode::VulkanObjectCreationFailure{},
+    });
+  }
+
+  const auto level0 = DepthPyramid::level_extent_of(depth_width, depth_height, 0);
+  if (auto image = ImageResource::create_storage_image(
+          device, ImageDescription::image2d_desc(vk::Format::eR32Sfloat, level0.x(), level0.y()),
+          pyramid.level_count_)) {
+    pyramid.image_ = std::move(*image);
+  } else {
+    return std::unexpected(image.error());
+  }
+
+  if (auto view = pyramid.image_.create_image_view()) {
+    pyramid.view_ = std::move(*view);
+  } else {
+    return std::unexpected(view.error());
+  }
+
+  pyramid.level_views_.reserve(pyramid.level_count_);
+  for (auto level = 0U; level < pyramid.level_count_; ++level) {
+    if (auto view = pyramid.image_.create_mip_level_view(level)) {
+      pyramid.level_views_.push_back(std::move(*view));
+    } else {
+      return std::unexpected(view.error());
+    }
+  }
+
+  if (auto buffer =
+          BufferResource::create_gpu_local_buffer(device, sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer)) {
+    pyramid.counter_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  auto layout = DescriptorSetBuilder::create(device)
+                    .with_binding(vk::DescriptorType::eSampledImage, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute, kMaxLevels)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .build_push_descriptor_layout();
+  if (!layout) {
+    return std::unexpected(layout.error());
+  }
+
+  auto push_constant_ranges = std::array{vk::PushConstantRange{
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .offset     = 0,
+      .size       = sizeof(PushConstants),
+  }};
+  auto pipeline = ComputePipelineBuilder::create()
+                      .with_shader(downsample_shader)
+                      .with_descriptor_set_layout(*layout)
+                      .with_push_constant_ranges(push_constant_ranges)
+                      .build(device);
+  if (!pipeline) {
+    return std::unexpected(pipeline.error());
+  }
+  pyramid.pipeline_ = std::move(*pipeline);
+  pyramid.binder_   = DescriptorSetBinder::create(device);
+
+  return pyramid;
+}
+
+void HiZPyramid::record_build(vk::CommandBuffer cmd_buff, vk::ImageView depth_view, vk::ImageLayout depth_layout) {
+  ERAY_PROFILE_FUNCTION();
+
+  // The pyramid of the previous build must have been read by the cull before it is overwritten, write after read
+  // hazards need an execution dependency only. The first build discards the undefined contents
+  auto pyramid_barrier = vk::ImageMemoryBarrier2{
+      .srcStageMask        = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask       = vk::AccessFlagBits2::eNone,
+      .dstStageMask        = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask       = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+      .oldLayout           = initialized_ ? vk::ImageLayout::eGeneral : vk::ImageLayout::eUndefined,
+      .newLayout           = vk::ImageLayout::eGeneral,
+      .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .image               = image_.vk_image(),
+      .subresourceRange =
+          vk::ImageSubresourceRange{
+              .aspectMask     = vk::ImageAspectFlagBits::eColor,
+              .baseMipLevel   = 0,
+              .levelCount     = level_count_,
+              .baseArrayLayer = 0,
+              .layerCount     = 1,
+          },
+  };
+
+  // The last workgroup of every build zeroes the counter for the next one
+  auto clear_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eClear,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+  if (!initialized_) {
+    cmd_buff.fillBuffer(counter_buffer_.vk_buffer(), 0, sizeof(uint32_t), 0);
+    initialized_ = true;
+  } else {
+    clear_barrier.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader;
+    clear_barrier.srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite;
+  }
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount      = 1,
+      .pMemoryBarriers         = &clear_barrier,
+      .imageMemoryBarrierCount = 1,
+      .pImageMemoryBarriers    = &pyramid_barrier,
+  });
+
+  // The depth view changes with the frame, so the writes are rebuilt. The array elements past the level count are
+  // bound to the last level to keep the binding fully written
+  binder_.clear();
+  binder_.bind_sampled_image(0, depth_view, depth_layout);
+  for (auto level = 0U; level < kMaxLevels; ++level) {
+    binder_.bind_storage_image(1, *level_views_[std::min(level, level_count_ - 1)], vk::ImageLayout::eGeneral, level);
+  }
+  binder_.bind_buffer(2, counter_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+
+  const auto push_constants = PushConstants{
+      .depth_size      = depth_extent_,
+      .level_count     = level_count_,
+      .workgroup_count = workgroups_.x() * workgroups_.y(),
+  };
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline_.pipeline);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, pipeline_.layout);
+  cmd_buff.pushConstants<PushConstants>(pipeline_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants);
+  cmd_buff.dispatch(workgroups_.x(), workgroups_.y(), 1);
+  binder_._p_device->statistics().count_dispatches();
+
+  auto read_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &read_barrier,
+  });
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Hierarchical depth (Hi-Z) pyramid of a depth attachment, used by the occlusion culling of the
+ * `IndirectDrawCuller`. The level 0 has half of the depth resolution and every next level halves the previous one down
+ * to a single texel, each texel keeps the farthest depth it covers (see `DepthPyramid`, its CPU reference).
+ *
+ * All of the levels are built by a single compute dispatch, `liberay-vkren/shaders/hiz_downsample.slang`, compile it
+ * with the `add_slang_shader_target()` of the binary. The pyramid stays in the VK_IMAGE_LAYOUT_GENERAL layout.
+ *
+ * `record_build()` is meant to be emitted by a render graph compute pass reading the depth attachment, e.g. of the
+ * `create_depth_attachment()` with `readable` set:
+ * @code
+ * ComputePassBuilder::create(graph)
+ *     .with_image_dependency(depth, vk::PipelineStageFlagBits2::eComputeShader,
+ *                            vk::AccessFlagBits2::eShaderSampledRead)
+ *     .on_emit([&](const RenderGraph& graph, vk::CommandBuffer& cmd) {
+ *       hiz.record_build(cmd, graph.attachment(depth).view);
+ *     })
+ *     .build();
+ * @endcode
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class HiZPyramid {
+ public:
+  HiZPyramid() = delete;
+  explicit HiZPyramid(std::nullptr_t) {}
+
+  /**
+   * @brief Side of the workgroup of the downsample shader, must match the `numthreads` of `hiz_downsample.slang`. A
+   * workgroup reduces a tile of `4 * kWorkgroupSide` depth texels.
+   *
+   */
+  static constexpr uint32_t kWorkgroupSide = 16;
+
+  /**
+   * @brief Maximum number of the levels, the depth attachment may have at most 4096 texels per side.
+   *
+   */
+  static constexpr uint32_t kMaxLevels = 12;
+
+  /**
+   * @brief Creates the pipeline and the pyramid of a depth attachment. Recreate the pyramid when the attachment is
+   * resized.
+   *
+   * @param device
+   * @param downsample_shader Module compiled from `hiz_downsample.slang`.
+   * @param depth_width
+   * @param depth_height
+   * @return Result<HiZPyramid, Error> Fails with `VulkanObjectCreationFailure` when the depth attachment is too
+   * large.
+   */
+  [[nodiscard]] static Result<HiZPyramid, Error> create(Device& device, vk::ShaderModule downsample_shader,
+                                                        uint32_t depth_width, uint32_t depth_height);
+
+  /**
+   * @brief Records the build of all of the levels. Must be recorded outside of rendering, the following compute
+   * shader reads of the pyramid are synchronized.
+   *
+   * @param cmd_buff
+   * @param depth_view Depth attachment view, must have the extent the pyramid was created with.
+   * @param depth_layout Layout of the depth attachment.
+   */
+  void record_build(vk::CommandBuffer cmd_buff, vk::ImageView depth_view,
+                    vk::ImageLayout depth_layout = vk::ImageLayout::eReadOnlyOptimal);
+
+  /**
+   * @brief View of all of the levels, sampled in the VK_IMAGE_LAYOUT_GENERAL layout.
+   *
+   */
+  vk::ImageView view() const { return *view_; }
+  vk::Image vk_image() const { return image_.vk_image(); }
+  uint32_t level_count() const { return level_count_; }
+  math::Vec2u depth_extent() const { return depth_extent_; }
+
+ private:
+  /**
+   * @brief Push constants of `hiz_downsample.slang`.
+   *
+   */
+  struct PushConstants {
+    math::Vec2u depth_size;
+    uint32_t level_count;
+    uint32_t workgroup_count;
+  };
+
+  Pipeline pipeline_{};
+  DescriptorSetBinder binder_{};
+
+  ImageResource image_{};
+  vk::raii::ImageView view_ = nullptr;
+  std::vector<vk::raii::ImageView> level_views_;
+
+  /**
+   * @brief Number of the workgroups that finished the first levels, zeroed by the first build and then by the last
+   * workgroup of every build.
+   *
+   */
+  BufferResource counter_buffer_{};
+
+  math::Vec2u depth_extent_;
+  math::Vec2u workgroups_;
+  uint32_t level_count_ = 0;
+  bool initialized_     = false;
+};
+
+}  // namespace eray::vkren
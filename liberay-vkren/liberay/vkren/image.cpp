@@ -1,39 +1,60 @@
 #include <vma/vk_mem_alloc.h>
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
 #include <expected>
 #include <liberay/util/logger.hpp>
 #include <liberay/util/memory_region.hpp>
+#include <liberay/util/try.hpp>
 #include <liberay/vkren/buffer.hpp>
 #include <liberay/vkren/device.hpp>
 #include <liberay/vkren/error.hpp>
 #include <liberay/vkren/image.hpp>
 #include <liberay/vkren/image_description.hpp>
 #include <liberay/vkren/image_format_helpers.hpp>
+#include <liberay/vkren/mip_generator.hpp>
 #include <liberay/vkren/vk_util.hpp>
 #include <liberay/vkren/vma_raii_object.hpp>
+#include <span>
+#include <vector>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_structs.hpp>
 
 namespace eray::vkren {
 
-Result<ImageResource, Error> ImageResource::create_attachment_image(Device& device, ImageDescription desc,
-                                                                    vk::ImageUsageFlags usage,
-                                                                    vk::ImageAspectFlags aspect,
-                                                                    vk::SampleCountFlagBits sample_count) {
-  auto image_info = vk::ImageCreateInfo{
+vk::ImageCreateInfo ImageResource::attachment_image_create_info(const ImageDescription& desc,
+                                                                vk::ImageUsageFlags usage,
+                                                                vk::SampleCountFlagBits sample_count) {
+  return vk::ImageCreateInfo{
       .sType       = vk::StructureType::eImageCreateInfo,
       .imageType   = desc.image_type(),
       .format      = desc.format,
       .extent      = vk::Extent3D{.width = desc.width, .height = desc.height, .depth = desc.depth},
       .mipLevels   = 1,
-      .arrayLayers = 1,
+      .arrayLayers = desc.array_layers,
       .samples     = sample_count,
       .tiling      = vk::ImageTiling::eOptimal,
       .usage       = usage,
       .sharingMode = vk::SharingMode::eExclusive,
   };
+}
+
+vk::MemoryRequirements ImageResource::attachment_memory_requirements(const Device& device,
+                                                                     const ImageDescription& desc,
+                                                                     vk::ImageUsageFlags usage,
+                                                                     vk::SampleCountFlagBits sample_count) {
+  auto image_info = attachment_image_create_info(desc, usage, sample_count);
+  return device->getImageMemoryRequirements(vk::DeviceImageMemoryRequirements{.pCreateInfo = &image_info})
+      .memoryRequirements;
+}
+
+Result<ImageResource, Error> ImageResource::create_attachment_image(Device& device, ImageDescription desc,
+                                                                    vk::ImageUsageFlags usage,
+                                                                    vk::ImageAspectFlags aspect,
+                                                                    vk::SampleCountFlagBits sample_count,
+                                                                    const std::source_location& location) {
+  auto image_info = attachment_image_create_info(desc, usage, sample_count);
 
   auto alloc_create_info     = VmaAllocationCreateInfo{};
   alloc_create_info.usage    = VMA_MEMORY_USAGE_AUTO;
@@ -41,7 +62,57 @@ Result<ImageResource, Error> ImageResource::create_attachment_image(Device& devi
   alloc_create_info.priority = 1.0F;
 
   VmaAllocationInfo info;
-  auto image_opt = device.vma_alloc_manager().create_image(image_info, alloc_create_info, info);
+  auto image_opt = device.vma_alloc_manager().create_image(image_info, alloc_create_info, info, location);
+  if (!image_opt) {
+    return std::unexpected(image_opt.error());
+  }
+
+  return ImageResource{
+      ._image       = VmaRaiiImage(device.vma_alloc_manager(), image_opt->allocation, image_opt->vk_image),
+      .description  = desc,
+      ._p_device    = &device,
+      .mip_levels   = 1,
+      .aspect       = aspect,
+      .usage        = usage,
+      .sample_count = sample_count,
+  };
+}
+
+Result<ImageResource, Error> ImageResource::create_aliasing_attachment_image(Device& device, VmaAllocation memory,
+                                                                             ImageDescription desc,
+                                                                             vk::ImageUsageFlags usage,
+                                                                             vk::ImageAspectFlags aspect,
+                                                                             vk::SampleCountFlagBits sample_count,
+                                                                             const std::source_location& location) {
+  auto image_info = attachment_image_create_info(desc, usage, sample_count);
+
+  auto image_opt = device.vma_alloc_manager().create_aliasing_image(memory, image_info, 0, location);
+  if (!image_opt) {
+    return std::unexpected(image_opt.error());
+  }
+
+  return ImageResource{
+      ._image       = VmaRaiiImage(device.vma_alloc_manager(), nullptr, image_opt->vk_image),
+      .description  = desc,
+      ._p_device    = &device,
+      .mip_levels   = 1,
+      .aspect       = aspect,
+      .usage        = usage,
+      .sample_count = sample_count,
+  };
+}
+
+Result<ImageResource, Error> ImageResource::create_lazily_allocated_attachment_image(
+    Device& device, ImageDescription desc, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect,
+    vk::SampleCountFlagBits sample_count, const std::source_location& location) {
+  usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+  auto image_info = attachment_image_create_info(desc, usage, sample_count);
+
+  auto alloc_create_info  = VmaAllocationCreateInfo{};
+  alloc_create_info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+
+  VmaAllocationInfo info;
+  auto image_opt = device.vma_alloc_manager().create_image(image_info, alloc_create_info, info, location);
   if (!image_opt) {
     return std::unexpected(image_opt.error());
   }
@@ -58,31 +129,49 @@ Result<ImageResource, Error> ImageResource::create_attachment_image(Device& devi
 }
 
 Result<ImageResource, Error> ImageResource::create_texture(Device& device, ImageDescription desc, bool mipmapping,
-                                                           vk::ImageAspectFlags aspect) {
-  assert(!helper::is_block_format(desc.format) && "Block Compression Formats are not supported yet!");
+                                                           vk::ImageAspectFlags aspect,
+                                                           const std::source_location& location) {
+  const auto mip_levels = mipmapping ? desc.find_mip_levels() : 1U;
+  return create_texture_with_mip_levels(device, std::move(desc), mip_levels, aspect, location);
+}
+
+Result<ImageResource, Error> ImageResource::create_texture_with_mip_levels(Device& device, ImageDescription desc,
+                                                                           uint32_t mip_levels,
+                                                                           vk::ImageAspectFlags aspect,
+                                                                           const std::source_location& location) {
+  assert(mip_levels >= 1 && mip_levels <= desc.find_mip_levels() && "Invalid number of the mip levels");
 
-  const auto usage =
-      vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc;
+  auto usage = vk::ImageUsageFlags{vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst |
+                                   vk::ImageUsageFlagBits::eTransferSrc};
+
+  // The levels are written by the compute shader of the `MipGenerator`
+  if (mip_levels > 1 && !helper::is_compressed_format(desc.format) &&
+      device.is_format_supported(desc.format, vk::FormatFeatureFlagBits::eStorageImage)) {
+    usage |= vk::ImageUsageFlagBits::eStorage;
+  }
 
   auto image_info = vk::ImageCreateInfo{
       .sType       = vk::StructureType::eImageCreateInfo,
       .imageType   = desc.image_type(),
       .format      = desc.format,
       .extent      = vk::Extent3D{.width = desc.width, .height = desc.height, .depth = desc.depth},
-      .mipLevels   = mipmapping ? desc.find_mip_levels() : 1,
+      .mipLevels   = mip_levels,
       .arrayLayers = desc.array_layers,
       .samples     = vk::SampleCountFlagBits::e1,
       .tiling      = vk::ImageTiling::eOptimal,
       .usage       = usage,
       .sharingMode = vk::SharingMode::eExclusive,
   };
+  if (desc.array_layers == 6 && desc.width == desc.height) {
+    image_info.flags = vk::ImageCreateFlagBits::eCubeCompatible;
+  }
 
   auto alloc_create_info     = VmaAllocationCreateInfo{};
   alloc_create_info.usage    = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
   alloc_create_info.priority = 1.0F;
 
   VmaAllocationInfo info;
-  auto image_opt = device.vma_alloc_manager().create_image(image_info, alloc_create_info, info);
+  auto image_opt = device.vma_alloc_manager().create_image(image_info, alloc_create_info, info, location);
   if (!image_opt) {
     return std::unexpected(image_opt.error());
   }
@@ -91,76 +180,199 @@ Result<ImageResource, Error> ImageResource::create_texture(Device& device, Image
       ._image      = VmaRaiiImage(device.vma_alloc_manager(), image_opt->allocation, image_opt->vk_image),
       .description = std::move(desc),
       ._p_device   = &device,
-      .mip_levels  = mipmapping ? desc.find_mip_levels() : 1,
+      .mip_levels  = mip_levels,
       .aspect      = aspect,
       .usage       = usage,
   };
 }
 
-Result<void, Error> ImageResource::upload(util::MemoryRegion src_region) {
+vk::ImageCreateInfo ImageResource::sparse_texture_create_info(const ImageDescription& desc, uint32_t mip_levels) {
+  assert(desc.depth == 1 && desc.array_layers == 1 && "Only the 2D sparse textures are supported");
+  assert(mip_levels >= 1 && mip_levels <= desc.find_mip_levels() && "Invalid number of the mip levels");
+
+  return vk::ImageCreateInfo{
+      .sType       = vk::StructureType::eImageCreateInfo,
+      .flags       = vk::ImageCreateFlagBits::eSparseBinding | vk::ImageCreateFlagBits::eSparseResidency,
+      .imageType   = vk::ImageType::e2D,
+      .format      = desc.format,
+      .extent      = vk::Extent3D{.width = desc.width, .height = desc.height, .depth = 1},
+      .mipLevels   = mip_levels,
+      .arrayLayers = 1,
+      .samples     = vk::SampleCountFlagBits::e1,
+      .tiling      = vk::ImageTiling::eOptimal,
+      .usage       = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+      .sharingMode = vk::SharingMode::eExclusive,
+  };
+}
+
+Result<ImageResource, Error> ImageResource::create_sparse_texture(Device& device, ImageDescription desc,
+                                                                  uint32_t mip_levels,
+                                                                  const std::source_location& location) {
+  if (!device.has_sparse_residency()) {
+    return std::unexpected(Error{
+        .msg  = "Sparse residency is not supported",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
+  const auto image_info = sparse_texture_create_info(desc, mip_levels);
+  auto image_opt        = device.vma_alloc_manager().create_sparse_image(image_info, location);
+  if (!image_opt) {
+    return std::unexpected(image_opt.error());
+  }
+
+  return ImageResource{
+      ._image      = VmaRaiiImage(device.vma_alloc_manager(), nullptr, image_opt->vk_image),
+      .description = std::move(desc),
+      ._p_device   = &device,
+      .mip_levels  = mip_levels,
+      .aspect      = vk::ImageAspectFlagBits::eColor,
+      .usage       = image_info.usage,
+  };
+}
+
+Result<ImageResource, Error> ImageResource::create_texture(Device& device, const res::Ktx2Texture& texture,
+                                                           const std::source_location& location) {
+  const auto desc = ImageDescription::from(texture);
+  if (!device.is_format_supported(desc.format, vk::FormatFeatureFlagBits::eSampledImage)) {
+    util::Logger::err("Could not create a texture. The format {} is not supported by the device",
+                      vk::to_string(desc.format));
+    return std::unexpected(Error{
+        .msg  = "Texture format is not supported",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
+  // A file without the mip chain stores LOD0 only, the rest is generated from it
+  const auto compressed = helper::is_compressed_format(desc.format);
+  const auto mip_levels = texture.mip_levels() > 1 || compressed ? texture.mip_levels() : desc.find_mip_levels();
+  TRY_UNWRAP_DEFINE(image, create_texture_with_mip_levels(device, desc, mip_levels, vk::ImageAspectFlagBits::eColor,
+                                                          location));
+  TRY(image.upload(texture.levels_region(), texture.level_offsets()));
+
+  return image;
+}
+
+Result<ImageResource, Error> ImageResource::create_storage_image(Device& device, ImageDescription desc,
+                                                                 uint32_t mip_levels,
+                                                                 const std::source_location& location) {
+  const auto usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+
+  auto image_info = vk::ImageCreateInfo{
+      .sType       = vk::StructureType::eImageCreateInfo,
+      .imageType   = desc.image_type(),
+      .format      = desc.format,
+      .extent      = vk::Extent3D{.width = desc.width, .height = desc.height, .depth = desc.depth},
+      .mipLevels   = mip_levels,
+      .arrayLayers = desc.array_layers,
+      .samples     = vk::SampleCountFlagBits::e1,
+      .tiling      = vk::ImageTiling::eOptimal,
+      .usage       = usage,
+      .sharingMode = vk::SharingMode::eExclusive,
+  };
+
+  auto alloc_create_info     = VmaAllocationCreateInfo{};
+  alloc_create_info.usage    = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+  alloc_create_info.priority = 1.0F;
+
+  VmaAllocationInfo info;
+  auto image_opt = device.vma_alloc_manager().create_image(image_info, alloc_create_info, info, location);
+  if (!image_opt) {
+    return std::unexpected(image_opt.error());
+  }
+
+  return ImageResource{
+      ._image      = VmaRaiiImage(device.vma_alloc_manager(), image_opt->allocation, image_opt->vk_image),
+      .description = std::move(desc),
+      ._p_device   = &device,
+      .mip_levels  = mip_levels,
+      .aspect      = vk::ImageAspectFlagBits::eColor,
+      .usage       = usage,
+  };
+}
+
+Result<void, Error> ImageResource::upload(util::MemoryRegion src_region, MipGenerator* mip_generator) {
+  return upload(src_region, packed_upload_offsets(src_region.size_bytes()), mip_generator);
+}
+
+std::vector<vk::DeviceSize> ImageResource::packed_upload_offsets(vk::DeviceSize size_bytes) const {
   const auto full_size = find_full_size_bytes();
-  assert((mipmapping_enabled() && src_region.size_bytes() == full_size) ||
-         src_region.size_bytes() == lod0_size_bytes() &&
+  assert((mipmapping_enabled() && size_bytes == full_size) ||
+         size_bytes == lod0_size_bytes() &&
              "Expected either LOD=0 image level or full image with all of the mipmap levels");
+
+  const auto copy_mip_levels = (mipmapping_enabled() && size_bytes == full_size) ? mip_levels : 1;
+  return description.packed_mip_offsets(copy_mip_levels);
+}
+
+Result<void, Error> ImageResource::upload(util::MemoryRegion src_region, std::span<const vk::DeviceSize> mip_offsets,
+                                          MipGenerator* mip_generator) {
+  for (auto mip_level = 0U; mip_level < mip_offsets.size(); ++mip_level) {
+    assert(mip_offsets[mip_level] + description.mip_size_bytes(mip_level) <= src_region.size_bytes() &&
+           "Mip level is out of the source region bounds");
+  }
+
+  auto staging_buffer = BufferResource::create_staging_buffer(*_p_device, src_region);
+  if (!staging_buffer) {
+    util::Logger::err("Could not upload a texture. Staging buffer creation failed!");
+    return std::unexpected(staging_buffer.error());
+  }
+
+  auto cmd_buff = _p_device->begin_single_time_commands();
+  auto result   = record_upload(cmd_buff, staging_buffer->_buffer._vk_handle, 0, mip_offsets, mip_generator);
+  _p_device->end_single_time_commands(cmd_buff);
+
+  return result;
+}
+
+Result<void, Error> ImageResource::record_upload(vk::CommandBuffer cmd_buff, vk::Buffer src_buffer,
+                                                 vk::DeviceSize src_offset,
+                                                 std::span<const vk::DeviceSize> mip_offsets,
+                                                 MipGenerator* mip_generator) {
+  assert(!mip_offsets.empty() && mip_offsets.size() <= mip_levels && "Expected between 1 and mip_levels levels");
   assert((usage & vk::ImageUsageFlagBits::eTransferDst) && "Image is not a transfer destination, upload impossible");
 
   // == Copy data from the staging buffer to the image layers ==========================================================
-  {
-    const auto copy_mip_levels = (mipmapping_enabled() && src_region.size_bytes() == full_size) ? mip_levels : 1;
+  auto regions = std::vector<vk::BufferImageCopy>();
+  regions.reserve(mip_offsets.size());
+  for (auto mip_level = 0U; mip_level < mip_offsets.size(); ++mip_level) {
+    regions.push_back(vk::BufferImageCopy{
+        .bufferOffset = src_offset + mip_offsets[mip_level],
+
+        // No padding bytes between rows of the image is assumed
+        .bufferRowLength   = 0,
+        .bufferImageHeight = 0,
+
+        .imageSubresource = subresource_layers(mip_level, 0, description.array_layers),
+        .imageOffset      = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+        .imageExtent      = description.mip_extent(mip_level),
+    });
+  }
 
-    auto staging_buffer = BufferResource::create_staging_buffer(*_p_device, src_region);
-    if (!staging_buffer) {
-      util::Logger::err("Could not upload a texture. Staging buffer creation failed!");
-      return std::unexpected(staging_buffer.error());
-    }
+  transition_layout(cmd_buff, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+  cmd_buff.copyBufferToImage(src_buffer, _image._vk_handle, vk::ImageLayout::eTransferDstOptimal, regions);
 
-    auto cmd_cpy_buff = _p_device->begin_single_time_commands();
-    auto mip_width    = description.width;
-    auto mip_height   = description.height;
-    auto mip_depth    = description.depth;
-    auto mip_offset   = 0U;
-    for (auto mip_level = 0U; mip_level < copy_mip_levels; ++mip_level) {
-      const auto mip_size_bytes =
-          helper::bytes_per_pixel(description.format) * mip_width * mip_height * mip_depth * description.array_layers;
-
-      for (auto layer = 0U; layer < description.array_layers; ++layer) {
-        const auto copy_region = vk::BufferImageCopy{
-            .bufferOffset = mip_offset,
-
-            // No padding bytes between rows of the image is assumed
-            .bufferRowLength   = 0,
-            .bufferImageHeight = 0,
-
-            .imageSubresource =
-                vk::ImageSubresourceLayers{
-                    .aspectMask     = aspect,
-                    .mipLevel       = mip_level,
-                    .baseArrayLayer = 0,
-                    .layerCount     = description.array_layers,
-                },
-            .imageOffset = vk::Offset3D{.x = 0, .y = 0, .z = 0},
-            .imageExtent = description.extent(),
-        };
-
-        transition_layout(cmd_cpy_buff, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-        cmd_cpy_buff.copyBufferToImage(staging_buffer->_buffer._vk_handle, _image._vk_handle,
-                                       vk::ImageLayout::eTransferDstOptimal, copy_region);
-      }
-      mip_offset += mip_size_bytes;
-      mip_width  = std::max(mip_width / 2U, 1U);
-      mip_height = std::max(mip_height / 2U, 1U);
-      mip_depth  = std::max(mip_depth / 2U, 1U);
-    }
-    _p_device->end_single_time_commands(cmd_cpy_buff);
+  // The precomputed mipmaps are used as they are
+  if (mip_offsets.size() < mip_levels) {
+    return mip_generator && mip_generator->supports(*this) ? mip_generator->record_generate(cmd_buff, *this)
+                                                            : generate_mipmaps(cmd_buff);
   }
+  transition_layout(cmd_buff, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
 
-  // Return if mipmapping is disabled or the memory region already contained pregenerated mipmaps.
-  if (!mipmapping_enabled() || src_region.size_bytes() == full_size) {
-    return {};
-  }
+  return {};
+}
 
+Result<void, Error> ImageResource::generate_mipmaps(vk::CommandBuffer cmd_buff) {
   // == Generate mipmaps using linear blitting =========================================================================
 
+  if (helper::is_compressed_format(description.format)) {
+    util::Logger::err("Mipmaps of a compressed texture could not be generated, they must be precomputed");
+    return std::unexpected(Error{
+        .msg  = "Mipmapping impossible, because compressed images cannot be blitted",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
   // Check if linear blitting is supported
   auto format_props = _p_device->physical_device().getFormatProperties(description.format);
   if (!(format_props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear)) {
@@ -172,8 +384,6 @@ Result<void, Error> ImageResource::upload(util::MemoryRegion src_region) {
     });
   }
 
-  auto cmd_buff = _p_device->begin_single_time_commands();
-
   auto mip_width  = static_cast<int32_t>(description.width);
   auto mip_height = static_cast<int32_t>(description.height);
   auto mip_depth  = static_cast<int32_t>(description.depth);
@@ -230,16 +440,47 @@ Result<void, Error> ImageResource::upload(util::MemoryRegion src_region) {
   transition_mip_level_layout(cmd_buff, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
                               mip_levels - 1);
 
-  _p_device->end_single_time_commands(cmd_buff);
-
   return {};
 }
 
 Result<vk::raii::ImageView, Error> ImageResource::create_image_view(vk::ImageViewType image_view_type) const {
+  return create_view(image_view_type, description.format, full_resource_range());
+}
+
+Result<vk::raii::ImageView, Error> ImageResource::create_image_view() const {
+  return create_image_view(default_view_type());
+}
+
+Result<vk::raii::ImageView, Error> ImageResource::create_mip_level_view(uint32_t mip_level) const {
+  return create_view(vk::ImageViewType::e2D, description.format, mip_level_range(mip_level));
+}
+
+Result<vk::ImageView, Error> ImageResource::cached_view(vk::ImageViewType type, vk::Format format,
+                                                        const vk::ImageSubresourceRange& range) {
+  const auto key = ViewKey{.type = type, .format = format, .range = range};
+  if (auto it = std::ranges::find(_view_cache, key, [](const auto& entry) { return entry.first; });
+      it != _view_cache.end()) {
+    return *it->second;
+  }
+
+  TRY_UNWRAP_DEFINE(view, create_view(type, format, range));
+  return *_view_cache.emplace_back(key, std::move(view)).second;
+}
+
+Result<vk::ImageView, Error> ImageResource::cached_view() {
+  return cached_view(default_view_type(), description.format, full_resource_range());
+}
+
+Result<vk::ImageView, Error> ImageResource::cached_mip_level_view(uint32_t mip_level) {
+  return cached_view(vk::ImageViewType::e2D, description.format, mip_level_range(mip_level));
+}
+
+Result<vk::raii::ImageView, Error> ImageResource::create_view(vk::ImageViewType type, vk::Format format,
+                                                              const vk::ImageSubresourceRange& range) const {
   auto img_create_info = vk::ImageViewCreateInfo{
       .image    = vk_image(),
-      .viewType = image_view_type,
-      .format   = description.format,
+      .viewType = type,
+      .format   = format,
       .components =
           vk::ComponentMapping{
               .r = vk::ComponentSwizzle::eIdentity,
@@ -247,14 +488,7 @@ Result<vk::raii::ImageView, Error> ImageResource::create_image_view(vk::ImageVie
               .b = vk::ComponentSwizzle::eIdentity,
               .a = vk::ComponentSwizzle::eIdentity,
           },
-      .subresourceRange =
-          vk::ImageSubresourceRange{
-              .aspectMask     = aspect,
-              .baseMipLevel   = 0,
-              .levelCount     = mip_levels,
-              .baseArrayLayer = 0,
-              .layerCount     = description.array_layers,
-          },
+      .subresourceRange = range,
   };
 
   auto img_view_opt = (*_p_device)->createImageView(img_create_info);
@@ -270,13 +504,6 @@ Result<vk::raii::ImageView, Error> ImageResource::create_image_view(vk::ImageVie
   return std::move(*img_view_opt);
 }
 
-Result<vk::raii::ImageView, Error> ImageResource::create_image_view() const {
-  if (description.image_type() == vk::ImageType::e2D) {
-    return create_image_view(vk::ImageViewType::e2D);
-  }
-  return create_image_view(vk::ImageViewType::e3D);
-}
-
 void ImageResource::transition_layout(vk::CommandBuffer cmd, vk::ImageLayout current_layout,
                                       vk::ImageLayout new_layout) {
   vk_util::transition_image_barrier(cmd, vk_image(),
@@ -313,4 +540,11 @@ vk::ImageSubresourceRange ImageResource::full_resource_range() const {
   };
 }
 
+void ImageResource::set_debug_name(util::zstring_view name) const {
+  _p_device->set_object_name(vk_image(), name);
+  if (_image.owns_allocation()) {
+    _p_device->vma_alloc_manager().set_allocation_name(_image._allocation, name);
+  }
+}
+
 }  // namespace eray::vkren
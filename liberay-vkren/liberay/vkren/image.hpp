@@ -3,12 +3,18 @@
 #include <vulkan/vulkan_core.h>
 
 #include <liberay/res/image.hpp>
+#include <liberay/res/ktx2.hpp>
 #include <liberay/util/memory_region.hpp>
+#include <liberay/util/zstring_view.hpp>
 #include <liberay/vkren/common.hpp>
 #include <liberay/vkren/device.hpp>
 #include <liberay/vkren/error.hpp>
 #include <liberay/vkren/image_description.hpp>
 #include <liberay/vkren/vma_raii_object.hpp>
+#include <source_location>
+#include <span>
+#include <utility>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_raii.hpp>
@@ -16,7 +22,21 @@
 
 namespace eray::vkren {
 
+class MipGenerator;
+
 struct ImageResource {
+  /**
+   * @brief Identifies the views cached by `cached_view()`.
+   *
+   */
+  struct ViewKey {
+    vk::ImageViewType type;
+    vk::Format format;
+    vk::ImageSubresourceRange range;
+
+    bool operator==(const ViewKey& other) const = default;
+  };
+
   VmaRaiiImage _image = VmaRaiiImage(nullptr);
   ImageDescription description;
   observer_ptr<Device> _p_device = nullptr;
@@ -25,6 +45,13 @@ struct ImageResource {
   vk::ImageUsageFlags usage;
   vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1;
 
+  /**
+   * @brief An image has a few distinct views, so they are searched linearly. Declared last, so that the views are
+   * destroyed before the image.
+   *
+   */
+  std::vector<std::pair<ViewKey, vk::raii::ImageView>> _view_cache{};
+
   /**
    * @brief Any resources that you frequently write and read on GPU, e.g. images used as color attachments (aka "render
    * targets"), depth-stencil attachments, images/buffers used as storage image/buffer (aka "Unordered Access View
@@ -39,40 +66,98 @@ struct ImageResource {
    */
   [[nodiscard]] static Result<ImageResource, Error> create_attachment_image(
       Device& device, ImageDescription desc, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect,
-      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1);
+      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Creates an attachment image that is bound to the already allocated `memory` and does not own it. Images that
+   * are never alive at the same time can alias the same memory. The layout is VK_IMAGE_LAYOUT_UNDEFINED.
+   *
+   * @param device
+   * @param memory Must satisfy the requirements returned by `attachment_memory_requirements`.
+   * @param desc
+   * @param usage
+   * @param aspect
+   * @param sample_count
+   * @return Result<ImageResource, Error>
+   */
+  [[nodiscard]] static Result<ImageResource, Error> create_aliasing_attachment_image(
+      Device& device, VmaAllocation memory, ImageDescription desc, vk::ImageUsageFlags usage,
+      vk::ImageAspectFlags aspect, vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Creates an attachment image backed by lazily allocated memory. Such memory is useful on tiled GPUs for
+   * attachments whose content is never stored, e.g. MSAA or depth attachments. The `eTransientAttachment` usage is
+   * always added. Returns an error if the device does not expose a lazily allocated memory type.
+   *
+   * @param device
+   * @param desc
+   * @param usage
+   * @param aspect
+   * @param sample_count
+   * @return Result<ImageResource, Error>
+   */
+  [[nodiscard]] static Result<ImageResource, Error> create_lazily_allocated_attachment_image(
+      Device& device, ImageDescription desc, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect,
+      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Creation info used by all of the attachment images.
+   *
+   */
+  [[nodiscard]] static vk::ImageCreateInfo attachment_image_create_info(const ImageDescription& desc,
+                                                                        vk::ImageUsageFlags usage,
+                                                                        vk::SampleCountFlagBits sample_count);
+
+  /**
+   * @brief Memory requirements of an attachment image, no image is created.
+   *
+   */
+  [[nodiscard]] static vk::MemoryRequirements attachment_memory_requirements(const Device& device,
+                                                                             const ImageDescription& desc,
+                                                                             vk::ImageUsageFlags usage,
+                                                                             vk::SampleCountFlagBits sample_count);
 
   [[nodiscard]] static Result<ImageResource, Error> create_color_attachment_image(
       Device& device, const ImageDescription& desc,
-      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1) {
+      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1,
+      const std::source_location& location = std::source_location::current()) {
     return create_attachment_image(
         device, desc, vk::ImageUsageFlagBits::eTransientAttachment | vk::ImageUsageFlagBits::eColorAttachment,
-        vk::ImageAspectFlagBits::eColor, sample_count);
+        vk::ImageAspectFlagBits::eColor, sample_count, location);
   }
 
   [[nodiscard]] static Result<ImageResource, Error> create_depth_stencil_attachment_image(
       Device& device, const ImageDescription& desc,
-      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1) {
+      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1,
+      const std::source_location& location = std::source_location::current()) {
     return create_attachment_image(device, desc, vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                                   vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil, sample_count);
+                                   vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil, sample_count,
+                                   location);
   }
 
   [[nodiscard]] static Result<ImageResource, Error> create_stencil_attachment_image(
       Device& device, const ImageDescription& desc,
-      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1) {
+      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1,
+      const std::source_location& location = std::source_location::current()) {
     return create_attachment_image(device, desc, vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                                   vk::ImageAspectFlagBits::eStencil, sample_count);
+                                   vk::ImageAspectFlagBits::eStencil, sample_count, location);
   }
 
   [[nodiscard]] static Result<ImageResource, Error> create_depth_attachment_image(
       Device& device, const ImageDescription& desc,
-      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1) {
+      vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1,
+      const std::source_location& location = std::source_location::current()) {
     return create_attachment_image(device, desc, vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                                   vk::ImageAspectFlagBits::eDepth, sample_count);
+                                   vk::ImageAspectFlagBits::eDepth, sample_count, location);
   }
 
   /**
    * @brief Use this for buffers that are frequently sampled by the GPU, and loaded once from the CPU. The layout is
-   * VK_IMAGE_LAYOUT_UNDEFINED.
+   * VK_IMAGE_LAYOUT_UNDEFINED. A mipmapped texture gets the storage usage when the format supports it, so that its
+   * mipmaps can be generated by the `MipGenerator`.
    *
    * @param device
    * @param desc
@@ -80,7 +165,73 @@ struct ImageResource {
    */
   [[nodiscard]] static Result<ImageResource, Error> create_texture(
       Device& device, ImageDescription desc, bool mipmapping = true,
-      vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor);
+      vk::ImageAspectFlags aspect          = vk::ImageAspectFlagBits::eColor,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Texture with exactly `mip_levels` levels, e.g. for a precomputed mip chain that stops before 1x1. The
+   * layout is VK_IMAGE_LAYOUT_UNDEFINED.
+   *
+   * @param device
+   * @param desc
+   * @param mip_levels
+   * @param aspect
+   * @return Result<ImageResource, Error>
+   */
+  [[nodiscard]] static Result<ImageResource, Error> create_texture_with_mip_levels(
+      Device& device, ImageDescription desc, uint32_t mip_levels,
+      vk::ImageAspectFlags aspect          = vk::ImageAspectFlagBits::eColor,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Create info of a partially resident 2D texture, also used to query the sparse memory requirements before
+   * the image exists (`vk::Device::getImageSparseMemoryRequirements`).
+   *
+   */
+  static vk::ImageCreateInfo sparse_texture_create_info(const ImageDescription& desc, uint32_t mip_levels);
+
+  /**
+   * @brief Creates a partially resident texture with no memory bound, the tiles are bound with
+   * `vk::Queue::bindSparse` (see `SparseTextureStreamer`). The device must support `Device::has_sparse_residency()`.
+   * The layout is VK_IMAGE_LAYOUT_UNDEFINED.
+   *
+   * @param device
+   * @param desc
+   * @param mip_levels
+   * @return Result<ImageResource, Error>
+   */
+  [[nodiscard]] static Result<ImageResource, Error> create_sparse_texture(
+      Device& device, ImageDescription desc, uint32_t mip_levels,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Creates the texture described by the KTX2 file and uploads its mip chain verbatim, straight from the mapped
+   * file. A file without precomputed mipmaps gets them generated, unless the format is compressed. Leaves the layout
+   * in the VK_IMAGE_SHADER_READ_ONLY_OPTIMAL state.
+   *
+   * The device must support sampling the format, pick the file of the block compression family supported by the
+   * device with `Device::get_first_supported_format()`.
+   *
+   * @param device
+   * @param texture
+   * @return Result<ImageResource, Error>
+   */
+  [[nodiscard]] static Result<ImageResource, Error> create_texture(
+      Device& device, const res::Ktx2Texture& texture,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Image written and read by the compute shaders, e.g. a depth pyramid, with the `mip_levels` levels. The usage
+   * is storage and sampled. The layout is VK_IMAGE_LAYOUT_UNDEFINED.
+   *
+   * @param device
+   * @param desc
+   * @param mip_levels
+   * @return Result<ImageResource, Error>
+   */
+  [[nodiscard]] static Result<ImageResource, Error> create_storage_image(
+      Device& device, ImageDescription desc, uint32_t mip_levels = 1,
+      const std::source_location& location = std::source_location::current());
 
   /**
    * @brief Invokes `vkCmdPipelineBarrier2`. `cmd` must be in the begin state.
@@ -103,15 +254,73 @@ struct ImageResource {
    *
    * @param src_region Represents packed region of CPU memory that consists of mip levels. A mip level with LOD `i`
    * contains all layer images with LOD `i`.
-   * @param offset
+   * @param mip_generator Generates the mipmaps in a single compute dispatch if it supports the image, otherwise they
+   * are blitted.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> upload(util::MemoryRegion src_region, MipGenerator* mip_generator = nullptr);
+
+  /**
+   * @brief Uploads the first `mip_offsets.size()` mip levels, the level `i` starts at `mip_offsets[i]` bytes of the
+   * `src_region`. The levels may be padded or stored in any order, like in a KTX2 file. The missing mipmaps are
+   * generated if the mipmapping is enabled.
+   *
+   * Expects the layout of the image range to be VK_IMAGE_LAYOUT_UNDEFINED. Leaves the layout in the
+   * VK_IMAGE_SHADER_READ_ONLY_OPTIMAL state.
+   *
+   * @param src_region
+   * @param mip_offsets At least one level, at most `mip_levels`.
+   * @param mip_generator See `upload(util::MemoryRegion, MipGenerator*)`.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> upload(util::MemoryRegion src_region, std::span<const vk::DeviceSize> mip_offsets,
+                             MipGenerator* mip_generator = nullptr);
+
+  /**
+   * @brief Records the `upload()` of the levels already written to the `src_buffer`, the level `i` starts at
+   * `src_offset + mip_offsets[i]` bytes. Used to record many uploads into a single command buffer, see `UploadBatch`.
+   *
+   * @param cmd_buff Must be submitted to a graphics queue.
+   * @param src_buffer
+   * @param src_offset
+   * @param mip_offsets At least one level, at most `mip_levels`.
+   * @param mip_generator See `upload(util::MemoryRegion, MipGenerator*)`.
    * @return Result<void, Error>
    */
-  Result<void, Error> upload(util::MemoryRegion src_region);
+  Result<void, Error> record_upload(vk::CommandBuffer cmd_buff, vk::Buffer src_buffer, vk::DeviceSize src_offset,
+                                    std::span<const vk::DeviceSize> mip_offsets, MipGenerator* mip_generator = nullptr);
+
+  /**
+   * @brief Offsets of the levels of a packed region of `size_bytes`, uploaded by `upload(util::MemoryRegion,
+   * MipGenerator*)`: the full mip chain or the LOD0 only.
+   *
+   */
+  std::vector<vk::DeviceSize> packed_upload_offsets(vk::DeviceSize size_bytes) const;
+
+  /**
+   * @brief Records the mipmap generation from the LOD0 image(s) using linear blitting. `cmd` must be in the begin
+   * state and must be submitted to a graphics queue. Prefer the `MipGenerator`, which generates all of the levels in a
+   * single dispatch.
+   *
+   * Expects all of the mip levels to be in the VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL layout. Leaves the layout in the
+   * VK_IMAGE_SHADER_READ_ONLY_OPTIMAL state.
+   *
+   * @param cmd
+   * @return Result<void, Error> Fails if linear blitting is not supported for the image format or the format is
+   * compressed.
+   */
+  Result<void, Error> generate_mipmaps(vk::CommandBuffer cmd);
 
   VmaAllocationInfo alloc_info() const { return _image.alloc_info(); }
 
   vk::Image vk_image() const { return _image._vk_handle; }
 
+  /**
+   * @brief Names the image and its VMA allocation for the GPU captures and the VMA statistics dumps.
+   *
+   */
+  void set_debug_name(util::zstring_view name) const;
+
   vk::Extent3D extent() const {
     return vk::Extent3D{.width = description.width, .height = description.height, .depth = description.depth};
   }
@@ -135,6 +344,38 @@ struct ImageResource {
    */
   Result<vk::raii::ImageView, Error> create_image_view() const;
 
+  /**
+   * @brief 2D view of a single mip level, e.g. for writing the level as a storage image.
+   *
+   * @param mip_level
+   * @return Result<vk::raii::ImageView, Error>
+   */
+  Result<vk::raii::ImageView, Error> create_mip_level_view(uint32_t mip_level) const;
+
+  /**
+   * @brief View owned by the image, e.g. of a custom format or subresource range, created on the first request with the
+   * same type, format and range and shared by the later ones. The view lives as long as the image.
+   *
+   * @param type
+   * @param format Must be compatible with the image format.
+   * @param range
+   * @return Result<vk::ImageView, Error>
+   */
+  Result<vk::ImageView, Error> cached_view(vk::ImageViewType type, vk::Format format,
+                                           const vk::ImageSubresourceRange& range);
+
+  /**
+   * @brief Cached `create_image_view()`.
+   *
+   */
+  Result<vk::ImageView, Error> cached_view();
+
+  /**
+   * @brief Cached `create_mip_level_view()`.
+   *
+   */
+  Result<vk::ImageView, Error> cached_mip_level_view(uint32_t mip_level);
+
   /**
    * @brief Size of the image in level of detail 0. The function ignores the mipmap level and layers.
    *
@@ -147,7 +388,7 @@ struct ImageResource {
    *
    * @return vk::DeviceSize
    */
-  vk::DeviceSize find_full_size_bytes() const { return description.find_full_size_bytes(); }
+  vk::DeviceSize find_full_size_bytes() const { return description.find_size_bytes(mip_levels); }
 
   /**
    * @brief Returns true iff the image resource has mipmappnig enabled.
@@ -158,6 +399,26 @@ struct ImageResource {
   bool mipmapping_enabled() const { return mip_levels > 1; }
 
   vk::ImageSubresourceRange full_resource_range() const;
+
+ private:
+  vk::ImageViewType default_view_type() const {
+    if (description.image_type() != vk::ImageType::e2D) {
+      return vk::ImageViewType::e3D;
+    }
+    return description.array_layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+  }
+  vk::ImageSubresourceRange mip_level_range(uint32_t mip_level) const {
+    return vk::ImageSubresourceRange{
+        .aspectMask     = aspect,
+        .baseMipLevel   = mip_level,
+        .levelCount     = 1,
+        .baseArrayLayer = 0,
+        .layerCount     = 1,
+    };
+  }
+
+  Result<vk::raii::ImageView, Error> create_view(vk::ImageViewType type, vk::Format format,
+                                                 const vk::ImageSubresourceRange& range) const;
 };
 
 }  // namespace eray::vkren
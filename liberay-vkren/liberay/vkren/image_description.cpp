@@ -1,9 +1,29 @@
+#include <cassert>
 #include <liberay/vkren/image_description.hpp>
 #include <liberay/vkren/image_format_helpers.hpp>
 #include <vulkan/vulkan.hpp>
 
 namespace eray::vkren {
 
+vk::Format to_vk_format(res::PixelFormat format, res::ColorSpace color_space) {
+  const auto srgb = color_space == res::ColorSpace::Srgb;
+  switch (format) {
+    case res::PixelFormat::R8:
+      return srgb ? vk::Format::eR8Srgb : vk::Format::eR8Unorm;
+    case res::PixelFormat::RG8:
+      return srgb ? vk::Format::eR8G8Srgb : vk::Format::eR8G8Unorm;
+    case res::PixelFormat::RGBA8:
+      return srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+    case res::PixelFormat::R16:
+      return vk::Format::eR16Unorm;
+    case res::PixelFormat::RGBA16F:
+      return vk::Format::eR16G16B16A16Sfloat;
+    case res::PixelFormat::RGBA32F:
+      return vk::Format::eR32G32B32A32Sfloat;
+  }
+  return vk::Format::eUndefined;
+}
+
 std::uint32_t ImageDescription::find_mip_levels() const {
   // Alternative like this may suffer from the floating-point precision errors:
   // return static_cast<uint32_t>(std::floor(std::log2(std::max({width, height, depth})))) + 1;
@@ -21,48 +41,36 @@ std::uint32_t ImageDescription::find_mip_levels() const {
   return levels;
 }
 
-vk::DeviceSize ImageDescription::lod0_size_bytes() const {
-  return helper::bytes_per_pixel(format) * width * height * depth * array_layers;
-}
+vk::DeviceSize ImageDescription::mip_size_bytes(std::uint32_t mip_level) const {
+  assert((depth == 1 || array_layers == 1) && "At least one of the values: array_layers, depth must be equal 1!");
 
-vk::DeviceSize ImageDescription::find_full_size_bytes() const {
-  if (depth > 1 && array_layers == 1) {
-    auto mip_width  = width;
-    auto mip_height = height;
-    auto mip_depth  = depth;
-
-    vk::DeviceSize buff_size = 0;
-    for (auto i = 0U; i < find_mip_levels(); ++i) {
-      buff_size += mip_width * mip_height * mip_depth;
-      mip_width  = std::max(mip_width / 2U, 1U);
-      mip_height = std::max(mip_height / 2U, 1U);
-      mip_depth  = std::max(mip_depth / 2U, 1U);
-    }
+  const auto mip = mip_extent(mip_level);
+  return helper::image_size_bytes(format, mip.width, mip.height, mip.depth) * array_layers;
+}
 
-    return buff_size * helper::bytes_per_pixel(format);
+vk::DeviceSize ImageDescription::find_size_bytes(std::uint32_t mip_levels) const {
+  vk::DeviceSize buff_size = 0;
+  for (auto i = 0U; i < mip_levels; ++i) {
+    buff_size += mip_size_bytes(i);
   }
+  return buff_size;
+}
 
-  if (array_layers >= 1 && depth == 1) {
-    auto mip_width  = width;
-    auto mip_height = height;
-
-    vk::DeviceSize buff_size = 0;
-    for (auto i = 0U; i < find_mip_levels(); ++i) {
-      buff_size += mip_width * mip_height;
-      mip_width  = std::max(mip_width / 2U, 1U);
-      mip_height = std::max(mip_height / 2U, 1U);
-    }
+std::vector<vk::DeviceSize> ImageDescription::packed_mip_offsets(std::uint32_t mip_levels) const {
+  auto offsets = std::vector<vk::DeviceSize>();
+  offsets.reserve(mip_levels);
 
-    return buff_size * array_layers * helper::bytes_per_pixel(format);
+  vk::DeviceSize offset = 0;
+  for (auto i = 0U; i < mip_levels; ++i) {
+    offsets.push_back(offset);
+    offset += mip_size_bytes(i);
   }
-
-  assert(false && "At least one of the values: array_layers, depth must be equal 1!");
-  return 0;
+  return offsets;
 }
 
-ImageDescription ImageDescription::from(const res::Image& image) {
+ImageDescription ImageDescription::from(const res::Image& image, res::ColorSpace color_space) {
   return ImageDescription{
-      .format       = vk::Format::eR8G8B8A8Srgb,
+      .format       = to_vk_format(image.format(), color_space),
       .width        = image.width(),
       .height       = image.height(),
       .depth        = 1,
@@ -70,4 +78,14 @@ ImageDescription ImageDescription::from(const res::Image& image) {
   };
 }
 
+ImageDescription ImageDescription::from(const res::Ktx2Texture& texture) {
+  return ImageDescription{
+      .format       = static_cast<vk::Format>(texture.vk_format()),
+      .width        = texture.width(),
+      .height       = texture.height(),
+      .depth        = texture.depth(),
+      .array_layers = texture.layer_count() * texture.face_count(),
+  };
+}
+
 }  // namespace eray::vkren
@@ -1,12 +1,22 @@
 #pragma once
 
+#include <algorithm>
 #include <liberay/res/image.hpp>
+#include <liberay/res/ktx2.hpp>
 #include <liberay/vkren/image_format_helpers.hpp>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 
 namespace eray::vkren {
 
+/**
+ * @brief Format of the `res::Image` pixels. The `color_space` selects the sRGB variant of the 8-bit formats, the other
+ * formats are always linear.
+ *
+ */
+vk::Format to_vk_format(res::PixelFormat format, res::ColorSpace color_space = res::ColorSpace::Srgb);
+
 /**
  * @brief This class describes image requirements: format, dimensions and array layers.
  *
@@ -20,7 +30,13 @@ struct ImageDescription {
   std::uint32_t depth;
   std::uint32_t array_layers;
 
-  static ImageDescription from(const res::Image& image);
+  static ImageDescription from(const res::Image& image, res::ColorSpace color_space = res::ColorSpace::Srgb);
+
+  /**
+   * @brief The faces of a cube map are the array layers.
+   *
+   */
+  static ImageDescription from(const res::Ktx2Texture& texture);
 
   static ImageDescription image2d_desc(vk::Format format, std::uint32_t width, std::uint32_t height,
                                        std::uint32_t array_layers = 1) {
@@ -52,18 +68,43 @@ struct ImageDescription {
   std::uint32_t find_mip_levels() const;
 
   /**
-   * @brief Size of the image in level of detail 0 (width*height*depth*array_layers*bytes_per_pixel).
+   * @brief Size of the image in level of detail 0 (width*height*depth*array_layers*bytes_per_pixel). The compressed
+   * formats are measured in whole blocks.
+   *
+   * @return vk::DeviceSize
+   */
+  vk::DeviceSize lod0_size_bytes() const { return mip_size_bytes(0); }
+
+  /**
+   * @brief Size of the mip level with all of the layers.
    *
+   * @param mip_level
    * @return vk::DeviceSize
    */
-  vk::DeviceSize lod0_size_bytes() const;
+  vk::DeviceSize mip_size_bytes(std::uint32_t mip_level) const;
 
   /**
    * @brief Calculates the full size in bytes, includes mipmaps and layers.
    *
    * @return vk::DeviceSize
    */
-  vk::DeviceSize find_full_size_bytes() const;
+  vk::DeviceSize find_full_size_bytes() const { return find_size_bytes(find_mip_levels()); }
+
+  /**
+   * @brief Size of the first `mip_levels` levels with all of the layers.
+   *
+   * @param mip_levels
+   * @return vk::DeviceSize
+   */
+  vk::DeviceSize find_size_bytes(std::uint32_t mip_levels) const;
+
+  /**
+   * @brief Offsets of the first `mip_levels` levels packed one after another, LOD0 first.
+   *
+   * @param mip_levels
+   * @return std::vector<vk::DeviceSize>
+   */
+  std::vector<vk::DeviceSize> packed_mip_offsets(std::uint32_t mip_levels) const;
 
   vk::ImageType image_type() const { return depth > 1 ? vk::ImageType::e3D : vk::ImageType::e2D; }
 
@@ -74,6 +115,14 @@ struct ImageDescription {
         .depth  = depth,
     };
   }
+
+  vk::Extent3D mip_extent(std::uint32_t mip_level) const {
+    return vk::Extent3D{
+        .width  = std::max(width >> mip_level, 1U),
+        .height = std::max(height >> mip_level, 1U),
+        .depth  = std::max(depth >> mip_level, 1U),
+    };
+  }
 };
 
 }  // namespace eray::vkren
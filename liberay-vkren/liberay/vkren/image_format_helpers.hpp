@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <optional>
 #include <vulkan/vulkan.hpp>
 
 namespace eray::vkren {
@@ -18,11 +20,13 @@ inline bool is_block_format(vk::Format format) {
     case vk::Format::eR8Snorm:
     case vk::Format::eR8Uint:
     case vk::Format::eR8Sint:
+    case vk::Format::eR8Srgb:
 
     case vk::Format::eR8G8Unorm:
     case vk::Format::eR8G8Snorm:
     case vk::Format::eR8G8Uint:
     case vk::Format::eR8G8Sint:
+    case vk::Format::eR8G8Srgb:
 
     case vk::Format::eR8G8B8Unorm:
     case vk::Format::eR8G8B8Snorm:
@@ -115,6 +119,7 @@ inline size_t bytes_per_pixel(vk::Format format) {
     case vk::Format::eR8Snorm:
     case vk::Format::eR8Uint:
     case vk::Format::eR8Sint:
+    case vk::Format::eR8Srgb:
       return 1;
 
     // 16-bit formats
@@ -122,6 +127,7 @@ inline size_t bytes_per_pixel(vk::Format format) {
     case vk::Format::eR8G8Snorm:
     case vk::Format::eR8G8Uint:
     case vk::Format::eR8G8Sint:
+    case vk::Format::eR8G8Srgb:
     case vk::Format::eR16Unorm:
     case vk::Format::eR16Snorm:
     case vk::Format::eR16Uint:
@@ -158,14 +164,19 @@ inline size_t bytes_per_pixel(vk::Format format) {
     case vk::Format::eR32Uint:
     case vk::Format::eR32Sint:
     case vk::Format::eR32Sfloat:
-      return 4;
-
-    // 64-bit formats
     case vk::Format::eR16G16Unorm:
     case vk::Format::eR16G16Snorm:
     case vk::Format::eR16G16Uint:
     case vk::Format::eR16G16Sint:
     case vk::Format::eR16G16Sfloat:
+      return 4;
+
+    // 64-bit formats
+    case vk::Format::eR16G16B16A16Unorm:
+    case vk::Format::eR16G16B16A16Snorm:
+    case vk::Format::eR16G16B16A16Uint:
+    case vk::Format::eR16G16B16A16Sint:
+    case vk::Format::eR16G16B16A16Sfloat:
     case vk::Format::eR32G32Uint:
     case vk::Format::eR32G32Sint:
     case vk::Format::eR32G32Sfloat:
@@ -178,11 +189,6 @@ inline size_t bytes_per_pixel(vk::Format format) {
       return 12;
 
     // 128-bit formats
-    case vk::Format::eR16G16B16A16Unorm:
-    case vk::Format::eR16G16B16A16Snorm:
-    case vk::Format::eR16G16B16A16Uint:
-    case vk::Format::eR16G16B16A16Sint:
-    case vk::Format::eR16G16B16A16Sfloat:
     case vk::Format::eR32G32B32A32Uint:
     case vk::Format::eR32G32B32A32Sint:
     case vk::Format::eR32G32B32A32Sfloat:
@@ -194,6 +200,155 @@ inline size_t bytes_per_pixel(vk::Format format) {
   return 0;
 }
 
+struct TexelBlock {
+  uint32_t width;
+  uint32_t height;
+  uint32_t size_bytes;
+};
+
+/**
+ * @brief Texel block of a block compressed format (BCn, ETC2, EAC or ASTC). Returns `std::nullopt` for the other
+ * formats.
+ *
+ * @param format
+ * @return std::optional<TexelBlock>
+ */
+inline std::optional<TexelBlock> compressed_texel_block(vk::Format format) {
+  switch (format) {
+    case vk::Format::eBc1RgbUnormBlock:
+    case vk::Format::eBc1RgbSrgbBlock:
+    case vk::Format::eBc1RgbaUnormBlock:
+    case vk::Format::eBc1RgbaSrgbBlock:
+    case vk::Format::eBc4UnormBlock:
+    case vk::Format::eBc4SnormBlock:
+    case vk::Format::eEtc2R8G8B8UnormBlock:
+    case vk::Format::eEtc2R8G8B8SrgbBlock:
+    case vk::Format::eEtc2R8G8B8A1UnormBlock:
+    case vk::Format::eEtc2R8G8B8A1SrgbBlock:
+    case vk::Format::eEacR11UnormBlock:
+    case vk::Format::eEacR11SnormBlock:
+      return TexelBlock{.width = 4, .height = 4, .size_bytes = 8};
+
+    case vk::Format::eBc2UnormBlock:
+    case vk::Format::eBc2SrgbBlock:
+    case vk::Format::eBc3UnormBlock:
+    case vk::Format::eBc3SrgbBlock:
+    case vk::Format::eBc5UnormBlock:
+    case vk::Format::eBc5SnormBlock:
+    case vk::Format::eBc6HUfloatBlock:
+    case vk::Format::eBc6HSfloatBlock:
+    case vk::Format::eBc7UnormBlock:
+    case vk::Format::eBc7SrgbBlock:
+    case vk::Format::eEtc2R8G8B8A8UnormBlock:
+    case vk::Format::eEtc2R8G8B8A8SrgbBlock:
+    case vk::Format::eEacR11G11UnormBlock:
+    case vk::Format::eEacR11G11SnormBlock:
+      return TexelBlock{.width = 4, .height = 4, .size_bytes = 16};
+
+    case vk::Format::eAstc4x4UnormBlock:
+    case vk::Format::eAstc4x4SrgbBlock:
+    case vk::Format::eAstc4x4SfloatBlock:
+      return TexelBlock{.width = 4, .height = 4, .size_bytes = 16};
+
+    case vk::Format::eAstc5x4UnormBlock:
+    case vk::Format::eAstc5x4SrgbBlock:
+    case vk::Format::eAstc5x4SfloatBlock:
+      return TexelBlock{.width = 5, .height = 4, .size_bytes = 16};
+
+    case vk::Format::eAstc5x5UnormBlock:
+    case vk::Format::eAstc5x5SrgbBlock:
+    case vk::Format::eAstc5x5SfloatBlock:
+      return TexelBlock{.width = 5, .height = 5, .size_bytes = 16};
+
+    case vk::Format::eAstc6x5UnormBlock:
+    case vk::Format::eAstc6x5SrgbBlock:
+    case vk::Format::eAstc6x5SfloatBlock:
+      return TexelBlock{.width = 6, .height = 5, .size_bytes = 16};
+
+    case vk::Format::eAstc6x6UnormBlock:
+    case vk::Format::eAstc6x6SrgbBlock:
+    case vk::Format::eAstc6x6SfloatBlock:
+      return TexelBlock{.width = 6, .height = 6, .size_bytes = 16};
+
+    case vk::Format::eAstc8x5UnormBlock:
+    case vk::Format::eAstc8x5SrgbBlock:
+    case vk::Format::eAstc8x5SfloatBlock:
+      return TexelBlock{.width = 8, .height = 5, .size_bytes = 16};
+
+    case vk::Format::eAstc8x6UnormBlock:
+    case vk::Format::eAstc8x6SrgbBlock:
+    case vk::Format::eAstc8x6SfloatBlock:
+      return TexelBlock{.width = 8, .height = 6, .size_bytes = 16};
+
+    case vk::Format::eAstc8x8UnormBlock:
+    case vk::Format::eAstc8x8SrgbBlock:
+    case vk::Format::eAstc8x8SfloatBlock:
+      return TexelBlock{.width = 8, .height = 8, .size_bytes = 16};
+
+    case vk::Format::eAstc10x5UnormBlock:
+    case vk::Format::eAstc10x5SrgbBlock:
+    case vk::Format::eAstc10x5SfloatBlock:
+      return TexelBlock{.width = 10, .height = 5, .size_bytes = 16};
+
+    case vk::Format::eAstc10x6UnormBlock:
+    case vk::Format::eAstc10x6SrgbBlock:
+    case vk::Format::eAstc10x6SfloatBlock:
+      return TexelBlock{.width = 10, .height = 6, .size_bytes = 16};
+
+    case vk::Format::eAstc10x8UnormBlock:
+    case vk::Format::eAstc10x8SrgbBlock:
+    case vk::Format::eAstc10x8SfloatBlock:
+      return TexelBlock{.width = 10, .height = 8, .size_bytes = 16};
+
+    case vk::Format::eAstc10x10UnormBlock:
+    case vk::Format::eAstc10x10SrgbBlock:
+    case vk::Format::eAstc10x10SfloatBlock:
+      return TexelBlock{.width = 10, .height = 10, .size_bytes = 16};
+
+    case vk::Format::eAstc12x10UnormBlock:
+    case vk::Format::eAstc12x10SrgbBlock:
+    case vk::Format::eAstc12x10SfloatBlock:
+      return TexelBlock{.width = 12, .height = 10, .size_bytes = 16};
+
+    case vk::Format::eAstc12x12UnormBlock:
+    case vk::Format::eAstc12x12SrgbBlock:
+    case vk::Format::eAstc12x12SfloatBlock:
+      return TexelBlock{.width = 12, .height = 12, .size_bytes = 16};
+
+    default:
+      return std::nullopt;
+  }
+}
+
+/**
+ * @brief Detects whether a format is block compressed. Such images cannot be blitted, their mipmaps must be
+ * precomputed.
+ *
+ * @param format
+ * @return true
+ * @return false
+ */
+inline bool is_compressed_format(vk::Format format) { return compressed_texel_block(format).has_value(); }
+
+/**
+ * @brief Bytes of a single `width` x `height` x `depth` image, the partial blocks of the compressed formats are
+ * rounded up to the whole blocks.
+ *
+ * @param format
+ * @param width
+ * @param height
+ * @param depth
+ * @return vk::DeviceSize
+ */
+inline vk::DeviceSize image_size_bytes(vk::Format format, uint32_t width, uint32_t height, uint32_t depth = 1) {
+  if (const auto block = compressed_texel_block(format)) {
+    const auto blocks_x = (width + block->width - 1) / block->width;
+    const auto blocks_y = (height + block->height - 1) / block->height;
+    return vk::DeviceSize{blocks_x} * blocks_y * depth * block->size_bytes;
+  }
+  return vk::DeviceSize{bytes_per_pixel(format)} * width * height * depth;
+}
+
 }  // namespace helper
 
 }  // namespace eray::vkren
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cassert>
+#include <expected>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/indirect_draw_culler.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+GpuMeshLod GpuMeshLod::create(const GeometryArena& arena, GeometryHandle handle, float min_screen_size) {
+  const auto& range = arena.range(handle);
+  return GpuMeshLod{
+      .first_index     = range.first_index,
+      .index_count     = range.index_count,
+      .vertex_offset   = static_cast<int32_t>(range.vertex_offset),
+      .min_screen_size = min_screen_size,
+  };
+}
+
+GpuDrawInstance GpuDrawInstance::create(uint32_t world_matrix_index, const Aabb& local_bounds, uint32_t first_lod,
+                                        uint32_t lod_count) {
+  const auto center = local_bounds.center();
+  const auto extent = local_bounds.extent();
+  return GpuDrawInstance{
+      .bounds_center      = math::Vec4f(center.x(), center.y(), center.z(), 0.F),
+      .bounds_extent      = math::Vec4f(extent.x(), extent.y(), extent.z(), 0.F),
+      .world_matrix_index = world_matrix_index,
+      .first_lod          = first_lod,
+      .lod_count          = lod_count,
+  };
+}
+
+Result<IndirectDrawCuller, Error> IndirectDrawCuller::create(Device& device, vk::ShaderModule cull_shader,
+                                                             const WorldMatrixBuffer& world_matrices,
+                                                             uint32_t max_instances, uint32_t max_lods) {
+  auto culler           = IndirectDrawCuller(nullptr);
+  culler.max_instances_ = max_instances;
+  culler.max_lods_      = std::max(max_lods, 1U);
+  culler.compact_       = device.has_draw_indirect_count();
+
+  if (auto buffer = BufferResource::create_storage_buffer(device, max_instances * sizeof(GpuDrawInstance))) {
+    culler.instance_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(
+          device, max_instances * sizeof(vk::DrawIndexedIndirectCommand),
+          vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer)) {
+    culler.draw_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer =
+          BufferResource::create_gpu_local_buffer(device, sizeof(uint32_t),
+                                                  vk::BufferUsageFlagBits::eStorageBuffer |
+                                                      vk::BufferUsageFlagBits::eIndirectBuffer)) {
+    culler.count_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_storage_buffer(device, culler.max_lods_ * sizeof(GpuMeshLod))) {
+    culler.lod_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(device, max_instances * sizeof(uint32_t),
+                                                            vk::BufferUsageFlagBits::eStorageBuffer)) {
+    culler.lod_state_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(device, max_instances * sizeof(uint32_t),
+                                                            vk::BufferUsageFlagBits::eStorageBuffer)) {
+    culler.visibility_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(device, sizeof(OcclusionParams),
+                                                            vk::BufferUsageFlagBits::eUniformBuffer)) {
+    culler.occlusion_params_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  auto layout = DescriptorSetBuilder::create(device)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eSampledImage, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .build_push_descriptor_layout();
+  if (!layout) {
+    return std::unexpected(layout.error());
+  }
+
+  auto push_constant_ranges = std::array{vk::PushConstantRange{
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .offset     = 0,
+      .size       = sizeof(PushConstants),
+  }};
+  auto pipeline = ComputePipelineBuilder::create()
+                      .with_shader(cull_shader)
+                      .with_descriptor_set_layout(*layout)
+                      .with_push_constant_ranges(push_constant_ranges)
+                      .build(device);
+  if (!pipeline) {
+    return std::unexpected(pipeline.error());
+  }
+  culler.pipeline_ = std::move(*pipeline);
+
+  culler.binder_              = DescriptorSetBinder::create(device);
+  culler.world_matrices_info_ = world_matrices.desc_buffer_info();
+  culler.bind_descriptors();
+
+  return culler;
+}
+
+void IndirectDrawCuller::bind_descriptors() {
+  // The buffers never change, so the push descriptor writes are prepared once. The Hi-Z is read by the late phase only,
+  // so it stays unwritten until the `set_occlusion()`
+  binder_.clear();
+  binder_.bind_buffer(0, instance_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(1, world_matrices_info_, vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(2, draw_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(3, count_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(4, lod_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(5, lod_state_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(6, visibility_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  if (hiz_view_) {
+    binder_.bind_sampled_image(7, hiz_view_, vk::ImageLayout::eGeneral);
+  }
+  binder_.bind_buffer(8, occlusion_params_buffer_.desc_buffer_info(), vk::DescriptorType::eUniformBuffer);
+}
+
+Result<void, Error> IndirectDrawCuller::upload_instances(StagingRingBuffer& staging,
+                                                         std::span<const GpuDrawInstance> instances, uint32_t first) {
+  if (first + instances.size() > max_instances_) {
+    return std::unexpected(Error{
+        .msg  = "Indirect draw culler instance capacity exceeded",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  return staging.upload(util::MemoryRegion{instances.data(), instances.size_bytes()}, instance_buffer_,
+                        first * sizeof(GpuDrawInstance));
+}
+
+Result<void, Error> IndirectDrawCuller::upload_lods(StagingRingBuffer& staging, std::span<const GpuMeshLod> lods,
+                                                    uint32_t first) {
+  if (first + lods.size() > max_lods_) {
+    return std::unexpected(Error{
+        .msg  = "Indirect draw culler LOD capacity exceeded",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  return staging.upload(util::MemoryRegion{lods.data(), lods.size_bytes()}, lod_buffer_, first * sizeof(GpuMeshLod));
+}
+
+void IndirectDrawCuller::set_lod_view(const LodView& lod_view) {
+  push_constants_.lod_eye =
+      math::Vec4f(lod_view.eye.x(), lod_view.eye.y(), lod_view.eye.z(), lod_view.projection_scale);
+  push_constants_.lod_hysteresis = lod_view.hysteresis;
+}
+
+void IndirectDrawCuller::set_frustum(const Frustum& frustum) {
+  for (auto i = 0U; i < Frustum::kPlanes; ++i) {
+    push_constants_.planes[i] = frustum.plane(i);
+  }
+}
+
+void IndirectDrawCuller::set_occlusion(const HiZPyramid& hiz, const math::Mat4f& view_projection) {
+  occlusion_params_ = OcclusionParams{
+      .view_projection = view_projection,
+      .depth_size      = hiz.depth_extent(),
+      .level_count     = hiz.level_count(),
+      ._padding        = 0,
+  };
+  if (hiz.view() != hiz_view_) {
+    hiz_view_ = hiz.view();
+    bind_descriptors();
+  }
+}
+
+void IndirectDrawCuller::record_cull(vk::CommandBuffer cmd_buff, CullPhase phase) {
+  ERAY_PROFILE_FUNCTION();
+  assert((phase != CullPhase::Late || hiz_view_) && "The late cull requires the Hi-Z pyramid");
+
+  // The commands and the count of the previous frame or phase must have been consumed before they are overwritten,
+  // write after read hazards need an execution dependency only. The LOD states and the visibility written by the
+  // previous cull are read back
+  auto war_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eClear | vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &war_barrier,
+  });
+
+  if (!lod_state_cleared_) {
+    cmd_buff.fillBuffer(lod_state_buffer_.vk_buffer(), 0, vk::WholeSize, 0);
+    cmd_buff.fillBuffer(visibility_buffer_.vk_buffer(), 0, vk::WholeSize, 0);
+    lod_state_cleared_ = true;
+  }
+
+  // The view projection changes every frame
+  if (phase == CullPhase::Late) {
+    cmd_buff.updateBuffer<OcclusionParams>(occlusion_params_buffer_.vk_buffer(), 0, occlusion_params_);
+  }
+
+  if (compact_) {
+    cmd_buff.fillBuffer(count_buffer_.vk_buffer(), 0, sizeof(uint32_t), 0);
+  }
+
+  // Even without the count buffer the cull reads and writes the LOD states
+  auto clear_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eClear,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite |
+                       vk::AccessFlagBits2::eUniformRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &clear_barrier,
+  });
+
+  if (instance_count_ > 0) {
+    push_constants_.instance_count = instance_count_;
+    push_constants_.compact        = compact_ ? 1U : 0U;
+    push_constants_.phase          = phase;
+    cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline_.pipeline);
+    binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, pipeline_.layout);
+    cmd_buff.pushConstants<PushConstants>(pipeline_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants_);
+    cmd_buff.dispatch((instance_count_ + kWorkgroupSize - 1) / kWorkgroupSize, 1, 1);
+    binder_._p_device->statistics().count_dispatches();
+  }
+
+  auto draw_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect,
+      .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &draw_barrier,
+  });
+}
+
+void IndirectDrawCuller::record_draw(vk::CommandBuffer cmd_buff, const GeometryArena& arena) const {
+  if (instance_count_ == 0) {
+    return;
+  }
+
+  arena.bind(cmd_buff);
+  if (compact_) {
+    cmd_buff.drawIndexedIndirectCount(draw_buffer_.vk_buffer(), 0, count_buffer_.vk_buffer(), 0, instance_count_,
+                                      sizeof(vk::DrawIndexedIndirectCommand));
+  } else {
+    cmd_buff.drawIndexedIndirect(draw_buffer_.vk_buffer(), 0, instance_count_, sizeof(vk::DrawIndexedIndirectCommand));
+  }
+  binder_._p_device->statistics().count_draws();
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/buffer/geometry_arena.hpp>
+#include <liberay/vkren/buffer/staging_ring_buffer.hpp>
+#include <liberay/vkren/buffer/world_matrix_buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/hiz_pyramid.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <liberay/vkren/scene/aabb.hpp>
+#include <liberay/vkren/scene/frustum.hpp>
+#include <liberay/vkren/scene/lod.hpp>
+#include <span>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Level of detail of a mesh drawn by the `IndirectDrawCuller`, std430 layout of the `MeshLod` in
+ * `indirect_cull.slang`.
+ *
+ */
+struct GpuMeshLod {
+  uint32_t first_index;
+  uint32_t index_count;
+  int32_t vertex_offset;
+
+  /**
+   * @brief See `MeshLodChain::min_screen_sizes`.
+   *
+   */
+  float min_screen_size;
+
+  /**
+   * @brief LOD of the mesh uploaded to the geometry arena.
+   *
+   * @param arena
+   * @param handle
+   * @param min_screen_size
+   * @return GpuMeshLod
+   */
+  [[nodiscard]] static GpuMeshLod create(const GeometryArena& arena, GeometryHandle handle,
+                                         float min_screen_size = 0.F);
+};
+static_assert(sizeof(GpuMeshLod) == 16);
+
+/**
+ * @brief Instance drawn by the `IndirectDrawCuller`, std430 layout of the `DrawInstance` in `indirect_cull.slang`.
+ *
+ */
+struct GpuDrawInstance {
+  /**
+   * @brief Center (xyz) and extent (xyz) of the bounds in the local space of the node, w is unused.
+   *
+   */
+  math::Vec4f bounds_center;
+  math::Vec4f bounds_extent;
+
+  /**
+   * @brief Index of the node world matrix in the `WorldMatrixBuffer`, i.e. `FlatTree::index_of()`.
+   *
+   */
+  uint32_t world_matrix_index;
+
+  /**
+   * @brief LOD chain of the mesh in the LOD buffer of the culler, from the most detailed LOD. Instances of the same
+   * mesh share the chain.
+   *
+   */
+  uint32_t first_lod;
+  uint32_t lod_count;
+  uint32_t _padding = 0;
+
+  /**
+   * @brief Instance of the mesh placed by the node world matrix.
+   *
+   * @param world_matrix_index
+   * @param local_bounds Must not be empty.
+   * @param first_lod
+   * @param lod_count At most `MeshLodChain::kMaxLods`.
+   * @return GpuDrawInstance
+   */
+  [[nodiscard]] static GpuDrawInstance create(uint32_t world_matrix_index, const Aabb& local_bounds,
+                                              uint32_t first_lod, uint32_t lod_count = 1);
+};
+static_assert(sizeof(GpuDrawInstance) == 48);
+
+/**
+ * @brief Phase of the two-phase occlusion culling of the `IndirectDrawCuller`.
+ *
+ */
+enum class CullPhase : uint32_t {
+  /**
+   * @brief Frustum culling only, the occlusion is not tested.
+   *
+   */
+  All = 0,
+
+  /**
+   * @brief Draws the instances that were visible at the end of the last frame and lie in the frustum. Their depth is
+   * what the `HiZPyramid` is built from.
+   *
+   */
+  Early = 1,
+
+  /**
+   * @brief Tests the instances in the frustum against the `HiZPyramid` of the early depth and draws the visible ones
+   * the early phase skipped. The result is the visibility the next early phase starts from.
+   *
+   */
+  Late = 2,
+};
+
+/**
+ * @brief Culls the instances against the view frustum in a compute shader and writes a `VkDrawIndexedIndirectCommand`
+ * per visible instance, so the whole scene is drawn from the geometry arena with a single
+ * `drawIndexedIndirectCount` and the CPU records no per-object commands. The `firstInstance` of each command is the
+ * index of its instance, the vertex shader fetches the `GpuDrawInstance` (and the world matrix) with it.
+ *
+ * The same dispatch selects the LOD of each visible instance from its projected screen size, with the hysteresis of
+ * `select_lod()`. The LOD each instance was drawn with is kept in a device buffer between the frames.
+ *
+ * The compute shader is `liberay-vkren/shaders/indirect_cull.slang`, compile it with the `add_slang_shader_target()`
+ * of the binary. Without the `drawIndirectCount` feature the commands are not compacted, the culled ones draw zero
+ * instances instead.
+ *
+ * `record_cull()` is meant to be emitted by a render graph compute pass and `record_draw()` by the render pass that
+ * follows it, the culler orders its own buffer accesses with barriers.
+ *
+ * With a `HiZPyramid` set by `set_occlusion()` the instances hidden behind the depth are culled too, in two phases per
+ * frame: the `CullPhase::Early` cull and draw, the `HiZPyramid::record_build()` from their depth, then the
+ * `CullPhase::Late` cull and draw of the rest. Both phases write the same draw buffers, the late draw loads the depth
+ * of the early one.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class IndirectDrawCuller {
+ public:
+  IndirectDrawCuller() = delete;
+  explicit IndirectDrawCuller(std::nullptr_t) {}
+
+  /**
+   * @brief Workgroup size of the cull shader, must match the `numthreads` of `indirect_cull.slang`.
+   *
+   */
+  static constexpr uint32_t kWorkgroupSize = 64;
+
+  /**
+   * @brief Creates the pipeline and the instance, LOD, draw and count buffers.
+   *
+   * @param device
+   * @param cull_shader Module compiled from `indirect_cull.slang`.
+   * @param world_matrices Must outlive the culler.
+   * @param max_instances
+   * @param max_lods Capacity of the LOD buffer shared by the instances.
+   * @return Result<IndirectDrawCuller, Error>
+   */
+  [[nodiscard]] static Result<IndirectDrawCuller, Error> create(Device& device, vk::ShaderModule cull_shader,
+                                                                const WorldMatrixBuffer& world_matrices,
+                                                                uint32_t max_instances, uint32_t max_lods);
+
+  /**
+   * @brief Stages the instances at `first` and onwards, the copies are recorded by the next
+   * `StagingRingBuffer::record_pending_copies()`, which must precede `record_cull()`.
+   *
+   * @param staging
+   * @param instances
+   * @param first
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when the ring has not enough free space.
+   */
+  Result<void, Error> upload_instances(StagingRingBuffer& staging, std::span<const GpuDrawInstance> instances,
+                                       uint32_t first = 0);
+
+  /**
+   * @brief Stages the LODs at `first` and onwards, like the `upload_instances()`.
+   *
+   * @param staging
+   * @param lods
+   * @param first
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when the ring has not enough free space.
+   */
+  Result<void, Error> upload_lods(StagingRingBuffer& staging, std::span<const GpuMeshLod> lods, uint32_t first = 0);
+
+  /**
+   * @brief Number of the instances culled and drawn, starting from the first one.
+   *
+   */
+  void set_instance_count(uint32_t instance_count) { instance_count_ = instance_count; }
+  uint32_t instance_count() const { return instance_count_; }
+
+  /**
+   * @brief Frustum used by the next `record_cull()`, usually the world space frustum of the camera.
+   *
+   */
+  void set_frustum(const Frustum& frustum);
+
+  /**
+   * @brief Camera the next `record_cull()` selects the LODs for.
+   *
+   */
+  void set_lod_view(const LodView& lod_view);
+
+  /**
+   * @brief Hi-Z pyramid and camera the next `CullPhase::Late` cull tests the occlusion against.
+   *
+   * @param hiz Must outlive the culls, rebuilt by the `HiZPyramid::record_build()` between the phases.
+   * @param view_projection View projection matrix the depth was rendered with.
+   */
+  void set_occlusion(const HiZPyramid& hiz, const math::Mat4f& view_projection);
+
+  /**
+   * @brief Records the culling dispatch. Must be recorded outside of rendering.
+   *
+   * @param cmd_buff
+   * @param phase `CullPhase::Late` requires the `set_occlusion()`.
+   */
+  void record_cull(vk::CommandBuffer cmd_buff, CullPhase phase = CullPhase::All);
+
+  /**
+   * @brief Binds the geometry arena and records the indirect draw of the commands written by the last
+   * `record_cull()`. The graphics pipeline must be bound already.
+   *
+   * @param cmd_buff
+   * @param arena Arena the instances were created from.
+   */
+  void record_draw(vk::CommandBuffer cmd_buff, const GeometryArena& arena) const;
+
+  const BufferResource& instance_buffer() const { return instance_buffer_; }
+  const BufferResource& draw_buffer() const { return draw_buffer_; }
+  const BufferResource& count_buffer() const { return count_buffer_; }
+  const BufferResource& lod_buffer() const { return lod_buffer_; }
+  uint32_t max_instances() const { return max_instances_; }
+  uint32_t max_lods() const { return max_lods_; }
+
+ private:
+  /**
+   * @brief Push constants of `indirect_cull.slang`.
+   *
+   */
+  struct PushConstants {
+    std::array<math::Vec4f, Frustum::kPlanes> planes;
+
+    /**
+     * @brief Eye position (xyz) and projection scale (w) of the `LodView`.
+     *
+     */
+    math::Vec4f lod_eye;
+    uint32_t instance_count;
+
+    /**
+     * @brief 1 if the visible commands are compacted and counted, 0 if every instance keeps its own command.
+     *
+     */
+    uint32_t compact;
+    float lod_hysteresis;
+    CullPhase phase;
+  };
+
+  /**
+   * @brief Uniform buffer of the occlusion test of `indirect_cull.slang`, the push constants are full.
+   *
+   */
+  struct OcclusionParams {
+    math::Mat4f view_projection;
+    math::Vec2u depth_size;
+    uint32_t level_count;
+    uint32_t _padding;
+  };
+
+  /**
+   * @brief Prepares the push descriptor writes, the Hi-Z is bound once set.
+   *
+   */
+  void bind_descriptors();
+
+  Pipeline pipeline_{};
+  DescriptorSetBinder binder_{};
+
+  BufferResource instance_buffer_{};
+  BufferResource draw_buffer_{};
+  BufferResource count_buffer_{};
+  BufferResource lod_buffer_{};
+
+  /**
+   * @brief LOD selected for each instance by the last cull, zeroed by the first one.
+   *
+   */
+  BufferResource lod_state_buffer_{};
+
+  /**
+   * @brief 1 for each instance visible at the end of the last `CullPhase::Late` cull, zeroed by the first cull.
+   *
+   */
+  BufferResource visibility_buffer_{};
+
+  BufferResource occlusion_params_buffer_{};
+  OcclusionParams occlusion_params_{};
+  vk::ImageView hiz_view_ = VK_NULL_HANDLE;
+  vk::DescriptorBufferInfo world_matrices_info_{};
+
+  PushConstants push_constants_{};
+  uint32_t instance_count_ = 0;
+  uint32_t max_instances_  = 0;
+  uint32_t max_lods_       = 0;
+  bool compact_            = false;
+  bool lod_state_cleared_  = false;
+};
+
+}  // namespace eray::vkren
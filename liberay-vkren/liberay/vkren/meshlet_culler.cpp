@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cassert>
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/meshlet_culler.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+Result<MeshletCuller, Error> MeshletCuller::create(Device& device, GraphicsPipelineBuilder builder,
+                                                   vk::ShaderModule meshlet_shader, vk::ShaderModule fragment_shader,
+                                                   const WorldMatrixBuffer& world_matrices, const GeometryArena& arena,
+                                                   uint32_t max_meshlets, uint32_t max_meshlet_vertices,
+                                                   uint32_t max_meshlet_triangle_bytes, uint32_t max_batches) {
+  if (!device.has_mesh_shader()) {
+    util::Logger::err("Could not create the meshlet culler. The mesh shaders are not enabled");
+    return std::unexpected(Error{
+        .msg  = "Mesh shaders are not supported",
+        .code = ErrorCode::ExtensionNotSupported{.extension = vk::EXTMeshShaderExtensionName},
+    });
+  }
+  assert(arena.vertex_stride() == sizeof(res::MeshVertex) && "The mesh shader fetches res::MeshVertex vertices");
+
+  auto culler                  = MeshletCuller(nullptr);
+  culler.max_meshlets_         = std::max(max_meshlets, 1U);
+  culler.max_meshlet_vertices_ = std::max(max_meshlet_vertices, 1U);
+  culler.max_triangle_bytes_   = std::max(max_meshlet_triangle_bytes, 4U);
+  culler.max_batches_          = std::max(max_batches, 1U);
+
+  const auto mesh_shader_properties =
+      device.physical_device()
+          .getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceMeshShaderPropertiesEXT>()
+          .get<vk::PhysicalDeviceMeshShaderPropertiesEXT>();
+  culler.max_task_workgroups_x_ = mesh_shader_properties.maxTaskWorkGroupCount[0];
+
+  if (auto buffer = BufferResource::create_storage_buffer(device, culler.max_meshlets_ * sizeof(GpuMeshlet))) {
+    culler.meshlet_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_storage_buffer(device, culler.max_meshlet_vertices_ * sizeof(uint32_t))) {
+    culler.meshlet_vertex_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  // The triangles are read as words, the size is rounded up
+  const auto triangle_buffer_size = (culler.max_triangle_bytes_ + 3U) & ~3U;
+  if (auto buffer = BufferResource::create_storage_buffer(device, triangle_buffer_size)) {
+    culler.meshlet_triangle_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_storage_buffer(device, culler.max_batches_ * sizeof(Batch))) {
+    culler.batch_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(device, sizeof(ViewParams),
+                                                            vk::BufferUsageFlagBits::eUniformBuffer)) {
+    culler.view_params_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(device, sizeof(vk::DrawMeshTasksIndirectCommandEXT),
+                                                            vk::BufferUsageFlagBits::eIndirectBuffer)) {
+    culler.draw_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  const auto stages = vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT;
+  auto layout       = DescriptorSetBuilder::create(device)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, stages)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, stages)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, stages)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, stages)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, stages)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, stages)
+                    .with_binding(vk::DescriptorType::eUniformBuffer, stages)
+                    .build_push_descriptor_layout();
+  if (!layout) {
+    return std::unexpected(layout.error());
+  }
+
+  builder._shader_stages.clear();
+  auto pipeline = builder.with_mesh_shaders(meshlet_shader, meshlet_shader, fragment_shader)
+                      .with_descriptor_set_layout(*layout)
+                      .build(device);
+  if (!pipeline) {
+    return std::unexpected(pipeline.error());
+  }
+  culler.pipeline_ = std::move(*pipeline);
+
+  // The buffers never change, so the push descriptor writes are prepared once
+  culler.binder_ = DescriptorSetBinder::create(device);
+  culler.binder_.bind_buffer(0, culler.batch_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  culler.binder_.bind_buffer(1, world_matrices.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  culler.binder_.bind_buffer(2, culler.meshlet_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  culler.binder_.bind_buffer(3, culler.meshlet_vertex_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  culler.binder_.bind_buffer(4, culler.meshlet_triangle_buffer_.desc_buffer_info(),
+                             vk::DescriptorType::eStorageBuffer);
+  culler.binder_.bind_buffer(5, arena.vertex_buffer().desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  culler.binder_.bind_buffer(6, culler.view_params_buffer_.desc_buffer_info(), vk::DescriptorType::eUniformBuffer);
+
+  return culler;
+}
+
+Result<uint32_t, Error> MeshletCuller::upload_mesh(StagingRingBuffer& staging, const GeometryArena& arena,
+                                                   GeometryHandle handle, std::span<const res::Meshlet> meshlets,
+                                                   std::span<const uint32_t> meshlet_vertices,
+                                                   std::span<const uint8_t> meshlet_triangles) {
+  // Every mesh starts at a word, so the word aligned triangle offsets of the meshlets stay aligned
+  const auto triangle_bytes = static_cast<uint32_t>((meshlet_triangles.size() + 3) & ~size_t{3});
+  if (meshlet_count_ + meshlets.size() > max_meshlets_ ||
+      meshlet_vertex_count_ + meshlet_vertices.size() > max_meshlet_vertices_ ||
+      meshlet_triangle_bytes_ + triangle_bytes > max_triangle_bytes_) {
+    return std::unexpected(Error{
+        .msg  = "Meshlet culler capacity exceeded",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  const auto base_vertex = arena.range(handle).vertex_offset;
+  auto gpu_meshlets      = std::vector<GpuMeshlet>();
+  gpu_meshlets.reserve(meshlets.size());
+  for (const auto& meshlet : meshlets) {
+    assert(meshlet.vertex_count <= kMaxMeshletVertices && meshlet.triangle_count <= kMaxMeshletTriangles &&
+           "The meshlet exceeds the outputs of the mesh shader");
+    const auto& apex = meshlet.cone_apex;
+    const auto& axis = meshlet.cone_axis;
+    gpu_meshlets.push_back(GpuMeshlet{
+        .sphere          = math::Vec4f(meshlet.center[0], meshlet.center[1], meshlet.center[2], meshlet.radius),
+        .cone_apex       = math::Vec4f(apex[0], apex[1], apex[2], meshlet.cone_cutoff),
+        .cone_axis       = math::Vec4f(axis[0], axis[1], axis[2], 0.F),
+        .vertex_offset   = meshlet_vertex_count_ + meshlet.vertex_offset,
+        .triangle_offset = meshlet_triangle_bytes_ + meshlet.triangle_offset,
+        .counts          = meshlet.vertex_count | (meshlet.triangle_count << 16),
+        .base_vertex     = base_vertex,
+    });
+  }
+
+  if (auto result = staging.upload(util::MemoryRegion{gpu_meshlets.data(), gpu_meshlets.size() * sizeof(GpuMeshlet)},
+                                   meshlet_buffer_, meshlet_count_ * sizeof(GpuMeshlet));
+      !result) {
+    return std::unexpected(result.error());
+  }
+  if (auto result = staging.upload(util::MemoryRegion{meshlet_vertices.data(), meshlet_vertices.size_bytes()},
+                                   meshlet_vertex_buffer_, meshlet_vertex_count_ * sizeof(uint32_t));
+      !result) {
+    return std::unexpected(result.error());
+  }
+  if (auto result = staging.upload(util::MemoryRegion{meshlet_triangles.data(), meshlet_triangles.size_bytes()},
+                                   meshlet_triangle_buffer_, meshlet_triangle_bytes_);
+      !result) {
+    return std::unexpected(result.error());
+  }
+
+  const auto first_meshlet = meshlet_count_;
+  meshlet_count_ += static_cast<uint32_t>(meshlets.size());
+  meshlet_vertex_count_ += static_cast<uint32_t>(meshlet_vertices.size());
+  meshlet_triangle_bytes_ += triangle_bytes;
+
+  return first_meshlet;
+}
+
+Result<void, Error> MeshletCuller::upload_instances(StagingRingBuffer& staging,
+                                                    std::span<const GpuMeshletInstance> instances) {
+  batches_.clear();
+  for (const auto& instance : instances) {
+    assert(instance.first_meshlet + instance.meshlet_count <= meshlet_count_ && "The meshlets must be uploaded");
+    for (auto offset = 0U; offset < instance.meshlet_count; offset += kMeshletsPerTask) {
+      batches_.push_back(Batch{
+          .world_matrix_index = instance.world_matrix_index,
+          .first_meshlet      = instance.first_meshlet + offset,
+          .meshlet_count      = std::min(kMeshletsPerTask, instance.meshlet_count - offset),
+          ._padding           = 0,
+      });
+    }
+  }
+
+  if (batches_.size() > max_batches_) {
+    batch_count_ = 0;
+    return std::unexpected(Error{
+        .msg  = "Meshlet culler batch capacity exceeded",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  batch_count_ = static_cast<uint32_t>(batches_.size());
+  if (batches_.empty()) {
+    return {};
+  }
+  return staging.upload(util::MemoryRegion{batches_.data(), batches_.size() * sizeof(Batch)}, batch_buffer_);
+}
+
+void MeshletCuller::set_frustum(const Frustum& frustum) {
+  for (auto i = 0U; i < Frustum::kPlanes; ++i) {
+    view_params_.planes[i] = frustum.plane(i);
+  }
+}
+
+void MeshletCuller::set_view(const math::Mat4f& view_projection, const math::Vec3f& eye) {
+  view_params_.view_projection = view_projection;
+  view_params_.eye             = math::Vec4f(eye.x(), eye.y(), eye.z(), 1.F);
+}
+
+void MeshletCuller::record_update(vk::CommandBuffer cmd_buff) {
+  ERAY_PROFILE_FUNCTION();
+
+  // The batches past the X limit wrap to the next row, the task shader skips the tail of the last row
+  const auto batches_per_row   = std::max(std::min(batch_count_, max_task_workgroups_x_), 1U);
+  view_params_.batch_count     = batch_count_;
+  view_params_.batches_per_row = batches_per_row;
+
+  auto command = vk::DrawMeshTasksIndirectCommandEXT{
+      .groupCountX = batch_count_ == 0 ? 0 : batches_per_row,
+      .groupCountY = (batch_count_ + batches_per_row - 1) / batches_per_row,
+      .groupCountZ = 1,
+  };
+
+  // The previous draw must have consumed the view and the command before they are overwritten
+  auto war_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eTaskShaderEXT |
+                      vk::PipelineStageFlagBits2::eMeshShaderEXT,
+      .srcAccessMask = vk::AccessFlagBits2::eNone,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eAllTransfer,
+      .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &war_barrier,
+  });
+
+  cmd_buff.updateBuffer<ViewParams>(view_params_buffer_.vk_buffer(), 0, view_params_);
+  cmd_buff.updateBuffer<vk::DrawMeshTasksIndirectCommandEXT>(draw_buffer_.vk_buffer(), 0, command);
+
+  auto draw_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eAllTransfer,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eTaskShaderEXT |
+                      vk::PipelineStageFlagBits2::eMeshShaderEXT,
+      .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eUniformRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &draw_barrier,
+  });
+}
+
+void MeshletCuller::record_draw(vk::CommandBuffer cmd_buff) {
+  if (batch_count_ == 0) {
+    return;
+  }
+
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline_.pipeline);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eGraphics, pipeline_.layout);
+  cmd_buff.drawMeshTasksIndirectEXT(draw_buffer_.vk_buffer(), 0, 1, sizeof(vk::DrawMeshTasksIndirectCommandEXT));
+  binder_._p_device->statistics().count_draws();
+}
+
+}  // namespace eray::vkren
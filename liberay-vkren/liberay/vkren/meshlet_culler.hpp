@@ -0,0 +1,266 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/vec.hpp>
+#include <liberay/res/mesh.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/buffer/geometry_arena.hpp>
+#include <liberay/vkren/buffer/staging_ring_buffer.hpp>
+#include <liberay/vkren/buffer/world_matrix_buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <liberay/vkren/scene/frustum.hpp>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Meshlet drawn by the `MeshletCuller`, std430 layout of the `Meshlet` in `meshlet_cull.slang`.
+ *
+ */
+struct GpuMeshlet {
+  /**
+   * @brief Center (xyz) and radius (w) of the bounding sphere in the local space of the mesh.
+   *
+   */
+  math::Vec4f sphere;
+
+  /**
+   * @brief Apex (xyz) and cutoff (w) of the normal cone, see `res::Meshlet`.
+   *
+   */
+  math::Vec4f cone_apex;
+
+  /**
+   * @brief Axis (xyz) of the normal cone, w is unused.
+   *
+   */
+  math::Vec4f cone_axis;
+
+  /**
+   * @brief First meshlet vertex and first triangle byte in the buffers of the culler.
+   *
+   */
+  uint32_t vertex_offset;
+  uint32_t triangle_offset;
+
+  /**
+   * @brief Vertex count (low 16 bits) and triangle count (high 16 bits).
+   *
+   */
+  uint32_t counts;
+
+  /**
+   * @brief First vertex of the mesh in the geometry arena, added to the meshlet vertices.
+   *
+   */
+  uint32_t base_vertex;
+};
+static_assert(sizeof(GpuMeshlet) == 64);
+
+/**
+ * @brief Instance drawn by the `MeshletCuller`.
+ *
+ */
+struct GpuMeshletInstance {
+  /**
+   * @brief Index of the node world matrix in the `WorldMatrixBuffer`, i.e. `FlatTree::index_of()`.
+   *
+   */
+  uint32_t world_matrix_index;
+
+  /**
+   * @brief Meshlets of the instance in the meshlet buffer of the culler, e.g. the meshlets of a single LOD: the first
+   * meshlet returned by `MeshletCuller::upload_mesh()` plus `res::MeshLod::first_meshlet`.
+   *
+   */
+  uint32_t first_meshlet;
+  uint32_t meshlet_count;
+};
+
+/**
+ * @brief Draws the meshes as meshlets with the task and mesh shaders of VK_EXT_mesh_shader. Every task workgroup
+ * culls up to `kMeshletsPerTask` meshlets of an instance against the view frustum (bounding sphere) and the camera
+ * direction (normal cone), and launches a mesh workgroup per surviving meshlet, so the hidden clusters of the visible
+ * meshes cost neither the vertex nor the rasterizer work. The whole scene is a single `drawMeshTasksIndirectEXT`.
+ *
+ * The meshlets are built by the mesh import (meshoptimizer), see `res::MeshData`. The mesh shader fetches the
+ * `res::MeshVertex` vertices of the geometry arena directly, so the arena must have been created with their stride.
+ *
+ * The task and mesh shaders are `liberay-vkren/shaders/meshlet_cull.slang`, compile it with the
+ * `add_slang_shader_target()` of the binary. The fragment shader is provided by the user, it receives the world space
+ * `NORMAL` and the `TEXCOORD0` of the `res::MeshVertex`. Requires `Device::has_mesh_shader()`.
+ *
+ * `record_update()` is meant to be emitted outside of rendering, e.g. by a render graph transfer pass, and
+ * `record_draw()` by the render pass that follows it.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class MeshletCuller {
+ public:
+  MeshletCuller() = delete;
+  explicit MeshletCuller(std::nullptr_t) {}
+
+  /**
+   * @brief Meshlets culled by a task workgroup, must match the `numthreads` of `mainTask` in `meshlet_cull.slang`.
+   *
+   */
+  static constexpr uint32_t kMeshletsPerTask = 32;
+
+  /**
+   * @brief Limits of a meshlet, must match the outputs of `mainMesh` in `meshlet_cull.slang`. The defaults of the
+   * `res::MeshImportOptions`.
+   *
+   */
+  static constexpr uint32_t kMaxMeshletVertices  = 64;
+  static constexpr uint32_t kMaxMeshletTriangles = 124;
+
+  /**
+   * @brief Creates the pipeline and the meshlet, batch and view buffers.
+   *
+   * @param device Must support the mesh shaders.
+   * @param builder Describes the attachments and the state of the pipeline, its shaders and descriptor set layouts are
+   * replaced.
+   * @param meshlet_shader Module compiled from `meshlet_cull.slang`.
+   * @param fragment_shader
+   * @param world_matrices Must outlive the culler.
+   * @param arena Stores the `res::MeshVertex` vertices of the meshes, must outlive the culler.
+   * @param max_meshlets Capacity of the meshlet buffer shared by the meshes.
+   * @param max_meshlet_vertices Capacity of the meshlet vertex buffer.
+   * @param max_meshlet_triangle_bytes Capacity of the meshlet triangle buffer, 3 bytes per triangle.
+   * @param max_batches Capacity of the task workgroups, an instance takes a batch per `kMeshletsPerTask` meshlets.
+   * @return Result<MeshletCuller, Error> Fails with `ExtensionNotSupported` when the mesh shaders are not enabled.
+   */
+  [[nodiscard]] static Result<MeshletCuller, Error> create(Device& device, GraphicsPipelineBuilder builder,
+                                                           vk::ShaderModule meshlet_shader,
+                                                           vk::ShaderModule fragment_shader,
+                                                           const WorldMatrixBuffer& world_matrices,
+                                                           const GeometryArena& arena, uint32_t max_meshlets,
+                                                           uint32_t max_meshlet_vertices,
+                                                           uint32_t max_meshlet_triangle_bytes, uint32_t max_batches);
+
+  /**
+   * @brief Appends the meshlets of a mesh uploaded to the geometry arena. The copies are recorded by the next
+   * `StagingRingBuffer::record_pending_copies()`, which must precede `record_update()`.
+   *
+   * @param staging
+   * @param arena Arena the culler was created with.
+   * @param handle Allocation of the mesh vertices.
+   * @param meshlets Meshlets of all of the LODs, e.g. `res::MeshAsset::meshlets()`.
+   * @param meshlet_vertices
+   * @param meshlet_triangles
+   * @return Result<uint32_t, Error> Index of the first meshlet in the meshlet buffer of the culler. Fails with
+   * `MemoryAllocationFailure` when a capacity is exceeded or the ring has not enough free space.
+   */
+  Result<uint32_t, Error> upload_mesh(StagingRingBuffer& staging, const GeometryArena& arena, GeometryHandle handle,
+                                      std::span<const res::Meshlet> meshlets,
+                                      std::span<const uint32_t> meshlet_vertices,
+                                      std::span<const uint8_t> meshlet_triangles);
+
+  /**
+   * @brief Replaces the drawn instances. Every instance is split into the task batches on the CPU, the copy is recorded
+   * like the one of `upload_mesh()`.
+   *
+   * @param staging
+   * @param instances
+   * @return Result<void, Error> Fails with `MemoryAllocationFailure` when the batch capacity is exceeded or the ring
+   * has not enough free space.
+   */
+  Result<void, Error> upload_instances(StagingRingBuffer& staging, std::span<const GpuMeshletInstance> instances);
+
+  /**
+   * @brief Frustum the next `record_update()` culls against, usually the world space frustum of the camera.
+   *
+   */
+  void set_frustum(const Frustum& frustum);
+
+  /**
+   * @brief Camera the meshlets are drawn and cone culled for.
+   *
+   */
+  void set_view(const math::Mat4f& view_projection, const math::Vec3f& eye);
+
+  /**
+   * @brief Records the update of the view and of the indirect command. Must be recorded outside of rendering.
+   *
+   * @param cmd_buff
+   */
+  void record_update(vk::CommandBuffer cmd_buff);
+
+  /**
+   * @brief Binds the pipeline and records the indirect draw of the batches. The viewport and the scissor must be set.
+   *
+   * @param cmd_buff
+   */
+  void record_draw(vk::CommandBuffer cmd_buff);
+
+  const Pipeline& pipeline() const { return pipeline_; }
+  const BufferResource& meshlet_buffer() const { return meshlet_buffer_; }
+  const BufferResource& draw_buffer() const { return draw_buffer_; }
+  uint32_t meshlet_count() const { return meshlet_count_; }
+  uint32_t batch_count() const { return batch_count_; }
+
+ private:
+  /**
+   * @brief Meshlets culled by a task workgroup, std430 layout of the `Batch` in `meshlet_cull.slang`.
+   *
+   */
+  struct Batch {
+    uint32_t world_matrix_index;
+    uint32_t first_meshlet;
+    uint32_t meshlet_count;
+    uint32_t _padding;
+  };
+
+  /**
+   * @brief Uniform buffer of `meshlet_cull.slang`.
+   *
+   */
+  struct ViewParams {
+    math::Mat4f view_projection;
+    std::array<math::Vec4f, Frustum::kPlanes> planes;
+    math::Vec4f eye;
+    uint32_t batch_count;
+
+    /**
+     * @brief Task workgroups in the X dimension, the batches past the `maxTaskWorkGroupCount[0]` wrap to the next row.
+     *
+     */
+    uint32_t batches_per_row;
+    uint32_t _padding[2];
+  };
+
+  Pipeline pipeline_{};
+  DescriptorSetBinder binder_{};
+
+  BufferResource meshlet_buffer_{};
+  BufferResource meshlet_vertex_buffer_{};
+  BufferResource meshlet_triangle_buffer_{};
+  BufferResource batch_buffer_{};
+  BufferResource view_params_buffer_{};
+  BufferResource draw_buffer_{};
+
+  std::vector<Batch> batches_;
+  ViewParams view_params_{};
+  uint32_t max_task_workgroups_x_ = 0;
+
+  uint32_t meshlet_count_          = 0;
+  uint32_t meshlet_vertex_count_   = 0;
+  uint32_t meshlet_triangle_bytes_ = 0;
+  uint32_t batch_count_            = 0;
+  uint32_t max_meshlets_           = 0;
+  uint32_t max_meshlet_vertices_   = 0;
+  uint32_t max_triangle_bytes_     = 0;
+  uint32_t max_batches_            = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image_format_helpers.hpp>
+#include <liberay/vkren/mip_generator.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+Result<MipGenerator, Error> MipGenerator::create(Device& device, vk::ShaderModule downsample_shader) {
+  const auto subgroup = device.physical_device()
+                            .getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>()
+                            .get<vk::PhysicalDeviceSubgroupProperties>();
+  if (!(subgroup.supportedStages & vk::ShaderStageFlagBits::eCompute) ||
+      !(subgroup.supportedOperations & vk::SubgroupFeatureFlagBits::eQuad)) {
+    util::Logger::err("Could not create the mip generator. Subgroup quad operations are not supported in compute");
+    return std::unexpected(Error{
+        .msg  = "Subgroup quad operations are not supported",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
+  auto generator      = MipGenerator(nullptr);
+  generator.p_device_ = &device;
+
+  if (auto buffer = BufferResource::create_gpu_local_buffer(device, kMaxArrayLayers * sizeof(uint32_t),
+                                                            vk::BufferUsageFlagBits::eStorageBuffer)) {
+    generator.counter_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  const auto tile_texels_size = kMaxArrayLayers * kTileSide * kTileSide * sizeof(math::Vec4f);
+  if (auto buffer =
+          BufferResource::create_gpu_local_buffer(device, tile_texels_size, vk::BufferUsageFlagBits::eStorageBuffer)) {
+    generator.tile_texel_buffer_ = std::move(*buffer);
+  } else {
+    return std::unexpected(buffer.error());
+  }
+
+  auto layout = DescriptorSetBuilder::create(device)
+                    .with_binding(vk::DescriptorType::eSampledImage, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute, kMaxLevels - 1)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+                    .build_push_descriptor_layout();
+  if (!layout) {
+    return std::unexpected(layout.error());
+  }
+
+  auto push_constant_ranges = std::array{vk::PushConstantRange{
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .offset     = 0,
+      .size       = sizeof(PushConstants),
+  }};
+  auto pipeline = ComputePipelineBuilder::create()
+                      .with_shader(downsample_shader)
+                      .with_descriptor_set_layout(*layout)
+                      .with_push_constant_ranges(push_constant_ranges)
+                      .build(device);
+  if (!pipeline) {
+    return std::unexpected(pipeline.error());
+  }
+  generator.pipeline_ = std::move(*pipeline);
+  generator.binder_   = DescriptorSetBinder::create(device);
+
+  return generator;
+}
+
+bool MipGenerator::supports(const ImageResource& image) const {
+  const auto& desc = image.description;
+  if (desc.image_type() != vk::ImageType::e2D || image.mip_levels < 2 || image.mip_levels > kMaxLevels ||
+      desc.array_layers > kMaxArrayLayers || helper::is_compressed_format(desc.format)) {
+    return false;
+  }
+  if (!(image.usage & vk::ImageUsageFlagBits::eStorage) || !(image.usage & vk::ImageUsageFlagBits::eSampled)) {
+    return false;
+  }
+
+  // The shader does not declare the format of the levels
+  const auto features = p_device_->physical_device()
+                            .getFormatProperties2<vk::FormatProperties2, vk::FormatProperties3>(desc.format)
+                            .get<vk::FormatProperties3>()
+                            .optimalTilingFeatures;
+  return (features & vk::FormatFeatureFlagBits2::eStorageWriteWithoutFormat) &&
+         (features & vk::FormatFeatureFlagBits2::eSampledImage);
+}
+
+Result<void, Error> MipGenerator::record_generate(vk::CommandBuffer cmd_buff, ImageResource& image) {
+  ERAY_PROFILE_FUNCTION();
+  assert(supports(image) && "The mipmaps of the image cannot be generated by the compute shader");
+
+  const auto layers = image.description.array_layers;
+  auto views        = std::array<vk::ImageView, kMaxLevels>{};
+  for (auto level = 0U; level < image.mip_levels; ++level) {
+    const auto range = vk::ImageSubresourceRange{
+        .aspectMask     = image.aspect,
+        .baseMipLevel   = level,
+        .levelCount     = 1,
+        .baseArrayLayer = 0,
+        .layerCount     = layers,
+    };
+    if (auto view = image.cached_view(vk::ImageViewType::e2DArray, image.description.format, range)) {
+      views[level] = *view;
+    } else {
+      return std::unexpected(view.error());
+    }
+  }
+
+  // The counters and the tile texels might still be used by the previous dispatch. Every dispatch zeroes the counters,
+  // so the generator may be used from any queue without an ownership transfer
+  auto counter_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eClear,
+      .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &counter_barrier,
+  });
+  cmd_buff.fillBuffer(counter_buffer_.vk_buffer(), 0, kMaxArrayLayers * sizeof(uint32_t), 0);
+
+  auto level_range = vk::ImageSubresourceRange{
+      .aspectMask     = image.aspect,
+      .baseMipLevel   = 0,
+      .levelCount     = 1,
+      .baseArrayLayer = 0,
+      .layerCount     = layers,
+  };
+  auto image_barriers = std::array{
+      vk::ImageMemoryBarrier2{
+          .srcStageMask        = vk::PipelineStageFlagBits2::eAllTransfer,
+          .srcAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+          .dstStageMask        = vk::PipelineStageFlagBits2::eComputeShader,
+          .dstAccessMask       = vk::AccessFlagBits2::eShaderSampledRead,
+          .oldLayout           = vk::ImageLayout::eTransferDstOptimal,
+          .newLayout           = vk::ImageLayout::eShaderReadOnlyOptimal,
+          .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+          .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+          .image               = image.vk_image(),
+          .subresourceRange    = level_range,
+      },
+      vk::ImageMemoryBarrier2{
+          .srcStageMask        = vk::PipelineStageFlagBits2::eAllTransfer,
+          .srcAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+          .dstStageMask        = vk::PipelineStageFlagBits2::eComputeShader,
+          .dstAccessMask       = vk::AccessFlagBits2::eShaderStorageWrite,
+          .oldLayout           = vk::ImageLayout::eTransferDstOptimal,
+          .newLayout           = vk::ImageLayout::eGeneral,
+          .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+          .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+          .image               = image.vk_image(),
+          .subresourceRange    = level_range,
+      },
+  };
+  image_barriers[1].subresourceRange.baseMipLevel = 1;
+  image_barriers[1].subresourceRange.levelCount   = image.mip_levels - 1;
+
+  auto clear_barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eClear,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount      = 1,
+      .pMemoryBarriers         = &clear_barrier,
+      .imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers.size()),
+      .pImageMemoryBarriers    = image_barriers.data(),
+  });
+
+  // The array elements past the level count are bound to the last level to keep the binding fully written
+  binder_.clear();
+  binder_.bind_sampled_image(0, views[0], vk::ImageLayout::eShaderReadOnlyOptimal);
+  for (auto level = 1U; level < kMaxLevels; ++level) {
+    binder_.bind_storage_image(1, views[std::min(level, image.mip_levels - 1)], vk::ImageLayout::eGeneral, level - 1);
+  }
+  binder_.bind_buffer(2, counter_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+  binder_.bind_buffer(3, tile_texel_buffer_.desc_buffer_info(), vk::DescriptorType::eStorageBuffer);
+
+  const auto workgroups     = math::Vec2u((image.description.width + kTileSide - 1) / kTileSide,
+                                          (image.description.height + kTileSide - 1) / kTileSide);
+  const auto push_constants = PushConstants{
+      .size            = math::Vec2u(image.description.width, image.description.height),
+      .level_count     = image.mip_levels,
+      .workgroup_count = workgroups.x() * workgroups.y(),
+  };
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline_.pipeline);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, pipeline_.layout);
+  cmd_buff.pushConstants<PushConstants>(pipeline_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants);
+  cmd_buff.dispatch(workgroups.x(), workgroups.y(), layers);
+  p_device_->statistics().count_dispatches();
+
+  auto to_shader_read          = image_barriers[1];
+  to_shader_read.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader;
+  to_shader_read.srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite;
+  to_shader_read.dstStageMask  = vk::PipelineStageFlagBits2::eAllCommands;
+  to_shader_read.dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead;
+  to_shader_read.oldLayout     = vk::ImageLayout::eGeneral;
+  to_shader_read.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .imageMemoryBarrierCount = 1,
+      .pImageMemoryBarriers    = &to_shader_read,
+  });
+
+  return {};
+}
+
+}  // namespace eray::vkren
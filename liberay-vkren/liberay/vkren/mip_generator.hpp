@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Generates the whole mip chain of a texture from its level 0 with a single compute dispatch, instead of a blit
+ * and a layout transition per level. The texels are box filtered, as by the linear blits.
+ *
+ * Every workgroup averages a 64x64 tile down to the levels 1 to 6 and the last workgroup to finish, detected with a
+ * global atomic counter, averages the rest. The shader is `liberay-vkren/shaders/mip_downsample.slang`, compile it
+ * with the `add_slang_shader_target()` of the binary. The device must support the subgroup quad operations in the
+ * compute shaders.
+ *
+ * Any 2D texture whose format supports the storage writes without format is supported, see `supports()`. The textures
+ * created by `ImageResource::create_texture()` get the storage usage when their format allows it. The commands need a
+ * compute queue only, so they may be recorded into the async compute queue, e.g. right after the upload of the
+ * level 0 on the same queue.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class MipGenerator {
+ public:
+  MipGenerator() = delete;
+  explicit MipGenerator(std::nullptr_t) {}
+
+  /**
+   * @brief Workgroup size of the downsample shader, must match the `numthreads` of `mip_downsample.slang`.
+   *
+   */
+  static constexpr uint32_t kWorkgroupSize = 256;
+
+  /**
+   * @brief Side of the tile of the level 0 reduced by a workgroup.
+   *
+   */
+  static constexpr uint32_t kTileSide = 64;
+
+  /**
+   * @brief Maximum number of the levels, the texture may have at most 4096 texels per side.
+   *
+   */
+  static constexpr uint32_t kMaxLevels = 13;
+
+  /**
+   * @brief Maximum number of the array layers, e.g. of a cube map.
+   *
+   */
+  static constexpr uint32_t kMaxArrayLayers = 6;
+
+  /**
+   * @brief Creates the pipeline.
+   *
+   * @param device
+   * @param downsample_shader Module compiled from `mip_downsample.slang`.
+   * @return Result<MipGenerator, Error> Fails with `PhysicalDeviceNotSufficient` when the device does not support the
+   * subgroup quad operations in the compute shaders.
+   */
+  [[nodiscard]] static Result<MipGenerator, Error> create(Device& device, vk::ShaderModule downsample_shader);
+
+  /**
+   * @brief True if the mipmaps of the image can be generated, otherwise use `ImageResource::generate_mipmaps()`.
+   *
+   */
+  bool supports(const ImageResource& image) const;
+
+  /**
+   * @brief Records the generation of the mip chain from the level 0 of all of the layers. `cmd_buff` must be in the
+   * begin state and must be submitted to a queue with the compute support.
+   *
+   * Expects all of the mip levels to be in the VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL layout, like
+   * `ImageResource::generate_mipmaps()`. Leaves the layout in the VK_IMAGE_SHADER_READ_ONLY_OPTIMAL state.
+   *
+   * @param cmd_buff
+   * @param image Must be supported, see `supports()`. The views of its levels are cached by the image.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> record_generate(vk::CommandBuffer cmd_buff, ImageResource& image);
+
+ private:
+  /**
+   * @brief Push constants of `mip_downsample.slang`.
+   *
+   */
+  struct PushConstants {
+    math::Vec2u size;
+    uint32_t level_count;
+    uint32_t workgroup_count;
+  };
+
+  observer_ptr<Device> p_device_ = nullptr;
+
+  Pipeline pipeline_{};
+  DescriptorSetBinder binder_{};
+
+  /**
+   * @brief Number of the finished workgroups of every layer, zeroed before every dispatch.
+   *
+   */
+  BufferResource counter_buffer_{};
+
+  /**
+   * @brief The level 6 texel of every tile, reduced by the last workgroup of the layer.
+   *
+   */
+  BufferResource tile_texel_buffer_{};
+};
+
+}  // namespace eray::vkren
@@ -1,7 +1,13 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <cassert>
 #include <cstdint>
 #include <liberay/vkren/device.hpp>
 #include <liberay/vkren/image_description.hpp>
+#include <liberay/vkren/image_format_helpers.hpp>
 #include <liberay/vkren/offscreen_renderer.hpp>
+#include <liberay/vkren/wait_statistics.hpp>
+#include <utility>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_structs.hpp>
@@ -10,17 +16,19 @@ namespace eray::vkren {
 
 Result<OffscreenFragmentRenderer, Error> OffscreenFragmentRenderer::create(Device& device,
                                                                            const ImageDescription& target_image_desc,
-                                                                           bool blocking) {
+                                                                           bool blocking, size_t target_count) {
+  assert(target_count > 0 && "The offscreen renderer requires at least one target");
   OffscreenFragmentRenderer off_rend{};
-
-  for (auto i = 0U; i < kTargetCount; ++i) {
-    off_rend._p_device = &device;
-    if (auto img_opt = ImageResource::create_attachment_image(device, target_image_desc,
-                                                              vk::ImageUsageFlagBits::eColorAttachment |
-                                                                  vk::ImageUsageFlagBits::eTransferDst |
-                                                                  vk::ImageUsageFlagBits::eSampled,
-                                                              vk::ImageAspectFlagBits::eColor)) {
-      off_rend.targets_[i].img = std::move(*img_opt);
+  off_rend._p_device = &device;
+
+  off_rend.targets_.reserve(target_count);
+  for (auto i = 0U; i < target_count; ++i) {
+    if (auto img_opt = ImageResource::create_attachment_image(
+            device, target_image_desc,
+            vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst |
+                vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eSampled,
+            vk::ImageAspectFlagBits::eColor)) {
+      off_rend.targets_.push_back(TargetInfo{.img = std::move(*img_opt)});
     } else {
       return std::unexpected(img_opt.error());
     }
@@ -31,9 +39,8 @@ Result<OffscreenFragmentRenderer, Error> OffscreenFragmentRenderer::create(Devic
 
   auto buff = device.begin_single_time_commands();
 
-  for (auto i = 0U; i < kTargetCount; ++i) {
-    off_rend.targets_[i].img.transition_layout(buff, vk::ImageLayout::eUndefined,
-                                               vk::ImageLayout::eShaderReadOnlyOptimal);
+  for (auto& target : off_rend.targets_) {
+    target.img.transition_layout(buff, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal);
   }
 
   device.end_single_time_commands(buff);
@@ -89,8 +96,8 @@ Result<OffscreenFragmentRenderer, Error> OffscreenFragmentRenderer::create(Devic
 
   off_rend.render_pass_ = Result(device->createRenderPass(render_pass_info)).or_panic("Render pass creation failed");
 
-  for (auto i = 0U; i < kTargetCount; ++i) {
-    auto attachments = std::array{*off_rend.targets_[i].img_view};
+  for (auto& target : off_rend.targets_) {
+    auto attachments = std::array{*target.img_view};
     auto fb_info     = vk::FramebufferCreateInfo{
             .flags           = {},
             .renderPass      = *off_rend.render_pass_,
@@ -101,14 +108,8 @@ Result<OffscreenFragmentRenderer, Error> OffscreenFragmentRenderer::create(Devic
             .layers          = 1,
     };
 
-    off_rend.targets_[i].framebuffer =
-        Result(device->createFramebuffer(fb_info)).or_panic("Framebuffer creation failed");
+    target.framebuffer = Result(device->createFramebuffer(fb_info)).or_panic("Framebuffer creation failed");
   }
-
-  off_rend.finished_semaphore_ = Result(device->createSemaphore(vk::SemaphoreCreateInfo{}))
-                                     .or_panic("Could not create a semaphore for offscreen rendering");
-  off_rend.finished_fence_ =
-      Result(device->createFence(vk::FenceCreateInfo{})).or_panic("Could not create a fence for offscreen rendering");
   off_rend.blocking = blocking;
 
   auto command_pool_info = vk::CommandPoolCreateInfo{
@@ -120,10 +121,21 @@ Result<OffscreenFragmentRenderer, Error> OffscreenFragmentRenderer::create(Devic
   auto alloc_info = vk::CommandBufferAllocateInfo{
       .commandPool        = off_rend.cmd_pool_,
       .level              = vk::CommandBufferLevel::ePrimary,
-      .commandBufferCount = 1,
+      .commandBufferCount = static_cast<uint32_t>(target_count),
   };
-  off_rend.cmd_buff_ =
-      std::move(Result(device->allocateCommandBuffers(alloc_info)).or_panic("Could not allocate a command buffer")[0]);
+  auto cmd_buffs =
+      Result(device->allocateCommandBuffers(alloc_info)).or_panic("Could not allocate the command buffers");
+
+  // The fences are signaled, so that the first render of a target does not wait
+  const auto fence_info = vk::FenceCreateInfo{.flags = vk::FenceCreateFlagBits::eSignaled};
+  for (auto i = 0U; i < target_count; ++i) {
+    auto& target    = off_rend.targets_[i];
+    target.cmd_buff = std::move(cmd_buffs[i]);
+    target.fence =
+        Result(device->createFence(fence_info)).or_panic("Could not create a fence for offscreen rendering");
+    target.finished_semaphore = Result(device->createSemaphore(vk::SemaphoreCreateInfo{}))
+                                    .or_panic("Could not create a semaphore for offscreen rendering");
+  }
 
   return off_rend;
 }
@@ -223,13 +235,41 @@ void OffscreenFragmentRenderer::init_pipeline(vk::ShaderModule vertex_module, vk
                                                .basePipelineHandle  = nullptr,
                                                .basePipelineIndex   = -1};
 
-  pipeline_ = Result((*_p_device)->createGraphicsPipeline(nullptr, pipeline_info))
+  pipeline_ = Result((*_p_device)->createGraphicsPipeline(_p_device->pipeline_cache(), pipeline_info))
                   .or_panic("Could not create offscreen renderer pipeline");
 }
 
 void OffscreenFragmentRenderer::render_once(vk::DescriptorSet descriptor_set, vk::ClearColorValue clear_color) {
-  cmd_buff_.reset();
-  cmd_buff_.begin(vk::CommandBufferBeginInfo{});
+  record_and_submit(descriptor_set, clear_color, nullptr);
+}
+
+void OffscreenFragmentRenderer::render_once_with_readback(vk::DescriptorSet descriptor_set,
+                                                          ReadbackCallback on_readback,
+                                                          vk::ClearColorValue clear_color) {
+  assert(on_readback && "The readback callback must not be empty");
+  record_and_submit(descriptor_set, clear_color, std::move(on_readback));
+}
+
+void OffscreenFragmentRenderer::record_and_submit(vk::DescriptorSet descriptor_set, vk::ClearColorValue clear_color,
+                                                  ReadbackCallback on_readback) {
+  auto& target = targets_[current_image_];
+
+  // The previous render of the target might still be in flight, its readback is delivered before the buffer is reused
+  wait(target);
+  invoke_readback(target);
+  (*_p_device)->resetFences(*target.fence);
+
+  const auto& desc = target.img.description;
+  if (on_readback && !target.readback_buffer) {
+    const auto size_bytes  = vk::DeviceSize{helper::bytes_per_pixel(desc.format)} * desc.width * desc.height;
+    target.readback_buffer = BufferResource::create_readback_buffer(*_p_device, size_bytes,
+                                                                    vk::BufferUsageFlagBits::eTransferDst)
+                                 .or_panic("Could not create an offscreen renderer readback buffer");
+  }
+
+  auto& cmd_buff = target.cmd_buff;
+  cmd_buff.reset();
+  cmd_buff.begin(vk::CommandBufferBeginInfo{});
 
   // == Change Layout ==================================================================================================
   auto image_barrier = vk::ImageMemoryBarrier2{
@@ -241,7 +281,7 @@ void OffscreenFragmentRenderer::render_once(vk::DescriptorSet descriptor_set, vk
       .newLayout           = vk::ImageLayout::eColorAttachmentOptimal,
       .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
       .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-      .image               = targets_[current_image_].img.vk_image(),
+      .image               = target.img.vk_image(),
       .subresourceRange =
           vk::ImageSubresourceRange{
               .aspectMask     = vk::ImageAspectFlagBits::eColor,
@@ -257,30 +297,31 @@ void OffscreenFragmentRenderer::render_once(vk::DescriptorSet descriptor_set, vk
       .imageMemoryBarrierCount = 1,
       .pImageMemoryBarriers    = &image_barrier,
   };
-  cmd_buff_.pipelineBarrier2(dependency_info);
+  cmd_buff.pipelineBarrier2(dependency_info);
 
   // == Render =========================================================================================================
   std::array<vk::ClearValue, 1> clear_values = {clear_color};
 
   auto rp_begin = vk::RenderPassBeginInfo{
       .renderPass  = *render_pass_,
-      .framebuffer = *targets_[current_image_].framebuffer,
+      .framebuffer = *target.framebuffer,
       .renderArea =
           vk::Rect2D{
               .offset = vk::Offset2D{.x = 0, .y = 0},
-              .extent = vk::Extent2D{.width  = targets_[current_image_].img.description.width,
-                                     .height = targets_[current_image_].img.description.height},
+              .extent = vk::Extent2D{.width  = target.img.description.width,
+                                     .height = target.img.description.height},
           },
       .clearValueCount = static_cast<uint32_t>(clear_values.size()),
       .pClearValues    = clear_values.data(),
   };
 
-  cmd_buff_.setViewport(0, viewport);
-  cmd_buff_.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout_, 0, descriptor_set, nullptr);
-  cmd_buff_.beginRenderPass(rp_begin, vk::SubpassContents::eInline);
-  cmd_buff_.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline_);
-  cmd_buff_.draw(3, 1, 0, 0);
-  cmd_buff_.endRenderPass();
+  cmd_buff.setViewport(0, viewport);
+  cmd_buff.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout_, 0, descriptor_set, nullptr);
+  cmd_buff.beginRenderPass(rp_begin, vk::SubpassContents::eInline);
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline_);
+  cmd_buff.draw(3, 1, 0, 0);
+  _p_device->statistics().count_draws();
+  cmd_buff.endRenderPass();
 
   // == Change Layout ==================================================================================================
   image_barrier = vk::ImageMemoryBarrier2{
@@ -292,7 +333,7 @@ void OffscreenFragmentRenderer::render_once(vk::DescriptorSet descriptor_set, vk
       .newLayout           = vk::ImageLayout::eShaderReadOnlyOptimal,
       .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
       .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-      .image               = targets_[current_image_].img.vk_image(),
+      .image               = target.img.vk_image(),
       .subresourceRange =
           vk::ImageSubresourceRange{
               .aspectMask     = vk::ImageAspectFlagBits::eColor,
@@ -309,8 +350,53 @@ void OffscreenFragmentRenderer::render_once(vk::DescriptorSet descriptor_set, vk
       .pImageMemoryBarriers    = &image_barrier,
   };
 
-  cmd_buff_.pipelineBarrier2(dependency_info);
-  cmd_buff_.end();
+  if (on_readback) {
+    image_barrier.newLayout     = vk::ImageLayout::eTransferSrcOptimal;
+    image_barrier.dstStageMask  = vk::PipelineStageFlagBits2::eCopy;
+    image_barrier.dstAccessMask = vk::AccessFlagBits2::eTransferRead;
+  }
+  cmd_buff.pipelineBarrier2(dependency_info);
+
+  // == Readback =======================================================================================================
+  if (on_readback) {
+    auto region = vk::BufferImageCopy{
+        .bufferOffset      = 0,
+        .bufferRowLength   = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            vk::ImageSubresourceLayers{
+                .aspectMask     = vk::ImageAspectFlagBits::eColor,
+                .mipLevel       = 0,
+                .baseArrayLayer = 0,
+                .layerCount     = 1,
+            },
+        .imageOffset = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+        .imageExtent = vk::Extent3D{.width = desc.width, .height = desc.height, .depth = 1},
+    };
+    cmd_buff.copyImageToBuffer(target.img.vk_image(), vk::ImageLayout::eTransferSrcOptimal,
+                               target.readback_buffer->buffer.vk_buffer(), region);
+
+    image_barrier.srcStageMask  = vk::PipelineStageFlagBits2::eCopy;
+    image_barrier.srcAccessMask = vk::AccessFlagBits2::eTransferRead;
+    image_barrier.dstStageMask  = vk::PipelineStageFlagBits2::eFragmentShader;
+    image_barrier.dstAccessMask = vk::AccessFlagBits2::eShaderRead;
+    image_barrier.oldLayout     = vk::ImageLayout::eTransferSrcOptimal;
+    image_barrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+    auto host_barrier = vk::MemoryBarrier2{
+        .srcStageMask  = vk::PipelineStageFlagBits2::eCopy,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask  = vk::PipelineStageFlagBits2::eHost,
+        .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+    };
+    cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+        .memoryBarrierCount      = 1,
+        .pMemoryBarriers         = &host_barrier,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers    = &image_barrier,
+    });
+  }
+  cmd_buff.end();
 
   // == Submit =========================================================================================================
   auto submit_info = vk::SubmitInfo{
@@ -318,30 +404,84 @@ void OffscreenFragmentRenderer::render_once(vk::DescriptorSet descriptor_set, vk
       .pWaitSemaphores      = nullptr,
       .pWaitDstStageMask    = nullptr,
       .commandBufferCount   = 1,
-      .pCommandBuffers      = &*cmd_buff_,
+      .pCommandBuffers      = &*cmd_buff,
       .signalSemaphoreCount = 0,
       .pSignalSemaphores    = nullptr,
   };
 
+  if (!blocking) {
+    submit_info.pSignalSemaphores    = &*target.finished_semaphore;
+    submit_info.signalSemaphoreCount = 1;
+  }
+  target.on_readback = std::move(on_readback);
+  _p_device->graphics_queue().submit(submit_info, *target.fence);
+
   if (blocking) {
-    (*_p_device)->resetFences(*finished_fence_);
-    _p_device->graphics_queue().submit(submit_info, *finished_fence_);
-    while (vk::Result::eTimeout == (*_p_device)->waitForFences(*finished_fence_, vk::True, UINT64_MAX)) {
-      ;
+    wait(target);
+    invoke_readback(target);
+  }
+
+  current_image_ = (current_image_ + 1) % target_count();
+}
+
+void OffscreenFragmentRenderer::poll() {
+  for (auto& target : targets_) {
+    if (target.on_readback && is_complete(target)) {
+      invoke_readback(target);
     }
-  } else {
-    submit_info.pSignalSemaphores    = &*finished_semaphore_;
-    submit_info.signalSemaphoreCount = 1;
-    _p_device->graphics_queue().submit(submit_info);
   }
+}
+
+void OffscreenFragmentRenderer::wait_idle() {
+  for (auto& target : targets_) {
+    wait(target);
+    invoke_readback(target);
+  }
+}
+
+size_t OffscreenFragmentRenderer::in_flight_count() const {
+  auto count = size_t{0};
+  for (const auto& target : targets_) {
+    if (!is_complete(target)) {
+      ++count;
+    }
+  }
+  return count;
+}
 
-  current_image_ = (current_image_ + 1) % kTargetCount;
+bool OffscreenFragmentRenderer::is_complete(const TargetInfo& target) const {
+  return (*_p_device)->waitForFences(*target.fence, vk::True, 0) == vk::Result::eSuccess;
+}
+
+void OffscreenFragmentRenderer::wait(const TargetInfo& target) const {
+  const auto wait = WaitScope(_p_device->wait_statistics(), "Offscreen target fence", WaitKind::Stall);
+  while (vk::Result::eTimeout == (*_p_device)->waitForFences(*target.fence, vk::True, UINT64_MAX)) {
+    ;
+  }
+}
+
+void OffscreenFragmentRenderer::invoke_readback(TargetInfo& target) {
+  if (!target.on_readback) {
+    return;
+  }
+
+  // The memory might not be host coherent
+  const auto& buffer = target.readback_buffer->buffer;
+  vmaInvalidateAllocation(_p_device->vma_alloc_manager().allocator(), buffer._buffer._allocation, 0,
+                          buffer.size_bytes);
+
+  // The callback is cleared first, so that it is able to request another render
+  auto on_readback = std::exchange(target.on_readback, nullptr);
+  on_readback(util::MemoryRegion(target.readback_buffer->mapped_data, buffer.size_bytes));
 }
 
 void OffscreenFragmentRenderer::clear(vk::ClearColorValue clear_value) {
+  // The clear is not ordered after the renders in flight by the single time commands
+  wait_idle();
+
   auto cmd = _p_device->begin_single_time_commands();
-  for (auto i = 0U; i < kTargetCount; ++i) {
-    targets_[i].img.transition_layout(cmd, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eGeneral);
+  for (auto& target : targets_) {
+    target.img.transition_layout(cmd, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eGeneral);
     vk::ImageSubresourceRange range{
         .aspectMask     = vk::ImageAspectFlagBits::eColor,
         .baseMipLevel   = 0,
@@ -349,8 +489,8 @@ void OffscreenFragmentRenderer::clear(vk::ClearColorValue clear_value) {
         .baseArrayLayer = 0,
         .layerCount     = 1,
     };
-    cmd.clearColorImage(targets_[i].img.vk_image(), vk::ImageLayout::eGeneral, clear_value, range);
-    targets_[i].img.transition_layout(cmd, vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal);
+    cmd.clearColorImage(target.img.vk_image(), vk::ImageLayout::eGeneral, clear_value, range);
+    target.img.transition_layout(cmd, vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal);
   }
   _p_device->end_single_time_commands(cmd);
 }
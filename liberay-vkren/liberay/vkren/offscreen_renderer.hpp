@@ -1,8 +1,13 @@
 #pragma once
 
+#include <functional>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/vkren/buffer.hpp>
 #include <liberay/vkren/common.hpp>
 #include <liberay/vkren/image.hpp>
 #include <liberay/vkren/image_description.hpp>
+#include <optional>
+#include <vector>
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include <vulkan/vulkan_structs.hpp>
@@ -12,30 +17,52 @@ namespace eray::vkren {
 /**
  * @brief Allows for single time rendering to an image.
  *
+ * The renders cycle through the targets. Every target has its own command buffer and fence, so up to
+ * `target_count()` renders are in flight when the renderer is not blocking, and a render waits only for the previous
+ * render of the same target. The results may be read back asynchronously, see `render_once_with_readback()`.
+ *
  */
 struct OffscreenFragmentRenderer {
+  /**
+   * @brief Receives the tightly packed texels of the rendered target, valid only during the call.
+   *
+   */
+  using ReadbackCallback = std::function<void(const util::MemoryRegion&)>;
+
   struct TargetInfo {
     ImageResource img;
-    vk::raii::ImageView img_view      = nullptr;
-    vk::raii::Framebuffer framebuffer = nullptr;
+    vk::raii::ImageView img_view           = nullptr;
+    vk::raii::Framebuffer framebuffer      = nullptr;
+    vk::raii::CommandBuffer cmd_buff       = nullptr;
+    vk::raii::Fence fence                  = nullptr;
+    vk::raii::Semaphore finished_semaphore = nullptr;
+    std::optional<PersistentlyMappedBufferResource> readback_buffer;
+    ReadbackCallback on_readback;
   };
-  static constexpr size_t kTargetCount = 2;
-  std::array<TargetInfo, kTargetCount> targets_;
+  static constexpr size_t kDefaultTargetCount = 2;
+  std::vector<TargetInfo> targets_;
   size_t current_image_;
 
   vk::raii::RenderPass render_pass_         = nullptr;
   vk::raii::CommandPool cmd_pool_           = nullptr;
-  vk::raii::CommandBuffer cmd_buff_         = nullptr;
   vk::raii::Pipeline pipeline_              = nullptr;
   vk::raii::PipelineLayout pipeline_layout_ = nullptr;
-  vk::raii::Semaphore finished_semaphore_   = nullptr;
-  vk::raii::Fence finished_fence_           = nullptr;
-  observer_ptr<const Device> _p_device      = nullptr;
+  observer_ptr<Device> _p_device            = nullptr;
   bool blocking{true};
   vk::Viewport viewport{};
 
+  /**
+   * @brief Creates the renderer.
+   *
+   * @param device
+   * @param target_image_desc
+   * @param blocking Wait for every render to finish.
+   * @param target_count Maximum number of the renders in flight, at least 1.
+   * @return Result<OffscreenFragmentRenderer, Error>
+   */
   static Result<OffscreenFragmentRenderer, Error> create(Device& device, const ImageDescription& target_image_desc,
-                                                         bool blocking = true);
+                                                         bool blocking = true,
+                                                         size_t target_count = kDefaultTargetCount);
 
   // TODO(migoox): generate the vertex_module bytecode
   void init_pipeline(vk::ShaderModule vertex_module, vk::ShaderModule fragment_module,
@@ -43,24 +70,73 @@ struct OffscreenFragmentRenderer {
 
   vk::Image target_image() const { return targets_[current_image_].img.vk_image(); }
   vk::ImageView target_image() { return targets_[current_image_].img_view; }
-  vk::ImageView back_image() { return targets_[(current_image_ + 1) % kTargetCount].img_view; }
-  vk::ImageView image(size_t i) { return targets_[i % kTargetCount].img_view; }
+
+  /**
+   * @brief View of the target of the last render.
+   *
+   */
+  vk::ImageView back_image() { return targets_[(current_image_ + target_count() - 1) % target_count()].img_view; }
+  vk::ImageView image(size_t i) { return targets_[i % target_count()].img_view; }
 
   size_t current_image_ind() const { return current_image_; }
-  size_t next_image_ind() const { return (current_image_ + 1) % kTargetCount; }
+  size_t next_image_ind() const { return (current_image_ + 1) % target_count(); }
+  size_t target_count() const { return targets_.size(); }
 
   void set_viewport(int x, int y, int width, int height);
 
   /**
-   * @brief Expects the target image to be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL. After execution, this image is in
-   * the  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+   * @brief Renders to the current target and makes the next one current. Waits for the previous render of the target
+   * first, also when the renderer is not blocking. The target image is in the VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+   * layout before and after the render.
    *
    * @param descriptor_set
    */
   void render_once(vk::DescriptorSet descriptor_set, vk::ClearColorValue = {1.F, 1.F, 1.F, 1.F});
+
+  /**
+   * @brief `render_once()` followed by a copy of the target to its readback buffer. The `on_readback` is invoked by
+   * `poll()` once the render completes, or right away when the renderer is blocking.
+   *
+   * @param descriptor_set
+   * @param on_readback
+   */
+  void render_once_with_readback(vk::DescriptorSet descriptor_set, ReadbackCallback on_readback,
+                                 vk::ClearColorValue = {1.F, 1.F, 1.F, 1.F});
+
+  /**
+   * @brief Invokes the readback callbacks of the completed renders, never blocks.
+   *
+   */
+  void poll();
+
+  /**
+   * @brief Blocks the CPU until all of the renders complete and invokes their readback callbacks.
+   *
+   */
+  void wait_idle();
+
+  /**
+   * @brief Number of the submitted renders that have not completed yet.
+   *
+   */
+  size_t in_flight_count() const;
+
   void clear(vk::ClearColorValue = {1.F, 1.F, 1.F, 1.F});
 
-  vk::Semaphore finished_semaphore() const { return finished_semaphore_; }
+  /**
+   * @brief Semaphore signaled by the last render when the renderer is not blocking.
+   *
+   */
+  vk::Semaphore finished_semaphore() const {
+    return targets_[(current_image_ + target_count() - 1) % target_count()].finished_semaphore;
+  }
+
+ private:
+  void record_and_submit(vk::DescriptorSet descriptor_set, vk::ClearColorValue clear_color,
+                         ReadbackCallback on_readback);
+  bool is_complete(const TargetInfo& target) const;
+  void wait(const TargetInfo& target) const;
+  void invoke_readback(TargetInfo& target);
 };
 
 }  // namespace eray::vkren
@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <array>
+#include <liberay/util/hash_combine.hpp>
 #include <liberay/vkren/error.hpp>
 #include <liberay/vkren/pipeline.hpp>
 #include <liberay/vkren/render_graph.hpp>
 #include <liberay/vkren/swap_chain.hpp>
+#include <type_traits>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_raii.hpp>
@@ -9,6 +13,142 @@
 
 namespace eray::vkren {
 
+namespace {
+
+/**
+ * @brief The pipelines must be created with VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT to use the layouts created for
+ * the descriptor buffers.
+ *
+ */
+vk::PipelineCreateFlags descriptor_backend_flags(const Device& device) {
+  return device.descriptor_backend() == DescriptorBackend::DescriptorBuffer
+             ? vk::PipelineCreateFlags{vk::PipelineCreateFlagBits::eDescriptorBufferEXT}
+             : vk::PipelineCreateFlags{};
+}
+
+/**
+ * @brief The pipelines drawn in a pass with a shading rate image must be created with
+ * VK_PIPELINE_CREATE_RENDERING_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR, see
+ * `RenderPassBuilder::with_shading_rate_image()`.
+ *
+ */
+vk::PipelineCreateFlags shading_rate_flags(bool shading_rate_attachment) {
+  return shading_rate_attachment
+             ? vk::PipelineCreateFlags{vk::PipelineCreateFlagBits::eRenderingFragmentShadingRateAttachmentKHR}
+             : vk::PipelineCreateFlags{};
+}
+
+/**
+ * @brief The rate of the attachment replaces the full rate of the pipeline, without the state the attachment would be
+ * ignored.
+ *
+ */
+vk::PipelineFragmentShadingRateStateCreateInfoKHR shading_rate_state() {
+  return vk::PipelineFragmentShadingRateStateCreateInfoKHR{
+      .fragmentSize = vk::Extent2D{.width = 1, .height = 1},
+      .combinerOps  = std::array{vk::FragmentShadingRateCombinerOpKHR::eKeep,
+                                 vk::FragmentShadingRateCombinerOpKHR::eReplace},
+  };
+}
+
+/**
+ * @brief Creates the pipeline with the pipeline cache of the device and counts the cache hit reported by the creation
+ * feedback, see `FrameStatistics::count_pipeline()`. The pipeline is named if the name is not empty.
+ *
+ */
+template <typename TCreateInfo>
+auto create_pipeline(const Device& device, TCreateInfo pipeline_info, util::zstring_view name = "") {
+  auto feedback      = vk::PipelineCreationFeedback{};
+  auto feedback_info = vk::PipelineCreationFeedbackCreateInfo{
+      .pNext                     = pipeline_info.pNext,
+      .pPipelineCreationFeedback = &feedback,
+  };
+  pipeline_info.pNext = &feedback_info;
+
+  auto result = [&]() {
+    if constexpr (std::is_same_v<TCreateInfo, vk::ComputePipelineCreateInfo>) {
+      return device->createComputePipeline(device.pipeline_cache(), pipeline_info);
+    } else {
+      return device->createGraphicsPipeline(device.pipeline_cache(), pipeline_info);
+    }
+  }();
+  if (result) {
+    device.statistics().count_pipeline(feedback);
+    if (!name.empty()) {
+      device.set_object_name(**result, name);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+bool SpecializationConstants::operator==(const SpecializationConstants& other) const {
+  if (entries.size() != other.entries.size()) {
+    return false;
+  }
+
+  return std::ranges::all_of(entries, [this, &other](const vk::SpecializationMapEntry& entry) {
+    auto it = std::ranges::find(other.entries, entry.constantID, &vk::SpecializationMapEntry::constantID);
+    return it != other.entries.end() && it->size == entry.size &&
+           std::equal(data.begin() + entry.offset, data.begin() + entry.offset + entry.size,
+                      other.data.begin() + it->offset);
+  });
+}
+
+size_t SpecializationConstants::Hash::operator()(const SpecializationConstants& constants) const {
+  // The entry hashes are summed, so the hash does not depend on the order in which the constants were set
+  auto result = std::hash<size_t>()(constants.entries.size());
+  for (const auto& entry : constants.entries) {
+    auto entry_hash = std::hash<uint32_t>()(entry.constantID);
+    for (auto i = 0U; i < entry.size; ++i) {
+      util::hash_combine(entry_hash, constants.data[entry.offset + i]);
+    }
+    result += entry_hash;
+  }
+
+  return result;
+}
+
+void GraphicsDynamicState::record(vk::CommandBuffer cmd_buff) const {
+  if (cull_mode) {
+    cmd_buff.setCullMode(*cull_mode);
+  }
+  if (front_face) {
+    cmd_buff.setFrontFace(*front_face);
+  }
+  if (topology) {
+    cmd_buff.setPrimitiveTopology(*topology);
+  }
+  if (depth_test) {
+    cmd_buff.setDepthTestEnable(*depth_test ? vk::True : vk::False);
+  }
+  if (depth_write) {
+    cmd_buff.setDepthWriteEnable(*depth_write ? vk::True : vk::False);
+  }
+  if (depth_compare_op) {
+    cmd_buff.setDepthCompareOp(*depth_compare_op);
+  }
+  if (depth_bias) {
+    cmd_buff.setDepthBiasEnable(*depth_bias ? vk::True : vk::False);
+  }
+  if (primitive_restart) {
+    cmd_buff.setPrimitiveRestartEnable(*primitive_restart ? vk::True : vk::False);
+  }
+  if (polygon_mode) {
+    cmd_buff.setPolygonModeEXT(*polygon_mode);
+  }
+  if (!blend_enables.empty()) {
+    cmd_buff.setColorBlendEnableEXT(0, blend_enables);
+  }
+  if (!blend_equations.empty()) {
+    cmd_buff.setColorBlendEquationEXT(0, blend_equations);
+  }
+  if (!color_write_masks.empty()) {
+    cmd_buff.setColorWriteMaskEXT(0, color_write_masks);
+  }
+}
+
 GraphicsPipelineBuilder::GraphicsPipelineBuilder(const RenderGraph& render_graph, RenderPassHandle rp_handle) {
   init();
 
@@ -19,10 +159,21 @@ GraphicsPipelineBuilder::GraphicsPipelineBuilder(const RenderGraph& render_graph
     _multisampling.rasterizationSamples = rp.samples;
   }
 
-  _color_attachment_formats.reserve(rp.color_attachments.size());
-  for (const auto& ca : rp.color_attachments) {
-    _color_attachment_formats.push_back(render_graph.attachment(ca.handle).img.description.format);
-    _rg_attachment_handle_to_rp_attachment_ind.emplace(ca.handle.index(),
+  // The passes merged into a rendering scope are drawn with the attachments of the whole scope
+  const auto* scope  = render_graph.rendering_scope(rp);
+  auto color_handles = util::InplaceVector<RenderPassAttachmentHandle, RenderPass::kMaxColorAttachments>();
+  if (scope != nullptr) {
+    color_handles = scope->color_attachments;
+  } else {
+    for (const auto& ca : rp.color_attachments) {
+      color_handles.push_back(ca.handle);
+    }
+  }
+
+  _color_attachment_formats.reserve(color_handles.size());
+  for (auto handle : color_handles) {
+    _color_attachment_formats.push_back(render_graph.attachment(handle).img.description.format);
+    _rg_attachment_handle_to_rp_attachment_ind.emplace(handle.index(),
                                                        static_cast<uint32_t>(_color_attachment_formats.size() - 1));
     _color_blends.emplace_back(vk::PipelineColorBlendAttachmentState{
         .blendEnable         = vk::False,
@@ -47,6 +198,52 @@ GraphicsPipelineBuilder::GraphicsPipelineBuilder(const RenderGraph& render_graph
     _depth_format   = render_graph.attachment(rp.depth_stencil_attachment->handle).img.description.format;
     _stencil_format = render_graph.attachment(rp.depth_stencil_attachment->handle).img.description.format;
   }
+  shading_rate_attachment = rp.shading_rate_image.has_value();
+  _view_mask              = rp.view_mask;
+
+  if (scope != nullptr) {
+    _depth_format   = std::nullopt;
+    _stencil_format = std::nullopt;
+    if (scope->depth_attachment) {
+      _depth_format = render_graph.attachment(*scope->depth_attachment).img.description.format;
+      if (scope->depth_attachment->type() == ImageAttachmentType::DepthStencil) {
+        _stencil_format = _depth_format;
+      }
+    }
+    if (scope->stencil_attachment) {
+      _stencil_format = render_graph.attachment(*scope->stencil_attachment).img.description.format;
+    }
+
+    rendering_scope    = true;
+    auto locations     = scope->color_attachment_locations(rp);
+    auto input_indices = scope->color_attachment_input_indices(rp);
+    _color_attachment_locations.assign(locations.begin(), locations.end());
+    _color_attachment_input_indices.assign(input_indices.begin(), input_indices.end());
+    _depth_input_index   = scope->depth_input_index(rp);
+    _stencil_input_index = scope->stencil_input_index(rp);
+  }
+}
+
+void GraphicsPipelineBuilder::chain_rendering_scope_state(vk::PipelineRenderingCreateInfo& rendering_info,
+                                                          vk::RenderingAttachmentLocationInfo& locations,
+                                                          vk::RenderingInputAttachmentIndexInfo& input_indices) const {
+  if (!rendering_scope) {
+    return;
+  }
+
+  locations = vk::RenderingAttachmentLocationInfo{
+      .pNext                     = rendering_info.pNext,
+      .colorAttachmentCount      = static_cast<uint32_t>(_color_attachment_locations.size()),
+      .pColorAttachmentLocations = _color_attachment_locations.data(),
+  };
+  input_indices = vk::RenderingInputAttachmentIndexInfo{
+      .pNext                        = &locations,
+      .colorAttachmentCount         = static_cast<uint32_t>(_color_attachment_input_indices.size()),
+      .pColorAttachmentInputIndices = _color_attachment_input_indices.data(),
+      .pDepthInputAttachmentIndex   = &_depth_input_index,
+      .pStencilInputAttachmentIndex = &_stencil_input_index,
+  };
+  rendering_info.pNext = &input_indices;
 }
 
 GraphicsPipelineBuilder::GraphicsPipelineBuilder(const SwapChain& swap_chain) {
@@ -180,6 +377,37 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_tessellation_stage(
   return *this;
 }
 
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_mesh_shaders(vk::ShaderModule task_shader,
+                                                                    vk::ShaderModule mesh_shader,
+                                                                    vk::ShaderModule fragment_shader,
+                                                                    util::zstring_view task_shader_entry_point,
+                                                                    util::zstring_view mesh_shader_entry_point,
+                                                                    util::zstring_view fragment_shader_entry_point) {
+  if (task_shader) {
+    _shader_stages.push_back(vk::PipelineShaderStageCreateInfo{
+        .stage  = vk::ShaderStageFlagBits::eTaskEXT,
+        .module = task_shader,
+        .pName  = task_shader_entry_point.empty() ? kDefaultTaskShaderEntryPoint.c_str()
+                                                  : task_shader_entry_point.c_str(),
+    });
+  }
+  _shader_stages.push_back(vk::PipelineShaderStageCreateInfo{
+      .stage  = vk::ShaderStageFlagBits::eMeshEXT,
+      .module = mesh_shader,
+      .pName  = mesh_shader_entry_point.empty() ? kDefaultMeshShaderEntryPoint.c_str()
+                                                : mesh_shader_entry_point.c_str(),
+  });
+  _shader_stages.push_back(vk::PipelineShaderStageCreateInfo{
+      .stage  = vk::ShaderStageFlagBits::eFragment,
+      .module = fragment_shader,
+      .pName  = fragment_shader_entry_point.empty() ? kDefaultFragmentShaderEntryPoint.c_str()
+                                                    : fragment_shader_entry_point.c_str(),
+  });
+  mesh_stage = true;
+
+  return *this;
+}
+
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_tessellation_domain_origin(
     vk::TessellationDomainOrigin domain_origin) {
   _tess_domain_origin.domainOrigin = domain_origin;
@@ -190,6 +418,7 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_tessellation_domain_origi
 Result<Pipeline, Error> GraphicsPipelineBuilder::build(const Device& device) {
   // == Shader stage ===================================================================================================
   assert(!_shader_stages.empty() && "Shader stages must be provided");
+  update_internal_pointers();
 
   // == Dynamic states =================================================================================================
 
@@ -199,20 +428,16 @@ Result<Pipeline, Error> GraphicsPipelineBuilder::build(const Device& device) {
   // Note: This will cause the configuration of these values to be ignored, and you will be able (and required)
   // to specify the data at drawing time.
 
-  auto dynamic_states = std::vector{
-      vk::DynamicState::eViewport,
-      vk::DynamicState::eScissor,
-  };
-
   auto dynamic_state = vk::PipelineDynamicStateCreateInfo{
-      .dynamicStateCount = static_cast<uint32_t>(dynamic_states.size()),  //
-      .pDynamicStates    = dynamic_states.data(),                         //
+      .dynamicStateCount = static_cast<uint32_t>(_dynamic_states.size()),  //
+      .pDynamicStates    = _dynamic_states.data(),                         //
   };
 
   // With dynamic state only the count is necessary.
 
   // == Input assembly =================================================================================================
   vk::PipelineRenderingCreateInfo pipeline_rendering_create_info{
+      .viewMask                = _view_mask,
       .colorAttachmentCount    = static_cast<uint32_t>(_color_attachment_formats.size()),
       .pColorAttachmentFormats = _color_attachment_formats.data(),
   };
@@ -222,6 +447,13 @@ Result<Pipeline, Error> GraphicsPipelineBuilder::build(const Device& device) {
   if (_stencil_format) {
     pipeline_rendering_create_info.stencilAttachmentFormat = *_stencil_format;
   }
+  auto shading_rate_info = shading_rate_state();
+  if (shading_rate_attachment) {
+    pipeline_rendering_create_info.pNext = &shading_rate_info;
+  }
+  auto attachment_locations     = vk::RenderingAttachmentLocationInfo{};
+  auto input_attachment_indices = vk::RenderingInputAttachmentIndexInfo{};
+  chain_rendering_scope_state(pipeline_rendering_create_info, attachment_locations, input_attachment_indices);
 
   auto color_blending_info = vk::PipelineColorBlendStateCreateInfo{
       .logicOpEnable   = vk::False,
@@ -234,10 +466,11 @@ Result<Pipeline, Error> GraphicsPipelineBuilder::build(const Device& device) {
       .and_then([&](vk::raii::PipelineLayout&& layout) {
         auto pipeline_info = vk::GraphicsPipelineCreateInfo{
             .pNext               = &pipeline_rendering_create_info,
+            .flags               = descriptor_backend_flags(device) | shading_rate_flags(shading_rate_attachment),
             .stageCount          = static_cast<uint32_t>(_shader_stages.size()),
             .pStages             = _shader_stages.data(),
-            .pVertexInputState   = &_vertex_input_state,
-            .pInputAssemblyState = &_input_assembly,
+            .pVertexInputState   = mesh_stage ? nullptr : &_vertex_input_state,
+            .pInputAssemblyState = mesh_stage ? nullptr : &_input_assembly,
             .pTessellationState  = tess_stage ? &_tess_stage : nullptr,
             .pViewportState      = &_viewport_state,
             .pRasterizationState = &_rasterizer,
@@ -251,7 +484,7 @@ Result<Pipeline, Error> GraphicsPipelineBuilder::build(const Device& device) {
             .basePipelineIndex   = -1,
         };
 
-        return device->createGraphicsPipeline(nullptr, pipeline_info)
+        return create_pipeline(device, pipeline_info, _name)
             .transform([l = std::move(layout)](vk::raii::Pipeline&& p) mutable {
               return Pipeline{
                   .pipeline = std::move(p),
@@ -271,6 +504,7 @@ Result<Pipeline, Error> GraphicsPipelineBuilder::build(const Device& device) {
 Result<vk::raii::Pipeline, Error> GraphicsPipelineBuilder::build(const Device& device, vk::PipelineLayout layout) {
   // == Shader stage ===================================================================================================
   assert(!_shader_stages.empty() && "Shader stages must be provided");
+  update_internal_pointers();
 
   // == Dynamic states =================================================================================================
 
@@ -280,20 +514,16 @@ Result<vk::raii::Pipeline, Error> GraphicsPipelineBuilder::build(const Device& d
   // Note: This will cause the configuration of these values to be ignored, and you will be able (and required)
   // to specify the data at drawing time.
 
-  auto dynamic_states = std::vector{
-      vk::DynamicState::eViewport,
-      vk::DynamicState::eScissor,
-  };
-
   auto dynamic_state = vk::PipelineDynamicStateCreateInfo{
-      .dynamicStateCount = static_cast<uint32_t>(dynamic_states.size()),
-      .pDynamicStates    = dynamic_states.data(),
+      .dynamicStateCount = static_cast<uint32_t>(_dynamic_states.size()),
+      .pDynamicStates    = _dynamic_states.data(),
   };
 
   // With dynamic state only the count is necessary.
 
   // == Input assembly =================================================================================================
   vk::PipelineRenderingCreateInfo pipeline_rendering_create_info{
+      .viewMask                = _view_mask,
       .colorAttachmentCount    = static_cast<uint32_t>(_color_attachment_formats.size()),
       .pColorAttachmentFormats = _color_attachment_formats.data(),
   };
@@ -303,6 +533,13 @@ Result<vk::raii::Pipeline, Error> GraphicsPipelineBuilder::build(const Device& d
   if (_stencil_format) {
     pipeline_rendering_create_info.stencilAttachmentFormat = *_stencil_format;
   }
+  auto shading_rate_info = shading_rate_state();
+  if (shading_rate_attachment) {
+    pipeline_rendering_create_info.pNext = &shading_rate_info;
+  }
+  auto attachment_locations     = vk::RenderingAttachmentLocationInfo{};
+  auto input_attachment_indices = vk::RenderingInputAttachmentIndexInfo{};
+  chain_rendering_scope_state(pipeline_rendering_create_info, attachment_locations, input_attachment_indices);
 
   auto color_blending_info = vk::PipelineColorBlendStateCreateInfo{
       .logicOpEnable   = vk::False,
@@ -313,10 +550,11 @@ Result<vk::raii::Pipeline, Error> GraphicsPipelineBuilder::build(const Device& d
 
   auto pipeline_info = vk::GraphicsPipelineCreateInfo{
       .pNext               = &pipeline_rendering_create_info,
+      .flags               = descriptor_backend_flags(device) | shading_rate_flags(shading_rate_attachment),
       .stageCount          = static_cast<uint32_t>(_shader_stages.size()),
       .pStages             = _shader_stages.data(),
-      .pVertexInputState   = &_vertex_input_state,
-      .pInputAssemblyState = &_input_assembly,
+      .pVertexInputState   = mesh_stage ? nullptr : &_vertex_input_state,
+      .pInputAssemblyState = mesh_stage ? nullptr : &_input_assembly,
       .pTessellationState  = tess_stage ? &_tess_stage : nullptr,
       .pViewportState      = &_viewport_state,
       .pRasterizationState = &_rasterizer,
@@ -330,7 +568,7 @@ Result<vk::raii::Pipeline, Error> GraphicsPipelineBuilder::build(const Device& d
       .basePipelineIndex   = -1,
   };
 
-  return device->createGraphicsPipeline(nullptr, pipeline_info).transform_error([](auto err) {
+  return create_pipeline(device, pipeline_info, _name).transform_error([](auto err) {
     return Error{
         .msg     = "Graphics Pipeline creation failure",
         .code    = ErrorCode::VulkanObjectCreationFailure{},
@@ -339,6 +577,289 @@ Result<vk::raii::Pipeline, Error> GraphicsPipelineBuilder::build(const Device& d
   });
 }
 
+void GraphicsPipelineBuilder::update_internal_pointers() {
+  if (_tess_stage.pNext != nullptr) {
+    _tess_stage.pNext = &_tess_domain_origin;
+  }
+
+  _specialization_info = _specialization.info();
+  for (auto& stage : _shader_stages) {
+    stage.pSpecializationInfo = _specialization.empty() ? nullptr : &_specialization_info;
+  }
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_specialization_constants(SpecializationConstants constants) {
+  _specialization = std::move(constants);
+  return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_name(std::string name) {
+  _name = std::move(name);
+  return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_dynamic_states(std::span<const vk::DynamicState> states) {
+  for (auto state : states) {
+    with_dynamic_state(state);
+  }
+  return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_dynamic_state(vk::DynamicState state) {
+  if (!is_dynamic(state)) {
+    _dynamic_states.push_back(state);
+  }
+  return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_extended_dynamic_state(const Device& device) {
+  static constexpr auto kCoreStates = std::array{
+      vk::DynamicState::eCullMode,
+      vk::DynamicState::eFrontFace,
+      vk::DynamicState::ePrimitiveTopology,
+      vk::DynamicState::eDepthTestEnable,
+      vk::DynamicState::eDepthWriteEnable,
+      vk::DynamicState::eDepthCompareOp,
+      vk::DynamicState::eDepthBiasEnable,
+      vk::DynamicState::ePrimitiveRestartEnable,
+  };
+  with_dynamic_states(kCoreStates);
+
+  const auto& eds3 = device.extended_dynamic_state3_features();
+  if (eds3.extendedDynamicState3PolygonMode) {
+    with_dynamic_state(vk::DynamicState::ePolygonModeEXT);
+  }
+  if (eds3.extendedDynamicState3ColorBlendEnable) {
+    with_dynamic_state(vk::DynamicState::eColorBlendEnableEXT);
+  }
+  if (eds3.extendedDynamicState3ColorBlendEquation) {
+    with_dynamic_state(vk::DynamicState::eColorBlendEquationEXT);
+  }
+  if (eds3.extendedDynamicState3ColorWriteMask) {
+    with_dynamic_state(vk::DynamicState::eColorWriteMaskEXT);
+  }
+  return *this;
+}
+
+bool GraphicsPipelineBuilder::is_dynamic(vk::DynamicState state) const {
+  return std::ranges::find(_dynamic_states, state) != _dynamic_states.end();
+}
+
+GraphicsDynamicState GraphicsPipelineBuilder::dynamic_state() const {
+  auto state = GraphicsDynamicState{};
+  if (is_dynamic(vk::DynamicState::eCullMode)) {
+    state.cull_mode = _rasterizer.cullMode;
+  }
+  if (is_dynamic(vk::DynamicState::eFrontFace)) {
+    state.front_face = _rasterizer.frontFace;
+  }
+  if (is_dynamic(vk::DynamicState::ePrimitiveTopology)) {
+    state.topology = _input_assembly.topology;
+  }
+  if (is_dynamic(vk::DynamicState::eDepthTestEnable)) {
+    state.depth_test = _depth_stencil.depthTestEnable == vk::True;
+  }
+  if (is_dynamic(vk::DynamicState::eDepthWriteEnable)) {
+    state.depth_write = _depth_stencil.depthWriteEnable == vk::True;
+  }
+  if (is_dynamic(vk::DynamicState::eDepthCompareOp)) {
+    state.depth_compare_op = _depth_stencil.depthCompareOp;
+  }
+  if (is_dynamic(vk::DynamicState::eDepthBiasEnable)) {
+    state.depth_bias = _rasterizer.depthBiasEnable == vk::True;
+  }
+  if (is_dynamic(vk::DynamicState::ePrimitiveRestartEnable)) {
+    state.primitive_restart = _input_assembly.primitiveRestartEnable == vk::True;
+  }
+  if (is_dynamic(vk::DynamicState::ePolygonModeEXT)) {
+    state.polygon_mode = _rasterizer.polygonMode;
+  }
+
+  for (const auto& blend : _color_blends) {
+    if (is_dynamic(vk::DynamicState::eColorBlendEnableEXT)) {
+      state.blend_enables.push_back(blend.blendEnable);
+    }
+    if (is_dynamic(vk::DynamicState::eColorBlendEquationEXT)) {
+      state.blend_equations.push_back(vk::ColorBlendEquationEXT{
+          .srcColorBlendFactor = blend.srcColorBlendFactor,
+          .dstColorBlendFactor = blend.dstColorBlendFactor,
+          .colorBlendOp        = blend.colorBlendOp,
+          .srcAlphaBlendFactor = blend.srcAlphaBlendFactor,
+          .dstAlphaBlendFactor = blend.dstAlphaBlendFactor,
+          .alphaBlendOp        = blend.alphaBlendOp,
+      });
+    }
+    if (is_dynamic(vk::DynamicState::eColorWriteMaskEXT)) {
+      state.color_write_masks.push_back(blend.colorWriteMask);
+    }
+  }
+
+  return state;
+}
+
+Result<GraphicsPipelineLibraries, Error> GraphicsPipelineBuilder::build_libraries(const Device& device,
+                                                                                  vk::PipelineLayout layout) {
+  assert(!_shader_stages.empty() && "Shader stages must be provided");
+  assert(device.has_graphics_pipeline_library() && "VK_EXT_graphics_pipeline_library is not enabled");
+  assert(!mesh_stage && "The mesh shading pipelines are not split into the libraries");
+  update_internal_pointers();
+
+  auto dynamic_state = vk::PipelineDynamicStateCreateInfo{
+      .dynamicStateCount = static_cast<uint32_t>(_dynamic_states.size()),
+      .pDynamicStates    = _dynamic_states.data(),
+  };
+
+  vk::PipelineRenderingCreateInfo pipeline_rendering_create_info{
+      .viewMask                = _view_mask,
+      .colorAttachmentCount    = static_cast<uint32_t>(_color_attachment_formats.size()),
+      .pColorAttachmentFormats = _color_attachment_formats.data(),
+  };
+  if (_depth_format) {
+    pipeline_rendering_create_info.depthAttachmentFormat = *_depth_format;
+  }
+  if (_stencil_format) {
+    pipeline_rendering_create_info.stencilAttachmentFormat = *_stencil_format;
+  }
+  auto shading_rate_info = shading_rate_state();
+  if (shading_rate_attachment) {
+    pipeline_rendering_create_info.pNext = &shading_rate_info;
+  }
+  auto attachment_locations     = vk::RenderingAttachmentLocationInfo{};
+  auto input_attachment_indices = vk::RenderingInputAttachmentIndexInfo{};
+  chain_rendering_scope_state(pipeline_rendering_create_info, attachment_locations, input_attachment_indices);
+
+  auto color_blending_info = vk::PipelineColorBlendStateCreateInfo{
+      .logicOpEnable   = vk::False,
+      .logicOp         = vk::LogicOp::eCopy,
+      .attachmentCount = static_cast<uint32_t>(_color_blends.size()),
+      .pAttachments    = _color_blends.data(),
+  };
+
+  auto pre_rasterization_stages = std::vector<vk::PipelineShaderStageCreateInfo>();
+  auto fragment_stages          = std::vector<vk::PipelineShaderStageCreateInfo>();
+  for (const auto& stage : _shader_stages) {
+    if (stage.stage == vk::ShaderStageFlagBits::eFragment) {
+      fragment_stages.push_back(stage);
+    } else {
+      pre_rasterization_stages.push_back(stage);
+    }
+  }
+
+  // Every part keeps the information needed by the link time optimization, the parts share the layout and the
+  // rendering info
+  auto create_part = [&](vk::GraphicsPipelineLibraryFlagsEXT part, vk::GraphicsPipelineCreateInfo pipeline_info) {
+    auto library_info = vk::GraphicsPipelineLibraryCreateInfoEXT{
+        .pNext = &pipeline_rendering_create_info,
+        .flags = part,
+    };
+    pipeline_info.pNext              = &library_info;
+    pipeline_info.flags              = vk::PipelineCreateFlagBits::eLibraryKHR |
+                          vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT |
+                          descriptor_backend_flags(device) | shading_rate_flags(shading_rate_attachment);
+    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+    pipeline_info.basePipelineIndex  = -1;
+
+    return create_pipeline(device, pipeline_info, _name).transform_error([](auto err) {
+      return Error{
+          .msg     = "Graphics Pipeline Library creation failure",
+          .code    = ErrorCode::VulkanObjectCreationFailure{},
+          .vk_code = err,
+      };
+    });
+  };
+
+  auto vertex_input = create_part(vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface,
+                                  vk::GraphicsPipelineCreateInfo{
+                                      .pVertexInputState   = &_vertex_input_state,
+                                      .pInputAssemblyState = &_input_assembly,
+                                      .pDynamicState       = &dynamic_state,
+                                  });
+  if (!vertex_input) {
+    return std::unexpected(vertex_input.error());
+  }
+
+  auto pre_rasterization_info = vk::GraphicsPipelineCreateInfo{
+      .stageCount          = static_cast<uint32_t>(pre_rasterization_stages.size()),
+      .pStages             = pre_rasterization_stages.data(),
+      .pTessellationState  = tess_stage ? &_tess_stage : nullptr,
+      .pViewportState      = &_viewport_state,
+      .pRasterizationState = &_rasterizer,
+      .pDynamicState       = &dynamic_state,
+      .layout              = layout,
+  };
+  auto pre_rasterization =
+      create_part(vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders, pre_rasterization_info);
+  if (!pre_rasterization) {
+    return std::unexpected(pre_rasterization.error());
+  }
+
+  auto fragment_shader_info = vk::GraphicsPipelineCreateInfo{
+      .stageCount         = static_cast<uint32_t>(fragment_stages.size()),
+      .pStages            = fragment_stages.data(),
+      .pMultisampleState  = &_multisampling,
+      .pDepthStencilState = &_depth_stencil,
+      .pDynamicState      = &dynamic_state,
+      .layout             = layout,
+  };
+  auto fragment_shader = create_part(vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader, fragment_shader_info);
+  if (!fragment_shader) {
+    return std::unexpected(fragment_shader.error());
+  }
+
+  auto fragment_output_info = vk::GraphicsPipelineCreateInfo{
+      .pMultisampleState = &_multisampling,
+      .pColorBlendState  = &color_blending_info,
+      .pDynamicState     = &dynamic_state,
+  };
+  auto fragment_output =
+      create_part(vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface, fragment_output_info);
+  if (!fragment_output) {
+    return std::unexpected(fragment_output.error());
+  }
+
+  return GraphicsPipelineLibraries{
+      .vertex_input            = std::move(*vertex_input),
+      .pre_rasterization       = std::move(*pre_rasterization),
+      .fragment_shader         = std::move(*fragment_shader),
+      .fragment_output         = std::move(*fragment_output),
+      .shading_rate_attachment = shading_rate_attachment,
+  };
+}
+
+Result<vk::raii::Pipeline, Error> GraphicsPipelineBuilder::link(const Device& device,
+                                                                const GraphicsPipelineLibraries& libraries,
+                                                                vk::PipelineLayout layout,
+                                                                bool link_time_optimization) {
+  auto pipeline_libraries = std::array<vk::Pipeline, 4>{
+      *libraries.vertex_input,
+      *libraries.pre_rasterization,
+      *libraries.fragment_shader,
+      *libraries.fragment_output,
+  };
+  auto library_info = vk::PipelineLibraryCreateInfoKHR{
+      .libraryCount = static_cast<uint32_t>(pipeline_libraries.size()),
+      .pLibraries   = pipeline_libraries.data(),
+  };
+
+  auto pipeline_info = vk::GraphicsPipelineCreateInfo{
+      .pNext              = &library_info,
+      .flags              = (link_time_optimization ? vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT
+                                                    : vk::PipelineCreateFlags{}) |
+                            descriptor_backend_flags(device) | shading_rate_flags(libraries.shading_rate_attachment),
+      .layout             = layout,
+      .basePipelineHandle = VK_NULL_HANDLE,
+      .basePipelineIndex  = -1,
+  };
+
+  return create_pipeline(device, pipeline_info).transform_error([](auto err) {
+    return Error{
+        .msg     = "Graphics Pipeline linking failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = err,
+    };
+  });
+}
+
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_primitive_topology(vk::PrimitiveTopology topology,
                                                                           bool primitive_restart_enable) {
   _input_assembly = vk::PipelineInputAssemblyStateCreateInfo{
@@ -459,6 +980,51 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_depth_test(bool test_writ
   return *this;
 }
 
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_depth_prepass_test() {
+  _depth_stencil.depthTestEnable  = vk::True;
+  _depth_stencil.depthWriteEnable = vk::False;
+  _depth_stencil.depthCompareOp   = vk::CompareOp::eEqual;
+  return *this;
+}
+
+GraphicsPipelineBuilder GraphicsPipelineBuilder::depth_only_variant(const RenderGraph& render_graph,
+                                                                    RenderPassHandle prepass_handle,
+                                                                    vk::ShaderModule position_only_vertex_shader,
+                                                                    util::zstring_view entry_point) const {
+  // The formats and the samples come from the pre-pass, the rest of the state is shared with the main pass, so that
+  // both of the pipelines rasterize the same depth
+  auto variant = GraphicsPipelineBuilder(render_graph, prepass_handle);
+  for (const auto& stage : _shader_stages) {
+    if (stage.stage == vk::ShaderStageFlagBits::eFragment) {
+      continue;
+    }
+    variant._shader_stages.push_back(stage);
+    if (stage.stage == vk::ShaderStageFlagBits::eVertex && position_only_vertex_shader) {
+      variant._shader_stages.back().module = position_only_vertex_shader;
+      variant._shader_stages.back().pName =
+          entry_point.empty() ? kDefaultVertexShaderEntryPoint.c_str() : entry_point.c_str();
+    }
+  }
+  variant._dynamic_states     = _dynamic_states;
+  variant._vertex_input_state = _vertex_input_state;
+  variant._input_assembly     = _input_assembly;
+  variant._rasterizer         = _rasterizer;
+  variant._tess_stage         = _tess_stage;
+  variant._tess_domain_origin = _tess_domain_origin;
+  variant._pipeline_layout    = _pipeline_layout;
+  variant._specialization     = _specialization;
+  variant.tess_stage          = tess_stage;
+  variant.mesh_stage          = mesh_stage;
+
+  variant._depth_stencil                  = _depth_stencil;
+  variant._depth_stencil.depthTestEnable  = vk::True;
+  variant._depth_stencil.depthWriteEnable = vk::True;
+  if (!_name.empty()) {
+    variant._name = _name + " (depth pre-pass)";
+  }
+  return variant;
+}
+
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::with_depth_bounds_test(float min_depth_bounds,
                                                                          float max_depth_bounds) {
   _depth_stencil.depthBoundsTestEnable = vk::True;
@@ -565,17 +1131,34 @@ ComputePipelineBuilder& ComputePipelineBuilder::with_push_constant_ranges(
   return *this;
 }
 
+ComputePipelineBuilder& ComputePipelineBuilder::with_specialization_constants(SpecializationConstants constants) {
+  _specialization = std::move(constants);
+  return *this;
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::with_name(std::string name) {
+  _name = std::move(name);
+  return *this;
+}
+
+void ComputePipelineBuilder::update_internal_pointers() {
+  _specialization_info              = _specialization.info();
+  _shader_stage.pSpecializationInfo = _specialization.empty() ? nullptr : &_specialization_info;
+}
+
 Result<Pipeline, Error> ComputePipelineBuilder::build(const Device& device) {
   assert(_shader_stage.module && "Compute shader must be provided");
+  update_internal_pointers();
 
   return device->createPipelineLayout(_pipeline_layout)
       .and_then([&](vk::raii::PipelineLayout&& layout) {
         auto pipeline_info = vk::ComputePipelineCreateInfo{
+            .flags  = descriptor_backend_flags(device),
             .stage  = _shader_stage,
             .layout = layout,
         };
 
-        return device->createComputePipeline(nullptr, pipeline_info)
+        return create_pipeline(device, pipeline_info, _name)
             .transform([l = std::move(layout)](vk::raii::Pipeline&& p) mutable {
               return Pipeline{
                   .pipeline = std::move(p),
@@ -592,6 +1175,25 @@ Result<Pipeline, Error> ComputePipelineBuilder::build(const Device& device) {
       });
 }
 
+Result<vk::raii::Pipeline, Error> ComputePipelineBuilder::build(const Device& device, vk::PipelineLayout layout) {
+  assert(_shader_stage.module && "Compute shader must be provided");
+  update_internal_pointers();
+
+  auto pipeline_info = vk::ComputePipelineCreateInfo{
+      .flags  = descriptor_backend_flags(device),
+      .stage  = _shader_stage,
+      .layout = layout,
+  };
+
+  return create_pipeline(device, pipeline_info, _name).transform_error([](auto err) {
+    return Error{
+        .msg     = "Compute Pipeline creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = err,
+    };
+  });
+}
+
 Result<Pipelines, Error> ComputePipelineBuilder::build_for_each_shader(
     const Device& device, std::span<std::pair<vk::ShaderModule, const char*>> shaders) {
   Pipelines pipelines;
@@ -611,13 +1213,15 @@ Result<Pipelines, Error> ComputePipelineBuilder::build_for_each_shader(
         .module = shader.first,
         .pName  = shader.second,
     };
+    update_internal_pointers();
 
     auto pipeline_info = vk::ComputePipelineCreateInfo{
+        .flags  = descriptor_backend_flags(device),
         .stage  = _shader_stage,
         .layout = pipelines.layout,
     };
 
-    if (auto result = device->createComputePipeline(nullptr, pipeline_info); !result) {
+    if (auto result = create_pipeline(device, pipeline_info, _name); !result) {
       return std::unexpected(Error{
           .msg     = "Compute Pipeline creation failure",
           .code    = ErrorCode::VulkanObjectCreationFailure{},
@@ -1,9 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <expected>
+#include <liberay/util/small_vector.hpp>
 #include <liberay/util/zstring_view.hpp>
 #include <liberay/vkren/render_graph.hpp>
 #include <liberay/vkren/shader.hpp>
 #include <liberay/vkren/swap_chain.hpp>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_raii.hpp>
@@ -11,16 +21,133 @@
 
 namespace eray::vkren {
 
+/**
+ * @brief Values of the shader specialization constants. The driver folds them into the shader code when the pipeline
+ * is compiled, so e.g. the workgroup sizes, loop counts and feature toggles cost nothing at runtime. The same constant
+ * block is provided to every stage of the pipeline, the ids not declared by a stage are ignored.
+ *
+ */
+struct SpecializationConstants {
+  std::vector<vk::SpecializationMapEntry> entries;
+  std::vector<std::byte> data;
+
+  /**
+   * @brief Sets the value of the constant with `constant_id`. Booleans are stored as VkBool32, as required by SPIR-V.
+   *
+   * @tparam T Trivially copyable scalar type matching the constant type declared in the shader.
+   * @param constant_id
+   * @param value
+   */
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  void set(uint32_t constant_id, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      set(constant_id, static_cast<vk::Bool32>(value ? VK_TRUE : VK_FALSE));
+    } else {
+      const auto* bytes = reinterpret_cast<const std::byte*>(&value);
+      auto it           = std::ranges::find(entries, constant_id, &vk::SpecializationMapEntry::constantID);
+      if (it != entries.end()) {
+        assert(it->size == sizeof(T) && "Specialization constant type must not change");
+        std::copy_n(bytes, sizeof(T), data.begin() + it->offset);
+        return;
+      }
+
+      entries.push_back(vk::SpecializationMapEntry{
+          .constantID = constant_id,
+          .offset     = static_cast<uint32_t>(data.size()),
+          .size       = sizeof(T),
+      });
+      data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+  }
+
+  bool empty() const { return entries.empty(); }
+
+  /**
+   * @brief The returned info points to the `entries` and `data`, it is valid as long as the constants are not modified.
+   *
+   */
+  vk::SpecializationInfo info() const {
+    return vk::SpecializationInfo{
+        .mapEntryCount = static_cast<uint32_t>(entries.size()),
+        .pMapEntries   = entries.data(),
+        .dataSize      = data.size(),
+        .pData         = data.data(),
+    };
+  }
+
+  /**
+   * @brief The constants are equal when they set the same values, regardless of the order in which they were set.
+   *
+   */
+  bool operator==(const SpecializationConstants& other) const;
+
+  struct Hash {
+    size_t operator()(const SpecializationConstants& constants) const;
+  };
+};
+
+/**
+ * @brief Values of the graphics pipeline states made dynamic with `GraphicsPipelineBuilder::with_dynamic_states()`.
+ * A pipeline built with the extended dynamic states serves all of the materials that differ only in these states,
+ * the states of a material are then set on the command buffer before its draws. The states without a value are not
+ * recorded.
+ *
+ */
+struct GraphicsDynamicState {
+  // VK_EXT_extended_dynamic_state, core in Vulkan 1.3
+  std::optional<vk::CullModeFlags> cull_mode;
+  std::optional<vk::FrontFace> front_face;
+  std::optional<vk::PrimitiveTopology> topology;
+  std::optional<bool> depth_test;
+  std::optional<bool> depth_write;
+  std::optional<vk::CompareOp> depth_compare_op;
+
+  // VK_EXT_extended_dynamic_state2, core in Vulkan 1.3
+  std::optional<bool> depth_bias;
+  std::optional<bool> primitive_restart;
+
+  // VK_EXT_extended_dynamic_state3, see `Device::extended_dynamic_state3_features()`. One element per color attachment
+  std::optional<vk::PolygonMode> polygon_mode;
+  std::vector<vk::Bool32> blend_enables;
+  std::vector<vk::ColorBlendEquationEXT> blend_equations;
+  std::vector<vk::ColorComponentFlags> color_write_masks;
+
+  /**
+   * @brief Sets the states on the command buffer. The bound pipeline must have all of the set states dynamic.
+   *
+   * @param cmd_buff Must be in the recording state.
+   */
+  void record(vk::CommandBuffer cmd_buff) const;
+};
+
 struct Pipeline {
   vk::raii::Pipeline pipeline     = nullptr;
   vk::raii::PipelineLayout layout = nullptr;
 };
 
 struct Pipelines {
-  std::vector<vk::raii::Pipeline> pipeline;
+  util::SmallVector<vk::raii::Pipeline, 4> pipeline;
   vk::raii::PipelineLayout layout = nullptr;
 };
 
+/**
+ * @brief The four parts of a graphics pipeline compiled separately with VK_EXT_graphics_pipeline_library.
+ *
+ */
+struct GraphicsPipelineLibraries {
+  vk::raii::Pipeline vertex_input      = nullptr;
+  vk::raii::Pipeline pre_rasterization = nullptr;
+  vk::raii::Pipeline fragment_shader   = nullptr;
+  vk::raii::Pipeline fragment_output   = nullptr;
+
+  /**
+   * @brief True if the parts were built for a pass with a shading rate image, the linked pipeline must match them.
+   *
+   */
+  bool shading_rate_attachment = false;
+};
+
 struct GraphicsPipelineBuilder {
   GraphicsPipelineBuilder() = delete;
   static GraphicsPipelineBuilder create(const SwapChain& swap_chain);
@@ -50,6 +177,25 @@ struct GraphicsPipelineBuilder {
                                                    util::zstring_view tess_control_shader_entry_point = "",
                                                    util::zstring_view tess_eval_shader_entry_point    = "");
 
+  /**
+   * @brief Replaces the vertex processing with the task and mesh shaders of VK_EXT_mesh_shader, requires
+   * `Device::has_mesh_shader()`. The vertex input and input assembly states are ignored, the mesh shader fetches its
+   * own vertices. Must not be combined with `with_shaders()` or `with_tessellation_stage()`.
+   *
+   * @param task_shader Optional, null when the mesh shader is dispatched directly.
+   * @param mesh_shader
+   * @param fragment_shader
+   * @param task_shader_entry_point
+   * @param mesh_shader_entry_point
+   * @param fragment_shader_entry_point
+   * @return GraphicsPipelineBuilder&
+   */
+  GraphicsPipelineBuilder& with_mesh_shaders(vk::ShaderModule task_shader, vk::ShaderModule mesh_shader,
+                                             vk::ShaderModule fragment_shader,
+                                             util::zstring_view task_shader_entry_point     = "",
+                                             util::zstring_view mesh_shader_entry_point     = "",
+                                             util::zstring_view fragment_shader_entry_point = "");
+
   // https://docs.vulkan.org/spec/latest/chapters/tessellation.html#img-tessellation-topology-ul
   GraphicsPipelineBuilder& with_tessellation_domain_origin(vk::TessellationDomainOrigin domain_origin);
 
@@ -80,6 +226,31 @@ struct GraphicsPipelineBuilder {
 
   GraphicsPipelineBuilder& with_depth_test(bool test_write = true);
   GraphicsPipelineBuilder& with_depth_test_compare_op(vk::CompareOp compare_op);
+
+  /**
+   * @brief Tests the depth laid down by a depth pre-pass (see `DepthPrepass`) for equality without writing it, so the
+   * fragment shader runs only for the visible fragments. Derive the `depth_only_variant()` before calling this.
+   *
+   * @return GraphicsPipelineBuilder&
+   */
+  GraphicsPipelineBuilder& with_depth_prepass_test();
+
+  /**
+   * @brief Derives the pipeline of the depth pre-pass from the builder of the main pass: the same vertex processing,
+   * rasterization state and layout, no fragment shader and no color attachments, the depth tested and written with the
+   * compare op of the builder.
+   *
+   * @param render_graph
+   * @param prepass_handle Render pass of `DepthPrepass::render_pass()`.
+   * @param position_only_vertex_shader If set, replaces the vertex shader, e.g. with an entry point that reads only the
+   * input of `VertexLayout::position_attribute_descriptions()` (set with `with_input_state()` on the variant). It must
+   * compute the positions exactly like the main vertex shader (`precise`), otherwise the equal depth test fails.
+   * @param entry_point
+   * @return GraphicsPipelineBuilder
+   */
+  GraphicsPipelineBuilder depth_only_variant(const RenderGraph& render_graph, RenderPassHandle prepass_handle,
+                                             vk::ShaderModule position_only_vertex_shader = nullptr,
+                                             util::zstring_view entry_point              = "") const;
   GraphicsPipelineBuilder& with_depth_bounds_test(float min_depth_bounds, float max_depth_bounds);
 
   GraphicsPipelineBuilder& with_stencil_test();
@@ -141,9 +312,84 @@ struct GraphicsPipelineBuilder {
 
   GraphicsPipelineBuilder& with_constant_ranges();
 
+  /**
+   * @brief Sets the specialization constant of all of the shader stages.
+   *
+   * @tparam T
+   * @param constant_id
+   * @param value
+   * @return GraphicsPipelineBuilder&
+   */
+  template <typename T>
+  GraphicsPipelineBuilder& with_specialization(uint32_t constant_id, const T& value) {
+    _specialization.set(constant_id, value);
+    return *this;
+  }
+  GraphicsPipelineBuilder& with_specialization_constants(SpecializationConstants constants);
+
+  /**
+   * @brief Names the pipeline in the validation messages and the GPU captures.
+   *
+   */
+  GraphicsPipelineBuilder& with_name(std::string name);
+
+  /**
+   * @brief Marks the states as dynamic. The values of the states set on the builder are ignored by the pipeline and
+   * must be set on the command buffer before a draw, see `dynamic_state()`. The viewport and the scissor are always
+   * dynamic.
+   *
+   * @param states
+   * @return GraphicsPipelineBuilder&
+   */
+  GraphicsPipelineBuilder& with_dynamic_states(std::span<const vk::DynamicState> states);
+  GraphicsPipelineBuilder& with_dynamic_state(vk::DynamicState state);
+
+  /**
+   * @brief Makes the states that usually differ between the materials dynamic: the cull mode, the front face, the
+   * primitive topology (within its class), the depth test, write, compare op and bias, the primitive restart, and, if
+   * supported by the device, the polygon mode and the color blending.
+   *
+   * @param device
+   * @return GraphicsPipelineBuilder&
+   */
+  GraphicsPipelineBuilder& with_extended_dynamic_state(const Device& device);
+
+  bool is_dynamic(vk::DynamicState state) const;
+
+  /**
+   * @brief Values of the dynamic states as set on the builder. A material might describe its state with a builder
+   * and record the returned state before its draws with the pipeline shared by all of the materials.
+   *
+   * @return GraphicsDynamicState
+   */
+  GraphicsDynamicState dynamic_state() const;
+
   Result<Pipeline, Error> build(const Device& device);
   Result<vk::raii::Pipeline, Error> build(const Device& device, vk::PipelineLayout layout);
 
+  /**
+   * @brief Compiles the vertex input, pre-rasterization, fragment shader and fragment output parts of the pipeline as
+   * separate libraries. Requires `Device::has_graphics_pipeline_library()`.
+   *
+   * @param device
+   * @param layout Must be the layout passed to `link()`.
+   * @return Result<GraphicsPipelineLibraries, Error>
+   */
+  Result<GraphicsPipelineLibraries, Error> build_libraries(const Device& device, vk::PipelineLayout layout);
+
+  /**
+   * @brief Links the libraries into an executable pipeline. Without the link time optimization linking is fast enough
+   * to be done while rendering, but the pipeline might be slower than the one built with `build()`.
+   *
+   * @param device
+   * @param libraries
+   * @param layout
+   * @param link_time_optimization
+   * @return Result<vk::raii::Pipeline, Error>
+   */
+  static Result<vk::raii::Pipeline, Error> link(const Device& device, const GraphicsPipelineLibraries& libraries,
+                                                vk::PipelineLayout layout, bool link_time_optimization);
+
   std::vector<vk::PipelineShaderStageCreateInfo> _shader_stages;
   std::vector<vk::DynamicState> _dynamic_states;
   vk::PipelineViewportStateCreateInfo _viewport_state;
@@ -159,18 +405,60 @@ struct GraphicsPipelineBuilder {
   std::vector<vk::Format> _color_attachment_formats;
   std::optional<vk::Format> _depth_format;
   std::optional<vk::Format> _stencil_format;
+  uint32_t _view_mask = 0;
+  SpecializationConstants _specialization;
+  vk::SpecializationInfo _specialization_info;
+  std::string _name;
 
   std::unordered_map<uint32_t, uint32_t> _rg_attachment_handle_to_rp_attachment_ind;
 
   bool tess_stage{false};
+  bool mesh_stage{false};
+
+  /**
+   * @brief Set by `create()` of a render pass with a shading rate image, see
+   * `RenderPassBuilder::with_shading_rate_image()`.
+   *
+   */
+  bool shading_rate_attachment{false};
+
+  /**
+   * @brief Set by `create()` of a render pass merged into a `RenderingScope`. The pipeline is created with the
+   * attachments of the whole scope, the outputs and the input attachments of the pass are mapped to them.
+   *
+   */
+  bool rendering_scope{false};
+  std::vector<uint32_t> _color_attachment_locations;
+  std::vector<uint32_t> _color_attachment_input_indices;
+  uint32_t _depth_input_index   = VK_ATTACHMENT_UNUSED;
+  uint32_t _stencil_input_index = VK_ATTACHMENT_UNUSED;
 
   static constexpr util::zstring_view kDefaultVertexShaderEntryPoint              = "mainVert";
   static constexpr util::zstring_view kDefaultFragmentShaderEntryPoint            = "mainFrag";
   static constexpr util::zstring_view kDefaultTessellationControlShaderEntryPoint = "mainTessControl";
   static constexpr util::zstring_view kDefaultTessellationEvalShaderEntryPoint    = "mainTessEval";
+  static constexpr util::zstring_view kDefaultTaskShaderEntryPoint                = "mainTask";
+  static constexpr util::zstring_view kDefaultMeshShaderEntryPoint                = "mainMesh";
 
  private:
   void init();
+
+  /**
+   * @brief The builder might have been copied or moved since the state was set, the internal pointers are refreshed
+   * before the create infos are assembled.
+   *
+   */
+  void update_internal_pointers();
+
+  /**
+   * @brief Chains the attachment locations and the input attachment indices in front of the rendering info if the pass
+   * has been merged into a `RenderingScope`.
+   *
+   */
+  void chain_rendering_scope_state(vk::PipelineRenderingCreateInfo& rendering_info,
+                                   vk::RenderingAttachmentLocationInfo& locations,
+                                   vk::RenderingInputAttachmentIndexInfo& input_indices) const;
+
   explicit GraphicsPipelineBuilder(const SwapChain& swap_chain);
   explicit GraphicsPipelineBuilder(const RenderGraph& render_graph, RenderPassHandle rp_handle);
 };
@@ -185,7 +473,30 @@ struct ComputePipelineBuilder {
   ComputePipelineBuilder& with_descriptor_set_layout(const vk::DescriptorSetLayout& layout);
   ComputePipelineBuilder& with_push_constant_ranges(std::span<vk::PushConstantRange> push_constant_ranges);
 
+  /**
+   * @brief Sets the specialization constant of the compute shader, e.g. the workgroup size declared with
+   * `local_size_x_id`.
+   *
+   * @tparam T
+   * @param constant_id
+   * @param value
+   * @return ComputePipelineBuilder&
+   */
+  template <typename T>
+  ComputePipelineBuilder& with_specialization(uint32_t constant_id, const T& value) {
+    _specialization.set(constant_id, value);
+    return *this;
+  }
+  ComputePipelineBuilder& with_specialization_constants(SpecializationConstants constants);
+
+  /**
+   * @brief Names the pipeline in the validation messages and the GPU captures.
+   *
+   */
+  ComputePipelineBuilder& with_name(std::string name);
+
   Result<Pipeline, Error> build(const Device& device);
+  Result<vk::raii::Pipeline, Error> build(const Device& device, vk::PipelineLayout layout);
   Result<Pipelines, Error> build_for_each_shader(const Device& device,
                                                  std::span<std::pair<vk::ShaderModule, const char*>> shaders);
 
@@ -193,9 +504,89 @@ struct ComputePipelineBuilder {
 
   vk::PipelineShaderStageCreateInfo _shader_stage{};
   vk::PipelineLayoutCreateInfo _pipeline_layout{};
+  SpecializationConstants _specialization;
+  vk::SpecializationInfo _specialization_info;
+  std::string _name;
 
  private:
   ComputePipelineBuilder();
+
+  void update_internal_pointers();
 };
 
+/**
+ * @brief Compiles every specialization of a pipeline only once. All of the variants share the pipeline layout, so
+ * the bound descriptor sets stay valid when switching between them.
+ *
+ * @tparam TBuilder `GraphicsPipelineBuilder` or `ComputePipelineBuilder`.
+ */
+template <typename TBuilder>
+class PipelinePermutationCache {
+ public:
+  PipelinePermutationCache() = delete;
+  explicit PipelinePermutationCache(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the cache.
+   *
+   * @param builder Describes the pipeline. The specialization constants set on the builder are replaced by the ones
+   * passed to `get()`.
+   * @param layout Must outlive the cache.
+   * @return PipelinePermutationCache
+   */
+  [[nodiscard]] static PipelinePermutationCache create(TBuilder builder, vk::PipelineLayout layout) {
+    auto cache     = PipelinePermutationCache(nullptr);
+    cache.builder_ = std::move(builder);
+    cache.layout_  = layout;
+    return cache;
+  }
+
+  /**
+   * @brief Returns the variant specialized with the `constants`, the variant is compiled when it is requested for the
+   * first time.
+   *
+   * @param device
+   * @param constants
+   * @return Result<vk::Pipeline, Error>
+   */
+  Result<vk::Pipeline, Error> get(const Device& device, const SpecializationConstants& constants) {
+    assert(builder_ && "Permutation cache has not been created");
+
+    if (auto it = pipelines_.find(constants); it != pipelines_.end()) {
+      return *it->second;
+    }
+
+    builder_->with_specialization_constants(constants);
+    auto pipeline = builder_->build(device, layout_);
+    if (!pipeline) {
+      return std::unexpected(pipeline.error());
+    }
+
+    auto [it, _] = pipelines_.emplace(constants, std::move(*pipeline));
+    return *it->second;
+  }
+
+  vk::PipelineLayout layout() const { return layout_; }
+
+  /**
+   * @brief Number of the compiled variants.
+   *
+   */
+  size_t size() const { return pipelines_.size(); }
+
+  /**
+   * @brief Destroys all of the compiled variants. The variants must not be in use by the device.
+   *
+   */
+  void clear() { pipelines_.clear(); }
+
+ private:
+  std::optional<TBuilder> builder_;
+  vk::PipelineLayout layout_;
+  std::unordered_map<SpecializationConstants, vk::raii::Pipeline, SpecializationConstants::Hash> pipelines_;
+};
+
+using GraphicsPipelinePermutationCache = PipelinePermutationCache<GraphicsPipelineBuilder>;
+using ComputePipelinePermutationCache  = PipelinePermutationCache<ComputePipelineBuilder>;
+
 }  // namespace eray::vkren
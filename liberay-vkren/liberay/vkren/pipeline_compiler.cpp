@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/pipeline_compiler.hpp>
+#include <utility>
+
+namespace eray::vkren {
+
+std::optional<Error> AsyncPipeline::error() const {
+  if (!state_) {
+    return std::nullopt;
+  }
+
+  auto lock = std::lock_guard(state_->mutex);
+  return state_->error;
+}
+
+std::unique_ptr<PipelineCompiler> PipelineCompiler::create(const Device& device, uint32_t worker_count) {
+  if (worker_count == 0) {
+    worker_count = std::max(1U, std::thread::hardware_concurrency() / 4);
+  }
+
+  return std::unique_ptr<PipelineCompiler>(new PipelineCompiler(device, worker_count));
+}
+
+PipelineCompiler::PipelineCompiler(const Device& device, uint32_t worker_count) : p_device_(&device) {
+  workers_.reserve(worker_count);
+  for (auto i = 0U; i < worker_count; ++i) {
+    workers_.emplace_back([this](const std::stop_token& stop_token) { work(stop_token); });
+  }
+}
+
+PipelineCompiler::~PipelineCompiler() {
+  for (auto& worker : workers_) {
+    worker.request_stop();
+  }
+
+  {
+    auto lock = std::lock_guard(mutex_);
+    for (auto& job : jobs_) {
+      fail(*job.state, Error{
+                           .msg  = "Pipeline compilation cancelled",
+                           .code = ErrorCode::VulkanObjectCreationFailure{},
+                       });
+    }
+    jobs_.clear();
+  }
+
+  // Joins the workers, the compilations in progress are finished
+  workers_.clear();
+}
+
+AsyncPipeline PipelineCompiler::compile(const GraphicsPipelineBuilder& builder, vk::PipelineLayout layout) {
+  auto state = std::make_shared<detail::AsyncPipelineState>();
+  {
+    auto lock = std::lock_guard(mutex_);
+    jobs_.push_front(Job{
+        .state           = state,
+        .builder         = std::make_shared<GraphicsPipelineBuilder>(builder),
+        .layout          = layout,
+        .libraries       = nullptr,
+        .compute_builder = nullptr,
+    });
+  }
+  job_available_.notify_one();
+
+  return AsyncPipeline(std::move(state));
+}
+
+AsyncPipeline PipelineCompiler::compile(const ComputePipelineBuilder& builder, vk::PipelineLayout layout) {
+  auto state = std::make_shared<detail::AsyncPipelineState>();
+  {
+    auto lock = std::lock_guard(mutex_);
+    jobs_.push_front(Job{
+        .state           = state,
+        .builder         = nullptr,
+        .layout          = layout,
+        .libraries       = nullptr,
+        .compute_builder = std::make_shared<ComputePipelineBuilder>(builder),
+    });
+  }
+  job_available_.notify_one();
+
+  return AsyncPipeline(std::move(state));
+}
+
+void PipelineCompiler::wait_idle() {
+  auto lock = std::unique_lock(mutex_);
+  idle_.wait(lock, [this] { return jobs_.empty() && running_count_ == 0; });
+}
+
+size_t PipelineCompiler::pending_count() const {
+  auto lock = std::lock_guard(mutex_);
+  return jobs_.size() + running_count_;
+}
+
+void PipelineCompiler::work(const std::stop_token& stop_token) {
+  while (true) {
+    auto job = Job{};
+    {
+      auto lock = std::unique_lock(mutex_);
+      if (!job_available_.wait(lock, stop_token, [this] { return !jobs_.empty(); })) {
+        return;
+      }
+
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+      ++running_count_;
+    }
+
+    run(job);
+
+    {
+      auto lock = std::lock_guard(mutex_);
+      --running_count_;
+    }
+    idle_.notify_all();
+  }
+}
+
+void PipelineCompiler::run(Job& job) {
+  const auto& device = *p_device_;
+
+  // == Compute Pipeline ===============================================================================================
+  if (job.compute_builder) {
+    if (auto pipeline = job.compute_builder->build(device, job.layout)) {
+      publish(*job.state, std::move(*pipeline), true);
+    } else {
+      fail(*job.state, std::move(pipeline.error()));
+    }
+    return;
+  }
+
+  // == Link Time Optimization =========================================================================================
+  if (job.libraries) {
+    if (auto pipeline = GraphicsPipelineBuilder::link(device, *job.libraries, job.layout, true)) {
+      publish(*job.state, std::move(*pipeline), true);
+    } else {
+      // The fast linked pipeline stays in use
+      util::Logger::warn("Could not link the optimized pipeline: {}", pipeline.error().msg);
+    }
+    return;
+  }
+
+  // == Whole Pipeline =================================================================================================
+  if (!device.has_graphics_pipeline_library()) {
+    if (auto pipeline = job.builder->build(device, job.layout)) {
+      publish(*job.state, std::move(*pipeline), true);
+    } else {
+      fail(*job.state, std::move(pipeline.error()));
+    }
+    return;
+  }
+
+  // == Pipeline Libraries =============================================================================================
+  auto libraries = job.builder->build_libraries(device, job.layout);
+  if (!libraries) {
+    fail(*job.state, std::move(libraries.error()));
+    return;
+  }
+
+  auto libraries_ptr = std::make_shared<GraphicsPipelineLibraries>(std::move(*libraries));
+  if (auto pipeline = GraphicsPipelineBuilder::link(device, *libraries_ptr, job.layout, false)) {
+    publish(*job.state, std::move(*pipeline), false);
+  } else {
+    fail(*job.state, std::move(pipeline.error()));
+    return;
+  }
+
+  {
+    auto lock = std::lock_guard(mutex_);
+    jobs_.push_back(Job{
+        .state           = job.state,
+        .builder         = nullptr,
+        .layout          = job.layout,
+        .libraries       = std::move(libraries_ptr),
+        .compute_builder = nullptr,
+    });
+  }
+  job_available_.notify_one();
+}
+
+void PipelineCompiler::publish(detail::AsyncPipelineState& state, vk::raii::Pipeline&& pipeline, bool optimized) {
+  auto lock      = std::lock_guard(state.mutex);
+  auto vk_handle = static_cast<VkPipeline>(*pipeline);
+  state.pipelines.push_back(std::move(pipeline));
+  state.current.store(vk_handle, std::memory_order_release);
+  state.optimized.store(optimized, std::memory_order_release);
+}
+
+void PipelineCompiler::fail(detail::AsyncPipelineState& state, Error&& error) {
+  util::Logger::err("Pipeline compilation failed: {}", error.msg);
+
+  auto lock   = std::lock_guard(state.mutex);
+  state.error = std::move(error);
+  state.failed.store(true, std::memory_order_release);
+}
+
+}  // namespace eray::vkren
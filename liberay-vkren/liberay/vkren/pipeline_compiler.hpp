@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+namespace detail {
+
+struct AsyncPipelineState {
+  /**
+   * @brief Handle of the newest pipeline, read by the render thread without locking.
+   *
+   */
+  std::atomic<VkPipeline> current = VK_NULL_HANDLE;
+  std::atomic<bool> optimized     = false;
+  std::atomic<bool> failed        = false;
+
+  std::mutex mutex;
+
+  /**
+   * @brief Every published pipeline. A pipeline replaced by the optimized one might still be used by the frames in
+   * flight, so all of them live as long as the state.
+   *
+   */
+  std::vector<vk::raii::Pipeline> pipelines;
+  std::optional<Error> error;
+};
+
+}  // namespace detail
+
+/**
+ * @brief Future-like handle of a pipeline compiled by the `PipelineCompiler`. Copies share the pipeline.
+ *
+ * @warning The pipeline is owned by the handle, which must not outlive the device.
+ *
+ */
+class AsyncPipeline {
+ public:
+  AsyncPipeline() = delete;
+  explicit AsyncPipeline(std::nullptr_t) {}
+
+  /**
+   * @brief False for the handles that do not refer to any compilation.
+   *
+   */
+  bool is_valid() const { return state_ != nullptr; }
+
+  /**
+   * @brief True once any executable pipeline is available. With VK_EXT_graphics_pipeline_library this is the fast
+   * linked pipeline, which is later replaced by the optimized one.
+   *
+   */
+  bool is_ready() const { return state_ && state_->current.load(std::memory_order_acquire) != VK_NULL_HANDLE; }
+  bool is_optimized() const { return state_ && state_->optimized.load(std::memory_order_acquire); }
+  bool has_failed() const { return state_ && state_->failed.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Returns the compiled pipeline or the `fallback` if it is not ready yet. A null fallback lets the caller skip
+   * the draw.
+   *
+   * @param fallback
+   * @return vk::Pipeline
+   */
+  vk::Pipeline pipeline_or(vk::Pipeline fallback = nullptr) const {
+    if (!state_) {
+      return fallback;
+    }
+    if (auto pipeline = state_->current.load(std::memory_order_acquire); pipeline != VK_NULL_HANDLE) {
+      return pipeline;
+    }
+    return fallback;
+  }
+
+  /**
+   * @brief Error of the failed compilation.
+   *
+   * @return std::optional<Error>
+   */
+  std::optional<Error> error() const;
+
+ private:
+  friend class PipelineCompiler;
+
+  explicit AsyncPipeline(std::shared_ptr<detail::AsyncPipelineState> state) : state_(std::move(state)) {}
+
+  std::shared_ptr<detail::AsyncPipelineState> state_;
+};
+
+/**
+ * @brief Compiles graphics and compute pipelines on worker threads, so new materials do not stall the frame. The render
+ * path queries `AsyncPipeline::pipeline_or()` every frame and either skips the draw or uses a fallback pipeline until
+ * the compiled one is ready.
+ *
+ * When VK_EXT_graphics_pipeline_library is enabled, the pipeline parts are compiled as libraries and fast linked first.
+ * The link time optimized pipeline is built afterwards with a lower priority and replaces the fast linked one.
+ *
+ * @warning The shader modules and pipeline layouts passed to `compile()` must outlive the compilation. Lifetime is
+ * bound by the device lifetime.
+ *
+ */
+class PipelineCompiler {
+ public:
+  PipelineCompiler() = delete;
+
+  PipelineCompiler(PipelineCompiler&&)                 = delete;
+  PipelineCompiler& operator=(PipelineCompiler&&)      = delete;
+  PipelineCompiler(const PipelineCompiler&)            = delete;
+  PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+  /**
+   * @brief Stops the workers. The queued compilations are cancelled, their handles report a failure.
+   *
+   */
+  ~PipelineCompiler();
+
+  /**
+   * @brief Creates the compiler. As the compiler owns threads, it is not movable.
+   *
+   * @param device
+   * @param worker_count When zero, a quarter of the hardware threads (at least one) is used.
+   * @return std::unique_ptr<PipelineCompiler>
+   */
+  [[nodiscard]] static std::unique_ptr<PipelineCompiler> create(const Device& device, uint32_t worker_count = 0);
+
+  /**
+   * @brief Queues the compilation of a graphics pipeline.
+   *
+   * @param builder Copied, the builder might be reused right after the call.
+   * @param layout
+   * @return AsyncPipeline
+   */
+  AsyncPipeline compile(const GraphicsPipelineBuilder& builder, vk::PipelineLayout layout);
+
+  /**
+   * @brief Queues the compilation of a compute pipeline.
+   *
+   * @param builder Copied, the builder might be reused right after the call.
+   * @param layout
+   * @return AsyncPipeline
+   */
+  AsyncPipeline compile(const ComputePipelineBuilder& builder, vk::PipelineLayout layout);
+
+  /**
+   * @brief Blocks the CPU until every queued compilation, including the link time optimizations, is complete.
+   *
+   */
+  void wait_idle();
+
+  size_t pending_count() const;
+
+ private:
+  struct Job {
+    std::shared_ptr<detail::AsyncPipelineState> state;
+    std::shared_ptr<GraphicsPipelineBuilder> builder;
+    vk::PipelineLayout layout;
+
+    /**
+     * @brief Set for the link time optimization of already compiled libraries.
+     *
+     */
+    std::shared_ptr<GraphicsPipelineLibraries> libraries;
+    std::shared_ptr<ComputePipelineBuilder> compute_builder;
+  };
+
+  PipelineCompiler(const Device& device, uint32_t worker_count);
+
+  void work(const std::stop_token& stop_token);
+  void run(Job& job);
+  static void publish(detail::AsyncPipelineState& state, vk::raii::Pipeline&& pipeline, bool optimized);
+  static void fail(detail::AsyncPipelineState& state, Error&& error);
+
+  observer_ptr<const Device> p_device_ = nullptr;
+
+  mutable std::mutex mutex_;
+  std::condition_variable_any job_available_;
+  std::condition_variable idle_;
+
+  /**
+   * @brief Compilations of new pipelines are taken from the front, the link time optimizations are queued at the back.
+   *
+   */
+  std::deque<Job> jobs_;
+  size_t running_count_ = 0;
+
+  std::vector<std::jthread> workers_;
+};
+
+}  // namespace eray::vkren
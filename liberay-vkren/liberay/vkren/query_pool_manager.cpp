@@ -0,0 +1,177 @@
+#include <bit>
+#include <cassert>
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/query_pool_manager.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+QueryPoolManager QueryPoolManager::create(Device& device) {
+  auto manager      = QueryPoolManager(nullptr);
+  manager.p_device_ = &device;
+
+  const auto queue_families = device.physical_device().getQueueFamilyProperties();
+  const auto valid_bits     = queue_families[device.graphics_queue_family()].timestampValidBits;
+  if (valid_bits > 0) {
+    manager.timestamp_period_ns_ = device.physical_device().getProperties().limits.timestampPeriod;
+    manager.timestamp_mask_      = valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << valid_bits) - 1;
+  }
+
+  return manager;
+}
+
+Result<TimestampPoolHandle, Error> QueryPoolManager::create_timestamp_pool(uint32_t capacity,
+                                                                          uint32_t frames_in_flight) {
+  if (!has_timestamps()) {
+    util::Logger::err("Could not create a timestamp query pool. The graphics queue does not support timestamps");
+    return std::unexpected(Error{
+        .msg  = "Timestamps are not supported",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
+  return create_pool(vk::QueryType::eTimestamp, capacity, frames_in_flight).transform([](QueryPoolKey key) {
+    return TimestampPoolHandle{.key = key};
+  });
+}
+
+Result<OcclusionPoolHandle, Error> QueryPoolManager::create_occlusion_pool(uint32_t capacity,
+                                                                          uint32_t frames_in_flight) {
+  return create_pool(vk::QueryType::eOcclusion, capacity, frames_in_flight).transform([](QueryPoolKey key) {
+    return OcclusionPoolHandle{.key = key};
+  });
+}
+
+Result<StatisticsPoolHandle, Error> QueryPoolManager::create_statistics_pool(
+    uint32_t capacity, uint32_t frames_in_flight, vk::QueryPipelineStatisticFlags statistics) {
+  if (p_device_->physical_device().getFeatures().pipelineStatisticsQuery != vk::True) {
+    util::Logger::err("Could not create a pipeline statistics query pool. The queries are not supported");
+    return std::unexpected(Error{
+        .msg  = "Pipeline statistics queries are not supported",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
+  return create_pool(vk::QueryType::ePipelineStatistics, capacity, frames_in_flight, statistics)
+      .transform([](QueryPoolKey key) { return StatisticsPoolHandle{.key = key}; });
+}
+
+void QueryPoolManager::begin_frame(vk::CommandBuffer cmd_buff, uint32_t frame_index) {
+  frame_index_ = frame_index;
+  ++frame_counter_;
+
+  for (auto& pool : pools_) {
+    assert(frame_index < pool.frames.size() && "Frame index exceeds the frames in flight of the pool");
+    auto& frame = pool.frames[frame_index];
+    if (frame.used > 0) {
+      read_results(pool, frame);
+    }
+
+    // The whole pool is reset, so that none of its queries is left in the undefined state after the creation
+    cmd_buff.resetQueryPool(*frame.pool, 0, pool.capacity);
+    frame.used  = 0;
+    frame.frame = frame_counter_;
+  }
+}
+
+std::optional<uint32_t> QueryPoolManager::write_timestamp(vk::CommandBuffer cmd_buff, TimestampPoolHandle handle,
+                                                          vk::PipelineStageFlags2 stage) {
+  auto query = allocate(handle.key);
+  if (query) {
+    cmd_buff.writeTimestamp2(stage, *current(handle.key).pool, *query);
+  }
+  return query;
+}
+
+std::optional<uint32_t> QueryPoolManager::begin_query(vk::CommandBuffer cmd_buff, OcclusionPoolHandle handle,
+                                                      bool precise) {
+  auto query = allocate(handle.key);
+  if (query) {
+    cmd_buff.beginQuery(*current(handle.key).pool, *query,
+                        precise ? vk::QueryControlFlagBits::ePrecise : vk::QueryControlFlags{});
+  }
+  return query;
+}
+
+std::optional<uint32_t> QueryPoolManager::begin_query(vk::CommandBuffer cmd_buff, StatisticsPoolHandle handle) {
+  auto query = allocate(handle.key);
+  if (query) {
+    cmd_buff.beginQuery(*current(handle.key).pool, *query, {});
+  }
+  return query;
+}
+
+void QueryPoolManager::end_query(vk::CommandBuffer cmd_buff, OcclusionPoolHandle handle, uint32_t query) {
+  cmd_buff.endQuery(*current(handle.key).pool, query);
+}
+
+void QueryPoolManager::end_query(vk::CommandBuffer cmd_buff, StatisticsPoolHandle handle, uint32_t query) {
+  cmd_buff.endQuery(*current(handle.key).pool, query);
+}
+
+Result<QueryPoolKey, Error> QueryPoolManager::create_pool(vk::QueryType type, uint32_t capacity,
+                                                          uint32_t frames_in_flight,
+                                                          vk::QueryPipelineStatisticFlags statistics) {
+  assert(capacity > 0 && frames_in_flight > 0 && "Query pool must not be empty");
+
+  auto pool             = Pool{};
+  pool.type             = type;
+  pool.capacity         = capacity;
+  pool.values_per_query = type == vk::QueryType::ePipelineStatistics
+                              ? static_cast<uint32_t>(std::popcount(static_cast<uint32_t>(statistics)))
+                              : 1;
+
+  const auto create_info = vk::QueryPoolCreateInfo{
+      .queryType          = type,
+      .queryCount         = capacity,
+      .pipelineStatistics = statistics,
+  };
+  pool.frames.resize(frames_in_flight);
+  for (auto& frame : pool.frames) {
+    if (auto result = (*p_device_)->createQueryPool(create_info)) {
+      frame.pool = std::move(*result);
+    } else {
+      util::Logger::err("Could not create a {} query pool. {}", vk::to_string(type), vk::to_string(result.error()));
+      return std::unexpected(Error{
+          .msg     = "Query pool creation failure",
+          .code    = ErrorCode::VulkanObjectCreationFailure{},
+          .vk_code = result.error(),
+      });
+    }
+  }
+
+  return pools_.insert(std::move(pool));
+}
+
+std::optional<uint32_t> QueryPoolManager::allocate(QueryPoolKey key) {
+  auto& pool  = pools_[key];
+  auto& frame = pool.frames[frame_index_];
+  if (frame.used == pool.capacity) {
+    return std::nullopt;
+  }
+  return frame.used++;
+}
+
+void QueryPoolManager::read_results(Pool& pool, const FramePool& frame) {
+  // Each query is followed by its availability, the results are never waited for
+  const auto stride = static_cast<size_t>(pool.values_per_query + 1) * sizeof(uint64_t);
+  const auto flags  = vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability;
+
+  auto [result, values] = frame.pool.getResults<uint64_t>(0, frame.used, frame.used * stride, stride, flags);
+  if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) {
+    util::Logger::warn("Could not read the {} query results. {}", vk::to_string(pool.type), vk::to_string(result));
+    return;
+  }
+
+  pool.results = QueryResults{
+      .frame            = frame.frame,
+      .query_count      = frame.used,
+      .values_per_query = pool.values_per_query,
+      .values           = std::move(values),
+  };
+}
+
+}  // namespace eray::vkren
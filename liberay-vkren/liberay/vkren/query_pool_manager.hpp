@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/util/slot_map.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/error.hpp>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+class Device;
+
+struct QueryPoolTag {};
+using QueryPoolKey = util::SlotMapKey<QueryPoolTag>;
+
+/**
+ * @brief Handle of a `QueryPoolManager` pool, typed by the query type, so that e.g. a timestamp cannot be written to
+ * an occlusion pool.
+ *
+ */
+template <vk::QueryType kType>
+struct QueryPoolHandle {
+  QueryPoolKey key;
+};
+
+using TimestampPoolHandle  = QueryPoolHandle<vk::QueryType::eTimestamp>;
+using OcclusionPoolHandle  = QueryPoolHandle<vk::QueryType::eOcclusion>;
+using StatisticsPoolHandle = QueryPoolHandle<vk::QueryType::ePipelineStatistics>;
+
+/**
+ * @brief Results of the queries written by a single frame.
+ *
+ */
+struct QueryResults {
+  /**
+   * @brief `QueryPoolManager::frame_counter()` of the frame that wrote the queries, the results are
+   * `frame_counter() - frame` frames old.
+   *
+   */
+  uint64_t frame = 0;
+
+  uint32_t query_count      = 0;
+  uint32_t values_per_query = 0;
+
+  /**
+   * @brief The `values_per_query` values of every query followed by its availability.
+   *
+   */
+  std::vector<uint64_t> values;
+
+  bool available(uint32_t query) const {
+    return query < query_count && values[(query * (values_per_query + 1)) + values_per_query] != 0;
+  }
+
+  /**
+   * @brief Value of an available query, the values of the pipeline statistics follow the order of the
+   * `vk::QueryPipelineStatisticFlagBits`.
+   *
+   */
+  std::optional<uint64_t> value(uint32_t query, uint32_t index = 0) const {
+    if (!available(query)) {
+      return std::nullopt;
+    }
+    return values[(query * (values_per_query + 1)) + index];
+  }
+};
+
+/**
+ * @brief Owns the timestamp, occlusion and pipeline statistics query pools, with a pool per frame in flight. Owned by
+ * the `Device`, see `Device::query_pools()`.
+ *
+ * `begin_frame()` reads back the results of the frame that has last used the frame in flight and resets its pools
+ * with `vkCmdResetQueryPool`, so the queries of the frame are allocated in the order they are written. The results are
+ * never waited for: they are read once the fence of the frame has been waited for, so they lag `frames_in_flight`
+ * frames behind, and the queries that are still unavailable are reported as such (see `QueryResults::frame`).
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class QueryPoolManager {
+ public:
+  QueryPoolManager() = delete;
+  explicit QueryPoolManager(std::nullptr_t) {}
+
+  static QueryPoolManager create(Device& device);
+
+  /**
+   * @brief Creates the pools of up to `capacity` timestamps per frame.
+   *
+   * @param capacity
+   * @param frames_in_flight
+   * @return Result<TimestampPoolHandle, Error> Fails with `PhysicalDeviceNotSufficient` when the graphics queue does
+   * not support the timestamps.
+   */
+  [[nodiscard]] Result<TimestampPoolHandle, Error> create_timestamp_pool(uint32_t capacity, uint32_t frames_in_flight);
+
+  /**
+   * @brief Creates the pools of up to `capacity` occlusion queries per frame, the query counts the passed samples.
+   *
+   * @param capacity
+   * @param frames_in_flight
+   * @return Result<OcclusionPoolHandle, Error>
+   */
+  [[nodiscard]] Result<OcclusionPoolHandle, Error> create_occlusion_pool(uint32_t capacity, uint32_t frames_in_flight);
+
+  /**
+   * @brief Creates the pools of up to `capacity` pipeline statistics queries per frame.
+   *
+   * @param capacity
+   * @param frames_in_flight
+   * @param statistics Counters of every query, in the order of their bits.
+   * @return Result<StatisticsPoolHandle, Error> Fails with `PhysicalDeviceNotSufficient` when the
+   * `pipelineStatisticsQuery` feature is not supported.
+   */
+  [[nodiscard]] Result<StatisticsPoolHandle, Error> create_statistics_pool(
+      uint32_t capacity, uint32_t frames_in_flight, vk::QueryPipelineStatisticFlags statistics);
+
+  /**
+   * @brief Destroys the pools right away, the GPU must not use them anymore.
+   *
+   */
+  template <vk::QueryType kType>
+  void destroy_pool(QueryPoolHandle<kType> handle) {
+    pools_.erase(handle.key);
+  }
+
+  /**
+   * @brief Reads back the results of the previous recording of the frame in flight and resets its pools. Must be
+   * recorded before any query of the frame, outside of rendering. Call after the fence of the frame has been waited
+   * for.
+   *
+   * @param cmd_buff
+   * @param frame_index Must be less than the `frames_in_flight` of every pool.
+   */
+  void begin_frame(vk::CommandBuffer cmd_buff, uint32_t frame_index);
+
+  /**
+   * @brief Writes a timestamp once all of the previous commands have reached the stage.
+   *
+   * @return std::optional<uint32_t> Index of the query in the frame, none if the capacity of the pool is exhausted.
+   */
+  std::optional<uint32_t> write_timestamp(vk::CommandBuffer cmd_buff, TimestampPoolHandle handle,
+                                          vk::PipelineStageFlags2 stage);
+
+  /**
+   * @brief Begins an occlusion query, ended by `end_query()` in the same subpass or rendering.
+   *
+   * @param precise Counts the exact number of the samples instead of non zero for any, requires the
+   * `occlusionQueryPrecise` feature.
+   * @return std::optional<uint32_t> Index of the query in the frame, none if the capacity of the pool is exhausted.
+   */
+  std::optional<uint32_t> begin_query(vk::CommandBuffer cmd_buff, OcclusionPoolHandle handle, bool precise = false);
+  std::optional<uint32_t> begin_query(vk::CommandBuffer cmd_buff, StatisticsPoolHandle handle);
+
+  void end_query(vk::CommandBuffer cmd_buff, OcclusionPoolHandle handle, uint32_t query);
+  void end_query(vk::CommandBuffer cmd_buff, StatisticsPoolHandle handle, uint32_t query);
+
+  /**
+   * @brief Results of the most recently read frame of the pool.
+   *
+   */
+  template <vk::QueryType kType>
+  const QueryResults& results(QueryPoolHandle<kType> handle) const {
+    return pools_[handle.key].results;
+  }
+
+  /**
+   * @brief Converts the difference of two timestamps to milliseconds, the difference wraps around with the counter.
+   *
+   */
+  double timestamp_delta_ms(uint64_t begin, uint64_t end) const {
+    return static_cast<double>((end - begin) & timestamp_mask_) * timestamp_period_ns_ / 1e6;
+  }
+
+  /**
+   * @brief Number of `begin_frame()` calls.
+   *
+   */
+  uint64_t frame_counter() const { return frame_counter_; }
+
+  bool has_timestamps() const { return timestamp_mask_ != 0; }
+  size_t pool_count() const { return pools_.size(); }
+
+ private:
+  struct FramePool {
+    vk::raii::QueryPool pool = nullptr;
+    uint32_t used            = 0;
+    uint64_t frame           = 0;
+  };
+
+  struct Pool {
+    vk::QueryType type;
+    uint32_t capacity         = 0;
+    uint32_t values_per_query = 1;
+    std::vector<FramePool> frames;
+    QueryResults results;
+  };
+
+  Result<QueryPoolKey, Error> create_pool(vk::QueryType type, uint32_t capacity, uint32_t frames_in_flight,
+                                          vk::QueryPipelineStatisticFlags statistics = {});
+
+  /**
+   * @brief Allocates the next query of the current frame.
+   *
+   */
+  std::optional<uint32_t> allocate(QueryPoolKey key);
+  FramePool& current(QueryPoolKey key) { return pools_[key].frames[frame_index_]; }
+
+  static void read_results(Pool& pool, const FramePool& frame);
+
+  observer_ptr<Device> p_device_{};
+  util::SlotMap<Pool, QueryPoolKey> pools_;
+  uint32_t frame_index_       = 0;
+  uint64_t frame_counter_     = 0;
+  double timestamp_period_ns_ = 0.0;
+  uint64_t timestamp_mask_    = 0;
+};
+
+}  // namespace eray::vkren
@@ -1,15 +1,30 @@
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cmath>
 #include <expected>
+#include <format>
+#include <functional>
+#include <liberay/util/hash_combine.hpp>
 #include <liberay/util/logger.hpp>
 #include <liberay/util/panic.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/util/try.hpp>
 #include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/command_manager.hpp>
 #include <liberay/vkren/device.hpp>
+#include <liberay/vkren/gpu_profiler.hpp>
 #include <liberay/vkren/error.hpp>
 #include <liberay/vkren/image.hpp>
 #include <liberay/vkren/image_description.hpp>
 #include <liberay/vkren/render_graph.hpp>
+#include <liberay/vkren/wait_statistics.hpp>
 #include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
 #include <variant>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
@@ -57,6 +72,10 @@ RenderPassBuilder& RenderPassBuilder::with_buffer_dependency(ShaderStorageHandle
 RenderPassBuilder& RenderPassBuilder::with_color_attachment(RenderPassAttachmentHandle handle,
                                                             vk::AttachmentLoadOp load_op,
                                                             vk::AttachmentStoreOp store_op) {
+  if (render_pass_.color_attachments.full()) {
+    util::panic("Render pass supports at most {} color attachments", RenderPass::kMaxColorAttachments);
+  }
+
   render_pass_.color_attachments.emplace_back(RenderPassAttachmentImageInfo{
       .handle         = handle,
       .resolve_handle = std::nullopt,
@@ -74,6 +93,9 @@ RenderPassBuilder& RenderPassBuilder::with_msaa_color_attachment(RenderPassAttac
   if (render_pass_.samples != render_graph_->attachment(msaa_image_handle).samples) {
     util::panic("Render pass MSAA sample count does not match the color attachment sample count");
   }
+  if (render_pass_.color_attachments.full()) {
+    util::panic("Render pass supports at most {} color attachments", RenderPass::kMaxColorAttachments);
+  }
 
   render_pass_.color_attachments.emplace_back(RenderPassAttachmentImageInfo{
       .handle         = msaa_image_handle,
@@ -140,24 +162,87 @@ RenderPassBuilder& RenderPassBuilder::with_shader_storage(ShaderStorageHandle ha
   return *this;
 }
 
+RenderPassBuilder& RenderPassBuilder::with_view_mask(uint32_t view_mask) {
+  render_pass_.view_mask = view_mask;
+  return *this;
+}
+
+RenderPassBuilder& RenderPassBuilder::with_shading_rate_image(ShaderStorageHandle handle) {
+  if (handle.type() != ShaderStorageType::Image) {
+    util::panic("Shading rate image must be a shader storage image");
+  }
+
+  // The rate image is read by the rasterizer before the fragment shader
+  render_pass_.shading_rate_image = handle;
+  render_pass_.shader_storage_dependencies.emplace_back(ShaderStorageDependency{
+      .handle      = handle,
+      .stage_mask  = vk::PipelineStageFlagBits2::eFragmentShadingRateAttachmentKHR,
+      .access_mask = vk::AccessFlagBits2::eFragmentShadingRateAttachmentReadKHR,
+      .layout      = vk::ImageLayout::eFragmentShadingRateAttachmentOptimalKHR,
+  });
+  return *this;
+}
+
+RenderPassBuilder& RenderPassBuilder::with_local_read(RenderPassAttachmentHandle handle) {
+  // The dependency keeps the producer alive, the graph turns it into a regular read if the pass cannot be merged
+  render_pass_.local_reads.push_back(handle);
+  render_pass_.attachment_dependencies.emplace_back(RenderPassAttachmentDependency{
+      .handle      = handle,
+      .stage_mask  = vk::PipelineStageFlagBits2::eFragmentShader,
+      .access_mask = vk::AccessFlagBits2::eInputAttachmentRead,
+      .layout      = vk::ImageLayout::eRenderingLocalRead,
+  });
+  return *this;
+}
+
 RenderPassBuilder& RenderPassBuilder::run_on_request_only() {
   render_pass_.on_request_only = true;
   return *this;
 }
 
-RenderPassBuilder& RenderPassBuilder::on_emit(
-    const std::function<void(Device& device, vk::CommandBuffer& cmd_buff)>& emit_func) {
-  render_pass_.on_cmd_emit_func = emit_func;
+RenderPassBuilder& RenderPassBuilder::as_static(uint64_t key) {
+  render_pass_.static_key = key;
+  return *this;
+}
+
+RenderPassBuilder& RenderPassBuilder::with_name(std::string name) {
+  render_pass_.name = std::move(name);
+  return *this;
+}
+
+RenderPassBuilder& RenderPassBuilder::on_emit(PassEmitFunc emit_func) {
+  render_pass_.on_cmd_emit_func = std::move(emit_func);
   return *this;
 }
 
-RenderPassBuilder& RenderPassBuilder::on_emit(
-    const std::function<void(const RenderGraph& render_graph, vk::CommandBuffer& cmd_buff)>& emit_func) {
-  render_pass_.on_cmd_emit_func2 = emit_func;
+RenderPassBuilder& RenderPassBuilder::on_emit(PassGraphEmitFunc emit_func) {
+  render_pass_.on_cmd_emit_func2 = std::move(emit_func);
   return *this;
 }
 
 Result<ComputePassHandle, Error> ComputePassBuilder::build() {
+  if (compute_pass_.indirect_dispatch) {
+    const auto [args, offset] = *compute_pass_.indirect_dispatch;
+    const auto& buffers       = render_graph_->shader_storage_buffers_;
+    auto is_valid = args.type() != ShaderStorageType::Image && args.index() < buffers.size() && offset % 4 == 0;
+    if (is_valid) {
+      const auto& buffer = buffers[args.index()].buffer;
+      is_valid           = (buffer.usage & vk::BufferUsageFlagBits::eIndirectBuffer) &&
+                 offset + sizeof(vk::DispatchIndirectCommand) <= buffer.size_bytes;
+    }
+
+    if (!is_valid) {
+      util::Logger::err(
+          "Could not emplace a compute pass. The indirect dispatch arguments must be a 4-byte aligned "
+          "VkDispatchIndirectCommand in a shader storage buffer with the indirect buffer usage.");
+      compute_pass_ = ComputePass{};
+      return std::unexpected(Error{
+          .msg  = "Invalid indirect dispatch arguments",
+          .code = ErrorCode::InvalidRenderGraph{},
+      });
+    }
+  }
+
   auto handle   = render_graph_->emplace_compute_pass(std::move(compute_pass_));
   compute_pass_ = ComputePass{};
   return handle;
@@ -203,6 +288,29 @@ Result<RenderPassHandle, Error> RenderPassBuilder::build(uint32_t width, uint32_
     });
   }
 
+  // Every view is rendered to its own layer of all of the attachments
+  const auto view_count = static_cast<uint32_t>(std::bit_width(render_pass_.view_mask));
+  auto has_view_layers  = [this, view_count](RenderPassAttachmentHandle handle) {
+    return render_graph_->attachment(handle).view_count >= view_count;
+  };
+  auto has_views = std::ranges::all_of(render_pass_.color_attachments,
+                                       [&](const auto& c) {
+                                         return has_view_layers(c.handle) &&
+                                                (!c.resolve_handle || has_view_layers(*c.resolve_handle));
+                                       }) &&
+                   std::ranges::all_of(
+                       std::array{render_pass_.depth_stencil_attachment, render_pass_.depth_attachment,
+                                  render_pass_.stencil_attachment},
+                       [&](const auto& info) { return !info || has_view_layers(info->handle); });
+
+  if (!has_views) {
+    util::Logger::err("Could not emplace a render pass. Attachments have fewer layers than the views of the pass.");
+    return std::unexpected(Error{
+        .msg  = "Attachments have fewer layers than the views of the pass",
+        .code = ErrorCode::InvalidRenderPass{},
+    });
+  }
+
   render_pass_.extent.width  = width;
   render_pass_.extent.height = height;
 
@@ -211,6 +319,12 @@ Result<RenderPassHandle, Error> RenderPassBuilder::build(uint32_t width, uint32_
   return handle;
 }
 
+Result<RenderPassHandle, Error> RenderPassBuilder::build(RelativeExtent extent) {
+  auto size                    = render_graph_->extent(extent);
+  render_pass_.relative_extent = extent;
+  return build(size.width, size.height);
+}
+
 ComputePassBuilder& ComputePassBuilder::with_image_dependency(RenderPassAttachmentHandle handle,
                                                               vk::PipelineStageFlags2 stage_mask,
                                                               vk::AccessFlagBits2 access_mask, vk::ImageLayout layout) {
@@ -246,6 +360,17 @@ ComputePassBuilder& ComputePassBuilder::with_buffer_dependency(ShaderStorageHand
   return *this;
 }
 
+ComputePassBuilder& ComputePassBuilder::with_indirect_dispatch(ShaderStorageHandle args, vk::DeviceSize offset) {
+  compute_pass_.shader_storage_dependencies.emplace_back(ShaderStorageDependency{
+      .handle      = args,
+      .stage_mask  = vk::PipelineStageFlagBits2::eDrawIndirect,
+      .access_mask = vk::AccessFlagBits2::eIndirectCommandRead,
+      .layout      = vk::ImageLayout::eUndefined,
+  });
+  compute_pass_.indirect_dispatch = IndirectDispatch{.args = args, .offset = offset};
+  return *this;
+}
+
 ComputePassBuilder& ComputePassBuilder::with_shader_storage(ShaderStorageHandle handle) {
   compute_pass_.shader_storage.push_back(handle);
   return *this;
@@ -256,34 +381,105 @@ ComputePassBuilder& ComputePassBuilder::run_on_request_only() {
   return *this;
 }
 
-ComputePassBuilder& ComputePassBuilder::on_emit(
-    const std::function<void(Device& device, vk::CommandBuffer& cmd_buff)>& emit_func) {
-  compute_pass_.on_cmd_emit_func = emit_func;
+ComputePassBuilder& ComputePassBuilder::as_static(uint64_t key) {
+  compute_pass_.static_key = key;
+  return *this;
+}
+
+ComputePassBuilder& ComputePassBuilder::with_name(std::string name) {
+  compute_pass_.name = std::move(name);
+  return *this;
+}
+
+ComputePassBuilder& ComputePassBuilder::run_async() {
+  compute_pass_.async = true;
   return *this;
 }
 
-ComputePassBuilder& ComputePassBuilder::on_emit(
-    const std::function<void(const RenderGraph& device, vk::CommandBuffer& cmd_buff)>& emit_func) {
-  compute_pass_.on_cmd_emit_func2 = emit_func;
+ComputePassBuilder& ComputePassBuilder::on_emit(PassEmitFunc emit_func) {
+  compute_pass_.on_cmd_emit_func = std::move(emit_func);
   return *this;
 }
 
+ComputePassBuilder& ComputePassBuilder::on_emit(PassGraphEmitFunc emit_func) {
+  compute_pass_.on_cmd_emit_func2 = std::move(emit_func);
+  return *this;
+}
+
+namespace {
+
+/**
+ * @brief Names the image and the view of the attachment. Transient attachments have no image until they are realized.
+ *
+ */
+void apply_debug_name(const RenderPassAttachmentImage& img) {
+  if (img.name.empty() || !img.img.vk_image()) {
+    return;
+  }
+  img.img.set_debug_name(img.name);
+  img.img._p_device->set_object_name(*img.view, img.name);
+}
+
+constexpr std::array kDepthStencilFormats = {
+    vk::Format::eD32SfloatS8Uint,  // repeated intentionally, replaced by the requested format
+    vk::Format::eD32SfloatS8Uint,
+    vk::Format::eD24UnormS8Uint,
+};
+
+constexpr std::array kDepthFormats = {
+    vk::Format::eD32Sfloat,  // repeated intentionally, replaced by the requested format
+    vk::Format::eD32Sfloat,
+    vk::Format::eD16Unorm,
+};
+
+vk::Format find_color_attachment_format(Device& device, vk::Format format) {
+  if (!device.is_format_supported(format, vk::FormatFeatureFlagBits::eColorAttachment)) {
+    util::Logger::err("Requested format {} is not supported. Using default format (B8G8R8A8Srgb)",
+                      vk::to_string(format));
+    return vk::Format::eB8G8R8A8Srgb;
+  }
+  return format;
+}
+
+/**
+ * @brief Returns the requested format if it's supported, otherwise the first supported of the fallback formats.
+ *
+ */
+vk::Format find_depth_attachment_format(Device& device, std::optional<vk::Format> format,
+                                        std::array<vk::Format, 3> formats) {
+  vk::FormatFeatureFlags features = vk::FormatFeatureFlagBits::eDepthStencilAttachment;
+
+  if (format) {
+    formats[0] = *format;
+  }
+  std::optional<vk::Format> final_format = device.get_first_supported_format(formats, features);
+
+  if (!final_format) {
+    util::panic("Could not find a supported depth stencil format for this device.");
+  }
+  if (format && *final_format != *format) {
+    util::Logger::err("Requested depth stencil format {} is not supported. Default format will be used",
+                      vk::to_string(*format));
+  }
+
+  return *final_format;
+}
+
+}  // namespace
+
 RenderPassAttachmentHandle RenderGraph::create_color_attachment(Device& device, uint32_t width, uint32_t height,
                                                                 bool readable, vk::SampleCountFlagBits samples,
                                                                 vk::Format format) {
-  vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment;
+  // Any of the attachments might be read at the same pixel by a merged pass, see `RenderPassBuilder::with_local_read()`
+  vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment;
   if (readable) {
     usage |= vk::ImageUsageFlagBits::eSampled;
   } else {
     usage |= vk::ImageUsageFlagBits::eTransientAttachment;
   }
   auto aspect = vk::ImageAspectFlagBits::eColor;
+  format      = find_color_attachment_format(device, format);
 
-  if (!device.is_format_supported(format, vk::FormatFeatureFlagBits::eColorAttachment)) {
-    util::Logger::err("Requested format {} is not supported. Using default format (B8G8R8A8Srgb)",
-                      vk::to_string(format));
-    format = vk::Format::eB8G8R8A8Srgb;
-  }
   auto img = ImageResource::create_attachment_image(device, ImageDescription::image2d_desc(format, width, height),
                                                     usage, aspect, samples)
                  .or_panic("Could not create image attachment");
@@ -305,36 +501,18 @@ RenderPassAttachmentHandle RenderGraph::create_color_attachment(Device& device,
 RenderPassAttachmentHandle RenderGraph::create_depth_stencil_attachment(Device& device, uint32_t width, uint32_t height,
                                                                         bool readable, vk::SampleCountFlagBits samples,
                                                                         std::optional<vk::Format> format) {
-  vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+  vk::ImageUsageFlags usage =
+      vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eInputAttachment;
   if (readable) {
     usage |= vk::ImageUsageFlagBits::eSampled;
   } else {
     usage |= vk::ImageUsageFlagBits::eTransientAttachment;
   }
-  auto aspect = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
-
-  vk::FormatFeatureFlags features = vk::FormatFeatureFlagBits::eDepthStencilAttachment;
-
-  std::array formats = {
-      vk::Format::eD32SfloatS8Uint,  // repeated intentionally
-      vk::Format::eD32SfloatS8Uint,
-      vk::Format::eD24UnormS8Uint,
-  };
-  if (format) {
-    formats[0] = *format;
-  }
-  std::optional<vk::Format> final_format = device.get_first_supported_format(formats, features);
-
-  if (!final_format) {
-    util::panic("Could not find a supported depth stencil format for this device.");
-  }
-  if (format && *final_format != *format) {
-    util::Logger::err("Requested depth stencil format {} is not supported. Default format will be used",
-                      vk::to_string(*format));
-  }
+  auto aspect       = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+  auto final_format = find_depth_attachment_format(device, format, kDepthStencilFormats);
 
   auto img = ImageResource::create_attachment_image(
-                 device, ImageDescription::image2d_desc(*final_format, width, height), usage, aspect, samples)
+                 device, ImageDescription::image2d_desc(final_format, width, height), usage, aspect, samples)
                  .or_panic("Could not create attachment image");
   auto view = img.create_image_view().or_panic("Could not create image view");
   depth_stencil_attachments_.emplace_back(RenderPassAttachmentImage{
@@ -352,36 +530,18 @@ RenderPassAttachmentHandle RenderGraph::create_depth_stencil_attachment(Device&
 RenderPassAttachmentHandle RenderGraph::create_depth_attachment(Device& device, uint32_t width, uint32_t height,
                                                                 bool readable, vk::SampleCountFlagBits samples,
                                                                 std::optional<vk::Format> format) {
-  vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+  vk::ImageUsageFlags usage =
+      vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eInputAttachment;
   if (readable) {
     usage |= vk::ImageUsageFlagBits::eSampled;
   } else {
     usage |= vk::ImageUsageFlagBits::eTransientAttachment;
   }
-  auto aspect = vk::ImageAspectFlagBits::eDepth;
-
-  vk::FormatFeatureFlags features = vk::FormatFeatureFlagBits::eDepthStencilAttachment;
-
-  std::array formats = {
-      vk::Format::eD32Sfloat,  // repeated intentionally
-      vk::Format::eD32Sfloat,
-      vk::Format::eD16Unorm,
-  };
-  if (format) {
-    formats[0] = *format;
-  }
-  std::optional<vk::Format> final_format = device.get_first_supported_format(formats, features);
-
-  if (!final_format) {
-    util::panic("Could not find a supported depth stencil format for this device.");
-  }
-  if (format && *final_format != *format) {
-    util::Logger::err("Requested depth stencil format {} is not supported. Default format will be used",
-                      vk::to_string(*format));
-  }
+  auto aspect       = vk::ImageAspectFlagBits::eDepth;
+  auto final_format = find_depth_attachment_format(device, format, kDepthFormats);
 
   auto img = ImageResource::create_attachment_image(
-                 device, ImageDescription::image2d_desc(*final_format, width, height), usage, aspect, samples)
+                 device, ImageDescription::image2d_desc(final_format, width, height), usage, aspect, samples)
                  .or_panic("Could not create attachment image");
   auto view = img.create_image_view().or_panic("Could not create image view");
   depth_attachments_.emplace_back(RenderPassAttachmentImage{
@@ -398,7 +558,8 @@ RenderPassAttachmentHandle RenderGraph::create_depth_attachment(Device& device,
 
 RenderPassAttachmentHandle RenderGraph::create_stencil_attachment(Device& device, uint32_t width, uint32_t height,
                                                                   bool readable, vk::SampleCountFlagBits samples) {
-  vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+  vk::ImageUsageFlags usage =
+      vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eInputAttachment;
   if (readable) {
     usage |= vk::ImageUsageFlagBits::eSampled;
   } else {
@@ -423,6 +584,152 @@ RenderPassAttachmentHandle RenderGraph::create_stencil_attachment(Device& device
   };
 }
 
+RenderPassAttachmentHandle RenderGraph::create_transient_attachment(Device& device, const ImageDescription& desc,
+                                                                    vk::ImageUsageFlags usage,
+                                                                    vk::ImageAspectFlags aspect,
+                                                                    vk::SampleCountFlagBits samples,
+                                                                    ImageAttachmentType type) {
+  // The image is created during compilation, when the lifetime of the attachment is known
+  auto placeholder = RenderPassAttachmentImage{
+      .img =
+          ImageResource{
+              ._image       = VmaRaiiImage(nullptr),
+              .description  = desc,
+              ._p_device    = &device,
+              .mip_levels   = 1,
+              .aspect       = aspect,
+              .usage        = usage,
+              .sample_count = samples,
+          },
+      .view            = nullptr,
+      .samples         = samples,
+      .transient_index = static_cast<uint32_t>(transient_attachments_.size()),
+  };
+
+  auto& attachments = type == ImageAttachmentType::Color          ? color_attachments_
+                      : type == ImageAttachmentType::DepthStencil ? depth_stencil_attachments_
+                      : type == ImageAttachmentType::Depth        ? depth_attachments_
+                                                                  : stencil_attachments_;
+  attachments.emplace_back(std::move(placeholder));
+
+  auto handle = RenderPassAttachmentHandle{static_cast<uint32_t>(attachments.size() - 1), type};
+  transient_attachments_.emplace_back(TransientAttachment{
+      .handle      = handle,
+      .description = desc,
+      .usage       = usage,
+      .aspect      = aspect,
+      .samples     = samples,
+      ._p_device   = &device,
+  });
+  dirty_ = true;
+
+  return handle;
+}
+
+RenderPassAttachmentHandle RenderGraph::create_transient_color_attachment(Device& device, uint32_t width,
+                                                                          uint32_t height,
+                                                                          vk::SampleCountFlagBits samples,
+                                                                          vk::Format format) {
+  format = find_color_attachment_format(device, format);
+  return create_transient_attachment(device, ImageDescription::image2d_desc(format, width, height),
+                                     vk::ImageUsageFlagBits::eColorAttachment |
+                                         vk::ImageUsageFlagBits::eInputAttachment,
+                                     vk::ImageAspectFlagBits::eColor, samples, ImageAttachmentType::Color);
+}
+
+RenderPassAttachmentHandle RenderGraph::create_transient_depth_stencil_attachment(Device& device, uint32_t width,
+                                                                                  uint32_t height,
+                                                                                  vk::SampleCountFlagBits samples,
+                                                                                  std::optional<vk::Format> format) {
+  auto final_format = find_depth_attachment_format(device, format, kDepthStencilFormats);
+  return create_transient_attachment(device, ImageDescription::image2d_desc(final_format, width, height),
+                                     vk::ImageUsageFlagBits::eDepthStencilAttachment |
+                                         vk::ImageUsageFlagBits::eInputAttachment,
+                                     vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil, samples,
+                                     ImageAttachmentType::DepthStencil);
+}
+
+RenderPassAttachmentHandle RenderGraph::create_transient_depth_attachment(Device& device, uint32_t width,
+                                                                          uint32_t height,
+                                                                          vk::SampleCountFlagBits samples,
+                                                                          std::optional<vk::Format> format) {
+  auto final_format = find_depth_attachment_format(device, format, kDepthFormats);
+  return create_transient_attachment(device, ImageDescription::image2d_desc(final_format, width, height),
+                                     vk::ImageUsageFlagBits::eDepthStencilAttachment |
+                                         vk::ImageUsageFlagBits::eInputAttachment,
+                                     vk::ImageAspectFlagBits::eDepth, samples, ImageAttachmentType::Depth);
+}
+
+vk::DeviceSize RenderGraph::transient_memory_size_bytes() const {
+  auto size = vk::DeviceSize{0};
+  for (const auto& memory : transient_memory_) {
+    size += memory.alloc_info().size;
+  }
+  return size;
+}
+
+RenderGraphExtentHandle RenderGraph::create_extent(uint32_t width, uint32_t height) {
+  extents_.emplace_back(vk::Extent2D{.width = width, .height = height});
+  render_scales_.push_back(1.F);
+  return RenderGraphExtentHandle{.index = static_cast<uint32_t>(extents_.size() - 1)};
+}
+
+void RenderGraph::resize_extent(RenderGraphExtentHandle handle, uint32_t width, uint32_t height) {
+  auto& extent = extents_[handle.index];
+  if (extent.width == width && extent.height == height) {
+    return;
+  }
+
+  extent          = vk::Extent2D{.width = width, .height = height};
+  resize_pending_ = true;
+  dirty_          = true;
+}
+
+vk::Extent2D RenderGraph::extent(RelativeExtent extent) const {
+  const auto& base  = extents_[extent.handle.index];
+  const auto scaled = [&extent](uint32_t size) {
+    return std::max(1U, static_cast<uint32_t>(std::lround(static_cast<float>(size) * extent.scale)));
+  };
+  return vk::Extent2D{.width = scaled(base.width), .height = scaled(base.height)};
+}
+
+void RenderGraph::set_render_scale(RenderGraphExtentHandle handle, float scale) {
+  // The render area is computed when the passes are emitted
+  render_scales_[handle.index] = std::clamp(scale, std::numeric_limits<float>::min(), 1.F);
+}
+
+vk::Extent2D RenderGraph::render_extent(RelativeExtent extent) const {
+  const auto size   = this->extent(extent);
+  const auto scale  = render_scales_[extent.handle.index];
+  const auto scaled = [scale](uint32_t size) {
+    return std::max(1U, static_cast<uint32_t>(std::lround(static_cast<float>(size) * scale)));
+  };
+  return vk::Extent2D{.width = scaled(size.width), .height = scaled(size.height)};
+}
+
+std::array<float, 2> RenderGraph::render_uv_scale(RelativeExtent extent) const {
+  const auto size   = this->extent(extent);
+  const auto render = render_extent(extent);
+  return {static_cast<float>(render.width) / static_cast<float>(size.width),
+          static_cast<float>(render.height) / static_cast<float>(size.height)};
+}
+
+vk::Extent2D RenderGraph::render_area(const RenderPass& render_pass) const {
+  return render_pass.relative_extent ? render_extent(*render_pass.relative_extent) : render_pass.extent;
+}
+
+void RenderGraph::bind_attachment_extent(RenderPassAttachmentHandle handle, RelativeExtent extent) {
+  attachment(handle).relative_extent = extent;
+  resize_pending_                    = true;
+  dirty_                             = true;
+}
+
+void RenderGraph::set_attachment_view_count(RenderPassAttachmentHandle handle, uint32_t view_count) {
+  attachment(handle).view_count = view_count;
+  resize_pending_               = true;
+  dirty_                        = true;
+}
+
 ShaderStorageHandle RenderGraph::create_shader_storage_buffer(Device& device, vk::DeviceSize size_bytes,
                                                               vk::BufferUsageFlagBits additional_usage_flags) {
   auto buffer =
@@ -485,6 +792,34 @@ ShaderStorageHandle RenderGraph::create_shader_storage_image(Device& device, con
   };
 }
 
+ShaderStorageHandle RenderGraph::create_shading_rate_image(Device& device, uint32_t width, uint32_t height) {
+  assert(device.has_fragment_shading_rate() && "VK_KHR_fragment_shading_rate is not enabled");
+
+  // Every texel size between the minimum and the maximum is valid, the smallest one gives the finest control
+  shading_rate_texel_size_ = device.fragment_shading_rate_properties().minFragmentShadingRateAttachmentTexelSize;
+
+  const auto desc = ImageDescription::image2d_desc(
+      vk::Format::eR8Uint, (width + shading_rate_texel_size_.width - 1) / shading_rate_texel_size_.width,
+      (height + shading_rate_texel_size_.height - 1) / shading_rate_texel_size_.height);
+  vk::ImageUsageFlags usage =
+      vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eFragmentShadingRateAttachmentKHR;
+
+  auto img = ImageResource::create_attachment_image(device, desc, usage, vk::ImageAspectFlagBits::eColor,
+                                                    vk::SampleCountFlagBits::e1)
+                 .or_panic("Could not create shading rate image");
+  auto view = img.create_image_view().or_panic("Could not create image view");
+
+  shader_storage_images_.emplace_back(ShaderStorageImage{
+      .img  = std::move(img),
+      .view = std::move(view),
+  });
+
+  return ShaderStorageHandle{
+      static_cast<uint32_t>(shader_storage_images_.size() - 1),
+      ShaderStorageType::Image,
+  };
+}
+
 RenderPassAttachmentHandle RenderGraph::emplace_attachment(ImageResource&& attachment, ImageAttachmentType type) {
   auto view = attachment.create_image_view().or_panic("Could not create image view");
   switch (type) {
@@ -535,6 +870,7 @@ RenderPassHandle RenderGraph::emplace_render_pass(RenderPass&& render_pass) {
   // It's impossible to create dependency cycles or provide incorrect ordering, because during render pass creation
   // client can only refer to already emplaced render passes (via handles).
   passes_.emplace_back(std::move(render_pass));
+  dirty_ = true;
 
   auto exists =
       (!render_pass.depth_attachment || render_pass.depth_attachment->handle.index() < depth_attachments_.size()) &&
@@ -549,6 +885,7 @@ RenderPassHandle RenderGraph::emplace_render_pass(RenderPass&& render_pass) {
     util::panic("Could not emplace a render pass. Attachment is not registered.");
   }
 
+  merge_into_rendering_scope(static_cast<uint32_t>(passes_.size() - 1));
   return RenderPassHandle{.index = static_cast<uint32_t>(passes_.size() - 1)};
 }
 
@@ -556,6 +893,7 @@ ComputePassHandle RenderGraph::emplace_compute_pass(ComputePass&& compute_pass)
   // It's impossible to create dependency cycles or provide incorrect ordering, because during render pass creation
   // client can only refer to already emplaced render passes (via handles).
   passes_.emplace_back(std::move(compute_pass));
+  dirty_ = true;
 
   auto exists = std::ranges::all_of(compute_pass.shader_storage, [this](auto& handle) {
     if (handle.type() == ShaderStorageType::Image) {
@@ -571,6 +909,230 @@ ComputePassHandle RenderGraph::emplace_compute_pass(ComputePass&& compute_pass)
   return ComputePassHandle{.index = static_cast<uint32_t>(passes_.size() - 1)};
 }
 
+namespace {
+
+uint32_t find_handle_index(std::span<const RenderPassAttachmentHandle> handles, RenderPassAttachmentHandle handle) {
+  auto it = std::ranges::find(handles, handle._value, &RenderPassAttachmentHandle::_value);
+  return it == handles.end() ? VK_ATTACHMENT_UNUSED : static_cast<uint32_t>(it - handles.begin());
+}
+
+/**
+ * @brief Attachment of the pass with the handle or null if the pass does not render to it.
+ *
+ */
+const RenderPassAttachmentImageInfo* find_attachment_info(const RenderPass& rp, RenderPassAttachmentHandle handle) {
+  for (const auto& color : rp.color_attachments) {
+    if (color.handle._value == handle._value) {
+      return &color;
+    }
+  }
+  for (const auto* info : {&rp.depth_stencil_attachment, &rp.depth_attachment, &rp.stencil_attachment}) {
+    if (*info && (*info)->handle._value == handle._value) {
+      return &**info;
+    }
+  }
+  return nullptr;
+}
+
+bool same_render_area(const RenderPass& a, const RenderPass& b) {
+  if (a.relative_extent && b.relative_extent) {
+    return a.relative_extent->handle.index == b.relative_extent->handle.index &&
+           a.relative_extent->scale == b.relative_extent->scale;
+  }
+  return !a.relative_extent && !b.relative_extent && a.extent == b.extent;
+}
+
+}  // namespace
+
+bool RenderingScope::is_local_read(RenderPassAttachmentHandle handle) const {
+  return find_handle_index(local_reads, handle) != VK_ATTACHMENT_UNUSED;
+}
+
+util::InplaceVector<uint32_t, RenderPass::kMaxColorAttachments> RenderingScope::color_attachment_locations(
+    const RenderPass& render_pass) const {
+  auto pass_handles = util::InplaceVector<RenderPassAttachmentHandle, RenderPass::kMaxColorAttachments>();
+  for (const auto& color : render_pass.color_attachments) {
+    pass_handles.push_back(color.handle);
+  }
+
+  auto locations = util::InplaceVector<uint32_t, RenderPass::kMaxColorAttachments>();
+  for (auto handle : color_attachments) {
+    locations.push_back(find_handle_index(pass_handles, handle));
+  }
+  return locations;
+}
+
+util::InplaceVector<uint32_t, RenderPass::kMaxColorAttachments> RenderingScope::color_attachment_input_indices(
+    const RenderPass& render_pass) const {
+  auto indices = util::InplaceVector<uint32_t, RenderPass::kMaxColorAttachments>();
+  for (auto handle : color_attachments) {
+    indices.push_back(find_handle_index(render_pass.local_reads, handle));
+  }
+  return indices;
+}
+
+uint32_t RenderingScope::depth_input_index(const RenderPass& render_pass) const {
+  return depth_attachment ? find_handle_index(render_pass.local_reads, *depth_attachment) : VK_ATTACHMENT_UNUSED;
+}
+
+uint32_t RenderingScope::stencil_input_index(const RenderPass& render_pass) const {
+  if (stencil_attachment) {
+    return find_handle_index(render_pass.local_reads, *stencil_attachment);
+  }
+  if (depth_attachment && depth_attachment->type() == ImageAttachmentType::DepthStencil) {
+    return find_handle_index(render_pass.local_reads, *depth_attachment);
+  }
+  return VK_ATTACHMENT_UNUSED;
+}
+
+void RenderGraph::merge_into_rendering_scope(uint32_t pass_index) {
+  auto& rp = std::get<RenderPass>(passes_[pass_index]);
+  if (rp.local_reads.empty()) {
+    return;
+  }
+
+  auto* prev = pass_index > 0 ? std::get_if<RenderPass>(&passes_[pass_index - 1]) : nullptr;
+  auto scope = RenderingScope{};
+  if (prev != nullptr && prev->rendering_scope) {
+    scope = rendering_scopes_[*prev->rendering_scope];
+  } else if (prev != nullptr) {
+    scope.first_pass_index = pass_index - 1;
+    for (const auto& color : prev->color_attachments) {
+      scope.color_attachments.push_back(color.handle);
+    }
+    if (prev->depth_stencil_attachment) {
+      scope.depth_attachment = prev->depth_stencil_attachment->handle;
+    } else if (prev->depth_attachment) {
+      scope.depth_attachment = prev->depth_attachment->handle;
+    }
+    if (prev->stencil_attachment) {
+      scope.stencil_attachment = prev->stencil_attachment->handle;
+    }
+  }
+
+  // The merged pass may only read the attachments of the scope at the same pixel and continue rendering to them. The
+  // resolves happen at the end of the rendering, so the passes with MSAA resolves are never merged.
+  auto is_scope_attachment = [&scope](RenderPassAttachmentHandle handle) {
+    return find_handle_index(scope.color_attachments, handle) != VK_ATTACHMENT_UNUSED ||
+           (scope.depth_attachment && scope.depth_attachment->_value == handle._value) ||
+           (scope.stencil_attachment && scope.stencil_attachment->_value == handle._value);
+  };
+  auto continues_attachment = [&](const std::optional<RenderPassAttachmentImageInfo>& info,
+                                  const std::optional<RenderPassAttachmentHandle>& scope_handle) {
+    return !info || !scope_handle ||
+           (scope_handle->_value == info->handle._value && info->load_op == vk::AttachmentLoadOp::eLoad);
+  };
+  auto has_resolve = [](const RenderPass& pass) {
+    return std::ranges::any_of(pass.color_attachments, [](const auto& c) { return c.resolve_handle.has_value(); });
+  };
+  auto new_color_count = std::ranges::count_if(rp.color_attachments, [&](const auto& c) {
+    return find_handle_index(scope.color_attachments, c.handle) == VK_ATTACHMENT_UNUSED;
+  });
+
+  const auto mergeable =
+      pass_merging_enabled_ && prev != nullptr && prev->samples == rp.samples && same_render_area(*prev, rp) &&
+      prev->view_mask == rp.view_mask &&
+      prev->shading_rate_image.has_value() == rp.shading_rate_image.has_value() &&
+      (!rp.shading_rate_image || prev->shading_rate_image->_value == rp.shading_rate_image->_value) &&
+      !has_resolve(*prev) && !has_resolve(rp) && rp.shader_storage.empty() &&
+      std::ranges::all_of(rp.shader_storage_dependencies,
+                          [&rp](const auto& dep) {
+                            return rp.shading_rate_image && dep.handle._value == rp.shading_rate_image->_value;
+                          }) &&
+      std::ranges::all_of(rp.attachment_dependencies,
+                          [&](const auto& dep) {
+                            return find_handle_index(rp.local_reads, dep.handle) != VK_ATTACHMENT_UNUSED &&
+                                   is_scope_attachment(dep.handle);
+                          }) &&
+      std::ranges::all_of(rp.color_attachments,
+                          [&](const auto& c) {
+                            return find_handle_index(scope.color_attachments, c.handle) == VK_ATTACHMENT_UNUSED ||
+                                   c.load_op == vk::AttachmentLoadOp::eLoad;
+                          }) &&
+      scope.color_attachments.size() + new_color_count <= RenderPass::kMaxColorAttachments &&
+      continues_attachment(rp.depth_stencil_attachment, scope.depth_attachment) &&
+      continues_attachment(rp.depth_attachment, scope.depth_attachment) &&
+      continues_attachment(rp.stencil_attachment, scope.stencil_attachment);
+
+  if (!mergeable) {
+    // The pass is rendered on its own, it reads the attachments from the memory like with a regular image dependency
+    for (auto& dep : rp.attachment_dependencies) {
+      if (find_handle_index(rp.local_reads, dep.handle) != VK_ATTACHMENT_UNUSED) {
+        dep.access_mask = vk::AccessFlagBits2::eShaderSampledRead;
+        dep.layout      = vk::ImageLayout::eReadOnlyOptimal;
+      }
+    }
+    rp.local_reads.clear();
+    return;
+  }
+
+  for (const auto& color : rp.color_attachments) {
+    if (find_handle_index(scope.color_attachments, color.handle) == VK_ATTACHMENT_UNUSED) {
+      scope.color_attachments.push_back(color.handle);
+    }
+  }
+  if (!scope.depth_attachment && rp.depth_stencil_attachment) {
+    scope.depth_attachment = rp.depth_stencil_attachment->handle;
+  } else if (!scope.depth_attachment && rp.depth_attachment) {
+    scope.depth_attachment = rp.depth_attachment->handle;
+  }
+  if (!scope.stencil_attachment && rp.stencil_attachment) {
+    scope.stencil_attachment = rp.stencil_attachment->handle;
+  }
+  for (auto handle : rp.local_reads) {
+    if (!scope.is_local_read(handle)) {
+      scope.local_reads.push_back(handle);
+    }
+  }
+  scope.last_pass_index = pass_index;
+
+  if (prev->rendering_scope) {
+    rendering_scopes_[*prev->rendering_scope] = std::move(scope);
+  } else {
+    prev->rendering_scope = static_cast<uint32_t>(rendering_scopes_.size());
+    rendering_scopes_.emplace_back(std::move(scope));
+  }
+  rp.rendering_scope = prev->rendering_scope;
+}
+
+bool RenderGraph::is_rendering_scope_intermediate(const RenderingScope& scope,
+                                                  RenderPassAttachmentHandle handle) const {
+  // Only the attachments read locally are known to be consumed inside of the scope
+  if (!scope.is_local_read(handle)) {
+    return false;
+  }
+
+  if (std::ranges::any_of(final_pass_attachments_dependencies_,
+                          [handle](const auto& dep) { return dep.handle._value == handle._value; })) {
+    return false;
+  }
+
+  // The passes outside of the scope might read the attachment later in the frame or in the next one
+  for (auto i = 0U; i < passes_.size(); ++i) {
+    if (i >= scope.first_pass_index && i <= scope.last_pass_index) {
+      continue;
+    }
+    auto reads = std::visit(
+        [handle](const auto& p) {
+          return std::ranges::any_of(p.attachment_dependencies,
+                                     [handle](const auto& dep) { return dep.handle._value == handle._value; });
+        },
+        passes_[i]);
+    if (const auto* rp = std::get_if<RenderPass>(&passes_[i])) {
+      const auto* info = find_attachment_info(*rp, handle);
+      reads = reads || (info != nullptr && info->load_op == vk::AttachmentLoadOp::eLoad);
+    }
+    if (reads) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const RenderingScope* RenderGraph::rendering_scope(const RenderPass& render_pass) const {
+  return render_pass.rendering_scope ? &rendering_scopes_[*render_pass.rendering_scope] : nullptr;
+}
+
 void RenderGraph::for_each_attachment(const std::function<void(RenderPassAttachmentImage& attachment_image)>& action) {
   for (auto& img_info : color_attachments_) {
     action(img_info);
@@ -656,436 +1218,2033 @@ vk::BufferMemoryBarrier2 RenderGraph::create_dependency_storage_buffer_barrier(S
   };
 }
 
-void RenderGraph::emit(Device& device, vk::CommandBuffer& cmd_buff) {
-  if (passes_.empty()) {
-    return;
-  }
+namespace {
+
+constexpr auto kWriteAccessMask =
+    vk::AccessFlagBits2::eShaderWrite | vk::AccessFlagBits2::eShaderStorageWrite |
+    vk::AccessFlagBits2::eColorAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+    vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eHostWrite | vk::AccessFlagBits2::eMemoryWrite;
+
+/**
+ * @brief True if the access only reads the resource and the last write has already been made visible to the stage and
+ * the access by one of the previous barriers, i.e. no barrier is required.
+ *
+ */
+template <typename TResourceInfo>
+bool is_visible_read(const TResourceInfo& info, vk::PipelineStageFlags2 dst_stage_mask,
+                     vk::AccessFlags2 dst_access_mask) {
+  return !(dst_access_mask & kWriteAccessMask) && !(dst_stage_mask & ~info.visible_stage_mask) &&
+         !(dst_access_mask & ~info.visible_access_mask);
+}
 
-  const auto dependency_attachment_image_barrier = [this](std::vector<vk::ImageMemoryBarrier2>& barriers,
-                                                          const RenderPassAttachmentDependency& dep) {
+/**
+ * @brief Updates the synchronization state of the resource after it has been accessed.
+ *
+ */
+template <typename TResourceInfo>
+void track_access(TResourceInfo& info, vk::PipelineStageFlags2 dst_stage_mask, vk::AccessFlags2 dst_access_mask,
+                  bool layout_changed) {
+  if (dst_access_mask & kWriteAccessMask) {
+    // The next access waits for the write, which is not visible to anyone yet
+    info.src_stage_mask      = dst_stage_mask;
+    info.src_access_mask     = dst_access_mask;
+    info.visible_stage_mask  = vk::PipelineStageFlagBits2::eNone;
+    info.visible_access_mask = vk::AccessFlagBits2::eNone;
+  } else if (layout_changed) {
+    // The layout transition happens before the read, so the next access only has to wait for the reader
+    info.src_stage_mask      = dst_stage_mask;
+    info.visible_stage_mask  = dst_stage_mask;
+    info.visible_access_mask = dst_access_mask;
+  } else {
+    // Subsequent writes must wait for all of the readers (write-after-read)
+    info.src_stage_mask |= dst_stage_mask;
+    info.visible_stage_mask |= dst_stage_mask;
+    info.visible_access_mask |= dst_access_mask;
+  }
+}
+
+/**
+ * @brief Appends the barrier required before the image is accessed, read-after-read accesses in the same layout are
+ * skipped.
+ *
+ */
+template <typename TImageInfo>
+void append_image_transition(std::vector<vk::ImageMemoryBarrier2>& barriers, TImageInfo& img_info,
+                             vk::ImageSubresourceRange range, vk::PipelineStageFlags2 dst_stage_mask,
+                             vk::AccessFlags2 dst_access_mask, vk::ImageLayout dst_layout) {
+  const auto layout_changed = img_info.src_layout != dst_layout;
+  if (!layout_changed && is_visible_read(img_info, dst_stage_mask, dst_access_mask)) {
+    track_access(img_info, dst_stage_mask, dst_access_mask, false);
+    return;
+  }
+
+  barriers.emplace_back(vk::ImageMemoryBarrier2{
+      .srcStageMask        = img_info.src_stage_mask,
+      .srcAccessMask       = img_info.src_access_mask,
+      .dstStageMask        = dst_stage_mask,
+      .dstAccessMask       = dst_access_mask,
+      .oldLayout           = img_info.src_layout,
+      .newLayout           = dst_layout,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image               = img_info.img.vk_image(),
+      .subresourceRange    = range,
+  });
+  track_access(img_info, dst_stage_mask, dst_access_mask, layout_changed);
+  img_info.src_layout = dst_layout;
+}
+
+template <typename TPass>
+void invoke_emit_funcs(const TPass& pass, Device& device, const RenderGraph& render_graph,
+                       vk::CommandBuffer& cmd_buff) {
+  if (pass.on_cmd_emit_func) {
+    pass.on_cmd_emit_func(device, cmd_buff);
+  }
+  if (pass.on_cmd_emit_func2) {
+    pass.on_cmd_emit_func2(render_graph, cmd_buff);
+  }
+  if constexpr (std::is_same_v<TPass, ComputePass>) {
+    if (pass.indirect_dispatch) {
+      const auto& args = render_graph.shader_storage_buffer(pass.indirect_dispatch->args);
+      cmd_buff.dispatchIndirect(args.buffer.vk_buffer(), pass.indirect_dispatch->offset);
+      device.statistics().count_dispatches();
+    }
+  }
+}
+
+/**
+ * @brief Makes the attachment writes of the preceding passes of a rendering scope visible to the local reads of the
+ * next one. Inside of the rendering only the framebuffer-local dependencies are allowed.
+ *
+ */
+void emit_local_read_barrier(vk::CommandBuffer& cmd_buff) {
+  auto barrier = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eColorAttachmentOutput |
+                      vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+      .srcAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eFragmentShader,
+      .dstAccessMask = vk::AccessFlagBits2::eInputAttachmentRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .dependencyFlags    = vk::DependencyFlagBits::eByRegion,
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers    = &barrier,
+  });
+}
+
+void set_full_viewport(vk::CommandBuffer& cmd_buff, vk::Extent2D extent) {
+  cmd_buff.setScissor(0, vk::Rect2D{.offset = vk::Offset2D{.x = 0, .y = 0}, .extent = extent});
+  cmd_buff.setViewport(0,
+                       vk::Viewport{
+                           .x      = 0.0F,
+                           .y      = 0.0F,
+                           .width  = static_cast<float>(extent.width),
+                           .height = static_cast<float>(extent.height),
+                           // Note: min and max depth must be between [0.0F, 1.0F] and min might be higher than max.
+                           .minDepth = 0.0F,
+                           .maxDepth = 1.0F  //
+                       });
+}
+
+}  // namespace
+
+bool RenderGraph::is_pass_active(const std::variant<RenderPass, ComputePass>& pass) {
+  return std::visit([](const auto& p) { return !p.on_request_only || p.requested; }, pass);
+}
+
+bool RenderGraph::is_compiled_graph_outdated() const {
+  if (dirty_ || compiled_.active_passes.size() != passes_.size()) {
+    return true;
+  }
+
+  for (auto i = 0U; i < passes_.size(); ++i) {
+    if (compiled_.active_passes[i] != is_pass_active(passes_[i])) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+RenderGraphTopology RenderGraphTopology::create(std::vector<uint32_t>&& values) {
+  auto topology  = RenderGraphTopology{.values = std::move(values)};
+  topology._hash = topology.generate_hash();
+  return topology;
+}
+
+size_t RenderGraphTopology::generate_hash() const {
+  auto result = std::hash<size_t>()(values.size());
+  for (auto value : values) {
+    util::hash_combine(result, value);
+  }
+  return result;
+}
+
+RenderGraphTopology RenderGraph::topology() const {
+  auto values    = std::vector<uint32_t>();
+  auto push_mask = [&values](uint64_t mask) {
+    values.push_back(static_cast<uint32_t>(mask));
+    values.push_back(static_cast<uint32_t>(mask >> 32));
+  };
+
+  values.push_back(async_compute_queue_family_);
+
+  values.push_back(static_cast<uint32_t>(passes_.size()));
+  for (const auto& pass : passes_) {
+    values.push_back(is_pass_active(pass) ? 1U : 0U);
+  }
+
+  // Reallocated images bump the generation, the compiled barriers and attachment infos refer to the old ones
+  for (const auto* attachments : {&color_attachments_, &depth_attachments_, &stencil_attachments_,
+                                  &depth_stencil_attachments_}) {
+    values.push_back(static_cast<uint32_t>(attachments->size()));
+    for (const auto& img_info : *attachments) {
+      values.push_back(img_info.generation);
+    }
+  }
+  values.push_back(static_cast<uint32_t>(shader_storage_buffers_.size()));
+  values.push_back(static_cast<uint32_t>(shader_storage_images_.size()));
+
+  for (auto extent : extents_) {
+    values.push_back(extent.width);
+    values.push_back(extent.height);
+  }
+
+  values.push_back(static_cast<uint32_t>(final_pass_attachments_dependencies_.size()));
+  for (const auto& dep : final_pass_attachments_dependencies_) {
+    values.push_back(dep.handle._value);
+    push_mask(static_cast<uint64_t>(dep.stage_mask));
+    push_mask(static_cast<uint64_t>(dep.access_mask));
+    values.push_back(static_cast<uint32_t>(dep.layout));
+  }
+  values.push_back(static_cast<uint32_t>(final_pass_storage_dependencies_.size()));
+  for (const auto& dep : final_pass_storage_dependencies_) {
+    values.push_back(dep.handle._value);
+    push_mask(static_cast<uint64_t>(dep.stage_mask));
+    push_mask(static_cast<uint64_t>(dep.access_mask));
+    values.push_back(static_cast<uint32_t>(dep.layout));
+  }
+
+  return RenderGraphTopology::create(std::move(values));
+}
+
+std::vector<RenderGraphResourceState> RenderGraph::save_resource_states() {
+  auto states = std::vector<RenderGraphResourceState>();
+  auto save   = [&states](const auto& info, vk::ImageLayout layout) {
+    states.push_back(RenderGraphResourceState{
+        .src_stage_mask      = info.src_stage_mask,
+        .src_access_mask     = info.src_access_mask,
+        .src_layout          = layout,
+        .visible_stage_mask  = info.visible_stage_mask,
+        .visible_access_mask = info.visible_access_mask,
+    });
+  };
+
+  for_each_attachment([&save](RenderPassAttachmentImage& img_info) { save(img_info, img_info.src_layout); });
+  for_each_shader_storage_image([&save](ShaderStorageImage& img_info) { save(img_info, img_info.src_layout); });
+  for_each_shader_storage_buffer([&save](ShaderStorageBuffer& buff) { save(buff, vk::ImageLayout::eUndefined); });
+
+  return states;
+}
+
+void RenderGraph::restore_resource_states(std::span<const RenderGraphResourceState> states) {
+  auto next    = states.begin();
+  auto restore = [&next](auto& info) -> const RenderGraphResourceState& {
+    const auto& state        = *next++;
+    info.src_stage_mask      = state.src_stage_mask;
+    info.src_access_mask     = state.src_access_mask;
+    info.visible_stage_mask  = state.visible_stage_mask;
+    info.visible_access_mask = state.visible_access_mask;
+    return state;
+  };
+
+  for_each_attachment(
+      [&restore](RenderPassAttachmentImage& img_info) { img_info.src_layout = restore(img_info).src_layout; });
+  for_each_shader_storage_image(
+      [&restore](ShaderStorageImage& img_info) { img_info.src_layout = restore(img_info).src_layout; });
+  for_each_shader_storage_buffer([&restore](ShaderStorageBuffer& buff) { restore(buff); });
+}
+
+bool RenderGraph::restore_cached_compilation(const RenderGraphTopology& topology) {
+  auto it = std::ranges::find(compilation_cache_, topology, &CompiledRenderGraphCacheEntry::topology);
+  if (it == compilation_cache_.end()) {
+    return false;
+  }
+
+  // Move the entry to the front, so that the least recently used one is always the last
+  std::rotate(compilation_cache_.begin(), it, it + 1);
+  const auto& entry = compilation_cache_.front();
+  compiled_         = entry.compiled;
+  restore_resource_states(entry.resource_states);
+  return true;
+}
+
+void RenderGraph::cache_compilation(RenderGraphTopology&& topology) {
+  if (compilation_cache_capacity_ == 0) {
+    return;
+  }
+
+  if (compilation_cache_.size() >= compilation_cache_capacity_) {
+    compilation_cache_.pop_back();
+  }
+  compilation_cache_.insert(compilation_cache_.begin(), CompiledRenderGraphCacheEntry{
+                                                            .topology        = std::move(topology),
+                                                            .compiled        = compiled_,
+                                                            .resource_states = save_resource_states(),
+                                                        });
+}
+
+void RenderGraph::set_compilation_cache_capacity(uint32_t capacity) {
+  compilation_cache_capacity_ = capacity;
+  if (compilation_cache_.size() > capacity) {
+    compilation_cache_.resize(capacity);
+  }
+}
+
+std::vector<bool> RenderGraph::find_live_passes() const {
+  auto live                 = std::vector<bool>(passes_.size(), false);
+  auto consumed_attachments = std::unordered_set<uint32_t>();
+  auto consumed_storage     = std::unordered_set<uint32_t>();
+
+  auto consume = [&](std::span<const RenderPassAttachmentDependency> attachment_dependencies,
+                     std::span<const ShaderStorageDependency> storage_dependencies) {
+    for (const auto& dep : attachment_dependencies) {
+      consumed_attachments.insert(dep.handle._value);
+    }
+    for (const auto& dep : storage_dependencies) {
+      consumed_storage.insert(dep.handle._value);
+    }
+  };
+  auto is_consumed         = [&](RenderPassAttachmentHandle handle) {
+    return consumed_attachments.contains(handle._value);
+  };
+  auto is_storage_consumed = [&](std::span<const ShaderStorageHandle> handles) {
+    return std::ranges::any_of(handles, [&](auto h) { return consumed_storage.contains(h._value); });
+  };
+
+  consume(final_pass_attachments_dependencies_, final_pass_storage_dependencies_);
+
+  // Consumers are always emplaced after their producers, so a single backward walk over the insertion order finds all
+  // of the live passes. The outputs are never removed from the consumed sets, as the passes might load the previous
+  // content (e.g. load op or read-write shader storage).
+  for (auto i = passes_.size(); i > 0; --i) {
+    const auto& pass = passes_[i - 1];
+    if (!is_pass_active(pass)) {
+      continue;
+    }
+
+    auto requested                = std::visit([](const auto& p) { return p.on_request_only; }, pass);
+    auto produces_consumed_output = false;
+    if (const auto* rp = std::get_if<RenderPass>(&pass)) {
+      produces_consumed_output =
+          is_storage_consumed(rp->shader_storage) ||
+          std::ranges::any_of(rp->color_attachments,
+                              [&](const auto& color) {
+                                return is_consumed(color.handle) ||
+                                       (color.resolve_handle && is_consumed(*color.resolve_handle));
+                              }) ||
+          (rp->depth_stencil_attachment && is_consumed(rp->depth_stencil_attachment->handle)) ||
+          (rp->depth_attachment && is_consumed(rp->depth_attachment->handle)) ||
+          (rp->stencil_attachment && is_consumed(rp->stencil_attachment->handle));
+    } else {
+      produces_consumed_output = is_storage_consumed(std::get<ComputePass>(pass).shader_storage);
+    }
+
+    if (!requested && !produces_consumed_output) {
+      continue;
+    }
+
+    live[i - 1] = true;
+    std::visit([&consume](const auto& p) { consume(p.attachment_dependencies, p.shader_storage_dependencies); }, pass);
+  }
+
+  return live;
+}
+
+std::vector<bool> RenderGraph::find_async_passes() {
+  auto async = std::vector<bool>(passes_.size(), false);
+  if (!is_async_compute_enabled()) {
+    return async;
+  }
+
+  auto storage_of = [](const auto& p) {
+    auto handles = std::vector<ShaderStorageHandle>(p.shader_storage.begin(), p.shader_storage.end());
+    for (const auto& dep : p.shader_storage_dependencies) {
+      handles.push_back(dep.handle);
+    }
+    return handles;
+  };
+
+  // An async pass must not wait for the graphics queue within the frame, so it's recorded on the graphics queue when
+  // any of its resources has already been used by a preceding graphics pass.
+  auto async_storage    = std::unordered_set<uint32_t>();
+  auto graphics_storage = std::unordered_set<uint32_t>();
+  for (auto i = 0U; i < passes_.size(); ++i) {
+    if (!compiled_.live_passes[i]) {
+      continue;
+    }
+
+    auto handles = std::visit(storage_of, passes_[i]);
+    if (const auto* cp = std::get_if<ComputePass>(&passes_[i]); cp && cp->async) {
+      auto independent = cp->attachment_dependencies.empty() && std::ranges::none_of(handles, [&](auto handle) {
+                           return graphics_storage.contains(handle._value);
+                         });
+      if (independent) {
+        async[i] = true;
+        for (auto handle : handles) {
+          if (async_storage.insert(handle._value).second) {
+            compiled_.async_shader_storage.push_back(handle);
+          }
+        }
+        continue;
+      }
+      util::Logger::warn("Async compute pass {} depends on the graphics queue and is recorded on it instead.", i);
+    }
+
+    for (auto handle : handles) {
+      graphics_storage.insert(handle._value);
+    }
+  }
+
+  // == Find the stages of the graphics queue that consume the async compute output ===================================
+  auto wait_stage_mask = vk::PipelineStageFlags2{vk::PipelineStageFlagBits2::eNone};
+  auto consume         = [&](std::span<const ShaderStorageDependency> dependencies) {
+    for (const auto& dep : dependencies) {
+      if (async_storage.contains(dep.handle._value)) {
+        wait_stage_mask |= dep.stage_mask;
+      }
+    }
+  };
+  for (auto i = 0U; i < passes_.size(); ++i) {
+    if (!compiled_.live_passes[i] || async[i]) {
+      continue;
+    }
+
+    std::visit(
+        [&](const auto& p) {
+          consume(p.shader_storage_dependencies);
+          if (std::ranges::any_of(p.shader_storage,
+                                  [&](auto handle) { return async_storage.contains(handle._value); })) {
+            wait_stage_mask |= vk::PipelineStageFlagBits2::eComputeShader;
+          }
+        },
+        passes_[i]);
+  }
+  consume(final_pass_storage_dependencies_);
+
+  if (wait_stage_mask) {
+    compiled_.async_wait_stage_mask = wait_stage_mask;
+  }
+
+  return async;
+}
+
+void RenderGraph::compile_queue_family_transfer(uint32_t src_queue_family, uint32_t dst_queue_family,
+                                                vk::PipelineStageFlags2 dst_stage_mask,
+                                                vk::AccessFlags2 dst_access_mask, CompiledBarrierBatch& release,
+                                                CompiledBarrierBatch& acquire) {
+  // Release and acquire barriers must specify the same queue families and layouts.
+  // https://docs.vulkan.org/spec/latest/chapters/synchronization.html#synchronization-queue-transfers
+  const auto transfer_layout = vk::ImageLayout::eGeneral;
+
+  for (auto is_release : {true, false}) {
+    auto batch = begin_barrier_batch();
+    for (auto handle : compiled_.async_shader_storage) {
+      if (handle.type() == ShaderStorageType::Image) {
+        auto& img_info = shader_storage_image(handle);
+        compiled_.image_barriers.emplace_back(vk::ImageMemoryBarrier2{
+            .srcStageMask        = is_release ? img_info.src_stage_mask : vk::PipelineStageFlagBits2::eNone,
+            .srcAccessMask       = is_release ? img_info.src_access_mask : vk::AccessFlagBits2::eNone,
+            .dstStageMask        = is_release ? vk::PipelineStageFlagBits2::eNone : dst_stage_mask,
+            .dstAccessMask       = is_release ? vk::AccessFlagBits2::eNone : dst_access_mask,
+            .oldLayout           = img_info.src_layout,
+            .newLayout           = transfer_layout,
+            .srcQueueFamilyIndex = src_queue_family,
+            .dstQueueFamilyIndex = dst_queue_family,
+            .image               = img_info.img.vk_image(),
+            .subresourceRange    = img_info.img.full_resource_range(),
+        });
+      } else {
+        const auto& buffer_info = shader_storage_buffer(handle);
+        compiled_.buffer_barriers.emplace_back(vk::BufferMemoryBarrier2{
+            .srcStageMask        = is_release ? buffer_info.src_stage_mask : vk::PipelineStageFlagBits2::eNone,
+            .srcAccessMask       = is_release ? buffer_info.src_access_mask : vk::AccessFlagBits2::eNone,
+            .dstStageMask        = is_release ? vk::PipelineStageFlagBits2::eNone : dst_stage_mask,
+            .dstAccessMask       = is_release ? vk::AccessFlagBits2::eNone : dst_access_mask,
+            .srcQueueFamilyIndex = src_queue_family,
+            .dstQueueFamilyIndex = dst_queue_family,
+            .buffer              = buffer_info.buffer.vk_buffer(),
+            .offset              = 0,
+            .size                = buffer_info.buffer.size_bytes,
+        });
+      }
+    }
+    end_barrier_batch(batch);
+    (is_release ? release : acquire) = batch;
+  }
+
+  for (auto handle : compiled_.async_shader_storage) {
+    // The acquire barrier makes the storage visible to the destination scope only
+    if (handle.type() == ShaderStorageType::Image) {
+      auto& img_info               = shader_storage_image(handle);
+      img_info.src_stage_mask      = dst_stage_mask;
+      img_info.src_access_mask     = dst_access_mask;
+      img_info.src_layout          = transfer_layout;
+      img_info.visible_stage_mask  = dst_stage_mask;
+      img_info.visible_access_mask = dst_access_mask & ~kWriteAccessMask;
+    } else {
+      auto& buffer_info               = shader_storage_buffer(handle);
+      buffer_info.src_stage_mask      = dst_stage_mask;
+      buffer_info.src_access_mask     = dst_access_mask;
+      buffer_info.visible_stage_mask  = dst_stage_mask;
+      buffer_info.visible_access_mask = dst_access_mask & ~kWriteAccessMask;
+    }
+  }
+}
+
+bool RenderGraph::validate_dependencies(std::span<const RenderPassAttachmentDependency> attachment_dependencies,
+                                        std::span<const ShaderStorageDependency> storage_dependencies) const {
+  auto attachment_exists = [this](RenderPassAttachmentHandle handle) {
+    switch (handle.type()) {
+      case eray::vkren::ImageAttachmentType::Color:
+        return handle.index() < color_attachments_.size();
+      case eray::vkren::ImageAttachmentType::Depth:
+        return handle.index() < depth_attachments_.size();
+      case eray::vkren::ImageAttachmentType::Stencil:
+        return handle.index() < stencil_attachments_.size();
+      case eray::vkren::ImageAttachmentType::DepthStencil:
+        return handle.index() < depth_stencil_attachments_.size();
+    };
+    return false;
+  };
+
+  auto storage_exists = [this](ShaderStorageHandle handle) {
+    if (handle.type() == ShaderStorageType::Image) {
+      return handle.index() < shader_storage_images_.size();
+    }
+    return handle.index() < shader_storage_buffers_.size();
+  };
+
+  return std::ranges::all_of(attachment_dependencies, [&](const auto& dep) { return attachment_exists(dep.handle); }) &&
+         std::ranges::all_of(storage_dependencies, [&](const auto& dep) { return storage_exists(dep.handle); });
+}
+
+CompiledBarrierBatch RenderGraph::begin_barrier_batch() const {
+  return CompiledBarrierBatch{
+      .image_barriers_offset  = static_cast<uint32_t>(compiled_.image_barriers.size()),
+      .image_barriers_count   = 0,
+      .buffer_barriers_offset = static_cast<uint32_t>(compiled_.buffer_barriers.size()),
+      .buffer_barriers_count  = 0,
+  };
+}
+
+void RenderGraph::end_barrier_batch(CompiledBarrierBatch& batch) const {
+  batch.image_barriers_count  = static_cast<uint32_t>(compiled_.image_barriers.size()) - batch.image_barriers_offset;
+  batch.buffer_barriers_count = static_cast<uint32_t>(compiled_.buffer_barriers.size()) - batch.buffer_barriers_offset;
+}
+
+void RenderGraph::compile_dependency_barriers(std::span<const RenderPassAttachmentDependency> attachment_dependencies,
+                                              std::span<const ShaderStorageDependency> storage_dependencies) {
+  for (const auto& dep : attachment_dependencies) {
     auto& img_info = attachment(dep.handle);
-    auto barrier   = vk::ImageMemoryBarrier2{
-          .srcStageMask        = img_info.src_stage_mask,
-          .srcAccessMask       = img_info.src_access_mask,
-          .dstStageMask        = dep.stage_mask,
-          .dstAccessMask       = dep.access_mask,
-          .oldLayout           = img_info.src_layout,
-          .newLayout           = dep.layout,
+    append_image_transition(compiled_.image_barriers, img_info, img_info.img.full_resource_range(), dep.stage_mask,
+                            dep.access_mask, dep.layout);
+  }
+
+  for (const auto& dep : storage_dependencies) {
+    if (dep.handle.type() == ShaderStorageType::Image) {
+      auto& img_info = shader_storage_image(dep.handle);
+      append_image_transition(compiled_.image_barriers, img_info, img_info.img.full_resource_range(), dep.stage_mask,
+                              dep.access_mask, dep.layout);
+    } else {
+      auto& buffer_info = shader_storage_buffer(dep.handle);
+      if (!is_visible_read(buffer_info, dep.stage_mask, dep.access_mask)) {
+        compiled_.buffer_barriers.emplace_back(
+            create_dependency_storage_buffer_barrier(dep.handle, dep.stage_mask, dep.access_mask));
+      }
+      track_access(buffer_info, dep.stage_mask, dep.access_mask, false);
+    }
+  }
+}
+
+void RenderGraph::compile_shader_storage_target_barriers(std::span<const ShaderStorageHandle> handles) {
+  auto dst_stage_mask  = vk::PipelineStageFlagBits2::eComputeShader;
+  auto dst_access_mask = vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eShaderStorageRead;
+
+  // https://vulkan.lunarg.com/doc/view/1.4.328.1/windows/antora/guide/latest/storage_image_and_texel_buffers.html#_synchronization_with_storage_images
+  auto dst_layout = vk::ImageLayout::eGeneral;
+
+  for (auto handle : handles) {
+    if (handle.type() == ShaderStorageType::Image) {
+      auto& img_info = shader_storage_images_[handle.index()];
+      append_image_transition(compiled_.image_barriers, img_info, img_info.img.full_resource_range(), dst_stage_mask,
+                              dst_access_mask, dst_layout);
+    } else {
+      auto& buffer_info = shader_storage_buffers_[handle.index()];
+      compiled_.buffer_barriers.emplace_back(vk::BufferMemoryBarrier2{
+          .srcStageMask        = buffer_info.src_stage_mask,
+          .srcAccessMask       = buffer_info.src_access_mask,
+          .dstStageMask        = dst_stage_mask,
+          .dstAccessMask       = dst_access_mask,
           .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
           .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-          .image               = img_info.img.vk_image(),  //
-          .subresourceRange    = img_info.img.full_resource_range(),
+          .buffer              = buffer_info.buffer.vk_buffer(),
+          .offset              = 0,
+          .size                = buffer_info.buffer.size_bytes,
+      });
+      track_access(buffer_info, dst_stage_mask, dst_access_mask, false);
+    }
+  }
+}
+
+void RenderGraph::compile_render_pass_attachments(const RenderPass& rp, CompiledPass& compiled_pass) {
+  const auto depth_stage_mask =
+      vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests;
+  const auto depth_access_mask =
+      vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentRead;
+  const auto color_stage_mask  = vk::PipelineStageFlagBits2::eColorAttachmentOutput;
+  const auto color_access_mask = vk::AccessFlagBits2::eColorAttachmentWrite;
+  const auto color_layout      = vk::ImageLayout::eColorAttachmentOptimal;
+
+  compiled_pass.color_attachments_offset = static_cast<uint32_t>(compiled_.color_attachment_infos.size());
+  compiled_pass.color_attachments_count  = static_cast<uint32_t>(rp.color_attachments.size());
+
+  for (const auto& c : rp.color_attachments) {
+    auto& color_img_info = color_attachments_[c.handle.index()];
+    const auto load_op   = inferred_load_op(compiled_pass.pass_index, c);
+
+    auto info = vk::RenderingAttachmentInfo{
+        .imageView   = vk::ImageView{color_img_info.view},
+        .imageLayout = color_layout,
+        .loadOp      = load_op,
+        .storeOp     = inferred_store_op(compiled_pass.pass_index, c),
+        .clearValue  = color_img_info.clear_color,
+    };
+    // Loading the previous content is a read of the attachment
+    auto access_mask = vk::AccessFlags2{color_access_mask};
+    if (load_op == vk::AttachmentLoadOp::eLoad) {
+      access_mask |= vk::AccessFlagBits2::eColorAttachmentRead;
+    }
+    append_image_transition(compiled_.image_barriers, color_img_info, color_img_info.img.full_resource_range(),
+                            color_stage_mask, access_mask, color_layout);
+
+    if (c.resolve_handle) {
+      // MSAA is enabled
+      auto& resolve_color_img_info = color_attachments_[c.resolve_handle->index()];
+      info.resolveMode             = vk::ResolveModeFlagBits::eAverage;
+      info.resolveImageView        = resolve_color_img_info.view;
+      info.resolveImageLayout      = color_layout;
+
+      append_image_transition(compiled_.image_barriers, resolve_color_img_info,
+                              resolve_color_img_info.img.full_resource_range(), color_stage_mask, color_access_mask,
+                              color_layout);
+    }
+
+    compiled_.color_attachment_infos.emplace_back(std::move(info));
+    compiled_.color_attachment_formats.emplace_back(color_img_info.img.description.format);
+  }
+
+  const auto compile_depth_or_stencil = [&](const RenderPassAttachmentImageInfo& a, vk::ImageLayout layout,
+                                            vk::ImageAspectFlags aspect) {
+    auto& img_info   = attachment(a.handle);
+    auto range       = img_info.img.full_resource_range();
+    range.aspectMask = aspect;
+    append_image_transition(compiled_.image_barriers, img_info, range, depth_stage_mask, depth_access_mask, layout);
+
+    return vk::RenderingAttachmentInfo{
+        .imageView   = vk::ImageView{img_info.view},
+        .imageLayout = layout,
+        .loadOp      = inferred_load_op(compiled_pass.pass_index, a),
+        .storeOp     = inferred_store_op(compiled_pass.pass_index, a),
+        .clearValue  = img_info.clear_depth_stencil,
+    };
+  };
+
+  compiled_pass.depth_attachment_info     = std::nullopt;
+  compiled_pass.stencil_attachment_info   = std::nullopt;
+  compiled_pass.depth_attachment_format   = vk::Format::eUndefined;
+  compiled_pass.stencil_attachment_format = vk::Format::eUndefined;
+
+  if (rp.depth_attachment) {
+    compiled_pass.depth_attachment_info = compile_depth_or_stencil(
+        *rp.depth_attachment, vk::ImageLayout::eDepthAttachmentOptimal, vk::ImageAspectFlagBits::eDepth);
+    compiled_pass.depth_attachment_format = attachment(rp.depth_attachment->handle).img.description.format;
+  }
+
+  if (rp.stencil_attachment) {
+    compiled_pass.stencil_attachment_info = compile_depth_or_stencil(
+        *rp.stencil_attachment, vk::ImageLayout::eStencilAttachmentOptimal, vk::ImageAspectFlagBits::eStencil);
+    compiled_pass.stencil_attachment_format = attachment(rp.stencil_attachment->handle).img.description.format;
+  }
+
+  if (rp.depth_stencil_attachment) {
+    compiled_pass.stencil_attachment_info   = std::nullopt;
+    compiled_pass.stencil_attachment_format = vk::Format::eUndefined;
+    compiled_pass.depth_attachment_info =
+        compile_depth_or_stencil(*rp.depth_stencil_attachment, vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                                 vk::ImageAspectFlagBits::eStencil | vk::ImageAspectFlagBits::eDepth);
+    compiled_pass.depth_attachment_format = attachment(rp.depth_stencil_attachment->handle).img.description.format;
+  }
+
+  // The transition of the rate image is compiled with the dependencies of the pass
+  compiled_pass.shading_rate_attachment_info = std::nullopt;
+  if (rp.shading_rate_image) {
+    compiled_pass.shading_rate_attachment_info = vk::RenderingFragmentShadingRateAttachmentInfoKHR{
+        .imageView                      = vk::ImageView{shader_storage_image(*rp.shading_rate_image).view},
+        .imageLayout                    = vk::ImageLayout::eFragmentShadingRateAttachmentOptimalKHR,
+        .shadingRateAttachmentTexelSize = shading_rate_texel_size_,
+    };
+  }
+}
+
+vk::AttachmentLoadOp RenderGraph::inferred_load_op(uint32_t pass_index,
+                                                   const RenderPassAttachmentImageInfo& info) const {
+  // Nothing has been written to the transient attachment in this frame yet, its content is undefined
+  const auto& transient_index = attachment(info.handle).transient_index;
+  if (info.load_op == vk::AttachmentLoadOp::eLoad && transient_index &&
+      transient_attachments_[*transient_index].first_use == pass_index) {
+    return vk::AttachmentLoadOp::eDontCare;
+  }
+  return info.load_op;
+}
+
+vk::AttachmentStoreOp RenderGraph::inferred_store_op(uint32_t pass_index,
+                                                     const RenderPassAttachmentImageInfo& info) const {
+  const auto& transient_index = attachment(info.handle).transient_index;
+  if (info.store_op != vk::AttachmentStoreOp::eStore || !transient_index) {
+    return info.store_op;
+  }
+
+  // Nothing reads the content after the pass, e.g. the samples of an MSAA attachment that is only resolved
+  const auto last_read = transient_attachments_[*transient_index].last_read;
+  if (last_read == TransientAttachment::kUnused || last_read <= pass_index) {
+    return vk::AttachmentStoreOp::eDontCare;
+  }
+  return vk::AttachmentStoreOp::eStore;
+}
+
+void RenderGraph::compile_rendering_scope_attachments(const RenderingScope& scope, uint32_t pass_index,
+                                                      CompiledPass& compiled_pass) {
+  // The rendering is shared by the recorded passes of the scope from this one on. The attachment is loaded like by the
+  // first of them that renders to it and stored like by the last one, the attachments read only inside of the scope
+  // are discarded, so on the tile-based GPUs they never leave the tile memory.
+  auto attachment_ops = [&](RenderPassAttachmentHandle handle) {
+    auto load_op  = vk::AttachmentLoadOp::eLoad;
+    auto store_op = vk::AttachmentStoreOp::eStore;
+    auto first    = true;
+    for (auto i = pass_index; i <= scope.last_pass_index; ++i) {
+      const auto* info =
+          compiled_.live_passes[i] ? find_attachment_info(std::get<RenderPass>(passes_[i]), handle) : nullptr;
+      if (info == nullptr) {
+        continue;
+      }
+      if (first) {
+        load_op = inferred_load_op(i, *info);
+        first   = false;
+      }
+      store_op = inferred_store_op(i, *info);
+    }
+    if (is_rendering_scope_intermediate(scope, handle)) {
+      store_op = vk::AttachmentStoreOp::eDontCare;
+    }
+    return std::pair(load_op, store_op);
+  };
+
+  // The attachments read locally stay in the local read layout, they are also read by the fragment shaders
+  auto add_local_read = [&scope](RenderPassAttachmentHandle handle, vk::ImageLayout& layout,
+                                 vk::PipelineStageFlags2& stage_mask, vk::AccessFlags2& access_mask) {
+    if (scope.is_local_read(handle)) {
+      layout = vk::ImageLayout::eRenderingLocalRead;
+      stage_mask |= vk::PipelineStageFlagBits2::eFragmentShader;
+      access_mask |= vk::AccessFlagBits2::eInputAttachmentRead;
+    }
+  };
+
+  compiled_pass.color_attachments_offset = static_cast<uint32_t>(compiled_.color_attachment_infos.size());
+  compiled_pass.color_attachments_count  = static_cast<uint32_t>(scope.color_attachments.size());
+
+  for (auto handle : scope.color_attachments) {
+    auto& color_img_info     = color_attachments_[handle.index()];
+    auto [load_op, store_op] = attachment_ops(handle);
+
+    auto layout      = vk::ImageLayout::eColorAttachmentOptimal;
+    auto stage_mask  = vk::PipelineStageFlags2{vk::PipelineStageFlagBits2::eColorAttachmentOutput};
+    auto access_mask = vk::AccessFlags2{vk::AccessFlagBits2::eColorAttachmentWrite};
+    if (load_op == vk::AttachmentLoadOp::eLoad) {
+      access_mask |= vk::AccessFlagBits2::eColorAttachmentRead;
+    }
+    add_local_read(handle, layout, stage_mask, access_mask);
+    append_image_transition(compiled_.image_barriers, color_img_info, color_img_info.img.full_resource_range(),
+                            stage_mask, access_mask, layout);
+
+    compiled_.color_attachment_infos.emplace_back(vk::RenderingAttachmentInfo{
+        .imageView   = vk::ImageView{color_img_info.view},
+        .imageLayout = layout,
+        .loadOp      = load_op,
+        .storeOp     = store_op,
+        .clearValue  = color_img_info.clear_color,
+    });
+    compiled_.color_attachment_formats.emplace_back(color_img_info.img.description.format);
+  }
+
+  const auto compile_depth_or_stencil = [&](RenderPassAttachmentHandle handle, vk::ImageLayout layout,
+                                            vk::ImageAspectFlags aspect) {
+    auto& img_info           = attachment(handle);
+    auto range               = img_info.img.full_resource_range();
+    range.aspectMask         = aspect;
+    auto [load_op, store_op] = attachment_ops(handle);
+
+    auto stage_mask = vk::PipelineStageFlags2{vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                                              vk::PipelineStageFlagBits2::eLateFragmentTests};
+    auto access_mask = vk::AccessFlags2{vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+                                        vk::AccessFlagBits2::eDepthStencilAttachmentRead};
+    add_local_read(handle, layout, stage_mask, access_mask);
+    append_image_transition(compiled_.image_barriers, img_info, range, stage_mask, access_mask, layout);
+
+    return vk::RenderingAttachmentInfo{
+        .imageView   = vk::ImageView{img_info.view},
+        .imageLayout = layout,
+        .loadOp      = load_op,
+        .storeOp     = store_op,
+        .clearValue  = img_info.clear_depth_stencil,
+    };
+  };
+
+  compiled_pass.depth_attachment_info     = std::nullopt;
+  compiled_pass.stencil_attachment_info   = std::nullopt;
+  compiled_pass.depth_attachment_format   = vk::Format::eUndefined;
+  compiled_pass.stencil_attachment_format = vk::Format::eUndefined;
+
+  if (scope.depth_attachment) {
+    const auto depth_stencil = scope.depth_attachment->type() == ImageAttachmentType::DepthStencil;
+    compiled_pass.depth_attachment_info = compile_depth_or_stencil(
+        *scope.depth_attachment,
+        depth_stencil ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eDepthAttachmentOptimal,
+        depth_stencil ? vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil
+                      : vk::ImageAspectFlags{vk::ImageAspectFlagBits::eDepth});
+    compiled_pass.depth_attachment_format = attachment(*scope.depth_attachment).img.description.format;
+  }
+
+  if (scope.stencil_attachment) {
+    compiled_pass.stencil_attachment_info = compile_depth_or_stencil(
+        *scope.stencil_attachment, vk::ImageLayout::eStencilAttachmentOptimal, vk::ImageAspectFlagBits::eStencil);
+    compiled_pass.stencil_attachment_format = attachment(*scope.stencil_attachment).img.description.format;
+  }
+
+  // The passes of a scope share the shading rate image
+  const auto& rp                             = std::get<RenderPass>(passes_[pass_index]);
+  compiled_pass.shading_rate_attachment_info = std::nullopt;
+  if (rp.shading_rate_image) {
+    compiled_pass.shading_rate_attachment_info = vk::RenderingFragmentShadingRateAttachmentInfoKHR{
+        .imageView                      = vk::ImageView{shader_storage_image(*rp.shading_rate_image).view},
+        .imageLayout                    = vk::ImageLayout::eFragmentShadingRateAttachmentOptimalKHR,
+        .shadingRateAttachmentTexelSize = shading_rate_texel_size_,
+    };
+  }
+}
+
+void RenderGraph::compile_attachment_locations(const RenderingScope& scope, const RenderPass& rp,
+                                               CompiledPass& compiled_pass) {
+  auto locations     = scope.color_attachment_locations(rp);
+  auto input_indices = scope.color_attachment_input_indices(rp);
+
+  compiled_pass.attachment_locations_offset = static_cast<uint32_t>(compiled_.color_attachment_locations.size());
+  compiled_.color_attachment_locations.insert(compiled_.color_attachment_locations.end(), locations.begin(),
+                                              locations.end());
+  compiled_.color_attachment_input_indices.insert(compiled_.color_attachment_input_indices.end(),
+                                                  input_indices.begin(), input_indices.end());
+  compiled_pass.depth_input_index   = scope.depth_input_index(rp);
+  compiled_pass.stencil_input_index = scope.stencil_input_index(rp);
+}
+
+Result<void, Error> RenderGraph::apply_pending_resizes() {
+  resize_pending_ = false;
+
+  for (auto& pass : passes_) {
+    if (auto* rp = std::get_if<RenderPass>(&pass); rp && rp->relative_extent) {
+      rp->extent = extent(*rp->relative_extent);
+    }
+  }
+
+  // The layers of the multiview attachments are reallocated like their size
+  auto target_description = [this](const RenderPassAttachmentImage& img_info) {
+    auto desc         = img_info.img.description;
+    desc.array_layers = img_info.view_count;
+    if (img_info.relative_extent) {
+      auto target = extent(*img_info.relative_extent);
+      desc.width  = target.width;
+      desc.height = target.height;
+    }
+    return desc;
+  };
+
+  auto resized = std::vector<RenderPassAttachmentImage*>();
+  for_each_attachment([&](RenderPassAttachmentImage& img_info) {
+    auto target = target_description(img_info);
+    if (img_info.img.description.width != target.width || img_info.img.description.height != target.height ||
+        img_info.img.description.array_layers != target.array_layers) {
+      resized.push_back(&img_info);
+    }
+  });
+
+  if (resized.empty()) {
+    return {};
+  }
+
+  // The old images might still be used by the frames in flight
+  {
+    const auto wait =
+        WaitScope(resized.front()->img._p_device->wait_statistics(), "Render graph resize", WaitKind::Stall);
+    (*resized.front()->img._p_device)->waitIdle();
+  }
+
+  for (auto* img_info : resized) {
+    auto desc = target_description(*img_info);
+
+    if (img_info->transient_index) {
+      // Transient images are recreated with the rest of the transient attachments, as the aliasing might change
+      auto& transient           = transient_attachments_[*img_info->transient_index];
+      transient.description     = desc;
+      transient.realized        = false;
+      img_info->img.description = desc;
+      continue;
+    }
+
+    img_info->view = nullptr;
+    TRY_UNWRAP_DEFINE(img, ImageResource::create_attachment_image(*img_info->img._p_device, desc, img_info->img.usage,
+                                                                  img_info->img.aspect, img_info->img.sample_count));
+    TRY_UNWRAP_DEFINE(view, img.create_image_view());
+    img_info->img  = std::move(img);
+    img_info->view = std::move(view);
+    ++img_info->generation;
+    apply_debug_name(*img_info);
+  }
+
+  return {};
+}
+
+Result<void, Error> RenderGraph::update_transient_attachments() {
+  auto previous = transient_attachments_;
+  for (auto& transient : transient_attachments_) {
+    transient.first_use = TransientAttachment::kUnused;
+    transient.last_use  = TransientAttachment::kUnused;
+    transient.last_read = TransientAttachment::kUnused;
+    transient.stored    = false;
+  }
+
+  // == Reads of the content, they decide the inferred store ops of the preceding writes ===============================
+  auto read = [this](RenderPassAttachmentHandle handle, uint32_t pass_index) {
+    if (const auto& transient_index = attachment(handle).transient_index) {
+      transient_attachments_[*transient_index].last_read = pass_index;
+    }
+  };
+  for (auto i = 0U; i < passes_.size(); ++i) {
+    std::visit(
+        [&read, i](const auto& p) {
+          for (const auto& dep : p.attachment_dependencies) {
+            read(dep.handle, i);
+          }
+        },
+        passes_[i]);
+
+    if (const auto* rp = std::get_if<RenderPass>(&passes_[i])) {
+      for (const auto& color : rp->color_attachments) {
+        if (color.load_op == vk::AttachmentLoadOp::eLoad) {
+          read(color.handle, i);
+        }
+      }
+      for (const auto& info : {rp->depth_stencil_attachment, rp->depth_attachment, rp->stencil_attachment}) {
+        if (info && info->load_op == vk::AttachmentLoadOp::eLoad) {
+          read(info->handle, i);
+        }
+      }
+    }
+  }
+  for (const auto& dep : final_pass_attachments_dependencies_) {
+    read(dep.handle, static_cast<uint32_t>(passes_.size()));
+  }
+
+  // == Lifetimes =====================================================================================================
+
+  // Passes are visited in the topological order, so the last visit determines the end of the lifetime. The lifetimes
+  // are computed for all of the passes (even the inactive ones), so that the memory layout stays stable between frames.
+  auto use = [this](RenderPassAttachmentHandle handle, uint32_t pass_index, bool stored) {
+    const auto& transient_index = attachment(handle).transient_index;
+    if (!transient_index) {
+      return;
+    }
+    auto& transient = transient_attachments_[*transient_index];
+    if (!transient.used()) {
+      transient.first_use = pass_index;
+    }
+    transient.last_use = pass_index;
+    transient.stored   = transient.stored || stored;
+  };
+
+  for (auto i = 0U; i < passes_.size(); ++i) {
+    const auto* rp    = std::get_if<RenderPass>(&passes_[i]);
+    const auto* scope = rp != nullptr ? rendering_scope(*rp) : nullptr;
+
+    // The attachments of a rendering scope are alive during the whole scope, the ones read only inside of it are never
+    // stored, so they might be lazily allocated
+    auto discarded = [this, scope](RenderPassAttachmentHandle handle) {
+      return scope != nullptr && is_rendering_scope_intermediate(*scope, handle);
+    };
+    if (scope != nullptr && scope->first_pass_index == i) {
+      for (auto handle : scope->color_attachments) {
+        use(handle, i, false);
+      }
+      for (const auto& handle : {scope->depth_attachment, scope->stencil_attachment}) {
+        if (handle) {
+          use(*handle, i, false);
+        }
+      }
+    }
+
+    std::visit(
+        [&use, &discarded, i](const auto& p) {
+          for (const auto& dep : p.attachment_dependencies) {
+            use(dep.handle, i, !discarded(dep.handle));
+          }
+        },
+        passes_[i]);
+
+    if (rp != nullptr) {
+      for (const auto& color : rp->color_attachments) {
+        use(color.handle, i,
+            inferred_store_op(i, color) == vk::AttachmentStoreOp::eStore && !discarded(color.handle));
+        if (color.resolve_handle) {
+          use(*color.resolve_handle, i, true);
+        }
+      }
+      for (const auto& info : {rp->depth_stencil_attachment, rp->depth_attachment, rp->stencil_attachment}) {
+        if (info) {
+          use(info->handle, i,
+              inferred_store_op(i, *info) == vk::AttachmentStoreOp::eStore && !discarded(info->handle));
+        }
+      }
+    }
+  }
+  for (const auto& dep : final_pass_attachments_dependencies_) {
+    use(dep.handle, static_cast<uint32_t>(passes_.size()), true);
+  }
+
+  auto lifetimes_changed = !std::ranges::equal(previous, transient_attachments_, [](const auto& a, const auto& b) {
+    return a.first_use == b.first_use && a.last_use == b.last_use && a.stored == b.stored;
+  });
+  auto missing_images    = std::ranges::any_of(
+      transient_attachments_, [](const auto& transient) { return transient.used() && !transient.realized; });
+  if (!lifetimes_changed && !missing_images) {
+    return {};
+  }
+
+  return realize_transient_attachments();
+}
+
+Result<void, Error> RenderGraph::realize_transient_attachments() {
+  if (std::ranges::any_of(transient_attachments_, [](const auto& transient) { return transient.realized; })) {
+    // The old images and their memory might still be used by the frames in flight
+    const auto wait = WaitScope(transient_attachments_.front()._p_device->wait_statistics(),
+                                "Transient attachments realization", WaitKind::Stall);
+    (*transient_attachments_.front()._p_device)->waitIdle();
+  }
+
+  for (auto& transient : transient_attachments_) {
+    auto& img              = attachment(transient.handle);
+    img.view               = nullptr;
+    img.img._image         = VmaRaiiImage(nullptr);
+    transient.realized     = false;
+    transient.memory_block = TransientAttachment::kLazilyAllocated;
+  }
+  transient_memory_.clear();
+
+  auto usage = [](const TransientAttachment& transient) -> vk::ImageUsageFlags {
+    return transient.usage |
+           (transient.stored ? vk::ImageUsageFlagBits::eSampled : vk::ImageUsageFlagBits::eTransientAttachment);
+  };
+
+  auto bind = [this](const TransientAttachment& transient, ImageResource&& img) -> Result<void, Error> {
+    TRY_UNWRAP_DEFINE(view, img.create_image_view());
+    auto& attachment_img = attachment(transient.handle);
+    attachment_img.img   = std::move(img);
+    attachment_img.view  = std::move(view);
+    ++attachment_img.generation;
+    apply_debug_name(attachment_img);
+    return {};
+  };
+
+  // == Attachments that are never stored might not require any memory on tiled GPUs =================================
+  auto aliased = std::vector<uint32_t>();
+  for (auto i = 0U; i < transient_attachments_.size(); ++i) {
+    auto& transient = transient_attachments_[i];
+    if (!transient.used()) {
+      continue;
+    }
+    if (!transient.stored) {
+      auto img = ImageResource::create_lazily_allocated_attachment_image(
+          *transient._p_device, transient.description, usage(transient), transient.aspect, transient.samples);
+      if (img) {
+        TRY(bind(transient, std::move(*img)));
+        transient.realized = true;
+        continue;
+      }
+    }
+    aliased.push_back(i);
+  }
+
+  // == Assign the remaining attachments to memory blocks =============================================================
+  // Greedy first fit, the largest attachments go first so that the size of a block is determined by its first member.
+  auto requirements = std::vector<vk::MemoryRequirements>(transient_attachments_.size());
+  for (auto i : aliased) {
+    const auto& transient = transient_attachments_[i];
+    requirements[i]       = ImageResource::attachment_memory_requirements(*transient._p_device, transient.description,
+                                                                          usage(transient), transient.samples);
+  }
+  std::ranges::stable_sort(aliased, std::greater{}, [&requirements](uint32_t i) { return requirements[i].size; });
+
+  auto blocks        = std::vector<vk::MemoryRequirements>();
+  auto block_members = std::vector<std::vector<uint32_t>>();
+  for (auto i : aliased) {
+    auto& transient = transient_attachments_[i];
+    const auto& req = requirements[i];
+
+    auto block = 0U;
+    for (; block < blocks.size(); ++block) {
+      auto compatible_memory = (blocks[block].memoryTypeBits & req.memoryTypeBits) != 0;
+      auto disjoint          = std::ranges::none_of(
+          block_members[block], [&](uint32_t member) { return transient_attachments_[member].overlaps(transient); });
+      if (compatible_memory && disjoint) {
+        break;
+      }
+    }
+
+    if (block == blocks.size()) {
+      blocks.push_back(req);
+      block_members.emplace_back();
+    } else {
+      blocks[block].size           = std::max(blocks[block].size, req.size);
+      blocks[block].alignment      = std::max(blocks[block].alignment, req.alignment);
+      blocks[block].memoryTypeBits = blocks[block].memoryTypeBits & req.memoryTypeBits;
+    }
+    block_members[block].push_back(i);
+    transient.memory_block = block;
+  }
+
+  if (blocks.empty()) {
+    return {};
+  }
+
+  auto& alloc_manager             = transient_attachments_.front()._p_device->vma_alloc_manager();
+  auto alloc_create_info          = VmaAllocationCreateInfo{};
+  alloc_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  alloc_create_info.priority      = 1.0F;
+  for (const auto& req : blocks) {
+    TRY_UNWRAP_DEFINE(memory, alloc_manager.allocate_memory(req, alloc_create_info, MemoryCategory::Attachment));
+    alloc_manager.set_allocation_name(memory, std::format("Transient attachment block {}", transient_memory_.size()));
+    transient_memory_.emplace_back(alloc_manager, memory);
+  }
+
+  // == Bind the images to the shared memory ===========================================================================
+  for (auto i : aliased) {
+    auto& transient = transient_attachments_[i];
+    TRY_UNWRAP_DEFINE(img, ImageResource::create_aliasing_attachment_image(
+                               *transient._p_device, transient_memory_[transient.memory_block]._allocation,
+                               transient.description, usage(transient), transient.aspect, transient.samples));
+    TRY(bind(transient, std::move(img)));
+    transient.realized = true;
+  }
+
+  return {};
+}
+
+void RenderGraph::begin_transient_lifetimes(uint32_t pass_index, std::vector<bool>& began) {
+  for (auto i = 0U; i < transient_attachments_.size(); ++i) {
+    const auto& transient = transient_attachments_[i];
+    if (began[i] || transient.memory_block == TransientAttachment::kLazilyAllocated ||
+        transient.first_use > pass_index) {
+      continue;
+    }
+    began[i] = true;
+
+    // The previous occupants of the memory block must finish their work before the attachment is written. The content
+    // is discarded, so the layout stays undefined.
+    auto src_stage_mask  = vk::PipelineStageFlags2{vk::PipelineStageFlagBits2::eNone};
+    auto src_access_mask = vk::AccessFlags2{vk::AccessFlagBits2::eNone};
+    for (const auto& other : transient_attachments_) {
+      if (&other != &transient && other.memory_block == transient.memory_block) {
+        src_stage_mask |= attachment(other.handle).src_stage_mask;
+        src_access_mask |= attachment(other.handle).src_access_mask;
+      }
+    }
+
+    auto& img               = attachment(transient.handle);
+    img.src_stage_mask      = src_stage_mask;
+    img.src_access_mask     = src_access_mask;
+    img.src_layout          = vk::ImageLayout::eUndefined;
+    img.visible_stage_mask  = vk::PipelineStageFlagBits2::eNone;
+    img.visible_access_mask = vk::AccessFlagBits2::eNone;
+  }
+}
+
+Result<void, Error> RenderGraph::compile() {
+  auto valid = validate_dependencies(final_pass_attachments_dependencies_, final_pass_storage_dependencies_) &&
+               std::ranges::all_of(passes_, [this](const auto& pass) {
+                 return std::visit(
+                     [this](const auto& p) {
+                       return validate_dependencies(p.attachment_dependencies, p.shader_storage_dependencies);
+                     },
+                     pass);
+               });
+  if (!valid) {
+    util::Logger::err("Could not compile the render graph. One of the dependencies refers to a non-existing resource.");
+    return std::unexpected(Error{
+        .msg  = "Dependency refers to a non-existing resource",
+        .code = ErrorCode::InvalidRenderGraph{},
+    });
+  }
+
+  if (resize_pending_) {
+    TRY(apply_pending_resizes());
+  }
+
+  if (!transient_attachments_.empty()) {
+    TRY(update_transient_attachments());
+  }
+
+  // The topology is computed after the attachments are reallocated, so that their generations are up to date
+  auto current_topology = topology();
+  if (restore_cached_compilation(current_topology)) {
+    dirty_ = false;
+    return {};
+  }
+
+  compiled_.clear();
+  compiled_.active_passes.reserve(passes_.size());
+  compiled_.live_passes = find_live_passes();
+
+  // The barriers are computed by simulating a single frame, every resource starts in the undefined state.
+  //
+  // https://docs.vulkan.org/refpages/latest/refpages/source/VkPipelineStageFlagBits2.html
+  //
+  // The TOP and BOTTOM pipeline stages are legacy, and applications should prefer VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+  // and VK_PIPELINE_STAGE_2_NONE.
+
+  for_each_attachment([](RenderPassAttachmentImage& img_info) {
+    img_info.src_access_mask     = vk::AccessFlagBits2::eNone;
+    img_info.src_stage_mask      = vk::PipelineStageFlagBits2::eNone;
+    img_info.src_layout          = vk::ImageLayout::eUndefined;
+    img_info.visible_access_mask = vk::AccessFlagBits2::eNone;
+    img_info.visible_stage_mask  = vk::PipelineStageFlagBits2::eNone;
+  });
+
+  for_each_shader_storage_image([](ShaderStorageImage& img_info) {
+    img_info.src_access_mask     = vk::AccessFlagBits2::eNone;
+    img_info.src_stage_mask      = vk::PipelineStageFlagBits2::eNone;
+    img_info.src_layout          = vk::ImageLayout::eUndefined;
+    img_info.visible_access_mask = vk::AccessFlagBits2::eNone;
+    img_info.visible_stage_mask  = vk::PipelineStageFlagBits2::eNone;
+  });
+
+  for_each_shader_storage_buffer([](ShaderStorageBuffer& buff) {
+    buff.src_access_mask     = vk::AccessFlagBits2::eNone;
+    buff.src_stage_mask      = vk::PipelineStageFlagBits2::eNone;
+    buff.visible_access_mask = vk::AccessFlagBits2::eNone;
+    buff.visible_stage_mask  = vk::PipelineStageFlagBits2::eNone;
+  });
+
+  // It's impossible to create dependency cycles or provide incorrect ordering, because during pass creation client can
+  // only refer to already emplaced passes, so the insertion order is a valid topological order.
+  // == Async compute passes ==========================================================================================
+  // Async passes only use shader storage that is not touched by the graphics queue before the wait, so they can be
+  // simulated ahead of the graphics passes.
+  auto async_passes = find_async_passes();
+  if (!compiled_.async_shader_storage.empty()) {
+    compile_queue_family_transfer(graphics_queue_family_, async_compute_queue_family_,
+                                  vk::PipelineStageFlagBits2::eComputeShader,
+                                  vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+                                  compiled_.to_compute_release, compiled_.to_compute_acquire);
+
+    for (auto i = 0U; i < passes_.size(); ++i) {
+      if (!async_passes[i]) {
+        continue;
+      }
+
+      const auto& cp         = std::get<ComputePass>(passes_[i]);
+      auto compiled_pass     = CompiledPass{.pass_index = i};
+      compiled_pass.barriers = begin_barrier_batch();
+      compile_dependency_barriers(cp.attachment_dependencies, cp.shader_storage_dependencies);
+      compile_shader_storage_target_barriers(cp.shader_storage);
+      end_barrier_batch(compiled_pass.barriers);
+      compiled_.async_passes.emplace_back(std::move(compiled_pass));
+    }
+
+    compile_queue_family_transfer(async_compute_queue_family_, graphics_queue_family_, compiled_.async_wait_stage_mask,
+                                  vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite,
+                                  compiled_.to_graphics_release, compiled_.to_graphics_acquire);
+  }
+
+  auto uses_async_storage = [this](const auto& p) {
+    auto is_async = [this](ShaderStorageHandle handle) {
+      return std::ranges::any_of(compiled_.async_shader_storage,
+                                 [handle](auto async_handle) { return async_handle._value == handle._value; });
     };
-    img_info.src_stage_mask  = dep.stage_mask;
-    img_info.src_access_mask = dep.access_mask;
-    img_info.src_layout      = dep.layout;
+    return std::ranges::any_of(p.shader_storage, is_async) ||
+           std::ranges::any_of(p.shader_storage_dependencies, [&](const auto& dep) { return is_async(dep.handle); });
+  };
+
+  // == Graphics passes ================================================================================================
+  auto waits_for_async_compute   = false;
+  auto began_transient_lifetimes = std::vector<bool>(transient_attachments_.size(), false);
+  for (auto i = 0U; i < passes_.size(); ++i) {
+    const auto& pass = passes_[i];
+    compiled_.active_passes.push_back(is_pass_active(pass));
+    if (!compiled_.live_passes[i] || async_passes[i]) {
+      continue;
+    }
+    if (!waits_for_async_compute && std::visit(uses_async_storage, pass)) {
+      compiled_.async_wait_pass_offset = static_cast<uint32_t>(compiled_.passes.size());
+      waits_for_async_compute          = true;
+    }
+    begin_transient_lifetimes(i, began_transient_lifetimes);
+
+    const auto* rp    = std::get_if<RenderPass>(&pass);
+    const auto* scope = rp != nullptr ? rendering_scope(*rp) : nullptr;
+
+    // == Continue the rendering of the preceding pass of the same scope ===============================================
+    // The merged passes only read the attachments of the scope locally, the reads are synchronized by region inside of
+    // the rendering. The pass never waits for the async compute, as it does not use any shader storage of its own.
+    if (scope != nullptr && !compiled_.passes.empty()) {
+      auto& previous          = compiled_.passes.back();
+      const auto* previous_rp = std::get_if<RenderPass>(&passes_[previous.pass_index]);
+      if (previous_rp != nullptr && previous_rp->rendering_scope == rp->rendering_scope) {
+        previous.ends_rendering = false;
+
+        auto compiled_pass             = previous;
+        compiled_pass.pass_index       = i;
+        compiled_pass.barriers         = begin_barrier_batch();
+        compiled_pass.begins_rendering = false;
+        compiled_pass.ends_rendering   = true;
+        for (auto handle : rp->local_reads) {
+          track_access(attachment(handle), vk::PipelineStageFlagBits2::eFragmentShader,
+                       vk::AccessFlagBits2::eInputAttachmentRead, false);
+        }
+        compile_attachment_locations(*scope, *rp, compiled_pass);
+        compiled_.passes.emplace_back(std::move(compiled_pass));
+        continue;
+      }
+    }
+
+    auto compiled_pass     = CompiledPass{.pass_index = i};
+    compiled_pass.barriers = begin_barrier_batch();
+
+    // == Setup barriers for the dependencies (wait for dependencies to become ready) ==================================
+    std::visit(
+        [this](const auto& p) {
+          compile_dependency_barriers(p.attachment_dependencies, p.shader_storage_dependencies);  //
+        },
+        pass);
+
+    // == Setup the target image barriers and attachments ==============================================================
+    if (scope != nullptr) {
+      compile_rendering_scope_attachments(*scope, i, compiled_pass);
+      compile_attachment_locations(*scope, *rp, compiled_pass);
+      compile_shader_storage_target_barriers(rp->shader_storage);
+    } else if (rp != nullptr) {
+      compile_render_pass_attachments(*rp, compiled_pass);
+      compile_shader_storage_target_barriers(rp->shader_storage);
+    } else {
+      compile_shader_storage_target_barriers(std::get<ComputePass>(pass).shader_storage);
+    }
+
+    end_barrier_batch(compiled_pass.barriers);
+    compiled_.passes.emplace_back(std::move(compiled_pass));
+  }
+
+  if (!waits_for_async_compute) {
+    compiled_.async_wait_pass_offset = static_cast<uint32_t>(compiled_.passes.size());
+  }
+
+  // == Setup the barriers for final pass dependencies =================================================================
+  compiled_.final_barriers = begin_barrier_batch();
+  compile_dependency_barriers(final_pass_attachments_dependencies_, final_pass_storage_dependencies_);
+  end_barrier_batch(compiled_.final_barriers);
+
+  cache_compilation(std::move(current_topology));
+  dirty_ = false;
+
+  return {};
+}
+
+void RenderGraph::emit_barrier_batch(vk::CommandBuffer& cmd_buff, const CompiledBarrierBatch& batch) const {
+  if (batch.empty()) {
+    return;
+  }
+
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .dependencyFlags          = {},
+      .bufferMemoryBarrierCount = batch.buffer_barriers_count,
+      .pBufferMemoryBarriers    = compiled_.buffer_barriers.data() + batch.buffer_barriers_offset,
+      .imageMemoryBarrierCount  = batch.image_barriers_count,
+      .pImageMemoryBarriers     = compiled_.image_barriers.data() + batch.image_barriers_offset,
+  });
+}
 
-    barriers.emplace_back(std::move(barrier));
-  };
-  const auto dependency_storage_image_barrier = [this](std::vector<vk::ImageMemoryBarrier2>& barriers,
-                                                       const ShaderStorageDependency& dep) {
-    if (dep.handle.type() != ShaderStorageType::Image) {
-      return;
+void RenderGraph::begin_pass_rendering(vk::CommandBuffer& cmd_buff, const RenderPass& rp, CompiledPass& compiled_pass,
+                                       vk::RenderingFlags flags) {
+  // Clear values are not a part of the graph topology and might be changed by the client after compilation
+  auto color_infos = std::span(compiled_.color_attachment_infos)
+                         .subspan(compiled_pass.color_attachments_offset, compiled_pass.color_attachments_count);
+  const auto* scope = rendering_scope(rp);
+  for (auto i = 0U; i < color_infos.size(); ++i) {
+    const auto handle         = scope != nullptr ? scope->color_attachments[i] : rp.color_attachments[i].handle;
+    color_infos[i].clearValue = color_attachments_[handle.index()].clear_color;
+  }
+  if (scope != nullptr) {
+    if (scope->depth_attachment) {
+      compiled_pass.depth_attachment_info->clearValue = attachment(*scope->depth_attachment).clear_depth_stencil;
+    }
+    if (scope->stencil_attachment) {
+      compiled_pass.stencil_attachment_info->clearValue = attachment(*scope->stencil_attachment).clear_depth_stencil;
+    }
+  } else if (rp.depth_stencil_attachment) {
+    compiled_pass.depth_attachment_info->clearValue =
+        attachment(rp.depth_stencil_attachment->handle).clear_depth_stencil;
+  } else {
+    if (rp.depth_attachment) {
+      compiled_pass.depth_attachment_info->clearValue = attachment(rp.depth_attachment->handle).clear_depth_stencil;
+    }
+    if (rp.stencil_attachment) {
+      compiled_pass.stencil_attachment_info->clearValue = attachment(rp.stencil_attachment->handle).clear_depth_stencil;
     }
+  }
 
-    auto& img_info = shader_storage_image(dep.handle);
-    auto barrier   = vk::ImageMemoryBarrier2{
-          .srcStageMask        = img_info.src_stage_mask,
-          .srcAccessMask       = img_info.src_access_mask,
-          .dstStageMask        = dep.stage_mask,
-          .dstAccessMask       = dep.access_mask,
-          .oldLayout           = img_info.src_layout,
-          .newLayout           = dep.layout,
-          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-          .image               = img_info.img.vk_image(),  //
-          .subresourceRange    = img_info.img.full_resource_range(),
-    };
-    img_info.src_stage_mask  = dep.stage_mask;
-    img_info.src_access_mask = dep.access_mask;
-    img_info.src_layout      = dep.layout;
+  cmd_buff.beginRendering(vk::RenderingInfo{
+      .pNext = compiled_pass.shading_rate_attachment_info ? &*compiled_pass.shading_rate_attachment_info : nullptr,
+      .flags = flags,
+      .renderArea =
+          vk::Rect2D{
+              .offset = {.x = 0, .y = 0},
+              .extent = render_area(rp),
+          },
+      .layerCount           = 1,
+      .viewMask             = rp.view_mask,
+      .colorAttachmentCount = static_cast<uint32_t>(color_infos.size()),
+      .pColorAttachments    = color_infos.data(),
+      .pDepthAttachment     = compiled_pass.depth_attachment_info ? &*compiled_pass.depth_attachment_info : nullptr,
+      .pStencilAttachment   = compiled_pass.stencil_attachment_info ? &*compiled_pass.stencil_attachment_info : nullptr,
+  });
+}
 
-    barriers.emplace_back(std::move(barrier));
-  };
-  const auto dependency_storage_buffer_barrier = [this](std::vector<vk::BufferMemoryBarrier2>& barriers,
-                                                        const ShaderStorageDependency& dep) {
-    if (dep.handle.type() == ShaderStorageType::Image) {
-      return;
-    }
+void RenderGraph::emit_pass(Device& device, vk::CommandBuffer& cmd_buff, CompiledPass& compiled_pass,
+                            bool on_graphics_queue) {
+  emit_barrier_batch(cmd_buff, compiled_pass.barriers);
 
-    auto& buffer_info           = shader_storage_buffer(dep.handle);
-    auto barrier                = create_dependency_storage_buffer_barrier(dep.handle, dep.stage_mask, dep.access_mask);
-    buffer_info.src_stage_mask  = vk::PipelineStageFlagBits2::eComputeShader;
-    buffer_info.src_access_mask = dep.access_mask;
+  // The name is generated for the unnamed passes, so it is not built if nothing consumes the labels
+  const auto debug_label = device.has_debug_utils();
+  if (debug_label) {
+    device.begin_debug_label(cmd_buff, pass_name(compiled_pass.pass_index));
+  }
 
-    barriers.emplace_back(std::move(barrier));
-  };
-  const auto target_shader_storage_barriers = [this](std::vector<vk::BufferMemoryBarrier2>& buff_barriers,
-                                                     std::vector<vk::ImageMemoryBarrier2>& img_barriers,
-                                                     const std::span<const ShaderStorageHandle> handles) {
-    auto dst_stage_mask  = vk::PipelineStageFlagBits2::eComputeShader;
-    auto dst_access_mask = vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eShaderStorageRead;
+  // The secondary command buffers are allocated for the graphics queue family
+  const auto static_cmd_buff = on_graphics_queue ? update_static_pass(device, compiled_pass) : nullptr;
+
+  // Pipeline statistics queries count graphics operations, they can't be used on the compute queue. Neither can they
+  // span the rendering shared by the passes of a scope or the secondary command buffers without the query inheritance.
+  auto* cost_profiler         = on_graphics_queue && !static_cmd_buff ? p_shader_cost_profiler_ : nullptr;
+  const auto shares_rendering = !compiled_pass.begins_rendering || !compiled_pass.ends_rendering;
+  const auto with_statistics  = profile_pipeline_statistics_ && on_graphics_queue && cost_profiler == nullptr &&
+                               !shares_rendering && !static_cmd_buff;
+  if (is_profiling_enabled()) {
+    begin_pass_profiling(cmd_buff, compiled_pass.pass_index, with_statistics);
+  }
 
-    // https://vulkan.lunarg.com/doc/view/1.4.328.1/windows/antora/guide/latest/storage_image_and_texel_buffers.html#_synchronization_with_storage_images
-    auto dst_layout = vk::ImageLayout::eGeneral;
+  // Tracy context is bound to the graphics queue
+  [[maybe_unused]] auto* gpu_profiler = on_graphics_queue ? p_gpu_profiler_ : nullptr;
+  ERAY_PROFILE_GPU_SCOPE_DYNAMIC(gpu_profiler, cmd_buff, pass_name(compiled_pass.pass_index));
 
-    for (auto handle : handles) {
-      if (handle.type() == ShaderStorageType::Image) {
-        auto& img_info = shader_storage_images_[handle.index()];
-        img_barriers.emplace_back(vk::ImageMemoryBarrier2{
-            .srcStageMask        = img_info.src_stage_mask,
-            .srcAccessMask       = img_info.src_access_mask,
-            .dstStageMask        = dst_stage_mask,
-            .dstAccessMask       = dst_access_mask,
-            .oldLayout           = img_info.src_layout,
-            .newLayout           = dst_layout,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image               = img_info.img.vk_image(),
-            .subresourceRange    = img_info.img.full_resource_range(),
-        });
-        img_info.src_access_mask = dst_access_mask;
-        img_info.src_stage_mask  = dst_stage_mask;
-        img_info.src_layout      = dst_layout;
-      } else {
-        auto& buffer_info = shader_storage_buffers_[handle.index()];
-        buff_barriers.emplace_back(vk::BufferMemoryBarrier2{
-            .srcStageMask        = buffer_info.src_stage_mask,
-            .srcAccessMask       = buffer_info.src_access_mask,
-            .dstStageMask        = dst_stage_mask,
-            .dstAccessMask       = dst_access_mask,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .buffer              = buffer_info.buffer.vk_buffer(),
-            .offset              = 0,
-            .size                = buffer_info.buffer.size_bytes,
-        });
-        buffer_info.src_access_mask = dst_access_mask;
-        buffer_info.src_stage_mask  = dst_stage_mask;
-      }
+  auto& pass = passes_[compiled_pass.pass_index];
+  if (static_cmd_buff) {
+    if (const auto* rp = std::get_if<RenderPass>(&pass)) {
+      begin_pass_rendering(cmd_buff, *rp, compiled_pass, vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+      cmd_buff.executeCommands(static_cmd_buff);
+      cmd_buff.endRendering();
+    } else {
+      cmd_buff.executeCommands(static_cmd_buff);
     }
-  };
+  } else if (const auto* rp = std::get_if<RenderPass>(&pass)) {
+    if (compiled_pass.begins_rendering) {
+      begin_pass_rendering(cmd_buff, *rp, compiled_pass, {});
+    } else {
+      emit_local_read_barrier(cmd_buff);
+    }
+    emit_attachment_locations(cmd_buff, compiled_pass);
+    set_full_viewport(cmd_buff, render_area(*rp));
+    if (cost_profiler != nullptr) {
+      cost_profiler->begin_pass(cmd_buff, pass_name(compiled_pass.pass_index));
+    }
+    invoke_emit_funcs(*rp, device, *this, cmd_buff);
+    if (cost_profiler != nullptr) {
+      cost_profiler->end_pass(cmd_buff);
+    }
+    if (compiled_pass.ends_rendering) {
+      cmd_buff.endRendering();
+    }
+  } else {
+    const auto& cp = std::get<ComputePass>(pass);
+    if (cost_profiler != nullptr) {
+      cost_profiler->begin_pass(cmd_buff, pass_name(compiled_pass.pass_index));
+    }
+    invoke_emit_funcs(cp, device, *this, cmd_buff);
+    if (cost_profiler != nullptr) {
+      cost_profiler->end_pass(cmd_buff);
+    }
+  }
 
-  // https://docs.vulkan.org/refpages/latest/refpages/source/VkPipelineStageFlagBits2.html
-  //
-  // The TOP and BOTTOM pipeline stages are legacy, and applications should prefer VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
-  // and VK_PIPELINE_STAGE_2_NONE.
+  if (is_profiling_enabled()) {
+    end_pass_profiling(cmd_buff, with_statistics);
+  }
+  if (debug_label) {
+    device.end_debug_label(cmd_buff);
+  }
+}
 
-  for_each_attachment([](RenderPassAttachmentImage& img_info) {
-    img_info.src_access_mask = vk::AccessFlagBits2::eNone;
-    img_info.src_stage_mask  = vk::PipelineStageFlagBits2::eNone;
-    img_info.src_layout      = vk::ImageLayout::eUndefined;
-  });
+void RenderGraph::emit_attachment_locations(vk::CommandBuffer& cmd_buff, const CompiledPass& compiled_pass) const {
+  if (!compiled_pass.attachment_locations_offset) {
+    return;
+  }
 
-  for_each_shader_storage_image([](ShaderStorageImage& img_info) {
-    img_info.src_access_mask = vk::AccessFlagBits2::eNone;
-    img_info.src_stage_mask  = vk::PipelineStageFlagBits2::eNone;
-    img_info.src_layout      = vk::ImageLayout::eUndefined;
+  // The outputs and the input attachments of the pass are mapped to the attachments of the scope, matching the
+  // pipelines created for the pass
+  auto locations     = std::span(compiled_.color_attachment_locations)
+                       .subspan(*compiled_pass.attachment_locations_offset, compiled_pass.color_attachments_count);
+  auto input_indices = std::span(compiled_.color_attachment_input_indices)
+                           .subspan(*compiled_pass.attachment_locations_offset, compiled_pass.color_attachments_count);
+  cmd_buff.setRenderingAttachmentLocations(vk::RenderingAttachmentLocationInfo{
+      .colorAttachmentCount      = static_cast<uint32_t>(locations.size()),
+      .pColorAttachmentLocations = locations.data(),
   });
+  cmd_buff.setRenderingInputAttachmentIndices(vk::RenderingInputAttachmentIndexInfo{
+      .colorAttachmentCount         = static_cast<uint32_t>(input_indices.size()),
+      .pColorAttachmentInputIndices = input_indices.data(),
+      .pDepthInputAttachmentIndex   = &compiled_pass.depth_input_index,
+      .pStencilInputAttachmentIndex = &compiled_pass.stencil_input_index,
+  });
+}
 
-  for_each_shader_storage_buffer([](ShaderStorageBuffer& buff) {
-    buff.src_access_mask = vk::AccessFlagBits2::eNone;
-    buff.src_stage_mask  = vk::PipelineStageFlagBits2::eNone;
+void RenderGraph::record_secondary_pass(Device& device, vk::raii::CommandBuffer& secondary_cmd_buff,
+                                        const CompiledPass& compiled_pass, vk::CommandBufferUsageFlags usage) const {
+  auto cmd_buff    = *secondary_cmd_buff;
+  const auto& pass = passes_[compiled_pass.pass_index];
+  if (const auto* rp = std::get_if<RenderPass>(&pass)) {
+    // Secondary command buffers executed inside a render pass instance must declare the attachment formats, the
+    // dynamic state is not inherited from the primary command buffer.
+    auto color_formats = std::span(compiled_.color_attachment_formats)
+                             .subspan(compiled_pass.color_attachments_offset, compiled_pass.color_attachments_count);
+    auto rendering_inheritance_info = vk::CommandBufferInheritanceRenderingInfo{
+        .viewMask                = rp->view_mask,
+        .colorAttachmentCount    = static_cast<uint32_t>(color_formats.size()),
+        .pColorAttachmentFormats = color_formats.data(),
+        .depthAttachmentFormat   = compiled_pass.depth_attachment_format,
+        .stencilAttachmentFormat = compiled_pass.stencil_attachment_format,
+        .rasterizationSamples    = rp->samples,
+    };
+    auto inheritance_info = vk::CommandBufferInheritanceInfo{.pNext = &rendering_inheritance_info};
+    secondary_cmd_buff.begin(vk::CommandBufferBeginInfo{
+        .flags            = usage | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+        .pInheritanceInfo = &inheritance_info,
+    });
+    set_full_viewport(cmd_buff, render_area(*rp));
+    invoke_emit_funcs(*rp, device, *this, cmd_buff);
+  } else {
+    auto inheritance_info = vk::CommandBufferInheritanceInfo{};
+    secondary_cmd_buff.begin(vk::CommandBufferBeginInfo{
+        .flags            = usage,
+        .pInheritanceInfo = &inheritance_info,
+    });
+    const auto& cp = std::get<ComputePass>(pass);
+    invoke_emit_funcs(cp, device, *this, cmd_buff);
+  }
+  secondary_cmd_buff.end();
+}
+
+vk::CommandBuffer RenderGraph::update_static_pass(Device& device, const CompiledPass& compiled_pass) {
+  const auto pass_index = compiled_pass.pass_index;
+  const auto is_static  = std::visit([](const auto& p) { return p.static_key.has_value(); }, passes_[pass_index]);
+  if (!is_static_pass_caching_enabled() || !is_static || compiled_pass.attachment_locations_offset) {
+    return nullptr;
+  }
+
+  if (static_passes_.size() < passes_.size()) {
+    static_passes_.resize(passes_.size());
+  }
+  auto& cached     = static_passes_[pass_index];
+  const auto state = static_pass_state(pass_index);
+  if (*cached.cmd_buff && cached.state == state) {
+    return *cached.cmd_buff;
+  }
+
+  // The previous commands might still be executed by the frames in flight
+  if (*cached.cmd_buff) {
+    retired_static_passes_.emplace_back(static_pass_emit_count_ + static_pass_frames_in_flight_,
+                                        std::move(cached.cmd_buff));
+  }
+
+  auto cmd_buffs = device->allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+      .commandPool        = *static_pass_pool_,
+      .level              = vk::CommandBufferLevel::eSecondary,
+      .commandBufferCount = 1,
   });
+  if (!cmd_buffs) {
+    util::panic("Could not allocate a static pass command buffer");
+  }
+  cached.cmd_buff = std::move(cmd_buffs->front());
+  cached.state    = state;
+  record_secondary_pass(device, cached.cmd_buff, compiled_pass, vk::CommandBufferUsageFlagBits::eSimultaneousUse);
 
-  std::vector<vk::RenderingAttachmentInfo> color_attachment_infos;
-  std::vector<vk::ImageMemoryBarrier2> image_memory_barriers;
-  std::vector<vk::BufferMemoryBarrier2> buffer_memory_barriers;
-  for (auto& pass : passes_) {
-    if (std::visit(
-            [](auto& p) {
-              bool result = p.on_request_only && !p.requested;
-              p.requested = false;
-              return result;
-            },
-            pass)) {
-      continue;
-    }
+  return *cached.cmd_buff;
+}
 
-    image_memory_barriers.clear();
-    buffer_memory_barriers.clear();
+size_t RenderGraph::static_pass_state(uint32_t pass_index) const {
+  auto state = size_t{0};
 
-    // == Setup barriers for the dependencies (wait for dependencies to become ready) ==================================
-    std::visit(
-        [&](auto& pass) {
-          for (auto& dep : pass.attachment_dependencies) {
-            dependency_attachment_image_barrier(image_memory_barriers, dep);
+  // The recreated attachments get new views, the descriptors of the pass referring to them are outdated
+  auto hash_attachment = [this, &state](RenderPassAttachmentHandle handle) {
+    util::hash_combine(state, handle._value);
+    util::hash_combine(state, attachment(handle).generation);
+  };
+  std::visit(
+      [&](const auto& p) {
+        util::hash_combine(state, *p.static_key);
+        for (const auto& dep : p.attachment_dependencies) {
+          hash_attachment(dep.handle);
+        }
+
+        using TPass = std::remove_cvref_t<decltype(p)>;
+        if constexpr (std::is_same_v<TPass, RenderPass>) {
+          const auto extent = render_area(p);
+          util::hash_combine(state, extent.width);
+          util::hash_combine(state, extent.height);
+          for (const auto& info : p.color_attachments) {
+            hash_attachment(info.handle);
           }
-          for (auto& dep : pass.shader_storage_dependencies) {
-            if (dep.handle.type() == ShaderStorageType::Image) {
-              dependency_storage_image_barrier(image_memory_barriers, dep);
-            } else {
-              dependency_storage_buffer_barrier(buffer_memory_barriers, dep);
+          for (const auto& info : {p.depth_stencil_attachment, p.depth_attachment, p.stencil_attachment}) {
+            if (info) {
+              hash_attachment(info->handle);
             }
           }
-        },
-        pass);
-
-    // == Setup the target image barriers and attachments ==============================================================
-    if (std::holds_alternative<RenderPass>(pass)) {
-      const auto& rp = std::get<RenderPass>(pass);
-
-      color_attachment_infos.clear();
-      color_attachment_infos.reserve(rp.color_attachments.size());
-      for (auto c : rp.color_attachments) {
-        auto& color_img_info = color_attachments_[c.handle.index()];
-
-        auto info = vk::RenderingAttachmentInfo{
-            .imageView   = vk::ImageView{color_img_info.view},
-            .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-            .loadOp      = c.load_op,
-            .storeOp     = c.store_op,
-            .clearValue  = color_img_info.clear_color,
-        };
-
-        {
-          auto dst_stage_mask  = vk::PipelineStageFlagBits2::eColorAttachmentOutput;
-          auto dst_access_mask = vk::AccessFlagBits2::eColorAttachmentWrite;
-          auto dst_layout      = vk::ImageLayout::eColorAttachmentOptimal;
-          auto barrier         = vk::ImageMemoryBarrier2{
-                      .srcStageMask        = color_img_info.src_stage_mask,
-                      .srcAccessMask       = color_img_info.src_access_mask,
-                      .dstStageMask        = dst_stage_mask,
-                      .dstAccessMask       = dst_access_mask,
-                      .oldLayout           = color_img_info.src_layout,
-                      .newLayout           = dst_layout,
-                      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                      .image               = color_attachments_[c.handle.index()].img.vk_image(),
-                      .subresourceRange    = color_attachments_[c.handle.index()].img.full_resource_range(),
-          };
-          color_img_info.src_stage_mask  = dst_stage_mask;
-          color_img_info.src_access_mask = dst_access_mask;
-          color_img_info.src_layout      = dst_layout;
-          image_memory_barriers.emplace_back(std::move(barrier));
         }
+      },
+      passes_[pass_index]);
 
-        if (c.resolve_handle) {
-          // MSAA is enabled
-
-          auto& resolve_color_img_info = color_attachments_[c.resolve_handle->index()];
-          info.resolveMode             = vk::ResolveModeFlagBits::eAverage;
-          info.resolveImageView        = resolve_color_img_info.view;
-          info.resolveImageLayout      = vk::ImageLayout::eColorAttachmentOptimal;
-
-          auto dst_stage_mask  = vk::PipelineStageFlagBits2::eColorAttachmentOutput;
-          auto dst_access_mask = vk::AccessFlagBits2::eColorAttachmentWrite;
-          auto dst_layout      = vk::ImageLayout::eColorAttachmentOptimal;
-
-          auto resolve_barrier = vk::ImageMemoryBarrier2{
-              .srcStageMask        = resolve_color_img_info.src_stage_mask,
-              .srcAccessMask       = resolve_color_img_info.src_access_mask,
-              .dstStageMask        = dst_stage_mask,
-              .dstAccessMask       = dst_access_mask,
-              .oldLayout           = resolve_color_img_info.src_layout,
-              .newLayout           = dst_layout,
-              .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-              .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-              .image               = resolve_color_img_info.img.vk_image(),
-              .subresourceRange    = resolve_color_img_info.img.full_resource_range(),
-          };
-          resolve_color_img_info.src_stage_mask  = dst_stage_mask;
-          resolve_color_img_info.src_access_mask = dst_access_mask;
-          resolve_color_img_info.src_layout      = dst_layout;
-          image_memory_barriers.emplace_back(std::move(resolve_barrier));
-        }
+  return state;
+}
 
-        color_attachment_infos.emplace_back(std::move(info));
-      }
+void RenderGraph::free_retired_static_passes() {
+  ++static_pass_emit_count_;
+  std::erase_if(retired_static_passes_,
+                [this](const auto& retired) { return retired.first <= static_pass_emit_count_; });
+}
 
-      std::optional<vk::RenderingAttachmentInfo> depth_info   = std::nullopt;
-      std::optional<vk::RenderingAttachmentInfo> stencil_info = std::nullopt;
-
-      if (rp.depth_attachment) {
-        const auto& a  = rp.depth_attachment;
-        auto& img_info = attachment(a->handle);
-
-        depth_info = vk::RenderingAttachmentInfo{
-            .imageView   = vk::ImageView{depth_attachments_[a->handle.index()].view},
-            .imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
-            .loadOp      = a->load_op,
-            .storeOp     = a->store_op,
-            .clearValue  = depth_attachments_[a->handle.index()].clear_depth_stencil,
-        };
-
-        auto dst_stage_mask =
-            vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests;
-        auto dst_access_mask =
-            vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentRead;
-        auto dst_layout = vk::ImageLayout::eDepthAttachmentOptimal;
-
-        auto range       = depth_attachments_[a->handle.index()].img.full_resource_range();
-        range.aspectMask = vk::ImageAspectFlagBits::eDepth;
-
-        auto barrier = vk::ImageMemoryBarrier2{
-            .srcStageMask        = img_info.src_stage_mask,
-            .srcAccessMask       = img_info.src_access_mask,
-            .dstStageMask        = dst_stage_mask,
-            .dstAccessMask       = dst_access_mask,
-            .oldLayout           = img_info.src_layout,
-            .newLayout           = dst_layout,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image               = depth_attachments_[a->handle.index()].img.vk_image(),
-            .subresourceRange    = range,
-        };
-        img_info.src_stage_mask  = dst_stage_mask;
-        img_info.src_access_mask = dst_access_mask;
-        img_info.src_layout      = dst_layout;
-        image_memory_barriers.emplace_back(std::move(barrier));
-      }
+void RenderGraph::reset_requested_passes() {
+  for (auto& pass : passes_) {
+    std::visit([](auto& p) { p.requested = false; }, pass);
+  }
+}
 
-      if (rp.stencil_attachment) {
-        const auto& a  = rp.stencil_attachment;
-        auto& img_info = attachment(a->handle);
-
-        stencil_info = vk::RenderingAttachmentInfo{
-            .imageView   = vk::ImageView{stencil_attachments_[a->handle.index()].view},
-            .imageLayout = vk::ImageLayout::eStencilAttachmentOptimal,
-            .loadOp      = a->load_op,
-            .storeOp     = a->store_op,
-            .clearValue  = stencil_attachments_[a->handle.index()].clear_depth_stencil,
-        };
-
-        auto dst_stage_mask =
-            vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests;
-        auto dst_access_mask =
-            vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentRead;
-        auto dst_layout = vk::ImageLayout::eStencilAttachmentOptimal;
-
-        auto range       = stencil_attachments_[a->handle.index()].img.full_resource_range();
-        range.aspectMask = vk::ImageAspectFlagBits::eStencil;
-
-        auto barrier = vk::ImageMemoryBarrier2{
-            .srcStageMask        = img_info.src_stage_mask,
-            .srcAccessMask       = img_info.src_access_mask,
-            .dstStageMask        = dst_stage_mask,
-            .dstAccessMask       = dst_access_mask,
-            .oldLayout           = img_info.src_layout,
-            .newLayout           = dst_layout,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image               = stencil_attachments_[a->handle.index()].img.vk_image(),
-            .subresourceRange    = range,
-        };
-        img_info.src_stage_mask  = dst_stage_mask;
-        img_info.src_access_mask = dst_access_mask;
-        img_info.src_layout      = dst_layout;
-        image_memory_barriers.emplace_back(std::move(barrier));
-      }
+void RenderGraph::emit(Device& device, vk::CommandBuffer& cmd_buff) {
+  ERAY_PROFILE_FUNCTION();
+  if (passes_.empty()) {
+    return;
+  }
 
-      if (rp.depth_stencil_attachment) {
-        const auto& a  = rp.depth_stencil_attachment;
-        auto& img_info = attachment(a->handle);
-
-        stencil_info = std::nullopt;
-        depth_info   = vk::RenderingAttachmentInfo{
-              .imageView   = vk::ImageView{depth_stencil_attachments_[a->handle.index()].view},
-              .imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
-              .loadOp      = a->load_op,
-              .storeOp     = a->store_op,
-              .clearValue  = depth_stencil_attachments_[a->handle.index()].clear_depth_stencil,
-        };
-
-        auto dst_stage_mask =
-            vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests;
-        auto dst_access_mask =
-            vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentRead;
-        auto dst_layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-
-        auto range       = depth_stencil_attachments_[a->handle.index()].img.full_resource_range();
-        range.aspectMask = vk::ImageAspectFlagBits::eStencil | vk::ImageAspectFlagBits::eDepth;
-
-        auto barrier = vk::ImageMemoryBarrier2{
-            .srcStageMask        = img_info.src_stage_mask,
-            .srcAccessMask       = img_info.src_access_mask,
-            .dstStageMask        = dst_stage_mask,
-            .dstAccessMask       = dst_access_mask,
-            .oldLayout           = img_info.src_layout,
-            .newLayout           = dst_layout,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image               = depth_stencil_attachments_[a->handle.index()].img.vk_image(),
-            .subresourceRange    = range,
-        };
-        img_info.src_stage_mask  = dst_stage_mask;
-        img_info.src_access_mask = dst_access_mask;
-        img_info.src_layout      = dst_layout;
-        image_memory_barriers.emplace_back(std::move(barrier));
+  if (is_compiled_graph_outdated()) {
+    compile().or_panic("Could not compile the render graph");
+  }
+
+  if (!compiled_.async_passes.empty()) {
+    util::panic("Render graph with async compute passes must be emitted with the async compute command buffers");
+  }
+
+  free_retired_static_passes();
+  if (is_profiling_enabled()) {
+    begin_profiled_frame(device, cmd_buff);
+  }
+
+  for (auto& compiled_pass : compiled_.passes) {
+    emit_pass(device, cmd_buff, compiled_pass);
+  }
+  emit_barrier_batch(cmd_buff, compiled_.final_barriers);
+  device.statistics().count_barriers(compiled_.barrier_count());
+
+  reset_requested_passes();
+}
+
+void RenderGraph::emit(Device& device, AsyncComputeCommandBuffers& cmd_buffs) {
+  ERAY_PROFILE_FUNCTION();
+  if (passes_.empty()) {
+    return;
+  }
+
+  if (is_compiled_graph_outdated()) {
+    compile().or_panic("Could not compile the render graph");
+  }
+
+  free_retired_static_passes();
+  if (is_profiling_enabled()) {
+    // The ownership release command buffer is submitted first, the queries are reset before any of them is written
+    begin_profiled_frame(device, cmd_buffs.ownership_release);
+  }
+
+  // == Async compute queue ============================================================================================
+  emit_barrier_batch(cmd_buffs.ownership_release, compiled_.to_compute_release);
+  emit_barrier_batch(cmd_buffs.async_compute, compiled_.to_compute_acquire);
+  for (auto& compiled_pass : compiled_.async_passes) {
+    emit_pass(device, cmd_buffs.async_compute, compiled_pass, false);
+  }
+  emit_barrier_batch(cmd_buffs.async_compute, compiled_.to_graphics_release);
+
+  // == Graphics queue =================================================================================================
+  auto passes = std::span(compiled_.passes);
+  for (auto& compiled_pass : passes.first(compiled_.async_wait_pass_offset)) {
+    emit_pass(device, cmd_buffs.graphics, compiled_pass);
+  }
+  emit_barrier_batch(cmd_buffs.graphics_after_async_compute, compiled_.to_graphics_acquire);
+  for (auto& compiled_pass : passes.subspan(compiled_.async_wait_pass_offset)) {
+    emit_pass(device, cmd_buffs.graphics_after_async_compute, compiled_pass);
+  }
+  emit_barrier_batch(cmd_buffs.graphics_after_async_compute, compiled_.final_barriers);
+  device.statistics().count_barriers(compiled_.barrier_count());
+
+  reset_requested_passes();
+}
+
+void RenderGraph::emit_parallel(Device& device, vk::CommandBuffer& cmd_buff, CommandManager& secondary_cmd_buffs) {
+  ERAY_PROFILE_FUNCTION();
+  if (passes_.empty()) {
+    return;
+  }
+
+  if (is_compiled_graph_outdated()) {
+    compile().or_panic("Could not compile the render graph");
+  }
+
+  if (!compiled_.async_passes.empty()) {
+    util::panic("Render graph with async compute passes must be emitted with the async compute command buffers");
+  }
+
+  const auto thread_count = secondary_cmd_buffs.thread_count();
+  if (thread_count == 0) {
+    util::panic("Parallel render graph emission requires at least one command pool");
+  }
+
+  // The static passes are recorded by this thread, the pool of their command buffers is not synchronized
+  free_retired_static_passes();
+  const auto pass_count = static_cast<uint32_t>(compiled_.passes.size());
+  auto static_cmd_buffs = std::vector<vk::CommandBuffer>(pass_count);
+  for (auto i = 0U; i < pass_count; ++i) {
+    static_cmd_buffs[i] = update_static_pass(device, compiled_.passes[i]);
+  }
+
+  const auto buffers_per_thread = (pass_count + thread_count - 1) / thread_count;
+  if (secondary_cmd_buffs.level() != vk::CommandBufferLevel::eSecondary ||
+      secondary_cmd_buffs.buffers_per_thread() < buffers_per_thread) {
+    secondary_cmd_buffs
+        .allocate_command_buffers(device, thread_count, buffers_per_thread, vk::CommandBufferLevel::eSecondary)
+        .or_panic("Could not allocate the secondary command buffers");
+  }
+
+  // == Recording ======================================================================================================
+  // Recording of a pass does not depend on the other passes, all of the synchronization is recorded by the primary
+  // command buffer, so the passes are distributed between the threads regardless of their dependencies. The passes of
+  // the rendering scopes are recorded directly into the primary command buffer, as the attachment locations and the
+  // local read barriers cannot be recorded by it inside of a rendering with the secondary command buffers.
+  const auto record = [&](uint32_t thread_index) {
+    ERAY_PROFILE_SCOPE("Record secondary passes");
+    for (auto i = thread_index; i < pass_count; i += thread_count) {
+      if (compiled_.passes[i].attachment_locations_offset || static_cmd_buffs[i]) {
+        continue;
       }
+      record_secondary_pass(device, secondary_cmd_buffs.command_buffer(thread_index, i / thread_count),
+                            compiled_.passes[i]);
+    }
+  };
 
-      target_shader_storage_barriers(buffer_memory_barriers, image_memory_barriers, rp.shader_storage);
+  {
+    auto workers = std::vector<std::jthread>();
+    workers.reserve(thread_count - 1);
+    for (auto t = 1U; t < thread_count; ++t) {
+      workers.emplace_back(record, t);
+    }
+    record(0);
+  }
 
-      cmd_buff.pipelineBarrier2(vk::DependencyInfo{
-          .dependencyFlags          = {},
-          .bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_memory_barriers.size()),
-          .pBufferMemoryBarriers    = buffer_memory_barriers.data(),
-          .imageMemoryBarrierCount  = static_cast<uint32_t>(image_memory_barriers.size()),
-          .pImageMemoryBarriers     = image_memory_barriers.data(),
-      });
-      cmd_buff.beginRendering(vk::RenderingInfo{
-          .renderArea =
-              vk::Rect2D{
-                  .offset = {.x = 0, .y = 0},
-                  .extent = rp.extent,
-              },
-          .layerCount           = 1,
-          .colorAttachmentCount = static_cast<uint32_t>(color_attachment_infos.size()),
-          .pColorAttachments    = color_attachment_infos.data(),
-          .pDepthAttachment     = depth_info ? &*depth_info : nullptr,
-          .pStencilAttachment   = stencil_info ? &*stencil_info : nullptr,
-      });
-      cmd_buff.setScissor(0, vk::Rect2D{.offset = vk::Offset2D{.x = 0, .y = 0}, .extent = rp.extent});
-      cmd_buff.setViewport(0,
-                           vk::Viewport{
-                               .x      = 0.0F,
-                               .y      = 0.0F,
-                               .width  = static_cast<float>(rp.extent.width),
-                               .height = static_cast<float>(rp.extent.height),
-                               // Note: min and max depth must be between [0.0F, 1.0F] and min might be higher than max.
-                               .minDepth = 0.0F,
-                               .maxDepth = 1.0F  //
-                           });
-
-      rp.on_cmd_emit_func(device, cmd_buff);
-      rp.on_cmd_emit_func2(*this, cmd_buff);
+  // == Stitching ======================================================================================================
+  if (is_profiling_enabled()) {
+    begin_profiled_frame(device, cmd_buff);
+  }
+
+  const auto debug_labels = device.has_debug_utils();
+  for (auto i = 0U; i < pass_count; ++i) {
+    auto& compiled_pass = compiled_.passes[i];
+    if (compiled_pass.attachment_locations_offset) {
+      emit_pass(device, cmd_buff, compiled_pass);
+      continue;
+    }
+    auto secondary = static_cmd_buffs[i] ? static_cmd_buffs[i]
+                                         : *secondary_cmd_buffs.command_buffer(i % thread_count, i / thread_count);
+
+    emit_barrier_batch(cmd_buff, compiled_pass.barriers);
+    if (debug_labels) {
+      device.begin_debug_label(cmd_buff, pass_name(compiled_pass.pass_index));
+    }
+
+    // Pipeline statistics of secondary command buffers require query inheritance, only the timestamps are written
+    if (is_profiling_enabled()) {
+      begin_pass_profiling(cmd_buff, compiled_pass.pass_index, false);
+    }
+    ERAY_PROFILE_GPU_SCOPE_DYNAMIC(p_gpu_profiler_, cmd_buff, pass_name(compiled_pass.pass_index));
+    if (const auto* rp = std::get_if<RenderPass>(&passes_[compiled_pass.pass_index])) {
+      begin_pass_rendering(cmd_buff, *rp, compiled_pass, vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+      cmd_buff.executeCommands(secondary);
       cmd_buff.endRendering();
     } else {
-      const auto& cp = std::get<ComputePass>(pass);
-
-      target_shader_storage_barriers(buffer_memory_barriers, image_memory_barriers, cp.shader_storage);
-      cmd_buff.pipelineBarrier2(vk::DependencyInfo{
-          .dependencyFlags          = {},
-          .bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_memory_barriers.size()),
-          .pBufferMemoryBarriers    = buffer_memory_barriers.data(),
-          .imageMemoryBarrierCount  = static_cast<uint32_t>(image_memory_barriers.size()),
-          .pImageMemoryBarriers     = image_memory_barriers.data(),
-      });
-      cp.on_cmd_emit_func(device, cmd_buff);
-      cp.on_cmd_emit_func2(*this, cmd_buff);
+      cmd_buff.executeCommands(secondary);
+    }
+    if (is_profiling_enabled()) {
+      end_pass_profiling(cmd_buff, false);
+    }
+    if (debug_labels) {
+      device.end_debug_label(cmd_buff);
     }
   }
+  emit_barrier_batch(cmd_buff, compiled_.final_barriers);
+  device.statistics().count_barriers(compiled_.barrier_count());
 
-  // == Setup the barriers for final pass dependencies =================================================================
-  image_memory_barriers.clear();
-  buffer_memory_barriers.clear();
-  for (auto dep : final_pass_attachments_dependencies_) {
-    dependency_attachment_image_barrier(image_memory_barriers, dep);
+  reset_requested_passes();
+}
+
+Result<void, Error> RenderGraph::enable_profiling(Device& device, uint32_t frames_in_flight,
+                                                  bool pipeline_statistics) {
+  const auto limits = device.physical_device().getProperties().limits;
+  if (limits.timestampComputeAndGraphics == vk::False) {
+    util::Logger::err("Could not enable the render graph profiling. Device does not support timestamps on all of the "
+                      "graphics and compute queues.");
+    return std::unexpected(Error{
+        .msg  = "Timestamp queries are not supported",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
   }
-  for (auto dep : final_pass_storage_dependencies_) {
-    if (dep.handle.type() == ShaderStorageType::Image) {
-      dependency_storage_image_barrier(image_memory_barriers, dep);
-    } else {
-      dependency_storage_buffer_barrier(buffer_memory_barriers, dep);
-    }
+
+  if (pipeline_statistics && device.physical_device().getFeatures().pipelineStatisticsQuery == vk::False) {
+    util::Logger::warn("Device does not support pipeline statistics queries. Only the timestamps will be written.");
+    pipeline_statistics = false;
   }
-  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
-      .dependencyFlags          = {},
-      .bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_memory_barriers.size()),
-      .pBufferMemoryBarriers    = buffer_memory_barriers.data(),
-      .imageMemoryBarrierCount  = static_cast<uint32_t>(image_memory_barriers.size()),
-      .pImageMemoryBarriers     = image_memory_barriers.data(),
+
+  profiling_frames_.clear();
+  profiling_frames_.resize(frames_in_flight);
+  profiling_results_.clear();
+  profiling_frame_index_       = 0;
+  profile_pipeline_statistics_ = pipeline_statistics;
+  timestamp_period_ns_         = limits.timestampPeriod;
+
+  return {};
+}
+
+Result<void, Error> RenderGraph::enable_static_pass_caching(Device& device, uint32_t frames_in_flight) {
+  auto pool = device->createCommandPool(vk::CommandPoolCreateInfo{
+      .queueFamilyIndex = device.graphics_queue_family(),
   });
+  if (!pool) {
+    util::Logger::err("Could not create the command pool of the static passes");
+    return std::unexpected(Error{
+        .msg     = "Command Pool creation failed",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = pool.error(),
+    });
+  }
+
+  disable_static_pass_caching();
+  static_pass_pool_             = std::move(*pool);
+  static_pass_frames_in_flight_ = std::max(frames_in_flight, 1U);
+
+  return {};
+}
+
+void RenderGraph::disable_static_pass_caching() {
+  // The command buffers must be freed before the pool they were allocated from
+  static_passes_.clear();
+  retired_static_passes_.clear();
+  static_pass_pool_             = nullptr;
+  static_pass_frames_in_flight_ = 0;
+}
+
+void RenderGraph::set_static_pass_key(std::variant<ComputePassHandle, RenderPassHandle> handle, uint64_t key) {
+  auto index = std::visit([](auto h) -> uint32_t { return h.index; }, handle);
+  std::visit([key](auto& p) { p.static_key = key; }, passes_[index]);
+}
+
+void RenderGraph::disable_profiling() {
+  profiling_frames_.clear();
+  profiling_results_.clear();
+}
+
+std::string RenderGraph::pass_name(uint32_t pass_index) const {
+  return std::visit(
+      [pass_index](const auto& p) {
+        if (!p.name.empty()) {
+          return p.name;
+        }
+        using TPass = std::remove_cvref_t<decltype(p)>;
+        return std::format("{} {}", std::is_same_v<TPass, RenderPass> ? "Render pass" : "Compute pass", pass_index);
+      },
+      passes_[pass_index]);
+}
+
+void RenderGraph::begin_profiled_frame(Device& device, vk::CommandBuffer& cmd_buff) {
+  profiling_frame_index_ = (profiling_frame_index_ + 1) % static_cast<uint32_t>(profiling_frames_.size());
+  auto& frame            = profiling_frames_[profiling_frame_index_];
+
+  // The queries were written `frames_in_flight` frames ago and that frame has already finished
+  read_profiling_results(frame);
+  frame.pass_indices.clear();
+
+  auto required = static_cast<uint32_t>(compiled_.passes.size() + compiled_.async_passes.size());
+  if (required == 0) {
+    return;
+  }
+
+  if (frame.capacity < required) {
+    const auto timestamps_info = vk::QueryPoolCreateInfo{
+        .queryType  = vk::QueryType::eTimestamp,
+        .queryCount = 2 * required,
+    };
+    frame.timestamps =
+        Result(device->createQueryPool(timestamps_info)).or_panic("Could not create the timestamp query pool");
+
+    if (profile_pipeline_statistics_) {
+      // The order of the flags determines the order of the values in the query results
+      using enum vk::QueryPipelineStatisticFlagBits;
+      const auto statistics_info = vk::QueryPoolCreateInfo{
+          .queryType          = vk::QueryType::ePipelineStatistics,
+          .queryCount         = required,
+          .pipelineStatistics = eInputAssemblyVertices | eVertexShaderInvocations | eFragmentShaderInvocations |
+                                eComputeShaderInvocations,
+      };
+      frame.statistics = Result(device->createQueryPool(statistics_info))
+                             .or_panic("Could not create the pipeline statistics query pool");
+    }
+    frame.capacity = required;
+  }
+
+  cmd_buff.resetQueryPool(*frame.timestamps, 0, 2 * frame.capacity);
+  if (profile_pipeline_statistics_) {
+    cmd_buff.resetQueryPool(*frame.statistics, 0, frame.capacity);
+  }
+}
+
+void RenderGraph::read_profiling_results(const RenderGraphProfilingFrame& frame) {
+  if (frame.pass_indices.empty()) {
+    return;
+  }
+
+  // Each query is followed by its availability, the results are never waited for
+  const auto query_count = static_cast<uint32_t>(frame.pass_indices.size());
+  const auto flags       = vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability;
+
+  constexpr auto kTimestampStride = 2U;
+  auto [ts_result, timestamps]    = frame.timestamps.getResults<uint64_t>(
+      0, 2 * query_count, 2 * query_count * kTimestampStride * sizeof(uint64_t), kTimestampStride * sizeof(uint64_t),
+      flags);
+  if (ts_result != vk::Result::eSuccess && ts_result != vk::Result::eNotReady) {
+    return;
+  }
+
+  constexpr auto kStatisticsStride = 5U;
+  auto statistics                  = std::vector<uint64_t>();
+  if (profile_pipeline_statistics_) {
+    auto [stats_result, data] = frame.statistics.getResults<uint64_t>(
+        0, query_count, query_count * kStatisticsStride * sizeof(uint64_t), kStatisticsStride * sizeof(uint64_t),
+        flags);
+    if (stats_result == vk::Result::eSuccess || stats_result == vk::Result::eNotReady) {
+      statistics = std::move(data);
+    }
+  }
+
+  profiling_results_.clear();
+  for (auto q = 0U; q < query_count; ++q) {
+    const auto* begin = &timestamps[2 * q * kTimestampStride];
+    const auto* end   = &timestamps[(2 * q + 1) * kTimestampStride];
+    if (begin[1] == 0 || end[1] == 0) {
+      continue;
+    }
+
+    auto result = PassProfilingResult{
+        .pass_index      = frame.pass_indices[q],
+        .gpu_time_ms     = static_cast<double>(end[0] - begin[0]) * timestamp_period_ns_ / 1e6,
+        .gpu_begin_ticks = begin[0],
+        .gpu_end_ticks   = end[0],
+        .async_compute   = std::ranges::any_of(compiled_.async_passes, [&](const CompiledPass& pass) {
+          return pass.pass_index == frame.pass_indices[q];
+        }),
+    };
+    if (!statistics.empty() && statistics[(q * kStatisticsStride) + 4] != 0) {
+      const auto* stats = &statistics[q * kStatisticsStride];
+      result.statistics = PassPipelineStatistics{
+          .input_assembly_vertices     = stats[0],
+          .vertex_shader_invocations   = stats[1],
+          .fragment_shader_invocations = stats[2],
+          .compute_shader_invocations  = stats[3],
+      };
+    }
+    profiling_results_.push_back(result);
+  }
+}
+
+void RenderGraph::begin_pass_profiling(vk::CommandBuffer& cmd_buff, uint32_t pass_index, bool with_statistics) {
+  auto& frame = profiling_frames_[profiling_frame_index_];
+  auto query  = static_cast<uint32_t>(frame.pass_indices.size());
+  frame.pass_indices.push_back(pass_index);
+
+  cmd_buff.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *frame.timestamps, 2 * query);
+  if (with_statistics) {
+    cmd_buff.beginQuery(*frame.statistics, query, {});
+  }
+}
+
+void RenderGraph::end_pass_profiling(vk::CommandBuffer& cmd_buff, bool with_statistics) {
+  const auto& frame = profiling_frames_[profiling_frame_index_];
+  auto query        = static_cast<uint32_t>(frame.pass_indices.size() - 1);
+
+  if (with_statistics) {
+    cmd_buff.endQuery(*frame.statistics, query);
+  }
+  cmd_buff.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, *frame.timestamps, (2 * query) + 1);
+}
+
+void RenderGraph::enable_async_compute(const Device& device) {
+  if (!device.has_async_compute_queue()) {
+    util::Logger::info("Device does not expose a dedicated compute queue family. Async compute passes will be recorded "
+                       "on the graphics queue.");
+    return;
+  }
+
+  graphics_queue_family_      = device.graphics_queue_family();
+  async_compute_queue_family_ = device.compute_queue_family();
+  dirty_                      = true;
+}
+
+void RenderGraph::enable_pass_merging(const Device& device) {
+  if (!device.has_dynamic_rendering_local_read()) {
+    util::Logger::info(
+        "Device does not support the dynamic rendering local read. Every render pass will be recorded in its own "
+        "rendering.");
+    return;
+  }
+
+  if (!passes_.empty()) {
+    util::Logger::warn("Pass merging has been enabled after the passes were emplaced, they are not merged.");
+  }
+  pass_merging_enabled_ = true;
 }
 
 void RenderGraph::emplace_final_pass_dependency(RenderPassAttachmentHandle handle, vk::PipelineStageFlags2 stage_mask,
@@ -1096,6 +3255,7 @@ void RenderGraph::emplace_final_pass_dependency(RenderPassAttachmentHandle handl
       .access_mask = access_mask,
       .layout      = layout,
   });
+  dirty_ = true;
 }
 
 void RenderGraph::emplace_final_pass_storage_buffer_dependency(ShaderStorageHandle handle,
@@ -1106,6 +3266,7 @@ void RenderGraph::emplace_final_pass_storage_buffer_dependency(ShaderStorageHand
       .access_mask = access_mask,
       .layout      = vk::ImageLayout::eUndefined,
   });
+  dirty_ = true;
 }
 
 void RenderGraph::emplace_final_pass_storage_image_dependency(ShaderStorageHandle handle,
@@ -1117,6 +3278,15 @@ void RenderGraph::emplace_final_pass_storage_image_dependency(ShaderStorageHandl
       .access_mask = access_mask,
       .layout      = layout,
   });
+  dirty_ = true;
+}
+
+void RenderGraph::remove_final_pass_dependency(RenderPassAttachmentHandle handle) {
+  auto removed = std::erase_if(final_pass_attachments_dependencies_,
+                               [handle](const auto& dep) { return dep.handle._value == handle._value; });
+  if (removed > 0) {
+    dirty_ = true;
+  }
 }
 
 const RenderPass& RenderGraph::render_pass(RenderPassHandle handle) const {
@@ -1137,6 +3307,22 @@ const ShaderStorageImage& RenderGraph::shader_storage_image(ShaderStorageHandle
   return shader_storage_images_[handle.index()];
 }
 
+void RenderGraph::set_attachment_name(RenderPassAttachmentHandle handle, std::string name) {
+  auto& img = attachment(handle);
+  img.name  = std::move(name);
+  apply_debug_name(img);
+}
+
+void RenderGraph::set_shader_storage_name(ShaderStorageHandle handle, util::zstring_view name) {
+  if (handle.type() == ShaderStorageType::Image) {
+    auto& storage = shader_storage_image(handle);
+    storage.img.set_debug_name(name);
+    storage.img._p_device->set_object_name(*storage.view, name);
+  } else {
+    shader_storage_buffer(handle).buffer.set_debug_name(name);
+  }
+}
+
 const ComputePass& RenderGraph::compute_pass(ComputePassHandle handle) const {
   return std::get<ComputePass>(passes_[handle.index]);
 }
@@ -1146,4 +3332,9 @@ void RenderGraph::request_pass(std::variant<ComputePassHandle, RenderPassHandle>
   std::visit([](auto& p) { p.requested = true; }, passes_[index]);
 }
 
+bool RenderGraph::is_pass_culled(std::variant<ComputePassHandle, RenderPassHandle> handle) const {
+  auto index = std::visit([](auto h) -> uint32_t { return h.index; }, handle);
+  return index >= compiled_.live_passes.size() || !compiled_.live_passes[index];
+}
+
 }  // namespace eray::vkren
@@ -1,11 +1,25 @@
 #pragma once
 
+#include <array>
+#include <liberay/util/inline_function.hpp>
+#include <liberay/util/inplace_vector.hpp>
 #include <liberay/util/memory_region.hpp>
+#include <liberay/util/small_vector.hpp>
 #include <liberay/vkren/buffer.hpp>
 #include <liberay/vkren/common.hpp>
+#include <liberay/vkren/gpu_profiler.hpp>
 #include <liberay/vkren/image.hpp>
 #include <liberay/vkren/image_description.hpp>
+#include <liberay/vkren/shader_cost_profiler.hpp>
+#include <liberay/vkren/vma_raii_object.hpp>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
@@ -54,6 +68,24 @@ struct ComputePassHandle {
   uint32_t index;
 };
 
+/**
+ * @brief Resizable extent owned by the render graph, e.g. the size of the swap chain or of a viewport. Attachments and
+ * render passes that follow the extent are resized with it.
+ *
+ */
+struct RenderGraphExtentHandle {
+  uint32_t index;
+};
+
+/**
+ * @brief Extent relative to a `RenderGraphExtentHandle`, e.g. `scale = 0.5F` declares a half resolution attachment.
+ *
+ */
+struct RelativeExtent {
+  RenderGraphExtentHandle handle;
+  float scale = 1.F;
+};
+
 struct RenderPassAttachmentImageInfo {
   RenderPassAttachmentHandle handle;
   std::optional<RenderPassAttachmentHandle> resolve_handle;
@@ -77,25 +109,138 @@ struct ShaderStorageDependency {
 };
 
 class RenderGraph;
+class CommandManager;
+
+/**
+ * @brief Pass emit callbacks are stored inline in the passes, so that building the graph does not allocate. Callables
+ * larger than the inline buffer (4 pointers) are rejected at compile time, capture a pointer to a larger state instead.
+ *
+ */
+using PassEmitFunc      = util::InlineFunction<void(Device& device, vk::CommandBuffer& cmd_buff)>;
+using PassGraphEmitFunc = util::InlineFunction<void(const RenderGraph& render_graph, vk::CommandBuffer& cmd_buff)>;
+
+/**
+ * @brief The dependency and attachment arrays of the passes hold a few elements, they are stored inline in the pass.
+ *
+ */
+using PassAttachmentDependencies = util::SmallVector<RenderPassAttachmentDependency, 8>;
+using PassStorageDependencies    = util::SmallVector<ShaderStorageDependency, 4>;
+using PassShaderStorage          = util::SmallVector<ShaderStorageHandle, 4>;
+using PassLocalReads             = util::SmallVector<RenderPassAttachmentHandle, 4>;
 
 struct RenderPass {
+  /**
+   * @brief Guaranteed `maxColorAttachments` of the Vulkan roadmap profiles.
+   *
+   */
+  static constexpr size_t kMaxColorAttachments = 8;
+
   vk::Extent2D extent;
-  std::vector<RenderPassAttachmentDependency> attachment_dependencies;
-  std::vector<ShaderStorageDependency> shader_storage_dependencies;
+  PassAttachmentDependencies attachment_dependencies;
+  PassStorageDependencies shader_storage_dependencies;
 
-  std::vector<ShaderStorageHandle> shader_storage;
+  PassShaderStorage shader_storage;
 
-  std::vector<RenderPassAttachmentImageInfo> color_attachments;
+  util::InplaceVector<RenderPassAttachmentImageInfo, kMaxColorAttachments> color_attachments;
   vk::SampleCountFlagBits samples                                                   = vk::SampleCountFlagBits::e1;
   std::optional<RenderPassAttachmentImageInfo> depth_stencil_attachment             = std::nullopt;
   std::optional<RenderPassAttachmentImageInfo> depth_attachment                     = std::nullopt;
   std::optional<RenderPassAttachmentImageInfo> stencil_attachment                   = std::nullopt;
-  std::function<void(Device& device, vk::CommandBuffer& cmd_buff)> on_cmd_emit_func = [](auto&, auto&) {};
-  std::function<void(const RenderGraph& render_graph, vk::CommandBuffer& cmd_buff)> on_cmd_emit_func2 = [](auto&,
-                                                                                                           auto&) {};
+  std::optional<RelativeExtent> relative_extent                                     = std::nullopt;
+
+  /**
+   * @brief Storage image of `RenderGraph::create_shading_rate_image()` read as the fragment shading rate attachment.
+   *
+   */
+  std::optional<ShaderStorageHandle> shading_rate_image = std::nullopt;
+
+  /**
+   * @brief Views rendered by the pass (VK_KHR_multiview), the view i is rendered to the array layer i of every
+   * attachment. Zero if the pass renders only the first layer. See `RenderPassBuilder::with_view_mask()`.
+   *
+   */
+  uint32_t view_mask = 0;
+
+  /**
+   * @brief Attachments of the preceding passes read at the same pixel as the input attachments, the i-th one is bound
+   * to the input attachment index i, see `RenderPassBuilder::with_local_read()`.
+   *
+   */
+  PassLocalReads local_reads;
+
+  /**
+   * @brief Index of the `RenderingScope` that the pass has been merged into, set when the pass is emplaced.
+   *
+   */
+  std::optional<uint32_t> rendering_scope = std::nullopt;
+  PassEmitFunc on_cmd_emit_func;
+  PassGraphEmitFunc on_cmd_emit_func2;
+
+  /**
+   * @brief Optional name of the pass, used by the profiler and debugging tools.
+   *
+   */
+  std::string name;
 
   bool on_request_only = false;
   bool requested       = false;
+
+  /**
+   * @brief Invalidation key of a static pass, whose commands are recorded once and replayed, see `as_static()` of the
+   * builder.
+   *
+   */
+  std::optional<uint64_t> static_key = std::nullopt;
+};
+
+/**
+ * @brief Consecutive render passes recorded by the compiler in a single rendering scope. Every pass after the first
+ * one reads the attachments of the preceding ones at the same pixel (`RenderPassBuilder::with_local_read()`), which
+ * lets the tile-based GPUs keep the attachments in the tile memory between the passes. The scope begins with the union
+ * of the color attachments of its passes, every pass writes to its own ones through the attachment locations of
+ * VK_KHR_dynamic_rendering_local_read.
+ *
+ */
+struct RenderingScope {
+  uint32_t first_pass_index = 0;
+  uint32_t last_pass_index  = 0;
+
+  util::InplaceVector<RenderPassAttachmentHandle, RenderPass::kMaxColorAttachments> color_attachments;
+
+  /**
+   * @brief Depth or depth stencil attachment, shared by all of the passes that use one.
+   *
+   */
+  std::optional<RenderPassAttachmentHandle> depth_attachment   = std::nullopt;
+  std::optional<RenderPassAttachmentHandle> stencil_attachment = std::nullopt;
+
+  /**
+   * @brief Attachments read locally by any of the passes. They stay in the VK_IMAGE_LAYOUT_RENDERING_LOCAL_READ layout
+   * during the whole scope.
+   *
+   */
+  util::SmallVector<RenderPassAttachmentHandle, RenderPass::kMaxColorAttachments> local_reads;
+
+  bool is_local_read(RenderPassAttachmentHandle handle) const;
+
+  /**
+   * @brief Location of the fragment output written to each of the color attachments of the scope by the pass, or
+   * VK_ATTACHMENT_UNUSED if the pass does not write the attachment. The outputs of the pass are numbered like its own
+   * color attachments.
+   *
+   */
+  util::InplaceVector<uint32_t, RenderPass::kMaxColorAttachments> color_attachment_locations(
+      const RenderPass& render_pass) const;
+
+  /**
+   * @brief Input attachment index that the pass reads each of the color attachments of the scope with, or
+   * VK_ATTACHMENT_UNUSED.
+   *
+   */
+  util::InplaceVector<uint32_t, RenderPass::kMaxColorAttachments> color_attachment_input_indices(
+      const RenderPass& render_pass) const;
+  uint32_t depth_input_index(const RenderPass& render_pass) const;
+  uint32_t stencil_input_index(const RenderPass& render_pass) const;
 };
 
 class RenderPassBuilder {
@@ -143,11 +288,63 @@ class RenderPassBuilder {
 
   RenderPassBuilder& with_shader_storage(ShaderStorageHandle handle);
 
+  /**
+   * @brief Shades the fragments at the rates stored in the image of `RenderGraph::create_shading_rate_image()`, e.g.
+   * built by the `ShadingRateGenerator` in a preceding compute pass. Requires `Device::has_fragment_shading_rate()`,
+   * the pipelines of the pass must be created with `GraphicsPipelineBuilder::create()` of the pass.
+   *
+   * @param handle
+   * @return RenderPassBuilder&
+   */
+  RenderPassBuilder& with_shading_rate_image(ShaderStorageHandle handle);
+
+  /**
+   * @brief Renders each draw once per view of the `view_mask`, e.g. `0b11` for the stereo or `0b1111` for a quad view
+   * layout. The view i is rendered to the array layer i of the attachments, which must have at least that many layers
+   * (see `RenderGraph::set_attachment_view_count()`). The shaders select the per-view state, e.g. the view-projection
+   * matrix, with `SV_ViewID` (`gl_ViewIndex`). The pipelines of the pass must be created with
+   * `GraphicsPipelineBuilder::create()` of the pass.
+   *
+   * @param view_mask At most `Device::max_multiview_view_count()` views.
+   * @return RenderPassBuilder&
+   */
+  RenderPassBuilder& with_view_mask(uint32_t view_mask);
+
+  /**
+   * @brief Reads the attachment of a preceding pass at the same pixel only, e.g. the lighting pass reading the G-buffer
+   * with `subpassLoad()`. The i-th local read is bound to the input attachment index i, the descriptor of the input
+   * attachment must use the VK_IMAGE_LAYOUT_RENDERING_LOCAL_READ layout.
+   *
+   * If the render graph has the pass merging enabled (`RenderGraph::enable_pass_merging()`) and the pass only reads the
+   * attachments of the directly preceding render pass this way, both of the passes are recorded in one rendering scope
+   * and the attachments read only inside of it are not stored. Otherwise the read is a regular dependency.
+   *
+   * @param handle
+   * @return RenderPassBuilder&
+   */
+  RenderPassBuilder& with_local_read(RenderPassAttachmentHandle handle);
+
   RenderPassBuilder& run_on_request_only();
+  RenderPassBuilder& with_name(std::string name);
 
-  RenderPassBuilder& on_emit(const std::function<void(Device& device, vk::CommandBuffer& cmd_buff)>& emit_func);
-  RenderPassBuilder& on_emit(
-      const std::function<void(const RenderGraph& render_graph, vk::CommandBuffer& cmd_buff)>& emit_func);
+  /**
+   * @brief Declares that the pass records the same commands every frame, e.g. a background or a static overlay. When
+   * the render graph caches the static passes (`RenderGraph::enable_static_pass_caching()`), the emit functions are
+   * invoked once into a reusable secondary command buffer, which is executed until the pass has to be recorded again.
+   * It happens when the `key` changes (`RenderGraph::set_static_pass_key()`), the render area changes or any of the
+   * attachments of the pass is recreated.
+   *
+   * The key must cover everything else recorded by the pass, e.g. a hash of the pipelines and the descriptor sets it
+   * binds. The pass must not bind any per frame resources. Static passes merged into a rendering scope are recorded
+   * every frame.
+   *
+   * @param key
+   * @return RenderPassBuilder&
+   */
+  RenderPassBuilder& as_static(uint64_t key = 0);
+
+  RenderPassBuilder& on_emit(PassEmitFunc emit_func);
+  RenderPassBuilder& on_emit(PassGraphEmitFunc emit_func);
 
   /**
    * @brief Builds the render pass.
@@ -157,7 +354,16 @@ class RenderPassBuilder {
    * @return Result<RenderPass, Error>
    * @warning After build is invoked it returns to default state (it does not preserve the current state).
    */
-  [[nodiscard]] Result<RenderPassHandle, Error> build(uint32_t width, uint32_t height);  // TODO(migoox): handle resize
+  [[nodiscard]] Result<RenderPassHandle, Error> build(uint32_t width, uint32_t height);
+
+  /**
+   * @brief Builds the render pass whose render area follows the `extent`, see `RenderGraph::resize_extent()`.
+   *
+   * @param extent
+   * @return Result<RenderPassHandle, Error>
+   * @warning After build is invoked it returns to default state (it does not preserve the current state).
+   */
+  [[nodiscard]] Result<RenderPassHandle, Error> build(RelativeExtent extent);
 
  private:
   explicit RenderPassBuilder(RenderGraph* render_graph) : render_graph_(render_graph) {}
@@ -165,18 +371,48 @@ class RenderPassBuilder {
   RenderGraph* render_graph_;
 };
 
+/**
+ * @brief Workgroup counts of the dispatch read by the GPU from the shader storage buffer, a
+ * `VkDispatchIndirectCommand` (3 x uint32) at the `offset`.
+ *
+ */
+struct IndirectDispatch {
+  ShaderStorageHandle args;
+  vk::DeviceSize offset;
+};
+
 struct ComputePass {
-  std::vector<RenderPassAttachmentDependency> attachment_dependencies;
-  std::vector<ShaderStorageDependency> shader_storage_dependencies;
+  PassAttachmentDependencies attachment_dependencies;
+  PassStorageDependencies shader_storage_dependencies;
+
+  PassShaderStorage shader_storage;
 
-  std::vector<ShaderStorageHandle> shader_storage;
+  PassEmitFunc on_cmd_emit_func;
+  PassGraphEmitFunc on_cmd_emit_func2;
 
-  std::function<void(Device& device, vk::CommandBuffer& cmd_buff)> on_cmd_emit_func = [](auto&, auto&) {};
-  std::function<void(const RenderGraph& render_graph, vk::CommandBuffer& cmd_buff)> on_cmd_emit_func2 = [](auto&,
-                                                                                                           auto&) {};
+  std::string name;
 
   bool on_request_only = false;
   bool requested       = false;
+
+  /**
+   * @brief Async passes are recorded on the compute queue when the render graph has async compute enabled.
+   *
+   */
+  bool async = false;
+
+  /**
+   * @brief Dispatch recorded by the render graph after the emit functions.
+   *
+   */
+  std::optional<IndirectDispatch> indirect_dispatch = std::nullopt;
+
+  /**
+   * @brief Invalidation key of a static pass, whose commands are recorded once and replayed, see `as_static()` of the
+   * builder.
+   *
+   */
+  std::optional<uint64_t> static_key = std::nullopt;
 };
 
 class ComputePassBuilder {
@@ -205,11 +441,39 @@ class ComputePassBuilder {
 
   ComputePassBuilder& with_shader_storage(ShaderStorageHandle handle);
 
+  /**
+   * @brief Sizes the pass on the GPU, e.g. by the counter written by a culling pass. The emit functions bind the
+   * pipeline, the descriptors and the push constants, then the render graph records the `dispatchIndirect` with the
+   * arguments at the `offset` of the buffer. The buffer becomes a dependency of the pass read by the
+   * `eDrawIndirect` stage, so the barrier after its last write is inserted by the render graph.
+   *
+   * @param args Shader storage buffer created with the `eIndirectBuffer` usage.
+   * @param offset Multiple of 4.
+   * @return ComputePassBuilder&
+   */
+  ComputePassBuilder& with_indirect_dispatch(ShaderStorageHandle args, vk::DeviceSize offset = 0);
+
   ComputePassBuilder& run_on_request_only();
+  ComputePassBuilder& with_name(std::string name);
+
+  /**
+   * @brief Compute counterpart of the `RenderPassBuilder::as_static()`. Static passes recorded on the async compute
+   * queue are recorded every frame.
+   *
+   */
+  ComputePassBuilder& as_static(uint64_t key = 0);
+
+  /**
+   * @brief Records the pass on the dedicated compute queue, so that it overlaps with the graphics passes that do not
+   * consume its shader storage. Async passes may only depend on shader storage that is not used by the preceding
+   * graphics passes, otherwise the pass is recorded on the graphics queue. Has no effect when the render graph does not
+   * have async compute enabled.
+   *
+   */
+  ComputePassBuilder& run_async();
 
-  ComputePassBuilder& on_emit(const std::function<void(Device& device, vk::CommandBuffer& cmd_buff)>& emit_func);
-  ComputePassBuilder& on_emit(
-      const std::function<void(const RenderGraph& device, vk::CommandBuffer& cmd_buff)>& emit_func);
+  ComputePassBuilder& on_emit(PassEmitFunc emit_func);
+  ComputePassBuilder& on_emit(PassGraphEmitFunc emit_func);
 
   /**
    * @brief Builds the render pass.
@@ -235,21 +499,355 @@ struct RenderPassAttachmentImage {
   vk::ImageLayout src_layout                     = vk::ImageLayout::eUndefined;
   vk::ClearColorValue clear_color                = vk::ClearColorValue{0.F, 0.F, 0.F, 1.F};
   vk::ClearDepthStencilValue clear_depth_stencil = vk::ClearDepthStencilValue{.depth = 1.F, .stencil = 0U};
+
+  /**
+   * @brief Scope that the last write has been made visible to by the compiled barriers. Reads within the scope in the
+   * same layout do not need another barrier.
+   *
+   */
+  vk::PipelineStageFlags2 visible_stage_mask = {};  // NOLINT
+  vk::AccessFlags2 visible_access_mask       = {};  // NOLINT
+
+  /**
+   * @brief Index of the `TransientAttachment` if the image is owned by the render graph compiler.
+   *
+   */
+  std::optional<uint32_t> transient_index = std::nullopt;
+
+  /**
+   * @brief Extent that the image follows. The image and the view are recreated during the compilation after the extent
+   * has been resized.
+   *
+   */
+  std::optional<RelativeExtent> relative_extent = std::nullopt;
+
+  /**
+   * @brief Array layers of the image, one per view of the multiview render passes, see
+   * `RenderGraph::set_attachment_view_count()`.
+   *
+   */
+  uint32_t view_count = 1;
+
+  /**
+   * @brief Incremented whenever the image and the view are recreated, so that the clients can detect that their
+   * descriptors referencing the view are outdated.
+   *
+   */
+  uint32_t generation = 0;
+
+  /**
+   * @brief Debug name of the image and the view, reapplied whenever they are recreated.
+   *
+   */
+  std::string name;
+};
+
+/**
+ * @brief Attachment whose image is created during the render graph compilation. The graph computes its lifetime from
+ * the passes that use it, so that attachments which are never alive at the same time can alias the same memory.
+ *
+ */
+struct TransientAttachment {
+  static constexpr uint32_t kUnused          = std::numeric_limits<uint32_t>::max();
+  static constexpr uint32_t kLazilyAllocated = std::numeric_limits<uint32_t>::max();
+
+  RenderPassAttachmentHandle handle;
+  ImageDescription description;
+  vk::ImageUsageFlags usage;
+  vk::ImageAspectFlags aspect;
+  vk::SampleCountFlagBits samples;
+  observer_ptr<Device> _p_device = nullptr;
+
+  /**
+   * @brief Lifetime expressed with indices of the first and the last pass that use the attachment. Final pass
+   * dependencies extend the lifetime to the end of the graph.
+   *
+   */
+  uint32_t first_use = kUnused;
+  uint32_t last_use  = kUnused;
+
+  /**
+   * @brief Index of the last pass that reads the content of the attachment, via a dependency or the load op, or
+   * `kUnused`. The passes writing the attachment after it do not store their output, see
+   * `RenderGraph::inferred_store_op()`.
+   *
+   */
+  uint32_t last_read = kUnused;
+
+  /**
+   * @brief True if the content of the attachment is read after the pass that writes it, either via a
+   * dependency or the store op.
+   *
+   */
+  bool stored = false;
+
+  /**
+   * @brief Index of the memory block that the attachment is bound to or `kLazilyAllocated`.
+   *
+   */
+  uint32_t memory_block = kLazilyAllocated;
+  bool realized         = false;
+
+  bool used() const { return first_use != kUnused; }
+  bool overlaps(const TransientAttachment& other) const {
+    return first_use <= other.last_use && other.first_use <= last_use;
+  }
 };
 
 struct ShaderStorageBuffer {
   BufferResource buffer;
   ShaderStorageType type;
-  vk::PipelineStageFlags2 src_stage_mask = vk::PipelineStageFlagBits2::eTopOfPipe;
-  vk::AccessFlags2 src_access_mask       = {};  // NOLINT
+  vk::PipelineStageFlags2 src_stage_mask     = vk::PipelineStageFlagBits2::eTopOfPipe;
+  vk::AccessFlags2 src_access_mask           = {};  // NOLINT
+  vk::PipelineStageFlags2 visible_stage_mask = {};  // NOLINT
+  vk::AccessFlags2 visible_access_mask       = {};  // NOLINT
 };
 
 struct ShaderStorageImage {
   ImageResource img;
   vk::raii::ImageView view;
-  vk::PipelineStageFlags2 src_stage_mask = vk::PipelineStageFlagBits2::eTopOfPipe;
-  vk::AccessFlags2 src_access_mask       = {};  // NOLINT
-  vk::ImageLayout src_layout             = vk::ImageLayout::eUndefined;
+  vk::PipelineStageFlags2 src_stage_mask     = vk::PipelineStageFlagBits2::eTopOfPipe;
+  vk::AccessFlags2 src_access_mask           = {};  // NOLINT
+  vk::ImageLayout src_layout                 = vk::ImageLayout::eUndefined;
+  vk::PipelineStageFlags2 visible_stage_mask = {};  // NOLINT
+  vk::AccessFlags2 visible_access_mask       = {};  // NOLINT
+};
+
+/**
+ * @brief Range of barriers issued with a single `pipelineBarrier2` call. Offsets index into the flat barrier arrays of
+ * the `CompiledRenderGraph`.
+ *
+ */
+struct CompiledBarrierBatch {
+  uint32_t image_barriers_offset  = 0;
+  uint32_t image_barriers_count   = 0;
+  uint32_t buffer_barriers_offset = 0;
+  uint32_t buffer_barriers_count  = 0;
+
+  bool empty() const { return image_barriers_count == 0 && buffer_barriers_count == 0; }
+};
+
+struct CompiledPass {
+  uint32_t pass_index = 0;
+  CompiledBarrierBatch barriers;
+
+  uint32_t color_attachments_offset = 0;
+  uint32_t color_attachments_count  = 0;
+  std::optional<vk::RenderingAttachmentInfo> depth_attachment_info   = std::nullopt;
+  std::optional<vk::RenderingAttachmentInfo> stencil_attachment_info = std::nullopt;
+  vk::Format depth_attachment_format                                 = vk::Format::eUndefined;
+  vk::Format stencil_attachment_format                               = vk::Format::eUndefined;
+
+  /**
+   * @brief Chained in front of the rendering info of the passes with a shading rate image.
+   *
+   */
+  std::optional<vk::RenderingFragmentShadingRateAttachmentInfoKHR> shading_rate_attachment_info = std::nullopt;
+
+  /**
+   * @brief Passes of a `RenderingScope` share the rendering begun by the first of them that is recorded, the
+   * attachments of the scope are then the attachments of every one of the passes.
+   *
+   */
+  bool begins_rendering = true;
+  bool ends_rendering   = true;
+
+  /**
+   * @brief Offset of the attachment locations and input attachment indices of the pass in a `RenderingScope` within
+   * the `CompiledRenderGraph::color_attachment_locations`, their count is `color_attachments_count`.
+   *
+   */
+  std::optional<uint32_t> attachment_locations_offset = std::nullopt;
+  uint32_t depth_input_index                          = VK_ATTACHMENT_UNUSED;
+  uint32_t stencil_input_index                        = VK_ATTACHMENT_UNUSED;
+};
+
+/**
+ * @brief Flat, replayable form of the render graph produced by `RenderGraph::compile()`. Stores the order of active
+ * passes, all of the barriers and rendering attachment infos, so that the per-frame `RenderGraph::emit()` only replays
+ * them.
+ *
+ */
+struct CompiledRenderGraph {
+  std::vector<CompiledPass> passes;
+  std::vector<vk::ImageMemoryBarrier2> image_barriers;
+  std::vector<vk::BufferMemoryBarrier2> buffer_barriers;
+  std::vector<vk::RenderingAttachmentInfo> color_attachment_infos;
+  std::vector<vk::Format> color_attachment_formats;
+  std::vector<uint32_t> color_attachment_locations;
+  std::vector<uint32_t> color_attachment_input_indices;
+  CompiledBarrierBatch final_barriers;
+
+  /**
+   * @brief Set of passes that were active (not request only or requested) during the compilation.
+   *
+   */
+  std::vector<bool> active_passes;
+
+  /**
+   * @brief Passes recorded on the async compute queue. Their shader storage is released by the graphics queue at the
+   * beginning of the frame and returned to it before the first graphics pass that uses it (`async_wait_pass_offset`).
+   *
+   */
+  std::vector<CompiledPass> async_passes;
+  std::vector<ShaderStorageHandle> async_shader_storage;
+  CompiledBarrierBatch to_compute_release;
+  CompiledBarrierBatch to_compute_acquire;
+  CompiledBarrierBatch to_graphics_release;
+  CompiledBarrierBatch to_graphics_acquire;
+  uint32_t async_wait_pass_offset               = 0;
+  vk::PipelineStageFlags2 async_wait_stage_mask = vk::PipelineStageFlagBits2::eAllCommands;
+
+  /**
+   * @brief Set of active passes whose outputs are consumed by the final pass dependencies, directly or through other
+   * live passes. Requested passes are always live. The remaining passes are culled.
+   *
+   */
+  std::vector<bool> live_passes;
+
+  /**
+   * @brief Barriers recorded by every emission of the graph, including the queue ownership transfers.
+   *
+   */
+  size_t barrier_count() const { return image_barriers.size() + buffer_barriers.size(); }
+
+  void clear() {
+    passes.clear();
+    image_barriers.clear();
+    buffer_barriers.clear();
+    color_attachment_infos.clear();
+    color_attachment_formats.clear();
+    color_attachment_locations.clear();
+    color_attachment_input_indices.clear();
+    final_barriers = CompiledBarrierBatch{};
+    active_passes.clear();
+    live_passes.clear();
+    async_passes.clear();
+    async_shader_storage.clear();
+    to_compute_release     = CompiledBarrierBatch{};
+    to_compute_acquire     = CompiledBarrierBatch{};
+    to_graphics_release    = CompiledBarrierBatch{};
+    to_graphics_acquire    = CompiledBarrierBatch{};
+    async_wait_pass_offset = 0;
+    async_wait_stage_mask  = vk::PipelineStageFlagBits2::eAllCommands;
+  }
+};
+
+/**
+ * @brief Flattened description of everything the compiled graph depends on: the set of active passes, the final pass
+ * dependencies, the extents and the generations of the attachment images. Passes and resources are append-only, so
+ * their counts identify them. Used as a key of the compilation cache.
+ *
+ */
+struct RenderGraphTopology {
+  std::vector<uint32_t> values;
+  size_t _hash{};
+
+  static RenderGraphTopology create(std::vector<uint32_t>&& values);
+
+  bool operator==(const RenderGraphTopology& other) const { return values == other.values; }
+
+  struct Hash {
+    std::size_t operator()(const RenderGraphTopology& topology) const { return topology._hash; }
+  };
+
+ private:
+  size_t generate_hash() const;
+};
+
+/**
+ * @brief Synchronization state of a single resource left by the simulated frame.
+ *
+ */
+struct RenderGraphResourceState {
+  vk::PipelineStageFlags2 src_stage_mask;
+  vk::AccessFlags2 src_access_mask;
+  vk::ImageLayout src_layout;
+  vk::PipelineStageFlags2 visible_stage_mask;
+  vk::AccessFlags2 visible_access_mask;
+};
+
+struct CompiledRenderGraphCacheEntry {
+  RenderGraphTopology topology;
+  CompiledRenderGraph compiled;
+  std::vector<RenderGraphResourceState> resource_states;
+};
+
+struct PassPipelineStatistics {
+  uint64_t input_assembly_vertices     = 0;
+  uint64_t vertex_shader_invocations   = 0;
+  uint64_t fragment_shader_invocations = 0;
+  uint64_t compute_shader_invocations  = 0;
+};
+
+/**
+ * @brief GPU cost of a single pass measured with timestamp queries. The time excludes the barriers issued before the
+ * pass.
+ *
+ */
+struct PassProfilingResult {
+  uint32_t pass_index = 0;
+  double gpu_time_ms  = 0.0;
+
+  /**
+   * @brief Raw timestamps of the beginning and the end of the pass, see `Device::calibrate_timestamps()`.
+   *
+   */
+  uint64_t gpu_begin_ticks = 0;
+  uint64_t gpu_end_ticks   = 0;
+
+  /**
+   * @brief The pass was recorded into the async compute command buffer.
+   *
+   */
+  bool async_compute = false;
+
+  /**
+   * @brief Only available if the pipeline statistics were requested and the pass was recorded directly into a graphics
+   * queue command buffer.
+   *
+   */
+  std::optional<PassPipelineStatistics> statistics = std::nullopt;
+};
+
+/**
+ * @brief Queries of a single frame in flight.
+ *
+ */
+struct RenderGraphProfilingFrame {
+  vk::raii::QueryPool timestamps = nullptr;
+  vk::raii::QueryPool statistics = nullptr;
+  uint32_t capacity              = 0;
+  std::vector<uint32_t> pass_indices;
+};
+
+/**
+ * @brief Reusable secondary command buffer of a static pass.
+ *
+ */
+struct StaticPassCommandBuffer {
+  vk::raii::CommandBuffer cmd_buff = nullptr;
+
+  /**
+   * @brief Hash of the key and of the state of the graph the commands were recorded with.
+   *
+   */
+  size_t state = 0;
+};
+
+/**
+ * @brief Command buffers recorded by the render graph with async compute enabled. Expected submission order:
+ *  1. `ownership_release` and `graphics` on the graphics queue, `ownership_release` signals a semaphore,
+ *  2. `async_compute` on the compute queue, waits for `ownership_release` and signals a semaphore,
+ *  3. `graphics_after_async_compute` on the graphics queue, waits for `async_compute` with the
+ *     `RenderGraph::async_compute_wait_stage_mask()`.
+ *
+ */
+struct AsyncComputeCommandBuffers {
+  vk::CommandBuffer ownership_release;
+  vk::CommandBuffer async_compute;
+  vk::CommandBuffer graphics;
+  vk::CommandBuffer graphics_after_async_compute;
 };
 
 /**
@@ -283,6 +881,96 @@ class RenderGraph {
                                                        bool readable                   = false,
                                                        vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1);
 
+  /**
+   * @brief Creates a color attachment whose image is allocated by the graph during compilation. Transient attachments
+   * with non-overlapping lifetimes share memory. If the content is never stored, lazily allocated memory is used when
+   * the device supports it. The image and its view are valid after the graph is compiled and might be recreated when
+   * new passes are emplaced.
+   *
+   * The load and store ops of the transient attachments are inferred by the graph: the content is not loaded before
+   * the first use and not stored when no later pass reads it, e.g. an MSAA attachment that is only resolved or a depth
+   * buffer that is only tested against. The declared ops are the upper bound, a declared clear is kept.
+   *
+   */
+  RenderPassAttachmentHandle create_transient_color_attachment(
+      Device& device, uint32_t width, uint32_t height, vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1,
+      vk::Format format = vk::Format::eB8G8R8A8Srgb);
+
+  RenderPassAttachmentHandle create_transient_depth_stencil_attachment(
+      Device& device, uint32_t width, uint32_t height, vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1,
+      std::optional<vk::Format> format = std::nullopt);
+
+  RenderPassAttachmentHandle create_transient_depth_attachment(
+      Device& device, uint32_t width, uint32_t height, vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1,
+      std::optional<vk::Format> format = std::nullopt);
+
+  /**
+   * @brief Creates a resizable extent, attachments and render passes declared relative to it follow its size.
+   *
+   */
+  RenderGraphExtentHandle create_extent(uint32_t width, uint32_t height);
+
+  /**
+   * @brief Changes the size of the extent. Only the attachments that follow the extent are reallocated, it happens
+   * lazily during the next compilation. Passes, pipelines and the rest of the attachments are reused. Resizing to the
+   * current size is a no-op.
+   *
+   */
+  void resize_extent(RenderGraphExtentHandle handle, uint32_t width, uint32_t height);
+
+  vk::Extent2D extent(RenderGraphExtentHandle handle) const { return extents_[handle.index]; }
+  vk::Extent2D extent(RelativeExtent extent) const;
+
+  /**
+   * @brief Renders the passes that follow the extent into the top-left sub-region of their attachments, scaled by
+   * `scale` in both dimensions. The attachments keep their size, so changing the scale does not reallocate or recompile
+   * anything and can happen every frame. The consumers of the attachments must sample only the rendered region, i.e.
+   * scale the texture coordinates by `render_uv_scale()`.
+   *
+   * @param handle
+   * @param scale Clamped to (0, 1].
+   */
+  void set_render_scale(RenderGraphExtentHandle handle, float scale);
+  float render_scale(RenderGraphExtentHandle handle) const { return render_scales_[handle.index]; }
+
+  /**
+   * @brief Render area of the passes that follow the `extent`, see `set_render_scale()`.
+   *
+   */
+  vk::Extent2D render_extent(RelativeExtent extent) const;
+
+  /**
+   * @brief Ratio of the render area to the attachment size in both dimensions, the texture coordinates of the rendered
+   * region are within [0, uv_scale].
+   *
+   */
+  std::array<float, 2> render_uv_scale(RelativeExtent extent) const;
+
+  /**
+   * @brief Makes the attachment follow the `extent`. If the size differs, the attachment is reallocated during the next
+   * compilation.
+   *
+   * @param handle
+   * @param extent
+   */
+  void bind_attachment_extent(RenderPassAttachmentHandle handle, RelativeExtent extent);
+
+  /**
+   * @brief Makes the attachment an array with a layer per view of the multiview render passes using it, see
+   * `RenderPassBuilder::with_view_mask()`. The attachment is reallocated during the next compilation, its view becomes
+   * a 2D array view.
+   *
+   * @param handle
+   * @param view_count
+   */
+  void set_attachment_view_count(RenderPassAttachmentHandle handle, uint32_t view_count);
+
+  /**
+   * @brief Total size of the memory shared by the transient attachments, lazily allocated memory is not included.
+   *
+   */
+  vk::DeviceSize transient_memory_size_bytes() const;
+
   ShaderStorageHandle create_shader_storage_buffer(
       Device& device, vk::DeviceSize size_bytes,
       vk::BufferUsageFlagBits additional_usage_flags = vk::BufferUsageFlagBits{});
@@ -294,6 +982,24 @@ class RenderGraph {
   ShaderStorageHandle create_shader_storage_image(Device& device, const ImageDescription& img_desc,
                                                   vk::ImageAspectFlags image_aspect = vk::ImageAspectFlagBits::eColor);
 
+  /**
+   * @brief Creates the `R8_UINT` storage image of the fragment shading rates of a render area, a texel per
+   * `shading_rate_texel_size()` block of pixels, see `RenderPassBuilder::with_shading_rate_image()`. Requires
+   * `Device::has_fragment_shading_rate()`.
+   *
+   * @param device
+   * @param width Largest width of the render area, the image is not resized with the render scale.
+   * @param height Largest height of the render area.
+   * @return ShaderStorageHandle
+   */
+  ShaderStorageHandle create_shading_rate_image(Device& device, uint32_t width, uint32_t height);
+
+  /**
+   * @brief Pixels covered by a texel of the shading rate images, the smallest texel size supported by the device.
+   *
+   */
+  vk::Extent2D shading_rate_texel_size() const { return shading_rate_texel_size_; }
+
   RenderPassAttachmentHandle emplace_attachment(ImageResource&& attachment, ImageAttachmentType type);
   RenderPassHandle emplace_render_pass(RenderPass&& render_pass);
   ComputePassHandle emplace_compute_pass(ComputePass&& compute_pass);
@@ -317,8 +1023,170 @@ class RenderGraph {
       vk::AccessFlagBits2 access_mask = vk::AccessFlagBits2::eShaderStorageRead,
       vk::ImageLayout layout          = vk::ImageLayout::eReadOnlyOptimal);
 
+  /**
+   * @brief Removes all of the final pass dependencies on the attachment. Passes that only produced the attachment are
+   * culled during the next compilation, e.g. when a viewport is not visible.
+   *
+   * @param handle
+   */
+  void remove_final_pass_dependency(RenderPassAttachmentHandle handle);
+
+  /**
+   * @brief Resolves the order of the active passes, image layouts and barrier batches and stores them in the flat
+   * `CompiledRenderGraph`. Passes whose outputs are not consumed by any final pass dependency (directly or through
+   * other passes) are culled, unless they were requested. There is no need to call it explicitly, `emit()` recompiles
+   * the graph whenever a pass or final dependency has been emplaced or the set of requested passes changed.
+   *
+   * The results are cached by the graph topology (see `RenderGraphTopology`), switching back to a recently compiled
+   * topology, e.g. re-requesting a pass or making a viewport visible again, only restores the cached result.
+   *
+   * @return Result<void, Error>
+   */
+  Result<void, Error> compile();
+
+  /**
+   * @brief Sets the number of the most recently used compiled graphs kept by the compilation cache. Zero disables the
+   * cache.
+   *
+   */
+  void set_compilation_cache_capacity(uint32_t capacity);
+  void clear_compilation_cache() { compilation_cache_.clear(); }
+
+  /**
+   * @brief Replays the compiled graph into the `cmd_buff`. Compiles the graph first when it's out of date. Panics if
+   * the compiled graph contains async compute passes.
+   *
+   * @param device
+   * @param cmd_buff
+   */
   void emit(Device& device, vk::CommandBuffer& cmd_buff);
 
+  /**
+   * @brief Replays the compiled graph split between the graphics and the compute queue, see
+   * `AsyncComputeCommandBuffers`. Compiles the graph first when it's out of date.
+   *
+   * @param device
+   * @param cmd_buffs
+   */
+  void emit(Device& device, AsyncComputeCommandBuffers& cmd_buffs);
+
+  /**
+   * @brief Replays the compiled graph into the `cmd_buff` with the commands of each pass recorded in parallel. The pass
+   * callbacks record secondary command buffers on `secondary_cmd_buffs.thread_count()` threads, the pass `i` is
+   * recorded by the thread `i % thread_count`. The primary `cmd_buff` still receives all of the barriers and executes
+   * the secondary command buffers in the compiled order. Compiles the graph first when it's out of date. Panics if the
+   * compiled graph contains async compute passes.
+   *
+   * @param device
+   * @param cmd_buff
+   * @param secondary_cmd_buffs Command pools must be created for the graphics queue family and must not be used by any
+   * pending submission. Secondary command buffers are (re)allocated when there are not enough of them.
+   * @warning The pass callbacks are invoked concurrently, they must not modify any shared state.
+   */
+  void emit_parallel(Device& device, vk::CommandBuffer& cmd_buff, CommandManager& secondary_cmd_buffs);
+
+  /**
+   * @brief Allows the compute passes marked with `run_async()` to be recorded on the compute queue. Has no effect if
+   * the device does not expose a dedicated compute queue family.
+   *
+   * @param device
+   */
+  void enable_async_compute(const Device& device);
+  bool is_async_compute_enabled() const { return async_compute_queue_family_ != VK_QUEUE_FAMILY_IGNORED; }
+
+  /**
+   * @brief Stages of the graphics submission that must wait for the async compute submission.
+   *
+   */
+  vk::PipelineStageFlags2 async_compute_wait_stage_mask() const { return compiled_.async_wait_stage_mask; }
+
+  /**
+   * @brief Merges the render passes that read the attachments of the preceding render pass at the same pixel into one
+   * rendering scope, see `RenderPassBuilder::with_local_read()`. Has no effect if the device does not support
+   * `Device::has_dynamic_rendering_local_read()`.
+   *
+   * @param device
+   * @warning Must be called before the passes are emplaced. The pipelines of the merged passes must be created after
+   * all of the passes of the scope are emplaced, as they are created with the attachments of the whole scope.
+   */
+  void enable_pass_merging(const Device& device);
+  bool is_pass_merging_enabled() const { return pass_merging_enabled_; }
+
+  /**
+   * @brief Scope that the render pass has been merged into or null.
+   *
+   */
+  const RenderingScope* rendering_scope(const RenderPass& render_pass) const;
+
+  /**
+   * @brief Records the static passes (see `RenderPassBuilder::as_static()`) only when they are out of date and replays
+   * them from the secondary command buffers otherwise. The replaced command buffers are freed `frames_in_flight` emits
+   * later, the graph must be emitted once per frame and the caller must wait for the frame that used the command
+   * buffer before emitting again.
+   *
+   * @param device
+   * @param frames_in_flight
+   * @return Result<void, Error>
+   */
+  Result<void, Error> enable_static_pass_caching(Device& device, uint32_t frames_in_flight);
+  void disable_static_pass_caching();
+  bool is_static_pass_caching_enabled() const { return static_pass_frames_in_flight_ > 0; }
+
+  /**
+   * @brief Records the static pass again during the next emit if the key differs from the current one.
+   *
+   * @param handle
+   * @param key
+   */
+  void set_static_pass_key(std::variant<ComputePassHandle, RenderPassHandle> handle, uint64_t key);
+
+  /**
+   * @brief Wraps every emitted pass in timestamp queries and, optionally, pipeline statistics queries. Each frame in
+   * flight uses its own query pools, the results are read back without waiting when the pools are reused, i.e.
+   * `frames_in_flight` emits later. The graph must be emitted once per frame and the caller must wait for the frame
+   * that used the command buffer before emitting again.
+   *
+   * @param device
+   * @param frames_in_flight
+   * @param pipeline_statistics Ignored if the device does not support pipeline statistics queries.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> enable_profiling(Device& device, uint32_t frames_in_flight, bool pipeline_statistics = false);
+  void disable_profiling();
+  bool is_profiling_enabled() const { return !profiling_frames_.empty(); }
+
+  /**
+   * @brief Wraps every pass emitted on the graphics queue in a Tracy GPU zone named after the pass. Independent of the
+   * `enable_profiling()`, has no effect unless the engine is built with the `ENABLE_TRACY` CMake option.
+   *
+   * @param profiler Null disables the zones, must outlive the graph otherwise.
+   */
+  void set_gpu_profiler(GpuProfiler* profiler) { p_gpu_profiler_ = profiler; }
+
+  /**
+   * @brief Wraps every pass emitted directly into the graphics queue command buffer in a `ShaderCostProfiler` pass
+   * scope. The pipeline statistics of the `enable_profiling()` are not written while the profiler is set, as the
+   * statistics queries cannot be nested.
+   *
+   * @param profiler Null disables the scopes, must outlive the graph otherwise.
+   */
+  void set_shader_cost_profiler(ShaderCostProfiler* profiler) { p_shader_cost_profiler_ = profiler; }
+  ShaderCostProfiler* shader_cost_profiler() const { return p_shader_cost_profiler_; }
+
+  /**
+   * @brief Results of the most recent frame whose queries have been read back, in the emission order.
+   *
+   */
+  std::span<const PassProfilingResult> profiling_results() const { return profiling_results_; }
+
+  /**
+   * @brief Name of the pass or a generated one if the pass is unnamed.
+   *
+   */
+  std::string pass_name(uint32_t pass_index) const;
+
+  const CompiledRenderGraph& compiled() const { return compiled_; }
+
   const RenderPassAttachmentImage& attachment(RenderPassAttachmentHandle handle) const;
   RenderPassAttachmentImage& attachment(RenderPassAttachmentHandle handle);
 
@@ -330,23 +1198,120 @@ class RenderGraph {
   ShaderStorageImage& shader_storage_image(ShaderStorageHandle handle);
   const ShaderStorageImage& shader_storage_image(ShaderStorageHandle handle) const;
 
+  /**
+   * @brief Names the resource in the validation messages and the GPU captures. The attachments keep the name when they
+   * are recreated after a resize or by the transient attachment aliasing.
+   *
+   */
+  void set_attachment_name(RenderPassAttachmentHandle handle, std::string name);
+  void set_shader_storage_name(ShaderStorageHandle handle, util::zstring_view name);
+
   const ComputePass& compute_pass(ComputePassHandle handle) const;
 
   void request_pass(std::variant<ComputePassHandle, RenderPassHandle> handle);
 
+  /**
+   * @brief True if the pass was not recorded during the last compilation, either because it was not requested or none
+   * of its outputs is consumed.
+   *
+   */
+  bool is_pass_culled(std::variant<ComputePassHandle, RenderPassHandle> handle) const;
+
   vk::BufferMemoryBarrier2 create_dependency_storage_buffer_barrier(ShaderStorageHandle handle,
                                                                     vk::PipelineStageFlags2 dst_stage_mask,
                                                                     vk::AccessFlags2 access_mask) const;
 
  private:
   friend RenderPassBuilder;
+  friend ComputePassBuilder;
 
   void for_each_attachment(const std::function<void(RenderPassAttachmentImage& attachment_image)>& action);
   void for_each_shader_storage_buffer(const std::function<void(ShaderStorageBuffer& buffer)>& action);
   void for_each_shader_storage_image(const std::function<void(ShaderStorageImage& buffer)>& action);
   void for_each_depth_or_stencil(const std::function<void(RenderPassAttachmentImage& attachment_image)>& action);
 
+  RenderPassAttachmentHandle create_transient_attachment(Device& device, const ImageDescription& desc,
+                                                         vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect,
+                                                         vk::SampleCountFlagBits samples, ImageAttachmentType type);
+  Result<void, Error> apply_pending_resizes();
+  Result<void, Error> update_transient_attachments();
+  Result<void, Error> realize_transient_attachments();
+  void begin_transient_lifetimes(uint32_t pass_index, std::vector<bool>& began);
+
+  vk::Extent2D render_area(const RenderPass& render_pass) const;
+
+  RenderGraphTopology topology() const;
+  std::vector<RenderGraphResourceState> save_resource_states();
+  void restore_resource_states(std::span<const RenderGraphResourceState> states);
+  bool restore_cached_compilation(const RenderGraphTopology& topology);
+  void cache_compilation(RenderGraphTopology&& topology);
+
+  static bool is_pass_active(const std::variant<RenderPass, ComputePass>& pass);
+  bool is_compiled_graph_outdated() const;
+  std::vector<bool> find_live_passes() const;
+  bool validate_dependencies(std::span<const RenderPassAttachmentDependency> attachment_dependencies,
+                             std::span<const ShaderStorageDependency> storage_dependencies) const;
+
+  void compile_dependency_barriers(std::span<const RenderPassAttachmentDependency> attachment_dependencies,
+                                   std::span<const ShaderStorageDependency> storage_dependencies);
+  void compile_shader_storage_target_barriers(std::span<const ShaderStorageHandle> handles);
+  void compile_render_pass_attachments(const RenderPass& render_pass, CompiledPass& compiled_pass);
+
+  /**
+   * @brief Ops of the attachment used by the pass, inferred from the lifetime of the transient attachment (see
+   * `TransientAttachment::last_read`). The ops of the rest of the attachments are kept as declared, their content might
+   * be read outside of the graph or in the next frame.
+   *
+   */
+  vk::AttachmentLoadOp inferred_load_op(uint32_t pass_index, const RenderPassAttachmentImageInfo& info) const;
+  vk::AttachmentStoreOp inferred_store_op(uint32_t pass_index, const RenderPassAttachmentImageInfo& info) const;
+  void compile_rendering_scope_attachments(const RenderingScope& scope, uint32_t pass_index,
+                                           CompiledPass& compiled_pass);
+  void compile_attachment_locations(const RenderingScope& scope, const RenderPass& render_pass,
+                                    CompiledPass& compiled_pass);
+  void merge_into_rendering_scope(uint32_t pass_index);
+  bool is_rendering_scope_intermediate(const RenderingScope& scope, RenderPassAttachmentHandle handle) const;
+  CompiledBarrierBatch begin_barrier_batch() const;
+  void end_barrier_batch(CompiledBarrierBatch& batch) const;
+
+  void emit_barrier_batch(vk::CommandBuffer& cmd_buff, const CompiledBarrierBatch& batch) const;
+  void emit_pass(Device& device, vk::CommandBuffer& cmd_buff, CompiledPass& compiled_pass,
+                 bool on_graphics_queue = true);
+  void begin_pass_rendering(vk::CommandBuffer& cmd_buff, const RenderPass& render_pass, CompiledPass& compiled_pass,
+                            vk::RenderingFlags flags);
+  void emit_attachment_locations(vk::CommandBuffer& cmd_buff, const CompiledPass& compiled_pass) const;
+  void record_secondary_pass(Device& device, vk::raii::CommandBuffer& secondary_cmd_buff,
+                             const CompiledPass& compiled_pass,
+                             vk::CommandBufferUsageFlags usage = vk::CommandBufferUsageFlagBits::eOneTimeSubmit) const;
+
+  /**
+   * @brief Secondary command buffer of the static pass recorded with the current state, recorded again if the state
+   * has changed. Null if the pass is recorded every frame.
+   *
+   */
+  vk::CommandBuffer update_static_pass(Device& device, const CompiledPass& compiled_pass);
+  size_t static_pass_state(uint32_t pass_index) const;
+  void free_retired_static_passes();
+  void reset_requested_passes();
+
+  void begin_profiled_frame(Device& device, vk::CommandBuffer& cmd_buff);
+  void read_profiling_results(const RenderGraphProfilingFrame& frame);
+  void begin_pass_profiling(vk::CommandBuffer& cmd_buff, uint32_t pass_index, bool with_statistics);
+  void end_pass_profiling(vk::CommandBuffer& cmd_buff, bool with_statistics);
+
+  std::vector<bool> find_async_passes();
+  void compile_queue_family_transfer(uint32_t src_queue_family, uint32_t dst_queue_family,
+                                     vk::PipelineStageFlags2 dst_stage_mask, vk::AccessFlags2 dst_access_mask,
+                                     CompiledBarrierBatch& release, CompiledBarrierBatch& acquire);
+
  private:
+  /**
+   * @brief Memory shared by the aliasing transient attachments, declared first so that it outlives the images bound to
+   * it.
+   *
+   */
+  std::vector<VmaRaiiAllocation> transient_memory_;
+
   std::vector<RenderPassAttachmentImage> color_attachments_;
   std::vector<RenderPassAttachmentImage> depth_stencil_attachments_;
   std::vector<RenderPassAttachmentImage> depth_attachments_;
@@ -359,6 +1324,53 @@ class RenderGraph {
   std::vector<ShaderStorageDependency> final_pass_storage_dependencies_;
 
   std::vector<std::variant<RenderPass, ComputePass>> passes_;
+  std::vector<RenderingScope> rendering_scopes_;
+  bool pass_merging_enabled_ = false;
+
+  std::vector<TransientAttachment> transient_attachments_;
+
+  std::vector<vk::Extent2D> extents_;
+  std::vector<float> render_scales_;
+  bool resize_pending_ = false;
+
+  vk::Extent2D shading_rate_texel_size_;
+
+  CompiledRenderGraph compiled_;
+  bool dirty_ = true;
+
+  /**
+   * @brief Most recently used compiled graphs, the first one is the most recent.
+   *
+   */
+  std::vector<CompiledRenderGraphCacheEntry> compilation_cache_;
+  uint32_t compilation_cache_capacity_ = 4;
+
+  uint32_t graphics_queue_family_      = VK_QUEUE_FAMILY_IGNORED;
+  uint32_t async_compute_queue_family_ = VK_QUEUE_FAMILY_IGNORED;
+
+  std::vector<RenderGraphProfilingFrame> profiling_frames_;
+  std::vector<PassProfilingResult> profiling_results_;
+  uint32_t profiling_frame_index_   = 0;
+  bool profile_pipeline_statistics_ = false;
+  float timestamp_period_ns_        = 1.F;
+
+  observer_ptr<GpuProfiler> p_gpu_profiler_                = nullptr;
+  observer_ptr<ShaderCostProfiler> p_shader_cost_profiler_ = nullptr;
+
+  /**
+   * @brief Pool of the static pass command buffers, declared before them so that it outlives them.
+   *
+   */
+  vk::raii::CommandPool static_pass_pool_ = nullptr;
+  std::vector<StaticPassCommandBuffer> static_passes_;
+
+  /**
+   * @brief Replaced command buffers with the emit count after which they are no longer used by any frame in flight.
+   *
+   */
+  std::vector<std::pair<uint64_t, vk::raii::CommandBuffer>> retired_static_passes_;
+  uint64_t static_pass_emit_count_       = 0;
+  uint32_t static_pass_frames_in_flight_ = 0;
 };
 
 }  // namespace eray::vkren
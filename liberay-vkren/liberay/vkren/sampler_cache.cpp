@@ -0,0 +1,56 @@
+#include <cassert>
+#include <expected>
+#include <liberay/util/hash_combine.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/sampler_cache.hpp>
+#include <vulkan/vulkan_enums.hpp>
+
+namespace eray::vkren {
+
+SamplerCache SamplerCache::create(Device& device) {
+  auto cache      = SamplerCache(nullptr);
+  cache.p_device_ = &device;
+  return cache;
+}
+
+Result<vk::Sampler, Error> SamplerCache::get(const vk::SamplerCreateInfo& create_info) {
+  assert(create_info.pNext == nullptr && "The chained structures are not a part of the sampler cache key");
+
+  if (auto it = samplers_.find(create_info); it != samplers_.end()) {
+    return *it->second;
+  }
+
+  auto sampler = (*p_device_)->createSampler(create_info);
+  if (!sampler) {
+    util::Logger::err("Could not create a sampler: {}", vk::to_string(sampler.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Sampler creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = sampler.error(),
+    });
+  }
+
+  return *samplers_.try_emplace(create_info, std::move(*sampler)).first->second;
+}
+
+size_t SamplerCache::Hash::operator()(const vk::SamplerCreateInfo& info) const {
+  auto result = std::hash<uint32_t>()(static_cast<uint32_t>(info.flags));
+  util::hash_combine(result, static_cast<uint32_t>(info.magFilter) | (static_cast<uint32_t>(info.minFilter) << 8) |
+                                 (static_cast<uint32_t>(info.mipmapMode) << 16));
+  util::hash_combine(result, static_cast<uint32_t>(info.addressModeU) |
+                                 (static_cast<uint32_t>(info.addressModeV) << 8) |
+                                 (static_cast<uint32_t>(info.addressModeW) << 16));
+  util::hash_combine(result, info.mipLodBias);
+  util::hash_combine(result, info.anisotropyEnable);
+  util::hash_combine(result, info.maxAnisotropy);
+  util::hash_combine(result, info.compareEnable);
+  util::hash_combine(result, static_cast<uint32_t>(info.compareOp));
+  util::hash_combine(result, info.minLod);
+  util::hash_combine(result, info.maxLod);
+  util::hash_combine(result, static_cast<uint32_t>(info.borderColor));
+  util::hash_combine(result, info.unnormalizedCoordinates);
+  return result;
+}
+
+}  // namespace eray::vkren
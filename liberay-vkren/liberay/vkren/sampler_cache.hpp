@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <liberay/util/flat_hash_map.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/error.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+class Device;
+
+/**
+ * @brief Samplers created with the same info are shared, so that the textures requesting identical samplers do not
+ * exhaust the sampler limit of the device (`maxSamplerAllocationCount`, 4000 on some GPUs). Owned by the `Device`,
+ * the samplers live as long as the device.
+ *
+ */
+class SamplerCache {
+ public:
+  SamplerCache() = delete;
+  explicit SamplerCache(std::nullptr_t) {}
+
+  static SamplerCache create(Device& device);
+
+  /**
+   * @brief Returns the cached sampler with the same info or creates a new one.
+   *
+   * @param create_info Must not have any structures chained, e.g. a sampler reduction mode.
+   * @return Result<vk::Sampler, Error>
+   */
+  [[nodiscard]] Result<vk::Sampler, Error> get(const vk::SamplerCreateInfo& create_info);
+
+  size_t size() const { return samplers_.size(); }
+
+ private:
+  struct Hash {
+    size_t operator()(const vk::SamplerCreateInfo& info) const;
+  };
+
+  util::FlatHashMap<vk::SamplerCreateInfo, vk::raii::Sampler, Hash> samplers_;
+  observer_ptr<Device> p_device_{};
+};
+
+}  // namespace eray::vkren
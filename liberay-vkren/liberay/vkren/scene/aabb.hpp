@@ -0,0 +1,9 @@
+#pragma once
+
+#include <liberay/math/bounds.hpp>
+
+namespace eray::vkren {
+
+using Aabb = math::Aabb3f;
+
+}  // namespace eray::vkren
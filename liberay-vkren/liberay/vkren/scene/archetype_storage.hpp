@@ -0,0 +1,471 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <liberay/util/job_system.hpp>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace eray::vkren {
+
+/**
+ * @brief Component storage grouping the keys by their component signature (archetype), an alternative to a sparse set
+ * per component for the scenes with millions of entities. Every archetype stores its rows in fixed size chunks of
+ * `kChunkBytes`, each chunk holds the keys and then a column per component of the signature (SoA), so iterating a
+ * component query walks the matching chunks linearly and the chunks can be processed in parallel.
+ *
+ * Adding or removing a component moves the whole row to the archetype of the new signature. Removals swap the last
+ * row of the archetype into the hole, the chunks stay packed.
+ *
+ * The component types are fixed by the template arguments, at most 32 distinct types.
+ *
+ */
+template <typename TKey, typename... TComponents>
+  requires std::convertible_to<TKey, size_t> && (sizeof...(TComponents) > 0)
+class ArchetypeStorage {
+ public:
+  using Key                               = TKey;
+  using Signature                         = uint32_t;
+  static constexpr size_t kChunkBytes     = 16 * 1024;
+  static constexpr size_t kComponentCount = sizeof...(TComponents);
+
+  static_assert(kComponentCount <= std::numeric_limits<Signature>::digits, "Too many component types");
+  static_assert(((alignof(TComponents) <= alignof(std::max_align_t)) && ...),
+                "Over-aligned components are unsupported");
+
+  /**
+   * @brief Index of the component type in the template arguments.
+   *
+   */
+  template <typename T>
+  static constexpr size_t kComponentIndex = [] {
+    constexpr auto kMatches = std::array<bool, kComponentCount>{std::is_same_v<T, TComponents>...};
+    static_assert(std::ranges::count(kMatches, true) == 1, "Not a component type of the storage");
+    return static_cast<size_t>(std::ranges::find(kMatches, true) - kMatches.begin());
+  }();
+
+  template <typename... Ts>
+  static constexpr Signature kSignatureOf = (Signature{0} | ... | (Signature{1} << kComponentIndex<Ts>));
+
+  ArchetypeStorage() = delete;
+  explicit ArchetypeStorage(std::nullptr_t) {}
+
+  ArchetypeStorage(const ArchetypeStorage&)            = delete;
+  ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+
+  ArchetypeStorage(ArchetypeStorage&& other) noexcept
+      : archetypes_(std::move(other.archetypes_)),
+        archetype_indices_(std::move(other.archetype_indices_)),
+        locations_(std::move(other.locations_)),
+        size_(std::exchange(other.size_, 0)) {
+    other.archetypes_.clear();
+  }
+
+  ArchetypeStorage& operator=(ArchetypeStorage&& other) noexcept {
+    if (this != &other) {
+      clear();
+      archetypes_        = std::move(other.archetypes_);
+      archetype_indices_ = std::move(other.archetype_indices_);
+      locations_         = std::move(other.locations_);
+      size_              = std::exchange(other.size_, 0);
+      other.archetypes_.clear();
+    }
+    return *this;
+  }
+
+  ~ArchetypeStorage() { clear(); }
+
+  [[nodiscard]] static ArchetypeStorage create(TKey max_key) {
+    auto storage = ArchetypeStorage(nullptr);
+    storage.locations_.resize(static_cast<size_t>(max_key) + 1);
+    return storage;
+  }
+
+  /**
+   * @brief Inserts a new key with the components, one value per component type.
+   *
+   */
+  template <typename... Ts>
+  void insert(TKey key, Ts&&... values) {
+    assert(!contains_key(key) && "Key already exists");
+    if (locations_.size() <= static_cast<size_t>(key)) {
+      locations_.resize(static_cast<size_t>(key) + 1);
+    }
+
+    const auto archetype = archetype_of(kSignatureOf<std::remove_cvref_t<Ts>...>);
+    const auto row       = push_row(archetypes_[archetype], key);
+    (construct<kComponentIndex<std::remove_cvref_t<Ts>>>(archetypes_[archetype], row, std::forward<Ts>(values)), ...);
+    locations_[static_cast<size_t>(key)] = Location{.archetype = archetype, .row = row};
+    ++size_;
+  }
+
+  /**
+   * @brief Removes the key with all of its components.
+   *
+   */
+  void erase(TKey key) {
+    assert(contains_key(key) && "Key does not exist");
+
+    auto& location = locations_[static_cast<size_t>(key)];
+    erase_row(archetypes_[location.archetype], location.row, archetypes_[location.archetype].signature);
+    location = Location{};
+    --size_;
+  }
+
+  /**
+   * @brief Adds the component to the key, the row moves to the archetype with the component.
+   *
+   */
+  template <typename T, typename... TArgs>
+  T& add(TKey key, TArgs&&... args) {
+    assert(contains_key(key) && !contains<T>(key) && "Key does not exist or already has the component");
+
+    const auto location = locations_[static_cast<size_t>(key)];
+    const auto target   = archetype_of(archetypes_[location.archetype].signature | kSignatureOf<T>);
+    const auto row      = move_row(key, location, target);
+    construct<kComponentIndex<T>>(archetypes_[target], row, std::forward<TArgs>(args)...);
+    return component<kComponentIndex<T>>(archetypes_[target], row);
+  }
+
+  /**
+   * @brief Removes the component of the key, the row moves to the archetype without the component.
+   *
+   */
+  template <typename T>
+  void remove(TKey key) {
+    assert(contains<T>(key) && "Key does not have the component");
+
+    const auto location = locations_[static_cast<size_t>(key)];
+    const auto target   = archetype_of(archetypes_[location.archetype].signature & ~kSignatureOf<T>);
+    move_row(key, location, target);
+  }
+
+  bool contains_key(TKey key) const {
+    return static_cast<size_t>(key) < locations_.size() &&
+           locations_[static_cast<size_t>(key)].archetype != kNullArchetype;
+  }
+
+  template <typename T>
+  bool contains(TKey key) const {
+    return contains_key(key) &&
+           (archetypes_[locations_[static_cast<size_t>(key)].archetype].signature & kSignatureOf<T>) != 0;
+  }
+
+  template <typename T>
+  T& at(TKey key) {
+    assert(contains<T>(key) && "Key does not have the component");
+    const auto location = locations_[static_cast<size_t>(key)];
+    return component<kComponentIndex<T>>(archetypes_[location.archetype], location.row);
+  }
+
+  template <typename T>
+  const T& at(TKey key) const {
+    assert(contains<T>(key) && "Key does not have the component");
+    const auto location = locations_[static_cast<size_t>(key)];
+    return component<kComponentIndex<T>>(archetypes_[location.archetype], location.row);
+  }
+
+  /**
+   * @brief Signature of the components of the key.
+   *
+   */
+  Signature signature_of(TKey key) const {
+    assert(contains_key(key) && "Key does not exist");
+    return archetypes_[locations_[static_cast<size_t>(key)].archetype].signature;
+  }
+
+  /**
+   * @brief Number of the keys.
+   *
+   */
+  size_t size() const { return size_; }
+
+  size_t archetype_count() const { return archetypes_.size(); }
+
+  size_t chunk_count() const {
+    auto count = size_t{0};
+    for (const auto& archetype : archetypes_) {
+      count += archetype.chunks.size();
+    }
+    return count;
+  }
+
+  /**
+   * @brief Rows of every chunk of the archetypes with all of the components `Ts`, as the span of the keys followed by
+   * a span per component. The chunks are disjoint, so they may be processed concurrently, e.g. by a `parallel_for`
+   * over the result. Invalidated by any insertion or removal.
+   *
+   */
+  template <typename... Ts>
+  std::vector<std::tuple<std::span<const TKey>, std::span<Ts>...>> chunks() {
+    auto result = std::vector<std::tuple<std::span<const TKey>, std::span<Ts>...>>();
+    for (auto& archetype : archetypes_) {
+      if ((archetype.signature & kSignatureOf<Ts...>) != kSignatureOf<Ts...>) {
+        continue;
+      }
+      for (auto chunk = 0U; chunk < archetype.chunks.size(); ++chunk) {
+        const auto rows = archetype.rows_in(chunk);
+        result.emplace_back(std::span<const TKey>(archetype.keys(chunk), rows),
+                            std::span<Ts>(archetype.template column<kComponentIndex<Ts>>(chunk), rows)...);
+      }
+    }
+    return result;
+  }
+
+  /**
+   * @brief Calls `func(key, components...)` for every key with all of the components `Ts`, the components are passed
+   * by reference. The keys come chunk by chunk. The components may be modified, but no key may be inserted or removed
+   * during the iteration.
+   *
+   */
+  template <typename... Ts, typename TFunc>
+  void each(TFunc&& func) {
+    for (auto& archetype : archetypes_) {
+      if ((archetype.signature & kSignatureOf<Ts...>) != kSignatureOf<Ts...>) {
+        continue;
+      }
+      for (auto chunk = 0U; chunk < archetype.chunks.size(); ++chunk) {
+        each_in_chunk<Ts...>(archetype, chunk, func);
+      }
+    }
+  }
+
+  /**
+   * @brief Same as `each()`, but the chunks are distributed among the workers of the `jobs`, one job per chunk. The
+   * `func` is invoked concurrently for the keys of different chunks.
+   *
+   */
+  template <typename... Ts, typename TFunc>
+  void each(util::JobSystem& jobs, TFunc&& func) {
+    auto matching = std::vector<std::pair<Archetype*, size_t>>();
+    for (auto& archetype : archetypes_) {
+      if ((archetype.signature & kSignatureOf<Ts...>) != kSignatureOf<Ts...>) {
+        continue;
+      }
+      for (auto chunk = 0U; chunk < archetype.chunks.size(); ++chunk) {
+        matching.emplace_back(&archetype, chunk);
+      }
+    }
+    jobs.parallel_for(
+        0, matching.size(),
+        [&matching, &func](size_t i) { each_in_chunk<Ts...>(*matching[i].first, matching[i].second, func); }, 1);
+  }
+
+  /**
+   * @brief Removes all of the keys, the locations keep their capacity.
+   *
+   */
+  void clear() {
+    for (auto& archetype : archetypes_) {
+      while (archetype.size > 0) {
+        destroy_row(archetype, archetype.size - 1, archetype.signature);
+        --archetype.size;
+      }
+    }
+    archetypes_.clear();
+    archetype_indices_.clear();
+    std::ranges::fill(locations_, Location{});
+    size_ = 0;
+  }
+
+ private:
+  template <size_t I>
+  using Component = std::tuple_element_t<I, std::tuple<TComponents...>>;
+
+  static constexpr uint32_t kNullArchetype = std::numeric_limits<uint32_t>::max();
+
+  struct Location {
+    uint32_t archetype = kNullArchetype;
+    uint32_t row       = 0;
+  };
+
+  /**
+   * @brief Rows of a single signature. The row `r` lives in the chunk `r / chunk_capacity`, all of the chunks but the
+   * last one are full.
+   *
+   */
+  struct Archetype {
+    Signature signature   = 0;
+    size_t chunk_capacity = 0;
+
+    /**
+     * @brief Offset of the component columns in a chunk, only the components of the signature have a column.
+     *
+     */
+    std::array<size_t, kComponentCount> offsets{};
+    std::vector<std::unique_ptr<std::byte[]>> chunks;
+    size_t size = 0;
+
+    size_t rows_in(size_t chunk) const { return std::min(chunk_capacity, size - chunk * chunk_capacity); }
+
+    TKey* keys(size_t chunk) const { return std::launder(reinterpret_cast<TKey*>(chunks[chunk].get())); }
+
+    template <size_t I>
+    Component<I>* column(size_t chunk) const {
+      return std::launder(reinterpret_cast<Component<I>*>(chunks[chunk].get() + offsets[I]));
+    }
+  };
+
+  static constexpr size_t align_up(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+
+  /**
+   * @brief Calls `func(std::integral_constant<size_t, I>)` for the index `I` of every component of the signature.
+   *
+   */
+  template <typename TFunc>
+  static void for_each_component(Signature signature, TFunc&& func) {
+    [&]<size_t... Is>(std::index_sequence<Is...>) {
+      (((signature & (Signature{1} << Is)) != 0 ? func(std::integral_constant<size_t, Is>{}) : void()), ...);
+    }(std::index_sequence_for<TComponents...>{});
+  }
+
+  /**
+   * @brief Lays out the columns of `capacity` rows, returns the bytes used.
+   *
+   */
+  static size_t layout(Archetype& archetype, size_t capacity) {
+    auto offset = sizeof(TKey) * capacity;
+    for_each_component(archetype.signature, [&]<size_t I>(std::integral_constant<size_t, I>) {
+      offset               = align_up(offset, alignof(Component<I>));
+      archetype.offsets[I] = offset;
+      offset += sizeof(Component<I>) * capacity;
+    });
+    return offset;
+  }
+
+  uint32_t archetype_of(Signature signature) {
+    if (auto it = archetype_indices_.find(signature); it != archetype_indices_.end()) {
+      return it->second;
+    }
+
+    auto archetype      = Archetype{};
+    archetype.signature = signature;
+    auto row_bytes      = sizeof(TKey);
+    for_each_component(signature, [&row_bytes]<size_t I>(std::integral_constant<size_t, I>) {
+      row_bytes += sizeof(Component<I>);
+    });
+
+    // The alignment padding between the columns may not fit, the capacity shrinks until it does
+    auto capacity = kChunkBytes / row_bytes;
+    while (layout(archetype, capacity) > kChunkBytes) {
+      --capacity;
+    }
+    assert(capacity > 0 && "Row does not fit a chunk");
+    archetype.chunk_capacity = capacity;
+
+    const auto index = static_cast<uint32_t>(archetypes_.size());
+    archetypes_.push_back(std::move(archetype));
+    archetype_indices_.emplace(signature, index);
+    return index;
+  }
+
+  static uint32_t push_row(Archetype& archetype, TKey key) {
+    if (archetype.size == archetype.chunks.size() * archetype.chunk_capacity) {
+      archetype.chunks.push_back(std::make_unique_for_overwrite<std::byte[]>(kChunkBytes));
+    }
+    const auto row                                                                 = archetype.size++;
+    archetype.keys(row / archetype.chunk_capacity)[row % archetype.chunk_capacity] = key;
+    return static_cast<uint32_t>(row);
+  }
+
+  template <size_t I>
+  static Component<I>& component(const Archetype& archetype, size_t row) {
+    return archetype.template column<I>(row / archetype.chunk_capacity)[row % archetype.chunk_capacity];
+  }
+
+  template <size_t I, typename... TArgs>
+  static void construct(Archetype& archetype, size_t row, TArgs&&... args) {
+    std::construct_at(&component<I>(archetype, row), std::forward<TArgs>(args)...);
+  }
+
+  /**
+   * @brief Destroys the components of the `signature` at the row.
+   *
+   */
+  static void destroy_row(Archetype& archetype, size_t row, Signature signature) {
+    for_each_component(signature, [&]<size_t I>(std::integral_constant<size_t, I>) {
+      std::destroy_at(&component<I>(archetype, row));
+    });
+  }
+
+  /**
+   * @brief Destroys the components of the `signature` at the row and fills the hole with the last row, the
+   * components outside of the `signature` must have been moved out or destroyed already.
+   *
+   */
+  void erase_row(Archetype& archetype, size_t row, Signature signature) {
+    destroy_row(archetype, row, signature);
+
+    const auto last = archetype.size - 1;
+    if (row != last) {
+      for_each_component(archetype.signature, [&]<size_t I>(std::integral_constant<size_t, I>) {
+        std::construct_at(&component<I>(archetype, row), std::move(component<I>(archetype, last)));
+        std::destroy_at(&component<I>(archetype, last));
+      });
+
+      const auto moved_key = archetype.keys(last / archetype.chunk_capacity)[last % archetype.chunk_capacity];
+      archetype.keys(row / archetype.chunk_capacity)[row % archetype.chunk_capacity] = moved_key;
+      locations_[static_cast<size_t>(moved_key)].row                                  = static_cast<uint32_t>(row);
+    }
+
+    --archetype.size;
+    if (archetype.size <= (archetype.chunks.size() - 1) * archetype.chunk_capacity) {
+      archetype.chunks.pop_back();
+    }
+  }
+
+  /**
+   * @brief Moves the components shared by both signatures to a new row of the `target` archetype, the components
+   * missing in the target are destroyed.
+   *
+   */
+  uint32_t move_row(TKey key, Location location, uint32_t target) {
+    // Creating the target archetype may have reallocated the archetypes, so the references are taken only here
+    auto& source   = archetypes_[location.archetype];
+    auto& dest     = archetypes_[target];
+    const auto row = push_row(dest, key);
+    for_each_component(source.signature & dest.signature, [&]<size_t I>(std::integral_constant<size_t, I>) {
+      std::construct_at(&component<I>(dest, row), std::move(component<I>(source, location.row)));
+    });
+
+    // The moved-from components are destroyed with the rest of the source row
+    erase_row(source, location.row, source.signature);
+    locations_[static_cast<size_t>(key)] = Location{.archetype = target, .row = row};
+    return row;
+  }
+
+  template <typename... Ts, typename TFunc>
+  static void each_in_chunk(Archetype& archetype, size_t chunk, TFunc& func) {
+    const auto rows    = archetype.rows_in(chunk);
+    const auto* keys   = archetype.keys(chunk);
+    const auto columns = std::tuple<Ts*...>(archetype.template column<kComponentIndex<Ts>>(chunk)...);
+    for (auto i = size_t{0}; i < rows; ++i) {
+      func(keys[i], std::get<Ts*>(columns)[i]...);
+    }
+  }
+
+  std::vector<Archetype> archetypes_;
+  std::unordered_map<Signature, uint32_t> archetype_indices_;
+
+  /**
+   * @brief Archetype and row of every key, indexed by the key.
+   *
+   */
+  std::vector<Location> locations_;
+  size_t size_ = 0;
+};
+
+}  // namespace eray::vkren
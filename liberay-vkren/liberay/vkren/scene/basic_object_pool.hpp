@@ -1,9 +1,12 @@
 #pragma once
 
+#include <bit>
+#include <cassert>
 #include <concepts>
 #include <cstddef>
 #include <cstdint>
-#include <ranges>
+#include <limits>
+#include <span>
 #include <vector>
 
 namespace eray::vkren {
@@ -17,6 +20,13 @@ concept CComposedIdExtractor = requires(std::size_t index, std::uint32_t version
   { T::kNullIndex } -> std::convertible_to<size_t>;
 };
 
+/**
+ * @brief Hands out versioned ids of the objects stored in external arrays indexed by `index_of()`. The free indices
+ * form an intrusive LIFO list threaded through the slots, the indices that have never been used are handed out from
+ * the end of the used range, so `create()` needs no pre-filled free list. Liveness is kept in a bitset, the live ids
+ * are iterated word by word with `std::countr_zero`.
+ *
+ */
 template <typename TComposedId, CComposedIdExtractor<TComposedId> TIdExtractor>
 class BasicObjectPool {
  public:
@@ -30,39 +40,102 @@ class BasicObjectPool {
   [[nodiscard]] static BasicObjectPool create(size_t max_objs_count) {
     auto obj_pool = BasicObjectPool();
 
-    obj_pool.free_ =
-        std::views::iota(0U, max_objs_count) | std::views::reverse | std::ranges::to<std::vector<size_t>>();
-    obj_pool.obj_count_ = 0;
-    obj_pool.version_.resize(max_objs_count, 0);
-    obj_pool.exist_.resize(max_objs_count, false);
+    obj_pool.max_objs_count_ = max_objs_count;
+    obj_pool.obj_count_      = 0;
+    obj_pool.slots_.reserve(max_objs_count);
+    obj_pool.live_.resize((max_objs_count + kWordBits - 1) / kWordBits, 0);
 
     return obj_pool;
   }
 
   [[nodiscard]] TComposedId create() {
-    auto ind = free_.back();
-    free_.pop_back();
+    assert(obj_count_ < max_objs_count_ && "Object pool is full");
+
+    auto ind = size_t{};
+    if (free_head_ != kNullSlot) {
+      ind        = free_head_;
+      free_head_ = slots_[ind].next_free;
+    } else {
+      ind = slots_.size();
+      slots_.push_back(Slot{});
+    }
+
     ++obj_count_;
-    exist_[ind] = true;
-    return TIdExtractor::compose_id(ind, version_[ind]);
+    set_live(ind, true);
+    return TIdExtractor::compose_id(ind, slots_[ind].version);
+  }
+
+  /**
+   * @brief Creates `ids.size()` objects at once. The reused indices are taken from the free list first, the rest are
+   * appended to the used range as a whole.
+   *
+   * @param ids
+   */
+  void create_many(std::span<TComposedId> ids) {
+    assert(obj_count_ + ids.size() <= max_objs_count_ && "Object pool is full");
+
+    auto it = ids.begin();
+    for (; it != ids.end() && free_head_ != kNullSlot; ++it) {
+      const auto ind = static_cast<size_t>(free_head_);
+      free_head_     = slots_[ind].next_free;
+      set_live(ind, true);
+      *it = TIdExtractor::compose_id(ind, slots_[ind].version);
+    }
+
+    const auto first = slots_.size();
+    const auto count = static_cast<size_t>(ids.end() - it);
+    slots_.resize(first + count);
+    set_live_range(first, first + count);
+    for (auto ind = first; it != ids.end(); ++it, ++ind) {
+      *it = TIdExtractor::compose_id(ind, 0);
+    }
+
+    obj_count_ += ids.size();
   }
 
   void remove(TComposedId id) {
     --obj_count_;
-    auto index    = TIdExtractor::index_of(id);
-    exist_[index] = false;
-    free_.push_back(index);
-    ++version_[index];
+    auto index = TIdExtractor::index_of(id);
+    set_live(index, false);
+    ++slots_[index].version;
+    slots_[index].next_free = free_head_;
+    free_head_              = static_cast<uint32_t>(index);
+  }
+
+  /**
+   * @brief Removes all of the `ids`, each must exist and occur once.
+   *
+   * @param ids
+   */
+  void remove_many(std::span<const TComposedId> ids) {
+    for (const auto id : ids) {
+      remove(id);
+    }
   }
 
   [[nodiscard]] bool exists(TComposedId id) const {
     auto index   = TIdExtractor::index_of(id);
     auto version = TIdExtractor::version_of(id);
-    return index < exist_.size() && exist_[index] && version_[index] == version;
+    return index < slots_.size() && is_live(index) && slots_[index].version == version;
   }
 
   [[nodiscard]] size_t count() const { return obj_count_; }
 
+  /**
+   * @brief Calls `func(TComposedId)` for every live object in the ascending index order.
+   *
+   * @param func
+   */
+  template <typename TFunc>
+  void for_each(TFunc&& func) const {
+    for (auto word_index = 0U; word_index < live_.size(); ++word_index) {
+      for (auto word = live_[word_index]; word != 0; word &= word - 1) {
+        const auto ind = word_index * kWordBits + static_cast<size_t>(std::countr_zero(word));
+        func(TIdExtractor::compose_id(ind, slots_[ind].version));
+      }
+    }
+  }
+
   /**
    * @brief Returns null id if object indexed with `index` does not exist.
    *
@@ -70,11 +143,11 @@ class BasicObjectPool {
    * @return TComposedId
    */
   [[nodiscard]] TComposedId compose_id(size_t index) const {
-    if (index == kNullIndex || index >= exist_.size() || !exist_[index]) {
+    if (index == kNullIndex || index >= slots_.size() || !is_live(index)) {
       return kNullId;
     }
 
-    return Extractor::compose_id(index, version_[index]);
+    return Extractor::compose_id(index, slots_[index].version);
   }
 
   [[nodiscard]] static size_t index_of(TComposedId id) { return Extractor::index_of(id); }
@@ -86,9 +159,53 @@ class BasicObjectPool {
  private:
   BasicObjectPool() = default;
 
-  std::vector<uint32_t> version_;
-  std::vector<bool> exist_;
-  std::vector<size_t> free_;
+  static constexpr uint32_t kNullSlot = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t kWordBits   = 64;
+
+  /**
+   * @brief The `next_free` link is meaningful only while the slot is on the free list.
+   *
+   */
+  struct Slot {
+    uint32_t version   = 0;
+    uint32_t next_free = kNullSlot;
+  };
+
+  bool is_live(size_t index) const { return ((live_[index / kWordBits] >> (index % kWordBits)) & 1U) != 0; }
+
+  void set_live(size_t index, bool live) {
+    const auto mask = uint64_t{1} << (index % kWordBits);
+    if (live) {
+      live_[index / kWordBits] |= mask;
+    } else {
+      live_[index / kWordBits] &= ~mask;
+    }
+  }
+
+  /**
+   * @brief Raises the live bits of `[first, last)`, whole words at once.
+   *
+   */
+  void set_live_range(size_t first, size_t last) {
+    for (; first < last && first % kWordBits != 0; ++first) {
+      set_live(first, true);
+    }
+    for (; first + kWordBits <= last; first += kWordBits) {
+      live_[first / kWordBits] = ~uint64_t{0};
+    }
+    for (; first < last; ++first) {
+      set_live(first, true);
+    }
+  }
+
+  /**
+   * @brief Slots of the indices used so far, the never used indices have no slot yet.
+   *
+   */
+  std::vector<Slot> slots_;
+  std::vector<uint64_t> live_;
+  uint32_t free_head_    = kNullSlot;
+  size_t max_objs_count_ = 0;
   size_t obj_count_{};
 };
 
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <liberay/math/mat.hpp>
+#include <liberay/vkren/scene/depth_pyramid.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+/**
+ * @brief Smallest clip space w of a corner that is still projected, the boxes crossing the near plane are not tested.
+ *
+ */
+constexpr float kMinClipW = 1e-5F;
+
+}  // namespace
+
+std::optional<ScreenRect> project_bounds(const Aabb& world_bounds, const math::Mat4f& view_projection) {
+  auto rect = ScreenRect{
+      .min_uv        = math::Vec2f::filled(1.F),
+      .max_uv        = math::Vec2f::filled(0.F),
+      .nearest_depth = 1.F,
+  };
+  for (auto corner = 0U; corner < 8; ++corner) {
+    const auto x    = (corner & 1U) != 0 ? world_bounds.max.x() : world_bounds.min.x();
+    const auto y    = (corner & 2U) != 0 ? world_bounds.max.y() : world_bounds.min.y();
+    const auto z    = (corner & 4U) != 0 ? world_bounds.max.z() : world_bounds.min.z();
+    const auto clip = view_projection * math::Vec4f(x, y, z, 1.F);
+    if (clip.w() <= kMinClipW) {
+      return std::nullopt;
+    }
+
+    // The Vulkan projection flips y, so the NDC y grows downwards like the texture coordinates
+    const auto u       = clip.x() / clip.w() * 0.5F + 0.5F;
+    const auto v       = clip.y() / clip.w() * 0.5F + 0.5F;
+    rect.min_uv        = math::Vec2f(std::min(rect.min_uv.x(), u), std::min(rect.min_uv.y(), v));
+    rect.max_uv        = math::Vec2f(std::max(rect.max_uv.x(), u), std::max(rect.max_uv.y(), v));
+    rect.nearest_depth = std::min(rect.nearest_depth, clip.z() / clip.w());
+  }
+
+  rect.min_uv = math::Vec2f(std::clamp(rect.min_uv.x(), 0.F, 1.F), std::clamp(rect.min_uv.y(), 0.F, 1.F));
+  rect.max_uv = math::Vec2f(std::clamp(rect.max_uv.x(), 0.F, 1.F), std::clamp(rect.max_uv.y(), 0.F, 1.F));
+  return rect;
+}
+
+DepthPyramid DepthPyramid::create(uint32_t depth_width, uint32_t depth_height) {
+  assert(depth_width > 0 && depth_height > 0 && "Depth attachment must not be empty");
+
+  auto pyramid          = DepthPyramid(nullptr);
+  pyramid.depth_width_  = depth_width;
+  pyramid.depth_height_ = depth_height;
+  pyramid.levels_.resize(level_count_of(depth_width, depth_height));
+  for (auto level = 0U; level < pyramid.levels_.size(); ++level) {
+    const auto extent = pyramid.level_extent(level);
+    pyramid.levels_[level].assign(static_cast<size_t>(extent.x()) * extent.y(), 1.F);
+  }
+  return pyramid;
+}
+
+uint32_t DepthPyramid::level_count_of(uint32_t depth_width, uint32_t depth_height) {
+  const auto extent = level_extent_of(depth_width, depth_height, 0);
+  return static_cast<uint32_t>(std::bit_width(std::max(extent.x(), extent.y()) - 1)) + 1;
+}
+
+math::Vec2u DepthPyramid::level_extent_of(uint32_t depth_width, uint32_t depth_height, uint32_t level) {
+  const auto shift = level + 1;
+  const auto round = (1U << shift) - 1;
+  return math::Vec2u(std::max((depth_width + round) >> shift, 1U), std::max((depth_height + round) >> shift, 1U));
+}
+
+void DepthPyramid::build(std::span<const float> depth) {
+  assert(depth.size() == static_cast<size_t>(depth_width_) * depth_height_ && "Depth size mismatch");
+
+  auto source_extent = math::Vec2u(depth_width_, depth_height_);
+  auto source        = depth;
+  for (auto level = 0U; level < levels_.size(); ++level) {
+    const auto extent = level_extent(level);
+    auto& target      = levels_[level];
+    for (auto y = 0U; y < extent.y(); ++y) {
+      for (auto x = 0U; x < extent.x(); ++x) {
+        // The reads past the edge are clamped, an odd source texel is covered by the last target texel
+        const auto x0 = std::min(2 * x, source_extent.x() - 1);
+        const auto x1 = std::min(2 * x + 1, source_extent.x() - 1);
+        const auto y0 = std::min(2 * y, source_extent.y() - 1) * source_extent.x();
+        const auto y1 = std::min(2 * y + 1, source_extent.y() - 1) * source_extent.x();
+        target[x + y * extent.x()] = std::max({source[x0 + y0], source[x1 + y0], source[x0 + y1], source[x1 + y1]});
+      }
+    }
+    source_extent = extent;
+    source        = target;
+  }
+}
+
+bool DepthPyramid::is_occluded(const ScreenRect& rect) const {
+  // The level on which the footprint spans at most two texels, a texel of the level `l` covers 2^(l + 1) depth texels
+  const auto width  = (rect.max_uv.x() - rect.min_uv.x()) * static_cast<float>(depth_width_);
+  const auto height = (rect.max_uv.y() - rect.min_uv.y()) * static_cast<float>(depth_height_);
+  const auto size   = std::max(width, height);
+  const auto level  = std::min(size <= 2.F ? 0U : static_cast<uint32_t>(std::ceil(std::log2(size))) - 1,
+                               level_count() - 1);
+
+  const auto extent   = level_extent(level);
+  const auto scale    = static_cast<float>(1U << (level + 1));
+  const auto texel_of = [scale](float uv, uint32_t depth_size, uint32_t level_size) {
+    const auto coord = static_cast<uint32_t>(std::max(uv * static_cast<float>(depth_size) / scale, 0.F));
+    return std::min(coord, level_size - 1);
+  };
+  const auto x0 = texel_of(rect.min_uv.x(), depth_width_, extent.x());
+  const auto x1 = texel_of(rect.max_uv.x(), depth_width_, extent.x());
+  const auto y0 = texel_of(rect.min_uv.y(), depth_height_, extent.y());
+  const auto y1 = texel_of(rect.max_uv.y(), depth_height_, extent.y());
+
+  const auto farthest =
+      std::max({texel(level, x0, y0), texel(level, x1, y0), texel(level, x0, y1), texel(level, x1, y1)});
+  return rect.nearest_depth > farthest;
+}
+
+}  // namespace eray::vkren
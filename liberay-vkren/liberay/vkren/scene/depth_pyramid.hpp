@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/mat_fwd.hpp>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/scene/aabb.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace eray::vkren {
+
+/**
+ * @brief Screen space footprint of a box, see `project_bounds()`.
+ *
+ */
+struct ScreenRect {
+  /**
+   * @brief Corners in the texture coordinates of the viewport, `(0, 0)` is the top left corner, clamped to `[0, 1]`.
+   *
+   */
+  math::Vec2f min_uv;
+  math::Vec2f max_uv;
+
+  /**
+   * @brief Depth (0 at the near plane, 1 at the far plane) of the point of the box closest to the camera.
+   *
+   */
+  float nearest_depth;
+};
+
+/**
+ * @brief Projects the corners of the box with a Vulkan view projection matrix (`perspective_vk_rh()`, depth range 0
+ * to 1). Matches `indirect_cull.slang`.
+ *
+ * @param world_bounds Must not be empty.
+ * @param view_projection
+ * @return std::optional<ScreenRect> Empty when a corner lies behind the near plane, the box may cover the whole screen
+ * then.
+ */
+std::optional<ScreenRect> project_bounds(const Aabb& world_bounds, const math::Mat4f& view_projection);
+
+/**
+ * @brief Hierarchical depth (Hi-Z) pyramid, CPU reference of `hiz_downsample.slang` and of the occlusion test of
+ * `indirect_cull.slang`. The level 0 has half of the depth resolution (rounded up) and every next level halves the
+ * previous one down to a single texel. A texel keeps the farthest depth of the depth texels it covers, so a box whose
+ * nearest depth lies behind all of the texels under its footprint is hidden.
+ *
+ */
+class DepthPyramid {
+ public:
+  DepthPyramid() = delete;
+  explicit DepthPyramid(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the pyramid of a depth attachment, all of the texels at the far plane.
+   *
+   * @param depth_width
+   * @param depth_height
+   * @return DepthPyramid
+   */
+  [[nodiscard]] static DepthPyramid create(uint32_t depth_width, uint32_t depth_height);
+
+  /**
+   * @brief Number of the levels of the pyramid of a depth attachment, the last one has a single texel.
+   *
+   */
+  static uint32_t level_count_of(uint32_t depth_width, uint32_t depth_height);
+
+  /**
+   * @brief Extent of the level `level` of the pyramid of a depth attachment.
+   *
+   */
+  static math::Vec2u level_extent_of(uint32_t depth_width, uint32_t depth_height, uint32_t level);
+
+  /**
+   * @brief Rebuilds all of the levels.
+   *
+   * @param depth Row major depth attachment texels.
+   */
+  void build(std::span<const float> depth);
+
+  /**
+   * @brief Tests the footprint against the level on which it covers at most 2x2 texels.
+   *
+   * @param rect
+   * @return true if the box is hidden behind the depth the pyramid was built from.
+   */
+  bool is_occluded(const ScreenRect& rect) const;
+
+  uint32_t level_count() const { return static_cast<uint32_t>(levels_.size()); }
+  math::Vec2u level_extent(uint32_t level) const { return level_extent_of(depth_width_, depth_height_, level); }
+  float texel(uint32_t level, uint32_t x, uint32_t y) const { return levels_[level][x + y * level_extent(level).x()]; }
+
+ private:
+  std::vector<std::vector<float>> levels_;
+  uint32_t depth_width_  = 0;
+  uint32_t depth_height_ = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <array>
+#include <liberay/vkren/scene/dynamic_bvh.hpp>
+#include <utility>
+
+namespace eray::vkren {
+
+namespace {
+
+/**
+ * @brief Number of the centroid bins the SAH split candidates are evaluated at.
+ *
+ */
+constexpr size_t kSahBins = 12;
+
+}  // namespace
+
+DynamicBvh DynamicBvh::create(float fat_margin) {
+  auto bvh        = DynamicBvh(nullptr);
+  bvh.fat_margin_ = fat_margin;
+  return bvh;
+}
+
+uint32_t DynamicBvh::insert(uint32_t value, const Aabb& box) {
+  const auto leaf = allocate_node();
+  nodes_[leaf]    = Node{.box = box.expanded(fat_margin_), .value = value};
+  insert_leaf(leaf);
+  ++leaf_count_;
+  return leaf;
+}
+
+void DynamicBvh::remove(uint32_t leaf) {
+  remove_leaf(leaf);
+  free_node(leaf);
+  --leaf_count_;
+}
+
+bool DynamicBvh::update(uint32_t leaf, const Aabb& box) {
+  if (nodes_[leaf].box.contains(box)) {
+    return false;
+  }
+
+  remove_leaf(leaf);
+  nodes_[leaf].box = box.expanded(fat_margin_);
+  insert_leaf(leaf);
+  return true;
+}
+
+void DynamicBvh::build(std::span<const BvhItem> items, std::span<uint32_t> leaves) {
+  clear();
+  if (items.empty()) {
+    return;
+  }
+
+  nodes_.reserve(2 * items.size() - 1);
+  build_leaves_.clear();
+  for (auto i = 0U; i < items.size(); ++i) {
+    const auto leaf = allocate_node();
+    nodes_[leaf]    = Node{.box = items[i].box.expanded(fat_margin_), .value = items[i].value};
+    leaves[i]       = leaf;
+    build_leaves_.push_back(leaf);
+  }
+
+  root_                = build_range(0, build_leaves_.size());
+  nodes_[root_].parent = kNullNode;
+  leaf_count_          = items.size();
+}
+
+void DynamicBvh::clear() {
+  nodes_.clear();
+  free_nodes_.clear();
+  root_       = kNullNode;
+  leaf_count_ = 0;
+}
+
+void DynamicBvh::cull(const Frustum& frustum, std::vector<uint32_t>& values) const {
+  if (root_ == kNullNode) {
+    return;
+  }
+
+  cull_stack_.clear();
+  cull_stack_.push_back(CullEntry{.node = root_, .inside = false});
+  while (!cull_stack_.empty()) {
+    auto entry = cull_stack_.back();
+    cull_stack_.pop_back();
+
+    const auto& node = nodes_[entry.node];
+    if (!entry.inside) {
+      const auto test = frustum.classify(node.box);
+      if (test == FrustumTest::Outside) {
+        continue;
+      }
+      entry.inside = test == FrustumTest::Inside;
+    }
+
+    if (node.is_leaf()) {
+      values.push_back(node.value);
+      continue;
+    }
+    cull_stack_.push_back(CullEntry{.node = node.child2, .inside = entry.inside});
+    cull_stack_.push_back(CullEntry{.node = node.child1, .inside = entry.inside});
+  }
+}
+
+float DynamicBvh::internal_area() const {
+  auto area = 0.F;
+  for (auto i = 0U; i < nodes_.size(); ++i) {
+    if (nodes_[i].child1 != kNullNode) {
+      area += nodes_[i].box.surface_area();
+    }
+  }
+  return area;
+}
+
+uint32_t DynamicBvh::height() const {
+  if (root_ == kNullNode) {
+    return 0;
+  }
+
+  auto height = 0U;
+  auto stack  = std::vector<std::pair<uint32_t, uint32_t>>{{root_, 0U}};
+  while (!stack.empty()) {
+    const auto [node, depth] = stack.back();
+    stack.pop_back();
+    height = std::max(height, depth);
+    if (!nodes_[node].is_leaf()) {
+      stack.emplace_back(nodes_[node].child1, depth + 1);
+      stack.emplace_back(nodes_[node].child2, depth + 1);
+    }
+  }
+  return height;
+}
+
+uint32_t DynamicBvh::allocate_node() {
+  if (free_nodes_.empty()) {
+    nodes_.emplace_back();
+    return static_cast<uint32_t>(nodes_.size() - 1);
+  }
+
+  const auto node = free_nodes_.back();
+  free_nodes_.pop_back();
+  nodes_[node] = Node{};
+  return node;
+}
+
+void DynamicBvh::free_node(uint32_t node) {
+  nodes_[node] = Node{};
+  free_nodes_.push_back(node);
+}
+
+void DynamicBvh::insert_leaf(uint32_t leaf) {
+  if (root_ == kNullNode) {
+    root_               = leaf;
+    nodes_[leaf].parent = kNullNode;
+    return;
+  }
+
+  // Descend towards the sibling with the lowest cost, the inheritance cost is paid by every ancestor of the new parent
+  const auto leaf_box = nodes_[leaf].box;
+  auto sibling        = root_;
+  while (!nodes_[sibling].is_leaf()) {
+    const auto& node         = nodes_[sibling];
+    const auto area          = node.box.surface_area();
+    const auto combined_area = node.box.merged(leaf_box).surface_area();
+    const auto cost          = 2.F * combined_area;
+    const auto inheritance   = 2.F * (combined_area - area);
+
+    const auto child_cost = [&](uint32_t child) {
+      const auto& child_node = nodes_[child];
+      const auto merged_area = child_node.box.merged(leaf_box).surface_area();
+      return child_node.is_leaf() ? merged_area + inheritance
+                                  : merged_area - child_node.box.surface_area() + inheritance;
+    };
+    const auto cost1 = child_cost(node.child1);
+    const auto cost2 = child_cost(node.child2);
+    if (cost < cost1 && cost < cost2) {
+      break;
+    }
+    sibling = cost1 < cost2 ? node.child1 : node.child2;
+  }
+
+  const auto old_parent     = nodes_[sibling].parent;
+  const auto new_parent     = allocate_node();
+  nodes_[new_parent].parent = old_parent;
+  nodes_[new_parent].box    = leaf_box.merged(nodes_[sibling].box);
+  nodes_[new_parent].child1 = sibling;
+  nodes_[new_parent].child2 = leaf;
+  nodes_[sibling].parent    = new_parent;
+  nodes_[leaf].parent       = new_parent;
+
+  if (old_parent == kNullNode) {
+    root_ = new_parent;
+  } else if (nodes_[old_parent].child1 == sibling) {
+    nodes_[old_parent].child1 = new_parent;
+  } else {
+    nodes_[old_parent].child2 = new_parent;
+  }
+
+  refit_ancestors(new_parent);
+}
+
+void DynamicBvh::remove_leaf(uint32_t leaf) {
+  if (leaf == root_) {
+    root_ = kNullNode;
+    return;
+  }
+
+  const auto parent      = nodes_[leaf].parent;
+  const auto grandparent = nodes_[parent].parent;
+  const auto sibling     = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+  nodes_[leaf].parent    = kNullNode;
+  nodes_[sibling].parent = grandparent;
+  free_node(parent);
+
+  if (grandparent == kNullNode) {
+    root_ = sibling;
+    return;
+  }
+
+  if (nodes_[grandparent].child1 == parent) {
+    nodes_[grandparent].child1 = sibling;
+  } else {
+    nodes_[grandparent].child2 = sibling;
+  }
+  refit_ancestors(grandparent);
+}
+
+void DynamicBvh::refit_ancestors(uint32_t node) {
+  while (node != kNullNode) {
+    nodes_[node].box = nodes_[nodes_[node].child1].box.merged(nodes_[nodes_[node].child2].box);
+    rotate(node);
+    node = nodes_[node].parent;
+  }
+}
+
+void DynamicBvh::rotate(uint32_t node) {
+  const auto b = nodes_[node].child1;
+  const auto c = nodes_[node].child2;
+
+  // Swapping the child `x` with the grandchild `y` shrinks the sibling `s` of `x` to the box of `x` and `z`, the box
+  // of the node itself never changes
+  struct Rotation {
+    uint32_t x;
+    uint32_t s;
+    uint32_t y;
+    uint32_t z;
+  };
+  auto best      = Rotation{.x = kNullNode, .s = kNullNode, .y = kNullNode, .z = kNullNode};
+  auto best_cost = 0.F;
+
+  const auto consider = [&](uint32_t x, uint32_t s) {
+    const auto& sibling = nodes_[s];
+    if (sibling.is_leaf()) {
+      return;
+    }
+    const auto area = sibling.box.surface_area();
+    for (const auto [y, z] : {std::pair{sibling.child1, sibling.child2}, std::pair{sibling.child2, sibling.child1}}) {
+      const auto cost = nodes_[x].box.merged(nodes_[z].box).surface_area() - area;
+      if (cost < best_cost) {
+        best_cost = cost;
+        best      = Rotation{.x = x, .s = s, .y = y, .z = z};
+      }
+    }
+  };
+  consider(b, c);
+  consider(c, b);
+
+  if (best.x == kNullNode) {
+    return;
+  }
+
+  auto& parent = nodes_[node];
+  (parent.child1 == best.x ? parent.child1 : parent.child2) = best.y;
+  auto& sibling = nodes_[best.s];
+  (sibling.child1 == best.y ? sibling.child1 : sibling.child2) = best.x;
+  nodes_[best.x].parent = best.s;
+  nodes_[best.y].parent = node;
+  sibling.box           = nodes_[best.x].box.merged(nodes_[best.z].box);
+}
+
+uint32_t DynamicBvh::build_range(size_t first, size_t last) {
+  if (last - first == 1) {
+    return build_leaves_[first];
+  }
+
+  auto centroids = Aabb{};
+  for (auto i = first; i < last; ++i) {
+    const auto c = nodes_[build_leaves_[i]].box.center();
+    centroids    = centroids.merged(Aabb{.min = c, .max = c});
+  }
+
+  const auto size = centroids.max - centroids.min;
+  const auto axis = size.x() >= size.y() && size.x() >= size.z() ? 0U : (size.y() >= size.z() ? 1U : 2U);
+  const auto lo   = centroids.min[axis];
+  const auto span = size[axis];
+
+  const auto begin = build_leaves_.begin();
+  auto mid         = first + (last - first) / 2;
+  if (span > 0.F) {
+    const auto bin_of = [&](uint32_t leaf) {
+      const auto t = (nodes_[leaf].box.center()[axis] - lo) * (static_cast<float>(kSahBins) / span);
+      return std::min(static_cast<size_t>(t), kSahBins - 1);
+    };
+
+    auto bin_boxes  = std::array<Aabb, kSahBins>{};
+    auto bin_counts = std::array<size_t, kSahBins>{};
+    for (auto i = first; i < last; ++i) {
+      const auto bin = bin_of(build_leaves_[i]);
+      bin_boxes[bin] = bin_boxes[bin].merged(nodes_[build_leaves_[i]].box);
+      ++bin_counts[bin];
+    }
+
+    // Right to left sweep first, the cost of the split before `bin` is then evaluated left to right
+    auto right_areas = std::array<float, kSahBins>{};
+    auto right_box   = Aabb{};
+    for (auto bin = kSahBins - 1; bin > 0; --bin) {
+      right_box        = right_box.merged(bin_boxes[bin]);
+      right_areas[bin] = right_box.empty() ? 0.F : right_box.surface_area();
+    }
+
+    auto best_split  = size_t{0};
+    auto best_cost   = 0.F;
+    auto left_box    = Aabb{};
+    auto left_count  = size_t{0};
+    auto right_count = last - first;
+    for (auto bin = 1U; bin < kSahBins; ++bin) {
+      left_box = left_box.merged(bin_boxes[bin - 1]);
+      left_count += bin_counts[bin - 1];
+      right_count -= bin_counts[bin - 1];
+      if (left_count == 0 || right_count == 0) {
+        continue;
+      }
+
+      const auto cost = left_box.surface_area() * static_cast<float>(left_count) +
+                        right_areas[bin] * static_cast<float>(right_count);
+      if (best_split == 0 || cost < best_cost) {
+        best_split = bin;
+        best_cost  = cost;
+      }
+    }
+
+    const auto split = std::partition(begin + static_cast<ptrdiff_t>(first), begin + static_cast<ptrdiff_t>(last),
+                                      [&](uint32_t leaf) { return bin_of(leaf) < best_split; });
+    mid              = static_cast<size_t>(split - begin);
+  }
+
+  const auto child1     = build_range(first, mid);
+  const auto child2     = build_range(mid, last);
+  const auto node       = allocate_node();
+  nodes_[node].box      = nodes_[child1].box.merged(nodes_[child2].box);
+  nodes_[node].child1   = child1;
+  nodes_[node].child2   = child2;
+  nodes_[child1].parent = node;
+  nodes_[child2].parent = node;
+  return node;
+}
+
+}  // namespace eray::vkren
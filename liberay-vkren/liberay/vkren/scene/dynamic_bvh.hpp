@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/vkren/scene/aabb.hpp>
+#include <liberay/vkren/scene/frustum.hpp>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace eray::vkren {
+
+struct BvhItem {
+  Aabb box;
+  uint32_t value;
+};
+
+/**
+ * @brief Bounding volume hierarchy with a single value per leaf. The leaves keep fat boxes (the boxes expanded by the
+ * margin), so a value that moves a little does not touch the tree at all. Insertions pick the sibling with the lowest
+ * surface area cost increase, after every insertion, removal and refit the ancestors are refit and rotated to lower
+ * the surface area of the tree. `build()` creates the whole tree at once with a binned SAH split, which gives better
+ * trees than a sequence of insertions.
+ *
+ */
+class DynamicBvh {
+ public:
+  static constexpr uint32_t kNullNode = std::numeric_limits<uint32_t>::max();
+
+  DynamicBvh() = delete;
+  explicit DynamicBvh(std::nullptr_t) {}
+
+  /**
+   * @brief Creates an empty tree.
+   *
+   * @param fat_margin Margin the leaf boxes are expanded by.
+   * @return DynamicBvh
+   */
+  [[nodiscard]] static DynamicBvh create(float fat_margin);
+
+  /**
+   * @brief Inserts a leaf with the `value`.
+   *
+   * @param value
+   * @param box Must not be empty.
+   * @return uint32_t Leaf id, stable until the leaf is removed or the tree is rebuilt.
+   */
+  [[nodiscard]] uint32_t insert(uint32_t value, const Aabb& box);
+
+  void remove(uint32_t leaf);
+
+  /**
+   * @brief Moves the leaf to the `box`, unless its fat box still contains the `box`.
+   *
+   * @param leaf
+   * @param box Must not be empty.
+   * @return true if the leaf has been reinserted.
+   */
+  bool update(uint32_t leaf, const Aabb& box);
+
+  /**
+   * @brief Replaces the whole tree with the top down binned SAH build over the `items`.
+   *
+   * @param items
+   * @param leaves Receives the leaf id of each item, must be as long as the `items`.
+   */
+  void build(std::span<const BvhItem> items, std::span<uint32_t> leaves);
+
+  void clear();
+
+  /**
+   * @brief Appends the values of the leaves whose fat boxes are not outside of the `frustum`. Subtrees lying fully
+   * inside of the frustum are appended without further plane tests.
+   *
+   * @param frustum
+   * @param values
+   */
+  void cull(const Frustum& frustum, std::vector<uint32_t>& values) const;
+
+  uint32_t value(uint32_t leaf) const { return nodes_[leaf].value; }
+  const Aabb& fat_box(uint32_t leaf) const { return nodes_[leaf].box; }
+
+  uint32_t root() const { return root_; }
+  size_t leaf_count() const { return leaf_count_; }
+  float fat_margin() const { return fat_margin_; }
+
+  /**
+   * @brief Sum of the surface areas of the internal nodes, the expected cost of a query is proportional to it.
+   *
+   */
+  float internal_area() const;
+
+  /**
+   * @brief Length of the longest path from the root to a leaf, 0 for an empty tree.
+   *
+   */
+  uint32_t height() const;
+
+ private:
+  struct Node {
+    Aabb box;
+    uint32_t parent = kNullNode;
+    uint32_t child1 = kNullNode;
+    uint32_t child2 = kNullNode;
+    uint32_t value  = kNullNode;
+
+    bool is_leaf() const { return child1 == kNullNode; }
+  };
+
+  uint32_t allocate_node();
+  void free_node(uint32_t node);
+
+  void insert_leaf(uint32_t leaf);
+  void remove_leaf(uint32_t leaf);
+
+  /**
+   * @brief Refits the boxes of the `node` and its ancestors, rotating each of them on the way up.
+   *
+   */
+  void refit_ancestors(uint32_t node);
+
+  /**
+   * @brief Swaps a child of the `node` with a grandchild, if it lowers the surface area of the other child.
+   *
+   */
+  void rotate(uint32_t node);
+
+  /**
+   * @brief Builds the subtree over `build_leaves_[first, last)`, returns its root.
+   *
+   */
+  uint32_t build_range(size_t first, size_t last);
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_nodes_;
+  uint32_t root_     = kNullNode;
+  size_t leaf_count_ = 0;
+  float fat_margin_  = 0.F;
+
+  std::vector<uint32_t> build_leaves_;
+
+  struct CullEntry {
+    uint32_t node;
+    bool inside;
+  };
+  mutable std::vector<CullEntry> cull_stack_;
+};
+
+}  // namespace eray::vkren
@@ -1,9 +1,11 @@
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <liberay/vkren/scene/entity_pool.hpp>
 #include <liberay/vkren/scene/flat_tree.hpp>
+#include <numeric>
 #include <optional>
-#include <stack>
+#include <span>
 #include <unordered_map>
 #include <vector>
 
@@ -18,6 +20,15 @@ NodeId FlatTree::create_node(NodeId parent_id) {
   auto new_node_id    = nodes_pool_.create();
   auto new_node_index = EntityPool<NodeId>::index_of(new_node_id);
 
+  // The new node becomes the last child, so it follows the current subtree of the parent in the preorder
+  if (!dfs_dirty_) {
+    const auto position = dfs_position_cached_[parent_index] + subtree_size_[parent_index];
+    dfs_preorder_cached_.insert(dfs_preorder_cached_.begin() + static_cast<std::ptrdiff_t>(position), new_node_id);
+    update_dfs_positions(position, dfs_preorder_cached_.size());
+  }
+  subtree_size_[new_node_index] = 1;
+  resize_ancestors(parent_index, 1);
+
   nodes_[new_node_index] = Node{
       .parent        = parent_index,
       .left_child    = kNullNodeIndex,
@@ -36,7 +47,7 @@ NodeId FlatTree::create_node(NodeId parent_id) {
 
   level_[new_node_index] = level_[parent_index] + 1;
 
-  set_dirty();
+  bfs_dirty_ = true;
 
   return new_node_id;
 }
@@ -116,7 +127,15 @@ void FlatTree::delete_node(NodeId node_id) {
     nodes_[right].left_sibling = left;
   }
 
-  set_dirty();
+  // The subtree is a contiguous range of the preorder
+  const auto size = subtree_size_[node_index];
+  if (!dfs_dirty_) {
+    const auto first = dfs_preorder_cached_.begin() + static_cast<std::ptrdiff_t>(dfs_position_cached_[node_index]);
+    dfs_preorder_cached_.erase(first, first + static_cast<std::ptrdiff_t>(size));
+    update_dfs_positions(dfs_position_cached_[node_index], dfs_preorder_cached_.size());
+  }
+  resize_ancestors(parent, -static_cast<std::ptrdiff_t>(size));
+  bfs_dirty_ = true;
 
   // Delete all descendants
   for (auto descendant_id : FlatTreeDFSRange(this, node_id)) {
@@ -131,7 +150,8 @@ NodeId FlatTree::copy_node(NodeId node_id, NodeId parent_id) {
   auto old_to_new     = std::unordered_map<NodeId, NodeId>();
   old_to_new[node_id] = create_node();  // use root and later change parent, this handles node_id == parent_id case
 
-  for (auto curr_node_id : FlatTreeBFSRange(this, node_id, false)) {
+  // The preorder visits the parents first
+  for (auto curr_node_id : FlatTreeDFSRange(this, node_id, false)) {
     auto curr_node_index     = EntityPool<NodeId>::index_of(curr_node_id);
     auto curr_parent_id      = nodes_pool_.compose_id(nodes_[curr_node_index].parent);
     old_to_new[curr_node_id] = create_node(old_to_new[curr_parent_id]);
@@ -139,8 +159,6 @@ NodeId FlatTree::copy_node(NodeId node_id, NodeId parent_id) {
 
   change_parent(old_to_new[node_id], parent_id);
 
-  set_dirty();
-
   return old_to_new[node_id];
 }
 
@@ -158,6 +176,25 @@ void FlatTree::change_parent(NodeId node_id, NodeId parent_id) {
   auto right  = nodes_[node_index].right_sibling;
   auto parent = nodes_[node_index].parent;
 
+  // The subtree becomes the last child of the new parent, so its range is moved to the end of the new parent's range
+  const auto size = subtree_size_[node_index];
+  if (!dfs_dirty_) {
+    const auto first      = dfs_position_cached_[node_index];
+    const auto parent_end = dfs_position_cached_[parent_index] + subtree_size_[parent_index];
+    const auto begin      = dfs_preorder_cached_.begin();
+    if (parent_end <= first) {
+      std::rotate(begin + static_cast<std::ptrdiff_t>(parent_end), begin + static_cast<std::ptrdiff_t>(first),
+                  begin + static_cast<std::ptrdiff_t>(first + size));
+      update_dfs_positions(parent_end, first + size);
+    } else {
+      std::rotate(begin + static_cast<std::ptrdiff_t>(first), begin + static_cast<std::ptrdiff_t>(first + size),
+                  begin + static_cast<std::ptrdiff_t>(parent_end));
+      update_dfs_positions(first, parent_end);
+    }
+  }
+  resize_ancestors(parent, -static_cast<std::ptrdiff_t>(size));
+  resize_ancestors(parent_index, static_cast<std::ptrdiff_t>(size));
+
   if (nodes_[parent].left_child == nodes_[parent].right_child) {
     nodes_[parent].left_child = nodes_[parent].right_child = kNullNodeIndex;
   } else if (node_index == nodes_[parent].left_child) {
@@ -175,9 +212,13 @@ void FlatTree::change_parent(NodeId node_id, NodeId parent_id) {
 
   nodes_[node_index].parent        = parent_index;
   nodes_[node_index].right_sibling = kNullNodeIndex;
-  nodes_[node_index].left_sibling  = kNullNodeIndex;
+  nodes_[node_index].left_sibling  = nodes_[parent_index].right_child;
 
   level_[node_index] = level_[parent_index] + 1;
+  for (auto descendant_id : FlatTreeDFSRange(this, node_id, false)) {
+    auto descendant_index    = EntityPool<NodeId>::index_of(descendant_id);
+    level_[descendant_index] = level_[nodes_[descendant_index].parent] + 1;
+  }
 
   if (nodes_[parent_index].right_child != kNullNodeIndex) {
     nodes_[nodes_[parent_index].right_child].right_sibling = node_index;
@@ -187,7 +228,7 @@ void FlatTree::change_parent(NodeId node_id, NodeId parent_id) {
   }
   nodes_[parent_index].right_child = node_index;
 
-  set_dirty();
+  bfs_dirty_ = true;
 }
 
 uint32_t FlatTree::node_level(NodeId node_id) const {
@@ -206,9 +247,11 @@ const std::vector<NodeId>& FlatTree::nodes_bfs_order() const {
     return bfs_order_cached_;
   }
 
+  // The order itself is the queue of the traversal
   bfs_order_cached_.reserve(nodes_pool_.count());
-  for (auto node : FlatTreeBFSRange(this, kRootNodeId)) {
-    dfs_preorder_cached_.push_back(node);
+  bfs_order_cached_.push_back(kRootNodeId);
+  for (auto i = size_t{0}; i < bfs_order_cached_.size(); ++i) {
+    for_each_child(bfs_order_cached_[i], [this](NodeId child_id) { bfs_order_cached_.push_back(child_id); });
   }
   bfs_dirty_ = false;
 
@@ -227,20 +270,67 @@ const std::vector<NodeId>& FlatTree::nodes_dfs_preorder() const {
 
   dfs_preorder_cached_.reserve(nodes_pool_.count());
   for (auto node : FlatTreeDFSRange(this, kRootNodeId)) {
+    dfs_position_cached_[EntityPool<NodeId>::index_of(node)] = dfs_preorder_cached_.size();
     dfs_preorder_cached_.push_back(node);
   }
   dfs_dirty_ = false;
   return dfs_preorder_cached_;
 }
 
+std::span<const NodeId> FlatTree::subtree_dfs_preorder(NodeId node_id) const {
+  assert(exists(node_id) && "Node must exist");
+
+  const auto& preorder = nodes_dfs_preorder();
+  const auto index     = EntityPool<NodeId>::index_of(node_id);
+  return std::span<const NodeId>(preorder).subspan(dfs_position_cached_[index], subtree_size_[index]);
+}
+
+size_t FlatTree::dfs_position(size_t node_index) const {
+  nodes_dfs_preorder();
+  return dfs_position_cached_[node_index];
+}
+
+size_t FlatTree::subtree_size(NodeId node_id) const {
+  assert(exists(node_id) && "Node must exist");
+  return subtree_size_[EntityPool<NodeId>::index_of(node_id)];
+}
+
 FlatTree FlatTree::create(size_t max_nodes_count) {
   auto tree = FlatTree();
   tree.nodes_.resize(max_nodes_count, Node{});
   tree.level_.resize(max_nodes_count, 0);
+  tree.dfs_position_cached_.resize(max_nodes_count, 0);
+  tree.subtree_size_.resize(max_nodes_count, 0);
   tree.nodes_pool_ = EntityPool<NodeId>::create(max_nodes_count);
   auto root_id     = tree.nodes_pool_.create();
   assert(root_id == kRootNodeId && "Root index invariant not met");
   static_cast<void>(root_id);
+  tree.subtree_size_[kRootNodeIndex] = 1;
+
+  // Building the tree node by node does not pay for the splices until the preorder is requested
+  tree.dfs_dirty_ = true;
+  tree.bfs_dirty_ = true;
+  return tree;
+}
+
+FlatTree FlatTree::create_from_preorder(size_t max_nodes_count, std::span<const Node> nodes,
+                                        std::span<const uint32_t> levels, std::span<const size_t> subtree_sizes) {
+  assert(!nodes.empty() && nodes.size() <= max_nodes_count && "Expected the root and at most max_nodes_count nodes");
+  assert(levels.size() == nodes.size() && subtree_sizes.size() == nodes.size() &&
+         "Expected a level and a subtree size per node");
+
+  auto tree = FlatTree::create(max_nodes_count);
+  std::ranges::copy(nodes, tree.nodes_.begin());
+  std::ranges::copy(levels, tree.level_.begin());
+  std::ranges::copy(subtree_sizes, tree.subtree_size_.begin());
+
+  // The root already exists, the rest of the indices are handed out in order
+  tree.dfs_preorder_cached_.resize(nodes.size());
+  tree.dfs_preorder_cached_[kRootNodeIndex] = kRootNodeId;
+  tree.nodes_pool_.create_many(std::span(tree.dfs_preorder_cached_).subspan(1));
+  std::iota(tree.dfs_position_cached_.begin(), tree.dfs_position_cached_.begin() + std::ssize(nodes), size_t{0});
+  tree.dfs_dirty_ = false;
+
   return tree;
 }
 
@@ -252,22 +342,38 @@ bool FlatTree::is_descendant(NodeId node_id, NodeId ancestor_id) const {
     return false;
   }
 
-  return std::ranges::any_of(FlatTreeBFSRange(this, ancestor_id, false),
-                             [node_id](auto& descendant_id) { return descendant_id == node_id; });
+  const auto ancestor_index = EntityPool<NodeId>::index_of(ancestor_id);
+  auto index                = EntityPool<NodeId>::index_of(node_id);
+  while (index != kRootNodeIndex) {
+    index = nodes_[index].parent;
+    if (index == ancestor_index) {
+      return true;
+    }
+  }
+  return false;
 }
 
 bool FlatTree::exists(NodeId node_id) const { return node_id != kNullNodeId && nodes_pool_.exists(node_id); }
 
-void FlatTree::set_dirty() {
-  dfs_dirty_ = true;
-  bfs_dirty_ = true;
+void FlatTree::resize_ancestors(size_t index, std::ptrdiff_t delta) {
+  while (index != kNullNodeIndex) {
+    subtree_size_[index] = static_cast<size_t>(static_cast<std::ptrdiff_t>(subtree_size_[index]) + delta);
+    index                = nodes_[index].parent;
+  }
+}
+
+void FlatTree::update_dfs_positions(size_t first, size_t last) const {
+  for (auto i = first; i < last; ++i) {
+    dfs_position_cached_[EntityPool<NodeId>::index_of(dfs_preorder_cached_[i])] = i;
+  }
 }
 
 FlatTreeDFSIterator::FlatTreeDFSIterator(const FlatTree* tree, NodeId start, bool inclusive)
     : tree_(tree), current_(FlatTree::kNullNodeId) {
   if (tree_ && tree_->exists(start)) {
-    stack_.push(start);
-    advance();
+    root_index_    = EntityPool<NodeId>::index_of(start);
+    current_index_ = root_index_;
+    current_       = start;
     if (!inclusive) {
       advance();
     }
@@ -275,33 +381,34 @@ FlatTreeDFSIterator::FlatTreeDFSIterator(const FlatTree* tree, NodeId start, boo
 }
 
 void FlatTreeDFSIterator::advance() {
-  if (stack_.empty()) {
-    current_ = FlatTree::kNullNodeId;
-    return;
-  }
-
-  // acquire the current
-  current_ = stack_.top();
-  stack_.pop();
+  const auto& nodes = tree_->nodes_;
+  auto index        = current_index_;
 
-  if (!tree_->exists(current_)) {
-    current_ = FlatTree::kNullNodeId;
-    return;
+  if (nodes[index].left_child != FlatTree::kNullNodeIndex) {
+    index = nodes[index].left_child;
+  } else {
+    // Climb to the closest ancestor with a right sibling, the root of the range ends the traversal
+    while (index != root_index_ && nodes[index].right_sibling == FlatTree::kNullNodeIndex) {
+      index = nodes[index].parent;
+    }
+    if (index == root_index_) {
+      current_index_ = FlatTree::kNullNodeIndex;
+      current_       = FlatTree::kNullNodeId;
+      return;
+    }
+    index = nodes[index].right_sibling;
   }
 
-  // push children
-  auto child = tree_->nodes_[EntityPool<NodeId>::index_of(current_)].right_child;
-  while (child != FlatTree::kNullNodeIndex) {
-    stack_.push(tree_->nodes_pool_.compose_id(child));
-    child = tree_->nodes_[child].left_sibling;
-  }
+  current_index_ = index;
+  current_       = tree_->nodes_pool_.compose_id(index);
 }
 
 FlatTreeBFSIterator::FlatTreeBFSIterator(const FlatTree* tree, NodeId start, bool inclusive, bool dir_left_to_right)
     : tree_(tree), current_(FlatTree::kNullNodeId), dir_left_to_right_(dir_left_to_right) {
   if (tree_ && tree_->exists(start)) {
-    queue_.push(start);
-    advance();
+    root_index_    = EntityPool<NodeId>::index_of(start);
+    current_index_ = root_index_;
+    current_       = start;
     if (!inclusive) {
       advance();
     }
@@ -309,32 +416,47 @@ FlatTreeBFSIterator::FlatTreeBFSIterator(const FlatTree* tree, NodeId start, boo
 }
 
 void FlatTreeBFSIterator::advance() {
-  if (queue_.empty()) {
-    current_ = FlatTree::kNullNodeId;
-    return;
+  auto index = find_at_depth(current_index_, depth_);
+  if (index == FlatTree::kNullNodeIndex) {
+    // The level is exhausted, the next one starts with its first node after the root
+    ++depth_;
+    index = find_at_depth(root_index_, 0);
   }
 
-  // acquire the current
-  current_ = queue_.front();
-  queue_.pop();
-
-  if (!tree_->exists(current_)) {
-    current_ = FlatTree::kNullNodeId;
+  if (index == FlatTree::kNullNodeIndex) {
+    current_index_ = FlatTree::kNullNodeIndex;
+    current_       = FlatTree::kNullNodeId;
     return;
   }
 
-  // push children
-  if (dir_left_to_right_) {
-    auto child = tree_->nodes_[EntityPool<NodeId>::index_of(current_)].left_child;
-    while (child != FlatTree::kNullNodeIndex) {
-      queue_.push(tree_->nodes_pool_.compose_id(child));
-      child = tree_->nodes_[child].right_sibling;
+  current_index_ = index;
+  current_       = tree_->nodes_pool_.compose_id(index);
+}
+
+size_t FlatTreeBFSIterator::find_at_depth(size_t index, uint32_t depth) const {
+  const auto& nodes       = tree_->nodes_;
+  const auto first_child  = [&](size_t i) { return dir_left_to_right_ ? nodes[i].left_child : nodes[i].right_child; };
+  const auto next_sibling = [&](size_t i) {
+    return dir_left_to_right_ ? nodes[i].right_sibling : nodes[i].left_sibling;
+  };
+
+  while (true) {
+    if (depth < depth_ && first_child(index) != FlatTree::kNullNodeIndex) {
+      index = first_child(index);
+      ++depth;
+    } else {
+      while (index != root_index_ && next_sibling(index) == FlatTree::kNullNodeIndex) {
+        index = nodes[index].parent;
+        --depth;
+      }
+      if (index == root_index_) {
+        return FlatTree::kNullNodeIndex;
+      }
+      index = next_sibling(index);
     }
-  } else {
-    auto child = tree_->nodes_[EntityPool<NodeId>::index_of(current_)].right_child;
-    while (child != FlatTree::kNullNodeIndex) {
-      queue_.push(tree_->nodes_pool_.compose_id(child));
-      child = tree_->nodes_[child].left_sibling;
+
+    if (depth == depth_) {
+      return index;
     }
   }
 }
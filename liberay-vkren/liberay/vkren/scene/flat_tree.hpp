@@ -3,8 +3,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <liberay/vkren/scene/entity_pool.hpp>
-#include <queue>
-#include <stack>
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace eray::vkren {
@@ -45,6 +45,21 @@ class FlatTree {
 
   [[nodiscard]] static FlatTree create(size_t max_nodes_count);
 
+  /**
+   * @brief Creates the tree from the node arrays of `nodes.size()` nodes indexed in the DFS preorder, the root first,
+   * e.g. read from a `SceneSnapshot`. The arrays are copied at once and the preorder is known up front, so no node is
+   * linked one by one. All of the nodes get the version 0.
+   *
+   * @param max_nodes_count At least `nodes.size()`.
+   * @param nodes Links of the nodes, the root has no parent.
+   * @param levels
+   * @param subtree_sizes
+   * @return FlatTree
+   */
+  [[nodiscard]] static FlatTree create_from_preorder(size_t max_nodes_count, std::span<const Node> nodes,
+                                                     std::span<const uint32_t> levels,
+                                                     std::span<const size_t> subtree_sizes);
+
   [[nodiscard]] NodeId create_node(NodeId parent_id);
   [[nodiscard]] NodeId create_node() { return create_node(kRootNodeId); }
 
@@ -54,6 +69,21 @@ class FlatTree {
   std::optional<NodeId> right_sibling_of(NodeId node_id) const;
   [[nodiscard]] uint32_t node_level(NodeId node_id) const;
 
+  /**
+   * @brief Calls `func(child_id)` for every child of the node, from left to right.
+   *
+   * @param node_id
+   * @param func
+   */
+  template <typename TFunc>
+  void for_each_child(NodeId node_id, TFunc&& func) const {
+    auto child = nodes_[index_of(node_id)].left_child;
+    while (child != kNullNodeIndex) {
+      func(nodes_pool_.compose_id(child));
+      child = nodes_[child].right_sibling;
+    }
+  }
+
   /**
    * @brief Recursively copies the node with `node_id` and makes a node with `parent_id` its parent.
    *
@@ -95,8 +125,33 @@ class FlatTree {
   const std::vector<NodeId>& nodes_dfs_preorder() const;
 
   /**
-   * @brief If `node_id` equals `ancestor_id` then it's not an descendant. This function iterates over the subtree so
-   * it's heavy.
+   * @brief Returns the node with all of its descendants in DFS preorder, a contiguous range in `nodes_dfs_preorder()`.
+   *
+   * @param node_id
+   * @return std::span<const NodeId>
+   */
+  std::span<const NodeId> subtree_dfs_preorder(NodeId node_id) const;
+
+  /**
+   * @brief Position of the existing node with the index (`index_of()`) in `nodes_dfs_preorder()`, e.g. a sort key of
+   * the components keyed by the node index.
+   *
+   * @param node_index
+   * @return size_t
+   */
+  [[nodiscard]] size_t dfs_position(size_t node_index) const;
+
+  /**
+   * @brief Number of the nodes in the subtree, including the node itself.
+   *
+   * @param node_id
+   * @return size_t
+   */
+  [[nodiscard]] size_t subtree_size(NodeId node_id) const;
+
+  /**
+   * @brief If `node_id` equals `ancestor_id` then it's not an descendant. This function walks up the ancestors of the
+   * node.
    *
    * @param node_id
    * @param ancestor_id
@@ -107,6 +162,9 @@ class FlatTree {
 
   [[nodiscard]] bool exists(NodeId node_id) const;
 
+  [[nodiscard]] size_t node_count() const { return nodes_pool_.count(); }
+  [[nodiscard]] size_t max_nodes_count() const { return nodes_.size(); }
+
   [[nodiscard]] std::optional<NodeId> compose_id(size_t index) const {
     auto result = nodes_pool_.compose_id(index);
     if (result == kNullNodeId) {
@@ -120,7 +178,18 @@ class FlatTree {
 
  private:
   FlatTree() = default;
-  void set_dirty();
+
+  /**
+   * @brief Adds `delta` to the subtree sizes of the node with `index` and all of its ancestors.
+   *
+   */
+  void resize_ancestors(size_t index, std::ptrdiff_t delta);
+
+  /**
+   * @brief Refreshes `dfs_position_cached_` of the nodes in `dfs_preorder_cached_[first, last)`.
+   *
+   */
+  void update_dfs_positions(size_t first, size_t last) const;
 
   friend FlatTreeDFSIterator;
   friend FlatTreeBFSIterator;
@@ -129,15 +198,32 @@ class FlatTree {
 
   std::vector<Node> nodes_;
   std::vector<uint32_t> level_;
+  std::vector<size_t> subtree_size_;
 
+  /**
+   * @brief Built on the first request and then kept up to date by the structural edits: a subtree is a contiguous range
+   * of `subtree_size_` nodes, so the edits only insert, erase or rotate a range. The BFS order is rebuilt lazily.
+   *
+   */
   mutable std::vector<NodeId> dfs_preorder_cached_;
+
+  /**
+   * @brief Position of the node in `dfs_preorder_cached_`, per node index.
+   *
+   */
+  mutable std::vector<size_t> dfs_position_cached_;
   mutable std::vector<NodeId> bfs_order_cached_;
   mutable bool dfs_dirty_{};
   mutable bool bfs_dirty_{};
 };
 
 /**
- * @brief Allows to iterate over the nodes in the with DFS preorder scheme.
+ * @brief Allows to iterate over the nodes in the with DFS preorder scheme. The iterator is threaded through the child,
+ * sibling and parent links of the nodes, so it holds no container and never allocates.
+ *
+ * @note The links of the current node are read when the iterator is advanced, so the current node may be removed from
+ * the pool in the loop body (see `FlatTree::delete_node()`), but the links of the nodes not visited yet must not
+ * change.
  *
  */
 class FlatTreeDFSIterator {
@@ -169,7 +255,8 @@ class FlatTreeDFSIterator {
  private:
   void advance();
   const FlatTree* tree_{nullptr};
-  std::stack<NodeId> stack_;
+  size_t root_index_{FlatTree::kNullNodeIndex};
+  size_t current_index_{FlatTree::kNullNodeIndex};
   NodeId current_{FlatTree::kNullNodeId};
 };
 
@@ -190,7 +277,10 @@ struct FlatTreeDFSRange {
 };
 
 /**
- * @brief Allows to iterate over the nodes in the with BFS scheme.
+ * @brief Allows to iterate over the nodes in the with BFS scheme. The iterator holds no queue and never allocates: the
+ * nodes of a level are found by a DFS walk pruned at the depth of the level. A walk over a subtree of `n` nodes and
+ * height `h` visits O(n * h) nodes, prefer `FlatTreeDFSRange` when only the parents must precede their children, and
+ * `FlatTree::nodes_bfs_order()` for the whole tree.
  *
  */
 class FlatTreeBFSIterator {
@@ -221,9 +311,24 @@ class FlatTreeBFSIterator {
 
  private:
   void advance();
+
+  /**
+   * @brief Finds the first node at `depth_` that follows the node with `index`, at depth `depth`, in the pruned DFS
+   * preorder.
+   *
+   */
+  size_t find_at_depth(size_t index, uint32_t depth) const;
+
   const FlatTree* tree_{nullptr};
-  std::queue<NodeId> queue_;
+  size_t root_index_{FlatTree::kNullNodeIndex};
+  size_t current_index_{FlatTree::kNullNodeIndex};
   NodeId current_{FlatTree::kNullNodeId};
+
+  /**
+   * @brief Depth of the current node relative to the root of the range.
+   *
+   */
+  uint32_t depth_{0};
   bool dir_left_to_right_{true};
 };
 
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <liberay/math/bounds.hpp>
+#include <liberay/vkren/scene/aabb.hpp>
+
+namespace eray::vkren {
+
+using FrustumTest = math::FrustumTest;
+using Frustum     = math::Frustum;
+
+}  // namespace eray::vkren
@@ -0,0 +1,57 @@
+#include <liberay/vkren/scene/instance_batcher.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+bool can_instance(const RenderDraw& lhs, const RenderDraw& rhs) {
+  return lhs.material.pipeline == rhs.material.pipeline && lhs.material.layout == rhs.material.layout &&
+         lhs.material.material_set == rhs.material.material_set &&
+         lhs.surface.vertex_buffer == rhs.surface.vertex_buffer &&
+         lhs.surface.index_buffer == rhs.surface.index_buffer && lhs.surface.first_index == rhs.surface.first_index &&
+         lhs.surface.index_count == rhs.surface.index_count && lhs.surface.vertex_offset == rhs.surface.vertex_offset;
+}
+
+}  // namespace
+
+InstanceBatcher InstanceBatcher::create() { return InstanceBatcher(nullptr); }
+
+void InstanceBatcher::build(const RenderQueue& queue) {
+  batches_.clear();
+  instance_indices_.clear();
+  instance_indices_.reserve(queue.draws().size());
+
+  const auto order = queue.sorted_draws();
+  const auto draws = queue.draws();
+  for (auto pass = 0U; pass < RenderQueue::kMaxPasses; ++pass) {
+    pass_firsts_[pass] = static_cast<uint32_t>(batches_.size());
+
+    // The batches never span two passes
+    const auto [first, last] = queue.pass_range(pass);
+    for (auto i = first; i < last; ++i) {
+      const auto& draw = draws[order[i]];
+      if (batches_.size() == pass_firsts_[pass] || !can_instance(batches_.back(), draw)) {
+        auto batch           = draw;
+        batch.first_instance = static_cast<uint32_t>(instance_indices_.size());
+        batch.instance_count = 0;
+        batches_.push_back(batch);
+      }
+
+      for (auto n = 0U; n < draw.instance_count; ++n) {
+        instance_indices_.push_back(draw.first_instance + n);
+      }
+      batches_.back().instance_count += draw.instance_count;
+    }
+  }
+  pass_firsts_[RenderQueue::kMaxPasses] = static_cast<uint32_t>(batches_.size());
+}
+
+RenderQueueStats InstanceBatcher::record(vk::CommandBuffer cmd_buff, uint32_t pass, uint32_t material_set_index) const {
+  auto tracker = DrawStateTracker(cmd_buff, material_set_index);
+  for (auto i = pass_firsts_[pass]; i < pass_firsts_[pass + 1]; ++i) {
+    tracker.draw(batches_[i]);
+  }
+  return tracker.stats();
+}
+
+}  // namespace eray::vkren
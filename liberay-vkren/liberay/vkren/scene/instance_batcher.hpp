@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/vkren/scene/render_queue.hpp>
+#include <span>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Collapses the runs of the sorted `RenderQueue` draws that share the mesh surface and the material into single
+ * instanced draws.
+ *
+ * The `first_instance` values of the collapsed draws (e.g. the world matrix indices) are gathered in
+ * `instance_indices()`, one contiguous range per batch, and the batch draws `instance_count` instances starting at
+ * its range. The indices must be uploaded to a storage buffer the vertex shader reads the per instance data through:
+ * `worldMatrices[instanceIndices[gl_InstanceIndex]]`.
+ *
+ * The batches follow the order of the queue, so the `BackToFront` passes stay ordered and get batched only where the
+ * same draws happen to be adjacent.
+ *
+ */
+class InstanceBatcher {
+ public:
+  InstanceBatcher() = delete;
+  explicit InstanceBatcher(std::nullptr_t) {}
+
+  [[nodiscard]] static InstanceBatcher create();
+
+  /**
+   * @brief Rebuilds the batches of all of the passes of the queue.
+   *
+   * @param queue Must be sorted already.
+   */
+  void build(const RenderQueue& queue);
+
+  /**
+   * @brief Records the batches of the pass with a `DrawStateTracker`. Must be recorded inside of the rendering and
+   * the storage buffer with the `instance_indices()` must be bound already.
+   *
+   * @param cmd_buff
+   * @param pass
+   * @param material_set_index Index of the material descriptor set in the pipeline layouts.
+   * @return RenderQueueStats
+   */
+  RenderQueueStats record(vk::CommandBuffer cmd_buff, uint32_t pass, uint32_t material_set_index) const;
+
+  /**
+   * @brief Same as the `record()` but only counts the commands.
+   *
+   */
+  RenderQueueStats stats(uint32_t pass) const { return record(nullptr, pass, 0); }
+
+  /**
+   * @brief Instanced draws of all of the passes, the `first_instance` is an offset into the `instance_indices()`.
+   *
+   */
+  std::span<const RenderDraw> batches() const { return batches_; }
+
+  /**
+   * @brief The `first_instance` values of the queue draws, grouped by batch.
+   *
+   */
+  std::span<const uint32_t> instance_indices() const { return instance_indices_; }
+
+ private:
+  std::vector<RenderDraw> batches_;
+  std::vector<uint32_t> instance_indices_;
+
+  /**
+   * @brief Batches `[pass_firsts_[pass], pass_firsts_[pass + 1])` belong to the pass.
+   *
+   */
+  std::array<uint32_t, RenderQueue::kMaxPasses + 1> pass_firsts_{};
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <liberay/math/mat.hpp>
+#include <liberay/vkren/scene/light_clusters.hpp>
+#include <ranges>
+#include <variant>
+
+namespace eray::vkren {
+
+namespace {
+
+template <class... Ts>
+struct Overloaded : Ts... {
+  using Ts::operator()...;
+};
+
+/**
+ * @brief Smallest distance at which `max_color / (constant + linear * d + quadratic * d^2)` drops below the cutoff.
+ *
+ */
+float attenuation_range(const math::Vec3f& color, float constant, float linear, float quadratic) {
+  const auto max_color = std::max({color.x(), color.y(), color.z()});
+  const auto target    = max_color / GpuLight::kLightCutoff - constant;
+  if (target <= 0.F) {
+    return 0.F;
+  }
+  if (quadratic > 0.F) {
+    return (-linear + std::sqrt(linear * linear + 4.F * quadratic * target)) / (2.F * quadratic);
+  }
+  if (linear > 0.F) {
+    return target / linear;
+  }
+  return std::numeric_limits<float>::max();
+}
+
+/**
+ * @brief Squared distance from the point to the box, as in `cluster_lights.slang`.
+ *
+ */
+float distance_sq(const Aabb& box, const math::Vec3f& point) {
+  auto result = 0.F;
+  for (auto i = 0U; i < 3; ++i) {
+    const auto d = std::max({box.min[i] - point[i], 0.F, point[i] - box.max[i]});
+    result += d * d;
+  }
+  return result;
+}
+
+uint32_t move_directional_lights_to_front(std::vector<GpuLight>& packed) {
+  const auto local = std::ranges::stable_partition(
+      packed, [](const GpuLight& light) { return light.type == GpuLightType::Directional; });
+  return static_cast<uint32_t>(local.begin() - packed.begin());
+}
+
+}  // namespace
+
+GpuLight GpuLight::create(const Light& light) {
+  auto result  = GpuLight{};
+  result.color = light.color;
+  std::visit(Overloaded{
+                 [&result](const DirectionalLight& directional) {
+                   result.type      = GpuLightType::Directional;
+                   result.direction = directional.direction;
+                 },
+                 [&result, &light](const PointLight& point) {
+                   result.type        = GpuLightType::Point;
+                   result.position    = point.position;
+                   result.attenuation = math::Vec3f(point.constant, point.linear, point.quadratic);
+                   result.range = attenuation_range(light.color, point.constant, point.linear, point.quadratic);
+                 },
+                 [&result, &light](const SpotLight& spot) {
+                   result.type             = GpuLightType::Spot;
+                   result.position         = spot.position;
+                   result.direction        = spot.direction;
+                   result.cos_inner_cutoff = std::cos(spot.inner_cutoff);
+                   result.cos_outer_cutoff = std::cos(spot.outer_cutoff);
+                   result.attenuation      = math::Vec3f(spot.constant, spot.linear, spot.quadratic);
+                   result.range = attenuation_range(light.color, spot.constant, spot.linear, spot.quadratic);
+                 },
+             },
+             light.lights);
+  return result;
+}
+
+uint32_t pack_lights(std::span<const Light> lights, std::vector<GpuLight>& packed) {
+  packed.clear();
+  packed.reserve(lights.size());
+  for (const auto& light : lights) {
+    packed.push_back(GpuLight::create(light));
+  }
+  return move_directional_lights_to_front(packed);
+}
+
+uint32_t pack_lights(std::span<const Light> lights, std::span<const size_t> node_indices,
+                     std::span<const math::Mat4f> world_matrices, std::vector<GpuLight>& packed) {
+  assert(lights.size() == node_indices.size());
+
+  packed.clear();
+  packed.reserve(lights.size());
+  for (auto i = 0U; i < lights.size(); ++i) {
+    const auto& world = world_matrices[node_indices[i]];
+    auto light        = GpuLight::create(lights[i]);
+
+    const auto position = world * math::Vec4f(light.position.x(), light.position.y(), light.position.z(), 1.F);
+    light.position      = math::Vec3f(position.x(), position.y(), position.z());
+    if (light.type != GpuLightType::Point) {
+      const auto direction = world * math::Vec4f(light.direction.x(), light.direction.y(), light.direction.z(), 0.F);
+      light.direction      = math::Vec3f(direction.x(), direction.y(), direction.z()).normalized();
+    }
+    packed.push_back(light);
+  }
+  return move_directional_lights_to_front(packed);
+}
+
+LightClusterGrid LightClusterGrid::create(math::Vec3u dims, float fovy, float aspect, float z_near, float z_far) {
+  assert(dims.x() > 0 && dims.y() > 0 && dims.z() > 0 && "Cluster grid must not be empty");
+  assert(0.F < z_near && z_near < z_far && "Invalid depth range");
+
+  auto grid            = LightClusterGrid(nullptr);
+  grid.dims_           = dims;
+  grid.tan_half_fov_y_ = std::tan(fovy / 2.F);
+  grid.tan_half_fov_x_ = grid.tan_half_fov_y_ * aspect;
+  grid.z_near_         = z_near;
+  grid.z_far_          = z_far;
+  return grid;
+}
+
+uint32_t LightClusterGrid::slice_of(float view_depth) const {
+  if (view_depth <= z_near_) {
+    return 0;
+  }
+  const auto slice = std::log(view_depth / z_near_) / std::log(z_far_ / z_near_) * static_cast<float>(dims_.z());
+  return std::min(static_cast<uint32_t>(slice), dims_.z() - 1);
+}
+
+Aabb LightClusterGrid::cluster_bounds(uint32_t x, uint32_t y, uint32_t z) const {
+  const auto depth_ratio = z_far_ / z_near_;
+  const auto near_depth  = z_near_ * std::pow(depth_ratio, static_cast<float>(z) / static_cast<float>(dims_.z()));
+  const auto far_depth   = z_near_ * std::pow(depth_ratio, static_cast<float>(z + 1) / static_cast<float>(dims_.z()));
+
+  // Tile corners in NDC, the Vulkan projection flips y so the NDC y maps to the view -y
+  const auto ndc_x0 = -1.F + 2.F * static_cast<float>(x) / static_cast<float>(dims_.x());
+  const auto ndc_x1 = -1.F + 2.F * static_cast<float>(x + 1) / static_cast<float>(dims_.x());
+  const auto ndc_y0 = -1.F + 2.F * static_cast<float>(y) / static_cast<float>(dims_.y());
+  const auto ndc_y1 = -1.F + 2.F * static_cast<float>(y + 1) / static_cast<float>(dims_.y());
+  const auto view_x = [this](float ndc, float depth) { return ndc * depth * tan_half_fov_x_; };
+  const auto view_y = [this](float ndc, float depth) { return -ndc * depth * tan_half_fov_y_; };
+
+  // The tile edges are lines through the eye, so the extremes lie on the near or on the far face
+  return Aabb{
+      .min = math::Vec3f(std::min(view_x(ndc_x0, near_depth), view_x(ndc_x0, far_depth)),
+                         std::min(view_y(ndc_y1, near_depth), view_y(ndc_y1, far_depth)), -far_depth),
+      .max = math::Vec3f(std::max(view_x(ndc_x1, near_depth), view_x(ndc_x1, far_depth)),
+                         std::max(view_y(ndc_y0, near_depth), view_y(ndc_y0, far_depth)), -near_depth),
+  };
+}
+
+void LightClusterGrid::assign(std::span<const GpuLight> lights, const math::Mat4f& view,
+                              std::vector<GpuLightCluster>& clusters, std::vector<uint32_t>& light_indices) const {
+  clusters.assign(cluster_count(), GpuLightCluster{});
+  light_indices.clear();
+
+  auto view_positions = std::vector<math::Vec3f>();
+  view_positions.reserve(lights.size());
+  for (const auto& light : lights) {
+    const auto position = view * math::Vec4f(light.position.x(), light.position.y(), light.position.z(), 1.F);
+    view_positions.emplace_back(position.x(), position.y(), position.z());
+  }
+
+  for (auto z = 0U; z < dims_.z(); ++z) {
+    for (auto y = 0U; y < dims_.y(); ++y) {
+      for (auto x = 0U; x < dims_.x(); ++x) {
+        const auto bounds = cluster_bounds(x, y, z);
+        auto& cluster     = clusters[cluster_index(x, y, z)];
+        cluster.offset    = static_cast<uint32_t>(light_indices.size());
+        for (auto i = 0U; i < lights.size(); ++i) {
+          if (distance_sq(bounds, view_positions[i]) <= lights[i].range * lights[i].range) {
+            light_indices.push_back(i);
+          }
+        }
+        cluster.count = static_cast<uint32_t>(light_indices.size()) - cluster.offset;
+      }
+    }
+  }
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/mat_fwd.hpp>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/scene/aabb.hpp>
+#include <liberay/vkren/scene/light.hpp>
+#include <span>
+#include <vector>
+
+namespace eray::vkren {
+
+enum class GpuLightType : uint32_t {
+  Directional = 0,
+  Point       = 1,
+  Spot        = 2,
+};
+
+/**
+ * @brief Light packed for the GPU, std430 layout of the `Light` in `cluster_lights.slang`. The `Light` variant is
+ * flattened into a single tagged struct, the fields unused by the type are zero.
+ *
+ */
+struct GpuLight {
+  math::Vec3f position;
+
+  /**
+   * @brief Distance at which the attenuated light drops below `kLightCutoff`, zero for the directional lights.
+   *
+   */
+  float range;
+
+  math::Vec3f direction;
+  GpuLightType type;
+
+  math::Vec3f color;
+  float cos_inner_cutoff;
+
+  /**
+   * @brief Constant, linear and quadratic attenuation factors.
+   *
+   */
+  math::Vec3f attenuation;
+  float cos_outer_cutoff;
+
+  /**
+   * @brief Intensity (relative to the brightest color channel) below which a light is considered not to affect a
+   * point.
+   *
+   */
+  static constexpr float kLightCutoff = 1.F / 256.F;
+
+  [[nodiscard]] static GpuLight create(const Light& light);
+};
+static_assert(sizeof(GpuLight) == 64);
+
+/**
+ * @brief Packs the lights, e.g. the dense values of the `Scene` lights sparse set, the directional lights are moved to
+ * the front since they affect every cluster.
+ *
+ * @param lights
+ * @param packed Cleared first.
+ * @return uint32_t Number of the directional lights.
+ */
+uint32_t pack_lights(std::span<const Light> lights, std::vector<GpuLight>& packed);
+
+/**
+ * @brief Same as the `pack_lights()` but places every light in the world space with the world matrix of its node.
+ *
+ * @param lights E.g. the dense values of the `Scene` lights sparse set.
+ * @param node_indices Node index of each light, e.g. the dense keys of the sparse set.
+ * @param world_matrices `TransformTree::local_to_world_matrices()`.
+ * @param packed Cleared first.
+ * @return uint32_t Number of the directional lights.
+ */
+uint32_t pack_lights(std::span<const Light> lights, std::span<const size_t> node_indices,
+                     std::span<const math::Mat4f> world_matrices, std::vector<GpuLight>& packed);
+
+/**
+ * @brief Range of the light index list of a cluster, std430 layout of the `Cluster` in `cluster_lights.slang`.
+ *
+ */
+struct GpuLightCluster {
+  uint32_t offset;
+  uint32_t count;
+};
+
+/**
+ * @brief Froxel grid over the view frustum of a perspective camera: the screen is split into `dims.x() * dims.y()`
+ * tiles and the view depth into `dims.z()` exponential slices, so the clusters keep a similar shape along the depth.
+ * Cluster `(x, y, z)` has index `x + dims.x() * (y + dims.y() * z)`, the tile `(0, 0)` is the top left one.
+ *
+ * The shading fetches the cluster of a fragment with `tile = frag_coord.xy / viewport_size * dims.xy` and
+ * `slice_of(view_depth)` and iterates its lights only.
+ *
+ */
+class LightClusterGrid {
+ public:
+  LightClusterGrid() = delete;
+  explicit LightClusterGrid(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the grid over the frustum of the projection.
+   *
+   * @param dims Number of the clusters along the screen x, the screen y and the depth.
+   * @param fovy Vertical field of view of the `perspective_vk_rh()` projection, in radians.
+   * @param aspect
+   * @param z_near
+   * @param z_far
+   * @return LightClusterGrid
+   */
+  [[nodiscard]] static LightClusterGrid create(math::Vec3u dims, float fovy, float aspect, float z_near, float z_far);
+
+  /**
+   * @brief Depth slice of the view depth (the distance along the view direction), clamped to the grid.
+   *
+   */
+  uint32_t slice_of(float view_depth) const;
+
+  uint32_t cluster_index(uint32_t x, uint32_t y, uint32_t z) const { return x + dims_.x() * (y + dims_.y() * z); }
+  uint32_t cluster_count() const { return dims_.x() * dims_.y() * dims_.z(); }
+
+  /**
+   * @brief Bounds of the cluster in the view space (looking down -Z).
+   *
+   */
+  Aabb cluster_bounds(uint32_t x, uint32_t y, uint32_t z) const;
+
+  /**
+   * @brief CPU reference of the cull pass of `cluster_lights.slang`: assigns the lights to every cluster their
+   * bounding sphere touches.
+   *
+   * @param lights Point and spot lights, in the world space.
+   * @param view World to view space matrix.
+   * @param clusters Resized to `cluster_count()`.
+   * @param light_indices Cleared first, indices into the `lights` grouped by cluster.
+   */
+  void assign(std::span<const GpuLight> lights, const math::Mat4f& view, std::vector<GpuLightCluster>& clusters,
+              std::vector<uint32_t>& light_indices) const;
+
+  math::Vec3u dims() const { return dims_; }
+
+  /**
+   * @brief `tan(fovy / 2) * aspect` and `tan(fovy / 2)`, the view space extent of the frustum at the depth 1.
+   *
+   */
+  float tan_half_fov_x() const { return tan_half_fov_x_; }
+  float tan_half_fov_y() const { return tan_half_fov_y_; }
+
+  float z_near() const { return z_near_; }
+  float z_far() const { return z_far_; }
+
+ private:
+  math::Vec3u dims_;
+  float tan_half_fov_x_ = 0.F;
+  float tan_half_fov_y_ = 0.F;
+  float z_near_         = 0.F;
+  float z_far_          = 0.F;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <liberay/vkren/scene/flat_tree.hpp>
+#include <liberay/vkren/scene/lod.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+uint32_t lod_of(std::span<const float> min_screen_sizes, float screen_size, float threshold_scale) {
+  const auto last = static_cast<uint32_t>(min_screen_sizes.size()) - 1;
+  for (auto i = 0U; i < last; ++i) {
+    if (screen_size >= min_screen_sizes[i] * threshold_scale) {
+      return i;
+    }
+  }
+  return last;
+}
+
+}  // namespace
+
+std::optional<LodView> LodView::create(const Camera& camera, const math::Vec3f& eye) {
+  const auto* perspective = std::get_if<PerspectiveCamera>(&camera.projection);
+  if (!perspective) {
+    return std::nullopt;
+  }
+
+  auto tan_half_fov = std::tan(perspective->fov / 2.F);
+  if (perspective->horizontal) {
+    tan_half_fov /= camera.aspect_ratio;
+  }
+  return LodView{.eye = eye, .projection_scale = 1.F / tan_half_fov};
+}
+
+float projected_screen_size(const Aabb& world_bounds, const LodView& view) {
+  const auto radius   = world_bounds.extent().length();
+  const auto distance = (world_bounds.center() - view.eye).length();
+  if (distance <= radius) {
+    return std::numeric_limits<float>::max();
+  }
+  return radius * view.projection_scale / distance;
+}
+
+uint32_t select_lod(std::span<const float> min_screen_sizes, float screen_size, uint32_t current_lod,
+                    float hysteresis) {
+  assert(!min_screen_sizes.empty() && "LOD chain must not be empty");
+
+  current_lod = std::min(current_lod, static_cast<uint32_t>(min_screen_sizes.size()) - 1);
+
+  // Lowered thresholds for a switch to a coarser LOD, raised ones for a switch to a finer LOD
+  if (const auto coarser = lod_of(min_screen_sizes, screen_size, 1.F - hysteresis); coarser > current_lod) {
+    return coarser;
+  }
+  if (const auto finer = lod_of(min_screen_sizes, screen_size, 1.F + hysteresis); finer < current_lod) {
+    return finer;
+  }
+  return current_lod;
+}
+
+LodSelector LodSelector::create(size_t max_nodes_count) {
+  auto selector = LodSelector(nullptr);
+  selector.current_lods_.resize(max_nodes_count, 0);
+  return selector;
+}
+
+uint32_t LodSelector::select(NodeId node_id, const MeshLodChain& chain, float screen_size, float hysteresis) {
+  auto& current = current_lods_[FlatTree::index_of(node_id)];
+  current       = static_cast<uint8_t>(select_lod(chain.thresholds(), screen_size, current, hysteresis));
+  return current;
+}
+
+uint32_t LodSelector::current_lod(NodeId node_id) const { return current_lods_[FlatTree::index_of(node_id)]; }
+
+}  // namespace eray::vkren
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/scene/aabb.hpp>
+#include <liberay/vkren/scene/camera.hpp>
+#include <liberay/vkren/scene/entity_pool.hpp>
+#include <liberay/vkren/scene/mesh.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace eray::vkren {
+
+/**
+ * @brief Levels of detail of a mesh, e.g. index ranges of the geometry arena, from the most detailed one. The LOD `i`
+ * is drawn while the projected screen size of the node is at least `min_screen_sizes[i]`, the last LOD is drawn
+ * below all of the thresholds.
+ *
+ */
+struct MeshLodChain {
+  static constexpr uint32_t kMaxLods = 4;
+
+  std::array<GPUMeshSurface, kMaxLods> surfaces{};
+
+  /**
+   * @brief Decreasing, in the units of `projected_screen_size()`.
+   *
+   */
+  std::array<float, kMaxLods> min_screen_sizes{};
+  uint32_t lod_count = 0;
+
+  std::span<const float> thresholds() const { return std::span(min_screen_sizes).first(lod_count); }
+};
+
+/**
+ * @brief Camera parameters the LOD selection needs.
+ *
+ */
+struct LodView {
+  /**
+   * @brief Default relative width of the band around each threshold in which the LOD does not change.
+   *
+   */
+  static constexpr float kDefaultHysteresis = 0.1F;
+
+  math::Vec3f eye;
+
+  /**
+   * @brief `1 / tan(fovy / 2)`, i.e. the `[1][1]` entry of the perspective projection.
+   *
+   */
+  float projection_scale;
+
+  float hysteresis = kDefaultHysteresis;
+
+  /**
+   * @brief Fails for the cameras without a `PerspectiveCamera` projection.
+   *
+   * @param camera
+   * @param eye World space position of the camera.
+   * @return std::optional<LodView>
+   */
+  [[nodiscard]] static std::optional<LodView> create(const Camera& camera, const math::Vec3f& eye);
+};
+
+/**
+ * @brief Height of the bounding sphere of the box projected on the screen, as a fraction of the viewport height.
+ * Matches `indirect_cull.slang`.
+ *
+ * @param world_bounds Must not be empty.
+ * @param view
+ * @return float Unbounded when the eye is inside of the sphere.
+ */
+float projected_screen_size(const Aabb& world_bounds, const LodView& view);
+
+/**
+ * @brief Selects the LOD of the screen size. Switches from the `current_lod` only if the screen size crosses a
+ * threshold by more than the hysteresis, so a node that stays near a threshold does not pop between two LODs. Matches
+ * `indirect_cull.slang`.
+ *
+ * @param min_screen_sizes Thresholds of the chain, must not be empty.
+ * @param screen_size
+ * @param current_lod
+ * @param hysteresis
+ * @return uint32_t
+ */
+uint32_t select_lod(std::span<const float> min_screen_sizes, float screen_size, uint32_t current_lod, float hysteresis);
+
+/**
+ * @brief Keeps the LOD each node was drawn with, the state of the hysteresis of the CPU path. Fed with the screen sizes
+ * computed by `SceneBounds::cull()` along the culling.
+ *
+ */
+class LodSelector {
+ public:
+  LodSelector() = delete;
+  explicit LodSelector(std::nullptr_t) {}
+
+  /**
+   * @brief Creates the selector with every node at the LOD 0.
+   *
+   * @param max_nodes_count Must match the `TransformTree::create()` argument.
+   * @return LodSelector
+   */
+  [[nodiscard]] static LodSelector create(size_t max_nodes_count);
+
+  /**
+   * @brief Selects and remembers the LOD of the node.
+   *
+   * @param node_id
+   * @param chain
+   * @param screen_size
+   * @param hysteresis
+   * @return uint32_t
+   */
+  uint32_t select(NodeId node_id, const MeshLodChain& chain, float screen_size,
+                  float hysteresis = LodView::kDefaultHysteresis);
+
+  uint32_t current_lod(NodeId node_id) const;
+
+ private:
+  std::vector<uint8_t> current_lods_;
+};
+
+}  // namespace eray::vkren
@@ -2,28 +2,37 @@
 
 #include <liberay/math/mat.hpp>
 #include <liberay/math/vec_fwd.hpp>
+#include <liberay/util/flat_hash_map.hpp>
+#include <liberay/util/string_hash.hpp>
 #include <liberay/util/zstring_view.hpp>
 #include <liberay/vkren/scene/entity_pool.hpp>
-#include <unordered_map>
+#include <liberay/vkren/scene/material_schema.hpp>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_handles.hpp>
 
 namespace eray::vkren {
 
+/**
+ * @brief Looked up with the `const char*` and `std::string_view` names without constructing a string.
+ *
+ */
+template <typename TValue>
+using UniformMap = util::FlatHashMap<std::string, TValue, util::StringHash, std::equal_to<>>;
+
 struct Uniforms {
-  std::unordered_map<std::string, TextureId> textures;
+  UniformMap<TextureId> textures;
 
-  std::unordered_map<std::string, float> float_values;
-  std::unordered_map<std::string, math::Vec2f> float2_values;
-  std::unordered_map<std::string, math::Vec3f> float3_values;
-  std::unordered_map<std::string, math::Vec4f> float4_values;
+  UniformMap<float> float_values;
+  UniformMap<math::Vec2f> float2_values;
+  UniformMap<math::Vec3f> float3_values;
+  UniformMap<math::Vec4f> float4_values;
 
-  std::unordered_map<std::string, int> int_values;
-  std::unordered_map<std::string, math::Vec2i> int2_values;
-  std::unordered_map<std::string, math::Vec3i> int3_values;
-  std::unordered_map<std::string, math::Vec4i> int4_values;
+  UniformMap<int> int_values;
+  UniformMap<math::Vec2i> int2_values;
+  UniformMap<math::Vec3i> int3_values;
+  UniformMap<math::Vec4i> int4_values;
 
-  std::unordered_map<std::string, math::Mat4f> mat_values;
+  UniformMap<math::Mat4f> mat_values;
 
   template <typename TType>
   TType get(util::zstring_view name) const {
@@ -51,11 +60,65 @@ struct Uniforms {
       static_assert([] { return false; }(), "Unsupported Uniform type for get()");
     }
   }
+
+  /**
+   * @brief Writes the values into the block of the material, every parameter of the schema must have a value. Meant
+   * for the conversion of loaded materials, the per frame edits should go through the resolved handles.
+   *
+   * @param table
+   * @param slot
+   */
+  void write_to(MaterialParameterTable& table, uint32_t slot) const {
+    const auto& schema = table.schema();
+    for (auto i = 0U; i < schema.param_count(); ++i) {
+      const auto handle = MaterialParamHandle{._value = i};
+      const auto& name  = schema.name(handle);
+      switch (schema.type(handle)) {
+        case MaterialParamType::Float:
+          table.set(slot, handle, float_values.at(name));
+          break;
+        case MaterialParamType::Float2:
+          table.set(slot, handle, float2_values.at(name));
+          break;
+        case MaterialParamType::Float3:
+          table.set(slot, handle, float3_values.at(name));
+          break;
+        case MaterialParamType::Float4:
+          table.set(slot, handle, float4_values.at(name));
+          break;
+        case MaterialParamType::Int:
+          table.set(slot, handle, int_values.at(name));
+          break;
+        case MaterialParamType::Int2:
+          table.set(slot, handle, int2_values.at(name));
+          break;
+        case MaterialParamType::Int3:
+          table.set(slot, handle, int3_values.at(name));
+          break;
+        case MaterialParamType::Int4:
+          table.set(slot, handle, int4_values.at(name));
+          break;
+        case MaterialParamType::Mat4:
+          table.set(slot, handle, mat_values.at(name));
+          break;
+        case MaterialParamType::Texture:
+          table.set(slot, handle, textures.at(name));
+          break;
+      }
+    }
+  }
 };
 
 struct Material {
   enum class Info : uint8_t { PBR, Custom } info{};
   Uniforms uniform_data;
+
+  /**
+   * @brief Block of the material in the `MaterialParameterTable` of its schema, also its index in the material storage
+   * buffer.
+   *
+   */
+  uint32_t parameter_slot{};
 };
 
 struct GPUMaterial {
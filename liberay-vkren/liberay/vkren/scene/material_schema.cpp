@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cassert>
+#include <liberay/vkren/scene/material_schema.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+constexpr uint32_t align_up(uint32_t value, uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+MaterialSchema MaterialSchema::create(std::span<const MaterialParamInfo> params) {
+  auto schema = MaterialSchema(nullptr);
+  schema.params_.reserve(params.size());
+  schema.param_indices_.reserve(params.size());
+
+  auto offset        = 0U;
+  auto max_alignment = 4U;
+  for (const auto& param : params) {
+    const auto layout = std430_layout_of(param.type);
+    offset            = align_up(offset, layout.alignment);
+    max_alignment     = std::max(max_alignment, layout.alignment);
+
+    [[maybe_unused]] auto inserted =
+        schema.param_indices_.emplace(param.name, static_cast<uint32_t>(schema.params_.size())).second;
+    assert(inserted && "Material parameter names must be unique");
+    schema.params_.push_back(Param{.name = param.name, .type = param.type, .offset = offset});
+
+    // A vec3 leaves its last 4 bytes to the next scalar, as std430 allows
+    offset += layout.size;
+  }
+
+  schema.size_bytes_ = offset;
+  schema.stride_     = align_up(std::max(offset, 1U), max_alignment);
+  return schema;
+}
+
+std::optional<MaterialParamHandle> MaterialSchema::find(const std::string& name) const {
+  if (auto it = param_indices_.find(name); it != param_indices_.end()) {
+    return MaterialParamHandle{._value = it->second};
+  }
+  return std::nullopt;
+}
+
+MaterialParameterTable MaterialParameterTable::create(const MaterialSchema& schema) {
+  auto table    = MaterialParameterTable(nullptr);
+  table.schema_ = &schema;
+  return table;
+}
+
+uint32_t MaterialParameterTable::add_material() {
+  const auto slot = material_count_++;
+  bytes_.resize(static_cast<size_t>(material_count_) * schema_->stride(), std::byte{0});
+
+  // The new block has to reach the GPU even if none of its parameters is set
+  const auto first = static_cast<size_t>(slot) * schema_->stride();
+  dirty_first_     = std::min(dirty_first_, first);
+  dirty_last_      = std::max(dirty_last_, bytes_.size());
+  return slot;
+}
+
+}  // namespace eray::vkren
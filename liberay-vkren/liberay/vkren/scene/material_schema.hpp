@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <liberay/math/mat.hpp>
+#include <liberay/math/vec.hpp>
+#include <liberay/util/flat_hash_map.hpp>
+#include <liberay/util/string_hash.hpp>
+#include <liberay/vkren/scene/entity_pool.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace eray::vkren {
+
+enum class MaterialParamType : uint8_t {
+  Float,
+  Float2,
+  Float3,
+  Float4,
+  Int,
+  Int2,
+  Int3,
+  Int4,
+  Mat4,
+
+  /**
+   * @brief `TextureId` stored as its index (`uint`), e.g. an index into the bindless heap.
+   *
+   */
+  Texture,
+};
+
+/**
+ * @brief Size and base alignment of the parameter type in the std430 layout.
+ *
+ */
+struct MaterialParamLayout {
+  uint32_t size;
+  uint32_t alignment;
+};
+
+[[nodiscard]] constexpr MaterialParamLayout std430_layout_of(MaterialParamType type) {
+  switch (type) {
+    case MaterialParamType::Float:
+    case MaterialParamType::Int:
+    case MaterialParamType::Texture:
+      return MaterialParamLayout{.size = 4, .alignment = 4};
+    case MaterialParamType::Float2:
+    case MaterialParamType::Int2:
+      return MaterialParamLayout{.size = 8, .alignment = 8};
+    case MaterialParamType::Float3:
+    case MaterialParamType::Int3:
+      return MaterialParamLayout{.size = 12, .alignment = 16};
+    case MaterialParamType::Float4:
+    case MaterialParamType::Int4:
+      return MaterialParamLayout{.size = 16, .alignment = 16};
+    case MaterialParamType::Mat4:
+      return MaterialParamLayout{.size = 64, .alignment = 16};
+  }
+  return MaterialParamLayout{.size = 0, .alignment = 1};
+}
+
+/**
+ * @brief Maps the C++ type of a parameter to its `MaterialParamType`.
+ *
+ */
+template <typename T>
+constexpr MaterialParamType kMaterialParamTypeOf = [] {
+  if constexpr (std::is_same_v<T, float>) {
+    return MaterialParamType::Float;
+  } else if constexpr (std::is_same_v<T, math::Vec2f>) {
+    return MaterialParamType::Float2;
+  } else if constexpr (std::is_same_v<T, math::Vec3f>) {
+    return MaterialParamType::Float3;
+  } else if constexpr (std::is_same_v<T, math::Vec4f>) {
+    return MaterialParamType::Float4;
+  } else if constexpr (std::is_same_v<T, int>) {
+    return MaterialParamType::Int;
+  } else if constexpr (std::is_same_v<T, math::Vec2i>) {
+    return MaterialParamType::Int2;
+  } else if constexpr (std::is_same_v<T, math::Vec3i>) {
+    return MaterialParamType::Int3;
+  } else if constexpr (std::is_same_v<T, math::Vec4i>) {
+    return MaterialParamType::Int4;
+  } else if constexpr (std::is_same_v<T, math::Mat4f>) {
+    return MaterialParamType::Mat4;
+  } else if constexpr (std::is_same_v<T, TextureId>) {
+    return MaterialParamType::Texture;
+  } else {
+    static_assert([] { return false; }(), "Unsupported material parameter type");
+  }
+}();
+
+struct MaterialParamInfo {
+  std::string name;
+  MaterialParamType type;
+};
+
+/**
+ * @brief Index of a parameter in its `MaterialSchema`, resolved from the name once.
+ *
+ */
+struct MaterialParamHandle {
+  uint32_t _value;
+
+  bool operator==(const MaterialParamHandle&) const = default;
+};
+
+/**
+ * @brief Layout of the parameters of a material type: every parameter gets a fixed offset in a std430 packed block, in
+ * the declaration order, so the block matches a shader struct declaring the same members in the same order. The names
+ * are resolved to handles once, setting a parameter is then a `memcpy` at a known offset.
+ *
+ */
+class MaterialSchema {
+ public:
+  MaterialSchema() = delete;
+  explicit MaterialSchema(std::nullptr_t) {}
+
+  /**
+   * @brief Computes the offsets of the parameters.
+   *
+   * @param params Names must be unique.
+   * @return MaterialSchema
+   */
+  [[nodiscard]] static MaterialSchema create(std::span<const MaterialParamInfo> params);
+
+  std::optional<MaterialParamHandle> find(const std::string& name) const;
+
+  /**
+   * @brief Like `find()`, the parameter must exist and have the type `T`.
+   *
+   */
+  template <typename T>
+  MaterialParamHandle handle(const std::string& name) const {
+    auto result = find(name);
+    assert(result && "Material parameter does not exist");
+    assert(params_[result->_value].type == kMaterialParamTypeOf<T> && "Material parameter type mismatch");
+    return *result;
+  }
+
+  MaterialParamType type(MaterialParamHandle handle) const { return params_[handle._value].type; }
+  uint32_t offset(MaterialParamHandle handle) const { return params_[handle._value].offset; }
+  const std::string& name(MaterialParamHandle handle) const { return params_[handle._value].name; }
+  uint32_t param_count() const { return static_cast<uint32_t>(params_.size()); }
+
+  /**
+   * @brief Size of the packed parameters in bytes.
+   *
+   */
+  uint32_t size_bytes() const { return size_bytes_; }
+
+  /**
+   * @brief Distance between the blocks of two consecutive materials in an array, the size rounded up to the largest
+   * alignment of the parameters.
+   *
+   */
+  uint32_t stride() const { return stride_; }
+
+ private:
+  struct Param {
+    std::string name;
+    MaterialParamType type;
+    uint32_t offset;
+  };
+
+  std::vector<Param> params_;
+  util::FlatHashMap<std::string, uint32_t, util::StringHash, std::equal_to<>> param_indices_;
+  uint32_t size_bytes_ = 0;
+  uint32_t stride_     = 0;
+};
+
+/**
+ * @brief Parameters of all of the materials of a single `MaterialSchema`, one block per material packed one after
+ * another with the schema stride. The bytes can be copied as they are into a material storage buffer indexed by the
+ * material slot. The changed bytes are tracked as a single range, so only the edited part has to be uploaded.
+ *
+ */
+class MaterialParameterTable {
+ public:
+  MaterialParameterTable() = delete;
+  explicit MaterialParameterTable(std::nullptr_t) {}
+
+  [[nodiscard]] static MaterialParameterTable create(const MaterialSchema& schema);
+
+  /**
+   * @brief Appends a zero initialized block.
+   *
+   * @return uint32_t Slot of the material.
+   */
+  uint32_t add_material();
+
+  template <typename T>
+  void set(uint32_t slot, MaterialParamHandle handle, const T& value) {
+    assert(schema_->type(handle) == kMaterialParamTypeOf<T> && "Material parameter type mismatch");
+
+    const auto offset = static_cast<size_t>(slot) * schema_->stride() + schema_->offset(handle);
+    if constexpr (std::is_same_v<T, TextureId>) {
+      const auto index = static_cast<uint32_t>(EntityIdExtractor<TextureTag>::index_of(value));
+      write(offset, &index, sizeof(index));
+    } else {
+      write(offset, &value, std430_layout_of(kMaterialParamTypeOf<T>).size);
+    }
+  }
+
+  template <typename T>
+  T get(uint32_t slot, MaterialParamHandle handle) const {
+    assert(schema_->type(handle) == kMaterialParamTypeOf<T> && "Material parameter type mismatch");
+    static_assert(!std::is_same_v<T, TextureId>, "Texture parameters store the texture index only");
+
+    const auto offset = static_cast<size_t>(slot) * schema_->stride() + schema_->offset(handle);
+    auto value        = T{};
+    std::memcpy(&value, bytes_.data() + offset, std430_layout_of(kMaterialParamTypeOf<T>).size);
+    return value;
+  }
+
+  /**
+   * @brief Block of the material.
+   *
+   */
+  std::span<const std::byte> block(uint32_t slot) const {
+    return std::span(bytes_).subspan(static_cast<size_t>(slot) * schema_->stride(), schema_->stride());
+  }
+
+  std::span<const std::byte> bytes() const { return bytes_; }
+  uint32_t material_count() const { return material_count_; }
+  const MaterialSchema& schema() const { return *schema_; }
+
+  /**
+   * @brief Bytes `[first, last)` changed since the last `clear_dirty()`, empty if nothing has changed.
+   *
+   */
+  std::optional<std::pair<size_t, size_t>> dirty_range() const {
+    if (dirty_first_ >= dirty_last_) {
+      return std::nullopt;
+    }
+    return std::pair{dirty_first_, dirty_last_};
+  }
+  void clear_dirty() {
+    dirty_first_ = bytes_.size();
+    dirty_last_  = 0;
+  }
+
+ private:
+  void write(size_t offset, const void* src, size_t size) {
+    std::memcpy(bytes_.data() + offset, src, size);
+    dirty_first_ = std::min(dirty_first_, offset);
+    dirty_last_  = std::max(dirty_last_, offset + size);
+  }
+
+  const MaterialSchema* schema_ = nullptr;
+  std::vector<std::byte> bytes_;
+  uint32_t material_count_ = 0;
+  size_t dirty_first_      = 0;
+  size_t dirty_last_       = 0;
+};
+
+}  // namespace eray::vkren
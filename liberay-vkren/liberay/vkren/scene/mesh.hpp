@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_handles.hpp>
 
@@ -10,6 +11,25 @@ struct GPUMeshSurface {
   vk::Buffer index_buffer;
   uint32_t first_index;
   uint32_t index_count;
+  int32_t vertex_offset = 0;
+};
+
+/**
+ * @brief Draw of a node, the mesh and the material are indices into the tables of the application passed to the
+ * `RenderExtractor`. A mesh with several surfaces is split into child nodes.
+ *
+ */
+struct MeshRenderer {
+  static constexpr uint32_t kNone = ~0U;
+
+  uint32_t mesh     = kNone;
+  uint32_t material = 0;
+
+  /**
+   * @brief Render queue pass, less than `RenderQueue::kMaxPasses`.
+   *
+   */
+  uint32_t pass = 0;
 };
 
 }  // namespace eray::vkren
@@ -0,0 +1,19 @@
+#include <algorithm>
+#include <cmath>
+#include <liberay/vkren/scene/particle_emission.hpp>
+
+namespace eray::vkren {
+
+uint32_t ParticleEmissionClock::advance(float particles_per_second, float delta_time, uint32_t max_spawn_count) {
+  const auto total = carry_ + std::max(particles_per_second * delta_time, 0.F);
+  const auto whole = std::floor(total);
+  if (whole >= static_cast<float>(max_spawn_count)) {
+    carry_ = 0.F;
+    return max_spawn_count;
+  }
+
+  carry_ = total - whole;
+  return static_cast<uint32_t>(whole);
+}
+
+}  // namespace eray::vkren
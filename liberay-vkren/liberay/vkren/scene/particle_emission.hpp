@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace eray::vkren {
+
+/**
+ * @brief Converts the emission rate of a particle emitter to the whole particles spawned by each frame, see
+ * `GpuParticleEmitter::spawn_count`. The fraction of a particle is carried to the next frames, so that the rates below
+ * a particle per frame still emit and the emitted count does not drift from the rate.
+ *
+ */
+class ParticleEmissionClock {
+ public:
+  /**
+   * @brief Advances the clock by the frame time.
+   *
+   * @param particles_per_second
+   * @param delta_time Seconds.
+   * @param max_spawn_count The particles above it are dropped rather than spawned by the next frames, so a long frame
+   * does not cause a burst.
+   * @return uint32_t Particles to spawn by the frame.
+   */
+  uint32_t advance(float particles_per_second, float delta_time,
+                   uint32_t max_spawn_count = std::numeric_limits<uint32_t>::max());
+
+  /**
+   * @brief Drops the carried fraction, e.g. when the emitter is restarted.
+   *
+   */
+  void reset() { carry_ = 0.F; }
+
+  float carry() const { return carry_; }
+
+ private:
+  float carry_ = 0.F;
+};
+
+}  // namespace eray::vkren
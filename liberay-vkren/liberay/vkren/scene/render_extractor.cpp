@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cassert>
+#include <liberay/util/job_system.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/scene/render_extractor.hpp>
+
+namespace eray::vkren {
+
+RenderExtractor RenderExtractor::create() { return RenderExtractor(nullptr); }
+
+void RenderExtractor::extract(util::JobSystem& jobs, const RenderSnapshot& snapshot,
+                              std::span<const GPUMeshSurface> meshes, std::span<const GPUMaterial> materials,
+                              RenderQueue& queue, size_t chunk_size) {
+  ERAY_PROFILE_FUNCTION();
+  assert(chunk_size > 0 && "Render extraction chunks must not be empty");
+  assert(snapshot.renderers.size() == snapshot.visible_nodes.size() && "Snapshot renderers are not extracted");
+
+  // The tables are small compared to the visible nodes, the pipeline ids are resolved once per material
+  material_pipelines_.clear();
+  for (const auto& material : materials) {
+    const auto [it, _] = pipeline_ids_.try_emplace(static_cast<VkPipeline>(material.pipeline),
+                                                   static_cast<uint32_t>(pipeline_ids_.size()));
+    material_pipelines_.push_back(std::min(it->second, (1U << DrawSortKey::kPipelineBits) - 1));
+  }
+
+  threads_.resize(jobs.worker_count() + 1);
+  for (auto& thread : threads_) {
+    thread.packets.clear();
+  }
+
+  const auto node_count  = snapshot.visible_nodes.size();
+  const auto chunk_count = (node_count + chunk_size - 1) / chunk_size;
+  chunks_.resize(chunk_count);
+
+  jobs.parallel_for(
+      0, chunk_count,
+      [&](size_t chunk) {
+        const auto thread = jobs.thread_index();
+        auto& packets     = threads_[thread].packets;
+        const auto begin  = static_cast<uint32_t>(packets.size());
+
+        const auto last = std::min(node_count, (chunk + 1) * chunk_size);
+        for (auto i = chunk * chunk_size; i < last; ++i) {
+          const auto& renderer = snapshot.renderers[i];
+          if (renderer.mesh == MeshRenderer::kNone) {
+            continue;
+          }
+          assert(renderer.mesh < meshes.size() && "Renderer mesh out of the mesh table");
+          assert(renderer.material < materials.size() && "Renderer material out of the material table");
+          assert(renderer.pass < RenderQueue::kMaxPasses && "Renderer pass out of range");
+
+          const auto position = snapshot.view * snapshot.world_matrices[i][3];
+          const auto key      = DrawSortKey::pack(
+              queue.pass_order(renderer.pass), renderer.pass, material_pipelines_[renderer.material],
+              std::min(renderer.material, (1U << DrawSortKey::kMaterialBits) - 1),
+              std::min(renderer.mesh, (1U << DrawSortKey::kMeshBits) - 1), queue.quantize_depth(-position.z()));
+          packets.push_back(DrawPacket{
+              .sort_key = key,
+              .mesh     = renderer.mesh,
+              .material = renderer.material,
+              .instance = static_cast<uint32_t>(i),
+          });
+        }
+
+        chunks_[chunk] = ChunkRange{.thread = thread, .begin = begin, .end = static_cast<uint32_t>(packets.size())};
+      },
+      1);
+
+  ERAY_PROFILE_SCOPE("Merge draw packets");
+  packet_count_ = 0;
+  for (const auto& thread : threads_) {
+    packet_count_ += thread.packets.size();
+  }
+  queue.reserve(queue.draws().size() + packet_count_);
+  for (const auto& chunk : chunks_) {
+    const auto& packets = threads_[chunk.thread].packets;
+    for (auto p = chunk.begin; p < chunk.end; ++p) {
+      const auto& packet = packets[p];
+      queue.push_keyed(packet.sort_key, RenderDraw{
+                                            .material       = materials[packet.material],
+                                            .surface        = meshes[packet.mesh],
+                                            .first_instance = packet.instance,
+                                        });
+    }
+  }
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/vkren/scene/material.hpp>
+#include <liberay/vkren/scene/mesh.hpp>
+#include <liberay/vkren/scene/render_queue.hpp>
+#include <liberay/vkren/scene/render_snapshot.hpp>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace eray::util {
+class JobSystem;
+}
+
+namespace eray::vkren {
+
+/**
+ * @brief Draw of a visible node emitted by the extraction jobs, resolved to a `RenderDraw` when merged.
+ *
+ */
+struct DrawPacket {
+  uint64_t sort_key;
+  uint32_t mesh;
+  uint32_t material;
+
+  /**
+   * @brief Index of the node in the `RenderSnapshot::visible_nodes`, i.e. of its world matrix.
+   *
+   */
+  uint32_t instance;
+};
+
+/**
+ * @brief Turns the visible renderers of a `RenderSnapshot` into the draws of a `RenderQueue` on all of the workers.
+ *
+ * The visible nodes are split into chunks, every chunk is a job that packs the sort keys of its renderers and appends
+ * the packets to the linear buffer of the thread that runs it, so the jobs share nothing but the read-only snapshot.
+ * The buffers are merged in the order of the chunks, the queue gets the same draws in the same order regardless of
+ * the threads the chunks ran on. The buffers keep their capacity between the frames.
+ *
+ * The keys use the indices of the mesh and the material tables as the ids, the pipelines are mapped to ids in the first
+ * seen order like in the `RenderQueue::push()`.
+ *
+ */
+class RenderExtractor {
+ public:
+  RenderExtractor() = delete;
+  explicit RenderExtractor(std::nullptr_t) {}
+
+  static constexpr size_t kDefaultChunkSize = 512;
+
+  [[nodiscard]] static RenderExtractor create();
+
+  /**
+   * @brief Appends the draws of the visible renderers to the queue, with the pass orders and the depth range of the
+   * queue. The queue is not sorted.
+   *
+   * @param jobs
+   * @param snapshot
+   * @param meshes Surfaces indexed by the `MeshRenderer::mesh`.
+   * @param materials Materials indexed by the `MeshRenderer::material`.
+   * @param queue
+   * @param chunk_size Number of the visible nodes per job.
+   */
+  void extract(util::JobSystem& jobs, const RenderSnapshot& snapshot, std::span<const GPUMeshSurface> meshes,
+               std::span<const GPUMaterial> materials, RenderQueue& queue, size_t chunk_size = kDefaultChunkSize);
+
+  /**
+   * @brief Packets emitted by the last `extract()`.
+   *
+   */
+  size_t packet_count() const { return packet_count_; }
+
+ private:
+  /**
+   * @brief Packets of a chunk in the buffer of the thread that extracted it.
+   *
+   */
+  struct ChunkRange {
+    uint32_t thread;
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  /**
+   * @brief Written only by its thread, aligned so that the vectors of the threads do not share a cache line.
+   *
+   */
+  struct alignas(64) ThreadPackets {
+    std::vector<DrawPacket> packets;
+  };
+
+  std::vector<ThreadPackets> threads_;
+  std::vector<ChunkRange> chunks_;
+  size_t packet_count_ = 0;
+
+  std::vector<uint32_t> material_pipelines_;
+  std::unordered_map<VkPipeline, uint32_t> pipeline_ids_;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cassert>
+#include <liberay/vkren/scene/render_queue.hpp>
+#include <utility>
+
+namespace eray::vkren {
+
+namespace {
+
+template <typename TMap, typename TKey>
+uint32_t intern(TMap& ids, const TKey& key, uint32_t bits) {
+  const auto [it, _] = ids.try_emplace(key, static_cast<uint32_t>(ids.size()));
+  return std::min(it->second, (1U << bits) - 1);
+}
+
+}  // namespace
+
+RenderQueue RenderQueue::create() { return RenderQueue(nullptr); }
+
+void RenderQueue::set_depth_range(float near_depth, float far_depth) {
+  assert(near_depth < far_depth && "Depth range must not be empty");
+  near_depth_ = near_depth;
+  far_depth_  = far_depth;
+}
+
+uint32_t RenderQueue::quantize_depth(float view_depth) const {
+  constexpr auto kMaxDepth = static_cast<float>((1U << DrawSortKey::kDepthBits) - 1);
+  const auto t             = std::clamp((view_depth - near_depth_) / (far_depth_ - near_depth_), 0.F, 1.F);
+  return static_cast<uint32_t>(t * kMaxDepth);
+}
+
+void RenderQueue::push(uint32_t pass, const RenderDraw& draw, float view_depth) {
+  assert(pass < kMaxPasses && "Render queue pass out of range");
+
+  const auto depth = quantize_depth(view_depth);
+
+  const auto pipeline =
+      intern(pipeline_ids_, static_cast<VkPipeline>(draw.material.pipeline), DrawSortKey::kPipelineBits);
+  const auto material =
+      intern(material_ids_, static_cast<VkDescriptorSet>(draw.material.material_set), DrawSortKey::kMaterialBits);
+  const auto mesh = intern(surface_ids_,
+                           SurfaceKey{
+                               .vertex_buffer = static_cast<VkBuffer>(draw.surface.vertex_buffer),
+                               .index_buffer  = static_cast<VkBuffer>(draw.surface.index_buffer),
+                               .first_index   = draw.surface.first_index,
+                               .index_count   = draw.surface.index_count,
+                               .vertex_offset = draw.surface.vertex_offset,
+                           },
+                           DrawSortKey::kMeshBits);
+
+  keys_.push_back(DrawSortKey::pack(pass_orders_[pass], pass, pipeline, material, mesh, depth));
+  draws_.push_back(draw);
+}
+
+void RenderQueue::push_keyed(uint64_t key, const RenderDraw& draw) {
+  keys_.push_back(key);
+  draws_.push_back(draw);
+}
+
+void RenderQueue::reserve(size_t draw_count) {
+  keys_.reserve(draw_count);
+  draws_.reserve(draw_count);
+}
+
+void RenderQueue::sort() {
+  const auto count = keys_.size();
+  sorted_keys_.assign(keys_.begin(), keys_.end());
+  order_.resize(count);
+  for (auto i = 0U; i < count; ++i) {
+    order_[i] = i;
+  }
+  tmp_keys_.resize(count);
+  tmp_order_.resize(count);
+
+  // LSD radix sort with 8-bit digits, the histograms of all of the digits are counted in a single pass
+  constexpr auto kDigits  = sizeof(uint64_t);
+  constexpr auto kBuckets = 256U;
+  auto histograms         = std::array<std::array<uint32_t, kBuckets>, kDigits>{};
+  for (const auto key : sorted_keys_) {
+    for (auto d = 0U; d < kDigits; ++d) {
+      ++histograms[d][(key >> (d * 8)) & 0xFF];
+    }
+  }
+
+  for (auto d = 0U; d < kDigits; ++d) {
+    auto& histogram = histograms[d];
+
+    // Most of the key bits are shared by all of the draws (unused passes, few pipelines), such digits are skipped
+    if (std::ranges::any_of(histogram, [count](uint32_t bucket) { return bucket == count; })) {
+      continue;
+    }
+
+    auto offset = 0U;
+    for (auto& bucket : histogram) {
+      offset += std::exchange(bucket, offset);
+    }
+
+    for (auto i = 0U; i < count; ++i) {
+      const auto key  = sorted_keys_[i];
+      const auto dst  = histogram[(key >> (d * 8)) & 0xFF]++;
+      tmp_keys_[dst]  = key;
+      tmp_order_[dst] = order_[i];
+    }
+    sorted_keys_.swap(tmp_keys_);
+    order_.swap(tmp_order_);
+  }
+}
+
+void DrawStateTracker::draw(const RenderDraw& draw) {
+  if (!bound_ || bound_->material.pipeline != draw.material.pipeline) {
+    if (cmd_buff_) {
+      cmd_buff_.bindPipeline(vk::PipelineBindPoint::eGraphics, draw.material.pipeline);
+    }
+    ++stats_.pipeline_binds;
+  }
+
+  // A different layout may disturb the set binding even when the set is the same
+  if (!bound_ || bound_->material.material_set != draw.material.material_set ||
+      bound_->material.layout != draw.material.layout) {
+    if (cmd_buff_) {
+      cmd_buff_.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, draw.material.layout, material_set_index_,
+                                   draw.material.material_set, nullptr);
+    }
+    ++stats_.descriptor_binds;
+  }
+
+  if (!bound_ || bound_->surface.vertex_buffer != draw.surface.vertex_buffer ||
+      bound_->surface.index_buffer != draw.surface.index_buffer) {
+    if (cmd_buff_) {
+      cmd_buff_.bindVertexBuffers(0, draw.surface.vertex_buffer, vk::DeviceSize{0});
+      cmd_buff_.bindIndexBuffer(draw.surface.index_buffer, 0, vk::IndexType::eUint32);
+    }
+    ++stats_.geometry_binds;
+  }
+
+  if (cmd_buff_) {
+    cmd_buff_.drawIndexed(draw.surface.index_count, draw.instance_count, draw.surface.first_index,
+                          draw.surface.vertex_offset, draw.first_instance);
+  }
+  ++stats_.draws;
+  bound_ = &draw;
+}
+
+std::pair<uint32_t, uint32_t> RenderQueue::pass_range(uint32_t pass) const {
+  const auto first = std::ranges::lower_bound(sorted_keys_, static_cast<uint64_t>(pass) << DrawSortKey::kPassShift);
+  const auto last  = std::ranges::find_if(
+      first, sorted_keys_.end(), [pass](uint64_t key) { return DrawSortKey::pass_of(key) != pass; });
+  return {static_cast<uint32_t>(first - sorted_keys_.begin()), static_cast<uint32_t>(last - sorted_keys_.begin())};
+}
+
+RenderQueueStats RenderQueue::record(vk::CommandBuffer cmd_buff, uint32_t pass, uint32_t material_set_index,
+                                     ShaderCostProfiler* cost_profiler) const {
+  auto tracker             = DrawStateTracker(cmd_buff, material_set_index);
+  const auto [first, last] = pass_range(pass);
+  auto material_set        = vk::DescriptorSet{};
+  for (auto i = first; i < last; ++i) {
+    const auto& draw = draws_[order_[i]];
+    if (cost_profiler != nullptr && draw.material.material_set != material_set) {
+      material_set = draw.material.material_set;
+      cost_profiler->begin_material(cmd_buff, cost_profiler->material_name(material_set));
+    }
+    tracker.draw(draw);
+  }
+  if (cost_profiler != nullptr && material_set) {
+    cost_profiler->end_material(cmd_buff);
+  }
+  return tracker.stats();
+}
+
+RenderQueueStats RenderQueue::stats(uint32_t pass) const { return record(nullptr, pass, 0); }
+
+void RenderQueue::clear() {
+  draws_.clear();
+  keys_.clear();
+  sorted_keys_.clear();
+  order_.clear();
+}
+
+}  // namespace eray::vkren
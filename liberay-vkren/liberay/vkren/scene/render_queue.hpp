@@ -0,0 +1,297 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <liberay/vkren/scene/material.hpp>
+#include <liberay/vkren/scene/mesh.hpp>
+#include <liberay/vkren/shader_cost_profiler.hpp>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Order of the draws inside of a render queue pass.
+ *
+ */
+enum class DrawOrder : uint8_t {
+  /**
+   * @brief Key `pass | pipeline | material set | mesh | depth`, minimizes the state changes and draws the draws that
+   * share the state front to back. Meant for the opaque geometry.
+   *
+   */
+  StateFirst,
+
+  /**
+   * @brief Key `pass | inverted depth | pipeline | material set | mesh`, draws back to front. Meant for the blended
+   * geometry.
+   *
+   */
+  BackToFront,
+};
+
+/**
+ * @brief Packing of the 64-bit draw sort keys, from the most to the least significant bits.
+ *
+ */
+struct DrawSortKey {
+  static constexpr uint32_t kPassBits     = 4;
+  static constexpr uint32_t kPipelineBits = 12;
+  static constexpr uint32_t kMaterialBits = 16;
+  static constexpr uint32_t kMeshBits     = 16;
+  static constexpr uint32_t kDepthBits    = 16;
+  static_assert(kPassBits + kPipelineBits + kMaterialBits + kMeshBits + kDepthBits == 64);
+
+  static constexpr uint32_t kPassShift = 64 - kPassBits;
+
+  /**
+   * @brief Packs the fields, each of them must fit in its bits.
+   *
+   * @param order
+   * @param pass
+   * @param pipeline
+   * @param material
+   * @param mesh
+   * @param depth Quantized view depth, 0 is the nearest.
+   * @return uint64_t
+   */
+  [[nodiscard]] static constexpr uint64_t pack(DrawOrder order, uint32_t pass, uint32_t pipeline, uint32_t material,
+                                               uint32_t mesh, uint32_t depth) {
+    auto key = static_cast<uint64_t>(pass) << kPassShift;
+    if (order == DrawOrder::StateFirst) {
+      key |= static_cast<uint64_t>(pipeline) << (kMaterialBits + kMeshBits + kDepthBits);
+      key |= static_cast<uint64_t>(material) << (kMeshBits + kDepthBits);
+      key |= static_cast<uint64_t>(mesh) << kDepthBits;
+      key |= static_cast<uint64_t>(depth);
+    } else {
+      const auto inverted_depth = ((1U << kDepthBits) - 1) - depth;
+      key |= static_cast<uint64_t>(inverted_depth) << (kPipelineBits + kMaterialBits + kMeshBits);
+      key |= static_cast<uint64_t>(pipeline) << (kMaterialBits + kMeshBits);
+      key |= static_cast<uint64_t>(material) << kMeshBits;
+      key |= static_cast<uint64_t>(mesh);
+    }
+    return key;
+  }
+
+  [[nodiscard]] static constexpr uint32_t pass_of(uint64_t key) { return static_cast<uint32_t>(key >> kPassShift); }
+};
+
+/**
+ * @brief Single indexed draw of a mesh surface with a material.
+ *
+ */
+struct RenderDraw {
+  GPUMaterial material;
+  GPUMeshSurface surface;
+
+  /**
+   * @brief Passed as the `firstInstance`, e.g. the index of the world matrix of the node.
+   *
+   */
+  uint32_t first_instance;
+  uint32_t instance_count = 1;
+};
+
+/**
+ * @brief Commands recorded (or that would be recorded) for a pass.
+ *
+ */
+struct RenderQueueStats {
+  uint32_t draws            = 0;
+  uint32_t pipeline_binds   = 0;
+  uint32_t descriptor_binds = 0;
+  uint32_t geometry_binds   = 0;
+
+  uint32_t state_changes() const { return pipeline_binds + descriptor_binds + geometry_binds; }
+};
+
+/**
+ * @brief Records the draws and binds only the state that differs from the previous draw.
+ *
+ */
+class DrawStateTracker {
+ public:
+  /**
+   * @brief Starts with no state bound.
+   *
+   * @param cmd_buff Null if the commands should be only counted.
+   * @param material_set_index Index of the material descriptor set in the pipeline layouts.
+   */
+  DrawStateTracker(vk::CommandBuffer cmd_buff, uint32_t material_set_index)
+      : cmd_buff_(cmd_buff), material_set_index_(material_set_index) {}
+
+  void draw(const RenderDraw& draw);
+
+  const RenderQueueStats& stats() const { return stats_; }
+
+ private:
+  vk::CommandBuffer cmd_buff_;
+  uint32_t material_set_index_;
+  const RenderDraw* bound_ = nullptr;
+  RenderQueueStats stats_;
+};
+
+/**
+ * @brief Collects the draws of a frame, packs a 64-bit sort key per draw and radix sorts them, so that the draws are
+ * recorded in an order that binds every pipeline, material set and geometry as few times as possible.
+ *
+ * The pipelines, material sets and mesh surfaces are mapped to small ids in the first seen order and the ids are
+ * kept between the frames, so the order of the draws is stable. An id that does not fit in its key bits is clamped,
+ * which only degrades the order: the recording compares the actual handles and never skips a needed bind.
+ *
+ * Usage per frame: `clear()`, `push()` the visible draws, `sort()`, then `record()` each pass in its render pass.
+ *
+ */
+class RenderQueue {
+ public:
+  RenderQueue() = delete;
+  explicit RenderQueue(std::nullptr_t) {}
+
+  static constexpr uint32_t kMaxPasses = 1U << DrawSortKey::kPassBits;
+
+  [[nodiscard]] static RenderQueue create();
+
+  /**
+   * @brief Order of the draws of the pass used by the following `push()` calls, `StateFirst` by default.
+   *
+   */
+  void set_pass_order(uint32_t pass, DrawOrder order) { pass_orders_[pass] = order; }
+  DrawOrder pass_order(uint32_t pass) const { return pass_orders_[pass]; }
+
+  /**
+   * @brief View depth range the depths are quantized in, the depths outside of it are clamped.
+   *
+   * @param near_depth
+   * @param far_depth Must be greater than `near_depth`.
+   */
+  void set_depth_range(float near_depth, float far_depth);
+
+  /**
+   * @brief Depth of the sort keys, 0 at the near depth of the range.
+   *
+   */
+  uint32_t quantize_depth(float view_depth) const;
+
+  /**
+   * @brief Appends the draw to the pass.
+   *
+   * @param pass Less than `kMaxPasses`.
+   * @param draw
+   * @param view_depth Distance from the camera, e.g. of the center of the world bounds of the node.
+   */
+  void push(uint32_t pass, const RenderDraw& draw, float view_depth);
+
+  /**
+   * @brief Appends the draw with a key packed by the caller, e.g. by the `RenderExtractor` from the indices of its
+   * tables. The ids of such keys are unrelated to the ids of the `push()`, a pass should be filled by only one of them.
+   *
+   * @param key
+   * @param draw
+   */
+  void push_keyed(uint64_t key, const RenderDraw& draw);
+
+  void reserve(size_t draw_count);
+
+  /**
+   * @brief Radix sorts the draws by their keys, the draws with equal keys keep the order they were pushed in.
+   *
+   */
+  void sort();
+
+  /**
+   * @brief Binds the state that changes between the draws of the pass and records them, in the order of the last
+   * `sort()`. Must be recorded inside of the rendering.
+   *
+   * @param cmd_buff
+   * @param pass
+   * @param material_set_index Index of the material descriptor set in the pipeline layouts.
+   * @param cost_profiler Optional, the draws of every material set are wrapped in its material scope, see
+   * `ShaderCostProfiler::material_name()`.
+   * @return RenderQueueStats
+   */
+  RenderQueueStats record(vk::CommandBuffer cmd_buff, uint32_t pass, uint32_t material_set_index,
+                          ShaderCostProfiler* cost_profiler = nullptr) const;
+
+  /**
+   * @brief Positions in the `sorted_draws()` of the draws of the pass, valid after `sort()`.
+   *
+   * @param pass
+   * @return std::pair<uint32_t, uint32_t> `[first, last)`
+   */
+  std::pair<uint32_t, uint32_t> pass_range(uint32_t pass) const;
+
+  /**
+   * @brief Same as the `record()` but only counts the commands.
+   *
+   */
+  RenderQueueStats stats(uint32_t pass) const;
+
+  /**
+   * @brief Removes the draws, the handle ids are kept.
+   *
+   */
+  void clear();
+
+  /**
+   * @brief Indices of the draws in the sorted order, valid after `sort()`.
+   *
+   */
+  std::span<const uint32_t> sorted_draws() const { return order_; }
+  std::span<const RenderDraw> draws() const { return draws_; }
+  std::span<const uint64_t> keys() const { return keys_; }
+
+ private:
+  /**
+   * @brief Identifies a mesh surface, the draws of the same surface get the same key bits and are sorted next to each
+   * other.
+   *
+   */
+  struct SurfaceKey {
+    VkBuffer vertex_buffer;
+    VkBuffer index_buffer;
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+
+    bool operator==(const SurfaceKey&) const = default;
+  };
+
+  struct SurfaceKeyHash {
+    size_t operator()(const SurfaceKey& key) const {
+      auto hash    = std::hash<VkBuffer>{}(key.vertex_buffer);
+      auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2); };
+      combine(std::hash<VkBuffer>{}(key.index_buffer));
+      combine(key.first_index);
+      combine(key.index_count);
+      combine(static_cast<uint32_t>(key.vertex_offset));
+      return hash;
+    }
+  };
+
+  std::vector<RenderDraw> draws_;
+  std::vector<uint64_t> keys_;
+
+  /**
+   * @brief Sorted keys and the indices of their draws, the tmp vectors are the radix sort ping-pong buffers.
+   *
+   */
+  std::vector<uint64_t> sorted_keys_;
+  std::vector<uint32_t> order_;
+  std::vector<uint64_t> tmp_keys_;
+  std::vector<uint32_t> tmp_order_;
+
+  std::unordered_map<VkPipeline, uint32_t> pipeline_ids_;
+  std::unordered_map<VkDescriptorSet, uint32_t> material_ids_;
+  std::unordered_map<SurfaceKey, uint32_t, SurfaceKeyHash> surface_ids_;
+
+  std::array<DrawOrder, kMaxPasses> pass_orders_{};
+  float near_depth_ = 0.F;
+  float far_depth_  = 1.F;
+};
+
+}  // namespace eray::vkren
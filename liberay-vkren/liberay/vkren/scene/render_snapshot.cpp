@@ -0,0 +1,36 @@
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/scene/flat_tree.hpp>
+#include <liberay/vkren/scene/frustum.hpp>
+#include <liberay/vkren/scene/render_snapshot.hpp>
+#include <liberay/vkren/scene/scene.hpp>
+
+namespace eray::vkren {
+
+void RenderSnapshot::extract(const Scene& scene, const RenderView& render_view) {
+  ERAY_PROFILE_FUNCTION();
+
+  const auto& tree = scene.tree();
+  tree_update      = tree.update_count();
+  view             = render_view.view;
+  projection       = render_view.projection;
+
+  const auto frustum = Frustum::from_view_projection(render_view.projection * render_view.view);
+  scene.bounds().cull(frustum, render_view.lod_view, visible_nodes, screen_sizes);
+
+  const auto& tree_world_matrices = tree.local_to_world_matrices();
+  const auto& scene_renderers     = scene.renderers();
+  world_matrices.clear();
+  world_matrices.reserve(visible_nodes.size());
+  renderers.clear();
+  renderers.reserve(visible_nodes.size());
+  for (const auto node_id : visible_nodes) {
+    const auto index = FlatTree::index_of(node_id);
+    world_matrices.push_back(tree_world_matrices[index]);
+    renderers.push_back(scene_renderers.optional_at<MeshRenderer>(index).value_or(MeshRenderer{}));
+  }
+
+  directional_light_count =
+      pack_lights(scene.lights().values<Light>(), scene.lights().keys(), tree_world_matrices, lights);
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/util/triple_buffer.hpp>
+#include <liberay/vkren/scene/entity_pool.hpp>
+#include <liberay/vkren/scene/light_clusters.hpp>
+#include <liberay/vkren/scene/lod.hpp>
+#include <liberay/vkren/scene/mesh.hpp>
+#include <vector>
+
+namespace eray::vkren {
+
+struct Scene;
+
+/**
+ * @brief Camera the snapshot is extracted for.
+ *
+ */
+struct RenderView {
+  math::Mat4f view;
+  math::Mat4f projection;
+  LodView lod_view;
+};
+
+/**
+ * @brief Everything the frame recording reads from the `Scene`, copied out of it by `extract()`. Once extracted the
+ * snapshot does not refer to the scene, so the update of the next frame may mutate the scene while the render thread
+ * records the commands of this one.
+ *
+ */
+struct RenderSnapshot {
+  /**
+   * @brief `TransformTree::update_count()` at the extraction.
+   *
+   */
+  uint64_t tree_update = 0;
+
+  math::Mat4f view       = math::Mat4f::identity();
+  math::Mat4f projection = math::Mat4f::identity();
+
+  /**
+   * @brief Nodes that passed the frustum culling. The `world_matrices`, the `screen_sizes` and the `renderers` are
+   * parallel to it, the renderer of a node without one has the `MeshRenderer::kNone` mesh.
+   *
+   */
+  std::vector<NodeId> visible_nodes;
+  std::vector<math::Mat4f> world_matrices;
+  std::vector<float> screen_sizes;
+  std::vector<MeshRenderer> renderers;
+
+  /**
+   * @brief Lights in the world space, see `pack_lights()`.
+   *
+   */
+  std::vector<GpuLight> lights;
+  uint32_t directional_light_count = 0;
+
+  /**
+   * @brief Replaces the contents with the state of the scene, reusing the capacity of the vectors. The scene tree and
+   * the bounds must be up to date (`TransformTree::update()` followed by `SceneBounds::refit()`).
+   *
+   * @param scene
+   * @param view
+   */
+  void extract(const Scene& scene, const RenderView& view);
+};
+
+/**
+ * @brief Hands the snapshots from the update thread to the render thread: the update thread calls `extract()` on the
+ * `write_buffer()` and `publish()`es it, the render thread records the frame from `read()`. The render thread always
+ * gets the latest complete snapshot and neither of the threads waits for the other.
+ *
+ */
+using RenderSnapshotExchange = util::TripleBuffer<RenderSnapshot>;
+
+}  // namespace eray::vkren
@@ -5,13 +5,17 @@
 #include <liberay/math/quat.hpp>
 #include <liberay/util/zstring_view.hpp>
 #include <liberay/vkren/image.hpp>
+#include <liberay/vkren/scene/archetype_storage.hpp>
 #include <liberay/vkren/scene/camera.hpp>
 #include <liberay/vkren/scene/entity_pool.hpp>
 #include <liberay/vkren/scene/flat_tree.hpp>
 #include <liberay/vkren/scene/light.hpp>
 #include <liberay/vkren/scene/material.hpp>
+#include <liberay/vkren/scene/mesh.hpp>
+#include <liberay/vkren/scene/scene_bounds.hpp>
 #include <liberay/vkren/scene/sparse_set.hpp>
 #include <liberay/vkren/scene/transform_tree.hpp>
+#include <utility>
 #include <vulkan/vulkan.hpp>
 
 namespace eray::vkren {
@@ -19,15 +23,98 @@ namespace eray::vkren {
 template <typename... TValues>
 using EntitySparseSet = SparseSet<EntityIndex, TValues...>;
 
+/**
+ * @brief Chunked storage of the entity components, for the scenes with millions of entities, see `ArchetypeStorage`.
+ *
+ */
+template <typename... TComponents>
+using EntityArchetypeStorage = ArchetypeStorage<EntityIndex, TComponents...>;
+
 struct Scene {
  public:
+  /**
+   * @brief Creates the scene without any nodes.
+   *
+   * @param max_nodes_count
+   * @return Scene
+   */
+  [[nodiscard]] static Scene create(size_t max_nodes_count) {
+    auto scene            = Scene();
+    scene.tree_           = TransformTree::create(max_nodes_count);
+    scene.bounds_         = SceneBounds::create(max_nodes_count);
+    scene.camera_nodes_   = EntitySparseSet<Camera>::create(max_nodes_count);
+    scene.light_nodes_    = EntitySparseSet<Light>::create(max_nodes_count);
+    scene.renderer_nodes_ = EntitySparseSet<MeshRenderer>::create(max_nodes_count);
+    return scene;
+  }
+
+  /**
+   * @brief Creates the scene of the nodes of the `tree` without any components, e.g. read from a `SceneSnapshot`.
+   *
+   * @param tree
+   * @return Scene
+   */
+  [[nodiscard]] static Scene create(TransformTree&& tree) {
+    const auto max_nodes_count = tree.max_nodes_count();
+    auto scene                 = Scene();
+    scene.tree_                = std::move(tree);
+    scene.bounds_              = SceneBounds::create(max_nodes_count);
+    scene.camera_nodes_        = EntitySparseSet<Camera>::create(max_nodes_count);
+    scene.light_nodes_         = EntitySparseSet<Light>::create(max_nodes_count);
+    scene.renderer_nodes_      = EntitySparseSet<MeshRenderer>::create(max_nodes_count);
+    return scene;
+  }
+
   const TransformTree& tree() const { return tree_; }
   TransformTree& tree() { return tree_; }
 
+  const SceneBounds& bounds() const { return bounds_; }
+  SceneBounds& bounds() { return bounds_; }
+
+  /**
+   * @brief Cameras of the nodes keyed by the node index (`FlatTree::index_of()`).
+   *
+   */
+  const EntitySparseSet<Camera>& cameras() const { return camera_nodes_; }
+  EntitySparseSet<Camera>& cameras() { return camera_nodes_; }
+
+  /**
+   * @brief Lights of the nodes keyed by the node index (`FlatTree::index_of()`), expressed in the local space of the
+   * node. The dense storage can be packed for the GPU with `pack_lights()`.
+   *
+   */
+  const EntitySparseSet<Light>& lights() const { return light_nodes_; }
+  EntitySparseSet<Light>& lights() { return light_nodes_; }
+
+  /**
+   * @brief Drawn meshes of the nodes keyed by the node index (`FlatTree::index_of()`), copied to the snapshot for the
+   * visible nodes.
+   *
+   */
+  const EntitySparseSet<MeshRenderer>& renderers() const { return renderer_nodes_; }
+  EntitySparseSet<MeshRenderer>& renderers() { return renderer_nodes_; }
+
+  /**
+   * @brief Sorts the renderers, the lights and the cameras by the DFS preorder of their nodes a few at a time, see
+   * `BasicSparseSet::reorder_step()`, so that the extraction walks them parent first and the long-lived scenes do not
+   * scatter them with the removals. Meant to be called once per frame, outside of the iteration of the sets.
+   *
+   * @param max_steps Budget of every call, shared by the sets: the next set is sorted once the previous one is done.
+   * @return true When all of the sets are sorted.
+   */
+  bool reorder_components(size_t max_steps) {
+    const auto& flat_tree   = tree_.flat_tree();
+    const auto dfs_position = [&flat_tree](EntityIndex index) { return flat_tree.dfs_position(index); };
+    return renderer_nodes_.reorder_step(dfs_position, max_steps) &&
+           light_nodes_.reorder_step(dfs_position, max_steps) && camera_nodes_.reorder_step(dfs_position, max_steps);
+  }
+
  private:
-  TransformTree tree_;
+  TransformTree tree_ = TransformTree(nullptr);
+  SceneBounds bounds_ = SceneBounds(nullptr);
   EntitySparseSet<Camera> camera_nodes_;
   EntitySparseSet<Light> light_nodes_;
+  EntitySparseSet<MeshRenderer> renderer_nodes_;
 };
 
 }  // namespace eray::vkren
@@ -0,0 +1,142 @@
+#include <liberay/math/mat.hpp>
+#include <liberay/vkren/scene/scene_bounds.hpp>
+
+namespace eray::vkren {
+
+SceneBounds SceneBounds::create(size_t max_nodes_count, float fat_margin) {
+  auto bounds = SceneBounds(nullptr);
+  bounds.bvh_ = DynamicBvh::create(fat_margin);
+  bounds.node_ids_.resize(max_nodes_count, FlatTree::kNullNodeId);
+  bounds.local_bounds_.resize(max_nodes_count);
+  bounds.world_bounds_.resize(max_nodes_count);
+  bounds.leaves_.resize(max_nodes_count, DynamicBvh::kNullNode);
+  bounds.pending_.resize(max_nodes_count, false);
+  return bounds;
+}
+
+void SceneBounds::set_local_bounds(NodeId node_id, const Aabb& local_bounds) {
+  const auto index = FlatTree::index_of(node_id);
+  if (node_ids_[index] != node_id && node_ids_[index] != FlatTree::kNullNodeId) {
+    // The index has been reused, the box of the deleted node goes away
+    remove_index(index);
+  }
+
+  node_ids_[index]     = node_id;
+  local_bounds_[index] = local_bounds;
+  if (!pending_[index]) {
+    pending_[index] = true;
+    pending_indices_.push_back(static_cast<uint32_t>(index));
+  }
+}
+
+void SceneBounds::remove_bounds(NodeId node_id) {
+  if (has_bounds(node_id)) {
+    remove_index(FlatTree::index_of(node_id));
+  }
+}
+
+bool SceneBounds::has_bounds(NodeId node_id) const { return node_ids_[FlatTree::index_of(node_id)] == node_id; }
+
+void SceneBounds::refit(const TransformTree& tree) {
+  changed_indices_.clear();
+  if (!refit_update_ || !tree.world_matrices_changed_since(*refit_update_, changed_indices_)) {
+    changed_indices_.clear();
+    for (auto i = 0U; i < node_ids_.size(); ++i) {
+      if (node_ids_[i] != FlatTree::kNullNodeId) {
+        changed_indices_.push_back(i);
+      }
+    }
+  }
+
+  for (const auto index : changed_indices_) {
+    if (node_ids_[index] != FlatTree::kNullNodeId) {
+      refit_node(tree, index);
+    }
+  }
+
+  // A node refit above is refit again at no cost, its fat box already contains the new box
+  for (const auto index : pending_indices_) {
+    pending_[index] = false;
+    if (node_ids_[index] != FlatTree::kNullNodeId) {
+      refit_node(tree, index);
+    }
+  }
+  pending_indices_.clear();
+  refit_update_ = tree.update_count();
+}
+
+void SceneBounds::rebuild(const TransformTree& tree) {
+  bvh_.clear();
+  leaves_.assign(leaves_.size(), DynamicBvh::kNullNode);
+  build_items_.clear();
+
+  const auto& world_mats = tree.local_to_world_matrices();
+  for (auto i = 0U; i < node_ids_.size(); ++i) {
+    if (node_ids_[i] == FlatTree::kNullNodeId) {
+      continue;
+    }
+    if (!tree.exists(node_ids_[i])) {
+      remove_index(i);
+      continue;
+    }
+
+    world_bounds_[i] = local_bounds_[i].transformed(world_mats[i]);
+    build_items_.push_back(BvhItem{.box = world_bounds_[i], .value = i});
+  }
+
+  build_leaves_.resize(build_items_.size());
+  bvh_.build(build_items_, build_leaves_);
+  for (auto i = 0U; i < build_items_.size(); ++i) {
+    leaves_[build_items_[i].value] = build_leaves_[i];
+  }
+
+  for (const auto index : pending_indices_) {
+    pending_[index] = false;
+  }
+  pending_indices_.clear();
+  refit_update_ = tree.update_count();
+}
+
+void SceneBounds::cull(const Frustum& frustum, std::vector<NodeId>& visible_nodes) const {
+  culled_indices_.clear();
+  bvh_.cull(frustum, culled_indices_);
+  for (const auto index : culled_indices_) {
+    visible_nodes.push_back(node_ids_[index]);
+  }
+}
+
+void SceneBounds::cull(const Frustum& frustum, const LodView& lod_view, std::vector<NodeId>& visible_nodes,
+                       std::vector<float>& screen_sizes) const {
+  culled_indices_.clear();
+  bvh_.cull(frustum, culled_indices_);
+  for (const auto index : culled_indices_) {
+    visible_nodes.push_back(node_ids_[index]);
+    screen_sizes.push_back(projected_screen_size(world_bounds_[index], lod_view));
+  }
+}
+
+void SceneBounds::refit_node(const TransformTree& tree, size_t index) {
+  if (!tree.exists(node_ids_[index])) {
+    remove_index(index);
+    return;
+  }
+
+  world_bounds_[index] = local_bounds_[index].transformed(tree.local_to_world_matrices()[index]);
+  if (leaves_[index] == DynamicBvh::kNullNode) {
+    leaves_[index] = bvh_.insert(static_cast<uint32_t>(index), world_bounds_[index]);
+  } else {
+    bvh_.update(leaves_[index], world_bounds_[index]);
+  }
+}
+
+void SceneBounds::remove_index(size_t index) {
+  if (leaves_[index] != DynamicBvh::kNullNode) {
+    bvh_.remove(leaves_[index]);
+    leaves_[index] = DynamicBvh::kNullNode;
+  }
+  node_ids_[index]     = FlatTree::kNullNodeId;
+  local_bounds_[index] = Aabb{};
+  world_bounds_[index] = Aabb{};
+}
+
+}  // namespace eray::vkren
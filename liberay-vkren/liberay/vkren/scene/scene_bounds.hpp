@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/vkren/scene/aabb.hpp>
+#include <liberay/vkren/scene/dynamic_bvh.hpp>
+#include <liberay/vkren/scene/entity_pool.hpp>
+#include <liberay/vkren/scene/frustum.hpp>
+#include <liberay/vkren/scene/lod.hpp>
+#include <liberay/vkren/scene/transform_tree.hpp>
+#include <optional>
+#include <vector>
+
+namespace eray::vkren {
+
+/**
+ * @brief World space bounding boxes of the `TransformTree` nodes kept in a `DynamicBvh`. A node gets a box once its
+ * local bounds are set, `refit()` transforms only the boxes of the nodes whose world matrices were written by the
+ * updates since the last refit (see `TransformTree::world_matrices_changed_since()`), so the cost follows the dirty
+ * propagation of the transform tree and the static parts of the scene cost nothing.
+ *
+ */
+class SceneBounds {
+ public:
+  SceneBounds() = delete;
+  explicit SceneBounds(std::nullptr_t) {}
+
+  /**
+   * @brief Default margin the BVH leaf boxes are expanded by, in world units.
+   *
+   */
+  static constexpr float kDefaultFatMargin = 0.1F;
+
+  /**
+   * @brief Creates the bounds without any boxes.
+   *
+   * @param max_nodes_count Must match the `TransformTree::create()` argument.
+   * @param fat_margin
+   * @return SceneBounds
+   */
+  [[nodiscard]] static SceneBounds create(size_t max_nodes_count, float fat_margin = kDefaultFatMargin);
+
+  /**
+   * @brief Sets the bounds of the node in its local space, the world box is computed by the next `refit()`.
+   *
+   * @param node_id
+   * @param local_bounds Must not be empty.
+   */
+  void set_local_bounds(NodeId node_id, const Aabb& local_bounds);
+
+  /**
+   * @brief Removes the box of the node, must be called before the node is deleted from the tree. The boxes of the
+   * deleted nodes are otherwise removed only once their node index is reused.
+   *
+   * @param node_id
+   */
+  void remove_bounds(NodeId node_id);
+
+  bool has_bounds(NodeId node_id) const;
+
+  /**
+   * @brief Brings the world boxes up to date with the world matrices of the tree.
+   *
+   * @param tree Must be updated already.
+   */
+  void refit(const TransformTree& tree);
+
+  /**
+   * @brief Rebuilds the BVH from scratch with the SAH build, worth doing after a bulk load or when the quality of the
+   * incrementally updated tree has degraded (see `DynamicBvh::internal_area()`).
+   *
+   * @param tree Must be updated already.
+   */
+  void rebuild(const TransformTree& tree);
+
+  /**
+   * @brief Appends the nodes whose world boxes are not outside of the frustum. The test is conservative by the fat
+   * margin.
+   *
+   * @param frustum
+   * @param visible_nodes
+   */
+  void cull(const Frustum& frustum, std::vector<NodeId>& visible_nodes) const;
+
+  /**
+   * @brief Same as the `cull()` but also computes the `projected_screen_size()` of each visible node, while its world
+   * box is at hand, for the LOD selection (see `LodSelector`).
+   *
+   * @param frustum
+   * @param lod_view
+   * @param visible_nodes
+   * @param screen_sizes Appended in the order of the `visible_nodes`.
+   */
+  void cull(const Frustum& frustum, const LodView& lod_view, std::vector<NodeId>& visible_nodes,
+            std::vector<float>& screen_sizes) const;
+
+  /**
+   * @brief World box of the node as of the last `refit()`.
+   *
+   */
+  const Aabb& world_bounds(NodeId node_id) const { return world_bounds_[FlatTree::index_of(node_id)]; }
+
+  const DynamicBvh& bvh() const { return bvh_; }
+
+ private:
+  void refit_node(const TransformTree& tree, size_t index);
+  void remove_index(size_t index);
+
+  DynamicBvh bvh_ = DynamicBvh(nullptr);
+
+  // Per node index
+  std::vector<NodeId> node_ids_;
+  std::vector<Aabb> local_bounds_;
+  std::vector<Aabb> world_bounds_;
+  std::vector<uint32_t> leaves_;
+  std::vector<bool> pending_;
+
+  /**
+   * @brief Indices whose local bounds changed since the last refit, each once.
+   *
+   */
+  std::vector<uint32_t> pending_indices_;
+
+  /**
+   * @brief `TransformTree::update_count()` at the last refit, empty before the first one.
+   *
+   */
+  std::optional<uint64_t> refit_update_;
+  std::vector<uint32_t> changed_indices_;
+  std::vector<BvhItem> build_items_;
+  std::vector<uint32_t> build_leaves_;
+  mutable std::vector<uint32_t> culled_indices_;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/scene/scene_snapshot.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace eray::vkren {
+
+namespace {
+
+constexpr auto kMagic              = std::array<char, 8>{'E', 'R', 'A', 'Y', 'S', 'C', 'N', '\0'};
+constexpr size_t kSectionAlignment = 16;
+
+enum SnapshotSection : uint32_t {
+  SectionNodes,
+  SectionLevels,
+  SectionSubtreeSizes,
+  SectionPositions,
+  SectionRotations,
+  SectionScales,
+  SectionNameIndices,
+  SectionNameOffsets,
+  SectionNameChars,
+  SectionCameraKeys,
+  SectionCameras,
+  SectionLightKeys,
+  SectionLights,
+  SectionRendererKeys,
+  SectionRenderers,
+  SectionCount,
+};
+
+/**
+ * @brief Size of the elements of every section, the snapshots of a build with a different layout are rejected.
+ *
+ */
+constexpr auto kElementSizes = std::array<uint32_t, SectionCount>{
+    sizeof(FlatTree::Node), sizeof(uint32_t),    sizeof(size_t),      sizeof(math::Vec3f),
+    sizeof(math::Quatf),    sizeof(math::Vec3f), sizeof(uint32_t),    sizeof(uint32_t),
+    sizeof(char),           sizeof(EntityIndex), sizeof(Camera),      sizeof(EntityIndex),
+    sizeof(Light),          sizeof(EntityIndex), sizeof(MeshRenderer),
+};
+
+static_assert(std::is_trivially_copyable_v<FlatTree::Node> && std::is_trivially_copyable_v<math::Vec3f> &&
+                  std::is_trivially_copyable_v<math::Quatf>,
+              "The node arrays are copied as bytes");
+static_assert(std::is_trivially_copyable_v<Camera> && std::is_trivially_copyable_v<Light> &&
+                  std::is_trivially_copyable_v<MeshRenderer>,
+              "The components are copied as bytes");
+
+struct SectionInfo {
+  uint64_t offset;
+  uint64_t count;
+  uint32_t element_size;
+  uint32_t reserved;
+};
+
+struct SnapshotHeader {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t section_count;
+  uint64_t node_count;
+  uint64_t max_nodes_count;
+  std::array<SectionInfo, SectionCount> sections;
+};
+
+SnapshotHeader read_header(std::span<const std::byte> bytes) {
+  auto header = SnapshotHeader{};
+  std::memcpy(&header, bytes.data(), sizeof(SnapshotHeader));
+  return header;
+}
+
+/**
+ * @brief Stores every distinct string once, the string `i` is `chars[offsets[i], offsets[i + 1])`.
+ *
+ */
+struct StringTable {
+  std::vector<uint32_t> offsets{0};
+  std::vector<char> chars;
+  std::unordered_map<std::string_view, uint32_t> indices;
+
+  uint32_t intern(std::string_view str) {
+    const auto [it, inserted] = indices.try_emplace(str, static_cast<uint32_t>(offsets.size() - 1));
+    if (inserted) {
+      chars.insert(chars.end(), str.begin(), str.end());
+      offsets.push_back(static_cast<uint32_t>(chars.size()));
+    }
+    return it->second;
+  }
+};
+
+template <typename T>
+void append_section(std::vector<std::byte>& bytes, SnapshotHeader& header, SnapshotSection section,
+                    const std::vector<T>& data) {
+  const auto offset = (bytes.size() + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+  const auto size   = data.size() * sizeof(T);
+  bytes.resize(offset + size);
+  if (size > 0) {
+    std::memcpy(bytes.data() + offset, data.data(), size);
+  }
+  header.sections[section] = SectionInfo{
+      .offset       = offset,
+      .count        = data.size(),
+      .element_size = sizeof(T),
+      .reserved     = 0,
+  };
+}
+
+/**
+ * @brief Appends the keys remapped to the snapshot node indices and the values of the components of the nodes that
+ * still exist.
+ *
+ */
+template <typename T>
+void append_components(std::vector<std::byte>& bytes, SnapshotHeader& header, const EntitySparseSet<T>& set,
+                       std::span<const size_t> remap, SnapshotSection keys_section, SnapshotSection values_section) {
+  auto keys   = std::vector<EntityIndex>();
+  auto values = std::vector<T>();
+  keys.reserve(set.size());
+  values.reserve(set.size());
+  const auto set_keys   = set.keys();
+  const auto set_values = set.template values<T>();
+  for (auto i = size_t{0}; i < set_keys.size(); ++i) {
+    if (set_keys[i] < remap.size() && remap[set_keys[i]] != FlatTree::kNullNodeIndex) {
+      keys.push_back(remap[set_keys[i]]);
+      values.push_back(set_values[i]);
+    }
+  }
+  append_section(bytes, header, keys_section, keys);
+  append_section(bytes, header, values_section, values);
+}
+
+std::unexpected<Error> invalid_snapshot(std::string msg) {
+  util::Logger::err("Could not read the scene snapshot. {}", msg);
+  return std::unexpected(Error{
+      .msg  = std::move(msg),
+      .code = ErrorCode::ParserError{},
+  });
+}
+
+}  // namespace
+
+std::vector<std::byte> SceneSnapshot::serialize(const Scene& scene) {
+  ERAY_PROFILE_FUNCTION();
+
+  const auto& transforms = scene.tree();
+  const auto& tree       = transforms.flat_tree();
+  const auto& preorder   = tree.nodes_dfs_preorder();
+  const auto node_count  = preorder.size();
+
+  // Index of the node in the snapshot by its current index
+  auto remap = std::vector<size_t>(tree.max_nodes_count(), FlatTree::kNullNodeIndex);
+  for (auto i = size_t{0}; i < node_count; ++i) {
+    remap[FlatTree::index_of(preorder[i])] = i;
+  }
+  const auto remap_id = [&remap](NodeId id) {
+    return id == FlatTree::kNullNodeId ? FlatTree::kNullNodeIndex : remap[FlatTree::index_of(id)];
+  };
+
+  auto nodes         = std::vector<FlatTree::Node>();
+  auto levels        = std::vector<uint32_t>();
+  auto subtree_sizes = std::vector<size_t>();
+  auto positions     = std::vector<math::Vec3f>();
+  auto rotations     = std::vector<math::Quatf>();
+  auto scales        = std::vector<math::Vec3f>();
+  auto name_indices  = std::vector<uint32_t>();
+  nodes.reserve(node_count);
+  levels.reserve(node_count);
+  subtree_sizes.reserve(node_count);
+  positions.reserve(node_count);
+  rotations.reserve(node_count);
+  scales.reserve(node_count);
+  name_indices.reserve(node_count);
+
+  auto names = StringTable();
+  for (auto node : preorder) {
+    const auto info = tree.node_surrounding_info(node);
+    nodes.push_back(FlatTree::Node{
+        .parent        = remap_id(info.parent_id),
+        .left_child    = remap_id(info.left_child_id),
+        .right_child   = remap_id(info.right_child_id),
+        .left_sibling  = remap_id(info.left_sibling_id),
+        .right_sibling = remap_id(info.right_sibling_id),
+    });
+    levels.push_back(tree.node_level(node));
+    subtree_sizes.push_back(tree.subtree_size(node));
+
+    const auto transform = transforms.local_transform(node);
+    positions.push_back(transform.position);
+    rotations.push_back(transform.rotation);
+    scales.push_back(transform.scale);
+    name_indices.push_back(names.intern(transforms.name(node)));
+  }
+
+  auto header = SnapshotHeader{
+      .magic           = kMagic,
+      .version         = kVersion,
+      .section_count   = SectionCount,
+      .node_count      = node_count,
+      .max_nodes_count = tree.max_nodes_count(),
+      .sections        = {},
+  };
+  auto bytes = std::vector<std::byte>(sizeof(SnapshotHeader));
+  append_section(bytes, header, SectionNodes, nodes);
+  append_section(bytes, header, SectionLevels, levels);
+  append_section(bytes, header, SectionSubtreeSizes, subtree_sizes);
+  append_section(bytes, header, SectionPositions, positions);
+  append_section(bytes, header, SectionRotations, rotations);
+  append_section(bytes, header, SectionScales, scales);
+  append_section(bytes, header, SectionNameIndices, name_indices);
+  append_section(bytes, header, SectionNameOffsets, names.offsets);
+  append_section(bytes, header, SectionNameChars, names.chars);
+  append_components(bytes, header, scene.cameras(), remap, SectionCameraKeys, SectionCameras);
+  append_components(bytes, header, scene.lights(), remap, SectionLightKeys, SectionLights);
+  append_components(bytes, header, scene.renderers(), remap, SectionRendererKeys, SectionRenderers);
+  std::memcpy(bytes.data(), &header, sizeof(SnapshotHeader));
+
+  return bytes;
+}
+
+Result<void, Error> SceneSnapshot::write(const Scene& scene, const std::filesystem::path& path) {
+  const auto bytes = serialize(scene);
+
+  auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not open the scene snapshot "{}")", path.string()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  if (!file) {
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not write the scene snapshot "{}")", path.string()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  return {};
+}
+
+Result<SceneSnapshot, Error> SceneSnapshot::open(const std::filesystem::path& path) {
+  auto file = res::MappedFile::open(path);
+  if (!file) {
+    util::Logger::err(R"(Could not map the scene snapshot "{}": {})", path.string(), file.error().msg);
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not map the scene snapshot "{}")", path.string()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  auto snapshot   = SceneSnapshot(nullptr);
+  snapshot.bytes_ = file->bytes();
+  snapshot.file_  = std::move(*file);
+  TRY(snapshot.validate());
+
+  return snapshot;
+}
+
+Result<SceneSnapshot, Error> SceneSnapshot::create(std::vector<std::byte>&& bytes) {
+  auto snapshot         = SceneSnapshot(nullptr);
+  snapshot.owned_bytes_ = std::move(bytes);
+  snapshot.bytes_       = snapshot.owned_bytes_;
+  TRY(snapshot.validate());
+
+  return snapshot;
+}
+
+Result<void, Error> SceneSnapshot::validate() {
+  if (bytes_.size() < sizeof(SnapshotHeader)) {
+    return invalid_snapshot("The snapshot is truncated");
+  }
+
+  const auto header = read_header(bytes_);
+  if (header.magic != kMagic) {
+    return invalid_snapshot("The file is not a scene snapshot");
+  }
+  if (header.version != kVersion || header.section_count != SectionCount) {
+    return invalid_snapshot(std::format("Unsupported snapshot version {}", header.version));
+  }
+
+  for (auto i = 0U; i < SectionCount; ++i) {
+    const auto& info = header.sections[i];
+    if (info.element_size != kElementSizes[i]) {
+      return invalid_snapshot("The snapshot was written by a build with a different memory layout");
+    }
+    if (info.offset % kSectionAlignment != 0 || info.offset > bytes_.size() ||
+        info.count > (bytes_.size() - info.offset) / info.element_size) {
+      return invalid_snapshot("The snapshot is truncated");
+    }
+  }
+
+  const auto node_count     = header.node_count;
+  const auto& sections      = header.sections;
+  constexpr auto kPerNode   = std::array{SectionNodes,     SectionLevels, SectionSubtreeSizes, SectionPositions,
+                                         SectionRotations, SectionScales, SectionNameIndices};
+  const auto has_node_count = [&](SnapshotSection s) { return sections[s].count == node_count; };
+  const auto has_values     = [&](SnapshotSection keys, SnapshotSection values) {
+    return sections[keys].count == sections[values].count;
+  };
+  if (node_count == 0 || node_count > header.max_nodes_count || !std::ranges::all_of(kPerNode, has_node_count) ||
+      sections[SectionNameOffsets].count == 0 || !has_values(SectionCameraKeys, SectionCameras) ||
+      !has_values(SectionLightKeys, SectionLights) || !has_values(SectionRendererKeys, SectionRenderers)) {
+    return invalid_snapshot("The sections do not match the node count");
+  }
+
+  // The indices are followed by the instantiation, an invalid one would read out of the arrays
+  node_count_ = node_count;
+
+  const auto is_node_index = [this](size_t index) { return index < node_count_ || index == FlatTree::kNullNodeIndex; };
+  const auto valid_nodes   = std::ranges::all_of(section<FlatTree::Node>(SectionNodes), [&](const auto& node) {
+    return is_node_index(node.parent) && is_node_index(node.left_child) && is_node_index(node.right_child) &&
+           is_node_index(node.left_sibling) && is_node_index(node.right_sibling);
+  });
+
+  const auto name_offsets = section<uint32_t>(SectionNameOffsets);
+  const auto name_count   = name_offsets.size() - 1;
+  const auto valid_names =
+      std::ranges::all_of(section<uint32_t>(SectionNameIndices), [&](uint32_t index) { return index < name_count; }) &&
+      std::ranges::is_sorted(name_offsets) && name_offsets.back() <= sections[SectionNameChars].count;
+
+  const auto is_key     = [this](EntityIndex key) { return key < node_count_; };
+  const auto valid_keys = std::ranges::all_of(section<EntityIndex>(SectionCameraKeys), is_key) &&
+                          std::ranges::all_of(section<EntityIndex>(SectionLightKeys), is_key) &&
+                          std::ranges::all_of(section<EntityIndex>(SectionRendererKeys), is_key);
+
+  if (!valid_nodes || !valid_names || !valid_keys) {
+    node_count_ = 0;
+    return invalid_snapshot("The snapshot refers to a node or a name that does not exist");
+  }
+  max_nodes_count_ = header.max_nodes_count;
+
+  return {};
+}
+
+template <typename T>
+std::span<const T> SceneSnapshot::section(uint32_t section_index) const {
+  const auto info = read_header(bytes_).sections[section_index];
+  return std::span(reinterpret_cast<const T*>(bytes_.data() + info.offset), info.count);
+}
+
+Scene SceneSnapshot::instantiate(size_t max_nodes_count) const {
+  ERAY_PROFILE_FUNCTION();
+  assert((max_nodes_count == 0 || max_nodes_count >= node_count_) && "The scene cannot hold all of the nodes");
+
+  auto tree = FlatTree::create_from_preorder(max_nodes_count == 0 ? max_nodes_count_ : max_nodes_count,
+                                             section<FlatTree::Node>(SectionNodes), section<uint32_t>(SectionLevels),
+                                             section<size_t>(SectionSubtreeSizes));
+  auto transforms = TransformTree::create(std::move(tree), section<math::Vec3f>(SectionPositions),
+                                          section<math::Quatf>(SectionRotations), section<math::Vec3f>(SectionScales));
+
+  const auto name_indices = section<uint32_t>(SectionNameIndices);
+  const auto name_offsets = section<uint32_t>(SectionNameOffsets);
+  const auto name_chars   = section<char>(SectionNameChars);
+  for (auto i = size_t{0}; i < node_count_; ++i) {
+    const auto begin = name_offsets[name_indices[i]];
+    const auto end   = name_offsets[name_indices[i] + 1];
+    transforms.set_name(EntityPool<NodeId>::compose_id(i, 0), std::string(name_chars.data() + begin, end - begin));
+  }
+
+  auto scene = Scene::create(std::move(transforms));
+  scene.cameras().assign(section<EntityIndex>(SectionCameraKeys), section<Camera>(SectionCameras));
+  scene.lights().assign(section<EntityIndex>(SectionLightKeys), section<Light>(SectionLights));
+  scene.renderers().assign(section<EntityIndex>(SectionRendererKeys), section<MeshRenderer>(SectionRenderers));
+
+  return scene;
+}
+
+}  // namespace eray::vkren
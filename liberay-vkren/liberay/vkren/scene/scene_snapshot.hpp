@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <liberay/res/mapped_file.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/scene/scene.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace eray::vkren {
+
+/**
+ * @brief Binary snapshot of a `Scene`. The node arrays of the `FlatTree`, the levels, the local transforms and the
+ * component sparse sets are stored as flat arrays in their in-memory layout, the node names in an interned string
+ * table. The snapshot is read from the memory mapped file and every array is adopted with a single copy, so loading
+ * a scene does not create, link nor name its nodes one by one:
+ * @code
+ * SceneSnapshot::write(scene, "plant.scene").or_panic("Could not save the scene");
+ * auto snapshot = SceneSnapshot::open("plant.scene").or_panic("Could not open the scene");
+ * auto loaded   = snapshot.instantiate();
+ * @endcode
+ *
+ * The nodes are stored compacted in the DFS preorder, so the loaded scene gets new node ids: the i-th node of the
+ * preorder gets the index i and the version 0, the keys of the components are remapped the same way. The components of
+ * the removed nodes and the bounds are not stored.
+ *
+ * Like the asset cache, the snapshots are meant to stay on one machine. They are stored in the native byte order and
+ * layout, the snapshots written by a build with a different layout of the stored types are rejected.
+ *
+ */
+class SceneSnapshot {
+ public:
+  SceneSnapshot() = delete;
+  explicit SceneSnapshot(std::nullptr_t) {}
+
+  /**
+   * @brief Version of the format, rejected on a mismatch.
+   *
+   */
+  static constexpr uint32_t kVersion = 1;
+
+  /**
+   * @brief Serializes the scene into the snapshot bytes.
+   *
+   * @param scene
+   * @return std::vector<std::byte>
+   */
+  [[nodiscard]] static std::vector<std::byte> serialize(const Scene& scene);
+
+  /**
+   * @brief Serializes the scene and writes it to the file, an existing file is replaced.
+   *
+   * @param scene
+   * @param path
+   * @return Result<void, Error>
+   */
+  static Result<void, Error> write(const Scene& scene, const std::filesystem::path& path);
+
+  /**
+   * @brief Maps the file and validates the layout of the snapshot. The arrays are read by `instantiate()`.
+   *
+   * @param path
+   * @return Result<SceneSnapshot, Error> Fails with `FileError` when the file cannot be mapped and with `ParserError`
+   * when it is not a valid snapshot.
+   */
+  [[nodiscard]] static Result<SceneSnapshot, Error> open(const std::filesystem::path& path);
+
+  /**
+   * @brief Adopts the bytes of `serialize()`, e.g. received over the network.
+   *
+   * @param bytes
+   * @return Result<SceneSnapshot, Error>
+   */
+  [[nodiscard]] static Result<SceneSnapshot, Error> create(std::vector<std::byte>&& bytes);
+
+  size_t node_count() const { return node_count_; }
+
+  /**
+   * @brief Capacity of the saved scene.
+   *
+   */
+  size_t max_nodes_count() const { return max_nodes_count_; }
+
+  /**
+   * @brief Creates the scene with the nodes and the components of the snapshot. The first `TransformTree::update()`
+   * computes the matrices of all of the nodes.
+   *
+   * @param max_nodes_count Capacity of the scene, at least `node_count()`. Zero keeps the capacity of the saved scene.
+   * @return Scene
+   */
+  [[nodiscard]] Scene instantiate(size_t max_nodes_count = 0) const;
+
+ private:
+  Result<void, Error> validate();
+
+  template <typename T>
+  std::span<const T> section(uint32_t section_index) const;
+
+  std::optional<res::MappedFile> file_;
+  std::vector<std::byte> owned_bytes_;
+
+  /**
+   * @brief Bytes of the mapped file or the owned ones, the sections are 16-byte aligned and read in place.
+   *
+   */
+  std::span<const std::byte> bytes_;
+  size_t node_count_      = 0;
+  size_t max_nodes_count_ = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cmath>
+#include <liberay/vkren/scene/shading_rate.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+/**
+ * @brief Added to the mean luminance, the noise of the dark tiles does not keep them at the full rate.
+ *
+ */
+constexpr float kLuminanceBias = 0.05F;
+
+/**
+ * @brief 0 for the 1x1, 1 for the 2x2 and 2 for the 4x4 fragments.
+ *
+ */
+uint32_t level_of(ShadingRate rate) {
+  return static_cast<uint32_t>(rate) / static_cast<uint32_t>(ShadingRate::Rate2x2);
+}
+
+}  // namespace
+
+ShadingRate select_shading_rate(const ShadingRateParams& params, float luminance_mean, float luminance_variance,
+                                math::Vec2f tile_uv) {
+  auto level = 0U;
+  if (params.use_luminance) {
+    const auto contrast = std::sqrt(std::max(luminance_variance, 0.F)) / (luminance_mean + kLuminanceBias);
+    if (contrast < params.quarter_rate_contrast) {
+      level = 2;
+    } else if (contrast < params.half_rate_contrast) {
+      level = 1;
+    }
+  }
+
+  const auto distance = math::distance(tile_uv, params.focus);
+  if (distance > params.quarter_rate_radius) {
+    level = 2;
+  } else if (distance > params.half_rate_radius) {
+    level = std::max(level, 1U);
+  }
+
+  level = std::min(level, level_of(params.max_rate));
+  return static_cast<ShadingRate>(level * static_cast<uint32_t>(ShadingRate::Rate2x2));
+}
+
+ShadingRateBudget ShadingRateBudget::create(const ShadingRateBudgetInfo& info) {
+  auto budget  = ShadingRateBudget(nullptr);
+  budget.info_ = info;
+  return budget;
+}
+
+void ShadingRateBudget::update(double gpu_time_ms) {
+  gpu_time_ms_ = gpu_time_ms_ == 0.0 ? gpu_time_ms : std::lerp(gpu_time_ms_, gpu_time_ms, info_.smoothing);
+
+  if (settle_frames_left_ > 0) {
+    --settle_frames_left_;
+    return;
+  }
+
+  const auto target = info_.target_gpu_time_ms;
+  if (gpu_time_ms_ <= target && gpu_time_ms_ >= (1.0 - info_.headroom) * target) {
+    return;
+  }
+
+  // The saved fragment work is not known up front, the coarsening follows the relative error of the GPU time
+  const auto goal       = (1.0 - 0.5 * info_.headroom) * target;
+  const auto step       = static_cast<float>(gpu_time_ms_ / goal - 1.0);
+  const auto coarsening = std::clamp(
+      coarsening_ + std::clamp(step, -info_.max_coarsening_step, info_.max_coarsening_step), 0.F, 1.F);
+  if (coarsening == coarsening_) {
+    return;
+  }
+
+  coarsening_         = coarsening;
+  settle_frames_left_ = info_.settle_frame_count;
+  gpu_time_ms_        = 0.0;
+}
+
+ShadingRateParams ShadingRateBudget::params() const {
+  auto params        = info_.quality;
+  const auto scale   = std::lerp(1.F, info_.max_contrast_scale, coarsening_);
+  const auto half    = std::lerp(ShadingRateParams::kNoPeriphery, info_.min_half_rate_radius, coarsening_);
+  const auto quarter = std::lerp(ShadingRateParams::kNoPeriphery, info_.min_quarter_rate_radius, coarsening_);
+
+  params.half_rate_contrast *= scale;
+  params.quarter_rate_contrast *= scale;
+  params.half_rate_radius    = std::min(params.half_rate_radius, half);
+  params.quarter_rate_radius = std::min(params.quarter_rate_radius, quarter);
+  return params;
+}
+
+}  // namespace eray::vkren
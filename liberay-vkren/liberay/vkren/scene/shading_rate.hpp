@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/vec.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Texel of a shading rate image, `(log2(width) << 2) | log2(height)` of the fragment size. The 1x1 and 2x2
+ * fragments are supported by every device with VK_KHR_fragment_shading_rate, the 4x4 ones by most of them.
+ *
+ */
+enum class ShadingRate : uint8_t {
+  Rate1x1 = 0,
+  Rate2x2 = 5,
+  Rate4x4 = 10,
+};
+
+/**
+ * @brief Inputs of the rate selection of a tile, see `select_shading_rate()`.
+ *
+ */
+struct ShadingRateParams {
+  /**
+   * @brief Radius that no tile lies beyond, whatever the focus.
+   *
+   */
+  static constexpr float kNoPeriphery = 1.5F;
+
+  /**
+   * @brief Tiles whose luminance contrast (standard deviation over the mean) in the previous frame is below the
+   * threshold are shaded at 2x2, respectively 4x4.
+   *
+   */
+  float half_rate_contrast    = 0.04F;
+  float quarter_rate_contrast = 0.01F;
+
+  /**
+   * @brief If false, the contrast is ignored and only the periphery is shaded at the lower rates.
+   *
+   */
+  bool use_luminance = true;
+
+  /**
+   * @brief Texture coordinates of the point the viewer looks at, e.g. the center of the viewport.
+   *
+   */
+  math::Vec2f focus = math::Vec2f(0.5F, 0.5F);
+
+  /**
+   * @brief Tiles farther from the focus (in the texture coordinates) are shaded at least at 2x2, respectively 4x4.
+   *
+   */
+  float half_rate_radius    = kNoPeriphery;
+  float quarter_rate_radius = kNoPeriphery;
+
+  /**
+   * @brief Coarsest rate, e.g. `Rate2x2` on the devices whose `maxFragmentSize` is 2x2.
+   *
+   */
+  ShadingRate max_rate = ShadingRate::Rate4x4;
+};
+
+/**
+ * @brief Rate of a tile of the shading rate image, CPU reference of `shading_rate.slang`. The coarser of the rates
+ * chosen by the contrast and by the distance from the focus is taken, clamped to the `max_rate`.
+ *
+ * @param params
+ * @param luminance_mean Mean luminance of the pixels of the tile in the previous frame.
+ * @param luminance_variance Variance of the luminance of the pixels.
+ * @param tile_uv Texture coordinates of the center of the tile.
+ * @return ShadingRate
+ */
+ShadingRate select_shading_rate(const ShadingRateParams& params, float luminance_mean, float luminance_variance,
+                                math::Vec2f tile_uv);
+
+struct ShadingRateBudgetInfo {
+  /**
+   * @brief Parameters used while the GPU time stays within the budget.
+   *
+   */
+  ShadingRateParams quality;
+
+  /**
+   * @brief Periphery radii and the scale of the contrast thresholds at the full coarsening.
+   *
+   */
+  float min_half_rate_radius    = 0.3F;
+  float min_quarter_rate_radius = 0.5F;
+  float max_contrast_scale      = 4.F;
+
+  /**
+   * @brief GPU time budget of the frame in milliseconds.
+   *
+   */
+  double target_gpu_time_ms = 14.0;
+
+  /**
+   * @brief Smoothed GPU time within [(1 - headroom) * target, target] keeps the coarsening unchanged.
+   *
+   */
+  double headroom = 0.1;
+
+  /**
+   * @brief Weight of the newest GPU time in the exponential moving average.
+   *
+   */
+  double smoothing = 0.2;
+
+  /**
+   * @brief Largest change of the coarsening applied at once.
+   *
+   */
+  float max_coarsening_step = 0.1F;
+
+  /**
+   * @brief Number of the updates skipped after a change, the GPU times lag behind by the frames in flight.
+   *
+   */
+  uint32_t settle_frame_count = 4;
+};
+
+/**
+ * @brief Coarsens the shading rates while the GPU time of the frame exceeds the budget, like the
+ * `DynamicResolutionController` scales the render area. At the coarsening 0 the rates are selected with the `quality`
+ * parameters, towards 1 the contrast thresholds grow and the periphery closes in on the focus.
+ *
+ */
+class ShadingRateBudget {
+ public:
+  ShadingRateBudget() = delete;
+  explicit ShadingRateBudget(std::nullptr_t) {}
+
+  [[nodiscard]] static ShadingRateBudget create(const ShadingRateBudgetInfo& info);
+
+  /**
+   * @brief Updates the coarsening with the GPU time of the latest measured frame, e.g. the sum of the
+   * `RenderGraph::profiling_results()`. Must be called once per frame.
+   *
+   * @param gpu_time_ms
+   */
+  void update(double gpu_time_ms);
+
+  /**
+   * @brief Parameters of the current coarsening, see `ShadingRateGenerator::record_build()`.
+   *
+   */
+  ShadingRateParams params() const;
+
+  float coarsening() const { return coarsening_; }
+
+  /**
+   * @brief Exponential moving average of the GPU time in milliseconds.
+   *
+   */
+  double gpu_time_ms() const { return gpu_time_ms_; }
+
+  const ShadingRateBudgetInfo& info() const { return info_; }
+  void set_target_gpu_time_ms(double target_gpu_time_ms) { info_.target_gpu_time_ms = target_gpu_time_ms; }
+
+ private:
+  ShadingRateBudgetInfo info_;
+  float coarsening_            = 0.F;
+  double gpu_time_ms_          = 0.0;
+  uint32_t settle_frames_left_ = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <cassert>
+#include <liberay/vkren/scene/sparse_page_table.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+uint32_t tile_count(uint32_t extent, uint32_t mip, uint32_t tile_extent) {
+  const auto mip_extent = std::max(extent >> mip, 1U);
+  return (mip_extent + tile_extent - 1) / tile_extent;
+}
+
+}  // namespace
+
+SparsePageTable::SparsePageTable(const CreateInfo& info) : info_(info) {
+  // Popped from the back, so the pages are handed out in order
+  free_pages_.reserve(info.page_count);
+  for (auto page = info.page_count; page > 0; --page) {
+    free_pages_.push_back(page - 1);
+  }
+}
+
+SparsePageTable SparsePageTable::create(const CreateInfo& info) { return SparsePageTable(info); }
+
+SparseTextureId SparsePageTable::add(uint32_t width, uint32_t height, uint32_t tile_width, uint32_t tile_height,
+                                     uint32_t mip_tail_first) {
+  assert(width > 0 && height > 0 && "Texture must not be empty");
+  assert(tile_width > 0 && tile_height > 0 && "Tiles must not be empty");
+
+  auto texture = Texture{
+      .tiles          = {},
+      .mip_offsets    = std::vector<uint32_t>(mip_tail_first + 1, 0),
+      .width          = width,
+      .height         = height,
+      .tile_width     = tile_width,
+      .tile_height    = tile_height,
+      .mip_tail_first = mip_tail_first,
+      .cells_x        = std::min(tile_count(width, 0, tile_width), info_.max_cells_per_side),
+      .cells_y        = std::min(tile_count(height, 0, tile_height), info_.max_cells_per_side),
+      .alive          = true,
+  };
+  for (auto mip = 0U; mip < mip_tail_first; ++mip) {
+    texture.mip_offsets[mip + 1] =
+        texture.mip_offsets[mip] + tile_count(width, mip, tile_width) * tile_count(height, mip, tile_height);
+  }
+  texture.tiles.resize(texture.mip_offsets.back());
+
+  if (!free_ids_.empty()) {
+    const auto index = free_ids_.back();
+    free_ids_.pop_back();
+    textures_[index] = std::move(texture);
+    return SparseTextureId{index};
+  }
+
+  textures_.push_back(std::move(texture));
+  return SparseTextureId{static_cast<uint32_t>(textures_.size() - 1)};
+}
+
+void SparsePageTable::remove(SparseTextureId id) {
+  auto& texture = textures_[id._value];
+  assert(texture.alive && "Texture has already been removed");
+
+  for (const auto& tile : texture.tiles) {
+    if (tile.page != kNoPage) {
+      quarantine_.push_back(QuarantinedPage{
+          .page           = tile.page,
+          .release_update = update_index_ + info_.page_reuse_delay,
+      });
+    }
+  }
+  texture.alive = false;
+  texture.tiles.clear();
+  free_ids_.push_back(id._value);
+}
+
+uint32_t SparsePageTable::tiles_x(SparseTextureId id, uint32_t mip) const {
+  const auto& texture = textures_[id._value];
+  return tile_count(texture.width, mip, texture.tile_width);
+}
+
+uint32_t SparsePageTable::tiles_y(SparseTextureId id, uint32_t mip) const {
+  const auto& texture = textures_[id._value];
+  return tile_count(texture.height, mip, texture.tile_height);
+}
+
+SparsePageTable::Tile& SparsePageTable::tile_at(uint32_t texture, const SparseTile& tile) {
+  auto& t = textures_[texture];
+  assert(tile.mip < t.mip_tail_first && "The mip tail is not tiled");
+  return t.tiles[t.mip_offsets[tile.mip] + tile.y * tile_count(t.width, tile.mip, t.tile_width) + tile.x];
+}
+
+const SparsePageTable::Tile& SparsePageTable::tile_at(uint32_t texture, const SparseTile& tile) const {
+  const auto& t = textures_[texture];
+  assert(tile.mip < t.mip_tail_first && "The mip tail is not tiled");
+  return t.tiles[t.mip_offsets[tile.mip] + tile.y * tile_count(t.width, tile.mip, t.tile_width) + tile.x];
+}
+
+uint32_t SparsePageTable::page_of(SparseTextureId id, const SparseTile& tile) const {
+  return tile_at(id._value, tile).page;
+}
+
+bool SparsePageTable::is_resident(SparseTextureId id, const SparseTile& tile) const {
+  return tile_at(id._value, tile).state == TileState::Resident;
+}
+
+SparsePageTable::TileRect SparsePageTable::cell_tiles(const Texture& texture, uint32_t cell_x, uint32_t cell_y,
+                                                      uint32_t mip) {
+  // Texels of the LOD0 covered by the cell, scaled down to the level
+  const auto texel_x0 = static_cast<uint64_t>(cell_x) * texture.width / texture.cells_x;
+  const auto texel_y0 = static_cast<uint64_t>(cell_y) * texture.height / texture.cells_y;
+  const auto texel_x1 = (static_cast<uint64_t>(cell_x) + 1) * texture.width / texture.cells_x - 1;
+  const auto texel_y1 = (static_cast<uint64_t>(cell_y) + 1) * texture.height / texture.cells_y - 1;
+
+  const auto last_x = tile_count(texture.width, mip, texture.tile_width) - 1;
+  const auto last_y = tile_count(texture.height, mip, texture.tile_height) - 1;
+  return TileRect{
+      .x0 = std::min(static_cast<uint32_t>((texel_x0 >> mip) / texture.tile_width), last_x),
+      .y0 = std::min(static_cast<uint32_t>((texel_y0 >> mip) / texture.tile_height), last_y),
+      .x1 = std::min(static_cast<uint32_t>((texel_x1 >> mip) / texture.tile_width), last_x),
+      .y1 = std::min(static_cast<uint32_t>((texel_y1 >> mip) / texture.tile_height), last_y),
+  };
+}
+
+void SparsePageTable::request_tiles(uint32_t texture, uint32_t mip, TileRect rect) {
+  const auto& t = textures_[texture];
+  for (; mip < t.mip_tail_first; ++mip) {
+    const auto last_x = tile_count(t.width, mip, t.tile_width) - 1;
+    const auto last_y = tile_count(t.height, mip, t.tile_height) - 1;
+    rect.x0           = std::min(rect.x0, last_x);
+    rect.y0           = std::min(rect.y0, last_y);
+    rect.x1           = std::min(rect.x1, last_x);
+    rect.y1           = std::min(rect.y1, last_y);
+    for (auto y = rect.y0; y <= rect.y1; ++y) {
+      for (auto x = rect.x0; x <= rect.x1; ++x) {
+        tile_at(texture, SparseTile{.mip = mip, .x = x, .y = y}).last_request = update_index_;
+      }
+    }
+
+    // The tiles of the next level cover twice as many texels of the LOD0
+    rect.x0 /= 2;
+    rect.y0 /= 2;
+    rect.x1 /= 2;
+    rect.y1 /= 2;
+  }
+}
+
+void SparsePageTable::request(SparseTextureId id, uint32_t cell_x, uint32_t cell_y, uint32_t mip) {
+  const auto& texture = textures_[id._value];
+  assert(cell_x < texture.cells_x && cell_y < texture.cells_y && "Cell is out of the grid");
+  if (mip >= texture.mip_tail_first) {
+    return;
+  }
+  request_tiles(id._value, mip, cell_tiles(texture, cell_x, cell_y, mip));
+}
+
+void SparsePageTable::request_all(SparseTextureId id, uint32_t mip) {
+  const auto& texture = textures_[id._value];
+  if (mip >= texture.mip_tail_first) {
+    return;
+  }
+  request_tiles(id._value, mip,
+                TileRect{
+                    .x0 = 0,
+                    .y0 = 0,
+                    .x1 = tiles_x(id, mip) - 1,
+                    .y1 = tiles_y(id, mip) - 1,
+                });
+}
+
+std::span<const SparsePageUpdate> SparsePageTable::update() {
+  updates_.clear();
+
+  // == Return the pages the frames in flight do not sample anymore ==================================================
+  std::erase_if(quarantine_, [this](const QuarantinedPage& quarantined) {
+    if (quarantined.release_update > update_index_) {
+      return false;
+    }
+    free_pages_.push_back(quarantined.page);
+    return true;
+  });
+
+  // == Gather the requested tiles that are not backed, the coarser levels first ======================================
+  missing_.clear();
+  evictable_.clear();
+  for (auto i = 0U; i < textures_.size(); ++i) {
+    const auto& texture = textures_[i];
+    if (!texture.alive) {
+      continue;
+    }
+    for (auto mip = 0U; mip < texture.mip_tail_first; ++mip) {
+      const auto count_x = tile_count(texture.width, mip, texture.tile_width);
+      const auto count_y = tile_count(texture.height, mip, texture.tile_height);
+      for (auto y = 0U; y < count_y; ++y) {
+        for (auto x = 0U; x < count_x; ++x) {
+          const auto ref   = TileRef{.texture = i, .tile = SparseTile{.mip = mip, .x = x, .y = y}};
+          const auto& tile = texture.tiles[texture.mip_offsets[mip] + y * count_x + x];
+          if (tile.state == TileState::Empty && tile.last_request == update_index_) {
+            missing_.push_back(ref);
+          } else if (tile.state == TileState::Resident && tile.last_request < update_index_) {
+            evictable_.push_back(ref);
+          }
+        }
+      }
+    }
+  }
+  std::ranges::stable_sort(missing_, std::ranges::greater{}, [](const TileRef& ref) { return ref.tile.mip; });
+  if (missing_.size() > info_.max_binds_per_update) {
+    missing_.resize(info_.max_binds_per_update);
+  }
+
+  // == Evict the least recently requested tiles, the finer levels first =============================================
+  const auto available = free_pages_.size() + quarantine_.size();
+  if (missing_.size() > available) {
+    std::ranges::sort(evictable_, [this](const TileRef& lhs, const TileRef& rhs) {
+      const auto lhs_request = tile_at(lhs.texture, lhs.tile).last_request;
+      const auto rhs_request = tile_at(rhs.texture, rhs.tile).last_request;
+      if (lhs_request != rhs_request) {
+        return lhs_request < rhs_request;
+      }
+      return lhs.tile.mip < rhs.tile.mip;
+    });
+
+    const auto evictions = std::min(missing_.size() - available, evictable_.size());
+    for (auto i = size_t{0}; i < evictions; ++i) {
+      const auto& ref = evictable_[i];
+      auto& tile      = tile_at(ref.texture, ref.tile);
+      updates_.push_back(SparsePageUpdate{
+          .texture = SparseTextureId{ref.texture},
+          .tile    = ref.tile,
+          .page    = tile.page,
+          .bind    = false,
+      });
+      quarantine_.push_back(QuarantinedPage{
+          .page           = tile.page,
+          .release_update = update_index_ + info_.page_reuse_delay,
+      });
+      tile.page  = kNoPage;
+      tile.state = TileState::Empty;
+    }
+  }
+
+  // == Bind the free pages ============================================================================================
+  for (const auto& ref : missing_) {
+    if (free_pages_.empty()) {
+      break;
+    }
+    auto& tile = tile_at(ref.texture, ref.tile);
+    tile.page  = free_pages_.back();
+    tile.state = TileState::Pending;
+    free_pages_.pop_back();
+    updates_.push_back(SparsePageUpdate{
+        .texture = SparseTextureId{ref.texture},
+        .tile    = ref.tile,
+        .page    = tile.page,
+        .bind    = true,
+    });
+  }
+
+  ++update_index_;
+  return updates_;
+}
+
+void SparsePageTable::complete(SparseTextureId id, const SparseTile& tile) {
+  auto& t = tile_at(id._value, tile);
+  assert(t.state == TileState::Pending && "Tile is not pending");
+  t.state = TileState::Resident;
+}
+
+uint32_t SparsePageTable::cell_resident_mip(SparseTextureId id, uint32_t cell_x, uint32_t cell_y) const {
+  const auto& texture = textures_[id._value];
+
+  auto mip = texture.mip_tail_first;
+  for (; mip > 0; --mip) {
+    const auto rect = cell_tiles(texture, cell_x, cell_y, mip - 1);
+    for (auto y = rect.y0; y <= rect.y1; ++y) {
+      for (auto x = rect.x0; x <= rect.x1; ++x) {
+        if (!is_resident(id, SparseTile{.mip = mip - 1, .x = x, .y = y})) {
+          return mip;
+        }
+      }
+    }
+  }
+  return mip;
+}
+
+void SparsePageTable::write_resident_mips(SparseTextureId id, std::span<uint32_t> out) const {
+  const auto& texture = textures_[id._value];
+  assert(out.size() >= static_cast<size_t>(texture.cells_x) * texture.cells_y && "Output must fit all of the cells");
+
+  for (auto y = 0U; y < texture.cells_y; ++y) {
+    for (auto x = 0U; x < texture.cells_x; ++x) {
+      out[y * texture.cells_x + x] = cell_resident_mip(id, x, y);
+    }
+  }
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace eray::vkren {
+
+struct SparseTextureId {
+  uint32_t _value;
+
+  bool operator==(const SparseTextureId&) const = default;
+};
+
+/**
+ * @brief Tile of a mip level of a sparse texture. The tiles have the same size in texels on every level, so the tile
+ * `(x, y)` is covered by the tile `(x / 2, y / 2)` of the next level.
+ *
+ */
+struct SparseTile {
+  uint32_t mip;
+  uint32_t x;
+  uint32_t y;
+
+  bool operator==(const SparseTile&) const = default;
+};
+
+/**
+ * @brief Page of the pool to bind to (or unbind from) a tile of a texture.
+ *
+ */
+struct SparsePageUpdate {
+  SparseTextureId texture;
+  SparseTile tile;
+  uint32_t page;
+  bool bind;
+};
+
+/**
+ * @brief Decides which tiles of the partially resident textures are backed by the pages of a fixed size pool, the CPU
+ * policy of the `SparseTextureStreamer`. The mip tail of a texture (the levels from `mip_tail_first`) is always
+ * resident and is not managed here.
+ *
+ * The tiles are requested per cell of a coarse grid laid over the texture (the granularity of the shader feedback).
+ * A requested tile is resident with all of the tiles of the coarser levels covering it, so `cell_resident_mip()` is
+ * always a valid LOD clamp. When the pool runs out, the least recently requested tiles are evicted, their pages are
+ * reused after `page_reuse_delay` updates, once the frames in flight do not sample them anymore.
+ *
+ */
+class SparsePageTable {
+ public:
+  SparsePageTable() = delete;
+  explicit SparsePageTable(std::nullptr_t) {}
+
+  static constexpr uint32_t kNoPage = UINT32_MAX;
+
+  struct CreateInfo {
+    uint32_t page_count;
+
+    /**
+     * @brief Pages bound by a single `update()`, limits the tiles uploaded in a frame.
+     *
+     */
+    uint32_t max_binds_per_update = 64;
+
+    /**
+     * @brief Number of the updates an evicted page is kept unused for, at least the number of the frames in flight.
+     *
+     */
+    uint32_t page_reuse_delay = 3;
+
+    /**
+     * @brief Maximal size of the request cell grid of a texture.
+     *
+     */
+    uint32_t max_cells_per_side = 64;
+  };
+
+  [[nodiscard]] static SparsePageTable create(const CreateInfo& info);
+
+  /**
+   * @brief Adds a texture with no tiles resident.
+   *
+   * @param width Of the LOD0.
+   * @param height Of the LOD0.
+   * @param tile_width Sparse image granularity.
+   * @param tile_height Sparse image granularity.
+   * @param mip_tail_first First level of the mip tail, the levels above are tiled.
+   * @return SparseTextureId
+   */
+  SparseTextureId add(uint32_t width, uint32_t height, uint32_t tile_width, uint32_t tile_height,
+                      uint32_t mip_tail_first);
+
+  /**
+   * @brief Removes the texture, its pages are reused after the `page_reuse_delay`. The tiles are not unbound, the
+   * image is expected to be destroyed once the frames in flight complete.
+   *
+   */
+  void remove(SparseTextureId id);
+
+  /**
+   * @brief Requests the level `mip` of the cell and the coarser levels, e.g. from the screen space feedback.
+   *
+   */
+  void request(SparseTextureId id, uint32_t cell_x, uint32_t cell_y, uint32_t mip);
+
+  /**
+   * @brief Requests the level `mip` of the whole texture and the coarser levels.
+   *
+   */
+  void request_all(SparseTextureId id, uint32_t mip);
+
+  /**
+   * @brief Returns the pages to bind and unbind. The unbinds come first, the binds load the coarser levels first and
+   * leave the tiles pending until they are `complete()`.
+   *
+   * @return std::span<const SparsePageUpdate> Valid until the next call.
+   */
+  std::span<const SparsePageUpdate> update();
+
+  /**
+   * @brief Marks the pending tile as resident, once its texels are uploaded.
+   *
+   */
+  void complete(SparseTextureId id, const SparseTile& tile);
+
+  /**
+   * @brief Finest level whose tiles covering the cell, together with the coarser ones, are all resident.
+   *
+   */
+  uint32_t cell_resident_mip(SparseTextureId id, uint32_t cell_x, uint32_t cell_y) const;
+
+  /**
+   * @brief Writes `cell_resident_mip()` of every cell, row by row, e.g. to the LOD clamp map of the texture.
+   *
+   */
+  void write_resident_mips(SparseTextureId id, std::span<uint32_t> out) const;
+
+  uint32_t cells_x(SparseTextureId id) const { return textures_[id._value].cells_x; }
+  uint32_t cells_y(SparseTextureId id) const { return textures_[id._value].cells_y; }
+  uint32_t mip_tail_first(SparseTextureId id) const { return textures_[id._value].mip_tail_first; }
+  uint32_t tiles_x(SparseTextureId id, uint32_t mip) const;
+  uint32_t tiles_y(SparseTextureId id, uint32_t mip) const;
+
+  /**
+   * @brief Page bound to the tile, `kNoPage` when the tile is not backed.
+   *
+   */
+  uint32_t page_of(SparseTextureId id, const SparseTile& tile) const;
+  bool is_resident(SparseTextureId id, const SparseTile& tile) const;
+
+  uint32_t free_page_count() const { return static_cast<uint32_t>(free_pages_.size()); }
+  uint32_t page_count() const { return info_.page_count; }
+
+ private:
+  enum class TileState : uint8_t { Empty, Pending, Resident };
+
+  struct Tile {
+    uint64_t last_request = 0;
+    uint32_t page         = kNoPage;
+    TileState state       = TileState::Empty;
+  };
+
+  struct Texture {
+    /**
+     * @brief Tiles of the tiled levels, row by row, `mip_offsets[m]` is the first tile of the level `m`.
+     *
+     */
+    std::vector<Tile> tiles;
+    std::vector<uint32_t> mip_offsets;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_width;
+    uint32_t tile_height;
+    uint32_t mip_tail_first;
+    uint32_t cells_x;
+    uint32_t cells_y;
+    bool alive;
+  };
+
+  struct TileRef {
+    uint32_t texture;
+    SparseTile tile;
+  };
+
+  /**
+   * @brief Tiles of a level, the bounds are inclusive.
+   *
+   */
+  struct TileRect {
+    uint32_t x0;
+    uint32_t y0;
+    uint32_t x1;
+    uint32_t y1;
+  };
+
+  struct QuarantinedPage {
+    uint32_t page;
+    uint64_t release_update;
+  };
+
+  explicit SparsePageTable(const CreateInfo& info);
+
+  Tile& tile_at(uint32_t texture, const SparseTile& tile);
+  const Tile& tile_at(uint32_t texture, const SparseTile& tile) const;
+
+  static TileRect cell_tiles(const Texture& texture, uint32_t cell_x, uint32_t cell_y, uint32_t mip);
+
+  void request_tiles(uint32_t texture, uint32_t mip, TileRect rect);
+
+  CreateInfo info_;
+  std::vector<Texture> textures_;
+  std::vector<uint32_t> free_ids_;
+  std::vector<uint32_t> free_pages_;
+  std::vector<QuarantinedPage> quarantine_;
+  std::vector<SparsePageUpdate> updates_;
+  std::vector<TileRef> missing_;
+  std::vector<TileRef> evictable_;
+  uint64_t update_index_ = 1;
+};
+
+}  // namespace eray::vkren
@@ -1,19 +1,35 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <optional>
 #include <ranges>
 #include <span>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 namespace eray::vkren {
 
+/**
+ * @brief Sparse set with the values stored densely in insertion order (with swap-and-pop removals), unless sorted with
+ * `reorder_step()`. The sparse array is paged, a page of `kPageSize` entries is allocated only when a key within it is
+ * inserted and released when its last key is removed, so the memory follows the number of the keys present instead of
+ * the largest key.
+ *
+ */
 template <typename TKey, TKey NullKey, typename... TValues>
   requires std::convertible_to<TKey, size_t>
 class BasicSparseSet {
  public:
+  using Key                         = TKey;
+  static constexpr TKey kNullKey    = NullKey;
+  static constexpr size_t kPageSize = 4096;
+
   static BasicSparseSet create(TKey max_key) {
     auto set = BasicSparseSet();
     set.increase_max_key(max_key);
@@ -21,30 +37,67 @@ class BasicSparseSet {
   }
 
   void insert(TKey key, TValues&&... values) {
-    if (sparse_.size() <= key) {
+    if (key_capacity_ <= static_cast<size_t>(key)) {
       increase_max_key(key);
     }
 
     assert(dense_.size() <= static_cast<size_t>(std::numeric_limits<TKey>::max()));
 
-    sparse_[static_cast<size_t>(key)] = static_cast<TKey>(dense_.size());
+    auto& page = pages_[page_of(key)];
+    if (page.empty()) {
+      page.resize(kPageSize, NullKey);
+    }
+    page[offset_of(key)] = static_cast<TKey>(dense_.size());
+    ++page_counts_[page_of(key)];
     dense_.push_back(key);
 
     push_back_values(std::forward<TValues>(values)...);
   }
 
+  /**
+   * @brief Replaces the content of the set with the `keys` and their `values` in the dense order, e.g. read from a
+   * file. Equivalent to inserting the keys one by one into an empty set, but the dense arrays are copied at once.
+   *
+   * @param keys Unique keys.
+   * @param values One per key.
+   */
+  void assign(std::span<const TKey> keys, std::span<const TValues>... values) {
+    assert(((values.size() == keys.size()) && ...) && "Expected a value per key");
+
+    reorder_keys_.clear();
+    for (auto& page : pages_) {
+      page = std::vector<TKey>();
+    }
+    std::ranges::fill(page_counts_, 0);
+    dense_.assign(keys.begin(), keys.end());
+    (std::get<std::vector<TValues>>(values_).assign(values.begin(), values.end()), ...);
+
+    for (auto i = size_t{0}; i < keys.size(); ++i) {
+      if (key_capacity_ <= static_cast<size_t>(keys[i])) {
+        increase_max_key(keys[i]);
+      }
+      auto& page = pages_[page_of(keys[i])];
+      if (page.empty()) {
+        page.resize(kPageSize, NullKey);
+      }
+      page[offset_of(keys[i])] = static_cast<TKey>(i);
+      ++page_counts_[page_of(keys[i])];
+    }
+  }
+
   void remove(TKey key) {
+    reorder_keys_.clear();
     auto last_ind = dense_.size() - 1;
-    auto curr_ind = sparse_[static_cast<size_t>(key)];
+    auto curr_ind = sparse_at(key);
     if (curr_ind == last_ind) {
       std::apply([](auto&... vecs) { (vecs.pop_back(), ...); }, values_);
       dense_.pop_back();
-      sparse_[static_cast<size_t>(key)] = NullKey;
+      clear_sparse(key);
       return;
     }
 
-    sparse_[dense_[last_ind]]         = curr_ind;
-    sparse_[static_cast<size_t>(key)] = NullKey;
+    sparse_at(dense_[last_ind]) = curr_ind;
+    clear_sparse(key);
 
     std::apply([&](auto&... vecs) { ((vecs[curr_ind] = std::move(vecs[last_ind]), vecs.pop_back()), ...); }, values_);
 
@@ -53,21 +106,25 @@ class BasicSparseSet {
   }
 
   bool contains_key(TKey key) const {
-    return static_cast<size_t>(key) < sparse_.size() && sparse_[static_cast<size_t>(key)] != NullKey;
+    if (static_cast<size_t>(key) >= key_capacity_) {
+      return false;
+    }
+    const auto& page = pages_[page_of(key)];
+    return !page.empty() && page[offset_of(key)] != NullKey;
   }
 
   template <typename TValue>
   const TValue& at(TKey key) const {
     assert(contains_key(key) && "Key does not exist");
 
-    return std::get<std::vector<TValue>>(values_)[sparse_[static_cast<size_t>(key)]];
+    return std::get<std::vector<TValue>>(values_)[sparse_at(key)];
   }
 
   template <typename TValue>
   TValue& at(TKey key) {
     assert(contains_key(key) && "Key does not exist");
 
-    return std::get<std::vector<TValue>>(values_)[sparse_[static_cast<size_t>(key)]];
+    return std::get<std::vector<TValue>>(values_)[sparse_at(key)];
   }
 
   template <typename TValue>
@@ -78,18 +135,103 @@ class BasicSparseSet {
     return at<TValue>(key);
   }
 
+  /**
+   * @brief Grows the page table only, no page is allocated.
+   *
+   * @param max_key
+   */
   void increase_max_key(TKey max_key) {
-    assert(static_cast<size_t>(max_key) >= sparse_.size());
-    sparse_.resize(max_key + 1, NullKey);
+    assert(static_cast<size_t>(max_key) >= key_capacity_);
+    key_capacity_    = static_cast<size_t>(max_key) + 1;
+    const auto pages = (key_capacity_ + kPageSize - 1) / kPageSize;
+    pages_.resize(pages);
+    page_counts_.resize(pages, 0);
+  }
+
+  TKey max_key() const { return static_cast<TKey>(key_capacity_ - 1); }
+
+  size_t size() const { return dense_.size(); }
+
+  /**
+   * @brief Position of the key in the dense arrays, `kNullKey` if the key is not present. A single sparse lookup, used
+   * by the views to probe a set.
+   *
+   */
+  TKey dense_index(TKey key) const {
+    if (static_cast<size_t>(key) >= key_capacity_) {
+      return NullKey;
+    }
+    const auto& page = pages_[page_of(key)];
+    return page.empty() ? NullKey : page[offset_of(key)];
+  }
+
+  /**
+   * @brief References to all of the values at the position of the dense arrays.
+   *
+   */
+  std::tuple<TValues&...> dense_values(size_t index) {
+    return std::apply([index](auto&... vecs) { return std::tie(vecs[index]...); }, values_);
   }
 
-  TKey max_key() const { return static_cast<TKey>(sparse_.size() - 1); }
+  std::tuple<const TValues&...> dense_values(size_t index) const {
+    return std::apply([index](const auto&... vecs) { return std::tie(vecs[index]...); }, values_);
+  }
 
-  std::span<TKey> keys() const { return dense_; }
+  /**
+   * @brief Swaps two positions of the dense arrays, the keys stay associated with their values. Lets the groups keep
+   * the dense arrays of several sets in the same order.
+   *
+   */
+  void swap_dense(size_t lhs, size_t rhs) {
+    reorder_keys_.clear();
+    swap_positions(lhs, rhs);
+  }
+
+  /**
+   * @brief Moves the values towards the order of `sort_key(key)`, e.g. the DFS preorder position of the node or the
+   * Morton code of its world position, so that the iteration of the dense arrays stays linear in memory after the
+   * swap-and-pop removals. Settles at most `max_steps` positions of the dense arrays, each costs a sparse lookup and at
+   * most one swap of the values, and resumes where it stopped on the next call, so it fits in a small slice of a frame.
+   *
+   * The first call of a reorder checks the order and sorts a copy of the keys, the values are not touched. A removal,
+   * `assign()` or `swap_dense()` cancels the reorder in progress, while the keys inserted during the reorder stay at
+   * the back until the next one. The changes of the sort keys during the reorder are picked up by the next reorder.
+   *
+   * @param sort_key Maps a key to a value comparable with `<`. Called O(n log n) times when the reorder starts, so it
+   * should be a lookup, e.g. of the codes computed beforehand.
+   * @param max_steps
+   * @return true When the reorder is finished or the dense arrays were already sorted.
+   */
+  template <typename TSortKey>
+  bool reorder_step(const TSortKey& sort_key, size_t max_steps) {
+    if (reorder_keys_.empty()) {
+      if (std::ranges::is_sorted(dense_, {}, sort_key)) {
+        return true;
+      }
+      reorder_keys_.assign(dense_.begin(), dense_.end());
+      std::ranges::stable_sort(reorder_keys_, {}, sort_key);
+      reorder_next_ = 0;
+    }
+
+    // The keys before `reorder_next_` are settled, so the next key is always found at or after it
+    const auto last = reorder_next_ + std::min(max_steps, reorder_keys_.size() - reorder_next_);
+    for (; reorder_next_ < last; ++reorder_next_) {
+      swap_positions(reorder_next_, static_cast<size_t>(sparse_at(reorder_keys_[reorder_next_])));
+    }
+    if (reorder_next_ < reorder_keys_.size()) {
+      return false;
+    }
+    reorder_keys_.clear();
+    return true;
+  }
+
+  bool is_reordering() const { return !reorder_keys_.empty(); }
+
+  std::span<const TKey> keys() const { return dense_; }
 
   template <typename TValue>
-  std::span<TValue> values() const {
-    return std::get<TValue>(values_);
+  std::span<const TValue> values() const {
+    return std::get<std::vector<TValue>>(values_);
   }
 
   template <typename TValue>
@@ -97,15 +239,60 @@ class BasicSparseSet {
     return std::views::zip(dense_, std::get<std::vector<TValue>>(values_));
   }
 
+  /**
+   * @brief Number of the allocated sparse pages.
+   *
+   */
+  size_t allocated_page_count() const {
+    return static_cast<size_t>(std::ranges::count_if(pages_, [](const auto& page) { return !page.empty(); }));
+  }
+
  private:
+  static size_t page_of(TKey key) { return static_cast<size_t>(key) / kPageSize; }
+  static size_t offset_of(TKey key) { return static_cast<size_t>(key) % kPageSize; }
+
+  TKey& sparse_at(TKey key) { return pages_[page_of(key)][offset_of(key)]; }
+  const TKey& sparse_at(TKey key) const { return pages_[page_of(key)][offset_of(key)]; }
+
+  void swap_positions(size_t lhs, size_t rhs) {
+    if (lhs == rhs) {
+      return;
+    }
+    std::swap(sparse_at(dense_[lhs]), sparse_at(dense_[rhs]));
+    std::swap(dense_[lhs], dense_[rhs]);
+    std::apply([lhs, rhs](auto&... vecs) { (std::swap(vecs[lhs], vecs[rhs]), ...); }, values_);
+  }
+
+  void clear_sparse(TKey key) {
+    sparse_at(key) = NullKey;
+    if (--page_counts_[page_of(key)] == 0) {
+      pages_[page_of(key)] = std::vector<TKey>();
+    }
+  }
+
   template <typename... TArgs>
   void push_back_values(TArgs&&... args) {
     (std::get<std::vector<TArgs>>(values_).push_back(std::forward<TArgs>(args)), ...);
   }
 
-  std::vector<TKey> sparse_;
+  /**
+   * @brief Sparse pages, an empty page holds no keys and is not allocated.
+   *
+   */
+  std::vector<std::vector<TKey>> pages_;
+  std::vector<uint32_t> page_counts_;
+  size_t key_capacity_ = 0;
+
   std::vector<TKey> dense_;
   std::tuple<std::vector<TValues>...> values_;
+
+  /**
+   * @brief Keys in the target order of the reorder in progress, empty if there is none. The first `reorder_next_`
+   * positions of the dense arrays already hold their keys.
+   *
+   */
+  std::vector<TKey> reorder_keys_;
+  size_t reorder_next_ = 0;
 };
 
 template <typename TKey, typename... TValues>
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <liberay/vkren/scene/sparse_set.hpp>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace eray::vkren {
+
+/**
+ * @brief Join of several sparse sets over the keys present in all of them. Iterates the dense keys of the smallest set
+ * and probes the others through their sparse arrays, so the cost follows the smallest set. The sets may be const.
+ *
+ * The sets must not be inserted into or removed from during the iteration.
+ *
+ */
+template <typename... TSets>
+  requires(sizeof...(TSets) > 0)
+class SparseSetView {
+ public:
+  using Key                      = typename std::tuple_element_t<0, std::tuple<std::remove_const_t<TSets>...>>::Key;
+  static constexpr Key kNullKey  = std::tuple_element_t<0, std::tuple<std::remove_const_t<TSets>...>>::kNullKey;
+  static constexpr size_t kCount = sizeof...(TSets);
+
+  static_assert((std::is_same_v<typename std::remove_const_t<TSets>::Key, Key> && ...),
+                "The joined sets must share the key type");
+  static_assert(((std::remove_const_t<TSets>::kNullKey == kNullKey) && ...), "The joined sets must share the null key");
+
+  SparseSetView() = delete;
+  explicit SparseSetView(TSets&... sets) : sets_(sets...) {}
+
+  /**
+   * @brief Calls `func(key, values...)` for every key present in all of the sets, the values of all the sets are
+   * passed by reference in the order of the sets. The keys come in the dense order of the smallest set.
+   *
+   */
+  template <typename TFunc>
+  void each(TFunc&& func) const {
+    each_impl(func, std::make_index_sequence<kCount>{});
+  }
+
+  /**
+   * @brief Upper bound of the number of the keys visited by `each()`.
+   *
+   */
+  size_t size_hint() const { return pivot_keys().size(); }
+
+ private:
+  std::span<const Key> pivot_keys() const {
+    return std::apply(
+        [](const auto&... sets) {
+          auto keys = std::array<std::span<const Key>, kCount>{sets.keys()...};
+          return *std::ranges::min_element(keys, {}, [](std::span<const Key> span) { return span.size(); });
+        },
+        sets_);
+  }
+
+  template <typename TFunc, size_t... Is>
+  void each_impl(TFunc& func, std::index_sequence<Is...>) const {
+    for (const auto key : pivot_keys()) {
+      const auto indices = std::array<Key, kCount>{std::get<Is>(sets_).dense_index(key)...};
+      if (((indices[Is] == kNullKey) || ...)) {
+        continue;
+      }
+      std::apply(func, std::tuple_cat(std::tuple<Key>(key),
+                                      std::get<Is>(sets_).dense_values(static_cast<size_t>(indices[Is]))...));
+    }
+  }
+
+  std::tuple<TSets&...> sets_;
+};
+
+/**
+ * @brief Joins the sets, e.g. `view(scene.lights(), shadows).each([](auto node, const Light& light, Shadow& shadow)
+ * {...})`.
+ *
+ */
+template <typename... TSets>
+[[nodiscard]] SparseSetView<TSets...> view(TSets&... sets) {
+  return SparseSetView<TSets...>(sets...);
+}
+
+/**
+ * @brief Owning group of sparse sets of components that are commonly queried together. The group keeps the keys
+ * present in all of the sets at the front of their dense arrays, in the same order, so `each()` walks the sets in
+ * lockstep without any sparse lookup.
+ *
+ * To keep that order the sets are owned by the group and modified only through its `insert()` and `remove()`, the
+ * values may be modified freely.
+ *
+ */
+template <typename... TSets>
+  requires(sizeof...(TSets) > 1)
+class SparseSetGroup {
+ public:
+  using Key                      = typename std::tuple_element_t<0, std::tuple<TSets...>>::Key;
+  static constexpr Key kNullKey  = std::tuple_element_t<0, std::tuple<TSets...>>::kNullKey;
+  static constexpr size_t kCount = sizeof...(TSets);
+
+  static_assert((std::is_same_v<typename TSets::Key, Key> && ...), "The grouped sets must share the key type");
+
+  SparseSetGroup() = delete;
+  explicit SparseSetGroup(std::nullptr_t) {}
+
+  [[nodiscard]] static SparseSetGroup create(Key max_key) {
+    auto group  = SparseSetGroup(nullptr);
+    group.sets_ = std::tuple<TSets...>(TSets::create(max_key)...);
+    return group;
+  }
+
+  /**
+   * @brief Inserts the key into the set `I`, the key joins the group once it is present in all of the sets.
+   *
+   */
+  template <size_t I, typename... TArgs>
+  void insert(Key key, TArgs&&... values) {
+    std::get<I>(sets_).insert(key, std::forward<TArgs>(values)...);
+    if (contains_all(key, std::make_index_sequence<kCount>{})) {
+      move_to(key, size_, std::make_index_sequence<kCount>{});
+      ++size_;
+    }
+  }
+
+  /**
+   * @brief Removes the key from the set `I`, a key of the group is first moved out of it.
+   *
+   */
+  template <size_t I>
+  void remove(Key key) {
+    const auto index = static_cast<size_t>(std::get<I>(sets_).dense_index(key));
+    if (index < size_) {
+      --size_;
+      move_to(key, size_, std::make_index_sequence<kCount>{});
+    }
+    std::get<I>(sets_).remove(key);
+  }
+
+  template <size_t I>
+  const auto& set() const {
+    return std::get<I>(sets_);
+  }
+
+  template <size_t I, typename TValue>
+  TValue& at(Key key) {
+    return std::get<I>(sets_).template at<TValue>(key);
+  }
+
+  /**
+   * @brief Number of the keys present in all of the sets.
+   *
+   */
+  size_t size() const { return size_; }
+
+  /**
+   * @brief Keys of the group, in the order of the dense arrays.
+   *
+   */
+  std::span<const Key> keys() const { return std::get<0>(sets_).keys().first(size_); }
+
+  /**
+   * @brief Calls `func(key, values...)` for every key of the group, the values of all the sets are passed by reference
+   * in the order of the sets.
+   *
+   */
+  template <typename TFunc>
+  void each(TFunc&& func) {
+    each_impl(func, sets_, std::make_index_sequence<kCount>{});
+  }
+
+  template <typename TFunc>
+  void each(TFunc&& func) const {
+    each_impl(func, sets_, std::make_index_sequence<kCount>{});
+  }
+
+ private:
+  template <size_t... Is>
+  bool contains_all(Key key, std::index_sequence<Is...>) const {
+    return (std::get<Is>(sets_).contains_key(key) && ...);
+  }
+
+  template <size_t... Is>
+  void move_to(Key key, size_t index, std::index_sequence<Is...>) {
+    (std::get<Is>(sets_).swap_dense(static_cast<size_t>(std::get<Is>(sets_).dense_index(key)), index), ...);
+  }
+
+  template <typename TFunc, typename TTuple, size_t... Is>
+  void each_impl(TFunc& func, TTuple& sets, std::index_sequence<Is...>) const {
+    const auto keys = std::get<0>(sets).keys();
+    for (auto i = 0U; i < size_; ++i) {
+      std::apply(func, std::tuple_cat(std::tuple<Key>(keys[i]), std::get<Is>(sets).dense_values(i)...));
+    }
+  }
+
+  std::tuple<TSets...> sets_;
+  size_t size_ = 0;
+};
+
+}  // namespace eray::vkren
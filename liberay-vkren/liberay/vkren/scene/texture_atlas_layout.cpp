@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <liberay/vkren/scene/texture_atlas_layout.hpp>
+
+namespace eray::vkren {
+
+TextureAtlasLayout TextureAtlasLayout::create(const CreateInfo& info) { return TextureAtlasLayout(info); }
+
+TextureAtlasLayout::TextureAtlasLayout(const CreateInfo& info) : info_(info) {
+  info_.mip_levels = std::clamp(info_.mip_levels, 1U, 16U);
+  width_           = align(info_.width);
+  height_          = align(info_.height);
+}
+
+std::optional<AtlasRect> TextureAtlasLayout::allocate(uint32_t width, uint32_t height) {
+  if (width == 0 || height == 0) {
+    return std::nullopt;
+  }
+
+  const auto slot_width  = align(width) + 2 * padding();
+  const auto slot_height = align(height) + 2 * padding();
+  if (slot_width > width_ || slot_height > height_) {
+    return std::nullopt;
+  }
+
+  // The shelves much taller than the texture are used only when no new shelf fits
+  Shelf* best     = nullptr;
+  Shelf* fallback = nullptr;
+  for (auto& shelf : shelves_) {
+    if (shelf.height < slot_height || shelf.x + slot_width > width_) {
+      continue;
+    }
+    auto*& candidate = 2 * shelf.height <= 3 * slot_height ? best : fallback;
+    if (candidate == nullptr || shelf.height < candidate->height) {
+      candidate = &shelf;
+    }
+  }
+
+  if (best == nullptr) {
+    auto layer = std::ranges::find_if(layer_heights_, [&](uint32_t used) { return used + slot_height <= height_; });
+    if (layer == layer_heights_.end() && layer_heights_.size() < info_.max_layers) {
+      layer_heights_.push_back(0);
+      layer = layer_heights_.end() - 1;
+    }
+    if (layer != layer_heights_.end()) {
+      shelves_.push_back(Shelf{
+          .layer  = static_cast<uint32_t>(layer - layer_heights_.begin()),
+          .y      = *layer,
+          .height = slot_height,
+          .x      = 0,
+      });
+      *layer += slot_height;
+      best = &shelves_.back();
+    } else {
+      best = fallback;
+    }
+  }
+  if (best == nullptr) {
+    return std::nullopt;
+  }
+
+  const auto rect = AtlasRect{
+      .layer  = best->layer,
+      .x      = best->x + padding(),
+      .y      = best->y + padding(),
+      .width  = width,
+      .height = height,
+  };
+  best->x += slot_width;
+  ++allocation_count_;
+  used_texels_ += static_cast<uint64_t>(width) * height;
+  return rect;
+}
+
+void TextureAtlasLayout::reset() {
+  shelves_.clear();
+  layer_heights_.clear();
+  allocation_count_ = 0;
+  used_texels_      = 0;
+}
+
+math::Vec4f TextureAtlasLayout::uv_rect(const AtlasRect& rect) const {
+  const auto width  = static_cast<float>(width_);
+  const auto height = static_cast<float>(height_);
+  return math::Vec4f(static_cast<float>(rect.x) / width, static_cast<float>(rect.y) / height,
+                     static_cast<float>(rect.x + rect.width) / width,
+                     static_cast<float>(rect.y + rect.height) / height);
+}
+
+float TextureAtlasLayout::occupancy() const {
+  if (layer_heights_.empty()) {
+    return 0.F;
+  }
+  const auto layer_texels = static_cast<uint64_t>(width_) * height_;
+  return static_cast<float>(static_cast<double>(used_texels_) / static_cast<double>(layer_texels * layer_count()));
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/vec.hpp>
+#include <optional>
+#include <vector>
+
+namespace eray::vkren {
+
+/**
+ * @brief Texels of a packed texture in the atlas, without the guard border.
+ *
+ */
+struct AtlasRect {
+  uint32_t layer;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+
+  bool operator==(const AtlasRect&) const = default;
+};
+
+/**
+ * @brief Packs the rectangles of the small textures into the layers of a 2D texture array with the shelf algorithm,
+ * the CPU part of the `TextureAtlas`. A layer is cut into horizontal shelves, a texture goes to the shelf of the
+ * closest height that has room left, a new shelf is opened below the last one, then a new layer.
+ *
+ * The packing is mip-aware: every slot starts and ends at a multiple of `2^(mip_levels - 1)` texels, so a texel of any
+ * level covers the texels of a single slot, and the guard border is scaled by the same factor, so every level keeps
+ * `guard_border` texels of the extruded edge around the texture for the bilinear filtering.
+ *
+ * The textures are not removed one by one, the atlas is `reset()` and packed again.
+ *
+ */
+class TextureAtlasLayout {
+ public:
+  TextureAtlasLayout() = delete;
+  explicit TextureAtlasLayout(std::nullptr_t) {}
+
+  struct CreateInfo {
+    /**
+     * @brief Size of a layer, rounded up to the `alignment()`.
+     *
+     */
+    uint32_t width  = 2048;
+    uint32_t height = 2048;
+
+    uint32_t max_layers = 16;
+
+    /**
+     * @brief Texels of the extruded edge around every texture on the coarsest level.
+     *
+     */
+    uint32_t guard_border = 1;
+
+    /**
+     * @brief Levels the atlas is sampled with. Every level doubles the alignment and the padding, so the atlases of
+     * tiny textures should keep it low, e.g. 3 or 4.
+     *
+     */
+    uint32_t mip_levels = 1;
+  };
+
+  [[nodiscard]] static TextureAtlasLayout create(const CreateInfo& info);
+
+  /**
+   * @brief Finds the place of a `width` x `height` texture.
+   *
+   * @param width
+   * @param height
+   * @return std::optional<AtlasRect> Nullopt when the texture is larger than a layer or all of the `max_layers` are
+   * full.
+   */
+  std::optional<AtlasRect> allocate(uint32_t width, uint32_t height);
+
+  /**
+   * @brief Forgets all of the textures.
+   *
+   */
+  void reset();
+
+  /**
+   * @brief Texture coordinates of the rectangle in its layer, min (xy) and max (zw). The edges lie on the texel
+   * boundaries of the LOD0.
+   *
+   */
+  math::Vec4f uv_rect(const AtlasRect& rect) const;
+
+  uint32_t width() const { return width_; }
+  uint32_t height() const { return height_; }
+  uint32_t max_layers() const { return info_.max_layers; }
+  uint32_t mip_levels() const { return info_.mip_levels; }
+
+  /**
+   * @brief Layers that hold at least one texture.
+   *
+   */
+  uint32_t layer_count() const { return static_cast<uint32_t>(layer_heights_.size()); }
+
+  /**
+   * @brief Granularity of the slots, `2^(mip_levels - 1)` texels.
+   *
+   */
+  uint32_t alignment() const { return 1U << (info_.mip_levels - 1); }
+
+  /**
+   * @brief Texels of the LOD0 between the texture and the edge of its slot on every side.
+   *
+   */
+  uint32_t padding() const { return info_.guard_border * alignment(); }
+
+  size_t allocation_count() const { return allocation_count_; }
+
+  /**
+   * @brief Fraction of the texels of the used layers covered by the textures, without the padding.
+   *
+   */
+  float occupancy() const;
+
+ private:
+  struct Shelf {
+    uint32_t layer;
+    uint32_t y;
+    uint32_t height;
+
+    /**
+     * @brief Start of the free space at the right end of the shelf.
+     *
+     */
+    uint32_t x;
+  };
+
+  explicit TextureAtlasLayout(const CreateInfo& info);
+
+  uint32_t align(uint32_t value) const { return (value + alignment() - 1) & ~(alignment() - 1); }
+
+  CreateInfo info_;
+  uint32_t width_  = 0;
+  uint32_t height_ = 0;
+  std::vector<Shelf> shelves_;
+
+  /**
+   * @brief Height of the shelves of every used layer, the next shelf of the layer starts there.
+   *
+   */
+  std::vector<uint32_t> layer_heights_;
+
+  size_t allocation_count_ = 0;
+  uint64_t used_texels_    = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <liberay/vkren/scene/texture_residency.hpp>
+
+namespace eray::vkren {
+
+float mip_for_screen_size(uint32_t lod0_size, float screen_size, uint32_t viewport_height) {
+  const auto pixels = screen_size * static_cast<float>(viewport_height);
+  if (!(pixels > 0.F)) {
+    return std::numeric_limits<float>::infinity();
+  }
+  return std::max(std::log2(static_cast<float>(lod0_size) / pixels), 0.F);
+}
+
+TextureResidency TextureResidency::create(const CreateInfo& info) { return TextureResidency(info); }
+
+StreamedTextureId TextureResidency::add(std::span<const uint64_t> mip_size_bytes, uint32_t min_resident_mip) {
+  assert(min_resident_mip < mip_size_bytes.size() && "Minimal resident mip must be a level of the texture");
+
+  auto texture = Texture{
+      .suffix_bytes     = std::vector<uint64_t>(mip_size_bytes.size() + 1, 0),
+      .min_resident_mip = min_resident_mip,
+      .resident_mip     = min_resident_mip,
+      .target_mip       = min_resident_mip,
+      .requested_mip    = kNoRequest,
+      .wanted_mip       = min_resident_mip,
+      .last_request     = update_index_,
+      .alive            = true,
+  };
+  for (auto i = mip_size_bytes.size(); i > 0; --i) {
+    texture.suffix_bytes[i - 1] = texture.suffix_bytes[i] + mip_size_bytes[i - 1];
+  }
+  committed_bytes_ += texture.suffix_bytes[min_resident_mip];
+
+  if (!free_ids_.empty()) {
+    const auto index = free_ids_.back();
+    free_ids_.pop_back();
+    textures_[index] = std::move(texture);
+    return StreamedTextureId{index};
+  }
+
+  textures_.push_back(std::move(texture));
+  return StreamedTextureId{static_cast<uint32_t>(textures_.size() - 1)};
+}
+
+void TextureResidency::remove(StreamedTextureId id) {
+  auto& texture = textures_[id._value];
+  assert(texture.alive && "Texture has already been removed");
+
+  committed_bytes_ -= texture.suffix_bytes[texture.target_mip];
+  texture.alive = false;
+  texture.suffix_bytes.clear();
+  free_ids_.push_back(id._value);
+}
+
+void TextureResidency::request(StreamedTextureId id, uint32_t mip) {
+  auto& texture         = textures_[id._value];
+  texture.requested_mip = std::min(texture.requested_mip, mip);
+}
+
+uint64_t TextureResidency::size_bytes(StreamedTextureId id, uint32_t first_mip) const {
+  return textures_[id._value].suffix_bytes[first_mip];
+}
+
+void TextureResidency::complete(StreamedTextureId id) {
+  auto& texture        = textures_[id._value];
+  texture.resident_mip = texture.target_mip;
+}
+
+void TextureResidency::cancel(StreamedTextureId id) {
+  auto& texture     = textures_[id._value];
+  committed_bytes_ += texture.suffix_bytes[texture.resident_mip];
+  committed_bytes_ -= texture.suffix_bytes[texture.target_mip];
+  texture.target_mip = texture.resident_mip;
+}
+
+void TextureResidency::change(uint32_t index, uint32_t first_mip) {
+  auto& texture     = textures_[index];
+  committed_bytes_ += texture.suffix_bytes[first_mip];
+  committed_bytes_ -= texture.suffix_bytes[texture.target_mip];
+  texture.target_mip = first_mip;
+  changes_.push_back(ResidencyChange{.id = StreamedTextureId{index}, .first_mip = first_mip});
+}
+
+std::span<const ResidencyChange> TextureResidency::update(bool memory_pressure) {
+  ++update_index_;
+  changes_.clear();
+
+  for (auto& texture : textures_) {
+    if (!texture.alive) {
+      continue;
+    }
+    if (texture.requested_mip != kNoRequest) {
+      texture.wanted_mip    = std::min(texture.requested_mip, texture.min_resident_mip);
+      texture.last_request  = update_index_;
+      texture.requested_mip = kNoRequest;
+    } else if (update_index_ - texture.last_request > info_.request_lifetime) {
+      texture.wanted_mip = texture.min_resident_mip;
+    }
+  }
+
+  auto is_idle = [](const Texture& texture) {
+    return texture.alive && texture.resident_mip == texture.target_mip;
+  };
+
+  // == Evict the levels that are not requested anymore, the least recently requested first ==========================
+  candidates_.clear();
+  for (auto i = 0U; i < textures_.size(); ++i) {
+    if (is_idle(textures_[i]) && textures_[i].target_mip < textures_[i].wanted_mip) {
+      candidates_.push_back(i);
+    }
+  }
+  std::ranges::sort(candidates_, {}, [this](uint32_t i) { return textures_[i].last_request; });
+  for (const auto i : candidates_) {
+    if (!memory_pressure && committed_bytes_ <= info_.budget_bytes) {
+      break;
+    }
+    change(i, textures_[i].wanted_mip);
+  }
+
+  if (memory_pressure) {
+    return changes_;
+  }
+
+  // == Load the requested levels, the textures missing the most levels first =========================================
+  candidates_.clear();
+  for (auto i = 0U; i < textures_.size(); ++i) {
+    if (is_idle(textures_[i]) && textures_[i].wanted_mip < textures_[i].target_mip) {
+      candidates_.push_back(i);
+    }
+  }
+  std::ranges::sort(candidates_, [this](uint32_t lhs, uint32_t rhs) {
+    const auto& a = textures_[lhs];
+    const auto& b = textures_[rhs];
+    if (a.target_mip - a.wanted_mip != b.target_mip - b.wanted_mip) {
+      return a.target_mip - a.wanted_mip > b.target_mip - b.wanted_mip;
+    }
+    return a.last_request > b.last_request;
+  });
+
+  auto uploaded_bytes = uint64_t{0};
+  for (const auto i : candidates_) {
+    const auto& texture = textures_[i];
+
+    // Loads the finest of the requested levels that fit the budget
+    auto first_mip = texture.wanted_mip;
+    while (first_mip < texture.target_mip &&
+           committed_bytes_ + texture.suffix_bytes[first_mip] - texture.suffix_bytes[texture.target_mip] >
+               info_.budget_bytes) {
+      ++first_mip;
+    }
+    if (first_mip == texture.target_mip) {
+      continue;
+    }
+
+    // A change uploads all of the new levels, the image is replaced
+    const auto upload_bytes = texture.suffix_bytes[first_mip];
+    if (uploaded_bytes > 0 && uploaded_bytes + upload_bytes > info_.max_upload_bytes_per_update) {
+      break;
+    }
+    uploaded_bytes += upload_bytes;
+    change(i, first_mip);
+  }
+
+  return changes_;
+}
+
+}  // namespace eray::vkren
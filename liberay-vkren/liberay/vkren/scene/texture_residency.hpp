@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace eray::vkren {
+
+struct StreamedTextureId {
+  uint32_t _value;
+
+  bool operator==(const StreamedTextureId&) const = default;
+};
+
+/**
+ * @brief Mip level whose texels match the pixels of the screen, for a texture `lod0_size` texels wide mapped once
+ * across `screen_size` of the viewport height (see `projected_screen_size()`).
+ *
+ * @param lod0_size Larger dimension of the LOD0.
+ * @param screen_size
+ * @param viewport_height In pixels.
+ * @return float Not negative, infinite when the texture does not cover the screen.
+ */
+float mip_for_screen_size(uint32_t lod0_size, float screen_size, uint32_t viewport_height);
+
+/**
+ * @brief New first resident mip level of a streamed texture.
+ *
+ */
+struct ResidencyChange {
+  StreamedTextureId id;
+  uint32_t first_mip;
+};
+
+/**
+ * @brief Decides which mip levels of the streamed textures should be resident, the CPU policy of the
+ * `TextureStreamer`. A texture always keeps its tail (the levels from its `min_resident_mip`), the finer levels are
+ * loaded when requested and dropped in the least recently requested order once the textures exceed the budget.
+ *
+ * The resident levels of a texture are always a suffix of its mip chain, so a change replaces the texture image. The
+ * textures with a pending change are left alone until it is `complete()`.
+ *
+ */
+class TextureResidency {
+ public:
+  TextureResidency() = delete;
+  explicit TextureResidency(std::nullptr_t) {}
+
+  static constexpr uint32_t kNoRequest = UINT32_MAX;
+
+  struct CreateInfo {
+    /**
+     * @brief Memory of all of the resident levels (including the pending changes) the upgrades must fit in.
+     *
+     */
+    uint64_t budget_bytes = 512ULL * 1024 * 1024;
+
+    /**
+     * @brief Bytes uploaded by the upgrades of a single `update()`. A larger upgrade is still started if it is the
+     * first one.
+     *
+     */
+    uint64_t max_upload_bytes_per_update = 32ULL * 1024 * 1024;
+
+    /**
+     * @brief Number of the updates a request is remembered for. Afterwards the finer levels of the texture may be
+     * evicted.
+     *
+     */
+    uint32_t request_lifetime = 120;
+  };
+
+  [[nodiscard]] static TextureResidency create(const CreateInfo& info);
+
+  /**
+   * @brief Adds a texture with the levels from `min_resident_mip` resident.
+   *
+   * @param mip_size_bytes Size of every level, from the LOD0.
+   * @param min_resident_mip Must be a valid level.
+   * @return StreamedTextureId
+   */
+  StreamedTextureId add(std::span<const uint64_t> mip_size_bytes, uint32_t min_resident_mip);
+
+  void remove(StreamedTextureId id);
+
+  /**
+   * @brief Requests the level `mip` and the coarser ones, e.g. from the screen space feedback or
+   * `mip_for_screen_size()`. The finest level requested before an `update()` wins.
+   *
+   */
+  void request(StreamedTextureId id, uint32_t mip);
+
+  /**
+   * @brief Returns the changes to apply. The evictions come first, they are the least recently requested levels that
+   * are not requested anymore. Without the `memory_pressure` they are only made to fit the budget, with it every such
+   * level is dropped and nothing is loaded.
+   *
+   * @param memory_pressure E.g. `VmaAllocationManager::is_near_budget()`.
+   * @return std::span<const ResidencyChange> Valid until the next call.
+   */
+  std::span<const ResidencyChange> update(bool memory_pressure = false);
+
+  /**
+   * @brief Marks the pending change of the texture as applied.
+   *
+   */
+  void complete(StreamedTextureId id);
+
+  /**
+   * @brief Drops the pending change of the texture, e.g. when it could not be applied. It may be made again by a later
+   * `update()`.
+   *
+   */
+  void cancel(StreamedTextureId id);
+
+  uint32_t resident_mip(StreamedTextureId id) const { return textures_[id._value].resident_mip; }
+  uint32_t target_mip(StreamedTextureId id) const { return textures_[id._value].target_mip; }
+  uint32_t min_resident_mip(StreamedTextureId id) const { return textures_[id._value].min_resident_mip; }
+  bool is_pending(StreamedTextureId id) const {
+    return textures_[id._value].resident_mip != textures_[id._value].target_mip;
+  }
+
+  /**
+   * @brief Size of the levels from `first_mip`.
+   *
+   */
+  uint64_t size_bytes(StreamedTextureId id, uint32_t first_mip) const;
+
+  /**
+   * @brief Memory of the target levels of all of the textures.
+   *
+   */
+  uint64_t committed_bytes() const { return committed_bytes_; }
+  uint64_t budget_bytes() const { return info_.budget_bytes; }
+
+ private:
+  struct Texture {
+    /**
+     * @brief `suffix_bytes[i]` is the size of the levels from `i`, the last entry is 0.
+     *
+     */
+    std::vector<uint64_t> suffix_bytes;
+    uint32_t min_resident_mip;
+    uint32_t resident_mip;
+    uint32_t target_mip;
+    uint32_t requested_mip;
+    uint32_t wanted_mip;
+    uint64_t last_request;
+    bool alive;
+  };
+
+  explicit TextureResidency(const CreateInfo& info) : info_(info) {}
+
+  void change(uint32_t index, uint32_t first_mip);
+
+  CreateInfo info_;
+  std::vector<Texture> textures_;
+  std::vector<uint32_t> free_ids_;
+  std::vector<ResidencyChange> changes_;
+  std::vector<uint32_t> candidates_;
+  uint64_t committed_bytes_ = 0;
+  uint64_t update_index_    = 0;
+};
+
+}  // namespace eray::vkren
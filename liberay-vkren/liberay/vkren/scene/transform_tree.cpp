@@ -1,34 +1,151 @@
 #include <algorithm>
+#include <array>
+#include <cassert>
 #include <liberay/math/mat.hpp>
 #include <liberay/math/quat.hpp>
 #include <liberay/math/vec_fwd.hpp>
+#include <liberay/util/job_system.hpp>
+#include <liberay/util/profiler.hpp>
 #include <liberay/vkren/scene/flat_tree.hpp>
 #include <liberay/vkren/scene/transform_tree.hpp>
+#include <ranges>
 #include <utility>
 
 namespace eray::vkren {
 
-TransformTree TransformTree::create(size_t max_nodes_count) {
+namespace {
+
+/**
+ * @brief Components of a batch of the local transforms, one lane per node.
+ *
+ */
+template <size_t N>
+struct TransformLanes {
+  std::array<float, N> px, py, pz;
+  std::array<float, N> qw, qx, qy, qz;
+  std::array<float, N> sx, sy, sz;
+};
+
+/**
+ * @brief Builds `T * R * S` of every lane from the closed form of the rotation matrix of a unit quaternion. The lanes
+ * are independent and the loops have a constant trip count, which lets the compiler vectorize them.
+ *
+ */
+template <size_t N>
+void compose_trs(const TransformLanes<N>& in, std::array<math::Mat4f, N>& mats) {
+  // Rotation matrix, r<col><row>
+  std::array<float, N> r00, r01, r02, r10, r11, r12, r20, r21, r22;
+  for (auto l = size_t{0}; l < N; ++l) {
+    const auto xx = in.qx[l] * in.qx[l];
+    const auto yy = in.qy[l] * in.qy[l];
+    const auto zz = in.qz[l] * in.qz[l];
+    const auto xy = in.qx[l] * in.qy[l];
+    const auto xz = in.qx[l] * in.qz[l];
+    const auto yz = in.qy[l] * in.qz[l];
+    const auto wx = in.qw[l] * in.qx[l];
+    const auto wy = in.qw[l] * in.qy[l];
+    const auto wz = in.qw[l] * in.qz[l];
+
+    r00[l] = 1.F - 2.F * (yy + zz);
+    r01[l] = 2.F * (xy + wz);
+    r02[l] = 2.F * (xz - wy);
+    r10[l] = 2.F * (xy - wz);
+    r11[l] = 1.F - 2.F * (xx + zz);
+    r12[l] = 2.F * (yz + wx);
+    r20[l] = 2.F * (xz + wy);
+    r21[l] = 2.F * (yz - wx);
+    r22[l] = 1.F - 2.F * (xx + yy);
+  }
+
+  // T * R * S: the rotation columns scaled by the scale components, the translation in the last column
+  for (auto l = size_t{0}; l < N; ++l) {
+    auto& m = mats[l];
+    m[0]    = math::Vec4f(r00[l] * in.sx[l], r01[l] * in.sx[l], r02[l] * in.sx[l], 0.F);
+    m[1]    = math::Vec4f(r10[l] * in.sy[l], r11[l] * in.sy[l], r12[l] * in.sy[l], 0.F);
+    m[2]    = math::Vec4f(r20[l] * in.sz[l], r21[l] * in.sz[l], r22[l] * in.sz[l], 0.F);
+    m[3]    = math::Vec4f(in.px[l], in.py[l], in.pz[l], 1.F);
+  }
+}
+
+/**
+ * @brief Squared scale below which an axis is treated as degenerate by `inverse_trs()`.
+ *
+ */
+constexpr float kMinSquaredScale = 1e-12F;
+
+/**
+ * @brief Inverse `S^-1 * R^T * T^-1` of a `T * R * S` matrix. The columns of its linear part are the rotation columns
+ * scaled by the scale, so the rows of the inverse are the same columns divided by their squared lengths and the
+ * translation is `-(S^-1 * R^T * t)`.
+ *
+ */
+math::Mat4f inverse_trs(const math::Mat4f& m) {
+  auto inv = math::Mat4f::identity();
+  for (auto i = 0U; i < 3; ++i) {
+    const auto column = math::Vec3f(m[i][0], m[i][1], m[i][2]);
+    const auto row    = column / std::max(math::dot(column, column), kMinSquaredScale);
+    inv[0][i]         = row.x();
+    inv[1][i]         = row.y();
+    inv[2][i]         = row.z();
+    inv[3][i]         = -(row.x() * m[3][0] + row.y() * m[3][1] + row.z() * m[3][2]);
+  }
+  return inv;
+}
+
+}  // namespace
+
+TransformTree TransformTree::create(size_t max_nodes_count, InverseWorldMatrices inverse_world_matrices) {
   auto transform_tree  = TransformTree();
   transform_tree.tree_ = FlatTree::create(max_nodes_count);
-  transform_tree.local_transforms_.resize(max_nodes_count, Transform{
-                                                               .position = math::Vec3f::filled(0.F),
-                                                               .rotation = math::Quatf::one(),
-                                                               .scale    = math::Vec3f::filled(1.F),
-                                                           });
-  transform_tree.world_transforms_.resize(max_nodes_count, Transform{
-                                                               .position = math::Vec3f::filled(0.F),
-                                                               .rotation = math::Quatf::one(),
-                                                               .scale    = math::Vec3f::filled(1.F),
-                                                           });
-
-  transform_tree.local_model_mats_.resize(max_nodes_count, math::Mat4f::identity());
-  transform_tree.world_model_mats_.resize(max_nodes_count, math::Mat4f::identity());
-  transform_tree.local_model_inv_mats_.resize(max_nodes_count, math::Mat4f::identity());
-  transform_tree.world_model_inv_mats_.resize(max_nodes_count, math::Mat4f::identity());
-
-  transform_tree.name_.resize(max_nodes_count);
-  transform_tree.nodes_created_count_ = 0;
+  transform_tree.allocate_node_arrays(max_nodes_count, inverse_world_matrices);
+
+  return transform_tree;
+}
+
+void TransformTree::allocate_node_arrays(size_t max_nodes_count, InverseWorldMatrices inverse_world_matrices) {
+  inverse_world_matrices_ = inverse_world_matrices;
+  local_positions_.resize(max_nodes_count, math::Vec3f::filled(0.F));
+  local_rotations_.resize(max_nodes_count, math::Quatf::one());
+  local_scales_.resize(max_nodes_count, math::Vec3f::filled(1.F));
+  world_transforms_.resize(max_nodes_count, Transform{
+                                                .position = math::Vec3f::filled(0.F),
+                                                .rotation = math::Quatf::one(),
+                                                .scale    = math::Vec3f::filled(1.F),
+                                            });
+
+  local_model_mats_.resize(max_nodes_count, math::Mat4f::identity());
+  world_model_mats_.resize(max_nodes_count, math::Mat4f::identity());
+  if (inverse_world_matrices == InverseWorldMatrices::Cached) {
+    world_model_inv_mats_.resize(max_nodes_count, math::Mat4f::identity());
+    world_inv_update_.resize(max_nodes_count, 0);
+  }
+
+  name_.resize(max_nodes_count);
+  dirty_.resize(max_nodes_count, false);
+  world_change_update_.resize(max_nodes_count, 0);
+  bucketed_in_update_.resize(max_nodes_count, 0);
+  nodes_created_count_ = 0;
+}
+
+TransformTree TransformTree::create(FlatTree&& tree, std::span<const math::Vec3f> positions,
+                                    std::span<const math::Quatf> rotations, std::span<const math::Vec3f> scales,
+                                    InverseWorldMatrices inverse_world_matrices) {
+  const auto node_count = tree.node_count();
+  assert(positions.size() == node_count && rotations.size() == node_count && scales.size() == node_count &&
+         "Expected a local transform per node");
+
+  auto transform_tree = TransformTree();
+  transform_tree.allocate_node_arrays(tree.max_nodes_count(), inverse_world_matrices);
+  transform_tree.tree_ = std::move(tree);
+  std::ranges::copy(positions, transform_tree.local_positions_.begin());
+  std::ranges::copy(rotations, transform_tree.local_rotations_.begin());
+  std::ranges::copy(scales, transform_tree.local_scales_.begin());
+
+  // The root has no parent to compose its matrices with, it is never dirty
+  for (auto node : transform_tree.tree_.nodes_dfs_preorder() | std::views::drop(1)) {
+    transform_tree.mark_dirty(node);
+  }
+  transform_tree.nodes_created_count_ = node_count - 1;
 
   return transform_tree;
 }
@@ -37,11 +154,11 @@ NodeId TransformTree::create_node(NodeId parent_id) {
   auto node_id = tree_.create_node(parent_id);
   auto index   = FlatTree::index_of(node_id);
 
-  local_transforms_[index].position = math::Vec3f(0.F, 0.F, 0.F);
-  local_transforms_[index].rotation = math::Quatf();
-  local_transforms_[index].scale    = math::Vec3f(1.F, 1.F, 1.F);
+  local_positions_[index] = math::Vec3f(0.F, 0.F, 0.F);
+  local_rotations_[index] = math::Quatf();
+  local_scales_[index]    = math::Vec3f(1.F, 1.F, 1.F);
 
-  dirty_nodes_.insert(node_id);
+  mark_dirty(node_id);
   name_[index] = std::format("Node {}", ++nodes_created_count_);
 
   return node_id;
@@ -51,27 +168,38 @@ uint32_t TransformTree::node_level(NodeId node_id) const { return tree_.node_lev
 
 void TransformTree::copy_node(NodeId node_id, NodeId parent_id) {
   auto new_node_id = tree_.copy_node(node_id, parent_id);
-  dirty_nodes_.insert(new_node_id);
+  mark_dirty(new_node_id);
 }
 
-void TransformTree::delete_node(NodeId node_id) { tree_.delete_node(node_id); }
+void TransformTree::delete_node(NodeId node_id) {
+  // The indices are reused by the new nodes, which must be able to raise their dirty flags
+  for (auto descendant : FlatTreeDFSRange(&tree_, node_id)) {
+    dirty_[FlatTree::index_of(descendant)] = false;
+  }
+  tree_.delete_node(node_id);
+}
 
 void TransformTree::change_parent(NodeId node_id, NodeId parent_id) {
   tree_.change_parent(node_id, parent_id);
-  dirty_nodes_.insert(node_id);
+  mark_dirty(node_id);
 }
 
 void TransformTree::make_orphan(NodeId node_id) {
   tree_.make_orphan(node_id);
-  dirty_nodes_.insert(node_id);
+  mark_dirty(node_id);
 }
 
 const std::vector<NodeId>& TransformTree::nodes_bfs_order() const { return tree_.nodes_bfs_order(); }
 
 const std::vector<NodeId>& TransformTree::nodes_dfs_preorder() const { return tree_.nodes_dfs_preorder(); }
 
-const Transform& TransformTree::local_transform(NodeId node_id) {
-  return local_transforms_[FlatTree::index_of(node_id)];
+Transform TransformTree::local_transform(NodeId node_id) const {
+  const auto index = FlatTree::index_of(node_id);
+  return Transform{
+      .position = local_positions_[index],
+      .rotation = local_rotations_[index],
+      .scale    = local_scales_[index],
+  };
 }
 
 const Transform& TransformTree::world_transform(NodeId node_id) {
@@ -79,84 +207,258 @@ const Transform& TransformTree::world_transform(NodeId node_id) {
 }
 
 void TransformTree::set_local_transform(NodeId node_id, Transform transform) {
-  local_transforms_[FlatTree::index_of(node_id)] = std::move(transform);
-  dirty_nodes_.insert(node_id);
+  const auto index         = FlatTree::index_of(node_id);
+  local_positions_[index] = transform.position;
+  local_rotations_[index] = transform.rotation;
+  local_scales_[index]    = transform.scale;
+  mark_dirty(node_id);
 }
 
 void TransformTree::set_name(NodeId node_id, std::string name) { name_[FlatTree::index_of(node_id)] = std::move(name); }
 
 void TransformTree::update() {
+  ERAY_PROFILE_FUNCTION();
+
+  begin_world_changes();
+  collect_dirty_nodes();
+
   // Update local model matrices
-  for (auto node : dirty_nodes_) {
-    auto index        = FlatTree::index_of(node);
-    const auto& trans = local_transforms_[index];
-    local_model_mats_[index] =
-        math::translation(trans.position) * math::rot_mat_from_quat(trans.rotation) * math::scale(trans.scale);
-    local_model_inv_mats_[index] = math::scale(1.F / (trans.scale + 0.000001F)) *
-                                   math::rot_mat_from_quat(math::conjugate(trans.rotation)) *
-                                   math::translation(-trans.position);
+  for (auto first = size_t{0}; first < dirty_nodes_helper_.size(); first += kLocalMatricesBatchSize) {
+    update_local_matrices(first, std::min(kLocalMatricesBatchSize, dirty_nodes_helper_.size() - first));
   }
 
-  // Sort dirty nodes by their level
-  dirty_nodes_helper_.clear();
-  if (dirty_nodes_helper_.capacity() < dirty_nodes_.size()) {
-    dirty_nodes_helper_.reserve(dirty_nodes_.size());
+  // Update world model matrices, the dirty descendants of a dirty node are updated with it
+  for (auto node : dirty_nodes_helper_) {
+    if (!dirty_[FlatTree::index_of(node)]) {
+      continue;
+    }
+
+    for (auto descendant : FlatTreeDFSRange(&tree_, node)) {
+      dirty_[FlatTree::index_of(descendant)] = false;
+      update_world_matrices(descendant);
+      record_world_change(FlatTree::index_of(descendant));
+    }
+  }
+}
+
+void TransformTree::update(util::JobSystem& jobs, size_t grain) {
+  ERAY_PROFILE_FUNCTION();
+
+  begin_world_changes();
+  collect_dirty_nodes();
+  for (auto node : dirty_nodes_helper_) {
+    dirty_[FlatTree::index_of(node)] = false;
+  }
+  if (dirty_nodes_helper_.empty()) {
+    return;
   }
-  std::ranges::copy(dirty_nodes_, std::back_inserter(dirty_nodes_helper_));
-  std::ranges::sort(dirty_nodes_helper_,
-                    [this](auto n1, auto n2) { return tree_.node_level(n1) > tree_.node_level(n2); });
 
-  // Update world model matrices
+  // Update local model matrices
+  const auto batch_count = (dirty_nodes_helper_.size() + kLocalMatricesBatchSize - 1) / kLocalMatricesBatchSize;
+  jobs.parallel_for(
+      0, batch_count,
+      [this](size_t batch) {
+        const auto first = batch * kLocalMatricesBatchSize;
+        update_local_matrices(first, std::min(kLocalMatricesBatchSize, dirty_nodes_helper_.size() - first));
+      },
+      std::max<size_t>(grain / kLocalMatricesBatchSize, 1));
+
+  // Bucket the dirty nodes by their level, the descendants are added to the buckets while the levels are processed
+  ++parallel_update_count_;
+  for (auto& bucket : level_buckets_) {
+    bucket.clear();
+  }
+  const auto add_to_bucket = [this](NodeId node, uint32_t level) {
+    auto& bucketed = bucketed_in_update_[FlatTree::index_of(node)];
+    if (bucketed == parallel_update_count_) {
+      return;
+    }
+    bucketed = parallel_update_count_;
+    if (level_buckets_.size() <= level) {
+      level_buckets_.resize(level + 1);
+    }
+    level_buckets_[level].push_back(node);
+  };
   for (auto node : dirty_nodes_helper_) {
-    if (!dirty_nodes_.contains(node)) {
+    add_to_bucket(node, tree_.node_level(node));
+  }
+
+  // Update world model matrices, the parents are final once their level is processed
+  for (auto level = size_t{0}; level < level_buckets_.size(); ++level) {
+    const auto& bucket = level_buckets_[level];
+    if (bucket.empty()) {
       continue;
     }
 
-    for (auto descendant : FlatTreeBFSRange(&tree_, node)) {
-      if (auto descendant_it = dirty_nodes_.find(descendant); descendant_it != dirty_nodes_.end()) {
-        dirty_nodes_.erase(descendant_it);
+    jobs.parallel_for(0, bucket.size(), [this, &bucket](size_t i) { update_world_matrices(bucket[i]); }, grain);
+
+    for (auto i = size_t{0}; i < level_buckets_[level].size(); ++i) {
+      record_world_change(FlatTree::index_of(level_buckets_[level][i]));
+      tree_.for_each_child(level_buckets_[level][i], [&add_to_bucket, level](NodeId child) {
+        add_to_bucket(child, static_cast<uint32_t>(level + 1));
+      });
+    }
+  }
+}
+
+bool TransformTree::world_matrices_changed_since(uint64_t update, std::vector<uint32_t>& indices) const {
+  if (update >= update_count_) {
+    return true;
+  }
+  if (update_count_ - update > kWorldChangesHistory) {
+    return false;
+  }
+
+  // An index is reported by the last update that wrote it only
+  for (auto u = update + 1; u <= update_count_; ++u) {
+    for (auto index : world_changes_[u % kWorldChangesHistory]) {
+      if (world_change_update_[index] == u) {
+        indices.push_back(index);
       }
-      auto descendant_index = FlatTree::index_of(descendant);
-      auto parent_index     = FlatTree::index_of(tree_.parent_of(descendant));
+    }
+  }
+  return true;
+}
 
-      world_model_mats_[descendant_index] = world_model_mats_[parent_index] * local_model_mats_[descendant_index];
-      world_model_inv_mats_[descendant_index] =
-          local_model_inv_mats_[descendant_index] * world_model_inv_mats_[parent_index];
+void TransformTree::begin_world_changes() {
+  ++update_count_;
+  world_changes_[update_count_ % kWorldChangesHistory].clear();
+}
+
+void TransformTree::record_world_change(size_t index) {
+  if (world_change_update_[index] == update_count_) {
+    return;
+  }
+  world_change_update_[index] = update_count_;
+  world_changes_[update_count_ % kWorldChangesHistory].push_back(static_cast<uint32_t>(index));
+}
+
+void TransformTree::mark_dirty(NodeId node_id) {
+  const auto index = FlatTree::index_of(node_id);
+  if (dirty_[index]) {
+    return;
+  }
+  dirty_[index] = true;
+
+  const auto level = tree_.node_level(node_id);
+  if (dirty_level_buckets_.size() <= level) {
+    dirty_level_buckets_.resize(level + 1);
+  }
+  dirty_level_buckets_[level].push_back(node_id);
+}
+
+void TransformTree::collect_dirty_nodes() {
+  dirty_nodes_helper_.clear();
+  for (auto& bucket : dirty_level_buckets_) {
+    for (auto node : bucket) {
+      if (tree_.exists(node) && dirty_[FlatTree::index_of(node)]) {
+        dirty_nodes_helper_.push_back(node);
+      }
     }
+    bucket.clear();
+  }
+}
+
+void TransformTree::update_local_matrices(size_t first, size_t count) {
+  constexpr auto kN = kLocalMatricesBatchSize;
+
+  // Gather the components, the unused lanes repeat the last node
+  auto indices = std::array<size_t, kN>();
+  auto lanes   = TransformLanes<kN>();
+  for (auto l = size_t{0}; l < kN; ++l) {
+    indices[l]        = FlatTree::index_of(dirty_nodes_helper_[first + std::min(l, count - 1)]);
+    const auto& pos   = local_positions_[indices[l]];
+    const auto& rot   = local_rotations_[indices[l]];
+    const auto& scale = local_scales_[indices[l]];
+    lanes.px[l]       = pos.x();
+    lanes.py[l]       = pos.y();
+    lanes.pz[l]       = pos.z();
+    lanes.qw[l]       = rot.w;
+    lanes.qx[l]       = rot.x;
+    lanes.qy[l]       = rot.y;
+    lanes.qz[l]       = rot.z;
+    lanes.sx[l]       = scale.x();
+    lanes.sy[l]       = scale.y();
+    lanes.sz[l]       = scale.z();
+  }
+
+  auto mats = std::array<math::Mat4f, kN>();
+  compose_trs(lanes, mats);
+
+  for (auto l = size_t{0}; l < count; ++l) {
+    local_model_mats_[indices[l]] = mats[l];
   }
+}
 
-  dirty_nodes_.clear();
+void TransformTree::update_world_matrices(NodeId node_id) {
+  auto index        = FlatTree::index_of(node_id);
+  auto parent_index = FlatTree::index_of(tree_.parent_of(node_id));
+
+  world_model_mats_[index] = world_model_mats_[parent_index] * local_model_mats_[index];
 }
 
 void TransformTree::set_local_position(NodeId node_id, math::Vec3f position) {
-  local_transforms_[FlatTree::index_of(node_id)].position = std::move(position);
-  dirty_nodes_.insert(node_id);
+  local_positions_[FlatTree::index_of(node_id)] = std::move(position);
+  mark_dirty(node_id);
 }
 
 void TransformTree::set_local_rotation(NodeId node_id, math::Quatf rotation) {
-  local_transforms_[FlatTree::index_of(node_id)].rotation = std::move(rotation);
-  dirty_nodes_.insert(node_id);
+  local_rotations_[FlatTree::index_of(node_id)] = std::move(rotation);
+  mark_dirty(node_id);
 }
 
 void TransformTree::set_local_scale(NodeId node_id, math::Vec3f scale) {
-  local_transforms_[FlatTree::index_of(node_id)].scale = std::move(scale);
-  dirty_nodes_.insert(node_id);
+  local_scales_[FlatTree::index_of(node_id)] = std::move(scale);
+  mark_dirty(node_id);
 }
 
 const math::Mat4f& TransformTree::local_to_parent_matrix(NodeId node_id) {
   return local_model_mats_[FlatTree::index_of(node_id)];
 }
 
-const math::Mat4f& TransformTree::parent_to_local_matrix(NodeId node_id) {
-  return local_model_inv_mats_[FlatTree::index_of(node_id)];
+math::Mat4f TransformTree::parent_to_local_matrix(NodeId node_id) const {
+  return inverse_trs(local_model_mats_[FlatTree::index_of(node_id)]);
 }
 
 const math::Mat4f& TransformTree::local_to_world_matrix(NodeId node_id) {
   return world_model_mats_[FlatTree::index_of(node_id)];
 }
 
-const math::Mat4f& TransformTree::world_to_local_matrix(NodeId node_id) {
-  return world_model_inv_mats_[FlatTree::index_of(node_id)];
+math::Mat4f TransformTree::world_to_local_matrix(NodeId node_id) {
+  if (inverse_world_matrices_ == InverseWorldMatrices::Cached) {
+    return refresh_world_to_local(node_id);
+  }
+
+  // The world matrix is the product of the local matrices from the top ancestor down, its inverse applies the inverse
+  // local matrices from the node up
+  auto result = math::Mat4f::identity();
+  for (auto node = node_id; node != FlatTree::kRootNodeId; node = tree_.parent_of(node)) {
+    result = result * parent_to_local_matrix(node);
+  }
+  return result;
+}
+
+const std::vector<math::Mat4f>& TransformTree::world_to_local_matrices() {
+  ERAY_PROFILE_FUNCTION();
+  assert(inverse_world_matrices_ == InverseWorldMatrices::Cached && "The inverse world matrices are not stored");
+
+  // The parents precede their children, so every stale matrix is refreshed from an up to date parent
+  for (auto node : tree_.nodes_bfs_order()) {
+    refresh_world_to_local(node);
+  }
+  return world_model_inv_mats_;
+}
+
+const math::Mat4f& TransformTree::refresh_world_to_local(NodeId node_id) {
+  const auto index = FlatTree::index_of(node_id);
+  if (node_id == FlatTree::kRootNodeId || world_inv_update_[index] >= world_change_update_[index]) {
+    return world_model_inv_mats_[index];
+  }
+
+  const auto& parent_inv       = refresh_world_to_local(tree_.parent_of(node_id));
+  world_model_inv_mats_[index] = parent_to_local_matrix(node_id) * parent_inv;
+  world_inv_update_[index]     = update_count_;
+  return world_model_inv_mats_[index];
 }
 
 bool TransformTree::exists(NodeId node_id) const { return tree_.exists(node_id); }
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <liberay/math/mat_fwd.hpp>
 #include <liberay/math/quat.hpp>
 #include <liberay/math/vec_fwd.hpp>
 #include <liberay/vkren/scene/entity_pool.hpp>
 #include <liberay/vkren/scene/flat_tree.hpp>
-#include <unordered_set>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace eray::util {
+class JobSystem;
+}
 
 namespace eray::vkren {
 
@@ -16,10 +24,48 @@ struct Transform {
   math::Vec3f scale{1.F, 1.F, 1.F};
 };
 
+/**
+ * @brief Storage of the inverse world matrices (`TransformTree::world_to_local_matrix()`), which the update does not
+ * compute.
+ *
+ */
+enum class InverseWorldMatrices : uint8_t {
+  /**
+   * @brief Computed on demand and kept until the world matrix of the node changes.
+   *
+   */
+  Cached,
+
+  /**
+   * @brief Not stored at all, every query composes the inverse local matrices of the node and its ancestors. Saves
+   * 72 bytes per node.
+   *
+   */
+  None,
+};
+
 class TransformTree {
  public:
   explicit TransformTree(std::nullptr_t) {}
-  [[nodiscard]] static TransformTree create(size_t max_nodes_count);
+  [[nodiscard]] static TransformTree create(size_t max_nodes_count,
+                                            InverseWorldMatrices inverse_world_matrices = InverseWorldMatrices::Cached);
+
+  /**
+   * @brief Creates the transform tree of the `tree` nodes, e.g. read from a `SceneSnapshot`. The local transforms are
+   * indexed by the node index and copied at once. Every node is dirty, the first `update()` computes all of the
+   * matrices.
+   *
+   * @param tree
+   * @param positions
+   * @param rotations
+   * @param scales
+   * @param inverse_world_matrices
+   * @return TransformTree
+   */
+  [[nodiscard]] static TransformTree create(FlatTree&& tree, std::span<const math::Vec3f> positions,
+                                            std::span<const math::Quatf> rotations,
+                                            std::span<const math::Vec3f> scales,
+                                            InverseWorldMatrices inverse_world_matrices = InverseWorldMatrices::Cached);
 
   [[nodiscard]] NodeId create_node(NodeId parent_id);
   [[nodiscard]] NodeId create_node() { return create_node(FlatTree::kRootNodeId); }
@@ -76,12 +122,15 @@ class TransformTree {
   std::optional<NodeId> left_sibling_of(NodeId node_id) const;
   std::optional<NodeId> right_sibling_of(NodeId node_id) const;
 
+  const FlatTree& flat_tree() const { return tree_; }
+  size_t max_nodes_count() const { return tree_.max_nodes_count(); }
+
   /**
    * @brief Returns local transform of the node. This function does not call `update()` implicitly.
    *
    * @return Transform
    */
-  const Transform& local_transform(NodeId node_id);
+  Transform local_transform(NodeId node_id) const;
 
   /**
    * @brief Returns world transform of the node. This function does not call `update()` implicitly.
@@ -98,11 +147,11 @@ class TransformTree {
   const math::Mat4f& local_to_parent_matrix(NodeId node_id);
 
   /**
-   * @brief Returns inverse of the model matrix of the node.
+   * @brief Returns inverse of the model matrix of the node, computed from the model matrix on each call.
    *
    * @return math::Mat4f
    */
-  const math::Mat4f& parent_to_local_matrix(NodeId node_id);
+  math::Mat4f parent_to_local_matrix(NodeId node_id) const;
 
   /**
    * @brief Returns global matrix of the node. This function does not call `update()` implicitly.
@@ -112,11 +161,13 @@ class TransformTree {
   const math::Mat4f& local_to_world_matrix(NodeId node_id);
 
   /**
-   * @brief Returns inverse of the `local_to_world_matrix`.
+   * @brief Returns inverse of the `local_to_world_matrix`. Computed on demand, with `InverseWorldMatrices::Cached` the
+   * stale inverses of the node and its ancestors are refreshed and kept. This function does not call `update()`
+   * implicitly.
    *
    * @return math::Mat4f
    */
-  const math::Mat4f& world_to_local_matrix(NodeId node_id);
+  math::Mat4f world_to_local_matrix(NodeId node_id);
 
   /**
    * @brief Returns all current global transformation matrices. This function does not call `update()` implicitly.
@@ -124,9 +175,41 @@ class TransformTree {
    *
    * @return const std::vector<math::Mat4f>&
    */
-  const std::vector<math::Mat4f>& local_to_world_matrices();
+  const std::vector<math::Mat4f>& local_to_world_matrices() const { return world_model_mats_; }
+
+  /**
+   * @brief Refreshes all of the stale inverse world matrices at once and returns them. Requires
+   * `InverseWorldMatrices::Cached`.
+   *
+   * @return const std::vector<math::Mat4f>&
+   */
   const std::vector<math::Mat4f>& world_to_local_matrices();
 
+  /**
+   * @brief Number of the finished `update()` calls, identifies the state of the world matrices for
+   * `world_matrices_changed_since()`.
+   *
+   */
+  uint64_t update_count() const { return update_count_; }
+
+  /**
+   * @brief Number of the latest updates whose world matrix changes are kept, must be at least the number of the
+   * updates between two consecutive uploads of the matrices.
+   *
+   */
+  static constexpr size_t kWorldChangesHistory = 8;
+
+  /**
+   * @brief Appends the indices (`FlatTree::index_of()`) of the world matrices written by the updates that followed the
+   * `update` (see `update_count()`), each index once. Useful to stream only the changed matrices to the GPU memory.
+   *
+   * @param update
+   * @param indices
+   * @return false if the changes of the updates following `update` are no longer kept, all of the matrices must be
+   * treated as changed then.
+   */
+  bool world_matrices_changed_since(uint64_t update, std::vector<uint32_t>& indices) const;
+
   void set_local_transform(NodeId node_id, Transform transform);
   void set_local_position(NodeId node_id, math::Vec3f position);
   void set_local_rotation(NodeId node_id, math::Quatf rotation);
@@ -139,6 +222,7 @@ class TransformTree {
    * @param name
    */
   void set_name(NodeId node_id, std::string name);
+  const std::string& name(NodeId node_id) const { return name_[FlatTree::index_of(node_id)]; }
 
   /**
    * @brief Updates dirty transforms.
@@ -146,23 +230,130 @@ class TransformTree {
    */
   void update();
 
+  static constexpr size_t kDefaultUpdateGrain = 1024;
+
+  /**
+   * @brief Updates dirty transforms on the workers of the `jobs`, produces the same matrices as `update()`. The local
+   * matrices are independent and computed in parallel. The world matrices are computed level by level, the nodes
+   * of a level depend only on their parents, so every level is a `parallel_for` and the levels are separated by its
+   * implicit barrier.
+   *
+   * @param jobs
+   * @param grain Number of the nodes per job, smaller levels are updated by the calling thread.
+   */
+  void update(util::JobSystem& jobs, size_t grain = kDefaultUpdateGrain);
+
  private:
   TransformTree() = default;
 
+  void allocate_node_arrays(size_t max_nodes_count, InverseWorldMatrices inverse_world_matrices);
+
+  /**
+   * @brief Composes the local matrices of the nodes `dirty_nodes_helper_[first, first + count)`, see
+   * `kLocalMatricesBatchSize`.
+   *
+   */
+  void update_local_matrices(size_t first, size_t count);
+  void update_world_matrices(NodeId node_id);
+
+  /**
+   * @brief Recomputes the cached inverse world matrix of the node if its world matrix changed since, the stale
+   * ancestors first.
+   *
+   */
+  const math::Mat4f& refresh_world_to_local(NodeId node_id);
+
+  void begin_world_changes();
+
+  /**
+   * @brief Adds the world matrix with `index` to the changes of the current update.
+   *
+   */
+  void record_world_change(size_t index);
+
+  /**
+   * @brief Raises the dirty flag of the node and appends it to the bucket of its level.
+   *
+   */
+  void mark_dirty(NodeId node_id);
+
+  /**
+   * @brief Moves the existing dirty nodes from the buckets to `dirty_nodes_helper_` level by level, so that the
+   * ancestors precede their descendants.
+   *
+   */
+  void collect_dirty_nodes();
+
+  /**
+   * @brief Number of the nodes whose local matrices are composed at once. The TRS matrices are built directly from the
+   * components, lane by lane, so that the compiler emits vector instructions for the whole batch.
+   *
+   */
+  static constexpr size_t kLocalMatricesBatchSize = 8;
+
   FlatTree tree_ = FlatTree(nullptr);
-  std::vector<Transform> local_transforms_;
+
+  // Local transforms as a structure of arrays, the matrix composition reads each component contiguously
+  std::vector<math::Vec3f> local_positions_;
+  std::vector<math::Quatf> local_rotations_;
+  std::vector<math::Vec3f> local_scales_;
   std::vector<Transform> world_transforms_;
 
   std::vector<math::Mat4f> local_model_mats_;
   std::vector<math::Mat4f> world_model_mats_;
-  std::vector<math::Mat4f> local_model_inv_mats_;
+
+  /**
+   * @brief Cached inverse world matrices, valid while `world_inv_update_` is not older than the
+   * `world_change_update_` of the node. Empty with `InverseWorldMatrices::None`.
+   *
+   */
   std::vector<math::Mat4f> world_model_inv_mats_;
+  std::vector<uint64_t> world_inv_update_;
+  InverseWorldMatrices inverse_world_matrices_ = InverseWorldMatrices::Cached;
 
   std::vector<std::string> name_;
 
-  std::unordered_set<NodeId> dirty_nodes_;
+  /**
+   * @brief Dirty flag per node index, a node is appended to `dirty_level_buckets_` only when its flag is raised.
+   *
+   */
+  std::vector<bool> dirty_;
+
+  /**
+   * @brief Dirty nodes by the level they had when marked, append-only between the updates. Deleted nodes are left in
+   * the buckets and skipped. A stale level only costs a redundant update, since a dirty ancestor recomputes all of
+   * its descendants anyway.
+   *
+   */
+  std::vector<std::vector<NodeId>> dirty_level_buckets_;
   std::vector<NodeId> dirty_nodes_helper_;
 
+  /**
+   * @brief Nodes whose world matrices are recomputed by the parallel update, per level.
+   *
+   */
+  std::vector<std::vector<NodeId>> level_buckets_;
+
+  /**
+   * @brief Number of the parallel update that added the node to a bucket, so that no node is added twice.
+   *
+   */
+  std::vector<uint32_t> bucketed_in_update_;
+  uint32_t parallel_update_count_{};
+
+  /**
+   * @brief World matrix indices written by the latest updates, the update `u` is kept at `u % kWorldChangesHistory`.
+   *
+   */
+  std::array<std::vector<uint32_t>, kWorldChangesHistory> world_changes_;
+
+  /**
+   * @brief Number of the last update that has written the world matrix, per node index.
+   *
+   */
+  std::vector<uint64_t> world_change_update_;
+  uint64_t update_count_{};
+
   size_t nodes_created_count_{};
 };
 
@@ -1,7 +1,9 @@
 #include "liberay/res/shader.hpp"
 
+#include <algorithm>
 #include <expected>
 #include <liberay/util/logger.hpp>
+#include <liberay/vkren/descriptor.hpp>
 #include <liberay/vkren/error.hpp>
 #include <liberay/vkren/shader.hpp>
 
@@ -23,9 +25,17 @@ Result<ShaderModule, Error> ShaderModule::create(const Device& device, std::span
         .vk_code = shader_mod_opt.error(),
     });
   }
+
+  // The module is still usable without the reflection, the layouts must be provided manually then
+  auto reflection = res::ShaderReflection::reflect(spirv_bytecode);
+  if (!reflection) {
+    eray::util::Logger::warn("Could not reflect the shader module: {}", reflection.error().msg);
+  }
+
   return ShaderModule{
       .shader_module = std::move(*shader_mod_opt),
       ._p_device     = &device,
+      .reflection    = reflection ? std::optional(std::move(*reflection)) : std::nullopt,
   };
 }
 
@@ -45,4 +55,82 @@ Result<ShaderModule, Error> ShaderModule::load_from_path(const Device& device, c
   });
 }
 
+Result<ShaderLayouts, Error> ShaderModule::create_layouts(Device& device,
+                                                          std::span<const res::ShaderReflection> reflections,
+                                                          vk::ShaderStageFlags stage_flags) {
+  auto merged = res::ShaderReflection::merge(reflections);
+  if (!merged) {
+    return std::unexpected(Error{
+        .msg  = merged.error().msg,
+        .code = ErrorCode::ParserError{},
+    });
+  }
+
+  auto to_vk_stages = [stage_flags](res::ShaderStageFlags stages) {
+    return stage_flags ? stage_flags : vk::ShaderStageFlags{stages.mask()};
+  };
+
+  auto layout_flags = vk::DescriptorSetLayoutCreateFlags{};
+  if (device.descriptor_backend() == DescriptorBackend::DescriptorBuffer) {
+    layout_flags |= vk::DescriptorSetLayoutCreateFlagBits::eDescriptorBufferEXT;
+  }
+
+  auto layouts = ShaderLayouts{};
+  layouts.set_layouts.reserve(merged->set_count());
+
+  // The merged bindings are sorted by the set numbers, so every set is a contiguous range
+  auto bindings = std::vector<vk::DescriptorSetLayoutBinding>{};
+  auto it       = merged->bindings.begin();
+  for (auto set = 0U; set < merged->set_count(); ++set) {
+    bindings.clear();
+    for (; it != merged->bindings.end() && it->set == set; ++it) {
+      bindings.push_back(vk::DescriptorSetLayoutBinding{
+          .binding            = it->binding,
+          .descriptorType     = static_cast<vk::DescriptorType>(it->type),
+          .descriptorCount    = it->count,
+          .stageFlags         = to_vk_stages(it->stages),
+          .pImmutableSamplers = nullptr,
+      });
+    }
+
+    auto layout_opt = device.dsl_manager().create_layout(vk::DescriptorSetLayoutCreateInfo{
+        .flags        = layout_flags,
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings    = bindings.data(),
+    });
+    if (!layout_opt) {
+      return std::unexpected(layout_opt.error());
+    }
+    layouts.set_layouts.push_back(*layout_opt);
+  }
+
+  if (merged->push_constant_size_bytes > 0) {
+    layouts.push_constant_ranges.push_back(vk::PushConstantRange{
+        .stageFlags = to_vk_stages(merged->push_constant_stages),
+        .offset     = 0,
+        .size       = merged->push_constant_size_bytes,
+    });
+  }
+
+  auto pipeline_layout_opt =
+      device.dsl_manager().create_pipeline_layout(layouts.set_layouts, layouts.push_constant_ranges);
+  if (!pipeline_layout_opt) {
+    return std::unexpected(pipeline_layout_opt.error());
+  }
+  layouts.pipeline_layout = *pipeline_layout_opt;
+
+  return layouts;
+}
+
+Result<ShaderLayouts, Error> ShaderModule::create_layouts(Device& device, vk::ShaderStageFlags stage_flags) const {
+  if (!reflection) {
+    return std::unexpected(Error{
+        .msg  = "Shader module has not been reflected",
+        .code = ErrorCode::ParserError{},
+    });
+  }
+
+  return create_layouts(device, std::span{&*reflection, 1}, stage_flags);
+}
+
 }  // namespace eray::vkren
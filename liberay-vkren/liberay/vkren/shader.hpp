@@ -1,15 +1,36 @@
 #pragma once
 
 #include <liberay/res/shader.hpp>
+#include <liberay/res/shader_reflection.hpp>
 #include <liberay/vkren/common.hpp>
 #include <liberay/vkren/device.hpp>
+#include <optional>
+#include <span>
+#include <vector>
 
 namespace eray::vkren {
 
+/**
+ * @brief Layouts generated from the shader reflection. The set layouts are indexed with the set numbers, the sets not
+ * used by the shaders get an empty layout. All of the layouts are owned by the `DescriptorSetLayoutManager`.
+ *
+ */
+struct ShaderLayouts {
+  std::vector<vk::DescriptorSetLayout> set_layouts;
+  std::vector<vk::PushConstantRange> push_constant_ranges;
+  vk::PipelineLayout pipeline_layout;
+};
+
 struct ShaderModule {
   vk::raii::ShaderModule shader_module;
   observer_ptr<const Device> _p_device;
 
+  /**
+   * @brief Bindings used by the module, `std::nullopt` when the bytecode could not be reflected.
+   *
+   */
+  std::optional<res::ShaderReflection> reflection;
+
   /**
    * @brief Creates a shader module from the provided `bytecode` span.
    *
@@ -22,6 +43,32 @@ struct ShaderModule {
   [[nodiscard]] static Result<ShaderModule, Error> create(const Device& device, const res::SPIRVShaderBinary& spirv);
   [[nodiscard]] static Result<ShaderModule, Error> load_from_path(const Device& device,
                                                                   const std::filesystem::path& path);
+
+  /**
+   * @brief Generates the descriptor set layouts, push constant ranges and the pipeline layout of a pipeline built from
+   * the reflected modules. The layouts are deduplicated by the device `DescriptorSetLayoutManager`, so the pipelines
+   * declaring the same resources share them.
+   *
+   * @param device
+   * @param reflections Reflections of all of the modules of the pipeline.
+   * @param stage_flags When not empty, overrides the stages of every binding and push constant range. Setting it to
+   * all of the pipeline stages makes the layouts compatible across the pipelines using the resources in different
+   * stages.
+   * @return Result<ShaderLayouts, Error> Fails with `ParserError` when the modules declare different resources at the
+   * same binding.
+   */
+  [[nodiscard]] static Result<ShaderLayouts, Error> create_layouts(
+      Device& device, std::span<const res::ShaderReflection> reflections, vk::ShaderStageFlags stage_flags = {});
+
+  /**
+   * @brief Generates the layouts of a single module pipeline, e.g. a compute pipeline.
+   *
+   * @param device
+   * @param stage_flags
+   * @return Result<ShaderLayouts, Error> Fails with `ParserError` when the module has not been reflected.
+   */
+  [[nodiscard]] Result<ShaderLayouts, Error> create_layouts(Device& device,
+                                                            vk::ShaderStageFlags stage_flags = {}) const;
 };
 
 }  // namespace eray::vkren
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <fstream>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/shader_cost_profiler.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+std::string escape_json(std::string_view str) {
+  auto result = std::string();
+  result.reserve(str.size());
+  for (const auto c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+uint64_t entry_key(uint32_t pass, uint32_t material) { return (static_cast<uint64_t>(pass) << 32) | material; }
+
+}  // namespace
+
+ShaderCostCounters& ShaderCostCounters::operator+=(const ShaderCostCounters& other) {
+  input_vertices += other.input_vertices;
+  input_primitives += other.input_primitives;
+  vertex_invocations += other.vertex_invocations;
+  clipping_invocations += other.clipping_invocations;
+  clipping_primitives += other.clipping_primitives;
+  fragment_invocations += other.fragment_invocations;
+  compute_invocations += other.compute_invocations;
+  return *this;
+}
+
+Result<ShaderCostProfiler, Error> ShaderCostProfiler::create(Device& device, uint32_t capacity,
+                                                             uint32_t frames_in_flight) {
+  auto profiler      = ShaderCostProfiler(nullptr);
+  profiler.p_device_ = &device;
+  TRY_UNWRAP_ASSIGN(profiler.pool_,
+                    device.query_pools().create_statistics_pool(capacity, frames_in_flight, kStatistics));
+  profiler.frames_.resize(frames_in_flight);
+
+  return profiler;
+}
+
+void ShaderCostProfiler::destroy() {
+  if (p_device_ != nullptr) {
+    p_device_->query_pools().destroy_pool(pool_);
+    p_device_ = nullptr;
+  }
+}
+
+void ShaderCostProfiler::begin_frame(uint32_t frame_index) {
+  assert(frame_index < frames_.size() && "Frame index exceeds the frames in flight of the shader cost profiler");
+  assert(!open_query_ && "Pass of the previous frame has not been ended");
+
+  // The pool results are the previous recording of the frame in flight only if it has been available in time
+  auto& frame          = frames_[frame_index];
+  const auto& results  = p_device_->query_pools().results(pool_);
+  const auto collected = !frame.labels.empty() && results.frame == frame.frame;
+  if (collected) {
+    for (auto q = 0U; q < frame.labels.size(); ++q) {
+      if (!results.available(q)) {
+        continue;
+      }
+      const auto value = [&results, q](uint32_t index) { return *results.value(q, index); };
+      totals_[entry_key(frame.labels[q].pass, frame.labels[q].material)] += ShaderCostCounters{
+          .input_vertices       = value(0),
+          .input_primitives     = value(1),
+          .vertex_invocations   = value(2),
+          .clipping_invocations = value(3),
+          .clipping_primitives  = value(4),
+          .fragment_invocations = value(5),
+          .compute_invocations  = value(6),
+      };
+    }
+    ++frame_count_;
+  }
+
+  frame.labels.clear();
+  frame.frame  = p_device_->query_pools().frame_counter();
+  frame_index_ = frame_index;
+}
+
+void ShaderCostProfiler::begin_pass(vk::CommandBuffer cmd_buff, std::string_view pass) {
+  assert(pass_ == kNone && "Shader cost profiler passes cannot be nested");
+  pass_ = intern(pass);
+  begin_segment(cmd_buff, kNone);
+}
+
+void ShaderCostProfiler::end_pass(vk::CommandBuffer cmd_buff) {
+  end_segment(cmd_buff);
+  pass_     = kNone;
+  material_ = kNone;
+}
+
+void ShaderCostProfiler::begin_material(vk::CommandBuffer cmd_buff, std::string_view material) {
+  if (pass_ == kNone) {
+    return;
+  }
+  end_segment(cmd_buff);
+  begin_segment(cmd_buff, intern(material));
+}
+
+void ShaderCostProfiler::end_material(vk::CommandBuffer cmd_buff) {
+  if (pass_ == kNone || material_ == kNone) {
+    return;
+  }
+  end_segment(cmd_buff);
+  begin_segment(cmd_buff, kNone);
+}
+
+void ShaderCostProfiler::set_material_name(vk::DescriptorSet material_set, std::string name) {
+  material_names_[static_cast<VkDescriptorSet>(material_set)] = std::move(name);
+}
+
+std::string ShaderCostProfiler::material_name(vk::DescriptorSet material_set) const {
+  if (auto it = material_names_.find(static_cast<VkDescriptorSet>(material_set)); it != material_names_.end()) {
+    return it->second;
+  }
+  return std::format("Material {:#x}", reinterpret_cast<uintptr_t>(static_cast<VkDescriptorSet>(material_set)));
+}
+
+std::vector<ShaderCostEntry> ShaderCostProfiler::report() const {
+  auto entries = std::vector<ShaderCostEntry>();
+  entries.reserve(totals_.size());
+  for (const auto& [key, total] : totals_) {
+    const auto material = static_cast<uint32_t>(key);
+    entries.push_back(ShaderCostEntry{
+        .pass        = names_[key >> 32],
+        .material    = material == kNone ? std::string() : names_[material],
+        .frame_count = frame_count_,
+        .total       = total,
+    });
+  }
+  std::ranges::sort(entries, std::ranges::greater{}, [](const ShaderCostEntry& entry) { return entry.total.cost(); });
+
+  return entries;
+}
+
+Result<void, Error> ShaderCostProfiler::write_json(const std::filesystem::path& path) const {
+  auto file = std::ofstream(path, std::ios::trunc);
+  if (!file) {
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not open the shader cost report "{}")", path.string()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  const auto entries = report();
+  file << std::format("{{\n  \"frames\": {},\n  \"entries\": [", frame_count_);
+  for (auto i = 0U; i < entries.size(); ++i) {
+    const auto& entry = entries[i];
+    file << std::format("{}\n    {{\"pass\": \"{}\", \"material\": \"{}\", ", i == 0 ? "" : ",",
+                        escape_json(entry.pass), escape_json(entry.material));
+    file << std::format(
+        R"("input_vertices": {:.1f}, "input_primitives": {:.1f}, "vertex_invocations": {:.1f}, )"
+        R"("clipping_invocations": {:.1f}, "clipping_primitives": {:.1f}, "fragment_invocations": {:.1f}, )"
+        R"("compute_invocations": {:.1f}, "fragments_per_primitive": {:.3f}}})",
+        entry.per_frame(&ShaderCostCounters::input_vertices), entry.per_frame(&ShaderCostCounters::input_primitives),
+        entry.per_frame(&ShaderCostCounters::vertex_invocations),
+        entry.per_frame(&ShaderCostCounters::clipping_invocations),
+        entry.per_frame(&ShaderCostCounters::clipping_primitives),
+        entry.per_frame(&ShaderCostCounters::fragment_invocations),
+        entry.per_frame(&ShaderCostCounters::compute_invocations), entry.fragments_per_primitive());
+  }
+  file << "\n  ]\n}\n";
+
+  if (!file) {
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not write the shader cost report "{}")", path.string()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  util::Logger::succ(R"(Shader cost report of {} frames written to "{}")", frame_count_, path.string());
+  return {};
+}
+
+void ShaderCostProfiler::reset() {
+  totals_.clear();
+  frame_count_ = 0;
+}
+
+uint32_t ShaderCostProfiler::intern(std::string_view name) {
+  if (auto it = name_ids_.find(name); it != name_ids_.end()) {
+    return it->second;
+  }
+  const auto id = static_cast<uint32_t>(names_.size());
+  names_.emplace_back(name);
+  name_ids_.emplace(std::string(name), id);
+  return id;
+}
+
+void ShaderCostProfiler::begin_segment(vk::CommandBuffer cmd_buff, uint32_t material) {
+  material_   = material;
+  open_query_ = p_device_->query_pools().begin_query(cmd_buff, pool_);
+  if (open_query_) {
+    auto& labels = frames_[frame_index_].labels;
+    assert(*open_query_ == labels.size() && "Shader cost queries are expected to be allocated in order");
+    labels.push_back(QueryLabel{.pass = pass_, .material = material});
+  }
+}
+
+void ShaderCostProfiler::end_segment(vk::CommandBuffer cmd_buff) {
+  if (open_query_) {
+    p_device_->query_pools().end_query(cmd_buff, pool_, *open_query_);
+    open_query_.reset();
+  }
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <liberay/util/string_hash.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/query_pool_manager.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace eray::vkren {
+
+class Device;
+
+/**
+ * @brief Pipeline statistics counted by the `ShaderCostProfiler`.
+ *
+ */
+struct ShaderCostCounters {
+  uint64_t input_vertices       = 0;
+  uint64_t input_primitives     = 0;
+  uint64_t vertex_invocations   = 0;
+  uint64_t clipping_invocations = 0;
+  uint64_t clipping_primitives  = 0;
+  uint64_t fragment_invocations = 0;
+  uint64_t compute_invocations  = 0;
+
+  /**
+   * @brief Shader invocations of all of the stages, the report is sorted by it.
+   *
+   */
+  uint64_t cost() const { return vertex_invocations + fragment_invocations + compute_invocations; }
+
+  ShaderCostCounters& operator+=(const ShaderCostCounters& other);
+};
+
+/**
+ * @brief Counters of a pass or of a material drawn in a pass, summed over the collected frames.
+ *
+ */
+struct ShaderCostEntry {
+  std::string pass;
+
+  /**
+   * @brief Empty for the work of the pass recorded outside of the material scopes, e.g. the fullscreen passes and the
+   * compute passes.
+   *
+   */
+  std::string material;
+
+  uint32_t frame_count = 0;
+  ShaderCostCounters total;
+
+  double per_frame(uint64_t ShaderCostCounters::* counter) const {
+    return frame_count == 0 ? 0.0 : static_cast<double>(total.*counter) / static_cast<double>(frame_count);
+  }
+
+  /**
+   * @brief Fragment shader invocations per primitive that survived the clipping, high values point at large or
+   * overdrawn primitives.
+   *
+   */
+  double fragments_per_primitive() const {
+    return total.clipping_primitives == 0
+               ? 0.0
+               : static_cast<double>(total.fragment_invocations) / static_cast<double>(total.clipping_primitives);
+  }
+
+  /**
+   * @brief Fragment shader invocations per pixel of the target, without the early depth test rejections it
+   * approximates the overdraw.
+   *
+   */
+  double overdraw(uint32_t target_pixels) const {
+    return target_pixels == 0 ? 0.0 : per_frame(&ShaderCostCounters::fragment_invocations) / target_pixels;
+  }
+};
+
+/**
+ * @brief Collects `VK_QUERY_TYPE_PIPELINE_STATISTICS` per render graph pass and per material drawn in the pass, and
+ * aggregates them into a report of the most expensive shaders, see `report()` and `write_json()`.
+ *
+ * The pipeline statistics queries of a pool cannot be nested, so a material scope ends the query of its pass and the
+ * pass query is resumed once the material ends. The counters of a pass are the sum of its entries. The queries are
+ * allocated from the `Device::query_pools()`, whose `begin_frame()` must be recorded every frame, and read back
+ * `frames_in_flight` frames later.
+ *
+ * The scopes are recorded by the render graph into the graphics queue command buffer only (see
+ * `RenderGraph::set_shader_cost_profiler()`), the async compute passes and the passes recorded into the secondary
+ * command buffers are not measured. Not thread safe.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class ShaderCostProfiler {
+ public:
+  ShaderCostProfiler() = delete;
+  explicit ShaderCostProfiler(std::nullptr_t) {}
+
+  ShaderCostProfiler(const ShaderCostProfiler&)                = delete;
+  ShaderCostProfiler& operator=(const ShaderCostProfiler&)     = delete;
+  ShaderCostProfiler(ShaderCostProfiler&&) noexcept            = default;
+  ShaderCostProfiler& operator=(ShaderCostProfiler&&) noexcept = default;
+
+  static constexpr vk::QueryPipelineStatisticFlags kStatistics =
+      vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+      vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+      vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+      vk::QueryPipelineStatisticFlagBits::eClippingInvocations |
+      vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+      vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+      vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+
+  /**
+   * @brief Creates the statistics pools in the `Device::query_pools()`.
+   *
+   * @param device
+   * @param capacity Queries per frame, every pass takes one and every material scope two.
+   * @param frames_in_flight
+   * @return Result<ShaderCostProfiler, Error> Fails with `PhysicalDeviceNotSufficient` when the
+   * `pipelineStatisticsQuery` feature is not supported.
+   */
+  [[nodiscard]] static Result<ShaderCostProfiler, Error> create(Device& device, uint32_t capacity,
+                                                                uint32_t frames_in_flight);
+
+  /**
+   * @brief Destroys the pools, the GPU must not use them anymore.
+   *
+   */
+  void destroy();
+
+  /**
+   * @brief Aggregates the counters read back by the `QueryPoolManager::begin_frame()` of the same frame, which must
+   * be recorded first.
+   *
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Begins the query of a pass, ended by `end_pass()`. A render pass must record both inside of its
+   * rendering.
+   *
+   */
+  void begin_pass(vk::CommandBuffer cmd_buff, std::string_view pass);
+  void end_pass(vk::CommandBuffer cmd_buff);
+
+  /**
+   * @brief Moves the counting of the pass to the material, until `end_material()` or the next `begin_material()`.
+   * Ignored outside of a pass.
+   *
+   */
+  void begin_material(vk::CommandBuffer cmd_buff, std::string_view material);
+  void end_material(vk::CommandBuffer cmd_buff);
+
+  /**
+   * @brief Name of the material of the descriptor set, used by the scene rendering that identifies the materials by
+   * their sets only, see `RenderQueue::record()`.
+   *
+   */
+  void set_material_name(vk::DescriptorSet material_set, std::string name);
+  std::string material_name(vk::DescriptorSet material_set) const;
+
+  /**
+   * @brief Entries sorted by `ShaderCostCounters::cost()`, the most expensive first.
+   *
+   */
+  std::vector<ShaderCostEntry> report() const;
+
+  /**
+   * @brief Writes the `report()` with the per frame averages as JSON.
+   *
+   * @param path
+   * @return Result<void, Error>
+   */
+  Result<void, Error> write_json(const std::filesystem::path& path) const;
+
+  /**
+   * @brief Drops the collected counters, e.g. once the scene has changed.
+   *
+   */
+  void reset();
+
+  /**
+   * @brief Number of the frames whose counters have been collected since the creation or the last `reset()`.
+   *
+   */
+  uint32_t frame_count() const { return frame_count_; }
+
+ private:
+  static constexpr uint32_t kNone = ~0U;
+
+  /**
+   * @brief Pass and material of a query, as the indices of their names.
+   *
+   */
+  struct QueryLabel {
+    uint32_t pass;
+    uint32_t material;
+  };
+
+  struct FrameLabels {
+    uint64_t frame = 0;
+    std::vector<QueryLabel> labels;
+  };
+
+  uint32_t intern(std::string_view name);
+  void begin_segment(vk::CommandBuffer cmd_buff, uint32_t material);
+  void end_segment(vk::CommandBuffer cmd_buff);
+
+  observer_ptr<Device> p_device_{};
+  StatisticsPoolHandle pool_{};
+
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, uint32_t, util::StringHash, std::equal_to<>> name_ids_;
+  std::unordered_map<VkDescriptorSet, std::string> material_names_;
+
+  std::vector<FrameLabels> frames_;
+  uint32_t frame_index_ = 0;
+
+  /**
+   * @brief Summed counters by the pass and material name indices.
+   *
+   */
+  std::unordered_map<uint64_t, ShaderCostCounters> totals_;
+  uint32_t frame_count_ = 0;
+
+  uint32_t pass_                      = kNone;
+  uint32_t material_                  = kNone;
+  std::optional<uint32_t> open_query_ = std::nullopt;
+};
+
+}  // namespace eray::vkren
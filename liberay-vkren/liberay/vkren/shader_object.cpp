@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <expected>
+#include <iterator>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/shader_object.hpp>
+#include <utility>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+/**
+ * @brief The graphics stages in the order of the pipeline.
+ *
+ */
+constexpr auto kGraphicsStages = std::array{
+    vk::ShaderStageFlagBits::eTaskEXT,
+    vk::ShaderStageFlagBits::eMeshEXT,
+    vk::ShaderStageFlagBits::eVertex,
+    vk::ShaderStageFlagBits::eTessellationControl,
+    vk::ShaderStageFlagBits::eTessellationEvaluation,
+    vk::ShaderStageFlagBits::eGeometry,
+    vk::ShaderStageFlagBits::eFragment,
+};
+
+const char* entry_point(const ShaderStageCode& code) {
+  if (!code.entry_point.empty()) {
+    return code.entry_point.c_str();
+  }
+
+  switch (code.stage) {
+    case vk::ShaderStageFlagBits::eVertex:
+      return GraphicsPipelineBuilder::kDefaultVertexShaderEntryPoint.c_str();
+    case vk::ShaderStageFlagBits::eTessellationControl:
+      return GraphicsPipelineBuilder::kDefaultTessellationControlShaderEntryPoint.c_str();
+    case vk::ShaderStageFlagBits::eTessellationEvaluation:
+      return GraphicsPipelineBuilder::kDefaultTessellationEvalShaderEntryPoint.c_str();
+    case vk::ShaderStageFlagBits::eTaskEXT:
+      return GraphicsPipelineBuilder::kDefaultTaskShaderEntryPoint.c_str();
+    case vk::ShaderStageFlagBits::eMeshEXT:
+      return GraphicsPipelineBuilder::kDefaultMeshShaderEntryPoint.c_str();
+    case vk::ShaderStageFlagBits::eFragment:
+      return GraphicsPipelineBuilder::kDefaultFragmentShaderEntryPoint.c_str();
+    case vk::ShaderStageFlagBits::eCompute:
+      return ComputePipelineBuilder::kDefaultComputeShaderEntryPoint.c_str();
+    default:
+      return "main";
+  }
+}
+
+}  // namespace
+
+Result<ShaderObjects, Error> ShaderObjects::create(const Device& device, std::span<const ShaderStageCode> stages,
+                                                   std::span<const vk::DescriptorSetLayout> set_layouts,
+                                                   std::span<const vk::PushConstantRange> push_constant_ranges,
+                                                   const SpecializationConstants& specialization,
+                                                   bool shading_rate_attachment) {
+  assert(device.has_shader_object() && "VK_EXT_shader_object is not enabled");
+  assert(!stages.empty() && "Shader stages must be provided");
+
+  const auto is_compute = stages.front().stage == vk::ShaderStageFlagBits::eCompute;
+  assert((!is_compute || stages.size() == 1) && "Compute shader must not be combined with other stages");
+
+  auto contains = [&stages](vk::ShaderStageFlagBits stage) {
+    return std::ranges::find(stages, stage, &ShaderStageCode::stage) != stages.end();
+  };
+
+  // The linked shaders must know the stage that follows them
+  auto next_stage = [&](vk::ShaderStageFlagBits stage) {
+    auto it = std::ranges::find(kGraphicsStages, stage);
+    if (it == kGraphicsStages.end()) {
+      return vk::ShaderStageFlags{};
+    }
+    auto next = std::find_if(std::next(it), kGraphicsStages.end(), contains);
+    return next == kGraphicsStages.end() ? vk::ShaderStageFlags{} : vk::ShaderStageFlags{*next};
+  };
+
+  const auto specialization_info = specialization.info();
+  const auto link                = !is_compute && stages.size() > 1;
+
+  auto create_infos = std::vector<vk::ShaderCreateInfoEXT>();
+  create_infos.reserve(stages.size());
+  for (const auto& code : stages) {
+    auto flags = link ? vk::ShaderCreateFlagsEXT{vk::ShaderCreateFlagBitsEXT::eLinkStage} : vk::ShaderCreateFlagsEXT{};
+    if (code.stage == vk::ShaderStageFlagBits::eMeshEXT && !contains(vk::ShaderStageFlagBits::eTaskEXT)) {
+      flags |= vk::ShaderCreateFlagBitsEXT::eNoTaskShader;
+    }
+    if (code.stage == vk::ShaderStageFlagBits::eFragment && shading_rate_attachment) {
+      flags |= vk::ShaderCreateFlagBitsEXT::eFragmentShadingRateAttachment;
+    }
+    create_infos.push_back(vk::ShaderCreateInfoEXT{
+        .flags                  = flags,
+        .stage                  = code.stage,
+        .nextStage              = next_stage(code.stage),
+        .codeType               = vk::ShaderCodeTypeEXT::eSpirv,
+        .codeSize               = code.spirv.size_bytes(),
+        .pCode                  = code.spirv.data(),
+        .pName                  = entry_point(code),
+        .setLayoutCount         = static_cast<uint32_t>(set_layouts.size()),
+        .pSetLayouts            = set_layouts.data(),
+        .pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size()),
+        .pPushConstantRanges    = push_constant_ranges.data(),
+        .pSpecializationInfo    = specialization.empty() ? nullptr : &specialization_info,
+    });
+  }
+
+  auto shaders = device->createShadersEXT(create_infos);
+  if (!shaders) {
+    util::Logger::err("Could not create the shader objects: {}", vk::to_string(shaders.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Shader Object creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = shaders.error(),
+    });
+  }
+
+  auto objects     = ShaderObjects(nullptr);
+  objects.shaders_ = std::move(*shaders);
+  for (auto i = 0U; i < stages.size(); ++i) {
+    objects.bound_stages_.push_back(stages[i].stage);
+    objects.bound_shaders_.push_back(*objects.shaders_[i]);
+  }
+
+  if (!is_compute) {
+    const auto features = device.physical_device().getFeatures();
+    for (auto stage : kGraphicsStages) {
+      const auto is_mesh_stage =
+          stage == vk::ShaderStageFlagBits::eTaskEXT || stage == vk::ShaderStageFlagBits::eMeshEXT;
+      const auto enabled = (stage != vk::ShaderStageFlagBits::eGeometry || features.geometryShader == vk::True) &&
+                           (!is_mesh_stage || device.has_mesh_shader());
+      if (enabled && !contains(stage)) {
+        objects.bound_stages_.push_back(stage);
+        objects.bound_shaders_.emplace_back(nullptr);
+      }
+    }
+  }
+
+  return objects;
+}
+
+void ShaderObjects::bind(vk::CommandBuffer cmd_buff) const { cmd_buff.bindShadersEXT(bound_stages_, bound_shaders_); }
+
+Result<GraphicsProgram, Error> GraphicsProgram::create(const Device& device, GraphicsPipelineBuilder builder,
+                                                       std::span<const ShaderStageCode> stages,
+                                                       vk::PipelineLayout layout) {
+  auto program = GraphicsProgram(nullptr);
+
+  if (!device.has_shader_object()) {
+    // The modules are needed only by the pipeline creation
+    auto modules = std::vector<vk::raii::ShaderModule>();
+    modules.reserve(stages.size());
+    builder._shader_stages.clear();
+    for (const auto& code : stages) {
+      auto shader_module = device->createShaderModule(vk::ShaderModuleCreateInfo{
+          .codeSize = code.spirv.size_bytes(),
+          .pCode    = code.spirv.data(),
+      });
+      if (!shader_module) {
+        return std::unexpected(Error{
+            .msg     = "Shader Module creation failure",
+            .code    = ErrorCode::VulkanObjectCreationFailure{},
+            .vk_code = shader_module.error(),
+        });
+      }
+      modules.push_back(std::move(*shader_module));
+      builder._shader_stages.push_back(vk::PipelineShaderStageCreateInfo{
+          .stage  = code.stage,
+          .module = *modules.back(),
+          .pName  = entry_point(code),
+      });
+      builder.mesh_stage = builder.mesh_stage || code.stage == vk::ShaderStageFlagBits::eMeshEXT;
+    }
+
+    auto pipeline = builder.build(device, layout);
+    if (!pipeline) {
+      return std::unexpected(pipeline.error());
+    }
+    program.pipeline_ = std::move(*pipeline);
+    return program;
+  }
+
+  const auto& layout_info = builder._pipeline_layout;
+  auto shaders            = ShaderObjects::create(
+      device, stages, std::span(layout_info.pSetLayouts, layout_info.setLayoutCount),
+      std::span(layout_info.pPushConstantRanges, layout_info.pushConstantRangeCount), builder._specialization,
+      builder.shading_rate_attachment);
+  if (!shaders) {
+    return std::unexpected(shaders.error());
+  }
+  program.shader_objects_ = std::move(*shaders);
+
+  const auto& vertex_input = builder._vertex_input_state;
+  for (auto i = 0U; i < vertex_input.vertexBindingDescriptionCount; ++i) {
+    const auto& binding = vertex_input.pVertexBindingDescriptions[i];
+    program.vertex_bindings_.push_back(vk::VertexInputBindingDescription2EXT{
+        .binding   = binding.binding,
+        .stride    = binding.stride,
+        .inputRate = binding.inputRate,
+        .divisor   = 1,
+    });
+  }
+  for (auto i = 0U; i < vertex_input.vertexAttributeDescriptionCount; ++i) {
+    const auto& attribute = vertex_input.pVertexAttributeDescriptions[i];
+    program.vertex_attributes_.push_back(vk::VertexInputAttributeDescription2EXT{
+        .location = attribute.location,
+        .binding  = attribute.binding,
+        .format   = attribute.format,
+        .offset   = attribute.offset,
+    });
+  }
+
+  // Every state the dynamic state covers is recorded, the rest is recorded by `record_state()`
+  static constexpr auto kDynamicStates = std::array{
+      vk::DynamicState::eCullMode,
+      vk::DynamicState::eFrontFace,
+      vk::DynamicState::ePrimitiveTopology,
+      vk::DynamicState::eDepthTestEnable,
+      vk::DynamicState::eDepthWriteEnable,
+      vk::DynamicState::eDepthCompareOp,
+      vk::DynamicState::eDepthBiasEnable,
+      vk::DynamicState::ePrimitiveRestartEnable,
+      vk::DynamicState::ePolygonModeEXT,
+      vk::DynamicState::eColorBlendEnableEXT,
+      vk::DynamicState::eColorBlendEquationEXT,
+      vk::DynamicState::eColorWriteMaskEXT,
+  };
+  builder.with_dynamic_states(kDynamicStates);
+  program.dynamic_state_ = builder.dynamic_state();
+
+  const auto features                      = device.physical_device().getFeatures();
+  program.depth_clamp_supported_           = features.depthClamp == vk::True;
+  program.alpha_to_one_supported_          = features.alphaToOne == vk::True;
+  program.logic_op_supported_              = features.logicOp == vk::True;
+  program.fragment_shading_rate_supported_ = device.has_fragment_shading_rate();
+  program.builder_                = std::move(builder);
+
+  return program;
+}
+
+void GraphicsProgram::bind(vk::CommandBuffer cmd_buff, const vk::Viewport& viewport, const vk::Rect2D& scissor) const {
+  if (!shader_objects_) {
+    cmd_buff.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline_);
+    cmd_buff.setViewport(0, viewport);
+    cmd_buff.setScissor(0, scissor);
+    return;
+  }
+
+  shader_objects_->bind(cmd_buff);
+  cmd_buff.setViewportWithCount(viewport);
+  cmd_buff.setScissorWithCount(scissor);
+  record_state(cmd_buff);
+}
+
+void GraphicsProgram::record_state(vk::CommandBuffer cmd_buff) const {
+  const auto& builder = *builder_;
+  dynamic_state_.record(cmd_buff);
+
+  // == Input State ====================================================================================================
+  cmd_buff.setVertexInputEXT(vertex_bindings_, vertex_attributes_);
+  if (builder.tess_stage) {
+    cmd_buff.setPatchControlPointsEXT(builder._tess_stage.patchControlPoints);
+    cmd_buff.setTessellationDomainOriginEXT(builder._tess_stage.pNext != nullptr
+                                                ? builder._tess_domain_origin.domainOrigin
+                                                : vk::TessellationDomainOrigin::eUpperLeft);
+  }
+
+  // == Rasterizer =====================================================================================================
+  const auto& rasterizer = builder._rasterizer;
+  cmd_buff.setRasterizerDiscardEnable(rasterizer.rasterizerDiscardEnable);
+  cmd_buff.setLineWidth(rasterizer.lineWidth);
+  if (rasterizer.depthBiasEnable == vk::True) {
+    cmd_buff.setDepthBias(rasterizer.depthBiasConstantFactor, rasterizer.depthBiasClamp,
+                          rasterizer.depthBiasSlopeFactor);
+  }
+  if (depth_clamp_supported_) {
+    cmd_buff.setDepthClampEnableEXT(rasterizer.depthClampEnable);
+  }
+
+  // == Fragment Shading Rate ==========================================================================================
+  // The rate must be set whenever the pipeline rate is enabled, the shading rate image replaces it if bound
+  if (fragment_shading_rate_supported_) {
+    const auto combiner_ops = std::array{
+        vk::FragmentShadingRateCombinerOpKHR::eKeep,
+        builder.shading_rate_attachment ? vk::FragmentShadingRateCombinerOpKHR::eReplace
+                                        : vk::FragmentShadingRateCombinerOpKHR::eKeep,
+    };
+    cmd_buff.setFragmentShadingRateKHR(vk::Extent2D{.width = 1, .height = 1}, combiner_ops.data());
+  }
+
+  // == Multisampling ==================================================================================================
+  const auto& multisampling = builder._multisampling;
+  const auto sample_mask    = std::array<vk::SampleMask, 2>{~0U, ~0U};
+  cmd_buff.setRasterizationSamplesEXT(multisampling.rasterizationSamples);
+  cmd_buff.setSampleMaskEXT(multisampling.rasterizationSamples,
+                            multisampling.pSampleMask != nullptr ? multisampling.pSampleMask : sample_mask.data());
+  cmd_buff.setAlphaToCoverageEnableEXT(multisampling.alphaToCoverageEnable);
+  if (alpha_to_one_supported_) {
+    cmd_buff.setAlphaToOneEnableEXT(multisampling.alphaToOneEnable);
+  }
+
+  // == Depth and Stencil Testing ======================================================================================
+  const auto& depth_stencil = builder._depth_stencil;
+  cmd_buff.setDepthBoundsTestEnable(depth_stencil.depthBoundsTestEnable);
+  if (depth_stencil.depthBoundsTestEnable == vk::True) {
+    cmd_buff.setDepthBounds(depth_stencil.minDepthBounds, depth_stencil.maxDepthBounds);
+  }
+  cmd_buff.setStencilTestEnable(depth_stencil.stencilTestEnable);
+  if (depth_stencil.stencilTestEnable == vk::True) {
+    for (const auto& [face, op] : {std::pair{vk::StencilFaceFlagBits::eFront, depth_stencil.front},
+                                   std::pair{vk::StencilFaceFlagBits::eBack, depth_stencil.back}}) {
+      cmd_buff.setStencilOp(face, op.failOp, op.passOp, op.depthFailOp, op.compareOp);
+      cmd_buff.setStencilCompareMask(face, op.compareMask);
+      cmd_buff.setStencilWriteMask(face, op.writeMask);
+      cmd_buff.setStencilReference(face, op.reference);
+    }
+  }
+
+  // == Color blending =================================================================================================
+  if (logic_op_supported_) {
+    cmd_buff.setLogicOpEnableEXT(vk::False);
+  }
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/util/zstring_view.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief SPIR-V of a single shader stage. The empty entry point is replaced with the default entry point of the stage
+ * used by the pipeline builders, e.g. `mainVert`.
+ *
+ */
+struct ShaderStageCode {
+  vk::ShaderStageFlagBits stage;
+  std::span<const uint32_t> spirv;
+  util::zstring_view entry_point = "";
+};
+
+/**
+ * @brief Shaders compiled with VK_EXT_shader_object. The shaders do not bake any state, so a new variant costs only the
+ * compilation of its shaders and switching between the variants is a bind. All of the state is set on the command
+ * buffer, see `GraphicsProgram`. Requires `Device::has_shader_object()`.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class ShaderObjects {
+ public:
+  ShaderObjects() = delete;
+  explicit ShaderObjects(std::nullptr_t) {}
+
+  /**
+   * @brief Compiles the shaders.
+   *
+   * @param device
+   * @param stages Either a single compute stage or the graphics stages, which are linked so that the driver might
+   * optimize across them like across the stages of a pipeline.
+   * @param set_layouts Must match the layout of the pipeline layout used for the descriptor sets and push constants.
+   * @param push_constant_ranges
+   * @param specialization Provided to every stage.
+   * @param shading_rate_attachment True if the fragment shader is used in the passes with a shading rate image, see
+   * `RenderPassBuilder::with_shading_rate_image()`.
+   * @return Result<ShaderObjects, Error>
+   */
+  [[nodiscard]] static Result<ShaderObjects, Error> create(
+      const Device& device, std::span<const ShaderStageCode> stages,
+      std::span<const vk::DescriptorSetLayout> set_layouts,
+      std::span<const vk::PushConstantRange> push_constant_ranges, const SpecializationConstants& specialization = {},
+      bool shading_rate_attachment = false);
+
+  /**
+   * @brief Binds the shaders. The graphics stages without a shader are unbound, so that no shader of the previously
+   * bound program is used.
+   *
+   * @param cmd_buff Must be in the recording state.
+   */
+  void bind(vk::CommandBuffer cmd_buff) const;
+
+ private:
+  std::vector<vk::raii::ShaderEXT> shaders_;
+
+  /**
+   * @brief Arguments of `vkCmdBindShadersEXT`, the unused graphics stages are bound to null.
+   *
+   */
+  std::vector<vk::ShaderStageFlagBits> bound_stages_;
+  std::vector<vk::ShaderEXT> bound_shaders_;
+};
+
+/**
+ * @brief Graphics shaders with the state described by a `GraphicsPipelineBuilder`. Compiled into shader objects when
+ * the device supports VK_EXT_shader_object, then every state of the builder is recorded when the program is bound.
+ * Otherwise the builder builds a pipeline, so the program works on every device.
+ *
+ * The shader objects do not support the sample shading, the fallback pipeline does.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class GraphicsProgram {
+ public:
+  GraphicsProgram() = delete;
+  explicit GraphicsProgram(std::nullptr_t) {}
+
+  /**
+   * @brief Compiles the program.
+   *
+   * @param device
+   * @param builder Describes the state, its shaders are replaced with the `stages`.
+   * @param stages
+   * @param layout Must be compatible with the set layouts and push constant ranges of the `builder`.
+   * @return Result<GraphicsProgram, Error>
+   */
+  [[nodiscard]] static Result<GraphicsProgram, Error> create(const Device& device, GraphicsPipelineBuilder builder,
+                                                             std::span<const ShaderStageCode> stages,
+                                                             vk::PipelineLayout layout);
+
+  /**
+   * @brief Binds the shaders and records the state, or binds the pipeline.
+   *
+   * @param cmd_buff Must be in the recording state.
+   * @param viewport
+   * @param scissor
+   */
+  void bind(vk::CommandBuffer cmd_buff, const vk::Viewport& viewport, const vk::Rect2D& scissor) const;
+
+  bool uses_shader_objects() const { return shader_objects_.has_value(); }
+
+ private:
+  void record_state(vk::CommandBuffer cmd_buff) const;
+
+  std::optional<ShaderObjects> shader_objects_;
+  vk::raii::Pipeline pipeline_ = nullptr;
+
+  /**
+   * @brief State recorded with the shader objects. The builder does not own its vertex input descriptions, they are
+   * copied.
+   *
+   */
+  std::optional<GraphicsPipelineBuilder> builder_;
+  GraphicsDynamicState dynamic_state_{};
+  std::vector<vk::VertexInputBindingDescription2EXT> vertex_bindings_;
+  std::vector<vk::VertexInputAttributeDescription2EXT> vertex_attributes_;
+  bool depth_clamp_supported_{false};
+  bool alpha_to_one_supported_{false};
+  bool logic_op_supported_{false};
+  bool fragment_shading_rate_supported_{false};
+};
+
+}  // namespace eray::vkren
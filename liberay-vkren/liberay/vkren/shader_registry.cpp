@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cassert>
+#include <expected>
+#include <liberay/res/shader.hpp>
+#include <liberay/res/shader_reflection.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/shader_registry.hpp>
+#include <system_error>
+#include <utility>
+#include <variant>
+
+namespace eray::vkren {
+
+ShaderRegistry ShaderRegistry::create(const Device& device, PipelineCompiler& compiler,
+                                      FrameDeletionQueue& deletion_queue, Clock::duration poll_interval) {
+  return ShaderRegistry(device, compiler, deletion_queue, poll_interval);
+}
+
+Result<vk::ShaderModule, Error> ShaderRegistry::load(const std::filesystem::path& path) {
+  if (auto it = std::ranges::find(shaders_, path, &Shader::path); it != shaders_.end()) {
+    return *it->shader_module;
+  }
+
+  auto ec         = std::error_code{};
+  auto write_time = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    util::Logger::err("Could not watch the shader file {}: {}", path.string(), ec.message());
+    return std::unexpected(Error{
+        .msg  = "Could not watch the shader file",
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  auto shader_module = ShaderModule::load_from_path(*p_device_, path);
+  if (!shader_module) {
+    return std::unexpected(shader_module.error());
+  }
+
+  shaders_.push_back(Shader{
+      .path          = path,
+      .write_time    = write_time,
+      .shader_module = std::move(shader_module->shader_module),
+  });
+  return *shaders_.back().shader_module;
+}
+
+ReloadablePipelineHandle ShaderRegistry::register_pipeline(const GraphicsPipelineBuilder& builder,
+                                                           vk::PipelineLayout layout) {
+  return register_pipeline(ReloadablePipeline{
+      .builder = builder,
+      .layout  = layout,
+      .current = AsyncPipeline(nullptr),
+      .pending = AsyncPipeline(nullptr),
+  });
+}
+
+ReloadablePipelineHandle ShaderRegistry::register_pipeline(const ComputePipelineBuilder& builder,
+                                                           vk::PipelineLayout layout) {
+  return register_pipeline(ReloadablePipeline{
+      .builder = builder,
+      .layout  = layout,
+      .current = AsyncPipeline(nullptr),
+      .pending = AsyncPipeline(nullptr),
+  });
+}
+
+ReloadablePipelineHandle ShaderRegistry::register_pipeline(ReloadablePipeline&& pipeline) {
+  const auto handle = pipelines_.insert(std::move(pipeline));
+  compile(pipelines_[handle]);
+  return handle;
+}
+
+void ShaderRegistry::unregister_pipeline(ReloadablePipelineHandle handle) {
+  assert(pipelines_.contains(handle) && "Invalid pipeline handle");
+
+  // The compilation in progress keeps its own reference to the pipeline state, it is released when it completes
+  auto& pipeline = pipelines_[handle];
+  if (pipeline.current.is_valid()) {
+    p_deletion_queue_->push_deletor([retired = std::move(pipeline.current)]() {});
+  }
+  pipelines_.erase(handle);
+}
+
+vk::Pipeline ShaderRegistry::pipeline(ReloadablePipelineHandle handle) const {
+  assert(pipelines_.contains(handle) && "Invalid pipeline handle");
+  return pipelines_[handle].current.pipeline_or();
+}
+
+void ShaderRegistry::compile(ReloadablePipeline& pipeline) {
+  // A newer compilation supersedes the one in progress, its result is dropped together with the handle
+  pipeline.pending = std::visit([&](const auto& builder) { return p_compiler_->compile(builder, pipeline.layout); },
+                                pipeline.builder);
+}
+
+void ShaderRegistry::update() {
+  // == Swap ===========================================================================================================
+  for (auto& pipeline : pipelines_) {
+    if (pipeline.pending.has_failed()) {
+      // The previous pipeline stays in use until the shader is fixed
+      pipeline.pending = AsyncPipeline(nullptr);
+      continue;
+    }
+    if (!pipeline.pending.is_ready()) {
+      continue;
+    }
+
+    // The frames in flight might still use the replaced pipeline, it is released once the current frame slot is
+    // reused. Copying the handle keeps its pipelines alive until the deletor is destroyed.
+    if (pipeline.current.is_ready()) {
+      p_deletion_queue_->push_deletor([retired = std::move(pipeline.current)]() {});
+    }
+    pipeline.current = std::exchange(pipeline.pending, AsyncPipeline(nullptr));
+  }
+
+  // Shader modules may be destroyed as soon as no pipeline is being created from them. The superseded compilations
+  // are not tracked by the registry anymore, so the compiler has to be idle.
+  if (!retired_modules_.empty() && p_compiler_->pending_count() == 0) {
+    retired_modules_.clear();
+  }
+
+  // == Watch ==========================================================================================================
+  if (const auto now = Clock::now(); now - last_poll_ >= poll_interval_) {
+    last_poll_ = now;
+    reload_modified();
+  }
+}
+
+uint32_t ShaderRegistry::reload_modified() {
+  auto reloaded = 0U;
+  for (auto& shader : shaders_) {
+    auto ec         = std::error_code{};
+    auto write_time = std::filesystem::last_write_time(shader.path, ec);
+    if (ec || write_time == shader.write_time) {
+      continue;
+    }
+
+    // The file might still be written by the shader compiler, in that case it is retried on the next poll
+    auto binary = res::SPIRVShaderBinary::read_from_path(shader.path);
+    if (!binary || !res::ShaderReflection::reflect(*binary)) {
+      continue;
+    }
+
+    auto shader_module = ShaderModule::create(*p_device_, *binary);
+    if (!shader_module) {
+      continue;
+    }
+
+    util::Logger::info("Reloading shader {}", shader.path.string());
+    shader.write_time = write_time;
+    ++reloaded;
+
+    auto old_module = std::exchange(shader.shader_module, std::move(shader_module->shader_module));
+    for (auto& pipeline : pipelines_) {
+      if (replace_module(pipeline, *old_module, *shader.shader_module)) {
+        compile(pipeline);
+      }
+    }
+    retired_modules_.push_back(std::move(old_module));
+  }
+
+  return reloaded;
+}
+
+size_t ShaderRegistry::pending_count() const {
+  return static_cast<size_t>(std::ranges::count_if(
+      pipelines_, [](const ReloadablePipeline& pipeline) { return pipeline.pending.is_valid(); }));
+}
+
+bool ShaderRegistry::replace_module(ReloadablePipeline& pipeline, vk::ShaderModule old_module,
+                                    vk::ShaderModule new_module) {
+  auto replaced = false;
+  auto replace  = [&](vk::PipelineShaderStageCreateInfo& stage) {
+    if (stage.module == old_module) {
+      stage.module = new_module;
+      replaced     = true;
+    }
+  };
+
+  if (auto* graphics = std::get_if<GraphicsPipelineBuilder>(&pipeline.builder)) {
+    std::ranges::for_each(graphics->_shader_stages, replace);
+  } else {
+    replace(std::get<ComputePipelineBuilder>(pipeline.builder)._shader_stage);
+  }
+
+  return replaced;
+}
+
+}  // namespace eray::vkren
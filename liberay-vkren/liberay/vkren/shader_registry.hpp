@@ -0,0 +1,177 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <liberay/util/slot_map.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/deletion_queue.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <liberay/vkren/pipeline_compiler.hpp>
+#include <variant>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+struct ReloadablePipelineTag {};
+
+/**
+ * @brief Handle of a pipeline registered in the `ShaderRegistry`.
+ *
+ */
+using ReloadablePipelineHandle = util::SlotMapKey<ReloadablePipelineTag>;
+
+/**
+ * @brief Hot reloads the SPIR-V shaders loaded from files. The registry watches the modification times of the
+ * loaded files. When a file changes, the dependent pipelines are rebuilt in the background by the `PipelineCompiler`
+ * and swapped in by `update()` once they are ready, so neither the device nor the frames are stalled. The replaced
+ * pipelines and shader modules are released through the `FrameDeletionQueue`.
+ *
+ * A pipeline depends on the shader modules referenced by the stages of its builder. When a reload fails, e.g. the file
+ * is still being written or the pipeline does not compile, the previous pipeline stays in use.
+ *
+ * @warning The compiler and the deletion queue must outlive the registry. Lifetime is bound by the device lifetime.
+ *
+ */
+class ShaderRegistry {
+ public:
+  ShaderRegistry() = delete;
+  explicit ShaderRegistry(std::nullptr_t) {}
+
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr auto kDefaultPollInterval = std::chrono::milliseconds(250);
+
+  /**
+   * @brief Creates the registry.
+   *
+   * @param device
+   * @param compiler
+   * @param deletion_queue
+   * @param poll_interval Minimal time between two checks of the file modification times.
+   * @return ShaderRegistry
+   */
+  [[nodiscard]] static ShaderRegistry create(const Device& device, PipelineCompiler& compiler,
+                                             FrameDeletionQueue& deletion_queue,
+                                             Clock::duration poll_interval = kDefaultPollInterval);
+
+  /**
+   * @brief Loads the shader module and starts watching the file. The same module is returned for the same path.
+   *
+   * @param path
+   * @return Result<vk::ShaderModule, Error>
+   */
+  Result<vk::ShaderModule, Error> load(const std::filesystem::path& path);
+
+  /**
+   * @brief Queues the compilation of the pipeline. The shader modules of the `builder` should be loaded with
+   * `load()`, otherwise the pipeline is never rebuilt.
+   *
+   * @param builder
+   * @param layout Must outlive the registry.
+   * @return ReloadablePipelineHandle
+   */
+  ReloadablePipelineHandle register_pipeline(const GraphicsPipelineBuilder& builder, vk::PipelineLayout layout);
+  ReloadablePipelineHandle register_pipeline(const ComputePipelineBuilder& builder, vk::PipelineLayout layout);
+
+  /**
+   * @brief Stops rebuilding the pipeline. Its pipelines are released once the frames in flight are done with them, the
+   * handle becomes invalid.
+   *
+   * @param handle
+   */
+  void unregister_pipeline(ReloadablePipelineHandle handle);
+
+  /**
+   * @brief Returns the pipeline that is currently in use, null until the first compilation completes. The draws that
+   * receive a null pipeline should be skipped.
+   *
+   * @param handle
+   * @return vk::Pipeline
+   */
+  vk::Pipeline pipeline(ReloadablePipelineHandle handle) const;
+
+  /**
+   * @brief Swaps in the rebuilt pipelines and checks the watched files for modifications. Call once per frame, after
+   * the `FrameDeletionQueue::begin_frame()` and before the recording.
+   *
+   */
+  void update();
+
+  /**
+   * @brief Checks the watched files for modifications right away, regardless of the poll interval.
+   *
+   * @return uint32_t Number of the reloaded shader modules.
+   */
+  uint32_t reload_modified();
+
+  size_t shader_count() const { return shaders_.size(); }
+  size_t pipeline_count() const { return pipelines_.size(); }
+
+  /**
+   * @brief Number of the pipelines that are still being compiled or rebuilt.
+   *
+   */
+  size_t pending_count() const;
+
+ private:
+  struct Shader {
+    std::filesystem::path path;
+    std::filesystem::file_time_type write_time;
+    vk::raii::ShaderModule shader_module = nullptr;
+  };
+
+  struct ReloadablePipeline {
+    std::variant<GraphicsPipelineBuilder, ComputePipelineBuilder> builder;
+    vk::PipelineLayout layout;
+
+    AsyncPipeline current = AsyncPipeline(nullptr);
+
+    /**
+     * @brief Rebuilt pipeline, swapped in as soon as it is ready.
+     *
+     */
+    AsyncPipeline pending = AsyncPipeline(nullptr);
+  };
+
+  ShaderRegistry(const Device& device, PipelineCompiler& compiler, FrameDeletionQueue& deletion_queue,
+                 Clock::duration poll_interval)
+      : p_device_(&device),
+        p_compiler_(&compiler),
+        p_deletion_queue_(&deletion_queue),
+        poll_interval_(poll_interval),
+        last_poll_(Clock::now()) {}
+
+  ReloadablePipelineHandle register_pipeline(ReloadablePipeline&& pipeline);
+  void compile(ReloadablePipeline& pipeline);
+
+  /**
+   * @brief Replaces the module in the stages of the pipeline builder.
+   *
+   * @return true The pipeline depends on the module.
+   */
+  static bool replace_module(ReloadablePipeline& pipeline, vk::ShaderModule old_module, vk::ShaderModule new_module);
+
+  observer_ptr<const Device> p_device_               = nullptr;
+  observer_ptr<PipelineCompiler> p_compiler_         = nullptr;
+  observer_ptr<FrameDeletionQueue> p_deletion_queue_ = nullptr;
+
+  std::vector<Shader> shaders_;
+  util::SlotMap<ReloadablePipeline, ReloadablePipelineHandle> pipelines_;
+
+  /**
+   * @brief Replaced modules wait here until none of the compilations in progress can reference them.
+   *
+   */
+  std::vector<vk::raii::ShaderModule> retired_modules_;
+
+  Clock::duration poll_interval_{};
+  Clock::time_point last_poll_;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <expected>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/shading_rate_generator.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+Result<ShadingRateGenerator, Error> ShadingRateGenerator::create(Device& device, vk::ShaderModule shader) {
+  assert(device.has_fragment_shading_rate() && "VK_KHR_fragment_shading_rate is not enabled");
+
+  const auto& props     = device.fragment_shading_rate_properties();
+  auto generator        = ShadingRateGenerator(nullptr);
+  generator.texel_size_ = props.minFragmentShadingRateAttachmentTexelSize;
+  if (props.maxFragmentSize.width < 4 || props.maxFragmentSize.height < 4) {
+    generator.max_rate_ = ShadingRate::Rate2x2;
+  }
+
+  auto layout = DescriptorSetBuilder::create(device)
+                    .with_binding(vk::DescriptorType::eSampledImage, vk::ShaderStageFlagBits::eCompute)
+                    .with_binding(vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute)
+                    .build_push_descriptor_layout();
+  if (!layout) {
+    return std::unexpected(layout.error());
+  }
+
+  auto push_constant_ranges = std::array{vk::PushConstantRange{
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .offset     = 0,
+      .size       = sizeof(PushConstants),
+  }};
+  auto pipeline = ComputePipelineBuilder::create()
+                      .with_shader(shader)
+                      .with_descriptor_set_layout(*layout)
+                      .with_push_constant_ranges(push_constant_ranges)
+                      .build(device);
+  if (!pipeline) {
+    return std::unexpected(pipeline.error());
+  }
+  generator.pipeline_ = std::move(*pipeline);
+  generator.binder_   = DescriptorSetBinder::create(device);
+
+  return generator;
+}
+
+void ShadingRateGenerator::record_build(vk::CommandBuffer cmd_buff, vk::ImageView color_view,
+                                        vk::Extent2D color_extent, vk::ImageView rate_view,
+                                        const ShadingRateParams& params, vk::ImageLayout color_layout) {
+  ERAY_PROFILE_FUNCTION();
+
+  // The render graph synchronizes both of the images, the views might change with the frame
+  binder_.clear();
+  binder_.bind_sampled_image(0, color_view, color_layout);
+  binder_.bind_storage_image(1, rate_view, vk::ImageLayout::eGeneral);
+
+  const auto rate_size = math::Vec2u((color_extent.width + texel_size_.width - 1) / texel_size_.width,
+                                     (color_extent.height + texel_size_.height - 1) / texel_size_.height);
+  const auto max_rate  = std::min(static_cast<uint32_t>(params.max_rate), static_cast<uint32_t>(max_rate_));
+
+  const auto push_constants = PushConstants{
+      .color_size            = math::Vec2u(color_extent.width, color_extent.height),
+      .rate_size             = rate_size,
+      .texel_size            = math::Vec2u(texel_size_.width, texel_size_.height),
+      .focus                 = params.focus,
+      .half_rate_contrast    = params.half_rate_contrast,
+      .quarter_rate_contrast = params.quarter_rate_contrast,
+      .half_rate_radius      = params.half_rate_radius,
+      .quarter_rate_radius   = params.quarter_rate_radius,
+      .max_rate              = max_rate,
+      .use_luminance         = params.use_luminance ? 1U : 0U,
+  };
+  cmd_buff.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline_.pipeline);
+  binder_.push(cmd_buff, vk::PipelineBindPoint::eCompute, pipeline_.layout);
+  cmd_buff.pushConstants<PushConstants>(pipeline_.layout, vk::ShaderStageFlagBits::eCompute, 0, push_constants);
+
+  // A workgroup per rate texel
+  cmd_buff.dispatch(rate_size.x(), rate_size.y(), 1);
+  binder_._p_device->statistics().count_dispatches();
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/descriptor.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/pipeline.hpp>
+#include <liberay/vkren/scene/shading_rate.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Builds the shading rate image of a render pass (see `RenderPassBuilder::with_shading_rate_image()`) from the
+ * luminance of the previous frame and the distance from the focus, see `select_shading_rate()`. The flat regions and
+ * the periphery are shaded at 2x2 or 4x4, the `ShadingRateBudget` coarsens the rates when the frame is over budget.
+ *
+ * A workgroup of `liberay-vkren/shaders/shading_rate.slang` reduces the pixels of a rate texel, compile it with the
+ * `add_slang_shader_target()` of the binary. `record_build()` is meant to be emitted by a render graph compute pass
+ * writing the rate image and reading the color attachment of the previous frame, which must not be transient:
+ * @code
+ * auto rates = graph.create_shading_rate_image(device, width, height);
+ * ComputePassBuilder::create(graph)
+ *     .with_shader_storage(rates)
+ *     .with_image_dependency(color, vk::PipelineStageFlagBits2::eComputeShader,
+ *                            vk::AccessFlagBits2::eShaderSampledRead)
+ *     .on_emit([&](const RenderGraph& graph, vk::CommandBuffer& cmd) {
+ *       generator.record_build(cmd, graph.attachment(color).view, extent, graph.shader_storage_image(rates).view,
+ *                              budget.params());
+ *     })
+ *     .build();
+ * RenderPassBuilder::create(graph).with_color_attachment(color).with_shading_rate_image(rates) // ...
+ * @endcode
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class ShadingRateGenerator {
+ public:
+  ShadingRateGenerator() = delete;
+  explicit ShadingRateGenerator(std::nullptr_t) {}
+
+  /**
+   * @brief Side of the workgroup of the shader, must match the `numthreads` of `shading_rate.slang`.
+   *
+   */
+  static constexpr uint32_t kWorkgroupSide = 8;
+
+  /**
+   * @brief Creates the pipeline.
+   *
+   * @param device Must support `Device::has_fragment_shading_rate()`.
+   * @param shader Module compiled from `shading_rate.slang`.
+   * @return Result<ShadingRateGenerator, Error>
+   */
+  [[nodiscard]] static Result<ShadingRateGenerator, Error> create(Device& device, vk::ShaderModule shader);
+
+  /**
+   * @brief Records the build of the rates of the render area. Must be recorded outside of rendering, with the rate
+   * image in the VK_IMAGE_LAYOUT_GENERAL layout.
+   *
+   * @param cmd_buff
+   * @param color_view Color of the previous frame, read only if `params.use_luminance` is set.
+   * @param color_extent Render area of the previous frame.
+   * @param rate_view Image of `RenderGraph::create_shading_rate_image()`.
+   * @param params The coarsest rate is clamped to the largest fragment size of the device.
+   * @param color_layout Layout of the color attachment.
+   */
+  void record_build(vk::CommandBuffer cmd_buff, vk::ImageView color_view, vk::Extent2D color_extent,
+                    vk::ImageView rate_view, const ShadingRateParams& params,
+                    vk::ImageLayout color_layout = vk::ImageLayout::eReadOnlyOptimal);
+
+  /**
+   * @brief Pixels covered by a rate texel, matches `RenderGraph::shading_rate_texel_size()`.
+   *
+   */
+  vk::Extent2D texel_size() const { return texel_size_; }
+
+ private:
+  /**
+   * @brief Push constants of `shading_rate.slang`.
+   *
+   */
+  struct PushConstants {
+    math::Vec2u color_size;
+    math::Vec2u rate_size;
+    math::Vec2u texel_size;
+    math::Vec2f focus;
+    float half_rate_contrast;
+    float quarter_rate_contrast;
+    float half_rate_radius;
+    float quarter_rate_radius;
+    uint32_t max_rate;
+    uint32_t use_luminance;
+  };
+
+  Pipeline pipeline_{};
+  DescriptorSetBinder binder_{};
+  vk::Extent2D texel_size_;
+  ShadingRate max_rate_ = ShadingRate::Rate4x4;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,703 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image_format_helpers.hpp>
+#include <liberay/vkren/sparse_texture_streamer.hpp>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace eray::vkren {
+
+namespace {
+
+constexpr auto kNoFeedback = UINT32_MAX;
+
+vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Sparse requirements of the color aspect, `nullptr` if the format can not be partially resident.
+ *
+ */
+const vk::SparseImageMemoryRequirements* color_requirements(
+    const std::vector<vk::SparseImageMemoryRequirements2>& requirements) {
+  const auto it = std::ranges::find_if(requirements, [](const vk::SparseImageMemoryRequirements2& r) {
+    return static_cast<bool>(r.memoryRequirements.formatProperties.aspectMask & vk::ImageAspectFlagBits::eColor);
+  });
+  return it == requirements.end() ? nullptr : &it->memoryRequirements;
+}
+
+}  // namespace
+
+Result<SparseTextureStreamer, Error> SparseTextureStreamer::create(Device& device, BindlessHeap& heap,
+                                                                   FrameDeletionQueue& deletion_queue,
+                                                                   const CreateInfo& info, uint32_t frames_in_flight) {
+  if (!device.has_sparse_residency()) {
+    util::Logger::err("Could not create a sparse texture streamer. Sparse residency is not supported by the device");
+    return std::unexpected(Error{
+        .msg  = "Sparse residency is not supported",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
+  // == Page size of the format ========================================================================================
+  const auto probe_desc   = ImageDescription::image2d_desc(info.format, 4096, 4096);
+  const auto probe_info   = ImageResource::sparse_texture_create_info(probe_desc, probe_desc.find_mip_levels());
+  const auto requirements = vk::DeviceImageMemoryRequirements{
+      .pCreateInfo = &probe_info,
+      .planeAspect = vk::ImageAspectFlagBits::eColor,
+  };
+  const auto memory_requirements = device->getImageMemoryRequirements(requirements).memoryRequirements;
+  const auto sparse_requirements = device->getImageSparseMemoryRequirements(requirements);
+  const auto* color              = color_requirements(sparse_requirements);
+  if (color == nullptr || (color->formatProperties.flags & vk::SparseImageFormatFlagBits::eNonstandardBlockSize)) {
+    util::Logger::err("Could not create a sparse texture streamer. The format {} can not be partially resident",
+                      vk::to_string(info.format));
+    return std::unexpected(Error{
+        .msg  = "Format can not be partially resident",
+        .code = ErrorCode::PhysicalDeviceNotSufficient{},
+    });
+  }
+
+  auto streamer_info = info;
+  // The pages are not reused while the frames in flight might still sample them
+  streamer_info.page_table.page_reuse_delay = std::max(info.page_table.page_reuse_delay, frames_in_flight);
+
+  auto streamer              = SparseTextureStreamer(device, heap, deletion_queue, streamer_info, frames_in_flight);
+  streamer.page_size_        = memory_requirements.alignment;
+  streamer.granularity_      = color->formatProperties.imageGranularity;
+  streamer.memory_type_bits_ = memory_requirements.memoryTypeBits;
+
+  // == Page pool ======================================================================================================
+  auto& alloc_manager             = device.vma_alloc_manager();
+  auto alloc_create_info          = VmaAllocationCreateInfo{};
+  alloc_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  alloc_create_info.priority      = 1.0F;
+  for (auto first_page = 0U; first_page < info.page_table.page_count; first_page += info.pages_per_allocation) {
+    const auto page_count = std::min(info.pages_per_allocation, info.page_table.page_count - first_page);
+
+    const auto req = vk::MemoryRequirements{
+        .size           = streamer.page_size_ * page_count,
+        .alignment      = streamer.page_size_,
+        .memoryTypeBits = streamer.memory_type_bits_,
+    };
+    TRY_UNWRAP_DEFINE(memory, alloc_manager.allocate_memory(req, alloc_create_info, MemoryCategory::Texture));
+    alloc_manager.set_allocation_name(memory, std::format("Sparse page pool {}", streamer.pages_.size()));
+
+    auto alloc_info = VmaAllocationInfo{};
+    vmaGetAllocationInfo(alloc_manager.allocator(), memory, &alloc_info);
+    streamer.pages_.push_back(PageAllocation{
+        .allocation = VmaRaiiAllocation(alloc_manager, memory),
+        .memory     = vk::DeviceMemory(alloc_info.deviceMemory),
+        .offset     = alloc_info.offset,
+    });
+  }
+
+  // == Residency map and the buffers of the frames ===================================================================
+  const auto slots_bytes = static_cast<vk::DeviceSize>(info.max_textures) * streamer.slot_words_ * sizeof(uint32_t);
+  TRY_UNWRAP_DEFINE(residency_map, BufferResource::create_storage_buffer(device, slots_bytes));
+  TRY_UNWRAP_DEFINE(residency_map_index, heap.register_storage_buffer(vk::DescriptorBufferInfo{
+                                             .buffer = residency_map.vk_buffer(),
+                                             .offset = 0,
+                                             .range  = slots_bytes,
+                                         }));
+  streamer.residency_map_       = std::move(residency_map);
+  streamer.residency_map_index_ = residency_map_index;
+
+  const auto staging_bytes = streamer.page_size_ * info.page_table.max_binds_per_update;
+  streamer.frames_.reserve(frames_in_flight);
+  for (auto i = 0U; i < frames_in_flight; ++i) {
+    TRY_UNWRAP_DEFINE(feedback, BufferResource::create_readback_storage_buffer(device, slots_bytes));
+    std::memset(feedback.mapped_data, 0xFF, slots_bytes);
+    vmaFlushAllocation(alloc_manager.allocator(), feedback.buffer._buffer._allocation, 0, slots_bytes);
+
+    TRY_UNWRAP_DEFINE(feedback_index, heap.register_storage_buffer(vk::DescriptorBufferInfo{
+                                          .buffer = feedback.buffer.vk_buffer(),
+                                          .offset = 0,
+                                          .range  = slots_bytes,
+                                      }));
+    TRY_UNWRAP_DEFINE(staging, BufferResource::persistently_mapped_staging_buffer(device, staging_bytes));
+    streamer.frames_.push_back(FrameResources{
+        .feedback       = std::move(feedback),
+        .feedback_index = feedback_index,
+        .staging        = std::move(staging),
+    });
+  }
+
+  auto timeline_info = vk::SemaphoreTypeCreateInfo{
+      .semaphoreType = vk::SemaphoreType::eTimeline,
+      .initialValue  = 0,
+  };
+  auto timeline = device->createSemaphore(vk::SemaphoreCreateInfo{.pNext = &timeline_info});
+  if (!timeline) {
+    util::Logger::err("Could not create a sparse binding timeline semaphore. {}", vk::to_string(timeline.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Semaphore creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = timeline.error(),
+    });
+  }
+  streamer.timeline_ = std::move(*timeline);
+
+  return streamer;
+}
+
+Result<SparseTextureId, Error> SparseTextureStreamer::add(res::CachedAsset&& asset) {
+  assert(asset.kind() == res::AssetKind::Image && "Only the image assets can be streamed");
+
+  const auto metadata = asset.metadata<res::ImageAssetMetadata>();
+  const auto desc     = ImageDescription::image2d_desc(to_vk_format(metadata.format, metadata.color_space),
+                                                       metadata.lod0_width, metadata.lod0_height);
+  if (metadata.mip_levels != desc.find_mip_levels() || asset.payload().size() != desc.find_full_size_bytes()) {
+    util::Logger::err("Could not stream a sparse texture. The asset does not hold the full mip chain of a {}x{} image",
+                      metadata.lod0_width, metadata.lod0_height);
+    return std::unexpected(Error{
+        .msg  = "Streamed texture asset is not a full mip chain",
+        .code = ErrorCode::FileError{},
+    });
+  }
+  if (desc.format != info_.format) {
+    util::Logger::err("Could not stream a sparse texture. Its format {} is not the format {} of the page pool",
+                      vk::to_string(desc.format), vk::to_string(info_.format));
+    return std::unexpected(Error{
+        .msg  = "Sparse texture format does not match the page pool",
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  const auto image_info   = ImageResource::sparse_texture_create_info(desc, metadata.mip_levels);
+  const auto requirements = (*p_device_)->getImageSparseMemoryRequirements(vk::DeviceImageMemoryRequirements{
+      .pCreateInfo = &image_info,
+      .planeAspect = vk::ImageAspectFlagBits::eColor,
+  });
+  const auto* color       = color_requirements(requirements);
+  assert(color != nullptr && "The format of the pool can be partially resident");
+  const auto mip_tail_first = std::min(color->imageMipTailFirstLod, metadata.mip_levels);
+
+  const auto id = page_table_.add(desc.width, desc.height, granularity_.width, granularity_.height, mip_tail_first);
+  if (id._value >= info_.max_textures) {
+    page_table_.remove(id);
+    util::Logger::warn("Could not stream a sparse texture. The streamer is full ({} textures)", info_.max_textures);
+    return std::unexpected(Error{
+        .msg  = "Sparse texture streamer is full",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+  if (id._value >= textures_.size()) {
+    textures_.resize(id._value + 1);
+  }
+
+  auto texture = Texture{
+      .source         = std::nullopt,
+      .description    = desc,
+      .mip_levels     = metadata.mip_levels,
+      .mip_tail_first = mip_tail_first,
+      .generation     = textures_[id._value].generation + 1,
+  };
+  auto result = [&]() -> Result<void, Error> {
+    TRY_UNWRAP_DEFINE(image, ImageResource::create_sparse_texture(*p_device_, desc, metadata.mip_levels));
+    texture.image = std::make_unique<ImageResource>(std::move(image));
+    TRY_UNWRAP_DEFINE(view, texture.image->create_image_view());
+    texture.view = std::move(view);
+    TRY(bind_mip_tail(texture, requirements));
+
+    // The levels are packed LOD0 first, so the mip tail is the end of the payload
+    const auto payload = asset.payload();
+    const auto offset  = static_cast<size_t>(desc.find_size_bytes(mip_tail_first));
+    if (offset < payload.size()) {
+      TRY_UNWRAP_DEFINE(staging, BufferResource::create_staging_buffer(
+                                     *p_device_, util::MemoryRegion(payload.data() + offset, payload.size() - offset)));
+      texture.tail_staging = std::move(staging);
+    }
+    return {};
+  }();
+  if (!result) {
+    page_table_.remove(id);
+    if (texture.image) {
+      const auto image = texture.image->vk_image();
+      std::erase_if(pending_opaque_binds_, [image](const PendingOpaqueBind& bind) { return bind.image == image; });
+      p_deletion_queue_->push(std::move(texture.image->_image));
+    }
+    return std::unexpected(result.error());
+  }
+
+  texture.source       = std::move(asset);
+  textures_[id._value] = std::move(texture);
+
+  return id;
+}
+
+void SparseTextureStreamer::remove(SparseTextureId id) {
+  auto& texture = textures_[id._value];
+  assert(texture.source && "Texture has already been removed");
+
+  page_table_.remove(id);
+  if (texture.index.is_valid()) {
+    p_heap_->release(BindlessArray::SampledImage, texture.index);
+  }
+
+  // The binds of the tail that have not been submitted yet would refer to the destroyed image
+  const auto image = texture.image->vk_image();
+  std::erase_if(pending_opaque_binds_, [image](const PendingOpaqueBind& bind) { return bind.image == image; });
+
+  if (*texture.view) {
+    p_deletion_queue_->push(texture.view.release());
+  }
+  p_deletion_queue_->push(std::move(texture.image->_image));
+  retired_tails_.push_back(RetiredMipTail{.allocation = std::move(texture.mip_tail), .frame = frame_number_});
+
+  texture = Texture{.generation = texture.generation};
+}
+
+void SparseTextureStreamer::begin_frame(uint32_t frame_index) {
+  ERAY_PROFILE_FUNCTION();
+  current_frame_ = frame_index;
+  ++frame_number_;
+
+  std::erase_if(retired_tails_,
+                [this](const RetiredMipTail& tail) { return tail.frame + frames_in_flight_ <= frame_number_; });
+
+  const auto allocator  = p_device_->vma_alloc_manager().allocator();
+  auto& feedback        = frames_[frame_index].feedback;
+  const auto size_bytes = textures_.size() * slot_words_ * sizeof(uint32_t);
+  vmaInvalidateAllocation(allocator, feedback.buffer._buffer._allocation, 0, size_bytes);
+
+  auto* words = static_cast<uint32_t*>(feedback.mapped_data);
+  for (auto i = 0U; i < textures_.size(); ++i) {
+    if (!textures_[i].source) {
+      continue;
+    }
+
+    const auto id     = SparseTextureId{i};
+    const auto* cells = words + slot_offset(id) + 2;
+    for (auto y = 0U; y < page_table_.cells_y(id); ++y) {
+      for (auto x = 0U; x < page_table_.cells_x(id); ++x) {
+        if (const auto mip = cells[y * page_table_.cells_x(id) + x]; mip != kNoFeedback) {
+          page_table_.request(id, x, y, mip);
+        }
+      }
+    }
+  }
+
+  std::memset(words, 0xFF, size_bytes);
+  vmaFlushAllocation(allocator, feedback.buffer._buffer._allocation, 0, size_bytes);
+}
+
+Result<void, Error> SparseTextureStreamer::update(vk::CommandBuffer cmd_buff) {
+  ERAY_PROFILE_FUNCTION();
+
+  struct TileUpload {
+    SparseTextureId texture;
+    SparseTile tile;
+  };
+  auto image_binds = std::vector<std::pair<uint32_t, vk::SparseImageMemoryBind>>();
+  auto uploads     = std::vector<TileUpload>();
+  auto touched     = std::vector<uint32_t>();
+
+  // == Page updates of the requested and the evicted tiles ============================================================
+  for (const auto& update : page_table_.update()) {
+    const auto& texture = textures_[update.texture._value];
+    if (update.bind) {
+      image_binds.emplace_back(update.texture._value, tile_bind(texture, update.tile, update.page));
+      uploads.push_back(TileUpload{.texture = update.texture, .tile = update.tile});
+    } else {
+      pending_unbinds_.push_back(PendingUnbind{
+          .texture    = update.texture,
+          .generation = texture.generation,
+          .tile       = update.tile,
+          .frame      = frame_number_ + frames_in_flight_,
+      });
+    }
+    touched.push_back(update.texture._value);
+  }
+
+  // The residency map has stopped pointing at the evicted tiles a few frames ago, so no frame in flight samples them
+  std::erase_if(pending_unbinds_, [&](const PendingUnbind& unbind) {
+    if (unbind.frame > frame_number_) {
+      return false;
+    }
+    const auto& texture = textures_[unbind.texture._value];
+    if (texture.source && texture.generation == unbind.generation &&
+        page_table_.page_of(unbind.texture, unbind.tile) == SparsePageTable::kNoPage) {
+      image_binds.emplace_back(unbind.texture._value, tile_bind(texture, unbind.tile, SparsePageTable::kNoPage));
+    }
+    return true;
+  });
+
+  // == Submit the binds ===============================================================================================
+  if (!image_binds.empty() || !pending_opaque_binds_.empty()) {
+    std::ranges::stable_sort(image_binds, {}, [](const auto& bind) { return bind.first; });
+
+    auto binds = std::vector<vk::SparseImageMemoryBind>();
+    binds.reserve(image_binds.size());
+    auto image_infos = std::vector<vk::SparseImageMemoryBindInfo>();
+    for (auto first = size_t{0}; first < image_binds.size();) {
+      auto last = first;
+      while (last < image_binds.size() && image_binds[last].first == image_binds[first].first) {
+        binds.push_back(image_binds[last].second);
+        ++last;
+      }
+      image_infos.push_back(vk::SparseImageMemoryBindInfo{
+          .image     = textures_[image_binds[first].first].image->vk_image(),
+          .bindCount = static_cast<uint32_t>(last - first),
+          .pBinds    = binds.data() + first,
+      });
+      first = last;
+    }
+
+    auto opaque_infos = std::vector<vk::SparseImageOpaqueMemoryBindInfo>();
+    opaque_infos.reserve(pending_opaque_binds_.size());
+    for (const auto& pending : pending_opaque_binds_) {
+      opaque_infos.push_back(vk::SparseImageOpaqueMemoryBindInfo{
+          .image     = pending.image,
+          .bindCount = 1,
+          .pBinds    = &pending.bind,
+      });
+    }
+
+    ++bound_value_;
+    const auto timeline_info = vk::TimelineSemaphoreSubmitInfo{
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues    = &bound_value_,
+    };
+    p_device_->graphics_queue().bindSparse(vk::BindSparseInfo{
+        .pNext                = &timeline_info,
+        .imageOpaqueBindCount = static_cast<uint32_t>(opaque_infos.size()),
+        .pImageOpaqueBinds    = opaque_infos.data(),
+        .imageBindCount       = static_cast<uint32_t>(image_infos.size()),
+        .pImageBinds          = image_infos.data(),
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores    = &*timeline_,
+    });
+    pending_opaque_binds_.clear();
+  }
+
+  // == Record the uploads =============================================================================================
+  auto tails = std::vector<uint32_t>();
+  for (auto i = 0U; i < textures_.size(); ++i) {
+    if (textures_[i].source && !textures_[i].published) {
+      tails.push_back(i);
+      touched.push_back(i);
+    }
+  }
+  if (touched.empty()) {
+    return {};
+  }
+
+  // The previous frames may still read the levels and the residency map that are written
+  auto to_transfer_dst = std::vector<vk::ImageMemoryBarrier2>();
+  auto to_shader_read  = std::vector<vk::ImageMemoryBarrier2>();
+  const auto transitions = [&](vk::Image image, vk::ImageLayout old_layout, uint32_t first_mip, uint32_t mip_count) {
+    const auto range = vk::ImageSubresourceRange{
+        .aspectMask     = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel   = first_mip,
+        .levelCount     = mip_count,
+        .baseArrayLayer = 0,
+        .layerCount     = 1,
+    };
+    to_transfer_dst.push_back(vk::ImageMemoryBarrier2{
+        .srcStageMask        = vk::PipelineStageFlagBits2::eAllCommands,
+        .srcAccessMask       = vk::AccessFlagBits2::eNone,
+        .dstStageMask        = vk::PipelineStageFlagBits2::eCopy,
+        .dstAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+        .oldLayout           = old_layout,
+        .newLayout           = vk::ImageLayout::eTransferDstOptimal,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image               = image,
+        .subresourceRange    = range,
+    });
+    to_shader_read.push_back(vk::ImageMemoryBarrier2{
+        .srcStageMask        = vk::PipelineStageFlagBits2::eCopy,
+        .srcAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask        = vk::PipelineStageFlagBits2::eAllCommands,
+        .dstAccessMask       = vk::AccessFlagBits2::eShaderSampledRead,
+        .oldLayout           = vk::ImageLayout::eTransferDstOptimal,
+        .newLayout           = vk::ImageLayout::eShaderReadOnlyOptimal,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image               = image,
+        .subresourceRange    = range,
+    });
+  };
+
+  // A new texture is transitioned as a whole, its unbacked levels have no contents to preserve
+  for (const auto i : tails) {
+    transitions(textures_[i].image->vk_image(), vk::ImageLayout::eUndefined, 0, textures_[i].mip_levels);
+  }
+
+  std::ranges::sort(uploads, {},
+                    [](const TileUpload& upload) { return std::pair(upload.texture._value, upload.tile.mip); });
+  for (auto i = size_t{0}; i < uploads.size(); ++i) {
+    const auto& upload  = uploads[i];
+    const auto& texture = textures_[upload.texture._value];
+    if (!texture.published ||
+        (i > 0 && uploads[i - 1].texture == upload.texture && uploads[i - 1].tile.mip == upload.tile.mip)) {
+      continue;
+    }
+    transitions(texture.image->vk_image(), vk::ImageLayout::eShaderReadOnlyOptimal, upload.tile.mip, 1);
+  }
+
+  const auto before_writes = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eAllCommands,
+      .srcAccessMask = vk::AccessFlagBits2::eNone,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eAllTransfer,
+      .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount      = 1,
+      .pMemoryBarriers         = &before_writes,
+      .imageMemoryBarrierCount = static_cast<uint32_t>(to_transfer_dst.size()),
+      .pImageMemoryBarriers    = to_transfer_dst.data(),
+  });
+
+  for (const auto i : tails) {
+    auto& texture = textures_[i];
+    if (!texture.tail_staging) {
+      continue;
+    }
+
+    const auto& desc = texture.description;
+    const auto base  = desc.find_size_bytes(texture.mip_tail_first);
+    auto copies      = std::vector<vk::BufferImageCopy>();
+    for (auto mip = texture.mip_tail_first; mip < texture.mip_levels; ++mip) {
+      copies.push_back(vk::BufferImageCopy{
+          .bufferOffset      = desc.find_size_bytes(mip) - base,
+          .bufferRowLength   = 0,
+          .bufferImageHeight = 0,
+          .imageSubresource =
+              vk::ImageSubresourceLayers{
+                  .aspectMask     = vk::ImageAspectFlagBits::eColor,
+                  .mipLevel       = mip,
+                  .baseArrayLayer = 0,
+                  .layerCount     = 1,
+              },
+          .imageOffset = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+          .imageExtent = desc.mip_extent(mip),
+      });
+    }
+    cmd_buff.copyBufferToImage(texture.tail_staging->vk_buffer(), texture.image->vk_image(),
+                               vk::ImageLayout::eTransferDstOptimal, copies);
+  }
+
+  auto& staging       = frames_[current_frame_].staging;
+  auto staging_offset = vk::DeviceSize{0};
+  for (const auto& upload : uploads) {
+    const auto& texture = textures_[upload.texture._value];
+    const auto copy     = stage_tile(texture, upload.tile, staging_offset);
+    cmd_buff.copyBufferToImage(staging.buffer.vk_buffer(), texture.image->vk_image(),
+                               vk::ImageLayout::eTransferDstOptimal, copy);
+  }
+  if (staging_offset > 0) {
+    vmaFlushAllocation(p_device_->vma_alloc_manager().allocator(), staging.buffer._buffer._allocation, 0,
+                       staging_offset);
+    p_device_->statistics().count_staging_bytes(staging_offset);
+  }
+
+  // == Residency map ==================================================================================================
+  for (const auto& upload : uploads) {
+    page_table_.complete(upload.texture, upload.tile);
+  }
+  std::ranges::sort(touched);
+  touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+  for (const auto i : touched) {
+    if (textures_[i].source) {
+      record_residency_map(cmd_buff, SparseTextureId{i});
+    }
+  }
+
+  const auto after_writes = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eAllTransfer,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eAllCommands,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .memoryBarrierCount      = 1,
+      .pMemoryBarriers         = &after_writes,
+      .imageMemoryBarrierCount = static_cast<uint32_t>(to_shader_read.size()),
+      .pImageMemoryBarriers    = to_shader_read.data(),
+  });
+
+  // == Publish the new textures =======================================================================================
+  for (const auto i : tails) {
+    auto& texture = textures_[i];
+    if (texture.tail_staging) {
+      p_deletion_queue_->push(std::move(texture.tail_staging->_buffer));
+      texture.tail_staging.reset();
+    }
+    texture.published = true;
+
+    TRY_UNWRAP_DEFINE(index, p_heap_->register_sampled_image(*texture.view));
+    texture.index = index;
+  }
+
+  return {};
+}
+
+std::optional<vk::SemaphoreSubmitInfo> SparseTextureStreamer::graphics_wait_info() {
+  if (waited_value_ == bound_value_) {
+    return std::nullopt;
+  }
+
+  waited_value_ = bound_value_;
+  return vk::SemaphoreSubmitInfo{
+      .semaphore = *timeline_,
+      .value     = bound_value_,
+      .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+  };
+}
+
+Result<void, Error> SparseTextureStreamer::bind_mip_tail(
+    Texture& texture, const std::vector<vk::SparseImageMemoryRequirements2>& requirements) {
+  auto binds      = std::vector<vk::SparseMemoryBind>();
+  auto size_bytes = vk::DeviceSize{0};
+  for (const auto& requirement : requirements) {
+    const auto& memory  = requirement.memoryRequirements;
+    const auto metadata  = static_cast<bool>(memory.formatProperties.aspectMask & vk::ImageAspectFlagBits::eMetadata);
+    if (!metadata && memory.imageMipTailFirstLod >= texture.mip_levels) {
+      continue;
+    }
+    binds.push_back(vk::SparseMemoryBind{
+        .resourceOffset = memory.imageMipTailOffset,
+        .size           = memory.imageMipTailSize,
+        .memoryOffset   = size_bytes,
+        .flags          = metadata ? vk::SparseMemoryBindFlagBits::eMetadata : vk::SparseMemoryBindFlags{},
+    });
+    size_bytes += align_up(memory.imageMipTailSize, page_size_);
+  }
+  if (binds.empty()) {
+    return {};
+  }
+
+  auto& alloc_manager             = p_device_->vma_alloc_manager();
+  auto alloc_create_info          = VmaAllocationCreateInfo{};
+  alloc_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+  const auto req = vk::MemoryRequirements{
+      .size           = size_bytes,
+      .alignment      = page_size_,
+      .memoryTypeBits = memory_type_bits_,
+  };
+  TRY_UNWRAP_DEFINE(memory, alloc_manager.allocate_memory(req, alloc_create_info, MemoryCategory::Texture));
+  texture.mip_tail = VmaRaiiAllocation(alloc_manager, memory);
+
+  auto alloc_info = VmaAllocationInfo{};
+  vmaGetAllocationInfo(alloc_manager.allocator(), memory, &alloc_info);
+  for (auto& bind : binds) {
+    bind.memory        = vk::DeviceMemory(alloc_info.deviceMemory);
+    bind.memoryOffset += alloc_info.offset;
+    pending_opaque_binds_.push_back(PendingOpaqueBind{.image = texture.image->vk_image(), .bind = bind});
+  }
+
+  return {};
+}
+
+vk::Offset3D SparseTextureStreamer::tile_offset(const SparseTile& tile) const {
+  return vk::Offset3D{
+      .x = static_cast<int32_t>(tile.x * granularity_.width),
+      .y = static_cast<int32_t>(tile.y * granularity_.height),
+      .z = 0,
+  };
+}
+
+vk::Extent3D SparseTextureStreamer::tile_extent(const Texture& texture, const SparseTile& tile) const {
+  // The tiles on the right and the bottom edge of a level are cut by the level
+  const auto extent = texture.description.mip_extent(tile.mip);
+  return vk::Extent3D{
+      .width  = std::min(granularity_.width, extent.width - tile.x * granularity_.width),
+      .height = std::min(granularity_.height, extent.height - tile.y * granularity_.height),
+      .depth  = 1,
+  };
+}
+
+vk::SparseImageMemoryBind SparseTextureStreamer::tile_bind(const Texture& texture, const SparseTile& tile,
+                                                           uint32_t page) const {
+  auto bind = vk::SparseImageMemoryBind{
+      .subresource =
+          vk::ImageSubresource{
+              .aspectMask = vk::ImageAspectFlagBits::eColor,
+              .mipLevel   = tile.mip,
+              .arrayLayer = 0,
+          },
+      .offset = tile_offset(tile),
+      .extent = tile_extent(texture, tile),
+  };
+  if (page != SparsePageTable::kNoPage) {
+    const auto& allocation = pages_[page / info_.pages_per_allocation];
+    bind.memory            = allocation.memory;
+    bind.memoryOffset      = allocation.offset + (page % info_.pages_per_allocation) * page_size_;
+  }
+  return bind;
+}
+
+vk::BufferImageCopy SparseTextureStreamer::stage_tile(const Texture& texture, const SparseTile& tile,
+                                                      vk::DeviceSize& staging_offset) {
+  const auto& desc  = texture.description;
+  const auto offset = tile_offset(tile);
+  const auto extent = tile_extent(texture, tile);
+  const auto block  = helper::compressed_texel_block(desc.format)
+                         .value_or(helper::TexelBlock{
+                             .width      = 1,
+                             .height     = 1,
+                             .size_bytes = static_cast<uint32_t>(helper::bytes_per_pixel(desc.format)),
+                         });
+
+  // The rows of the texel blocks of the tile are packed one after another
+  const auto level_pitch = helper::image_size_bytes(desc.format, desc.mip_extent(tile.mip).width, 1);
+  const auto row_bytes   = helper::image_size_bytes(desc.format, extent.width, 1);
+  const auto first_row   = static_cast<uint32_t>(offset.y) / block.height;
+  const auto row_count   = (extent.height + block.height - 1) / block.height;
+  assert(staging_offset + row_bytes * row_count <= frames_[current_frame_].staging.buffer.size_bytes &&
+         "Tiles bound in an update must fit the staging buffer");
+
+  const auto* level = texture.source->payload().data() + desc.find_size_bytes(tile.mip);
+  auto* dst         = static_cast<std::byte*>(frames_[current_frame_].staging.mapped_data) + staging_offset;
+  const auto src_x  = static_cast<vk::DeviceSize>(offset.x) / block.width * block.size_bytes;
+  for (auto row = 0U; row < row_count; ++row) {
+    std::memcpy(dst + row * row_bytes, level + (first_row + row) * level_pitch + src_x, row_bytes);
+  }
+
+  const auto copy = vk::BufferImageCopy{
+      .bufferOffset      = staging_offset,
+      .bufferRowLength   = 0,
+      .bufferImageHeight = 0,
+      .imageSubresource =
+          vk::ImageSubresourceLayers{
+              .aspectMask     = vk::ImageAspectFlagBits::eColor,
+              .mipLevel       = tile.mip,
+              .baseArrayLayer = 0,
+              .layerCount     = 1,
+          },
+      .imageOffset = offset,
+      .imageExtent = extent,
+  };
+  // The buffer offsets of the copies must be a multiple of the texel block size
+  staging_offset = align_up(staging_offset + row_bytes * row_count, 16);
+  return copy;
+}
+
+void SparseTextureStreamer::record_residency_map(vk::CommandBuffer cmd_buff, SparseTextureId id) {
+  const auto cells = page_table_.cells_x(id) * page_table_.cells_y(id);
+  resident_mips_.resize(2 + cells);
+  resident_mips_[0] = page_table_.cells_x(id);
+  resident_mips_[1] = page_table_.cells_y(id);
+  page_table_.write_resident_mips(id, std::span(resident_mips_).subspan(2));
+
+  cmd_buff.updateBuffer(residency_map_.vk_buffer(), static_cast<vk::DeviceSize>(slot_offset(id)) * sizeof(uint32_t),
+                        resident_mips_.size() * sizeof(uint32_t), resident_mips_.data());
+}
+
+}  // namespace eray::vkren
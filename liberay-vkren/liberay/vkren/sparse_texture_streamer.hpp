@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/vkren/bindless_heap.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/deletion_queue.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image.hpp>
+#include <liberay/vkren/image_description.hpp>
+#include <liberay/vkren/scene/sparse_page_table.hpp>
+#include <liberay/vkren/vma_raii_object.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Streams the tiles of the partially resident textures cached as `res::AssetKind::Image` assets. Every texture
+ * is a sparse image of the full mip chain, only its mip tail is always backed. The other tiles are bound with
+ * `vk::Queue::bindSparse` to the pages of a fixed pool of device memory when the shaders request them and unbound once
+ * their pages go to the more recently requested tiles, see `SparsePageTable`.
+ *
+ * Compared to the `TextureStreamer`, a texture is never copied to a new image and only the sampled regions of its
+ * finer levels take memory. All of the textures of a streamer share the format of the page pool.
+ *
+ * The shaders sampling a streamed texture use the storage buffers at `residency_map_buffer()` and `feedback_buffer()`
+ * of the bindless heap. The slot of a texture starts at `slot_offset()`, its first two words are the size of the cell
+ * grid laid over the texture, followed by a word per cell. The shaders request the level they need with
+ * `InterlockedMin()` on the word of the cell in the feedback buffer and clamp the sampled levels to the word of the
+ * cell in the residency map, see `sampleSparse()` of `liberay-vkren/shaders/sparse_texture.slang`.
+ *
+ * Frame order: `begin_frame()` after the fence of the frame, then `update()` with the command buffer of the frame,
+ * before the draws. The submission of the command buffer must wait on `graphics_wait_info()`.
+ *
+ * @warning Lifetime is bound by the device lifetime. The heap and the deletion queue must outlive the streamer.
+ *
+ */
+class SparseTextureStreamer {
+ public:
+  SparseTextureStreamer() = delete;
+  explicit SparseTextureStreamer(std::nullptr_t) {}
+
+  struct CreateInfo {
+    SparsePageTable::CreateInfo page_table = {.page_count = 1024, .max_cells_per_side = 16};
+
+    /**
+     * @brief Format of every streamed texture.
+     *
+     */
+    vk::Format format = vk::Format::eR8G8B8A8Srgb;
+
+    /**
+     * @brief Pages of a single allocation of the pool.
+     *
+     */
+    uint32_t pages_per_allocation = 64;
+
+    /**
+     * @brief Capacity of the residency map and the feedback buffers.
+     *
+     */
+    uint32_t max_textures = 1024;
+  };
+
+  /**
+   * @brief Allocates the page pool, the residency map and the buffers of the frames in flight, and registers the
+   * buffers in the heap.
+   *
+   * @param device Must support `Device::has_sparse_residency()`.
+   * @param heap
+   * @param deletion_queue
+   * @param info
+   * @param frames_in_flight
+   * @return Result<SparseTextureStreamer, Error>
+   */
+  [[nodiscard]] static Result<SparseTextureStreamer, Error> create(Device& device, BindlessHeap& heap,
+                                                                   FrameDeletionQueue& deletion_queue,
+                                                                   const CreateInfo& info, uint32_t frames_in_flight);
+
+  /**
+   * @brief Creates the sparse image of the texture, binds its mip tail and stages the tail for the next `update()`.
+   * The rest of the levels is streamed from the `asset`, which is kept mapped.
+   *
+   * @param asset `res::AssetKind::Image` asset in the format of the pool, see
+   * `res::AssetCache::load_mipmapped_image()`.
+   * @return Result<SparseTextureId, Error>
+   */
+  Result<SparseTextureId, Error> add(res::CachedAsset&& asset);
+
+  /**
+   * @brief Releases the image, its pages and the bindless slot once the frames in flight are done.
+   *
+   */
+  void remove(SparseTextureId id);
+
+  /**
+   * @brief Requests the level `mip` of the whole texture, e.g. from the distance heuristic.
+   *
+   */
+  void request_mip(SparseTextureId id, uint32_t mip) { page_table_.request_all(id, mip); }
+
+  /**
+   * @brief Reads the feedback written by the previous submission of the frame and clears it. Call after the fence of
+   * the frame has been waited for.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Binds the pages of the requested tiles and unbinds the evicted ones on the graphics queue, then records the
+   * uploads of the tiles and the mip tails, and the updates of the residency map.
+   *
+   * @param cmd_buff Command buffer of the frame, recorded before the draws sampling the textures.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> update(vk::CommandBuffer cmd_buff);
+
+  /**
+   * @brief Semaphore wait on the binds of the latest `update()` that the submission of its command buffer must
+   * contain. Returns `std::nullopt` if every bind has already been waited for.
+   *
+   * @return std::optional<vk::SemaphoreSubmitInfo>
+   */
+  std::optional<vk::SemaphoreSubmitInfo> graphics_wait_info();
+
+  /**
+   * @brief Slot of the texture in the sampled image array of the heap, invalid until its mip tail is uploaded.
+   *
+   */
+  BindlessIndex bindless_index(SparseTextureId id) const { return textures_[id._value].index; }
+
+  /**
+   * @brief Offset of the slot of the texture in the residency map and the feedback buffers, in words.
+   *
+   */
+  uint32_t slot_offset(SparseTextureId id) const { return id._value * slot_words_; }
+
+  /**
+   * @brief Slot of the residency map in the storage buffer array of the heap.
+   *
+   */
+  BindlessIndex residency_map_buffer() const { return residency_map_index_; }
+
+  /**
+   * @brief Slot of the feedback buffer of the current frame in the storage buffer array of the heap.
+   *
+   */
+  BindlessIndex feedback_buffer() const { return frames_[current_frame_].feedback_index; }
+
+  /**
+   * @brief Size of a page of the pool, the sparse block size of the format.
+   *
+   */
+  vk::DeviceSize page_size_bytes() const { return page_size_; }
+
+  const SparsePageTable& page_table() const { return page_table_; }
+
+ private:
+  struct PageAllocation {
+    VmaRaiiAllocation allocation = VmaRaiiAllocation(nullptr);
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset;
+  };
+
+  struct Texture {
+    std::optional<res::CachedAsset> source;
+    ImageDescription description;
+    uint32_t mip_levels;
+    uint32_t mip_tail_first;
+    std::unique_ptr<ImageResource> image;
+    vk::raii::ImageView view   = nullptr;
+    VmaRaiiAllocation mip_tail = VmaRaiiAllocation(nullptr);
+
+    /**
+     * @brief Texels of the mip tail until they are uploaded by `update()`.
+     *
+     */
+    std::optional<BufferResource> tail_staging;
+    BindlessIndex index;
+
+    /**
+     * @brief Incremented when the slot is reused, tells the pending unbinds of a removed texture apart.
+     *
+     */
+    uint32_t generation = 0;
+
+    /**
+     * @brief True once the image has been transitioned and its mip tail uploaded, the tiles are uploaded afterwards.
+     *
+     */
+    bool published = false;
+  };
+
+  struct FrameResources {
+    PersistentlyMappedBufferResource feedback;
+    BindlessIndex feedback_index;
+    PersistentlyMappedBufferResource staging;
+  };
+
+  /**
+   * @brief Unbind of an evicted tile, delayed until the frames in flight do not sample it anymore. Skipped if the tile
+   * has been bound again or its texture removed in the meantime.
+   *
+   */
+  struct PendingUnbind {
+    SparseTextureId texture;
+    uint32_t generation;
+    SparseTile tile;
+    uint64_t frame;
+  };
+
+  struct PendingOpaqueBind {
+    vk::Image image;
+    vk::SparseMemoryBind bind;
+  };
+
+  struct RetiredMipTail {
+    VmaRaiiAllocation allocation;
+    uint64_t frame;
+  };
+
+  SparseTextureStreamer(Device& device, BindlessHeap& heap, FrameDeletionQueue& deletion_queue,
+                        const CreateInfo& info, uint32_t frames_in_flight)
+      : p_device_(&device),
+        p_heap_(&heap),
+        p_deletion_queue_(&deletion_queue),
+        info_(info),
+        frames_in_flight_(frames_in_flight),
+        page_table_(SparsePageTable::create(info.page_table)),
+        slot_words_(2 + info.page_table.max_cells_per_side * info.page_table.max_cells_per_side) {}
+
+  /**
+   * @brief Allocates the memory of the mip tail (and the metadata) of the new image, the binds are submitted by the
+   * next `update()`.
+   *
+   */
+  Result<void, Error> bind_mip_tail(Texture& texture,
+                                    const std::vector<vk::SparseImageMemoryRequirements2>& requirements);
+
+  vk::SparseImageMemoryBind tile_bind(const Texture& texture, const SparseTile& tile, uint32_t page) const;
+  vk::Offset3D tile_offset(const SparseTile& tile) const;
+  vk::Extent3D tile_extent(const Texture& texture, const SparseTile& tile) const;
+
+  /**
+   * @brief Copies the texels of the tile from the asset to the staging memory of the frame.
+   *
+   */
+  vk::BufferImageCopy stage_tile(const Texture& texture, const SparseTile& tile, vk::DeviceSize& staging_offset);
+
+  void record_residency_map(vk::CommandBuffer cmd_buff, SparseTextureId id);
+
+  observer_ptr<Device> p_device_                     = nullptr;
+  observer_ptr<BindlessHeap> p_heap_                 = nullptr;
+  observer_ptr<FrameDeletionQueue> p_deletion_queue_ = nullptr;
+  CreateInfo info_;
+  uint32_t frames_in_flight_ = 0;
+
+  SparsePageTable page_table_ = SparsePageTable(nullptr);
+  uint32_t slot_words_        = 0;
+  vk::DeviceSize page_size_   = 0;
+  vk::Extent3D granularity_;
+  uint32_t memory_type_bits_ = 0;
+
+  std::vector<PageAllocation> pages_;
+  std::vector<Texture> textures_;
+  std::vector<FrameResources> frames_;
+  BufferResource residency_map_{};
+  BindlessIndex residency_map_index_;
+
+  vk::raii::Semaphore timeline_ = nullptr;
+  uint64_t bound_value_         = 0;
+  uint64_t waited_value_        = 0;
+
+  std::vector<PendingOpaqueBind> pending_opaque_binds_;
+  std::vector<PendingUnbind> pending_unbinds_;
+  std::vector<RetiredMipTail> retired_tails_;
+  std::vector<uint32_t> resident_mips_;
+
+  uint32_t current_frame_ = 0;
+  uint64_t frame_number_  = 0;
+};
+
+}  // namespace eray::vkren
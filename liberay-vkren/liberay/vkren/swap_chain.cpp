@@ -1,17 +1,22 @@
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
 #include <expected>
+#include <iterator>
 #include <liberay/os/window/events/event.hpp>
 #include <liberay/util/logger.hpp>
 #include <liberay/util/panic.hpp>
+#include <liberay/util/profiler.hpp>
 #include <liberay/util/try.hpp>
 #include <liberay/util/variant_match.hpp>
 #include <liberay/vkren/error.hpp>
 #include <liberay/vkren/image.hpp>
 #include <liberay/vkren/image_description.hpp>
 #include <liberay/vkren/swap_chain.hpp>
+#include <liberay/vkren/wait_statistics.hpp>
 #include <memory>
+#include <utility>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
@@ -20,14 +25,41 @@
 namespace eray::vkren {
 
 Result<std::unique_ptr<SwapChain>, Error> SwapChain::create(Device& device, std::shared_ptr<os::Window> window,
-                                                            vk::SampleCountFlagBits sample_count, bool vsync) noexcept {
-  auto swap_chain = std::make_unique<SwapChain>(SwapChain());
+                                                            vk::SampleCountFlagBits sample_count,
+                                                            PresentMode present_mode,
+                                                            uint32_t frames_in_flight) noexcept {
+  auto swap_chain = std::unique_ptr<SwapChain>(new SwapChain());  // NOLINT
+
+  swap_chain->p_device_               = &device;
+  auto framebuffer_size               = window->framebuffer_size();
+  swap_chain->window_                 = std::move(window);
+  swap_chain->msaa_sample_count_      = sample_count;
+  swap_chain->requested_present_mode_ = present_mode;
+  swap_chain->frames_in_flight_       = frames_in_flight;
 
-  swap_chain->p_device_          = &device;
-  auto framebuffer_size          = window->framebuffer_size();
-  swap_chain->window_            = std::move(window);
-  swap_chain->msaa_sample_count_ = sample_count;
-  swap_chain->vsync_             = vsync;
+  swap_chain->register_callbacks();
+  TRY(swap_chain->create_swap_chain(device, framebuffer_size.width, framebuffer_size.height));
+  TRY(swap_chain->create_image_views(device));
+  TRY(swap_chain->create_color_attachment_image(device));
+  TRY(swap_chain->create_depth_stencil_attachment_image(device));
+
+  return std::move(swap_chain);
+}
+
+Result<std::unique_ptr<SwapChain>, Error> SwapChain::create(Device& device, std::shared_ptr<os::Window> window,
+                                                            vk::raii::SurfaceKHR&& surface,
+                                                            vk::SampleCountFlagBits sample_count,
+                                                            PresentMode present_mode,
+                                                            uint32_t frames_in_flight) noexcept {
+  auto swap_chain = std::unique_ptr<SwapChain>(new SwapChain());  // NOLINT
+
+  swap_chain->p_device_               = &device;
+  swap_chain->surface_                = std::move(surface);
+  auto framebuffer_size               = window->framebuffer_size();
+  swap_chain->window_                 = std::move(window);
+  swap_chain->msaa_sample_count_      = sample_count;
+  swap_chain->requested_present_mode_ = present_mode;
+  swap_chain->frames_in_flight_       = frames_in_flight;
 
   swap_chain->register_callbacks();
   TRY(swap_chain->create_swap_chain(device, framebuffer_size.width, framebuffer_size.height));
@@ -47,9 +79,13 @@ void SwapChain::register_callbacks() noexcept {
 }
 
 Result<void, Error> SwapChain::create_swap_chain(Device& device, uint32_t width, uint32_t height) noexcept {
+  if (device.is_headless()) {
+    return create_offscreen_images(device, width, height);
+  }
+
   // Surface formats (pixel format, e.g. B8G8R8A8, color space e.g. SRGB)
-  auto available_formats       = device.physical_device().getSurfaceFormatsKHR(device.surface());
-  auto available_present_modes = device.physical_device().getSurfacePresentModesKHR(device.surface());
+  auto available_formats       = device.physical_device().getSurfaceFormatsKHR(surface());
+  auto available_present_modes = device.physical_device().getSurfacePresentModesKHR(surface());
 
   if (available_formats.empty() || available_present_modes.empty()) {
     eray::util::Logger::err(
@@ -78,10 +114,11 @@ Result<void, Error> SwapChain::create_swap_chain(Device& device, uint32_t width,
   //
   // Note: Only the VK_PRESENT_MODE_MAILBOX_KHR is guaranteed to be available
 
-  auto swap_present_mode = choose_swap_present_mode(available_present_modes, vsync_);
+  present_mode_         = choose_swap_present_mode(available_present_modes, requested_present_mode_);
+  present_mode_changed_ = false;
 
   // Basic Surface capabilities (min/max number of images in the swap chain, min/max width and height of images)
-  auto surface_capabilities = device.physical_device().getSurfaceCapabilitiesKHR(device.surface());
+  auto surface_capabilities = device.physical_device().getSurfaceCapabilitiesKHR(surface());
 
   // Swap extend is the resolution of the swap chain images, and it's almost always exactly equal to the resolution
   // of the window that we're drawing to in pixels.
@@ -92,8 +129,9 @@ Result<void, Error> SwapChain::create_swap_chain(Device& device, uint32_t width,
 
   };
 
-  // It is recommended to request at least one more image than the minimum
-  min_image_count_ = std::max(3U, surface_capabilities.minImageCount + 1);
+  // It is recommended to request at least one more image than the minimum. With more frames in flight, the extra image
+  // leaves one image for the presentation engine while the CPU records the other frames.
+  min_image_count_ = std::max({3U, surface_capabilities.minImageCount + 1, frames_in_flight_ + 1});
   if (surface_capabilities.maxImageCount > 0 && min_image_count_ > surface_capabilities.maxImageCount) {
     // 0 is a special value that means that there is no maximum
 
@@ -105,7 +143,7 @@ Result<void, Error> SwapChain::create_swap_chain(Device& device, uint32_t width,
       .flags = vk::SwapchainCreateFlagsKHR(),
 
       // Window surface on which the swap chain will present images
-      .surface = device.surface(),  //
+      .surface = surface(),  //
 
       // Minimum number of images (image buffers). More images reduce the risk of waiting for the GPU to finish
       // rendering, which improves performance
@@ -121,7 +159,9 @@ Result<void, Error> SwapChain::create_swap_chain(Device& device, uint32_t width,
       // Kind of images used in the swap chain (it's a bitfield, you can e.g. attach depth and stencil buffers)
       // Also you can render images to a separate image and perform post-processing
       // (VK_IMAGE_USAGE_TRANSFER_DST_BIT).
-      .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,  //
+      // The transfer source usage lets the `FrameCapture` copy the presented images, if the surface supports it.
+      .imageUsage = vk::ImageUsageFlagBits::eColorAttachment |
+                    (surface_capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc),  //
 
       // We can specify that a certain transform should be applied to images in the swap chain if it is supported,
       // for example 90-degree clockwise rotation or horizontal flip. We specify no transform by using
@@ -132,7 +172,7 @@ Result<void, Error> SwapChain::create_swap_chain(Device& device, uint32_t width,
       // surfaces on certain window systems
       .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,  //
 
-      .presentMode = swap_present_mode,  //
+      .presentMode = present_mode_,  //
 
       // Applications should set this value to VK_TRUE if they do not expect to read back the content of
       // presentable images before presenting them or after reacquiring them, and if their fragment shaders do not
@@ -144,8 +184,9 @@ Result<void, Error> SwapChain::create_swap_chain(Device& device, uint32_t width,
 
       // In Vulkan, it's possible that your swap chain becomes invalid or unoptimized while your app is running,
       // e.g. when window gets resized. IN SUCH A CASE THE SWAP CHAIN NEEDS TO BE RECREATED FROM SCRATCH, and a
-      // reference to the old one must be specified here.
-      .oldSwapchain = VK_NULL_HANDLE,
+      // reference to the old one must be specified here. The old swap chain is retired, its images that are not
+      // acquired are released and it can be destroyed once its presentations are finished.
+      .oldSwapchain = *swap_chain_,
   };
 
   // We need to specify how to handle swap chain images that will be used across multiple queue families. That will be
@@ -177,7 +218,7 @@ Result<void, Error> SwapChain::create_swap_chain(Device& device, uint32_t width,
   }
 
   if (auto result = device->createSwapchainKHR(swap_chain_info)) {
-    swap_chain_ = std::move(*result);
+    retire_swap_chain(std::exchange(swap_chain_, std::move(*result)));
   } else {
     eray::util::Logger::err("Failed to create a swap chain: {}", vk::to_string(result.error()));
     return std::unexpected(Error{
@@ -186,9 +227,35 @@ Result<void, Error> SwapChain::create_swap_chain(Device& device, uint32_t width,
         .vk_code = result.error(),
     });
   }
-  images_ = swap_chain_.getImages();
-  format_ = swap_surface_format.format;
-  extent_ = swap_extent;
+  images_      = swap_chain_.getImages();
+  format_      = swap_surface_format.format;
+  extent_      = swap_extent;
+  image_usage_ = swap_chain_info.imageUsage;
+
+  return {};
+}
+
+Result<void, Error> SwapChain::create_offscreen_images(Device& device, uint32_t width, uint32_t height) noexcept {
+  // Enough images to never reuse an image that is still rendered by one of the frames in flight
+  min_image_count_ = std::max(3U, frames_in_flight_ + 1);
+  format_          = vk::Format::eB8G8R8A8Srgb;
+  extent_          = vk::Extent2D{.width = std::max(width, 1U), .height = std::max(height, 1U)};
+  image_usage_     = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+
+  offscreen_images_.clear();
+  images_.clear();
+  for (auto i = 0U; i < min_image_count_; ++i) {
+    auto img_opt = ImageResource::create_attachment_image(
+        device, ImageDescription::image2d_desc(format_, extent_.width, extent_.height), image_usage_,
+        vk::ImageAspectFlagBits::eColor);
+    if (!img_opt) {
+      util::Logger::err("Could not create an offscreen image of the headless swap chain");
+      return std::unexpected(img_opt.error());
+    }
+    images_.push_back(img_opt->vk_image());
+    offscreen_images_.push_back(std::move(*img_opt));
+  }
+  next_offscreen_image_ = 0;
 
   return {};
 }
@@ -324,30 +391,54 @@ vk::SurfaceFormatKHR SwapChain::choose_swap_surface_format(const std::vector<vk:
 }
 
 vk::PresentModeKHR SwapChain::choose_swap_present_mode(const std::vector<vk::PresentModeKHR>& available_present_modes,
-                                                       bool vsync) {
-  if (!vsync) {
-    auto mode_it = std::ranges::find_if(available_present_modes,
-                                        [](const auto& mode) { return mode == vk::PresentModeKHR::eImmediate; });
-    if (mode_it != available_present_modes.end()) {
-      return *mode_it;
-    }
-  }
-
+                                                       PresentMode present_mode) {
   // Note: Mailbox is a good solution only if energy usage is not a concern, avoid for mobile devices, see:
   // https://docs.vulkan.org/samples/latest/samples/performance/swapchain_images/README.html#_best_practice_summary
-  // auto mode_it = std::ranges::find_if(available_present_modes,
-  //                                     [](const auto& mode) { return mode == vk::PresentModeKHR::eMailbox; });
-  // if (mode_it != available_present_modes.end()) {
-  //   return *mode_it;
-  // }
+  auto requested = vk::PresentModeKHR::eFifo;
+  switch (present_mode) {
+    case PresentMode::Fifo:
+      return vk::PresentModeKHR::eFifo;
+    case PresentMode::FifoRelaxed:
+      requested = vk::PresentModeKHR::eFifoRelaxed;
+      break;
+    case PresentMode::Mailbox:
+      requested = vk::PresentModeKHR::eMailbox;
+      break;
+    case PresentMode::Immediate:
+      requested = vk::PresentModeKHR::eImmediate;
+      break;
+  }
 
-  return vk::PresentModeKHR::eFifo;
+  const auto is_supported = [&available_present_modes](vk::PresentModeKHR mode) {
+    return std::ranges::find(available_present_modes, mode) != available_present_modes.end();
+  };
+  if (is_supported(requested)) {
+    return requested;
+  }
+
+  // The uncapped frames should not be blocked by the display even without tearing
+  const auto fallback = present_mode == PresentMode::Immediate && is_supported(vk::PresentModeKHR::eMailbox)
+                            ? vk::PresentModeKHR::eMailbox
+                            : vk::PresentModeKHR::eFifo;
+  eray::util::Logger::info("Present mode {} is not supported, falling back to {}", vk::to_string(requested),
+                           vk::to_string(fallback));
+  return fallback;
+}
+
+void SwapChain::set_present_mode(PresentMode present_mode) {
+  if (present_mode != requested_present_mode_) {
+    requested_present_mode_ = present_mode;
+    present_mode_changed_   = true;
+  }
 }
 
 Result<void, Error> SwapChain::recreate() {
-  (*p_device_)->waitIdle();
+  if (p_frame_deletion_queue_ == nullptr) {
+    const auto wait = WaitScope(p_device_->wait_statistics(), "Swap chain recreation", WaitKind::Stall);
+    (*p_device_)->waitIdle();
+  }
 
-  clear();
+  retire_attachments();
 
   auto framebuffer_size = window_->framebuffer_size();
   if (auto result = create_swap_chain(*p_device_, framebuffer_size.width, framebuffer_size.height); !result) {
@@ -373,14 +464,107 @@ Result<void, Error> SwapChain::recreate() {
   return {};
 }
 
+void SwapChain::retire_swap_chain(vk::raii::SwapchainKHR&& swap_chain) {
+  if (!*swap_chain) {
+    return;
+  }
+
+  if (p_device_->has_swapchain_maintenance1()) {
+    retired_swap_chains_.push_back(RetiredSwapChain{
+        .swap_chain     = std::move(swap_chain),
+        .present_fences = std::exchange(present_fences_, {}),
+    });
+    return;
+  }
+
+  if (p_frame_deletion_queue_ != nullptr) {
+    // There is no way to tell when a presentation has finished. The old images were presented before the currently
+    // recorded frame is submitted, when the fence of the frame signals the presentations are assumed to be finished.
+    p_frame_deletion_queue_->push_deletor(
+        [device = vk::Device(**p_device_), handle = swap_chain.release()]() { device.destroySwapchainKHR(handle); });
+    return;
+  }
+
+  // The device is idle, the swap chain is destroyed right away
+  swap_chain = nullptr;
+}
+
+void SwapChain::retire_attachments() {
+  if (p_frame_deletion_queue_ == nullptr) {
+    // Destroyed when they are replaced, the device is idle
+    image_views_.clear();
+    offscreen_images_.clear();
+    return;
+  }
+
+  // The views and the attachments are used by the frames in flight
+  for (auto& image_view : image_views_) {
+    p_frame_deletion_queue_->push(image_view.release());
+  }
+  image_views_.clear();
+  p_frame_deletion_queue_->push(color_image_view_.release());
+  p_frame_deletion_queue_->push(std::move(color_image_._image));
+  p_frame_deletion_queue_->push(depth_stencil_image_view_.release());
+  p_frame_deletion_queue_->push(std::move(depth_stencil_image_._image));
+  for (auto& image : offscreen_images_) {
+    p_frame_deletion_queue_->push(std::move(image._image));
+  }
+  offscreen_images_.clear();
+}
+
+void SwapChain::collect_present_fences() {
+  const auto is_signaled = [](const vk::raii::Fence& fence) { return fence.getStatus() == vk::Result::eSuccess; };
+
+  // The presentations of a swap chain finish in order
+  while (!present_fences_.empty() && is_signaled(present_fences_.front())) {
+    free_present_fences_.push_back(std::move(present_fences_.front()));
+    present_fences_.pop_front();
+  }
+
+  std::erase_if(retired_swap_chains_, [this, &is_signaled](RetiredSwapChain& retired) {
+    if (!std::ranges::all_of(retired.present_fences, is_signaled)) {
+      return false;
+    }
+    std::ranges::move(retired.present_fences, std::back_inserter(free_present_fences_));
+    return true;
+  });
+}
+
+Result<vk::Fence, Error> SwapChain::next_present_fence() {
+  if (free_present_fences_.empty()) {
+    if (auto result = (*p_device_)->createFence(vk::FenceCreateInfo{})) {
+      present_fences_.push_back(std::move(*result));
+    } else {
+      eray::util::Logger::err("Failed to create a present fence: {}", vk::to_string(result.error()));
+      return std::unexpected(Error{
+          .msg     = "Present fence creation failure",
+          .code    = ErrorCode::VulkanObjectCreationFailure{},
+          .vk_code = result.error(),
+      });
+    }
+  } else {
+    (*p_device_)->resetFences(*free_present_fences_.back());
+    present_fences_.push_back(std::move(free_present_fences_.back()));
+    free_present_fences_.pop_back();
+  }
+
+  return *present_fences_.back();
+}
+
 void SwapChain::clear() {
   image_views_.clear();
   swap_chain_ = nullptr;
+  images_.clear();
+  offscreen_images_.clear();
+  retired_swap_chains_.clear();
+  present_fences_.clear();
+  free_present_fences_.clear();
 }
 
 void SwapChain::destroy() {
   deletion_queue_.flush();
   clear();
+  surface_ = nullptr;
 }
 
 void SwapChain::begin_rendering(const vk::raii::CommandBuffer& cmd_buff, uint32_t image_index,
@@ -511,7 +695,7 @@ void SwapChain::end_rendering(const vk::raii::CommandBuffer& cmd_buff, uint32_t
       .dstStageMask        = vk::PipelineStageFlagBits2::eBottomOfPipe,
       .dstAccessMask       = {},
       .oldLayout           = vk::ImageLayout::eColorAttachmentOptimal,
-      .newLayout           = vk::ImageLayout::ePresentSrcKHR,
+      .newLayout           = is_headless() ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR,
       .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
       .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
       .image               = images_[image_index],  //
@@ -536,14 +720,32 @@ void SwapChain::end_rendering(const vk::raii::CommandBuffer& cmd_buff, uint32_t
 
 Result<SwapChain::AcquireResult, Error> SwapChain::acquire_next_image(uint64_t timeout, vk::Semaphore semaphore,
                                                                       vk::Fence fence) {
+  ERAY_PROFILE_FUNCTION();
+  if (is_headless()) {
+    return acquire_offscreen_image(semaphore, fence);
+  }
+
+  if (present_mode_changed_) {
+    return recreate().transform([]() {
+      return AcquireResult{
+          .status      = AcquireResult::Status::Resized,
+          .image_index = 0,
+      };
+    });
+  }
+
   vk::Device device           = **p_device_;
   vk::SwapchainKHR swap_chain = **this;
   uint32_t image_index        = 0;
   // When vk::Result::eErrorOutOfDateKHR is encountered the swap_chain_.acquireNextImage(timeout,
   // semaphore, fence); fails because of assertion failure. For that reason C-API is used instead.
-  auto result =
-      vk::Result(vkAcquireNextImageKHR(device, static_cast<VkSwapchainKHR>(swap_chain), timeout,
-                                       static_cast<VkSemaphore>(semaphore), static_cast<VkFence>(fence), &image_index));
+  auto result = vk::Result::eSuccess;
+  {
+    const auto wait = WaitScope(p_device_->wait_statistics(), "Swap chain acquire", WaitKind::Pacing);
+    result = vk::Result(vkAcquireNextImageKHR(device, static_cast<VkSwapchainKHR>(swap_chain), timeout,
+                                              static_cast<VkSemaphore>(semaphore), static_cast<VkFence>(fence),
+                                              &image_index));
+  }
 
   if (result == vk::Result::eErrorOutOfDateKHR) {
     // The swap chain has become incompatible with the surface and can no longer be used for rendering. Usually
@@ -556,6 +758,13 @@ Result<SwapChain::AcquireResult, Error> SwapChain::acquire_next_image(uint64_t t
     });
   }
 
+  if (result == vk::Result::eNotReady || result == vk::Result::eTimeout) {
+    return AcquireResult{
+        .status      = AcquireResult::Status::NotReady,
+        .image_index = 0,
+    };
+  }
+
   if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
     // The swap chain cannot be used even if we accept that the surface properties are no longer matched exactly
     // (eSuboptimalKHR).
@@ -574,7 +783,90 @@ Result<SwapChain::AcquireResult, Error> SwapChain::acquire_next_image(uint64_t t
   ;
 }
 
+Result<SwapChain::AcquireResult, Error> SwapChain::acquire_offscreen_image(vk::Semaphore semaphore, vk::Fence fence) {
+  if (framebuffer_resized_) {
+    framebuffer_resized_ = false;
+    return recreate().transform([]() {
+      return AcquireResult{
+          .status      = AcquireResult::Status::Resized,
+          .image_index = 0,
+      };
+    });
+  }
+
+  // The images are reused in order, the image acquired now was rendered by a frame that has already finished. The
+  // semaphore and the fence are signaled by an empty submission, as the presentation engine would do.
+  const auto image_index = next_offscreen_image_;
+  next_offscreen_image_  = (next_offscreen_image_ + 1) % static_cast<uint32_t>(images_.size());
+
+  if (semaphore || fence) {
+    auto signal = vk::SemaphoreSubmitInfo{
+        .semaphore = semaphore,
+        .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+    };
+    p_device_->graphics_queue().submit2(
+        vk::SubmitInfo2{
+            .signalSemaphoreInfoCount = semaphore ? 1U : 0U,
+            .pSignalSemaphoreInfos    = semaphore ? &signal : nullptr,
+        },
+        fence);
+  }
+
+  return AcquireResult{
+      .status      = AcquireResult::Status::Success,
+      .image_index = image_index,
+  };
+}
+
+Result<void, Error> SwapChain::present_offscreen_image(const vk::PresentInfoKHR& present_info) {
+  // Nothing is presented, but the wait semaphores are unsignaled, so that they can be signaled again
+  auto waits = std::vector<vk::SemaphoreSubmitInfo>();
+  waits.reserve(present_info.waitSemaphoreCount);
+  for (auto i = 0U; i < present_info.waitSemaphoreCount; ++i) {
+    waits.push_back(vk::SemaphoreSubmitInfo{
+        .semaphore = present_info.pWaitSemaphores[i],
+        .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+    });
+  }
+  if (!waits.empty()) {
+    p_device_->graphics_queue().submit2(vk::SubmitInfo2{
+        .waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size()),
+        .pWaitSemaphoreInfos    = waits.data(),
+    });
+  }
+
+  if (framebuffer_resized_) {
+    framebuffer_resized_ = false;
+    return recreate();
+  }
+
+  return {};
+}
+
 Result<void, Error> SwapChain::present_image(vk::PresentInfoKHR present_info) {
+  ERAY_PROFILE_FUNCTION();
+  if (is_headless()) {
+    return present_offscreen_image(present_info);
+  }
+
+  // The present fence tells when the presentation engine is done with the image, see `retire_swap_chain()`
+  auto present_fence      = vk::Fence{};
+  auto present_fence_info = vk::SwapchainPresentFenceInfoEXT{};
+  if (p_device_->has_swapchain_maintenance1()) {
+    collect_present_fences();
+    if (auto fence = next_present_fence()) {
+      present_fence      = *fence;
+      present_fence_info = vk::SwapchainPresentFenceInfoEXT{
+          .pNext          = present_info.pNext,
+          .swapchainCount = 1,
+          .pFences        = &present_fence,
+      };
+      present_info.pNext = &present_fence_info;
+    } else {
+      return std::unexpected(fence.error());
+    }
+  }
+
   // When vk::Result::eErrorOutOfDateKHR is encountered the p_device_->presentation_queue().presentKHR(present_info);
   // fails because of assertion failure. For that reason C-API is used instead.
   vk::Queue queue = p_device_->presentation_queue();
@@ -586,6 +878,10 @@ Result<void, Error> SwapChain::present_image(vk::PresentInfoKHR present_info) {
   }
 
   if (result != vk::Result::eSuccess) {
+    if (present_fence) {
+      // The presentation has not been queued, the fence is never signaled
+      present_fences_.pop_back();
+    }
     eray::util::Logger::err("Failed to present swap chain image");
     return std::unexpected(Error{
         .msg     = "Failed to present an image",
@@ -2,6 +2,8 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include <atomic>
+#include <deque>
 #include <liberay/os/window/window.hpp>
 #include <liberay/util/ruleof.hpp>
 #include <liberay/vkren/buffer.hpp>
@@ -14,16 +16,65 @@
 
 namespace eray::vkren {
 
+/**
+ * @brief Presentation mode policy of the swap chain. When the surface does not support the requested mode, the swap
+ * chain falls back to the nearest supported one, FIFO is supported always.
+ *
+ */
+enum class PresentMode : uint8_t {
+  /**
+   * @brief Waits for the vertical blank, no tearing. The presentation queue blocks the CPU when it is full -- VSync.
+   *
+   */
+  Fifo = 0,
+
+  /**
+   * @brief Like `Fifo`, but a frame that missed the vertical blank is presented right away and may tear. Falls back to
+   * `Fifo`.
+   *
+   */
+  FifoRelaxed = 1,
+
+  /**
+   * @brief The queued image is replaced by the newer ones, no tearing and the CPU never blocks, but the frames that are
+   * replaced are rendered in vain. Usually combined with a frame rate cap. Falls back to `Fifo`.
+   *
+   */
+  Mailbox = 2,
+
+  /**
+   * @brief Presents right away and tears, the frame rate is not limited by the display, e.g. for benchmarks. Falls
+   * back to `Mailbox`, then to `Fifo`.
+   *
+   */
+  Immediate = 3,
+};
+
 class SwapChain {
  public:
-  SwapChain(const SwapChain&)                = delete;
-  SwapChain(SwapChain&&) noexcept            = default;
-  SwapChain& operator=(const SwapChain&)     = delete;
-  SwapChain& operator=(SwapChain&&) noexcept = default;
+  SwapChain(const SwapChain&)            = delete;
+  SwapChain(SwapChain&&)                 = delete;
+  SwapChain& operator=(const SwapChain&) = delete;
+  SwapChain& operator=(SwapChain&&)      = delete;
 
+  /**
+   * @brief Creates the swap chain. At least one image more than the `frames_in_flight` is requested, so that the CPU
+   * can acquire an image for every frame it records ahead of the GPU.
+   *
+   */
   static Result<std::unique_ptr<SwapChain>, Error> create(
       Device& device, std::shared_ptr<os::Window>, vk::SampleCountFlagBits sample_count = vk::SampleCountFlagBits::e1,
-      bool vsync = true) noexcept;
+      PresentMode present_mode = PresentMode::Fifo, uint32_t frames_in_flight = 2) noexcept;
+
+  /**
+   * @brief Creates the swap chain of an additional window that presents to its own `surface`, see
+   * `Device::create_surface()`. The swap chain owns the surface.
+   *
+   */
+  static Result<std::unique_ptr<SwapChain>, Error> create(Device& device, std::shared_ptr<os::Window> window,
+                                                          vk::raii::SurfaceKHR&& surface,
+                                                          vk::SampleCountFlagBits sample_count,
+                                                          PresentMode present_mode, uint32_t frames_in_flight) noexcept;
 
   vk::raii::SwapchainKHR* operator->() noexcept { return &swap_chain_; }
   const vk::raii::SwapchainKHR* operator->() const noexcept { return &swap_chain_; }
@@ -47,6 +98,14 @@ class SwapChain {
   vk::ImageView color_attachment_image_view() const { return color_image_view_; }
 
   vk::Format image_format() const { return format_; }
+
+  /**
+   * @brief Usage of the swap chain images. Includes VK_IMAGE_USAGE_TRANSFER_SRC_BIT whenever the surface supports it,
+   * the images can then be copied, e.g. by the `FrameCapture`.
+   *
+   */
+  vk::ImageUsageFlags image_usage() const { return image_usage_; }
+
   vk::Format color_attachment_format() const { return format_; }
   vk::Format depth_stencil_attachment_format() const { return depth_stencil_format_; }
 
@@ -88,8 +147,9 @@ class SwapChain {
 
   struct AcquireResult {
     enum class Status : uint8_t {
-      Success = 0,
-      Resized = 1,
+      Success  = 0,
+      Resized  = 1,
+      NotReady = 2,
     };
 
     Status status;
@@ -103,7 +163,7 @@ class SwapChain {
 
   /**
    * @brief Calls `vkAcquireNextImageKHR` and resize the swap chain if necessary (if swap chain gets resized returns
-   * std::nullopt).
+   * std::nullopt). With a finite `timeout` the status is `NotReady` when no image has been available in time.
    *
    * @param timeout
    * @param semaphore
@@ -122,8 +182,24 @@ class SwapChain {
    */
   Result<void, Error> present_image(vk::PresentInfoKHR present_info);
 
+  /**
+   * @brief Creates a new swap chain from the current one without waiting for the device. The old swap chain and the
+   * attachments are retired to the frame deletion queue (see `set_frame_deletion_queue()`), the old swap chain is
+   * destroyed when its presentations are finished. Without the frame deletion queue the device is waited for and the
+   * old resources are destroyed right away.
+   *
+   * @return Result<void, Error>
+   */
   Result<void, Error> recreate();
 
+  /**
+   * @brief Queue the resources of the recreated swap chains are retired to. The queue must outlive the swap chain or be
+   * detached with `nullptr`. The recreation must happen while a frame that is going to be submitted is recorded.
+   *
+   * @param queue
+   */
+  void set_frame_deletion_queue(observer_ptr<FrameDeletionQueue> queue) { p_frame_deletion_queue_ = queue; }
+
   /**
    * @brief Minimum number of images (image buffers). More images reduce the risk of waiting for the GPU to finish
    * rendering, which improves performance.
@@ -132,7 +208,36 @@ class SwapChain {
    */
   uint32_t min_image_count() const { return min_image_count_; }
 
-  bool vsync_enabled() const { return vsync_; }
+  /**
+   * @brief True if the presented images wait for the vertical blank, i.e. the selected mode is FIFO or FIFO relaxed.
+   * The headless swap chain presents nothing.
+   *
+   */
+  bool vsync_enabled() const {
+    return !is_headless() &&
+           (present_mode_ == vk::PresentModeKHR::eFifo || present_mode_ == vk::PresentModeKHR::eFifoRelaxed);
+  }
+
+  /**
+   * @brief Requests another present mode. The swap chain is recreated by the next `acquire_next_image()`, which then
+   * reports the `Resized` status. Ignored by the headless swap chain.
+   *
+   */
+  void set_present_mode(PresentMode present_mode);
+
+  /**
+   * @brief The requested mode, see `present_mode()` for the one selected from the modes supported by the surface.
+   *
+   */
+  PresentMode requested_present_mode() const { return requested_present_mode_; }
+  vk::PresentModeKHR present_mode() const { return present_mode_; }
+
+  /**
+   * @brief True if the device is headless. The swap chain then owns offscreen images that are acquired in order and
+   * nothing is presented. The rendered images are left in the `eTransferSrcOptimal` layout.
+   *
+   */
+  bool is_headless() const { return p_device_->is_headless(); }
 
   /**
    * @brief Returns a window to which swap chain presents its images.
@@ -144,8 +249,15 @@ class SwapChain {
  private:
   SwapChain() = default;
 
+  /**
+   * @brief The owned surface of an additional window or the surface of the device.
+   *
+   */
+  vk::SurfaceKHR surface() const { return *surface_ ? *surface_ : *p_device_->surface(); }
+
   void register_callbacks() noexcept;
   Result<void, Error> create_swap_chain(vkren::Device& device, uint32_t width, uint32_t height) noexcept;
+  Result<void, Error> create_offscreen_images(vkren::Device& device, uint32_t width, uint32_t height) noexcept;
   Result<void, Error> create_image_views(vkren::Device& device) noexcept;
   Result<void, Error> create_color_attachment_image(vkren::Device& device) noexcept;
   Result<void, Error> create_depth_stencil_attachment_image(vkren::Device& device) noexcept;
@@ -155,11 +267,41 @@ class SwapChain {
                                                                 vk::ImageTiling tiling,
                                                                 vk::FormatFeatureFlags features);
 
+  /**
+   * @brief Moves the old swap chain to the retired ones or to the frame deletion queue.
+   *
+   */
+  void retire_swap_chain(vk::raii::SwapchainKHR&& swap_chain);
+
+  /**
+   * @brief Moves the views and the attachments to the frame deletion queue, if there is one.
+   *
+   */
+  void retire_attachments();
+
+  /**
+   * @brief Recycles the signaled present fences and destroys the retired swap chains whose presentations are finished.
+   * Used only with VK_EXT_swapchain_maintenance1.
+   *
+   */
+  void collect_present_fences();
+  Result<vk::Fence, Error> next_present_fence();
+
+  Result<AcquireResult, Error> acquire_offscreen_image(vk::Semaphore semaphore, vk::Fence fence);
+  Result<void, Error> present_offscreen_image(const vk::PresentInfoKHR& present_info);
+
   static vk::SurfaceFormatKHR choose_swap_surface_format(const std::vector<vk::SurfaceFormatKHR>& available_formats);
   static vk::PresentModeKHR choose_swap_present_mode(const std::vector<vk::PresentModeKHR>& available_present_modes,
-                                                     bool vsync);
+                                                     PresentMode present_mode);
 
  private:
+  /**
+   * @brief Present only for the additional windows, see `surface()`. Declared first, so that it outlives the swap
+   * chains.
+   *
+   */
+  vk::raii::SurfaceKHR surface_ = nullptr;
+
   /**
    * @brief Vulkan does not provide a "default framebuffuer". Hence it requires an infrastructure that will own the
    * buffers we will render to before we visualize them on the screen. This infrastructure is known as the swap chain.
@@ -171,11 +313,21 @@ class SwapChain {
   vk::raii::SwapchainKHR swap_chain_ = vk::raii::SwapchainKHR(nullptr);
 
   uint32_t min_image_count_{};
+  uint32_t frames_in_flight_{};
 
-  bool vsync_{};
+  PresentMode requested_present_mode_ = PresentMode::Fifo;
+  vk::PresentModeKHR present_mode_     = vk::PresentModeKHR::eFifo;
+  bool present_mode_changed_           = false;
 
   std::vector<vk::Image> images_;
 
+  /**
+   * @brief Owners of the `images_` of a headless swap chain.
+   *
+   */
+  std::vector<vkren::ImageResource> offscreen_images_;
+  uint32_t next_offscreen_image_{};
+
   /**
    * @brief An image view DESCRIBES HOW TO ACCESS THE IMAGE and which part of the image to access, for example, if it
    * should be treated as a 2D texture depth texture without any mipmapping levels.
@@ -203,6 +355,7 @@ class SwapChain {
    *
    */
   vk::Format format_ = vk::Format::eUndefined;
+  vk::ImageUsageFlags image_usage_;
 
   /**
    * @brief Describes the dimensions of the swap chain.
@@ -216,8 +369,31 @@ class SwapChain {
 
   std::shared_ptr<os::Window> window_;
 
-  bool framebuffer_resized_{};
+  /**
+   * @brief Set by the window event callback, which runs on the thread that pumps the window events.
+   *
+   */
+  std::atomic<bool> framebuffer_resized_{};
   DeletionQueue deletion_queue_;
+
+  observer_ptr<FrameDeletionQueue> p_frame_deletion_queue_ = nullptr;
+
+  /**
+   * @brief Swap chain replaced by a recreation, destroyed once all of its present fences have signaled.
+   *
+   */
+  struct RetiredSwapChain {
+    vk::raii::SwapchainKHR swap_chain = nullptr;
+    std::deque<vk::raii::Fence> present_fences;
+  };
+  std::vector<RetiredSwapChain> retired_swap_chains_;
+
+  /**
+   * @brief Fences of the pending presentations of the current swap chain, in the presentation order.
+   *
+   */
+  std::deque<vk::raii::Fence> present_fences_;
+  std::vector<vk::raii::Fence> free_present_fences_;
 };
 
 }  // namespace eray::vkren
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image_description.hpp>
+#include <liberay/vkren/texture_atlas.hpp>
+#include <vector>
+
+namespace eray::vkren {
+
+Result<TextureAtlas, Error> TextureAtlas::create(Device& device, BindlessHeap& heap, FrameDeletionQueue& deletion_queue,
+                                                 const CreateInfo& info) {
+  assert(!helper::is_compressed_format(info.format) && helper::bytes_per_pixel(info.format) > 0 &&
+         "The atlas texels must be of an uncompressed format");
+
+  return TextureAtlas(device, heap, deletion_queue, info);
+}
+
+Result<TextureAtlasEntry, Error> TextureAtlas::add(std::span<const std::byte> texels, uint32_t width, uint32_t height) {
+  assert(texels.size() == static_cast<size_t>(width) * height * texel_size_ && "Expected width * height texels");
+
+  const auto rect = layout_.allocate(width, height);
+  if (!rect) {
+    util::Logger::err("Could not pack a {}x{} texture into the {}x{}x{} atlas", width, height, layout_.width(),
+                      layout_.height(), layout_.max_layers());
+    return std::unexpected(Error{
+        .msg  = "Texture atlas is full",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  write_texels(*rect, texels);
+  rects_.push_back(*rect);
+  dirty_ = true;
+
+  return TextureAtlasEntry{._value = static_cast<uint32_t>(rects_.size() - 1)};
+}
+
+Result<TextureAtlasEntry, Error> TextureAtlas::add(const res::Image& image) {
+  assert(image.bytes_per_pixel() == texel_size_ && "The image pixels do not match the atlas format");
+
+  return add(std::as_bytes(std::span(image.data_bytes())), image.width(), image.height());
+}
+
+void TextureAtlas::write_texels(const AtlasRect& rect, std::span<const std::byte> texels) {
+  const auto layer_size = static_cast<size_t>(layout_.width()) * layout_.height() * texel_size_;
+  while (layers_.size() <= rect.layer) {
+    layers_.emplace_back(layer_size);
+  }
+  auto& layer = layers_[rect.layer];
+
+  // The padding and the alignment remainder of the slot repeat the nearest edge texel
+  const auto alignment   = layout_.alignment();
+  const auto padding     = layout_.padding();
+  const auto slot_width  = ((rect.width + alignment - 1) & ~(alignment - 1)) + 2 * padding;
+  const auto slot_height = ((rect.height + alignment - 1) & ~(alignment - 1)) + 2 * padding;
+  const auto slot_x      = rect.x - padding;
+  const auto slot_y      = rect.y - padding;
+  for (auto y = 0U; y < slot_height; ++y) {
+    const auto src_y = std::clamp(static_cast<int64_t>(y) - padding, int64_t{0}, int64_t{rect.height} - 1);
+    const auto* src  = texels.data() + static_cast<size_t>(src_y) * rect.width * texel_size_;
+    auto* dst        = layer.data() + ((static_cast<size_t>(slot_y) + y) * layout_.width() + slot_x) * texel_size_;
+
+    for (auto x = 0U; x < padding; ++x) {
+      std::memcpy(dst + static_cast<size_t>(x) * texel_size_, src, texel_size_);
+    }
+    std::memcpy(dst + static_cast<size_t>(padding) * texel_size_, src, static_cast<size_t>(rect.width) * texel_size_);
+    const auto* last = src + static_cast<size_t>(rect.width - 1) * texel_size_;
+    for (auto x = padding + rect.width; x < slot_width; ++x) {
+      std::memcpy(dst + static_cast<size_t>(x) * texel_size_, last, texel_size_);
+    }
+  }
+}
+
+Result<void, Error> TextureAtlas::build(MipGenerator* mip_generator) {
+  if (layers_.empty()) {
+    return {};
+  }
+
+  const auto layer_count = static_cast<uint32_t>(layers_.size());
+  const auto desc        = ImageDescription::image2d_desc(format_, layout_.width(), layout_.height(), layer_count);
+  const auto mip_levels  = std::min(layout_.mip_levels(), desc.find_mip_levels());
+  TRY_UNWRAP_DEFINE(image, ImageResource::create_texture_with_mip_levels(*p_device_, desc, mip_levels));
+  image.set_debug_name("Texture atlas");
+
+  // A packed level holds the layers one after another
+  auto lod0 = std::vector<std::byte>();
+  lod0.reserve(static_cast<size_t>(desc.lod0_size_bytes()));
+  for (const auto& layer : layers_) {
+    lod0.insert(lod0.end(), layer.begin(), layer.end());
+  }
+  TRY(image.upload(util::MemoryRegion(lod0.data(), lod0.size()), mip_generator));
+  TRY_UNWRAP_DEFINE(view, image.create_image_view(vk::ImageViewType::e2DArray));
+
+  if (index_.is_valid()) {
+    p_heap_->update_sampled_image(index_, *view);
+    retire_image();
+  } else {
+    TRY_UNWRAP_ASSIGN(index_, p_heap_->register_sampled_image(*view));
+  }
+  image_ = std::make_unique<ImageResource>(std::move(image));
+  view_  = std::move(view);
+  dirty_ = false;
+
+  return {};
+}
+
+TextureAtlasHandle TextureAtlas::handle(TextureAtlasEntry entry) const {
+  const auto& rect = rects_[entry._value];
+  return TextureAtlasHandle{
+      .image   = index_,
+      .layer   = rect.layer,
+      .uv_rect = layout_.uv_rect(rect),
+  };
+}
+
+void TextureAtlas::destroy() {
+  if (index_.is_valid()) {
+    p_heap_->release(BindlessArray::SampledImage, index_);
+    index_ = BindlessIndex{};
+  }
+  retire_image();
+  rects_.clear();
+  layers_.clear();
+  layout_.reset();
+  dirty_ = false;
+}
+
+void TextureAtlas::retire_image() {
+  if (!image_) {
+    return;
+  }
+
+  if (*view_) {
+    p_deletion_queue_->push(view_.release());
+  }
+  p_deletion_queue_->push(std::move(image_->_image));
+  image_.reset();
+}
+
+}  // namespace eray::vkren
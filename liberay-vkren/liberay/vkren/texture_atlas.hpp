@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/math/vec.hpp>
+#include <liberay/res/image.hpp>
+#include <liberay/vkren/bindless_heap.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/deletion_queue.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image.hpp>
+#include <liberay/vkren/image_format_helpers.hpp>
+#include <liberay/vkren/scene/texture_atlas_layout.hpp>
+#include <memory>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+class MipGenerator;
+
+struct TextureAtlasEntry {
+  uint32_t _value;
+
+  bool operator==(const TextureAtlasEntry&) const = default;
+};
+
+/**
+ * @brief Where the shaders find a packed texture: the `image` is the 2D array view of the whole atlas in the sampled
+ * image array of the bindless heap, the texture coordinates of the texture are remapped to
+ * `lerp(uv_rect.xy, uv_rect.zw, uv)` in the `layer`.
+ *
+ */
+struct TextureAtlasHandle {
+  BindlessIndex image;
+  uint32_t layer;
+  math::Vec4f uv_rect;
+};
+
+/**
+ * @brief Packs many small textures of the same format (icons, decals, UI) into the layers of a single 2D texture
+ * array, so they share one allocation, one view and one bindless slot instead of one each. The placement is decided
+ * by the `TextureAtlasLayout`, the edge texels of every texture are extruded into its padding, so the bilinear
+ * filtering and the mip levels do not bleed the neighbours in.
+ *
+ * The textures are added on the CPU and uploaded together by `build()`:
+ * @code
+ * auto atlas = TextureAtlas::create(device, heap, deletion_queue, {.layout = {.mip_levels = 4}}).or_panic();
+ * auto icon  = atlas.add(icon_image).or_panic("Could not pack the icon");
+ * atlas.build(&mip_generator).or_panic("Could not upload the atlas");
+ * const auto handle = atlas.handle(icon);  // pushed to the shader
+ * @endcode
+ * The shaders must sample the atlas with the clamp-to-edge addressing in the texture space of the atlas, the repeated
+ * textures have to wrap the `uv` before the remapping, e.g. with `frac()`.
+ *
+ * A texture added after the `build()` is visible after the next `build()`, which uploads a new image and swaps the
+ * descriptor of the same bindless slot. The previous image is released through the `FrameDeletionQueue`.
+ *
+ * @warning Lifetime is bound by the device lifetime. The heap and the deletion queue must outlive the atlas.
+ *
+ */
+class TextureAtlas {
+ public:
+  TextureAtlas() = delete;
+  explicit TextureAtlas(std::nullptr_t) {}
+
+  struct CreateInfo {
+    /**
+     * @brief Uncompressed format of the texels of every packed texture.
+     *
+     */
+    vk::Format format = vk::Format::eR8G8B8A8Srgb;
+
+    TextureAtlasLayout::CreateInfo layout;
+  };
+
+  /**
+   * @brief Creates an empty atlas, the image is created by the first `build()`.
+   *
+   * @param device
+   * @param heap
+   * @param deletion_queue
+   * @param info
+   * @return Result<TextureAtlas, Error>
+   */
+  [[nodiscard]] static Result<TextureAtlas, Error> create(Device& device, BindlessHeap& heap,
+                                                          FrameDeletionQueue& deletion_queue, const CreateInfo& info);
+
+  /**
+   * @brief Packs the texture and copies its texels with the extruded edges.
+   *
+   * @param texels `width * height` texels of the atlas format, row by row.
+   * @param width
+   * @param height
+   * @return Result<TextureAtlasEntry, Error> Fails with `MemoryAllocationFailure` when the texture is larger than a
+   * layer or all of the layers are full.
+   */
+  Result<TextureAtlasEntry, Error> add(std::span<const std::byte> texels, uint32_t width, uint32_t height);
+
+  /**
+   * @brief The pixels must have the size of the texels of the atlas format, e.g. an RGBA8 image for the
+   * `eR8G8B8A8Srgb` atlas.
+   *
+   */
+  Result<TextureAtlasEntry, Error> add(const res::Image& image);
+
+  /**
+   * @brief Uploads the layers with the textures added so far and generates their mip levels. Blocks until the upload
+   * is complete.
+   *
+   * @param mip_generator Generates the mip levels in a single dispatch if it supports the format, otherwise they are
+   * blitted.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> build(MipGenerator* mip_generator = nullptr);
+
+  /**
+   * @brief The `image` of the handle is invalid until the first `build()`.
+   *
+   */
+  TextureAtlasHandle handle(TextureAtlasEntry entry) const;
+
+  const AtlasRect& rect(TextureAtlasEntry entry) const { return rects_[entry._value]; }
+
+  /**
+   * @brief Slot of the 2D array view of the atlas in the sampled image array of the heap.
+   *
+   */
+  BindlessIndex bindless_index() const { return index_; }
+
+  const TextureAtlasLayout& layout() const { return layout_; }
+  size_t texture_count() const { return rects_.size(); }
+
+  /**
+   * @brief The textures added since the last `build()` are not uploaded yet.
+   *
+   */
+  bool is_dirty() const { return dirty_; }
+
+  /**
+   * @brief Releases the image and the bindless slot once the frames in flight are done.
+   *
+   */
+  void destroy();
+
+ private:
+  TextureAtlas(Device& device, BindlessHeap& heap, FrameDeletionQueue& deletion_queue, const CreateInfo& info)
+      : p_device_(&device),
+        p_heap_(&heap),
+        p_deletion_queue_(&deletion_queue),
+        format_(info.format),
+        texel_size_(helper::bytes_per_pixel(info.format)),
+        layout_(TextureAtlasLayout::create(info.layout)) {}
+
+  /**
+   * @brief Copies the texels to the layer and replicates the edge texels over the padding of the slot.
+   *
+   */
+  void write_texels(const AtlasRect& rect, std::span<const std::byte> texels);
+
+  void retire_image();
+
+  observer_ptr<Device> p_device_                     = nullptr;
+  observer_ptr<BindlessHeap> p_heap_                 = nullptr;
+  observer_ptr<FrameDeletionQueue> p_deletion_queue_ = nullptr;
+  vk::Format format_                                 = vk::Format::eUndefined;
+  size_t texel_size_                                 = 0;
+
+  TextureAtlasLayout layout_ = TextureAtlasLayout(nullptr);
+  std::vector<AtlasRect> rects_;
+
+  /**
+   * @brief LOD0 of every used layer, kept for the next `build()`.
+   *
+   */
+  std::vector<std::vector<std::byte>> layers_;
+
+  std::unique_ptr<ImageResource> image_;
+  vk::raii::ImageView view_ = nullptr;
+  BindlessIndex index_;
+  bool dirty_ = false;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,266 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <expected>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/texture_streamer.hpp>
+#include <vector>
+
+namespace eray::vkren {
+
+namespace {
+
+constexpr auto kNoFeedback = UINT32_MAX;
+
+}  // namespace
+
+Result<TextureStreamer, Error> TextureStreamer::create(Device& device, TransferUploader& uploader, BindlessHeap& heap,
+                                                       FrameDeletionQueue& deletion_queue, const CreateInfo& info,
+                                                       uint32_t frames_in_flight) {
+  const auto size_bytes = static_cast<vk::DeviceSize>(info.max_textures) * sizeof(uint32_t);
+
+  auto feedback = std::vector<FeedbackBuffer>();
+  feedback.reserve(frames_in_flight);
+  for (auto i = 0U; i < frames_in_flight; ++i) {
+    TRY_UNWRAP_DEFINE(buffer, BufferResource::create_readback_storage_buffer(device, size_bytes));
+    std::memset(buffer.mapped_data, 0xFF, size_bytes);
+    vmaFlushAllocation(device.vma_alloc_manager().allocator(), buffer.buffer._buffer._allocation, 0, size_bytes);
+
+    TRY_UNWRAP_DEFINE(index, heap.register_storage_buffer(vk::DescriptorBufferInfo{
+                                 .buffer = buffer.buffer.vk_buffer(),
+                                 .offset = 0,
+                                 .range  = size_bytes,
+                             }));
+    feedback.push_back(FeedbackBuffer{.buffer = std::move(buffer), .index = index});
+  }
+
+  return TextureStreamer(device, uploader, heap, deletion_queue, info, std::move(feedback));
+}
+
+Result<StreamedTextureId, Error> TextureStreamer::add(res::CachedAsset&& asset) {
+  assert(asset.kind() == res::AssetKind::Image && "Only the image assets can be streamed");
+
+  const auto metadata = asset.metadata<res::ImageAssetMetadata>();
+  const auto desc     = ImageDescription::image2d_desc(to_vk_format(metadata.format, metadata.color_space),
+                                                       metadata.lod0_width, metadata.lod0_height);
+  if (metadata.mip_levels != desc.find_mip_levels() || asset.payload().size() != desc.find_full_size_bytes()) {
+    util::Logger::err("Could not stream a texture. The asset does not hold the full mip chain of a {}x{} image",
+                      metadata.lod0_width, metadata.lod0_height);
+    return std::unexpected(Error{
+        .msg  = "Streamed texture asset is not a full mip chain",
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  auto min_resident_mip = 0U;
+  while (min_resident_mip + 1 < metadata.mip_levels &&
+         std::max(desc.width >> min_resident_mip, desc.height >> min_resident_mip) > info_.min_resident_size) {
+    ++min_resident_mip;
+  }
+
+  auto mip_sizes = std::vector<uint64_t>();
+  for (auto i = 0U; i < metadata.mip_levels; ++i) {
+    mip_sizes.push_back(desc.mip_size_bytes(i));
+  }
+  const auto id = residency_.add(mip_sizes, min_resident_mip);
+  if (id._value >= info_.max_textures) {
+    residency_.remove(id);
+    util::Logger::warn("Could not stream a texture. The streamer is full ({} textures)", info_.max_textures);
+    return std::unexpected(Error{
+        .msg  = "Texture streamer is full",
+        .code = ErrorCode::MemoryAllocationFailure{},
+    });
+  }
+
+  auto texture = Texture{
+      .source       = std::move(asset),
+      .description  = desc,
+      .mip_levels   = metadata.mip_levels,
+      .resident_mip = min_resident_mip,
+  };
+  auto pending = stream(texture, min_resident_mip);
+  if (!pending) {
+    residency_.remove(id);
+    return std::unexpected(pending.error());
+  }
+  texture.pending = std::move(*pending);
+
+  if (info_.fallback_view) {
+    auto index = p_heap_->register_sampled_image(info_.fallback_view);
+    if (!index) {
+      // The upload is already queued, so the image is released once the uploader is done with it
+      orphaned_.push_back(std::move(*texture.pending));
+      residency_.remove(id);
+      return std::unexpected(index.error());
+    }
+    texture.index = *index;
+  }
+
+  if (id._value >= textures_.size()) {
+    textures_.resize(id._value + 1);
+  }
+  textures_[id._value] = std::move(texture);
+
+  return id;
+}
+
+void TextureStreamer::remove(StreamedTextureId id) {
+  auto& texture = textures_[id._value];
+  assert(texture.source && "Texture has already been removed");
+
+  residency_.remove(id);
+  if (texture.index.is_valid()) {
+    p_heap_->release(BindlessArray::SampledImage, texture.index);
+  }
+  retire(texture.current);
+  if (texture.pending) {
+    orphaned_.push_back(std::move(*texture.pending));
+  }
+
+  texture = Texture{};
+}
+
+void TextureStreamer::request_screen_size(StreamedTextureId id, float screen_size, uint32_t viewport_height) {
+  const auto& desc = textures_[id._value].description;
+  const auto mip   = mip_for_screen_size(std::max(desc.width, desc.height), screen_size, viewport_height);
+  residency_.request(id, static_cast<uint32_t>(std::min(mip, static_cast<float>(textures_[id._value].mip_levels))));
+}
+
+void TextureStreamer::begin_frame(uint32_t frame_index) {
+  ERAY_PROFILE_FUNCTION();
+  current_frame_ = frame_index;
+
+  const auto allocator  = p_device_->vma_alloc_manager().allocator();
+  auto& feedback        = feedback_[frame_index];
+  const auto size_bytes = textures_.size() * sizeof(uint32_t);
+  vmaInvalidateAllocation(allocator, feedback.buffer.buffer._buffer._allocation, 0, size_bytes);
+
+  auto* mips = static_cast<uint32_t*>(feedback.buffer.mapped_data);
+  for (auto i = 0U; i < textures_.size(); ++i) {
+    if (textures_[i].source && mips[i] != kNoFeedback) {
+      residency_.request(StreamedTextureId{i}, mips[i]);
+    }
+  }
+
+  std::memset(mips, 0xFF, size_bytes);
+  vmaFlushAllocation(allocator, feedback.buffer.buffer._buffer._allocation, 0, size_bytes);
+}
+
+Result<void, Error> TextureStreamer::update() {
+  ERAY_PROFILE_FUNCTION();
+
+  // == Swap in the uploaded images ====================================================================================
+  for (auto i = 0U; i < textures_.size(); ++i) {
+    auto& texture = textures_[i];
+    if (!texture.pending || !is_usable(*texture.pending)) {
+      continue;
+    }
+
+    retire(texture.current);
+    texture.current      = std::move(texture.pending->image);
+    texture.resident_mip = texture.pending->first_mip;
+    texture.pending.reset();
+    residency_.complete(StreamedTextureId{i});
+
+    if (texture.index.is_valid()) {
+      p_heap_->update_sampled_image(texture.index, *texture.current.view);
+    } else {
+      TRY_UNWRAP_DEFINE(index, p_heap_->register_sampled_image(*texture.current.view));
+      texture.index = index;
+    }
+  }
+
+  for (auto& orphan : orphaned_) {
+    if (is_usable(orphan)) {
+      retire(orphan.image);
+    }
+  }
+  std::erase_if(orphaned_, [](const PendingImage& orphan) { return !orphan.image.image; });
+
+  // == Start the changes of the residency =============================================================================
+  const auto memory_pressure = p_device_->vma_alloc_manager().is_near_budget(info_.memory_pressure_fraction);
+  for (const auto& change : residency_.update(memory_pressure)) {
+    auto& texture = textures_[change.id._value];
+
+    // The tail of a new texture is still uploading
+    if (texture.pending) {
+      residency_.cancel(change.id);
+      continue;
+    }
+
+    auto pending = stream(texture, change.first_mip);
+    if (!pending) {
+      util::Logger::warn("Could not stream the mip {} of a texture: {}", change.first_mip, pending.error().msg);
+      residency_.cancel(change.id);
+      continue;
+    }
+    texture.pending = std::move(*pending);
+  }
+
+  if (has_unsubmitted_) {
+    const auto token = p_uploader_->submit();
+    for (auto& texture : textures_) {
+      if (texture.pending && texture.pending->token.value == 0) {
+        texture.pending->token = token;
+      }
+    }
+    for (auto& orphan : orphaned_) {
+      if (orphan.token.value == 0) {
+        orphan.token = token;
+      }
+    }
+    has_unsubmitted_ = false;
+  }
+
+  return {};
+}
+
+Result<TextureStreamer::PendingImage, Error> TextureStreamer::stream(const Texture& texture, uint32_t first_mip) {
+  const auto& desc    = texture.description;
+  const auto extent   = desc.mip_extent(first_mip);
+  const auto mip_desc = ImageDescription::image2d_desc(desc.format, extent.width, extent.height);
+
+  TRY_UNWRAP_DEFINE(image, ImageResource::create_texture_with_mip_levels(*p_device_, mip_desc,
+                                                                          texture.mip_levels - first_mip));
+  auto pending = PendingImage{
+      .image     = StreamedImage{.image = std::make_unique<ImageResource>(std::move(image))},
+      .first_mip = first_mip,
+  };
+  TRY_UNWRAP_DEFINE(view, pending.image.image->create_image_view());
+  pending.image.view = std::move(view);
+
+  // The levels are packed LOD0 first, so the levels from `first_mip` are the end of the payload
+  const auto payload = texture.source->payload();
+  const auto offset  = static_cast<size_t>(desc.find_size_bytes(first_mip));
+  TRY(p_uploader_->upload(util::MemoryRegion(payload.data() + offset, payload.size() - offset),
+                          *pending.image.image));
+  has_unsubmitted_ = true;
+
+  return pending;
+}
+
+bool TextureStreamer::is_usable(const PendingImage& pending) const {
+  return pending.token.value != 0 && pending.token.value <= p_uploader_->last_acquired().value &&
+         p_uploader_->is_complete(pending.token);
+}
+
+void TextureStreamer::retire(StreamedImage& image) {
+  if (!image.image) {
+    return;
+  }
+
+  if (*image.view) {
+    p_deletion_queue_->push(image.view.release());
+  }
+  p_deletion_queue_->push(std::move(image.image->_image));
+  image.image.reset();
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/res/asset_cache.hpp>
+#include <liberay/vkren/bindless_heap.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/deletion_queue.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image.hpp>
+#include <liberay/vkren/image_description.hpp>
+#include <liberay/vkren/scene/texture_residency.hpp>
+#include <liberay/vkren/transfer_uploader.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Streams the mip levels of the textures cached as `res::AssetKind::Image` assets. A texture starts with its
+ * tail resident (the levels not larger than `CreateInfo::min_resident_size`), the finer levels are uploaded straight
+ * from the mapped asset when requested and dropped under the memory pressure, see `TextureResidency`.
+ *
+ * The image of a texture holds only the resident levels, so the sampling is clamped to them without a `minLod`. A
+ * change of the resident levels uploads a new image on the `TransferUploader` and swaps the bindless descriptor once
+ * the upload is complete and acquired, the previous image is released through the `FrameDeletionQueue`.
+ *
+ * The levels are requested from the CPU (e.g. `request_screen_size()` with the distance heuristic) or from the screen
+ * space feedback: the shaders sampling a streamed texture write the level they need with
+ * `InterlockedMin(feedback[feedback_index], uint(lod + min_lod))`, where `lod` is the `CalculateLevelOfDetail()` of
+ * the resident image and `feedback` is the storage buffer at `feedback_buffer()` of the bindless heap.
+ *
+ * Frame order: `begin_frame()` after the fence of the frame, `TransferUploader::record_acquire_barriers()`, then
+ * `update()` before the recording of the draws.
+ *
+ * @warning Lifetime is bound by the device lifetime. The uploader, the heap and the deletion queue must outlive the
+ * streamer.
+ *
+ */
+class TextureStreamer {
+ public:
+  TextureStreamer() = delete;
+  explicit TextureStreamer(std::nullptr_t) {}
+
+  struct CreateInfo {
+    TextureResidency::CreateInfo residency;
+
+    /**
+     * @brief Capacity of the feedback buffers.
+     *
+     */
+    uint32_t max_textures = 4096;
+
+    /**
+     * @brief The levels whose larger dimension is at most this are always resident.
+     *
+     */
+    uint32_t min_resident_size = 64;
+
+    /**
+     * @brief Fraction of the device-local heap budget above which no level is loaded and the levels that are not
+     * requested anymore are evicted, see `VmaAllocationManager::is_near_budget()`.
+     *
+     */
+    float memory_pressure_fraction = 0.9F;
+
+    /**
+     * @brief View written to the bindless slot of a texture until its tail is uploaded, e.g. a 1x1 texture. Without it
+     * the slot is registered once the tail is resident.
+     *
+     */
+    vk::ImageView fallback_view = nullptr;
+  };
+
+  /**
+   * @brief Creates the feedback buffers of the frames in flight and registers them in the heap.
+   *
+   * @param device
+   * @param uploader
+   * @param heap
+   * @param deletion_queue
+   * @param info
+   * @param frames_in_flight
+   * @return Result<TextureStreamer, Error>
+   */
+  [[nodiscard]] static Result<TextureStreamer, Error> create(Device& device, TransferUploader& uploader,
+                                                             BindlessHeap& heap, FrameDeletionQueue& deletion_queue,
+                                                             const CreateInfo& info, uint32_t frames_in_flight);
+
+  /**
+   * @brief Queues the upload of the tail of the image, the rest of the levels is streamed from the `asset`, which is
+   * kept mapped.
+   *
+   * @param asset `res::AssetKind::Image` asset, see `res::AssetCache::load_mipmapped_image()`.
+   * @return Result<StreamedTextureId, Error>
+   */
+  Result<StreamedTextureId, Error> add(res::CachedAsset&& asset);
+
+  /**
+   * @brief Releases the images and the bindless slot once the frames in flight and the pending uploads are done.
+   *
+   */
+  void remove(StreamedTextureId id);
+
+  void request_mip(StreamedTextureId id, uint32_t mip) { residency_.request(id, mip); }
+
+  /**
+   * @brief Distance heuristic, requests the level of `mip_for_screen_size()`.
+   *
+   * @param id
+   * @param screen_size See `projected_screen_size()`.
+   * @param viewport_height
+   */
+  void request_screen_size(StreamedTextureId id, float screen_size, uint32_t viewport_height);
+
+  /**
+   * @brief Reads the feedback written by the previous submission of the frame and clears it. Call after the fence of
+   * the frame has been waited for.
+   *
+   * @param frame_index
+   */
+  void begin_frame(uint32_t frame_index);
+
+  /**
+   * @brief Swaps in the images whose uploads are complete and acquired, then starts the changes of the residency and
+   * submits the uploads.
+   *
+   * @return Result<void, Error>
+   */
+  Result<void, Error> update();
+
+  /**
+   * @brief Slot of the texture in the sampled image array of the heap, stable for the lifetime of the texture. Invalid
+   * until the tail is resident if there is no fallback view.
+   *
+   */
+  BindlessIndex bindless_index(StreamedTextureId id) const { return textures_[id._value].index; }
+
+  /**
+   * @brief Level of the LOD0 of the resident image, the offset of its level of detail to the full mip chain.
+   *
+   */
+  float min_lod(StreamedTextureId id) const { return static_cast<float>(textures_[id._value].resident_mip); }
+
+  uint32_t feedback_index(StreamedTextureId id) const { return id._value; }
+
+  /**
+   * @brief Slot of the feedback buffer of the current frame in the storage buffer array of the heap.
+   *
+   */
+  BindlessIndex feedback_buffer() const { return feedback_[current_frame_].index; }
+
+  const TextureResidency& residency() const { return residency_; }
+
+ private:
+  struct StreamedImage {
+    std::unique_ptr<ImageResource> image;
+    vk::raii::ImageView view = nullptr;
+  };
+
+  struct PendingImage {
+    StreamedImage image;
+    uint32_t first_mip;
+
+    /**
+     * @brief Zero until the batch of the upload is submitted.
+     *
+     */
+    UploadToken token;
+  };
+
+  struct Texture {
+    std::optional<res::CachedAsset> source;
+    ImageDescription description;
+    uint32_t mip_levels;
+    uint32_t resident_mip;
+    StreamedImage current;
+    std::optional<PendingImage> pending;
+    BindlessIndex index;
+  };
+
+  struct FeedbackBuffer {
+    PersistentlyMappedBufferResource buffer;
+    BindlessIndex index;
+  };
+
+  TextureStreamer(Device& device, TransferUploader& uploader, BindlessHeap& heap, FrameDeletionQueue& deletion_queue,
+                  const CreateInfo& info, std::vector<FeedbackBuffer>&& feedback)
+      : p_device_(&device),
+        p_uploader_(&uploader),
+        p_heap_(&heap),
+        p_deletion_queue_(&deletion_queue),
+        info_(info),
+        residency_(TextureResidency::create(info.residency)),
+        feedback_(std::move(feedback)) {}
+
+  /**
+   * @brief Creates the image of the levels from `first_mip` and queues their upload.
+   *
+   */
+  Result<PendingImage, Error> stream(const Texture& texture, uint32_t first_mip);
+
+  bool is_usable(const PendingImage& pending) const;
+  void retire(StreamedImage& image);
+
+  observer_ptr<Device> p_device_                     = nullptr;
+  observer_ptr<TransferUploader> p_uploader_         = nullptr;
+  observer_ptr<BindlessHeap> p_heap_                 = nullptr;
+  observer_ptr<FrameDeletionQueue> p_deletion_queue_ = nullptr;
+  CreateInfo info_;
+
+  TextureResidency residency_ = TextureResidency(nullptr);
+  std::vector<Texture> textures_;
+  std::vector<FeedbackBuffer> feedback_;
+
+  /**
+   * @brief Pending uploads of the removed textures, the uploader references their images until they are acquired.
+   *
+   */
+  std::vector<PendingImage> orphaned_;
+
+  uint32_t current_frame_ = 0;
+  bool has_unsubmitted_   = false;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <iterator>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/timeline_wait_queue.hpp>
+
+namespace eray::vkren {
+
+std::unique_ptr<TimelineWaitQueue> TimelineWaitQueue::create(Device& device) {
+  return std::unique_ptr<TimelineWaitQueue>(new TimelineWaitQueue(device));
+}
+
+uint64_t TimelineWaitQueue::counter_value(vk::Semaphore semaphore) const {
+  auto value = uint64_t{0};
+  if (auto result = vk::Device{**p_device_}.getSemaphoreCounterValue(semaphore, &value);
+      result != vk::Result::eSuccess) {
+    util::Logger::err("Could not query the timeline semaphore value. {}", vk::to_string(result));
+    return 0;
+  }
+  return value;
+}
+
+void TimelineWaitQueue::push(const Waiter& waiter) {
+  const auto lock = std::lock_guard(mutex_);
+  waiters_.push_back(waiter);
+}
+
+size_t TimelineWaitQueue::poll() {
+  {
+    const auto lock = std::lock_guard(mutex_);
+    counter_values_.clear();
+    for (const auto& waiter : waiters_) {
+      if (std::ranges::find(counter_values_, waiter.semaphore, &std::pair<vk::Semaphore, uint64_t>::first) ==
+          counter_values_.end()) {
+        counter_values_.emplace_back(waiter.semaphore, counter_value(waiter.semaphore));
+      }
+    }
+
+    const auto is_reached = [this](const Waiter& waiter) {
+      return std::ranges::find(counter_values_, waiter.semaphore, &std::pair<vk::Semaphore, uint64_t>::first)
+                 ->second >= waiter.value;
+    };
+    std::ranges::copy_if(waiters_, std::back_inserter(ready_), is_reached);
+    std::erase_if(waiters_, is_reached);
+  }
+
+  const auto count = ready_.size();
+  for (auto& waiter : ready_) {
+    waiter.continuation.resume();
+  }
+  ready_.clear();
+  return count;
+}
+
+size_t TimelineWaitQueue::pending() const {
+  const auto lock = std::lock_guard(mutex_);
+  return waiters_.size();
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/frame_timeline.hpp>
+#include <liberay/vkren/transfer_uploader.hpp>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Coroutines suspended until a timeline semaphore reaches a value, e.g. `co_await waits.wait(uploader, token)`
+ * after an upload. Nothing blocks on the GPU, the queue is polled once per frame by `poll()`, which resumes the
+ * coroutines whose values have been reached on the polling thread.
+ *
+ * The coroutines may suspend on any thread.
+ *
+ * @warning Lifetime is bound by the device lifetime. The semaphores must outlive their waits.
+ *
+ */
+class TimelineWaitQueue {
+ public:
+  TimelineWaitQueue(const TimelineWaitQueue&)            = delete;
+  TimelineWaitQueue& operator=(const TimelineWaitQueue&) = delete;
+
+  [[nodiscard]] static std::unique_ptr<TimelineWaitQueue> create(Device& device);
+
+  class Awaiter {
+   public:
+    Awaiter(TimelineWaitQueue& queue, vk::Semaphore semaphore, uint64_t value)
+        : queue_(&queue), semaphore_(semaphore), value_(value) {}
+
+    bool await_ready() const { return queue_->counter_value(semaphore_) >= value_; }
+    void await_suspend(std::coroutine_handle<> continuation) {
+      queue_->push(Waiter{.semaphore = semaphore_, .value = value_, .continuation = continuation});
+    }
+    void await_resume() const {}
+
+   private:
+    TimelineWaitQueue* queue_;
+    vk::Semaphore semaphore_;
+    uint64_t value_;
+  };
+
+  /**
+   * @brief Suspends the awaiting coroutine until the timeline `semaphore` reaches the `value`.
+   *
+   */
+  Awaiter wait(vk::Semaphore semaphore, uint64_t value) { return Awaiter(*this, semaphore, value); }
+
+  /**
+   * @brief Suspends the awaiting coroutine until the upload batch is complete. The resources of the batch still have
+   * to be acquired by the graphics queue before use, see `TransferUploader::record_acquire_barriers()`.
+   *
+   */
+  Awaiter wait(const TransferUploader& uploader, UploadToken token) {
+    return Awaiter(*this, uploader.timeline(), token.value);
+  }
+
+  /**
+   * @brief Suspends the awaiting coroutine until the graphics work of the `frame` is finished.
+   *
+   */
+  Awaiter wait(const FrameTimeline& timeline, uint64_t frame) {
+    return Awaiter(*this, timeline.graphics_timeline(), frame);
+  }
+
+  /**
+   * @brief Resumes the coroutines whose values have been reached, each semaphore is queried once.
+   *
+   * @return size_t Number of the resumed coroutines.
+   */
+  size_t poll();
+
+  /**
+   * @brief Number of the suspended coroutines, a snapshot.
+   *
+   */
+  size_t pending() const;
+
+ private:
+  struct Waiter {
+    vk::Semaphore semaphore;
+    uint64_t value;
+    std::coroutine_handle<> continuation;
+  };
+
+  explicit TimelineWaitQueue(Device& device) : p_device_(&device) {}
+
+  uint64_t counter_value(vk::Semaphore semaphore) const;
+  void push(const Waiter& waiter);
+
+  observer_ptr<Device> p_device_ = nullptr;
+
+  mutable std::mutex mutex_;
+  std::vector<Waiter> waiters_;
+
+  /**
+   * @brief Used only by `poll()`, the coroutines are resumed outside of the lock so that they may wait again.
+   *
+   */
+  std::vector<Waiter> ready_;
+  std::vector<std::pair<vk::Semaphore, uint64_t>> counter_values_;
+};
+
+}  // namespace eray::vkren
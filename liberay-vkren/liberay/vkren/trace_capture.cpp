@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <liberay/util/cpu_profiler.hpp>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/trace_capture.hpp>
+#include <limits>
+#include <string_view>
+
+namespace eray::vkren {
+
+namespace {
+
+constexpr uint32_t kCpuProcessId        = 1;
+constexpr uint32_t kGpuProcessId        = 2;
+constexpr uint32_t kGraphicsQueueId     = 0;
+constexpr uint32_t kAsyncComputeQueueId = 1;
+
+std::string escape_json(std::string_view str) {
+  auto result = std::string();
+  result.reserve(str.size());
+  for (const auto c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+}  // namespace
+
+TraceCapture TraceCapture::start(const Device& device, uint32_t frame_count, std::filesystem::path path) {
+  auto capture                  = TraceCapture(nullptr);
+  capture.path_                 = std::move(path);
+  capture.frame_count_          = frame_count;
+  capture.profiler_was_enabled_ = util::CpuProfiler::is_enabled();
+  capture.calibration_          = device.calibrate_timestamps();
+  if (!capture.calibration_) {
+    util::Logger::warn("{} is not supported, the trace contains the CPU timeline only",
+                       vk::EXTCalibratedTimestampsExtensionName);
+  }
+
+  util::CpuProfiler::set_enabled(true);
+  util::CpuProfiler::instance().begin_capture();
+  util::Logger::info("Capturing a trace of {} frames", frame_count);
+
+  return capture;
+}
+
+void TraceCapture::end_frame(const RenderGraph& render_graph) {
+  ++frame_;
+  frame_end_ns_.push_back(util::CpuProfiler::now_ns());
+  if (!calibration_) {
+    return;
+  }
+
+  // The results stay the same until the render graph reads back the next frame
+  for (const auto& result : render_graph.profiling_results()) {
+    if (result.gpu_begin_ticks <= last_gpu_begin_ticks_) {
+      continue;
+    }
+    gpu_events_.push_back(GpuEvent{
+        .name          = render_graph.pass_name(result.pass_index),
+        .begin_ns      = calibration_->to_cpu_ns(result.gpu_begin_ticks),
+        .end_ns        = calibration_->to_cpu_ns(result.gpu_end_ticks),
+        .async_compute = result.async_compute,
+    });
+  }
+  for (const auto& result : render_graph.profiling_results()) {
+    last_gpu_begin_ticks_ = std::max(last_gpu_begin_ticks_, result.gpu_begin_ticks);
+  }
+}
+
+Result<void, Error> TraceCapture::finish() {
+  auto& profiler = util::CpuProfiler::instance();
+  profiler.end_capture();
+  util::CpuProfiler::set_enabled(profiler_was_enabled_);
+
+  auto file = std::ofstream(path_, std::ios::trunc);
+  if (!file) {
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not open the trace "{}")", path_.string()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  // The timestamps are written in microseconds relative to the first event, so that they keep their precision
+  const auto cpu_events = profiler.captured_events();
+  auto origin_ns        = std::numeric_limits<uint64_t>::max();
+  for (const auto& event : cpu_events) {
+    origin_ns = std::min(origin_ns, event.start_ns);
+  }
+  for (const auto& event : gpu_events_) {
+    origin_ns = std::min(origin_ns, event.begin_ns);
+  }
+  for (const auto frame_end_ns : frame_end_ns_) {
+    origin_ns = std::min(origin_ns, frame_end_ns);
+  }
+  const auto to_us = [origin_ns](uint64_t ns) {
+    return static_cast<double>(static_cast<int64_t>(ns - origin_ns)) / 1e3;
+  };
+
+  // Every event is preceded by a separator, the process name of the CPU opens the list
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  file << std::format(R"(  {{"name": "process_name", "ph": "M", "pid": {}, "args": {{"name": "CPU"}}}})",
+                      kCpuProcessId);
+
+  const auto write_thread_name = [&file](uint32_t pid, uint32_t tid, std::string_view name) {
+    file << std::format(",\n  " R"({{"name": "thread_name", "ph": "M", "pid": {}, "tid": {}, )"
+                        R"("args": {{"name": "{}"}}}})",
+                        pid, tid, escape_json(name));
+  };
+  const auto write_slice = [&file, &to_us](std::string_view name, uint64_t begin_ns, uint64_t end_ns, uint32_t pid,
+                                           uint32_t tid) {
+    file << std::format(",\n  " R"({{"name": "{}", "ph": "X", "ts": {:.3f}, "dur": {:.3f}, "pid": {}, "tid": {}}})",
+                        escape_json(name), to_us(begin_ns), static_cast<double>(end_ns - begin_ns) / 1e3, pid, tid);
+  };
+
+  // == CPU ============================================================================================================
+  auto named_threads = std::vector<uint32_t>();
+  for (const auto& event : cpu_events) {
+    if (std::ranges::find(named_threads, event.thread_id) == named_threads.end()) {
+      named_threads.push_back(event.thread_id);
+      write_thread_name(kCpuProcessId, event.thread_id, profiler.captured_thread_name(event.thread_id));
+    }
+    write_slice(event.name, event.start_ns, event.end_ns, kCpuProcessId, event.thread_id);
+  }
+  for (auto i = 0U; i < frame_end_ns_.size(); ++i) {
+    file << std::format(",\n  " R"({{"name": "Frame {} end", "ph": "i", "s": "g", "ts": {:.3f}, "pid": {}}})", i,
+                        to_us(frame_end_ns_[i]), kCpuProcessId);
+  }
+
+  // == GPU ============================================================================================================
+  if (calibration_) {
+    file << std::format(",\n  " R"({{"name": "process_name", "ph": "M", "pid": {}, "args": {{"name": "GPU"}}}})",
+                        kGpuProcessId);
+    write_thread_name(kGpuProcessId, kGraphicsQueueId, "Graphics queue");
+    write_thread_name(kGpuProcessId, kAsyncComputeQueueId, "Async compute queue");
+  }
+  for (const auto& event : gpu_events_) {
+    write_slice(event.name, event.begin_ns, event.end_ns, kGpuProcessId,
+                event.async_compute ? kAsyncComputeQueueId : kGraphicsQueueId);
+  }
+  file << "\n]}\n";
+
+  if (!file) {
+    return std::unexpected(Error{
+        .msg  = std::format(R"(Could not write the trace "{}")", path_.string()),
+        .code = ErrorCode::FileError{},
+    });
+  }
+
+  util::Logger::succ(R"(Trace of {} frames written to "{}", open it with https://ui.perfetto.dev)", frame_,
+                     path_.string());
+  return {};
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/render_graph.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace eray::vkren {
+
+/**
+ * @brief Records a few frames of the CPU scopes of the `util::CpuProfiler` and the GPU pass timestamps of the render
+ * graph on a single timeline and writes them as a Chrome trace event JSON, which is opened by the Perfetto UI
+ * (ui.perfetto.dev) and chrome://tracing. The queue submissions, the presentation and the frame waits are CPU scopes of
+ * the application, so the CPU and GPU overlap and the synchronization stalls are visible side by side.
+ *
+ * The GPU timestamps are converted to the CPU timebase with `Device::calibrate_timestamps()`, without
+ * VK_EXT_calibrated_timestamps only the CPU timeline is written. The GPU passes are read back by the render graph a few
+ * frames later, the first captured frames show the passes of the frames recorded before the capture.
+ *
+ * @warning Lifetime is bound by the device lifetime.
+ *
+ */
+class TraceCapture {
+ public:
+  TraceCapture() = delete;
+  explicit TraceCapture(std::nullptr_t) {}
+
+  TraceCapture(const TraceCapture&)                = delete;
+  TraceCapture& operator=(const TraceCapture&)     = delete;
+  TraceCapture(TraceCapture&&) noexcept            = default;
+  TraceCapture& operator=(TraceCapture&&) noexcept = default;
+
+  /**
+   * @brief Starts capturing the CPU scopes, the CPU profiler is enabled until `finish()`.
+   *
+   * @param device
+   * @param frame_count Number of the captured frames.
+   * @param path JSON file the trace is written to.
+   * @return TraceCapture
+   */
+  [[nodiscard]] static TraceCapture start(const Device& device, uint32_t frame_count, std::filesystem::path path);
+
+  /**
+   * @brief Collects the pass timestamps read back by the render graph. Must be called once per frame, after the frame
+   * is emitted and before `ERAY_PROFILE_FRAME()`.
+   *
+   * @param render_graph Must have the profiling enabled, see `RenderGraph::enable_profiling()`.
+   */
+  void end_frame(const RenderGraph& render_graph);
+
+  bool is_finished() const { return frame_ >= frame_count_; }
+
+  /**
+   * @brief Stops the capture, restores the CPU profiler state and writes the trace.
+   *
+   * @return Result<void, Error>
+   */
+  Result<void, Error> finish();
+
+ private:
+  struct GpuEvent {
+    std::string name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    bool async_compute;
+  };
+
+  std::filesystem::path path_;
+  uint32_t frame_count_      = 0;
+  uint32_t frame_            = 0;
+  bool profiler_was_enabled_ = false;
+
+  std::optional<TimestampCalibration> calibration_;
+  uint64_t last_gpu_begin_ticks_ = 0;
+  std::vector<GpuEvent> gpu_events_;
+  std::vector<uint64_t> frame_end_ns_;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,442 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <expected>
+#include <iterator>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/transfer_uploader.hpp>
+#include <liberay/vkren/wait_statistics.hpp>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+#include <vulkan/vulkan_to_string.hpp>
+
+namespace eray::vkren {
+
+Result<TransferUploader, Error> TransferUploader::create(Device& device, vk::DeviceSize staging_chunk_size_bytes) {
+  auto command_pool_info = vk::CommandPoolCreateInfo{
+      .flags            = vk::CommandPoolCreateFlagBits::eTransient,
+      .queueFamilyIndex = device.transfer_queue_family(),
+  };
+  auto command_pool = device->createCommandPool(command_pool_info);
+  if (!command_pool) {
+    util::Logger::err("Could not create a transfer command pool. {}", vk::to_string(command_pool.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Command Pool creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = command_pool.error(),
+    });
+  }
+
+  auto timeline_info = vk::SemaphoreTypeCreateInfo{
+      .semaphoreType = vk::SemaphoreType::eTimeline,
+      .initialValue  = 0,
+  };
+  auto timeline = device->createSemaphore(vk::SemaphoreCreateInfo{.pNext = &timeline_info});
+  if (!timeline) {
+    util::Logger::err("Could not create a transfer timeline semaphore. {}", vk::to_string(timeline.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Semaphore creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = timeline.error(),
+    });
+  }
+
+  return TransferUploader(device, std::move(*command_pool), std::move(*timeline), staging_chunk_size_bytes);
+}
+
+Result<vk::CommandBuffer, Error> TransferUploader::current_cmd_buff() {
+  if (*current_.cmd_buff) {
+    return *current_.cmd_buff;
+  }
+
+  auto cmd_buffs = (*p_device_)->allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+      .commandPool        = command_pool_,
+      .level              = vk::CommandBufferLevel::ePrimary,
+      .commandBufferCount = 1,
+  });
+  if (!cmd_buffs) {
+    util::Logger::err("Could not allocate a transfer command buffer. {}", vk::to_string(cmd_buffs.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Command Buffer allocation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = cmd_buffs.error(),
+    });
+  }
+
+  current_.cmd_buff = std::move(cmd_buffs->front());
+  current_.cmd_buff.begin(vk::CommandBufferBeginInfo{
+      .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+  });
+  return *current_.cmd_buff;
+}
+
+Result<StagingSlice, Error> TransferUploader::allocate_staging(vk::DeviceSize size_bytes) {
+  // The copies are tightly packed, 16 bytes keeps the offsets valid for any texel block size
+  auto fits = [size_bytes](const StagingChunk& chunk) {
+    return ((chunk.offset + 15) & ~vk::DeviceSize{15}) + size_bytes <= chunk.staging.buffer.size_bytes;
+  };
+
+  if (current_.chunks.empty() || !fits(current_.chunks.back())) {
+    auto free_it = std::ranges::find_if(free_chunks_, fits);
+    if (free_it != free_chunks_.end()) {
+      current_.chunks.push_back(std::move(*free_it));
+      free_chunks_.erase(free_it);
+    } else {
+      auto staging = BufferResource::persistently_mapped_staging_buffer(
+          *p_device_, std::max(staging_chunk_size_bytes_, size_bytes));
+      if (!staging) {
+        util::Logger::err("Could not upload the data. Staging buffer creation failed!");
+        return std::unexpected(staging.error());
+      }
+      staging->buffer.set_debug_name("Transfer staging chunk");
+      current_.chunks.push_back(StagingChunk{.staging = std::move(*staging)});
+    }
+  }
+
+  auto& chunk  = current_.chunks.back();
+  auto offset  = (chunk.offset + 15) & ~vk::DeviceSize{15};
+  chunk.offset = offset + size_bytes;
+  p_device_->statistics().count_staging_bytes(size_bytes);
+
+  return StagingSlice{
+      .data   = std::span(static_cast<std::byte*>(chunk.staging.mapped_data) + offset, size_bytes),
+      .buffer = chunk.staging.buffer.vk_buffer(),
+      .offset = offset,
+  };
+}
+
+Result<void, Error> TransferUploader::upload(const util::MemoryRegion& src_region, const BufferResource& dst_buffer,
+                                             vk::DeviceSize dst_offset) {
+  TRY_UNWRAP_DEFINE(slice, allocate_staging(src_region.size_bytes()));
+  std::memcpy(slice.data.data(), src_region.data(), src_region.size_bytes());
+  return upload(slice, dst_buffer, dst_offset);
+}
+
+Result<void, Error> TransferUploader::upload(const StagingSlice& src, const BufferResource& dst_buffer,
+                                             vk::DeviceSize dst_offset) {
+  ERAY_PROFILE_SCOPE("Upload buffer");
+  assert(dst_offset + src.data.size() <= dst_buffer.size_bytes && "Region size exceeds the buffer size");
+
+  TRY_UNWRAP_DEFINE(cmd_buff, current_cmd_buff());
+  cmd_buff.copyBuffer(src.buffer, dst_buffer.vk_buffer(),
+                      vk::BufferCopy{
+                          .srcOffset = src.offset,
+                          .dstOffset = dst_offset,
+                          .size      = src.data.size(),
+                      });
+
+  if (p_device_->has_dedicated_transfer_queue()) {
+    auto release = vk::BufferMemoryBarrier2{
+        .srcStageMask        = vk::PipelineStageFlagBits2::eCopy,
+        .srcAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+        .srcQueueFamilyIndex = p_device_->transfer_queue_family(),
+        .dstQueueFamilyIndex = p_device_->graphics_queue_family(),
+        .buffer              = dst_buffer.vk_buffer(),
+        .offset              = dst_offset,
+        .size                = src.data.size(),
+    };
+    cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+        .bufferMemoryBarrierCount = 1,
+        .pBufferMemoryBarriers    = &release,
+    });
+
+    // The acquire repeats the ownership transfer, only its destination scope matters
+    auto acquire          = release;
+    acquire.srcStageMask  = vk::PipelineStageFlagBits2::eNone;
+    acquire.srcAccessMask = vk::AccessFlagBits2::eNone;
+    acquire.dstStageMask  = vk::PipelineStageFlagBits2::eAllCommands;
+    acquire.dstAccessMask = vk::AccessFlagBits2::eMemoryRead;
+    current_.buffer_acquires.push_back(acquire);
+  }
+
+  return {};
+}
+
+Result<void, Error> TransferUploader::upload(const util::MemoryRegion& src_region, ImageResource& dst_image) {
+  TRY_UNWRAP_DEFINE(slice, allocate_staging(src_region.size_bytes()));
+  std::memcpy(slice.data.data(), src_region.data(), src_region.size_bytes());
+  return upload(slice, dst_image);
+}
+
+Result<void, Error> TransferUploader::upload(const res::Image& image, res::ColorSpace color_space,
+                                             ImageResource& dst_image, util::JobSystem* jobs) {
+  ERAY_PROFILE_SCOPE("Stage image");
+  assert(image.width() == dst_image.description.width && image.height() == dst_image.description.height &&
+         "Image must match the extent of the destination image");
+
+  if (!dst_image.mipmapping_enabled()) {
+    return upload(image.memory_region(), dst_image);
+  }
+
+  assert(image.mip_chain_size_bytes() == dst_image.find_full_size_bytes() &&
+         "Image format must match the format of the destination image");
+  TRY_UNWRAP_DEFINE(slice, allocate_staging(image.mip_chain_size_bytes()));
+  image.generate_mipmaps_into(slice.data, color_space, jobs);
+  return upload(slice, dst_image);
+}
+
+Result<void, Error> TransferUploader::upload(const res::Ktx2Texture& texture, ImageResource& dst_image) {
+  ERAY_PROFILE_SCOPE("Stage KTX2 texture");
+  const auto& desc      = dst_image.description;
+  const auto mip_levels = texture.mip_levels() == dst_image.mip_levels ? dst_image.mip_levels : 1U;
+
+  TRY_UNWRAP_DEFINE(slice, allocate_staging(desc.find_size_bytes(mip_levels)));
+  auto offset = size_t{0};
+  for (auto level = 0U; level < mip_levels; ++level) {
+    const auto data = texture.level_data(level);
+    assert(data.size() == desc.mip_size_bytes(level) && "KTX2 level must match the destination image level");
+    std::memcpy(slice.data.data() + offset, data.data(), data.size());
+    offset += data.size();
+  }
+  return upload(slice, dst_image);
+}
+
+Result<void, Error> TransferUploader::upload(const StagingSlice& src, ImageResource& dst_image) {
+  ERAY_PROFILE_SCOPE("Upload image");
+  const auto full_size = dst_image.find_full_size_bytes();
+  assert((dst_image.mipmapping_enabled() && src.data.size() == full_size) ||
+         src.data.size() == dst_image.lod0_size_bytes() &&
+             "Expected either LOD=0 image level or full image with all of the mipmap levels");
+  assert((dst_image.usage & vk::ImageUsageFlagBits::eTransferDst) &&
+         "Image is not a transfer destination, upload impossible");
+
+  TRY_UNWRAP_DEFINE(cmd_buff, current_cmd_buff());
+
+  const auto& desc            = dst_image.description;
+  const auto copy_mip_levels  = src.data.size() == full_size ? dst_image.mip_levels : 1U;
+  const auto generate_mipmaps = dst_image.mipmapping_enabled() && copy_mip_levels == 1;
+  const auto range            = dst_image.full_resource_range();
+
+  // == Copy the mip levels ============================================================================================
+  auto to_transfer_dst = vk::ImageMemoryBarrier2{
+      .srcStageMask        = vk::PipelineStageFlagBits2::eNone,
+      .srcAccessMask       = vk::AccessFlagBits2::eNone,
+      .dstStageMask        = vk::PipelineStageFlagBits2::eCopy,
+      .dstAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+      .oldLayout           = vk::ImageLayout::eUndefined,
+      .newLayout           = vk::ImageLayout::eTransferDstOptimal,
+      .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .image               = dst_image.vk_image(),
+      .subresourceRange    = range,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .imageMemoryBarrierCount = 1,
+      .pImageMemoryBarriers    = &to_transfer_dst,
+  });
+
+  auto regions    = std::vector<vk::BufferImageCopy>();
+  auto mip_offset = src.offset;
+  for (auto mip_level = 0U; mip_level < copy_mip_levels; ++mip_level) {
+    regions.push_back(vk::BufferImageCopy{
+        .bufferOffset = mip_offset,
+
+        // No padding bytes between rows of the image is assumed
+        .bufferRowLength   = 0,
+        .bufferImageHeight = 0,
+
+        .imageSubresource = dst_image.subresource_layers(mip_level, 0, desc.array_layers),
+        .imageOffset      = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+        .imageExtent      = desc.mip_extent(mip_level),
+    });
+
+    mip_offset += desc.mip_size_bytes(mip_level);
+  }
+  cmd_buff.copyBufferToImage(src.buffer, dst_image.vk_image(), vk::ImageLayout::eTransferDstOptimal, regions);
+
+  // == Hand the image over to the graphics queue ======================================================================
+  if (!p_device_->has_dedicated_transfer_queue()) {
+    // The transfer queue is the graphics queue, so the mipmaps can be generated right away
+    if (generate_mipmaps) {
+      return dst_image.generate_mipmaps(cmd_buff);
+    }
+
+    auto to_shader_read = vk::ImageMemoryBarrier2{
+        .srcStageMask        = vk::PipelineStageFlagBits2::eCopy,
+        .srcAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask        = vk::PipelineStageFlagBits2::eAllCommands,
+        .dstAccessMask       = vk::AccessFlagBits2::eShaderSampledRead,
+        .oldLayout           = vk::ImageLayout::eTransferDstOptimal,
+        .newLayout           = vk::ImageLayout::eShaderReadOnlyOptimal,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image               = dst_image.vk_image(),
+        .subresourceRange    = range,
+    };
+    cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers    = &to_shader_read,
+    });
+    return {};
+  }
+
+  // The layout transition is a part of the ownership transfer, the mipmaps are generated by the graphics queue, so the
+  // image stays a transfer destination
+  auto release = vk::ImageMemoryBarrier2{
+      .srcStageMask        = vk::PipelineStageFlagBits2::eCopy,
+      .srcAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+      .oldLayout           = vk::ImageLayout::eTransferDstOptimal,
+      .newLayout           = generate_mipmaps ? vk::ImageLayout::eTransferDstOptimal
+                                              : vk::ImageLayout::eShaderReadOnlyOptimal,
+      .srcQueueFamilyIndex = p_device_->transfer_queue_family(),
+      .dstQueueFamilyIndex = p_device_->graphics_queue_family(),
+      .image               = dst_image.vk_image(),
+      .subresourceRange    = range,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .imageMemoryBarrierCount = 1,
+      .pImageMemoryBarriers    = &release,
+  });
+
+  auto acquire          = release;
+  acquire.srcStageMask  = vk::PipelineStageFlagBits2::eNone;
+  acquire.srcAccessMask = vk::AccessFlagBits2::eNone;
+  if (generate_mipmaps) {
+    acquire.dstStageMask  = vk::PipelineStageFlagBits2::eBlit;
+    acquire.dstAccessMask = vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite;
+  } else {
+    acquire.dstStageMask  = vk::PipelineStageFlagBits2::eAllCommands;
+    acquire.dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead;
+  }
+  current_.image_acquires.push_back(ImageAcquire{
+      .image            = &dst_image,
+      .barrier          = acquire,
+      .generate_mipmaps = generate_mipmaps,
+  });
+
+  return {};
+}
+
+UploadToken TransferUploader::submit() {
+  ERAY_PROFILE_FUNCTION();
+  recycle_completed_batches();
+  if (!*current_.cmd_buff) {
+    return last_submitted();
+  }
+
+  current_.cmd_buff.end();
+
+  // The staging memory might not be host coherent
+  for (const auto& chunk : current_.chunks) {
+    vmaFlushAllocation(p_device_->vma_alloc_manager().allocator(), chunk.staging.buffer._buffer._allocation, 0,
+                       chunk.offset);
+  }
+
+  current_.value = ++submitted_value_;
+  auto cmd_info  = vk::CommandBufferSubmitInfo{.commandBuffer = *current_.cmd_buff};
+  auto signal    = vk::SemaphoreSubmitInfo{
+         .semaphore = *timeline_,
+         .value     = current_.value,
+         .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+  };
+  p_device_->transfer_queue().submit2(vk::SubmitInfo2{
+      .commandBufferInfoCount   = 1,
+      .pCommandBufferInfos      = &cmd_info,
+      .signalSemaphoreInfoCount = 1,
+      .pSignalSemaphoreInfos    = &signal,
+  });
+
+  std::ranges::move(current_.buffer_acquires, std::back_inserter(pending_buffer_acquires_));
+  std::ranges::move(current_.image_acquires, std::back_inserter(pending_image_acquires_));
+  current_.buffer_acquires.clear();
+  current_.image_acquires.clear();
+
+  in_flight_.push_back(std::move(current_));
+  current_ = Batch{};
+
+  return last_submitted();
+}
+
+void TransferUploader::recycle_completed_batches() {
+  const auto completed = timeline_.getCounterValue();
+  for (auto& batch : in_flight_) {
+    if (batch.value > completed) {
+      continue;
+    }
+    for (auto& chunk : batch.chunks) {
+      chunk.offset = 0;
+      free_chunks_.push_back(std::move(chunk));
+    }
+    batch.chunks.clear();
+    batch.cmd_buff = nullptr;
+  }
+  std::erase_if(in_flight_, [completed](const Batch& batch) { return batch.value <= completed; });
+}
+
+bool TransferUploader::is_complete(UploadToken token) const { return timeline_.getCounterValue() >= token.value; }
+
+Result<void, Error> TransferUploader::wait(UploadToken token, uint64_t timeout_ns,
+                                           const std::source_location& location) const {
+  const auto wait = WaitScope(p_device_->wait_statistics(), "Transfer upload wait", WaitKind::Stall, location);
+  auto wait_info = vk::SemaphoreWaitInfo{
+      .semaphoreCount = 1,
+      .pSemaphores    = &*timeline_,
+      .pValues        = &token.value,
+  };
+  if (auto result = (*p_device_)->waitSemaphores(wait_info, timeout_ns); result != vk::Result::eSuccess) {
+    util::Logger::err("Could not wait for the upload batch {}. {}", token.value, vk::to_string(result));
+    return std::unexpected(Error{
+        .msg     = "Upload wait failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = result,
+    });
+  }
+
+  return {};
+}
+
+Result<void, Error> TransferUploader::record_acquire_barriers(vk::CommandBuffer cmd_buff, MipGenerator* mip_generator) {
+  acquired_value_ = submitted_value_;
+  if (pending_buffer_acquires_.empty() && pending_image_acquires_.empty()) {
+    return {};
+  }
+
+  auto image_barriers = std::vector<vk::ImageMemoryBarrier2>();
+  image_barriers.reserve(pending_image_acquires_.size());
+  for (const auto& acquire : pending_image_acquires_) {
+    image_barriers.push_back(acquire.barrier);
+  }
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{
+      .bufferMemoryBarrierCount = static_cast<uint32_t>(pending_buffer_acquires_.size()),
+      .pBufferMemoryBarriers    = pending_buffer_acquires_.data(),
+      .imageMemoryBarrierCount  = static_cast<uint32_t>(image_barriers.size()),
+      .pImageMemoryBarriers     = image_barriers.data(),
+  });
+
+  auto result = Result<void, Error>{};
+  for (const auto& acquire : pending_image_acquires_) {
+    if (acquire.generate_mipmaps) {
+      auto mipmaps = mip_generator && mip_generator->supports(*acquire.image)
+                         ? mip_generator->record_generate(cmd_buff, *acquire.image)
+                         : acquire.image->generate_mipmaps(cmd_buff);
+      if (!mipmaps) {
+        result = std::unexpected(mipmaps.error());
+      }
+    }
+  }
+
+  pending_buffer_acquires_.clear();
+  pending_image_acquires_.clear();
+
+  return result;
+}
+
+std::optional<vk::SemaphoreSubmitInfo> TransferUploader::graphics_wait_info() {
+  if (graphics_waited_value_ == submitted_value_) {
+    return std::nullopt;
+  }
+
+  graphics_waited_value_ = submitted_value_;
+  return vk::SemaphoreSubmitInfo{
+      .semaphore = *timeline_,
+      .value     = submitted_value_,
+      .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+  };
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <liberay/res/image.hpp>
+#include <liberay/res/ktx2.hpp>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image.hpp>
+#include <liberay/vkren/mip_generator.hpp>
+#include <optional>
+#include <source_location>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Identifies a submitted batch of uploads. The batch is complete when the uploader timeline semaphore reaches
+ * the `value`.
+ *
+ */
+struct UploadToken {
+  uint64_t value = 0;
+};
+
+/**
+ * @brief Persistently mapped staging memory of the current batch, see `TransferUploader::allocate_staging()`.
+ *
+ */
+struct StagingSlice {
+  std::span<std::byte> data;
+  vk::Buffer buffer;
+  vk::DeviceSize offset;
+};
+
+/**
+ * @brief Uploads buffers and images on the transfer queue without blocking the CPU. The uploads are gathered into a
+ * batch that is recorded into a single command buffer and submitted by `submit()`, which signals a timeline semaphore
+ * and returns a token of the batch.
+ *
+ * When the device exposes a dedicated transfer queue family the ownership of the uploaded resources is released by the
+ * transfer queue. The graphics queue must acquire it with `record_acquire_barriers()` and wait for
+ * `graphics_wait_info()` before the resources are used. The mipmaps of images uploaded with the LOD0 only are generated
+ * during the acquire, as blitting is not supported on the transfer queues, by the `MipGenerator` if one is provided.
+ *
+ * @warning Lifetime is bound by the device lifetime. The destination resources must outlive the batch.
+ *
+ */
+class TransferUploader {
+ public:
+  TransferUploader() = delete;
+  explicit TransferUploader(std::nullptr_t) {}
+
+  static constexpr vk::DeviceSize kDefaultStagingChunkSizeBytes = 64 * 1024 * 1024;
+
+  /**
+   * @brief Creates the uploader.
+   *
+   * @param device
+   * @param staging_chunk_size_bytes Staging memory is allocated in chunks of this size (or larger if an upload does not
+   * fit). Chunks of the completed batches are reused.
+   * @return Result<TransferUploader, Error>
+   */
+  [[nodiscard]] static Result<TransferUploader, Error> create(
+      Device& device, vk::DeviceSize staging_chunk_size_bytes = kDefaultStagingChunkSizeBytes);
+
+  /**
+   * @brief Queues the copy of the `src_region` to the `dst_buffer` in the current batch. The data is copied to the
+   * staging memory immediately.
+   *
+   * @param src_region
+   * @param dst_buffer Must have VK_BUFFER_USAGE_TRANSFER_DST_BIT set.
+   * @param dst_offset
+   * @return Result<void, Error>
+   */
+  Result<void, Error> upload(const util::MemoryRegion& src_region, const BufferResource& dst_buffer,
+                             vk::DeviceSize dst_offset = 0);
+
+  /**
+   * @brief Queues the upload of LOD0 image(s) or the full mip chain (see `ImageResource::upload()`) in the current
+   * batch. Expects the layout of the image to be VK_IMAGE_LAYOUT_UNDEFINED. Once the batch is acquired, the layout is
+   * VK_IMAGE_SHADER_READ_ONLY_OPTIMAL.
+   *
+   * @param src_region
+   * @param dst_image Must have VK_IMAGE_USAGE_TRANSFER_DST_BIT set.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> upload(const util::MemoryRegion& src_region, ImageResource& dst_image);
+
+  /**
+   * @brief Reserves the staging memory of the current batch, so the data can be written (e.g. decoded) straight into
+   * it instead of being staged by a copy. The slice may be written from any thread, but it must be uploaded with
+   * `upload(const StagingSlice&, ...)` before the next `submit()`.
+   *
+   * @param size_bytes
+   * @return Result<StagingSlice, Error>
+   */
+  Result<StagingSlice, Error> allocate_staging(vk::DeviceSize size_bytes);
+
+  /**
+   * @brief `upload()` of the data already written to the staging slice, without a copy on the CPU.
+   *
+   */
+  Result<void, Error> upload(const StagingSlice& src, const BufferResource& dst_buffer, vk::DeviceSize dst_offset = 0);
+
+  /**
+   * @brief `upload()` of the LOD0 or the full mip chain already written to the staging slice, without a copy on the
+   * CPU.
+   *
+   */
+  Result<void, Error> upload(const StagingSlice& src, ImageResource& dst_image);
+
+  /**
+   * @brief Generates the mip chain of the image on the CPU straight into the staging memory, so the pixels decoded by
+   * `res::Image::load_from_path()` are written once before the copy to the image. Without the mipmapping only the
+   * LOD0 is uploaded.
+   *
+   * @param image
+   * @param color_space See `res::Image::generate_mipmaps_into()`.
+   * @param dst_image E.g. created from `ImageDescription::from(image, color_space)`.
+   * @param jobs Splits the mipmap generation of the large images across the jobs if provided.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> upload(const res::Image& image, res::ColorSpace color_space, ImageResource& dst_image,
+                             util::JobSystem* jobs = nullptr);
+
+  /**
+   * @brief Copies the levels of the mapped KTX2 file to the staging memory, LOD0 first, with a single copy of every
+   * level. A file without the mip chain is uploaded as the LOD0, the mipmaps are generated if the mipmapping is
+   * enabled.
+   *
+   * @param texture
+   * @param dst_image Created from `ImageDescription::from(texture)`.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> upload(const res::Ktx2Texture& texture, ImageResource& dst_image);
+
+  /**
+   * @brief Submits the current batch with a single submit. Returns the token of the last submitted batch if the current
+   * batch is empty. Also recycles the staging memory and command buffers of the completed batches.
+   *
+   * @return UploadToken
+   */
+  UploadToken submit();
+
+  bool is_complete(UploadToken token) const;
+
+  /**
+   * @brief Blocks the CPU until the batch is complete. The wait is recorded as a stall at the `location`, see
+   * `Device::wait_statistics()`.
+   *
+   * @param token
+   * @param timeout_ns
+   * @param location
+   * @return Result<void, Error>
+   */
+  Result<void, Error> wait(UploadToken token, uint64_t timeout_ns = UINT64_MAX,
+                           const std::source_location& location = std::source_location::current()) const;
+
+  /**
+   * @brief Records the queue family ownership acquire barriers (and the mipmap generation) of the batches submitted
+   * since the previous call. `cmd_buff` must be submitted to the graphics queue after a wait on
+   * `graphics_wait_info()`.
+   *
+   * @param cmd_buff
+   * @param mip_generator Generates the mipmaps of the images it supports in a single dispatch each, the rest are
+   * blitted.
+   * @return Result<void, Error>
+   */
+  Result<void, Error> record_acquire_barriers(vk::CommandBuffer cmd_buff, MipGenerator* mip_generator = nullptr);
+
+  /**
+   * @brief Semaphore wait that must precede the commands recorded with `record_acquire_barriers()` or, when there is
+   * no dedicated transfer queue, any use of the uploaded resources. Returns `std::nullopt` if every batch has already
+   * been waited for.
+   *
+   * @return std::optional<vk::SemaphoreSubmitInfo>
+   */
+  std::optional<vk::SemaphoreSubmitInfo> graphics_wait_info();
+
+  UploadToken last_submitted() const { return UploadToken{.value = submitted_value_}; }
+
+  /**
+   * @brief Timeline semaphore signaled with the `UploadToken::value` of every submitted batch.
+   *
+   */
+  vk::Semaphore timeline() const { return *timeline_; }
+
+  /**
+   * @brief Last batch whose acquire barriers have been recorded by `record_acquire_barriers()`. Once such a batch is
+   * also complete, its resources may be used by any later graphics work.
+   *
+   * @return UploadToken
+   */
+  UploadToken last_acquired() const { return UploadToken{.value = acquired_value_}; }
+
+ private:
+  struct StagingChunk {
+    PersistentlyMappedBufferResource staging;
+    vk::DeviceSize offset = 0;
+  };
+
+  struct ImageAcquire {
+    observer_ptr<ImageResource> image;
+    vk::ImageMemoryBarrier2 barrier;
+    bool generate_mipmaps;
+  };
+
+  struct Batch {
+    vk::raii::CommandBuffer cmd_buff = nullptr;
+    std::vector<StagingChunk> chunks;
+    std::vector<vk::BufferMemoryBarrier2> buffer_acquires;
+    std::vector<ImageAcquire> image_acquires;
+    uint64_t value = 0;
+  };
+
+  TransferUploader(Device& device, vk::raii::CommandPool&& command_pool, vk::raii::Semaphore&& timeline,
+                   vk::DeviceSize staging_chunk_size_bytes)
+      : p_device_(&device),
+        command_pool_(std::move(command_pool)),
+        timeline_(std::move(timeline)),
+        staging_chunk_size_bytes_(staging_chunk_size_bytes) {}
+
+  Result<vk::CommandBuffer, Error> current_cmd_buff();
+  void recycle_completed_batches();
+
+  observer_ptr<Device> p_device_      = nullptr;
+  vk::raii::CommandPool command_pool_ = nullptr;
+  vk::raii::Semaphore timeline_       = nullptr;
+  vk::DeviceSize staging_chunk_size_bytes_{};
+
+  Batch current_;
+  std::vector<Batch> in_flight_;
+  std::vector<StagingChunk> free_chunks_;
+
+  /**
+   * @brief Acquires of the submitted batches that have not been recorded on the graphics queue yet.
+   *
+   */
+  std::vector<vk::BufferMemoryBarrier2> pending_buffer_acquires_;
+  std::vector<ImageAcquire> pending_image_acquires_;
+
+  uint64_t submitted_value_       = 0;
+  uint64_t graphics_waited_value_ = 0;
+  uint64_t acquired_value_        = 0;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,158 @@
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/image_format_helpers.hpp>
+#include <liberay/vkren/upload_batch.hpp>
+#include <liberay/vkren/wait_statistics.hpp>
+#include <numeric>
+#include <utility>
+#include <vulkan/vulkan_enums.hpp>
+#include <vulkan/vulkan_structs.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+constexpr vk::DeviceSize kBufferCopyAlignment = 16;
+
+vk::DeviceSize image_copy_alignment(vk::Format format) {
+  const auto block      = helper::compressed_texel_block(format);
+  const auto texel_size = block ? static_cast<vk::DeviceSize>(block->size_bytes)
+                                : std::max(static_cast<vk::DeviceSize>(helper::bytes_per_pixel(format)),
+                                           vk::DeviceSize{1});
+  return std::lcm(texel_size, vk::DeviceSize{4});
+}
+
+}  // namespace
+
+UploadBatch UploadBatch::create(Device& device) {
+  auto batch      = UploadBatch(nullptr);
+  batch.p_device_ = &device;
+  return batch;
+}
+
+Result<void, Error> UploadBatch::write(const BufferResource& dst_buffer, const util::MemoryRegion& src_region,
+                                       vk::DeviceSize offset) {
+  assert(offset < dst_buffer.size_bytes && "Offset exceeds the buffer size");
+  assert(src_region.size_bytes() <= dst_buffer.size_bytes - offset &&
+         "Region size exceeds available space in the buffer");
+
+  if (dst_buffer.mappable) {
+    return dst_buffer.write(src_region, offset);
+  }
+
+  buffer_writes_.push_back(BufferWrite{
+      .src_region     = src_region,
+      .dst_buffer     = &dst_buffer,
+      .dst_offset     = offset,
+      .staging_offset = reserve_staging(src_region.size_bytes(), kBufferCopyAlignment),
+  });
+  return {};
+}
+
+void UploadBatch::upload(ImageResource& dst_image, util::MemoryRegion src_region, MipGenerator* mip_generator) {
+  upload(dst_image, src_region, dst_image.packed_upload_offsets(src_region.size_bytes()), mip_generator);
+}
+
+void UploadBatch::upload(ImageResource& dst_image, util::MemoryRegion src_region,
+                         std::span<const vk::DeviceSize> mip_offsets, MipGenerator* mip_generator) {
+  for (auto mip_level = 0U; mip_level < mip_offsets.size(); ++mip_level) {
+    assert(mip_offsets[mip_level] + dst_image.description.mip_size_bytes(mip_level) <= src_region.size_bytes() &&
+           "Mip level is out of the source region bounds");
+  }
+
+  const auto alignment = image_copy_alignment(dst_image.description.format);
+  image_uploads_.push_back(ImageUpload{
+      .src_region     = src_region,
+      .dst_image      = &dst_image,
+      .mip_offsets    = std::vector<vk::DeviceSize>(mip_offsets.begin(), mip_offsets.end()),
+      .mip_generator  = mip_generator,
+      .staging_offset = reserve_staging(src_region.size_bytes(), alignment),
+  });
+}
+
+Result<void, Error> UploadBatch::submit() {
+  ERAY_PROFILE_FUNCTION();
+
+  if (empty()) {
+    return {};
+  }
+
+  auto buffer_writes      = std::exchange(buffer_writes_, {});
+  auto image_uploads      = std::exchange(image_uploads_, {});
+  const auto staging_size = std::exchange(staging_size_bytes_, 0);
+
+  auto fence = (*p_device_)->createFence(vk::FenceCreateInfo{});
+  if (!fence) {
+    util::Logger::err("Could not create the upload batch fence: {}", vk::to_string(fence.error()));
+    return std::unexpected(Error{
+        .msg     = "Vulkan Fence creation failure",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = fence.error(),
+    });
+  }
+
+  // == Stage all of the resources in a single buffer ==================================================================
+  auto staging = BufferResource::persistently_mapped_staging_buffer(*p_device_, staging_size);
+  if (!staging) {
+    util::Logger::err("Could not submit the upload batch. Staging buffer creation failed!");
+    return std::unexpected(staging.error());
+  }
+
+  auto* mapped = static_cast<std::byte*>(staging->mapped_data);
+  for (const auto& write : buffer_writes) {
+    std::memcpy(mapped + write.staging_offset, write.src_region.data(), write.src_region.size_bytes());
+  }
+  for (const auto& upload : image_uploads) {
+    std::memcpy(mapped + upload.staging_offset, upload.src_region.data(), upload.src_region.size_bytes());
+  }
+  vmaFlushAllocation(p_device_->vma_alloc_manager().allocator(), staging->buffer._buffer._allocation, 0,
+                     VK_WHOLE_SIZE);
+  p_device_->statistics().count_staging_bytes(staging_size);
+
+  // == Record all of the uploads into a single command buffer =========================================================
+  const auto src_buffer = staging->buffer._buffer._vk_handle;
+  auto cmd_buff         = p_device_->begin_single_time_commands();
+  for (const auto& write : buffer_writes) {
+    cmd_buff.copyBuffer(src_buffer, write.dst_buffer->_buffer._vk_handle,
+                        vk::BufferCopy(write.staging_offset, write.dst_offset, write.src_region.size_bytes()));
+  }
+
+  // A failed mipmap generation leaves the image in the transfer layout, the rest of the batch is still submitted
+  auto result = Result<void, Error>{};
+  for (const auto& upload : image_uploads) {
+    if (auto upload_result = upload.dst_image->record_upload(cmd_buff, src_buffer, upload.staging_offset,
+                                                             upload.mip_offsets, upload.mip_generator);
+        !upload_result && result) {
+      result = std::unexpected(upload_result.error());
+    }
+  }
+  cmd_buff.end();
+
+  // == Submit and wait for a single fence =============================================================================
+  const auto submit_info = vk::SubmitInfo{
+      .commandBufferCount = 1,
+      .pCommandBuffers    = &*cmd_buff,
+  };
+  p_device_->graphics_queue().submit(submit_info, **fence);
+  const auto wait = WaitScope(p_device_->wait_statistics(), "Upload batch fence", WaitKind::Stall);
+  while (vk::Result::eTimeout == (*p_device_)->waitForFences(**fence, vk::True, UINT64_MAX)) {
+    ;
+  }
+
+  return result;
+}
+
+vk::DeviceSize UploadBatch::reserve_staging(vk::DeviceSize size_bytes, vk::DeviceSize alignment) {
+  const auto offset   = (staging_size_bytes_ + alignment - 1) / alignment * alignment;
+  staging_size_bytes_ = offset + size_bytes;
+  return offset;
+}
+
+}  // namespace eray::vkren
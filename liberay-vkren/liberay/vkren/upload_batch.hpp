@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/util/memory_region.hpp>
+#include <liberay/vkren/buffer.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/image.hpp>
+#include <liberay/vkren/mip_generator.hpp>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_handles.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Blocking upload of many buffers and images with a single submit. `ImageResource::upload()` and
+ * `BufferResource::write()` stage and submit every resource on their own and wait for the graphics queue each time,
+ * the batch stages all of the queued resources in a single staging buffer and records all of the copies, the layout
+ * transitions and the mipmap generation into a single command buffer, waited for with a single fence:
+ *
+ *   auto batch = UploadBatch::create(device);
+ *   batch.upload(image, pixels);
+ *   batch.write(buffer, vertices);
+ *   TRY(batch.submit());
+ *
+ * The source memory is only referenced until `submit()`, it is copied to the staging buffer by the submit. Prefer the
+ * `TransferUploader` for the uploads that should not block the CPU.
+ *
+ * @warning Lifetime is bound by the device lifetime. The destination resources must outlive the `submit()`.
+ *
+ */
+class UploadBatch {
+ public:
+  UploadBatch() = delete;
+  explicit UploadBatch(std::nullptr_t) {}
+
+  static UploadBatch create(Device& device);
+
+  /**
+   * @brief Queues the copy of the `src_region` to the `dst_buffer`. Mappable buffers are written right away, like by
+   * `BufferResource::write()`.
+   *
+   * @param dst_buffer Must have VK_BUFFER_USAGE_TRANSFER_DST_BIT set unless it is mappable.
+   * @param src_region Must stay valid until `submit()`.
+   * @param offset
+   * @return Result<void, Error>
+   */
+  Result<void, Error> write(const BufferResource& dst_buffer, const util::MemoryRegion& src_region,
+                            vk::DeviceSize offset = 0);
+
+  /**
+   * @brief Queues the `ImageResource::upload()` of the LOD0 or the full mip chain.
+   *
+   * @param dst_image Expects the layout of the image to be VK_IMAGE_LAYOUT_UNDEFINED. Leaves the layout in the
+   * VK_IMAGE_SHADER_READ_ONLY_OPTIMAL state.
+   * @param src_region Must stay valid until `submit()`.
+   * @param mip_generator Must outlive the `submit()` if provided.
+   */
+  void upload(ImageResource& dst_image, util::MemoryRegion src_region, MipGenerator* mip_generator = nullptr);
+
+  /**
+   * @brief Queues the upload of the first `mip_offsets.size()` levels, see `ImageResource::upload()`.
+   *
+   */
+  void upload(ImageResource& dst_image, util::MemoryRegion src_region, std::span<const vk::DeviceSize> mip_offsets,
+              MipGenerator* mip_generator = nullptr);
+
+  /**
+   * @brief Stages the queued resources, records and submits their uploads to the graphics queue and blocks the CPU
+   * until they are executed. The batch is empty afterwards, even if the submit fails.
+   *
+   * @return Result<void, Error> Fails if the staging buffer cannot be allocated or the mipmaps of an image cannot be
+   * generated, the other uploads are still submitted in the latter case.
+   */
+  Result<void, Error> submit();
+
+  bool empty() const { return buffer_writes_.empty() && image_uploads_.empty(); }
+  size_t size() const { return buffer_writes_.size() + image_uploads_.size(); }
+  vk::DeviceSize staging_size_bytes() const { return staging_size_bytes_; }
+
+ private:
+  struct BufferWrite {
+    util::MemoryRegion src_region;
+    observer_ptr<const BufferResource> dst_buffer;
+    vk::DeviceSize dst_offset;
+    vk::DeviceSize staging_offset;
+  };
+
+  struct ImageUpload {
+    util::MemoryRegion src_region;
+    observer_ptr<ImageResource> dst_image;
+    std::vector<vk::DeviceSize> mip_offsets;
+    observer_ptr<MipGenerator> mip_generator;
+    vk::DeviceSize staging_offset;
+  };
+
+  /**
+   * @brief Reserves the staging range of a resource. The copies to an image require the offset to be a multiple of its
+   * texel block size and of 4.
+   *
+   */
+  vk::DeviceSize reserve_staging(vk::DeviceSize size_bytes, vk::DeviceSize alignment);
+
+  observer_ptr<Device> p_device_{};
+  std::vector<BufferWrite> buffer_writes_;
+  std::vector<ImageUpload> image_uploads_;
+  vk::DeviceSize staging_size_bytes_ = 0;
+};
+
+}  // namespace eray::vkren
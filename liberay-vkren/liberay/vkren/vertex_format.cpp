@@ -0,0 +1,295 @@
+#include <cassert>
+#include <cstring>
+#include <liberay/math/bounds.hpp>
+#include <liberay/math/packed.hpp>
+#include <liberay/util/profiler.hpp>
+#include <liberay/vkren/vertex_format.hpp>
+
+namespace eray::vkren {
+
+namespace {
+
+template <typename T>
+void write_attribute(std::byte* attribute, const T& value) {
+  std::memcpy(attribute, &value, sizeof(T));
+}
+
+VertexEncoding compact_encoding(VertexSemantic semantic) {
+  switch (semantic) {
+    case VertexSemantic::Position:
+      return VertexEncoding::QuantizedUnorm16;
+    case VertexSemantic::Normal:
+      return VertexEncoding::Octahedral;
+    case VertexSemantic::Tangent:
+      return VertexEncoding::Snorm10;
+    case VertexSemantic::Color:
+      return VertexEncoding::Unorm8;
+    case VertexSemantic::TexCoord:
+      return VertexEncoding::Half;
+  }
+  return VertexEncoding::Float32;
+}
+
+VertexLayout layout_with(std::span<const VertexSemantic> semantics, VertexEncoding (*encoding)(VertexSemantic)) {
+  auto specs = util::SmallVector<VertexAttributeSpec, VertexLayout::kMaxAttributes>();
+  for (const auto semantic : semantics) {
+    specs.push_back(VertexAttributeSpec{
+        .semantic = semantic,
+        .encoding = encoding(semantic),
+        .location = static_cast<uint32_t>(specs.size()),
+    });
+  }
+  return VertexLayout::create(specs);
+}
+
+}  // namespace
+
+vk::Format vertex_encoding_format(VertexSemantic semantic, VertexEncoding encoding) {
+  switch (encoding) {
+    case VertexEncoding::Float32:
+      switch (semantic) {
+        case VertexSemantic::Position:
+        case VertexSemantic::Normal:
+          return kVertexFormatOf<math::Vec3f>;
+        case VertexSemantic::Tangent:
+        case VertexSemantic::Color:
+          return kVertexFormatOf<math::Vec4f>;
+        case VertexSemantic::TexCoord:
+          return kVertexFormatOf<math::Vec2f>;
+      }
+      break;
+    case VertexEncoding::Half:
+      if (semantic == VertexSemantic::Position) {
+        return kVertexFormatOf<math::Half4>;
+      }
+      if (semantic == VertexSemantic::TexCoord) {
+        return kVertexFormatOf<math::Half2>;
+      }
+      break;
+    case VertexEncoding::QuantizedUnorm16:
+      if (semantic == VertexSemantic::Position) {
+        return kVertexFormatOf<math::Unorm16x4>;
+      }
+      break;
+    case VertexEncoding::Octahedral:
+      if (semantic == VertexSemantic::Normal) {
+        return kVertexFormatOf<math::Snorm16x2>;
+      }
+      break;
+    case VertexEncoding::Snorm10:
+      if (semantic == VertexSemantic::Normal || semantic == VertexSemantic::Tangent) {
+        return kVertexFormatOf<math::Snorm10x3_2>;
+      }
+      break;
+    case VertexEncoding::Unorm8:
+      if (semantic == VertexSemantic::Color) {
+        return kVertexFormatOf<math::Unorm8x4>;
+      }
+      break;
+  }
+  return vk::Format::eUndefined;
+}
+
+uint32_t vertex_encoding_size(VertexSemantic semantic, VertexEncoding encoding) {
+  switch (vertex_encoding_format(semantic, encoding)) {
+    case vk::Format::eR32G32B32A32Sfloat:
+      return 16;
+    case vk::Format::eR32G32B32Sfloat:
+      return 12;
+    case vk::Format::eR32G32Sfloat:
+    case vk::Format::eR16G16B16A16Sfloat:
+    case vk::Format::eR16G16B16A16Unorm:
+      return 8;
+    case vk::Format::eR16G16Sfloat:
+    case vk::Format::eR16G16Snorm:
+    case vk::Format::eA2B10G10R10SnormPack32:
+    case vk::Format::eR8G8B8A8Unorm:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+PositionDequantization PositionDequantization::from_bounds(const math::Aabb3f& bounds) {
+  if (bounds.empty()) {
+    return PositionDequantization{};
+  }
+
+  const auto size = bounds.max - bounds.min;
+  return PositionDequantization{
+      .offset = math::Vec4f(bounds.min.x(), bounds.min.y(), bounds.min.z(), 0.F),
+      .scale  = math::Vec4f(size.x() > 0.F ? size.x() : 1.F, size.y() > 0.F ? size.y() : 1.F,
+                            size.z() > 0.F ? size.z() : 1.F, 1.F),
+  };
+}
+
+math::Vec3f PositionDequantization::decode(const math::Unorm16x4& quantized) const {
+  const auto unit = quantized.to_vec();
+  return math::Vec3f(offset.x() + unit.x() * scale.x(), offset.y() + unit.y() * scale.y(),
+                     offset.z() + unit.z() * scale.z());
+}
+
+math::Unorm16x4 PositionDequantization::encode(const math::Vec3f& position) const {
+  return math::Unorm16x4::from_vec(math::Vec4f((position.x() - offset.x()) / scale.x(),
+                                               (position.y() - offset.y()) / scale.y(),
+                                               (position.z() - offset.z()) / scale.z(), 1.F));
+}
+
+VertexLayout VertexLayout::create(std::span<const VertexAttributeSpec> attributes) {
+  assert(attributes.size() <= kMaxAttributes && "Too many vertex attributes");
+
+  auto layout = VertexLayout();
+  for (const auto& spec : attributes) {
+    const auto size = vertex_encoding_size(spec.semantic, spec.encoding);
+    assert(size > 0 && "Vertex attribute semantic can not be stored with the encoding");
+    layout.attributes_.push_back(Attribute{
+        .semantic = spec.semantic,
+        .encoding = spec.encoding,
+        .location = spec.location,
+        .offset   = layout.stride_,
+    });
+    layout.stride_ += size;
+  }
+  return layout;
+}
+
+VertexLayout VertexLayout::compact(std::span<const VertexSemantic> semantics) {
+  return layout_with(semantics, compact_encoding);
+}
+
+VertexLayout VertexLayout::uncompressed(std::span<const VertexSemantic> semantics) {
+  return layout_with(semantics, [](VertexSemantic) { return VertexEncoding::Float32; });
+}
+
+vk::VertexInputBindingDescription VertexLayout::binding_description(uint32_t binding) const {
+  return vk::VertexInputBindingDescription{
+      .binding   = binding,
+      .stride    = stride_,
+      .inputRate = vk::VertexInputRate::eVertex,
+  };
+}
+
+util::SmallVector<vk::VertexInputAttributeDescription, VertexLayout::kMaxAttributes>
+VertexLayout::attribute_descriptions(uint32_t binding) const {
+  auto result = util::SmallVector<vk::VertexInputAttributeDescription, kMaxAttributes>();
+  for (const auto& attribute : attributes_) {
+    result.push_back(vk::VertexInputAttributeDescription{
+        .location = attribute.location,
+        .binding  = binding,
+        .format   = vertex_encoding_format(attribute.semantic, attribute.encoding),
+        .offset   = attribute.offset,
+    });
+  }
+  return result;
+}
+
+util::SmallVector<vk::VertexInputAttributeDescription, VertexLayout::kMaxAttributes>
+VertexLayout::position_attribute_descriptions(uint32_t binding) const {
+  auto result = util::SmallVector<vk::VertexInputAttributeDescription, kMaxAttributes>();
+  for (const auto& attribute : attributes_) {
+    if (attribute.semantic == VertexSemantic::Position) {
+      result.push_back(vk::VertexInputAttributeDescription{
+          .location = attribute.location,
+          .binding  = binding,
+          .format   = vertex_encoding_format(attribute.semantic, attribute.encoding),
+          .offset   = attribute.offset,
+      });
+    }
+  }
+  return result;
+}
+
+PositionDequantization VertexLayout::encode(const VertexStreams& streams, std::span<std::byte> out) const {
+  return encode(streams, math::Aabb3f::from_points(streams.positions), out);
+}
+
+PositionDequantization VertexLayout::encode(const VertexStreams& streams, const math::Aabb3f& position_bounds,
+                                            std::span<std::byte> out) const {
+  ERAY_PROFILE_FUNCTION();
+
+  const auto dequantization = PositionDequantization::from_bounds(position_bounds);
+  const auto vertex_count   = stride_ == 0 ? size_t{0} : out.size() / stride_;
+
+  // Attribute by attribute, every stream is read sequentially
+  for (const auto& attribute : attributes_) {
+    auto* vertex = out.data() + attribute.offset;
+    switch (attribute.semantic) {
+      case VertexSemantic::Position: {
+        assert(streams.positions.size() <= vertex_count && "Vertex output must fit all of the positions");
+        for (const auto& position : streams.positions) {
+          switch (attribute.encoding) {
+            case VertexEncoding::QuantizedUnorm16:
+              write_attribute(vertex, dequantization.encode(position));
+              break;
+            case VertexEncoding::Half:
+              write_attribute(vertex, math::Half4::from_vec(math::Vec4f(position, 1.F)));
+              break;
+            default:
+              write_attribute(vertex, position);
+              break;
+          }
+          vertex += stride_;
+        }
+        break;
+      }
+      case VertexSemantic::Normal: {
+        assert(streams.normals.size() <= vertex_count && "Vertex output must fit all of the normals");
+        for (const auto& normal : streams.normals) {
+          switch (attribute.encoding) {
+            case VertexEncoding::Octahedral:
+              write_attribute(vertex, math::oct_encode(normal));
+              break;
+            case VertexEncoding::Snorm10:
+              write_attribute(vertex, math::Snorm10x3_2::from_vec(math::Vec4f(normal, 0.F)));
+              break;
+            default:
+              write_attribute(vertex, normal);
+              break;
+          }
+          vertex += stride_;
+        }
+        break;
+      }
+      case VertexSemantic::Tangent: {
+        assert(streams.tangents.size() <= vertex_count && "Vertex output must fit all of the tangents");
+        for (const auto& tangent : streams.tangents) {
+          if (attribute.encoding == VertexEncoding::Snorm10) {
+            write_attribute(vertex, math::Snorm10x3_2::from_vec(tangent));
+          } else {
+            write_attribute(vertex, tangent);
+          }
+          vertex += stride_;
+        }
+        break;
+      }
+      case VertexSemantic::Color: {
+        assert(streams.colors.size() <= vertex_count && "Vertex output must fit all of the colors");
+        for (const auto& color : streams.colors) {
+          if (attribute.encoding == VertexEncoding::Unorm8) {
+            write_attribute(vertex, math::Unorm8x4::from_vec(color));
+          } else {
+            write_attribute(vertex, color);
+          }
+          vertex += stride_;
+        }
+        break;
+      }
+      case VertexSemantic::TexCoord: {
+        assert(streams.tex_coords.size() <= vertex_count && "Vertex output must fit all of the texture coordinates");
+        for (const auto& tex_coord : streams.tex_coords) {
+          if (attribute.encoding == VertexEncoding::Half) {
+            write_attribute(vertex, math::Half2::from_vec(tex_coord));
+          } else {
+            write_attribute(vertex, tex_coord);
+          }
+          vertex += stride_;
+        }
+        break;
+      }
+    }
+  }
+
+  return dequantization;
+}
+
+}  // namespace eray::vkren
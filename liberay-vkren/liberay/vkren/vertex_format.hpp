@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <liberay/math/bounds.hpp>
+#include <liberay/math/packed.hpp>
+#include <liberay/math/vec.hpp>
+#include <liberay/util/small_vector.hpp>
+#include <span>
+#include <vulkan/vulkan.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Vertex input format of a vertex attribute type, `vk::Format::eUndefined` for the types without one.
+ *
+ */
+template <typename T>
+inline constexpr vk::Format kVertexFormatOf = vk::Format::eUndefined;
+
+template <>
+inline constexpr vk::Format kVertexFormatOf<float> = vk::Format::eR32Sfloat;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Vec2f> = vk::Format::eR32G32Sfloat;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Vec3f> = vk::Format::eR32G32B32Sfloat;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Vec4f> = vk::Format::eR32G32B32A32Sfloat;
+
+template <>
+inline constexpr vk::Format kVertexFormatOf<int32_t> = vk::Format::eR32Sint;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Vec2i> = vk::Format::eR32G32Sint;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Vec3i> = vk::Format::eR32G32B32Sint;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Vec4i> = vk::Format::eR32G32B32A32Sint;
+
+template <>
+inline constexpr vk::Format kVertexFormatOf<uint32_t> = vk::Format::eR32Uint;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Vec2u> = vk::Format::eR32G32Uint;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Vec3u> = vk::Format::eR32G32B32Uint;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Vec4u> = vk::Format::eR32G32B32A32Uint;
+
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Half> = vk::Format::eR16Sfloat;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Half2> = vk::Format::eR16G16Sfloat;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Half4> = vk::Format::eR16G16B16A16Sfloat;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Snorm16x2> = vk::Format::eR16G16Snorm;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Unorm8x4> = vk::Format::eR8G8B8A8Unorm;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Unorm16x4> = vk::Format::eR16G16B16A16Unorm;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Unorm10x3_2> = vk::Format::eA2B10G10R10UnormPack32;
+template <>
+inline constexpr vk::Format kVertexFormatOf<math::Snorm10x3_2> = vk::Format::eA2B10G10R10SnormPack32;
+
+template <typename T>
+concept CVertexAttribute = kVertexFormatOf<T> != vk::Format::eUndefined;
+
+/**
+ * @brief Describes a vertex attribute of type `T` for `GraphicsPipelineBuilder::with_input_state()`, e.g.
+ * `vertex_attribute<math::Snorm16x2>(1, offsetof(Vertex, normal))`. The normalized types are read by the shader as
+ * floats, the octahedral normals still need `oct_decode` in the shader.
+ *
+ * @tparam T
+ * @param location Location of the input in the vertex shader.
+ * @param offset Offset of the attribute in the vertex.
+ * @param binding
+ * @return vk::VertexInputAttributeDescription
+ */
+template <CVertexAttribute T>
+[[nodiscard]] constexpr vk::VertexInputAttributeDescription vertex_attribute(uint32_t location, uint32_t offset,
+                                                                             uint32_t binding = 0) {
+  return vk::VertexInputAttributeDescription{
+      .location = location,
+      .binding  = binding,
+      .format   = kVertexFormatOf<T>,
+      .offset   = offset,
+  };
+}
+
+enum class VertexSemantic : uint8_t {
+  Position = 0,
+  Normal   = 1,
+  Tangent  = 2,
+  Color    = 3,
+  TexCoord = 4,
+};
+
+/**
+ * @brief Storage of a vertex attribute. The valid encodings of the semantics:
+ *  - `Float32`: all of them, 3 floats for the positions and the normals, 4 for the tangents and the colors, 2 for the
+ *    texture coordinates,
+ *  - `Half`: the positions (`Half4` with w = 1) and the texture coordinates (`Half2`),
+ *  - `QuantizedUnorm16`: the positions, `Unorm16x4` relative to the bounding box of the mesh, see
+ *    `PositionDequantization`,
+ *  - `Octahedral`: the normals, `Snorm16x2` (see `math::oct_encode()`),
+ *  - `Snorm10`: the normals and the tangents, `Snorm10x3_2` with the bitangent sign in w,
+ *  - `Unorm8`: the colors, `Unorm8x4`.
+ *
+ */
+enum class VertexEncoding : uint8_t {
+  Float32          = 0,
+  Half             = 1,
+  QuantizedUnorm16 = 2,
+  Octahedral       = 3,
+  Snorm10          = 4,
+  Unorm8           = 5,
+};
+
+/**
+ * @brief Returns `vk::Format::eUndefined` if the semantic can not be stored with the encoding.
+ *
+ */
+[[nodiscard]] vk::Format vertex_encoding_format(VertexSemantic semantic, VertexEncoding encoding);
+
+/**
+ * @brief Size of the attribute in bytes, 0 if the semantic can not be stored with the encoding.
+ *
+ */
+[[nodiscard]] uint32_t vertex_encoding_size(VertexSemantic semantic, VertexEncoding encoding);
+
+/**
+ * @brief Maps the quantized positions back to the object space, `position = offset + quantized * scale`. The w of both
+ * is chosen so that the decoded w is 1. Matches `PositionDequantization` of
+ * `liberay-vkren/shaders/vertex_decode.slang`, pass it to the vertex shader with the mesh (e.g. in the push constants).
+ *
+ */
+struct PositionDequantization {
+  math::Vec4f offset = math::Vec4f(0.F, 0.F, 0.F, 0.F);
+  math::Vec4f scale  = math::Vec4f(1.F, 1.F, 1.F, 1.F);
+
+  /**
+   * @brief Dequantization of the positions inside of the box. A flat box keeps a non-zero scale, so the quantization
+   * does not divide by zero.
+   *
+   */
+  [[nodiscard]] static PositionDequantization from_bounds(const math::Aabb3f& bounds);
+
+  [[nodiscard]] math::Vec3f decode(const math::Unorm16x4& quantized) const;
+  [[nodiscard]] math::Unorm16x4 encode(const math::Vec3f& position) const;
+};
+
+/**
+ * @brief Attribute streams of the encoded vertices, one element per vertex. The streams of the semantics that are not
+ * in the layout are ignored. The tangents store the bitangent sign in w.
+ *
+ */
+struct VertexStreams {
+  std::span<const math::Vec3f> positions;
+  std::span<const math::Vec3f> normals;
+  std::span<const math::Vec4f> tangents;
+  std::span<const math::Vec4f> colors;
+  std::span<const math::Vec2f> tex_coords;
+};
+
+struct VertexAttributeSpec {
+  VertexSemantic semantic;
+  VertexEncoding encoding;
+
+  /**
+   * @brief Location of the input in the vertex shader.
+   *
+   */
+  uint32_t location;
+};
+
+/**
+ * @brief Interleaved vertex format declared by the attribute semantics. The layout picks the offsets, produces the
+ * Vulkan input state for `GraphicsPipelineBuilder::with_input_state()` and encodes the float attribute streams into a
+ * vertex buffer, e.g.:
+ * @code
+ * const auto layout = VertexLayout::compact({VertexSemantic::Position, VertexSemantic::Normal});
+ * auto vertices     = std::vector<std::byte>(layout.size_bytes(positions.size()));
+ * const auto dequant = layout.encode(VertexStreams{.positions = positions, .normals = normals}, vertices);
+ * @endcode
+ * The shaders decode the attributes with `liberay-vkren/shaders/vertex_decode.slang`.
+ *
+ */
+class VertexLayout {
+ public:
+  static constexpr size_t kMaxAttributes = 8;
+
+  /**
+   * @brief Lays out the attributes in the given order, every attribute is 4-byte aligned.
+   *
+   */
+  [[nodiscard]] static VertexLayout create(std::span<const VertexAttributeSpec> attributes);
+
+  /**
+   * @brief Picks the most compact encoding of every semantic: the quantized positions, the octahedral normals, the
+   * snorm10 tangents, the unorm8 colors and the half texture coordinates. The locations follow the given order.
+   *
+   */
+  [[nodiscard]] static VertexLayout compact(std::span<const VertexSemantic> semantics);
+  [[nodiscard]] static VertexLayout compact(std::initializer_list<VertexSemantic> semantics) {
+    return compact(std::span(semantics.begin(), semantics.size()));
+  }
+
+  /**
+   * @brief Layout of the same semantics without any compression, the baseline of `compact()`.
+   *
+   */
+  [[nodiscard]] static VertexLayout uncompressed(std::span<const VertexSemantic> semantics);
+  [[nodiscard]] static VertexLayout uncompressed(std::initializer_list<VertexSemantic> semantics) {
+    return uncompressed(std::span(semantics.begin(), semantics.size()));
+  }
+
+  uint32_t stride() const { return stride_; }
+  size_t size_bytes(size_t vertex_count) const { return vertex_count * stride_; }
+
+  struct Attribute {
+    VertexSemantic semantic;
+    VertexEncoding encoding;
+    uint32_t location;
+    uint32_t offset;
+  };
+  std::span<const Attribute> attributes() const { return attributes_; }
+
+  [[nodiscard]] vk::VertexInputBindingDescription binding_description(uint32_t binding = 0) const;
+  [[nodiscard]] util::SmallVector<vk::VertexInputAttributeDescription, kMaxAttributes> attribute_descriptions(
+      uint32_t binding = 0) const;
+
+  /**
+   * @brief Only the position attribute of the layout (empty if there is none), the position-only input of the depth
+   * pre-pass reading the same vertex buffer, see `GraphicsPipelineBuilder::depth_only_variant()`. The vertex fetch skips
+   * the rest of the attributes.
+   *
+   */
+  [[nodiscard]] util::SmallVector<vk::VertexInputAttributeDescription, kMaxAttributes> position_attribute_descriptions(
+      uint32_t binding = 0) const;
+
+  /**
+   * @brief Encodes the streams into the interleaved vertices. The position bounds are computed from the streams.
+   *
+   * @param streams Every stream of a semantic of the layout must hold a value per vertex.
+   * @param out At least `size_bytes()` of the vertex count.
+   * @return PositionDequantization Identity if the positions are not quantized.
+   */
+  PositionDequantization encode(const VertexStreams& streams, std::span<std::byte> out) const;
+
+  /**
+   * @brief Encodes the streams with the given position bounds, e.g. the bounds shared by the LODs of a mesh.
+   *
+   */
+  PositionDequantization encode(const VertexStreams& streams, const math::Aabb3f& position_bounds,
+                                std::span<std::byte> out) const;
+
+ private:
+  util::SmallVector<Attribute, kMaxAttributes> attributes_;
+  uint32_t stride_ = 0;
+};
+
+}  // namespace eray::vkren
@@ -1,10 +1,80 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <liberay/util/logger.hpp>
 #include <liberay/util/variant_match.hpp>
 #include <liberay/vkren/vma_allocation_manager.hpp>
+#include <optional>
+#include <utility>
 
 namespace eray::vkren {
 
+namespace {
+
+// User data of the allocations owned by the manager, zero is reserved for the allocations the manager does not know
+static_assert(sizeof(uintptr_t) >= sizeof(uint64_t), "Slot and version must fit into the allocation user data");
+
+void* pack_slot(uint32_t slot, uint32_t version) {
+  const auto packed = (static_cast<uintptr_t>(version) << 32U) | (static_cast<uintptr_t>(slot) + 1);
+  return reinterpret_cast<void*>(packed);  // NOLINT
+}
+
+uint32_t unpack_slot(void* user_data) {
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(user_data) & 0xFFFFFFFFU) - 1;  // NOLINT
+}
+
+uint32_t unpack_version(void* user_data) {
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(user_data) >> 32U);  // NOLINT
+}
+
+}  // namespace
+
+MemoryCategory buffer_memory_category(vk::BufferUsageFlags usage) {
+  if (usage & (vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer)) {
+    return MemoryCategory::Geometry;
+  }
+  if (usage & vk::BufferUsageFlagBits::eUniformBuffer) {
+    return MemoryCategory::Uniform;
+  }
+
+  // Staging and readback buffers are only used as the transfer source or destination
+  const auto transfer = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+  if (usage && (usage & ~transfer) == vk::BufferUsageFlags{}) {
+    return MemoryCategory::Staging;
+  }
+
+  return MemoryCategory::Other;
+}
+
+MemoryCategory image_memory_category(vk::ImageUsageFlags usage) {
+  if (usage & (vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eDepthStencilAttachment |
+               vk::ImageUsageFlagBits::eInputAttachment)) {
+    return MemoryCategory::Attachment;
+  }
+  if (usage & vk::ImageUsageFlagBits::eSampled) {
+    return MemoryCategory::Texture;
+  }
+
+  return MemoryCategory::Other;
+}
+
 VmaAllocationManager::VmaAllocationManager(VmaAllocationManager&& other) noexcept
-    : allocator_(other.allocator_), vma_objects_(std::move(other.vma_objects_)) {
+    : allocator_(other.allocator_),
+      device_(other.device_),
+      objects_(std::move(other.objects_)),
+      slots_(std::move(other.slots_)),
+      free_slots_(std::move(other.free_slots_)),
+      aliasing_image_slots_(std::move(other.aliasing_image_slots_)),
+      category_stats_(other.category_stats_),
+      next_serial_(other.next_serial_),
+      defrag_context_(std::exchange(other.defrag_context_, nullptr)),
+      defrag_pass_(other.defrag_pass_),
+      defrag_pass_recorded_(std::exchange(other.defrag_pass_recorded_, false)),
+      defrag_cpu_time_budget_(other.defrag_cpu_time_budget_),
+      pending_moves_(std::move(other.pending_moves_)) {
   other.allocator_ = nullptr;
 }
 
@@ -16,21 +86,38 @@ VmaAllocationManager& VmaAllocationManager::operator=(VmaAllocationManager&& oth
   if (allocator_ != nullptr) {
     destroy();
   }
-  allocator_       = other.allocator_;
-  vma_objects_     = std::move(other.vma_objects_);
-  other.allocator_ = nullptr;
+  allocator_              = other.allocator_;
+  device_                 = other.device_;
+  objects_                = std::move(other.objects_);
+  slots_                  = std::move(other.slots_);
+  free_slots_             = std::move(other.free_slots_);
+  aliasing_image_slots_   = std::move(other.aliasing_image_slots_);
+  category_stats_         = other.category_stats_;
+  next_serial_            = other.next_serial_;
+  defrag_context_         = std::exchange(other.defrag_context_, nullptr);
+  defrag_pass_            = other.defrag_pass_;
+  defrag_pass_recorded_   = std::exchange(other.defrag_pass_recorded_, false);
+  defrag_cpu_time_budget_ = other.defrag_cpu_time_budget_;
+  pending_moves_          = std::move(other.pending_moves_);
+  other.allocator_        = nullptr;
 
   return *this;
 }
 
 Result<VmaAllocationManager, Error> VmaAllocationManager::create(vk::PhysicalDevice physical_device, vk::Device device,
-                                                                 vk::Instance instance) {
+                                                                 vk::Instance instance, bool memory_budget) {
   auto allocator_info           = VmaAllocatorCreateInfo{};
   allocator_info.physicalDevice = physical_device;
   allocator_info.device         = device;
   allocator_info.instance       = instance;
   allocator_info.flags          = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
 
+  // The memory budget query relies on vkGetPhysicalDeviceMemoryProperties2, which is core since Vulkan 1.1
+  allocator_info.vulkanApiVersion = VK_API_VERSION_1_3;
+  if (memory_budget) {
+    allocator_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+  }
+
   VmaAllocator allocator = nullptr;
 
   auto result = vk::Result(vmaCreateAllocator(&allocator_info, &allocator));
@@ -44,12 +131,13 @@ Result<VmaAllocationManager, Error> VmaAllocationManager::create(vk::PhysicalDev
     });
   }
 
-  return VmaAllocationManager(allocator);
+  return VmaAllocationManager(allocator, device);
 }
 
 Result<VmaBuffer, Error> VmaAllocationManager::create_buffer(const vk::BufferCreateInfo& buffer_create_info,
                                                              const VmaAllocationCreateInfo& alloc_create_info,
-                                                             VmaAllocationInfo& out_alloc_info) {
+                                                             VmaAllocationInfo& out_alloc_info,
+                                                             const std::source_location& location) {
   VkBuffer buf        = VK_NULL_HANDLE;
   VmaAllocation alloc = nullptr;
   VkResult res        = vmaCreateBuffer(allocator_, reinterpret_cast<const VkBufferCreateInfo*>(&buffer_create_info),
@@ -66,14 +154,33 @@ Result<VmaBuffer, Error> VmaAllocationManager::create_buffer(const vk::BufferCre
       .vk_buffer  = vk::Buffer(buf),
       .allocation = alloc,
   };
-  vma_objects_.emplace(vma_buff);
+
+  // The defragmentation recreates the buffer from its create info, the chained structures would not outlive the call
+  auto movable_create_info = std::optional<vk::BufferCreateInfo>();
+  if ((alloc_create_info.flags & VMA_ALLOCATION_CREATE_MAPPED_BIT) == 0 && buffer_create_info.pNext == nullptr &&
+      buffer_create_info.sharingMode == vk::SharingMode::eExclusive) {
+    movable_create_info = buffer_create_info;
+  }
+
+  insert_object(ManagedObject{
+      .object              = vma_buff,
+      .category            = buffer_memory_category(buffer_create_info.usage),
+      .size_bytes          = out_alloc_info.size,
+      .movable_create_info = movable_create_info,
+      .vk_handle_owner     = nullptr,
+      .slot                = 0,
+      .name                = {},
+      .location            = location,
+      .serial              = 0,
+  });
 
   return vma_buff;
 }
 
 Result<VmaImage, Error> VmaAllocationManager::create_image(const vk::ImageCreateInfo& image_create_info,
                                                            const VmaAllocationCreateInfo& alloc_create_info,
-                                                           VmaAllocationInfo& out_alloc_info) {
+                                                           VmaAllocationInfo& out_alloc_info,
+                                                           const std::source_location& location) {
   VkImage vkimg{};
   VmaAllocation alloc{};
   auto result = vmaCreateImage(allocator_, reinterpret_cast<const VkImageCreateInfo*>(&image_create_info),
@@ -89,7 +196,17 @@ Result<VmaImage, Error> VmaAllocationManager::create_image(const vk::ImageCreate
       .vk_image   = vk::Image(vkimg),
       .allocation = alloc,
   };
-  vma_objects_.emplace(vma_img);
+  insert_object(ManagedObject{
+      .object              = vma_img,
+      .category            = image_memory_category(image_create_info.usage),
+      .size_bytes          = out_alloc_info.size,
+      .movable_create_info = std::nullopt,
+      .vk_handle_owner     = nullptr,
+      .slot                = 0,
+      .name                = {},
+      .location            = location,
+      .serial              = 0,
+  });
 
   return vma_img;
 }
@@ -97,7 +214,22 @@ Result<VmaImage, Error> VmaAllocationManager::create_image(const vk::ImageCreate
 void VmaAllocationManager::destroy() {
   assert(allocator_ != nullptr && "Allocator must not be NULL");
 
-  for (const auto& o : vma_objects_) {
+  if (defrag_pass_recorded_) {
+    if (auto result = end_defragmentation_pass(); !result) {
+      util::Logger::err("Could not end the defragmentation pass: {}", result.error().msg);
+    }
+  }
+  if (defrag_context_ != nullptr) {
+    end_defragmentation();
+  }
+
+  if (!objects_.empty()) {
+    util::Logger::warn("{} objects were not released before the allocation manager was destroyed", objects_.size());
+    log_allocations("Leaked allocations", live_allocations());
+  }
+
+  // Memory must be freed after all of the aliasing resources bound to it are destroyed
+  for (const auto& o : objects_) {
     std::visit(util::match{
                    [this](VmaBuffer buffer) {
                      vmaDestroyBuffer(allocator_, static_cast<VkBuffer>(buffer.vk_buffer), buffer.allocation);
@@ -105,10 +237,21 @@ void VmaAllocationManager::destroy() {
                    [this](VmaImage image) {
                      vmaDestroyImage(allocator_, static_cast<VkImage>(image.vk_image), image.allocation);
                    },
+                   [](VmaAllocation) {},
                },
-               o);
+               o.object);
   }
-  vma_objects_.clear();
+  for (const auto& o : objects_) {
+    if (const auto* allocation = std::get_if<VmaAllocation>(&o.object)) {
+      vmaFreeMemory(allocator_, *allocation);
+    }
+  }
+  objects_.clear();
+  slots_.clear();
+  free_slots_.clear();
+  aliasing_image_slots_.clear();
+  category_stats_ = {};
+
   vmaDestroyAllocator(allocator_);
   allocator_ = nullptr;
 }
@@ -120,25 +263,541 @@ VmaAllocationManager::~VmaAllocationManager() {
 }
 
 void VmaAllocationManager::delete_buffer(VmaBuffer buffer) {
-  vma_objects_.erase(buffer);
+  if (auto slot = slot_of(buffer.allocation)) {
+    erase_object(*slot);
+  }
+
+  if (defrag_pass_recorded_) {
+    auto it = std::ranges::find(pending_moves_, buffer.allocation, &PendingMove::allocation);
+    if (it != pending_moves_.end()) {
+      // The buffers might still be used by the recorded copy, VMA frees both of the allocations when the pass ends
+      it->destroyed                                 = true;
+      defrag_pass_.pMoves[it->move_index].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+      return;
+    }
+  }
+
   vmaDestroyBuffer(allocator_, static_cast<VkBuffer>(buffer.vk_buffer), buffer.allocation);
 }
 
 void VmaAllocationManager::delete_image(VmaImage image) {
-  vma_objects_.erase(image);
+  if (image.allocation == nullptr) {
+    if (auto it = aliasing_image_slots_.find(static_cast<VkImage>(image.vk_image)); it != aliasing_image_slots_.end()) {
+      erase_object(it->second);
+    }
+  } else if (auto slot = slot_of(image.allocation)) {
+    erase_object(*slot);
+  }
   vmaDestroyImage(allocator_, static_cast<VkImage>(image.vk_image), image.allocation);
 }
 
+Result<VmaImage, Error> VmaAllocationManager::create_aliasing_image(VmaAllocation allocation,
+                                                                    const vk::ImageCreateInfo& image_create_info,
+                                                                    vk::DeviceSize offset,
+                                                                    const std::source_location& location) {
+  VkImage vkimg{};
+  auto result = vmaCreateAliasingImage2(allocator_, allocation, offset,
+                                        reinterpret_cast<const VkImageCreateInfo*>(&image_create_info), &vkimg);
+  if (result != VK_SUCCESS) {
+    return std::unexpected(Error{
+        .msg     = "Failed to create an aliasing image",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = vk::Result(result),
+    });
+  }
+  auto vma_img = VmaImage{
+      .vk_image   = vk::Image(vkimg),
+      .allocation = nullptr,
+  };
+
+  // The memory of the aliasing images is accounted for by the allocation they are bound to
+  auto slot = insert_object(ManagedObject{
+      .object              = vma_img,
+      .category            = image_memory_category(image_create_info.usage),
+      .size_bytes          = 0,
+      .movable_create_info = std::nullopt,
+      .vk_handle_owner     = nullptr,
+      .slot                = 0,
+      .name                = {},
+      .location            = location,
+      .serial              = 0,
+  });
+  aliasing_image_slots_.emplace(vkimg, slot);
+
+  return vma_img;
+}
+
+Result<VmaImage, Error> VmaAllocationManager::create_sparse_image(const vk::ImageCreateInfo& image_create_info,
+                                                                  const std::source_location& location) {
+  assert(image_create_info.flags & vk::ImageCreateFlagBits::eSparseBinding && "Image must be a sparse image");
+
+  auto image = device_.createImage(image_create_info);
+  if (image.result != vk::Result::eSuccess) {
+    return std::unexpected(Error{
+        .msg     = "Failed to create a sparse image",
+        .code    = ErrorCode::VulkanObjectCreationFailure{},
+        .vk_code = image.result,
+    });
+  }
+  auto vma_img = VmaImage{
+      .vk_image   = image.value,
+      .allocation = nullptr,
+  };
+
+  // The pages bound to the sparse images are accounted for by their allocations, like the aliasing images
+  auto slot = insert_object(ManagedObject{
+      .object              = vma_img,
+      .category            = image_memory_category(image_create_info.usage),
+      .size_bytes          = 0,
+      .movable_create_info = std::nullopt,
+      .vk_handle_owner     = nullptr,
+      .slot                = 0,
+      .name                = {},
+      .location            = location,
+      .serial              = 0,
+  });
+  aliasing_image_slots_.emplace(static_cast<VkImage>(image.value), slot);
+
+  return vma_img;
+}
+
+Result<VmaAllocation, Error> VmaAllocationManager::allocate_memory(const vk::MemoryRequirements& mem_requirements,
+                                                                   const VmaAllocationCreateInfo& alloc_create_info,
+                                                                   MemoryCategory category,
+                                                                   const std::source_location& location) {
+  VmaAllocation alloc{};
+  auto result = vmaAllocateMemory(allocator_, reinterpret_cast<const VkMemoryRequirements*>(&mem_requirements),
+                                  &alloc_create_info, &alloc, nullptr);
+  if (result != VK_SUCCESS) {
+    return std::unexpected(Error{
+        .msg     = "Failed to allocate memory",
+        .code    = ErrorCode::MemoryAllocationFailure{},
+        .vk_code = vk::Result(result),
+    });
+  }
+  auto info = VmaAllocationInfo{};
+  vmaGetAllocationInfo(allocator_, alloc, &info);
+  insert_object(ManagedObject{
+      .object              = alloc,
+      .category            = category,
+      .size_bytes          = info.size,
+      .movable_create_info = std::nullopt,
+      .vk_handle_owner     = nullptr,
+      .slot                = 0,
+      .name                = {},
+      .location            = location,
+      .serial              = 0,
+  });
+
+  return alloc;
+}
+
+void VmaAllocationManager::free_memory(VmaAllocation allocation) {
+  if (auto slot = slot_of(allocation)) {
+    erase_object(*slot);
+  }
+  vmaFreeMemory(allocator_, allocation);
+}
+
 Result<VmaBuffer, Error> VmaAllocationManager::create_buffer(const vk::BufferCreateInfo& buffer_create_info,
-                                                             const VmaAllocationCreateInfo& alloc_create_info) {
+                                                             const VmaAllocationCreateInfo& alloc_create_info,
+                                                             const std::source_location& location) {
   VmaAllocationInfo info;
-  return create_buffer(buffer_create_info, alloc_create_info, info);
+  return create_buffer(buffer_create_info, alloc_create_info, info, location);
 }
 
 Result<VmaImage, Error> VmaAllocationManager::create_image(const vk::ImageCreateInfo& image_create_info,
-                                                           const VmaAllocationCreateInfo& alloc_create_info) {
+                                                           const VmaAllocationCreateInfo& alloc_create_info,
+                                                           const std::source_location& location) {
   VmaAllocationInfo info;
-  return create_image(image_create_info, alloc_create_info, info);
+  return create_image(image_create_info, alloc_create_info, info, location);
+}
+
+uint32_t VmaAllocationManager::insert_object(ManagedObject&& object) {
+  auto slot = uint32_t{0};
+  if (free_slots_.empty()) {
+    slot = static_cast<uint32_t>(slots_.size());
+    slots_.push_back(Slot{.dense_index = 0, .version = 0});
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  slots_[slot].dense_index = static_cast<uint32_t>(objects_.size());
+  object.slot              = slot;
+  object.serial            = next_serial_++;
+
+  if (auto* allocation = allocation_of(object)) {
+    vmaSetAllocationUserData(allocator_, allocation, pack_slot(slot, slots_[slot].version));
+    vmaSetAllocationName(allocator_, allocation, kMemoryCategoryName[object.category].c_str());
+
+    auto& stats = category_stats_[static_cast<size_t>(object.category)];
+    stats.allocation_bytes += object.size_bytes;
+    ++stats.allocation_count;
+  }
+
+  objects_.push_back(std::move(object));
+  return slot;
+}
+
+void VmaAllocationManager::erase_object(uint32_t slot) {
+  const auto dense_index = slots_[slot].dense_index;
+  auto& object           = objects_[dense_index];
+
+  if (auto* image = std::get_if<VmaImage>(&object.object); image != nullptr && image->allocation == nullptr) {
+    aliasing_image_slots_.erase(static_cast<VkImage>(image->vk_image));
+  } else {
+    auto& stats = category_stats_[static_cast<size_t>(object.category)];
+    stats.allocation_bytes -= object.size_bytes;
+    --stats.allocation_count;
+  }
+
+  // Swap with the last object to keep the storage contiguous
+  if (dense_index + 1 != objects_.size()) {
+    object                          = std::move(objects_.back());
+    slots_[object.slot].dense_index = dense_index;
+  }
+  objects_.pop_back();
+
+  ++slots_[slot].version;
+  free_slots_.push_back(slot);
+}
+
+std::optional<uint32_t> VmaAllocationManager::slot_of(VmaAllocation allocation) const {
+  if (allocation == nullptr) {
+    return std::nullopt;
+  }
+
+  auto info = VmaAllocationInfo{};
+  vmaGetAllocationInfo(allocator_, allocation, &info);
+  if (info.pUserData == nullptr) {
+    return std::nullopt;
+  }
+
+  const auto slot = unpack_slot(info.pUserData);
+  assert(slot < slots_.size() && slots_[slot].version == unpack_version(info.pUserData) &&
+         "Allocation user data refers to a stale slot");
+
+  return slot;
+}
+
+observer_ptr<VmaAllocationManager::ManagedObject> VmaAllocationManager::find_object(VmaAllocation allocation) {
+  if (auto slot = slot_of(allocation)) {
+    return &objects_[slots_[*slot].dense_index];
+  }
+
+  return nullptr;
+}
+
+void VmaAllocationManager::set_memory_category(VmaAllocation allocation, MemoryCategory category) {
+  auto* object = find_object(allocation);
+  assert(object != nullptr && "Allocation is not managed by the allocation manager");
+
+  auto& old_stats = category_stats_[static_cast<size_t>(object->category)];
+  old_stats.allocation_bytes -= object->size_bytes;
+  --old_stats.allocation_count;
+
+  auto& new_stats = category_stats_[static_cast<size_t>(category)];
+  new_stats.allocation_bytes += object->size_bytes;
+  ++new_stats.allocation_count;
+
+  object->category = category;
+  if (object->name.empty()) {
+    vmaSetAllocationName(allocator_, allocation, kMemoryCategoryName[category].c_str());
+  }
+}
+
+void VmaAllocationManager::set_allocation_name(VmaAllocation allocation, std::string_view name) {
+  auto* object = find_object(allocation);
+  if (object == nullptr) {
+    return;
+  }
+
+  object->name = name;
+  vmaSetAllocationName(allocator_, allocation,
+                       object->name.empty() ? kMemoryCategoryName[object->category].c_str() : object->name.c_str());
+}
+
+std::vector<AllocationRecord> VmaAllocationManager::live_allocations() const { return allocations_from(0); }
+
+std::vector<AllocationRecord> VmaAllocationManager::allocations_since(AllocationCheckpoint checkpoint) const {
+  return allocations_from(checkpoint.serial);
+}
+
+void VmaAllocationManager::dump_live_allocations() const { log_allocations("Live allocations", live_allocations()); }
+
+size_t VmaAllocationManager::dump_allocations_since(AllocationCheckpoint checkpoint) const {
+  const auto records = allocations_since(checkpoint);
+  log_allocations(std::format("Allocations alive since checkpoint #{}", checkpoint.serial), records);
+  return records.size();
+}
+
+VmaAllocation VmaAllocationManager::allocation_of(const ManagedObject& object) {
+  return std::visit(util::match{
+                        [](VmaBuffer buffer) { return buffer.allocation; },
+                        [](VmaImage image) { return image.allocation; },
+                        [](VmaAllocation allocation) { return allocation; },
+                    },
+                    object.object);
+}
+
+std::vector<AllocationRecord> VmaAllocationManager::allocations_from(uint64_t first_serial) const {
+  auto records = std::vector<AllocationRecord>();
+  for (const auto& object : objects_) {
+    if (object.serial < first_serial) {
+      continue;
+    }
+    records.push_back(AllocationRecord{
+        .category   = object.category,
+        .size_bytes = object.size_bytes,
+        .name       = object.name,
+        .location   = object.location,
+        .serial     = object.serial,
+    });
+  }
+  std::ranges::sort(records, [](const AllocationRecord& lhs, const AllocationRecord& rhs) {
+    return lhs.size_bytes != rhs.size_bytes ? lhs.size_bytes > rhs.size_bytes : lhs.serial < rhs.serial;
+  });
+
+  return records;
+}
+
+void VmaAllocationManager::log_allocations(std::string_view title, const std::vector<AllocationRecord>& records) {
+  auto total_bytes = vk::DeviceSize{0};
+  for (const auto& record : records) {
+    total_bytes += record.size_bytes;
+  }
+  util::Logger::info("{}: {} allocations, {:.2f} MiB", title, records.size(),
+                     static_cast<double>(total_bytes) / (1024.0 * 1024.0));
+
+  // The records are sorted by size, so every category lists its largest allocations first
+  for (auto c = 0U; c < static_cast<uint32_t>(MemoryCategory::_Count); ++c) {
+    const auto category = static_cast<MemoryCategory>(c);
+    auto count          = 0U;
+    auto bytes          = vk::DeviceSize{0};
+    for (const auto& record : records) {
+      if (record.category == category) {
+        ++count;
+        bytes += record.size_bytes;
+      }
+    }
+    if (count == 0) {
+      continue;
+    }
+
+    util::Logger::info("  {}: {} allocations, {:.2f} MiB", kMemoryCategoryName[category], count,
+                       static_cast<double>(bytes) / (1024.0 * 1024.0));
+    for (const auto& record : records) {
+      if (record.category == category) {
+        util::Logger::info("    #{} {} bytes \"{}\" at {}:{} ({})", record.serial, record.size_bytes,
+                           record.name.empty() ? "unnamed" : record.name, record.location.file_name(),
+                           record.location.line(), record.location.function_name());
+      }
+    }
+  }
+}
+
+std::vector<MemoryHeapBudget> VmaAllocationManager::heap_budgets() const {
+  const VkPhysicalDeviceMemoryProperties* mem_props = nullptr;
+  vmaGetMemoryProperties(allocator_, &mem_props);
+
+  auto budgets = std::array<VmaBudget, VK_MAX_MEMORY_HEAPS>{};
+  vmaGetHeapBudgets(allocator_, budgets.data());
+
+  auto result = std::vector<MemoryHeapBudget>();
+  result.reserve(mem_props->memoryHeapCount);
+  for (auto i = 0U; i < mem_props->memoryHeapCount; ++i) {
+    result.push_back(MemoryHeapBudget{
+        .usage            = budgets[i].usage,
+        .budget           = budgets[i].budget,
+        .block_bytes      = budgets[i].statistics.blockBytes,
+        .allocation_bytes = budgets[i].statistics.allocationBytes,
+        .heap_size        = mem_props->memoryHeaps[i].size,
+        .device_local     = (mem_props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+    });
+  }
+
+  return result;
+}
+
+bool VmaAllocationManager::is_near_budget(float fraction) const {
+  return std::ranges::any_of(heap_budgets(), [fraction](const MemoryHeapBudget& heap) {
+    return heap.device_local && static_cast<double>(heap.usage) > fraction * static_cast<double>(heap.budget);
+  });
+}
+
+void VmaAllocationManager::track_buffer_handle(VmaAllocation allocation, vk::Buffer* vk_handle) noexcept {
+  if (auto* object = find_object(allocation)) {
+    object->vk_handle_owner = vk_handle;
+  }
+}
+
+Result<void, Error> VmaAllocationManager::begin_defragmentation(const DefragmentationInfo& info) {
+  assert(defrag_context_ == nullptr && "Defragmentation has already been started");
+
+  auto defrag_info                  = VmaDefragmentationInfo{};
+  defrag_info.flags                 = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+  defrag_info.maxBytesPerPass       = info.max_bytes_per_pass;
+  defrag_info.maxAllocationsPerPass = info.max_allocations_per_pass;
+
+  auto result = vmaBeginDefragmentation(allocator_, &defrag_info, &defrag_context_);
+  if (result != VK_SUCCESS) {
+    defrag_context_ = nullptr;
+    return std::unexpected(Error{
+        .msg     = "Failed to begin the defragmentation",
+        .code    = ErrorCode::MemoryAllocationFailure{},
+        .vk_code = vk::Result(result),
+    });
+  }
+  defrag_cpu_time_budget_ = info.cpu_time_budget;
+
+  return {};
+}
+
+Result<std::vector<BufferRelocation>, Error> VmaAllocationManager::record_defragmentation_pass(
+    vk::CommandBuffer cmd_buff) {
+  assert(defrag_context_ != nullptr && "Defragmentation has not been started");
+  assert(!defrag_pass_recorded_ && "Previous defragmentation pass has not been ended");
+
+  auto result = vmaBeginDefragmentationPass(allocator_, defrag_context_, &defrag_pass_);
+  if (result == VK_SUCCESS) {
+    end_defragmentation();
+    return std::vector<BufferRelocation>{};
+  }
+  if (result != VK_INCOMPLETE) {
+    return std::unexpected(Error{
+        .msg     = "Failed to begin a defragmentation pass",
+        .code    = ErrorCode::MemoryAllocationFailure{},
+        .vk_code = vk::Result(result),
+    });
+  }
+  defrag_pass_recorded_ = true;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (auto i = 0U; i < defrag_pass_.moveCount; ++i) {
+    auto& move = defrag_pass_.pMoves[i];
+
+    // Every move is ignored unless the buffer is successfully recreated in the new place
+    move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+
+    auto* object = find_object(move.srcAllocation);
+    if (object == nullptr || !object->movable_create_info || object->vk_handle_owner == nullptr) {
+      continue;
+    }
+    if (std::chrono::steady_clock::now() - start > defrag_cpu_time_budget_) {
+      continue;
+    }
+
+    // Mapped pointers cached by the resources would become dangling
+    VkMemoryPropertyFlags mem_props{};
+    vmaGetAllocationMemoryProperties(allocator_, move.srcAllocation, &mem_props);
+    if ((mem_props & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0) {
+      continue;
+    }
+
+    auto new_buffer = device_.createBuffer(*object->movable_create_info);
+    if (new_buffer.result != vk::Result::eSuccess) {
+      continue;
+    }
+    if (vmaBindBufferMemory(allocator_, move.dstTmpAllocation, static_cast<VkBuffer>(new_buffer.value)) !=
+        VK_SUCCESS) {
+      device_.destroyBuffer(new_buffer.value);
+      continue;
+    }
+
+    move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_COPY;
+    pending_moves_.push_back(PendingMove{
+        .move_index = i,
+        .allocation = move.srcAllocation,
+        .old_buffer = *object->vk_handle_owner,
+        .new_buffer = new_buffer.value,
+        .destroyed  = false,
+    });
+  }
+
+  auto relocations = std::vector<BufferRelocation>();
+  if (pending_moves_.empty()) {
+    return relocations;
+  }
+
+  // The moved buffers might have been written by any of the previously submitted commands
+  auto before_copy = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eAllCommands,
+      .srcAccessMask = vk::AccessFlagBits2::eMemoryWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eCopy,
+      .dstAccessMask = vk::AccessFlagBits2::eTransferRead,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &before_copy});
+
+  relocations.reserve(pending_moves_.size());
+  for (const auto& pending : pending_moves_) {
+    auto* object = find_object(pending.allocation);
+    cmd_buff.copyBuffer(pending.old_buffer, pending.new_buffer,
+                        vk::BufferCopy{
+                            .srcOffset = 0,
+                            .dstOffset = 0,
+                            .size      = object->movable_create_info->size,
+                        });
+
+    *object->vk_handle_owner = pending.new_buffer;
+    object->object           = VmaBuffer{.vk_buffer = pending.new_buffer, .allocation = pending.allocation};
+
+    relocations.push_back(BufferRelocation{
+        .allocation = pending.allocation,
+        .old_buffer = pending.old_buffer,
+        .new_buffer = pending.new_buffer,
+    });
+  }
+
+  auto after_copy = vk::MemoryBarrier2{
+      .srcStageMask  = vk::PipelineStageFlagBits2::eCopy,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask  = vk::PipelineStageFlagBits2::eAllCommands,
+      .dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite,
+  };
+  cmd_buff.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &after_copy});
+
+  return relocations;
+}
+
+Result<void, Error> VmaAllocationManager::end_defragmentation_pass() {
+  assert(defrag_pass_recorded_ && "There is no defragmentation pass to end");
+
+  for (const auto& pending : pending_moves_) {
+    device_.destroyBuffer(pending.old_buffer);
+    if (pending.destroyed) {
+      device_.destroyBuffer(pending.new_buffer);
+    }
+  }
+  pending_moves_.clear();
+  defrag_pass_recorded_ = false;
+
+  // VMA swaps the moved allocations into their new places
+  auto result = vmaEndDefragmentationPass(allocator_, defrag_context_, &defrag_pass_);
+  if (result == VK_SUCCESS) {
+    end_defragmentation();
+  } else if (result != VK_INCOMPLETE) {
+    return std::unexpected(Error{
+        .msg     = "Failed to end a defragmentation pass",
+        .code    = ErrorCode::MemoryAllocationFailure{},
+        .vk_code = vk::Result(result),
+    });
+  }
+
+  return {};
+}
+
+VmaDefragmentationStats VmaAllocationManager::end_defragmentation() {
+  assert(defrag_context_ != nullptr && "Defragmentation has not been started");
+  assert(!defrag_pass_recorded_ && "Defragmentation pass must be ended first");
+
+  auto stats = VmaDefragmentationStats{};
+  vmaEndDefragmentation(allocator_, defrag_context_, &stats);
+  defrag_context_ = nullptr;
+
+  util::Logger::info("Defragmentation moved {} allocations ({} bytes) and freed {} bytes",
+                     stats.allocationsMoved, stats.bytesMoved, stats.bytesFreed);
+
+  return stats;
 }
 
 }  // namespace eray::vkren
@@ -3,16 +3,140 @@
 #include <vma/vk_mem_alloc.h>
 #include <vulkan/vulkan_core.h>
 
+#include <array>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <liberay/util/enum_mapper.hpp>
 #include <liberay/vkren/common.hpp>
 #include <liberay/vkren/vma_object.hpp>
-#include <unordered_set>
+#include <optional>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_handles.hpp>
 
 namespace eray::vkren {
 
+/**
+ * @brief Category the allocation is attributed to in the memory statistics. By default it is deduced from the usage of
+ * the resource, see `buffer_memory_category()` and `image_memory_category()`.
+ *
+ */
+enum class MemoryCategory : uint8_t {
+  Attachment = 0,
+  Texture    = 1,
+  Geometry   = 2,
+  Staging    = 3,
+  Uniform    = 4,
+  Other      = 5,
+  _Count     = 6,  // NOLINT
+};
+
+constexpr auto kMemoryCategoryName = util::StringEnumMapper<MemoryCategory>({
+    {MemoryCategory::Attachment, "Attachment"},
+    {MemoryCategory::Texture, "Texture"},
+    {MemoryCategory::Geometry, "Geometry"},
+    {MemoryCategory::Staging, "Staging"},
+    {MemoryCategory::Uniform, "Uniform"},
+    {MemoryCategory::Other, "Other"},
+});
+
+MemoryCategory buffer_memory_category(vk::BufferUsageFlags usage);
+MemoryCategory image_memory_category(vk::ImageUsageFlags usage);
+
+struct MemoryCategoryStatistics {
+  vk::DeviceSize allocation_bytes = 0;
+  uint32_t allocation_count       = 0;
+};
+
+struct MemoryHeapBudget {
+  /**
+   * @brief Memory used by the whole process (including other allocators) and the memory available to it. Without
+   * VK_EXT_memory_budget the usage is the size of the VMA blocks and the budget is estimated as 80% of the heap size.
+   *
+   */
+  vk::DeviceSize usage;
+  vk::DeviceSize budget;
+
+  /**
+   * @brief Memory allocated by VMA in blocks and the part of it occupied by the allocations.
+   *
+   */
+  vk::DeviceSize block_bytes;
+  vk::DeviceSize allocation_bytes;
+
+  vk::DeviceSize heap_size;
+  bool device_local;
+};
+
+struct DefragmentationInfo {
+  /**
+   * @brief Limits of a single pass, the pass is recorded into a single frame.
+   *
+   */
+  vk::DeviceSize max_bytes_per_pass = 16 * 1024 * 1024;
+  uint32_t max_allocations_per_pass = 64;
+
+  /**
+   * @brief CPU time spent on recreating the moved buffers in a single pass. The moves that exceed the budget are
+   * postponed to the next pass.
+   *
+   */
+  std::chrono::microseconds cpu_time_budget{500};
+};
+
+/**
+ * @brief Reported for every buffer moved by the defragmentation. The descriptors referring to the `old_buffer` must be
+ * rewritten before they are used again.
+ *
+ */
+struct BufferRelocation {
+  VmaAllocation allocation;
+  vk::Buffer old_buffer;
+  vk::Buffer new_buffer;
+};
+
+/**
+ * @brief Entry of the allocation journal, see `VmaAllocationManager::live_allocations()`.
+ *
+ */
+struct AllocationRecord {
+  MemoryCategory category;
+  vk::DeviceSize size_bytes;
+
+  /**
+   * @brief Set with `VmaAllocationManager::set_allocation_name()`, e.g. by the `set_debug_name()` of the resources.
+   *
+   */
+  std::string name;
+
+  /**
+   * @brief Call site of the resource factory that created the allocation.
+   *
+   */
+  std::source_location location;
+
+  /**
+   * @brief Allocations are numbered in the creation order, the serial is never reused.
+   *
+   */
+  uint64_t serial;
+};
+
+/**
+ * @brief Position in the allocation journal, the allocations created after it are reported by
+ * `VmaAllocationManager::allocations_since()`.
+ *
+ */
+struct AllocationCheckpoint {
+  uint64_t serial = 0;
+};
+
 /**
  * @brief This class manages the VmaImage and VmaBuffer objects. After this class is destructed, all objects that
  * where created with `create_buffer` or `create_image` will be automatically deallocated. To schedule the earlier
@@ -29,38 +153,304 @@ class VmaAllocationManager {
   VmaAllocationManager(const VmaAllocationManager&)            = delete;
   VmaAllocationManager& operator=(const VmaAllocationManager&) = delete;
 
+  /**
+   * @brief Creates the VMA allocator.
+   *
+   * @param physical_device
+   * @param device
+   * @param instance
+   * @param memory_budget Must be true only if VK_EXT_memory_budget is enabled on the `device`.
+   * @return Result<VmaAllocationManager, Error>
+   */
   static Result<VmaAllocationManager, Error> create(vk::PhysicalDevice physical_device, vk::Device device,
-                                                    vk::Instance instance);
+                                                    vk::Instance instance, bool memory_budget = false);
 
   ~VmaAllocationManager();
 
-  [[nodiscard]] Result<VmaBuffer, Error> create_buffer(const vk::BufferCreateInfo& buffer_create_info,
-                                                       const VmaAllocationCreateInfo& alloc_create_info,
-                                                       VmaAllocationInfo& out_alloc_info);
+  /**
+   * @brief The `location` is recorded in the allocation journal, the resource factories forward the location of their
+   * callers.
+   *
+   */
+  [[nodiscard]] Result<VmaBuffer, Error> create_buffer(
+      const vk::BufferCreateInfo& buffer_create_info, const VmaAllocationCreateInfo& alloc_create_info,
+      VmaAllocationInfo& out_alloc_info, const std::source_location& location = std::source_location::current());
 
-  [[nodiscard]] Result<VmaImage, Error> create_image(const vk::ImageCreateInfo& image_create_info,
-                                                     const VmaAllocationCreateInfo& alloc_create_info,
-                                                     VmaAllocationInfo& out_alloc_info);
+  [[nodiscard]] Result<VmaImage, Error> create_image(
+      const vk::ImageCreateInfo& image_create_info, const VmaAllocationCreateInfo& alloc_create_info,
+      VmaAllocationInfo& out_alloc_info, const std::source_location& location = std::source_location::current());
 
-  [[nodiscard]] Result<VmaBuffer, Error> create_buffer(const vk::BufferCreateInfo& buffer_create_info,
-                                                       const VmaAllocationCreateInfo& alloc_create_info);
+  [[nodiscard]] Result<VmaBuffer, Error> create_buffer(
+      const vk::BufferCreateInfo& buffer_create_info, const VmaAllocationCreateInfo& alloc_create_info,
+      const std::source_location& location = std::source_location::current());
 
-  [[nodiscard]] Result<VmaImage, Error> create_image(const vk::ImageCreateInfo& image_create_info,
-                                                     const VmaAllocationCreateInfo& alloc_create_info);
+  [[nodiscard]] Result<VmaImage, Error> create_image(
+      const vk::ImageCreateInfo& image_create_info, const VmaAllocationCreateInfo& alloc_create_info,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Creates an image bound to the already existing `allocation` at `offset`. The returned image does not own the
+   * memory, its allocation is null. Allows for memory aliasing of resources that are never alive at the same time.
+   *
+   * @param allocation
+   * @param image_create_info
+   * @param offset
+   * @param location
+   * @return Result<VmaImage, Error>
+   */
+  [[nodiscard]] Result<VmaImage, Error> create_aliasing_image(
+      VmaAllocation allocation, const vk::ImageCreateInfo& image_create_info, vk::DeviceSize offset = 0,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Creates a sparse image (`vk::ImageCreateFlagBits::eSparseBinding`), with no memory bound. The memory is
+   * bound with `vk::Queue::bindSparse` to the allocations of `allocate_memory`, the image does not own it and its
+   * allocation is null.
+   *
+   * @param image_create_info
+   * @param location
+   * @return Result<VmaImage, Error>
+   */
+  [[nodiscard]] Result<VmaImage, Error> create_sparse_image(
+      const vk::ImageCreateInfo& image_create_info,
+      const std::source_location& location = std::source_location::current());
+
+  /**
+   * @brief Allocates raw memory that is not bound to any resource. Must be freed with `free_memory`, otherwise it's
+   * freed along with the allocation manager.
+   *
+   * @param mem_requirements
+   * @param alloc_create_info
+   * @param category
+   * @param location
+   * @return Result<VmaAllocation, Error>
+   */
+  [[nodiscard]] Result<VmaAllocation, Error> allocate_memory(
+      const vk::MemoryRequirements& mem_requirements, const VmaAllocationCreateInfo& alloc_create_info,
+      MemoryCategory category              = MemoryCategory::Other,
+      const std::source_location& location = std::source_location::current());
 
   void delete_buffer(VmaBuffer buffer);
   void delete_image(VmaImage image);
+  void free_memory(VmaAllocation allocation);
 
+  /**
+   * @brief Frees all of the objects that are still alive. They are reported as leaks, with their call sites.
+   *
+   */
   void destroy();
 
+  /**
+   * @brief Overrides the category the allocation is attributed to.
+   *
+   * @param allocation
+   * @param category
+   */
+  void set_memory_category(VmaAllocation allocation, MemoryCategory category);
+
+  const MemoryCategoryStatistics& category_statistics(MemoryCategory category) const {
+    return category_stats_[static_cast<size_t>(category)];
+  }
+
+  /**
+   * @brief Names the allocation in the journal and in VMA, the allocations without a name are named after their
+   * category.
+   *
+   * @param allocation
+   * @param name
+   */
+  void set_allocation_name(VmaAllocation allocation, std::string_view name);
+
+  /**
+   * @brief Journal of the allocations that are currently alive, the largest first. Includes the aliasing images, whose
+   * size is zero as their memory is accounted for by the allocation they are bound to.
+   *
+   * @return std::vector<AllocationRecord>
+   */
+  std::vector<AllocationRecord> live_allocations() const;
+
+  /**
+   * @brief Marks the current position in the journal, e.g. before a level is loaded, to find what has not been released
+   * after it is unloaded.
+   *
+   * @return AllocationCheckpoint
+   */
+  AllocationCheckpoint checkpoint() const { return AllocationCheckpoint{.serial = next_serial_}; }
+
+  /**
+   * @brief Allocations created after the `checkpoint` that are still alive, the largest first.
+   *
+   * @param checkpoint
+   * @return std::vector<AllocationRecord>
+   */
+  std::vector<AllocationRecord> allocations_since(AllocationCheckpoint checkpoint) const;
+
+  /**
+   * @brief Logs the `live_allocations()` grouped by category, with the totals of every category.
+   *
+   */
+  void dump_live_allocations() const;
+
+  /**
+   * @brief Logs the `allocations_since()` the `checkpoint` grouped by category. Returns the number of the allocations.
+   *
+   * @param checkpoint
+   * @return size_t
+   */
+  size_t dump_allocations_since(AllocationCheckpoint checkpoint) const;
+
+  /**
+   * @brief Queries the current budgets of all of the memory heaps. Cheap enough to be called every frame.
+   *
+   * @return std::vector<MemoryHeapBudget>
+   */
+  std::vector<MemoryHeapBudget> heap_budgets() const;
+
+  /**
+   * @brief True if the usage of any device-local heap exceeds the `fraction` of its budget. This is the moment to
+   * release memory (e.g. drop texture mips) before the driver starts paging.
+   *
+   * @param fraction
+   * @return bool
+   */
+  bool is_near_budget(float fraction = 0.9F) const;
+
+  /**
+   * @brief Starts an incremental defragmentation of the device memory. The work is split into passes recorded with
+   * `record_defragmentation_pass()`, one per frame.
+   *
+   * Only the device-local, not mapped buffers owned by a `VmaRaiiBuffer` are moved, their handles are patched
+   * automatically. Images are never moved, as their layouts are not tracked by the manager.
+   *
+   * @param info
+   * @return Result<void, Error>
+   */
+  Result<void, Error> begin_defragmentation(const DefragmentationInfo& info = {});
+
+  /**
+   * @brief Records the copies of the next pass into `cmd_buff` and patches the handles of the moved buffers. The
+   * copies are preceded by a barrier on all of the previously submitted commands of the queue and followed by a barrier
+   * that makes them visible to all of the later commands. Must be recorded outside of rendering.
+   *
+   * The pass must be finished with `end_defragmentation_pass()` once `cmd_buff` has completed execution. Finishes the
+   * defragmentation, when there is nothing left to move.
+   *
+   * @param cmd_buff
+   * @return Result<std::vector<BufferRelocation>, Error>
+   */
+  Result<std::vector<BufferRelocation>, Error> record_defragmentation_pass(vk::CommandBuffer cmd_buff);
+
+  /**
+   * @brief Destroys the buffers superseded by the recorded pass and releases their memory. Finishes the
+   * defragmentation, when there is nothing left to move.
+   *
+   * @return Result<void, Error>
+   */
+  Result<void, Error> end_defragmentation_pass();
+
+  /**
+   * @brief Finishes the defragmentation immediately. A recorded pass must be ended first.
+   *
+   * @return VmaDefragmentationStats Statistics of the whole defragmentation.
+   */
+  VmaDefragmentationStats end_defragmentation();
+
+  bool is_defragmenting() const { return defrag_context_ != nullptr; }
+  bool has_pending_defragmentation_pass() const { return defrag_pass_recorded_; }
+
+  /**
+   * @brief Registers the handle owned by a `VmaRaiiBuffer`, so that it is patched when the buffer is moved.
+   *
+   * @param allocation
+   * @param vk_handle
+   */
+  void track_buffer_handle(VmaAllocation allocation, vk::Buffer* vk_handle) noexcept;
+
   VmaAllocator allocator() const { return allocator_; }
 
  private:
-  explicit VmaAllocationManager(VmaAllocator allocator) : allocator_(allocator) {}
-  using VmaObjectVariant = std::variant<VmaImage, VmaBuffer>;
+  VmaAllocationManager(VmaAllocator allocator, vk::Device device) : allocator_(allocator), device_(device) {}
+
+  /**
+   * @brief Raw memory allocations are stored along with the resources, they are released after all of the resources as
+   * the aliasing resources might be bound to them.
+   *
+   */
+  using VmaObjectVariant = std::variant<VmaImage, VmaBuffer, VmaAllocation>;
+
+  struct ManagedObject {
+    VmaObjectVariant object;
+    MemoryCategory category;
+    vk::DeviceSize size_bytes;
+
+    /**
+     * @brief Create info of the buffers that might be recreated by the defragmentation.
+     *
+     */
+    std::optional<vk::BufferCreateInfo> movable_create_info;
+
+    /**
+     * @brief Handle owned by a `VmaRaiiBuffer`, patched when the defragmentation moves the buffer.
+     *
+     */
+    observer_ptr<vk::Buffer> vk_handle_owner;
+
+    uint32_t slot;
+
+    // == Journal ======================================================================================================
+    std::string name;
+    std::source_location location;
+    uint64_t serial;
+  };
+
+  /**
+   * @brief Stable index of an object, `dense_index` points to the `objects_`.
+   *
+   */
+  struct Slot {
+    uint32_t dense_index;
+    uint32_t version;
+  };
+
+  uint32_t insert_object(ManagedObject&& object);
+  void erase_object(uint32_t slot);
+
+  /**
+   * @brief The slot and its version are stored in the VMA user data of the allocation, so the objects are found without
+   * hashing. Aliasing images have no allocation and are looked up by their handles.
+   *
+   */
+  observer_ptr<ManagedObject> find_object(VmaAllocation allocation);
+  std::optional<uint32_t> slot_of(VmaAllocation allocation) const;
+
+  static VmaAllocation allocation_of(const ManagedObject& object);
+  std::vector<AllocationRecord> allocations_from(uint64_t first_serial) const;
+  static void log_allocations(std::string_view title, const std::vector<AllocationRecord>& records);
+
+  struct PendingMove {
+    uint32_t move_index;
+    VmaAllocation allocation;
+    vk::Buffer old_buffer;
+    vk::Buffer new_buffer;
+    bool destroyed;
+  };
 
   VmaAllocator allocator_ = nullptr;
-  std::unordered_set<VmaObjectVariant> vma_objects_;
+  vk::Device device_;
+
+  std::vector<ManagedObject> objects_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  std::unordered_map<VkImage, uint32_t> aliasing_image_slots_;
+
+  std::array<MemoryCategoryStatistics, static_cast<size_t>(MemoryCategory::_Count)> category_stats_{};
+  uint64_t next_serial_ = 0;
+
+  VmaDefragmentationContext defrag_context_ = nullptr;
+  VmaDefragmentationPassMoveInfo defrag_pass_{};
+  bool defrag_pass_recorded_ = false;
+  std::chrono::microseconds defrag_cpu_time_budget_{};
+  std::vector<PendingMove> pending_moves_;
 };
 
 }  // namespace eray::vkren
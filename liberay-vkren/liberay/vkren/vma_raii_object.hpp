@@ -6,6 +6,7 @@
 #include <cstddef>
 #include <liberay/vkren/common.hpp>
 #include <liberay/vkren/vma_allocation_manager.hpp>
+#include <type_traits>
 #include <vulkan/vulkan.hpp>
 
 namespace eray::vkren {
@@ -21,13 +22,16 @@ struct VmaRaiiObject {
   explicit VmaRaiiObject(std::nullptr_t) {}
 
   VmaRaiiObject(VmaAllocationManager& alloc_manager, VmaAllocation allocation, TVmaObjectHandle vk_handle)
-      : _alloc_manager(&alloc_manager), _allocation(allocation), _vk_handle(vk_handle) {}
+      : _alloc_manager(&alloc_manager), _allocation(allocation), _vk_handle(vk_handle) {
+    track_handle();
+  }
 
   VmaRaiiObject(VmaRaiiObject&& other) noexcept
       : _alloc_manager(other._alloc_manager), _allocation(other._allocation), _vk_handle(other._vk_handle) {
     other._allocation    = nullptr;
     other._alloc_manager = nullptr;
     other._vk_handle     = VK_NULL_HANDLE;
+    track_handle();
   }
 
   VmaRaiiObject& operator=(VmaRaiiObject&& other) noexcept {
@@ -35,7 +39,7 @@ struct VmaRaiiObject {
       return *this;
     }
 
-    if (_allocation != nullptr && _alloc_manager != nullptr && _vk_handle != VK_NULL_HANDLE) {
+    if (_alloc_manager != nullptr && _vk_handle != VK_NULL_HANDLE) {
       DeleteCallback(*_alloc_manager, _allocation, _vk_handle);
     }
 
@@ -46,6 +50,7 @@ struct VmaRaiiObject {
     other._allocation    = nullptr;
     other._alloc_manager = nullptr;
     other._vk_handle     = VK_NULL_HANDLE;
+    track_handle();
 
     return *this;
   }
@@ -62,11 +67,30 @@ struct VmaRaiiObject {
     return info;
   }
 
+  /**
+   * @brief Aliasing objects do not own their memory, in such case the allocation is null.
+   *
+   */
+  bool owns_allocation() const { return _allocation != nullptr; }
+
   ~VmaRaiiObject() {
-    if (_allocation != nullptr && _alloc_manager != nullptr && _vk_handle != VK_NULL_HANDLE) {
+    if (_alloc_manager != nullptr && _vk_handle != VK_NULL_HANDLE) {
       DeleteCallback(*_alloc_manager, _allocation, _vk_handle);
     }
   }
+
+ private:
+  /**
+   * @brief The allocation manager patches the handle of the buffer when the defragmentation moves its allocation.
+   *
+   */
+  void track_handle() noexcept {
+    if constexpr (std::is_same_v<TVmaObjectHandle, vk::Buffer>) {
+      if (_alloc_manager != nullptr && _allocation != nullptr) {
+        _alloc_manager->track_buffer_handle(_allocation, &_vk_handle);
+      }
+    }
+  }
 };
 
 /**
@@ -89,4 +113,58 @@ using VmaRaiiImage = VmaRaiiObject<vk::Image, [](VmaAllocationManager& alloc_man
   alloc_manager.delete_image(VmaImage{.vk_image = image, .allocation = allocation});
 }>;
 
+/**
+ * @brief Owns a raw VMA memory allocation that is not bound to a single resource, e.g. memory shared by aliasing images.
+ * This struct must not outlive the allocation manager and must outlive all of the resources bound to it.
+ *
+ */
+struct VmaRaiiAllocation {
+  observer_ptr<VmaAllocationManager> _alloc_manager{};
+  VmaAllocation _allocation{};
+
+  VmaRaiiAllocation() = delete;
+  explicit VmaRaiiAllocation(std::nullptr_t) {}
+  VmaRaiiAllocation(VmaAllocationManager& alloc_manager, VmaAllocation allocation)
+      : _alloc_manager(&alloc_manager), _allocation(allocation) {}
+
+  VmaRaiiAllocation(VmaRaiiAllocation&& other) noexcept
+      : _alloc_manager(other._alloc_manager), _allocation(other._allocation) {
+    other._alloc_manager = nullptr;
+    other._allocation    = nullptr;
+  }
+
+  VmaRaiiAllocation& operator=(VmaRaiiAllocation&& other) noexcept {
+    if (this == &other) {
+      return *this;
+    }
+
+    if (_alloc_manager != nullptr && _allocation != nullptr) {
+      _alloc_manager->free_memory(_allocation);
+    }
+
+    _alloc_manager = other._alloc_manager;
+    _allocation    = other._allocation;
+
+    other._alloc_manager = nullptr;
+    other._allocation    = nullptr;
+
+    return *this;
+  }
+
+  VmaRaiiAllocation(const VmaRaiiAllocation& other)            = delete;
+  VmaRaiiAllocation& operator=(const VmaRaiiAllocation& other) = delete;
+
+  VmaAllocationInfo alloc_info() const {
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(_alloc_manager->allocator(), _allocation, &info);
+    return info;
+  }
+
+  ~VmaRaiiAllocation() {
+    if (_alloc_manager != nullptr && _allocation != nullptr) {
+      _alloc_manager->free_memory(_allocation);
+    }
+  }
+};
+
 }  // namespace eray::vkren
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstring>
+#include <liberay/util/logger.hpp>
+#include <liberay/vkren/wait_statistics.hpp>
+
+namespace eray::vkren {
+
+void WaitStatistics::record(std::string_view label, WaitKind kind, const std::source_location& location,
+                            std::chrono::nanoseconds duration) {
+  const auto duration_ms = std::chrono::duration<float, std::milli>(duration).count();
+  auto stall             = false;
+  {
+    auto lock = std::lock_guard(mutex_);
+
+    // There are a few dozens of the call sites at most
+    auto it = std::ranges::find_if(sites_, [&location](const Site& site) {
+      return site.stats.location.line() == location.line() &&
+             std::strcmp(site.stats.location.file_name(), location.file_name()) == 0;
+    });
+    if (it == sites_.end()) {
+      sites_.push_back(Site{.stats = WaitSiteStatistics{.label = label, .location = location, .kind = kind}});
+      it = std::prev(sites_.end());
+    }
+
+    it->frame_duration += duration;
+    ++it->frame_count;
+    it->stats.total_ms += duration_ms;
+    it->stats.max_ms = std::max(it->stats.max_ms, duration_ms);
+    ++it->stats.count;
+
+    stall = kind == WaitKind::Stall && duration > stall_threshold_;
+  }
+
+  if (stall) {
+    util::Logger::warn(R"(CPU stalled for {:.2f} ms on "{}" at {}:{})", duration_ms, label, location.file_name(),
+                       location.line());
+  }
+}
+
+void WaitStatistics::end_frame() {
+  auto lock = std::lock_guard(mutex_);
+  for (auto& site : sites_) {
+    site.stats.last_frame_ms    = std::chrono::duration<float, std::milli>(site.frame_duration).count();
+    site.stats.last_frame_count = site.frame_count;
+    site.frame_duration         = std::chrono::nanoseconds{0};
+    site.frame_count            = 0;
+  }
+}
+
+std::vector<WaitSiteStatistics> WaitStatistics::sites() const {
+  auto lock   = std::lock_guard(mutex_);
+  auto result = std::vector<WaitSiteStatistics>();
+  result.reserve(sites_.size());
+  for (const auto& site : sites_) {
+    result.push_back(site.stats);
+  }
+
+  return result;
+}
+
+float WaitStatistics::last_frame_ms(WaitKind kind) const {
+  auto lock  = std::lock_guard(mutex_);
+  auto total = 0.0F;
+  for (const auto& site : sites_) {
+    if (site.stats.kind == kind) {
+      total += site.stats.last_frame_ms;
+    }
+  }
+
+  return total;
+}
+
+void WaitStatistics::set_stall_threshold(std::chrono::microseconds threshold) {
+  auto lock        = std::lock_guard(mutex_);
+  stall_threshold_ = threshold;
+}
+
+std::chrono::microseconds WaitStatistics::stall_threshold() const {
+  auto lock = std::lock_guard(mutex_);
+  return stall_threshold_;
+}
+
+}  // namespace eray::vkren
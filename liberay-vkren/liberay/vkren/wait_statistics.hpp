@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <liberay/util/cpu_profiler.hpp>
+#include <mutex>
+#include <source_location>
+#include <string_view>
+#include <vector>
+
+namespace eray::vkren {
+
+/**
+ * @brief Pacing waits are expected, e.g. the CPU waiting for a frame in flight when it runs ahead of the GPU. The
+ * stalls serialize the CPU with the GPU in the middle of a frame, e.g. the synchronous uploads and `waitIdle()`.
+ *
+ */
+enum class WaitKind : uint8_t {
+  Pacing = 0,
+  Stall  = 1,
+};
+
+/**
+ * @brief CPU time blocked at a single call site.
+ *
+ */
+struct WaitSiteStatistics {
+  std::string_view label;
+  std::source_location location;
+  WaitKind kind;
+
+  /**
+   * @brief Waits of the last finished frame.
+   *
+   */
+  float last_frame_ms       = 0.0F;
+  uint32_t last_frame_count = 0;
+
+  /**
+   * @brief Waits since the device creation.
+   *
+   */
+  double total_ms = 0.0;
+  float max_ms    = 0.0F;
+  uint64_t count  = 0;
+};
+
+/**
+ * @brief Blocking waits of the CPU on the GPU (fences, timeline semaphores, `waitIdle()` and the swap chain acquire) by
+ * their call sites, owned by the `Device`. The waits are recorded by the `WaitScope`s of the engine from any thread.
+ *
+ * A stall longer than the `stall_threshold()` is logged as a warning, most of the hitches turn out to be hidden
+ * synchronous uploads.
+ *
+ */
+class WaitStatistics {
+ public:
+  void record(std::string_view label, WaitKind kind, const std::source_location& location,
+              std::chrono::nanoseconds duration);
+
+  /**
+   * @brief Moves the waits of the frame to the `last_frame_ms` of the sites. Called by the application once the frame
+   * has been recorded.
+   *
+   */
+  void end_frame();
+
+  /**
+   * @brief Sites in the order of their first wait.
+   *
+   */
+  std::vector<WaitSiteStatistics> sites() const;
+
+  /**
+   * @brief Total CPU time of the waits of the kind in the last finished frame.
+   *
+   */
+  float last_frame_ms(WaitKind kind) const;
+
+  void set_stall_threshold(std::chrono::microseconds threshold);
+  std::chrono::microseconds stall_threshold() const;
+
+ private:
+  struct Site {
+    WaitSiteStatistics stats;
+    std::chrono::nanoseconds frame_duration{0};
+    uint32_t frame_count = 0;
+  };
+
+  mutable std::mutex mutex_;
+  std::vector<Site> sites_;
+  std::chrono::microseconds stall_threshold_{2000};
+};
+
+/**
+ * @brief Records the time between its construction and destruction as a wait at the call site, also as a scope of the
+ * `util::CpuProfiler`. The label must be a string literal.
+ *
+ */
+class WaitScope {
+ public:
+  WaitScope(WaitStatistics& statistics, const char* label, WaitKind kind,
+            const std::source_location& location = std::source_location::current())
+      : statistics_(statistics),
+        label_(label),
+        kind_(kind),
+        location_(location),
+        profile_scope_(label),
+        start_(std::chrono::steady_clock::now()) {}
+
+  ~WaitScope() { statistics_.record(label_, kind_, location_, std::chrono::steady_clock::now() - start_); }
+
+  WaitScope(const WaitScope&)            = delete;
+  WaitScope& operator=(const WaitScope&) = delete;
+  WaitScope(WaitScope&&)                 = delete;
+  WaitScope& operator=(WaitScope&&)      = delete;
+
+ private:
+  WaitStatistics& statistics_;
+  const char* label_;
+  WaitKind kind_;
+  std::source_location location_;
+  util::CpuProfileScope profile_scope_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace eray::vkren
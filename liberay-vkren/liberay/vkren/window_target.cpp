@@ -0,0 +1,122 @@
+#include <expected>
+#include <liberay/util/logger.hpp>
+#include <liberay/util/try.hpp>
+#include <liberay/vkren/window_target.hpp>
+#include <utility>
+
+namespace eray::vkren {
+
+Result<std::unique_ptr<WindowTarget>, Error> WindowTarget::create(Device& device, std::shared_ptr<os::Window> window,
+                                                                  vk::SampleCountFlagBits sample_count,
+                                                                  PresentMode present_mode, uint32_t frames_in_flight) {
+  auto target       = std::unique_ptr<WindowTarget>(new WindowTarget());  // NOLINT
+  target->p_device_ = &device;
+
+  TRY_UNWRAP_DEFINE(surface, device.create_surface(*window));
+  TRY_UNWRAP_DEFINE(
+      swap_chain, SwapChain::create(device, window, std::move(surface), sample_count, present_mode, frames_in_flight));
+  target->swap_chain_ = std::move(swap_chain);
+  target->window_     = std::move(window);
+  TRY(target->create_semaphores());
+
+  return target;
+}
+
+Result<void, Error> WindowTarget::create_semaphores() {
+  // A recreated swap chain may have more images
+  const auto image_count = swap_chain_->images().size();
+  while (acquire_semaphores_.size() < image_count) {
+    auto acquire_semaphore         = (*p_device_)->createSemaphore(vk::SemaphoreCreateInfo{});
+    auto render_finished_semaphore = (*p_device_)->createSemaphore(vk::SemaphoreCreateInfo{});
+    if (!acquire_semaphore || !render_finished_semaphore) {
+      util::Logger::err("Could not create the semaphores of a window target");
+      return std::unexpected(Error{
+          .msg     = "Semaphore creation failure",
+          .code    = ErrorCode::VulkanObjectCreationFailure{},
+          .vk_code = acquire_semaphore ? render_finished_semaphore.error() : acquire_semaphore.error(),
+      });
+    }
+    acquire_semaphores_.emplace_back(std::move(*acquire_semaphore));
+    render_finished_semaphores_.emplace_back(std::move(*render_finished_semaphore));
+  }
+  return {};
+}
+
+Result<bool, Error> WindowTarget::acquire() {
+  image_index_.reset();
+  if (window_->is_minimized()) {
+    // The swap chain cannot be recreated with a zero extent
+    return false;
+  }
+
+  TRY_UNWRAP_DEFINE(result, swap_chain_->acquire_next_image(0, *acquire_semaphores_[current_semaphore_], nullptr));
+  if (result.status != SwapChain::AcquireResult::Status::Success) {
+    // The recreated swap chain is acquired from the next frame, its retired resources are destroyed after this frame
+    TRY(create_semaphores());
+    return false;
+  }
+
+  image_index_ = result.image_index;
+  return true;
+}
+
+vk::SemaphoreSubmitInfo WindowTarget::wait_info() const {
+  return vk::SemaphoreSubmitInfo{
+      .semaphore = *acquire_semaphores_[current_semaphore_],
+      .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+  };
+}
+
+vk::SemaphoreSubmitInfo WindowTarget::signal_info() const {
+  return vk::SemaphoreSubmitInfo{
+      .semaphore = *render_finished_semaphores_[*image_index_],
+      .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+  };
+}
+
+void WindowTarget::begin_rendering(const vk::raii::CommandBuffer& cmd_buff, vk::ClearColorValue clear_color,
+                                   vk::ClearDepthStencilValue clear_depth_stencil) {
+  swap_chain_->begin_rendering(cmd_buff, *image_index_, clear_color, clear_depth_stencil);
+
+  const auto extent = swap_chain_->extent();
+  cmd_buff.setScissor(0, vk::Rect2D{.offset = vk::Offset2D{.x = 0, .y = 0}, .extent = extent});
+  cmd_buff.setViewport(0, vk::Viewport{
+                              .x        = 0.0F,
+                              .y        = 0.0F,
+                              .width    = static_cast<float>(extent.width),
+                              .height   = static_cast<float>(extent.height),
+                              .minDepth = 0.0F,
+                              .maxDepth = 1.0F,
+                          });
+}
+
+void WindowTarget::end_rendering(const vk::raii::CommandBuffer& cmd_buff) {
+  swap_chain_->end_rendering(cmd_buff, *image_index_);
+}
+
+Result<void, Error> WindowTarget::present() {
+  const auto image_index  = *std::exchange(image_index_, std::nullopt);
+  const auto present_info = vk::PresentInfoKHR{
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores    = &*render_finished_semaphores_[image_index],
+      .swapchainCount     = 1,
+      .pSwapchains        = &***swap_chain_,
+      .pImageIndices      = &image_index,
+  };
+  current_semaphore_ = (current_semaphore_ + 1) % static_cast<uint32_t>(acquire_semaphores_.size());
+
+  TRY(swap_chain_->present_image(present_info));
+  return create_semaphores();
+}
+
+void WindowTarget::destroy() {
+  image_index_.reset();
+  acquire_semaphores_.clear();
+  render_finished_semaphores_.clear();
+  if (swap_chain_) {
+    swap_chain_->destroy();
+    swap_chain_.reset();
+  }
+}
+
+}  // namespace eray::vkren
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <liberay/os/window/window.hpp>
+#include <liberay/vkren/common.hpp>
+#include <liberay/vkren/device.hpp>
+#include <liberay/vkren/error.hpp>
+#include <liberay/vkren/swap_chain.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace eray::vkren {
+
+/**
+ * @brief Additional window presented by the device of the main window. The target owns the surface of the window, its
+ * swap chain and the semaphores of its presentation, everything else, i.e. the device, the VMA allocator, the pipeline
+ * cache and the resources of the render graph, is shared with the main window.
+ *
+ * The image is acquired without waiting. When the presentation engine has no image ready, e.g. the window is on a
+ * monitor with a lower refresh rate and uses the FIFO present mode, or when the window is minimized, the window skips
+ * the frame instead of stalling the other windows. Every target is presented with its own `vkQueuePresentKHR`.
+ *
+ * @warning Lifetime is bound by the device lifetime. Must be created on the main thread.
+ *
+ */
+class WindowTarget {
+ public:
+  WindowTarget(const WindowTarget&)            = delete;
+  WindowTarget(WindowTarget&&)                 = delete;
+  WindowTarget& operator=(const WindowTarget&) = delete;
+  WindowTarget& operator=(WindowTarget&&)      = delete;
+
+  static Result<std::unique_ptr<WindowTarget>, Error> create(Device& device, std::shared_ptr<os::Window> window,
+                                                             vk::SampleCountFlagBits sample_count,
+                                                             PresentMode present_mode, uint32_t frames_in_flight);
+
+  /**
+   * @brief Acquires the next image of the swap chain without waiting.
+   *
+   * @return Result<bool, Error> False when the window skips the frame.
+   */
+  Result<bool, Error> acquire();
+
+  /**
+   * @brief True between a successful `acquire()` and `present()`.
+   *
+   */
+  bool is_acquired() const { return image_index_.has_value(); }
+
+  /**
+   * @brief Waited for by the submission that renders the acquired image.
+   *
+   */
+  vk::SemaphoreSubmitInfo wait_info() const;
+
+  /**
+   * @brief Signaled by the submission that renders the acquired image, the presentation waits for it.
+   *
+   */
+  vk::SemaphoreSubmitInfo signal_info() const;
+
+  /**
+   * @brief Begins the rendering into the acquired image and sets the viewport and the scissor to the whole image.
+   *
+   */
+  void begin_rendering(const vk::raii::CommandBuffer& cmd_buff,
+                       vk::ClearColorValue clear_color                = vk::ClearColorValue(0.0F, 0.0F, 0.0F, 1.0F),
+                       vk::ClearDepthStencilValue clear_depth_stencil = vk::ClearDepthStencilValue(1.0F, 0));
+  void end_rendering(const vk::raii::CommandBuffer& cmd_buff);
+
+  /**
+   * @brief Presents the acquired image. The swap chain is recreated when the window has been resized.
+   *
+   */
+  Result<void, Error> present();
+
+  os::Window& window() { return *window_; }
+  const os::Window& window() const { return *window_; }
+  const std::shared_ptr<os::Window>& window_ptr() const { return window_; }
+
+  SwapChain& swap_chain() { return *swap_chain_; }
+  const SwapChain& swap_chain() const { return *swap_chain_; }
+
+  /**
+   * @brief Destroys the swap chain and the surface, the window itself is left to its owner.
+   *
+   * @warning The device must not use the target anymore.
+   */
+  void destroy();
+
+ private:
+  WindowTarget() = default;
+
+  Result<void, Error> create_semaphores();
+
+  observer_ptr<Device> p_device_ = nullptr;
+  std::shared_ptr<os::Window> window_;
+  std::unique_ptr<SwapChain> swap_chain_;
+
+  /**
+   * @brief Binary semaphores of the presentation engine, one per swap chain image, the acquire semaphores are used in
+   * turns and the render finished semaphores by the image index.
+   *
+   */
+  std::vector<vk::raii::Semaphore> acquire_semaphores_;
+  std::vector<vk::raii::Semaphore> render_finished_semaphores_;
+  uint32_t current_semaphore_ = 0;
+
+  std::optional<uint32_t> image_index_;
+};
+
+}  // namespace eray::vkren
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <liberay/util/job_system.hpp>
+#include <liberay/vkren/scene/archetype_storage.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Position {
+  float x = 0.F;
+  float y = 0.F;
+};
+
+struct Velocity {
+  float dx = 0.F;
+  float dy = 0.F;
+};
+
+}  // namespace
+
+using TestStorage = eray::vkren::ArchetypeStorage<uint32_t, Position, Velocity, std::string>;
+
+TEST(ArchetypeStorageTest, GroupsKeysBySignature) {
+  auto storage = TestStorage::create(10);
+  storage.insert(1, Position{.x = 1.F});
+  storage.insert(2, Position{.x = 2.F}, Velocity{.dx = 1.F});
+  storage.insert(3, std::string("three"), Position{.x = 3.F});
+  storage.insert(4, Position{.x = 4.F}, Velocity{.dx = 2.F});
+
+  EXPECT_EQ(storage.size(), 4U);
+  EXPECT_EQ(storage.archetype_count(), 3U);
+  EXPECT_EQ(storage.chunk_count(), 3U);
+  EXPECT_TRUE(storage.contains<Velocity>(2));
+  EXPECT_FALSE(storage.contains<Velocity>(3));
+  EXPECT_EQ(storage.at<std::string>(3), "three");
+  EXPECT_EQ(storage.signature_of(3), (TestStorage::kSignatureOf<Position, std::string>));
+
+  storage.each<Position, Velocity>([](uint32_t, Position& position, const Velocity& velocity) {
+    position.x += velocity.dx;
+  });
+  EXPECT_FLOAT_EQ(storage.at<Position>(1).x, 1.F);
+  EXPECT_FLOAT_EQ(storage.at<Position>(2).x, 3.F);
+  EXPECT_FLOAT_EQ(storage.at<Position>(4).x, 6.F);
+
+  auto keys = std::vector<uint32_t>();
+  storage.each<Position>([&keys](uint32_t key, const Position&) { keys.push_back(key); });
+  std::ranges::sort(keys);
+  EXPECT_EQ(keys, (std::vector<uint32_t>{1, 2, 3, 4}));
+}
+
+TEST(ArchetypeStorageTest, AddAndRemoveMoveRows) {
+  auto storage = TestStorage::create(10);
+  storage.insert(1, Position{.x = 1.F}, std::string("one"));
+  storage.insert(2, Position{.x = 2.F}, std::string("two"));
+  storage.insert(3, Position{.x = 3.F}, std::string("three"));
+
+  storage.add<Velocity>(1, Velocity{.dx = 5.F});
+  EXPECT_TRUE(storage.contains<Velocity>(1));
+  EXPECT_EQ(storage.at<std::string>(1), "one");
+  EXPECT_FLOAT_EQ(storage.at<Position>(1).x, 1.F);
+
+  // The last row filled the hole
+  EXPECT_EQ(storage.at<std::string>(3), "three");
+  EXPECT_EQ(storage.at<std::string>(2), "two");
+
+  storage.remove<std::string>(1);
+  EXPECT_FALSE(storage.contains<std::string>(1));
+  EXPECT_FLOAT_EQ(storage.at<Velocity>(1).dx, 5.F);
+
+  storage.erase(2);
+  EXPECT_FALSE(storage.contains_key(2));
+  EXPECT_EQ(storage.size(), 2U);
+  EXPECT_EQ(storage.at<std::string>(3), "three");
+
+  // The emptied chunks are released
+  storage.erase(3);
+  EXPECT_EQ(storage.chunk_count(), 1U);
+}
+
+TEST(ArchetypeStorageTest, FillsChunksAndIteratesThemInParallel) {
+  constexpr auto kCount = uint32_t{10000};
+
+  auto storage = TestStorage::create(kCount);
+  for (auto key = 0U; key < kCount; ++key) {
+    storage.insert(key, Position{.x = static_cast<float>(key)}, Velocity{.dx = 1.F});
+  }
+
+  auto chunks = storage.chunks<Position, Velocity>();
+  ASSERT_EQ(chunks.size(), storage.chunk_count());
+  ASSERT_GT(chunks.size(), 1U);
+  auto rows = size_t{0};
+  for (const auto& [keys, positions, velocities] : chunks) {
+    EXPECT_EQ(keys.size(), positions.size());
+    EXPECT_LE(keys.size_bytes() + positions.size_bytes() + velocities.size_bytes(), TestStorage::kChunkBytes);
+    rows += keys.size();
+  }
+  EXPECT_EQ(rows, kCount);
+
+  for (auto key = 0U; key < kCount; key += 3) {
+    storage.erase(key);
+  }
+
+  auto jobs    = eray::util::JobSystem::create(4);
+  auto visited = std::atomic<uint32_t>(0);
+  storage.each<Position, Velocity>(*jobs, [&visited](uint32_t key, Position& position, const Velocity& velocity) {
+    EXPECT_FLOAT_EQ(position.x, static_cast<float>(key));
+    position.x += velocity.dx;
+    visited.fetch_add(1, std::memory_order_relaxed);
+  });
+  EXPECT_EQ(visited.load(), storage.size());
+  EXPECT_FLOAT_EQ(storage.at<Position>(1).x, 2.F);
+}
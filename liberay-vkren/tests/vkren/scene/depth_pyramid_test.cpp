@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/vkren/scene/aabb.hpp>
+#include <liberay/vkren/scene/depth_pyramid.hpp>
+#include <numbers>
+#include <vector>
+
+using Aabb         = eray::vkren::Aabb;
+using DepthPyramid = eray::vkren::DepthPyramid;
+namespace math     = eray::math;
+
+namespace {
+
+constexpr uint32_t kDepthWidth  = 64;
+constexpr uint32_t kDepthHeight = 32;
+constexpr float kZNear          = 1.F;
+constexpr float kZFar           = 100.F;
+
+math::Mat4f test_projection() {
+  return math::perspective_vk_rh(std::numbers::pi_v<float> / 2.F, 2.F, kZNear, kZFar);
+}
+
+/**
+ * @brief Depth of a point at the view distance, the camera looks down -Z.
+ *
+ */
+float depth_at(float distance) {
+  const auto clip = test_projection() * math::Vec4f(0.F, 0.F, -distance, 1.F);
+  return clip.z() / clip.w();
+}
+
+Aabb box_at(float x, float distance) {
+  return Aabb{
+      .min = math::Vec3f(x - 0.5F, -0.5F, -distance - 0.5F),
+      .max = math::Vec3f(x + 0.5F, 0.5F, -distance + 0.5F),
+  };
+}
+
+}  // namespace
+
+TEST(DepthPyramidTest, HalvesLevelsDownToSingleTexel) {
+  EXPECT_EQ(DepthPyramid::level_count_of(1, 1), 1U);
+  EXPECT_EQ(DepthPyramid::level_count_of(2, 2), 1U);
+  EXPECT_EQ(DepthPyramid::level_count_of(5, 3), 3U);
+  EXPECT_EQ(DepthPyramid::level_count_of(1920, 1080), 11U);
+
+  EXPECT_EQ(DepthPyramid::level_extent_of(5, 3, 0).x(), 3U);
+  EXPECT_EQ(DepthPyramid::level_extent_of(5, 3, 0).y(), 2U);
+  EXPECT_EQ(DepthPyramid::level_extent_of(5, 3, 1).x(), 2U);
+  EXPECT_EQ(DepthPyramid::level_extent_of(5, 3, 1).y(), 1U);
+  EXPECT_EQ(DepthPyramid::level_extent_of(5, 3, 2).x(), 1U);
+  EXPECT_EQ(DepthPyramid::level_extent_of(5, 3, 2).y(), 1U);
+  EXPECT_EQ(DepthPyramid::level_extent_of(1920, 1080, 10).x(), 1U);
+  EXPECT_EQ(DepthPyramid::level_extent_of(1920, 1080, 10).y(), 1U);
+}
+
+TEST(DepthPyramidTest, BuildKeepsFarthestDepth) {
+  // clang-format off
+  const auto depth = std::vector<float>{
+      0.1F, 0.2F, 0.3F, 0.1F, 0.5F,
+      0.4F, 0.1F, 0.1F, 0.1F, 0.1F,
+      0.1F, 0.1F, 0.1F, 0.6F, 0.1F,
+  };
+  // clang-format on
+
+  auto pyramid = DepthPyramid::create(5, 3);
+  pyramid.build(depth);
+
+  ASSERT_EQ(pyramid.level_count(), 3U);
+  EXPECT_FLOAT_EQ(pyramid.texel(0, 0, 0), 0.4F);
+  EXPECT_FLOAT_EQ(pyramid.texel(0, 1, 0), 0.3F);
+  EXPECT_FLOAT_EQ(pyramid.texel(0, 2, 0), 0.5F);
+  EXPECT_FLOAT_EQ(pyramid.texel(0, 0, 1), 0.1F);
+  EXPECT_FLOAT_EQ(pyramid.texel(0, 1, 1), 0.6F);
+  EXPECT_FLOAT_EQ(pyramid.texel(0, 2, 1), 0.1F);
+  EXPECT_FLOAT_EQ(pyramid.texel(1, 0, 0), 0.6F);
+  EXPECT_FLOAT_EQ(pyramid.texel(1, 1, 0), 0.5F);
+  EXPECT_FLOAT_EQ(pyramid.texel(2, 0, 0), *std::ranges::max_element(depth));
+}
+
+TEST(DepthPyramidTest, BoxBehindWallIsOccluded) {
+  // A wall covering the left half of the screen 5 units in front of the camera
+  auto depth = std::vector<float>(static_cast<size_t>(kDepthWidth) * kDepthHeight, 1.F);
+  for (auto y = 0U; y < kDepthHeight; ++y) {
+    std::fill_n(depth.begin() + y * kDepthWidth, kDepthWidth / 2, depth_at(5.F));
+  }
+
+  auto pyramid = DepthPyramid::create(kDepthWidth, kDepthHeight);
+  pyramid.build(depth);
+
+  const auto view_projection = test_projection();
+  const auto behind_wall     = eray::vkren::project_bounds(box_at(-20.F, 40.F), view_projection);
+  ASSERT_TRUE(behind_wall.has_value());
+  EXPECT_LT(behind_wall->max_uv.x(), 0.5F);
+  EXPECT_TRUE(pyramid.is_occluded(*behind_wall));
+
+  const auto before_wall = eray::vkren::project_bounds(box_at(-2.F, 3.F), view_projection);
+  ASSERT_TRUE(before_wall.has_value());
+  EXPECT_FALSE(pyramid.is_occluded(*before_wall));
+
+  const auto beside_wall = eray::vkren::project_bounds(box_at(20.F, 40.F), view_projection);
+  ASSERT_TRUE(beside_wall.has_value());
+  EXPECT_FALSE(pyramid.is_occluded(*beside_wall));
+
+  // Straddles the edge of the wall
+  const auto across_edge = eray::vkren::project_bounds(box_at(0.F, 40.F), view_projection);
+  ASSERT_TRUE(across_edge.has_value());
+  EXPECT_FALSE(pyramid.is_occluded(*across_edge));
+
+  // Crosses the near plane
+  EXPECT_FALSE(eray::vkren::project_bounds(box_at(0.F, 0.5F), view_projection).has_value());
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <liberay/vkren/scene/entity_pool.hpp>
+#include <vector>
 
 struct TestTag {};
 using TestEntityId   = eray::vkren::EntityId<TestTag>;
@@ -84,3 +85,46 @@ TEST(BasicObjectPoolTest, ComposeIdWithPool) {
   auto composed = pool.compose_id(index);
   EXPECT_EQ(composed.value, id.value);  // Compose with pool version
 }
+
+TEST(BasicObjectPoolTest, CreateManyReusesFreedIndicesFirst) {
+  auto pool = TestEntityPool::create(200);
+
+  auto first = std::vector<TestEntityId>(3);
+  pool.create_many(first);
+  pool.remove(first[1]);
+
+  auto ids = std::vector<TestEntityId>(150);
+  pool.create_many(ids);
+  EXPECT_EQ(pool.count(), 152);
+  EXPECT_EQ(TestEntityPool::index_of(ids[0]), TestEntityPool::index_of(first[1]));
+  EXPECT_EQ(TestEntityPool::version_of(ids[0]), TestEntityPool::version_of(first[1]) + 1);
+  for (auto n = 1U; n < ids.size(); ++n) {
+    EXPECT_EQ(TestEntityPool::index_of(ids[n]), n + 2);
+    EXPECT_TRUE(pool.exists(ids[n]));
+  }
+  EXPECT_FALSE(pool.exists(first[1]));
+}
+
+TEST(BasicObjectPoolTest, RemoveManyAndIterateLiveIds) {
+  auto pool = TestEntityPool::create(300);
+
+  auto ids = std::vector<TestEntityId>(300);
+  pool.create_many(ids);
+
+  auto removed = std::vector<TestEntityId>();
+  for (auto n = 0U; n < ids.size(); n += 3) {
+    removed.push_back(ids[n]);
+  }
+  pool.remove_many(removed);
+  EXPECT_EQ(pool.count(), 200);
+
+  auto live = std::vector<TestEntityId>();
+  pool.for_each([&live](TestEntityId id) { live.push_back(id); });
+  ASSERT_EQ(live.size(), 200);
+  auto expected = size_t{0};
+  for (auto n = 0U; n < ids.size(); ++n) {
+    if (n % 3 != 0) {
+      EXPECT_EQ(live[expected++].value, ids[n].value);
+    }
+  }
+}
@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <liberay/vkren/scene/entity_pool.hpp>
 #include <liberay/vkren/scene/flat_tree.hpp>
+#include <vector>
 
 using FlatTree = eray::vkren::FlatTree;
 using NodeId   = eray::vkren::NodeId;
@@ -153,6 +155,142 @@ TEST(FlatTreeTest, DFSIteration) {
   EXPECT_NE(std::ranges::find(ids, n4), ids.end());
 }
 
+TEST(FlatTreeTest, TraversalOrders) {
+  //       root
+  //      /    \
+  //     a      b
+  //    / \     |
+  //   c   d    e
+  //   |
+  //   f
+  FlatTree tree = FlatTree::create(10);
+  NodeId a      = tree.create_node();
+  NodeId b      = tree.create_node();
+  NodeId c      = tree.create_node(a);
+  NodeId d      = tree.create_node(a);
+  NodeId e      = tree.create_node(b);
+  NodeId f      = tree.create_node(c);
+  NodeId root   = FlatTree::kRootNodeId;
+
+  auto dfs = std::vector<NodeId>();
+  for (auto id : eray::vkren::FlatTreeDFSRange(&tree, root)) {
+    dfs.push_back(id);
+  }
+  EXPECT_EQ(dfs, (std::vector<NodeId>{root, a, c, f, d, b, e}));
+  EXPECT_EQ(tree.nodes_dfs_preorder(), dfs);
+
+  auto bfs = std::vector<NodeId>();
+  for (auto id : eray::vkren::FlatTreeBFSRange(&tree, root)) {
+    bfs.push_back(id);
+  }
+  EXPECT_EQ(bfs, (std::vector<NodeId>{root, a, b, c, d, e, f}));
+  EXPECT_EQ(tree.nodes_bfs_order(), bfs);
+
+  auto bfs_reversed = std::vector<NodeId>();
+  for (auto id : eray::vkren::FlatTreeBFSRange(&tree, root, true, false)) {
+    bfs_reversed.push_back(id);
+  }
+  EXPECT_EQ(bfs_reversed, (std::vector<NodeId>{root, b, a, e, d, c, f}));
+
+  auto subtree = std::vector<NodeId>();
+  for (auto id : eray::vkren::FlatTreeBFSRange(&tree, a, false)) {
+    subtree.push_back(id);
+  }
+  EXPECT_EQ(subtree, (std::vector<NodeId>{c, d, f}));
+
+  auto subtree_preorder = tree.subtree_dfs_preorder(a);
+  EXPECT_EQ(std::vector<NodeId>(subtree_preorder.begin(), subtree_preorder.end()), (std::vector<NodeId>{a, c, f, d}));
+
+  EXPECT_TRUE(tree.is_descendant(f, a));
+  EXPECT_FALSE(tree.is_descendant(e, a));
+  EXPECT_FALSE(tree.is_descendant(a, a));
+}
+
+TEST(FlatTreeTest, ChangeParentUpdatesDescendantLevels) {
+  FlatTree tree = FlatTree::create(10);
+  NodeId a      = tree.create_node();
+  NodeId b      = tree.create_node(a);
+  NodeId c      = tree.create_node(b);
+  NodeId d      = tree.create_node();
+
+  tree.change_parent(b, d);
+  tree.change_parent(d, tree.create_node());
+
+  EXPECT_EQ(tree.node_level(d), 2);
+  EXPECT_EQ(tree.node_level(b), 3);
+  EXPECT_EQ(tree.node_level(c), 4);
+
+  auto subtree_preorder = tree.subtree_dfs_preorder(d);
+  EXPECT_EQ(std::vector<NodeId>(subtree_preorder.begin(), subtree_preorder.end()), (std::vector<NodeId>{d, b, c}));
+}
+
+TEST(FlatTreeTest, IncrementalPreorderMatchesTraversal) {
+  FlatTree tree = FlatTree::create(256);
+  auto nodes    = std::vector<NodeId>();
+  for (auto i = 0U; i < 32; ++i) {
+    nodes.push_back(tree.create_node(i < 4 ? FlatTree::kRootNodeId : nodes[i / 3]));
+  }
+  static_cast<void>(tree.nodes_dfs_preorder());
+
+  const auto expect_consistent = [&tree]() {
+    auto traversal = std::vector<NodeId>();
+    for (auto id : eray::vkren::FlatTreeDFSRange(&tree, FlatTree::kRootNodeId)) {
+      traversal.push_back(id);
+    }
+    ASSERT_EQ(tree.nodes_dfs_preorder(), traversal);
+
+    for (auto id : traversal) {
+      auto subtree = std::vector<NodeId>();
+      for (auto descendant : eray::vkren::FlatTreeDFSRange(&tree, id)) {
+        subtree.push_back(descendant);
+      }
+      auto span = tree.subtree_dfs_preorder(id);
+      ASSERT_EQ(tree.subtree_size(id), subtree.size());
+      ASSERT_EQ(std::vector<NodeId>(span.begin(), span.end()), subtree);
+    }
+  };
+
+  // Deterministic pseudo-random edits
+  auto state = 12345U;
+  auto next  = [&state](size_t bound) {
+    state = state * 1664525U + 1013904223U;
+    return static_cast<size_t>(state >> 8) % bound;
+  };
+  for (auto step = 0U; step < 200; ++step) {
+    std::erase_if(nodes, [&tree](NodeId id) { return !tree.exists(id); });
+    auto node = nodes[next(nodes.size())];
+
+    switch (next(5)) {
+      case 0:
+        if (tree.subtree_size(FlatTree::kRootNodeId) < 200) {
+          nodes.push_back(tree.create_node(node));
+        }
+        break;
+      case 1: {
+        auto parent = nodes[next(nodes.size())];
+        if (parent != node && !tree.is_descendant(parent, node)) {
+          tree.change_parent(node, parent);
+        }
+        break;
+      }
+      case 2:
+        tree.make_orphan(node);
+        break;
+      case 3:
+        if (nodes.size() > 8) {
+          tree.delete_node(node);
+        }
+        break;
+      default:
+        if (tree.subtree_size(node) < 8 && tree.subtree_size(FlatTree::kRootNodeId) < 200) {
+          nodes.push_back(tree.copy_node(node, nodes[next(nodes.size())]));
+        }
+        break;
+    }
+    expect_consistent();
+  }
+}
+
 TEST(FlatTreeTest, Exists) {
   FlatTree tree = FlatTree::create(10);
   NodeId n      = tree.create_node();
@@ -171,3 +309,17 @@ TEST(FlatTreeTest, NodeSurroundingInfo) {
   EXPECT_EQ(info.parent_id, a);
   EXPECT_EQ(info.left_sibling_id, FlatTree::kNullNodeId);
 }
+
+TEST(FlatTreeTest, DfsPositionMatchesPreorder) {
+  FlatTree tree = FlatTree::create(10);
+  NodeId a      = tree.create_node();
+  NodeId b      = tree.create_node();
+  NodeId c      = tree.create_node(a);
+  tree.change_parent(b, c);
+
+  const auto& preorder = tree.nodes_dfs_preorder();
+  for (auto i = size_t{0}; i < preorder.size(); ++i) {
+    EXPECT_EQ(tree.dfs_position(FlatTree::index_of(preorder[i])), i);
+  }
+  EXPECT_EQ(tree.dfs_position(FlatTree::index_of(b)), 3U);
+}
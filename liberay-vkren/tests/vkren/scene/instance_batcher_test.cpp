@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <liberay/vkren/scene/instance_batcher.hpp>
+#include <liberay/vkren/scene/render_queue.hpp>
+#include <vector>
+
+using DrawOrder       = eray::vkren::DrawOrder;
+using InstanceBatcher = eray::vkren::InstanceBatcher;
+using RenderDraw      = eray::vkren::RenderDraw;
+using RenderQueue     = eray::vkren::RenderQueue;
+
+namespace {
+
+/**
+ * @brief Distinct non-null handle, never passed to Vulkan.
+ *
+ */
+template <typename THandle>
+THandle fake_handle(uintptr_t value) {
+  using CType = typename THandle::CType;
+  return THandle(reinterpret_cast<CType>(value));  // NOLINT
+}
+
+/**
+ * @brief All of the meshes share the buffers, like the surfaces of a geometry arena.
+ *
+ */
+RenderDraw test_draw(uint32_t material, uint32_t mesh, uint32_t world_matrix_index) {
+  return RenderDraw{
+      .material =
+          {
+              .pipeline     = fake_handle<vk::Pipeline>(0x100),
+              .layout       = fake_handle<vk::PipelineLayout>(0x200),
+              .material_set = fake_handle<vk::DescriptorSet>(0x300 + material),
+          },
+      .surface =
+          {
+              .vertex_buffer = fake_handle<vk::Buffer>(0x400),
+              .index_buffer  = fake_handle<vk::Buffer>(0x500),
+              .first_index   = mesh * 36,
+              .index_count   = 36,
+          },
+      .first_instance = world_matrix_index,
+  };
+}
+
+}  // namespace
+
+TEST(InstanceBatcherTest, CollapsesIdenticalDraws) {
+  auto queue = RenderQueue::create();
+  queue.set_depth_range(0.F, 100.F);
+
+  // An assembly of 2 parts repeated 100 times, the nodes are pushed in the scene order
+  constexpr auto kCopies = 100U;
+  for (auto i = 0U; i < kCopies; ++i) {
+    queue.push(0, test_draw(0, 0, 2 * i), static_cast<float>(i));
+    queue.push(0, test_draw(1, 1, 2 * i + 1), static_cast<float>(i));
+  }
+  queue.sort();
+  EXPECT_EQ(queue.stats(0).draws, 2 * kCopies);
+
+  auto batcher = InstanceBatcher::create();
+  batcher.build(queue);
+
+  const auto stats = batcher.stats(0);
+  EXPECT_EQ(stats.draws, 2U);
+  EXPECT_EQ(stats.descriptor_binds, 2U);
+  EXPECT_EQ(stats.geometry_binds, 1U);
+
+  ASSERT_EQ(batcher.batches().size(), 2U);
+  EXPECT_EQ(batcher.instance_indices().size(), 2 * kCopies);
+  for (const auto& batch : batcher.batches()) {
+    EXPECT_EQ(batch.instance_count, kCopies);
+
+    // Every instance keeps its world matrix index, the batch of the first part is sorted front to back
+    const auto first = batcher.instance_indices()[batch.first_instance];
+    for (auto n = 0U; n < batch.instance_count; ++n) {
+      EXPECT_EQ(batcher.instance_indices()[batch.first_instance + n], first + 2 * n);
+    }
+  }
+}
+
+TEST(InstanceBatcherTest, KeepsPassesAndBackToFrontOrder) {
+  auto queue = RenderQueue::create();
+  queue.set_depth_range(0.F, 10.F);
+  queue.set_pass_order(1, DrawOrder::BackToFront);
+
+  queue.push(0, test_draw(0, 0, 0), 1.F);
+  queue.push(1, test_draw(0, 0, 1), 2.F);
+  queue.push(1, test_draw(1, 0, 2), 3.F);
+  queue.push(1, test_draw(0, 0, 3), 4.F);
+  queue.push(1, test_draw(0, 0, 4), 5.F);
+  queue.sort();
+
+  auto batcher = InstanceBatcher::create();
+  batcher.build(queue);
+
+  EXPECT_EQ(batcher.stats(0).draws, 1U);
+
+  // The draws of the material 0 are not adjacent in the back to front order, only the farthest two get batched
+  EXPECT_EQ(batcher.stats(1).draws, 3U);
+  const auto indices = std::vector<uint32_t>(batcher.instance_indices().begin(), batcher.instance_indices().end());
+  EXPECT_EQ(indices, (std::vector<uint32_t>{0, 4, 3, 2, 1}));
+}
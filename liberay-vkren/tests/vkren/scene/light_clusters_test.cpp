@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/vkren/scene/light.hpp>
+#include <liberay/vkren/scene/light_clusters.hpp>
+#include <numbers>
+#include <vector>
+
+using GpuLight         = eray::vkren::GpuLight;
+using GpuLightCluster  = eray::vkren::GpuLightCluster;
+using GpuLightType     = eray::vkren::GpuLightType;
+using Light            = eray::vkren::Light;
+using LightClusterGrid = eray::vkren::LightClusterGrid;
+namespace math         = eray::math;
+
+namespace {
+
+constexpr float kFovY   = std::numbers::pi_v<float> / 2.F;
+constexpr float kAspect = 16.F / 9.F;
+
+LightClusterGrid test_grid() { return LightClusterGrid::create(math::Vec3u(16, 9, 4), kFovY, kAspect, 1.F, 16.F); }
+
+Light point_light(float x, float y, float z) {
+  return Light{
+      .color  = math::Vec3f::filled(1.F),
+      .lights = eray::vkren::PointLight{.position = math::Vec3f(x, y, z), .quadratic = 1.F},
+  };
+}
+
+}  // namespace
+
+TEST(LightClustersTest, PackMovesDirectionalLightsToFront) {
+  const auto lights = std::vector<Light>{
+      point_light(0.F, 0.F, 0.F),
+      Light{
+          .color  = math::Vec3f::filled(1.F),
+          .lights = eray::vkren::DirectionalLight{.direction = math::Vec3f(0.F, -1.F, 0.F)},
+      },
+      point_light(1.F, 0.F, 0.F),
+  };
+
+  auto packed                  = std::vector<GpuLight>();
+  const auto directional_count = eray::vkren::pack_lights(lights, packed);
+
+  ASSERT_EQ(packed.size(), 3U);
+  EXPECT_EQ(directional_count, 1U);
+  EXPECT_EQ(packed[0].type, GpuLightType::Directional);
+  EXPECT_EQ(packed[1].type, GpuLightType::Point);
+  EXPECT_FLOAT_EQ(packed[1].position.x(), 0.F);
+  EXPECT_FLOAT_EQ(packed[2].position.x(), 1.F);
+
+  // 1 / (1 + d^2) drops to the cutoff at d = sqrt(255)
+  EXPECT_NEAR(packed[1].range, std::sqrt(255.F), 1e-3F);
+  EXPECT_FLOAT_EQ(packed[0].range, 0.F);
+}
+
+TEST(LightClustersTest, SlicesAreExponential) {
+  const auto grid = test_grid();
+
+  EXPECT_EQ(grid.slice_of(0.5F), 0U);
+  EXPECT_EQ(grid.slice_of(1.5F), 0U);
+  EXPECT_EQ(grid.slice_of(3.F), 1U);
+  EXPECT_EQ(grid.slice_of(5.F), 2U);
+  EXPECT_EQ(grid.slice_of(12.F), 3U);
+  EXPECT_EQ(grid.slice_of(100.F), 3U);
+}
+
+TEST(LightClustersTest, ClusterBoundsContainTheirPoints) {
+  const auto grid = test_grid();
+  const auto proj = math::perspective_vk_rh(kFovY, kAspect, 1.F, 16.F);
+
+  const auto points = std::vector<math::Vec3f>{
+      math::Vec3f(0.3F, 0.2F, -2.F),
+      math::Vec3f(-4.F, 1.5F, -7.F),
+      math::Vec3f(2.F, -3.F, -13.F),
+  };
+  for (const auto& point : points) {
+    const auto clip = proj * math::Vec4f(point.x(), point.y(), point.z(), 1.F);
+    const auto ndc  = math::Vec2f(clip.x() / clip.w(), clip.y() / clip.w());
+    ASSERT_LT(std::abs(ndc.x()), 1.F);
+    ASSERT_LT(std::abs(ndc.y()), 1.F);
+
+    const auto x = static_cast<uint32_t>((ndc.x() * 0.5F + 0.5F) * static_cast<float>(grid.dims().x()));
+    const auto y = static_cast<uint32_t>((ndc.y() * 0.5F + 0.5F) * static_cast<float>(grid.dims().y()));
+    const auto z = grid.slice_of(-point.z());
+
+    const auto bounds = grid.cluster_bounds(x, y, z);
+    for (auto i = 0U; i < 3; ++i) {
+      EXPECT_LE(bounds.min[i], point[i] + 1e-4F);
+      EXPECT_GE(bounds.max[i], point[i] - 1e-4F);
+    }
+  }
+}
+
+TEST(LightClustersTest, AssignTouchesOnlyNearbyClusters) {
+  const auto grid = test_grid();
+
+  auto light      = GpuLight::create(point_light(0.F, 0.F, -5.F));
+  light.range     = 0.25F;
+  auto far_light  = GpuLight::create(point_light(0.F, 0.F, -100.F));
+  far_light.range = 1.F;
+  const auto lights = std::vector<GpuLight>{light, far_light};
+
+  auto clusters      = std::vector<GpuLightCluster>();
+  auto light_indices = std::vector<uint32_t>();
+  grid.assign(lights, math::Mat4f::identity(), clusters, light_indices);
+
+  ASSERT_EQ(clusters.size(), grid.cluster_count());
+  EXPECT_TRUE(std::ranges::none_of(light_indices, [](uint32_t index) { return index == 1; }));
+
+  // The light sits at the center of the screen, on the edge between the tiles 7 and 8 of the middle row
+  const auto center = clusters[grid.cluster_index(8, 4, 2)];
+  ASSERT_EQ(center.count, 1U);
+  EXPECT_EQ(light_indices[center.offset], 0U);
+  EXPECT_EQ(clusters[grid.cluster_index(0, 0, 2)].count, 0U);
+  EXPECT_EQ(clusters[grid.cluster_index(8, 4, 0)].count, 0U);
+  EXPECT_LE(light_indices.size(), 8U);
+}
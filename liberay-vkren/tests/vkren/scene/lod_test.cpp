@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/vkren/scene/camera.hpp>
+#include <liberay/vkren/scene/frustum.hpp>
+#include <liberay/vkren/scene/lod.hpp>
+#include <liberay/vkren/scene/scene_bounds.hpp>
+#include <liberay/vkren/scene/transform_tree.hpp>
+#include <numbers>
+#include <vector>
+
+using Aabb          = eray::vkren::Aabb;
+using Camera        = eray::vkren::Camera;
+using Frustum       = eray::vkren::Frustum;
+using LodSelector   = eray::vkren::LodSelector;
+using LodView       = eray::vkren::LodView;
+using MeshLodChain  = eray::vkren::MeshLodChain;
+using NodeId        = eray::vkren::NodeId;
+using SceneBounds   = eray::vkren::SceneBounds;
+using TransformTree = eray::vkren::TransformTree;
+namespace math      = eray::math;
+
+namespace {
+
+constexpr float kFovY = std::numbers::pi_v<float> / 2.F;
+
+LodView test_view() {
+  const auto camera = Camera{
+      .aspect_ratio = 1.F,
+      .near_plane   = 1.F,
+      .far_plane    = 1000.F,
+      .projection   = eray::vkren::PerspectiveCamera{.fov = kFovY},
+  };
+  return *LodView::create(camera, math::Vec3f::filled(0.F));
+}
+
+MeshLodChain test_chain() {
+  auto chain             = MeshLodChain{};
+  chain.min_screen_sizes = {0.5F, 0.1F, 0.F, 0.F};
+  chain.lod_count        = 3;
+  return chain;
+}
+
+}  // namespace
+
+TEST(LodTest, ScreenSizeFallsWithDistance) {
+  const auto view = test_view();
+  EXPECT_NEAR(view.projection_scale, 1.F, 1e-5F);
+
+  // A sphere of the radius 1 at the distance 10 covers a tenth of the screen height
+  const auto box = Aabb::from_center_extent(math::Vec3f(0.F, 0.F, -10.F), math::Vec3f::filled(1.F / std::sqrt(3.F)));
+  EXPECT_NEAR(eray::vkren::projected_screen_size(box, view), 0.1F, 1e-5F);
+
+  const auto far_box = Aabb::from_center_extent(math::Vec3f(0.F, 0.F, -20.F), box.extent());
+  EXPECT_NEAR(eray::vkren::projected_screen_size(far_box, view), 0.05F, 1e-5F);
+
+  const auto around_eye = Aabb::from_center_extent(math::Vec3f::filled(0.F), box.extent());
+  EXPECT_GT(eray::vkren::projected_screen_size(around_eye, view), 1e30F);
+
+  const auto ortho = Camera{.near_plane = 1.F, .far_plane = 10.F, .projection = eray::vkren::OrthographicCamera{}};
+  EXPECT_FALSE(LodView::create(ortho, math::Vec3f::filled(0.F)));
+}
+
+TEST(LodTest, SelectionHasHysteresis) {
+  const auto chain      = test_chain();
+  const auto thresholds = chain.thresholds();
+
+  EXPECT_EQ(eray::vkren::select_lod(thresholds, 0.8F, 0, 0.1F), 0U);
+  EXPECT_EQ(eray::vkren::select_lod(thresholds, 0.3F, 0, 0.1F), 1U);
+  EXPECT_EQ(eray::vkren::select_lod(thresholds, 0.01F, 0, 0.1F), 2U);
+
+  // Right below the threshold the LOD 0 is kept, it is dropped only past the band
+  EXPECT_EQ(eray::vkren::select_lod(thresholds, 0.48F, 0, 0.1F), 0U);
+  EXPECT_EQ(eray::vkren::select_lod(thresholds, 0.44F, 0, 0.1F), 1U);
+
+  // Back from the LOD 1 the size must exceed the threshold by the band as well
+  EXPECT_EQ(eray::vkren::select_lod(thresholds, 0.52F, 1, 0.1F), 1U);
+  EXPECT_EQ(eray::vkren::select_lod(thresholds, 0.56F, 1, 0.1F), 0U);
+
+  // Without hysteresis the LOD follows the thresholds
+  EXPECT_EQ(eray::vkren::select_lod(thresholds, 0.48F, 0, 0.F), 1U);
+  EXPECT_EQ(eray::vkren::select_lod(thresholds, 0.52F, 1, 0.F), 0U);
+}
+
+TEST(LodTest, CullComputesScreenSizesForSelector) {
+  const auto frustum = Frustum::from_view_projection(math::perspective_vk_rh(kFovY, 1.F, 1.F, 1000.F));
+  const auto view    = test_view();
+
+  auto tree     = TransformTree::create(16);
+  auto bounds   = SceneBounds::create(16, 0.F);
+  auto selector = LodSelector::create(16);
+
+  const auto near_node = tree.create_node();
+  const auto far_node  = tree.create_node();
+  tree.set_local_position(near_node, math::Vec3f(0.F, 0.F, -1.5F));
+  tree.set_local_position(far_node, math::Vec3f(0.F, 0.F, -100.F));
+  tree.update();
+
+  const auto unit_box = Aabb::from_center_extent(math::Vec3f::filled(0.F), math::Vec3f::filled(0.5F));
+  bounds.set_local_bounds(near_node, unit_box);
+  bounds.set_local_bounds(far_node, unit_box);
+  bounds.refit(tree);
+
+  auto visible      = std::vector<NodeId>();
+  auto screen_sizes = std::vector<float>();
+  bounds.cull(frustum, view, visible, screen_sizes);
+  ASSERT_EQ(visible.size(), 2U);
+  ASSERT_EQ(screen_sizes.size(), 2U);
+
+  const auto chain = test_chain();
+  for (auto i = 0U; i < visible.size(); ++i) {
+    selector.select(visible[i], chain, screen_sizes[i]);
+  }
+  EXPECT_EQ(selector.current_lod(near_node), 0U);
+  EXPECT_EQ(selector.current_lod(far_node), 2U);
+}
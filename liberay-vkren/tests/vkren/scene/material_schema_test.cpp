@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/scene/entity_pool.hpp>
+#include <liberay/vkren/scene/material_schema.hpp>
+#include <utility>
+
+using MaterialParamInfo      = eray::vkren::MaterialParamInfo;
+using MaterialParamType      = eray::vkren::MaterialParamType;
+using MaterialParameterTable = eray::vkren::MaterialParameterTable;
+using MaterialSchema         = eray::vkren::MaterialSchema;
+using TextureId              = eray::vkren::TextureId;
+namespace math               = eray::math;
+
+namespace {
+
+MaterialSchema test_schema() {
+  const auto params = std::array{
+      MaterialParamInfo{.name = "roughness", .type = MaterialParamType::Float},
+      MaterialParamInfo{.name = "emissive", .type = MaterialParamType::Float3},
+      MaterialParamInfo{.name = "metallic", .type = MaterialParamType::Float},
+      MaterialParamInfo{.name = "uv_scale", .type = MaterialParamType::Float2},
+      MaterialParamInfo{.name = "albedo_texture", .type = MaterialParamType::Texture},
+  };
+  return MaterialSchema::create(params);
+}
+
+}  // namespace
+
+TEST(MaterialSchemaTest, ParamsGetStd430Offsets) {
+  const auto schema = test_schema();
+
+  EXPECT_EQ(schema.offset(schema.handle<float>("roughness")), 0U);
+  EXPECT_EQ(schema.offset(schema.handle<math::Vec3f>("emissive")), 16U);
+  EXPECT_EQ(schema.offset(schema.handle<float>("metallic")), 28U);
+  EXPECT_EQ(schema.offset(schema.handle<math::Vec2f>("uv_scale")), 32U);
+  EXPECT_EQ(schema.offset(schema.handle<TextureId>("albedo_texture")), 40U);
+  EXPECT_EQ(schema.size_bytes(), 44U);
+  EXPECT_EQ(schema.stride(), 48U);
+  EXPECT_FALSE(schema.find("normal_texture"));
+}
+
+TEST(MaterialSchemaTest, SetWritesBlocksAndTracksDirtyRange) {
+  const auto schema = test_schema();
+  auto table        = MaterialParameterTable::create(schema);
+
+  const auto first  = table.add_material();
+  const auto second = table.add_material();
+  ASSERT_EQ(table.bytes().size(), 2 * schema.stride());
+  ASSERT_TRUE(table.dirty_range());
+  EXPECT_EQ(*table.dirty_range(), (std::pair<size_t, size_t>(0, 2 * schema.stride())));
+
+  table.clear_dirty();
+  EXPECT_FALSE(table.dirty_range());
+
+  const auto metallic = schema.handle<float>("metallic");
+  const auto emissive = schema.handle<math::Vec3f>("emissive");
+  table.set(second, metallic, 0.5F);
+  table.set(second, emissive, math::Vec3f(1.F, 2.F, 3.F));
+
+  EXPECT_EQ(*table.dirty_range(), (std::pair<size_t, size_t>(schema.stride() + 16, schema.stride() + 32)));
+  EXPECT_FLOAT_EQ(table.get<float>(second, metallic), 0.5F);
+  const auto value = table.get<math::Vec3f>(second, emissive);
+  EXPECT_FLOAT_EQ(value.x(), 1.F);
+  EXPECT_FLOAT_EQ(value.y(), 2.F);
+  EXPECT_FLOAT_EQ(value.z(), 3.F);
+  EXPECT_FLOAT_EQ(table.get<float>(first, metallic), 0.F);
+}
+
+TEST(MaterialSchemaTest, TexturesAreStoredAsIndices) {
+  const auto schema = test_schema();
+  auto table        = MaterialParameterTable::create(schema);
+  const auto slot   = table.add_material();
+
+  const auto handle  = schema.handle<TextureId>("albedo_texture");
+  const auto texture = eray::vkren::EntityIdExtractor<eray::vkren::TextureTag>::compose_id(7, 3);
+  table.set(slot, handle, texture);
+
+  auto index = uint32_t{};
+  std::memcpy(&index, table.block(slot).data() + schema.offset(handle), sizeof(index));
+  EXPECT_EQ(index, 7U);
+}
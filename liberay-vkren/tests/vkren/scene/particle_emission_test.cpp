@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+
+#include <liberay/vkren/scene/particle_emission.hpp>
+
+using ParticleEmissionClock = eray::vkren::ParticleEmissionClock;
+
+TEST(ParticleEmissionTest, FractionsCarryToTheNextFrames) {
+  auto clock = ParticleEmissionClock{};
+
+  // Half a particle per frame
+  EXPECT_EQ(clock.advance(30.F, 1.F / 60.F), 0U);
+  EXPECT_EQ(clock.advance(30.F, 1.F / 60.F), 1U);
+  EXPECT_EQ(clock.advance(30.F, 1.F / 60.F), 0U);
+  EXPECT_EQ(clock.advance(30.F, 1.F / 60.F), 1U);
+
+  clock.reset();
+  auto spawned = 0U;
+  for (auto i = 0; i < 600; ++i) {
+    spawned += clock.advance(1000.F, 1.F / 144.F);
+  }
+  EXPECT_NEAR(static_cast<float>(spawned), 1000.F * 600.F / 144.F, 1.F);
+}
+
+TEST(ParticleEmissionTest, LongFramesDoNotBurst) {
+  auto clock = ParticleEmissionClock{};
+  EXPECT_EQ(clock.advance(1000.F, 1.F, 100), 100U);
+  EXPECT_EQ(clock.carry(), 0.F);
+  EXPECT_EQ(clock.advance(40.F, 0.25F, 100), 10U);
+
+  // Negative rates and times emit nothing
+  EXPECT_EQ(clock.advance(-10.F, 1.F), 0U);
+  EXPECT_EQ(clock.advance(10.F, -1.F), 0U);
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/util/job_system.hpp>
+#include <liberay/vkren/scene/camera.hpp>
+#include <liberay/vkren/scene/flat_tree.hpp>
+#include <liberay/vkren/scene/lod.hpp>
+#include <liberay/vkren/scene/render_extractor.hpp>
+#include <liberay/vkren/scene/render_snapshot.hpp>
+#include <liberay/vkren/scene/scene.hpp>
+#include <numbers>
+#include <vector>
+
+using Aabb            = eray::vkren::Aabb;
+using Camera          = eray::vkren::Camera;
+using FlatTree        = eray::vkren::FlatTree;
+using GPUMaterial     = eray::vkren::GPUMaterial;
+using GPUMeshSurface  = eray::vkren::GPUMeshSurface;
+using LodView         = eray::vkren::LodView;
+using MeshRenderer    = eray::vkren::MeshRenderer;
+using RenderExtractor = eray::vkren::RenderExtractor;
+using RenderQueue     = eray::vkren::RenderQueue;
+using RenderSnapshot  = eray::vkren::RenderSnapshot;
+using RenderView      = eray::vkren::RenderView;
+using Scene           = eray::vkren::Scene;
+namespace math        = eray::math;
+
+namespace {
+
+constexpr float kFovY = std::numbers::pi_v<float> / 2.F;
+
+/**
+ * @brief Distinct non-null handle, never passed to Vulkan.
+ *
+ */
+template <typename THandle>
+THandle fake_handle(uintptr_t value) {
+  using CType = typename THandle::CType;
+  return THandle(reinterpret_cast<CType>(value));  // NOLINT
+}
+
+RenderView test_view() {
+  const auto camera = Camera{
+      .aspect_ratio = 1.F,
+      .near_plane   = 1.F,
+      .far_plane    = 1000.F,
+      .projection   = eray::vkren::PerspectiveCamera{.fov = kFovY},
+  };
+  return RenderView{
+      .view       = math::Mat4f::identity(),
+      .projection = math::perspective_vk_rh(kFovY, 1.F, 1.F, 1000.F),
+      .lod_view   = *LodView::create(camera, math::Vec3f::filled(0.F)),
+  };
+}
+
+}  // namespace
+
+TEST(RenderExtractorTest, ParallelExtractionMatchesVisibleOrder) {
+  constexpr auto kNodesCount = 1000U;
+  auto scene                 = Scene::create(kNodesCount + 1);
+  auto& tree                 = scene.tree();
+
+  const auto unit_box = Aabb::from_center_extent(math::Vec3f::filled(0.F), math::Vec3f::filled(0.5F));
+  for (auto i = 0U; i < kNodesCount; ++i) {
+    const auto node = tree.create_node();
+    tree.set_local_position(node, math::Vec3f(0.F, 0.F, -10.F - static_cast<float>(i % 50)));
+    scene.bounds().set_local_bounds(node, unit_box);
+
+    // Every seventh node has nothing to draw
+    if (i % 7 != 0) {
+      scene.renderers().insert(FlatTree::index_of(node), MeshRenderer{.mesh = i % 3, .material = i % 2});
+    }
+  }
+  tree.update();
+  scene.bounds().refit(tree);
+
+  auto snapshot = RenderSnapshot();
+  snapshot.extract(scene, test_view());
+  ASSERT_EQ(snapshot.renderers.size(), snapshot.visible_nodes.size());
+
+  auto meshes = std::array<GPUMeshSurface, 3>{};
+  for (auto i = 0U; i < meshes.size(); ++i) {
+    meshes[i] = GPUMeshSurface{
+        .vertex_buffer = fake_handle<vk::Buffer>(0x400 + i),
+        .index_buffer  = fake_handle<vk::Buffer>(0x500 + i),
+        .first_index   = 0,
+        .index_count   = 3,
+    };
+  }
+  auto materials = std::array<GPUMaterial, 2>{};
+  for (auto i = 0U; i < materials.size(); ++i) {
+    materials[i] = GPUMaterial{
+        .pipeline     = fake_handle<vk::Pipeline>(0x100 + i),
+        .layout       = fake_handle<vk::PipelineLayout>(0x200),
+        .material_set = fake_handle<vk::DescriptorSet>(0x300 + i),
+    };
+  }
+
+  auto jobs      = eray::util::JobSystem::create(3);
+  auto extractor = RenderExtractor::create();
+  auto queue     = RenderQueue::create();
+  queue.set_depth_range(1.F, 100.F);
+  extractor.extract(*jobs, snapshot, meshes, materials, queue, 16);
+
+  auto expected_instances = std::vector<uint32_t>();
+  for (auto i = 0U; i < snapshot.renderers.size(); ++i) {
+    if (snapshot.renderers[i].mesh != MeshRenderer::kNone) {
+      expected_instances.push_back(i);
+    }
+  }
+  ASSERT_EQ(extractor.packet_count(), expected_instances.size());
+  ASSERT_EQ(queue.draws().size(), expected_instances.size());
+  for (auto i = 0U; i < expected_instances.size(); ++i) {
+    const auto& draw     = queue.draws()[i];
+    const auto& renderer = snapshot.renderers[expected_instances[i]];
+    EXPECT_EQ(draw.first_instance, expected_instances[i]);
+    EXPECT_EQ(draw.surface.vertex_buffer, meshes[renderer.mesh].vertex_buffer);
+    EXPECT_EQ(draw.material.material_set, materials[renderer.material].material_set);
+  }
+
+  // The sorted draws bind every material and every mesh of a material once
+  queue.sort();
+  const auto stats = queue.stats(0);
+  EXPECT_EQ(stats.draws, expected_instances.size());
+  EXPECT_EQ(stats.pipeline_binds, materials.size());
+  EXPECT_EQ(stats.descriptor_binds, materials.size());
+  EXPECT_EQ(stats.geometry_binds, materials.size() * meshes.size());
+}
+
+TEST(RenderExtractorTest, ExtractionIsRepeatable) {
+  auto scene = Scene::create(8);
+  auto& tree = scene.tree();
+
+  const auto node = tree.create_node();
+  tree.set_local_position(node, math::Vec3f(0.F, 0.F, -10.F));
+  tree.update();
+  scene.bounds().set_local_bounds(node, Aabb::from_center_extent(math::Vec3f::filled(0.F), math::Vec3f::filled(0.5F)));
+  scene.bounds().refit(tree);
+  scene.renderers().insert(FlatTree::index_of(node), MeshRenderer{.mesh = 0, .material = 0});
+
+  auto snapshot = RenderSnapshot();
+  snapshot.extract(scene, test_view());
+
+  const auto meshes    = std::array{GPUMeshSurface{.index_count = 3}};
+  const auto materials = std::array{GPUMaterial{}};
+  auto jobs            = eray::util::JobSystem::create(2);
+  auto extractor       = RenderExtractor::create();
+  auto queue           = RenderQueue::create();
+  for (auto frame = 0; frame < 3; ++frame) {
+    queue.clear();
+    extractor.extract(*jobs, snapshot, meshes, materials, queue);
+    ASSERT_EQ(queue.draws().size(), 1U);
+    EXPECT_EQ(queue.draws()[0].first_instance, 0U);
+  }
+}
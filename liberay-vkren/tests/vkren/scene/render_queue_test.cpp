@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <liberay/vkren/scene/render_queue.hpp>
+#include <vector>
+
+using DrawOrder   = eray::vkren::DrawOrder;
+using DrawSortKey = eray::vkren::DrawSortKey;
+using RenderDraw  = eray::vkren::RenderDraw;
+using RenderQueue = eray::vkren::RenderQueue;
+
+namespace {
+
+/**
+ * @brief Distinct non-null handle, never passed to Vulkan.
+ *
+ */
+template <typename THandle>
+THandle fake_handle(uintptr_t value) {
+  using CType = typename THandle::CType;
+  return THandle(reinterpret_cast<CType>(value));  // NOLINT
+}
+
+RenderDraw test_draw(uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t instance) {
+  return RenderDraw{
+      .material =
+          {
+              .pipeline     = fake_handle<vk::Pipeline>(0x100 + pipeline),
+              .layout       = fake_handle<vk::PipelineLayout>(0x200),
+              .material_set = fake_handle<vk::DescriptorSet>(0x300 + material),
+          },
+      .surface =
+          {
+              .vertex_buffer = fake_handle<vk::Buffer>(0x400 + mesh),
+              .index_buffer  = fake_handle<vk::Buffer>(0x500 + mesh),
+              .first_index   = 0,
+              .index_count   = 3,
+          },
+      .first_instance = instance,
+  };
+}
+
+}  // namespace
+
+TEST(RenderQueueTest, KeysOrderByPassThenState) {
+  const auto a = DrawSortKey::pack(DrawOrder::StateFirst, 0, 1, 0, 0, 0);
+  const auto b = DrawSortKey::pack(DrawOrder::StateFirst, 0, 0, 5, 5, 100);
+  const auto c = DrawSortKey::pack(DrawOrder::StateFirst, 1, 0, 0, 0, 0);
+  EXPECT_LT(b, a);
+  EXPECT_LT(a, c);
+  EXPECT_EQ(DrawSortKey::pass_of(c), 1U);
+
+  const auto front = DrawSortKey::pack(DrawOrder::BackToFront, 2, 0, 0, 0, 10);
+  const auto back  = DrawSortKey::pack(DrawOrder::BackToFront, 2, 3, 0, 0, 20);
+  EXPECT_LT(back, front);
+  EXPECT_EQ(DrawSortKey::pass_of(front), 2U);
+}
+
+TEST(RenderQueueTest, SortGroupsDrawsByState) {
+  auto queue = RenderQueue::create();
+  queue.set_depth_range(0.F, 100.F);
+
+  // Interleaved pipelines, materials and meshes, the worst case for the submission order
+  constexpr auto kDraws = 512U;
+  for (auto i = 0U; i < kDraws; ++i) {
+    queue.push(0, test_draw(i % 4, i % 16, i % 8, i), static_cast<float>(kDraws - i) / 8.F);
+  }
+
+  queue.sort();
+  const auto stats = queue.stats(0);
+  EXPECT_EQ(stats.draws, kDraws);
+  EXPECT_EQ(stats.pipeline_binds, 4U);
+  EXPECT_EQ(stats.descriptor_binds, 16U);
+  EXPECT_LE(stats.geometry_binds, 32U);
+
+  auto previous = uint64_t{0};
+  for (const auto index : queue.sorted_draws()) {
+    EXPECT_LE(previous, queue.keys()[index]);
+    previous = queue.keys()[index];
+  }
+}
+
+TEST(RenderQueueTest, PassesAreRecordedSeparately) {
+  auto queue = RenderQueue::create();
+  queue.set_depth_range(0.F, 10.F);
+  queue.set_pass_order(1, DrawOrder::BackToFront);
+
+  queue.push(1, test_draw(0, 0, 0, 0), 1.F);
+  queue.push(0, test_draw(0, 0, 0, 1), 5.F);
+  queue.push(1, test_draw(1, 1, 1, 2), 9.F);
+  queue.push(1, test_draw(0, 0, 0, 3), 4.F);
+  queue.sort();
+
+  EXPECT_EQ(queue.stats(0).draws, 1U);
+  EXPECT_EQ(queue.stats(1).draws, 3U);
+  EXPECT_EQ(queue.stats(2).draws, 0U);
+
+  auto instances = std::vector<uint32_t>();
+  for (const auto index : queue.sorted_draws()) {
+    instances.push_back(queue.draws()[index].first_instance);
+  }
+  EXPECT_EQ(instances, (std::vector<uint32_t>{1, 2, 3, 0}));
+}
+
+TEST(RenderQueueTest, EqualKeysKeepPushOrder) {
+  auto queue = RenderQueue::create();
+  for (auto i = 0U; i < 4; ++i) {
+    queue.push(0, test_draw(0, 0, 0, i), 0.5F);
+  }
+  queue.sort();
+
+  auto instances = std::vector<uint32_t>();
+  for (const auto index : queue.sorted_draws()) {
+    instances.push_back(queue.draws()[index].first_instance);
+  }
+  EXPECT_EQ(instances, (std::vector<uint32_t>{0, 1, 2, 3}));
+  EXPECT_EQ(queue.stats(0).state_changes(), 3U);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/vkren/scene/camera.hpp>
+#include <liberay/vkren/scene/flat_tree.hpp>
+#include <liberay/vkren/scene/light.hpp>
+#include <liberay/vkren/scene/lod.hpp>
+#include <liberay/vkren/scene/render_snapshot.hpp>
+#include <liberay/vkren/scene/scene.hpp>
+#include <numbers>
+
+using Aabb                   = eray::vkren::Aabb;
+using Camera                 = eray::vkren::Camera;
+using FlatTree               = eray::vkren::FlatTree;
+using GpuLightType           = eray::vkren::GpuLightType;
+using Light                  = eray::vkren::Light;
+using LodView                = eray::vkren::LodView;
+using RenderSnapshotExchange = eray::vkren::RenderSnapshotExchange;
+using RenderView             = eray::vkren::RenderView;
+using Scene                  = eray::vkren::Scene;
+namespace math               = eray::math;
+
+namespace {
+
+constexpr float kFovY = std::numbers::pi_v<float> / 2.F;
+
+RenderView test_view() {
+  const auto camera = Camera{
+      .aspect_ratio = 1.F,
+      .near_plane   = 1.F,
+      .far_plane    = 1000.F,
+      .projection   = eray::vkren::PerspectiveCamera{.fov = kFovY},
+  };
+  return RenderView{
+      .view       = math::Mat4f::identity(),
+      .projection = math::perspective_vk_rh(kFovY, 1.F, 1.F, 1000.F),
+      .lod_view   = *LodView::create(camera, math::Vec3f::filled(0.F)),
+  };
+}
+
+}  // namespace
+
+TEST(RenderSnapshotTest, ExtractCopiesVisibleNodesAndWorldLights) {
+  auto scene = Scene::create(16);
+  auto& tree = scene.tree();
+
+  const auto visible_node = tree.create_node();
+  const auto hidden_node  = tree.create_node();
+  const auto light_node   = tree.create_node();
+  tree.set_local_position(visible_node, math::Vec3f(0.F, 0.F, -10.F));
+  tree.set_local_position(hidden_node, math::Vec3f(0.F, 0.F, 10.F));
+  tree.set_local_position(light_node, math::Vec3f(1.F, 2.F, -3.F));
+  tree.update();
+
+  const auto unit_box = Aabb::from_center_extent(math::Vec3f::filled(0.F), math::Vec3f::filled(0.5F));
+  scene.bounds().set_local_bounds(visible_node, unit_box);
+  scene.bounds().set_local_bounds(hidden_node, unit_box);
+  scene.bounds().refit(tree);
+
+  scene.lights().insert(FlatTree::index_of(light_node),
+                        Light{
+                            .color  = math::Vec3f::filled(1.F),
+                            .lights = eray::vkren::PointLight{.position = math::Vec3f::filled(0.F), .quadratic = 1.F},
+                        });
+
+  auto exchange = RenderSnapshotExchange();
+  exchange.write_buffer().extract(scene, test_view());
+  exchange.publish();
+
+  const auto& snapshot = exchange.read();
+  EXPECT_EQ(snapshot.tree_update, tree.update_count());
+  ASSERT_EQ(snapshot.visible_nodes.size(), 1U);
+  EXPECT_EQ(snapshot.visible_nodes[0], visible_node);
+  ASSERT_EQ(snapshot.world_matrices.size(), 1U);
+  EXPECT_EQ(snapshot.screen_sizes.size(), 1U);
+  EXPECT_FLOAT_EQ(snapshot.world_matrices[0][3][2], -10.F);
+
+  ASSERT_EQ(snapshot.lights.size(), 1U);
+  EXPECT_EQ(snapshot.directional_light_count, 0U);
+  EXPECT_EQ(snapshot.lights[0].type, GpuLightType::Point);
+  EXPECT_FLOAT_EQ(snapshot.lights[0].position.x(), 1.F);
+  EXPECT_FLOAT_EQ(snapshot.lights[0].position.y(), 2.F);
+  EXPECT_FLOAT_EQ(snapshot.lights[0].position.z(), -3.F);
+}
+
+TEST(RenderSnapshotTest, PublishedSnapshotOutlivesSceneChanges) {
+  auto scene = Scene::create(16);
+  auto& tree = scene.tree();
+
+  const auto node = tree.create_node();
+  tree.set_local_position(node, math::Vec3f(0.F, 0.F, -10.F));
+  tree.update();
+  scene.bounds().set_local_bounds(node, Aabb::from_center_extent(math::Vec3f::filled(0.F), math::Vec3f::filled(0.5F)));
+  scene.bounds().refit(tree);
+
+  auto exchange = RenderSnapshotExchange();
+  exchange.write_buffer().extract(scene, test_view());
+  exchange.publish();
+  const auto& frame = exchange.read();
+
+  // The update of the next frame moves the node out of the view and extracts again without publishing yet
+  tree.set_local_position(node, math::Vec3f(0.F, 0.F, 10.F));
+  tree.update();
+  scene.bounds().refit(tree);
+  exchange.write_buffer().extract(scene, test_view());
+
+  ASSERT_EQ(frame.visible_nodes.size(), 1U);
+  EXPECT_FLOAT_EQ(frame.world_matrices[0][3][2], -10.F);
+  EXPECT_FALSE(exchange.has_update());
+
+  exchange.publish();
+  const auto& next_frame = exchange.read();
+  EXPECT_TRUE(next_frame.visible_nodes.empty());
+  EXPECT_EQ(next_frame.tree_update, tree.update_count());
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <liberay/math/mat.hpp>
+#include <liberay/vkren/scene/dynamic_bvh.hpp>
+#include <liberay/vkren/scene/frustum.hpp>
+#include <liberay/vkren/scene/scene_bounds.hpp>
+#include <liberay/vkren/scene/transform_tree.hpp>
+#include <numbers>
+#include <tuple>
+#include <vector>
+
+using Aabb          = eray::vkren::Aabb;
+using BvhItem       = eray::vkren::BvhItem;
+using DynamicBvh    = eray::vkren::DynamicBvh;
+using Frustum       = eray::vkren::Frustum;
+using FrustumTest   = eray::vkren::FrustumTest;
+using NodeId        = eray::vkren::NodeId;
+using SceneBounds   = eray::vkren::SceneBounds;
+using TransformTree = eray::vkren::TransformTree;
+namespace math      = eray::math;
+
+namespace {
+
+/**
+ * @brief Camera at the origin looking down -Z with a 90 degree vertical FOV, near 1 and far 100.
+ *
+ */
+Frustum test_frustum() {
+  return Frustum::from_view_projection(math::perspective_vk_rh(std::numbers::pi_v<float> / 2.F, 1.F, 1.F, 100.F));
+}
+
+Aabb unit_box_at(float x, float y, float z) {
+  return Aabb::from_center_extent(math::Vec3f(x, y, z), math::Vec3f::filled(0.5F));
+}
+
+/**
+ * @brief Deterministic pseudo-random boxes scattered around the camera.
+ *
+ */
+std::vector<BvhItem> scattered_items(uint32_t count) {
+  auto items = std::vector<BvhItem>();
+  auto state = uint32_t{12345};
+  auto next  = [&state]() {
+    state = state * 1664525U + 1013904223U;
+    return static_cast<float>(state >> 8) / static_cast<float>(1U << 24);
+  };
+  for (auto n = 0U; n < count; ++n) {
+    const auto x = next() * 200.F - 100.F;
+    const auto y = next() * 200.F - 100.F;
+    const auto z = next() * 200.F - 100.F;
+    items.push_back(BvhItem{.box = unit_box_at(x, y, z), .value = n});
+  }
+  return items;
+}
+
+std::vector<uint32_t> brute_force_cull(const Frustum& frustum, const std::vector<BvhItem>& items, float margin) {
+  auto values = std::vector<uint32_t>();
+  for (const auto& item : items) {
+    if (frustum.intersects(item.box.expanded(margin))) {
+      values.push_back(item.value);
+    }
+  }
+  return values;
+}
+
+}  // namespace
+
+TEST(FrustumClassifyTest, ClassifiesBoxes) {
+  const auto frustum = test_frustum();
+
+  EXPECT_EQ(frustum.classify(unit_box_at(0.F, 0.F, -10.F)), FrustumTest::Inside);
+  EXPECT_EQ(frustum.classify(unit_box_at(0.F, 0.F, 10.F)), FrustumTest::Outside);
+  EXPECT_EQ(frustum.classify(unit_box_at(0.F, 0.F, -200.F)), FrustumTest::Outside);
+  EXPECT_EQ(frustum.classify(unit_box_at(30.F, 0.F, -10.F)), FrustumTest::Outside);
+  EXPECT_EQ(frustum.classify(unit_box_at(0.F, 0.F, -1.F)), FrustumTest::Intersecting);
+  EXPECT_EQ(frustum.classify(unit_box_at(10.F, 0.F, -10.F)), FrustumTest::Intersecting);
+}
+
+TEST(DynamicBvhTest, InsertedTreeCullsLikeBruteForce) {
+  const auto frustum = test_frustum();
+  const auto items   = scattered_items(500);
+
+  auto bvh = DynamicBvh::create(0.F);
+  for (const auto& item : items) {
+    std::ignore = bvh.insert(item.value, item.box);
+  }
+  EXPECT_EQ(bvh.leaf_count(), items.size());
+
+  auto culled = std::vector<uint32_t>();
+  bvh.cull(frustum, culled);
+  std::ranges::sort(culled);
+  EXPECT_EQ(culled, brute_force_cull(frustum, items, 0.F));
+  EXPECT_FALSE(culled.empty());
+  EXPECT_LT(culled.size(), items.size());
+}
+
+TEST(DynamicBvhTest, BuiltTreeCullsLikeBruteForce) {
+  const auto frustum = test_frustum();
+  const auto items   = scattered_items(500);
+
+  auto bvh    = DynamicBvh::create(0.F);
+  auto leaves = std::vector<uint32_t>(items.size());
+  bvh.build(items, leaves);
+  EXPECT_EQ(bvh.leaf_count(), items.size());
+  for (auto n = 0U; n < items.size(); ++n) {
+    EXPECT_EQ(bvh.value(leaves[n]), items[n].value);
+  }
+  EXPECT_LT(bvh.height(), 32U);
+
+  auto culled = std::vector<uint32_t>();
+  bvh.cull(frustum, culled);
+  std::ranges::sort(culled);
+  EXPECT_EQ(culled, brute_force_cull(frustum, items, 0.F));
+}
+
+TEST(DynamicBvhTest, UpdateAndRemoveKeepCullingCorrect) {
+  const auto frustum = test_frustum();
+  auto items         = scattered_items(200);
+
+  auto bvh    = DynamicBvh::create(0.5F);
+  auto leaves = std::vector<uint32_t>();
+  for (const auto& item : items) {
+    leaves.push_back(bvh.insert(item.value, item.box));
+  }
+
+  // Small moves stay within the fat boxes, large moves reinsert the leaves
+  EXPECT_FALSE(bvh.update(leaves[0], Aabb::from_center_extent(items[0].box.center() + math::Vec3f(0.2F, 0.F, 0.F),
+                                                               math::Vec3f::filled(0.5F))));
+  for (auto n = 0U; n < items.size(); n += 2) {
+    items[n].box = unit_box_at(0.F, 0.F, -5.F - static_cast<float>(n) * 0.1F);
+    EXPECT_TRUE(bvh.update(leaves[n], items[n].box));
+  }
+  for (auto n = 1U; n < items.size(); n += 4) {
+    bvh.remove(leaves[n]);
+  }
+  std::erase_if(items, [](const BvhItem& item) { return item.value % 4 == 1; });
+  EXPECT_EQ(bvh.leaf_count(), items.size());
+
+  auto culled = std::vector<uint32_t>();
+  bvh.cull(frustum, culled);
+  std::ranges::sort(culled);
+  EXPECT_EQ(culled, brute_force_cull(frustum, items, 0.5F));
+}
+
+TEST(SceneBoundsTest, RefitFollowsWorldMatrices) {
+  const auto frustum = test_frustum();
+
+  auto tree   = TransformTree::create(16);
+  auto bounds = SceneBounds::create(16, 0.F);
+
+  const auto parent  = tree.create_node();
+  const auto visible = tree.create_node(parent);
+  const auto hidden  = tree.create_node(parent);
+  tree.set_local_position(visible, math::Vec3f(0.F, 0.F, -10.F));
+  tree.set_local_position(hidden, math::Vec3f(0.F, 0.F, 10.F));
+  tree.update();
+
+  bounds.set_local_bounds(visible, unit_box_at(0.F, 0.F, 0.F));
+  bounds.set_local_bounds(hidden, unit_box_at(0.F, 0.F, 0.F));
+  bounds.refit(tree);
+
+  auto culled = std::vector<NodeId>();
+  bounds.cull(frustum, culled);
+  EXPECT_EQ(culled, std::vector<NodeId>{visible});
+
+  // Moving the parent moves the boxes of both children
+  tree.set_local_position(parent, math::Vec3f(0.F, 0.F, -20.F));
+  tree.update();
+  bounds.refit(tree);
+  EXPECT_NEAR(bounds.world_bounds(hidden).center().z(), -10.F, 1e-5F);
+
+  culled.clear();
+  bounds.cull(frustum, culled);
+  std::ranges::sort(culled);
+  auto expected = std::vector<NodeId>{visible, hidden};
+  std::ranges::sort(expected);
+  EXPECT_EQ(culled, expected);
+
+  bounds.remove_bounds(visible);
+  EXPECT_FALSE(bounds.has_bounds(visible));
+  culled.clear();
+  bounds.cull(frustum, culled);
+  EXPECT_EQ(culled, std::vector<NodeId>{hidden});
+}
+
+TEST(SceneBoundsTest, RebuildMatchesIncrementalRefit) {
+  const auto frustum = test_frustum();
+  const auto items   = scattered_items(100);
+
+  auto tree   = TransformTree::create(128);
+  auto bounds = SceneBounds::create(128);
+  auto nodes  = std::vector<NodeId>();
+  for (const auto& item : items) {
+    const auto node = tree.create_node();
+    tree.set_local_position(node, item.box.center());
+    bounds.set_local_bounds(node, unit_box_at(0.F, 0.F, 0.F));
+    nodes.push_back(node);
+  }
+  tree.update();
+  bounds.refit(tree);
+
+  auto incremental = std::vector<NodeId>();
+  bounds.cull(frustum, incremental);
+  std::ranges::sort(incremental);
+
+  bounds.rebuild(tree);
+  auto rebuilt = std::vector<NodeId>();
+  bounds.cull(frustum, rebuilt);
+  std::ranges::sort(rebuilt);
+
+  EXPECT_EQ(incremental, rebuilt);
+  EXPECT_EQ(bounds.bvh().leaf_count(), nodes.size());
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <liberay/vkren/scene/scene_snapshot.hpp>
+#include <vector>
+
+using Scene         = eray::vkren::Scene;
+using SceneSnapshot = eray::vkren::SceneSnapshot;
+using FlatTree      = eray::vkren::FlatTree;
+using Transform     = eray::vkren::Transform;
+using Camera        = eray::vkren::Camera;
+using Light         = eray::vkren::Light;
+using MeshRenderer  = eray::vkren::MeshRenderer;
+using NodeId        = eray::vkren::NodeId;
+namespace math      = eray::math;
+
+namespace {
+
+/**
+ * @brief root -> {a -> {c}, b}, the node d is deleted, so the snapshot must compact the indices.
+ *
+ */
+Scene create_scene() {
+  auto scene = Scene::create(16);
+  auto& tree = scene.tree();
+
+  const auto a = tree.create_node();
+  const auto d = tree.create_node();
+  const auto b = tree.create_node();
+  const auto c = tree.create_node(a);
+  tree.delete_node(d);
+
+  tree.set_name(a, "a");
+  tree.set_name(b, "b");
+  tree.set_name(c, "c");
+  tree.set_local_transform(a, Transform{.position = math::Vec3f(1.F, 2.F, 3.F)});
+  tree.set_local_transform(c, Transform{.scale = math::Vec3f(2.F, 2.F, 2.F)});
+
+  scene.cameras().insert(FlatTree::index_of(b), Camera{.near_plane = 0.1F, .far_plane = 100.F});
+  scene.renderers().insert(FlatTree::index_of(c), MeshRenderer{.mesh = 7, .material = 3});
+  return scene;
+}
+
+NodeId node_at(size_t preorder_index) { return eray::vkren::EntityPool<NodeId>::compose_id(preorder_index, 0); }
+
+}  // namespace
+
+TEST(SceneSnapshotTest, RoundTripKeepsHierarchyNamesTransformsAndComponents) {
+  const auto scene = create_scene();
+  auto snapshot    = SceneSnapshot::create(SceneSnapshot::serialize(scene));
+  ASSERT_TRUE(snapshot.has_value());
+  EXPECT_EQ(snapshot->node_count(), 4U);
+  EXPECT_EQ(snapshot->max_nodes_count(), 16U);
+
+  auto loaded       = snapshot->instantiate();
+  const auto& tree  = loaded.tree();
+  const auto& flat  = tree.flat_tree();
+  const auto& order = flat.nodes_dfs_preorder();
+  ASSERT_EQ(order.size(), 4U);
+  for (auto i = size_t{0}; i < order.size(); ++i) {
+    EXPECT_EQ(order[i], node_at(i));
+  }
+
+  // Preorder: root, a, c, b
+  EXPECT_EQ(tree.name(node_at(1)), "a");
+  EXPECT_EQ(tree.name(node_at(2)), "c");
+  EXPECT_EQ(tree.name(node_at(3)), "b");
+  EXPECT_EQ(flat.node_surrounding_info(node_at(2)).parent_id, node_at(1));
+  EXPECT_EQ(flat.node_surrounding_info(node_at(3)).parent_id, FlatTree::kRootNodeId);
+  EXPECT_EQ(flat.node_level(node_at(2)), 2U);
+  EXPECT_EQ(flat.subtree_size(node_at(1)), 2U);
+
+  EXPECT_FLOAT_EQ(tree.local_transform(node_at(1)).position.y(), 2.F);
+  EXPECT_FLOAT_EQ(tree.local_transform(node_at(2)).scale.x(), 2.F);
+
+  ASSERT_TRUE(loaded.cameras().contains_key(3));
+  EXPECT_FLOAT_EQ(loaded.cameras().at<Camera>(3).far_plane, 100.F);
+  ASSERT_TRUE(loaded.renderers().contains_key(2));
+  EXPECT_EQ(loaded.renderers().at<MeshRenderer>(2).mesh, 7U);
+  EXPECT_EQ(loaded.lights().size(), 0U);
+
+  // The loaded scene accepts new nodes after the loaded ones
+  const auto e = loaded.tree().create_node(node_at(3));
+  EXPECT_EQ(FlatTree::index_of(e), 4U);
+}
+
+TEST(SceneSnapshotTest, InstantiateWithLargerCapacity) {
+  auto snapshot = SceneSnapshot::create(SceneSnapshot::serialize(create_scene()));
+  ASSERT_TRUE(snapshot.has_value());
+
+  auto loaded = snapshot->instantiate(64);
+  EXPECT_EQ(loaded.tree().max_nodes_count(), 64U);
+  EXPECT_EQ(loaded.tree().flat_tree().node_count(), 4U);
+}
+
+TEST(SceneSnapshotTest, RejectsInvalidBytes) {
+  auto bytes = SceneSnapshot::serialize(create_scene());
+
+  auto truncated = std::vector<std::byte>(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(bytes.size() / 2));
+  EXPECT_FALSE(SceneSnapshot::create(std::move(truncated)).has_value());
+
+  auto bad_magic = bytes;
+  bad_magic[0]   = std::byte{'X'};
+  EXPECT_FALSE(SceneSnapshot::create(std::move(bad_magic)).has_value());
+
+  EXPECT_FALSE(SceneSnapshot::create(std::vector<std::byte>(8)).has_value());
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/scene/shading_rate.hpp>
+
+using ShadingRate           = eray::vkren::ShadingRate;
+using ShadingRateBudget     = eray::vkren::ShadingRateBudget;
+using ShadingRateBudgetInfo = eray::vkren::ShadingRateBudgetInfo;
+using ShadingRateParams     = eray::vkren::ShadingRateParams;
+using Vec2f                 = eray::math::Vec2f;
+
+TEST(ShadingRateTest, FlatTilesAreShadedAtLowerRates) {
+  const auto params = ShadingRateParams{};
+  const auto center = Vec2f(0.5F, 0.5F);
+
+  // Standard deviation 0.1 of the mean 0.5 is a contrast of about 0.18
+  EXPECT_EQ(eray::vkren::select_shading_rate(params, 0.5F, 0.01F, center), ShadingRate::Rate1x1);
+  EXPECT_EQ(eray::vkren::select_shading_rate(params, 0.5F, 0.0001F, center), ShadingRate::Rate2x2);
+  EXPECT_EQ(eray::vkren::select_shading_rate(params, 0.5F, 0.F, center), ShadingRate::Rate4x4);
+
+  auto clamped     = params;
+  clamped.max_rate = ShadingRate::Rate2x2;
+  EXPECT_EQ(eray::vkren::select_shading_rate(clamped, 0.5F, 0.F, center), ShadingRate::Rate2x2);
+
+  auto periphery_only          = params;
+  periphery_only.use_luminance = false;
+  EXPECT_EQ(eray::vkren::select_shading_rate(periphery_only, 0.5F, 0.F, center), ShadingRate::Rate1x1);
+}
+
+TEST(ShadingRateTest, PeripheryIsCoarsenedRegardlessOfDetail) {
+  auto params                = ShadingRateParams{};
+  params.half_rate_radius    = 0.25F;
+  params.quarter_rate_radius = 0.45F;
+
+  EXPECT_EQ(eray::vkren::select_shading_rate(params, 0.5F, 0.01F, Vec2f(0.6F, 0.5F)), ShadingRate::Rate1x1);
+  EXPECT_EQ(eray::vkren::select_shading_rate(params, 0.5F, 0.01F, Vec2f(0.8F, 0.5F)), ShadingRate::Rate2x2);
+  EXPECT_EQ(eray::vkren::select_shading_rate(params, 0.5F, 0.01F, Vec2f(1.F, 1.F)), ShadingRate::Rate4x4);
+
+  // A flat tile in the inner periphery keeps its coarser rate
+  EXPECT_EQ(eray::vkren::select_shading_rate(params, 0.5F, 0.F, Vec2f(0.8F, 0.5F)), ShadingRate::Rate4x4);
+}
+
+TEST(ShadingRateTest, BudgetCoarsensOverTheTargetAndRecovers) {
+  auto budget = ShadingRateBudget::create(ShadingRateBudgetInfo{
+      .target_gpu_time_ms = 10.0,
+      .smoothing          = 1.0,
+      .settle_frame_count = 0,
+  });
+  EXPECT_EQ(budget.coarsening(), 0.F);
+  EXPECT_EQ(budget.params().half_rate_radius, ShadingRateParams::kNoPeriphery);
+
+  for (auto i = 0; i < 20; ++i) {
+    budget.update(20.0);
+  }
+  EXPECT_EQ(budget.coarsening(), 1.F);
+  EXPECT_FLOAT_EQ(budget.params().half_rate_radius, budget.info().min_half_rate_radius);
+  EXPECT_FLOAT_EQ(budget.params().half_rate_contrast,
+                  budget.info().quality.half_rate_contrast * budget.info().max_contrast_scale);
+
+  // Within the headroom band the coarsening stays
+  budget.update(9.5);
+  EXPECT_EQ(budget.coarsening(), 1.F);
+
+  for (auto i = 0; i < 20; ++i) {
+    budget.update(5.0);
+  }
+  EXPECT_EQ(budget.coarsening(), 0.F);
+}
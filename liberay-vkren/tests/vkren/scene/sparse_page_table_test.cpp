@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <liberay/vkren/scene/sparse_page_table.hpp>
+#include <vector>
+
+using SparsePageTable  = eray::vkren::SparsePageTable;
+using SparsePageUpdate = eray::vkren::SparsePageUpdate;
+using SparseTile       = eray::vkren::SparseTile;
+
+namespace {
+
+std::vector<SparsePageUpdate> apply(SparsePageTable& table) {
+  auto updates = std::vector<SparsePageUpdate>();
+  for (const auto& update : table.update()) {
+    updates.push_back(update);
+    if (update.bind) {
+      table.complete(update.texture, update.tile);
+    }
+  }
+  return updates;
+}
+
+}  // namespace
+
+TEST(SparsePageTableTest, RequestedCellBindsItsTilesAndTheCoarserOnes) {
+  auto table = SparsePageTable::create({.page_count = 64});
+
+  // 512x512 texels of 128x128 tiles: 4x4, 2x2 and 1x1 tiles, then the mip tail
+  const auto id = table.add(512, 512, 128, 128, 3);
+  EXPECT_EQ(table.cells_x(id), 4U);
+  EXPECT_EQ(table.cells_y(id), 4U);
+  EXPECT_EQ(table.cell_resident_mip(id, 0, 0), 3U);
+  EXPECT_TRUE(table.update().empty());
+
+  table.request(id, 3, 1, 0);
+  const auto updates = apply(table);
+  ASSERT_EQ(updates.size(), 3U);
+  EXPECT_EQ(updates[0].tile, (SparseTile{.mip = 2, .x = 0, .y = 0}));
+  EXPECT_EQ(updates[1].tile, (SparseTile{.mip = 1, .x = 1, .y = 0}));
+  EXPECT_EQ(updates[2].tile, (SparseTile{.mip = 0, .x = 3, .y = 1}));
+  for (const auto& update : updates) {
+    EXPECT_TRUE(update.bind);
+    EXPECT_EQ(table.page_of(id, update.tile), update.page);
+  }
+  EXPECT_EQ(table.free_page_count(), 61U);
+
+  EXPECT_EQ(table.cell_resident_mip(id, 3, 1), 0U);
+  EXPECT_EQ(table.cell_resident_mip(id, 2, 1), 1U);
+  EXPECT_EQ(table.cell_resident_mip(id, 0, 3), 2U);
+
+  auto mips = std::vector<uint32_t>(16);
+  table.write_resident_mips(id, mips);
+  EXPECT_EQ(mips[1 * 4 + 3], 0U);
+  EXPECT_EQ(mips[0], 2U);
+}
+
+TEST(SparsePageTableTest, PendingTilesDoNotCountAsResident) {
+  auto table    = SparsePageTable::create({.page_count = 8});
+  const auto id = table.add(256, 256, 128, 128, 1);
+
+  table.request_all(id, 0);
+  const auto updates = table.update();
+  ASSERT_EQ(updates.size(), 4U);
+  EXPECT_EQ(table.cell_resident_mip(id, 0, 0), 1U);
+
+  const auto tile = updates[0].tile;
+  table.complete(id, tile);
+  EXPECT_TRUE(table.is_resident(id, tile));
+  EXPECT_EQ(table.cell_resident_mip(id, tile.x, tile.y), 0U);
+}
+
+TEST(SparsePageTableTest, BindsAreLimitedPerUpdate) {
+  auto table    = SparsePageTable::create({.page_count = 64, .max_binds_per_update = 2});
+  const auto id = table.add(512, 512, 128, 128, 1);
+
+  table.request_all(id, 0);
+  EXPECT_EQ(apply(table).size(), 2U);
+
+  // The tiles that were not bound are requested again by the next feedback
+  table.request_all(id, 0);
+  EXPECT_EQ(apply(table).size(), 2U);
+  EXPECT_EQ(table.free_page_count(), 60U);
+}
+
+TEST(SparsePageTableTest, LeastRecentlyRequestedTilesAreEvictedAndTheirPagesReusedLater) {
+  auto table    = SparsePageTable::create({.page_count = 2, .page_reuse_delay = 2});
+  const auto id = table.add(512, 128, 128, 128, 1);
+
+  table.request(id, 0, 0, 0);
+  table.request(id, 1, 0, 0);
+  EXPECT_EQ(apply(table).size(), 2U);
+
+  // Tile 0 stays requested, tile 1 becomes the least recently requested one
+  table.request(id, 0, 0, 0);
+  apply(table);
+  table.request(id, 0, 0, 0);
+  table.request(id, 2, 0, 0);
+  auto updates = apply(table);
+  ASSERT_EQ(updates.size(), 1U);
+  EXPECT_FALSE(updates[0].bind);
+  EXPECT_EQ(updates[0].tile, (SparseTile{.mip = 0, .x = 1, .y = 0}));
+  EXPECT_EQ(table.page_of(id, SparseTile{.mip = 0, .x = 1, .y = 0}), SparsePageTable::kNoPage);
+  EXPECT_EQ(table.free_page_count(), 0U);
+
+  // The evicted page is quarantined for the frames in flight
+  table.request(id, 0, 0, 0);
+  table.request(id, 2, 0, 0);
+  EXPECT_TRUE(apply(table).empty());
+
+  table.request(id, 0, 0, 0);
+  table.request(id, 2, 0, 0);
+  updates = apply(table);
+  ASSERT_EQ(updates.size(), 1U);
+  EXPECT_TRUE(updates[0].bind);
+  EXPECT_EQ(updates[0].tile, (SparseTile{.mip = 0, .x = 2, .y = 0}));
+  EXPECT_TRUE(table.is_resident(id, SparseTile{.mip = 0, .x = 0, .y = 0}));
+}
+
+TEST(SparsePageTableTest, RemovedTexturesReturnTheirPages) {
+  auto table    = SparsePageTable::create({.page_count = 4, .page_reuse_delay = 1});
+  const auto id = table.add(256, 256, 128, 128, 1);
+  table.request_all(id, 0);
+  apply(table);
+  EXPECT_EQ(table.free_page_count(), 0U);
+
+  table.remove(id);
+  apply(table);
+  apply(table);
+  EXPECT_EQ(table.free_page_count(), 4U);
+}
@@ -114,3 +114,76 @@ TEST(SparseSetTest, KeyValueIteration) {
   EXPECT_NE(std::ranges::find(strs, "foo"), strs.end());
   EXPECT_NE(std::ranges::find(strs, "bar"), strs.end());
 }
+
+TEST(SparseSetTest, PagesAllocatedOnDemand) {
+  auto set = TestSparseSet::create(10'000'000);
+  EXPECT_EQ(set.allocated_page_count(), 0);
+
+  set.insert(9'999'999, std::string("far"), 1.0);
+  set.insert(9'999'998, std::string("near far"), 2.0);
+  set.insert(3, std::string("first page"), 3.0);
+  EXPECT_EQ(set.allocated_page_count(), 2);
+  EXPECT_FALSE(set.contains_key(9'999'997));
+  EXPECT_FALSE(set.contains_key(5'000'000));
+  EXPECT_EQ(set.at<std::string>(9'999'999), "far");
+  EXPECT_EQ(set.at<std::string>(3), "first page");
+
+  set.remove(9'999'999);
+  EXPECT_EQ(set.allocated_page_count(), 2);
+  EXPECT_EQ(set.at<std::string>(9'999'998), "near far");
+
+  set.remove(9'999'998);
+  EXPECT_EQ(set.allocated_page_count(), 1);
+  EXPECT_FALSE(set.contains_key(9'999'998));
+  EXPECT_EQ(set.at<std::string>(3), "first page");
+}
+
+TEST(SparseSetTest, ReorderStepSortsWithinBudget) {
+  auto set = TestSparseSet::create(16);
+  for (auto key : {7, 2, 9, 4, 1, 8, 3}) {
+    set.insert(key, std::to_string(key), key * 0.5);
+  }
+  set.remove(2);
+  set.remove(4);
+
+  const auto identity = [](int key) { return key; };
+  auto calls          = 0;
+  while (!set.reorder_step(identity, 2)) {
+    ++calls;
+  }
+  EXPECT_EQ(calls, 2);
+  EXPECT_FALSE(set.is_reordering());
+
+  const auto keys = set.keys();
+  EXPECT_TRUE(std::ranges::is_sorted(keys));
+  EXPECT_EQ(keys.size(), 5);
+  for (auto i = size_t{0}; i < keys.size(); ++i) {
+    EXPECT_EQ(set.values<std::string>()[i], std::to_string(keys[i]));
+    EXPECT_DOUBLE_EQ(set.at<double>(keys[i]), keys[i] * 0.5);
+    EXPECT_EQ(set.dense_index(keys[i]), static_cast<int>(i));
+  }
+
+  // Already sorted, nothing to do
+  EXPECT_TRUE(set.reorder_step(identity, 0));
+}
+
+TEST(SparseSetTest, RemovalCancelsReorder) {
+  auto set = TestSparseSet::create(16);
+  for (auto key : {5, 4, 3, 2, 1}) {
+    set.insert(key, std::to_string(key), 0.0);
+  }
+
+  const auto identity = [](int key) { return key; };
+  EXPECT_FALSE(set.reorder_step(identity, 1));
+  EXPECT_TRUE(set.is_reordering());
+
+  set.remove(3);
+  EXPECT_FALSE(set.is_reordering());
+  set.insert(0, std::string("0"), 0.0);
+
+  while (!set.reorder_step(identity, 1)) {
+  }
+  EXPECT_TRUE(std::ranges::is_sorted(set.keys()));
+  EXPECT_EQ(set.keys().size(), 5);
+  EXPECT_EQ(set.at<std::string>(4), "4");
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <liberay/vkren/scene/sparse_set.hpp>
+#include <liberay/vkren/scene/sparse_set_view.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+using NameSet     = eray::vkren::SparseSet<int, std::string>;
+using PositionSet = eray::vkren::SparseSet<int, float>;
+using MassSet     = eray::vkren::SparseSet<int, double>;
+using TestGroup   = eray::vkren::SparseSetGroup<NameSet, PositionSet, MassSet>;
+
+TEST(SparseSetViewTest, JoinsKeysPresentInAllSets) {
+  auto names     = NameSet::create(10);
+  auto positions = PositionSet::create(10);
+  auto masses    = MassSet::create(10);
+  for (auto key = 0; key < 10; ++key) {
+    names.insert(key, std::to_string(key));
+    positions.insert(key, static_cast<float>(key));
+  }
+  masses.insert(7, 70.0);
+  masses.insert(2, 20.0);
+  masses.insert(11, 110.0);
+
+  auto view = eray::vkren::view(std::as_const(names), positions, std::as_const(masses));
+  EXPECT_EQ(view.size_hint(), 3U);
+
+  auto keys = std::vector<int>();
+  view.each([&keys](int key, const std::string& name, float& position, double mass) {
+    EXPECT_EQ(name, std::to_string(key));
+    EXPECT_DOUBLE_EQ(mass, key * 10.0);
+    position += 0.5F;
+    keys.push_back(key);
+  });
+
+  // The keys come in the dense order of the smallest set
+  EXPECT_EQ(keys, (std::vector<int>{7, 2}));
+  EXPECT_FLOAT_EQ(positions.at<float>(7), 7.5F);
+  EXPECT_FLOAT_EQ(positions.at<float>(3), 3.F);
+}
+
+TEST(SparseSetViewTest, GroupKeepsJoinedKeysInLockstep) {
+  auto group = TestGroup::create(10);
+  for (auto key = 0; key < 6; ++key) {
+    group.insert<0>(key, std::to_string(key));
+    group.insert<1>(key, static_cast<float>(key));
+  }
+  EXPECT_EQ(group.size(), 0U);
+
+  group.insert<2>(4, 40.0);
+  group.insert<2>(1, 10.0);
+  group.insert<2>(5, 50.0);
+  EXPECT_EQ(group.size(), 3U);
+
+  group.remove<1>(1);
+  EXPECT_EQ(group.size(), 2U);
+  EXPECT_FALSE(group.set<1>().contains_key(1));
+  EXPECT_TRUE(group.set<2>().contains_key(1));
+
+  auto keys = std::vector<int>(group.keys().begin(), group.keys().end());
+  std::ranges::sort(keys);
+  EXPECT_EQ(keys, (std::vector<int>{4, 5}));
+
+  // Every set holds the group at the front of its dense arrays in the same order
+  for (auto i = 0U; i < group.size(); ++i) {
+    EXPECT_EQ(group.set<0>().keys()[i], group.keys()[i]);
+    EXPECT_EQ(group.set<1>().keys()[i], group.keys()[i]);
+    EXPECT_EQ(group.set<2>().keys()[i], group.keys()[i]);
+  }
+
+  auto visited = 0U;
+  group.each([&visited](int key, const std::string& name, float& position, double& mass) {
+    EXPECT_EQ(name, std::to_string(key));
+    EXPECT_FLOAT_EQ(position, static_cast<float>(key));
+    EXPECT_DOUBLE_EQ(mass, key * 10.0);
+    mass = 0.0;
+    ++visited;
+  });
+  EXPECT_EQ(visited, 2U);
+  EXPECT_DOUBLE_EQ(group.set<2>().at<double>(5), 0.0);
+  EXPECT_DOUBLE_EQ(group.set<2>().at<double>(1), 10.0);
+
+  group.insert<1>(1, 1.F);
+  EXPECT_EQ(group.size(), 3U);
+  EXPECT_FLOAT_EQ((group.at<1, float>(1)), 1.F);
+}
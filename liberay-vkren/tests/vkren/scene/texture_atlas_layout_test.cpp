@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <liberay/vkren/scene/texture_atlas_layout.hpp>
+#include <optional>
+#include <vector>
+
+using AtlasRect          = eray::vkren::AtlasRect;
+using TextureAtlasLayout = eray::vkren::TextureAtlasLayout;
+
+namespace {
+
+bool overlap(const AtlasRect& a, const AtlasRect& b, uint32_t padding) {
+  return a.layer == b.layer && a.x < b.x + b.width + 2 * padding && b.x < a.x + a.width + 2 * padding &&
+         a.y < b.y + b.height + 2 * padding && b.y < a.y + a.height + 2 * padding;
+}
+
+}  // namespace
+
+TEST(TextureAtlasLayoutTest, PacksTexturesInShelves) {
+  auto layout = TextureAtlasLayout::create({.width = 64, .height = 64, .max_layers = 1, .guard_border = 1});
+  EXPECT_EQ(layout.padding(), 1U);
+
+  const auto first  = layout.allocate(14, 14);
+  const auto second = layout.allocate(14, 12);
+  ASSERT_TRUE(first && second);
+  EXPECT_EQ(*first, (AtlasRect{.layer = 0, .x = 1, .y = 1, .width = 14, .height = 14}));
+
+  // Both fit the first shelf
+  EXPECT_EQ(*second, (AtlasRect{.layer = 0, .x = 17, .y = 1, .width = 14, .height = 12}));
+
+  // Much smaller textures get a shelf of their own
+  const auto small = layout.allocate(4, 4);
+  ASSERT_TRUE(small);
+  EXPECT_EQ(small->y, 17U);
+  EXPECT_EQ(layout.layer_count(), 1U);
+  EXPECT_EQ(layout.allocation_count(), 3U);
+}
+
+TEST(TextureAtlasLayoutTest, SlotsAreAlignedForTheMipLevels) {
+  auto layout = TextureAtlasLayout::create({.width = 256, .height = 256, .guard_border = 1, .mip_levels = 3});
+  EXPECT_EQ(layout.alignment(), 4U);
+  EXPECT_EQ(layout.padding(), 4U);
+
+  auto rects = std::vector<AtlasRect>();
+  for (auto size = 1U; size <= 20; ++size) {
+    const auto rect = layout.allocate(size, 21 - size);
+    ASSERT_TRUE(rect);
+    rects.push_back(*rect);
+  }
+
+  for (auto i = 0U; i < rects.size(); ++i) {
+    // The texel (x >> 2, y >> 2) of the coarsest level belongs to a single slot
+    EXPECT_EQ(rects[i].x % 4, 0U);
+    EXPECT_EQ(rects[i].y % 4, 0U);
+    for (auto j = i + 1; j < rects.size(); ++j) {
+      EXPECT_FALSE(overlap(rects[i], rects[j], layout.padding())) << i << " " << j;
+    }
+  }
+}
+
+TEST(TextureAtlasLayoutTest, OpensLayersUntilTheLimit) {
+  auto layout = TextureAtlasLayout::create({.width = 32, .height = 32, .max_layers = 2, .guard_border = 0});
+
+  for (auto i = 0U; i < 8; ++i) {
+    const auto rect = layout.allocate(16, 16);
+    ASSERT_TRUE(rect);
+    EXPECT_EQ(rect->layer, i / 4);
+  }
+  EXPECT_EQ(layout.layer_count(), 2U);
+  EXPECT_FLOAT_EQ(layout.occupancy(), 1.F);
+  EXPECT_EQ(layout.allocate(1, 1), std::nullopt);
+
+  layout.reset();
+  EXPECT_EQ(layout.layer_count(), 0U);
+  EXPECT_TRUE(layout.allocate(16, 16));
+}
+
+TEST(TextureAtlasLayoutTest, RejectsTexturesLargerThanALayer) {
+  auto layout = TextureAtlasLayout::create({.width = 64, .height = 64, .guard_border = 1});
+
+  EXPECT_EQ(layout.allocate(63, 8), std::nullopt);
+  EXPECT_EQ(layout.allocate(0, 8), std::nullopt);
+  EXPECT_TRUE(layout.allocate(62, 62));
+}
+
+TEST(TextureAtlasLayoutTest, UvRectCoversTheTexels) {
+  auto layout     = TextureAtlasLayout::create({.width = 64, .height = 32, .guard_border = 0});
+  const auto rect = layout.allocate(16, 8);
+  ASSERT_TRUE(rect);
+
+  const auto uv = layout.uv_rect(*rect);
+  EXPECT_FLOAT_EQ(uv.x(), 0.F);
+  EXPECT_FLOAT_EQ(uv.y(), 0.F);
+  EXPECT_FLOAT_EQ(uv.z(), 0.25F);
+  EXPECT_FLOAT_EQ(uv.w(), 0.25F);
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <liberay/vkren/scene/texture_residency.hpp>
+#include <vector>
+
+using ResidencyChange   = eray::vkren::ResidencyChange;
+using StreamedTextureId = eray::vkren::StreamedTextureId;
+using TextureResidency  = eray::vkren::TextureResidency;
+
+namespace {
+
+/**
+ * @brief Mip chain of a square RGBA8 texture, 1024x1024 down to 1x1.
+ *
+ */
+std::vector<uint64_t> mip_sizes() {
+  auto sizes = std::vector<uint64_t>();
+  for (auto size = uint64_t{1024}; size > 0; size /= 2) {
+    sizes.push_back(size * size * 4);
+  }
+  return sizes;
+}
+
+std::vector<ResidencyChange> apply(TextureResidency& residency, bool memory_pressure = false) {
+  auto changes = std::vector<ResidencyChange>();
+  for (const auto& change : residency.update(memory_pressure)) {
+    changes.push_back(change);
+    residency.complete(change.id);
+  }
+  return changes;
+}
+
+}  // namespace
+
+TEST(TextureResidencyTest, MipForScreenSizeMatchesTexelsToPixels) {
+  EXPECT_NEAR(eray::vkren::mip_for_screen_size(1024, 1.F, 1024), 0.F, 1e-5F);
+  EXPECT_NEAR(eray::vkren::mip_for_screen_size(1024, 0.25F, 1024), 2.F, 1e-5F);
+  EXPECT_NEAR(eray::vkren::mip_for_screen_size(1024, 4.F, 1024), 0.F, 1e-5F);
+  EXPECT_TRUE(std::isinf(eray::vkren::mip_for_screen_size(1024, 0.F, 1024)));
+}
+
+TEST(TextureResidencyTest, TexturesStartWithTheTailAndLoadRequestedLevels) {
+  const auto sizes = mip_sizes();
+  auto residency   = TextureResidency::create({});
+  const auto id    = residency.add(sizes, 4);
+  EXPECT_EQ(residency.resident_mip(id), 4U);
+  EXPECT_EQ(residency.committed_bytes(), residency.size_bytes(id, 4));
+  EXPECT_TRUE(residency.update().empty());
+
+  residency.request(id, 3);
+  residency.request(id, 1);
+  const auto changes = residency.update();
+  ASSERT_EQ(changes.size(), 1U);
+  EXPECT_EQ(changes[0].id, id);
+  EXPECT_EQ(changes[0].first_mip, 1U);
+  EXPECT_TRUE(residency.is_pending(id));
+  EXPECT_EQ(residency.resident_mip(id), 4U);
+  EXPECT_EQ(residency.committed_bytes(), residency.size_bytes(id, 1));
+
+  // The pending texture is left alone
+  residency.request(id, 0);
+  EXPECT_TRUE(residency.update().empty());
+  residency.complete(id);
+  EXPECT_FALSE(residency.is_pending(id));
+  EXPECT_EQ(residency.resident_mip(id), 1U);
+
+  // The level never drops below the tail
+  residency.request(id, 7);
+  EXPECT_TRUE(residency.update().empty());
+}
+
+TEST(TextureResidencyTest, UpgradesFitTheBudget) {
+  const auto sizes = mip_sizes();
+  auto residency   = TextureResidency::create({.budget_bytes = 1536 * 1024});
+  const auto a     = residency.add(sizes, 5);
+  const auto b     = residency.add(sizes, 5);
+
+  // Level 0 alone is 4 MiB, the finest level that fits the budget is 1
+  residency.request(a, 0);
+  auto changes = apply(residency);
+  ASSERT_EQ(changes.size(), 1U);
+  EXPECT_EQ(changes[0].first_mip, 1U);
+
+  // The rest of the budget fits the level 3 of b, not the requested 2
+  residency.request(b, 2);
+  changes = apply(residency);
+  ASSERT_EQ(changes.size(), 1U);
+  EXPECT_EQ(changes[0].id, b);
+  EXPECT_EQ(changes[0].first_mip, 3U);
+  EXPECT_LE(residency.committed_bytes(), residency.budget_bytes());
+
+  residency.request(b, 2);
+  EXPECT_TRUE(apply(residency).empty());
+
+  // A cancelled change returns its memory
+  residency.remove(a);
+  residency.request(b, 2);
+  ASSERT_EQ(residency.update().size(), 1U);
+  EXPECT_EQ(residency.committed_bytes(), residency.size_bytes(b, 2));
+  residency.cancel(b);
+  EXPECT_FALSE(residency.is_pending(b));
+  EXPECT_EQ(residency.committed_bytes(), residency.size_bytes(b, 3));
+}
+
+TEST(TextureResidencyTest, UploadLimitPostponesUpgrades) {
+  const auto sizes = mip_sizes();
+  auto residency   = TextureResidency::create({.max_upload_bytes_per_update = 1024 * 1024});
+  const auto a     = residency.add(sizes, 5);
+  const auto b     = residency.add(sizes, 5);
+
+  // The first upgrade is started even though it exceeds the limit
+  residency.request(a, 0);
+  residency.request(b, 0);
+  auto changes = apply(residency);
+  ASSERT_EQ(changes.size(), 1U);
+  EXPECT_EQ(changes[0].first_mip, 0U);
+
+  residency.request(a, 0);
+  residency.request(b, 0);
+  changes = apply(residency);
+  ASSERT_EQ(changes.size(), 1U);
+  EXPECT_EQ(residency.resident_mip(a), 0U);
+  EXPECT_EQ(residency.resident_mip(b), 0U);
+}
+
+TEST(TextureResidencyTest, MemoryPressureEvictsTheExpiredRequests) {
+  const auto sizes = mip_sizes();
+  auto residency   = TextureResidency::create({.request_lifetime = 2});
+  const auto a     = residency.add(sizes, 6);
+  const auto b     = residency.add(sizes, 6);
+
+  residency.request(a, 0);
+  residency.request(b, 0);
+  EXPECT_EQ(apply(residency).size(), 2U);
+
+  // Within the budget the expired levels are kept
+  for (auto i = 0; i < 3; ++i) {
+    residency.request(b, 0);
+    EXPECT_TRUE(apply(residency).empty());
+  }
+  EXPECT_EQ(residency.resident_mip(a), 0U);
+
+  // Under the pressure only the texture that is not requested anymore is evicted and nothing is loaded
+  residency.request(b, 0);
+  const auto changes = apply(residency, true);
+  ASSERT_EQ(changes.size(), 1U);
+  EXPECT_EQ(changes[0].id, a);
+  EXPECT_EQ(changes[0].first_mip, 6U);
+  EXPECT_EQ(residency.resident_mip(b), 0U);
+
+  residency.request(a, 0);
+  EXPECT_TRUE(apply(residency, true).empty());
+
+  residency.remove(a);
+  residency.remove(b);
+  EXPECT_EQ(residency.committed_bytes(), 0U);
+  const auto c = residency.add(sizes, 6);
+  EXPECT_EQ(residency.resident_mip(c), 6U);
+}
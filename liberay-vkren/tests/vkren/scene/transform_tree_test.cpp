@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <liberay/util/alloc_tracker.hpp>
+#include <liberay/util/job_system.hpp>
 #include <liberay/vkren/scene/transform_tree.hpp>
+#include <vector>
 
 using FlatTree      = eray::vkren::FlatTree;
 using TransformTree = eray::vkren::TransformTree;
@@ -78,3 +82,221 @@ TEST(TransformTreeTest, WorldModelMatrixPropagatesThroughHierarchy) {
   const math::Mat4f expected_child_world_inv = child_local_inv * parent_local_inv;
   EXPECT_MAT4_NEAR(expected_child_world_inv, tree.world_to_local_matrix(child), 1e-5);
 }
+
+TEST(TransformTreeTest, ChildMarkedDirtyBeforeParentSeesUpdatedParent) {
+  auto tree = TransformTree::create(8);
+
+  NodeId parent = tree.create_node();
+  NodeId child  = tree.create_node(parent);
+  tree.update();
+
+  tree.set_local_position(child, math::Vec3f(0.F, 1.F, 0.F));
+  tree.set_local_position(parent, math::Vec3f(1.F, 0.F, 0.F));
+  tree.update();
+
+  EXPECT_MAT4_NEAR(math::translation(math::Vec3f(1.F, 1.F, 0.F)), tree.local_to_world_matrix(child), 1e-5);
+}
+
+TEST(TransformTreeTest, NodeReusingDeletedNodeIndexIsUpdated) {
+  auto tree = TransformTree::create(4);
+
+  NodeId deleted = tree.create_node();
+  tree.set_local_position(deleted, math::Vec3f(5.F, 0.F, 0.F));
+  tree.delete_node(deleted);
+
+  NodeId node = tree.create_node();
+  ASSERT_EQ(FlatTree::index_of(deleted), FlatTree::index_of(node));
+  tree.set_local_position(node, math::Vec3f(0.F, 2.F, 0.F));
+  tree.update();
+
+  EXPECT_MAT4_NEAR(math::translation(math::Vec3f(0.F, 2.F, 0.F)), tree.local_to_world_matrix(node), 1e-5);
+}
+
+TEST(TransformTreeTest, WorldMatricesChangedSinceUpdate) {
+  auto tree = TransformTree::create(16);
+
+  NodeId parent  = tree.create_node();
+  NodeId child   = tree.create_node(parent);
+  NodeId sibling = tree.create_node();
+  tree.update();
+  const auto initial_update = tree.update_count();
+
+  tree.set_local_position(parent, math::Vec3f(1.F, 0.F, 0.F));
+  tree.update();
+  tree.set_local_position(child, math::Vec3f(0.F, 1.F, 0.F));
+  tree.update();
+
+  auto changed = std::vector<uint32_t>();
+  ASSERT_TRUE(tree.world_matrices_changed_since(initial_update, changed));
+  std::ranges::sort(changed);
+  EXPECT_EQ(changed, (std::vector<uint32_t>{static_cast<uint32_t>(FlatTree::index_of(parent)),
+                                            static_cast<uint32_t>(FlatTree::index_of(child))}));
+
+  changed.clear();
+  ASSERT_TRUE(tree.world_matrices_changed_since(initial_update + 1, changed));
+  EXPECT_EQ(changed, (std::vector<uint32_t>{static_cast<uint32_t>(FlatTree::index_of(child))}));
+
+  changed.clear();
+  ASSERT_TRUE(tree.world_matrices_changed_since(tree.update_count(), changed));
+  EXPECT_TRUE(changed.empty());
+
+  for (auto i = 0U; i < TransformTree::kWorldChangesHistory; ++i) {
+    tree.set_local_position(sibling, math::Vec3f(static_cast<float>(i), 0.F, 0.F));
+    tree.update();
+  }
+  EXPECT_FALSE(tree.world_matrices_changed_since(initial_update, changed));
+}
+
+TEST(TransformTreeTest, LocalMatricesMatchGenericComposition) {
+  // Not a multiple of the batch size, so the last batch is partial
+  constexpr auto kNodesCount = 13U;
+  auto tree                  = TransformTree::create(kNodesCount + 1);
+
+  auto nodes      = std::vector<NodeId>();
+  auto transforms = std::vector<Transform>();
+  for (auto i = 0U; i < kNodesCount; ++i) {
+    auto f     = static_cast<float>(i);
+    auto t     = Transform{};
+    t.position = math::Vec3f(f, -2.F * f, 0.5F);
+    t.rotation = math::Quatf::rotation_axis(0.3F * f, math::normalize(math::Vec3f(1.F, f, 2.F)));
+    t.scale    = math::Vec3f(1.F + 0.1F * f, 0.5F, 2.F - 0.1F * f);
+    nodes.push_back(tree.create_node());
+    transforms.push_back(t);
+    tree.set_local_transform(nodes.back(), t);
+  }
+  tree.update();
+
+  // The matrix comparison macro declares its own `i`
+  for (auto n = 0U; n < kNodesCount; ++n) {
+    const auto& t  = transforms[n];
+    const auto& m  = tree.local_to_parent_matrix(nodes[n]);
+    const auto& mi = tree.parent_to_local_matrix(nodes[n]);
+
+    const math::Mat4f expected =
+        math::translation(t.position) * math::rot_mat_from_quat(t.rotation) * math::scale(t.scale);
+    const math::Mat4f expected_inv = math::scale(1.F / (t.scale + 0.000001F)) *
+                                     math::rot_mat_from_quat(math::conjugate(t.rotation)) *
+                                     math::translation(-t.position);
+
+    EXPECT_MAT4_NEAR(expected, m, 1e-4);
+    EXPECT_MAT4_NEAR(expected_inv, mi, 1e-4);
+    EXPECT_MAT4_NEAR(math::Mat4f::identity(), m * mi, 1e-4);
+  }
+}
+
+TEST(TransformTreeTest, ParallelUpdateMatchesSerialUpdate) {
+  constexpr auto kNodesCount = 2000U;
+  auto serial_tree           = TransformTree::create(kNodesCount + 1);
+  auto parallel_tree         = TransformTree::create(kNodesCount + 1);
+  auto jobs                  = eray::util::JobSystem::create(3);
+
+  // Every node is attached to one of the previous ones, so the tree has many levels of different widths
+  auto serial_nodes   = std::vector<NodeId>();
+  auto parallel_nodes = std::vector<NodeId>();
+  for (auto i = 0U; i < kNodesCount; ++i) {
+    if (i < 4) {
+      serial_nodes.push_back(serial_tree.create_node());
+      parallel_nodes.push_back(parallel_tree.create_node());
+    } else {
+      auto parent = i % 5 == 0 ? i - 1 : i / 2;
+      serial_nodes.push_back(serial_tree.create_node(serial_nodes[parent]));
+      parallel_nodes.push_back(parallel_tree.create_node(parallel_nodes[parent]));
+    }
+  }
+
+  const auto set_transforms = [&](uint32_t step) {
+    for (auto i = step % 3U; i < kNodesCount; i += 3) {
+      auto f     = static_cast<float>(i + step);
+      auto t     = Transform{};
+      t.position = math::Vec3f(f * 0.01F, 1.F, -f * 0.02F);
+      t.rotation = math::normalize(math::Quatf(1.F, 0.1F * f, 0.F, 0.01F));
+      t.scale    = math::Vec3f(1.F, 1.F + 0.001F * f, 1.F);
+      serial_tree.set_local_transform(serial_nodes[i], t);
+      parallel_tree.set_local_transform(parallel_nodes[i], t);
+    }
+  };
+
+  for (auto step = 0U; step < 3; ++step) {
+    set_transforms(step);
+    serial_tree.update();
+    parallel_tree.update(*jobs, 16);
+
+    for (auto i = 0U; i < kNodesCount; ++i) {
+      EXPECT_MAT4_NEAR(serial_tree.local_to_world_matrix(serial_nodes[i]),
+                       parallel_tree.local_to_world_matrix(parallel_nodes[i]), 1e-4);
+      EXPECT_MAT4_NEAR(serial_tree.world_to_local_matrix(serial_nodes[i]),
+                       parallel_tree.world_to_local_matrix(parallel_nodes[i]), 1e-4);
+    }
+  }
+}
+
+TEST(TransformTreeTest, LazyInverseWorldMatricesFollowUpdates) {
+  auto cached = TransformTree::create(8);
+  auto plain  = TransformTree::create(8, eray::vkren::InverseWorldMatrices::None);
+
+  const auto set_transforms = [](TransformTree& tree, NodeId parent, NodeId child, float f) {
+    tree.set_local_transform(parent, Transform{
+                                         .position = math::Vec3f(1.F, f, 0.F),
+                                         .rotation = math::Quatf::rotation_axis(f, math::Vec3f(0.F, 0.F, 1.F)),
+                                         .scale    = math::Vec3f(2.F, 1.F, 0.5F),
+                                     });
+    tree.set_local_position(child, math::Vec3f(f, 2.F, 3.F));
+  };
+
+  const auto cached_parent = cached.create_node();
+  const auto cached_child  = cached.create_node(cached_parent);
+  const auto plain_parent  = plain.create_node();
+  const auto plain_child   = plain.create_node(plain_parent);
+
+  const auto identity = math::Mat4f::identity();
+  for (auto step = 0U; step < 3; ++step) {
+    set_transforms(cached, cached_parent, cached_child, static_cast<float>(step));
+    set_transforms(plain, plain_parent, plain_child, static_cast<float>(step));
+    cached.update();
+    plain.update();
+
+    // The batch refreshes the stale matrices on the odd steps, the single node queries on the even ones
+    if (step % 2 == 1) {
+      EXPECT_MAT4_NEAR(identity, cached.local_to_world_matrix(cached_child) *
+                                     cached.world_to_local_matrices()[FlatTree::index_of(cached_child)],
+                       1e-5);
+    }
+    const auto parent_inv = cached.world_to_local_matrix(cached_parent);
+    const auto child_inv  = cached.world_to_local_matrix(cached_child);
+    EXPECT_MAT4_NEAR(identity, cached.local_to_world_matrix(cached_parent) * parent_inv, 1e-5);
+    EXPECT_MAT4_NEAR(identity, cached.local_to_world_matrix(cached_child) * child_inv, 1e-5);
+    EXPECT_MAT4_NEAR(cached.world_to_local_matrix(cached_child), plain.world_to_local_matrix(plain_child), 1e-5);
+  }
+}
+
+TEST(TransformTreeTest, SteadyStateUpdateDoesNotAllocate) {
+  if constexpr (!eray::util::AllocationTracker::kEnabled) {
+    GTEST_SKIP() << "Requires the ERAY_TRACK_ALLOCATIONS build";
+  }
+
+  auto tree       = TransformTree::create(64);
+  const auto root = tree.create_node();
+  auto nodes      = std::vector<NodeId>{root};
+  for (auto i = 1U; i < 32; ++i) {
+    nodes.push_back(tree.create_node(nodes[(i - 1) / 2]));
+  }
+
+  auto move_nodes = [&](float f) {
+    for (auto i = 0U; i < nodes.size(); i += 3) {
+      tree.set_local_position(nodes[i], math::Vec3f(f, static_cast<float>(i), 0.F));
+    }
+  };
+
+  // Grows the dirty buckets and the change lists of the whole history to their steady state sizes
+  for (auto step = 0U; step <= TransformTree::kWorldChangesHistory; ++step) {
+    move_nodes(static_cast<float>(step));
+    tree.update();
+  }
+
+  move_nodes(-1.F);
+  {
+    ERAY_EXPECT_NO_ALLOC();
+    tree.update();
+  }
+  EXPECT_MAT4_NEAR(math::translation(math::Vec3f(-1.F, 0.F, 0.F)), tree.local_to_world_matrix(root), 1e-5);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+#include <liberay/math/packed.hpp>
+#include <liberay/math/vec.hpp>
+#include <liberay/vkren/vertex_format.hpp>
+#include <vector>
+
+using PositionDequantization = eray::vkren::PositionDequantization;
+using VertexEncoding         = eray::vkren::VertexEncoding;
+using VertexLayout           = eray::vkren::VertexLayout;
+using VertexSemantic         = eray::vkren::VertexSemantic;
+using VertexStreams          = eray::vkren::VertexStreams;
+namespace math               = eray::math;
+
+namespace {
+
+template <typename T>
+T read_attribute(const std::vector<std::byte>& vertices, size_t offset) {
+  auto result = T{};
+  std::memcpy(&result, vertices.data() + offset, sizeof(T));
+  return result;
+}
+
+}  // namespace
+
+TEST(VertexFormatTest, CompactLayoutPicksCompressedEncodings) {
+  const auto semantics = {VertexSemantic::Position, VertexSemantic::Normal, VertexSemantic::Tangent,
+                          VertexSemantic::Color, VertexSemantic::TexCoord};
+  const auto compact   = VertexLayout::compact(semantics);
+  const auto baseline  = VertexLayout::uncompressed(semantics);
+  EXPECT_EQ(compact.stride(), 24U);
+  EXPECT_EQ(baseline.stride(), 64U);
+
+  const auto attributes = compact.attribute_descriptions(1);
+  ASSERT_EQ(attributes.size(), 5U);
+  EXPECT_EQ(attributes[0].format, vk::Format::eR16G16B16A16Unorm);
+  EXPECT_EQ(attributes[1].format, vk::Format::eR16G16Snorm);
+  EXPECT_EQ(attributes[2].format, vk::Format::eA2B10G10R10SnormPack32);
+  EXPECT_EQ(attributes[3].format, vk::Format::eR8G8B8A8Unorm);
+  EXPECT_EQ(attributes[4].format, vk::Format::eR16G16Sfloat);
+  for (auto i = 0U; i < attributes.size(); ++i) {
+    EXPECT_EQ(attributes[i].location, i);
+    EXPECT_EQ(attributes[i].binding, 1U);
+    EXPECT_EQ(attributes[i].offset % 4, 0U);
+  }
+  EXPECT_EQ(compact.binding_description().stride, compact.stride());
+}
+
+TEST(VertexFormatTest, PositionOnlyInputReadsTheSameVertices) {
+  const auto layout    = VertexLayout::compact({VertexSemantic::Normal, VertexSemantic::Position});
+  const auto positions = layout.position_attribute_descriptions(2);
+  ASSERT_EQ(positions.size(), 1U);
+  EXPECT_EQ(positions[0].location, 1U);
+  EXPECT_EQ(positions[0].binding, 2U);
+  EXPECT_EQ(positions[0].format, vk::Format::eR16G16B16A16Unorm);
+  EXPECT_EQ(positions[0].offset, layout.attributes()[1].offset);
+
+  EXPECT_TRUE(VertexLayout::compact({VertexSemantic::Normal}).position_attribute_descriptions().empty());
+}
+
+TEST(VertexFormatTest, EncodedVerticesDecodeWithinQuantizationError) {
+  const auto positions = std::vector<math::Vec3f>{math::Vec3f(-2.F, 0.F, 1.F), math::Vec3f(3.F, 4.F, 1.F),
+                                                  math::Vec3f(0.5F, 1.F, 1.F)};
+  const auto normals   = std::vector<math::Vec3f>{math::Vec3f(0.F, 0.F, 1.F), math::Vec3f(0.F, -1.F, 0.F),
+                                                  math::Vec3f(0.6F, 0.F, -0.8F)};
+  const auto uvs       = std::vector<math::Vec2f>{math::Vec2f(0.F, 0.F), math::Vec2f(1.F, 0.25F),
+                                                  math::Vec2f(0.5F, 1.F)};
+
+  const auto layout  =
+      VertexLayout::compact({VertexSemantic::Position, VertexSemantic::Normal, VertexSemantic::TexCoord});
+  auto vertices      = std::vector<std::byte>(layout.size_bytes(positions.size()));
+  const auto streams = VertexStreams{.positions = positions, .normals = normals, .tex_coords = uvs};
+  const auto dequant = layout.encode(streams, vertices);
+
+  // The flat z extent keeps a unit scale
+  EXPECT_FLOAT_EQ(dequant.scale.z(), 1.F);
+  EXPECT_FLOAT_EQ(dequant.offset.x(), -2.F);
+
+  const auto attributes = layout.attributes();
+  for (auto i = 0U; i < positions.size(); ++i) {
+    const auto base     = i * layout.stride();
+    const auto position = dequant.decode(read_attribute<math::Unorm16x4>(vertices, base + attributes[0].offset));
+    const auto normal   = math::oct_decode(read_attribute<math::Snorm16x2>(vertices, base + attributes[1].offset));
+    const auto uv       = read_attribute<math::Half2>(vertices, base + attributes[2].offset).to_vec();
+
+    EXPECT_LT(math::distance(position, positions[i]), 5.F / 65535.F) << "vertex: " << i;
+    EXPECT_LT(math::distance(normal, normals[i]), 1e-4F) << "vertex: " << i;
+    EXPECT_NEAR(uv.x(), uvs[i].x(), 1e-3F);
+    EXPECT_NEAR(uv.y(), uvs[i].y(), 1e-3F);
+  }
+}
+
+TEST(VertexFormatTest, InvalidEncodingsHaveNoFormat) {
+  EXPECT_EQ(eray::vkren::vertex_encoding_format(VertexSemantic::Color, VertexEncoding::Octahedral),
+            vk::Format::eUndefined);
+  EXPECT_EQ(eray::vkren::vertex_encoding_size(VertexSemantic::TexCoord, VertexEncoding::QuantizedUnorm16), 0U);
+  EXPECT_EQ(PositionDequantization::from_bounds(eray::math::Aabb3f()).scale.x(), 1.F);
+}
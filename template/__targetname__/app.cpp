@@ -83,7 +83,7 @@ void __class__::on_init() {
         .minLod           = 0.F,
         .maxLod           = vk::LodClampNone,
     };
-    txt_sampler_ = vkren::Result(device().vk().createSampler(sampler_info)).or_panic("Could not create the sampler");
+    txt_sampler_ = device().sampler(sampler_info).or_panic("Could not create the sampler");
   }
 
   // == Descriptors setup ============================================================================================
@@ -20,7 +20,7 @@ struct UniformBufferObject {
 
 class __class__ : public eray::vkren::VulkanApplication {
  private:
-  vk::raii::Sampler txt_sampler_ = nullptr;
+  vk::Sampler txt_sampler_ = nullptr;
 
   static constexpr auto kViewportSizeX = 1280U;
   static constexpr auto kViewportSizeY = 720U;
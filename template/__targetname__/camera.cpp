@@ -88,9 +88,8 @@ void Camera::recalculate() {
 
   view_ = math::translation(math::Vec3f(0.F, 0.F, -distance_)) * math::rotation_x(-pitch_) * math::rotation_y(-yaw_) *
           math::translation(-origin_);
-  inv_view_ = math::translation(origin_) * math::rotation_y(yaw_) * math::rotation_x(pitch_) *
-              math::translation(math::Vec3f(0.F, 0.F, distance_));
-  pos_ = math::Vec3f(inv_view_ * math::Vec4f(0.F, 0.F, 1.F, 1.F));
+  inv_view_ = math::inverse_rigid(view_);
+  pos_      = math::Vec3f(inv_view_ * math::Vec4f(0.F, 0.F, 1.F, 1.F));
 
   if (is_orthographic_) {
     projection_     = eray::math::orthographic_vk_rh(-width_, width_, -height_, height_, near_plane_, far_plane_);
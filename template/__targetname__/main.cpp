@@ -22,8 +22,8 @@ int main() {
   {
     auto app =
         eray::vkren::VulkanApplication::create<__namespace__::__class__>(eray::vkren::VulkanApplicationCreateInfo{
-            .app_name = "__class__",
-            .vsync    = false,
+            .app_name     = "__class__",
+            .present_mode = eray::vkren::PresentMode::Immediate,
         });
     app.run();
   }
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <numbers>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compares the frame times of two `vkren::FrameBenchmark` reports, e.g. written by `cmake/run_benchmark_scenes.cmake`
+// before and after an upgrade, with the two-sided Mann-Whitney U test. The frame times of a run are rarely normally
+// distributed (the hitches form a long tail), the rank test does not assume any distribution.
+//
+// Usage: bench_compare <baseline> <candidate> [--alpha=<p>] [--threshold=<percent>]
+//
+// Both paths are either reports or directories of reports, the directories are compared by the report names. A scene
+// regresses when its median frame time grows by more than the threshold (2% by default) and the difference is
+// significant at the alpha level (0.01 by default). The exit code is 1 if any scene regresses, 2 on invalid input.
+
+namespace {
+
+namespace fs = std::filesystem;
+
+struct Options {
+  double alpha         = 0.01;
+  double threshold_pct = 2.0;
+};
+
+struct MannWhitneyResult {
+  double u       = 0.0;
+  double z       = 0.0;
+  double p_value = 1.0;
+};
+
+std::optional<std::string> read_file(const fs::path& path) {
+  auto file = std::ifstream(path);
+  if (!file) {
+    return std::nullopt;
+  }
+  auto stream = std::ostringstream();
+  stream << file.rdbuf();
+  return std::move(stream).str();
+}
+
+/**
+ * @brief Parses the number array of the key, e.g. `"cpu_frame_times_ms": [1.0, 2.0]`. The reports are written by the
+ * engine, so only the arrays of numbers are supported.
+ *
+ */
+std::optional<std::vector<double>> read_samples(std::string_view json, std::string_view key) {
+  const auto quoted_key = std::format(R"("{}")", key);
+  auto pos              = json.find(quoted_key);
+  if (pos == std::string_view::npos) {
+    return std::nullopt;
+  }
+  pos = json.find_first_not_of(" \t\r\n:", pos + quoted_key.size());
+  if (pos == std::string_view::npos || json[pos] != '[') {
+    return std::nullopt;
+  }
+
+  auto samples = std::vector<double>();
+  ++pos;
+  while (true) {
+    pos = json.find_first_not_of(" \t\r\n,", pos);
+    if (pos == std::string_view::npos) {
+      return std::nullopt;
+    }
+    if (json[pos] == ']') {
+      return samples;
+    }
+    auto value       = 0.0;
+    const auto* last = json.data() + json.size();
+    auto [ptr, ec]   = std::from_chars(json.data() + pos, last, value);
+    if (ec != std::errc{}) {
+      return std::nullopt;
+    }
+    samples.push_back(value);
+    pos = static_cast<size_t>(ptr - json.data());
+  }
+}
+
+double median(std::vector<double> samples) {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  const auto mid = samples.size() / 2;
+  std::ranges::nth_element(samples, samples.begin() + static_cast<std::ptrdiff_t>(mid));
+  if (samples.size() % 2 == 1) {
+    return samples[mid];
+  }
+  // The lower middle is the largest of the lower half left by the `nth_element`
+  const auto lower = *std::max_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(mid));
+  return (lower + samples[mid]) / 2.0;
+}
+
+/**
+ * @brief Two-sided Mann-Whitney U test with the normal approximation, corrected for the ties and the continuity. The
+ * approximation is accurate for the hundreds of frames of a benchmark run.
+ *
+ */
+MannWhitneyResult mann_whitney_u(const std::vector<double>& baseline, const std::vector<double>& candidate) {
+  struct Sample {
+    double value;
+    bool baseline;
+  };
+
+  auto samples = std::vector<Sample>();
+  samples.reserve(baseline.size() + candidate.size());
+  for (const auto value : baseline) {
+    samples.push_back(Sample{.value = value, .baseline = true});
+  }
+  for (const auto value : candidate) {
+    samples.push_back(Sample{.value = value, .baseline = false});
+  }
+  std::ranges::sort(samples, {}, &Sample::value);
+
+  // The tied samples share the average of their ranks
+  const auto n       = static_cast<double>(samples.size());
+  auto baseline_rank = 0.0;
+  auto tie_term      = 0.0;
+  for (auto first = size_t{0}; first < samples.size();) {
+    auto last = first + 1;
+    while (last < samples.size() && samples[last].value == samples[first].value) {
+      ++last;
+    }
+    const auto rank = (static_cast<double>(first + last) + 1.0) / 2.0;
+    const auto ties = static_cast<double>(last - first);
+    tie_term += (ties * ties * ties) - ties;
+    for (auto i = first; i < last; ++i) {
+      if (samples[i].baseline) {
+        baseline_rank += rank;
+      }
+    }
+    first = last;
+  }
+
+  const auto n1    = static_cast<double>(baseline.size());
+  const auto n2    = static_cast<double>(candidate.size());
+  auto result      = MannWhitneyResult{};
+  result.u         = baseline_rank - (n1 * (n1 + 1.0) / 2.0);
+  const auto mean  = n1 * n2 / 2.0;
+  const auto sigma = std::sqrt(n1 * n2 / 12.0 * ((n + 1.0) - (tie_term / (n * (n - 1.0)))));
+  if (!(sigma > 0.0)) {
+    return result;
+  }
+
+  const auto diff = result.u - mean;
+  result.z        = std::copysign(std::max(std::abs(diff) - 0.5, 0.0), diff) / sigma;
+  result.p_value  = std::erfc(std::abs(result.z) / std::numbers::sqrt2);
+  return result;
+}
+
+/**
+ * @brief Compares the frame times of the key, returns true if the candidate regressed.
+ *
+ */
+bool compare_samples(std::string_view scene, std::string_view key, std::string_view baseline_json,
+                     std::string_view candidate_json, const Options& options) {
+  auto baseline  = read_samples(baseline_json, key);
+  auto candidate = read_samples(candidate_json, key);
+  if (!baseline || !candidate || baseline->size() < 2 || candidate->size() < 2) {
+    std::println("{:<32} {:<20} {:>10}", scene, key, "no samples");
+    return false;
+  }
+
+  const auto baseline_median  = median(*baseline);
+  const auto candidate_median = median(*candidate);
+  const auto delta_pct        = baseline_median > 0.0 ? (candidate_median / baseline_median - 1.0) * 100.0 : 0.0;
+  const auto test             = mann_whitney_u(*baseline, *candidate);
+  const auto significant      = test.p_value < options.alpha;
+
+  auto verdict = std::string_view("");
+  if (significant && delta_pct > options.threshold_pct) {
+    verdict = "REGRESSION";
+  } else if (significant && delta_pct < -options.threshold_pct) {
+    verdict = "improvement";
+  }
+  std::println("{:<32} {:<20} {:>10.3f} {:>10.3f} {:>+8.2f}% {:>10.2e}  {}", scene, key, baseline_median,
+               candidate_median, delta_pct, test.p_value, verdict);
+
+  return verdict == "REGRESSION";
+}
+
+/**
+ * @brief Returns nullopt if a report cannot be read, true if the scene regressed.
+ *
+ */
+std::optional<bool> compare_reports(std::string_view scene, const fs::path& baseline_path,
+                                    const fs::path& candidate_path, const Options& options) {
+  const auto baseline  = read_file(baseline_path);
+  const auto candidate = read_file(candidate_path);
+  if (!baseline || !candidate) {
+    std::println(stderr, R"(Could not read "{}" or "{}")", baseline_path.string(), candidate_path.string());
+    return std::nullopt;
+  }
+
+  auto regressed = compare_samples(scene, "cpu_frame_times_ms", *baseline, *candidate, options);
+  regressed      = compare_samples(scene, "gpu_frame_times_ms", *baseline, *candidate, options) || regressed;
+  return regressed;
+}
+
+std::optional<double> parse_option(std::string_view arg, std::string_view name) {
+  if (!arg.starts_with(name)) {
+    return std::nullopt;
+  }
+  arg.remove_prefix(name.size());
+  auto value     = 0.0;
+  auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+  if (ec != std::errc{} || ptr != arg.data() + arg.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto options = Options{};
+  auto paths   = std::vector<fs::path>();
+  for (auto i = 1; i < argc; ++i) {
+    const auto arg = std::string_view(argv[i]);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (auto alpha = parse_option(arg, "--alpha=")) {
+      options.alpha = *alpha;
+    } else if (auto threshold = parse_option(arg, "--threshold=")) {
+      options.threshold_pct = *threshold;
+    } else if (arg.starts_with("--")) {
+      std::println(stderr, "Unknown option {}", arg);
+      return 2;
+    } else {
+      paths.emplace_back(arg);
+    }
+  }
+  if (paths.size() != 2) {
+    std::println(stderr, "Usage: bench_compare <baseline> <candidate> [--alpha=<p>] [--threshold=<percent>]");
+    return 2;
+  }
+
+  std::println("{:<32} {:<20} {:>10} {:>10} {:>9} {:>10}", "Scene", "Frame times", "Base [ms]", "New [ms]", "Delta",
+               "p");
+
+  auto regressions = 0U;
+  auto failed      = false;
+  const auto count = [&](std::optional<bool> result) {
+    failed = failed || !result;
+    regressions += result.value_or(false) ? 1U : 0U;
+  };
+
+  if (fs::is_directory(paths[0]) && fs::is_directory(paths[1])) {
+    auto reports = std::vector<fs::path>();
+    for (const auto& entry : fs::directory_iterator(paths[0])) {
+      if (entry.path().extension() == ".json") {
+        reports.push_back(entry.path().filename());
+      }
+    }
+    std::ranges::sort(reports);
+    for (const auto& report : reports) {
+      if (!fs::exists(paths[1] / report)) {
+        std::println("{:<32} missing in the candidate", report.stem().string());
+        continue;
+      }
+      count(compare_reports(report.stem().string(), paths[0] / report, paths[1] / report, options));
+    }
+  } else {
+    count(compare_reports(paths[1].stem().string(), paths[0], paths[1], options));
+  }
+
+  if (failed) {
+    return 2;
+  }
+  if (regressions > 0) {
+    std::println("{} regression(s) at alpha {} and threshold {}%", regressions, options.alpha, options.threshold_pct);
+    return 1;
+  }
+  return 0;
+}